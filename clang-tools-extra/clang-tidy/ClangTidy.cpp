@@ -46,7 +46,10 @@
 #include "clang/Tooling/Tooling.h"
 #include "llvm/Support/Process.h"
 #include "llvm/Support/Signals.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
+#include <mutex>
 #include <utility>
 
 using namespace clang::ast_matchers;
@@ -484,12 +487,13 @@ getCheckOptions(const ClangTidyOptions &Options,
   return Factory.getCheckOptions();
 }
 
-std::vector<ClangTidyError>
-runClangTidy(clang::tidy::ClangTidyContext &Context,
-             const CompilationDatabase &Compilations,
-             ArrayRef<std::string> InputFiles,
-             llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
-             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile) {
+static std::vector<ClangTidyError>
+runClangTidyOnFiles(ClangTidyContext &Context,
+                    const CompilationDatabase &Compilations,
+                    ArrayRef<std::string> InputFiles,
+                    IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+                    bool EnableCheckProfile, StringRef StoreCheckProfile,
+                    bool RemoveIncompatibleErrors) {
   ClangTool Tool(Compilations, InputFiles,
                  std::make_shared<PCHContainerOperations>(), BaseFS);
 
@@ -516,7 +520,8 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
   Context.setEnableProfiling(EnableCheckProfile);
   Context.setProfileStoragePrefix(StoreCheckProfile);
 
-  ClangTidyDiagnosticConsumer DiagConsumer(Context);
+  ClangTidyDiagnosticConsumer DiagConsumer(
+      Context, /*ExternalDiagEngine=*/nullptr, RemoveIncompatibleErrors);
   DiagnosticsEngine DE(new DiagnosticIDs(), new DiagnosticOptions(),
                        &DiagConsumer, /*ShouldOwnClient=*/false);
   Context.setDiagnosticsEngine(&DE);
@@ -562,6 +567,96 @@ runClangTidy(clang::tidy::ClangTidyContext &Context,
   return DiagConsumer.take();
 }
 
+namespace {
+/// Gives the context of a worker thread the options of the main context.
+/// Options providers cache what they read, so the calls are serialized.
+class SharedOptionsProvider : public ClangTidyOptionsProvider {
+public:
+  SharedOptionsProvider(const ClangTidyContext &Context, std::mutex &Mutex)
+      : Context(Context), Mutex(Mutex) {}
+
+  const ClangTidyGlobalOptions &getGlobalOptions() override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return Context.getGlobalOptions();
+  }
+
+  std::vector<OptionsSource> getRawOptions(StringRef FileName) override {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    return {OptionsSource(Context.getOptionsForFile(FileName),
+                          "main clang-tidy context")};
+  }
+
+private:
+  const ClangTidyContext &Context;
+  std::mutex &Mutex;
+};
+} // namespace
+
+std::vector<ClangTidyError>
+runClangTidy(clang::tidy::ClangTidyContext &Context,
+             const CompilationDatabase &Compilations,
+             ArrayRef<std::string> InputFiles,
+             llvm::IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> BaseFS,
+             bool EnableCheckProfile, llvm::StringRef StoreCheckProfile,
+             unsigned Threads) {
+  if (Threads == 0)
+    Threads = llvm::hardware_concurrency();
+  Threads = std::min<size_t>(Threads, InputFiles.size());
+  // ClangTool changes the working directory of its file system for each
+  // compile command. The workers need file systems of their own for that,
+  // which is only possible if BaseFS has no overlay pushed on top of the real
+  // file system.
+  if (Threads <= 1 ||
+      std::distance(BaseFS->overlays_begin(), BaseFS->overlays_end()) != 1)
+    return runClangTidyOnFiles(Context, Compilations, InputFiles, BaseFS,
+                               EnableCheckProfile, StoreCheckProfile,
+                               /*RemoveIncompatibleErrors=*/true);
+
+  // Each worker has its own context and a ClangTool for a contiguous range of
+  // the input files. Neighbouring files tend to include the same headers,
+  // which the FileManager of the ClangTool then reads once.
+  std::mutex OptionsMutex;
+  std::mutex ResultMutex;
+  std::vector<ClangTidyError> Errors;
+  ClangTidyStats Stats;
+  size_t FilesPerThread = (InputFiles.size() + Threads - 1) / Threads;
+  llvm::ThreadPool Pool(Threads);
+  for (size_t Begin = 0; Begin < InputFiles.size(); Begin += FilesPerThread) {
+    ArrayRef<std::string> WorkerFiles = InputFiles.slice(
+        Begin, std::min(FilesPerThread, InputFiles.size() - Begin));
+    Pool.async([&, WorkerFiles] {
+      ClangTidyContext WorkerContext(
+          llvm::make_unique<SharedOptionsProvider>(Context, OptionsMutex),
+          Context.canEnableAnalyzerAlphaCheckers());
+      IntrusiveRefCntPtr<llvm::vfs::FileSystem> PhysicalFS =
+          llvm::vfs::createPhysicalFileSystem().release();
+      IntrusiveRefCntPtr<llvm::vfs::OverlayFileSystem> WorkerFS(
+          new llvm::vfs::OverlayFileSystem(PhysicalFS));
+      std::vector<ClangTidyError> WorkerErrors = runClangTidyOnFiles(
+          WorkerContext, Compilations, WorkerFiles, WorkerFS,
+          EnableCheckProfile, StoreCheckProfile,
+          /*RemoveIncompatibleErrors=*/false);
+
+      std::lock_guard<std::mutex> Lock(ResultMutex);
+      const ClangTidyStats &WorkerStats = WorkerContext.getStats();
+      Stats.ErrorsIgnoredCheckFilter += WorkerStats.ErrorsIgnoredCheckFilter;
+      Stats.ErrorsIgnoredNOLINT += WorkerStats.ErrorsIgnoredNOLINT;
+      Stats.ErrorsIgnoredNonUserCode += WorkerStats.ErrorsIgnoredNonUserCode;
+      Stats.ErrorsIgnoredLineFilter += WorkerStats.ErrorsIgnoredLineFilter;
+      Errors.insert(Errors.end(), std::make_move_iterator(WorkerErrors.begin()),
+                    std::make_move_iterator(WorkerErrors.end()));
+    });
+  }
+  Pool.wait();
+
+  // Headers included by files processed on different workers are diagnosed
+  // by each of them. They are displayed once, and counted once.
+  removeDuplicatedErrors(Errors, /*RemoveIncompatibleErrors=*/true);
+  Stats.ErrorsDisplayed = Errors.size();
+  Context.addStats(Stats);
+  return Errors;
+}
+
 void handleErrors(llvm::ArrayRef<ClangTidyError> Errors,
                   ClangTidyContext &Context, bool Fix,
                   unsigned &WarningsAsErrorsCount,
@@ -165,6 +165,10 @@ public:
   /// counters.
   const ClangTidyStats &getStats() const { return Stats; }
 
+  /// \brief Adds the counters of \p Other, collected by a context that
+  /// processed a part of the input files, to the counters of this context.
+  void addStats(const ClangTidyStats &Other);
+
   /// \brief Control profile collection in clang-tidy.
   void setEnableProfiling(bool Profile);
   bool getEnableProfiling() const { return Profile; }
@@ -243,6 +247,15 @@ bool ShouldSuppressDiagnostic(DiagnosticsEngine::Level DiagLevel,
                               const Diagnostic &Info, ClangTidyContext &Context,
                               bool CheckMacroExpansion = true);
 
+/// \brief Sorts \p Errors and removes the duplicated ones. If
+/// \p RemoveIncompatibleErrors is true, the fixes of errors whose replacements
+/// overlap are dropped.
+///
+/// \c ClangTidyDiagnosticConsumer::take() does this for the errors it
+/// collected; errors merged from several consumers need it once more.
+void removeDuplicatedErrors(std::vector<ClangTidyError> &Errors,
+                            bool RemoveIncompatibleErrors);
+
 /// \brief A diagnostic consumer that turns each \c Diagnostic into a
 /// \c SourceManager-independent \c ClangTidyError.
 //
@@ -265,7 +278,6 @@ public:
 
 private:
   void finalizeLastError();
-  void removeIncompatibleErrors();
 
   /// \brief Returns the \c HeaderFilter constructed for the options set in the
   /// context.
@@ -223,6 +223,16 @@ over the real file system.
                                        cl::value_desc("filename"),
                                        cl::cat(ClangTidyCategory));
 
+static cl::opt<unsigned> Jobs("j", cl::desc(R"(
+Number of threads processing the input files in
+parallel. Headers included by files processed on
+different threads are parsed by each of them, but
+their diagnostics are reported once. 0 uses all
+the hardware threads.
+)"),
+                              cl::init(1), cl::value_desc("threads"),
+                              cl::cat(ClangTidyCategory));
+
 namespace clang {
 namespace tidy {
 
@@ -428,7 +438,7 @@ static int clangTidyMain(int argc, const char **argv) {
                            AllowEnablingAnalyzerAlphaCheckers);
   std::vector<ClangTidyError> Errors =
       runClangTidy(Context, OptionsParser.getCompilations(), PathList, BaseFS,
-                   EnableCheckProfile, ProfilePrefix);
+                   EnableCheckProfile, ProfilePrefix, Jobs);
   bool FoundErrors = llvm::find_if(Errors, [](const ClangTidyError &E) {
                        return E.DiagLevel == ClangTidyError::Error;
                      }) != Errors.end();
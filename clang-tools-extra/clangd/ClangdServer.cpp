@@ -128,7 +128,9 @@ ClangdServer::ClangdServer(const GlobalCompilationDatabase &CDB,
     BackgroundIdx = llvm::make_unique<BackgroundIndex>(
         Context::current().clone(), FSProvider, CDB,
         BackgroundIndexStorage::createDiskBackedStorageFactory(),
-        Opts.BackgroundIndexRebuildPeriodMs);
+        Opts.BackgroundIndexRebuildPeriodMs,
+        llvm::heavyweight_hardware_concurrency(),
+        Opts.BackgroundIndexMemoryLimit);
     AddIndex(BackgroundIdx.get());
   }
   if (DynamicIdx)
@@ -153,6 +155,10 @@ void ClangdServer::addDocument(PathRef File, llvm::StringRef Contents,
   Inputs.Opts = std::move(Opts);
   Inputs.Index = Index;
   WorkScheduler.update(File, Inputs, WantDiags);
+
+  // Index the TUs related to open and recently edited files first.
+  if (BackgroundIdx)
+    BackgroundIdx->boostRelated(File);
 }
 
 void ClangdServer::removeDocument(PathRef File) { WorkScheduler.remove(File); }
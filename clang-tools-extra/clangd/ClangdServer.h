@@ -102,6 +102,10 @@ public:
     /// periodically every BuildIndexPeriodMs milliseconds; otherwise, the
     /// symbol index will be updated for each indexed file.
     size_t BackgroundIndexRebuildPeriodMs = 0;
+    /// If set to non-zero, the background index evicts references from memory
+    /// when it grows beyond this many bytes, and reloads them from disk when a
+    /// related file is opened.
+    size_t BackgroundIndexMemoryLimit = 0;
 
     /// If set, use this index to augment code completion results.
     SymbolIndex *StaticIndex = nullptr;
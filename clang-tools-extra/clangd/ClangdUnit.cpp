@@ -631,6 +631,25 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
   }
 }
 
+bool canPatchPreamble(const PreambleData &Preamble,
+                      const tooling::CompileCommand &PreambleCommand,
+                      const CompilerInvocation &CI, const ParseInputs &Inputs) {
+  if (!compileCommandsAreEqual(Inputs.CompileCommand, PreambleCommand))
+    return false;
+  auto ContentsBuffer = llvm::MemoryBuffer::getMemBuffer(Inputs.Contents);
+  auto Bounds =
+      ComputePreambleBounds(*CI.getLangOpts(), ContentsBuffer.get(), 0);
+  PreambleBounds OldBounds = Preamble.Preamble.getBounds();
+  // If the preamble section didn't grow, the preamble is either reused as is
+  // or the section was edited.
+  if (Bounds.Size <= OldBounds.Size || !OldBounds.PreambleEndsAtStartOfLine)
+    return false;
+  // This checks that the old section is a prefix of the new contents and that
+  // none of the files in the preamble changed.
+  return Preamble.Preamble.CanReuse(CI, ContentsBuffer.get(), OldBounds,
+                                    Inputs.FS.get());
+}
+
 llvm::Optional<ParsedAST>
 buildAST(PathRef FileName, std::unique_ptr<CompilerInvocation> Invocation,
          const ParseInputs &Inputs,
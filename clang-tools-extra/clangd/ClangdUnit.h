@@ -169,6 +169,17 @@ buildPreamble(PathRef FileName, CompilerInvocation &CI,
               const ParseInputs &Inputs, bool StoreInMemory,
               PreambleParsedCallback PreambleCallback);
 
+/// Returns true if \p Preamble, which was built for an earlier version of the
+/// file with \p PreambleCommand, can't be reused for \p Inputs but can still
+/// be used to build an AST for them. This is the case when the old preamble
+/// section is a prefix of the new one, e.g. when an #include was added at the
+/// end of it: the new directives are parsed as part of the main file. Such an
+/// AST is slower to build than with an up to date preamble, but much faster
+/// than rebuilding the preamble first.
+bool canPatchPreamble(const PreambleData &Preamble,
+                      const tooling::CompileCommand &PreambleCommand,
+                      const CompilerInvocation &CI, const ParseInputs &Inputs);
+
 /// Build an AST from provided user inputs. This function does not check if
 /// preamble can be reused, as this function expects that \p Preamble is the
 /// result of calling buildPreamble.
@@ -410,6 +410,25 @@ void ASTWorker::update(ParseInputs Inputs, WantDiagnostics WantDiags) {
 
     std::shared_ptr<const PreambleData> OldPreamble =
         getPossiblyStalePreamble();
+    // If directives were only added at the end of the preamble section, report
+    // diagnostics from an AST built on the old preamble before rebuilding it.
+    // This keeps diagnostics responsive while includes are being edited.
+    if (OldPreamble && WantDiags != WantDiagnostics::No &&
+        canPatchPreamble(*OldPreamble, OldCommand, *Invocation, Inputs)) {
+      vlog("Building AST for {0} with the previous preamble while the new "
+           "one is built.",
+           FileName);
+      emitTUStatus({TUAction::BuildingFile, TaskName});
+      llvm::Optional<ParsedAST> PatchedAST =
+          buildAST(FileName, llvm::make_unique<CompilerInvocation>(*Invocation),
+                   Inputs, OldPreamble);
+      if (PatchedAST) {
+        std::lock_guard<std::mutex> Lock(DiagsMu);
+        if (ReportDiagnostics)
+          Callbacks.onDiagnostics(FileName, PatchedAST->getDiagnostics());
+      }
+      emitTUStatus({TUAction::BuildingPreamble, TaskName});
+    }
     std::shared_ptr<const PreambleData> NewPreamble = buildPreamble(
         FileName, *Invocation, OldPreamble, OldCommand, Inputs,
         StorePreambleInMemory,
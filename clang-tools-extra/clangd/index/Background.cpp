@@ -130,17 +130,23 @@ llvm::SmallString<128> getAbsolutePath(const tooling::CompileCommand &Cmd) {
   }
   return AbsolutePath;
 }
+
+// Files with the same stem are usually a header and its implementation file.
+std::string getStem(llvm::StringRef Path) {
+  return llvm::sys::path::stem(Path).lower();
+}
 } // namespace
 
 BackgroundIndex::BackgroundIndex(
     Context BackgroundContext, const FileSystemProvider &FSProvider,
     const GlobalCompilationDatabase &CDB,
     BackgroundIndexStorage::Factory IndexStorageFactory,
-    size_t BuildIndexPeriodMs, size_t ThreadPoolSize)
+    size_t BuildIndexPeriodMs, size_t ThreadPoolSize, size_t MemoryLimit)
     : SwapIndex(llvm::make_unique<MemIndex>()), FSProvider(FSProvider),
       CDB(CDB), BackgroundContext(std::move(BackgroundContext)),
       BuildIndexPeriodMs(BuildIndexPeriodMs),
       SymbolsUpdatedSinceLastIndex(false),
+      MemoryLimit(MemoryLimit),
       IndexStorageFactory(std::move(IndexStorageFactory)),
       CommandsChanged(
           CDB.watch([&](const std::vector<std::string> &ChangedFiles) {
@@ -188,7 +194,8 @@ void BackgroundIndex::run() {
         return;
       }
       ++NumActiveTasks;
-      std::tie(Task, Priority) = std::move(Queue.front());
+      Task = std::move(Queue.front().Run);
+      Priority = Queue.front().Priority;
       Queue.pop_front();
     }
 
@@ -232,8 +239,28 @@ void BackgroundIndex::enqueue(const std::vector<std::string> &ChangedFiles) {
       llvm::ThreadPriority::Default);
 }
 
+void BackgroundIndex::boostRelated(llvm::StringRef Path) {
+  {
+    std::lock_guard<std::mutex> Lock(QueueMu);
+    bool NewStem = BoostedStems.insert(getStem(Path)).second;
+    bool NewDir = BoostedDirs.insert(llvm::sys::path::parent_path(Path)).second;
+    if (!NewStem && !NewDir)
+      return;
+    std::stable_sort(Queue.begin(), Queue.end(),
+                     [this](const QueuedTask &A, const QueuedTask &B) {
+                       return rankLocked(A) < rankLocked(B);
+                     });
+  }
+  QueueCV.notify_all();
+
+  if (MemoryLimit > 0)
+    enqueueTask([this] { reloadEvictedRefs(); },
+                llvm::ThreadPriority::Default);
+}
+
 void BackgroundIndex::enqueue(tooling::CompileCommand Cmd,
                               BackgroundIndexStorage *Storage) {
+  std::string File = getAbsolutePath(Cmd).str();
   enqueueTask(Bind(
                   [this, Storage](tooling::CompileCommand Cmd) {
                     // We can't use llvm::StringRef here since we are going to
@@ -244,24 +271,43 @@ void BackgroundIndex::enqueue(tooling::CompileCommand Cmd,
                            std::move(Error));
                   },
                   std::move(Cmd)),
-              llvm::ThreadPriority::Background);
+              llvm::ThreadPriority::Background, std::move(File));
 }
 
-void BackgroundIndex::enqueueTask(Task T, llvm::ThreadPriority Priority) {
+bool BackgroundIndex::isBoostedLocked(llvm::StringRef Path) const {
+  return BoostedStems.count(getStem(Path)) ||
+         BoostedDirs.count(llvm::sys::path::parent_path(Path));
+}
+
+unsigned BackgroundIndex::rankLocked(const QueuedTask &T) const {
+  if (T.Priority == llvm::ThreadPriority::Default)
+    return 0;
+  if (T.File.empty())
+    return 3;
+  if (BoostedStems.count(getStem(T.File)))
+    return 1;
+  if (BoostedDirs.count(llvm::sys::path::parent_path(T.File)))
+    return 2;
+  return 3;
+}
+
+void BackgroundIndex::enqueueTask(Task T, llvm::ThreadPriority Priority,
+                                  std::string File) {
   {
     std::lock_guard<std::mutex> Lock(QueueMu);
-    auto I = Queue.end();
+    QueuedTask New{std::move(T), Priority, std::move(File)};
     // We first store the tasks with Normal priority in the front of the queue.
-    // Then we store low priority tasks. Normal priority tasks are pretty rare,
-    // they should not grow beyond single-digit numbers, so it is OK to do
-    // linear search and insert after that.
-    if (Priority == llvm::ThreadPriority::Default) {
-      I = llvm::find_if(
-          Queue, [](const std::pair<Task, llvm::ThreadPriority> &Elem) {
-            return Elem.second == llvm::ThreadPriority::Background;
-          });
-    }
-    Queue.insert(I, {std::move(T), Priority});
+    // Then we store the low priority tasks related to boosted files, and then
+    // the rest. Normal priority and boosted tasks are pretty rare, so it is OK
+    // to do linear search and insert after that. Most tasks have the highest
+    // rank and go to the end of the queue.
+    unsigned Rank = rankLocked(New);
+    auto I = Queue.end();
+    if (Rank < 3)
+      I = llvm::find_if(Queue, [&](const QueuedTask &Elem) {
+        return rankLocked(Elem) > Rank;
+      });
+    Queue.insert(I, std::move(New));
   }
   QueueCV.notify_all();
 }
@@ -349,6 +395,7 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
         getSubGraph(URI::create(Path), Index.Sources.getValue()));
     // We need to store shards before updating the index, since the latter
     // consumes slabs.
+    bool Stored = false;
     if (IndexStorage) {
       IndexFileOut Shard;
       Shard.Symbols = SS.get();
@@ -359,6 +406,8 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
       if (auto Error = IndexStorage->storeShard(Path, Shard))
         elog("Failed to write background-index shard for file {0}: {1}", Path,
              std::move(Error));
+      else
+        Stored = true;
     }
     {
       std::lock_guard<std::mutex> Lock(DigestsMu);
@@ -371,12 +420,102 @@ void BackgroundIndex::update(llvm::StringRef MainFile, IndexFileIn Index,
       // This can override a newer version that is added in another thread, if
       // this thread sees the older version but finishes later. This should be
       // rare in practice.
+      ShardState &State = Shards[Path];
+      State.RefBytes = RS->bytes();
+      State.CountReferences = Path == MainFile;
+      State.Storage = Stored ? IndexStorage : nullptr;
+      State.RefsEvicted = false;
       IndexedSymbols.update(Path, std::move(SS), std::move(RS), std::move(RelS),
                             Path == MainFile);
     }
   }
 }
 
+void BackgroundIndex::enforceMemoryLimit(IndexType Type) {
+  if (MemoryLimit == 0)
+    return;
+  size_t Usage = estimateMemoryUsage();
+  if (Usage <= MemoryLimit)
+    return;
+  // Evict down to three quarters of the limit, so that indexing the next few
+  // files doesn't immediately exceed the limit again.
+  size_t Excess = Usage - MemoryLimit / 4 * 3;
+  size_t Freed = 0;
+  unsigned NumEvicted = 0;
+  {
+    std::lock_guard<std::mutex> QueueLock(QueueMu);
+    std::lock_guard<std::mutex> Lock(DigestsMu);
+    // The references of files related to open files are kept, as they are
+    // the most likely to be needed. The largest shards go first.
+    std::vector<llvm::StringMapEntry<ShardState> *> Candidates;
+    for (auto &Entry : Shards)
+      if (!Entry.second.RefsEvicted && Entry.second.Storage &&
+          Entry.second.RefBytes > 0 && !isBoostedLocked(Entry.first()))
+        Candidates.push_back(&Entry);
+    llvm::sort(Candidates, [](const llvm::StringMapEntry<ShardState> *A,
+                              const llvm::StringMapEntry<ShardState> *B) {
+      return A->second.RefBytes > B->second.RefBytes;
+    });
+    for (auto *Entry : Candidates) {
+      if (Freed >= Excess)
+        break;
+      IndexedSymbols.removeRefs(Entry->first());
+      Entry->second.RefsEvicted = true;
+      Freed += Entry->second.RefBytes;
+      ++NumEvicted;
+    }
+  }
+  if (NumEvicted == 0)
+    return;
+  reset(IndexedSymbols.buildIndex(Type, DuplicateHandling::Merge));
+  log("BackgroundIndex: evicted references of {0} files ({1} bytes) to stay "
+      "within the memory limit of {2} bytes.",
+      NumEvicted, Freed, MemoryLimit);
+}
+
+void BackgroundIndex::reloadEvictedRefs() {
+  trace::Span Tracer("BackgroundIndexReload");
+  std::vector<std::pair<std::string, BackgroundIndexStorage *>> ToReload;
+  {
+    std::lock_guard<std::mutex> QueueLock(QueueMu);
+    std::lock_guard<std::mutex> Lock(DigestsMu);
+    for (const auto &Entry : Shards)
+      if (Entry.second.RefsEvicted && isBoostedLocked(Entry.first()))
+        ToReload.emplace_back(Entry.first(), Entry.second.Storage);
+  }
+  if (ToReload.empty())
+    return;
+  SPAN_ATTACH(Tracer, "files", int64_t(ToReload.size()));
+
+  for (const auto &File : ToReload) {
+    auto Shard = File.second->loadShard(File.first);
+    if (!Shard || !Shard->Symbols || !Shard->Refs) {
+      vlog("Failed to reload shard: {0}", File.first);
+      continue;
+    }
+    std::lock_guard<std::mutex> Lock(DigestsMu);
+    auto It = Shards.find(File.first);
+    // The file may have been re-indexed in the meantime.
+    if (It == Shards.end() || !It->second.RefsEvicted)
+      continue;
+    It->second.RefsEvicted = false;
+    IndexedSymbols.update(
+        File.first, llvm::make_unique<SymbolSlab>(std::move(*Shard->Symbols)),
+        llvm::make_unique<RefSlab>(std::move(*Shard->Refs)),
+        Shard->Relations
+            ? llvm::make_unique<RelationSlab>(std::move(*Shard->Relations))
+            : nullptr,
+        It->second.CountReferences);
+  }
+  vlog("Reloaded references of {0} files", ToReload.size());
+
+  if (BuildIndexPeriodMs > 0)
+    SymbolsUpdatedSinceLastIndex = true;
+  else
+    reset(
+        IndexedSymbols.buildIndex(IndexType::Light, DuplicateHandling::Merge));
+}
+
 void BackgroundIndex::buildIndex() {
   assert(BuildIndexPeriodMs > 0);
   while (true) {
@@ -400,6 +539,7 @@ void BackgroundIndex::buildIndex() {
     log("BackgroundIndex: rebuilt symbol index with estimated memory {0} "
         "bytes.",
         estimateMemoryUsage());
+    enforceMemoryLimit(IndexType::Heavy);
   }
 }
 
@@ -479,11 +619,13 @@ llvm::Error BackgroundIndex::index(tooling::CompileCommand Cmd,
 
   update(AbsolutePath, std::move(Index), DigestsSnapshot, IndexStorage);
 
-  if (BuildIndexPeriodMs > 0)
+  if (BuildIndexPeriodMs > 0) {
     SymbolsUpdatedSinceLastIndex = true;
-  else
+  } else {
     reset(
         IndexedSymbols.buildIndex(IndexType::Light, DuplicateHandling::Merge));
+    enforceMemoryLimit(IndexType::Light);
+  }
 
   return llvm::Error::success();
 }
@@ -591,6 +733,11 @@ BackgroundIndex::loadShard(const tooling::CompileCommand &Cmd,
               ? llvm::make_unique<RelationSlab>(std::move(*SI.Shard->Relations))
               : nullptr;
       IndexedFileDigests[SI.AbsolutePath] = SI.Digest;
+      ShardState &State = Shards[SI.AbsolutePath];
+      State.RefBytes = RS ? RS->bytes() : 0;
+      State.CountReferences = SI.CountReferences;
+      State.Storage = IndexStorage;
+      State.RefsEvicted = false;
       IndexedSymbols.update(SI.AbsolutePath, std::move(SS), std::move(RS),
                             std::move(RelS), SI.CountReferences);
     }
@@ -639,6 +786,7 @@ BackgroundIndex::loadShards(std::vector<std::string> ChangedFiles) {
   vlog("BackgroundIndex: built symbol index with estimated memory {0} "
        "bytes.",
        estimateMemoryUsage());
+  enforceMemoryLimit(IndexType::Heavy);
   return NeedsReIndexing;
 }
 
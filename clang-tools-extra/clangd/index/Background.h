@@ -18,6 +18,7 @@
 #include "index/Serialization.h"
 #include "clang/Tooling/CompilationDatabase.h"
 #include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/Threading.h"
 #include <atomic>
@@ -67,12 +68,17 @@ public:
   /// If BuildIndexPeriodMs is greater than 0, the symbol index will only be
   /// rebuilt periodically (one per \p BuildIndexPeriodMs); otherwise, index is
   /// rebuilt for each indexed file.
+  /// If MemoryLimit is greater than 0, the references of indexed files are
+  /// evicted from memory when the index grows beyond \p MemoryLimit bytes.
+  /// They are reloaded from the index storage when a related file is opened
+  /// or when the file is re-indexed.
   BackgroundIndex(
       Context BackgroundContext, const FileSystemProvider &,
       const GlobalCompilationDatabase &CDB,
       BackgroundIndexStorage::Factory IndexStorageFactory,
       size_t BuildIndexPeriodMs = 0,
-      size_t ThreadPoolSize = llvm::heavyweight_hardware_concurrency());
+      size_t ThreadPoolSize = llvm::heavyweight_hardware_concurrency(),
+      size_t MemoryLimit = 0);
   ~BackgroundIndex(); // Blocks while the current task finishes.
 
   // Enqueue translation units for indexing.
@@ -80,6 +86,13 @@ public:
   // available sometime later.
   void enqueue(const std::vector<std::string> &ChangedFiles);
 
+  // Indexes the TUs related to \p Path before the rest of the queue, e.g.
+  // because it was opened or edited. TUs with the same file name stem (like a
+  // header and its implementation file) come first, followed by the TUs in the
+  // same directory. This also applies to TUs that are enqueued later, and
+  // reloads the evicted references of the related files.
+  void boostRelated(llvm::StringRef Path);
+
   // Cause background threads to stop after ther current task, any remaining
   // tasks will be discarded.
   void stop();
@@ -118,6 +131,24 @@ private:
   llvm::StringMap<FileDigest> IndexedFileDigests; // Key is absolute file path.
   std::mutex DigestsMu;
 
+  // memory limit
+  struct ShardState {
+    size_t RefBytes = 0;
+    bool CountReferences = false;
+    // The storage that has the shard of the file, if it was stored.
+    BackgroundIndexStorage *Storage = nullptr;
+    // Whether the references were dropped from IndexedSymbols.
+    bool RefsEvicted = false;
+  };
+  // Key is absolute file path. Guarded by DigestsMu.
+  llvm::StringMap<ShardState> Shards;
+  const size_t MemoryLimit;
+  // Evicts references until the index is back below the memory limit, and
+  // rebuilds the index if anything was evicted.
+  void enforceMemoryLimit(IndexType Type);
+  // Reloads the evicted references of the files related to open files.
+  void reloadEvictedRefs();
+
   BackgroundIndexStorage::Factory IndexStorageFactory;
   struct Source {
     std::string Path;
@@ -137,15 +168,31 @@ private:
 
   // queue management
   using Task = std::function<void()>;
+  struct QueuedTask {
+    Task Run;
+    llvm::ThreadPriority Priority;
+    // The TU indexed by the task, if any.
+    std::string File;
+  };
   void run(); // Main loop executed by Thread. Runs tasks from Queue.
-  void enqueueTask(Task T, llvm::ThreadPriority Prioirty);
+  void enqueueTask(Task T, llvm::ThreadPriority Prioirty,
+                   std::string File = "");
   void enqueueLocked(tooling::CompileCommand Cmd,
                      BackgroundIndexStorage *IndexStorage);
+  // Position of a task in the queue, lower ranks run first. QueueMu must be
+  // held.
+  unsigned rankLocked(const QueuedTask &T) const;
+  // Whether \p Path is related to a boosted file. QueueMu must be held.
+  bool isBoostedLocked(llvm::StringRef Path) const;
   std::mutex QueueMu;
   unsigned NumActiveTasks = 0; // Only idle when queue is empty *and* no tasks.
   std::condition_variable QueueCV;
   bool ShouldStop = false;
-  std::deque<std::pair<Task, llvm::ThreadPriority>> Queue;
+  std::deque<QueuedTask> Queue;
+  // Lowercase file name stems and directories of the files passed to
+  // boostRelated().
+  llvm::StringSet<> BoostedStems;
+  llvm::StringSet<> BoostedDirs;
   AsyncTaskRunner ThreadPool;
   GlobalCompilationDatabase::CommandChanged::Subscription CommandsChanged;
 };
@@ -114,6 +114,11 @@ void FileSymbols::update(PathRef Path, std::unique_ptr<SymbolSlab> Symbols,
     FileToRelations[Path] = std::move(Relations);
 }
 
+void FileSymbols::removeRefs(PathRef Path) {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  FileToRefs.erase(Path);
+}
+
 std::unique_ptr<SymbolIndex>
 FileSymbols::buildIndex(IndexType Type, DuplicateHandling DuplicateHandle) {
   std::vector<std::shared_ptr<SymbolSlab>> SymbolSlabs;
@@ -66,6 +66,9 @@ public:
               std::unique_ptr<RefSlab> Refs,
               std::unique_ptr<RelationSlab> Relations, bool CountReferences);
 
+  /// Removes the refs in file \p Path, keeping its symbols and relations.
+  void removeRefs(PathRef Path);
+
   /// The index keeps the symbols alive.
   /// Will count Symbol::References based on number of references in the main
   /// files, while building the index with DuplicateHandling::Merge option.
@@ -13,11 +13,60 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/MathExtras.h"
 
+#include <cstring>
+
 namespace clang {
 namespace clangd {
 namespace dex {
 namespace {
 
+/// Decodes the DocIDs of chunk \p C into \p Out, which must have room for
+/// Chunk::PayloadSize + 1 elements, and returns their number.
+///
+/// Most deltas in practice are below 128 and take a single byte, so the
+/// payload is checked eight bytes at a time: if none of them has the
+/// continuation bit set and none is the terminating zero, all of them are
+/// single-byte deltas and are decoded without per-byte branches.
+unsigned decodeChunk(const Chunk &C, DocID *Out) {
+  const uint64_t HighBits = 0x8080808080808080ULL;
+  const uint64_t LowBits = 0x0101010101010101ULL;
+  const uint8_t *P = C.Payload.data();
+  const uint8_t *End = P + Chunk::PayloadSize;
+  DocID Current = C.Head;
+  unsigned Size = 0;
+  Out[Size++] = Current;
+  while (P != End) {
+    if (End - P >= 8) {
+      uint64_t Word;
+      std::memcpy(&Word, P, sizeof(Word));
+      // Without high bits set, (Word - LowBits) & ~Word has the high bit of a
+      // byte set iff the byte is zero.
+      bool SingleByteDeltas =
+          (Word & HighBits) == 0 && ((Word - LowBits) & ~Word & HighBits) == 0;
+      if (SingleByteDeltas) {
+        for (unsigned I = 0; I < 8; ++I) {
+          Current += P[I];
+          Out[Size++] = Current;
+        }
+        P += 8;
+        continue;
+      }
+    }
+    if (*P == 0) // The rest of the payload is unused.
+      break;
+    DocID Delta = 0;
+    for (unsigned Shift = 0; P != End; Shift += 7) {
+      uint8_t Byte = *P++;
+      Delta |= DocID(Byte & 0x7f) << Shift;
+      if ((Byte & 0x80) == 0)
+        break;
+    }
+    Current += Delta;
+    Out[Size++] = Current;
+  }
+  return Size;
+}
+
 /// Implements iterator of PostingList chunks. This requires iterating over two
 /// levels: the first level iterator iterates over the chunks and decompresses
 /// them on-the-fly when the contents of chunk are to be seen.
@@ -25,10 +74,8 @@ class ChunkIterator : public Iterator {
 public:
   explicit ChunkIterator(const Token *Tok, llvm::ArrayRef<Chunk> Chunks)
       : Tok(Tok), Chunks(Chunks), CurrentChunk(Chunks.begin()) {
-    if (!Chunks.empty()) {
-      DecompressedChunk = CurrentChunk->decompress();
-      CurrentID = DecompressedChunk.begin();
-    }
+    if (!Chunks.empty())
+      decodeCurrentChunk();
   }
 
   bool reachedEnd() const override { return CurrentChunk == Chunks.end(); }
@@ -50,7 +97,7 @@ public:
       return;
     advanceToChunk(ID);
     // Try to find ID within current chunk.
-    CurrentID = llvm::bsearch(CurrentID, DecompressedChunk.end(),
+    CurrentID = llvm::bsearch(CurrentID, DecompressedEnd,
                               [&](const DocID D) { return D >= ID; });
     normalizeCursor();
   }
@@ -88,14 +135,19 @@ private:
   /// chunk.
   void normalizeCursor() {
     // Invariant is already established if examined chunk is not exhausted.
-    if (CurrentID != std::end(DecompressedChunk))
+    if (CurrentID != DecompressedEnd)
       return;
     // Advance to next chunk if current one is exhausted.
     ++CurrentChunk;
     if (CurrentChunk == Chunks.end()) // Reached the end of PostingList.
       return;
-    DecompressedChunk = CurrentChunk->decompress();
-    CurrentID = DecompressedChunk.begin();
+    decodeCurrentChunk();
+  }
+
+  void decodeCurrentChunk() {
+    DecompressedEnd = DecompressedChunk.data() +
+                      decodeChunk(*CurrentChunk, DecompressedChunk.data());
+    CurrentID = DecompressedChunk.data();
   }
 
   /// Advances CurrentChunk to the chunk which might contain ID.
@@ -106,21 +158,21 @@ private:
           llvm::bsearch(CurrentChunk + 1, Chunks.end(),
                         [&](const Chunk &C) { return C.Head >= ID; });
       --CurrentChunk;
-      DecompressedChunk = CurrentChunk->decompress();
-      CurrentID = DecompressedChunk.begin();
+      decodeCurrentChunk();
     }
   }
 
   const Token *Tok;
   llvm::ArrayRef<Chunk> Chunks;
   /// Iterator over chunks.
-  /// If CurrentChunk is valid, then DecompressedChunk is
+  /// If CurrentChunk is valid, then DecompressedChunk up to DecompressedEnd is
   /// CurrentChunk->decompress() and CurrentID is a valid (non-end) iterator
-  /// into it.
+  /// into it. The buffer is reused for all chunks to avoid copying.
   decltype(Chunks)::const_iterator CurrentChunk;
-  llvm::SmallVector<DocID, Chunk::PayloadSize + 1> DecompressedChunk;
+  std::array<DocID, Chunk::PayloadSize + 1> DecompressedChunk;
+  DocID *DecompressedEnd = nullptr;
   /// Iterator over DecompressedChunk.
-  decltype(DecompressedChunk)::iterator CurrentID;
+  DocID *CurrentID = nullptr;
 
   static constexpr size_t ApproxEntriesPerChunk = 15;
 };
@@ -182,38 +234,12 @@ std::vector<Chunk> encodeStream(llvm::ArrayRef<DocID> Documents) {
   return std::vector<Chunk>(Result); // no move, shrink-to-fit
 }
 
-/// Reads variable length DocID from the buffer and updates the buffer size. If
-/// the stream is terminated, return None.
-llvm::Optional<DocID> readVByte(llvm::ArrayRef<uint8_t> &Bytes) {
-  if (Bytes.front() == 0 || Bytes.empty())
-    return None;
-  DocID Result = 0;
-  bool HasNextByte = true;
-  for (size_t Length = 0; HasNextByte && !Bytes.empty(); ++Length) {
-    assert(Length <= 5 && "Malformed VByte encoding sequence.");
-    // Write meaningful bits to the correct place in the document decoding.
-    Result |= (Bytes.front() & 0x7f) << (BitsPerEncodingByte * Length);
-    if ((Bytes.front() & 0x80) == 0)
-      HasNextByte = false;
-    Bytes = Bytes.drop_front();
-  }
-  return Result;
-}
-
 } // namespace
 
 llvm::SmallVector<DocID, Chunk::PayloadSize + 1> Chunk::decompress() const {
-  llvm::SmallVector<DocID, Chunk::PayloadSize + 1> Result{Head};
-  llvm::ArrayRef<uint8_t> Bytes(Payload);
-  DocID Delta;
-  for (DocID Current = Head; !Bytes.empty(); Current += Delta) {
-    auto MaybeDelta = readVByte(Bytes);
-    if (!MaybeDelta)
-      break;
-    Delta = *MaybeDelta;
-    Result.push_back(Current + Delta);
-  }
-  return llvm::SmallVector<DocID, Chunk::PayloadSize + 1>{Result};
+  DocID Buffer[Chunk::PayloadSize + 1];
+  return llvm::SmallVector<DocID, Chunk::PayloadSize + 1>(
+      Buffer, Buffer + decodeChunk(*this, Buffer));
 }
 
 PostingList::PostingList(llvm::ArrayRef<DocID> Documents)
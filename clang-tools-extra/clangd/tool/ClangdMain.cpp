@@ -199,6 +199,14 @@ static llvm::cl::opt<int> BackgroundIndexRebuildPeriod(
         "symbol index will be updated for each indexed file"),
     llvm::cl::init(5000), llvm::cl::Hidden);
 
+static llvm::cl::opt<unsigned> BackgroundIndexMemoryLimit(
+    "background-index-memory-limit",
+    llvm::cl::desc(
+        "If set to non-zero, the background index keeps the references of "
+        "files that aren't related to open files on disk once the index uses "
+        "more than X megabytes"),
+    llvm::cl::init(0), llvm::cl::Hidden);
+
 enum CompileArgsFrom { LSPCompileArgs, FilesystemCompileArgs };
 static llvm::cl::opt<CompileArgsFrom> CompileArgsFrom(
     "compile_args_from", llvm::cl::desc("The source of compile commands"),
@@ -460,6 +468,8 @@ int main(int argc, char *argv[]) {
   Opts.BuildDynamicSymbolIndex = EnableIndex;
   Opts.BackgroundIndex = EnableBackgroundIndex;
   Opts.BackgroundIndexRebuildPeriodMs = BackgroundIndexRebuildPeriod;
+  Opts.BackgroundIndexMemoryLimit =
+      size_t(BackgroundIndexMemoryLimit) * 1024 * 1024;
   std::unique_ptr<SymbolIndex> StaticIdx;
   std::future<void> AsyncIndexLoad; // Block exit while loading the index.
   if (EnableIndex && !IndexFile.empty()) {
@@ -462,6 +462,41 @@ TEST_F(BackgroundIndexTest, ShardStorageEmptyFile) {
               Contains(AllOf(Named("new_func"), Declared(), Not(Defined()))));
 }
 
+TEST_F(BackgroundIndexTest, EvictRefsAboveMemoryLimit) {
+  MockFSProvider FS;
+  FS.Files[testPath("root/A.h")] = "void common();";
+  FS.Files[testPath("root/A.cc")] =
+      "#include \"A.h\"\nvoid g() { (void)common; }";
+  llvm::StringMap<std::string> Storage;
+  size_t CacheHits = 0;
+  MemoryShardStorage MSS(Storage, CacheHits);
+  OverlayCDB CDB(/*Base=*/nullptr);
+  BackgroundIndex Idx(Context::empty(), FS, CDB,
+                      [&](llvm::StringRef) { return &MSS; },
+                      /*BuildIndexPeriodMs=*/0, /*ThreadPoolSize=*/1,
+                      /*MemoryLimit=*/1);
+
+  tooling::CompileCommand Cmd;
+  Cmd.Filename = testPath("root/A.cc");
+  Cmd.Directory = testPath("root");
+  Cmd.CommandLine = {"clang++", testPath("root/A.cc")};
+  CDB.setCompileCommand(testPath("root/A.cc"), Cmd);
+
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  auto Syms = runFuzzyFind(Idx, "common");
+  EXPECT_THAT(Syms, UnorderedElementsAre(Named("common")));
+  auto Common = *Syms.begin();
+  // The symbols are kept, but the refs are only in the storage.
+  EXPECT_THAT(getRefs(Idx, Common.ID), ElementsAre());
+
+  // Opening a related file reloads the refs.
+  Idx.boostRelated(testPath("root/A.cc"));
+  ASSERT_TRUE(Idx.blockUntilIdleForTest());
+  EXPECT_THAT(getRefs(Idx, Common.ID),
+              RefsAre({FileURI("unittest:///root/A.h"),
+                       FileURI("unittest:///root/A.cc")}));
+}
+
 TEST_F(BackgroundIndexTest, NoDotsInAbsPath) {
   MockFSProvider FS;
   llvm::StringMap<std::string> Storage;
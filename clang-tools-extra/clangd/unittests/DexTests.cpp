@@ -68,6 +68,24 @@ TEST(DexIterators, DocumentIterator) {
   EXPECT_TRUE(DocIterator->reachedEnd());
 }
 
+TEST(DexIterators, DocumentIteratorLargeList) {
+  // Mix runs of single-byte deltas with multi-byte ones, so that chunks are
+  // decoded both eight bytes at a time and byte by byte.
+  std::vector<DocID> IDs;
+  DocID ID = 0;
+  for (unsigned I = 0; I < 1000; ++I) {
+    ID += I % 13 == 0 ? 1000 + I * 97 : 1 + I % 100;
+    IDs.push_back(ID);
+  }
+  const PostingList L(IDs);
+  auto DocIterator = L.iterator();
+  EXPECT_EQ(consumeIDs(*DocIterator), IDs);
+
+  DocIterator = L.iterator();
+  DocIterator->advanceTo(IDs[500] + 1);
+  EXPECT_EQ(DocIterator->peek(), IDs[501]);
+}
+
 TEST(DexIterators, AndTwoLists) {
   Corpus C{10000};
   const PostingList L0({0, 5, 7, 10, 42, 320, 9000});
@@ -654,6 +654,49 @@ TEST_F(TUSchedulerTests, NoChangeDiags) {
   ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
 }
 
+TEST_F(TUSchedulerTests, DiagsWithPatchedPreamble) {
+  TUScheduler S(CDB,
+                /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
+                /*StorePreambleInMemory=*/true, captureDiags(),
+                /*UpdateDebounce=*/std::chrono::steady_clock::duration::zero(),
+                ASTRetentionPolicy());
+
+  auto Source = testPath("foo.cpp");
+  Files[testPath("foo.h")] = "int a;";
+  Files[testPath("bar.h")] = "int b;";
+
+  std::atomic<int> DiagsCount(0);
+  updateWithDiags(S, Source, "#include \"foo.h\"\nint x = a;",
+                  WantDiagnostics::Yes, [&](std::vector<Diag> Diags) {
+                    EXPECT_THAT(Diags, ElementsAre());
+                    ++DiagsCount;
+                  });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(DiagsCount, 1);
+
+  // Adding an include at the end of the preamble section reports diagnostics
+  // from the old preamble first, and then from the rebuilt one.
+  DiagsCount = 0;
+  updateWithDiags(S, Source,
+                  "#include \"foo.h\"\n#include \"bar.h\"\nint x = a + b;",
+                  WantDiagnostics::Yes, [&](std::vector<Diag> Diags) {
+                    EXPECT_THAT(Diags, ElementsAre());
+                    ++DiagsCount;
+                  });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(DiagsCount, 2);
+
+  // Removing an include needs a new preamble first.
+  DiagsCount = 0;
+  updateWithDiags(S, Source, "#include \"bar.h\"\nint x = b;",
+                  WantDiagnostics::Yes, [&](std::vector<Diag> Diags) {
+                    EXPECT_THAT(Diags, ElementsAre());
+                    ++DiagsCount;
+                  });
+  ASSERT_TRUE(S.blockUntilIdle(timeoutSeconds(10)));
+  EXPECT_EQ(DiagsCount, 1);
+}
+
 TEST_F(TUSchedulerTests, Run) {
   TUScheduler S(CDB, /*AsyncThreadsCount=*/getDefaultAsyncThreadsCount(),
                 /*StorePreambleInMemory=*/true, /*ASTCallbacks=*/nullptr,
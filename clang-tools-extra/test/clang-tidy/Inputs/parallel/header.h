@@ -0,0 +1 @@
+struct Header { Header(int); };
@@ -0,0 +1,3 @@
+#include "header.h"
+
+struct Second { Second(int); };
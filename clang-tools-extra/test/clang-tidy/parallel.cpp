@@ -0,0 +1,12 @@
+// RUN: clang-tidy -j 2 -quiet -checks='-*,google-explicit-constructor' -header-filter='.*' %s %S/Inputs/parallel/second.cpp -- -I %S/Inputs/parallel 2>&1 | FileCheck %s
+// RUN: clang-tidy -j 2 -quiet -checks='-*,google-explicit-constructor' -header-filter='.*' %s %S/Inputs/parallel/second.cpp -- -I %S/Inputs/parallel 2>&1 | grep -c 'header.h:1:17: warning' | FileCheck --check-prefix=CHECK-COUNT %s
+
+// Both files include header.h, and each thread diagnoses it, but its warning
+// is reported once.
+#include "header.h"
+// CHECK-DAG: header.h:1:17: warning: single-argument constructors must be marked explicit
+// CHECK-COUNT: {{^}}1{{$}}
+
+struct First { First(int); };
+// CHECK-DAG: parallel.cpp:[[@LINE-1]]:16: warning: single-argument constructors must be marked explicit
+// CHECK-DAG: second.cpp:3:17: warning: single-argument constructors must be marked explicit
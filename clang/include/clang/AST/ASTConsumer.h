@@ -131,6 +131,12 @@ public:
   /// PrintStats - If desired, print any statistics.
   virtual void PrintStats() {}
 
+  /// Whether the consumer needs to see the declarations that an AST file
+  /// requires to be deserialized eagerly, such as definitions that must be
+  /// emitted. If it doesn't, the AST reader leaves them to be deserialized on
+  /// demand, which makes loading a large PCH cheaper.
+  virtual bool needsEagerlyDeserializedDecls() { return true; }
+
   /// This callback is called for each function if the Parser was
   /// initialized with \c SkipFunctionBodies set to \c true.
   ///
@@ -45,7 +45,8 @@ enum class index_error_code {
   failed_to_generate_usr,
   triple_mismatch,
   lang_mismatch,
-  lang_dialect_mismatch
+  lang_dialect_mismatch,
+  load_threshold_reached
 };
 
 class IndexError : public llvm::ErrorInfo<IndexError> {
@@ -100,7 +101,9 @@ bool containsConst(const VarDecl *VD, const ASTContext &ACtx);
 /// In order to use this class, an index file is required that describes
 /// the locations of the AST files for each definition.
 ///
-/// Note that this class also implements caching.
+/// Note that this class also implements caching. The parsed index is shared
+/// by all the contexts of the process, and at most as many AST files as the
+/// analyzer's ctu-import-threshold option allows are loaded.
 class CrossTranslationUnitContext {
 public:
   CrossTranslationUnitContext(CompilerInstance &CI);
@@ -176,12 +179,16 @@ private:
 
   llvm::StringMap<std::unique_ptr<clang::ASTUnit>> FileASTUnitMap;
   llvm::StringMap<clang::ASTUnit *> NameASTUnitMap;
-  llvm::StringMap<std::string> NameFileMap;
+  std::shared_ptr<const llvm::StringMap<std::string>> NameFileMap;
   llvm::DenseMap<TranslationUnitDecl *, std::unique_ptr<ASTImporter>>
       ASTUnitImporterMap;
   CompilerInstance &CI;
   ASTContext &Context;
   std::unique_ptr<ASTImporterLookupTable> LookupTable;
+
+  /// Number of AST files loaded so far, and the maximum that may be.
+  unsigned NumASTLoaded = 0;
+  const unsigned CTULoadThreshold;
 };
 
 } // namespace cross_tu
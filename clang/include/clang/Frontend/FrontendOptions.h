@@ -270,6 +270,9 @@ public:
   /// Output time trace profile.
   unsigned TimeTrace : 1;
 
+  /// Output the time per header, template specialization and function.
+  unsigned TimeTraceSummary : 1;
+
   /// Show the -version text.
   unsigned ShowVersion : 1;
 
@@ -455,6 +458,7 @@ public:
   FrontendOptions()
       : DisableFree(false), RelocatablePCH(false), ShowHelp(false),
         ShowStats(false), ShowTimers(false), TimeTrace(false),
+        TimeTraceSummary(false),
         ShowVersion(false), FixWhatYouCan(false), FixOnlyWarnings(false),
         FixAndRecompile(false), FixToTemporaries(false),
         ARCMTMigrateEmitARCErrors(false), SkipFunctionBodies(false),
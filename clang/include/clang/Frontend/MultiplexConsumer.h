@@ -70,6 +70,7 @@ public:
   ASTMutationListener *GetASTMutationListener() override;
   ASTDeserializationListener *GetASTDeserializationListener() override;
   void PrintStats() override;
+  bool needsEagerlyDeserializedDecls() override;
   bool shouldSkipFunctionBody(Decl *D) override;
 
   // SemaConsumer
@@ -42,6 +42,7 @@ class HeaderSearchOptions;
 class IdentifierInfo;
 class LangOptions;
 class Module;
+class PersistentHeaderSearchCache;
 class Preprocessor;
 class TargetInfo;
 
@@ -214,6 +215,12 @@ class HeaderSearch {
   };
   llvm::StringMap<LookupFileCacheInfo, llvm::BumpPtrAllocator> LookupFileCache;
 
+  /// The cache of LookupFile results shared with other compilations, if
+  /// -fheader-search-cache-path is given. It is created by the first lookup,
+  /// when the search path is complete.
+  std::unique_ptr<PersistentHeaderSearchCache> PersistentCache;
+  bool PersistentCacheInitialized = false;
+
   /// Collection mapping a framework or subframework
   /// name like "Carbon" to the Carbon.framework directory.
   llvm::StringMap<FrameworkCacheEntry, llvm::BumpPtrAllocator> FrameworkMap;
@@ -262,6 +269,7 @@ public:
                const LangOptions &LangOpts, const TargetInfo *Target);
   HeaderSearch(const HeaderSearch &) = delete;
   HeaderSearch &operator=(const HeaderSearch &) = delete;
+  ~HeaderSearch();
 
   /// Retrieve the header-search options with which this header search
   /// was initialized.
@@ -730,7 +738,19 @@ public:
 
   size_t getTotalMemory() const;
 
+  /// Stores the new results of this compilation in the persistent header
+  /// search cache, if there is one.
+  void writePersistentCache();
+
 private:
+  /// Returns the persistent header search cache, or null if there is none.
+  PersistentHeaderSearchCache *getPersistentCache();
+
+  /// Records the result of a search of SearchDirs in the persistent cache, if
+  /// it can be replayed. \p FE is null if the file was not found.
+  void addToPersistentCache(StringRef Filename, unsigned StartIdx,
+                            unsigned HitIdx, const FileEntry *FE);
+
   /// Describes what happened when we tried to load a module map file.
   enum LoadModuleMapResult {
     /// The module map file had already been loaded.
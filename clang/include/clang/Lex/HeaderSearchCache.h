@@ -0,0 +1,95 @@
+//===- HeaderSearchCache.h - Persistent header search cache -----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the PersistentHeaderSearchCache interface.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_CLANG_LEX_HEADERSEARCHCACHE_H
+#define LLVM_CLANG_LEX_HEADERSEARCHCACHE_H
+
+#include "clang/Basic/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clang {
+
+/// A cache of the results of searching the header search path, which is
+/// shared by all compiler invocations that use the same search path.
+///
+/// An entry maps a spelled file name and the index of the first search
+/// directory to the index of the directory the file was found in, or to the
+/// end of the search path if it wasn't found. Replaying an entry skips the
+/// failed lookups in the directories before the hit, which are most of the
+/// file system traffic of header search when the search path is long.
+///
+/// An entry remembers the directories that would have contained the file in
+/// each directory that was searched, and the file that was found. It is only
+/// used if all of them still have the same device, inode and modification
+/// time, so creating, removing or replacing a header invalidates it. Each
+/// directory is only stat'ed once per process.
+///
+/// The cache is stored in a single file per search path, which is mapped into
+/// memory when the first lookup is made and rewritten with the new entries at
+/// the end of the compilation.
+class PersistentHeaderSearchCache {
+public:
+  /// Creates the cache for the search path identified by \p SearchPathHash,
+  /// stored in the directory \p CachePath.
+  PersistentHeaderSearchCache(StringRef CachePath, uint64_t SearchPathHash);
+  ~PersistentHeaderSearchCache();
+
+  /// Looks up the result of searching for \p Filename starting at the search
+  /// directory \p StartIdx.
+  ///
+  /// \returns true and sets \p HitIdx if the cached result is still valid.
+  bool lookup(StringRef Filename, unsigned StartIdx, unsigned &HitIdx);
+
+  /// Records the result of searching for \p Filename starting at the search
+  /// directory \p StartIdx.
+  ///
+  /// \param SearchedDirs The directories that would have contained the file
+  /// in each search directory before \p HitIdx.
+  /// \param File The file that was found, or empty if there was none.
+  void insert(StringRef Filename, unsigned StartIdx, unsigned HitIdx,
+              ArrayRef<std::string> SearchedDirs, StringRef File);
+
+  /// Writes the cache back if entries were added. Failures are ignored.
+  void write();
+
+private:
+  /// Returns the identity of the file or directory \p Path, or "-" if it
+  /// doesn't exist.
+  StringRef getStamp(StringRef Path);
+
+  void load();
+
+  std::string CacheFile;
+  bool Loaded = false;
+
+  /// The mapped versions of the cache file.
+  std::vector<std::unique_ptr<llvm::MemoryBuffer>> Buffers;
+
+  /// Maps keys to the serialized entries, which point into Buffers or into
+  /// NewEntries.
+  llvm::StringMap<StringRef> Entries;
+
+  /// The entries added by this compilation.
+  std::vector<std::unique_ptr<std::string>> NewEntries;
+
+  llvm::StringMap<std::string> Stamps;
+};
+
+} // namespace clang
+
+#endif // LLVM_CLANG_LEX_HEADERSEARCHCACHE_H
@@ -113,6 +113,9 @@ public:
   /// The directory used for a user build.
   std::string ModuleUserBuildPath;
 
+  /// The directory used for the persistent header search cache.
+  std::string HeaderSearchCachePath;
+
   /// The mapping of module names to prebuilt module files.
   std::map<std::string, std::string> PrebuiltModuleFiles;
 
@@ -247,6 +247,12 @@ public:
   /// uninterpreted string.  This switches the lexer out of directive mode.
   void ReadToEndOfLine(SmallVectorImpl<char> *Result = nullptr);
 
+  /// Skips ahead over whole lines that can't contain a preprocessor directive.
+  /// This is used in raw mode to skip excluded conditional blocks quickly.
+  ///
+  /// \param ScanLimit The last character examined by the previous call, or
+  /// null. The lexer only scans again once it has lexed past that character.
+  void SkipExcludedLines(const char *&ScanLimit);
 
   /// Diag - Forwarding function for diagnostics.  This translate a source
   /// position in the current buffer into a SourceLocation object for rendering.
@@ -177,6 +177,11 @@ public:
 
   /// Write a global index into the given
   ///
+  /// The module files that are described by the existing index and haven't
+  /// changed since it was written are not loaded again; their information is
+  /// copied from the existing index. Adding a module to the cache therefore
+  /// only loads the new module files.
+  ///
   /// \param FileMgr The file manager to use to load module files.
   /// \param PCHContainerRdr - The PCHContainerOperations to use for loading and
   /// creating modules.
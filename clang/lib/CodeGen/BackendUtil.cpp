@@ -50,6 +50,7 @@
 #include "llvm/Transforms/Coroutines.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
+#include "llvm/Transforms/IPO/OmpTgtAddrTrans.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/IPO/ThinLTOBitcodeWriter.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
@@ -63,6 +64,7 @@
 #include "llvm/Transforms/Instrumentation/ThreadSanitizer.h"
 #include "llvm/Transforms/ObjCARC.h"
 #include "llvm/Transforms/Scalar.h"
+#include "llvm/Transforms/Scalar/EarlyCSE.h"
 #include "llvm/Transforms/Scalar/GVN.h"
 #include "llvm/Transforms/Utils.h"
 #include "llvm/Transforms/Utils/CanonicalizeAliases.h"
@@ -1179,6 +1181,10 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
 
   ModulePassManager MPM(CodeGenOpts.DebugPassManager);
 
+  // Same placement of the address translation passes as in CreatePasses
+  bool RunOmpAT = !getenv("OMP_NO_AT") && TargetTriple.isNVPTX() &&
+      CodeGenOpts.getDebugInfo() == codegenoptions::NoDebugInfo;
+
   if (!CodeGenOpts.DisableLLVMPasses) {
     bool IsThinLTO = CodeGenOpts.PrepareForThinLTO;
     bool IsLTO = CodeGenOpts.PrepareForLTO;
@@ -1196,6 +1202,12 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
       // code generation.
       MPM.addPass(AlwaysInlinerPass(/*InsertLifetimeIntrinsics=*/false));
 
+      if (RunOmpAT) {
+        MPM.addPass(OmpTgtAddrTransPass());
+        MPM.addPass(createModuleToFunctionPassAdaptor(EarlyCSEPass()));
+        MPM.addPass(RestoreLoadPass());
+      }
+
       // At -O0 we directly run necessary sanitizer passes.
       if (LangOpts.Sanitize.has(SanitizerKind::LocalBounds))
         MPM.addPass(createModuleToFunctionPassAdaptor(BoundsCheckingPass()));
@@ -1215,6 +1227,13 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
             EntryExitInstrumenterPass(/*PostInlining=*/false)));
       });
 
+      if (RunOmpAT) {
+        PB.registerPipelineStartEPCallback([](ModulePassManager &MPM) {
+          MPM.addPass(OmpTgtAddrTransPass());
+          MPM.addPass(createModuleToFunctionPassAdaptor(EarlyCSEPass()));
+        });
+      }
+
       // Register callbacks to schedule sanitizer passes at the appropriate part of
       // the pipeline.
       // FIXME: either handle asan/the remaining sanitizers or error out
@@ -1297,6 +1316,9 @@ void EmitAssemblyHelper::EmitAssemblyWithNewPassManager(
         MPM = PB.buildPerModuleDefaultPipeline(Level,
                                                CodeGenOpts.DebugPassManager);
       }
+      // Optimizer-last callbacks only take function passes
+      if (RunOmpAT)
+        MPM.addPass(RestoreLoadPass());
     }
 
     if (CodeGenOpts.OptimizationLevel == 0)
@@ -16,7 +16,9 @@
 #include "CGRecordLayout.h"
 #include "CodeGenFunction.h"
 #include "clang/CodeGen/ConstantInitBuilder.h"
+#include "clang/AST/Attr.h"
 #include "clang/AST/Decl.h"
+#include "clang/AST/RecordLayout.h"
 #include "clang/AST/StmtOpenMP.h"
 #include "clang/AST/RecursiveASTVisitor.h"
 #include "clang/Basic/BitmaskEnum.h"
@@ -27,18 +29,36 @@
 #include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cassert>
+#include <deque>
+#include <set>
 
 using namespace clang;
 using namespace CodeGen;
 
+static llvm::cl::opt<bool> OpenMPDCMarshaller(
+    "openmp-dc-marshaller", llvm::cl::ZeroOrMore, llvm::cl::Hidden,
+    llvm::cl::desc("Emit a compiled traversal for deep copy expressions "
+                   "instead of leaving the type array to the runtime"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<std::string> OpenMPDCFieldUsage(
+    "openmp-dc-field-usage", llvm::cl::ZeroOrMore, llvm::cl::Hidden,
+    llvm::cl::desc("Field usage written by the address translation pass "
+                   "(OMP_AT_FIELD_USAGE); pointer fields of listed structs "
+                   "that no kernel dereferences are left out of deep copy"),
+    llvm::cl::init(""));
+
 namespace {
 class MappableExprsHandler;
 enum RttTypes : uint64_t {
   RTT_BUILTIN       = 0x01,
   RTT_PTR           = 0x02,
+  RTT_MARSHAL       = 0x1UL << 60,
   RTT_STRUCT        = 0x2UL << 60,
   RTT_TID           = 0x4UL << 60,
 };
@@ -46,6 +66,7 @@ enum RttTypes : uint64_t {
 class MapRttArrayTy : public SmallVector<uint64_t, 4> {
   public :
   llvm::GlobalVariable *IR = nullptr;
+  llvm::Function *Marshaller = nullptr;
 };
 using MapValuesArrayTy = SmallVector<llvm::Value *, 4>;
 
@@ -54,9 +75,13 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
   public:
   // Type
   MapRttArrayTy *CurRttypeArray;
+  // Names the IR types of the structs, for the field usage
+  CodeGenModule *CGM = nullptr;
   static std::map<Type*, uint64_t> TIDMap;
-  static SmallVector<MapRttArrayTy, 8> TIDList;
+  // A deque, CurRttypeArray stays valid while new types are added
+  static std::deque<MapRttArrayTy> TIDList;
   static MapValuesArrayTy AdditionalPointers;
+  static std::map<std::string, std::set<uint64_t>> FieldUsage;
   int64_t genRttTypes(QualType T) {
     // Lookup existing TID
     Type *RootType = const_cast<Type*>(T.getTypePtr());
@@ -77,22 +102,15 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
     Type *T = dyn_cast<Type>(RT);
     // Be care of infinite loop, check if the type is recorded
 
-    // Struct is first type
+    // Struct is first type, gen its descriptor
+    //   [TID, RTT_STRUCT | Fields, sizeof, (offset, pointee size, pointee)...]
     if (CurRttypeArray->size() == 1) {
-      // Gen info about struct
-      uint64_t FieldCount = 0;
       RecordDecl *RD = RT->getDecl();
-      for (auto F : RD->fields()) {
-        std::ignore = F;
-        FieldCount++;
-      }
-      CurRttypeArray->emplace_back(RTT_STRUCT | FieldCount);
-      // Check each field
-      for (auto F : RD->fields()) {
-        // We only care if there is pointer or struct
-        // TODO how to store offset of the pointer
-        TraverseType(F->getType());
-      }
+      ASTContext &C = RD->getASTContext();
+      size_t Header = CurRttypeArray->size();
+      CurRttypeArray->emplace_back(RTT_STRUCT);
+      CurRttypeArray->emplace_back(C.getTypeSizeInChars(RT).getQuantity());
+      (*CurRttypeArray)[Header] |= addPointerFields(RD, 0);
       return true;
     }
     // Create New Type
@@ -100,6 +118,124 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
     CurRttypeArray->push_back(RTT_TID | ID);
     return true;
   }
+  // Append the pointer fields of RD at Offset that deep copy follows, those
+  // of struct fields included, and return their number. Each maps one
+  // pointee, a builtin or a struct whose fields are followed in turn.
+  uint64_t addPointerFields(RecordDecl *RD, uint64_t Offset) {
+    // The active member of a union is not known
+    if (RD->isUnion()) {
+      return 0;
+    }
+    ASTContext &C = RD->getASTContext();
+    const ASTRecordLayout &Layout = C.getASTRecordLayout(RD);
+    uint64_t Count = 0;
+    for (auto F : RD->fields()) {
+      if (!isFieldMapped(RD, F)) {
+        continue;
+      }
+      uint64_t FieldOffset = Offset + C.toCharUnitsFromBits(
+          Layout.getFieldOffset(F->getFieldIndex())).getQuantity();
+      QualType FT = F->getType().getCanonicalType();
+      if (auto *Inner = FT->getAs<RecordType>()) {
+        Count += addPointerFields(Inner->getDecl(), FieldOffset);
+        continue;
+      }
+      auto *PT = FT->getAs<PointerType>();
+      if (!PT) {
+        continue;
+      }
+      QualType Pointee = PT->getPointeeType().getCanonicalType();
+      uint64_t PointeeType;
+      if (Pointee->isIncompleteType() || Pointee->isFunctionType()) {
+        continue;
+      } else if (Pointee->isRecordType()) {
+        PointeeType = RTT_TID |
+            getOrCreateTID(const_cast<Type *>(Pointee.getTypePtr()));
+      } else if (Pointee->isBuiltinType() || Pointee->isEnumeralType()) {
+        PointeeType = RTT_BUILTIN;
+      } else {
+        // Pointers to pointers and to arrays are not followed
+        continue;
+      }
+      CurRttypeArray->push_back(FieldOffset);
+      CurRttypeArray->push_back(C.getTypeSizeInChars(Pointee).getQuantity());
+      CurRttypeArray->push_back(PointeeType);
+      Count++;
+    }
+    return Count;
+  }
+  // A field is not followed if it is annotated with
+  //   __attribute__((annotate("omp_dc_nomap")))
+  // or, with -openmp-dc-field-usage, if it is a pointer of a struct in the
+  // usage file that no kernel dereferenced
+  bool isFieldMapped(RecordDecl *RD, FieldDecl *F) {
+    for (auto *A : F->specific_attrs<AnnotateAttr>()) {
+      if (A->getAnnotation() == "omp_dc_nomap") {
+        return false;
+      }
+    }
+    if (OpenMPDCFieldUsage.empty() || !F->getType()->isAnyPointerType()) {
+      return true;
+    }
+    loadFieldUsage();
+    auto Used = FieldUsage.find(getStructName(RD));
+    if (Used == FieldUsage.end()) {
+      return true;
+    }
+    ASTContext &C = RD->getASTContext();
+    uint64_t Offset = C.toCharUnitsFromBits(
+        C.getASTRecordLayout(RD).getFieldOffset(F->getFieldIndex()))
+        .getQuantity();
+    return Used->second.count(Offset);
+  }
+  // Name of the IR type of RD as the address translation pass writes it,
+  // without the ".N" suffix of renamed types. Empty for anonymous structs,
+  // they cannot be told apart.
+  std::string getStructName(RecordDecl *RD) {
+    if (!CGM) {
+      return "";
+    }
+    auto *ST = dyn_cast<llvm::StructType>(CGM->getTypes().ConvertTypeForMem(
+        RD->getASTContext().getRecordType(RD)));
+    if (!ST || !ST->hasName()) {
+      return "";
+    }
+    StringRef Name = ST->getName();
+    StringRef Base, Suffix;
+    std::tie(Base, Suffix) = Name.rsplit('.');
+    if (Base.contains('.') && !Suffix.empty() &&
+        Suffix.find_first_not_of("0123456789") == StringRef::npos) {
+      Name = Base;
+    }
+    if (Name.split('.').second.startswith("anon")) {
+      return "";
+    }
+    return Name.str();
+  }
+  // Lines of "<IR struct name> <byte offset>", one per dereferenced field
+  static void loadFieldUsage() {
+    static bool Loaded = false;
+    if (Loaded) {
+      return;
+    }
+    Loaded = true;
+    auto Buf = llvm::MemoryBuffer::getFile(OpenMPDCFieldUsage);
+    if (!Buf) {
+      llvm::errs() << "Cannot read deep copy field usage "
+                   << OpenMPDCFieldUsage << "\n";
+      return;
+    }
+    SmallVector<StringRef, 16> Lines;
+    (*Buf)->getBuffer().split(Lines, '\n', -1, false);
+    for (StringRef Line : Lines) {
+      StringRef Name, Offset;
+      std::tie(Name, Offset) = Line.trim().rsplit(' ');
+      uint64_t Value;
+      if (!Name.empty() && !Offset.getAsInteger(10, Value)) {
+        FieldUsage[Name.str()].insert(Value);
+      }
+    }
+  }
   int64_t getKnownType(Type *T) {
     auto TID = TIDMap.find(T);
     if (TID != TIDMap.end()) {
@@ -136,6 +272,36 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
     for (auto Value : types) {
       LiteralTypes.push_back(llvm::ConstantInt::get(CGM.Int64Ty, Value, false));
     }
+    // A chain ending in a struct is followed by the descriptors of the
+    // structs reachable from it and a 0, for the runtime to walk the fields
+    SmallVector<uint64_t, 4> Structs;
+    std::set<uint64_t> Seen;
+    auto AddStruct = [&](uint64_t Value) {
+      if ((Value & RTT_TID) && Seen.insert(Value & ~RTT_TID).second) {
+        Structs.push_back(Value & ~RTT_TID);
+      }
+    };
+    if (types.size() > 1) {
+      AddStruct(types.back());
+    }
+    for (unsigned I = 0; I < Structs.size(); ++I) {
+      auto &Desc = getRttArrayByID(Structs[I]);
+      for (uint64_t F = 0; F < (Desc[1] & ~RTT_STRUCT); ++F) {
+        AddStruct(Desc[5 + 3 * F]);
+      }
+      for (auto Value : Desc) {
+        LiteralTypes.push_back(
+            llvm::ConstantInt::get(CGM.Int64Ty, Value, false));
+      }
+    }
+    if (!Structs.empty()) {
+      LiteralTypes.push_back(llvm::ConstantInt::get(CGM.Int64Ty, 0, false));
+    }
+    // The rtt info then has a third slot holding the marshaller
+    if (OpenMPDCMarshaller) {
+      LiteralTypes[0] = llvm::ConstantInt::get(CGM.Int64Ty,
+          types[0] | RTT_MARSHAL, false);
+    }
     auto RttsArrayInit = llvm::ConstantArray::get(
       llvm::ArrayType::get(CGM.Int64Ty, LiteralTypes.size()), LiteralTypes);
     std::string Name = CGM.getOpenMPRuntime().getName({"offload_rtts"});
@@ -147,6 +313,124 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
     // Store the result
     return RttsArrayGbl;
   }
+  // Emit the compiled counterpart of the runtime's job walk over type ID:
+  //   void marshaller(void *Root, int64_t *Sizes,
+  //                   void (*Emit)(void *Ctx, void **Base, void *Begin,
+  //                                int64_t Size),
+  //                   void *Ctx);
+  // It calls Emit for every nested region below Root, in the order of the
+  // walk. Only chains of pointers down to a builtin are supported, i.e.
+  // [TID, PTR, PTR..., BUILTIN] with one size per level; returns null
+  // otherwise.
+  llvm::Function *emitMarshaller(uint64_t ID, CodeGenModule &CGM) {
+    auto &types = getRttArrayByID(ID);
+    if (types.Marshaller &&
+        types.Marshaller->getParent() == &CGM.getModule()) {
+      return types.Marshaller;
+    }
+    if (types.size() < 4 || types[1] != RTT_PTR ||
+        types.back() != RTT_BUILTIN) {
+      return nullptr;
+    }
+    for (unsigned I = 2; I < types.size() - 1; ++I) {
+      if (types[I] != RTT_PTR) {
+        return nullptr;
+      }
+    }
+    unsigned Levels = types.size() - 3;
+
+    ASTContext &C = CGM.getContext();
+    FunctionArgList Args;
+    ImplicitParamDecl RootArg(C, /*DC=*/nullptr, SourceLocation(),
+                              /*Id=*/nullptr, C.VoidPtrTy,
+                              ImplicitParamDecl::Other);
+    ImplicitParamDecl SizesArg(C, /*DC=*/nullptr, SourceLocation(),
+                               /*Id=*/nullptr, C.VoidPtrTy,
+                               ImplicitParamDecl::Other);
+    ImplicitParamDecl EmitArg(C, /*DC=*/nullptr, SourceLocation(),
+                              /*Id=*/nullptr, C.VoidPtrTy,
+                              ImplicitParamDecl::Other);
+    ImplicitParamDecl CtxArg(C, /*DC=*/nullptr, SourceLocation(),
+                             /*Id=*/nullptr, C.VoidPtrTy,
+                             ImplicitParamDecl::Other);
+    Args.push_back(&RootArg);
+    Args.push_back(&SizesArg);
+    Args.push_back(&EmitArg);
+    Args.push_back(&CtxArg);
+    const auto &CGFI =
+        CGM.getTypes().arrangeBuiltinFunctionDeclaration(C.VoidTy, Args);
+    std::string Name = CGM.getOpenMPRuntime().getName(
+        {"omp_offloading", "dc_marshaller"});
+    auto *Fn = llvm::Function::Create(CGM.getTypes().GetFunctionType(CGFI),
+                                      llvm::GlobalValue::InternalLinkage,
+                                      Name, &CGM.getModule());
+    CGM.SetInternalFunctionAttributes(GlobalDecl(), Fn, CGFI);
+    Fn->setDoesNotRecurse();
+    CodeGenFunction CGF(CGM);
+    CGF.StartFunction(GlobalDecl(), C.VoidTy, Fn, CGFI, Args);
+    CGBuilderTy &Builder = CGF.Builder;
+
+    llvm::Value *Root = Builder.CreatePointerBitCastOrAddrSpaceCast(
+        Builder.CreateLoad(CGF.GetAddrOfLocalVar(&RootArg)),
+        CGM.VoidPtrPtrTy);
+    Address Sizes(Builder.CreatePointerBitCastOrAddrSpaceCast(
+        Builder.CreateLoad(CGF.GetAddrOfLocalVar(&SizesArg)),
+        CGM.Int64Ty->getPointerTo()), C.getTypeAlignInChars(C.LongLongTy));
+    llvm::Type *EmitParams[] = {CGM.VoidPtrTy, CGM.VoidPtrPtrTy,
+                                CGM.VoidPtrTy, CGM.Int64Ty};
+    auto *EmitTy = llvm::FunctionType::get(CGM.VoidTy, EmitParams,
+                                           /*isVarArg=*/false);
+    llvm::Value *Emit = Builder.CreatePointerBitCastOrAddrSpaceCast(
+        Builder.CreateLoad(CGF.GetAddrOfLocalVar(&EmitArg)),
+        EmitTy->getPointerTo());
+    llvm::Value *Ctx = Builder.CreateLoad(CGF.GetAddrOfLocalVar(&CtxArg));
+
+    SmallVector<llvm::Value *, 4> LevelSizes;
+    for (unsigned I = 0; I <= Levels; ++I) {
+      LevelSizes.push_back(
+          Builder.CreateLoad(Builder.CreateConstInBoundsGEP(Sizes, I)));
+    }
+    llvm::Value *PtrSize = llvm::ConstantInt::get(
+        CGM.Int64Ty, CGM.getPointerSize().getQuantity());
+    llvm::Value *Zero = llvm::ConstantInt::get(CGM.Int64Ty, 0);
+
+    // for (I = 0; I < Sizes[Level] / sizeof(void *); ++I) {
+    //   Emit(Ctx, &Array[I], Array[I], Sizes[Level + 1]);
+    //   <next level over Array[I]>
+    // }
+    std::function<void(unsigned, llvm::Value *)> EmitLevel =
+        [&](unsigned Level, llvm::Value *Array) {
+      llvm::Value *Count = Builder.CreateSDiv(LevelSizes[Level], PtrSize);
+      llvm::BasicBlock *EntryBB = Builder.GetInsertBlock();
+      llvm::BasicBlock *BodyBB = CGF.createBasicBlock("dc.body");
+      llvm::BasicBlock *DoneBB = CGF.createBasicBlock("dc.done");
+      Builder.CreateCondBr(Builder.CreateICmpSGT(Count, Zero), BodyBB, DoneBB);
+
+      CGF.EmitBlock(BodyBB);
+      llvm::PHINode *Idx = Builder.CreatePHI(CGM.Int64Ty, 2, "dc.idx");
+      Idx->addIncoming(Zero, EntryBB);
+      llvm::Value *Slot = Builder.CreateInBoundsGEP(CGM.VoidPtrTy, Array, Idx);
+      llvm::Value *Ptr = Builder.CreateLoad(Address(Slot,
+                                                    CGF.getPointerAlign()));
+      llvm::Value *EmitArgs[] = {Ctx, Slot, Ptr, LevelSizes[Level + 1]};
+      Builder.CreateCall(EmitTy, Emit, EmitArgs);
+      if (Level + 1 < Levels) {
+        EmitLevel(Level + 1, Builder.CreatePointerBitCastOrAddrSpaceCast(
+                                 Ptr, CGM.VoidPtrPtrTy));
+      }
+      llvm::Value *Next = Builder.CreateNSWAdd(
+          Idx, llvm::ConstantInt::get(CGM.Int64Ty, 1));
+      Idx->addIncoming(Next, Builder.GetInsertBlock());
+      Builder.CreateCondBr(Builder.CreateICmpSLT(Next, Count), BodyBB, DoneBB);
+
+      CGF.EmitBlock(DoneBB);
+    };
+    EmitLevel(0, Root);
+    CGF.FinishFunction();
+
+    types.Marshaller = Fn;
+    return Fn;
+  }
 
   // Stmt
   int OASECount;
@@ -162,8 +446,9 @@ class OMPDC_Helper : public RecursiveASTVisitor<OMPDC_Helper> {
   }
 };
 std::map<Type*, uint64_t> OMPDC_Helper::TIDMap;
-SmallVector<MapRttArrayTy, 8> OMPDC_Helper::TIDList;
+std::deque<MapRttArrayTy> OMPDC_Helper::TIDList;
 MapValuesArrayTy OMPDC_Helper::AdditionalPointers;
+std::map<std::string, std::set<uint64_t>> OMPDC_Helper::FieldUsage;
 } // anonymous namespace
 
 namespace {
@@ -850,7 +1135,8 @@ enum OpenMPRTLFunction {
   OMPRTL__tgt_target,
   // Call to int32_t __tgt_target_nowait(int64_t device_id, void *host_ptr,
   // int32_t arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-  // *arg_types);
+  // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+  // *noAliasDepList);
   OMPRTL__tgt_target_nowait,
   // Call to int32_t __tgt_target_teams(int64_t device_id, void *host_ptr,
   // int32_t arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
@@ -858,7 +1144,9 @@ enum OpenMPRTLFunction {
   OMPRTL__tgt_target_teams,
   // Call to int32_t __tgt_target_teams_nowait(int64_t device_id, void
   // *host_ptr, int32_t arg_num, void** args_base, void **args, int64_t
-  // *arg_sizes, int64_t *arg_types, int32_t num_teams, int32_t thread_limit);
+  // *arg_sizes, int64_t *arg_types, int32_t num_teams, int32_t thread_limit,
+  // int32_t depNum, void *depList, int32_t noAliasDepNum, void
+  // *noAliasDepList);
   OMPRTL__tgt_target_teams_nowait,
   // Call to void __tgt_register_requires(int64_t flags);
   OMPRTL__tgt_register_requires,
@@ -871,21 +1159,24 @@ enum OpenMPRTLFunction {
   OMPRTL__tgt_target_data_begin,
   // Call to void __tgt_target_data_begin_nowait(int64_t device_id, int32_t
   // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-  // *arg_types);
+  // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+  // *noAliasDepList);
   OMPRTL__tgt_target_data_begin_nowait,
   // Call to void __tgt_target_data_end(int64_t device_id, int32_t arg_num,
   // void** args_base, void **args, size_t *arg_sizes, int64_t *arg_types);
   OMPRTL__tgt_target_data_end,
   // Call to void __tgt_target_data_end_nowait(int64_t device_id, int32_t
   // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-  // *arg_types);
+  // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+  // *noAliasDepList);
   OMPRTL__tgt_target_data_end_nowait,
   // Call to void __tgt_target_data_update(int64_t device_id, int32_t arg_num,
   // void** args_base, void **args, int64_t *arg_sizes, int64_t *arg_types);
   OMPRTL__tgt_target_data_update,
   // Call to void __tgt_target_data_update_nowait(int64_t device_id, int32_t
   // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-  // *arg_types);
+  // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+  // *noAliasDepList);
   OMPRTL__tgt_target_data_update_nowait,
 };
 
@@ -2430,14 +2721,19 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
   case OMPRTL__tgt_target_nowait: {
     // Build int32_t __tgt_target_nowait(int64_t device_id, void *host_ptr,
     // int32_t arg_num, void** args_base, void **args, int64_t *arg_sizes,
-    // int64_t *arg_types);
+    // int64_t *arg_types, int32_t depNum, void *depList, int32_t
+    // noAliasDepNum, void *noAliasDepList);
     llvm::Type *TypeParams[] = {CGM.Int64Ty,
                                 CGM.VoidPtrTy,
                                 CGM.Int32Ty,
                                 CGM.VoidPtrPtrTy,
                                 CGM.VoidPtrPtrTy,
                                 CGM.Int64Ty->getPointerTo(),
-                                CGM.Int64Ty->getPointerTo()};
+                                CGM.Int64Ty->getPointerTo(),
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy};
     auto *FnTy =
         llvm::FunctionType::get(CGM.Int32Ty, TypeParams, /*isVarArg*/ false);
     RTLFn = CGM.CreateRuntimeFunction(FnTy, "__tgt_target_nowait");
@@ -2464,7 +2760,9 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
   case OMPRTL__tgt_target_teams_nowait: {
     // Build int32_t __tgt_target_teams_nowait(int64_t device_id, void
     // *host_ptr, int32_t arg_num, void** args_base, void **args, int64_t
-    // *arg_sizes, int64_t *arg_types, int32_t num_teams, int32_t thread_limit);
+    // *arg_sizes, int64_t *arg_types, int32_t num_teams, int32_t thread_limit,
+    // int32_t depNum, void *depList, int32_t noAliasDepNum, void
+    // *noAliasDepList);
     llvm::Type *TypeParams[] = {CGM.Int64Ty,
                                 CGM.VoidPtrTy,
                                 CGM.Int32Ty,
@@ -2473,7 +2771,11 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
                                 CGM.Int64Ty->getPointerTo(),
                                 CGM.Int64Ty->getPointerTo(),
                                 CGM.Int32Ty,
-                                CGM.Int32Ty};
+                                CGM.Int32Ty,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy};
     auto *FnTy =
         llvm::FunctionType::get(CGM.Int32Ty, TypeParams, /*isVarArg*/ false);
     RTLFn = CGM.CreateRuntimeFunction(FnTy, "__tgt_target_teams_nowait");
@@ -2524,13 +2826,18 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
   case OMPRTL__tgt_target_data_begin_nowait: {
     // Build void __tgt_target_data_begin_nowait(int64_t device_id, int32_t
     // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-    // *arg_types);
+    // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+    // *noAliasDepList);
     llvm::Type *TypeParams[] = {CGM.Int64Ty,
                                 CGM.Int32Ty,
                                 CGM.VoidPtrPtrTy,
                                 CGM.VoidPtrPtrTy,
                                 CGM.Int64Ty->getPointerTo(),
-                                CGM.Int64Ty->getPointerTo()};
+                                CGM.Int64Ty->getPointerTo(),
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy};
     auto *FnTy =
         llvm::FunctionType::get(CGM.VoidTy, TypeParams, /*isVarArg=*/false);
     RTLFn = CGM.CreateRuntimeFunction(FnTy, "__tgt_target_data_begin_nowait");
@@ -2553,13 +2860,18 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
   case OMPRTL__tgt_target_data_end_nowait: {
     // Build void __tgt_target_data_end_nowait(int64_t device_id, int32_t
     // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-    // *arg_types);
+    // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+    // *noAliasDepList);
     llvm::Type *TypeParams[] = {CGM.Int64Ty,
                                 CGM.Int32Ty,
                                 CGM.VoidPtrPtrTy,
                                 CGM.VoidPtrPtrTy,
                                 CGM.Int64Ty->getPointerTo(),
-                                CGM.Int64Ty->getPointerTo()};
+                                CGM.Int64Ty->getPointerTo(),
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy};
     auto *FnTy =
         llvm::FunctionType::get(CGM.VoidTy, TypeParams, /*isVarArg=*/false);
     RTLFn = CGM.CreateRuntimeFunction(FnTy, "__tgt_target_data_end_nowait");
@@ -2582,13 +2894,18 @@ llvm::FunctionCallee CGOpenMPRuntime::createRuntimeFunction(unsigned Function) {
   case OMPRTL__tgt_target_data_update_nowait: {
     // Build void __tgt_target_data_update_nowait(int64_t device_id, int32_t
     // arg_num, void** args_base, void **args, int64_t *arg_sizes, int64_t
-    // *arg_types);
+    // *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum, void
+    // *noAliasDepList);
     llvm::Type *TypeParams[] = {CGM.Int64Ty,
                                 CGM.Int32Ty,
                                 CGM.VoidPtrPtrTy,
                                 CGM.VoidPtrPtrTy,
                                 CGM.Int64Ty->getPointerTo(),
-                                CGM.Int64Ty->getPointerTo()};
+                                CGM.Int64Ty->getPointerTo(),
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy,
+                                CGM.Int32Ty,
+                                CGM.VoidPtrTy};
     auto *FnTy =
         llvm::FunctionType::get(CGM.VoidTy, TypeParams, /*isVarArg=*/false);
     RTLFn = CGM.CreateRuntimeFunction(FnTy, "__tgt_target_data_update_nowait");
@@ -7219,6 +7536,9 @@ public:
     // If a flags has OMP_MAP_NESTED, embed every flags
     OMP_MAP_HAS_NESTED = 0x800,
 #endif
+    /// The map types array is a constant of its construct, the runtime may
+    /// cache what it derives from it by address.
+    OMP_MAP_CONST_DESC = 0x1000,
     /// The 16 MSBs of the flags indicate whether the entry is member of some
     /// struct/class.
     OMP_MAP_MEMBER_OF = 0xffff000000000000,
@@ -7895,6 +8215,8 @@ private:
 
           OMPDC_Helper DCHelper;
           llvm::Value *RttTypeArray, *RttSizeArray;
+          llvm::Function *Marshaller = nullptr;
+          uint64_t RttID = 0;
           Expr *E = I->getAssociatedExpression();
           assert(isa<OMPArraySectionExpr>(E));
           if (auto OASE = dyn_cast<OMPArraySectionExpr>(E)) {
@@ -7903,9 +8225,14 @@ private:
             // Gen type
             llvm::outs() << "\tMapping type: " <<
               TargetType.getAsString() << "\n";
+            DCHelper.CGM = &CGF.CGM;
             auto ID = DCHelper.genRttTypes(TargetType);
+            RttID = ID;
             // FIXME
             RttTypeArray = DCHelper.emitRttArray(ID, CGF.CGM);
+            if (OpenMPDCMarshaller) {
+              Marshaller = DCHelper.emitMarshaller(ID, CGF.CGM);
+            }
             // Debug
             llvm::outs() << "\tRTT array: ";
             for (auto M : DCHelper.getRttArrayByID(ID)) {
@@ -7951,15 +8278,23 @@ private:
             return SizeArray;
           };
           RttSizeArray = emitRttSizes();
+          // The marshaller reads one size per level
+          if (Marshaller &&
+              RttSizes.size() + 2 != DCHelper.getRttArrayByID(RttID).size()) {
+            Marshaller = nullptr;
+          }
 
-          // Store type array and size array into a two-pointer array
+          // Store type array and size array into a two-pointer array, plus
+          // the marshaller with -openmp-dc-marshaller
+          unsigned RttInfoSize = OpenMPDCMarshaller ? 3 : 2;
           // clang type
           QualType RttInfoTy = Ctx.getConstantArrayType(Ctx.VoidPtrTy,
-              llvm::APInt(8, 2, false), ArrayType::Normal, 0);
+              llvm::APInt(8, RttInfoSize, false), ArrayType::Normal, 0);
           llvm::Value *RttInfo = CGF.CreateMemTemp(
             RttInfoTy, ".offload_rtt_info").getPointer();
           // Store Types
-          auto *llvmRttInfoTy = llvm::ArrayType::get(CGF.VoidPtrTy, 2);
+          auto *llvmRttInfoTy = llvm::ArrayType::get(CGF.VoidPtrTy,
+                                                     RttInfoSize);
           llvm::Value *TypeGEP = CGF.Builder.CreateConstInBoundsGEP2_32(
             llvmRttInfoTy, RttInfo, 0, /*idx*/ 0);
           TypeGEP = CGF.Builder.CreatePointerBitCastOrAddrSpaceCast(
@@ -7973,6 +8308,17 @@ private:
             SizeGEP, RttSizeArray->getType()->getPointerTo(0));
           Address SizeAddr(SizeGEP, Ctx.getTypeAlignInChars(Ctx.VoidPtrTy));
           CGF.Builder.CreateStore(RttSizeArray, SizeAddr);
+          // Store the marshaller, null leaves the walk to the runtime
+          if (OpenMPDCMarshaller) {
+            llvm::Value *FnGEP = CGF.Builder.CreateConstInBoundsGEP2_32(
+              llvmRttInfoTy, RttInfo, 0, /*idx*/ 2);
+            Address FnAddr(FnGEP, Ctx.getTypeAlignInChars(Ctx.VoidPtrTy));
+            CGF.Builder.CreateStore(
+                Marshaller ? CGF.Builder.CreatePointerBitCastOrAddrSpaceCast(
+                                 Marshaller, CGF.VoidPtrTy)
+                           : llvm::ConstantPointerNull::get(CGF.VoidPtrTy),
+                FnAddr);
+          }
           // Put into Additional
           OMPDC_Helper::AdditionalPointers.push_back(RttInfo);
         }
@@ -8789,9 +9135,12 @@ emitOffloadingArrays(CodeGenFunction &CGF,
     }
 
     // The map types are always constant so we don't need to generate code to
-    // fill arrays. Instead, we create an array constant.
+    // fill arrays. Instead, we create an array constant, which is flagged so
+    // that the runtime only scans it on the first launch of the construct.
     SmallVector<uint64_t, 4> Mapping(MapTypes.size(), 0);
     llvm::copy(MapTypes, Mapping.begin());
+    if (!Mapping.empty())
+      Mapping[0] |= MappableExprsHandler::OMP_MAP_CONST_DESC;
     llvm::Constant *MapTypesArrayInit =
         llvm::ConstantDataArray::get(CGF.Builder.getContext(), Mapping);
     std::string MaptypesName =
@@ -9061,7 +9410,15 @@ void CGOpenMPRuntime::emitTargetCall(CodeGenFunction &CGF,
     llvm::Value *NumTeams = emitNumTeamsForTargetDirective(CGF, D);
     llvm::Value *NumThreads = emitNumThreadsForTargetDirective(CGF, D);
 
-    bool HasNowait = D.hasClausesOfKind<OMPNowaitClause>();
+    // With dependences the call is made from a target task, which already
+    // defers the region; the runtime completes it before the task ends.
+    bool HasNowait =
+        D.hasClausesOfKind<OMPNowaitClause>() && !RequiresOuterTask;
+    // The dependences were resolved by the enclosing code, none are passed
+    // to the nowait entry points.
+    llvm::Value *NoDeps[] = {
+        CGF.Builder.getInt32(0), llvm::ConstantPointerNull::get(CGF.VoidPtrTy),
+        CGF.Builder.getInt32(0), llvm::ConstantPointerNull::get(CGF.VoidPtrTy)};
     // The target region is an outlined function launched by the runtime
     // via calls __tgt_target() or __tgt_target_teams().
     //
@@ -9097,27 +9454,33 @@ void CGOpenMPRuntime::emitTargetCall(CodeGenFunction &CGF,
       // passed to the runtime library - a 32-bit integer with the value zero.
       assert(NumThreads && "Thread limit expression should be available along "
                            "with number of teams.");
-      llvm::Value *OffloadingArgs[] = {DeviceID,
-                                       OutlinedFnID,
-                                       PointerNum,
-                                       InputInfo.BasePointersArray.getPointer(),
-                                       InputInfo.PointersArray.getPointer(),
-                                       InputInfo.SizesArray.getPointer(),
-                                       MapTypesArray,
-                                       NumTeams,
-                                       NumThreads};
+      llvm::SmallVector<llvm::Value *, 13> OffloadingArgs = {
+          DeviceID,
+          OutlinedFnID,
+          PointerNum,
+          InputInfo.BasePointersArray.getPointer(),
+          InputInfo.PointersArray.getPointer(),
+          InputInfo.SizesArray.getPointer(),
+          MapTypesArray,
+          NumTeams,
+          NumThreads};
+      if (HasNowait)
+        OffloadingArgs.append(std::begin(NoDeps), std::end(NoDeps));
       Return = CGF.EmitRuntimeCall(
           createRuntimeFunction(HasNowait ? OMPRTL__tgt_target_teams_nowait
                                           : OMPRTL__tgt_target_teams),
           OffloadingArgs);
     } else {
-      llvm::Value *OffloadingArgs[] = {DeviceID,
-                                       OutlinedFnID,
-                                       PointerNum,
-                                       InputInfo.BasePointersArray.getPointer(),
-                                       InputInfo.PointersArray.getPointer(),
-                                       InputInfo.SizesArray.getPointer(),
-                                       MapTypesArray};
+      llvm::SmallVector<llvm::Value *, 11> OffloadingArgs = {
+          DeviceID,
+          OutlinedFnID,
+          PointerNum,
+          InputInfo.BasePointersArray.getPointer(),
+          InputInfo.PointersArray.getPointer(),
+          InputInfo.SizesArray.getPointer(),
+          MapTypesArray};
+      if (HasNowait)
+        OffloadingArgs.append(std::begin(NoDeps), std::end(NoDeps));
       Return = CGF.EmitRuntimeCall(
           createRuntimeFunction(HasNowait ? OMPRTL__tgt_target_nowait
                                           : OMPRTL__tgt_target),
@@ -9934,16 +10297,27 @@ void CGOpenMPRuntime::emitTargetDataStandAloneCall(
     llvm::Constant *PointerNum =
         CGF.Builder.getInt32(InputInfo.NumberOfTargetItems);
 
-    llvm::Value *OffloadingArgs[] = {DeviceID,
-                                     PointerNum,
-                                     InputInfo.BasePointersArray.getPointer(),
-                                     InputInfo.PointersArray.getPointer(),
-                                     InputInfo.SizesArray.getPointer(),
-                                     MapTypesArray};
+    llvm::SmallVector<llvm::Value *, 10> OffloadingArgs = {
+        DeviceID,
+        PointerNum,
+        InputInfo.BasePointersArray.getPointer(),
+        InputInfo.PointersArray.getPointer(),
+        InputInfo.SizesArray.getPointer(),
+        MapTypesArray};
 
     // Select the right runtime function call for each expected standalone
-    // directive.
-    const bool HasNowait = D.hasClausesOfKind<OMPNowaitClause>();
+    // directive. With dependences the call is made from a target task, which
+    // already defers the directive.
+    const bool HasNowait = D.hasClausesOfKind<OMPNowaitClause>() &&
+                           !D.hasClausesOfKind<OMPDependClause>();
+    if (HasNowait) {
+      // The dependences were resolved by the enclosing code
+      OffloadingArgs.append(
+          {CGF.Builder.getInt32(0),
+           llvm::ConstantPointerNull::get(CGF.VoidPtrTy),
+           CGF.Builder.getInt32(0),
+           llvm::ConstantPointerNull::get(CGF.VoidPtrTy)});
+    }
     OpenMPRTLFunction RTLFn;
     switch (D.getDirectiveKind()) {
     case OMPD_target_enter_data:
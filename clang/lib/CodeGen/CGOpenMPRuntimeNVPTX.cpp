@@ -652,6 +652,22 @@ static llvm::Value *getNVPTXNumThreads(CodeGenFunction &CGF) {
       "nvptx_num_threads");
 }
 
+/// Get the id of the current block in the grid.
+static llvm::Value *getNVPTXBlockID(CodeGenFunction &CGF) {
+  return CGF.EmitRuntimeCall(
+      llvm::Intrinsic::getDeclaration(
+          &CGF.CGM.getModule(), llvm::Intrinsic::nvvm_read_ptx_sreg_ctaid_x),
+      "nvptx_block_id");
+}
+
+/// Get the number of blocks in the grid.
+static llvm::Value *getNVPTXNumBlocks(CodeGenFunction &CGF) {
+  return CGF.EmitRuntimeCall(
+      llvm::Intrinsic::getDeclaration(
+          &CGF.CGM.getModule(), llvm::Intrinsic::nvvm_read_ptx_sreg_nctaid_x),
+      "nvptx_num_blocks");
+}
+
 /// Get the value of the thread_limit clause in the teams directive.
 /// For the 'generic' execution mode, the runtime encodes thread_limit in
 /// the launch parameters, always starting thread_limit+warpSize threads per
@@ -2687,6 +2703,134 @@ void CGOpenMPRuntimeNVPTX::emitBarrierCall(CodeGenFunction &CGF,
   CGF.EmitRuntimeCall(createNVPTXRuntimeFunction(OMPRTL__kmpc_barrier), Args);
 }
 
+/// Emit the computation of omptarget_nvptx_LoopSupport::for_static_init in
+/// the device runtime: the first chunk of entity \p EntityId among
+/// \p NumEntities is stored to the LB, UB, ST and IL outputs of \p Values.
+/// A null \p Chunk is the unchunked schedule, a chunk that is not positive
+/// falls back to it like in the runtime.
+static void
+emitStaticScheduleInline(CodeGenFunction &CGF,
+                         const CGOpenMPRuntime::StaticRTInput &Values,
+                         llvm::Value *Chunk, llvm::Value *EntityId,
+                         llvm::Value *NumEntities) {
+  CGBuilderTy &Bld = CGF.Builder;
+  bool Signed = Values.IVSigned;
+  llvm::Type *IVTy = Bld.getIntNTy(Values.IVSize);
+  auto &&Div = [&Bld, Signed](llvm::Value *LHS, llvm::Value *RHS) {
+    return Signed ? Bld.CreateSDiv(LHS, RHS) : Bld.CreateUDiv(LHS, RHS);
+  };
+  auto &&Rem = [&Bld, Signed](llvm::Value *LHS, llvm::Value *RHS) {
+    return Signed ? Bld.CreateSRem(LHS, RHS) : Bld.CreateURem(LHS, RHS);
+  };
+  auto &&LessEq = [&Bld, Signed](llvm::Value *LHS, llvm::Value *RHS) {
+    return Signed ? Bld.CreateICmpSLE(LHS, RHS) : Bld.CreateICmpULE(LHS, RHS);
+  };
+  EntityId = Bld.CreateIntCast(EntityId, IVTy, /*isSigned=*/false);
+  NumEntities = Bld.CreateIntCast(NumEntities, IVTy, /*isSigned=*/false);
+  llvm::Value *Zero = llvm::ConstantInt::get(IVTy, 0);
+  llvm::Value *One = llvm::ConstantInt::get(IVTy, 1);
+  llvm::Value *LB = Bld.CreateLoad(Values.LB);
+  llvm::Value *UB = Bld.CreateLoad(Values.UB);
+
+  // Without chunk, each entity gets at most one chunk and the chunks are of
+  // almost equal sizes: the first LeftOver entities take one more iteration.
+  llvm::Value *LoopSize = Bld.CreateAdd(Bld.CreateSub(UB, LB), One);
+  llvm::Value *Size = Div(LoopSize, NumEntities);
+  llvm::Value *LeftOver =
+      Bld.CreateSub(LoopSize, Bld.CreateMul(Size, NumEntities));
+  llvm::Value *TakesMore = Signed ? Bld.CreateICmpSLT(EntityId, LeftOver)
+                                  : Bld.CreateICmpULT(EntityId, LeftOver);
+  Size = Bld.CreateAdd(Size, Bld.CreateZExt(TakesMore, IVTy));
+  llvm::Value *NewLB = Bld.CreateAdd(
+      Bld.CreateAdd(LB, Bld.CreateMul(EntityId, Size)),
+      Bld.CreateSelect(TakesMore, Zero, LeftOver));
+  llvm::Value *NewUB = Bld.CreateSub(Bld.CreateAdd(NewLB, Size), One);
+  llvm::Value *Last = Bld.CreateAnd(LessEq(NewLB, UB), LessEq(UB, NewUB));
+  llvm::Value *Stride = LoopSize;
+
+  if (Chunk) {
+    // Chunks of the same size are dealt round-robin.
+    auto *ConstChunk = dyn_cast<llvm::ConstantInt>(Chunk);
+    bool KnownPositive =
+        ConstChunk && ConstChunk->getValue().isStrictlyPositive();
+    llvm::Value *IsChunked = nullptr;
+    if (!KnownPositive) {
+      IsChunked = Bld.CreateICmpSGT(Chunk, Zero);
+      // Keep the unused computation free of division by zero.
+      Chunk = Bld.CreateSelect(IsChunked, Chunk, One);
+    }
+    llvm::Value *ChunkStride = Bld.CreateMul(NumEntities, Chunk);
+    llvm::Value *ChunkLB = Bld.CreateAdd(LB, Bld.CreateMul(EntityId, Chunk));
+    llvm::Value *ChunkUB = Bld.CreateSub(Bld.CreateAdd(ChunkLB, Chunk), One);
+    llvm::Value *LastChunkBegin = Bld.CreateSub(UB, Rem(UB, Chunk));
+    llvm::Value *ChunkLast = Bld.CreateICmpEQ(
+        Rem(Bld.CreateSub(LastChunkBegin, ChunkLB), ChunkStride), Zero);
+    if (KnownPositive) {
+      NewLB = ChunkLB;
+      NewUB = ChunkUB;
+      Stride = ChunkStride;
+      Last = ChunkLast;
+    } else {
+      NewLB = Bld.CreateSelect(IsChunked, ChunkLB, NewLB);
+      NewUB = Bld.CreateSelect(IsChunked, ChunkUB, NewUB);
+      Stride = Bld.CreateSelect(IsChunked, ChunkStride, Stride);
+      Last = Bld.CreateSelect(IsChunked, ChunkLast, Last);
+    }
+  }
+
+  Bld.CreateStore(NewLB, Values.LB);
+  Bld.CreateStore(NewUB, Values.UB);
+  Bld.CreateStore(Stride, Values.ST);
+  Bld.CreateStore(Bld.CreateZExt(Last, CGF.Int32Ty), Values.IL);
+}
+
+void CGOpenMPRuntimeNVPTX::emitForStaticInit(
+    CodeGenFunction &CGF, SourceLocation Loc, OpenMPDirectiveKind DKind,
+    const OpenMPScheduleTy &ScheduleKind, const StaticRTInput &Values) {
+  // Only the worksharing loops of the combined constructs are known to be in
+  // the parallel region of the kernel, where all the threads of the block
+  // take part. The simd modifier and ordered loops need the runtime.
+  bool IsL1Loop = false;
+  switch (DKind) {
+  case OMPD_target_parallel_for:
+  case OMPD_target_parallel_for_simd:
+  case OMPD_distribute_parallel_for:
+  case OMPD_distribute_parallel_for_simd:
+  case OMPD_teams_distribute_parallel_for:
+  case OMPD_teams_distribute_parallel_for_simd:
+  case OMPD_target_teams_distribute_parallel_for:
+  case OMPD_target_teams_distribute_parallel_for_simd:
+    IsL1Loop = true;
+    break;
+  default:
+    break;
+  }
+  if (!CGF.HaveInsertPoint() || !IsL1Loop ||
+      getExecutionMode() != CGOpenMPRuntimeNVPTX::EM_SPMD || Values.Ordered ||
+      (ScheduleKind.Schedule != OMPC_SCHEDULE_static &&
+       ScheduleKind.Schedule != OMPC_SCHEDULE_unknown) ||
+      ScheduleKind.M1 == OMPC_SCHEDULE_MODIFIER_simd ||
+      ScheduleKind.M2 == OMPC_SCHEDULE_MODIFIER_simd) {
+    CGOpenMPRuntime::emitForStaticInit(CGF, Loc, DKind, ScheduleKind, Values);
+    return;
+  }
+  emitStaticScheduleInline(CGF, Values, Values.Chunk, getThreadID(CGF, Loc),
+                           getNVPTXNumThreads(CGF));
+}
+
+void CGOpenMPRuntimeNVPTX::emitDistributeStaticInit(
+    CodeGenFunction &CGF, SourceLocation Loc,
+    OpenMPDistScheduleClauseKind SchedKind, const StaticRTInput &Values) {
+  if (!CGF.HaveInsertPoint() ||
+      getExecutionMode() != CGOpenMPRuntimeNVPTX::EM_SPMD) {
+    CGOpenMPRuntime::emitDistributeStaticInit(CGF, Loc, SchedKind, Values);
+    return;
+  }
+  // One team per block.
+  emitStaticScheduleInline(CGF, Values, Values.Chunk, getNVPTXBlockID(CGF),
+                           getNVPTXNumBlocks(CGF));
+}
+
 void CGOpenMPRuntimeNVPTX::emitCriticalRegion(
     CodeGenFunction &CGF, StringRef CriticalName,
     const RegionCodeGenTy &CriticalOpGen, SourceLocation Loc,
@@ -3955,6 +4099,54 @@ static llvm::Value *emitGlobalToListReduceFunction(
   return Fn;
 }
 
+/// Return the suffix of the typed runtime reductions, e.g. "add_i32", if the
+/// reduction is of a single int, long, float or double with the builtin +,
+/// min or max operator. Return an empty string otherwise.
+static std::string getTypedReductionSuffix(ASTContext &C,
+                                           ArrayRef<const Expr *> Privates,
+                                           ArrayRef<const Expr *> ReductionOps) {
+  if (Privates.size() != 1)
+    return std::string();
+  QualType Ty = Privates.front()->getType().getCanonicalType();
+  StringRef TySuffix;
+  if (Ty->isSpecificBuiltinType(BuiltinType::Float))
+    TySuffix = "f32";
+  else if (Ty->isSpecificBuiltinType(BuiltinType::Double))
+    TySuffix = "f64";
+  else if (Ty->isSignedIntegerType() && !Ty->isEnumeralType() &&
+           C.getTypeSize(Ty) == 32)
+    TySuffix = "i32";
+  else if (Ty->isSignedIntegerType() && !Ty->isEnumeralType() &&
+           C.getTypeSize(Ty) == 64)
+    TySuffix = "i64";
+  else
+    return std::string();
+
+  // Sema builds 'lhs = lhs + rhs' for + and 'lhs = lhs < rhs ? lhs : rhs'
+  // (or '>') for min and max.
+  const auto *Assign =
+      dyn_cast<BinaryOperator>(ReductionOps.front()->IgnoreImplicit());
+  if (!Assign || Assign->getOpcode() != BO_Assign)
+    return std::string();
+  const Expr *Combiner = Assign->getRHS()->IgnoreParenImpCasts();
+  StringRef OpSuffix;
+  if (const auto *BO = dyn_cast<BinaryOperator>(Combiner)) {
+    if (BO->getOpcode() == BO_Add)
+      OpSuffix = "add";
+  } else if (const auto *CO = dyn_cast<ConditionalOperator>(Combiner)) {
+    if (const auto *Cond =
+            dyn_cast<BinaryOperator>(CO->getCond()->IgnoreParenImpCasts())) {
+      if (Cond->getOpcode() == BO_LT)
+        OpSuffix = "min";
+      else if (Cond->getOpcode() == BO_GT)
+        OpSuffix = "max";
+    }
+  }
+  if (OpSuffix.empty())
+    return std::string();
+  return (OpSuffix + "_" + TySuffix).str();
+}
+
 ///
 /// Design of OpenMP reductions on the GPU
 ///
@@ -4229,6 +4421,45 @@ void CGOpenMPRuntimeNVPTX::emitReduction(
 
   llvm::Value *Res;
   ASTContext &C = CGM.getContext();
+  std::string TypedSuffix =
+      getTypedReductionSuffix(C, Privates, ReductionOps);
+  if (!TypedSuffix.empty()) {
+    // A scalar with a builtin operator is reduced by the runtime without
+    // the shuffle, copy and buffer helpers.
+    llvm::Type *ElemPtrTy =
+        CGF.ConvertTypeForMem(Privates.front()->getType())->getPointerTo();
+    llvm::Value *RHSPtr = CGF.Builder.CreatePointerBitCastOrAddrSpaceCast(
+        CGF.EmitLValue(RHSExprs.front()).getPointer(), ElemPtrTy);
+    if (!ParallelReduction) {
+      assert(TeamsReduction && "expected teams reduction.");
+      // Build __kmpc_nvptx_teams_reduce_nowait_<op>_<type>(<loc>, <gtid>,
+      // &rhs, &lhs), it combines into the original variable itself.
+      llvm::Value *LHSPtr = CGF.Builder.CreatePointerBitCastOrAddrSpaceCast(
+          CGF.EmitLValue(LHSExprs.front()).getPointer(), ElemPtrTy);
+      llvm::Type *TypeParams[] = {getIdentTyPointerTy(), CGM.Int32Ty,
+                                  ElemPtrTy, ElemPtrTy};
+      auto *FnTy =
+          llvm::FunctionType::get(CGM.VoidTy, TypeParams, /*isVarArg=*/false);
+      CGF.EmitRuntimeCall(
+          CGM.CreateRuntimeFunction(
+              FnTy, "__kmpc_nvptx_teams_reduce_nowait_" + TypedSuffix),
+          {RTLoc, ThreadId, RHSPtr, LHSPtr});
+      return;
+    }
+    // Build res = __kmpc_nvptx_parallel_reduce_nowait_<op>_<type>(<loc>,
+    // <gtid>, &rhs);
+    llvm::Type *TypeParams[] = {getIdentTyPointerTy(), CGM.Int32Ty, ElemPtrTy};
+    auto *FnTy =
+        llvm::FunctionType::get(CGM.Int32Ty, TypeParams, /*isVarArg=*/false);
+    Res = CGF.EmitRuntimeCall(
+        CGM.CreateRuntimeFunction(
+            FnTy, "__kmpc_nvptx_parallel_reduce_nowait_" + TypedSuffix),
+        {RTLoc, ThreadId, RHSPtr});
+    emitReductionResult(CGF, Res, ThreadId, Privates, LHSExprs, RHSExprs,
+                        ReductionOps);
+    return;
+  }
+
   // 1. Build a list of reduction variables.
   // void *RedList[<n>] = {<ReductionVars>[0], ..., <ReductionVars>[<n>-1]};
   auto Size = RHSExprs.size();
@@ -4341,6 +4572,14 @@ void CGOpenMPRuntimeNVPTX::emitReduction(
         Args);
   }
 
+  emitReductionResult(CGF, Res, ThreadId, Privates, LHSExprs, RHSExprs,
+                      ReductionOps);
+}
+
+void CGOpenMPRuntimeNVPTX::emitReductionResult(
+    CodeGenFunction &CGF, llvm::Value *Res, llvm::Value *ThreadId,
+    ArrayRef<const Expr *> Privates, ArrayRef<const Expr *> LHSExprs,
+    ArrayRef<const Expr *> RHSExprs, ArrayRef<const Expr *> ReductionOps) {
   // 5. Build if (res == 1)
   llvm::BasicBlock *ExitBB = CGF.createBasicBlock(".omp.reduction.done");
   llvm::BasicBlock *ThenBB = CGF.createBasicBlock(".omp.reduction.then");
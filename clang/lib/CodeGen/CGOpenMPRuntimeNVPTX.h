@@ -88,6 +88,15 @@ private:
   /// Signal termination of SPMD mode execution.
   void emitSPMDEntryFooter(CodeGenFunction &CGF, EntryFunctionState &EST);
 
+  /// Combine the reduced values into the original variables in the thread
+  /// where the reduction call returned 1 in \p Res.
+  void emitReductionResult(CodeGenFunction &CGF, llvm::Value *Res,
+                           llvm::Value *ThreadId,
+                           ArrayRef<const Expr *> Privates,
+                           ArrayRef<const Expr *> LHSExprs,
+                           ArrayRef<const Expr *> RHSExprs,
+                           ArrayRef<const Expr *> ReductionOps);
+
   //
   // Base class overrides.
   //
@@ -287,6 +296,20 @@ public:
                        OpenMPDirectiveKind Kind, bool EmitChecks = true,
                        bool ForceSimpleCall = false) override;
 
+  /// Call the appropriate runtime routine to initialize it before start
+  /// of loop. In SPMD mode, the static schedules of the loops run by all the
+  /// threads of the block are computed inline instead.
+  void emitForStaticInit(CodeGenFunction &CGF, SourceLocation Loc,
+                         OpenMPDirectiveKind DKind,
+                         const OpenMPScheduleTy &ScheduleKind,
+                         const StaticRTInput &Values) override;
+
+  /// Same for the 'distribute' part of a loop, which is split among the
+  /// blocks of the kernel.
+  void emitDistributeStaticInit(CodeGenFunction &CGF, SourceLocation Loc,
+                                OpenMPDistScheduleClauseKind SchedKind,
+                                const StaticRTInput &Values) override;
+
   /// Emits a critical region.
   /// \param CriticalName Name of the critical region.
   /// \param CriticalOpGen Generator for the statement associated with the given
@@ -18,13 +18,16 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/TextDiagnosticPrinter.h"
 #include "clang/Index/USRGeneration.h"
+#include "clang/StaticAnalyzer/Core/AnalyzerOptions.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <fstream>
+#include <mutex>
 #include <sstream>
 
 namespace clang {
@@ -47,6 +50,9 @@ STATISTIC(NumNameConflicts, "The # of imports when the ASTImporter "
 STATISTIC(NumTripleMismatch, "The # of triple mismatches");
 STATISTIC(NumLangMismatch, "The # of language mismatches");
 STATISTIC(NumLangDialectMismatch, "The # of language dialect mismatches");
+STATISTIC(NumASTLoadThresholdReached,
+          "The # of ASTs not loaded because of the threshold");
+STATISTIC(NumIndexCacheHits, "The # of CTU indexes reused from the cache");
 
 // Same as Triple's equality operator, but we check a field only if that is
 // known in both instances.
@@ -106,12 +112,37 @@ public:
       return "Language mismatch";
     case index_error_code::lang_dialect_mismatch:
       return "Language dialect mismatch";
+    case index_error_code::load_threshold_reached:
+      return "Load threshold reached";
     }
     llvm_unreachable("Unrecognized index_error_code.");
   }
 };
 
 static llvm::ManagedStatic<IndexErrorCategory> Category;
+
+/// The parsed indexes of the process. Tools that analyze several translation
+/// units, one after the other or on several threads, parse each index once.
+/// An index is parsed again if its file changed since.
+class CrossTUIndexCache {
+public:
+  using IndexTy = llvm::StringMap<std::string>;
+
+  llvm::Expected<std::shared_ptr<const IndexTy>> get(StringRef IndexPath,
+                                                     StringRef CrossTUDir);
+
+private:
+  struct Entry {
+    llvm::sys::TimePoint<> ModificationTime;
+    uint64_t Size;
+    std::shared_ptr<const IndexTy> Index;
+  };
+
+  std::mutex Mutex;
+  llvm::StringMap<Entry> Entries;
+};
+
+static llvm::ManagedStatic<CrossTUIndexCache> IndexCache;
 } // end anonymous namespace
 
 char IndexError::ID;
@@ -154,6 +185,32 @@ parseCrossTUIndex(StringRef IndexPath, StringRef CrossTUDir) {
   return Result;
 }
 
+llvm::Expected<std::shared_ptr<const CrossTUIndexCache::IndexTy>>
+CrossTUIndexCache::get(StringRef IndexPath, StringRef CrossTUDir) {
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(IndexPath, Status))
+    return llvm::make_error<IndexError>(index_error_code::missing_index_file,
+                                        IndexPath.str());
+  // The paths in the index are relative to CrossTUDir.
+  std::string Key = (Twine(IndexPath) + Twine('\0') + CrossTUDir).str();
+
+  std::lock_guard<std::mutex> Lock(Mutex);
+  auto It = Entries.find(Key);
+  if (It != Entries.end() &&
+      It->second.ModificationTime == Status.getLastModificationTime() &&
+      It->second.Size == Status.getSize()) {
+    ++NumIndexCacheHits;
+    return It->second.Index;
+  }
+
+  llvm::Expected<IndexTy> IndexOrErr = parseCrossTUIndex(IndexPath, CrossTUDir);
+  if (!IndexOrErr)
+    return IndexOrErr.takeError();
+  auto Index = std::make_shared<const IndexTy>(std::move(*IndexOrErr));
+  Entries[Key] = {Status.getLastModificationTime(), Status.getSize(), Index};
+  return Index;
+}
+
 std::string
 createCrossTUIndexString(const llvm::StringMap<std::string> &Index) {
   std::ostringstream Result;
@@ -184,7 +241,8 @@ template <typename T> static bool hasBodyOrInit(const T *D) {
 }
 
 CrossTranslationUnitContext::CrossTranslationUnitContext(CompilerInstance &CI)
-    : CI(CI), Context(CI.getASTContext()) {}
+    : CI(CI), Context(CI.getASTContext()),
+      CTULoadThreshold(CI.getAnalyzerOpts()->CTUImportThreshold) {}
 
 CrossTranslationUnitContext::~CrossTranslationUnitContext() {}
 
@@ -345,28 +403,35 @@ llvm::Expected<ASTUnit *> CrossTranslationUnitContext::loadExternalAST(
   ASTUnit *Unit = nullptr;
   auto NameUnitCacheEntry = NameASTUnitMap.find(LookupName);
   if (NameUnitCacheEntry == NameASTUnitMap.end()) {
-    if (NameFileMap.empty()) {
+    if (!NameFileMap) {
       SmallString<256> IndexFile = CrossTUDir;
       if (llvm::sys::path::is_absolute(IndexName))
         IndexFile = IndexName;
       else
         llvm::sys::path::append(IndexFile, IndexName);
-      llvm::Expected<llvm::StringMap<std::string>> IndexOrErr =
-          parseCrossTUIndex(IndexFile, CrossTUDir);
+      auto IndexOrErr = IndexCache->get(IndexFile, CrossTUDir);
       if (IndexOrErr)
-        NameFileMap = *IndexOrErr;
+        NameFileMap = std::move(*IndexOrErr);
       else
         return IndexOrErr.takeError();
     }
 
-    auto It = NameFileMap.find(LookupName);
-    if (It == NameFileMap.end()) {
+    auto It = NameFileMap->find(LookupName);
+    if (It == NameFileMap->end()) {
       ++NumNotInOtherTU;
       return llvm::make_error<IndexError>(index_error_code::missing_definition);
     }
     StringRef ASTFileName = It->second;
     auto ASTCacheEntry = FileASTUnitMap.find(ASTFileName);
     if (ASTCacheEntry == FileASTUnitMap.end()) {
+      // Loaded ASTs are kept until the end of the analysis, bound their
+      // number.
+      if (NumASTLoaded >= CTULoadThreshold) {
+        ++NumASTLoadThresholdReached;
+        return llvm::make_error<IndexError>(
+            index_error_code::load_threshold_reached);
+      }
+
       IntrusiveRefCntPtr<DiagnosticOptions> DiagOpts = new DiagnosticOptions();
       TextDiagnosticPrinter *DiagClient =
           new TextDiagnosticPrinter(llvm::errs(), &*DiagOpts);
@@ -379,6 +444,7 @@ llvm::Expected<ASTUnit *> CrossTranslationUnitContext::loadExternalAST(
           ASTUnit::LoadEverything, Diags, CI.getFileSystemOpts()));
       Unit = LoadedUnit.get();
       FileASTUnitMap[ASTFileName] = std::move(LoadedUnit);
+      ++NumASTLoaded;
       if (DisplayCTUProgress) {
         llvm::errs() << "CTU loaded AST file: "
                      << ASTFileName << "\n";
@@ -310,9 +310,18 @@ GenerateHeaderModuleAction::CreateOutputFile(CompilerInstance &CI,
 SyntaxOnlyAction::~SyntaxOnlyAction() {
 }
 
+namespace {
+/// The consumer of -fsyntax-only. It ignores all declarations, so there is no
+/// need to deserialize the ones that a PCH would otherwise load eagerly.
+class SyntaxOnlyConsumer : public ASTConsumer {
+public:
+  bool needsEagerlyDeserializedDecls() override { return false; }
+};
+} // end anonymous namespace
+
 std::unique_ptr<ASTConsumer>
 SyntaxOnlyAction::CreateASTConsumer(CompilerInstance &CI, StringRef InFile) {
-  return llvm::make_unique<ASTConsumer>();
+  return llvm::make_unique<SyntaxOnlyConsumer>();
 }
 
 std::unique_ptr<ASTConsumer>
@@ -345,6 +345,13 @@ void MultiplexConsumer::PrintStats() {
     Consumer->PrintStats();
 }
 
+bool MultiplexConsumer::needsEagerlyDeserializedDecls() {
+  for (auto &Consumer : Consumers)
+    if (Consumer->needsEagerlyDeserializedDecls())
+      return true;
+  return false;
+}
+
 bool MultiplexConsumer::shouldSkipFunctionBody(Decl *D) {
   bool Skip = true;
   for (auto &Consumer : Consumers)
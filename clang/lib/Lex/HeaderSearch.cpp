@@ -16,9 +16,11 @@
 #include "clang/Basic/IdentifierTable.h"
 #include "clang/Basic/Module.h"
 #include "clang/Basic/SourceManager.h"
+#include "clang/Basic/Version.h"
 #include "clang/Lex/DirectoryLookup.h"
 #include "clang/Lex/ExternalPreprocessorSource.h"
 #include "clang/Lex/HeaderMap.h"
+#include "clang/Lex/HeaderSearchCache.h"
 #include "clang/Lex/HeaderSearchOptions.h"
 #include "clang/Lex/LexDiagnostic.h"
 #include "clang/Lex/ModuleMap.h"
@@ -34,6 +36,7 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/VirtualFileSystem.h"
+#include "llvm/Support/xxhash.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
@@ -74,6 +77,8 @@ HeaderSearch::HeaderSearch(std::shared_ptr<HeaderSearchOptions> HSOpts,
       FileMgr(SourceMgr.getFileManager()), FrameworkMap(64),
       ModMap(SourceMgr, Diags, LangOpts, Target, *this) {}
 
+HeaderSearch::~HeaderSearch() = default;
+
 void HeaderSearch::PrintStats() {
   fprintf(stderr, "\n*** HeaderSearch Stats:\n");
   fprintf(stderr, "%d files tracked.\n", (int)FileInfo.size());
@@ -832,6 +837,8 @@ const FileEntry *HeaderSearch::LookupFile(
   // being relex/pp'd, but they would still have to search through a
   // (potentially huge) series of SearchDirs to find it.
   LookupFileCacheInfo &CacheLookup = LookupFileCache[Filename];
+  unsigned StartIdx = i;
+  bool AddToPersistentCache = false;
 
   // If the entry has been previously looked up, the first value will be
   // non-zero.  If the value is equal to i (the start point of our search), then
@@ -849,6 +856,17 @@ const FileEntry *HeaderSearch::LookupFile(
     // our search start.  We will fill in our found location below, so prime the
     // start point value.
     CacheLookup.reset(/*StartIdx=*/i+1);
+
+    // Another compilation may have done the same search already.
+    if (PersistentHeaderSearchCache *PC = SkipCache ? nullptr
+                                                    : getPersistentCache()) {
+      unsigned HitIdx;
+      if (PC->lookup(Filename, StartIdx, HitIdx) &&
+          HitIdx <= SearchDirs.size())
+        i = HitIdx;
+      else
+        AddToPersistentCache = true;
+    }
   }
 
   SmallString<64> MappedName;
@@ -922,6 +940,8 @@ const FileEntry *HeaderSearch::LookupFile(
 
     // Remember this location for the next lookup we do.
     CacheLookup.HitIdx = i;
+    if (AddToPersistentCache)
+      addToPersistentCache(Filename, StartIdx, i, FE);
     return FE;
   }
 
@@ -964,9 +984,59 @@ const FileEntry *HeaderSearch::LookupFile(
 
   // Otherwise, didn't find it. Remember we didn't find this.
   CacheLookup.HitIdx = SearchDirs.size();
+  if (AddToPersistentCache)
+    addToPersistentCache(Filename, StartIdx, SearchDirs.size(), nullptr);
   return nullptr;
 }
 
+PersistentHeaderSearchCache *HeaderSearch::getPersistentCache() {
+  if (PersistentCacheInitialized)
+    return PersistentCache.get();
+  PersistentCacheInitialized = true;
+
+  StringRef CachePath = HSOpts->HeaderSearchCachePath;
+  if (CachePath.empty())
+    return nullptr;
+
+  // Entries refer to search directories by index, so the cache is specific to
+  // the search path.
+  std::string SearchPath = getClangFullRepositoryVersion();
+  llvm::raw_string_ostream OS(SearchPath);
+  OS << '\0' << AngledDirIdx << '\0' << SystemDirIdx << '\0';
+  for (const DirectoryLookup &DL : SearchDirs)
+    OS << DL.getLookupType() << DL.getName() << '\0';
+  OS.flush();
+  PersistentCache = llvm::make_unique<PersistentHeaderSearchCache>(
+      CachePath, llvm::xxHash64(SearchPath));
+  return PersistentCache.get();
+}
+
+void HeaderSearch::addToPersistentCache(StringRef Filename, unsigned StartIdx,
+                                        unsigned HitIdx, const FileEntry *FE) {
+  // Only lookups in normal directories are replayed. Header maps and
+  // frameworks can map the file name, and their contents aren't covered by
+  // the directory stamps.
+  if (FE && !SearchDirs[HitIdx].isNormalDir())
+    return;
+
+  std::vector<std::string> SearchedDirs;
+  for (unsigned I = StartIdx; I != HitIdx; ++I) {
+    if (!SearchDirs[I].isNormalDir())
+      return;
+    SmallString<256> Path(SearchDirs[I].getDir()->getName());
+    llvm::sys::path::append(Path, Filename);
+    SearchedDirs.push_back(llvm::sys::path::parent_path(Path));
+  }
+
+  PersistentCache->insert(Filename, StartIdx, HitIdx, SearchedDirs,
+                          FE ? FE->getName() : StringRef());
+}
+
+void HeaderSearch::writePersistentCache() {
+  if (PersistentCache)
+    PersistentCache->write();
+}
+
 /// LookupSubframeworkHeader - Look up a subframework for the specified
 /// \#include file.  For example, if \#include'ing <HIToolbox/HIToolbox.h> from
 /// within ".../Carbon.framework/Headers/Carbon.h", check to see if HIToolbox
@@ -0,0 +1,188 @@
+//===- HeaderSearchCache.cpp - Persistent header search cache -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the PersistentHeaderSearchCache class.
+//
+// The cache file starts with a magic string followed by the entries. Every
+// field of an entry is terminated by a null character:
+//
+//   key hit-index directory-count (directory stamp)* file stamp
+//
+// where the key is the start index and the spelled file name, and a stamp is
+// the identity of a file or directory as returned by getStamp().
+//
+//===----------------------------------------------------------------------===//
+
+#include "clang/Lex/HeaderSearchCache.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace clang;
+
+static const char CacheMagic[] = "clang-header-search-cache-v1\n";
+
+/// Removes the next null terminated field from \p Buf and stores it in
+/// \p Field.
+static bool readField(StringRef &Buf, StringRef &Field) {
+  size_t End = Buf.find('\0');
+  if (End == StringRef::npos)
+    return false;
+  Field = Buf.substr(0, End);
+  Buf = Buf.substr(End + 1);
+  return true;
+}
+
+/// Splits the contents of a cache file into keys and entries, and adds the
+/// ones that aren't in \p Entries yet. Stops at the first malformed entry.
+static void parseEntries(StringRef Buf, llvm::StringMap<StringRef> &Entries) {
+  if (!Buf.consume_front(CacheMagic))
+    return;
+
+  while (!Buf.empty()) {
+    StringRef Key, HitIdx, NumDirs, Field;
+    StringRef Entry = Buf;
+    if (!readField(Entry, Key))
+      return;
+    Buf = Entry;
+    unsigned N;
+    if (!readField(Buf, HitIdx) || !readField(Buf, NumDirs) ||
+        NumDirs.getAsInteger(10, N))
+      return;
+    for (unsigned I = 0; I != 2 * N + 2; ++I)
+      if (!readField(Buf, Field))
+        return;
+    Entries.try_emplace(Key, Entry.take_front(Entry.size() - Buf.size()));
+  }
+}
+
+PersistentHeaderSearchCache::PersistentHeaderSearchCache(
+    StringRef CachePath, uint64_t SearchPathHash) {
+  SmallString<128> Path(CachePath);
+  llvm::sys::path::append(Path, "headers-" + llvm::utohexstr(SearchPathHash));
+  CacheFile = Path.str();
+}
+
+PersistentHeaderSearchCache::~PersistentHeaderSearchCache() = default;
+
+void PersistentHeaderSearchCache::load() {
+  Loaded = true;
+  auto BufOrErr = llvm::MemoryBuffer::getFile(
+      CacheFile, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    return;
+  Buffers.push_back(std::move(*BufOrErr));
+  parseEntries(Buffers.back()->getBuffer(), Entries);
+}
+
+StringRef PersistentHeaderSearchCache::getStamp(StringRef Path) {
+  auto Result = Stamps.try_emplace(Path);
+  std::string &Stamp = Result.first->second;
+  if (!Result.second)
+    return Stamp;
+
+  llvm::sys::fs::file_status Status;
+  if (llvm::sys::fs::status(Path, Status)) {
+    Stamp = "-";
+    return Stamp;
+  }
+  llvm::sys::fs::UniqueID ID = Status.getUniqueID();
+  llvm::raw_string_ostream OS(Stamp);
+  OS << llvm::utohexstr(ID.getDevice()) << ':'
+     << llvm::utohexstr(ID.getFile()) << ':'
+     << llvm::utohexstr(
+            Status.getLastModificationTime().time_since_epoch().count())
+     << ':' << llvm::utohexstr(Status.getSize());
+  OS.flush();
+  return Stamp;
+}
+
+bool PersistentHeaderSearchCache::lookup(StringRef Filename, unsigned StartIdx,
+                                         unsigned &HitIdx) {
+  if (!Loaded)
+    load();
+
+  auto It = Entries.find((Twine(StartIdx) + ":" + Filename).str());
+  if (It == Entries.end())
+    return false;
+
+  StringRef Buf = It->second;
+  StringRef HitIdxStr, NumDirsStr, Path, Stamp;
+  unsigned NumDirs;
+  readField(Buf, HitIdxStr);
+  readField(Buf, NumDirsStr);
+  if (HitIdxStr.getAsInteger(10, HitIdx) ||
+      NumDirsStr.getAsInteger(10, NumDirs))
+    return false;
+
+  // The directories and the file that is found come in the same format, so
+  // all of them are checked by the same loop.
+  for (unsigned I = 0; I != NumDirs + 1; ++I) {
+    readField(Buf, Path);
+    readField(Buf, Stamp);
+    if (!Path.empty() && getStamp(Path) != Stamp)
+      return false;
+  }
+  return true;
+}
+
+void PersistentHeaderSearchCache::insert(StringRef Filename, unsigned StartIdx,
+                                         unsigned HitIdx,
+                                         ArrayRef<std::string> SearchedDirs,
+                                         StringRef File) {
+  if (!Loaded)
+    load();
+
+  auto Entry = llvm::make_unique<std::string>();
+  llvm::raw_string_ostream OS(*Entry);
+  OS << HitIdx << '\0' << SearchedDirs.size() << '\0';
+  for (StringRef Dir : SearchedDirs)
+    OS << Dir << '\0' << getStamp(Dir) << '\0';
+  OS << File << '\0' << (File.empty() ? StringRef() : getStamp(File)) << '\0';
+  OS.flush();
+
+  Entries[(Twine(StartIdx) + ":" + Filename).str()] = *Entry;
+  NewEntries.push_back(std::move(Entry));
+}
+
+void PersistentHeaderSearchCache::write() {
+  if (NewEntries.empty())
+    return;
+
+  // Other compilations may have updated the cache since it was loaded. Merge
+  // their entries, so that concurrent builds don't keep dropping each
+  // other's results.
+  load();
+
+  StringRef CacheDir = llvm::sys::path::parent_path(CacheFile);
+  if (llvm::sys::fs::create_directories(CacheDir))
+    return;
+
+  // Write to a temporary file first, so that readers never see a partially
+  // written cache.
+  int FD;
+  SmallString<128> TempPath;
+  if (llvm::sys::fs::createUniqueFile(CacheFile + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    llvm::raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << CacheMagic;
+    for (const auto &Entry : Entries)
+      OS << Entry.first() << '\0' << Entry.second;
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      llvm::sys::fs::remove(TempPath);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(TempPath, CacheFile))
+    llvm::sys::fs::remove(TempPath);
+}
@@ -2695,6 +2695,80 @@ void Lexer::ReadToEndOfLine(SmallVectorImpl<char> *Result) {
   }
 }
 
+/// Returns true if C may start something that the fast skipping of excluded
+/// lines can't step over: a directive (# or the %: and ??= spellings of it),
+/// a comment, a literal that may span lines, an escaped newline, or a null
+/// character marking the end of the buffer or a code completion point.
+static bool isExcludedLineStop(char C) {
+  switch (C) {
+  case '\0':
+  case '#':
+  case '%':
+  case '?':
+  case '/':
+  case '\\':
+  case '"':
+  case '\'':
+    return true;
+  default:
+    return false;
+  }
+}
+
+/// Returns the first character in [CurPtr, BufferEnd] for which
+/// isExcludedLineStop is true. The buffer is null terminated, so there is one.
+static const char *findExcludedLineStop(const char *CurPtr,
+                                        const char *BufferEnd) {
+#ifdef __SSE2__
+  const __m128i Stops[] = {
+      _mm_set1_epi8('\0'), _mm_set1_epi8('#'),  _mm_set1_epi8('%'),
+      _mm_set1_epi8('?'),  _mm_set1_epi8('/'),  _mm_set1_epi8('\\'),
+      _mm_set1_epi8('"'),  _mm_set1_epi8('\'')};
+  while (CurPtr + 16 <= BufferEnd) {
+    __m128i Chars = _mm_loadu_si128((const __m128i *)CurPtr);
+    __m128i Match = _mm_setzero_si128();
+    for (const __m128i &Stop : Stops)
+      Match = _mm_or_si128(Match, _mm_cmpeq_epi8(Chars, Stop));
+    if (int Mask = _mm_movemask_epi8(Match))
+      return CurPtr + llvm::countTrailingZeros<unsigned>(Mask);
+    CurPtr += 16;
+  }
+#endif
+  while (!isExcludedLineStop(*CurPtr))
+    ++CurPtr;
+  return CurPtr;
+}
+
+void Lexer::SkipExcludedLines(const char *&ScanLimit) {
+  // Don't scan again until the lexer has consumed the character that stopped
+  // the previous scan, so that every character is scanned once.
+  if (BufferPtr <= ScanLimit)
+    return;
+
+  // The end of a conflict marker is recognized at the start of a line, so we
+  // can't jump over it.
+  if (CurrentConflictMarkerState)
+    return;
+
+  const char *Stop = findExcludedLineStop(BufferPtr, BufferEnd);
+  ScanLimit = Stop;
+
+  // Resume lexing at the start of the line containing Stop. Every line before
+  // it consists of plain tokens, so it can't contain a directive or begin
+  // anything that spans lines.
+  const char *LineStart = Stop;
+  while (LineStart != BufferPtr && LineStart[-1] != '\n' &&
+         LineStart[-1] != '\r')
+    --LineStart;
+  if (LineStart == BufferPtr)
+    return;
+
+  BufferPtr = LineStart;
+  IsAtStartOfLine = true;
+  IsAtPhysicalStartOfLine = true;
+  HasLeadingSpace = false;
+}
+
 /// LexEndOfFile - CurPtr points to the end of this file.  Handle this
 /// condition, reporting diagnostics and handling other edge cases as required.
 /// This returns true if Result contains a token, false if PP.Lex should be
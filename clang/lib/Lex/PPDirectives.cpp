@@ -395,7 +395,11 @@ void Preprocessor::SkipExcludedConditionalBlock(SourceLocation HashTokenLoc,
   // disabling warnings, etc.
   CurPPLexer->LexingRawMode = true;
   Token Tok;
+  const char *ScanLimit = nullptr;
   while (true) {
+    // Jump over the lines that can't contain a directive instead of lexing
+    // every token in them.
+    CurLexer->SkipExcludedLines(ScanLimit);
     CurLexer->Lex(Tok);
 
     if (Tok.is(tok::code_completion)) {
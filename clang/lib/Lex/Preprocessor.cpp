@@ -680,6 +680,8 @@ void Preprocessor::EndSourceFile() {
   // Notify the client that we reached the end of the source file.
   if (Callbacks)
     Callbacks->EndOfMainFile();
+
+  HeaderInfo.writePersistentCache();
 }
 
 //===----------------------------------------------------------------------===//
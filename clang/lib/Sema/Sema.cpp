@@ -949,6 +949,21 @@ void Sema::ActOnEndOfTranslationUnit() {
                                  LateParsedInstantiations.begin(),
                                  LateParsedInstantiations.end());
     LateParsedInstantiations.clear();
+
+    // Perform the implicit instantiations now if requested, so that they are
+    // stored in the PCH and every translation unit that uses it finds the
+    // instantiated definitions instead of instantiating them again.
+    if (LangOpts.PCHInstantiateTemplates) {
+      llvm::TimeTraceScope TimeScope("PerformPendingInstantiations",
+                                     StringRef(""));
+      PerformPendingInstantiations();
+
+      // Instantiations of templates that aren't defined yet stay pending.
+      PendingInstantiations.insert(PendingInstantiations.end(),
+                                   LateParsedInstantiations.begin(),
+                                   LateParsedInstantiations.end());
+      LateParsedInstantiations.clear();
+    }
   }
 
   DiagnoseUnterminatedPragmaPack();
@@ -4143,7 +4143,13 @@ void Sema::InstantiateFunctionDefinition(SourceLocation PointOfInstantiation,
       PendingInstantiations.push_back(
         std::make_pair(Function, PointOfInstantiation));
     } else if (TSK == TSK_ImplicitInstantiation) {
-      if (AtEndOfTU && !getDiagnostics().hasErrorOccurred() &&
+      if (AtEndOfTU && TUKind == TU_Prefix) {
+        // The definition may still follow in a translation unit that uses
+        // this PCH, so leave the instantiation to it.
+        Function->setInstantiationIsPending(true);
+        LateParsedInstantiations.push_back(
+            std::make_pair(Function, PointOfInstantiation));
+      } else if (AtEndOfTU && !getDiagnostics().hasErrorOccurred() &&
           !getSourceManager().isInSystemHeader(PatternDecl->getBeginLoc())) {
         Diag(PointOfInstantiation, diag::warn_func_template_missing)
           << Function;
@@ -4698,8 +4704,13 @@ void Sema::InstantiateVariableDefinition(SourceLocation PointOfInstantiation,
       PendingInstantiations.push_back(
         std::make_pair(Var, PointOfInstantiation));
     } else if (TSK == TSK_ImplicitInstantiation) {
-      // Warn about missing definition at the end of translation unit.
-      if (AtEndOfTU && !getDiagnostics().hasErrorOccurred() &&
+      // Warn about missing definition at the end of translation unit. When
+      // building a PCH, leave the instantiation to the translation units
+      // that use it instead, since the definition may follow there.
+      if (AtEndOfTU && TUKind == TU_Prefix) {
+        LateParsedInstantiations.push_back(
+            std::make_pair(Var, PointOfInstantiation));
+      } else if (AtEndOfTU && !getDiagnostics().hasErrorOccurred() &&
           !getSourceManager().isInSystemHeader(PatternDecl->getBeginLoc())) {
         Diag(PointOfInstantiation, diag::warn_var_template_missing)
           << Var;
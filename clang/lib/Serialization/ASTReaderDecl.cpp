@@ -4000,9 +4000,10 @@ void ASTReader::PassInterestingDeclsToConsumer() {
                                                    true);
 
   // Ensure that we've loaded all potentially-interesting declarations
-  // that need to be eagerly loaded.
-  for (auto ID : EagerlyDeserializedDecls)
-    GetDecl(ID);
+  // that need to be eagerly loaded, unless the consumer would ignore them.
+  if (Consumer->needsEagerlyDeserializedDecls())
+    for (auto ID : EagerlyDeserializedDecls)
+      GetDecl(ID);
   EagerlyDeserializedDecls.clear();
 
   while (!PotentiallyInterestingDecls.empty()) {
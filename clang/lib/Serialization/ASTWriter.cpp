@@ -94,6 +94,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/SHA1.h"
 #include "llvm/Support/VersionTuple.h"
@@ -2198,28 +2199,56 @@ void ASTWriter::WriteHeaderSearch(const HeaderSearch &HS) {
     free(const_cast<char *>(SavedStrings[I]));
 }
 
-static void emitBlob(llvm::BitstreamWriter &Stream, StringRef Blob,
-                     unsigned SLocBufferBlobCompressedAbbrv,
-                     unsigned SLocBufferBlobAbbrv) {
-  using RecordDataType = ASTWriter::RecordData::value_type;
+namespace {
+
+/// The contents of a buffer that is embedded in the source manager block.
+struct SLocBufferBlob {
+  /// The contents, including the terminating null character.
+  StringRef Blob;
+
+  /// The compressed contents, without the null character, if compression
+  /// succeeded.
+  SmallString<0> CompressedBuffer;
+  bool IsCompressed = false;
+};
 
+} // namespace
+
+static void compressBlob(SLocBufferBlob &B) {
   // Compress the buffer if possible. We expect that almost all PCM
   // consumers will not want its contents.
-  SmallString<0> CompressedBuffer;
-  if (llvm::zlib::isAvailable()) {
-    llvm::Error E = llvm::zlib::compress(Blob.drop_back(1), CompressedBuffer);
-    if (!E) {
-      RecordDataType Record[] = {SM_SLOC_BUFFER_BLOB_COMPRESSED,
-                                 Blob.size() - 1};
-      Stream.EmitRecordWithBlob(SLocBufferBlobCompressedAbbrv, Record,
-                                CompressedBuffer);
-      return;
-    }
+  if (!llvm::zlib::isAvailable())
+    return;
+  llvm::Error E = llvm::zlib::compress(B.Blob.drop_back(1), B.CompressedBuffer);
+  if (E) {
     llvm::consumeError(std::move(E));
+    return;
+  }
+  B.IsCompressed = true;
+}
+
+static void emitBlob(llvm::BitstreamWriter &Stream, const SLocBufferBlob &B,
+                     unsigned SLocBufferBlobCompressedAbbrv,
+                     unsigned SLocBufferBlobAbbrv) {
+  using RecordDataType = ASTWriter::RecordData::value_type;
+
+  if (B.IsCompressed) {
+    RecordDataType Record[] = {SM_SLOC_BUFFER_BLOB_COMPRESSED,
+                               B.Blob.size() - 1};
+    Stream.EmitRecordWithBlob(SLocBufferBlobCompressedAbbrv, Record,
+                              B.CompressedBuffer);
+    return;
   }
 
   RecordDataType Record[] = {SM_SLOC_BUFFER_BLOB};
-  Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record, Blob);
+  Stream.EmitRecordWithBlob(SLocBufferBlobAbbrv, Record, B.Blob);
+}
+
+/// Returns true if the contents of \p Content are embedded in the AST file.
+static bool shouldEmitBlob(const SrcMgr::ContentCache *Content) {
+  if (!Content->OrigEntry)
+    return true;
+  return Content->BufferOverridden || Content->IsTransient;
 }
 
 /// Writes the block containing the serialized form of the
@@ -2245,6 +2274,29 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
       CreateSLocBufferBlobAbbrev(Stream, true);
   unsigned SLocExpansionAbbrv = CreateSLocExpansionAbbrev(Stream);
 
+  // Compress the embedded buffers up front. The buffers are independent, so
+  // they are compressed in parallel, which matters for modules built with
+  // -fmodules-embed-all-files. They are emitted in the same order below.
+  std::vector<SLocBufferBlob> Blobs;
+  for (unsigned I = 1, N = SourceMgr.local_sloc_entry_size(); I != N; ++I) {
+    const SrcMgr::SLocEntry &SLoc = SourceMgr.getLocalSLocEntry(I);
+    if (!SLoc.isFile())
+      continue;
+    const SrcMgr::ContentCache *Content = SLoc.getFile().getContentCache();
+    if (!shouldEmitBlob(Content))
+      continue;
+    // Include the implicit terminating null character in the on-disk buffer
+    // if we're writing it uncompressed.
+    const llvm::MemoryBuffer *Buffer =
+        Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
+    Blobs.emplace_back();
+    Blobs.back().Blob =
+        StringRef(Buffer->getBufferStart(), Buffer->getBufferSize() + 1);
+  }
+  llvm::parallel::for_each(llvm::parallel::par, Blobs.begin(), Blobs.end(),
+                           compressBlob);
+  auto NextBlob = Blobs.begin();
+
   // Write out the source location entry table. We skip the first
   // entry, which is always the same dummy entry.
   std::vector<uint32_t> SLocEntryOffsets;
@@ -2282,7 +2334,6 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
       Record.push_back(File.hasLineDirectives());
 
       const SrcMgr::ContentCache *Content = File.getContentCache();
-      bool EmitBlob = false;
       if (Content->OrigEntry) {
         assert(Content->OrigEntry == Content->ContentsEntry &&
                "Writing to AST an overridden file is not supported");
@@ -2303,9 +2354,6 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
         }
 
         Stream.EmitRecordWithAbbrev(SLocFileAbbrv, Record);
-
-        if (Content->BufferOverridden || Content->IsTransient)
-          EmitBlob = true;
       } else {
         // The source location entry is a buffer. The blob associated
         // with this entry contains the contents of the buffer.
@@ -2318,19 +2366,14 @@ void ASTWriter::WriteSourceManagerBlock(SourceManager &SourceMgr,
         StringRef Name = Buffer->getBufferIdentifier();
         Stream.EmitRecordWithBlob(SLocBufferAbbrv, Record,
                                   StringRef(Name.data(), Name.size() + 1));
-        EmitBlob = true;
 
         if (Name == "<built-in>")
           PreloadSLocs.push_back(SLocEntryOffsets.size());
       }
 
-      if (EmitBlob) {
-        // Include the implicit terminating null character in the on-disk buffer
-        // if we're writing it uncompressed.
-        const llvm::MemoryBuffer *Buffer =
-            Content->getBuffer(PP.getDiagnostics(), PP.getSourceManager());
-        StringRef Blob(Buffer->getBufferStart(), Buffer->getBufferSize() + 1);
-        emitBlob(Stream, Blob, SLocBufferBlobCompressedAbbrv,
+      if (shouldEmitBlob(Content)) {
+        assert(NextBlob != Blobs.end() && "Missed buffer");
+        emitBlob(Stream, *NextBlob++, SLocBufferBlobCompressedAbbrv,
                  SLocBufferBlobAbbrv);
       }
     } else {
@@ -31,6 +31,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TimeProfiler.h"
 #include <cstdio>
+#include <functional>
 using namespace clang;
 using namespace serialization;
 
@@ -457,6 +458,29 @@ namespace {
     /// Load the contents of the given module file into the builder.
     llvm::Error loadModuleFile(const FileEntry *File);
 
+    /// Add a module file whose contents are known from an existing index,
+    /// without loading it. Its identifiers are added with addIdentifier().
+    void addIndexedModuleFile(const FileEntry *File,
+                              ArrayRef<const FileEntry *> Dependencies) {
+      getModuleFileInfo(File);
+      for (const FileEntry *DependsOnFile : Dependencies) {
+        unsigned DependsOnID = getModuleFileInfo(DependsOnFile).ID;
+        getModuleFileInfo(File).Dependencies.push_back(DependsOnID);
+      }
+    }
+
+    /// Retrieve the ID that the index assigns to the given module file.
+    unsigned getModuleFileID(const FileEntry *File) {
+      return getModuleFileInfo(File).ID;
+    }
+
+    /// Record that the given module files consider the identifier
+    /// interesting, or just that the identifier exists if there are none.
+    void addIdentifier(StringRef Name, ArrayRef<unsigned> IDs) {
+      SmallVectorImpl<unsigned> &Known = InterestingIdentifiers[Name];
+      Known.append(IDs.begin(), IDs.end());
+    }
+
     /// Write the index to the given bitstream.
     /// \returns true if an error occurred, false otherwise.
     bool writeIndex(llvm::BitstreamWriter &Stream);
@@ -876,7 +900,8 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
   // The module index builder.
   GlobalModuleIndexBuilder Builder(FileMgr, PCHContainerRdr);
 
-  // Load each of the module files.
+  // Find the module files.
+  std::vector<const FileEntry *> ModuleFiles;
   std::error_code EC;
   for (llvm::sys::fs::directory_iterator D(Path, EC), DEnd;
        D != DEnd && !EC;
@@ -894,15 +919,84 @@ GlobalModuleIndex::writeIndex(FileManager &FileMgr,
     }
 
     // If we can't find the module file, skip it.
-    const FileEntry *ModuleFile = FileMgr.getFile(D->path());
-    if (!ModuleFile)
+    if (const FileEntry *ModuleFile = FileMgr.getFile(D->path()))
+      ModuleFiles.push_back(ModuleFile);
+  }
+
+  // Determine which module files are still described correctly by the
+  // existing index: those that haven't changed since it was written, and
+  // whose dependencies haven't either.
+  std::unique_ptr<GlobalModuleIndex> OldIndex;
+  {
+    auto Result = readIndex(Path);
+    OldIndex.reset(Result.first);
+    llvm::consumeError(std::move(Result.second));
+  }
+  llvm::DenseMap<const FileEntry *, unsigned> OldIDs;
+  std::vector<const FileEntry *> OldFiles;
+  if (OldIndex) {
+    OldFiles.resize(OldIndex->Modules.size());
+    for (unsigned ID = 0, N = OldIndex->Modules.size(); ID != N; ++ID) {
+      const ModuleInfo &Info = OldIndex->Modules[ID];
+      if (Info.FileName.empty())
+        continue;
+      const FileEntry *File = FileMgr.getFile(Info.FileName);
+      if (File && File->getSize() == Info.Size &&
+          File->getModificationTime() == Info.ModTime) {
+        OldFiles[ID] = File;
+        OldIDs[File] = ID;
+      }
+    }
+  }
+
+  enum ReuseState { Unknown, Visiting, Reused, NotReused };
+  std::vector<ReuseState> States(OldFiles.size(), Unknown);
+  std::function<bool(unsigned)> CanReuse = [&](unsigned ID) {
+    if (States[ID] == Unknown) {
+      States[ID] = Visiting;
+      bool Result = OldFiles[ID] != nullptr;
+      for (unsigned Dep : OldIndex->Modules[ID].Dependencies)
+        Result = Result && Dep < OldFiles.size() && CanReuse(Dep);
+      States[ID] = Result ? Reused : NotReused;
+    }
+    return States[ID] == Reused;
+  };
+
+  // Load each of the module files that the existing index can't describe.
+  for (const FileEntry *ModuleFile : ModuleFiles) {
+    auto Known = OldIDs.find(ModuleFile);
+    if (Known != OldIDs.end() && CanReuse(Known->second)) {
+      SmallVector<const FileEntry *, 4> Dependencies;
+      for (unsigned Dep : OldIndex->Modules[Known->second].Dependencies)
+        Dependencies.push_back(OldFiles[Dep]);
+      Builder.addIndexedModuleFile(ModuleFile, Dependencies);
       continue;
+    }
 
-    // Load this module file.
     if (llvm::Error Err = Builder.loadModuleFile(ModuleFile))
       return Err;
   }
 
+  // Copy the identifiers of the reused module files from the existing index.
+  if (OldIndex && OldIndex->IdentifierIndex) {
+    std::vector<int> NewIDs(OldFiles.size(), -1);
+    for (unsigned ID = 0, N = OldFiles.size(); ID != N; ++ID)
+      if (States[ID] == Reused)
+        NewIDs[ID] = Builder.getModuleFileID(OldFiles[ID]);
+
+    IdentifierIndexTable &Table =
+        *static_cast<IdentifierIndexTable *>(OldIndex->IdentifierIndex);
+    SmallVector<unsigned, 2> IDs;
+    for (auto Key = Table.key_begin(), KeyEnd = Table.key_end();
+         Key != KeyEnd; ++Key) {
+      IDs.clear();
+      for (unsigned ID : *Table.find(*Key))
+        if (ID < NewIDs.size() && NewIDs[ID] >= 0)
+          IDs.push_back(NewIDs[ID]);
+      Builder.addIdentifier(*Key, IDs);
+    }
+  }
+
   // The output buffer, into which the global index will be written.
   SmallVector<char, 16> OutputBuffer;
   {
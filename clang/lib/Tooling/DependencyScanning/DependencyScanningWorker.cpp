@@ -115,12 +115,17 @@ private:
 
 } // end anonymous namespace
 
-DependencyScanningWorker::DependencyScanningWorker() {
+DependencyScanningWorker::DependencyScanningWorker(
+    DependencyScanningService &Service) {
   DiagOpts = new DiagnosticOptions();
   PCHContainerOps = std::make_shared<PCHContainerOperations>();
-  /// FIXME: Use the shared file system from the service for fast scanning
-  /// mode.
   WorkerFS = new ProxyFileSystemWithoutChdir(llvm::vfs::getRealFileSystem());
+  // In the fast scanning mode, files are read through the cache of the
+  // service, which is shared by all workers. The working directory is still
+  // tracked by the proxy without calling chdir.
+  if (Service.getMode() == ScanningMode::MinimizedSourcePreprocessing)
+    WorkerFS = new DependencyScanningWorkerFilesystem(Service.getSharedCache(),
+                                                      WorkerFS);
 }
 
 llvm::Expected<std::string>
@@ -0,0 +1,26 @@
+// REQUIRES: shell
+// RUN: %clangxx -S -ftime-trace-summary -o %T/check-time-trace-summary %s
+// RUN: cat %T/check-time-trace-summary.time-summary.json \
+// RUN:   | %python -c 'import json, sys; json.dump(json.loads(sys.stdin.read()), sys.stdout, sort_keys=True, indent=2)' \
+// RUN:   | FileCheck %s
+// RUN: not test -e %T/check-time-trace-summary.json
+
+// CHECK: "summary": [
+// CHECK: "count":
+// CHECK-NEXT: "detail":
+// CHECK-NEXT: "name":
+// CHECK-NEXT: "self":
+// CHECK-NEXT: "total":
+// CHECK: "detail": "Struct<int>"
+// CHECK-NEXT: "name": "InstantiateClass"
+
+template <typename T>
+struct Struct {
+  T Num;
+};
+
+int main() {
+  Struct<int> S;
+
+  return 0;
+}
@@ -0,0 +1,25 @@
+// -fsyntax-only doesn't deserialize the definitions that must be emitted, but
+// code generation still sees them.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x c++ -emit-pch %s -o %t
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -fsyntax-only -verify %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+
+#ifndef HEADER
+#define HEADER
+
+int f() { return 1; }
+int g = f();
+
+#else
+
+// expected-no-diagnostics
+
+int h() { return f() + g; }
+
+// CHECK-DAG: @g = global i32 0
+// CHECK-DAG: define {{.*}}i32 @_Z1fv()
+// CHECK-DAG: define {{.*}}i32 @_Z1hv()
+
+#endif
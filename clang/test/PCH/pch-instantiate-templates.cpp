@@ -0,0 +1,38 @@
+// With -fpch-instantiate-templates, the templates used by the PCH are
+// instantiated while building it, so errors in them are reported there.
+// RUN: %clang_cc1 -x c++-header -emit-pch -o %t.pch %s -DERROR
+// RUN: not %clang_cc1 -x c++-header -emit-pch -fpch-instantiate-templates \
+// RUN:   -o %t.pch %s -DERROR 2>&1 | FileCheck --check-prefix=ERROR %s
+
+// Instantiations of templates that are only defined after the PCH are left
+// to the translation units that use it.
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -x c++-header -emit-pch \
+// RUN:   -fpch-instantiate-templates -o %t.pch %s
+// RUN: %clang_cc1 -triple x86_64-unknown-linux-gnu -include-pch %t.pch \
+// RUN:   -emit-llvm -o - %s | FileCheck %s
+
+#ifndef HEADER
+#define HEADER
+
+#ifdef ERROR
+template <typename T> int bad(T t) { return t.error; }
+inline int use_bad() { return bad(1); }
+// ERROR: error: member reference base type 'int' is not a structure or union
+#endif
+
+template <typename T> T twice(T t) { return t + t; }
+inline int use_twice() { return twice(1); }
+
+template <typename T> T later(T t);
+inline int use_later() { return later(1); }
+
+#else
+
+template <typename T> T later(T t) { return t; }
+
+int main() { return use_twice() + use_later(); }
+
+// CHECK-DAG: define linkonce_odr {{.*}}i32 @_Z5twiceIiET_S0_(
+// CHECK-DAG: define linkonce_odr {{.*}}i32 @_Z5laterIiET_S0_(
+
+#endif
@@ -0,0 +1,20 @@
+// RUN: rm -rf %t && mkdir -p %t/a %t/b %t/cache
+// RUN: echo 'int from_b;' > %t/b/h.h
+// RUN: %clang_cc1 -E -I %t/a -I %t/b -fheader-search-cache-path=%t/cache %s \
+// RUN:   | FileCheck --check-prefix=CHECK-B %s
+// RUN: ls %t/cache | FileCheck --check-prefix=CHECK-FILE %s
+
+// The cached result is replayed by the next compilation.
+// RUN: %clang_cc1 -E -I %t/a -I %t/b -fheader-search-cache-path=%t/cache %s \
+// RUN:   | FileCheck --check-prefix=CHECK-B %s
+
+// Adding a header to an earlier search directory invalidates it.
+// RUN: echo 'int from_a;' > %t/a/h.h
+// RUN: %clang_cc1 -E -I %t/a -I %t/b -fheader-search-cache-path=%t/cache %s \
+// RUN:   | FileCheck --check-prefix=CHECK-A %s
+
+#include "h.h"
+
+// CHECK-B: int from_b;
+// CHECK-A: int from_a;
+// CHECK-FILE: headers-
@@ -216,8 +216,9 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   bool Success = CompilerInvocation::CreateFromArgs(
       Clang->getInvocation(), Argv.begin(), Argv.end(), Diags);
 
-  if (Clang->getFrontendOpts().TimeTrace)
-    llvm::timeTraceProfilerInitialize();
+  if (Clang->getFrontendOpts().TimeTrace ||
+      Clang->getFrontendOpts().TimeTraceSummary)
+    llvm::timeTraceProfilerInitialize("clang");
 
   // --print-supported-cpus takes priority over the actual compilation.
   if (Clang->getFrontendOpts().PrintSupportedCPUs)
@@ -253,7 +254,7 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
   // results now.  This happens in -disable-free mode.
   llvm::TimerGroup::printAll(llvm::errs());
 
-  if (llvm::timeTraceProfilerEnabled()) {
+  if (llvm::timeTraceProfilerEnabled() && Clang->getFrontendOpts().TimeTrace) {
     SmallString<128> Path(Clang->getFrontendOpts().OutputFile);
     llvm::sys::path::replace_extension(Path, "json");
     auto profilerOutput =
@@ -266,7 +267,6 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
     llvm::timeTraceProfilerWrite(*profilerOutput);
     // FIXME(ibiryukov): make profilerOutput flush in destructor instead.
     profilerOutput->flush();
-    llvm::timeTraceProfilerCleanup();
 
     llvm::errs() << "Time trace json-file dumped to " << Path.str() << "\n";
     llvm::errs()
@@ -274,6 +274,28 @@ int cc1_main(ArrayRef<const char *> Argv, const char *Argv0, void *MainAddr) {
            "(https://www.speedscope.app) for flamegraph visualization\n";
   }
 
+  if (llvm::timeTraceProfilerEnabled() &&
+      Clang->getFrontendOpts().TimeTraceSummary) {
+    SmallString<128> Path(Clang->getFrontendOpts().OutputFile);
+    llvm::sys::path::replace_extension(Path, "time-summary.json");
+    auto SummaryOutput =
+        Clang->createOutputFile(Path.str(),
+                                /*Binary=*/false,
+                                /*RemoveFileOnSignal=*/false, "",
+                                /*Extension=*/"time-summary.json",
+                                /*useTemporary=*/false);
+
+    llvm::timeTraceProfilerWriteSummary(*SummaryOutput);
+    SummaryOutput->flush();
+
+    llvm::errs() << "Time trace summary dumped to " << Path.str() << "\n";
+    llvm::errs() << "Use clang/utils/merge-time-trace-summaries.py to merge "
+                    "the summaries of several compilations\n";
+  }
+
+  if (llvm::timeTraceProfilerEnabled())
+    llvm::timeTraceProfilerCleanup();
+
   // Our error handler depends on the Diagnostics object, which we're
   // potentially about to delete. Uninstall the handler now so that any
   // later errors use the default handling behavior instead.
@@ -0,0 +1,86 @@
+#!/usr/bin/env python
+#
+#===- merge-time-trace-summaries.py - Merge -ftime-trace-summary files ----===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+
+"""Merges the .time-summary.json files written by clang -ftime-trace-summary.
+
+The entries with the same name and detail, e.g. all inclusions of a header or
+all instantiations of a template specialization in a build, are added up. The
+result is printed as a table sorted by total time, or written as a summary
+file with the same format as the inputs.
+
+Example:
+  merge-time-trace-summaries.py -name Source -top 20 build/**/*.time-summary.json
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import sys
+
+
+def merge(paths):
+    merged = {}
+    for path in paths:
+        with open(path) as f:
+            summary = json.load(f)['summary']
+        for entry in summary:
+            key = (entry['name'], entry['detail'])
+            m = merged.setdefault(key, {'count': 0, 'total': 0, 'self': 0,
+                                        'files': 0})
+            m['count'] += entry['count']
+            m['total'] += entry['total']
+            m['self'] += entry['self']
+            m['files'] += 1
+    return merged
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+        formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('files', nargs='+', metavar='FILE',
+                        help='summary files to merge')
+    parser.add_argument('-name', action='append', default=[],
+                        help='only show entries with this name, e.g. Source, '
+                             'InstantiateFunction or "CodeGen Function"')
+    parser.add_argument('-top', type=int, default=0,
+                        help='only show the N entries with the highest total')
+    parser.add_argument('-sort', choices=['total', 'self', 'count'],
+                        default='total', help='column to sort by')
+    parser.add_argument('-o', dest='output',
+                        help='write the merged summary as JSON to this file')
+    args = parser.parse_args()
+
+    merged = merge(args.files)
+    entries = sorted(((k, v) for k, v in merged.items()
+                      if not args.name or k[0] in args.name),
+                     key=lambda e: e[1][args.sort], reverse=True)
+    if args.top:
+        entries = entries[:args.top]
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump({'summary': [
+                {'name': k[0], 'detail': k[1], 'count': v['count'],
+                 'total': v['total'], 'self': v['self']}
+                for k, v in entries]}, f, indent=2)
+        return 0
+
+    print('%12s %12s %8s %6s  %s' % ('total (ms)', 'self (ms)', 'count',
+                                     'TUs', 'name: detail'))
+    for (name, detail), v in entries:
+        print('%12.1f %12.1f %8d %6d  %s: %s' % (
+            v['total'] / 1000.0, v['self'] / 1000.0, v['count'], v['files'],
+            name, detail))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -245,8 +245,14 @@ struct Allocator {
   StaticSpinMutex fallback_mutex;
   AllocatorCache fallback_allocator_cache;
   QuarantineCache fallback_quarantine_cache;
+  // Only used by the thread started by MaybeStartQuarantineThread().
+  AllocatorCache background_allocator_cache;
 
   atomic_uint8_t rss_limit_exceeded;
+  atomic_uint8_t rss_limit_approached;
+  // The quarantine size from the options, the actual size shrinks when the
+  // RSS gets close to the limits.
+  atomic_uintptr_t max_quarantine_size;
 
   // ------------------- Options --------------------------
   atomic_uint16_t min_redzone;
@@ -270,6 +276,9 @@ struct Allocator {
     CheckOptions(options);
     quarantine.Init((uptr)options.quarantine_size_mb << 20,
                     (uptr)options.thread_local_quarantine_size_kb << 10);
+    atomic_store_relaxed(&max_quarantine_size,
+                         (uptr)options.quarantine_size_mb << 20);
+    UpdateQuarantineSize();
     atomic_store(&alloc_dealloc_mismatch, options.alloc_dealloc_mismatch,
                  memory_order_release);
     atomic_store(&min_redzone, options.min_redzone, memory_order_release);
@@ -288,6 +297,31 @@ struct Allocator {
 
   void SetRssLimitExceeded(bool limit_exceeded) {
     atomic_store(&rss_limit_exceeded, limit_exceeded, memory_order_relaxed);
+    UpdateQuarantineSize();
+  }
+
+  void SetRssLimitApproached(bool limit_approached) {
+    if (atomic_exchange(&rss_limit_approached, limit_approached,
+                        memory_order_relaxed) != limit_approached)
+      UpdateQuarantineSize();
+  }
+
+  // The quarantine is usually the largest amount of memory that the allocator
+  // can give back, so it is shrunk to a quarter while the RSS is close to or
+  // over a limit.
+  void UpdateQuarantineSize() {
+    uptr size = atomic_load_relaxed(&max_quarantine_size);
+    if (RssLimitExceeded() ||
+        atomic_load(&rss_limit_approached, memory_order_relaxed))
+      size /= 4;
+    if (quarantine.GetCacheSize())
+      quarantine.SetSize(size);
+  }
+
+  void RecycleQuarantine() {
+    BufferedStackTrace stack;
+    quarantine.RecycleInBackground(
+        QuarantineCallback(&background_allocator_cache, &stack));
   }
 
   void RePoisonChunk(uptr chunk) {
@@ -331,7 +365,8 @@ struct Allocator {
   }
 
   void GetOptions(AllocatorOptions *options) const {
-    options->quarantine_size_mb = quarantine.GetSize() >> 20;
+    options->quarantine_size_mb =
+        atomic_load_relaxed(&max_quarantine_size) >> 20;
     options->thread_local_quarantine_size_kb = quarantine.GetCacheSize() >> 10;
     options->min_redzone = atomic_load(&min_redzone, memory_order_acquire);
     options->max_redzone = atomic_load(&max_redzone, memory_order_acquire);
@@ -988,6 +1023,35 @@ void AsanSoftRssLimitExceededCallback(bool limit_exceeded) {
   instance.SetRssLimitExceeded(limit_exceeded);
 }
 
+#if (SANITIZER_LINUX || SANITIZER_NETBSD) && !SANITIZER_GO
+static void QuarantineThread(void *arg) {
+  const uptr interval_ms = flags()->quarantine_recycle_interval_ms;
+  uptr rss_limit_mb = common_flags()->soft_rss_limit_mb;
+  if (!rss_limit_mb || (common_flags()->hard_rss_limit_mb &&
+                        common_flags()->hard_rss_limit_mb < rss_limit_mb))
+    rss_limit_mb = common_flags()->hard_rss_limit_mb;
+  // The RSS is checked about every 100ms, like in the common background
+  // thread.
+  const uptr rss_check_period = Max<uptr>(1, 100 / interval_ms);
+  for (uptr i = 0;; i++) {
+    SleepForMillis(interval_ms);
+    if (rss_limit_mb && i % rss_check_period == 0)
+      instance.SetRssLimitApproached((GetRSS() >> 20) >= rss_limit_mb / 10 * 9);
+    instance.RecycleQuarantine();
+  }
+}
+#endif
+
+void MaybeStartQuarantineThread() {
+#if (SANITIZER_LINUX || SANITIZER_NETBSD) && !SANITIZER_GO
+  if (flags()->quarantine_recycle_interval_ms <= 0 ||
+      !instance.quarantine.GetSize())
+    return;
+  instance.quarantine.SetRecycleInBackground(true);
+  internal_start_thread(QuarantineThread, nullptr);
+#endif
+}
+
 } // namespace __asan
 
 // --- Implementation of LSan-specific functions --- {{{1
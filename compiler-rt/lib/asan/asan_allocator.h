@@ -46,6 +46,9 @@ struct AllocatorOptions {
 void InitializeAllocator(const AllocatorOptions &options);
 void ReInitializeAllocator(const AllocatorOptions &options);
 void GetAllocatorOptions(AllocatorOptions *options);
+// Starts the thread that recycles the quarantine if
+// quarantine_recycle_interval_ms is set.
+void MaybeStartQuarantineThread();
 
 class AsanChunkView {
  public:
@@ -389,6 +389,7 @@ void PrintAddressSpaceLayout() {
 #ifndef START_BACKGROUND_THREAD_IN_ASAN_INTERNAL
 static bool UNUSED __local_asan_dyninit = [] {
   MaybeStartBackgroudThread();
+  MaybeStartQuarantineThread();
   SetSoftRssLimitExceededCallback(AsanSoftRssLimitExceededCallback);
 
   return false;
@@ -471,6 +472,7 @@ static void AsanInitInternal() {
 
 #ifdef START_BACKGROUND_THREAD_IN_ASAN_INTERNAL
   MaybeStartBackgroudThread();
+  MaybeStartQuarantineThread();
   SetSoftRssLimitExceededCallback(AsanSoftRssLimitExceededCallback);
 #endif
 
@@ -9,6 +9,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "FuzzerCommand.h"
+#include "FuzzerCorpus.h"
 #include "FuzzerFork.h"
 #include "FuzzerIO.h"
 #include "FuzzerInternal.h"
@@ -23,9 +24,12 @@
 #include <fstream>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <queue>
+#include <random>
 #include <sstream>
 #include <thread>
+#include <unordered_map>
 
 namespace fuzzer {
 
@@ -95,6 +99,11 @@ struct GlobalEnv {
   Set<uint32_t> Features, Cov;
   Set<std::string> FilesWithDFT;
   Vector<std::string> Files;
+  // Seed energy, parallel to Files: the number of features each file brought
+  // into the main corpus, and the number of jobs it has been given to.
+  Vector<size_t> FileFeatures, FileUses;
+  // Features, shared with the jobs through a file mapping. May be null.
+  uint8_t *FeaturesBitmap = nullptr;
   Random *Rand;
   std::chrono::system_clock::time_point ProcessStartTime;
   int Verbosity = 0;
@@ -107,6 +116,35 @@ struct GlobalEnv {
   size_t NumRuns = 0;
 
   std::string StopFile() { return DirPlusFile(TempDir, "STOP"); }
+  std::string FeaturesBitmapFile() {
+    return DirPlusFile(TempDir, "features.bitmap");
+  }
+
+  void PublishFeatures(const Set<uint32_t> &NewFeatures) {
+    if (!FeaturesBitmap) return;
+    for (auto Ft : NewFeatures) {
+      size_t Idx = Ft % InputCorpus::kFeatureSetSize;
+      FeaturesBitmap[Idx / 8] |= 1 << (Idx % 8);
+    }
+  }
+
+  void AddFile(const std::string &Path, size_t NumFeatures) {
+    Files.push_back(Path);
+    FileFeatures.push_back(NumFeatures);
+    FileUses.push_back(0);
+  }
+
+  // Files that brought many features are given to more jobs, newer files are
+  // preferred, and a file loses energy every time it is used.
+  std::piecewise_constant_distribution<double> SeedDistribution() {
+    Vector<double> Intervals(Files.size() + 1);
+    std::iota(Intervals.begin(), Intervals.end(), 0);
+    Vector<double> Weights(Files.size());
+    for (size_t i = 0; i < Files.size(); i++)
+      Weights[i] = (i + 1) * (1.0 + FileFeatures[i]) / (1 + FileUses[i]);
+    return std::piecewise_constant_distribution<double>(
+        Intervals.begin(), Intervals.end(), Weights.begin());
+  }
 
   size_t secondsSinceProcessStartUp() const {
     return std::chrono::duration_cast<std::chrono::seconds>(
@@ -126,6 +164,8 @@ struct GlobalEnv {
     Cmd.addFlag("print_funcs", "0");  // no need to spend time symbolizing.
     Cmd.addFlag("max_total_time", std::to_string(std::min((size_t)300, JobId)));
     Cmd.addFlag("stop_file", StopFile());
+    if (FeaturesBitmap)
+      Cmd.addFlag("fork_features_bitmap", FeaturesBitmapFile());
     if (!DataFlowBinary.empty()) {
       Cmd.addFlag("data_flow_trace", DFTDir);
       if (!Cmd.hasFlag("focus_function"))
@@ -136,8 +176,12 @@ struct GlobalEnv {
     if (size_t CorpusSubsetSize =
             std::min(Files.size(), (size_t)sqrt(Files.size() + 2))) {
       auto Time1 = std::chrono::system_clock::now();
+      auto Distribution = SeedDistribution();
       for (size_t i = 0; i < CorpusSubsetSize; i++) {
-        auto &SF = Files[Rand->SkewTowardsLast(Files.size())];
+        size_t Idx = std::min(static_cast<size_t>(Distribution(*Rand)),
+                              Files.size() - 1);
+        FileUses[Idx]++;
+        auto &SF = Files[Idx];
         Seeds += (Seeds.empty() ? "" : ",") + SF;
         CollectDFT(SF);
       }
@@ -182,8 +226,11 @@ struct GlobalEnv {
     NumRuns += Stats.number_of_executed_units;
 
     Vector<SizedFile> TempFiles, MergeCandidates;
+    std::unordered_map<std::string, Vector<uint32_t>> CandidateFeatures;
     // Read all newly created inputs and their feature sets.
     // Choose only those inputs that have new features.
+    // The job does not write the inputs whose features were all published in
+    // FeaturesBitmap when it found them.
     GetSizedFilesFromDir(Job->CorpusDir, &TempFiles);
     std::sort(TempFiles.begin(), TempFiles.end());
     for (auto &F : TempFiles) {
@@ -196,6 +243,7 @@ struct GlobalEnv {
       for (auto Ft : NewFeatures) {
         if (!Features.count(Ft)) {
           MergeCandidates.push_back(F);
+          CandidateFeatures[F.File] = std::move(NewFeatures);
           break;
         }
       }
@@ -213,13 +261,19 @@ struct GlobalEnv {
     Set<uint32_t> NewFeatures, NewCov;
     CrashResistantMerge(Args, {}, MergeCandidates, &FilesToAdd, Features,
                         &NewFeatures, Cov, &NewCov, Job->CFPath, false);
+    Set<uint32_t> CountedFeatures;
     for (auto &Path : FilesToAdd) {
       auto U = FileToVector(Path);
       auto NewPath = DirPlusFile(MainCorpusDir, Hash(U));
       WriteToFile(U, NewPath);
-      Files.push_back(NewPath);
+      size_t NumFeatures = 0;
+      for (auto Ft : CandidateFeatures[Path])
+        if (NewFeatures.count(Ft) && CountedFeatures.insert(Ft).second)
+          NumFeatures++;
+      AddFile(NewPath, NumFeatures);
     }
     Features.insert(NewFeatures.begin(), NewFeatures.end());
+    PublishFeatures(NewFeatures);
     Cov.insert(NewCov.begin(), NewCov.end());
     for (auto Idx : NewCov)
       if (auto *TE = TPC.PCTableEntryByIdx(Idx))
@@ -310,10 +364,16 @@ void FuzzWithFork(Random &Rand, const FuzzingOptions &Options,
     Env.MainCorpusDir = CorpusDirs[0];
 
   auto CFPath = DirPlusFile(Env.TempDir, "merge.txt");
-  CrashResistantMerge(Env.Args, {}, SeedFiles, &Env.Files, {}, &Env.Features,
-                      {}, &Env.Cov,
-                      CFPath, false);
+  Vector<std::string> InitialFiles;
+  CrashResistantMerge(Env.Args, {}, SeedFiles, &InitialFiles, {},
+                      &Env.Features, {}, &Env.Cov, CFPath, false);
   RemoveFile(CFPath);
+  for (auto &Path : InitialFiles)
+    Env.AddFile(Path, 0);
+  Env.FeaturesBitmap =
+      MapSharedFile(Env.FeaturesBitmapFile(), InputCorpus::kFeatureSetSize / 8,
+                    /*Writable=*/true);
+  Env.PublishFeatures(Env.Features);
   Printf("INFO: -fork=%d: %zd seed inputs, starting to fuzz in %s\n", NumJobs,
          Env.Files.size(), Env.TempDir.c_str());
 
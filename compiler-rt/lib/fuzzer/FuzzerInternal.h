@@ -101,6 +101,7 @@ private:
   void PrintStats(const char *Where, const char *End = "\n", size_t Units = 0);
   void PrintStatusForNewUnit(const Unit &U, const char *Text);
   void CheckExitOnSrcPosOrItem();
+  bool FeaturesKnownToForkParent(const Vector<uint32_t> &FeatureSet) const;
 
   static void StaticDeathCallback();
   void DumpCurrentUnit(const char *Prefix);
@@ -119,6 +120,11 @@ private:
   size_t LastCorpusUpdateRun = 0;
 
   bool HasMoreMallocsThanFrees = false;
+
+  // -fork mode child only: the features of the parent's main corpus, and
+  // whether the last unit added by RunOne only has such features.
+  const uint8_t *ForkFeaturesBitmap = nullptr;
+  bool LastUnitKnownToForkParent = false;
   size_t NumberOfLeakDetectionAttempts = 0;
 
   system_clock::time_point LastAllocatorPurgeAttemptTime = system_clock::now();
@@ -157,6 +157,10 @@ Fuzzer::Fuzzer(UserCallback CB, InputCorpus &Corpus, MutationDispatcher &MD,
   AllocateCurrentUnitData();
   CurrentUnitSize = 0;
   memset(BaseSha1, 0, sizeof(BaseSha1));
+  if (!Options.ForkFeaturesBitmap.empty())
+    ForkFeaturesBitmap =
+        MapSharedFile(Options.ForkFeaturesBitmap,
+                      InputCorpus::kFeatureSetSize / 8, /*Writable=*/false);
 }
 
 Fuzzer::~Fuzzer() {}
@@ -461,6 +465,20 @@ static void RenameFeatureSetFile(const std::string &FeaturesDir,
              DirPlusFile(FeaturesDir, NewFile));
 }
 
+// The -fork parent only merges inputs that have a feature its main corpus
+// does not have yet, so there is no point in writing the other ones to disk.
+bool Fuzzer::FeaturesKnownToForkParent(
+    const Vector<uint32_t> &FeatureSet) const {
+  if (!ForkFeaturesBitmap)
+    return false;
+  for (auto Feature : FeatureSet) {
+    size_t Idx = Feature % InputCorpus::kFeatureSetSize;
+    if (!(ForkFeaturesBitmap[Idx / 8] & (1 << (Idx % 8))))
+      return false;
+  }
+  return true;
+}
+
 bool Fuzzer::RunOne(const uint8_t *Data, size_t Size, bool MayDeleteFile,
                     InputInfo *II, bool *FoundUniqFeatures) {
   if (!Size)
@@ -488,8 +506,11 @@ bool Fuzzer::RunOne(const uint8_t *Data, size_t Size, bool MayDeleteFile,
     auto NewII = Corpus.AddToCorpus({Data, Data + Size}, NumNewFeatures,
                                     MayDeleteFile, TPC.ObservedFocusFunction(),
                                     UniqFeatureSetTmp, DFT, II);
-    WriteFeatureSetToFile(Options.FeaturesDir, Sha1ToString(NewII->Sha1),
-                          NewII->UniqFeatureSet);
+    LastUnitKnownToForkParent =
+        FeaturesKnownToForkParent(NewII->UniqFeatureSet);
+    if (!LastUnitKnownToForkParent)
+      WriteFeatureSetToFile(Options.FeaturesDir, Sha1ToString(NewII->Sha1),
+                            NewII->UniqFeatureSet);
     return true;
   }
   if (II && FoundUniqFeaturesOfII &&
@@ -500,6 +521,7 @@ bool Fuzzer::RunOne(const uint8_t *Data, size_t Size, bool MayDeleteFile,
     Corpus.Replace(II, {Data, Data + Size});
     RenameFeatureSetFile(Options.FeaturesDir, OldFeaturesFile,
                          Sha1ToString(II->Sha1));
+    LastUnitKnownToForkParent = FeaturesKnownToForkParent(II->UniqFeatureSet);
     return true;
   }
   return false;
@@ -603,7 +625,8 @@ void Fuzzer::ReportNewCoverage(InputInfo *II, const Unit &U) {
   II->NumSuccessfullMutations++;
   MD.RecordSuccessfulMutationSequence();
   PrintStatusForNewUnit(U, II->Reduced ? "REDUCE" : "NEW   ");
-  WriteToOutputCorpus(U);
+  if (!LastUnitKnownToForkParent)
+    WriteToOutputCorpus(U);
   NumberOfNewUnitsAdded++;
   CheckExitOnSrcPosOrItem(); // Check only after the unit is saved to corpus.
   LastCorpusUpdateRun = TotalNumberOfRuns;
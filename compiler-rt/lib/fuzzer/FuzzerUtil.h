@@ -54,6 +54,11 @@ void SleepSeconds(int Seconds);
 
 bool Mprotect(void *Ptr, size_t Size, bool AllowReadWrite);
 
+// Maps Size bytes of the file at Path so that other processes mapping the same
+// file see the updates. A writable mapping creates and resizes the file.
+// Returns nullptr on failure.
+uint8_t *MapSharedFile(const std::string &Path, size_t Size, bool Writable);
+
 unsigned long GetPid();
 
 size_t GetPeakRSSMb();
@@ -309,6 +309,10 @@ bool Mprotect(void *Ptr, size_t Size, bool AllowReadWrite) {
   return false;  // UNIMPLEMENTED
 }
 
+uint8_t *MapSharedFile(const std::string &Path, size_t Size, bool Writable) {
+  return nullptr;  // UNIMPLEMENTED
+}
+
 // Platform specific functions.
 void SetSignalHandler(const FuzzingOptions &Options) {
   // Set up alarm handler if needed.
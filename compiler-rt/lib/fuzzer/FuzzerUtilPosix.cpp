@@ -16,6 +16,7 @@
 #include <chrono>
 #include <cstring>
 #include <errno.h>
+#include <fcntl.h>
 #include <iomanip>
 #include <signal.h>
 #include <stdio.h>
@@ -103,6 +104,20 @@ bool Mprotect(void *Ptr, size_t Size, bool AllowReadWrite) {
                        AllowReadWrite ? (PROT_READ | PROT_WRITE) : PROT_NONE);
 }
 
+uint8_t *MapSharedFile(const std::string &Path, size_t Size, bool Writable) {
+  int Fd = open(Path.c_str(), Writable ? (O_RDWR | O_CREAT) : O_RDONLY, 0600);
+  if (Fd < 0)
+    return nullptr;
+  if (Writable && ftruncate(Fd, Size)) {
+    close(Fd);
+    return nullptr;
+  }
+  int Prot = Writable ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void *Ptr = mmap(nullptr, Size, Prot, MAP_SHARED, Fd, 0);
+  close(Fd);
+  return Ptr == MAP_FAILED ? nullptr : static_cast<uint8_t *>(Ptr);
+}
+
 void SetSignalHandler(const FuzzingOptions& Options) {
   if (Options.UnitTimeoutSec > 0)
     SetTimer(Options.UnitTimeoutSec / 2 + 1);
@@ -589,6 +589,20 @@ TEST(FuzzerUtil, Base64) {
   EXPECT_EQ("YWJjeHl6", Base64({'a', 'b', 'c', 'x', 'y', 'z'}));
 }
 
+#if LIBFUZZER_POSIX
+TEST(FuzzerUtil, MapSharedFile) {
+  std::string Path = TempPath(".bitmap");
+  uint8_t *Writer = MapSharedFile(Path, 4096, /*Writable=*/true);
+  ASSERT_NE(Writer, nullptr);
+  const uint8_t *Reader = MapSharedFile(Path, 4096, /*Writable=*/false);
+  ASSERT_NE(Reader, nullptr);
+  EXPECT_EQ(Reader[17], 0);
+  Writer[17] = 42;
+  EXPECT_EQ(Reader[17], 42);
+  RemoveFile(Path);
+}
+#endif
+
 TEST(Corpus, Distribution) {
   DataFlowTrace DFT;
   Random Rand(0);
@@ -13,6 +13,7 @@
 
 #include "InstrProfiling.h"
 #include "InstrProfilingInternal.h"
+#include "InstrProfilingPort.h"
 
 #define INSTR_PROF_VALUE_PROF_DATA
 #include "InstrProfData.inc"
@@ -20,6 +21,92 @@
 
 COMPILER_RT_WEAK uint64_t INSTR_PROF_RAW_VERSION_VAR = INSTR_PROF_RAW_VERSION;
 
+#if defined(__ELF__)
+/* Modules built with runtime counter relocation define the bias variable,
+ * which overrides the weak alias to the default. */
+COMPILER_RT_VISIBILITY int64_t INSTR_PROF_PROFILE_COUNTER_BIAS_DEFAULT_VAR = 0;
+COMPILER_RT_VISIBILITY extern int64_t INSTR_PROF_PROFILE_COUNTER_BIAS_VAR
+    __attribute__((weak, alias(INSTR_PROF_QUOTE(
+                             INSTR_PROF_PROFILE_COUNTER_BIAS_DEFAULT_VAR))));
+
+COMPILER_RT_VISIBILITY int64_t *lprofGetCounterBias(void) {
+  if (&INSTR_PROF_PROFILE_COUNTER_BIAS_VAR ==
+      &INSTR_PROF_PROFILE_COUNTER_BIAS_DEFAULT_VAR)
+    return 0;
+  return &INSTR_PROF_PROFILE_COUNTER_BIAS_VAR;
+}
+#else
+COMPILER_RT_VISIBILITY int64_t *lprofGetCounterBias(void) { return 0; }
+#endif
+
+/* Code built with per-thread counters increments one of these copies of the
+ * counters instead of the counters themselves, so that threads don't write
+ * to the same cache lines. The copies are added into the counters before the
+ * profile is written. */
+#define INSTR_PROF_MAX_COUNTER_SHARDS 64
+#define INSTR_PROF_DEFAULT_COUNTER_SHARDS 16
+
+static uint64_t *CounterShards[INSTR_PROF_MAX_COUNTER_SHARDS];
+static uint32_t NumCounterShards;
+/* Only used as a counter, the pointer is never dereferenced. */
+static char *NextCounterShard;
+
+static uint32_t getNumCounterShards(void) {
+  if (!NumCounterShards) {
+    uint32_t N = INSTR_PROF_DEFAULT_COUNTER_SHARDS;
+    const char *Str = getenv("LLVM_PROFILE_COUNTER_SHARDS");
+    if (Str && Str[0] && atoi(Str) > 0)
+      N = atoi(Str);
+    if (N > INSTR_PROF_MAX_COUNTER_SHARDS)
+      N = INSTR_PROF_MAX_COUNTER_SHARDS;
+    NumCounterShards = N;
+  }
+  return NumCounterShards;
+}
+
+/* Called once by each thread that runs instrumented code. Returns the offset
+ * from the counters to the shard the thread should update. */
+COMPILER_RT_VISIBILITY int64_t
+INSTR_PROF_PROFILE_GET_THREAD_COUNTER_BIAS_FUNC(void) {
+  uint64_t *Begin = __llvm_profile_begin_counters();
+  uint64_t *End = __llvm_profile_end_counters();
+  uint32_t Idx =
+      (uintptr_t)COMPILER_RT_PTR_FETCH_ADD(char, NextCounterShard, 1) %
+      getNumCounterShards();
+
+  if (!CounterShards[Idx]) {
+    uint64_t *Shard = (uint64_t *)calloc(End - Begin, sizeof(uint64_t));
+    /* Fall back to the shared counters if there is no memory. */
+    if (!Shard)
+      return 0;
+    if (!COMPILER_RT_BOOL_CMPXCHG(&CounterShards[Idx], 0, Shard))
+      free(Shard);
+  }
+  return (char *)CounterShards[Idx] - (char *)Begin;
+}
+
+COMPILER_RT_VISIBILITY void lprofMergeCounterShards(void) {
+  uint64_t *Begin = __llvm_profile_begin_counters();
+  uint64_t *End = __llvm_profile_end_counters();
+  uint32_t S;
+  for (S = 0; S < INSTR_PROF_MAX_COUNTER_SHARDS; ++S) {
+    uint64_t *Shard = CounterShards[S];
+    uint64_t I;
+    if (!Shard)
+      continue;
+    /* Other threads may still be running, take each count atomically so
+     * that no increment is added twice or lost. */
+    for (I = 0; I < (uint64_t)(End - Begin); ++I) {
+      uint64_t V = Shard[I];
+      if (!V)
+        continue;
+      while (!COMPILER_RT_BOOL_CMPXCHG(&Shard[I], V, 0))
+        V = Shard[I];
+      Begin[I] += V;
+    }
+  }
+}
+
 COMPILER_RT_VISIBILITY uint64_t __llvm_profile_get_magic(void) {
   return sizeof(void *) == sizeof(uint64_t) ? (INSTR_PROF_RAW_MAGIC_64)
                                             : (INSTR_PROF_RAW_MAGIC_32);
@@ -54,8 +141,17 @@ COMPILER_RT_VISIBILITY uint64_t __llvm_profile_get_version(void) {
 COMPILER_RT_VISIBILITY void __llvm_profile_reset_counters(void) {
   uint64_t *I = __llvm_profile_begin_counters();
   uint64_t *E = __llvm_profile_end_counters();
+  uint32_t S;
 
   memset(I, 0, sizeof(uint64_t) * (E - I));
+  for (S = 0; S < INSTR_PROF_MAX_COUNTER_SHARDS; ++S)
+    if (CounterShards[S])
+      memset(CounterShards[S], 0, sizeof(uint64_t) * (E - I));
+
+  /* In continuous mode, the counters that are updated are in the file. */
+  int64_t *Bias = lprofGetCounterBias();
+  if (Bias && *Bias)
+    memset((char *)I + *Bias, 0, sizeof(uint64_t) * (E - I));
 
   const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
   const __llvm_profile_data *DataEnd = __llvm_profile_end_data();
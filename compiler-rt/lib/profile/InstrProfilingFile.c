@@ -83,13 +83,18 @@ typedef struct lprofFilename {
    * 2 profile data files. %1m is equivalent to %m. Also %m specifier
    * can only appear once at the end of the name pattern. */
   unsigned MergePoolSize;
+  /* A flag indicating if continuous mode is requested by the %c specifier.
+   * In continuous mode, the counters are updated directly in the mapped
+   * profile file. */
+  unsigned ContinuousMode;
   ProfileNameSpecifier PNS;
 } lprofFilename;
 
-COMPILER_RT_WEAK lprofFilename lprofCurFilename = {0,   0, 0, 0, {0},
-                                                   {0}, 0, 0, 0, PNS_unknown};
+COMPILER_RT_WEAK lprofFilename lprofCurFilename = {
+    0, 0, 0, 0, {0}, {0}, 0, 0, 0, 0, PNS_unknown};
 
 static int ProfileMergeRequested = 0;
+static int ContinuousModeActive = 0;
 static int isProfileMergeRequested() { return ProfileMergeRequested; }
 static void setProfileMergeRequested(int EnableMerge) {
   ProfileMergeRequested = EnableMerge;
@@ -422,6 +427,8 @@ static int parseFilenamePattern(const char *FilenamePat,
                       FilenamePat);
             return -1;
           }
+      } else if (FilenamePat[I] == 'c') {
+        lprofCurFilename.ContinuousMode = 1;
       } else if (containsMergeSpecifier(FilenamePat, I)) {
         if (MergingEnabled) {
           PROF_WARN("%%m specifier can only be specified once in %s.\n",
@@ -490,7 +497,7 @@ static int getCurFilenameLength() {
     return 0;
 
   if (!(lprofCurFilename.NumPids || lprofCurFilename.NumHosts ||
-        lprofCurFilename.MergePoolSize))
+        lprofCurFilename.MergePoolSize || lprofCurFilename.ContinuousMode))
     return strlen(lprofCurFilename.FilenamePat);
 
   Len = strlen(lprofCurFilename.FilenamePat) +
@@ -514,7 +521,7 @@ static const char *getCurFilename(char *FilenameBuf, int ForceUseBuf) {
     return 0;
 
   if (!(lprofCurFilename.NumPids || lprofCurFilename.NumHosts ||
-        lprofCurFilename.MergePoolSize)) {
+        lprofCurFilename.MergePoolSize || lprofCurFilename.ContinuousMode)) {
     if (!ForceUseBuf)
       return lprofCurFilename.FilenamePat;
 
@@ -619,6 +626,94 @@ const char *__llvm_profile_get_filename(void) {
   return FilenameBuf;
 }
 
+/* Map the profile file into memory and point the counters of the code built
+ * with runtime counter relocation at the counters in the mapping, so that
+ * every counter update reaches the file without a dump. The profile of a
+ * process that is killed is then still usable. With %m, the counters of a
+ * compatible existing file are kept and shared by all the processes using it.
+ * Value profile data is not written in continuous mode. */
+static void initializeContinuousMode(void) {
+  int64_t *Bias;
+  int Length, Reuse = 0;
+  char *FilenameBuf, *Profile = MAP_FAILED;
+  const char *Filename;
+  FILE *File;
+  uint64_t FileSize, CountersOffset, I;
+  long CurrentSize;
+  const __llvm_profile_data *DataBegin = __llvm_profile_begin_data();
+  const __llvm_profile_data *DataEnd = __llvm_profile_end_data();
+  uint64_t *CountersBegin = __llvm_profile_begin_counters();
+  uint64_t *CountersEnd = __llvm_profile_end_counters();
+
+  Bias = lprofGetCounterBias();
+  if (!Bias) {
+    PROF_WARN("Continuous mode (%%c) ignored: the code is not built with %s.\n",
+              "-mllvm -runtime-counter-relocation");
+    return;
+  }
+  /* The mismatch is reported when the profile is written. */
+  if (GET_VERSION(__llvm_profile_get_version()) != INSTR_PROF_RAW_VERSION)
+    return;
+
+  Length = getCurFilenameLength();
+  FilenameBuf = (char *)COMPILER_RT_ALLOCA(Length + 1);
+  Filename = getCurFilename(FilenameBuf, 0);
+  if (!Filename)
+    return;
+
+  FileSize = __llvm_profile_get_size_for_buffer();
+  CountersOffset = sizeof(__llvm_profile_header) +
+                   (DataEnd - DataBegin) * sizeof(__llvm_profile_data);
+
+  createProfileDir(Filename);
+  File = lprofOpenFileEx(Filename);
+  if (!File) {
+    PROF_ERR("Continuous mode: failed to open %s: %s\n", Filename,
+             strerror(errno));
+    return;
+  }
+
+  if (lprofCurFilename.MergePoolSize && fseek(File, 0L, SEEK_END) != -1 &&
+      (CurrentSize = ftell(File)) >= 0 && (uint64_t)CurrentSize == FileSize) {
+    Profile = mmap(NULL, FileSize, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FILE, fileno(File), 0);
+    if (Profile != MAP_FAILED) {
+      Reuse = !__llvm_profile_check_compatibility(Profile, FileSize);
+      if (!Reuse) {
+        (void)munmap(Profile, FileSize);
+        Profile = MAP_FAILED;
+      }
+    }
+  }
+
+  if (!Reuse) {
+    if (COMPILER_RT_FTRUNCATE(File, 0L) == 0 &&
+        COMPILER_RT_FTRUNCATE(File, FileSize) == 0)
+      Profile = mmap(NULL, FileSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_FILE, fileno(File), 0);
+    if (Profile == MAP_FAILED) {
+      PROF_ERR("Continuous mode: failed to map %s: %s\n", Filename,
+               strerror(errno));
+      lprofUnlockFileHandle(File);
+      fclose(File);
+      return;
+    }
+    __llvm_profile_write_buffer(Profile);
+  } else {
+    /* Keep the counts of the code that ran before the file was mapped. */
+    uint64_t *FileCounters = (uint64_t *)(Profile + CountersOffset);
+    for (I = 0; I < (uint64_t)(CountersEnd - CountersBegin); ++I)
+      FileCounters[I] += CountersBegin[I];
+  }
+
+  *Bias = (Profile + CountersOffset) - (char *)CountersBegin;
+  ContinuousModeActive = 1;
+
+  /* The mapping stays valid after the file is closed. */
+  lprofUnlockFileHandle(File);
+  fclose(File);
+}
+
 /* This method is invoked by the runtime initialization hook
  * InstrProfilingRuntime.o if it is linked in. Both user specified
  * profile path via -fprofile-instr-generate= and LLVM_PROFILE_FILE
@@ -635,16 +730,19 @@ void __llvm_profile_initialize_file(void) {
     /* Pass CopyFilenamePat = 1, to ensure that the filename would be valid
        at the  moment when __llvm_profile_write_file() gets executed. */
     parseAndSetFilename(EnvFilenamePat, PNS_environment, 1);
-    return;
-  } else if (hasCommandLineOverrider) {
-    SelectedPat = INSTR_PROF_PROFILE_NAME_VAR;
-    PNS = PNS_command_line;
   } else {
-    SelectedPat = NULL;
-    PNS = PNS_default;
+    if (hasCommandLineOverrider) {
+      SelectedPat = INSTR_PROF_PROFILE_NAME_VAR;
+      PNS = PNS_command_line;
+    } else {
+      SelectedPat = NULL;
+      PNS = PNS_default;
+    }
+    parseAndSetFilename(SelectedPat, PNS, 0);
   }
 
-  parseAndSetFilename(SelectedPat, PNS, 0);
+  if (lprofCurFilename.ContinuousMode && !ContinuousModeActive)
+    initializeContinuousMode();
 }
 
 /* This API is directly called by the user application code. It has the
@@ -653,6 +751,11 @@ void __llvm_profile_initialize_file(void) {
  */
 COMPILER_RT_VISIBILITY
 void __llvm_profile_set_filename(const char *FilenamePat) {
+  if (ContinuousModeActive) {
+    PROF_WARN("Profile file not changed: %s.\n",
+              "continuous mode writes to the file mapped at startup");
+    return;
+  }
   parseAndSetFilename(FilenamePat, PNS_runtime_api, 1);
 }
 
@@ -672,6 +775,10 @@ int __llvm_profile_write_file(void) {
     return 0;
   }
 
+  /* The counters are already in the mapped file. */
+  if (ContinuousModeActive)
+    return 0;
+
   Length = getCurFilenameLength();
   FilenameBuf = (char *)COMPILER_RT_ALLOCA(Length + 1);
   Filename = getCurFilename(FilenameBuf, 0);
@@ -708,7 +815,7 @@ int __llvm_profile_write_file(void) {
 
 COMPILER_RT_VISIBILITY
 int __llvm_profile_dump(void) {
-  if (!doMerging())
+  if (!doMerging() && !ContinuousModeActive)
     PROF_WARN("Later invocation of __llvm_profile_dump can lead to clobbering "
               " of previously dumped profile data : %s. Either use %%m "
               "in profile name or change profile name before dumping.\n",
@@ -177,6 +177,16 @@ uint64_t lprofGetLoadModuleSignature();
 unsigned lprofProfileDumped();
 void lprofSetProfileDumped();
 
+/* Return the offset that code built with runtime counter relocation adds to
+ * the counter addresses, or null if no code in this module was built with
+ * it. Continuous mode sets the offset to point the counters at the mapped
+ * profile file. */
+int64_t *lprofGetCounterBias(void);
+
+/* Add the per-thread copies of the counters of code built with per-thread
+ * counters into the counters, and clear them. */
+void lprofMergeCounterShards(void);
+
 COMPILER_RT_VISIBILITY extern void (*FreeHook)(void *);
 COMPILER_RT_VISIBILITY extern uint8_t *DynamicBufferIOBuffer;
 COMPILER_RT_VISIBILITY extern uint32_t VPBufferSize;
@@ -95,6 +95,21 @@ class Quarantine {
   }
 
   uptr GetSize() const { return atomic_load_relaxed(&max_size_); }
+
+  // Changes the global quarantine size at runtime, e.g. to react to memory
+  // pressure. Chunks over the new size are recycled by the next Drain().
+  void SetSize(uptr size) {
+    CHECK(size == 0 || GetCacheSize() != 0);
+    atomic_store_relaxed(&max_size_, size);
+    atomic_store_relaxed(&min_size_, size / 10 * 9);  // 90% of max size.
+  }
+
+  // When set, Drain() only transfers the thread local cache and leaves the
+  // recycling to a thread calling RecycleInBackground() periodically, unless
+  // the quarantine grows past twice its size.
+  void SetRecycleInBackground(bool enabled) {
+    atomic_store_relaxed(&recycle_in_background_, enabled);
+  }
   uptr GetCacheSize() const {
     return atomic_load_relaxed(&max_cache_size_);
   }
@@ -117,6 +132,14 @@ class Quarantine {
       SpinMutexLock l(&cache_mutex_);
       cache_.Transfer(c);
     }
+    uptr max_size = GetSize();
+    if (atomic_load_relaxed(&recycle_in_background_))
+      max_size *= 2;
+    if (cache_.Size() > max_size && recycle_mutex_.TryLock())
+      Recycle(atomic_load_relaxed(&min_size_), cb);
+  }
+
+  void NOINLINE RecycleInBackground(Callback cb) {
     if (cache_.Size() > GetSize() && recycle_mutex_.TryLock())
       Recycle(atomic_load_relaxed(&min_size_), cb);
   }
@@ -143,6 +166,7 @@ class Quarantine {
   atomic_uintptr_t max_size_;
   atomic_uintptr_t min_size_;
   atomic_uintptr_t max_cache_size_;
+  atomic_uint8_t recycle_in_background_;
   char pad1_[kCacheLineSize];
   StaticSpinMutex cache_mutex_;
   StaticSpinMutex recycle_mutex_;
@@ -30,7 +30,11 @@ class StackDepotBase {
   // Retrieves a stored stack trace by the id.
   args_type Get(u32 id);
 
-  StackDepotStats *GetStats() { return &stats; }
+  StackDepotStats *GetStats() {
+    stats.n_uniq_ids = atomic_load(&n_uniq_ids, memory_order_relaxed);
+    stats.allocated = atomic_load(&allocated, memory_order_relaxed);
+    return &stats;
+  }
 
   void LockAll();
   void UnlockAll();
@@ -51,6 +55,9 @@ class StackDepotBase {
   atomic_uintptr_t tab[kTabSize];   // Hash table of Node's.
   atomic_uint32_t seq[kPartCount];  // Unique id generators.
 
+  // Put() updates the counters without a lock; GetStats() copies them out.
+  atomic_uintptr_t n_uniq_ids;
+  atomic_uintptr_t allocated;
   StackDepotStats stats;
 
   friend class StackDepotReverseMap;
@@ -105,31 +112,48 @@ StackDepotBase<Node, kReservedBits, kTabSizeLog>::Put(args_type args,
   // First, try to find the existing stack.
   Node *node = find(s, args, h);
   if (node) return node->get_handle();
-  // If failed, lock, retry and insert new.
-  Node *s2 = lock(p);
-  if (s2 != s) {
-    node = find(s2, args, h);
-    if (node) {
-      unlock(p, s2);
-      return node->get_handle();
-    }
-  }
+  // If failed, create a new node and publish it by swapping it in as the new
+  // bucket head. Readers never lock, so the node is complete before the swap.
   uptr part = (h % kTabSize) / kPartSize;
   u32 id = atomic_fetch_add(&seq[part], 1, memory_order_relaxed) + 1;
-  stats.n_uniq_ids++;
   CHECK_LT(id, kMaxId);
   id |= part << kPartShift;
   CHECK_NE(id, 0);
   CHECK_EQ(id & (((u32)-1) >> kReservedBits), id);
   uptr memsz = Node::storage_size(args);
-  s = (Node *)PersistentAlloc(memsz);
-  stats.allocated += memsz;
-  s->id = id;
-  s->store(args, h);
-  s->link = s2;
-  unlock(p, s);
+  Node *new_node = (Node *)PersistentAlloc(memsz);
+  new_node->id = id;
+  new_node->store(args, h);
+  for (int i = 0;; i++) {
+    new_node->link = s;
+    uptr cmp = (uptr)s;
+    if (atomic_compare_exchange_weak(p, &cmp, (uptr)new_node,
+                                     memory_order_acq_rel))
+      break;
+    // Either another thread inserted nodes, which may contain the stack, or
+    // the bucket is locked by LockAll().
+    Node *s2 = (Node *)(cmp & ~1);
+    if (s2 != s) {
+      node = find(s2, args, h);
+      if (node) {
+        // The new node is never published, so the stats do not count it. Its
+        // memory and id are lost, which only happens when threads race to
+        // insert the same stack.
+        return node->get_handle();
+      }
+      s = s2;
+    }
+    if (cmp & 1) {
+      if (i < 10)
+        proc_yield(10);
+      else
+        internal_sched_yield();
+    }
+  }
+  atomic_fetch_add(&n_uniq_ids, 1, memory_order_relaxed);
+  atomic_fetch_add(&allocated, memsz, memory_order_relaxed);
   if (inserted) *inserted = true;
-  return s->get_handle();
+  return new_node->get_handle();
 }
 
 template <class Node, int kReservedBits, int kTabSizeLog>
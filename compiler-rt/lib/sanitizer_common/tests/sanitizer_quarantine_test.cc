@@ -176,4 +176,43 @@ TEST(SanitizerCommon, QuarantineCacheMergeBatchesALotOfBatches) {
   DeallocateCache(&to_deallocate);
 }
 
+struct CountingQuarantineCallback {
+  static uptr recycled;
+  void Recycle(void *m) { recycled++; }
+  void *Allocate(uptr size) {
+    return malloc(size);
+  }
+  void Deallocate(void *p) {
+    free(p);
+  }
+};
+
+uptr CountingQuarantineCallback::recycled;
+
+TEST(SanitizerCommon, QuarantineRecycleInBackground) {
+  typedef Quarantine<CountingQuarantineCallback, void> CountingQuarantine;
+  static CountingQuarantine quarantine(LINKER_INITIALIZED);
+  CountingQuarantineCallback counting_cb;
+  CountingQuarantine::Cache cache;
+  const uptr kChunkSize = 4 << 10;
+  quarantine.Init(1 << 20, 64 << 10);
+  quarantine.SetRecycleInBackground(true);
+
+  // Going over the quarantine size doesn't recycle on the freeing thread.
+  for (uptr i = 0; i < 320; i++)
+    quarantine.Put(&cache, counting_cb, kFakePtr, kChunkSize);
+  EXPECT_EQ(0U, CountingQuarantineCallback::recycled);
+
+  quarantine.RecycleInBackground(counting_cb);
+  uptr recycled = CountingQuarantineCallback::recycled;
+  EXPECT_NE(0U, recycled);
+
+  // Going over twice the size does, as the background thread is lagging.
+  for (uptr i = 0; i < 512; i++)
+    quarantine.Put(&cache, counting_cb, kFakePtr, kChunkSize);
+  EXPECT_LT(recycled, CountingQuarantineCallback::recycled);
+
+  quarantine.DrainAndRecycle(&cache, counting_cb);
+}
+
 }  // namespace __sanitizer
@@ -14,6 +14,8 @@
 #include "sanitizer_common/sanitizer_libc.h"
 #include "gtest/gtest.h"
 
+#include <thread>
+
 namespace __sanitizer {
 
 TEST(SanitizerCommon, StackDepotBasic) {
@@ -89,4 +91,28 @@ TEST(SanitizerCommon, StackDepotReverseMap) {
   }
 }
 
+TEST(SanitizerCommon, StackDepotThreaded) {
+  const int kNumThreads = 8;
+  const int kNumStacks = 1000;
+  static u32 ids[kNumThreads][kNumStacks];
+  std::thread threads[kNumThreads];
+  for (int t = 0; t < kNumThreads; t++) {
+    threads[t] = std::thread([t]() {
+      for (int i = 0; i < kNumStacks; i++) {
+        uptr array[] = {100, 200, (uptr)i, 300};
+        ids[t][i] = StackDepotPut(StackTrace(array, ARRAY_SIZE(array)));
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  // All threads must have got the same id for the same stack.
+  for (int i = 0; i < kNumStacks; i++) {
+    for (int t = 1; t < kNumThreads; t++) EXPECT_EQ(ids[0][i], ids[t][i]);
+    StackTrace stack = StackDepotGet(ids[0][i]);
+    ASSERT_EQ(4U, stack.size);
+    EXPECT_EQ((uptr)i, stack.trace[2]);
+  }
+}
+
 }  // namespace __sanitizer
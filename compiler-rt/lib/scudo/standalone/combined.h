@@ -124,6 +124,8 @@ public:
     Options.DeallocTypeMismatch = getFlags()->dealloc_type_mismatch;
     Options.DeleteSizeMismatch = getFlags()->delete_size_mismatch;
     Options.QuarantineMaxChunkSize = getFlags()->quarantine_max_chunk_size;
+    Options.MaxBatchSize =
+        static_cast<u32>(Max(0, getFlags()->max_batch_size));
 
     Stats.initLinkerInitialized();
     Primary.initLinkerInitialized(getFlags()->release_to_os_interval_ms);
@@ -142,7 +144,9 @@ public:
 
   TSDRegistryT *getTSDRegistry() { return &TSDRegistry; }
 
-  void initCache(CacheT *Cache) { Cache->init(&Stats, &Primary); }
+  void initCache(CacheT *Cache) {
+    Cache->init(&Stats, &Primary, Options.MaxBatchSize);
+  }
 
   // Release the resources used by a TSD, which involves:
   // - draining the local quarantine cache to the global quarantine;
@@ -444,6 +448,7 @@ private:
     u8 DeallocTypeMismatch : 1; // dealloc_type_mismatch
     u8 DeleteSizeMismatch : 1;  // delete_size_mismatch
     u32 QuarantineMaxChunkSize; // quarantine_max_chunk_size
+    u32 MaxBatchSize;           // max_batch_size
   } Options;
 
   // The following might get optimized out by the compiler.
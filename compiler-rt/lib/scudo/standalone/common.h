@@ -127,6 +127,11 @@ INLINE uptr getPageSizeCached() {
 
 u32 getNumberOfCPUs();
 
+// Returns the CPU the calling thread is running on, or UINT32_MAX if it can't
+// be determined. The thread can be migrated at any time, so the result is
+// only a hint.
+u32 getCurrentCPU();
+
 const char *getEnv(const char *Name);
 
 u64 getMonotonicTime();
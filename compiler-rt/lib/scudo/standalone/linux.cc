@@ -115,6 +115,13 @@ u32 getNumberOfCPUs() {
   return static_cast<u32>(CPU_COUNT(&CPUs));
 }
 
+u32 getCurrentCPU() {
+  // With a recent glibc, this reads the CPU number from the restartable
+  // sequences area of the thread, otherwise it goes through the vDSO.
+  const int CPU = sched_getcpu();
+  return CPU < 0 ? UINT32_MAX : static_cast<u32>(CPU);
+}
+
 // Blocking is possibly unused if the getrandom block is not compiled in.
 bool getRandom(void *Buffer, uptr Length, UNUSED bool Blocking) {
   if (!Buffer || !Length || Length > MaxRandomLength)
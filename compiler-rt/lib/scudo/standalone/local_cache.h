@@ -49,16 +49,20 @@ template <class SizeClassAllocator> struct SizeClassAllocatorLocalCache {
     void *Batch[MaxNumCached];
   };
 
-  void initLinkerInitialized(GlobalStats *S, SizeClassAllocator *A) {
+  // MaxBatchCount limits the number of chunks transferred at once from or to
+  // the primary, 0 uses the hint of the size class map.
+  void initLinkerInitialized(GlobalStats *S, SizeClassAllocator *A,
+                             u32 MaxBatchCount = 0) {
     Stats.initLinkerInitialized();
     if (S)
       S->link(&Stats);
     Allocator = A;
+    MaxBatch = MaxBatchCount;
   }
 
-  void init(GlobalStats *S, SizeClassAllocator *A) {
+  void init(GlobalStats *S, SizeClassAllocator *A, u32 MaxBatchCount = 0) {
     memset(this, 0, sizeof(*this));
-    initLinkerInitialized(S, A);
+    initLinkerInitialized(S, A, MaxBatchCount);
   }
 
   void destroy(GlobalStats *S) {
@@ -117,6 +121,14 @@ template <class SizeClassAllocator> struct SizeClassAllocatorLocalCache {
 
   LocalStats &getStats() { return Stats; }
 
+  // The number of chunks of the given size moved at once from or to the
+  // primary. The primary also fills its batches up to it, so that a refill
+  // never brings in more.
+  u32 getMaxCached(uptr Size) const {
+    const u32 MaxCached = TransferBatch::MaxCached(Size);
+    return MaxBatch ? Min(MaxCached, MaxBatch) : MaxCached;
+  }
+
 private:
   static const uptr NumClasses = SizeClassMap::NumClasses;
   struct PerClass {
@@ -128,6 +140,7 @@ private:
   PerClass PerClassArray[NumClasses];
   LocalStats Stats;
   SizeClassAllocator *Allocator;
+  u32 MaxBatch;
 
   ALWAYS_INLINE void initCacheMaybe(PerClass *C) {
     if (LIKELY(C->MaxCount))
@@ -140,7 +153,7 @@ private:
     for (uptr I = 0; I < NumClasses; I++) {
       PerClass *P = &PerClassArray[I];
       const uptr Size = SizeClassAllocator::getSizeByClassId(I);
-      P->MaxCount = 2 * TransferBatch::MaxCached(Size);
+      P->MaxCount = 2 * getMaxCached(Size);
       P->ClassSize = Size;
     }
   }
@@ -156,6 +169,7 @@ private:
     if (UNLIKELY(!B))
       return false;
     DCHECK_GT(B->getCount(), 0);
+    DCHECK_LE(B->getCount(), C->MaxCount / 2);
     B->copyToArray(C->Chunks);
     C->Count = B->getCount();
     destroyBatch(ClassId, B);
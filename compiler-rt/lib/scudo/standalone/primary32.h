@@ -262,13 +262,13 @@ private:
   }
 
   bool populateBatches(CacheT *C, SizeClassInfo *Sci, uptr ClassId,
-                       TransferBatch **CurrentBatch, u32 MaxCount,
+                       TransferBatch **CurrentBatch, u32 BatchCount,
                        void **PointersArray, u32 Count) {
     if (ClassId != SizeClassMap::BatchClassId)
       shuffle(PointersArray, Count, &Sci->RandState);
     TransferBatch *B = *CurrentBatch;
     for (uptr I = 0; I < Count; I++) {
-      if (B && B->getCount() == MaxCount) {
+      if (B && B->getCount() == BatchCount) {
         Sci->FreeList.push_back(B);
         B = nullptr;
       }
@@ -291,8 +291,8 @@ private:
       return nullptr;
     C->getStats().add(StatMapped, RegionSize);
     const uptr Size = getSizeByClassId(ClassId);
-    const u32 MaxCount = TransferBatch::MaxCached(Size);
-    DCHECK_GT(MaxCount, 0);
+    const u32 BatchCount = C->getMaxCached(Size);
+    DCHECK_GT(BatchCount, 0);
     const uptr NumberOfBlocks = RegionSize / Size;
     DCHECK_GT(NumberOfBlocks, 0);
     TransferBatch *B = nullptr;
@@ -303,15 +303,15 @@ private:
     for (uptr I = Region; I < Region + AllocatedUser; I += Size) {
       ShuffleArray[Count++] = reinterpret_cast<void *>(I);
       if (Count == ShuffleArraySize) {
-        if (UNLIKELY(!populateBatches(C, Sci, ClassId, &B, MaxCount,
+        if (UNLIKELY(!populateBatches(C, Sci, ClassId, &B, BatchCount,
                                       ShuffleArray, Count)))
           return nullptr;
         Count = 0;
       }
     }
     if (Count) {
-      if (UNLIKELY(!populateBatches(C, Sci, ClassId, &B, MaxCount, ShuffleArray,
-                                    Count)))
+      if (UNLIKELY(!populateBatches(C, Sci, ClassId, &B, BatchCount,
+                                    ShuffleArray, Count)))
         return nullptr;
     }
     DCHECK(B);
@@ -223,14 +223,14 @@ private:
   }
 
   bool populateBatches(CacheT *C, RegionInfo *Region, uptr ClassId,
-                       TransferBatch **CurrentBatch, u32 MaxCount,
+                       TransferBatch **CurrentBatch, u32 BatchCount,
                        void **PointersArray, u32 Count) {
     // No need to shuffle the batches size class.
     if (ClassId != SizeClassMap::BatchClassId)
       shuffle(PointersArray, Count, &Region->RandState);
     TransferBatch *B = *CurrentBatch;
     for (uptr I = 0; I < Count; I++) {
-      if (B && B->getCount() == MaxCount) {
+      if (B && B->getCount() == BatchCount) {
         Region->FreeList.push_back(B);
         B = nullptr;
       }
@@ -250,6 +250,7 @@ private:
                                            RegionInfo *Region) {
     const uptr Size = getSizeByClassId(ClassId);
     const u32 MaxCount = TransferBatch::MaxCached(Size);
+    const u32 BatchCount = C->getMaxCached(Size);
 
     const uptr RegionBeg = Region->RegionBeg;
     const uptr MappedUser = Region->MappedUser;
@@ -293,14 +294,14 @@ private:
     for (uptr I = P; I < P + AllocatedUser; I += Size) {
       ShuffleArray[Count++] = reinterpret_cast<void *>(I);
       if (Count == ShuffleArraySize) {
-        if (UNLIKELY(!populateBatches(C, Region, ClassId, &B, MaxCount,
+        if (UNLIKELY(!populateBatches(C, Region, ClassId, &B, BatchCount,
                                       ShuffleArray, Count)))
           return nullptr;
         Count = 0;
       }
     }
     if (Count) {
-      if (UNLIKELY(!populateBatches(C, Region, ClassId, &B, MaxCount,
+      if (UNLIKELY(!populateBatches(C, Region, ClassId, &B, BatchCount,
                                     ShuffleArray, Count)))
         return nullptr;
     }
@@ -20,7 +20,8 @@
 // 32-bit architectures. It's not something we want to encourage, but we still
 // should ensure the tests pass.
 
-template <typename Primary> static void testPrimary() {
+template <typename Primary>
+static void testPrimary(scudo::u32 MaxBatchCount = 0) {
   const scudo::uptr NumberOfAllocations = 32U;
   auto Deleter = [](Primary *P) {
     P->unmapTestOnly();
@@ -29,12 +30,19 @@ template <typename Primary> static void testPrimary() {
   std::unique_ptr<Primary, decltype(Deleter)> Allocator(new Primary, Deleter);
   Allocator->init(/*ReleaseToOsInterval=*/-1);
   typename Primary::CacheT Cache;
-  Cache.init(nullptr, Allocator.get());
+  Cache.init(nullptr, Allocator.get(), MaxBatchCount);
   for (scudo::uptr I = 0; I <= 16U; I++) {
     const scudo::uptr Size = 1UL << I;
     if (!Primary::canAllocate(Size))
       continue;
     const scudo::uptr ClassId = Primary::SizeClassMap::getClassIdBySize(Size);
+    if (MaxBatchCount) {
+      // The batches the cache gets from the primary respect the limit too.
+      auto *B = Allocator->popBatch(&Cache, ClassId);
+      ASSERT_NE(B, nullptr);
+      EXPECT_LE(B->getCount(), MaxBatchCount);
+      Allocator->pushBatch(ClassId, B);
+    }
     void *Pointers[NumberOfAllocations];
     for (scudo::uptr J = 0; J < NumberOfAllocations; J++) {
       void *P = Cache.allocate(ClassId);
@@ -55,6 +63,14 @@ TEST(ScudoPrimaryTest, BasicPrimary) {
   testPrimary<scudo::SizeClassAllocator64<SizeClassMap, 24U>>();
 }
 
+TEST(ScudoPrimaryTest, PrimaryLimitedBatchSize) {
+  using SizeClassMap = scudo::DefaultSizeClassMap;
+  testPrimary<scudo::SizeClassAllocator32<SizeClassMap, 18U>>(
+      /*MaxBatchCount=*/1U);
+  testPrimary<scudo::SizeClassAllocator64<SizeClassMap, 24U>>(
+      /*MaxBatchCount=*/3U);
+}
+
 // The 64-bit SizeClassAllocator can be easily OOM'd with small region sizes.
 // For the 32-bit one, it requires actually exhausting memory, so we skip it.
 TEST(ScudoPrimaryTest, Primary64OOM) {
@@ -9,6 +9,7 @@
 #ifndef SCUDO_TSD_SHARED_H_
 #define SCUDO_TSD_SHARED_H_
 
+#include "flags.h"
 #include "linux.h" // for getAndroidTlsPtr()
 #include "tsd.h"
 
@@ -21,6 +22,7 @@ template <class Allocator, u32 MaxTSDCount> struct TSDRegistrySharedT {
     Instance->initLinkerInitialized();
     CHECK_EQ(pthread_key_create(&PThreadKey, nullptr), 0); // For non-TLS
     NumberOfTSDs = Min(Max(1U, getNumberOfCPUs()), MaxTSDCount);
+    PerCPU = getFlags()->per_cpu_tsds && NumberOfTSDs > 1U;
     TSDs = reinterpret_cast<TSD<Allocator> *>(
         map(nullptr, sizeof(TSD<Allocator>) * NumberOfTSDs, "scudo:tsd"));
     for (u32 I = 0; I < NumberOfTSDs; I++)
@@ -63,6 +65,13 @@ template <class Allocator, u32 MaxTSDCount> struct TSDRegistrySharedT {
     TSD<Allocator> *TSD = getCurrentTSD();
     DCHECK(TSD);
     *UnlockRequired = true;
+    // Threads running on the same CPU only contend for its TSD when one of
+    // them is preempted while holding it, so prefer it to the assigned one.
+    if (PerCPU) {
+      const u32 CPU = getCurrentCPU();
+      if (LIKELY(CPU != UINT32_MAX))
+        TSD = &TSDs[CPU % NumberOfTSDs];
+    }
     // Try to lock the currently associated context.
     if (TSD->tryLock())
       return TSD;
@@ -148,6 +157,7 @@ private:
   pthread_key_t PThreadKey;
   atomic_u32 CurrentIndex;
   u32 NumberOfTSDs;
+  bool PerCPU;
   TSD<Allocator> *TSDs;
   u32 NumberOfCoPrimes;
   u32 CoPrimes[MaxTSDCount];
@@ -566,10 +566,10 @@ void SyncClock::DebugDump(int(*printf)(const char *s, ...)) {
   printf("] reused=[");
   for (uptr i = 0; i < size_; i++)
     printf("%s%llu", i == 0 ? "" : ",", elem(i).reused);
-  printf("] release_store_tid=%d/%d dirty_tids=%d[%llu]/%d[%llu]",
-      release_store_tid_, release_store_reused_,
-      dirty_[0].tid, dirty_[0].epoch,
-      dirty_[1].tid, dirty_[1].epoch);
+  printf("] release_store_tid=%d/%d dirty_tids=",
+      release_store_tid_, release_store_reused_);
+  for (uptr i = 0; i < kDirtyTids; i++)
+    printf("%s%d[%llu]", i == 0 ? "" : "/", dirty_[i].tid, dirty_[i].epoch);
 }
 
 void SyncClock::Iter::Next() {
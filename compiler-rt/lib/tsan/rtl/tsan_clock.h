@@ -62,7 +62,11 @@ class SyncClock {
  private:
   friend class ThreadClock;
   friend class Iter;
-  static const uptr kDirtyTids = 2;
+  // Number of threads whose latest release is kept out of line. While at most
+  // kDirtyTids distinct threads release into the clock between full
+  // operations, both release and acquire stay O(1) regardless of the clock
+  // size, which is what keeps programs with many mostly idle threads cheap.
+  static const uptr kDirtyTids = 4;
 
   struct Dirty {
     u64 epoch  : kClkBits;
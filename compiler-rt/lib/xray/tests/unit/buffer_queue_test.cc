@@ -17,6 +17,7 @@
 #include <future>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 namespace __xray {
 namespace {
@@ -120,6 +121,37 @@ TEST(BufferQueueTest, Apply) {
   ASSERT_EQ(Count, 10);
 }
 
+TEST(BufferQueueTest, StreamingWaitsForFlush) {
+  bool Success = false;
+  BufferQueue Buffers(kSize, 2, Success);
+  ASSERT_TRUE(Success);
+  Buffers.setStreaming(true);
+  BufferQueue::Buffer B;
+  for (int I = 0; I < 2; ++I) {
+    ASSERT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::Ok);
+    atomic_store(B.Extents, I + 1, memory_order_release);
+    ASSERT_EQ(Buffers.releaseBuffer(B), BufferQueue::ErrorCode::Ok);
+  }
+
+  // Both buffers are waiting to be flushed, so none can be handed out.
+  EXPECT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::NotEnoughMemory);
+
+  // The buffers are flushed in the order they were released.
+  std::vector<uint64_t> Extents;
+  EXPECT_EQ(Buffers.flushReleasedBuffers([&](const BufferQueue::Buffer &B) {
+    Extents.push_back(atomic_load(B.Extents, memory_order_acquire));
+  }),
+            2u);
+  EXPECT_THAT(Extents, ::testing::ElementsAre(1u, 2u));
+
+  ASSERT_EQ(Buffers.getBuffer(B), BufferQueue::ErrorCode::Ok);
+  ASSERT_EQ(Buffers.releaseBuffer(B), BufferQueue::ErrorCode::Ok);
+  EXPECT_EQ(Buffers.flushReleasedBuffers([](const BufferQueue::Buffer &) {}),
+            1u);
+  EXPECT_EQ(Buffers.flushReleasedBuffers([](const BufferQueue::Buffer &) {}),
+            0u);
+}
+
 TEST(BufferQueueTest, GenerationalSupport) {
   bool Success = false;
   BufferQueue Buffers(kSize, 10, Success);
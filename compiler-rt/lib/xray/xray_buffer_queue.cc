@@ -137,6 +137,9 @@ BufferQueue::ErrorCode BufferQueue::init(size_t BS, size_t BC) {
   Next = Buffers;
   First = Buffers;
   LiveBuffers = 0;
+  Streaming = false;
+  Unflushed = Buffers;
+  UnflushedBuffers = 0;
   atomic_store(&Finalizing, 0, memory_order_release);
   Success = true;
   return BufferQueue::ErrorCode::Ok;
@@ -154,6 +157,9 @@ BufferQueue::BufferQueue(size_t B, size_t N,
       Next(Buffers),
       First(Buffers),
       LiveBuffers(0),
+      Streaming(false),
+      Unflushed(Buffers),
+      UnflushedBuffers(0),
       Generation{0} {
   Success = init(B, N) == BufferQueue::ErrorCode::Ok;
 }
@@ -165,7 +171,9 @@ BufferQueue::ErrorCode BufferQueue::getBuffer(Buffer &Buf) {
   BufferRep *B = nullptr;
   {
     SpinMutexLock Guard(&Mutex);
-    if (LiveBuffers == BufferCount)
+    // In streaming mode, the buffers that are waiting to be flushed can't be
+    // handed out either.
+    if (LiveBuffers + UnflushedBuffers == BufferCount)
       return ErrorCode::NotEnoughMemory;
     B = Next++;
     if (Next == (Buffers + BufferCount))
@@ -202,11 +210,15 @@ BufferQueue::ErrorCode BufferQueue::releaseBuffer(Buffer &Buf) {
     B = First++;
     if (First == (Buffers + BufferCount))
       First = Buffers;
+
+    // Now that the buffer has been released, we mark it as "used". In
+    // streaming mode this has to happen before a flush can see the buffer.
+    B->Buff = Buf;
+    B->Used = true;
+    if (Streaming)
+      ++UnflushedBuffers;
   }
 
-  // Now that the buffer has been released, we mark it as "used".
-  B->Buff = Buf;
-  B->Used = true;
   decRefCount(Buf.BackingStore, Buf.Size, Buf.Count);
   decRefCount(Buf.ExtentsBackingStore, kExtentsSize, Buf.Count);
   atomic_store(B->Buff.Extents, atomic_load(Buf.Extents, memory_order_acquire),
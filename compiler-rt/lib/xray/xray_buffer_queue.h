@@ -159,6 +159,16 @@ private:
   // Count of buffers that have been handed out through 'getBuffer'.
   size_t LiveBuffers;
 
+  // Whether released buffers have to be written out through
+  // 'flushReleasedBuffers' before they are handed out again.
+  bool Streaming;
+
+  // Pointer to the oldest released buffer that has not been flushed yet.
+  BufferRep *Unflushed;
+
+  // Count of released buffers that have not been flushed yet.
+  size_t UnflushedBuffers;
+
   // We use a generation number to identify buffers and which generation they're
   // associated with.
   atomic_uint64_t Generation;
@@ -240,6 +250,43 @@ public:
   /// Returns the configured size of the buffers in the buffer queue.
   size_t ConfiguredBufferSize() const { return BufferSize; }
 
+  /// Enables or disables streaming mode. In streaming mode, a released buffer
+  /// is only handed out again by getBuffer(...) after it was passed to the
+  /// function given to flushReleasedBuffers(...). This is reset by init(...).
+  void setStreaming(bool S) XRAY_NEVER_INSTRUMENT {
+    SpinMutexLock G(&Mutex);
+    Streaming = S;
+  }
+
+  /// Applies the provided function F to each Buffer that was released and not
+  /// flushed yet, in the order they were released, and then makes them
+  /// available to getBuffer(...) again. The function is called without holding
+  /// the queue's lock, so that writing out the buffers does not block the
+  /// threads getting and releasing buffers. Only one thread may flush at a
+  /// time.
+  ///
+  /// Returns the number of buffers that were flushed.
+  template <class F> size_t flushReleasedBuffers(F Fn) XRAY_NEVER_INSTRUMENT {
+    BufferRep *B = nullptr;
+    size_t N = 0;
+    {
+      SpinMutexLock G(&Mutex);
+      B = Unflushed;
+      N = UnflushedBuffers;
+    }
+    for (size_t I = 0; I < N; ++I) {
+      Fn(static_cast<const Buffer &>(B->Buff));
+      if (++B == Buffers + BufferCount)
+        B = Buffers;
+    }
+    {
+      SpinMutexLock G(&Mutex);
+      Unflushed = B;
+      UnflushedBuffers -= N;
+    }
+    return N;
+  }
+
   /// Sets the state of the BufferQueue to finalizing, which ensures that:
   ///
   ///   - All subsequent attempts to retrieve a Buffer will fail.
@@ -89,6 +89,12 @@ static atomic_uint64_t TicksPerSec{0};
 static atomic_sint32_t LogFlushStatus = {
     XRayLogFlushStatus::XRAY_LOG_NOT_FLUSHING};
 
+// The log that the buffers are streamed to while tracing, when the
+// stream_interval_ms flag is set, and the thread that writes them.
+static LogWriter *StreamWriter = nullptr;
+static pthread_t StreamThread;
+static atomic_uint8_t StreamStopping{0};
+
 // This function will initialize the thread-local data structure used by the FDR
 // logging implementation and return a reference to it. The implementation
 // details require a bit of care to maintain.
@@ -275,6 +281,63 @@ XRayBuffer fdrIterator(const XRayBuffer B) {
   return Result;
 }
 
+static void writeBuffer(LogWriter *LW,
+                        const BufferQueue::Buffer &B) XRAY_NEVER_INSTRUMENT {
+  // Starting at version 2 of the FDR logging implementation, we only write
+  // the records identified by the extents of the buffer. We use the Extents
+  // from the Buffer and write that out as the first record in the buffer.  We
+  // still use a Metadata record, but fill in the extents instead for the
+  // data.
+  MetadataRecord ExtentsRecord;
+  auto BufferExtents = atomic_load(B.Extents, memory_order_acquire);
+  DCHECK(BufferExtents <= B.Size);
+  ExtentsRecord.Type = uint8_t(RecordType::Metadata);
+  ExtentsRecord.RecordKind =
+      uint8_t(MetadataRecord::RecordKinds::BufferExtents);
+  internal_memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
+  if (BufferExtents > 0) {
+    LW->WriteAll(reinterpret_cast<char *>(&ExtentsRecord),
+                 reinterpret_cast<char *>(&ExtentsRecord) +
+                     sizeof(MetadataRecord));
+    LW->WriteAll(reinterpret_cast<char *>(B.Data),
+                 reinterpret_cast<char *>(B.Data) + BufferExtents);
+  }
+}
+
+static void *streamBuffers(void *) XRAY_NEVER_INSTRUMENT {
+  const int IntervalMs = fdrFlags()->stream_interval_ms;
+  while (!atomic_load(&StreamStopping, memory_order_acquire)) {
+    SleepForMillis(IntervalMs);
+    BQ->flushReleasedBuffers([](const BufferQueue::Buffer &B) {
+      writeBuffer(StreamWriter, B);
+    });
+  }
+  return nullptr;
+}
+
+// Opens the log and starts the thread that writes the released buffers to it
+// while tracing. Returns false if streaming could not be set up.
+static bool startStreaming() XRAY_NEVER_INSTRUMENT {
+  StreamWriter = LogWriter::Open();
+  if (StreamWriter == nullptr)
+    return false;
+
+  XRayFileHeader Header = fdrCommonHeaderInfo();
+  Header.FdrData = FdrAdditionalHeaderData{BQ->ConfiguredBufferSize()};
+  StreamWriter->WriteAll(reinterpret_cast<char *>(&Header),
+                         reinterpret_cast<char *>(&Header) + sizeof(Header));
+
+  BQ->setStreaming(true);
+  atomic_store(&StreamStopping, 0, memory_order_release);
+  if (pthread_create(&StreamThread, nullptr, streamBuffers, nullptr) != 0) {
+    BQ->setStreaming(false);
+    LogWriter::Close(StreamWriter);
+    StreamWriter = nullptr;
+    return false;
+  }
+  return true;
+}
+
 // Must finalize before flushing.
 XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   if (atomic_load(&LoggingStatus, memory_order_acquire) !=
@@ -320,6 +383,24 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
       TLD.Controller->flush();
   });
 
+  // When streaming, most of the buffers were already written. Stop the
+  // streaming thread and write the rest, including the current thread's.
+  if (StreamWriter != nullptr) {
+    atomic_store(&StreamStopping, 1, memory_order_release);
+    pthread_join(StreamThread, nullptr);
+    auto &TLD = getThreadLocalData();
+    if (TLD.Controller != nullptr)
+      TLD.Controller->flush();
+    BQ->flushReleasedBuffers([](const BufferQueue::Buffer &B) {
+      writeBuffer(StreamWriter, B);
+    });
+    LogWriter::Close(StreamWriter);
+    StreamWriter = nullptr;
+    atomic_store(&LogFlushStatus, XRayLogFlushStatus::XRAY_LOG_FLUSHED,
+                 memory_order_release);
+    return XRayLogFlushStatus::XRAY_LOG_FLUSHED;
+  }
+
   if (fdrFlags()->no_file_flush) {
     if (Verbosity())
       Report("XRay FDR: Not flushing to file, 'no_file_flush=true'.\n");
@@ -357,27 +438,7 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   if (TLD.Controller != nullptr)
     TLD.Controller->flush();
 
-  BQ->apply([&](const BufferQueue::Buffer &B) {
-    // Starting at version 2 of the FDR logging implementation, we only write
-    // the records identified by the extents of the buffer. We use the Extents
-    // from the Buffer and write that out as the first record in the buffer.  We
-    // still use a Metadata record, but fill in the extents instead for the
-    // data.
-    MetadataRecord ExtentsRecord;
-    auto BufferExtents = atomic_load(B.Extents, memory_order_acquire);
-    DCHECK(BufferExtents <= B.Size);
-    ExtentsRecord.Type = uint8_t(RecordType::Metadata);
-    ExtentsRecord.RecordKind =
-        uint8_t(MetadataRecord::RecordKinds::BufferExtents);
-    internal_memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
-    if (BufferExtents > 0) {
-      LW->WriteAll(reinterpret_cast<char *>(&ExtentsRecord),
-                   reinterpret_cast<char *>(&ExtentsRecord) +
-                       sizeof(MetadataRecord));
-      LW->WriteAll(reinterpret_cast<char *>(B.Data),
-                   reinterpret_cast<char *>(B.Data) + BufferExtents);
-    }
-  });
+  BQ->apply([&](const BufferQueue::Buffer &B) { writeBuffer(LW, B); });
 
   atomic_store(&LogFlushStatus, XRayLogFlushStatus::XRAY_LOG_FLUSHED,
                memory_order_release);
@@ -705,6 +766,11 @@ XRayLogInitStatus fdrLoggingInit(size_t, size_t, void *Options,
                atomic_load_relaxed(&TicksPerSec) *
                    fdrFlags()->func_duration_threshold_us / 1000000,
                memory_order_release);
+
+  if (fdrFlags()->stream_interval_ms > 0 && !fdrFlags()->no_file_flush &&
+      !startStreaming())
+    Report("XRay FDR: Failed to start streaming; buffers will be written "
+           "when the log is flushed.\n");
   // Arg1 handler should go in first to avoid concurrent code accidentally
   // falling back to arg0 when it should have ran arg1.
   __xray_set_handler_arg1(fdrLoggingHandleArg1);
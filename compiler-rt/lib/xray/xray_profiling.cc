@@ -71,6 +71,67 @@ thread_local atomic_uint8_t TLDInitGuard{0};
 // non-essential work should be ignored (things like recording events, etc.).
 thread_local atomic_uint8_t ThreadExitingLatch{0};
 
+// When sampling, each thread records into its FunctionCallTrie during a window
+// at the start of every sampling period. The window length and the period are
+// in TSC ticks, and a zero period means every event is recorded.
+static atomic_uint64_t SamplePeriodTicks{0};
+static atomic_uint64_t SampleWindowTicks{0};
+
+// The call depth of the thread is tracked even outside the sampling windows,
+// so that the trie only sees balanced entries and exits. The frames in
+// (RecordedBase, RecordedTop] are the ones that were entered into the trie.
+// When a window ends with frames still recorded, their exits keep being
+// recorded, while the deeper frames are not.
+struct SamplingState {
+  s64 Depth;
+  s64 RecordedBase;
+  s64 RecordedTop;
+  bool InWindow;
+  u64 WindowEnd;
+  u64 NextWindow;
+};
+thread_local SamplingState Sampling{0, 0, 0, false, 0, 0};
+
+// Returns true if the entry or exit at TSC should be recorded into the trie.
+static bool shouldRecord(XRayEntryType Entry,
+                         uint64_t TSC) XRAY_NEVER_INSTRUMENT {
+  auto Period = atomic_load_relaxed(&SamplePeriodTicks);
+  if (LIKELY(Period == 0))
+    return true;
+
+  auto &S = Sampling;
+  switch (Entry) {
+  case XRayEntryType::ENTRY:
+  case XRayEntryType::LOG_ARGS_ENTRY: {
+    ++S.Depth;
+    if (S.InWindow && TSC >= S.WindowEnd)
+      S.InWindow = false;
+    if (S.RecordedTop == S.RecordedBase && !S.InWindow &&
+        TSC >= S.NextWindow) {
+      auto Window = atomic_load_relaxed(&SampleWindowTicks);
+      S.InWindow = Window != 0;
+      S.WindowEnd = TSC + Window;
+      S.NextWindow = TSC + Period;
+      S.RecordedBase = S.RecordedTop = S.Depth - 1;
+    }
+    if (!S.InWindow || S.Depth != S.RecordedTop + 1)
+      return false;
+    S.RecordedTop = S.Depth;
+    return true;
+  }
+  case XRayEntryType::EXIT:
+  case XRayEntryType::TAIL: {
+    bool Record = S.RecordedTop > S.RecordedBase && S.Depth == S.RecordedTop;
+    if (Record)
+      --S.RecordedTop;
+    --S.Depth;
+    return Record;
+  }
+  default:
+    return false;
+  }
+}
+
 static ProfilingData *getThreadLocalData() XRAY_NEVER_INSTRUMENT {
   thread_local auto ThreadOnce = []() XRAY_NEVER_INSTRUMENT {
     pthread_setspecific(ProfilingKey, &TLD);
@@ -192,6 +253,11 @@ static void postCurrentThreadFCT(ProfilingData &T) XRAY_NEVER_INSTRUMENT {
 
   // Re-initialize the ThreadBuffers object to a known "default" state.
   ThreadBuffers = FunctionCallTrie::Allocators::Buffers{};
+
+  // The frames recorded into the posted trie must not be exited from the next
+  // one.
+  Sampling.RecordedBase = Sampling.RecordedTop = Sampling.Depth;
+  Sampling.InWindow = false;
 }
 
 } // namespace
@@ -287,6 +353,9 @@ void profilingHandleArg0(int32_t FuncId,
     return;
   }
 
+  if (!shouldRecord(Entry, TSC))
+    return;
+
   auto T = getThreadLocalData();
   if (T == nullptr)
     return;
@@ -384,6 +453,27 @@ profilingLoggingInit(size_t, size_t, void *Options,
     *profilingFlags() = Flags;
   }
 
+  // Convert the sampling configuration into TSC ticks, so that the handlers
+  // only need to compare against the TSC they already read.
+  {
+    auto Percent = profilingFlags()->sample_percent;
+    auto PeriodMs = profilingFlags()->sample_period_ms;
+    uint64_t Period = 0;
+    uint64_t Window = 0;
+    if (Percent < 100 && PeriodMs > 0) {
+      uint64_t TicksPerSec = getTSCFrequency();
+      if (TicksPerSec == 0)
+        TicksPerSec = NanosecondsPerSecond;
+      Period = TicksPerSec / 1000 * PeriodMs;
+      Window = Percent > 0 ? Period / 100 * Percent : 0;
+      if (Verbosity())
+        Report("XRay Profiling: sampling %d%% of every %d ms.\n", Percent,
+               PeriodMs);
+    }
+    atomic_store(&SampleWindowTicks, Window, memory_order_release);
+    atomic_store(&SamplePeriodTicks, Period, memory_order_release);
+  }
+
   // We need to reset the profile data collection implementation now.
   profileCollectorService::reset();
 
@@ -0,0 +1,32 @@
+// RUN: %clang_profgen -mllvm -instrprof-per-thread-counters -o %t -O2 %s -pthread
+// RUN: env LLVM_PROFILE_FILE=%t.profraw %run %t
+// RUN: llvm-profdata merge -o %t.profdata %t.profraw
+// RUN: llvm-profdata show --function=foo --counts %t.profdata | FileCheck %s
+
+// Each thread updates its own copy of the counters, which are added up when
+// the profile is written.
+
+#include <pthread.h>
+
+__attribute__((noinline)) void foo(int N) {
+  if (N)
+    __asm__ volatile("");
+}
+
+static void *run(void *Arg) {
+  for (int I = 0; I < 100000; ++I)
+    foo(I & 1);
+  return 0;
+}
+
+int main(void) {
+  pthread_t Threads[8];
+  for (int I = 0; I < 8; ++I)
+    pthread_create(&Threads[I], 0, run, 0);
+  for (int I = 0; I < 8; ++I)
+    pthread_join(Threads[I], 0);
+  return 0;
+}
+
+// CHECK: Function count: 800000
+// CHECK: Block counts: [400000]
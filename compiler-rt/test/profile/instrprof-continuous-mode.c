@@ -0,0 +1,27 @@
+// REQUIRES: linux
+// RUN: %clang_profgen -mllvm -runtime-counter-relocation -o %t -O3 %s
+// RUN: rm -f %t.profraw
+// RUN: env LLVM_PROFILE_FILE=%t%c.profraw not --crash %run %t
+// RUN: llvm-profdata merge -o %t.profdata %t.profraw
+// RUN: %clang_profuse=%t.profdata -o - -S -emit-llvm %s | FileCheck %s
+
+// The process is killed before the profile is written at exit, so the counts
+// come from the counters mapped onto the profile file.
+
+#include <signal.h>
+#include <unistd.h>
+
+void foo(int);
+int main(void) {
+  foo(0);
+  foo(0);
+  foo(1);
+  kill(getpid(), SIGKILL);
+  return 0;
+}
+void foo(int N) {
+  // CHECK-LABEL: define{{( dso_local)?}} void @foo(
+  // CHECK: br i1 %{{.*}}, label %{{.*}}, label %{{.*}}, !prof ![[FOO:[0-9]+]]
+  if (N) {}
+}
+// CHECK: ![[FOO]] = !{!"branch_weights", i32 2, i32 3}
@@ -49,6 +49,26 @@ static void BM_StringFindMatch2(benchmark::State &state) {
 }
 BENCHMARK(BM_StringFindMatch2)->Range(1, MAX_STRING_LEN / 4);
 
+// Benchmark when the first character of the pattern occurs often, as the
+// spaces of a log line do.
+static void BM_StringFindFrequentFirstChar(benchmark::State &state) {
+  std::string s1;
+  while (s1.size() < static_cast<std::size_t>(state.range(0)))
+    s1 += "GET /index.html 200 INFO user=42 ";
+  std::string s2(" ERROR ");
+  for (auto _ : state)
+    benchmark::DoNotOptimize(s1.find(s2));
+}
+BENCHMARK(BM_StringFindFrequentFirstChar)->Range(16, MAX_STRING_LEN);
+
+// Benchmark find_first_of with a set of several characters and no match.
+static void BM_StringFindFirstOfNoMatch(benchmark::State &state) {
+  std::string s1(state.range(0), '-');
+  for (auto _ : state)
+    benchmark::DoNotOptimize(s1.find_first_of("=;,\t"));
+}
+BENCHMARK(BM_StringFindFirstOfNoMatch)->Range(16, MAX_STRING_LEN);
+
 static void BM_StringCtorDefault(benchmark::State &state) {
   for (auto _ : state) {
     std::string Default;
@@ -0,0 +1,6 @@
+// Runs the unordered_map benchmarks with the bucket tags of the unstable ABI,
+// for comparison with the results of unordered_map_operations.
+
+#define _LIBCPP_ABI_HASH_TABLE_BUCKET_TAGS
+
+#include "unordered_map_operations.bench.cpp"
@@ -0,0 +1,80 @@
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "benchmark/benchmark.h"
+
+#include "GenerateInput.hpp"
+
+// The keys at the odd positions of the inputs are only used as missing keys,
+// so both the hit and the miss benchmarks use maps with half of the inputs.
+
+template <class Map, class GenInputs>
+void BM_MapFindHit(benchmark::State& st, Map m, GenInputs gen) {
+    auto in = gen(st.range(0));
+    for (std::size_t i = 0; i < in.size(); i += 2)
+        m[in[i]];
+    const auto end = in.data() + in.size();
+    while (st.KeepRunning()) {
+        for (auto it = in.data(); it < end; it += 2) {
+            benchmark::DoNotOptimize(m.find(*it));
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+template <class Map, class GenInputs>
+void BM_MapFindMiss(benchmark::State& st, Map m, GenInputs gen) {
+    auto in = gen(st.range(0));
+    for (std::size_t i = 0; i < in.size(); i += 2)
+        m[in[i]];
+    const auto end = in.data() + in.size();
+    while (st.KeepRunning()) {
+        for (auto it = in.data() + 1; it < end; it += 2) {
+            benchmark::DoNotOptimize(m.find(*it));
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+template <class Map, class GenInputs>
+void BM_MapSubscript(benchmark::State& st, Map m, GenInputs gen) {
+    auto in = gen(st.range(0));
+    const auto end = in.data() + in.size();
+    while (st.KeepRunning()) {
+        m.clear();
+        for (auto it = in.data(); it != end; ++it) {
+            benchmark::DoNotOptimize(&m[*it]);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+BENCHMARK_CAPTURE(BM_MapFindHit,
+    unordered_map_random_uint64,
+    std::unordered_map<uint64_t, uint64_t>{},
+    getRandomIntegerInputs<uint64_t>)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK_CAPTURE(BM_MapFindMiss,
+    unordered_map_random_uint64,
+    std::unordered_map<uint64_t, uint64_t>{},
+    getRandomIntegerInputs<uint64_t>)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK_CAPTURE(BM_MapSubscript,
+    unordered_map_random_uint64,
+    std::unordered_map<uint64_t, uint64_t>{},
+    getRandomIntegerInputs<uint64_t>)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20);
+
+BENCHMARK_CAPTURE(BM_MapFindHit,
+    unordered_map_string,
+    std::unordered_map<std::string, uint64_t>{},
+    getRandomStringInputs)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK_CAPTURE(BM_MapFindMiss,
+    unordered_map_string,
+    std::unordered_map<std::string, uint64_t>{},
+    getRandomStringInputs)->Arg(1 << 10)->Arg(1 << 16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+//===------------------------- atomic.cpp ---------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "__config"
+#ifndef _LIBCPP_HAS_NO_THREADS
+
+#include "atomic"
+#include "chrono"
+#include "climits"
+#include "include/atomic_support.h"
+#include "include/atomic_wait.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include "condition_variable"
+#include "mutex"
+#endif
+
+#if defined(__unix__) &&  defined(__ELF__) && defined(_LIBCPP_HAS_COMMENT_LIB_PRAGMA)
+#pragma comment(lib, "pthread")
+#endif
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace {
+
+// Every address that is waited on maps to one entry of a fixed table. An entry
+// counts the notifications of all the addresses that share it in __version_,
+// and its sleeping threads in __waiters_ so that a notification with nobody to
+// wake stays in user space. Waking the threads of an unrelated address that
+// shares the entry is harmless, since waiters check their value again.
+struct alignas(64) __libcpp_contention_table_entry
+{
+    __cxx_contention_t __version_ = 0;
+    __cxx_contention_t __waiters_ = 0;
+#if !defined(__linux__)
+    mutex              __mut_;
+    condition_variable __cv_;
+#endif
+};
+
+const size_t __libcpp_contention_table_size = 256;
+
+__libcpp_contention_table_entry __libcpp_contention_table[__libcpp_contention_table_size];
+
+__libcpp_contention_table_entry*
+__libcpp_contention_state(void const volatile* __location)
+{
+    uintptr_t __h = reinterpret_cast<uintptr_t>(__location);
+    __h = (__h >> 2) ^ (__h >> 10);
+    return &__libcpp_contention_table[__h % __libcpp_contention_table_size];
+}
+
+void
+__libcpp_contention_wait(__libcpp_contention_table_entry* __entry,
+                         __cxx_contention_t __old,
+                         chrono::nanoseconds const* __rel_time)
+{
+    // The increment of __waiters_ is ordered before the version is compared
+    // below, and a notifier increments the version before reading
+    // __waiters_, so one of the two sees the other.
+    __libcpp_atomic_add(&__entry->__waiters_, 1, _AO_Seq);
+#if defined(__linux__)
+    timespec __ts;
+    timespec* __timeout = nullptr;
+    if (__rel_time != nullptr)
+    {
+        chrono::seconds __s = chrono::duration_cast<chrono::seconds>(*__rel_time);
+        __ts.tv_sec = static_cast<time_t>(__s.count());
+        __ts.tv_nsec = static_cast<long>((*__rel_time - __s).count());
+        __timeout = &__ts;
+    }
+    syscall(SYS_futex, &__entry->__version_, FUTEX_WAIT_PRIVATE, __old,
+            __timeout, 0, 0);
+#else
+    unique_lock<mutex> __lk(__entry->__mut_);
+    if (__rel_time != nullptr)
+    {
+        if (__libcpp_atomic_load(&__entry->__version_, _AO_Seq) == __old)
+            __entry->__cv_.wait_for(__lk, *__rel_time);
+    }
+    else
+    {
+        while (__libcpp_atomic_load(&__entry->__version_, _AO_Seq) == __old)
+            __entry->__cv_.wait(__lk);
+    }
+#endif
+    __libcpp_atomic_add(&__entry->__waiters_, -1, _AO_Release);
+}
+
+void
+__libcpp_contention_notify(__libcpp_contention_table_entry* __entry)
+{
+    __libcpp_atomic_add(&__entry->__version_, 1, _AO_Seq);
+    if (__libcpp_atomic_load(&__entry->__waiters_, _AO_Seq) == 0)
+        return;
+#if defined(__linux__)
+    syscall(SYS_futex, &__entry->__version_, FUTEX_WAKE_PRIVATE, INT_MAX,
+            0, 0, 0);
+#else
+    // A waiter compares the version while holding the mutex, so taking it
+    // here makes sure it is either asleep or sees the new version.
+    { lock_guard<mutex> __lk(__entry->__mut_); }
+    __entry->__cv_.notify_all();
+#endif
+}
+
+} // namespace
+
+__cxx_contention_t
+__libcpp_atomic_monitor(void const volatile* __location) _NOEXCEPT
+{
+    return __libcpp_atomic_load(&__libcpp_contention_state(__location)->__version_,
+                                _AO_Seq);
+}
+
+void
+__libcpp_atomic_wait(void const volatile* __location, __cxx_contention_t __old) _NOEXCEPT
+{
+    __libcpp_contention_wait(__libcpp_contention_state(__location), __old, nullptr);
+}
+
+void
+__libcpp_atomic_wait_for(void const volatile* __location, __cxx_contention_t __old,
+                         chrono::nanoseconds __rel_time) _NOEXCEPT
+{
+    if (__rel_time <= chrono::nanoseconds::zero())
+        return;
+    __libcpp_contention_wait(__libcpp_contention_state(__location), __old, &__rel_time);
+}
+
+// Other addresses may share the entry of __location, so a single wakeup could
+// go to a thread that is not waiting for it; notify_one wakes them all.
+void
+__cxx_atomic_notify_one(void const volatile* __location) _NOEXCEPT
+{
+    __libcpp_contention_notify(__libcpp_contention_state(__location));
+}
+
+void
+__cxx_atomic_notify_all(void const volatile* __location) _NOEXCEPT
+{
+    __libcpp_contention_notify(__libcpp_contention_state(__location));
+}
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // !_LIBCPP_HAS_NO_THREADS
@@ -7,8 +7,15 @@
 //===----------------------------------------------------------------------===//
 
 #include "charconv"
+#include "bit"
+#include "locale"
+#include "string"
+#include <errno.h>
+#include <float.h>
 #include <string.h>
 
+#include "include/charconv_tables.h"
+
 _LIBCPP_BEGIN_NAMESPACE_STD
 
 namespace __itoa
@@ -157,4 +164,1230 @@ __u64toa(uint64_t value, char* buffer)
 
 }  // namespace __itoa
 
+namespace __floating_point
+{
+
+template <class _Fp>
+struct __traits;
+
+template <>
+struct __traits<float>
+{
+    typedef uint32_t __bits_type;
+    static const int __mantissa_bits = 23;
+    static const int __exponent_bits = 8;
+    static const int __bias = 127;
+    // A conversion of a mantissa up to __max_exact_mantissa followed by one
+    // multiplication or division by an exact power of ten is correctly
+    // rounded.
+    static const int __max_exact_pow10 = 10;
+    static const uint64_t __max_exact_mantissa = uint64_t(1) << 24;
+    // The powers of ten that __eisel_lemire handles, and those for which a
+    // product can be exactly halfway between two values.
+    static const int __min_pow10 = -65;
+    static const int __max_pow10 = 38;
+    static const int __min_round_to_even = -17;
+    static const int __max_round_to_even = 10;
+};
+
+template <>
+struct __traits<double>
+{
+    typedef uint64_t __bits_type;
+    static const int __mantissa_bits = 52;
+    static const int __exponent_bits = 11;
+    static const int __bias = 1023;
+    static const int __max_exact_pow10 = 22;
+    static const uint64_t __max_exact_mantissa = uint64_t(1) << 53;
+    static const int __min_pow10 = -342;
+    static const int __max_pow10 = 308;
+    static const int __min_round_to_even = -4;
+    static const int __max_round_to_even = 23;
+};
+
+static const double __exact_pow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+inline uint64_t
+__umul128(uint64_t __a, uint64_t __b, uint64_t* __high)
+{
+#ifndef _LIBCPP_HAS_NO_INT128
+    const __uint128_t __p = static_cast<__uint128_t>(__a) * __b;
+    *__high = static_cast<uint64_t>(__p >> 64);
+    return static_cast<uint64_t>(__p);
+#else
+    const uint64_t __a_lo = static_cast<uint32_t>(__a), __a_hi = __a >> 32;
+    const uint64_t __b_lo = static_cast<uint32_t>(__b), __b_hi = __b >> 32;
+    const uint64_t __ll = __a_lo * __b_lo, __lh = __a_lo * __b_hi;
+    const uint64_t __hl = __a_hi * __b_lo, __hh = __a_hi * __b_hi;
+    const uint64_t __mid = (__ll >> 32) + static_cast<uint32_t>(__lh) +
+                           static_cast<uint32_t>(__hl);
+    *__high = __hh + (__lh >> 32) + (__hl >> 32) + (__mid >> 32);
+    return (__mid << 32) | static_cast<uint32_t>(__ll);
+#endif
+}
+
+// Shortest round-trip output, with the Ryu algorithm (Ulf Adams, "Ryu: Fast
+// Float-to-String Conversion", PLDI 2018). float uses the double tables,
+// whose range covers the exponents of a float.
+
+static const int __pow5_inv_bits = 125;
+static const int __pow5_bits = 125;
+
+// ceil(log2(5^__e)), or 1 for 0.
+inline int32_t __pow5bits(int32_t __e)
+{
+    return static_cast<int32_t>((static_cast<uint32_t>(__e) * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^__e))
+inline uint32_t __log10_pow2(int32_t __e)
+{
+    return (static_cast<uint32_t>(__e) * 78913) >> 18;
+}
+
+// floor(log10(5^__e))
+inline uint32_t __log10_pow5(int32_t __e)
+{
+    return (static_cast<uint32_t>(__e) * 732923) >> 20;
+}
+
+inline bool __multiple_of_pow5(uint64_t __v, uint32_t __p)
+{
+    uint32_t __count = 0;
+    for (; __v % 5 == 0; __v /= 5)
+        ++__count;
+    return __count >= __p;
+}
+
+inline bool __multiple_of_pow2(uint64_t __v, uint32_t __p)
+{
+    return (__v & ((uint64_t(1) << __p) - 1)) == 0;
+}
+
+// (__m * __mul) >> __j, where __mul is a 128-bit {low, high} pair and
+// 64 < __j < 128.
+inline uint64_t __mul_shift(uint64_t __m, const uint64_t* __mul, int32_t __j)
+{
+    uint64_t __high0;
+    __umul128(__m, __mul[0], &__high0);
+    uint64_t __high1;
+    const uint64_t __low1 = __umul128(__m, __mul[1], &__high1);
+    const uint64_t __sum = __high0 + __low1;
+    if (__sum < __high0)
+        ++__high1;
+    const int32_t __dist = __j - 64;
+    return (__high1 << (64 - __dist)) | (__sum >> __dist);
+}
+
+struct __decimal
+{
+    uint64_t __mantissa;
+    int32_t __exponent;
+};
+
+// Returns the shortest __mantissa * 10^__exponent that reads back as the
+// finite nonzero value with the given IEEE mantissa and biased exponent.
+template <class _Fp>
+__decimal __shortest(uint64_t __ieee_m, uint32_t __ieee_e)
+{
+    typedef __traits<_Fp> _Tr;
+    int32_t __e2;
+    uint64_t __m2;
+    if (__ieee_e == 0)
+    {
+        __e2 = 1 - _Tr::__bias - _Tr::__mantissa_bits - 2;
+        __m2 = __ieee_m;
+    }
+    else
+    {
+        __e2 = static_cast<int32_t>(__ieee_e) - _Tr::__bias -
+               _Tr::__mantissa_bits - 2;
+        __m2 = (uint64_t(1) << _Tr::__mantissa_bits) | __ieee_m;
+    }
+    // The bounds of the interval that rounds to the value are included when
+    // its mantissa is even.
+    const bool __accept_bounds = (__m2 & 1) == 0;
+
+    // The value and the bounds, times 4 * 2^__e2. The lower bound is closer
+    // at the powers of two, whose predecessor has a smaller exponent.
+    const uint64_t __mv = 4 * __m2;
+    const uint32_t __mm_shift = __ieee_m != 0 || __ieee_e <= 1;
+
+    uint64_t __vr, __vp, __vm;
+    int32_t __e10;
+    bool __vm_is_trailing_zeros = false;
+    bool __vr_is_trailing_zeros = false;
+    if (__e2 >= 0)
+    {
+        const uint32_t __q = __log10_pow2(__e2) - (__e2 > 3);
+        __e10 = static_cast<int32_t>(__q);
+        const int32_t __k = __pow5_inv_bits + __pow5bits(__q) - 1;
+        const int32_t __i = -__e2 + static_cast<int32_t>(__q) + __k;
+        const uint64_t* __mul = __pow5_inv_split[__q];
+        __vr = __mul_shift(__mv, __mul, __i);
+        __vp = __mul_shift(__mv + 2, __mul, __i);
+        __vm = __mul_shift(__mv - 1 - __mm_shift, __mul, __i);
+        if (__q <= 21)
+        {
+            // Only the values that are multiples of 5^__q can have trailing
+            // zeros that the loops below need to know about.
+            if (__mv % 5 == 0)
+                __vr_is_trailing_zeros = __multiple_of_pow5(__mv, __q);
+            else if (__accept_bounds)
+                __vm_is_trailing_zeros =
+                    __multiple_of_pow5(__mv - 1 - __mm_shift, __q);
+            else
+                __vp -= __multiple_of_pow5(__mv + 2, __q);
+        }
+    }
+    else
+    {
+        const uint32_t __q = __log10_pow5(-__e2) - (-__e2 > 1);
+        __e10 = static_cast<int32_t>(__q) + __e2;
+        const int32_t __i = -__e2 - static_cast<int32_t>(__q);
+        const int32_t __k = __pow5bits(__i) - __pow5_bits;
+        const int32_t __j = static_cast<int32_t>(__q) - __k;
+        const uint64_t* __mul = __pow5_split[__i];
+        __vr = __mul_shift(__mv, __mul, __j);
+        __vp = __mul_shift(__mv + 2, __mul, __j);
+        __vm = __mul_shift(__mv - 1 - __mm_shift, __mul, __j);
+        if (__q <= 1)
+        {
+            // __mv has at least __q trailing zero bits, so all three are
+            // integers with trailing decimal zeros.
+            __vr_is_trailing_zeros = true;
+            if (__accept_bounds)
+                __vm_is_trailing_zeros = __mm_shift == 1;
+            else
+                --__vp;
+        }
+        else if (__q < 63)
+            __vr_is_trailing_zeros = __multiple_of_pow2(__mv, __q);
+    }
+
+    // Remove the digits that the bounds share with the value, and round.
+    int32_t __removed = 0;
+    uint32_t __last_removed = 0;
+    uint64_t __output;
+    if (__vm_is_trailing_zeros || __vr_is_trailing_zeros)
+    {
+        for (;;)
+        {
+            const uint64_t __vp10 = __vp / 10;
+            const uint64_t __vm10 = __vm / 10;
+            if (__vp10 <= __vm10)
+                break;
+            const uint64_t __vr10 = __vr / 10;
+            __vm_is_trailing_zeros &= __vm - 10 * __vm10 == 0;
+            __vr_is_trailing_zeros &= __last_removed == 0;
+            __last_removed = static_cast<uint32_t>(__vr - 10 * __vr10);
+            __vr = __vr10;
+            __vp = __vp10;
+            __vm = __vm10;
+            ++__removed;
+        }
+        if (__vm_is_trailing_zeros)
+        {
+            for (;;)
+            {
+                const uint64_t __vm10 = __vm / 10;
+                if (__vm - 10 * __vm10 != 0)
+                    break;
+                const uint64_t __vr10 = __vr / 10;
+                __vr_is_trailing_zeros &= __last_removed == 0;
+                __last_removed = static_cast<uint32_t>(__vr - 10 * __vr10);
+                __vr = __vr10;
+                __vp /= 10;
+                __vm = __vm10;
+                ++__removed;
+            }
+        }
+        // Round exact halves to even.
+        if (__vr_is_trailing_zeros && __last_removed == 5 && __vr % 2 == 0)
+            __last_removed = 4;
+        __output = __vr + ((__vr == __vm &&
+                            (!__accept_bounds || !__vm_is_trailing_zeros)) ||
+                           __last_removed >= 5);
+    }
+    else
+    {
+        // The common case, where no exact halves are possible.
+        bool __round_up = false;
+        const uint64_t __vp100 = __vp / 100;
+        const uint64_t __vm100 = __vm / 100;
+        if (__vp100 > __vm100)
+        {
+            const uint64_t __vr100 = __vr / 100;
+            __round_up = __vr - 100 * __vr100 >= 50;
+            __vr = __vr100;
+            __vp = __vp100;
+            __vm = __vm100;
+            __removed += 2;
+        }
+        for (;;)
+        {
+            const uint64_t __vp10 = __vp / 10;
+            const uint64_t __vm10 = __vm / 10;
+            if (__vp10 <= __vm10)
+                break;
+            const uint64_t __vr10 = __vr / 10;
+            __round_up = __vr - 10 * __vr10 >= 5;
+            __vr = __vr10;
+            __vp = __vp10;
+            __vm = __vm10;
+            ++__removed;
+        }
+        __output = __vr + (__vr == __vm || __round_up);
+    }
+    __decimal __d = {__output, __e10 + __removed};
+    return __d;
+}
+
+// Writes the integer __m * 2^__e, where __e > 0 and the result is below
+// 10^315, in decimal, and returns the number of digits.
+inline int __write_integer(char* __buffer, uint64_t __m, int __e)
+{
+    // Base 10^9 limbs, least significant first.
+    const uint32_t __base = 1000000000;
+    uint32_t __limbs[36];
+    int __n = 0;
+    for (; __m != 0; __m /= __base)
+        __limbs[__n++] = static_cast<uint32_t>(__m % __base);
+    while (__e > 0)
+    {
+        const int __shift = __e < 29 ? __e : 29;
+        uint64_t __carry = 0;
+        for (int __i = 0; __i < __n; ++__i)
+        {
+            const uint64_t __v =
+                (static_cast<uint64_t>(__limbs[__i]) << __shift) + __carry;
+            __limbs[__i] = static_cast<uint32_t>(__v % __base);
+            __carry = __v / __base;
+        }
+        if (__carry != 0)
+            __limbs[__n++] = static_cast<uint32_t>(__carry);
+        __e -= __shift;
+    }
+    char* __p = __itoa::__u32toa(__limbs[__n - 1], __buffer);
+    for (int __i = __n - 2; __i >= 0; --__i, __p += 9)
+        for (int __j = 8; __j >= 0; --__j, __limbs[__i] /= 10)
+            __p[__j] = static_cast<char>('0' + __limbs[__i] % 10);
+    return static_cast<int>(__p - __buffer);
+}
+
+inline to_chars_result
+__write_string(char* __first, char* __last, const char* __s, size_t __n)
+{
+    if (static_cast<size_t>(__last - __first) < __n)
+        return {__last, errc::value_too_large};
+    memcpy(__first, __s, __n);
+    return {__first + __n, errc()};
+}
+
+inline int __scientific_length(int __n, int __x)
+{
+    const int __ax = __x < 0 ? -__x : __x;
+    return __n + (__n > 1) + 2 + (__ax >= 1000 ? 4 : __ax >= 100 ? 3 : 2);
+}
+
+inline int __fixed_length(int __n, int __x)
+{
+    if (__x >= __n - 1)
+        return __x + 1;
+    if (__x < 0)
+        return __n + 1 - __x;
+    return __n + 1;
+}
+
+// The decimal writers take the __n significant digits of a value
+// d.ddd * 10^__x.
+
+inline to_chars_result
+__write_scientific(char* __first, char* __last, const char* __digits, int __n,
+                   int __x)
+{
+    if (__last - __first < __scientific_length(__n, __x))
+        return {__last, errc::value_too_large};
+    *__first++ = __digits[0];
+    if (__n > 1)
+    {
+        *__first++ = '.';
+        memcpy(__first, __digits + 1, __n - 1);
+        __first += __n - 1;
+    }
+    *__first++ = 'e';
+    *__first++ = __x < 0 ? '-' : '+';
+    const unsigned __ax = __x < 0 ? -__x : __x;
+    if (__ax >= 1000)
+        *__first++ = static_cast<char>('0' + __ax / 1000);
+    if (__ax >= 100)
+        *__first++ = static_cast<char>('0' + __ax / 100 % 10);
+    *__first++ = static_cast<char>('0' + __ax / 10 % 10);
+    *__first++ = static_cast<char>('0' + __ax % 10);
+    return {__first, errc()};
+}
+
+inline to_chars_result
+__write_fixed(char* __first, char* __last, const char* __digits, int __n,
+              int __x)
+{
+    if (__last - __first < __fixed_length(__n, __x))
+        return {__last, errc::value_too_large};
+    if (__x >= __n - 1)
+    {
+        memcpy(__first, __digits, __n);
+        memset(__first + __n, '0', __x + 1 - __n);
+        return {__first + __x + 1, errc()};
+    }
+    if (__x < 0)
+    {
+        *__first++ = '0';
+        *__first++ = '.';
+        memset(__first, '0', -__x - 1);
+        __first += -__x - 1;
+        memcpy(__first, __digits, __n);
+        return {__first + __n, errc()};
+    }
+    memcpy(__first, __digits, __x + 1);
+    __first[__x + 1] = '.';
+    memcpy(__first + __x + 2, __digits + __x + 1, __n - __x - 1);
+    return {__first + __n + 1, errc()};
+}
+
+// Writes the value in __fmt, or in the shorter of fixed and scientific
+// notation if __plain. __integer holds the exact digits of an integer too
+// large for the shortest digits followed by zeros to spell it exactly; fixed
+// notation prints those instead, like printf does.
+inline to_chars_result
+__write_decimal(char* __first, char* __last, const char* __digits, int __n,
+                int __x, const char* __integer, int __integer_length,
+                chars_format __fmt, bool __plain)
+{
+    bool __fixed;
+    if (__plain)
+        __fixed = (__integer ? __integer_length : __fixed_length(__n, __x)) <=
+                  __scientific_length(__n, __x);
+    else if (__fmt == chars_format::general)
+        // The style of %g, whose default precision is 6.
+        __fixed = -4 <= __x && __x < 6;
+    else
+        __fixed = __fmt == chars_format::fixed;
+    if (!__fixed)
+        return __write_scientific(__first, __last, __digits, __n, __x);
+    if (__integer)
+        return __write_string(__first, __last, __integer, __integer_length);
+    return __write_fixed(__first, __last, __digits, __n, __x);
+}
+
+// Writes the hexadecimal form, 1.hhhp+d or 0.hhhp-d for the subnormals,
+// without the 0x prefix of printf. With a negative precision the form is the
+// shortest exact one, otherwise it has __precision digits after the point,
+// rounded to nearest even like %.*a, which may carry into the leading digit.
+template <class _Fp>
+to_chars_result
+__write_hex(char* __first, char* __last, uint64_t __ieee_m, uint32_t __ieee_e,
+            int __precision = -1)
+{
+    typedef __traits<_Fp> _Tr;
+    const int __pad = (4 - _Tr::__mantissa_bits % 4) % 4;
+    uint64_t __fraction = __ieee_m << __pad;
+    int __n = (_Tr::__mantissa_bits + __pad) / 4;
+    unsigned __leading = __ieee_e != 0 ? 1 : 0;
+    int __zeros = 0;
+    if (__precision < 0)
+    {
+        for (; __n > 0 && (__fraction & 0xf) == 0; --__n)
+            __fraction >>= 4;
+    }
+    else if (__precision < __n)
+    {
+        const int __shift = 4 * (__n - __precision);
+        const uint64_t __half = uint64_t(1) << (__shift - 1);
+        const uint64_t __rest = __fraction & ((__half << 1) - 1);
+        uint64_t __digits =
+            (uint64_t(__leading) << (4 * __n - __shift)) | __fraction >> __shift;
+        if (__rest > __half || (__rest == __half && (__digits & 1)))
+            ++__digits;
+        __n = __precision;
+        __leading = static_cast<unsigned>(__digits >> (4 * __n));
+        __fraction = __digits & ((uint64_t(1) << (4 * __n)) - 1);
+    }
+    else
+    {
+        __zeros = __precision - __n;
+    }
+    int __exp = 0;
+    if (__ieee_e != 0)
+        __exp = static_cast<int>(__ieee_e) - _Tr::__bias;
+    else if (__ieee_m != 0)
+        __exp = 1 - _Tr::__bias;
+    char __exp_digits[8];
+    const int __exp_length = static_cast<int>(
+        __itoa::__u32toa(__exp < 0 ? -__exp : __exp, __exp_digits) -
+        __exp_digits);
+
+    const int __length = __n + __zeros;
+    if (__last - __first < 1 + (__length > 0) + __length + 2 + __exp_length)
+        return {__last, errc::value_too_large};
+    *__first++ = "0123456789abcdef"[__leading];
+    if (__length > 0)
+    {
+        *__first++ = '.';
+        for (int __i = __n - 1; __i >= 0; --__i, __fraction >>= 4)
+            __first[__i] = "0123456789abcdef"[__fraction & 0xf];
+        __first += __n;
+        memset(__first, '0', __zeros);
+        __first += __zeros;
+    }
+    *__first++ = 'p';
+    *__first++ = __exp < 0 ? '-' : '+';
+    memcpy(__first, __exp_digits, __exp_length);
+    return {__first + __exp_length, errc()};
+}
+
+// Formats float and double in hexadecimal with a precision. printf would do
+// it for double, but would promote a float, and so print its subnormals in
+// the normalized form of double rather than as 0.hhhp-126.
+template <class _Fp>
+to_chars_result
+__to_chars_hex(char* __first, char* __last, _Fp __value, int __precision)
+{
+    typedef __traits<_Fp> _Tr;
+    typename _Tr::__bits_type __bits;
+    memcpy(&__bits, &__value, sizeof(__bits));
+    const uint64_t __ieee_m =
+        __bits & ((uint64_t(1) << _Tr::__mantissa_bits) - 1);
+    const uint32_t __ieee_e =
+        static_cast<uint32_t>(__bits >> _Tr::__mantissa_bits) &
+        ((1u << _Tr::__exponent_bits) - 1);
+
+    if (__bits >> (_Tr::__mantissa_bits + _Tr::__exponent_bits))
+    {
+        if (__first == __last)
+            return {__last, errc::value_too_large};
+        *__first++ = '-';
+    }
+    if (__ieee_e == (1u << _Tr::__exponent_bits) - 1)
+        return __write_string(__first, __last, __ieee_m ? "nan" : "inf", 3);
+    return __write_hex<_Fp>(__first, __last, __ieee_m, __ieee_e, __precision);
+}
+
+template <class _Fp>
+to_chars_result
+__to_chars_shortest(char* __first, char* __last, _Fp __value,
+                    chars_format __fmt, bool __plain)
+{
+    typedef __traits<_Fp> _Tr;
+    typename _Tr::__bits_type __bits;
+    memcpy(&__bits, &__value, sizeof(__bits));
+    const uint64_t __ieee_m =
+        __bits & ((uint64_t(1) << _Tr::__mantissa_bits) - 1);
+    const uint32_t __ieee_e =
+        static_cast<uint32_t>(__bits >> _Tr::__mantissa_bits) &
+        ((1u << _Tr::__exponent_bits) - 1);
+
+    if (__bits >> (_Tr::__mantissa_bits + _Tr::__exponent_bits))
+    {
+        if (__first == __last)
+            return {__last, errc::value_too_large};
+        *__first++ = '-';
+    }
+    if (__ieee_e == (1u << _Tr::__exponent_bits) - 1)
+        return __write_string(__first, __last, __ieee_m ? "nan" : "inf", 3);
+    if (!__plain && __fmt == chars_format::hex)
+        return __write_hex<_Fp>(__first, __last, __ieee_m, __ieee_e);
+    if (__ieee_e == 0 && __ieee_m == 0)
+        return __write_decimal(__first, __last, "0", 1, 0, nullptr, 0, __fmt,
+                               __plain);
+
+    const __decimal __d = __shortest<_Fp>(__ieee_m, __ieee_e);
+    char __digits[24];
+    const int __n = static_cast<int>(
+        __itoa::__u64toa(__d.__mantissa, __digits) - __digits);
+    const int __x = __d.__exponent + __n - 1;
+
+    // Above 2^(__mantissa_bits + 1) the values are integers whose last bits
+    // may be nonzero, so the fixed notation needs their exact digits. They
+    // have at least __x of them, which rules fixed out for the plain
+    // overload when that is longer than scientific.
+    const int __e2 =
+        static_cast<int>(__ieee_e) - _Tr::__bias - _Tr::__mantissa_bits;
+    if (__e2 > 0 &&
+        (__plain ? __x <= __scientific_length(__n, __x)
+                 : __fmt == chars_format::fixed))
+    {
+        char __integer[320];
+        const int __length = __write_integer(
+            __integer, (uint64_t(1) << _Tr::__mantissa_bits) | __ieee_m, __e2);
+        return __write_decimal(__first, __last, __digits, __n, __x, __integer,
+                               __length, __fmt, __plain);
+    }
+    return __write_decimal(__first, __last, __digits, __n, __x, nullptr, 0,
+                           __fmt, __plain);
+}
+
+// Formats the value with printf in the C locale, for the overloads that take
+// a precision, which have the exact semantics of the printf conversions.
+template <class _Fp>
+to_chars_result
+__to_chars_printf(char* __first, char* __last, _Fp __value,
+                  chars_format __fmt, int __precision)
+{
+    char __format[8] = "%.*";
+    char* __f = __format + 3;
+    if (is_same<_Fp, long double>::value)
+        *__f++ = 'L';
+    *__f++ = __fmt == chars_format::fixed        ? 'f'
+             : __fmt == chars_format::scientific ? 'e'
+             : __fmt == chars_format::hex        ? 'a'
+                                                 : 'g';
+    *__f = '\0';
+
+    const size_t __size = static_cast<size_t>(__last - __first);
+    const int __length = __libcpp_snprintf_l(
+        __first, __size, _LIBCPP_GET_C_LOCALE, __format, __precision, __value);
+    if (__length < 0)
+        return {__last, errc::value_too_large};
+    const char* __s = __first;
+    string __buffer;
+    if (static_cast<size_t>(__length) >= __size)
+    {
+        // Either too long, or long enough that the null terminator did not
+        // fit, which to_chars does not need.
+        __buffer.resize(__length);
+        __libcpp_snprintf_l(&__buffer[0], __length + 1, _LIBCPP_GET_C_LOCALE,
+                            __format, __precision, __value);
+        __s = __buffer.data();
+    }
+    // printf starts the hexadecimal form with 0x, which to_chars leaves out,
+    // but not inf and nan.
+    const size_t __sign = __s[0] == '-';
+    const size_t __skip =
+        __fmt == chars_format::hex && __s[__sign] == '0' ? 2 : 0;
+    const size_t __result_length = __length - __skip;
+    if (__result_length > __size)
+        return {__last, errc::value_too_large};
+    memmove(__first + __sign, __s + __sign + __skip, __result_length - __sign);
+    if (__sign)
+        *__first = '-';
+    return {__first + __result_length, errc()};
+}
+
+#if LDBL_MANT_DIG != DBL_MANT_DIG
+// The tables above only cover double, so long double finds its shortest
+// digits with printf and strtold.
+inline to_chars_result
+__to_chars_shortest(char* __first, char* __last, long double __value,
+                    chars_format __fmt, bool __plain)
+{
+    if (signbit(__value))
+    {
+        if (__first == __last)
+            return {__last, errc::value_too_large};
+        *__first++ = '-';
+        __value = -__value;
+    }
+    if (isinf(__value))
+        return __write_string(__first, __last, "inf", 3);
+    if (isnan(__value))
+        return __write_string(__first, __last, "nan", 3);
+    if (!__plain && __fmt == chars_format::hex)
+        return __to_chars_printf(__first, __last, __value, __fmt, -1);
+    if (__value == 0)
+        return __write_decimal(__first, __last, "0", 1, 0, nullptr, 0, __fmt,
+                               __plain);
+
+    char __buffer[64];
+    for (int __precision = 0;; ++__precision)
+    {
+        __libcpp_snprintf_l(__buffer, sizeof(__buffer), _LIBCPP_GET_C_LOCALE,
+                            "%.*Le", __precision, __value);
+        if (__do_strtod<long double>(__buffer, nullptr) == __value)
+            break;
+    }
+    // __buffer holds d.ddde+dd.
+    char __digits[64];
+    int __n = 0;
+    const char* __s = __buffer;
+    for (; *__s != 'e'; ++__s)
+        if (*__s != '.')
+            __digits[__n++] = *__s;
+    const int __x = atoi(__s + 1);
+
+    if (__value >= ldexpl(1, LDBL_MANT_DIG) &&
+        (__plain || __fmt == chars_format::fixed))
+    {
+        string __integer(__libcpp_snprintf_l(nullptr, 0, _LIBCPP_GET_C_LOCALE,
+                                             "%.0Lf", __value),
+                         '\0');
+        __libcpp_snprintf_l(&__integer[0], __integer.size() + 1,
+                            _LIBCPP_GET_C_LOCALE, "%.0Lf", __value);
+        return __write_decimal(__first, __last, __digits, __n, __x,
+                               __integer.data(),
+                               static_cast<int>(__integer.size()), __fmt,
+                               __plain);
+    }
+    return __write_decimal(__first, __last, __digits, __n, __x, nullptr, 0,
+                           __fmt, __plain);
+}
+#endif
+
+// Input.
+
+inline bool __is_digit(char __c)
+{
+    return static_cast<unsigned char>(__c - '0') < 10;
+}
+
+inline int __hex_digit(char __c)
+{
+    if (__is_digit(__c))
+        return __c - '0';
+    const char __lower = static_cast<char>(__c | 0x20);
+    if ('a' <= __lower && __lower <= 'f')
+        return __lower - 'a' + 10;
+    return -1;
+}
+
+// Whether [__p, __last) starts with __word, ignoring case. __word is lower
+// case.
+inline bool __match(const char* __p, const char* __last, const char* __word)
+{
+    for (; *__word; ++__p, ++__word)
+        if (__p == __last || (*__p | 0x20) != *__word)
+            return false;
+    return true;
+}
+
+// Parses the exponent that starts with __marker at __p, if any, and adds it
+// to __exp. Returns the end of the exponent.
+inline const char* __parse_exponent(const char* __p, const char* __last,
+                                    char __marker, int64_t& __exp)
+{
+    if (__p == __last || (*__p | 0x20) != __marker)
+        return __p;
+    const char* __q = __p + 1;
+    const bool __negative = __q != __last && *__q == '-';
+    if (__q != __last && (*__q == '-' || *__q == '+'))
+        ++__q;
+    if (__q == __last || !__is_digit(*__q))
+        return __p;
+    // Exponents this large overflow or underflow regardless of the digits.
+    int64_t __e = 0;
+    for (; __q != __last && __is_digit(*__q); ++__q)
+        if (__e < INT64_C(1000000000000000))
+            __e = 10 * __e + (*__q - '0');
+    __exp += __negative ? -__e : __e;
+    return __q;
+}
+
+// Stores the IEEE bits of a nonzero value, which are those of zero or
+// infinity when it underflowed or overflowed.
+template <class _Fp>
+from_chars_result __store(uint64_t __bits, bool __negative, const char* __end,
+                          _Fp& __value)
+{
+    typedef __traits<_Fp> _Tr;
+    const uint64_t __infinity = ((uint64_t(1) << _Tr::__exponent_bits) - 1)
+                                << _Tr::__mantissa_bits;
+    if (__bits == 0 || __bits == __infinity)
+        return {__end, errc::result_out_of_range};
+    __bits |= uint64_t(__negative)
+              << (_Tr::__mantissa_bits + _Tr::__exponent_bits);
+    const typename _Tr::__bits_type __b =
+        static_cast<typename _Tr::__bits_type>(__bits);
+    memcpy(&__value, &__b, sizeof(__value));
+    return {__end, errc()};
+}
+
+// Converts the text of a number with strtod in the C locale, for the cases
+// that the exact algorithms below do not handle. __prefix goes before it.
+template <class _Fp>
+from_chars_result
+__from_chars_strtod(const char* __begin, const char* __end,
+                    const char* __prefix, bool __negative, _Fp& __value)
+{
+    string __text(__prefix);
+    __text.append(__begin, __end);
+    const int __saved_errno = errno;
+    const _Fp __result = __do_strtod<_Fp>(__text.c_str(), nullptr);
+    errno = __saved_errno;
+    if (__result == 0 || __result == numeric_limits<_Fp>::infinity())
+        return {__end, errc::result_out_of_range};
+    __value = __negative ? -__result : __result;
+    return {__end, errc()};
+}
+
+// Rounds __m * 2^__e, plus less than one unit in the last place of __m if
+// __sticky, to the nearest _Fp, with ties to even, and returns its bits.
+template <class _Fp>
+uint64_t __round_binary(uint64_t __m, int64_t __e, bool __sticky)
+{
+    typedef __traits<_Fp> _Tr;
+    const int64_t __infinite = (int64_t(1) << _Tr::__exponent_bits) - 1;
+    const int __lz = __clz(__m);
+    __m <<= __lz;
+    __e -= __lz;
+    // The biased exponent of the leading bit, and the number of bits of __m
+    // below the last bit of the result.
+    int64_t __biased = __e + 63 + _Tr::__bias;
+    if (__biased >= __infinite)
+        return uint64_t(__infinite) << _Tr::__mantissa_bits;
+    int64_t __shift = 63 - _Tr::__mantissa_bits;
+    if (__biased <= 0)
+    {
+        __shift += 1 - __biased;
+        __biased = 1;
+    }
+    if (__shift > 64)
+        return 0;
+    uint64_t __kept;
+    bool __half, __rest;
+    if (__shift == 64)
+    {
+        __kept = 0;
+        __half = true;
+        __rest = (__m << 1) != 0 || __sticky;
+    }
+    else
+    {
+        __kept = __m >> __shift;
+        __half = (__m >> (__shift - 1)) & 1;
+        __rest = (__m & ((uint64_t(1) << (__shift - 1)) - 1)) != 0 || __sticky;
+    }
+    if (__half && (__rest || (__kept & 1)))
+        ++__kept;
+    // __kept includes the leading bit of a normal value, which adds one to
+    // the exponent, as does a carry out of the mantissa when rounding up.
+    return (uint64_t(__biased - 1) << _Tr::__mantissa_bits) + __kept;
+}
+
+// Returns the bits of the _Fp nearest to __w * 10^__q, where __w < 10^19,
+// with the Eisel-Lemire algorithm (Daniel Lemire, "Number Parsing at a
+// Gigabyte per Second", 2021), whose 128-bit product is always precise
+// enough for such __w (Noble Mushtak and Daniel Lemire, "Fast Number
+// Parsing Without Fallback", 2023).
+template <class _Fp>
+uint64_t __eisel_lemire(uint64_t __w, int64_t __q)
+{
+    typedef __traits<_Fp> _Tr;
+    const int32_t __infinite = (1 << _Tr::__exponent_bits) - 1;
+    if (__q < _Tr::__min_pow10)
+        return 0;
+    if (__q > _Tr::__max_pow10)
+        return uint64_t(__infinite) << _Tr::__mantissa_bits;
+
+    const int __lz = __clz(__w);
+    __w <<= __lz;
+    const uint64_t* __pow5 = __pow5_128[__q + 342];
+    uint64_t __high;
+    uint64_t __low = __umul128(__w, __pow5[0], &__high);
+    // The lower half of 5^__q only matters when the bits below the result in
+    // the upper product are all ones.
+    const uint64_t __mask = ~uint64_t(0) >> (_Tr::__mantissa_bits + 3);
+    if ((__high & __mask) == __mask)
+    {
+        uint64_t __high2;
+        __umul128(__w, __pow5[1], &__high2);
+        __low += __high2;
+        if (__high2 > __low)
+            ++__high;
+    }
+
+    const int __upper_bit = static_cast<int>(__high >> 63);
+    const int __shift = __upper_bit + 64 - _Tr::__mantissa_bits - 3;
+    uint64_t __m = __high >> __shift;
+    // floor(log2(10^__q)) + 63 + __upper_bit - __lz, biased.
+    int32_t __e2 = ((217706 * static_cast<int32_t>(__q)) >> 16) + 63 +
+                   __upper_bit - __lz + _Tr::__bias;
+
+    if (__e2 <= 0)
+    {
+        // Subnormal, or zero. A mantissa that rounds up to 2^__mantissa_bits
+        // becomes the smallest normal value.
+        if (-__e2 + 1 >= 64)
+            return 0;
+        __m >>= -__e2 + 1;
+        __m += __m & 1;
+        return __m >> 1;
+    }
+
+    // An exact half would look like one, but only the products with small
+    // powers of ten can be exact.
+    if (__low <= 1 && __q >= _Tr::__min_round_to_even &&
+        __q <= _Tr::__max_round_to_even && (__m & 3) == 1 &&
+        (__m << __shift) == __high)
+        __m &= ~uint64_t(1);
+    __m += __m & 1;
+    __m >>= 1;
+    if (__m >= (uint64_t(2) << _Tr::__mantissa_bits))
+    {
+        __m = uint64_t(1) << _Tr::__mantissa_bits;
+        ++__e2;
+    }
+    __m &= ~(uint64_t(1) << _Tr::__mantissa_bits);
+    if (__e2 >= __infinite)
+        return uint64_t(__infinite) << _Tr::__mantissa_bits;
+    return (uint64_t(__e2) << _Tr::__mantissa_bits) | __m;
+}
+
+// Converts the nonzero __w * 10^__exp, the first 19 significant digits of
+// [__begin, __end) and whether any of the other digits are nonzero.
+template <class _Fp>
+from_chars_result
+__convert_decimal(const char* __begin, const char* __end, bool __negative,
+                  uint64_t __w, int64_t __exp, bool __truncated, _Fp& __value)
+{
+    typedef __traits<_Fp> _Tr;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // Clinger's fast path: both operands are exact, so the single rounding
+    // of the operation is the correct one.
+    if (!__truncated && __w <= _Tr::__max_exact_mantissa &&
+        -_Tr::__max_exact_pow10 <= __exp && __exp <= _Tr::__max_exact_pow10)
+    {
+        _Fp __result = static_cast<_Fp>(__w);
+        if (__exp < 0)
+            __result /= static_cast<_Fp>(__exact_pow10[-__exp]);
+        else
+            __result *= static_cast<_Fp>(__exact_pow10[__exp]);
+        __value = __negative ? -__result : __result;
+        return {__end, errc()};
+    }
+#endif
+    const uint64_t __bits = __eisel_lemire<_Fp>(__w, __exp);
+    // With more digits the value lies between __w and __w + 1 times 10^__exp,
+    // which settles it when both round the same way.
+    if (__truncated && __bits != __eisel_lemire<_Fp>(__w + 1, __exp))
+        return __from_chars_strtod(__begin, __end, "", __negative, __value);
+    return __store(__bits, __negative, __end, __value);
+}
+
+template <class _Fp>
+from_chars_result
+__convert_hex(const char*, const char* __end, bool __negative, uint64_t __m,
+              int64_t __exp, bool __sticky, _Fp& __value)
+{
+    return __store(__round_binary<_Fp>(__m, __exp, __sticky), __negative,
+                   __end, __value);
+}
+
+#if LDBL_MANT_DIG == DBL_MANT_DIG
+inline from_chars_result
+__convert_decimal(const char* __begin, const char* __end, bool __negative,
+                  uint64_t __w, int64_t __exp, bool __truncated,
+                  long double& __value)
+{
+    double __d;
+    from_chars_result __r = __convert_decimal(__begin, __end, __negative, __w,
+                                              __exp, __truncated, __d);
+    if (__r.ec == errc())
+        __value = __d;
+    return __r;
+}
+
+inline from_chars_result
+__convert_hex(const char* __begin, const char* __end, bool __negative,
+              uint64_t __m, int64_t __exp, bool __sticky, long double& __value)
+{
+    double __d;
+    from_chars_result __r =
+        __convert_hex(__begin, __end, __negative, __m, __exp, __sticky, __d);
+    if (__r.ec == errc())
+        __value = __d;
+    return __r;
+}
+#else
+inline from_chars_result
+__convert_decimal(const char* __begin, const char* __end, bool __negative,
+                  uint64_t, int64_t, bool, long double& __value)
+{
+    return __from_chars_strtod(__begin, __end, "", __negative, __value);
+}
+
+inline from_chars_result
+__convert_hex(const char* __begin, const char* __end, bool __negative,
+              uint64_t, int64_t, bool, long double& __value)
+{
+    return __from_chars_strtod(__begin, __end, "0x", __negative, __value);
+}
+#endif
+
+template <class _Fp>
+from_chars_result
+__from_chars_special(const char* __first, const char* __p, const char* __last,
+                     bool __negative, _Fp& __value)
+{
+    if (__match(__p, __last, "inf"))
+    {
+        __p += 3;
+        if (__match(__p, __last, "inity"))
+            __p += 5;
+        __value = __negative ? -numeric_limits<_Fp>::infinity()
+                             : numeric_limits<_Fp>::infinity();
+        return {__p, errc()};
+    }
+    if (__match(__p, __last, "nan"))
+    {
+        __p += 3;
+        if (__p != __last && *__p == '(')
+        {
+            const char* __q = __p + 1;
+            while (__q != __last &&
+                   (__is_digit(*__q) || *__q == '_' ||
+                    ('a' <= (*__q | 0x20) && (*__q | 0x20) <= 'z')))
+                ++__q;
+            if (__q != __last && *__q == ')')
+                __p = __q + 1;
+        }
+        __value = __negative ? -numeric_limits<_Fp>::quiet_NaN()
+                             : numeric_limits<_Fp>::quiet_NaN();
+        return {__p, errc()};
+    }
+    return {__first, errc::invalid_argument};
+}
+
+template <class _Fp>
+from_chars_result
+__from_chars_hex(const char* __first, const char* __p, const char* __last,
+                 bool __negative, _Fp& __value)
+{
+    const char* const __begin = __p;
+    // The value is __m * 2^__exp, plus less than one unit of __m if
+    // __sticky.
+    uint64_t __m = 0;
+    int64_t __exp = 0;
+    bool __any = false;
+    bool __sticky = false;
+    int __d;
+    for (; __p != __last && (__d = __hex_digit(*__p)) >= 0; ++__p)
+    {
+        __any = true;
+        if (__m >> 60 == 0)
+            __m = 16 * __m + __d;
+        else
+        {
+            __exp += 4;
+            __sticky |= __d != 0;
+        }
+    }
+    if (__p != __last && *__p == '.')
+    {
+        const char* __q = __p + 1;
+        for (; __q != __last && (__d = __hex_digit(*__q)) >= 0; ++__q)
+        {
+            __any = true;
+            if (__m >> 60 == 0)
+            {
+                __m = 16 * __m + __d;
+                __exp -= 4;
+            }
+            else
+                __sticky |= __d != 0;
+        }
+        if (__any)
+            __p = __q;
+    }
+    if (!__any)
+        return {__first, errc::invalid_argument};
+    __p = __parse_exponent(__p, __last, 'p', __exp);
+
+    if (__m == 0)
+    {
+        __value = __negative ? -_Fp(0) : _Fp(0);
+        return {__p, errc()};
+    }
+    return __convert_hex(__begin, __p, __negative, __m, __exp, __sticky,
+                         __value);
+}
+
+template <class _Fp>
+from_chars_result
+__from_chars_decimal(const char* __first, const char* __p, const char* __last,
+                     bool __negative, _Fp& __value, chars_format __fmt)
+{
+    const char* const __begin = __p;
+    // The value is __w * 10^__exp, where __w holds the first 19 significant
+    // digits, plus less than one unit of __w if __truncated.
+    uint64_t __w = 0;
+    int64_t __exp = 0;
+    int __digits = 0;
+    bool __any = false;
+    bool __truncated = false;
+    for (; __p != __last && __is_digit(*__p); ++__p)
+    {
+        __any = true;
+        if (__digits < 19)
+        {
+            __w = 10 * __w + (*__p - '0');
+            __digits += __w != 0;
+        }
+        else
+        {
+            ++__exp;
+            __truncated |= *__p != '0';
+        }
+    }
+    if (__p != __last && *__p == '.')
+    {
+        const char* __q = __p + 1;
+        for (; __q != __last && __is_digit(*__q); ++__q)
+        {
+            __any = true;
+            if (__digits < 19)
+            {
+                __w = 10 * __w + (*__q - '0');
+                __digits += __w != 0;
+                --__exp;
+            }
+            else
+                __truncated |= *__q != '0';
+        }
+        if (__any)
+            __p = __q;
+    }
+    if (!__any)
+        return {__first, errc::invalid_argument};
+
+    // The exponent is required by scientific, optional with general and not
+    // part of the number with fixed.
+    if (static_cast<unsigned>(__fmt) &
+        static_cast<unsigned>(chars_format::scientific))
+    {
+        const char* __q = __parse_exponent(__p, __last, 'e', __exp);
+        if (__q == __p && __fmt == chars_format::scientific)
+            return {__first, errc::invalid_argument};
+        __p = __q;
+    }
+
+    if (__w == 0)
+    {
+        __value = __negative ? -_Fp(0) : _Fp(0);
+        return {__p, errc()};
+    }
+    return __convert_decimal(__begin, __p, __negative, __w, __exp,
+                             __truncated, __value);
+}
+
+template <class _Fp>
+from_chars_result
+__from_chars(const char* __first, const char* __last, _Fp& __value,
+             chars_format __fmt)
+{
+    const char* __p = __first;
+    const bool __negative = __p != __last && *__p == '-';
+    __p += __negative;
+    if (__p != __last && ((*__p | 0x20) == 'i' || (*__p | 0x20) == 'n'))
+        return __from_chars_special(__first, __p, __last, __negative, __value);
+    if (__fmt == chars_format::hex)
+        return __from_chars_hex(__first, __p, __last, __negative, __value);
+    return __from_chars_decimal(__first, __p, __last, __negative, __value,
+                                __fmt);
+}
+
+}  // namespace __floating_point
+
+to_chars_result
+to_chars(char* __first, char* __last, float __value)
+{
+    return __floating_point::__to_chars_shortest(
+        __first, __last, __value, chars_format::general, true);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, double __value)
+{
+    return __floating_point::__to_chars_shortest(
+        __first, __last, __value, chars_format::general, true);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, long double __value)
+{
+#if LDBL_MANT_DIG == DBL_MANT_DIG
+    return to_chars(__first, __last, static_cast<double>(__value));
+#else
+    return __floating_point::__to_chars_shortest(
+        __first, __last, __value, chars_format::general, true);
+#endif
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, float __value, chars_format __fmt)
+{
+    return __floating_point::__to_chars_shortest(__first, __last, __value,
+                                                 __fmt, false);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, double __value, chars_format __fmt)
+{
+    return __floating_point::__to_chars_shortest(__first, __last, __value,
+                                                 __fmt, false);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, long double __value, chars_format __fmt)
+{
+#if LDBL_MANT_DIG == DBL_MANT_DIG
+    return to_chars(__first, __last, static_cast<double>(__value), __fmt);
+#else
+    return __floating_point::__to_chars_shortest(__first, __last, __value,
+                                                 __fmt, false);
+#endif
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, float __value, chars_format __fmt,
+         int __precision)
+{
+    // The decimal forms of a float are those of the same double.
+    if (__fmt == chars_format::hex)
+        return __floating_point::__to_chars_hex(__first, __last, __value,
+                                                __precision);
+    return __floating_point::__to_chars_printf(
+        __first, __last, static_cast<double>(__value), __fmt, __precision);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, double __value, chars_format __fmt,
+         int __precision)
+{
+    if (__fmt == chars_format::hex)
+        return __floating_point::__to_chars_hex(__first, __last, __value,
+                                                __precision);
+    return __floating_point::__to_chars_printf(__first, __last, __value, __fmt,
+                                               __precision);
+}
+
+to_chars_result
+to_chars(char* __first, char* __last, long double __value, chars_format __fmt,
+         int __precision)
+{
+    return __floating_point::__to_chars_printf(__first, __last, __value, __fmt,
+                                               __precision);
+}
+
+from_chars_result
+from_chars(const char* __first, const char* __last, float& __value,
+           chars_format __fmt)
+{
+    return __floating_point::__from_chars(__first, __last, __value, __fmt);
+}
+
+from_chars_result
+from_chars(const char* __first, const char* __last, double& __value,
+           chars_format __fmt)
+{
+    return __floating_point::__from_chars(__first, __last, __value, __fmt);
+}
+
+from_chars_result
+from_chars(const char* __first, const char* __last, long double& __value,
+           chars_format __fmt)
+{
+    return __floating_point::__from_chars(__first, __last, __value, __fmt);
+}
+
 _LIBCPP_END_NAMESPACE_STD
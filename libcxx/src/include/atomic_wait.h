@@ -0,0 +1,26 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef ATOMIC_WAIT_H
+#define ATOMIC_WAIT_H
+
+#include "__config"
+#include "atomic"
+#include "chrono"
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+// Like __libcpp_atomic_wait, but gives up after __rel_time. Callers recheck
+// their condition and the clock either way, as wakeups may be spurious.
+_LIBCPP_HIDDEN void __libcpp_atomic_wait_for(void const volatile* __location,
+                                             __cxx_contention_t __old,
+                                             chrono::nanoseconds __rel_time) _NOEXCEPT;
+
+_LIBCPP_END_NAMESPACE_STD
+
+#endif // ATOMIC_WAIT_H
@@ -0,0 +1,491 @@
+//===------------------------ memory_resource.cpp -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "memory_resource"
+
+#ifndef _LIBCPP_HAS_NO_ATOMIC_HEADER
+#include "atomic"
+#elif !defined(_LIBCPP_HAS_NO_THREADS)
+#include "mutex"
+#if defined(__unix__) &&  defined(__ELF__) && defined(_LIBCPP_HAS_COMMENT_LIB_PRAGMA)
+#pragma comment(lib, "pthread")
+#endif
+#endif
+
+_LIBCPP_BEGIN_NAMESPACE_STD
+
+namespace pmr
+{
+
+// memory_resource
+
+memory_resource::~memory_resource() {}
+
+namespace {
+
+// new_delete_resource()
+
+class __new_delete_memory_resource_imp
+    : public memory_resource
+{
+#ifdef _LIBCPP_HAS_NO_ALIGNED_ALLOCATION
+    // The library may be built without the aligned operator new. Over-aligned
+    // blocks are then carved out of a larger block, with the pointer to the
+    // start of it stored right before the block.
+    void* do_allocate(size_t __size, size_t __align) override
+    {
+        if (!_VSTD::__is_overaligned_for_new(__align))
+            return _VSTD::__libcpp_allocate(__size, __align);
+        if (__size > numeric_limits<size_t>::max() - __align - sizeof(void*))
+            __throw_bad_alloc();
+        void* __raw = _VSTD::__libcpp_allocate(__size + __align + sizeof(void*),
+                                               _LIBCPP_ALIGNOF(void*));
+        uintptr_t __p = reinterpret_cast<uintptr_t>(__raw) + sizeof(void*);
+        __p = (__p + __align - 1) & ~(uintptr_t(__align) - 1);
+        reinterpret_cast<void**>(__p)[-1] = __raw;
+        return reinterpret_cast<void*>(__p);
+    }
+
+    void do_deallocate(void* __p, size_t __n, size_t __align) override
+    {
+        if (!_VSTD::__is_overaligned_for_new(__align)) {
+            _VSTD::__libcpp_deallocate(__p, __n, __align);
+            return;
+        }
+        void* __raw = static_cast<void**>(__p)[-1];
+        _VSTD::__libcpp_deallocate(__raw, __n + __align + sizeof(void*),
+                                   _LIBCPP_ALIGNOF(void*));
+    }
+#else
+    void* do_allocate(size_t __size, size_t __align) override
+        { return _VSTD::__libcpp_allocate(__size, __align); }
+
+    void do_deallocate(void* __p, size_t __n, size_t __align) override
+        { _VSTD::__libcpp_deallocate(__p, __n, __align); }
+#endif
+
+    bool do_is_equal(memory_resource const& __other) const _NOEXCEPT override
+        { return &__other == this; }
+};
+
+// null_memory_resource()
+
+class __null_memory_resource_imp
+    : public memory_resource
+{
+    void* do_allocate(size_t, size_t) override { __throw_bad_alloc(); }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(memory_resource const& __other) const _NOEXCEPT override
+        { return &__other == this; }
+};
+
+// The global resources are constant initialized and never destroyed, so that
+// they can be used by the destructors of other static objects.
+union ResourceInitHelper {
+  struct {
+    __new_delete_memory_resource_imp new_delete_res;
+    __null_memory_resource_imp       null_res;
+  } resources;
+  char dummy;
+  _LIBCPP_CONSTEXPR_AFTER_CXX11 ResourceInitHelper() : resources() {}
+  ~ResourceInitHelper() {}
+};
+
+_LIBCPP_SAFE_STATIC ResourceInitHelper res_init;
+
+} // end namespace
+
+memory_resource* new_delete_resource() _NOEXCEPT
+{ return &res_init.resources.new_delete_res; }
+
+memory_resource* null_memory_resource() _NOEXCEPT
+{ return &res_init.resources.null_res; }
+
+// default_memory_resource()
+
+static memory_resource *
+__default_memory_resource(bool set = false, memory_resource * new_res = nullptr) _NOEXCEPT
+{
+#ifndef _LIBCPP_HAS_NO_ATOMIC_HEADER
+    _LIBCPP_SAFE_STATIC static atomic<memory_resource*> __res =
+        ATOMIC_VAR_INIT(&res_init.resources.new_delete_res);
+    if (set) {
+        new_res = new_res ? new_res : new_delete_resource();
+        // TODO: Can a weaker ordering be used?
+        return _VSTD::atomic_exchange_explicit(
+            &__res, new_res, memory_order_acq_rel);
+    }
+    else {
+        return _VSTD::atomic_load_explicit(
+            &__res, memory_order_acquire);
+    }
+#elif !defined(_LIBCPP_HAS_NO_THREADS)
+    _LIBCPP_SAFE_STATIC static memory_resource * res = &res_init.resources.new_delete_res;
+    static mutex res_lock;
+    if (set) {
+        new_res = new_res ? new_res : new_delete_resource();
+        lock_guard<mutex> guard(res_lock);
+        memory_resource * old_res = res;
+        res = new_res;
+        return old_res;
+    } else {
+        lock_guard<mutex> guard(res_lock);
+        return res;
+    }
+#else
+    _LIBCPP_SAFE_STATIC static memory_resource* res = &res_init.resources.new_delete_res;
+    if (set) {
+        new_res = new_res ? new_res : new_delete_resource();
+        memory_resource * old_res = res;
+        res = new_res;
+        return old_res;
+    } else {
+        return res;
+    }
+#endif
+}
+
+memory_resource * get_default_resource() _NOEXCEPT
+{
+    return __default_memory_resource();
+}
+
+memory_resource * set_default_resource(memory_resource * __new_res) _NOEXCEPT
+{
+    return __default_memory_resource(true, __new_res);
+}
+
+// 23.12.5, mem.res.pool
+
+static size_t __roundup(size_t __count, size_t __alignment)
+{
+    const size_t __mask = __alignment - 1;
+    return (__count + __mask) & ~__mask;
+}
+
+static const int __log2_smallest_block_size = 3;
+static const size_t __smallest_block_size = 8;
+static const size_t __default_largest_block_size = size_t(1) << 12;
+static const size_t __max_largest_block_size = size_t(1) << 20;
+static const size_t __default_max_blocks_per_chunk = size_t(1) << 10;
+static const size_t __max_blocks_per_chunk = size_t(1) << 20;
+// The first chunk of a pool holds about this many bytes, and chunks never get
+// larger than __max_chunk_size unless a single block is larger.
+static const size_t __min_chunk_size = size_t(1) << 10;
+static const size_t __max_chunk_size = size_t(1) << 22;
+
+// Returns the smallest N such that (1 << N) >= __n, for __n > 1.
+static int __log2_ceil(size_t __n)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<int>(sizeof(unsigned long long) * 8) -
+           __builtin_clzll(static_cast<unsigned long long>(__n - 1));
+#else
+    int __r = 0;
+    for (--__n; __n != 0; __n >>= 1)
+        ++__r;
+    return __r;
+#endif
+}
+
+struct unsynchronized_pool_resource::__adhoc_header
+{
+    __adhoc_header* __prev_;
+    __adhoc_header* __next_;
+    size_t __offset_;
+    size_t __size_;
+    size_t __align_;
+};
+
+class unsynchronized_pool_resource::__fixed_pool
+{
+    struct __chunk_footer {
+        __chunk_footer* __next_;
+        char* __start_;
+    };
+
+    struct __vacancy_header {
+        __vacancy_header* __next_vacancy_;
+    };
+
+    __chunk_footer* __first_chunk_;
+    __vacancy_header* __first_vacancy_;
+    // The part of the newest chunk that hasn't been handed out yet.
+    char* __bump_cur_;
+    char* __bump_end_;
+    size_t __next_chunk_blocks_;
+
+public:
+    explicit __fixed_pool(size_t __block_size)
+        : __first_chunk_(nullptr), __first_vacancy_(nullptr),
+          __bump_cur_(nullptr), __bump_end_(nullptr),
+          __next_chunk_blocks_(__block_size >= __min_chunk_size
+                                   ? 1 : __min_chunk_size / __block_size) {}
+
+    void* __allocate(memory_resource* __upstream, size_t __block_size,
+                     size_t __max_blocks)
+    {
+        if (__vacancy_header* __v = __first_vacancy_) {
+            __first_vacancy_ = __v->__next_vacancy_;
+            return __v;
+        }
+        if (__bump_cur_ == __bump_end_)
+            __allocate_chunk(__upstream, __block_size, __max_blocks);
+        void* __result = __bump_cur_;
+        __bump_cur_ += __block_size;
+        return __result;
+    }
+
+    void __evacuate(void* __p)
+    {
+        __vacancy_header* __v = static_cast<__vacancy_header*>(__p);
+        __v->__next_vacancy_ = __first_vacancy_;
+        __first_vacancy_ = __v;
+    }
+
+    void __release(memory_resource* __upstream)
+    {
+        __chunk_footer* __next;
+        for (__chunk_footer* __f = __first_chunk_; __f != nullptr; __f = __next) {
+            __next = __f->__next_;
+            size_t __size = reinterpret_cast<char*>(__f) - __f->__start_ +
+                            sizeof(__chunk_footer);
+            __upstream->deallocate(__f->__start_, __size,
+                                   _LIBCPP_ALIGNOF(max_align_t));
+        }
+        __first_chunk_ = nullptr;
+        __first_vacancy_ = nullptr;
+        __bump_cur_ = __bump_end_ = nullptr;
+    }
+
+private:
+    void __allocate_chunk(memory_resource* __upstream, size_t __block_size,
+                          size_t __max_blocks)
+    {
+        size_t __blocks = __next_chunk_blocks_;
+        if (__blocks > __max_blocks)
+            __blocks = __max_blocks;
+        // The footer follows the blocks, which are all multiples of its
+        // alignment.
+        size_t __size = __blocks * __block_size + sizeof(__chunk_footer);
+        char* __start = static_cast<char*>(
+            __upstream->allocate(__size, _LIBCPP_ALIGNOF(max_align_t)));
+        __chunk_footer* __f =
+            reinterpret_cast<__chunk_footer*>(__start + __blocks * __block_size);
+        __f->__next_ = __first_chunk_;
+        __f->__start_ = __start;
+        __first_chunk_ = __f;
+
+        __bump_cur_ = __start;
+        __bump_end_ = __start + __blocks * __block_size;
+
+        if (__blocks < __max_blocks &&
+            __blocks * __block_size * 2 <= __max_chunk_size)
+            __next_chunk_blocks_ = __blocks * 2;
+    }
+};
+
+unsynchronized_pool_resource::unsynchronized_pool_resource(
+    const pool_options& __opts, memory_resource* __upstream)
+    : __res_(__upstream), __fixed_pools_(nullptr), __adhoc_(nullptr)
+{
+    size_t __largest = __opts.largest_required_pool_block;
+    if (__largest == 0)
+        __largest = __default_largest_block_size;
+    else if (__largest < __smallest_block_size)
+        __largest = __smallest_block_size;
+    else if (__largest > __max_largest_block_size)
+        __largest = __max_largest_block_size;
+    __num_fixed_pools_ = __log2_ceil(__largest) - __log2_smallest_block_size + 1;
+
+    __max_blocks_per_chunk_ = __opts.max_blocks_per_chunk;
+    if (__max_blocks_per_chunk_ == 0)
+        __max_blocks_per_chunk_ = __default_max_blocks_per_chunk;
+    else if (__max_blocks_per_chunk_ > __max_blocks_per_chunk)
+        __max_blocks_per_chunk_ = __max_blocks_per_chunk;
+}
+
+pool_options unsynchronized_pool_resource::options() const
+{
+    pool_options __p;
+    __p.max_blocks_per_chunk = __max_blocks_per_chunk_;
+    __p.largest_required_pool_block =
+        __smallest_block_size << (__num_fixed_pools_ - 1);
+    return __p;
+}
+
+void unsynchronized_pool_resource::release()
+{
+    while (__adhoc_ != nullptr) {
+        __adhoc_header* __h = __adhoc_;
+        __adhoc_ = __h->__next_;
+        char* __start = reinterpret_cast<char*>(__h + 1) - __h->__offset_;
+        __res_->deallocate(__start, __h->__size_, __h->__align_);
+    }
+
+    if (__fixed_pools_ != nullptr) {
+        for (int __i = 0; __i < __num_fixed_pools_; ++__i) {
+            __fixed_pools_[__i].__release(__res_);
+            __fixed_pools_[__i].~__fixed_pool();
+        }
+        __res_->deallocate(__fixed_pools_,
+                           __num_fixed_pools_ * sizeof(__fixed_pool),
+                           _LIBCPP_ALIGNOF(__fixed_pool));
+        __fixed_pools_ = nullptr;
+    }
+}
+
+int unsynchronized_pool_resource::__pool_index(size_t __bytes,
+                                               size_t __align) const
+{
+    if (__align > _LIBCPP_ALIGNOF(max_align_t))
+        return __num_fixed_pools_;
+    size_t __n = __bytes > __align ? __bytes : __align;
+    if (__n <= __smallest_block_size)
+        return 0;
+    int __i = __log2_ceil(__n) - __log2_smallest_block_size;
+    return __i < __num_fixed_pools_ ? __i : __num_fixed_pools_;
+}
+
+void* unsynchronized_pool_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    int __i = __pool_index(__bytes, __align);
+    if (__i == __num_fixed_pools_) {
+        // The header goes right before the block, so that deallocation
+        // doesn't need to search for it.
+        size_t __a = __align > _LIBCPP_ALIGNOF(__adhoc_header)
+            ? __align : _LIBCPP_ALIGNOF(__adhoc_header);
+        size_t __offset = __roundup(sizeof(__adhoc_header), __a);
+        if (__bytes > numeric_limits<size_t>::max() - __offset)
+            __throw_bad_alloc();
+        char* __start =
+            static_cast<char*>(__res_->allocate(__offset + __bytes, __a));
+        __adhoc_header* __h =
+            reinterpret_cast<__adhoc_header*>(__start + __offset) - 1;
+        __h->__prev_ = nullptr;
+        __h->__next_ = __adhoc_;
+        __h->__offset_ = __offset;
+        __h->__size_ = __offset + __bytes;
+        __h->__align_ = __a;
+        if (__adhoc_ != nullptr)
+            __adhoc_->__prev_ = __h;
+        __adhoc_ = __h;
+        return __start + __offset;
+    }
+
+    if (__fixed_pools_ == nullptr) {
+        __fixed_pools_ = static_cast<__fixed_pool*>(__res_->allocate(
+            __num_fixed_pools_ * sizeof(__fixed_pool),
+            _LIBCPP_ALIGNOF(__fixed_pool)));
+        for (int __j = 0; __j < __num_fixed_pools_; ++__j)
+            ::new ((void*)&__fixed_pools_[__j])
+                __fixed_pool(__smallest_block_size << __j);
+    }
+    return __fixed_pools_[__i].__allocate(
+        __res_, __smallest_block_size << __i, __max_blocks_per_chunk_);
+}
+
+void unsynchronized_pool_resource::do_deallocate(void* __p, size_t __bytes,
+                                                 size_t __align)
+{
+    _LIBCPP_ASSERT(__p != nullptr, "deallocating a null pointer");
+    int __i = __pool_index(__bytes, __align);
+    if (__i == __num_fixed_pools_) {
+        __adhoc_header* __h = static_cast<__adhoc_header*>(__p) - 1;
+        if (__h->__prev_ != nullptr)
+            __h->__prev_->__next_ = __h->__next_;
+        else
+            __adhoc_ = __h->__next_;
+        if (__h->__next_ != nullptr)
+            __h->__next_->__prev_ = __h->__prev_;
+        __res_->deallocate(static_cast<char*>(__p) - __h->__offset_,
+                           __h->__size_, __h->__align_);
+        return;
+    }
+    __fixed_pools_[__i].__evacuate(__p);
+}
+
+// 23.12.6, mem.res.monotonic.buffer
+
+struct monotonic_buffer_resource::__chunk_footer
+{
+    __chunk_footer* __next_;
+    char* __start_;
+    size_t __align_;
+};
+
+void monotonic_buffer_resource::release()
+{
+    __chunk_footer* __next;
+    for (__chunk_footer* __f = __chunks_; __f != nullptr; __f = __next) {
+        __next = __f->__next_;
+        size_t __size = reinterpret_cast<char*>(__f) - __f->__start_ +
+                        sizeof(__chunk_footer);
+        __res_->deallocate(__f->__start_, __size, __f->__align_);
+    }
+    __chunks_ = nullptr;
+
+    if (__initial_buffer_ != nullptr) {
+        __begin_ = static_cast<char*>(__initial_buffer_);
+        __cur_ = __begin_ + __initial_size_;
+        __next_size_ = __grow(__initial_size_ ? __initial_size_ : 1);
+    } else {
+        __begin_ = __cur_ = nullptr;
+        __next_size_ = __initial_size_;
+    }
+}
+
+void* monotonic_buffer_resource::do_allocate(size_t __bytes, size_t __align)
+{
+    // Fast path: carve the block off the end of the current buffer.
+    uintptr_t __cur = reinterpret_cast<uintptr_t>(__cur_);
+    if (__bytes <= __cur - reinterpret_cast<uintptr_t>(__begin_)) {
+        uintptr_t __p = (__cur - __bytes) & ~(uintptr_t(__align) - 1);
+        // There is no buffer yet if __begin_ is null.
+        if (__p >= reinterpret_cast<uintptr_t>(__begin_) && __p != 0) {
+            __cur_ = reinterpret_cast<char*>(__p);
+            return __cur_;
+        }
+    }
+
+    // Allocate a buffer that is large enough for this request, even after
+    // aligning it, and for the footer that links the buffers together.
+    const size_t __footer_align = _LIBCPP_ALIGNOF(__chunk_footer);
+    size_t __chunk_align = __align > __footer_align ? __align : __footer_align;
+    size_t __min_size = __roundup(__bytes, __footer_align);
+    if (__min_size < __bytes ||
+        __min_size > numeric_limits<size_t>::max() - sizeof(__chunk_footer))
+        __throw_bad_alloc();
+    size_t __size = __next_size_;
+    if (__size < __min_size)
+        __size = __min_size;
+    __size = __roundup(__size, __footer_align);
+    if (__size > numeric_limits<size_t>::max() - sizeof(__chunk_footer))
+        __size = __min_size;
+
+    char* __start = static_cast<char*>(
+        __res_->allocate(__size + sizeof(__chunk_footer), __chunk_align));
+    __chunk_footer* __f = reinterpret_cast<__chunk_footer*>(__start + __size);
+    __f->__next_ = __chunks_;
+    __f->__start_ = __start;
+    __f->__align_ = __chunk_align;
+    __chunks_ = __f;
+
+    __next_size_ = __grow(__size);
+
+    // The start of the buffer is aligned to __align, so the request fits.
+    __begin_ = __start;
+    __cur_ = reinterpret_cast<char*>(
+        (reinterpret_cast<uintptr_t>(__start + __size) - __bytes) &
+        ~(uintptr_t(__align) - 1));
+    return __cur_;
+}
+
+} // namespace pmr
+
+_LIBCPP_END_NAMESPACE_STD
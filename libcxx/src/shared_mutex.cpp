@@ -10,6 +10,11 @@
 #ifndef _LIBCPP_HAS_NO_THREADS
 
 #include "shared_mutex"
+#if defined(_LIBCPP_ABI_ATOMIC_SHARED_MUTEX)
+#include "atomic"
+#include "include/atomic_support.h"
+#include "include/atomic_wait.h"
+#endif
 #if defined(__unix__) &&  defined(__ELF__) && defined(_LIBCPP_HAS_COMMENT_LIB_PRAGMA)
 #pragma comment(lib, "pthread")
 #endif
@@ -22,6 +27,174 @@ __shared_mutex_base::__shared_mutex_base()
 {
 }
 
+#if defined(_LIBCPP_ABI_ATOMIC_SHARED_MUTEX)
+
+// __state_ is only accessed atomically. A reader increments the count while
+// __write_entered_ is clear; a writer sets __write_entered_, which turns new
+// readers away, and then waits for the count to drain. Threads that cannot
+// make progress sleep on __state_ through the atomic wait table, and are
+// woken by whoever clears the bits they are waiting for.
+
+namespace {
+
+typedef chrono::steady_clock::time_point __shared_mutex_deadline;
+
+// Returns once __state may have changed from __old, or false if __deadline
+// (when given) has passed first.
+bool
+__wait_for_state_change(unsigned* __state, unsigned __old,
+                        __shared_mutex_deadline const* __deadline)
+{
+    for (int __i = 0; __i < 64; ++__i)
+        if (__libcpp_atomic_load(__state, _AO_Relaxed) != __old)
+            return true;
+    __cxx_contention_t __monitor = __libcpp_atomic_monitor(__state);
+    if (__libcpp_atomic_load(__state, _AO_Seq) != __old)
+        return true;
+    if (__deadline == nullptr)
+    {
+        __libcpp_atomic_wait(__state, __monitor);
+        return true;
+    }
+    chrono::steady_clock::time_point __now = chrono::steady_clock::now();
+    if (__now >= *__deadline)
+        return false;
+    __libcpp_atomic_wait_for(__state, __monitor, *__deadline - __now);
+    return true;
+}
+
+bool
+__lock_exclusive(unsigned* __state, __shared_mutex_deadline const* __deadline)
+{
+    const unsigned __write_entered = __shared_mutex_base::__write_entered_;
+    const unsigned __n_readers = __shared_mutex_base::__n_readers_;
+    unsigned __s = 0;
+    if (__libcpp_atomic_compare_exchange(__state, &__s, __write_entered,
+                                         _AO_Acquire, _AO_Relaxed))
+        return true;
+    // Keep other writers and new readers out first...
+    while (true)
+    {
+        if (__s & __write_entered)
+        {
+            if (!__wait_for_state_change(__state, __s, __deadline))
+                return false;
+            __s = __libcpp_atomic_load(__state, _AO_Relaxed);
+        }
+        else if (__libcpp_atomic_compare_exchange(__state, &__s, __s | __write_entered,
+                                                  _AO_Acquire, _AO_Relaxed))
+            break;
+    }
+    // ...then wait for the readers that are already in to leave.
+    while (true)
+    {
+        __s = __libcpp_atomic_load(__state, _AO_Acquire);
+        if ((__s & __n_readers) == 0)
+            return true;
+        if (!__wait_for_state_change(__state, __s, __deadline))
+            break;
+    }
+    __s = __libcpp_atomic_load(__state, _AO_Relaxed);
+    while (!__libcpp_atomic_compare_exchange(__state, &__s, __s & ~__write_entered,
+                                             _AO_Release, _AO_Relaxed))
+        ;
+    __cxx_atomic_notify_all(__state);
+    return false;
+}
+
+bool
+__lock_shared(unsigned* __state, __shared_mutex_deadline const* __deadline)
+{
+    const unsigned __write_entered = __shared_mutex_base::__write_entered_;
+    const unsigned __n_readers = __shared_mutex_base::__n_readers_;
+    unsigned __s = __libcpp_atomic_load(__state, _AO_Relaxed);
+    while (true)
+    {
+        if ((__s & __write_entered) == 0 && (__s & __n_readers) != __n_readers)
+        {
+            if (__libcpp_atomic_compare_exchange(__state, &__s, __s + 1,
+                                                 _AO_Acquire, _AO_Relaxed))
+                return true;
+        }
+        else
+        {
+            if (!__wait_for_state_change(__state, __s, __deadline))
+                return false;
+            __s = __libcpp_atomic_load(__state, _AO_Relaxed);
+        }
+    }
+}
+
+} // namespace
+
+// Exclusive ownership
+
+void
+__shared_mutex_base::lock()
+{
+    __lock_exclusive(&__state_, nullptr);
+}
+
+bool
+__shared_mutex_base::try_lock()
+{
+    unsigned __s = 0;
+    return __libcpp_atomic_compare_exchange(&__state_, &__s, __write_entered_,
+                                            _AO_Acquire, _AO_Relaxed);
+}
+
+bool
+__shared_mutex_base::__try_lock_for(chrono::nanoseconds __rel_time)
+{
+    __shared_mutex_deadline __deadline = chrono::steady_clock::now() + __rel_time;
+    return __lock_exclusive(&__state_, &__deadline);
+}
+
+void
+__shared_mutex_base::unlock()
+{
+    __libcpp_atomic_store(&__state_, 0u, _AO_Release);
+    __cxx_atomic_notify_all(&__state_);
+}
+
+// Shared ownership
+
+void
+__shared_mutex_base::lock_shared()
+{
+    __lock_shared(&__state_, nullptr);
+}
+
+bool
+__shared_mutex_base::try_lock_shared()
+{
+    unsigned __s = __libcpp_atomic_load(&__state_, _AO_Relaxed);
+    while ((__s & __write_entered_) == 0 && (__s & __n_readers_) != __n_readers_)
+        if (__libcpp_atomic_compare_exchange(&__state_, &__s, __s + 1,
+                                             _AO_Acquire, _AO_Relaxed))
+            return true;
+    return false;
+}
+
+bool
+__shared_mutex_base::__try_lock_shared_for(chrono::nanoseconds __rel_time)
+{
+    __shared_mutex_deadline __deadline = chrono::steady_clock::now() + __rel_time;
+    return __lock_shared(&__state_, &__deadline);
+}
+
+void
+__shared_mutex_base::unlock_shared()
+{
+    unsigned __s = __libcpp_atomic_add(&__state_, -1, _AO_Release);
+    // Only the last reader out in front of a writer, and a reader that makes
+    // room below the maximum count, can have anybody waiting on them.
+    if (__s == __write_entered_ || __s == __n_readers_ - 1)
+        __cxx_atomic_notify_all(&__state_);
+}
+
+#else // _LIBCPP_ABI_ATOMIC_SHARED_MUTEX
+
 // Exclusive ownership
 
 void
@@ -102,6 +275,8 @@ __shared_mutex_base::unlock_shared()
     }
 }
 
+#endif // _LIBCPP_ABI_ATOMIC_SHARED_MUTEX
+
 
 // Shared Timed Mutex
 // These routines are here for ABI stability
@@ -0,0 +1,130 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// UNSUPPORTED: c++98, c++03
+
+// Not a portable test
+
+// <__hash_table>
+
+// Check that the unordered containers stay consistent with the bucket tags
+// of _LIBCPP_ABI_HASH_TABLE_BUCKET_TAGS through insertions, erasures, rehashes
+// and node transfers.
+
+#define _LIBCPP_ABI_HASH_TABLE_BUCKET_TAGS
+
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <cassert>
+#include <cstddef>
+
+#include "test_macros.h"
+#include "min_allocator.h"
+
+template <class Map>
+void check(const Map& m, const std::map<int, int>& ref) {
+    assert(m.size() == ref.size());
+    for (int k = -64; k < 2112; ++k) {
+        auto i = m.find(k);
+        auto r = ref.find(k);
+        if (r == ref.end()) {
+            assert(i == m.end());
+            assert(m.count(k) == 0);
+        } else {
+            assert(i != m.end());
+            assert(i->second == r->second);
+        }
+    }
+}
+
+template <class Map>
+void test_map() {
+    Map m;
+    std::map<int, int> ref;
+    check(m, ref);
+    for (int k = 0; k < 2048; k += 3) {
+        m[k] = k + 1;
+        ref[k] = k + 1;
+    }
+    check(m, ref);
+    for (int k = 0; k < 2048; k += 6) {
+        assert(m.erase(k) == 1);
+        ref.erase(k);
+    }
+    check(m, ref);
+    m.rehash(7);
+    check(m, ref);
+    m.rehash(4096);
+    check(m, ref);
+    for (int k = 1; k < 2048; k += 4) {
+        m.emplace(k, -k);
+        ref.emplace(k, -k);
+    }
+    check(m, ref);
+    Map copy(m);
+    check(copy, ref);
+    Map moved(std::move(copy));
+    check(moved, ref);
+    m.clear();
+    check(m, std::map<int, int>());
+    m.insert(std::make_pair(5, 6));
+    std::map<int, int> one;
+    one[5] = 6;
+    check(m, one);
+    m.swap(moved);
+    check(m, ref);
+    check(moved, one);
+}
+
+void test_multimap() {
+    std::unordered_multimap<int, int> m;
+    for (int i = 0; i < 4; ++i)
+        for (int k = 0; k < 512; ++k)
+            m.emplace(k * 7, i);
+    for (int k = 0; k < 512 * 7; ++k)
+        assert(m.count(k) == (k % 7 == 0 ? 4u : 0u));
+    for (int k = 0; k < 512; k += 2)
+        assert(m.erase(k * 7) == 4);
+    m.rehash(0);
+    for (int k = 0; k < 512 * 7; ++k)
+        assert(m.count(k) == (k % 7 == 0 && (k / 7) % 2 == 1 ? 4u : 0u));
+    auto hint = m.find(7);
+    m.emplace_hint(hint, 7, 4);
+    assert(m.count(7) == 5);
+}
+
+void test_node_handles() {
+#if TEST_STD_VER > 14
+    std::unordered_set<int> a, b;
+    for (int k = 0; k < 256; ++k)
+        a.insert(k);
+    for (int k = 0; k < 256; k += 2)
+        b.insert(a.extract(k));
+    for (int k = 0; k < 256; ++k) {
+        assert(a.count(k) == size_t(k % 2));
+        assert(b.count(k) == size_t(k % 2 == 0));
+    }
+    a.merge(b);
+    assert(b.empty());
+    for (int k = 0; k < 256; ++k)
+        assert(a.count(k) == 1);
+    for (int k = 256; k < 512; ++k)
+        assert(b.find(k) == b.end());
+#endif
+}
+
+int main(int, char**) {
+    test_map<std::unordered_map<int, int> >();
+    test_map<std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                min_allocator<std::pair<const int, int> > > >();
+    test_multimap();
+    test_node_handles();
+
+    return 0;
+}
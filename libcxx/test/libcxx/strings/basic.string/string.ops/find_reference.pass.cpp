@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// <string>
+
+// Compare the searches of basic_string<char>, which use vectors of candidate
+// positions and character bitmaps, with naive implementations over inputs
+// whose lengths and match positions straddle the vector widths.
+
+#include <string>
+#include <cassert>
+#include <cstddef>
+
+#include "test_macros.h"
+
+static std::size_t naive_find(const std::string& s, const std::string& p,
+                              std::size_t pos) {
+    for (std::size_t i = pos; i + p.size() <= s.size(); ++i) {
+        std::size_t j = 0;
+        while (j < p.size() && s[i + j] == p[j])
+            ++j;
+        if (j == p.size())
+            return i;
+    }
+    return std::string::npos;
+}
+
+static bool in_set(char c, const std::string& set) {
+    for (std::size_t i = 0; i < set.size(); ++i)
+        if (set[i] == c)
+            return true;
+    return false;
+}
+
+static std::size_t naive_first(const std::string& s, const std::string& set,
+                               std::size_t pos, bool in) {
+    for (std::size_t i = pos; i < s.size(); ++i)
+        if (in_set(s[i], set) == in)
+            return i;
+    return std::string::npos;
+}
+
+static std::size_t naive_last(const std::string& s, const std::string& set,
+                              std::size_t pos, bool in) {
+    std::size_t i = pos < s.size() ? pos + 1 : s.size();
+    while (i != 0)
+        if (in_set(s[--i], set) == in)
+            return i;
+    return std::string::npos;
+}
+
+static unsigned next(unsigned& state) {
+    state = state * 1103515245u + 12345u;
+    return state >> 16;
+}
+
+int main(int, char**) {
+    unsigned state = 1;
+    // A small alphabet, including bytes above 0x7f, gives many partial matches.
+    const char alphabet[] = {'a', 'b', 'c', '\0', '\x80', '\xff'};
+    for (int iter = 0; iter < 3000; ++iter) {
+        std::string s(next(state) % 100, 'a');
+        for (std::size_t i = 0; i < s.size(); ++i)
+            s[i] = alphabet[next(state) % 6];
+        std::string p(next(state) % 8, 'a');
+        for (std::size_t i = 0; i < p.size(); ++i)
+            p[i] = alphabet[next(state) % 6];
+        if (!p.empty() && next(state) % 2 && s.size() >= p.size())
+            s.replace(next(state) % (s.size() - p.size() + 1), p.size(), p);
+        for (std::size_t pos = 0; pos <= s.size() + 1; pos += 1 + next(state) % 9) {
+            assert(s.find(p, pos) == (pos > s.size() ? std::string::npos
+                                                     : naive_find(s, p, pos)));
+            assert(s.find_first_of(p, pos) == naive_first(s, p, pos, true));
+            assert(s.find_first_not_of(p, pos) == naive_first(s, p, pos, false));
+            assert(s.find_last_of(p, pos) ==
+                   (p.empty() ? std::string::npos : naive_last(s, p, pos, true)));
+            assert(s.find_last_not_of(p, pos) == naive_last(s, p, pos, false));
+        }
+    }
+
+    // A match that ends exactly at the end of a long string.
+    std::string long_s(1000, 'x');
+    long_s += "needle";
+    assert(long_s.find("needle") == 1000);
+    assert(long_s.find("needlf") == std::string::npos);
+    assert(long_s.find_first_of("den") == 1000);
+    assert(long_s.find_last_not_of("led") == 1000);
+
+    return 0;
+}
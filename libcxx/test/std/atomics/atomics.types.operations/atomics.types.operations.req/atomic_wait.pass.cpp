@@ -0,0 +1,105 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// UNSUPPORTED: libcpp-has-no-threads
+// UNSUPPORTED: c++98, c++03, c++11, c++14, c++17
+
+// <atomic>
+
+// template <class T>
+//     void
+//     atomic_wait(const volatile atomic<T>* obj, T old);
+//
+// template <class T>
+//     void
+//     atomic_wait(const atomic<T>* obj, T old);
+//
+// template <class T>
+//     void
+//     atomic_wait_explicit(const atomic<T>* obj, T old, memory_order m);
+//
+// template <class T>
+//     void
+//     atomic_notify_one(atomic<T>* obj);
+//
+// template <class T>
+//     void
+//     atomic_notify_all(atomic<T>* obj);
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <cassert>
+
+#include "test_macros.h"
+#include "atomic_helpers.h"
+
+template <class T>
+struct TestFn {
+  void operator()() const {
+    typedef std::atomic<T> A;
+    {
+      A t;
+      std::atomic_init(&t, T(1));
+      // Returns immediately when the value is not the old one.
+      std::atomic_wait(&t, T(0));
+      std::atomic_wait_explicit(&t, T(0), std::memory_order_acquire);
+      t.wait(T(0));
+
+      std::thread waiter([&] {
+        std::atomic_wait(&t, T(1));
+        assert(std::atomic_load(&t) == T(3));
+      });
+      std::atomic_store(&t, T(3));
+      std::atomic_notify_one(&t);
+      waiter.join();
+    }
+    {
+      volatile A vt;
+      std::atomic_init(&vt, T(2));
+      std::atomic_wait(&vt, T(0));
+      std::thread waiter1([&] {
+        vt.wait(T(2), std::memory_order_acquire);
+        assert(vt.load() == T(4));
+      });
+      std::thread waiter2([&] {
+        std::atomic_wait_explicit(&vt, T(2), std::memory_order_seq_cst);
+        assert(vt.load() == T(4));
+      });
+      vt.store(T(4));
+      std::atomic_notify_all(&vt);
+      waiter1.join();
+      waiter2.join();
+    }
+  }
+};
+
+int main(int, char**)
+{
+    TestEachAtomicType<TestFn>()();
+
+    // A value that is changed repeatedly while threads wait for each change.
+    std::atomic<int> counter(0);
+    const int rounds = 1000;
+    std::thread consumer([&] {
+      for (int i = 0; i < rounds; ++i) {
+        counter.wait(2 * i);
+        counter.store(2 * i + 2);
+        counter.notify_one();
+      }
+    });
+    for (int i = 0; i < rounds; ++i) {
+      counter.store(2 * i + 1);
+      counter.notify_one();
+      counter.wait(2 * i + 1);
+    }
+    consumer.join();
+    assert(counter.load() == 2 * rounds);
+
+  return 0;
+}
@@ -0,0 +1,154 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03
+// UNSUPPORTED: !libc++ && c++11
+// UNSUPPORTED: !libc++ && c++14
+
+// XFAIL: with_system_cxx_lib=macosx10.14
+// XFAIL: with_system_cxx_lib=macosx10.13
+// XFAIL: with_system_cxx_lib=macosx10.12
+// XFAIL: with_system_cxx_lib=macosx10.11
+// XFAIL: with_system_cxx_lib=macosx10.10
+// XFAIL: with_system_cxx_lib=macosx10.9
+// XFAIL: with_system_cxx_lib=macosx10.8
+// XFAIL: with_system_cxx_lib=macosx10.7
+
+// <charconv>
+
+// from_chars_result from_chars(const char* first, const char* last,
+//                              FloatingPoint& value,
+//                              chars_format fmt = chars_format::general);
+
+#include <charconv>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "test_macros.h"
+
+template <class T>
+void test(const char* s, T expected, size_t consumed,
+          std::chars_format fmt = std::chars_format::general)
+{
+    T value = T(42);
+    std::from_chars_result r =
+        std::from_chars(s, s + std::strlen(s), value, fmt);
+    assert(r.ec == std::errc());
+    assert(r.ptr == s + consumed);
+    assert(value == expected);
+    assert(std::signbit(value) == std::signbit(expected));
+}
+
+template <class T>
+void test_error(const char* s, std::errc ec, size_t consumed,
+                std::chars_format fmt = std::chars_format::general)
+{
+    T value = T(42);
+    std::from_chars_result r =
+        std::from_chars(s, s + std::strlen(s), value, fmt);
+    assert(r.ec == ec);
+    assert(r.ptr == s + consumed);
+    assert(value == T(42));
+}
+
+template <class T>
+void test_common()
+{
+    typedef std::numeric_limits<T> L;
+    const std::chars_format sci = std::chars_format::scientific;
+    const std::chars_format fixed = std::chars_format::fixed;
+    const std::chars_format hex = std::chars_format::hex;
+
+    test("0", T(0), 1);
+    test("-0", -T(0), 2);
+    test("1.5", T(1.5), 3);
+    test("-1.5e3", T(-1500), 6);
+    test(".25", T(0.25), 3);
+    test("25.", T(25), 3);
+    test("0.1", T(1) / 10, 3);
+    test("1e-7", T(1) / 10000000, 4);
+    test("00000000000000000000000001.5", T(1.5), 28);
+    test("1.50000000000000000000000000000000000001", T(1.5), 40);
+    test("1.5xyz", T(1.5), 3);
+    test("1.5e", T(1.5), 3);
+    test("1.5e+", T(1.5), 3);
+    test("0e99999999999999999999", T(0), 22);
+
+    // The exponent is required by scientific and not part of the number
+    // with fixed.
+    test("1.5E2", T(150), 5, sci);
+    test("1.5e2", T(1.5), 3, fixed);
+    test_error<T>("1.5", std::errc::invalid_argument, 0, sci);
+    test_error<T>("1.5e", std::errc::invalid_argument, 0, sci);
+
+    test("1.8p+1", T(3), 6, hex);
+    test("-1p-1", T(-0.5), 5, hex);
+    test("ff.8", T(255.5), 4, hex);
+    test("1P4", T(16), 3, hex);
+    test("0x1", T(0), 1, hex);
+
+    test("inf", L::infinity(), 3);
+    test("-INFINITY", -L::infinity(), 9);
+    test("infinit", L::infinity(), 3);
+    T value;
+    std::from_chars_result r = std::from_chars("nan(abc_1)x", "nan(abc_1)x" + 11, value);
+    assert(r.ec == std::errc() && std::isnan(value));
+    assert(*r.ptr == 'x');
+    r = std::from_chars("-NaN(", "-NaN(" + 5, value);
+    assert(r.ec == std::errc() && std::isnan(value) && std::signbit(value));
+    assert(*r.ptr == '(');
+
+    test_error<T>("", std::errc::invalid_argument, 0);
+    test_error<T>("-", std::errc::invalid_argument, 0);
+    test_error<T>(".", std::errc::invalid_argument, 0);
+    test_error<T>("+1", std::errc::invalid_argument, 0);
+    test_error<T>(" 1", std::errc::invalid_argument, 0);
+    test_error<T>("e5", std::errc::invalid_argument, 0);
+    test_error<T>("in", std::errc::invalid_argument, 0);
+    test_error<T>("p1", std::errc::invalid_argument, 0, hex);
+
+    test_error<T>("1e99999", std::errc::result_out_of_range, 7);
+    test_error<T>("-1e99999", std::errc::result_out_of_range, 8);
+    test_error<T>("1e-99999", std::errc::result_out_of_range, 8);
+    test_error<T>("1p99999", std::errc::result_out_of_range, 7, hex);
+}
+
+int main(int, char**)
+{
+    test_common<float>();
+    test_common<double>();
+    test_common<long double>();
+
+    // Correct rounding, including halfway cases and subnormals.
+    test("0.1", 0.1, 3);
+    test("9007199254740993", 9007199254740992.0, 16);
+    test("9007199254740993.0000000000000000001", 9007199254740994.0, 36);
+    test("2.2250738585072011e-308", 2.2250738585072009e-308, 23);
+    test("4.9406564584124654e-324", 5e-324, 23);
+    test("2.4703282292062328e-324", 5e-324, 23);
+    test_error<double>("2.4703282292062327e-324",
+                       std::errc::result_out_of_range, 23);
+    test("1.7976931348623157e308", 1.7976931348623157e308, 22);
+    test_error<double>("1.7976931348623159e308",
+                       std::errc::result_out_of_range, 22);
+    test("123456789012345678901234567890", 1.2345678901234568e29, 30);
+    test("1.fffffffffffff7p1023", 1.7976931348623157e308, 21,
+         std::chars_format::hex);
+    test("1p-1074", 5e-324, 7, std::chars_format::hex);
+    test("1.8p-1075", 5e-324, 9, std::chars_format::hex);
+
+    test("0.1", 0.1f, 3);
+    test("16777217", 16777216.0f, 8);
+    test("3.4028235e38", 3.4028235e38f, 12);
+    test_error<float>("3.4028236e38", std::errc::result_out_of_range, 12);
+    test("1e-45", 1e-45f, 5);
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03
+// UNSUPPORTED: !libc++ && c++11
+// UNSUPPORTED: !libc++ && c++14
+
+// XFAIL: with_system_cxx_lib=macosx10.14
+// XFAIL: with_system_cxx_lib=macosx10.13
+// XFAIL: with_system_cxx_lib=macosx10.12
+// XFAIL: with_system_cxx_lib=macosx10.11
+// XFAIL: with_system_cxx_lib=macosx10.10
+// XFAIL: with_system_cxx_lib=macosx10.9
+// XFAIL: with_system_cxx_lib=macosx10.8
+// XFAIL: with_system_cxx_lib=macosx10.7
+
+// <charconv>
+
+// to_chars_result to_chars(char* first, char* last, FloatingPoint value);
+// to_chars_result to_chars(char* first, char* last, FloatingPoint value,
+//                          chars_format fmt);
+// to_chars_result to_chars(char* first, char* last, FloatingPoint value,
+//                          chars_format fmt, int precision);
+
+#include <charconv>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+#include "test_macros.h"
+
+template <class T>
+void test(T value, const char* expected)
+{
+    char buf[400];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value);
+    assert(r.ec == std::errc());
+    assert(std::string(buf, r.ptr) == expected);
+
+    // The output must fit exactly.
+    size_t len = std::strlen(expected);
+    r = std::to_chars(buf, buf + len, value);
+    assert(r.ec == std::errc() && r.ptr == buf + len);
+    r = std::to_chars(buf, buf + len - 1, value);
+    assert(r.ec == std::errc::value_too_large && r.ptr == buf + len - 1);
+}
+
+template <class T>
+void test(T value, std::chars_format fmt, const char* expected)
+{
+    char buf[400];
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), value, fmt);
+    assert(r.ec == std::errc());
+    assert(std::string(buf, r.ptr) == expected);
+
+    size_t len = std::strlen(expected);
+    r = std::to_chars(buf, buf + len - 1, value, fmt);
+    assert(r.ec == std::errc::value_too_large && r.ptr == buf + len - 1);
+}
+
+template <class T>
+void test(T value, std::chars_format fmt, int precision, const char* expected)
+{
+    char buf[400];
+    std::to_chars_result r =
+        std::to_chars(buf, buf + sizeof(buf), value, fmt, precision);
+    assert(r.ec == std::errc());
+    assert(std::string(buf, r.ptr) == expected);
+
+    size_t len = std::strlen(expected);
+    r = std::to_chars(buf, buf + len, value, fmt, precision);
+    assert(r.ec == std::errc() && r.ptr == buf + len);
+    r = std::to_chars(buf, buf + len - 1, value, fmt, precision);
+    assert(r.ec == std::errc::value_too_large && r.ptr == buf + len - 1);
+}
+
+template <class T>
+void test_round_trip(T value)
+{
+    const std::chars_format formats[] = {
+        std::chars_format::scientific, std::chars_format::fixed,
+        std::chars_format::general, std::chars_format::hex};
+    // Large enough for the fixed notation of the largest long double.
+    static char buf[5000];
+    for (std::chars_format fmt : formats)
+    {
+        std::to_chars_result r =
+            std::to_chars(buf, buf + sizeof(buf), value, fmt);
+        assert(r.ec == std::errc());
+        T back;
+        std::from_chars_result fr = std::from_chars(buf, r.ptr, back, fmt);
+        assert(fr.ec == std::errc() && fr.ptr == r.ptr);
+        assert(back == value);
+    }
+}
+
+template <class T>
+void test_common()
+{
+    typedef std::numeric_limits<T> L;
+
+    test(T(0), "0");
+    test(-T(0), "-0");
+    test(T(1), "1");
+    test(T(-2.5), "-2.5");
+    test(T(1) / 10, "0.1");
+    test(T(1) / 10000000, "1e-07");
+    test(T(123456), "123456");
+    test(L::infinity(), "inf");
+    test(-L::infinity(), "-inf");
+    test(L::quiet_NaN(), "nan");
+
+    test(T(0), std::chars_format::scientific, "0e+00");
+    test(T(0), std::chars_format::fixed, "0");
+    test(T(0), std::chars_format::hex, "0p+0");
+    test(T(1.5), std::chars_format::scientific, "1.5e+00");
+    test(T(1500), std::chars_format::scientific, "1.5e+03");
+    test(T(1500), std::chars_format::fixed, "1500");
+    test(T(0.015625), std::chars_format::fixed, "0.015625");
+    test(T(123456), std::chars_format::general, "123456");
+    test(T(1234567), std::chars_format::general, "1.234567e+06");
+    test(T(1) / 10000, std::chars_format::general, "0.0001");
+    test(T(1) / 100000, std::chars_format::general, "1e-05");
+    test(L::infinity(), std::chars_format::scientific, "inf");
+
+    test(T(3.25), std::chars_format::fixed, 3, "3.250");
+    test(T(3.25), std::chars_format::scientific, 2, "3.25e+00");
+    test(T(3.25), std::chars_format::general, 2, "3.2");
+    test(T(3.25), std::chars_format::fixed, 0, "3");
+    test(L::infinity(), std::chars_format::hex, 2, "inf");
+    test(-L::infinity(), std::chars_format::hex, 2, "-inf");
+    test(L::quiet_NaN(), std::chars_format::hex, 2, "nan");
+    test(L::infinity(), std::chars_format::fixed, 2, "inf");
+    test(L::quiet_NaN(), std::chars_format::scientific, 2, "nan");
+
+    test_round_trip(T(1) / 10);
+    test_round_trip(T(-1234.5678));
+    test_round_trip(L::min());
+    test_round_trip(L::denorm_min());
+    test_round_trip(L::max());
+    test_round_trip(L::lowest());
+    test_round_trip(L::epsilon());
+}
+
+int main(int, char**)
+{
+    test_common<float>();
+    test_common<double>();
+    test_common<long double>();
+
+    // The shortest digits that read back as the same value.
+    test(0.3, "0.3");
+    test(2.0 / 3, "0.6666666666666666");
+    test(1e23, "1e+23");
+    test(5e-324, "5e-324");
+    test(1.7976931348623157e308, "1.7976931348623157e+308");
+    test(2.2250738585072014e-308, "2.2250738585072014e-308");
+    test(9007199254740993.0, "9007199254740992");
+    test(0.1f, "0.1");
+    test(2.0f / 3, "0.6666667");
+    test(3.4028235e38f, "3.4028235e+38");
+    test(1e-45f, "1e-45");
+
+    // Fixed notation spells large values out exactly, like printf.
+    test(1e23, std::chars_format::fixed, "99999999999999991611392");
+    test(1e22, std::chars_format::fixed, "10000000000000000000000");
+    test(3.4028235e38f, std::chars_format::fixed,
+         "340282346638528859811704183484516925440");
+    test(1e22, "1e+22");
+
+    test(3.0, std::chars_format::hex, "1.8p+1");
+    test(-0.5, std::chars_format::hex, "-1p-1");
+    test(3.0, std::chars_format::hex, 2, "1.80p+1");
+    test(3.0f, std::chars_format::hex, "1.8p+1");
+    test(5e-324, std::chars_format::hex, "0.0000000000001p-1022");
+    test(1e-45f, std::chars_format::hex, "0.000002p-126");
+    test(1.0f / 3, std::chars_format::hex, "1.555556p-2");
+
+    // With a precision, hex rounds to nearest even like %.*a, and float keeps
+    // its own subnormal form rather than that of the promoted double.
+    test(1.5, std::chars_format::hex, 0, "2p+0");
+    test(2.5, std::chars_format::hex, 0, "1p+1");
+    test(1.03125, std::chars_format::hex, 1, "1.0p+0");
+    test(5e-324, std::chars_format::hex, 2, "0.00p-1022");
+    test(1.0f / 3, std::chars_format::hex, 3, "1.555p-2");
+    test(1e-45f, std::chars_format::hex, 3, "0.000p-126");
+    test(1e-45f, std::chars_format::hex, 6, "0.000002p-126");
+    test(1e-45f, std::chars_format::hex, 8, "0.00000200p-126");
+    test(-1e-45f, std::chars_format::hex, 1, "-0.0p-126");
+    const float largest_subnormal = std::numeric_limits<float>::min() -
+                                    std::numeric_limits<float>::denorm_min();
+    test(largest_subnormal, std::chars_format::hex, 6, "0.fffffep-126");
+    test(largest_subnormal, std::chars_format::hex, 2, "1.00p-126");
+    test(1e-45f, std::chars_format::scientific, 2, "1.40e-45");
+
+    return 0;
+}
@@ -0,0 +1,56 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03, c++11, c++14
+
+// <memory_resource>
+
+// template <class T> class polymorphic_allocator;
+// and the std::pmr container aliases.
+
+#include <memory_resource>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <cassert>
+
+#include "test_macros.h"
+
+int main(int, char**)
+{
+    static_assert(std::is_same<std::pmr::vector<int>::allocator_type,
+                               std::pmr::polymorphic_allocator<int>>::value, "");
+    static_assert(std::is_same<std::pmr::string,
+                               std::basic_string<char, std::char_traits<char>,
+                                   std::pmr::polymorphic_allocator<char>>>::value, "");
+    {
+        std::pmr::polymorphic_allocator<int> a;
+        assert(a.resource() == std::pmr::get_default_resource());
+        std::pmr::polymorphic_allocator<long> b(a);
+        assert(a == b);
+        assert(a != std::pmr::polymorphic_allocator<int>(std::pmr::null_memory_resource()));
+    }
+    {
+        // The resource is propagated to the elements that use allocators.
+        std::pmr::monotonic_buffer_resource r;
+        std::pmr::vector<std::pmr::string> v(&r);
+        v.emplace_back("a string that is too long for the small buffer");
+        assert(v[0].get_allocator().resource() == &r);
+
+        std::pmr::map<int, std::pmr::string> m(&r);
+        m[1] = "another string that is too long for the small buffer";
+        assert(m[1].get_allocator().resource() == &r);
+
+        // Copies use the default resource.
+        std::pmr::vector<std::pmr::string> copy(v);
+        assert(copy.get_allocator().resource() == std::pmr::get_default_resource());
+    }
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03, c++11, c++14
+
+// <memory_resource>
+
+// memory_resource* new_delete_resource() noexcept;
+// memory_resource* null_memory_resource() noexcept;
+// memory_resource* get_default_resource() noexcept;
+// memory_resource* set_default_resource(memory_resource* r) noexcept;
+
+#include <memory_resource>
+#include <cassert>
+#include <cstdint>
+#include <new>
+
+#include "test_macros.h"
+
+int main(int, char**)
+{
+    std::pmr::memory_resource* nd = std::pmr::new_delete_resource();
+    std::pmr::memory_resource* null = std::pmr::null_memory_resource();
+    assert(nd == std::pmr::new_delete_resource());
+    assert(null == std::pmr::null_memory_resource());
+    assert(*nd == *nd);
+    assert(*nd != *null);
+    ASSERT_NOEXCEPT(std::pmr::new_delete_resource());
+    ASSERT_NOEXCEPT(std::pmr::get_default_resource());
+
+    {
+        // Over-aligned requests are honoured.
+        for (std::size_t align = 1; align <= 4096; align *= 2) {
+            void* p = nd->allocate(100, align);
+            assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+            nd->deallocate(p, 100, align);
+        }
+    }
+#ifndef TEST_HAS_NO_EXCEPTIONS
+    {
+        try {
+            null->allocate(1);
+            assert(false);
+        } catch (std::bad_alloc const&) {
+        }
+    }
+#endif
+    {
+        assert(std::pmr::get_default_resource() == nd);
+        assert(std::pmr::set_default_resource(null) == nd);
+        assert(std::pmr::get_default_resource() == null);
+        // A null pointer restores new_delete_resource().
+        assert(std::pmr::set_default_resource(nullptr) == null);
+        assert(std::pmr::get_default_resource() == nd);
+    }
+
+  return 0;
+}
@@ -0,0 +1,84 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03, c++11, c++14
+
+// <memory_resource>
+
+// class monotonic_buffer_resource
+
+#include <memory_resource>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "test_macros.h"
+
+struct counting_resource : std::pmr::memory_resource {
+    long live = 0;
+    long calls = 0;
+
+    void* do_allocate(std::size_t n, std::size_t a) override {
+        ++calls;
+        live += n;
+        return std::pmr::new_delete_resource()->allocate(n, a);
+    }
+    void do_deallocate(void* p, std::size_t n, std::size_t a) override {
+        live -= n;
+        std::pmr::new_delete_resource()->deallocate(p, n, a);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        return this == &o;
+    }
+};
+
+int main(int, char**)
+{
+    counting_resource up;
+    {
+        // The initial buffer is used before anything is requested upstream.
+        alignas(16) char buf[64];
+        std::pmr::monotonic_buffer_resource r(buf, sizeof(buf), &up);
+        assert(r.upstream_resource() == &up);
+        void* p = r.allocate(10, 1);
+        assert(p >= buf && p < buf + sizeof(buf));
+        assert(up.calls == 0);
+
+        for (int i = 0; i < 1000; ++i) {
+            std::size_t size = i % 100 + 1;
+            std::size_t align = std::size_t(1) << (i % 7);
+            void* q = r.allocate(size, align);
+            assert(reinterpret_cast<std::uintptr_t>(q) % align == 0);
+            std::memset(q, 0xAB, size);
+            r.deallocate(q, size, align);
+        }
+        void* big = r.allocate(1 << 20, 4096);
+        assert(reinterpret_cast<std::uintptr_t>(big) % 4096 == 0);
+        assert(up.live > 0);
+
+        // release() gives everything back and starts over with the buffer.
+        long calls = up.calls;
+        r.release();
+        assert(up.live == 0);
+        p = r.allocate(10, 1);
+        assert(p >= buf && p < buf + sizeof(buf));
+        assert(up.calls == calls);
+    }
+    assert(up.live == 0);
+    {
+        // The buffers grow geometrically, so few upstream calls are made.
+        std::pmr::monotonic_buffer_resource r(&up);
+        long calls = up.calls;
+        for (int i = 0; i < 100000; ++i)
+            r.allocate(8, 8);
+        assert(up.calls - calls < 40);
+    }
+    assert(up.live == 0);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// UNSUPPORTED: c++98, c++03, c++11, c++14
+
+// <memory_resource>
+
+// class unsynchronized_pool_resource
+// class synchronized_pool_resource
+
+#include <memory_resource>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "test_macros.h"
+
+struct counting_resource : std::pmr::memory_resource {
+    long live = 0;
+    long calls = 0;
+
+    void* do_allocate(std::size_t n, std::size_t a) override {
+        ++calls;
+        live += n;
+        return std::pmr::new_delete_resource()->allocate(n, a);
+    }
+    void do_deallocate(void* p, std::size_t n, std::size_t a) override {
+        live -= n;
+        std::pmr::new_delete_resource()->deallocate(p, n, a);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        return this == &o;
+    }
+};
+
+template <class Resource>
+void test_reuse(counting_resource& up)
+{
+    Resource r(&up);
+    assert(r.upstream_resource() == &up);
+    assert(r.options().largest_required_pool_block >= 4096);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 10000; ++i) {
+        std::size_t size = i % 5000 + 1;
+        std::size_t align = std::size_t(1) << (i % 8);
+        void* p = r.allocate(size, align);
+        assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+        std::memset(p, 0xAB, size);
+        blocks.push_back(p);
+    }
+    for (int i = 0; i < 10000; ++i)
+        r.deallocate(blocks[i], i % 5000 + 1, std::size_t(1) << (i % 8));
+
+    // Pooled blocks that were given back are handed out again without
+    // going upstream. Large and over-aligned blocks are not pooled.
+    long calls = up.calls;
+    blocks.clear();
+    for (int i = 0; i < 10000; ++i) {
+        std::size_t size = i % 5000 + 1;
+        std::size_t align = std::size_t(1) << (i % 8);
+        if (size > 4096 || align > alignof(std::max_align_t))
+            continue;
+        blocks.push_back(r.allocate(size, align));
+    }
+    assert(up.calls == calls);
+
+    r.release();
+    assert(up.live == 0);
+}
+
+int main(int, char**)
+{
+    counting_resource up;
+    test_reuse<std::pmr::unsynchronized_pool_resource>(up);
+    test_reuse<std::pmr::synchronized_pool_resource>(up);
+    {
+        // The options are rounded to what the implementation supports.
+        std::pmr::pool_options opts;
+        opts.max_blocks_per_chunk = 4;
+        opts.largest_required_pool_block = 100;
+        std::pmr::unsynchronized_pool_resource r(opts, &up);
+        assert(r.options().largest_required_pool_block >= 100);
+        assert(r.options().max_blocks_per_chunk >= 4);
+        void* p = r.allocate(100);
+        r.deallocate(p, 100);
+    }
+    assert(up.live == 0);
+
+  return 0;
+}
@@ -251,8 +251,20 @@ class BumpPointerAllocator {
 
   alignas(long double) char InitialBuffer[AllocSize];
   BlockMeta* BlockList = nullptr;
+  // Blocks released by reset(), which grow() reuses before calling malloc, so
+  // that a reused allocator stops allocating once it has seen its largest
+  // name.
+  BlockMeta* FreeList = nullptr;
+  // Allocations larger than a block. They are freed by reset().
+  BlockMeta* MassiveList = nullptr;
 
   void grow() {
+    if (FreeList) {
+      BlockMeta* Reused = FreeList;
+      FreeList = FreeList->Next;
+      BlockList = new (Reused) BlockMeta{BlockList, 0};
+      return;
+    }
     char* NewMeta = static_cast<char *>(std::malloc(AllocSize));
     if (NewMeta == nullptr)
       std::terminate();
@@ -264,7 +276,7 @@ class BumpPointerAllocator {
     BlockMeta* NewMeta = reinterpret_cast<BlockMeta*>(std::malloc(NBytes));
     if (NewMeta == nullptr)
       std::terminate();
-    BlockList->Next = new (NewMeta) BlockMeta{BlockList->Next, 0};
+    MassiveList = new (NewMeta) BlockMeta{MassiveList, 0};
     return static_cast<void*>(NewMeta + 1);
   }
 
@@ -288,13 +300,27 @@ public:
     while (BlockList) {
       BlockMeta* Tmp = BlockList;
       BlockList = BlockList->Next;
-      if (reinterpret_cast<char*>(Tmp) != InitialBuffer)
-        std::free(Tmp);
+      if (reinterpret_cast<char*>(Tmp) != InitialBuffer) {
+        Tmp->Next = FreeList;
+        FreeList = Tmp;
+      }
+    }
+    while (MassiveList) {
+      BlockMeta* Tmp = MassiveList;
+      MassiveList = MassiveList->Next;
+      std::free(Tmp);
     }
     BlockList = new (InitialBuffer) BlockMeta{nullptr, 0};
   }
 
-  ~BumpPointerAllocator() { reset(); }
+  ~BumpPointerAllocator() {
+    reset();
+    while (FreeList) {
+      BlockMeta* Tmp = FreeList;
+      FreeList = FreeList->Next;
+      std::free(Tmp);
+    }
+  }
 };
 
 class DefaultAllocator {
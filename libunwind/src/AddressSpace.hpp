@@ -12,6 +12,7 @@
 #ifndef __ADDRESSSPACE_HPP__
 #define __ADDRESSSPACE_HPP__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -149,6 +150,14 @@ extern char __exidx_end;
 #define ElfW(type) Elf_##type
 #endif
 
+// glibc reports in dl_phdr_info how many objects were loaded and unloaded so
+// far, which lets the sections found through dl_iterate_phdr() be cached until
+// the next dlopen() or dlclose().
+#if defined(_LIBUNWIND_SUPPORT_DWARF_UNWIND) && defined(__GLIBC__) &&          \
+    !defined(_LIBUNWIND_DISABLE_UNWIND_INFO_CACHE)
+#define _LIBUNWIND_USE_UNWIND_INFO_CACHE 1
+#endif
+
 #endif
 
 namespace libunwind {
@@ -179,6 +188,54 @@ struct UnwindInfoSections {
 };
 
 
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+/// Per-thread cache of the sections found by findUnwindSections(), keyed by
+/// the address range of the PT_LOAD segment holding the code. Being per-thread,
+/// it needs no lock.
+struct UnwindSectionsCache {
+  struct Entry {
+    uintptr_t begin;
+    uintptr_t end;
+    UnwindInfoSections sects;
+  };
+  enum { kNumEntries = 8 };
+
+  /// dlpi_adds + dlpi_subs when the entries were found, or 0 if unknown. Both
+  /// counters only grow, so the sum changes on every dlopen() or dlclose().
+  uint64_t generation;
+  unsigned next;
+  Entry entries[kNumEntries];
+
+  bool find(uintptr_t pc, UnwindInfoSections &sects) const {
+    for (unsigned i = 0; i < kNumEntries; ++i) {
+      if (entries[i].begin <= pc && pc < entries[i].end) {
+        sects = entries[i].sects;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void add(uintptr_t begin, uintptr_t end, const UnwindInfoSections &sects) {
+    entries[next].begin = begin;
+    entries[next].end = end;
+    entries[next].sects = sects;
+    next = (next + 1) % kNumEntries;
+  }
+
+  void reset(uint64_t newGeneration) {
+    memset(this, 0, sizeof(*this));
+    generation = newGeneration;
+  }
+
+  // Zero-initialized, like all thread-local data, which makes it empty.
+  static UnwindSectionsCache &get() {
+    static __thread UnwindSectionsCache cache;
+    return cache;
+  }
+};
+#endif
+
 /// LocalAddressSpace is used as a template parameter to UnwindCursor when
 /// unwinding a thread in the same process.  The wrappers compile away,
 /// making local unwinds fast.
@@ -227,6 +284,14 @@ public:
                         unw_word_t *offset);
   bool findUnwindSections(pint_t targetAddr, UnwindInfoSections &info);
   bool findOtherFDE(pint_t targetAddr, pint_t &fde);
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+  /// The generation of the objects loaded when this thread last called
+  /// findUnwindSections(). Data read from the sections it found can be cached
+  /// under it. 0 if it is unknown.
+  static uint64_t unwindInfoGeneration() {
+    return UnwindSectionsCache::get().generation;
+  }
+#endif
 
   static LocalAddressSpace sThisAddressSpace;
 };
@@ -475,17 +540,48 @@ inline bool LocalAddressSpace::findUnwindSections(pint_t targetAddr,
     LocalAddressSpace *addressSpace;
     UnwindInfoSections *sects;
     uintptr_t targetAddr;
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+    UnwindSectionsCache *cache;
+    bool checkedCache;
+    bool foundInCache;
+#endif
   };
 
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+  dl_iterate_cb_data cb_data = {this, &info, targetAddr,
+                                &UnwindSectionsCache::get(), false, false};
+#else
   dl_iterate_cb_data cb_data = {this, &info, targetAddr};
+#endif
   int found = dl_iterate_phdr(
-      [](struct dl_phdr_info *pinfo, size_t, void *data) -> int {
+      [](struct dl_phdr_info *pinfo, size_t size, void *data) -> int {
         auto cbdata = static_cast<dl_iterate_cb_data *>(data);
         bool found_obj = false;
         bool found_hdr = false;
 
         assert(cbdata);
         assert(cbdata->sects);
+        (void)size;
+
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+        // The counters are the same in every dl_phdr_info, so the cache is
+        // checked once, on the first object. Unless an object was loaded or
+        // unloaded since the entries were found, a hit ends the iteration.
+        if (!cbdata->checkedCache) {
+          cbdata->checkedCache = true;
+          if (size >= offsetof(struct dl_phdr_info, dlpi_subs) +
+                          sizeof(pinfo->dlpi_subs)) {
+            uint64_t generation = pinfo->dlpi_adds + pinfo->dlpi_subs;
+            if (cbdata->cache->generation != generation)
+              cbdata->cache->reset(generation);
+            else if (cbdata->cache->find(cbdata->targetAddr,
+                                         *cbdata->sects)) {
+              cbdata->foundInCache = true;
+              return true;
+            }
+          }
+        }
+#endif
 
         if (cbdata->targetAddr < pinfo->dlpi_addr) {
           return false;
@@ -571,6 +667,12 @@ inline bool LocalAddressSpace::findUnwindSections(pint_t targetAddr,
  #endif
       },
       &cb_data);
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+  // dwarf_section_length is the size of the PT_LOAD segment holding the code.
+  if (found && !cb_data.foundInCache && cb_data.cache->generation != 0)
+    cb_data.cache->add(info.dso_base, info.dso_base + info.dwarf_section_length,
+                       info);
+#endif
   return static_cast<bool>(found);
 #endif
 
@@ -214,6 +214,61 @@ void DwarfFDECache<A>::iterateCacheEntries(void (*func)(
 }
 #endif // defined(_LIBUNWIND_SUPPORT_DWARF_UNWIND)
 
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+/// Per-thread cache of the FDEs found before, so that unwinding through a
+/// function seen before skips the .eh_frame_hdr search. Entries cover the PC
+/// range of their FDE, and are only valid for the generation of loaded objects
+/// they were found in. Being per-thread, it needs no lock. Only the location of
+/// the FDE is kept, and a hit decodes it again, which keeps the cache at 1KB of
+/// thread-local storage in every thread of the process.
+template <typename A>
+class _LIBUNWIND_HIDDEN DwarfFDEThreadCache {
+  typedef typename A::pint_t pint_t;
+  typedef typename CFI_Parser<A>::FDE_Info FDE_Info;
+  typedef typename CFI_Parser<A>::CIE_Info CIE_Info;
+
+public:
+  static bool find(A &addressSpace, pint_t pc, uint64_t generation,
+                   FDE_Info *fdeInfo, CIE_Info *cieInfo) {
+    const entry &e = entries()[slot(pc)];
+    if (e.generation != generation || pc < e.pcStart || pc >= e.pcEnd)
+      return false;
+    return CFI_Parser<A>::decodeFDE(addressSpace, e.fdeStart, fdeInfo,
+                                    cieInfo) == NULL;
+  }
+
+  static void add(pint_t pc, uint64_t generation, const FDE_Info &fdeInfo) {
+    entry &e = entries()[slot(pc)];
+    e.generation = generation;
+    e.pcStart = fdeInfo.pcStart;
+    e.pcEnd = fdeInfo.pcEnd;
+    e.fdeStart = fdeInfo.fdeStart;
+  }
+
+private:
+  struct entry {
+    uint64_t generation;
+    pint_t pcStart;
+    pint_t pcEnd;
+    pint_t fdeStart;
+  };
+
+  // A power of two. Entries are direct-mapped by the PC looked up, which
+  // keeps the deepest stacks of a thread in the cache.
+  static const size_t kNumEntries = 32;
+
+  static size_t slot(pint_t pc) {
+    return (size_t)((pc >> 2) ^ (pc >> 7)) & (kNumEntries - 1);
+  }
+
+  // Zero-initialized, and no generation is 0, which makes it empty.
+  static entry *entries() {
+    static __thread entry cache[kNumEntries];
+    return cache;
+  }
+};
+#endif // defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+
 
 #define arrayoffsetof(type, index, field) ((size_t)(&((type *)0)[index].field))
 
@@ -1454,8 +1509,17 @@ bool UnwindCursor<A, R>::getInfoFromDwarfSection(pint_t pc,
   typename CFI_Parser<A>::CIE_Info cieInfo;
   bool foundFDE = false;
   bool foundInCache = false;
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+  // Only set by findUnwindSections(), which was called for these sections.
+  uint64_t generation = _addressSpace.unwindInfoGeneration();
+  bool foundInThreadCache =
+      generation != 0 &&
+      DwarfFDEThreadCache<A>::find(_addressSpace, pc, generation, &fdeInfo,
+                                   &cieInfo);
+  foundFDE = foundInCache = foundInThreadCache;
+#endif
   // If compact encoding table gave offset into dwarf section, go directly there
-  if (fdeSectionOffsetHint != 0) {
+  if (!foundFDE && fdeSectionOffsetHint != 0) {
     foundFDE = CFI_Parser<A>::findFDE(_addressSpace, pc, sects.dwarf_section,
                                     (uint32_t)sects.dwarf_section_length,
                                     sects.dwarf_section + fdeSectionOffsetHint,
@@ -1501,6 +1565,10 @@ bool UnwindCursor<A, R>::getInfoFromDwarfSection(pint_t pc,
       _info.unwind_info_size  = (uint32_t)fdeInfo.fdeLength;
       _info.extra             = (unw_word_t) sects.dso_base;
 
+#if defined(_LIBUNWIND_USE_UNWIND_INFO_CACHE)
+      if (generation != 0 && !foundInThreadCache)
+        DwarfFDEThreadCache<A>::add(pc, generation, fdeInfo);
+#endif
       // Add to cache (to make next lookup faster) if we had no hint
       // and there was no index.
       if (!foundInCache && (fdeSectionOffsetHint == 0)) {
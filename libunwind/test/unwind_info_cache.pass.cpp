@@ -0,0 +1,71 @@
+// The second walk of the same stack finds the FDEs in the caches of the
+// thread. It must see the same frames and procedure info as the first walk.
+
+#include <libunwind.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_FRAMES 100
+
+struct frame_info {
+  unw_word_t ip;
+  unw_proc_info_t info;
+};
+
+int walk(frame_info *frames) {
+  unw_context_t context;
+  unw_getcontext(&context);
+
+  unw_cursor_t cursor;
+  unw_init_local(&cursor, &context);
+
+  int n = 0;
+  do {
+    if (n == MAX_FRAMES)
+      abort();
+    memset(&frames[n], 0, sizeof(frames[n]));
+    unw_get_reg(&cursor, UNW_REG_IP, &frames[n].ip);
+    unw_get_proc_info(&cursor, &frames[n].info);
+    ++n;
+  } while (unw_step(&cursor) > 0);
+  return n;
+}
+
+void compare_walks() {
+  static frame_info frames[4][MAX_FRAMES];
+  int counts[4];
+  for (int i = 0; i < 4; ++i)
+    counts[i] = walk(frames[i]);
+
+  // The frame of walk() itself is at another IP in each walk.
+  frame_info *first = frames[0];
+  for (int i = 1; i < 4; ++i) {
+    frame_info *other = frames[i];
+    if (counts[i] != counts[0])
+      abort();
+    for (int j = 1; j < counts[0]; ++j) {
+      if (first[j].ip != other[j].ip ||
+          first[j].info.start_ip != other[j].info.start_ip ||
+          first[j].info.end_ip != other[j].info.end_ip ||
+          first[j].info.lsda != other[j].info.lsda ||
+          first[j].info.handler != other[j].info.handler ||
+          first[j].info.unwind_info != other[j].info.unwind_info ||
+          first[j].info.unwind_info_size != other[j].info.unwind_info_size)
+        abort();
+    }
+  }
+}
+
+int recurse(int i) {
+  if (i == 0) {
+    compare_walks();
+    return 0;
+  }
+  return i + recurse(i - 1);
+}
+
+int main() {
+  if (recurse(40) != 820)
+    abort();
+  return 0;
+}
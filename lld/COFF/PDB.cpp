@@ -57,6 +57,7 @@
 #include "llvm/Support/JamCRC.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ScopedPrinter.h"
+#include <atomic>
 #include <memory>
 
 using namespace lld;
@@ -101,6 +102,10 @@ public:
   /// Link CodeView from each object file in the symbol table into the PDB.
   void addObjectsToPDB();
 
+  /// Compute the global type hashes of the object files that will need them
+  /// for /DEBUG:GHASH, in parallel.
+  void computeGlobalHashes();
+
   /// Link info for each import file in the symbol table into the PDB.
   void addImportFilesToPDB(ArrayRef<OutputSection *> OutputSections);
 
@@ -184,6 +189,10 @@ private:
   /// far.
   std::map<uint32_t, CVIndexMap> PrecompTypeIndexMappings;
 
+  /// Global type hashes computed by computeGlobalHashes() that haven't been
+  /// used by mergeDebugT() yet.
+  DenseMap<ObjFile *, std::vector<GloballyHashedType>> GlobalHashes;
+
   // For statistics
   uint64_t GlobalSymbols = 0;
   uint64_t ModuleSymbols = 0;
@@ -323,13 +332,28 @@ static void addTypeInfo(pdb::TpiStreamBuilder &TpiBuilder,
   // Start the TPI or IPI stream header.
   TpiBuilder.setVersionHeader(pdb::PdbTpiV80);
 
-  // Flatten the in memory type table and hash each type.
-  TypeTable.ForEachRecord([&](TypeIndex TI, const CVType &Type) {
-    auto Hash = pdb::hashTypeRecord(Type);
-    if (auto E = Hash.takeError())
-      fatal("type hashing error");
-    TpiBuilder.addTypeRecord(Type.RecordData, *Hash);
+  // Flatten the in memory type table and hash each type. The types are
+  // hashed in parallel and then added in order.
+  std::vector<CVType> Types;
+  TypeTable.ForEachRecord(
+      [&](TypeIndex TI, const CVType &Type) { Types.push_back(Type); });
+
+  std::vector<uint32_t> Hashes(Types.size());
+  std::atomic<bool> HashingFailed(false);
+  parallelForEachN(0, Types.size(), [&](size_t I) {
+    Expected<uint32_t> Hash = pdb::hashTypeRecord(Types[I]);
+    if (!Hash) {
+      consumeError(Hash.takeError());
+      HashingFailed = true;
+      return;
+    }
+    Hashes[I] = *Hash;
   });
+  if (HashingFailed)
+    fatal("type hashing error");
+
+  for (size_t I = 0, E = Types.size(); I != E; ++I)
+    TpiBuilder.addTypeRecord(Types[I].RecordData, Hashes[I]);
 }
 
 Expected<const CVIndexMap &>
@@ -393,10 +417,16 @@ PDBLinker::mergeDebugT(ObjFile *File, CVIndexMap *ObjectIndexMap) {
   if (Config->DebugGHashes) {
     ArrayRef<GloballyHashedType> Hashes;
     std::vector<GloballyHashedType> OwnedHashes;
-    if (Optional<ArrayRef<uint8_t>> DebugH = getDebugH(File))
+    if (Optional<ArrayRef<uint8_t>> DebugH = getDebugH(File)) {
       Hashes = getHashesFromDebugH(*DebugH);
-    else {
-      OwnedHashes = GloballyHashedType::hashTypes(Types);
+    } else {
+      auto It = GlobalHashes.find(File);
+      if (It != GlobalHashes.end()) {
+        OwnedHashes = std::move(It->second);
+        GlobalHashes.erase(It);
+      } else {
+        OwnedHashes = GloballyHashedType::hashTypes(Types);
+      }
       Hashes = OwnedHashes;
     }
 
@@ -1275,6 +1305,32 @@ static PublicSym32 createPublic(Defined *Def) {
   return Pub;
 }
 
+// Hashing the types of a file doesn't depend on any other file, unlike
+// merging them, so the hashes mergeDebugT() would compute are computed for all
+// files in parallel up front. Objects that use precompiled headers or a type
+// server get their type streams rewritten or replaced while merging, so they
+// are still hashed then.
+void PDBLinker::computeGlobalHashes() {
+  ScopedTimer T(TypeMergingTimer);
+
+  std::vector<ObjFile *> Files;
+  for (ObjFile *File : ObjFile::Instances) {
+    if (!File->DebugTypesObj || getDebugH(File))
+      continue;
+    TpiSource::TpiKind Kind = File->DebugTypesObj->Kind;
+    if (Kind == TpiSource::Regular || Kind == TpiSource::PCH)
+      Files.push_back(File);
+  }
+
+  std::vector<std::vector<GloballyHashedType>> Hashes(Files.size());
+  parallelForEachN(0, Files.size(), [&](size_t I) {
+    Hashes[I] = GloballyHashedType::hashTypes(*Files[I]->DebugTypes);
+  });
+
+  for (size_t I = 0, E = Files.size(); I != E; ++I)
+    GlobalHashes[Files[I]] = std::move(Hashes[I]);
+}
+
 // Add all object files to the PDB. Merge .debug$T sections into IpiData and
 // TpiData.
 void PDBLinker::addObjectsToPDB() {
@@ -1282,6 +1338,9 @@ void PDBLinker::addObjectsToPDB() {
 
   createModuleDBI(Builder);
 
+  if (Config->DebugGHashes)
+    computeGlobalHashes();
+
   for (ObjFile *File : ObjFile::Instances)
     addObjFile(File);
 
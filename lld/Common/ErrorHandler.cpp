@@ -40,6 +40,20 @@ static void newline(raw_ostream *ErrorOS, const Twine &Msg) {
   Flag = StringRef(Msg.str()).contains('\n');
 }
 
+// The buffer set by bufferDiagnostics() on this thread.
+static thread_local std::vector<BufferedDiagnostic> *DiagnosticBuffer;
+
+void lld::bufferDiagnostics(std::vector<BufferedDiagnostic> *Buffer) {
+  DiagnosticBuffer = Buffer;
+}
+
+void lld::reportDiagnostic(const BufferedDiagnostic &D) {
+  if (D.IsError)
+    error(D.Msg);
+  else
+    warn(D.Msg);
+}
+
 ErrorHandler &lld::errorHandler() {
   static ErrorHandler Handler;
   return Handler;
@@ -113,6 +127,10 @@ void ErrorHandler::warn(const Twine &Msg) {
     error(Msg);
     return;
   }
+  if (DiagnosticBuffer) {
+    DiagnosticBuffer->push_back({false, Msg.str()});
+    return;
+  }
 
   std::lock_guard<std::mutex> Lock(Mu);
   newline(ErrorOS, Msg);
@@ -121,6 +139,11 @@ void ErrorHandler::warn(const Twine &Msg) {
 }
 
 void ErrorHandler::error(const Twine &Msg) {
+  if (DiagnosticBuffer) {
+    DiagnosticBuffer->push_back({true, Msg.str()});
+    return;
+  }
+
   std::lock_guard<std::mutex> Lock(Mu);
   newline(ErrorOS, Msg);
 
@@ -138,6 +161,7 @@ void ErrorHandler::error(const Twine &Msg) {
 }
 
 void ErrorHandler::fatal(const Twine &Msg) {
+  DiagnosticBuffer = nullptr;
   error(Msg);
   exitLld(1);
 }
@@ -7,6 +7,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "lld/Common/Memory.h"
+#include <mutex>
 
 using namespace llvm;
 using namespace lld;
@@ -15,6 +16,15 @@ BumpPtrAllocator lld::BAlloc;
 StringSaver lld::Saver{BAlloc};
 std::vector<SpecificAllocBase *> lld::SpecificAllocBase::Instances;
 
+// Guards Instances, as the allocators of different types may be created by
+// several threads at once.
+static std::mutex InstancesMutex;
+
+SpecificAllocBase::SpecificAllocBase() {
+  std::lock_guard<std::mutex> Lock(InstancesMutex);
+  Instances.push_back(this);
+}
+
 void lld::freeArena() {
   for (SpecificAllocBase *Alloc : SpecificAllocBase::Instances)
     Alloc->reset();
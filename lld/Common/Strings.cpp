@@ -28,12 +28,12 @@ Optional<std::string> lld::demangleItanium(StringRef Name) {
   if (!Name.startswith("_Z"))
     return None;
 
-  char *Buf = itaniumDemangle(Name.str().c_str(), nullptr, nullptr, nullptr);
+  // Errors may be reported from several threads, each with its own context.
+  static thread_local ItaniumDemangleContext Demangler;
+  const char *Buf = Demangler.demangle(Name.data(), Name.size());
   if (!Buf)
     return None;
-  std::string S(Buf);
-  free(Buf);
-  return S;
+  return std::string(Buf);
 }
 
 Optional<std::string> lld::demangleMSVC(StringRef Name) {
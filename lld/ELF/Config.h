@@ -104,9 +104,12 @@ struct Configuration {
   llvm::StringRef ProgName;
   llvm::StringRef PrintSymbolOrder;
   llvm::StringRef SoName;
+  llvm::StringRef SymbolIndexCache;
   llvm::StringRef Sysroot;
   llvm::StringRef ThinLTOCacheDir;
+  llvm::StringRef ThinLTOCacheStore;
   llvm::StringRef ThinLTOIndexOnlyArg;
+  llvm::StringRef TimeTraceFile;
   std::pair<llvm::StringRef, llvm::StringRef> ThinLTOObjectSuffixReplace;
   std::pair<llvm::StringRef, llvm::StringRef> ThinLTOPrefixReplace;
   std::string Rpath;
@@ -158,6 +161,7 @@ struct Configuration {
   bool HasDynSymTab;
   bool IgnoreDataAddressEquality;
   bool IgnoreFunctionAddressEquality;
+  bool Incremental;
   bool LTOCSProfileGenerate;
   bool LTODebugPassManager;
   bool LTONewPassManager;
@@ -185,6 +189,8 @@ struct Configuration {
   bool Trace;
   bool ThinLTOEmitImportsFiles;
   bool ThinLTOIndexOnly;
+  bool ThinLTOStreamToDisk;
+  bool TimeTraceEnabled;
   bool TocOptimize;
   bool UndefinedVersion;
   bool UseAndroidRelrTags = false;
@@ -229,6 +235,7 @@ struct Configuration {
   uint64_t CommonPageSize;
   uint64_t MaxPageSize;
   uint64_t MipsGotSize;
+  uint64_t ThinLTOMemoryBudget;
   uint64_t ZStackSize;
   unsigned LTOPartitions;
   unsigned LTOO;
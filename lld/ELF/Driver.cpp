@@ -25,6 +25,7 @@
 #include "Driver.h"
 #include "Config.h"
 #include "ICF.h"
+#include "Incremental.h"
 #include "InputFiles.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
@@ -55,6 +56,7 @@
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TarWriter.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 #include <cstdlib>
 #include <utility>
@@ -286,6 +288,22 @@ static void initLLVM() {
   InitializeAllAsmParsers();
 }
 
+// Writes the events recorded for --time-trace as a Chrome trace, which can
+// be loaded into chrome://tracing or speedscope.
+static void writeTimeTrace() {
+  std::string Path = Config->TimeTraceFile;
+  if (Path.empty())
+    Path = (Config->OutputFile + ".time-trace").str();
+
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::F_Text);
+  if (EC) {
+    error("cannot open " + Path + ": " + EC.message());
+    return;
+  }
+  timeTraceProfilerWrite(OS);
+}
+
 // Some command line options or some combinations of them are not allowed.
 // This function checks for such errors.
 static void checkOptions() {
@@ -463,21 +481,32 @@ void LinkerDriver::main(ArrayRef<const char *> ArgsArr) {
   // values such as a default image base address.
   Target = getTarget();
 
-  switch (Config->EKind) {
-  case ELF32LEKind:
-    link<ELF32LE>(Args);
-    return;
-  case ELF32BEKind:
-    link<ELF32BE>(Args);
-    return;
-  case ELF64LEKind:
-    link<ELF64LE>(Args);
-    return;
-  case ELF64BEKind:
-    link<ELF64BE>(Args);
-    return;
-  default:
-    llvm_unreachable("unknown Config->EKind");
+  if (Config->TimeTraceEnabled)
+    timeTraceProfilerInitialize(errorHandler().LogName);
+
+  {
+    llvm::TimeTraceScope TimeScope("Link", StringRef(""));
+    switch (Config->EKind) {
+    case ELF32LEKind:
+      link<ELF32LE>(Args);
+      break;
+    case ELF32BEKind:
+      link<ELF32BE>(Args);
+      break;
+    case ELF64LEKind:
+      link<ELF64LE>(Args);
+      break;
+    case ELF64BEKind:
+      link<ELF64BE>(Args);
+      break;
+    default:
+      llvm_unreachable("unknown Config->EKind");
+    }
+  }
+
+  if (Config->TimeTraceEnabled) {
+    writeTimeTrace();
+    timeTraceProfilerCleanup();
   }
 }
 
@@ -834,6 +863,8 @@ static void readConfigs(opt::InputArgList &Args) {
       Args.hasArg(OPT_ignore_data_address_equality);
   Config->IgnoreFunctionAddressEquality =
       Args.hasArg(OPT_ignore_function_address_equality);
+  Config->Incremental =
+      Args.hasFlag(OPT_incremental, OPT_no_incremental, false);
   Config->Init = Args.getLastArgValue(OPT_init, "_init");
   Config->LTOAAPipeline = Args.getLastArgValue(OPT_lto_aa_pipeline);
   Config->LTOCSProfileGenerate = Args.hasArg(OPT_lto_cs_profile_generate);
@@ -880,10 +911,12 @@ static void readConfigs(opt::InputArgList &Args) {
   Config->SortSection = getSortSection(Args);
   Config->SplitStackAdjustSize = args::getInteger(Args, OPT_split_stack_adjust_size, 16384);
   Config->Strip = getStrip(Args);
+  Config->SymbolIndexCache = Args.getLastArgValue(OPT_symbol_index_cache);
   Config->Sysroot = Args.getLastArgValue(OPT_sysroot);
   Config->Target1Rel = Args.hasFlag(OPT_target1_rel, OPT_target1_abs, false);
   Config->Target2 = getTarget2(Args);
   Config->ThinLTOCacheDir = Args.getLastArgValue(OPT_thinlto_cache_dir);
+  Config->ThinLTOCacheStore = Args.getLastArgValue(OPT_thinlto_cache_store);
   Config->ThinLTOCachePolicy = CHECK(
       parseCachePruningPolicy(Args.getLastArgValue(OPT_thinlto_cache_policy)),
       "--thinlto-cache-policy: invalid cache policy");
@@ -894,10 +927,16 @@ static void readConfigs(opt::InputArgList &Args) {
   Config->ThinLTOIndexOnlyArg =
       Args.getLastArgValue(OPT_plugin_opt_thinlto_index_only_eq);
   Config->ThinLTOJobs = args::getInteger(Args, OPT_thinlto_jobs, -1u);
+  Config->ThinLTOMemoryBudget =
+      args::getInteger(Args, OPT_thinlto_memory_budget, 0);
   Config->ThinLTOObjectSuffixReplace =
       getOldNewOptions(Args, OPT_plugin_opt_thinlto_object_suffix_replace_eq);
   Config->ThinLTOPrefixReplace =
       getOldNewOptions(Args, OPT_plugin_opt_thinlto_prefix_replace_eq);
+  Config->ThinLTOStreamToDisk = Args.hasArg(OPT_thinlto_stream_to_disk);
+  Config->TimeTraceEnabled = Args.hasArg(OPT_time_trace) ||
+                             Args.hasArg(OPT_time_trace_file);
+  Config->TimeTraceFile = Args.getLastArgValue(OPT_time_trace_file);
   Config->Trace = Args.hasArg(OPT_trace);
   Config->Undefined = args::getStrings(Args, OPT_undefined);
   Config->UndefinedVersion =
@@ -952,6 +991,10 @@ static void readConfigs(opt::InputArgList &Args) {
     error("--lto-partitions: number of threads must be > 0");
   if (Config->ThinLTOJobs == 0)
     error("--thinlto-jobs: number of threads must be > 0");
+  if (int64_t(Config->ThinLTOMemoryBudget) < 0)
+    error("--thinlto-memory-budget: budget must be >= 0");
+  if (!Config->ThinLTOCacheStore.empty() && Config->ThinLTOCacheDir.empty())
+    error("--thinlto-cache-store requires --thinlto-cache-dir");
 
   if (Config->SplitStackAdjustSize < 0)
     error("--split-stack-adjust-size: size must be >= 0");
@@ -1675,6 +1718,13 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   if (Config->OutputFile.empty())
     Config->OutputFile = "a.out";
 
+  // With --incremental, the outputs may already be what this link would
+  // produce. See Incremental.cpp.
+  if (Config->Incremental && isIncrementalUpToDate(Args)) {
+    log(Config->OutputFile + " is up to date");
+    return;
+  }
+
   // Fail early if the output file or map file is not writable. If a user has a
   // long link, e.g. due to a large LTO link, they do not wish to run it and
   // find that it failed because there was a mistake in their command-line.
@@ -1701,8 +1751,18 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   // symbols that we need to the symbol table. This process might
   // add files to the link, via autolinking, these files are always
   // appended to the Files vector.
-  for (size_t I = 0; I < Files.size(); ++I)
-    parseFile(Files[I]);
+  //
+  // Symbol names are decoded and hashed for all object files in parallel
+  // first. Symbols are still added in command line order, because the order
+  // of resolution decides which archive members are fetched.
+  {
+    llvm::TimeTraceScope TimeScope("Parse input files", [&] {
+      return std::to_string(Files.size()) + " files";
+    });
+    preparseFiles(Files);
+    for (size_t I = 0; I < Files.size(); ++I)
+      parseFile(Files[I]);
+  }
 
   // Now that we have every file, we can decide if we will need a
   // dynamic symbol table.
@@ -1794,7 +1854,12 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   //
   // With this the symbol table should be complete. After this, no new names
   // except a few linker-synthesized ones will be added to the symbol table.
-  compileBitcodeFiles<ELFT>();
+  {
+    llvm::TimeTraceScope TimeScope("LTO", [&] {
+      return std::to_string(BitcodeFiles.size()) + " bitcode files";
+    });
+    compileBitcodeFiles<ELFT>();
+  }
   if (errorCount())
     return;
 
@@ -1884,11 +1949,25 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
 
   // Do size optimizations: garbage collection, merging of SHF_MERGE sections
   // and identical code folding.
-  splitSections<ELFT>();
-  markLive<ELFT>();
+  {
+    llvm::TimeTraceScope TimeScope("Split sections", [&] {
+      return std::to_string(InputSections.size()) + " sections";
+    });
+    splitSections<ELFT>();
+  }
+  {
+    llvm::TimeTraceScope TimeScope("GC", StringRef(""));
+    markLive<ELFT>();
+  }
   demoteSharedSymbols();
-  mergeSections();
+  {
+    llvm::TimeTraceScope TimeScope("Merge sections", StringRef(""));
+    mergeSections();
+  }
   if (Config->ICF != ICFLevel::None) {
+    llvm::TimeTraceScope TimeScope("ICF", [&] {
+      return std::to_string(InputSections.size()) + " sections";
+    });
     findKeepUniqueSections<ELFT>(Args);
     doIcf<ELFT>();
   }
@@ -1902,5 +1981,11 @@ template <class ELFT> void LinkerDriver::link(opt::InputArgList &Args) {
   }
 
   // Write the result to the file.
-  writeResult<ELFT>();
+  {
+    llvm::TimeTraceScope TimeScope("Write output file", StringRef(""));
+    writeResult<ELFT>();
+  }
+
+  if (Config->Incremental && !errorCount())
+    writeIncrementalState(Args);
 }
@@ -100,6 +100,12 @@ public:
 private:
   void segregate(size_t Begin, size_t End, bool Constant);
 
+  template <class RelTy>
+  void collectTargets(InputSection *IS, ArrayRef<RelTy> Rels,
+                      std::vector<uint32_t> &Out);
+
+  bool isDirty(size_t Begin, size_t End);
+
   template <class RelTy>
   bool constantEq(const InputSection *A, ArrayRef<RelTy> RelsA,
                   const InputSection *B, ArrayRef<RelTy> RelsB);
@@ -120,6 +126,22 @@ private:
 
   std::vector<InputSection *> Sections;
 
+  // Sections is reordered as classes are split, so each section also gets a
+  // fixed ID, which is its index in Sections as initially collected.
+  DenseMap<const InputSection *, uint32_t> Ids;
+
+  // For each section by ID, the IDs of the sections its relocations refer
+  // to, among those subject to ICF. Relocation targets don't change during
+  // ICF, so they are resolved only once.
+  std::vector<std::vector<uint32_t>> Targets;
+
+  // For each section by ID, the iteration of the main loop that last changed
+  // its class, and the iteration that last compared the members of its class.
+  // A class can only be split if a section its members refer to changed its
+  // class since the class was compared. See isDirty().
+  std::vector<std::atomic<uint32_t>> LastChanged;
+  std::vector<uint32_t> LastCompared;
+
   // We repeat the main loop while `Repeat` is true.
   std::atomic<bool> Repeat;
 
@@ -217,8 +239,12 @@ void ICF<ELFT>::segregate(size_t Begin, size_t End, bool Constant) {
     // Now we split [Begin, End) into [Begin, Mid) and [Mid, End) by
     // updating the sections in [Begin, Mid). We use Mid as an equivalence
     // class ID because every group ends with a unique index.
-    for (size_t I = Begin; I < Mid; ++I)
-      Sections[I]->Class[Next] = Mid;
+    for (size_t I = Begin; I < Mid; ++I) {
+      InputSection *S = Sections[I];
+      if (!Constant && S->Class[Current] != Mid)
+        LastChanged[Ids.lookup(S)].store(Cnt + 1, std::memory_order_relaxed);
+      S->Class[Next] = Mid;
+    }
 
     // If we created a group, we need to iterate the main loop again.
     if (Mid != End)
@@ -228,6 +254,58 @@ void ICF<ELFT>::segregate(size_t Begin, size_t End, bool Constant) {
   }
 }
 
+// Collect the IDs of the sections that the relocations of IS refer to.
+template <class ELFT>
+template <class RelTy>
+void ICF<ELFT>::collectTargets(InputSection *IS, ArrayRef<RelTy> Rels,
+                               std::vector<uint32_t> &Out) {
+  for (const RelTy &Rel : Rels) {
+    Symbol &S = IS->template getFile<ELFT>()->getRelocTargetSym(Rel);
+    if (auto *D = dyn_cast<Defined>(&S))
+      if (auto *RelSec = dyn_cast_or_null<InputSection>(D->Section)) {
+        auto It = Ids.find(RelSec);
+        if (It != Ids.end())
+          Out.push_back(It->second);
+      }
+  }
+}
+
+// Returns true if the class [Begin, End) has to be compared again in this
+// iteration, and if so, records that it is.
+//
+// The members of a class were equal in terms of the classes of their
+// relocation targets when the class was last compared. If none of the
+// targets changed its class since, comparing them again can't split the
+// class. With threads, a class change isn't visible until the next
+// iteration, so a change in the same iteration as the comparison counts.
+template <class ELFT> bool ICF<ELFT>::isDirty(size_t Begin, size_t End) {
+  SmallVector<uint32_t, 8> ClassIds;
+  bool Dirty = false;
+  for (size_t I = Begin; I < End; ++I) {
+    uint32_t Id = Ids.lookup(Sections[I]);
+    ClassIds.push_back(Id);
+    if (Dirty)
+      continue;
+    // Relocations to sections not subject to ICF are only compared once,
+    // since these sections never change their class.
+    if (LastCompared[Id] == 0) {
+      Dirty = true;
+      continue;
+    }
+    for (uint32_t T : Targets[Id]) {
+      if (LastChanged[T].load(std::memory_order_relaxed) >= LastCompared[Id]) {
+        Dirty = true;
+        break;
+      }
+    }
+  }
+
+  if (Dirty)
+    for (uint32_t Id : ClassIds)
+      LastCompared[Id] = Cnt + 1;
+  return Dirty;
+}
+
 // Compare two lists of relocations.
 template <class ELFT>
 template <class RelTy>
@@ -422,22 +500,6 @@ void ICF<ELFT>::forEachClass(llvm::function_ref<void(size_t, size_t)> Fn) {
   ++Cnt;
 }
 
-// Combine the hashes of the sections referenced by the given section into its
-// hash.
-template <class ELFT, class RelTy>
-static void combineRelocHashes(unsigned Cnt, InputSection *IS,
-                               ArrayRef<RelTy> Rels) {
-  uint32_t Hash = IS->Class[Cnt % 2];
-  for (RelTy Rel : Rels) {
-    Symbol &S = IS->template getFile<ELFT>()->getRelocTargetSym(Rel);
-    if (auto *D = dyn_cast<Defined>(&S))
-      if (auto *RelSec = dyn_cast_or_null<InputSection>(D->Section))
-        Hash += RelSec->Class[Cnt % 2];
-  }
-  // Set MSB to 1 to avoid collisions with non-hash IDs.
-  IS->Class[(Cnt + 1) % 2] = Hash | (1U << 31);
-}
-
 static void print(const Twine &S) {
   if (Config->PrintIcfSections)
     message(S);
@@ -451,17 +513,32 @@ template <class ELFT> void ICF<ELFT>::run() {
       if (isEligible(S))
         Sections.push_back(S);
 
+  for (size_t I = 0, E = Sections.size(); I != E; ++I)
+    Ids[Sections[I]] = I;
+
+  Targets.resize(Sections.size());
+  parallelForEachN(0, Sections.size(), [&](size_t I) {
+    InputSection *S = Sections[I];
+    if (S->AreRelocsRela)
+      collectTargets(S, S->template relas<ELFT>(), Targets[I]);
+    else
+      collectTargets(S, S->template rels<ELFT>(), Targets[I]);
+  });
+
   // Initially, we use hash values to partition sections.
   parallelForEach(Sections, [&](InputSection *S) {
-    S->Class[0] = xxHash64(S->data());
+    S->Class[0] = xxh3_64bits(S->data());
   });
 
+  // Combine the hashes of the sections referenced by each section into its
+  // hash. Sections that are not subject to ICF don't contribute.
   for (unsigned Cnt = 0; Cnt != 2; ++Cnt) {
-    parallelForEach(Sections, [&](InputSection *S) {
-      if (S->AreRelocsRela)
-        combineRelocHashes<ELFT>(Cnt, S, S->template relas<ELFT>());
-      else
-        combineRelocHashes<ELFT>(Cnt, S, S->template rels<ELFT>());
+    parallelForEachN(0, Sections.size(), [&](size_t I) {
+      uint32_t Hash = Sections[I]->Class[Cnt % 2];
+      for (uint32_t T : Targets[I])
+        Hash += Sections[T]->Class[Cnt % 2];
+      // Set MSB to 1 to avoid collisions with non-hash IDs.
+      Sections[I]->Class[(Cnt + 1) % 2] = Hash | (1U << 31);
     });
   }
 
@@ -475,10 +552,23 @@ template <class ELFT> void ICF<ELFT>::run() {
   forEachClass([&](size_t Begin, size_t End) { segregate(Begin, End, true); });
 
   // Split groups by comparing relocations until convergence is obtained.
+  // The first iteration compares all classes. Later ones only compare the
+  // classes that may have become splittable since.
+  LastChanged = std::vector<std::atomic<uint32_t>>(Sections.size());
+  for (std::atomic<uint32_t> &C : LastChanged)
+    C.store(Cnt, std::memory_order_relaxed);
+  LastCompared.assign(Sections.size(), 0);
+
   do {
     Repeat = false;
-    forEachClass(
-        [&](size_t Begin, size_t End) { segregate(Begin, End, false); });
+    forEachClass([&](size_t Begin, size_t End) {
+      if (isDirty(Begin, End)) {
+        segregate(Begin, End, false);
+        return;
+      }
+      for (size_t I = Begin; I < End; ++I)
+        Sections[I]->Class[Next] = Sections[I]->Class[Current];
+    });
   } while (Repeat);
 
   log("ICF needed " + Twine(Cnt) + " iterations");
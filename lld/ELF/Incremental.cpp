@@ -0,0 +1,240 @@
+//===- Incremental.cpp ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --incremental.
+//
+// With the option, a successful link saves its state next to the output
+// file: a hash of the command line, a hash of each file that was read,
+// including the profiles that LTO reads itself, and the size and
+// modification time of each file that was written, including the side
+// outputs of LTO such as .dwo files. The next
+// link with the option compares that state against what it reads. If the
+// command line and every input are the same and the outputs haven't been
+// touched since, the outputs are exactly what the link would produce, so
+// the link stops there. Object files that were rebuilt to the same contents
+// (e.g. after touching a header) therefore don't cause a relink.
+//
+// In any other case, the link runs in full and saves a new state. The
+// previous output is never patched in place.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Incremental.h"
+#include "Config.h"
+#include "lld/Common/ErrorHandler.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Option/ArgList.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::sys;
+
+using namespace lld;
+using namespace lld::elf;
+
+static const char StateMagic[] = "lld-incremental-state-v1";
+
+// Content hashes of the files read by this link, keyed by path.
+static StringMap<uint64_t> Inputs;
+
+static std::string getStatePath() {
+  return (Config->OutputFile + ".lldstate").str();
+}
+
+// The outputs whose size and modification time are recorded. Returns false
+// if an output can't be recorded, e.g. because it is written to stdout.
+static bool getOutputs(SmallVectorImpl<StringRef> &Outputs) {
+  Outputs.push_back(Config->OutputFile);
+  if (!Config->MapFile.empty())
+    Outputs.push_back(Config->MapFile);
+  return llvm::none_of(Outputs, [](StringRef Path) { return Path == "-"; });
+}
+
+// The files written by LTO besides the output, which only exist if LTO ran.
+// They are recorded like the outputs, so that a link that would write them
+// isn't skipped when they are gone.
+static void getSideOutputs(std::vector<std::string> &Outputs) {
+  if (!Config->LTOObjPath.empty() && fs::exists(Config->LTOObjPath))
+    Outputs.push_back(Config->LTOObjPath);
+  if (Config->DwoDir.empty())
+    return;
+  std::error_code EC;
+  for (fs::directory_iterator It(Config->DwoDir, EC), End; It != End && !EC;
+       It.increment(EC))
+    if (path::extension(It->path()) == ".dwo")
+      Outputs.push_back(It->path());
+}
+
+// The profiles are read by LTO rather than by readFile(), and LTO runs after
+// isIncrementalUpToDate(), so they are hashed here.
+static void addProfileInputs() {
+  StringRef Profiles[] = {Config->LTOSampleProfile,
+                          Config->LTOCSProfileGenerate
+                              ? StringRef()
+                              : Config->LTOCSProfileFile};
+  for (StringRef Path : Profiles) {
+    if (Path.empty())
+      continue;
+    if (ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+            MemoryBuffer::getFile(Path, -1, false))
+      addIncrementalInput(Path, (*MB)->getMemBufferRef());
+  }
+}
+
+// Relative paths on the command line are relative to the current directory,
+// so that is hashed along with the arguments.
+static uint64_t hashCommandLine(opt::InputArgList &Args) {
+  SmallString<128> Cwd;
+  fs::current_path(Cwd);
+
+  std::string S = getLLDVersion();
+  S += '\0';
+  S += Cwd.str();
+  S += '\0';
+  for (opt::Arg *Arg : Args) {
+    S += Arg->getAsString(Args);
+    S += '\0';
+  }
+  return xxh3_64bits(S);
+}
+
+void elf::addIncrementalInput(StringRef Path, MemoryBufferRef MB) {
+  Inputs[Path] = xxh3_64bits(MB.getBuffer());
+}
+
+bool elf::isIncrementalUpToDate(opt::InputArgList &Args) {
+  SmallVector<StringRef, 2> Outputs;
+  if (!getOutputs(Outputs))
+    return false;
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(getStatePath(), -1, false);
+  if (!MBOrErr)
+    return false;
+
+  SmallVector<StringRef, 0> Lines;
+  (*MBOrErr)->getBuffer().split(Lines, '\n', -1, false);
+  if (Lines.size() < 2 || Lines[0] != StateMagic)
+    return false;
+
+  uint64_t Hash;
+  if (!Lines[1].consume_front("cmdline ") || Lines[1].getAsInteger(16, Hash) ||
+      Hash != hashCommandLine(Args))
+    return false;
+
+  // Each remaining line is "input <hash> <path>" or
+  // "output <size> <mtime> <path>". The outputs that aren't in Outputs are
+  // side outputs.
+  StringMap<uint64_t> Recorded;
+  size_t NumOutputs = 0;
+  for (StringRef Line : makeArrayRef(Lines).slice(2)) {
+    if (Line.consume_front("input ")) {
+      StringRef HashStr, Path;
+      std::tie(HashStr, Path) = Line.split(' ');
+      if (HashStr.getAsInteger(16, Hash))
+        return false;
+      Recorded[Path] = Hash;
+      continue;
+    }
+
+    if (Line.consume_front("output ")) {
+      StringRef SizeStr, TimeStr, Path;
+      std::tie(SizeStr, Line) = Line.split(' ');
+      std::tie(TimeStr, Path) = Line.split(' ');
+      uint64_t Size;
+      int64_t Time;
+      if (SizeStr.getAsInteger(10, Size) || TimeStr.getAsInteger(10, Time))
+        return false;
+      fs::file_status St;
+      if (fs::status(Path, St) || St.getSize() != Size ||
+          St.getLastModificationTime().time_since_epoch().count() != Time)
+        return false;
+      if (llvm::is_contained(Outputs, Path))
+        ++NumOutputs;
+      continue;
+    }
+    return false;
+  }
+  if (NumOutputs != Outputs.size())
+    return false;
+
+  addProfileInputs();
+
+  // Every file read so far must have been read by the previous link. That
+  // catches a library search that now finds a different file.
+  for (const auto &KV : Inputs) {
+    auto It = Recorded.find(KV.first());
+    if (It == Recorded.end() || It->second != KV.second)
+      return false;
+  }
+
+  // The files that haven't been read yet, e.g. archives and dependent
+  // libraries opened later in the link, are read here.
+  for (const auto &KV : Recorded) {
+    if (Inputs.count(KV.first()))
+      continue;
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MB =
+        MemoryBuffer::getFile(KV.first(), -1, false);
+    if (!MB || xxh3_64bits((*MB)->getBuffer()) != KV.second)
+      return false;
+  }
+  return true;
+}
+
+void elf::writeIncrementalState(opt::InputArgList &Args) {
+  std::string Path = getStatePath();
+  SmallVector<StringRef, 2> Outputs;
+  if (!getOutputs(Outputs)) {
+    fs::remove(Path);
+    return;
+  }
+
+  std::string S;
+  raw_string_ostream OS(S);
+  OS << StateMagic << '\n';
+  OS << "cmdline " << utohexstr(hashCommandLine(Args)) << '\n';
+
+  std::vector<std::string> SideOutputs;
+  getSideOutputs(SideOutputs);
+  for (const std::string &Output : SideOutputs)
+    Outputs.push_back(Output);
+  for (StringRef Output : Outputs) {
+    fs::file_status St;
+    if (fs::status(Output, St)) {
+      fs::remove(Path);
+      return;
+    }
+    OS << "output " << St.getSize() << ' '
+       << St.getLastModificationTime().time_since_epoch().count() << ' '
+       << Output << '\n';
+  }
+
+  addProfileInputs();
+  for (const auto &KV : Inputs) {
+    // A path with a newline can't be represented in the state.
+    if (KV.first().find('\n') != StringRef::npos) {
+      fs::remove(Path);
+      return;
+    }
+    OS << "input " << utohexstr(KV.second) << ' ' << KV.first() << '\n';
+  }
+
+  std::error_code EC;
+  raw_fd_ostream File(Path, EC, fs::F_None);
+  if (EC) {
+    warn("--incremental: cannot write " + Path + ": " + EC.message());
+    return;
+  }
+  File << OS.str();
+}
@@ -0,0 +1,36 @@
+//===- Incremental.h --------------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_INCREMENTAL_H
+#define LLD_ELF_INCREMENTAL_H
+
+#include "lld/Common/LLVM.h"
+
+namespace llvm {
+namespace opt {
+class InputArgList;
+}
+} // namespace llvm
+
+namespace lld {
+namespace elf {
+
+// Records a file read by this link for --incremental.
+void addIncrementalInput(StringRef Path, MemoryBufferRef MB);
+
+// Returns true if the outputs of the previous link with the same command
+// line and the same inputs are still in place.
+bool isIncrementalUpToDate(llvm::opt::InputArgList &Args);
+
+// Saves the state of this link next to the output file.
+void writeIncrementalState(llvm::opt::InputArgList &Args);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -8,13 +8,16 @@
 
 #include "InputFiles.h"
 #include "Driver.h"
+#include "Incremental.h"
 #include "InputSection.h"
 #include "LinkerScript.h"
+#include "SymbolIndexCache.h"
 #include "SymbolTable.h"
 #include "Symbols.h"
 #include "SyntheticSections.h"
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/CodeGen/Analysis.h"
 #include "llvm/DebugInfo/DWARF/DWARFContext.h"
@@ -28,6 +31,7 @@
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TarWriter.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace llvm;
@@ -108,6 +112,8 @@ Optional<MemoryBufferRef> elf::readFile(StringRef Path) {
 
   if (Tar)
     Tar->append(relativeToRoot(Path), MBRef.getBuffer());
+  if (Config->Incremental)
+    addIncrementalInput(Path, MBRef);
   return MBRef;
 }
 
@@ -207,6 +213,37 @@ void elf::parseFile(InputFile *File) {
   }
 }
 
+template <class ELFT> static void doPreparseFiles(ArrayRef<InputFile *> Files) {
+  std::vector<ObjFile<ELFT> *> Objs;
+  for (InputFile *File : Files)
+    if (auto *F = dyn_cast<ObjFile<ELFT>>(File))
+      if (F->EKind == Config->EKind)
+        Objs.push_back(F);
+  parallelForEach(Objs, [](ObjFile<ELFT> *F) {
+    llvm::TimeTraceScope TimeScope("Preparse", [&] { return toString(F); });
+    F->preparse();
+  });
+}
+
+void elf::preparseFiles(ArrayRef<InputFile *> Files) {
+  switch (Config->EKind) {
+  case ELF32LEKind:
+    doPreparseFiles<ELF32LE>(Files);
+    return;
+  case ELF32BEKind:
+    doPreparseFiles<ELF32BE>(Files);
+    return;
+  case ELF64LEKind:
+    doPreparseFiles<ELF64LE>(Files);
+    return;
+  case ELF64BEKind:
+    doPreparseFiles<ELF64BE>(Files);
+    return;
+  default:
+    llvm_unreachable("unknown ELFT");
+  }
+}
+
 // Concatenates arguments to construct a string representing an error location.
 static std::string createFileLineMsg(StringRef Path, unsigned Line) {
   std::string Filename = path::filename(Path);
@@ -460,6 +497,23 @@ template <class ELFT> void ObjFile<ELFT>::parse(bool IgnoreComdats) {
   initializeSymbols();
 }
 
+template <class ELFT> void ObjFile<ELFT>::preparse() {
+  ArrayRef<Elf_Sym> ESyms = this->getGlobalELFSyms<ELFT>();
+  std::vector<CachedHashStringRef> Names;
+  Names.reserve(ESyms.size());
+
+  for (const Elf_Sym &ESym : ESyms) {
+    // An invalid name is reported by parse(), in input order.
+    Expected<StringRef> Name = ESym.getName(this->StringTable);
+    if (!Name) {
+      consumeError(Name.takeError());
+      return;
+    }
+    Names.push_back(CachedHashStringRef(SymbolTable::getSymbolName(*Name)));
+  }
+  GlobalSymbolNames = std::move(Names);
+}
+
 // Sections with SHT_GROUP and comdat bits define comdat section groups.
 // They are identified and deduplicated by group name. This function
 // returns a group name.
@@ -1046,10 +1100,17 @@ template <class ELFT> void ObjFile<ELFT>::initializeSymbols() {
 
   // Our symbol table may have already been partially initialized
   // because of LazyObjFile.
-  for (size_t I = 0, End = ESyms.size(); I != End; ++I)
-    if (!this->Symbols[I] && ESyms[I].getBinding() != STB_LOCAL)
+  for (size_t I = 0, End = ESyms.size(); I != End; ++I) {
+    if (this->Symbols[I] || ESyms[I].getBinding() == STB_LOCAL)
+      continue;
+    if (I >= this->FirstGlobal && !GlobalSymbolNames.empty())
+      this->Symbols[I] =
+          Symtab->insert(GlobalSymbolNames[I - this->FirstGlobal]);
+    else
       this->Symbols[I] =
           Symtab->insert(CHECK(ESyms[I].getName(this->StringTable), this));
+  }
+  GlobalSymbolNames = {};
 
   // Fill this->Symbols. A symbol is either local or global.
   for (size_t I = 0, End = ESyms.size(); I != End; ++I) {
@@ -1558,13 +1619,22 @@ template <class ELFT> void LazyObjFile::parse() {
 
   // A lazy object file wraps either a bitcode file or an ELF file.
   if (isBitcode(this->MB)) {
-    std::unique_ptr<lto::InputFile> Obj =
-        CHECK(lto::InputFile::create(this->MB), this);
-    for (const lto::InputFile::Symbol &Sym : Obj->symbols()) {
-      if (Sym.isUndefined())
-        continue;
-      Symtab->addSymbol(LazyObject{*this, Saver.save(Sym.getName())});
+    StringRef Path = ArchiveName.empty() ? MB.getBufferIdentifier()
+                                         : StringRef(ArchiveName);
+    std::vector<StringRef> Names;
+    if (Config->SymbolIndexCache.empty() ||
+        !readSymbolIndexCache(Path, OffsetInArchive, MB, Names)) {
+      std::unique_ptr<lto::InputFile> Obj =
+          CHECK(lto::InputFile::create(this->MB), this);
+      for (const lto::InputFile::Symbol &Sym : Obj->symbols())
+        if (!Sym.isUndefined())
+          Names.push_back(Saver.save(Sym.getName()));
+      if (!Config->SymbolIndexCache.empty())
+        writeSymbolIndexCache(Path, OffsetInArchive, MB, Names);
     }
+
+    for (StringRef Name : Names)
+      Symtab->addSymbol(LazyObject{*this, Name});
     return;
   }
 
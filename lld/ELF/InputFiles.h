@@ -57,6 +57,10 @@ llvm::Optional<MemoryBufferRef> readFile(StringRef Path);
 // Add symbols in File to the symbol table.
 void parseFile(InputFile *File);
 
+// Decode what parseFile() needs from the object files among Files in
+// parallel. This doesn't touch the symbol table.
+void preparseFiles(ArrayRef<InputFile *> Files);
+
 // The root class of input files.
 class InputFile {
 public:
@@ -207,6 +211,10 @@ public:
 
   void parse(bool IgnoreComdats = false);
 
+  // Decodes and hashes the names of the global symbols so that parse() only
+  // has to look them up in the symbol table. Thread-safe.
+  void preparse();
+
   StringRef getShtGroupSignature(ArrayRef<Elf_Shdr> Sections,
                                  const Elf_Shdr &Sec);
 
@@ -280,6 +288,10 @@ private:
   // .shstrtab contents.
   StringRef SectionStringTable;
 
+  // Names of the global symbols as computed by preparse(), indexed by symbol
+  // index minus FirstGlobal. Empty if the file was not preparsed.
+  std::vector<llvm::CachedHashStringRef> GlobalSymbolNames;
+
   // Debugging information to retrieve source file and line for error
   // reporting. Linker may find reasonable number of errors in a
   // single object file, so we cache debugging information in order to
@@ -1187,11 +1187,32 @@ void EhInputSection::split(ArrayRef<RelTy> Rels) {
   }
 }
 
+// Returns the offset of the first all-zero entry of type T in S.
+template <class T> static size_t findNullEntry(StringRef S) {
+  for (size_t I = 0, N = S.size(); I != N; I += sizeof(T)) {
+    T V;
+    memcpy(&V, S.data() + I, sizeof(T));
+    if (V == 0)
+      return I;
+  }
+  return StringRef::npos;
+}
+
 static size_t findNull(StringRef S, size_t EntSize) {
   // Optimize the common case.
   if (EntSize == 1)
     return S.find(0);
 
+  // Wide character strings are scanned one entry, not one byte, at a time.
+  switch (EntSize) {
+  case 2:
+    return findNullEntry<uint16_t>(S);
+  case 4:
+    return findNullEntry<uint32_t>(S);
+  case 8:
+    return findNullEntry<uint64_t>(S);
+  }
+
   for (unsigned I = 0, N = S.size(); I != N; I += EntSize) {
     const char *B = S.begin() + I;
     if (std::all_of(B, B + EntSize, [](char C) { return C == 0; }))
@@ -1217,7 +1238,7 @@ void MergeInputSection::splitStrings(ArrayRef<uint8_t> Data, size_t EntSize) {
       fatal(toString(this) + ": string is not null terminated");
     size_t Size = End + EntSize;
 
-    Pieces.emplace_back(Off, xxHash64(S.substr(0, Size)), !IsAlloc);
+    Pieces.emplace_back(Off, xxh3_64bits(S.substr(0, Size)), !IsAlloc);
     S = S.substr(Size);
     Off += Size;
   }
@@ -1232,7 +1253,7 @@ void MergeInputSection::splitNonStrings(ArrayRef<uint8_t> Data,
   bool IsAlloc = Flags & SHF_ALLOC;
 
   for (size_t I = 0; I != Size; I += EntSize)
-    Pieces.emplace_back(I, xxHash64(Data.slice(I, EntSize)), !IsAlloc);
+    Pieces.emplace_back(I, xxh3_64bits(Data.slice(I, EntSize)), !IsAlloc);
 }
 
 template <class ELFT>
@@ -31,6 +31,9 @@
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cstddef>
 #include <memory>
@@ -135,11 +138,27 @@ BitcodeCompiler::BitcodeCompiler() {
     Backend = lto::createWriteIndexesThinBackend(
         Config->ThinLTOPrefixReplace.first, Config->ThinLTOPrefixReplace.second,
         Config->ThinLTOEmitImportsFiles, IndexFile.get(), OnIndexWrite);
-  } else if (Config->ThinLTOJobs != -1U) {
-    Backend = lto::createInProcessThinBackend(Config->ThinLTOJobs);
+  } else if (Config->ThinLTOJobs != -1U || Config->ThinLTOMemoryBudget) {
+    unsigned Jobs = Config->ThinLTOJobs != -1U
+                        ? Config->ThinLTOJobs
+                        : llvm::heavyweight_hardware_concurrency();
+    Backend = lto::createInProcessThinBackend(
+        Jobs, Config->ThinLTOMemoryBudget << 20);
   }
 
-  LTOObj = llvm::make_unique<lto::LTO>(createConfig(), Backend,
+  lto::Config C = createConfig();
+  if (!Config->ThinLTOCacheStore.empty()) {
+    // Lookups in the store mostly wait on the network, so run more of them
+    // than there are cores. The misses of the cache directory start while the
+    // backends are scheduled.
+    CacheStore = lto::createCommandObjectStore(
+        Config->ThinLTOCacheStore,
+        4 * llvm::heavyweight_hardware_concurrency());
+    C.CachePrefetchHook =
+        lto::localCachePrefetcher(Config->ThinLTOCacheDir, CacheStore);
+  }
+
+  LTOObj = llvm::make_unique<lto::LTO>(std::move(C), Backend,
                                        Config->LTOPartitions);
 
   // Initialize UsedStartStop.
@@ -228,6 +247,53 @@ static void thinLTOCreateEmptyIndexFiles() {
   }
 }
 
+namespace {
+// A native object written to a temporary file. Once it is complete it is
+// mapped back, so that it doesn't stay on the heap for the rest of the link.
+struct DiskObjectStream : lto::NativeObjectStream {
+  sys::fs::TempFile File;
+  std::unique_ptr<MemoryBuffer> &Out;
+
+  DiskObjectStream(sys::fs::TempFile File, std::unique_ptr<MemoryBuffer> &Out)
+      : NativeObjectStream(
+            llvm::make_unique<raw_fd_ostream>(File.FD, /*shouldClose=*/false)),
+        File(std::move(File)), Out(Out) {}
+
+  ~DiskObjectStream() {
+    OS.reset();
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+        MemoryBuffer::getOpenFile(File.FD, File.TmpName, /*FileSize=*/-1,
+                                  /*RequiresNullTerminator=*/false);
+    if (MBOrErr)
+      Out = std::move(*MBOrErr);
+    else
+      error("cannot read " + File.TmpName + ": " +
+            MBOrErr.getError().message());
+    // The mapping outlives the file.
+    consumeError(File.discard());
+  }
+};
+} // namespace
+
+std::unique_ptr<lto::NativeObjectStream>
+BitcodeCompiler::createObjectStream(size_t Task) {
+  // --save-temps and --lto-obj-path save the objects from memory.
+  if (Config->ThinLTOStreamToDisk && !Config->SaveTemps &&
+      Config->LTOObjPath.empty()) {
+    SmallString<128> Model;
+    sys::path::system_temp_directory(/*ErasedOnReboot=*/true, Model);
+    sys::path::append(Model, "lto-%%%%%%.o");
+    Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(Model);
+    if (Temp)
+      return llvm::make_unique<DiskObjectStream>(std::move(*Temp),
+                                                 Files[Task]);
+    // Keep going with the object in memory.
+    warn("--thinlto-stream-to-disk: " + toString(Temp.takeError()));
+  }
+  return llvm::make_unique<lto::NativeObjectStream>(
+      llvm::make_unique<raw_svector_ostream>(Buf[Task]));
+}
+
 // Merge all the bitcode files we have seen, codegen the result
 // and return the resulting ObjectFile(s).
 std::vector<InputFile *> BitcodeCompiler::compile() {
@@ -244,15 +310,15 @@ std::vector<InputFile *> BitcodeCompiler::compile() {
         lto::localCache(Config->ThinLTOCacheDir,
                         [&](size_t Task, std::unique_ptr<MemoryBuffer> MB) {
                           Files[Task] = std::move(MB);
-                        }));
+                        },
+                        CacheStore));
 
-  if (!BitcodeFiles.empty())
+  if (!BitcodeFiles.empty()) {
     checkError(LTOObj->run(
-        [&](size_t Task) {
-          return llvm::make_unique<lto::NativeObjectStream>(
-              llvm::make_unique<raw_svector_ostream>(Buf[Task]));
-        },
-        Cache));
+        [&](size_t Task) { return createObjectStream(Task); }, Cache));
+    log("peak resident set size after LTO: " +
+        Twine(sys::Process::GetPeakRSS() >> 20) + " MB");
+  }
 
   // Emit empty index files for non-indexed files
   for (StringRef S : ThinIndices) {
@@ -30,6 +30,8 @@
 namespace llvm {
 namespace lto {
 class LTO;
+class ObjectStore;
+struct NativeObjectStream;
 }
 } // namespace llvm
 
@@ -49,7 +51,11 @@ public:
   std::vector<InputFile *> compile();
 
 private:
+  std::unique_ptr<llvm::lto::NativeObjectStream>
+  createObjectStream(size_t Task);
+
   std::unique_ptr<llvm::lto::LTO> LTOObj;
+  std::shared_ptr<llvm::lto::ObjectStore> CacheStore;
   std::vector<SmallString<0>> Buf;
   std::vector<std::unique_ptr<MemoryBuffer>> Files;
   llvm::DenseSet<StringRef> UsedStartStop;
@@ -17,6 +17,12 @@
 // bits. Writer will then ignore sections whose Live bits are off, so that
 // such sections are not included into output.
 //
+// When there is only one partition, the graph is traversed by multiple
+// threads. Each thread has its own worklist and hands half of it to an idle
+// thread when it grows, and a section is claimed by atomically setting its
+// partition, so every reachable section is visited exactly once, the same as
+// in the serial traversal.
+//
 //===----------------------------------------------------------------------===//
 
 #include "MarkLive.h"
@@ -29,9 +35,13 @@
 #include "Target.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/Object/ELF.h"
+#include "llvm/Support/Parallel.h"
+#include <atomic>
 #include <functional>
+#include <mutex>
 #include <vector>
 
 using namespace llvm;
@@ -51,12 +61,28 @@ public:
   void moveToMain();
 
 private:
-  void enqueue(InputSectionBase *Sec, uint64_t Offset);
+  // The state of a thread that visits sections.
+  struct Worker {
+    // A list of sections to visit.
+    SmallVector<InputSection *, 256> Queue;
+
+    // The Used bits of symbols and the Live bits of section pieces share
+    // their words with other bit fields, so threads can't set them directly.
+    // They are collected here and set once the traversal is done.
+    bool Parallel = false;
+    std::vector<Symbol *> UsedSymbols;
+    std::vector<std::pair<MergeInputSection *, uint64_t>> LivePieces;
+  };
+
+  void enqueue(Worker &W, InputSectionBase *Sec, uint64_t Offset);
   void markSymbol(Symbol *Sym);
   void mark();
+  void markParallel();
+  void visit(Worker &W, InputSection &Sec);
+  void visitAll(Worker W, parallel::detail::TaskGroup &TG);
 
   template <class RelTy>
-  void resolveReloc(InputSectionBase &Sec, RelTy &Rel, bool IsLSDA);
+  void resolveReloc(Worker &W, InputSectionBase &Sec, RelTy &Rel, bool IsLSDA);
 
   template <class RelTy>
   void scanEhFrameSection(EhInputSection &EH, ArrayRef<RelTy> Rels);
@@ -64,8 +90,13 @@ private:
   // The index of the partition that we are currently processing.
   unsigned Partition;
 
-  // A list of sections to visit.
-  SmallVector<InputSection *, 256> Queue;
+  // The worker of the serial traversal. GC roots are added to its queue.
+  Worker Main;
+
+  // Guards the results of the workers of the parallel traversal.
+  std::mutex Mu;
+  std::vector<Symbol *> UsedSymbols;
+  std::vector<std::pair<MergeInputSection *, uint64_t>> LivePieces;
 
   // There are normally few input sections whose names are valid C
   // identifiers, so we just store a std::vector instead of a multimap.
@@ -88,12 +119,18 @@ static uint64_t getAddend(InputSectionBase &Sec,
 
 template <class ELFT>
 template <class RelTy>
-void MarkLive<ELFT>::resolveReloc(InputSectionBase &Sec, RelTy &Rel,
-                                  bool IsLSDA) {
+void MarkLive<ELFT>::resolveReloc(Worker &W, InputSectionBase &Sec,
+                                  RelTy &Rel, bool IsLSDA) {
   Symbol &Sym = Sec.getFile<ELFT>()->getRelocTargetSym(Rel);
 
-  // If a symbol is referenced in a live section, it is used.
-  Sym.Used = true;
+  // If a symbol is referenced in a live section, it is used. The bit is only
+  // read for symbols that are not defined, so the parallel traversal records
+  // just those.
+  if (!W.Parallel)
+    Sym.Used = true;
+  else if (!isa<Defined>(Sym) && !Sym.Used &&
+           (W.UsedSymbols.empty() || W.UsedSymbols.back() != &Sym))
+    W.UsedSymbols.push_back(&Sym);
 
   if (auto *D = dyn_cast<Defined>(&Sym)) {
     auto *RelSec = dyn_cast_or_null<InputSectionBase>(D->Section);
@@ -105,16 +142,16 @@ void MarkLive<ELFT>::resolveReloc(InputSectionBase &Sec, RelTy &Rel,
       Offset += getAddend<ELFT>(Sec, Rel);
 
     if (!IsLSDA || !(RelSec->Flags & SHF_EXECINSTR))
-      enqueue(RelSec, Offset);
+      enqueue(W, RelSec, Offset);
     return;
   }
 
   if (auto *SS = dyn_cast<SharedSymbol>(&Sym))
-    if (!SS->isWeak())
+    if (!SS->isWeak() && !W.Parallel)
       SS->getFile().IsNeeded = true;
 
   for (InputSectionBase *Sec : CNamedSections.lookup(Sym.getName()))
-    enqueue(Sec, 0);
+    enqueue(W, Sec, 0);
 }
 
 // The .eh_frame section is an unfortunate special case.
@@ -144,7 +181,7 @@ void MarkLive<ELFT>::scanEhFrameSection(EhInputSection &EH,
     if (read32<ELFT::TargetEndianness>(Piece.data().data() + 4) == 0) {
       // This is a CIE, we only need to worry about the first relocation. It is
       // known to point to the personality function.
-      resolveReloc(EH, Rels[FirstRelI], false);
+      resolveReloc(Main, EH, Rels[FirstRelI], false);
       continue;
     }
 
@@ -154,7 +191,7 @@ void MarkLive<ELFT>::scanEhFrameSection(EhInputSection &EH,
     uint64_t PieceEnd = Piece.InputOff + Piece.Size;
     for (size_t J = FirstRelI, End2 = Rels.size(); J < End2; ++J)
       if (Rels[J].r_offset < PieceEnd)
-        resolveReloc(EH, Rels[J], true);
+        resolveReloc(Main, EH, Rels[J], true);
   }
 }
 
@@ -177,7 +214,8 @@ static bool isReserved(InputSectionBase *Sec) {
 }
 
 template <class ELFT>
-void MarkLive<ELFT>::enqueue(InputSectionBase *Sec, uint64_t Offset) {
+void MarkLive<ELFT>::enqueue(Worker &W, InputSectionBase *Sec,
+                             uint64_t Offset) {
   // Skip over discarded sections. This in theory shouldn't happen, because
   // the ELF spec doesn't allow a relocation to point to a deduplicated
   // COMDAT section directly. Unfortunately this happens in practice (e.g.
@@ -188,25 +226,40 @@ void MarkLive<ELFT>::enqueue(InputSectionBase *Sec, uint64_t Offset) {
   // Usually, a whole section is marked as live or dead, but in mergeable
   // (splittable) sections, each piece of data has independent liveness bit.
   // So we explicitly tell it which offset is in use.
-  if (auto *MS = dyn_cast<MergeInputSection>(Sec))
-    MS->getSectionPiece(Offset)->Live = true;
+  if (auto *MS = dyn_cast<MergeInputSection>(Sec)) {
+    if (W.Parallel)
+      W.LivePieces.push_back({MS, Offset});
+    else
+      MS->getSectionPiece(Offset)->Live = true;
+  }
 
-  // Set Sec->Partition to the meet (i.e. the "minimum") of Partition and
-  // Sec->Partition in the following lattice: 1 < other < 0. If Sec->Partition
-  // doesn't change, we don't need to do anything.
-  if (Sec->Partition == 1 || Sec->Partition == Partition)
-    return;
-  Sec->Partition = Sec->Partition ? 1 : Partition;
+  if (W.Parallel) {
+    // There is only one partition, so a section is claimed by the thread
+    // that changes its partition from 0 to 1.
+    static_assert(sizeof(std::atomic<uint8_t>) == sizeof(uint8_t),
+                  "Partition can't be accessed atomically");
+    auto &P = reinterpret_cast<std::atomic<uint8_t> &>(Sec->Partition);
+    if (P.load(std::memory_order_relaxed) == 1 ||
+        P.exchange(1, std::memory_order_relaxed) == 1)
+      return;
+  } else {
+    // Set Sec->Partition to the meet (i.e. the "minimum") of Partition and
+    // Sec->Partition in the following lattice: 1 < other < 0. If
+    // Sec->Partition doesn't change, we don't need to do anything.
+    if (Sec->Partition == 1 || Sec->Partition == Partition)
+      return;
+    Sec->Partition = Sec->Partition ? 1 : Partition;
+  }
 
   // Add input section to the queue.
   if (InputSection *S = dyn_cast<InputSection>(Sec))
-    Queue.push_back(S);
+    W.Queue.push_back(S);
 }
 
 template <class ELFT> void MarkLive<ELFT>::markSymbol(Symbol *Sym) {
   if (auto *D = dyn_cast_or_null<Defined>(Sym))
     if (auto *IS = dyn_cast_or_null<InputSectionBase>(D->Section))
-      enqueue(IS, D->Value);
+      enqueue(Main, IS, D->Value);
 }
 
 // This is the main function of the garbage collector.
@@ -258,7 +311,7 @@ template <class ELFT> void MarkLive<ELFT>::run() {
       continue;
 
     if (isReserved(Sec) || Script->shouldKeep(Sec)) {
-      enqueue(Sec, 0);
+      enqueue(Main, Sec, 0);
     } else if (isValidCIdentifier(Sec->Name)) {
       CNamedSections[Saver.save("__start_" + Sec->Name)].push_back(Sec);
       CNamedSections[Saver.save("__stop_" + Sec->Name)].push_back(Sec);
@@ -268,22 +321,80 @@ template <class ELFT> void MarkLive<ELFT>::run() {
   mark();
 }
 
+template <class ELFT>
+void MarkLive<ELFT>::visit(Worker &W, InputSection &Sec) {
+  if (Sec.AreRelocsRela) {
+    for (const typename ELFT::Rela &Rel : Sec.template relas<ELFT>())
+      resolveReloc(W, Sec, Rel, false);
+  } else {
+    for (const typename ELFT::Rel &Rel : Sec.template rels<ELFT>())
+      resolveReloc(W, Sec, Rel, false);
+  }
+
+  for (InputSectionBase *IS : Sec.DependentSections)
+    enqueue(W, IS, 0);
+}
+
 template <class ELFT> void MarkLive<ELFT>::mark() {
   // Mark all reachable sections.
-  while (!Queue.empty()) {
-    InputSectionBase &Sec = *Queue.pop_back_val();
-
-    if (Sec.AreRelocsRela) {
-      for (const typename ELFT::Rela &Rel : Sec.template relas<ELFT>())
-        resolveReloc(Sec, Rel, false);
-    } else {
-      for (const typename ELFT::Rel &Rel : Sec.template rels<ELFT>())
-        resolveReloc(Sec, Rel, false);
+  if (ThreadsEnabled && Partitions.size() == 1) {
+    markParallel();
+    return;
+  }
+
+  while (!Main.Queue.empty())
+    visit(Main, *Main.Queue.pop_back_val());
+}
+
+// Visits the sections in W's queue and everything reachable from them.
+template <class ELFT>
+void MarkLive<ELFT>::visitAll(Worker W, parallel::detail::TaskGroup &TG) {
+  // Once the queue is long enough, give half of it to a new task. An idle
+  // thread takes the task from this thread's queue of tasks.
+  const size_t SplitThreshold = 512;
+
+  W.Parallel = true;
+  while (!W.Queue.empty()) {
+    visit(W, *W.Queue.pop_back_val());
+
+    if (W.Queue.size() >= SplitThreshold) {
+      auto Mid = W.Queue.begin() + W.Queue.size() / 2;
+      Worker Other;
+      Other.Queue.append(Mid, W.Queue.end());
+      W.Queue.erase(Mid, W.Queue.end());
+      TG.spawn(
+          [this, &TG, Other]() mutable { visitAll(std::move(Other), TG); });
     }
+  }
+
+  std::lock_guard<std::mutex> Lock(Mu);
+  UsedSymbols.insert(UsedSymbols.end(), W.UsedSymbols.begin(),
+                     W.UsedSymbols.end());
+  LivePieces.insert(LivePieces.end(), W.LivePieces.begin(),
+                    W.LivePieces.end());
+}
+
+template <class ELFT> void MarkLive<ELFT>::markParallel() {
+  // Symbols are marked used and section pieces live only after the threads
+  // have joined, so that no bit field is written concurrently.
+  {
+    parallel::detail::TaskGroup TG;
+    Worker W;
+    W.Queue = std::move(Main.Queue);
+    Main.Queue.clear();
+    visitAll(std::move(W), TG);
+  }
 
-    for (InputSectionBase *IS : Sec.DependentSections)
-      enqueue(IS, 0);
+  for (Symbol *Sym : UsedSymbols) {
+    Sym->Used = true;
+    if (auto *SS = dyn_cast<SharedSymbol>(Sym))
+      if (!SS->isWeak())
+        SS->getFile().IsNeeded = true;
   }
+  for (std::pair<MergeInputSection *, uint64_t> &P : LivePieces)
+    P.first->getSectionPiece(P.second)->Live = true;
+  UsedSymbols.clear();
+  LivePieces.clear();
 }
 
 // Move the sections for some symbols to the main partition, specifically ifuncs
@@ -52,6 +52,7 @@
 #include "lld/Common/ErrorHandler.h"
 #include "lld/Common/Memory.h"
 #include "lld/Common/Strings.h"
+#include "lld/Common/Threads.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/raw_ostream.h"
@@ -1102,9 +1103,70 @@ struct IRelativeReloc {
 
 static std::vector<IRelativeReloc> IRelativeRelocs;
 
+namespace {
+// The part of the scan of a relocation that only depends on the relocation
+// itself, which is computed for the relocations of many sections in parallel
+// before they are scanned in order.
+struct PreScannedReloc {
+  uint64_t Offset;
+  int64_t Addend;
+  RelExpr Expr;
+  // The expression and the addend are left to the scan for relocations
+  // against undefined symbols, which may not get that far.
+  bool HasExpr;
+};
+
+// The pre-scanned relocations of a section. The diagnostics of the pre-scan
+// are buffered, and reported by the scan where it reaches the relocation they
+// are about, so that they come in input order.
+struct PreScannedSection {
+  std::vector<PreScannedReloc> Relocs;
+  std::vector<BufferedDiagnostic> Diags;
+  // The index of the relocation of each diagnostic.
+  std::vector<size_t> DiagRelocs;
+};
+} // namespace
+
 template <class ELFT, class RelTy>
-static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
-                      RelTy *End) {
+static void preScanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                          PreScannedSection &Out) {
+  OffsetGetter GetOffset(Sec);
+  Out.Relocs.resize(Rels.size());
+  Out.Diags.clear();
+  Out.DiagRelocs.clear();
+  bufferDiagnostics(&Out.Diags);
+  for (auto I = Rels.begin(), End = Rels.end(); I != End;) {
+    const RelTy &Rel = *I;
+    size_t Index = I - Rels.begin();
+    PreScannedReloc &Pre = Out.Relocs[Index];
+    uint32_t SymIndex = Rel.getSymbol(Config->IsMips64EL);
+    const Symbol &Sym = Sec.getFile<ELFT>()->getSymbol(SymIndex);
+    RelType Type;
+    if (Config->MipsN32Abi) {
+      Type = getMipsN32RelType(I, End);
+    } else {
+      Type = Rel.getType(Config->IsMips64EL);
+      ++I;
+    }
+
+    Pre.Offset = GetOffset.get(Rel.r_offset);
+    Pre.HasExpr = Pre.Offset != uint64_t(-1) && !Sym.isUndefined();
+    if (!Pre.HasExpr)
+      continue;
+    Pre.Expr =
+        Target->getRelExpr(Type, Sym, Sec.data().begin() + Rel.r_offset);
+    Pre.Addend = oneof<R_HINT, R_NONE>(Pre.Expr)
+                     ? 0
+                     : computeAddend<ELFT>(Rel, End, Sec, Pre.Expr,
+                                           Sym.isLocal());
+    Out.DiagRelocs.resize(Out.Diags.size(), Index);
+  }
+  bufferDiagnostics(nullptr);
+}
+
+template <class ELFT, class RelTy>
+static void scanReloc(InputSectionBase &Sec, const PreScannedReloc &Pre,
+                      RelTy *&I, RelTy *End) {
   const RelTy &Rel = *I;
   uint32_t SymIndex = Rel.getSymbol(Config->IsMips64EL);
   Symbol &Sym = Sec.getFile<ELFT>()->getSymbol(SymIndex);
@@ -1119,7 +1181,7 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
   }
 
   // Get an offset in an output section this relocation is applied to.
-  uint64_t Offset = GetOffset.get(Rel.r_offset);
+  uint64_t Offset = Pre.Offset;
   if (Offset == uint64_t(-1))
     return;
 
@@ -1129,7 +1191,8 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
     return;
 
   const uint8_t *RelocatedAddr = Sec.data().begin() + Rel.r_offset;
-  RelExpr Expr = Target->getRelExpr(Type, Sym, RelocatedAddr);
+  RelExpr Expr = Pre.HasExpr ? Pre.Expr
+                             : Target->getRelExpr(Type, Sym, RelocatedAddr);
 
   // Ignore "hint" relocations because they are only markers for relaxation.
   if (oneof<R_HINT, R_NONE>(Expr))
@@ -1157,7 +1220,9 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
   }
 
   // Read an addend.
-  int64_t Addend = computeAddend<ELFT>(Rel, End, Sec, Expr, Sym.isLocal());
+  int64_t Addend = Pre.HasExpr ? Pre.Addend
+                               : computeAddend<ELFT>(Rel, End, Sec, Expr,
+                                                     Sym.isLocal());
 
   // Relax relocations.
   //
@@ -1343,14 +1408,18 @@ static void scanReloc(InputSectionBase &Sec, OffsetGetter &GetOffset, RelTy *&I,
 }
 
 template <class ELFT, class RelTy>
-static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels) {
-  OffsetGetter GetOffset(Sec);
-
+static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels,
+                       const PreScannedSection &Pre) {
   // Not all relocations end up in Sec.Relocations, but a lot do.
   Sec.Relocations.reserve(Rels.size());
 
-  for (auto I = Rels.begin(), End = Rels.end(); I != End;)
-    scanReloc<ELFT>(Sec, GetOffset, I, End);
+  size_t D = 0;
+  for (auto I = Rels.begin(), End = Rels.end(); I != End;) {
+    size_t Index = I - Rels.begin();
+    for (; D != Pre.Diags.size() && Pre.DiagRelocs[D] == Index; ++D)
+      reportDiagnostic(Pre.Diags[D]);
+    scanReloc<ELFT>(Sec, Pre.Relocs[Index], I, End);
+  }
 
   // Sort relocations by offset for more efficient searching for
   // R_RISCV_PCREL_HI20 and R_PPC64_ADDR64.
@@ -1362,11 +1431,41 @@ static void scanRelocs(InputSectionBase &Sec, ArrayRef<RelTy> Rels) {
                       });
 }
 
-template <class ELFT> void elf::scanRelocations(InputSectionBase &S) {
-  if (S.AreRelocsRela)
-    scanRelocs<ELFT>(S, S.relas<ELFT>());
-  else
-    scanRelocs<ELFT>(S, S.rels<ELFT>());
+// Scanning a relocation creates GOT and PLT entries, copy relocations and
+// dynamic relocations, whose order must not depend on the number of threads.
+// So the sections are scanned one after the other, but what doesn't change
+// while scanning, like the offset, the expression and the addend of each
+// relocation, is computed for a batch of sections in parallel first. The
+// diagnostics of that part are buffered and reported in input order.
+template <class ELFT>
+void elf::scanRelocations(ArrayRef<InputSectionBase *> Sections) {
+  // Bound the batches, so that the precomputed relocations of a large link
+  // are not all in memory at once.
+  const size_t BatchRelocs = 1 << 20;
+  std::vector<PreScannedSection> Pre;
+  for (size_t Begin = 0, E = Sections.size(); Begin != E;) {
+    size_t End = Begin;
+    size_t NumRelocs = 0;
+    while (End != E && (End == Begin || NumRelocs < BatchRelocs))
+      NumRelocs += Sections[End++]->NumRelocations;
+
+    Pre.resize(End - Begin);
+    parallelForEachN(Begin, End, [&](size_t I) {
+      InputSectionBase &S = *Sections[I];
+      if (S.AreRelocsRela)
+        preScanRelocs<ELFT>(S, S.relas<ELFT>(), Pre[I - Begin]);
+      else
+        preScanRelocs<ELFT>(S, S.rels<ELFT>(), Pre[I - Begin]);
+    });
+    for (size_t I = Begin; I != End; ++I) {
+      InputSectionBase &S = *Sections[I];
+      if (S.AreRelocsRela)
+        scanRelocs<ELFT>(S, S.relas<ELFT>(), Pre[I - Begin]);
+      else
+        scanRelocs<ELFT>(S, S.rels<ELFT>(), Pre[I - Begin]);
+    }
+    Begin = End;
+  }
 }
 
 // Figure out which representation to use for any absolute relocs to
@@ -1809,10 +1908,14 @@ bool ThunkCreator::createThunks(ArrayRef<OutputSection *> OutputSections) {
   return AddressesChanged;
 }
 
-template void elf::scanRelocations<ELF32LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF32BE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64LE>(InputSectionBase &);
-template void elf::scanRelocations<ELF64BE>(InputSectionBase &);
+template void
+elf::scanRelocations<ELF32LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF32BE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64LE>(ArrayRef<InputSectionBase *>);
+template void
+elf::scanRelocations<ELF64BE>(ArrayRef<InputSectionBase *>);
 template void elf::reportUndefinedSymbols<ELF32LE>();
 template void elf::reportUndefinedSymbols<ELF32BE>();
 template void elf::reportUndefinedSymbols<ELF64LE>();
@@ -0,0 +1,154 @@
+//===- SymbolIndexCache.cpp -----------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements --symbol-index-cache.
+//
+// Archives usually have a symbol table that maps symbols to members, and we
+// read that table directly from the mapped archive. Lazy bitcode files don't
+// have such an index: for files between --start-lib and --end-lib and for
+// members of archives without a symbol table (e.g. created by an ar that
+// doesn't understand bitcode), we have to create an lto::InputFile to know
+// which symbols they define. That reads the whole file even if no symbol of
+// it is used in the end.
+//
+// With the option, the names of the defined symbols of such a file are saved
+// in the cache directory, in a file of NUL-terminated strings that we map
+// into memory in the following links. An entry is keyed by the path, size
+// and modification time of the file (or of the archive and the member), so a
+// hit doesn't touch the contents of the input at all.
+//
+// Errors are ignored; a broken cache just means the file is parsed again.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolIndexCache.h"
+#include "Config.h"
+#include "lld/Common/Memory.h"
+#include "lld/Common/Version.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/xxhash.h"
+
+using namespace llvm;
+using namespace llvm::sys;
+
+using namespace lld;
+using namespace lld::elf;
+
+static const char CacheMagic[] = "lld-symbol-index-v1\n";
+
+// Appends the size and modification time of Path to Key. Returns false if
+// the file can't be stat'ed. The results are cached, because all members of
+// an archive share the archive's status.
+static bool addFileStatus(StringRef Path, std::string &Key) {
+  static StringMap<Optional<std::string>> Cache;
+
+  auto P = Cache.insert({Path, None});
+  if (P.second) {
+    fs::file_status St;
+    if (!fs::status(Path, St) && fs::is_regular_file(St)) {
+      auto Time = St.getLastModificationTime().time_since_epoch().count();
+      P.first->second =
+          std::to_string(St.getSize()) + " " + std::to_string(Time);
+    }
+  }
+
+  if (!P.first->second)
+    return false;
+  Key += Path;
+  Key += '\0';
+  Key += *P.first->second;
+  Key += '\0';
+  return true;
+}
+
+static Optional<std::string> getCachePath(StringRef Path,
+                                          uint64_t OffsetInArchive,
+                                          MemoryBufferRef MB) {
+  std::string Key = getLLDVersion();
+  Key += '\0';
+  if (!addFileStatus(Path, Key))
+    return None;
+
+  // A member of a thin archive is a separate file that can change without
+  // the archive itself being touched.
+  StringRef Member = MB.getBufferIdentifier();
+  if (Member != Path && fs::is_regular_file(Member))
+    addFileStatus(Member, Key);
+
+  Key += std::to_string(OffsetInArchive);
+  Key += '\0';
+  Key += std::to_string(MB.getBufferSize());
+
+  SmallString<128> S = Config->SymbolIndexCache;
+  path::append(S, "lld-symidx-" + utohexstr(xxh3_64bits(Key)));
+  return std::string(S.str());
+}
+
+bool elf::readSymbolIndexCache(StringRef Path, uint64_t OffsetInArchive,
+                               MemoryBufferRef MB,
+                               std::vector<StringRef> &Names) {
+  Optional<std::string> CachePath = getCachePath(Path, OffsetInArchive, MB);
+  if (!CachePath)
+    return false;
+
+  ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr =
+      MemoryBuffer::getFile(*CachePath, -1, false);
+  if (!MBOrErr)
+    return false;
+
+  // Every name is followed by a NUL, so a truncated entry is detected by
+  // its last byte.
+  StringRef Buf = (*MBOrErr)->getBuffer();
+  if (!Buf.consume_front(CacheMagic) || (!Buf.empty() && Buf.back() != '\0'))
+    return false;
+
+  while (!Buf.empty()) {
+    size_t End = Buf.find('\0');
+    Names.push_back(Buf.substr(0, End));
+    Buf = Buf.substr(End + 1);
+  }
+
+  // The names point into the mapped entry, so keep it alive.
+  make<std::unique_ptr<MemoryBuffer>>(std::move(*MBOrErr));
+  return true;
+}
+
+void elf::writeSymbolIndexCache(StringRef Path, uint64_t OffsetInArchive,
+                                MemoryBufferRef MB, ArrayRef<StringRef> Names) {
+  Optional<std::string> CachePath = getCachePath(Path, OffsetInArchive, MB);
+  if (!CachePath)
+    return;
+  if (fs::create_directories(Config->SymbolIndexCache))
+    return;
+
+  // Write to a temporary file first, so that concurrent links never see a
+  // partially written entry.
+  int FD;
+  SmallString<128> TempPath;
+  if (fs::createUniqueFile(*CachePath + ".tmp-%%%%%%", FD, TempPath))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    OS << CacheMagic;
+    for (StringRef Name : Names)
+      OS << Name << '\0';
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      fs::remove(TempPath);
+      return;
+    }
+  }
+  if (fs::rename(TempPath, *CachePath))
+    fs::remove(TempPath);
+}
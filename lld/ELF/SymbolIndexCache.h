@@ -0,0 +1,32 @@
+//===- SymbolIndexCache.h ---------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLD_ELF_SYMBOL_INDEX_CACHE_H
+#define LLD_ELF_SYMBOL_INDEX_CACHE_H
+
+#include "lld/Common/LLVM.h"
+#include <vector>
+
+namespace lld {
+namespace elf {
+
+// Reads the names of the symbols defined by a lazy bitcode file from the
+// --symbol-index-cache directory. Path is the archive containing the file,
+// or the file itself if it is not an archive member. Returns false on a
+// cache miss. The returned names stay valid until the end of the link.
+bool readSymbolIndexCache(StringRef Path, uint64_t OffsetInArchive,
+                          MemoryBufferRef MB, std::vector<StringRef> &Names);
+
+// Stores the names of the symbols defined by a lazy bitcode file.
+void writeSymbolIndexCache(StringRef Path, uint64_t OffsetInArchive,
+                           MemoryBufferRef MB, ArrayRef<StringRef> Names);
+
+} // namespace elf
+} // namespace lld
+
+#endif
@@ -49,8 +49,7 @@ void SymbolTable::wrap(Symbol *Sym, Symbol *Real, Symbol *Wrap) {
   Real->setName(S);
 }
 
-// Find an existing symbol or create a new one.
-Symbol *SymbolTable::insert(StringRef Name) {
+StringRef SymbolTable::getSymbolName(StringRef Name) {
   // <name>@@<version> means the symbol is the default version. In that
   // case <name>@@<version> will be used to resolve references to <name>.
   //
@@ -59,9 +58,17 @@ Symbol *SymbolTable::insert(StringRef Name) {
   // StringRef::find(StringRef).
   size_t Pos = Name.find('@');
   if (Pos != StringRef::npos && Pos + 1 < Name.size() && Name[Pos + 1] == '@')
-    Name = Name.take_front(Pos);
+    return Name.take_front(Pos);
+  return Name;
+}
+
+// Find an existing symbol or create a new one.
+Symbol *SymbolTable::insert(StringRef Name) {
+  return insert(CachedHashStringRef(getSymbolName(Name)));
+}
 
-  auto P = SymMap.insert({CachedHashStringRef(Name), (int)SymVector.size()});
+Symbol *SymbolTable::insert(CachedHashStringRef Name) {
+  auto P = SymMap.insert({Name, (int)SymVector.size()});
   int &SymIndex = P.first->second;
   bool IsNew = P.second;
 
@@ -71,7 +78,7 @@ Symbol *SymbolTable::insert(StringRef Name) {
   Symbol *Sym = reinterpret_cast<Symbol *>(make<SymbolUnion>());
   SymVector.push_back(Sym);
 
-  Sym->setName(Name);
+  Sym->setName(Name.val());
   Sym->SymbolKind = Symbol::PlaceholderKind;
   Sym->VersionId = Config->DefaultSymbolVersion;
   Sym->Visibility = STV_DEFAULT;
@@ -43,6 +43,13 @@ public:
 
   Symbol *insert(StringRef Name);
 
+  // Same as insert(StringRef), but takes a name that has already been passed
+  // through getSymbolName() and hashed, e.g. by ObjFile::preparse().
+  Symbol *insert(llvm::CachedHashStringRef Name);
+
+  // Returns the name under which a symbol is looked up in the symbol table.
+  static StringRef getSymbolName(StringRef Name);
+
   Symbol *addSymbol(const Symbol &New);
 
   void scanVersionScript();
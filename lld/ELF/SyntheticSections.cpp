@@ -2448,20 +2448,16 @@ static std::vector<GdbIndexSection::CuEntry> readCuList(DWARFContext &Dwarf) {
   return Ret;
 }
 
+// Convert the address ranges of the compile units of Sec's file, indexed by
+// unit, to address areas of the output.
 static std::vector<GdbIndexSection::AddressEntry>
-readAddressAreas(DWARFContext &Dwarf, InputSection *Sec) {
+readAddressAreas(InputSection *Sec,
+                 ArrayRef<DWARFAddressRangesVector> CuRanges) {
   std::vector<GdbIndexSection::AddressEntry> Ret;
 
-  uint32_t CuIdx = 0;
-  for (std::unique_ptr<DWARFUnit> &Cu : Dwarf.compile_units()) {
-    Expected<DWARFAddressRangesVector> Ranges = Cu->collectAddressRanges();
-    if (!Ranges) {
-      error(toString(Sec) + ": " + toString(Ranges.takeError()));
-      return {};
-    }
-
-    ArrayRef<InputSectionBase *> Sections = Sec->File->getSections();
-    for (DWARFAddressRange &R : *Ranges) {
+  ArrayRef<InputSectionBase *> Sections = Sec->File->getSections();
+  for (uint32_t CuIdx = 0, E = CuRanges.size(); CuIdx != E; ++CuIdx) {
+    for (const DWARFAddressRange &R : CuRanges[CuIdx]) {
       if (R.SectionIndex == -1ULL)
         continue;
       InputSectionBase *S = Sections[R.SectionIndex];
@@ -2474,7 +2470,6 @@ readAddressAreas(DWARFContext &Dwarf, InputSection *Sec) {
       uint64_t Offset = IS->getOffsetInFile();
       Ret.push_back({IS, R.LowPC - Offset, R.HighPC - Offset, CuIdx});
     }
-    ++CuIdx;
   }
 
   return Ret;
@@ -2602,19 +2597,57 @@ template <class ELFT> GdbIndexSection *GdbIndexSection::create() {
 
   std::vector<GdbChunk> Chunks(Sections.size());
   std::vector<std::vector<NameAttrEntry>> NameAttrs(Sections.size());
+  std::vector<std::unique_ptr<DWARFContext>> Dwarfs(Sections.size());
 
   parallelForEachN(0, Sections.size(), [&](size_t I) {
     ObjFile<ELFT> *File = Sections[I]->getFile<ELFT>();
-    DWARFContext Dwarf(make_unique<LLDDwarfObj<ELFT>>(File));
+    Dwarfs[I] = llvm::make_unique<DWARFContext>(
+        llvm::make_unique<LLDDwarfObj<ELFT>>(File));
+    Dwarfs[I]->prepareNormalUnitsForThreads();
 
     Chunks[I].Sec = Sections[I];
-    Chunks[I].CompilationUnits = readCuList(Dwarf);
-    Chunks[I].AddressAreas = readAddressAreas(Dwarf, Sections[I]);
+    Chunks[I].CompilationUnits = readCuList(*Dwarfs[I]);
     NameAttrs[I] = readPubNamesAndTypes<ELFT>(
-        static_cast<const LLDDwarfObj<ELFT> &>(Dwarf.getDWARFObj()),
+        static_cast<const LLDDwarfObj<ELFT> &>(Dwarfs[I]->getDWARFObj()),
         Chunks[I].CompilationUnits);
   });
 
+  // Reading the address ranges is the expensive part, and after LTO a few
+  // object files hold most of the compile units, so the ranges are read per
+  // unit rather than per file.
+  std::vector<DWARFUnit *> Units;
+  std::vector<size_t> FirstUnit(Sections.size() + 1);
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    FirstUnit[I] = Units.size();
+    for (std::unique_ptr<DWARFUnit> &Cu : Dwarfs[I]->compile_units())
+      Units.push_back(Cu.get());
+  }
+  FirstUnit[Sections.size()] = Units.size();
+
+  std::vector<DWARFAddressRangesVector> Ranges(Units.size());
+  std::vector<std::string> Errors(Units.size());
+  parallelForEachN(0, Units.size(), [&](size_t I) {
+    Expected<DWARFAddressRangesVector> R = Units[I]->collectAddressRanges();
+    if (R)
+      Ranges[I] = std::move(*R);
+    else
+      Errors[I] = toString(R.takeError());
+  });
+
+  for (size_t I = 0, E = Sections.size(); I != E; ++I) {
+    auto Begin = Errors.begin() + FirstUnit[I];
+    auto End = Errors.begin() + FirstUnit[I + 1];
+    auto Err = std::find_if(Begin, End,
+                            [](const std::string &S) { return !S.empty(); });
+    if (Err != End) {
+      error(toString(Sections[I]) + ": " + *Err);
+      continue;
+    }
+    ArrayRef<DWARFAddressRangesVector> CuRanges = makeArrayRef(Ranges).slice(
+        FirstUnit[I], FirstUnit[I + 1] - FirstUnit[I]);
+    Chunks[I].AddressAreas = readAddressAreas(Sections[I], CuRanges);
+  }
+
   auto *Ret = make<GdbIndexSection>();
   Ret->Chunks = std::move(Chunks);
   Ret->Symbols = createSymbols(NameAttrs, Ret->Chunks);
@@ -2977,6 +3010,17 @@ void MergeNoTailSection::finalizeContents() {
 
   // Add section pieces to the builders.
   parallelForEachN(0, Concurrency, [&](size_t ThreadId) {
+    // The number of live pieces of a shard is an upper bound of the number
+    // of its unique strings. Reserving that much up front keeps the builders
+    // from rehashing while the strings are added.
+    size_t NumPieces[NumShards] = {};
+    for (MergeInputSection *Sec : Sections)
+      for (const SectionPiece &Piece : Sec->Pieces)
+        if (Piece.Live)
+          ++NumPieces[getShardId(Piece.Hash)];
+    for (size_t I = ThreadId; I < NumShards; I += Concurrency)
+      Shards[I].reserve(NumPieces[I]);
+
     for (MergeInputSection *Sec : Sections) {
       for (size_t I = 0, E = Sec->Pieces.size(); I != E; ++I) {
         if (!Sec->Pieces[I].Live)
@@ -26,6 +26,7 @@
 #include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/RandomNumberGenerator.h"
 #include "llvm/Support/SHA1.h"
+#include "llvm/Support/TimeProfiler.h"
 #include "llvm/Support/xxhash.h"
 #include <climits>
 
@@ -577,7 +578,10 @@ template <class ELFT> void Writer<ELFT>::run() {
   // completes section contents. For example, we need to add strings
   // to the string table, and add entries to .got and .plt.
   // finalizeSections does that.
-  finalizeSections();
+  {
+    llvm::TimeTraceScope TimeScope("Finalize sections", StringRef(""));
+    finalizeSections();
+  }
   checkExecuteOnly();
   if (errorCount())
     return;
@@ -624,6 +628,10 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (!Config->OFormatBinary) {
     writeTrapInstr();
     writeHeader();
+    llvm::TimeTraceScope TimeScope("Write sections", [&] {
+      return std::to_string(OutputSections.size()) + " sections, " +
+             std::to_string(FileSize) + " bytes";
+    });
     writeSections();
   } else {
     writeSectionsBinary();
@@ -641,6 +649,7 @@ template <class ELFT> void Writer<ELFT>::run() {
   if (errorCount())
     return;
 
+  llvm::TimeTraceScope TimeScope("Commit output file", StringRef(""));
   if (auto E = Buffer->commit())
     error("failed to write to the output file: " + toString(std::move(E)));
 }
@@ -1738,7 +1747,12 @@ template <class ELFT> void Writer<ELFT>::finalizeSections() {
   // Scan relocations. This must be done after every symbol is declared so that
   // we can correctly decide if a dynamic relocation is needed.
   if (!Config->Relocatable) {
-    forEachRelSec(scanRelocations<ELFT>);
+    std::vector<InputSectionBase *> RelSecs;
+    forEachRelSec([&](InputSectionBase &S) { RelSecs.push_back(&S); });
+    llvm::TimeTraceScope TimeScope("Scan relocations", [&] {
+      return std::to_string(RelSecs.size()) + " sections";
+    });
+    scanRelocations<ELFT>(RelSecs);
     reportUndefinedSymbols<ELFT>();
   }
 
@@ -2619,12 +2633,16 @@ template <class ELFT> void Writer<ELFT>::writeSections() {
   // ELf_Rel targets we might find out that we need to modify the relocated
   // section while doing it.
   for (OutputSection *Sec : OutputSections)
-    if (Sec->Type == SHT_REL || Sec->Type == SHT_RELA)
+    if (Sec->Type == SHT_REL || Sec->Type == SHT_RELA) {
+      llvm::TimeTraceScope TimeScope("Write section", Sec->Name);
       Sec->writeTo<ELFT>(Out::BufferStart + Sec->Offset);
+    }
 
   for (OutputSection *Sec : OutputSections)
-    if (Sec->Type != SHT_REL && Sec->Type != SHT_RELA)
+    if (Sec->Type != SHT_REL && Sec->Type != SHT_RELA) {
+      llvm::TimeTraceScope TimeScope("Write section", Sec->Name);
       Sec->writeTo<ELFT>(Out::BufferStart + Sec->Offset);
+    }
 }
 
 // Split one uint8 array into small pieces of uint8 arrays.
@@ -2678,7 +2696,7 @@ template <class ELFT> void Writer<ELFT>::writeBuildId() {
   switch (Config->BuildId) {
   case BuildIdKind::Fast:
     computeHash(BuildId, Buf, [](uint8_t *Dest, ArrayRef<uint8_t> Arr) {
-      write64le(Dest, xxHash64(Arr));
+      write64le(Dest, xxh3_64bits(Arr));
     });
     break;
   case BuildIdKind::Md5:
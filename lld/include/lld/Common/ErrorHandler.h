@@ -59,6 +59,9 @@
 //
 // warn() doesn't do anything but printing out a given message.
 //
+// Work that runs in parallel can buffer its warnings and errors with
+// bufferDiagnostics() and report them afterwards in a deterministic order.
+//
 // It is not recommended to use llvm::outs() or llvm::errs() directly in lld
 // because they are not thread-safe. The functions declared in this file are
 // thread-safe.
@@ -80,6 +83,12 @@ class DiagnosticInfo;
 
 namespace lld {
 
+// A warning or an error that was buffered rather than printed.
+struct BufferedDiagnostic {
+  bool IsError;
+  std::string Msg;
+};
+
 class ErrorHandler {
 public:
   uint64_t ErrorCount = 0;
@@ -118,6 +127,14 @@ inline uint64_t errorCount() { return errorHandler().ErrorCount; }
 
 LLVM_ATTRIBUTE_NORETURN void exitLld(int Val);
 
+// While a buffer is set, warn() and error() on the calling thread append to
+// it rather than print. Pass nullptr to print them again. fatal() still
+// prints at once.
+void bufferDiagnostics(std::vector<BufferedDiagnostic> *Buffer);
+
+// Report a diagnostic buffered by bufferDiagnostics().
+void reportDiagnostic(const BufferedDiagnostic &D);
+
 void diagnosticHandler(const llvm::DiagnosticInfo &DI);
 void checkError(Error E);
 
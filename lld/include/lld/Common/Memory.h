@@ -34,9 +34,9 @@ extern llvm::StringSaver Saver;
 void freeArena();
 
 // These two classes are hack to keep track of all
-// SpecificBumpPtrAllocator instances.
+// ThreadSafeSpecificBumpPtrAllocator instances.
 struct SpecificAllocBase {
-  SpecificAllocBase() { Instances.push_back(this); }
+  SpecificAllocBase();
   virtual ~SpecificAllocBase() = default;
   virtual void reset() = 0;
   static std::vector<SpecificAllocBase *> Instances;
@@ -44,11 +44,13 @@ struct SpecificAllocBase {
 
 template <class T> struct SpecificAlloc : public SpecificAllocBase {
   void reset() override { Alloc.DestroyAll(); }
-  llvm::SpecificBumpPtrAllocator<T> Alloc;
+  llvm::ThreadSafeSpecificBumpPtrAllocator<T> Alloc;
 };
 
 // Use this arena if your object has a destructor.
 // Your destructor will be invoked from freeArena().
+// make() may be called from several threads at once, but not concurrently
+// with freeArena().
 template <typename T, typename... U> T *make(U &&... Args) {
   static SpecificAlloc<T> Alloc;
   return new (Alloc.Alloc.Allocate()) T(std::forward<U>(Args)...);
@@ -51,6 +51,9 @@ public:
 
   FileSpec GetClangModulesCachePath() const;
   bool SetClangModulesCachePath(llvm::StringRef path);
+  FileSpec GetDWARFIndexCachePath() const;
+  bool GetLazyMethodParsing() const;
+  FileSpec GetSymtabCachePath() const;
   bool GetEnableExternalLookup() const;
   bool SetEnableExternalLookup(bool new_value);
 }; 
@@ -10,6 +10,7 @@
 #define liblldb_UniqueCStringMap_h_
 
 #include <algorithm>
+#include <iterator>
 #include <vector>
 
 #include "lldb/Utility/ConstString.h"
@@ -163,6 +164,17 @@ public:
   // my_map.Sort();
   void Sort() { llvm::sort(m_map.begin(), m_map.end(), Compare()); }
 
+  // Merge the entries of the sorted map "other" into this sorted map, keeping
+  // it sorted. This is linear in the size of both maps, so merging maps that
+  // were sorted in parallel is faster than sorting their concatenation.
+  void MergeSorted(const UniqueCStringMap &other) {
+    collection result;
+    result.reserve(m_map.size() + other.m_map.size());
+    std::merge(m_map.begin(), m_map.end(), other.m_map.begin(),
+               other.m_map.end(), std::back_inserter(result), Compare());
+    m_map.swap(result);
+  }
+
   // Since we are using a vector to contain our items it will always double its
   // memory consumption as things are added to the vector, so if you intend to
   // keep a UniqueCStringMap around and have a lot of entries in the map, you
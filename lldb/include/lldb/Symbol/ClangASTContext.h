@@ -441,6 +441,11 @@ public:
   static void CompleteObjCInterfaceDecl(void *baton,
                                         clang::ObjCInterfaceDecl *);
 
+  static void FindExternalVisibleDeclsByName(
+      void *baton, const clang::DeclContext *decl_ctx,
+      clang::DeclarationName name,
+      llvm::SmallVectorImpl<clang::NamedDecl *> *results);
+
   static bool LayoutRecordType(
       void *baton, const clang::RecordDecl *record_decl, uint64_t &size,
       uint64_t &alignment,
@@ -198,6 +198,17 @@ private:
                             const char *decl_context,
                             const std::set<const char *> &class_contexts);
 
+  /// Returns the path of the file that caches the name indexes of this
+  /// symbol table, or an empty string if they are not cached.
+  std::string GetNameIndexCachePath() const;
+
+  /// Loads the name indexes and the demangled names from \p path. Returns
+  /// false and leaves the symbol table unchanged if the file doesn't match
+  /// the object file.
+  bool LoadNameIndexesFromCache(llvm::StringRef path);
+
+  void SaveNameIndexesToCache(llvm::StringRef path) const;
+
   DISALLOW_COPY_AND_ASSIGN(Symtab);
 };
 
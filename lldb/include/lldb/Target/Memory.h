@@ -57,8 +57,19 @@ protected:
   InvalidRanges m_invalid_ranges;
   Process &m_process;
   uint32_t m_L2_cache_line_byte_size;
+  /// The address of the line after the last lines that were read from the
+  /// process. A miss on this line means that memory is read sequentially.
+  lldb::addr_t m_next_sequential_line_addr = LLDB_INVALID_ADDRESS;
+  /// The number of lines that are read from the process on the next
+  /// sequential miss.
+  uint32_t m_prefetch_line_count = 1;
 
 private:
+  /// Reads the line at \p line_addr from the process into the L2 cache,
+  /// together with the lines after it if memory is read sequentially.
+  /// Returns false if the line at \p line_addr couldn't be read.
+  bool ReadLinesFromProcess(lldb::addr_t line_addr, Status &error);
+
   DISALLOW_COPY_AND_ASSIGN(MemoryCache);
 };
 
@@ -67,6 +67,7 @@ public:
 
   bool GetDisableMemoryCache() const;
   uint64_t GetMemoryCacheLineSize() const;
+  uint64_t GetMemoryCacheMaxPrefetchLines() const;
   Args GetExtraStartupCommands() const;
   void SetExtraStartupCommands(const Args &args);
   FileSpec GetPythonOSPluginPath() const;
@@ -1411,6 +1412,30 @@ public:
   virtual size_t DoReadMemory(lldb::addr_t vm_addr, void *buf, size_t size,
                               Status &error) = 0;
 
+  typedef Range<lldb::addr_t, size_t> MemoryRange;
+
+  /// Actually do the reading of the memory of several ranges in a process.
+  ///
+  /// Processes that can read several ranges with a single request to the
+  /// debugged process override this function. The default implementation
+  /// reads each range with DoReadMemory.
+  ///
+  /// \param[in] ranges
+  ///     The ranges to read.
+  ///
+  /// \param[out] buf
+  ///     A byte buffer that receives the bytes of each range after the bytes
+  ///     of the previous range, whether they were read or not.
+  ///
+  /// \param[out] error
+  ///     An error that indicates the success or failure of reading the
+  ///     first range. The other ranges are only read opportunistically.
+  ///
+  /// \return
+  ///     The number of bytes that were read of each range.
+  virtual std::vector<size_t> DoReadMemoryRanges(
+      llvm::ArrayRef<MemoryRange> ranges, uint8_t *buf, Status &error);
+
   /// Read of memory from a process.
   ///
   /// This function will read memory from the current process's address space
@@ -1477,6 +1502,13 @@ public:
   size_t ReadMemoryFromInferior(lldb::addr_t vm_addr, void *buf, size_t size,
                                 Status &error);
 
+  /// Read the memory of several ranges from the process like
+  /// ReadMemoryFromInferior, with as few requests as possible.
+  ///
+  /// \see DoReadMemoryRanges
+  std::vector<size_t> ReadMemoryRangesFromInferior(
+      llvm::ArrayRef<MemoryRange> ranges, uint8_t *buf, Status &error);
+
   /// Read a NULL terminated string from memory
   ///
   /// This function will read a cache page at a time until a NULL string
@@ -242,22 +242,13 @@ static char *GetMSVCDemangledStr(const char *M) {
 #endif
 }
 
-static char *GetItaniumDemangledStr(const char *M) {
-  char *demangled_cstr = nullptr;
-
-  llvm::ItaniumPartialDemangler ipd;
-  bool err = ipd.partialDemangle(M);
-  if (!err) {
-    // Default buffer and size (will realloc in case it's too small).
-    size_t demangled_size = 80;
-    demangled_cstr = static_cast<char *>(std::malloc(demangled_size));
-    demangled_cstr = ipd.finishDemangle(demangled_cstr, &demangled_size);
-
-    assert(demangled_cstr &&
-           "finishDemangle must always succeed if partialDemangle did");
-    assert(demangled_cstr[demangled_size - 1] == '\0' &&
-           "Expected demangled_size to return length including trailing null");
-  }
+static llvm::StringRef GetItaniumDemangledStr(const char *M) {
+  // The result goes to the string pool right away, so a context per thread
+  // can keep its buffers for all the names it demangles.
+  static thread_local llvm::ItaniumDemangleContext context;
+  size_t demangled_size = 0;
+  const char *demangled_cstr =
+      context.demangle(M, strlen(M), &demangled_size);
 
   if (Log *log = lldb_private::GetLogIfAllCategoriesSet(LIBLLDB_LOG_DEMANGLE)) {
     if (demangled_cstr)
@@ -266,7 +257,9 @@ static char *GetItaniumDemangledStr(const char *M) {
       log->Printf("demangled itanium: %s -> error: failed to demangle", M);
   }
 
-  return demangled_cstr;
+  if (!demangled_cstr)
+    return llvm::StringRef();
+  return llvm::StringRef(demangled_cstr, demangled_size);
 }
 
 // Explicit demangling for scheduled requests during batch processing. This
@@ -363,7 +356,9 @@ Mangled::GetDemangledName(lldb::LanguageType language) const {
         demangled_name = GetMSVCDemangledStr(mangled_name);
         break;
       case eManglingSchemeItanium: {
-        demangled_name = GetItaniumDemangledStr(mangled_name);
+        llvm::StringRef demangled = GetItaniumDemangledStr(mangled_name);
+        if (!demangled.empty())
+          m_demangled.SetStringWithMangledCounterpart(demangled, m_mangled);
         break;
       }
       case eManglingSchemeNone:
@@ -80,9 +80,32 @@ static constexpr PropertyDefinition g_properties[] = {
     },
     {"clang-modules-cache-path", OptionValue::eTypeFileSpec, true, 0, nullptr,
      {},
-     "The path to the clang modules cache directory (-fmodules-cache-path)."}};
-
-enum { ePropertyEnableExternalLookup, ePropertyClangModulesCachePath };
+     "The path to the clang modules cache directory (-fmodules-cache-path)."},
+    {"dwarf-index-cache-path", OptionValue::eTypeFileSpec, true, 0, nullptr,
+     {},
+     "The directory in which the indexes of DWARF without accelerator tables "
+     "are cached, keyed by the module UUID. Indexes are not cached if this "
+     "is empty."},
+    {"lazy-method-parsing", OptionValue::eTypeBoolean, true, false, nullptr,
+     {},
+     "Parse the non-virtual member functions of C++ classes from DWARF only "
+     "when an expression looks them up by name, instead of when the class is "
+     "completed. Member functions that were not looked up yet are not shown "
+     "by commands that print the class."},
+    {"symtab-cache-path", OptionValue::eTypeFileSpec, true, 0, nullptr,
+     {},
+     "The directory in which the name indexes and the demangled names of "
+     "symbol tables are cached, keyed by the module UUID and the path and "
+     "modification time of the object file. Symbol tables are not cached if "
+     "this is empty."}};
+
+enum {
+  ePropertyEnableExternalLookup,
+  ePropertyClangModulesCachePath,
+  ePropertyDWARFIndexCachePath,
+  ePropertyLazyMethodParsing,
+  ePropertySymtabCachePath
+};
 
 } // namespace
 
@@ -114,6 +137,26 @@ FileSpec ModuleListProperties::GetClangModulesCachePath() const {
       ->GetCurrentValue();
 }
 
+FileSpec ModuleListProperties::GetDWARFIndexCachePath() const {
+  return m_collection_sp
+      ->GetPropertyAtIndexAsOptionValueFileSpec(nullptr, false,
+                                                ePropertyDWARFIndexCachePath)
+      ->GetCurrentValue();
+}
+
+FileSpec ModuleListProperties::GetSymtabCachePath() const {
+  return m_collection_sp
+      ->GetPropertyAtIndexAsOptionValueFileSpec(nullptr, false,
+                                                ePropertySymtabCachePath)
+      ->GetCurrentValue();
+}
+
+bool ModuleListProperties::GetLazyMethodParsing() const {
+  const uint32_t idx = ePropertyLazyMethodParsing;
+  return m_collection_sp->GetPropertyAtIndexAsBoolean(
+      nullptr, idx, g_properties[idx].default_uint_value != 0);
+}
+
 bool ModuleListProperties::SetClangModulesCachePath(llvm::StringRef path) {
   return m_collection_sp->SetPropertyAtIndexAsString(
       nullptr, ePropertyClangModulesCachePath, path);
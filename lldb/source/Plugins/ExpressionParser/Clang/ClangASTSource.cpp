@@ -735,6 +735,9 @@ void ClangASTSource::FindExternalVisibleDecls(NameSearchContext &context) {
     }
   } else if (isa<ObjCInterfaceDecl>(context.m_decl_context) && !HasMerger()) {
     FindObjCPropertyAndIvarDecls(context);
+  } else if (isa<CXXRecordDecl>(context.m_decl_context)) {
+    FindCXXMethodDecls(context);
+    return;
   } else if (!isa<TranslationUnitDecl>(context.m_decl_context)) {
     // we shouldn't be getting FindExternalVisibleDecls calls for these
     return;
@@ -1630,6 +1633,49 @@ void ClangASTSource::FindObjCPropertyAndIvarDecls(NameSearchContext &context) {
   } while (false);
 }
 
+void ClangASTSource::FindCXXMethodDecls(NameSearchContext &context) {
+  Log *log(lldb_private::GetLogIfAllCategoriesSet(LIBLLDB_LOG_EXPRESSIONS));
+
+  const auto *record_decl = cast<CXXRecordDecl>(context.m_decl_context);
+  if (!m_ast_importer_sp || !context.m_decl_name.isIdentifier())
+    return;
+
+  Decl *original_decl = nullptr;
+  ASTContext *original_ctx = nullptr;
+  if (!m_ast_importer_sp->ResolveDeclOrigin(record_decl, &original_decl,
+                                            &original_ctx))
+    return;
+
+  // Only classes that parse their member functions on demand need to be
+  // searched, all other members were copied when the class was completed.
+  auto *original_record_decl = dyn_cast<CXXRecordDecl>(original_decl);
+  if (!original_record_decl ||
+      !original_record_decl->hasExternalVisibleStorage())
+    return;
+
+  StringRef name = context.m_decl_name.getAsIdentifierInfo()->getName();
+  DeclarationName original_name(&original_ctx->Idents.get(name));
+
+  // The fields and the member functions that were parsed eagerly are already
+  // in the class, only add member functions.
+  for (NamedDecl *decl : original_record_decl->lookup(original_name)) {
+    if (!isa<CXXMethodDecl>(decl))
+      continue;
+    auto *copied_decl = dyn_cast_or_null<NamedDecl>(CopyDecl(decl));
+    if (!copied_decl)
+      continue;
+
+    if (log) {
+      ASTDumper ast_dumper(copied_decl);
+      log->Printf("  CAS::FCXXMD Found method in %s: %s",
+                  record_decl->getNameAsString().c_str(),
+                  ast_dumper.GetCString());
+    }
+
+    context.AddNamedDecl(copied_decl);
+  }
+}
+
 typedef llvm::DenseMap<const FieldDecl *, uint64_t> FieldOffsetMap;
 typedef llvm::DenseMap<const CXXRecordDecl *, CharUnits> BaseOffsetMap;
 
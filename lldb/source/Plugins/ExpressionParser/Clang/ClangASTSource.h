@@ -318,6 +318,15 @@ protected:
   ///     is the containing object.
   void FindObjCPropertyAndIvarDecls(NameSearchContext &context);
 
+  /// Find the member functions with a given name in a C++ class whose
+  /// original class parses its member functions on demand.
+  ///
+  /// \param[in] context
+  ///     The NameSearchContext that can construct Decls for this name.
+  ///     Its m_decl_name contains the name and its m_decl_context
+  ///     is the containing class.
+  void FindCXXMethodDecls(NameSearchContext &context);
+
   /// A wrapper for ClangASTContext::CopyType that sets a flag that
   /// indicates that we should not respond to queries during import.
   ///
@@ -319,6 +319,8 @@ public:
 
   bool GetQXferAuxvReadSupported();
 
+  bool GetMultiMemReadSupported();
+
   void EnableErrorStringInPacket();
 
   bool GetQXferLibrariesReadSupported();
@@ -527,6 +529,7 @@ protected:
   LazyBool m_supports_jGetSharedCacheInfo;
   LazyBool m_supports_QPassSignals;
   LazyBool m_supports_error_string_reply;
+  LazyBool m_supports_MultiMemRead;
 
   bool m_supports_qProcessInfoPID : 1, m_supports_qfProcessInfo : 1,
       m_supports_qUserName : 1, m_supports_qGroupName : 1,
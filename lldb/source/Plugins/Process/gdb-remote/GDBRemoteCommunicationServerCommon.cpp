@@ -826,6 +826,7 @@ GDBRemoteCommunicationServerCommon::Handle_qSupported(
   response.PutCString(";QPassSignals+");
   response.PutCString(";qXfer:auxv:read+");
   response.PutCString(";qXfer:libraries-svr4:read+");
+  response.PutCString(";MultiMemRead+");
 #endif
 
   return SendPacketNoLock(response.GetString());
@@ -92,6 +92,9 @@ void GDBRemoteCommunicationServerLLGS::RegisterPacketHandlers() {
       &GDBRemoteCommunicationServerLLGS::Handle_memory_read);
   RegisterMemberFunctionHandler(StringExtractorGDBRemote::eServerPacketType_M,
                                 &GDBRemoteCommunicationServerLLGS::Handle_M);
+  RegisterMemberFunctionHandler(
+      StringExtractorGDBRemote::eServerPacketType_MultiMemRead,
+      &GDBRemoteCommunicationServerLLGS::Handle_MultiMemRead);
   RegisterMemberFunctionHandler(StringExtractorGDBRemote::eServerPacketType_p,
                                 &GDBRemoteCommunicationServerLLGS::Handle_p);
   RegisterMemberFunctionHandler(StringExtractorGDBRemote::eServerPacketType_P,
@@ -2332,6 +2335,77 @@ GDBRemoteCommunicationServerLLGS::Handle_memory_read(
   return SendPacketNoLock(response.GetString());
 }
 
+GDBRemoteCommunication::PacketResult
+GDBRemoteCommunicationServerLLGS::Handle_MultiMemRead(
+    StringExtractorGDBRemote &packet) {
+  Log *log(GetLogIfAnyCategoriesSet(LIBLLDB_LOG_PROCESS));
+
+  if (!m_debugged_process_up ||
+      (m_debugged_process_up->GetID() == LLDB_INVALID_PROCESS_ID)) {
+    if (log)
+      log->Printf(
+          "GDBRemoteCommunicationServerLLGS::%s failed, no process available",
+          __FUNCTION__);
+    return SendErrorResponse(0x15);
+  }
+
+  // The packet is "MultiMemRead:ranges:<addr>,<length>[,<addr>,<length>]*;".
+  packet.SetFilePos(strlen("MultiMemRead:"));
+  if (!packet.GetStringRef().substr(packet.GetFilePos()).startswith(
+          "ranges:"))
+    return SendIllFormedResponse(packet, "No ranges in MultiMemRead packet");
+  packet.SetFilePos(packet.GetFilePos() + strlen("ranges:"));
+
+  std::vector<std::pair<lldb::addr_t, uint64_t>> ranges;
+  uint64_t total_size = 0;
+  while (true) {
+    const lldb::addr_t addr = packet.GetHexMaxU64(false, LLDB_INVALID_ADDRESS);
+    if (addr == LLDB_INVALID_ADDRESS || packet.GetChar() != ',')
+      return SendIllFormedResponse(packet,
+                                   "Invalid range in MultiMemRead packet");
+    const uint64_t length = packet.GetHexMaxU64(false, UINT64_MAX);
+    if (length == UINT64_MAX)
+      return SendIllFormedResponse(packet,
+                                   "Invalid length in MultiMemRead packet");
+    ranges.emplace_back(addr, length);
+    total_size += length;
+
+    const char separator = packet.GetChar();
+    if (separator == ';')
+      break;
+    if (separator != ',')
+      return SendIllFormedResponse(packet,
+                                   "Invalid separator in MultiMemRead packet");
+  }
+
+  // Read all ranges into one buffer. A range that can't be read at all is
+  // reported with a length of zero instead of failing the whole packet.
+  std::string buf(total_size, '\0');
+  StreamGDBRemote response;
+  size_t buf_size = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    size_t bytes_read = 0;
+    if (ranges[i].second != 0) {
+      Status error = m_debugged_process_up->ReadMemoryWithoutTrap(
+          ranges[i].first, &buf[buf_size], ranges[i].second, bytes_read);
+      if (error.Fail()) {
+        if (log)
+          log->Printf("GDBRemoteCommunicationServerLLGS::%s pid %" PRIu64
+                      " mem 0x%" PRIx64 ": failed to read. Error: %s",
+                      __FUNCTION__, m_debugged_process_up->GetID(),
+                      ranges[i].first, error.AsCString());
+        bytes_read = 0;
+      }
+    }
+    response.Printf("%s%" PRIx64, i ? "," : "", (uint64_t)bytes_read);
+    buf_size += bytes_read;
+  }
+  response.PutChar(';');
+  response.PutEscapedBytes(buf.data(), buf_size);
+
+  return SendPacketNoLock(response.GetString());
+}
+
 GDBRemoteCommunication::PacketResult
 GDBRemoteCommunicationServerLLGS::Handle_M(StringExtractorGDBRemote &packet) {
   Log *log(GetLogIfAnyCategoriesSet(LIBLLDB_LOG_PROCESS));
@@ -2819,6 +2819,85 @@ size_t ProcessGDBRemote::DoReadMemory(addr_t addr, void *buf, size_t size,
   return 0;
 }
 
+std::vector<size_t>
+ProcessGDBRemote::DoReadMemoryRanges(llvm::ArrayRef<MemoryRange> ranges,
+                                     uint8_t *buf, Status &error) {
+  GetMaxMemorySize();
+  size_t total_size = 0;
+  for (const MemoryRange &range : ranges)
+    total_size += range.GetByteSize();
+  // The response starts with the number of bytes read of each range, which
+  // takes up to 17 bytes per range.
+  if (ranges.size() < 2 || !m_gdb_comm.GetMultiMemReadSupported() ||
+      total_size + 17 * ranges.size() > m_max_memory_size)
+    return Process::DoReadMemoryRanges(ranges, buf, error);
+
+  StreamString packet;
+  packet.PutCString("MultiMemRead:ranges:");
+  for (size_t i = 0; i < ranges.size(); ++i)
+    packet.Printf("%s%" PRIx64 ",%" PRIx64, i ? "," : "",
+                  (uint64_t)ranges[i].GetRangeBase(),
+                  (uint64_t)ranges[i].GetByteSize());
+  packet.PutChar(';');
+
+  std::vector<size_t> bytes_read(ranges.size(), 0);
+  StringExtractorGDBRemote response;
+  if (m_gdb_comm.SendPacketAndWaitForResponse(packet.GetString(), response,
+                                              true) !=
+      GDBRemoteCommunication::PacketResult::Success) {
+    error.SetErrorStringWithFormat("failed to send packet: '%s'",
+                                   packet.GetData());
+    return bytes_read;
+  }
+  if (response.IsUnsupportedResponse())
+    return Process::DoReadMemoryRanges(ranges, buf, error);
+  if (!response.IsNormalResponse()) {
+    error.SetErrorStringWithFormat("memory read failed for 0x%" PRIx64,
+                                   (uint64_t)ranges.front().GetRangeBase());
+    return bytes_read;
+  }
+
+  // The response is the number of bytes read of each range separated by
+  // commas, a semicolon and the bytes of all ranges.
+  size_t total_read = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    const uint64_t range_read = response.GetHexMaxU64(false, UINT64_MAX);
+    const char separator = response.GetChar();
+    if (range_read > ranges[i].GetByteSize() ||
+        separator != (i + 1 == ranges.size() ? ';' : ',')) {
+      error.SetErrorStringWithFormat(
+          "unexpected response to GDB server memory read packet '%s': '%s'",
+          packet.GetData(), response.GetStringRef().c_str());
+      return std::vector<size_t>(ranges.size(), 0);
+    }
+    bytes_read[i] = range_read;
+    total_read += range_read;
+  }
+  if (response.GetBytesLeft() < total_read) {
+    error.SetErrorStringWithFormat(
+        "unexpected response to GDB server memory read packet '%s': '%s'",
+        packet.GetData(), response.GetStringRef().c_str());
+    return std::vector<size_t>(ranges.size(), 0);
+  }
+
+  // The lower level GDBRemoteCommunication packet receive layer has already
+  // de-quoted any 0x7d character escaping that was present in the packet.
+  const char *data =
+      response.GetStringRef().data() + response.GetFilePos();
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    memcpy(buf, data, bytes_read[i]);
+    data += bytes_read[i];
+    buf += ranges[i].GetByteSize();
+  }
+
+  if (bytes_read.front() == 0)
+    error.SetErrorStringWithFormat("memory read failed for 0x%" PRIx64,
+                                   (uint64_t)ranges.front().GetRangeBase());
+  else
+    error.Clear();
+  return bytes_read;
+}
+
 Status ProcessGDBRemote::WriteObjectFile(
     std::vector<ObjectFile::LoadableData> entries) {
   Status error;
@@ -133,6 +133,10 @@ public:
   size_t DoReadMemory(lldb::addr_t addr, void *buf, size_t size,
                       Status &error) override;
 
+  std::vector<size_t> DoReadMemoryRanges(llvm::ArrayRef<MemoryRange> ranges,
+                                         uint8_t *buf,
+                                         Status &error) override;
+
   Status
   WriteObjectFile(std::vector<ObjectFile::LoadableData> entries) override;
 
@@ -20,6 +20,7 @@
 
 #include "Plugins/Language/ObjC/ObjCLanguage.h"
 #include "lldb/Core/Module.h"
+#include "lldb/Core/ModuleList.h"
 #include "lldb/Core/Value.h"
 #include "lldb/Host/Host.h"
 #include "lldb/Symbol/ClangASTImporter.h"
@@ -41,6 +42,7 @@
 #include "clang/AST/DeclObjC.h"
 #include "clang/AST/DeclTemplate.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <vector>
@@ -1879,6 +1881,26 @@ bool DWARFASTParserClang::ParseTemplateParameterInfos(
   return template_param_infos.args.size() == template_param_infos.names.size();
 }
 
+/// Returns true if the member function \p die of the class \p class_name
+/// only needs to be parsed when it is looked up by name. Clang needs the
+/// special members and the virtual functions to lay out the class and to
+/// decide whether it is trivial, so those are always parsed.
+static bool IsDeferrableMethod(const DWARFDIE &die, const char *class_name) {
+  const char *name = die.GetName();
+  if (!name || !class_name)
+    return false;
+  if (die.GetAttributeValueAsUnsigned(DW_AT_virtuality, 0) ||
+      die.GetAttributeValueAsUnsigned(DW_AT_artificial, 0))
+    return false;
+  llvm::StringRef method_name(name);
+  // Operators are found by other kinds of lookups, and the names of template
+  // specializations don't match the names they are looked up by.
+  if (method_name.startswith("~") || method_name.startswith("operator") ||
+      method_name.contains('<'))
+    return false;
+  return method_name != llvm::StringRef(class_name).split('<').first;
+}
+
 bool DWARFASTParserClang::CompleteTypeFromDWARF(const DWARFDIE &die,
                                                 lldb_private::Type *type,
                                                 CompilerType &clang_type) {
@@ -1942,6 +1964,7 @@ bool DWARFASTParserClang::CompleteTypeFromDWARF(const DWARFDIE &die,
   case DW_TAG_union_type:
   case DW_TAG_class_type: {
     ClangASTImporter::LayoutInfo layout_info;
+    std::vector<DWARFDIE> deferred_method_dies;
 
     {
       if (die.HasChildren()) {
@@ -1978,9 +2001,18 @@ bool DWARFASTParserClang::CompleteTypeFromDWARF(const DWARFDIE &die,
                           delayed_properties, default_accessibility, is_a_class,
                           layout_info);
 
-        // Now parse any methods if there were any...
-        for (const DWARFDIE &die : member_function_dies)
-          dwarf->ResolveType(die);
+        // Now parse any methods if there were any. Methods that can only be
+        // found by a lookup of their name are parsed on demand if lazy method
+        // parsing is enabled.
+        const bool lazy_methods =
+            class_language != eLanguageTypeObjC &&
+            ModuleList::GetGlobalModuleListProperties().GetLazyMethodParsing();
+        for (const DWARFDIE &method_die : member_function_dies) {
+          if (lazy_methods && IsDeferrableMethod(method_die, die.GetName()))
+            deferred_method_dies.push_back(method_die);
+          else
+            dwarf->ResolveType(method_die);
+        }
 
         if (class_language == eLanguageTypeObjC) {
           ConstString class_name(clang_type.GetTypeName());
@@ -2079,6 +2111,15 @@ bool DWARFASTParserClang::CompleteTypeFromDWARF(const DWARFDIE &die,
     ClangASTContext::BuildIndirectFields(clang_type);
     ClangASTContext::CompleteTagDeclarationDefinition(clang_type);
 
+    if (!deferred_method_dies.empty()) {
+      if (clang::CXXRecordDecl *record_decl =
+              m_ast.GetAsCXXRecordDecl(clang_type.GetOpaqueQualType())) {
+        // Lookups in the class now go through ParseDeferredMethods.
+        record_decl->setHasExternalVisibleStorage(true);
+        m_deferred_methods[record_decl] = std::move(deferred_method_dies);
+      }
+    }
+
     if (!layout_info.field_offsets.empty() ||
         !layout_info.base_offsets.empty() ||
         !layout_info.vbase_offsets.empty()) {
@@ -2181,6 +2222,38 @@ bool DWARFASTParserClang::CompleteTypeFromDWARF(const DWARFDIE &die,
   return false;
 }
 
+void DWARFASTParserClang::ParseDeferredMethods(
+    const clang::DeclContext *decl_ctx, clang::DeclarationName name,
+    llvm::SmallVectorImpl<clang::NamedDecl *> &results) {
+  if (!name.isIdentifier())
+    return;
+  auto pos = m_deferred_methods.find(decl_ctx);
+  if (pos == m_deferred_methods.end())
+    return;
+
+  llvm::StringRef name_str = name.getAsIdentifierInfo()->getName();
+  std::vector<DWARFDIE> &method_dies = pos->second;
+  auto matches = std::stable_partition(
+      method_dies.begin(), method_dies.end(),
+      [&](const DWARFDIE &die) { return name_str != die.GetName(); });
+  if (matches == method_dies.end())
+    return;
+
+  std::vector<DWARFDIE> dies_to_parse(matches, method_dies.end());
+  method_dies.erase(matches, method_dies.end());
+  SymbolFileDWARF *dwarf = dies_to_parse.front().GetDWARF();
+  std::lock_guard<std::recursive_mutex> guard(
+      dwarf->GetObjectFile()->GetModule()->GetMutex());
+  for (const DWARFDIE &die : dies_to_parse)
+    dwarf->ResolveType(die);
+
+  // Resolving a method adds its declaration to the class.
+  for (clang::Decl *decl : decl_ctx->decls())
+    if (auto *method_decl = llvm::dyn_cast<clang::CXXMethodDecl>(decl))
+      if (method_decl->getDeclName() == name)
+        results.push_back(method_decl);
+}
+
 std::vector<DWARFDIE> DWARFASTParserClang::GetDIEForDeclContext(
     lldb_private::CompilerDeclContext decl_context) {
   std::vector<DWARFDIE> result;
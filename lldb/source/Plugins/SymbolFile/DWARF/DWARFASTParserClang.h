@@ -62,6 +62,13 @@ public:
 
   lldb_private::ClangASTImporter &GetClangASTImporter();
 
+  /// Parses the member functions named \p name of the class \p decl_ctx
+  /// whose parsing was deferred when the class was completed, and adds their
+  /// declarations to \p results.
+  void ParseDeferredMethods(const clang::DeclContext *decl_ctx,
+                            clang::DeclarationName name,
+                            llvm::SmallVectorImpl<clang::NamedDecl *> &results);
+
 protected:
   class DelayedAddObjCClassProperty;
   typedef std::vector<DelayedAddObjCClassProperty> DelayedPropertyList;
@@ -145,6 +152,10 @@ protected:
   DeclToDIEMap m_decl_to_die;
   DIEToDeclContextMap m_die_to_decl_ctx;
   DeclContextToDIEMap m_decl_ctx_to_die;
+  /// The member functions of completed classes that are parsed when they
+  /// are looked up by name (see symbols.lazy-method-parsing).
+  llvm::DenseMap<const clang::DeclContext *, std::vector<DWARFDIE>>
+      m_deferred_methods;
   std::unique_ptr<lldb_private::ClangASTImporter> m_clang_ast_importer_up;
 };
 
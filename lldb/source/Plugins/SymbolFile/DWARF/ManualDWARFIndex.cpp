@@ -13,14 +13,28 @@
 #include "Plugins/SymbolFile/DWARF/LogChannelDWARF.h"
 #include "Plugins/SymbolFile/DWARF/SymbolFileDWARFDwo.h"
 #include "lldb/Core/Module.h"
+#include "lldb/Core/ModuleList.h"
 #include "lldb/Host/TaskPool.h"
 #include "lldb/Symbol/ObjectFile.h"
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/Timer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace lldb_private;
 using namespace lldb;
 
+NameToDIE ManualDWARFIndex::IndexSet::*const ManualDWARFIndex::g_tables[8] = {
+    &IndexSet::function_basenames, &IndexSet::function_fullnames,
+    &IndexSet::function_methods,   &IndexSet::function_selectors,
+    &IndexSet::objc_class_selectors, &IndexSet::globals,
+    &IndexSet::types,              &IndexSet::namespaces};
+
 void ManualDWARFIndex::Index() {
   if (!m_debug_info)
     return;
@@ -41,14 +55,22 @@ void ManualDWARFIndex::Index() {
   if (units_to_index.empty())
     return;
 
+  std::string cache_path = GetCacheFilePath();
+  if (!cache_path.empty() && LoadFromCache(cache_path))
+    return;
+
   std::vector<IndexSet> sets(units_to_index.size());
 
   // Keep memory down by clearing DIEs for any units if indexing
   // caused us to load the unit's DIEs.
   std::vector<llvm::Optional<DWARFUnit::ScopedExtractDIEs>> clear_cu_dies(
       units_to_index.size());
+  // Each unit is indexed into its own set, which is sorted right away so that
+  // the sets can be merged without sorting all names again.
   auto parser_fn = [&](size_t cu_idx) {
     IndexUnit(*units_to_index[cu_idx], sets[cu_idx]);
+    for (NameToDIE IndexSet::*table : g_tables)
+      (sets[cu_idx].*table).Finalize();
   };
 
   auto extract_fn = [&units_to_index, &clear_cu_dies](size_t cu_idx) {
@@ -70,21 +92,173 @@ void ManualDWARFIndex::Index() {
 
   TaskMapOverInt(0, units_to_index.size(), parser_fn);
 
-  auto finalize_fn = [this, &sets](NameToDIE(IndexSet::*index)) {
-    NameToDIE &result = m_set.*index;
-    for (auto &set : sets)
-      result.Append(set.*index);
-    result.Finalize();
-  };
+  // Merge the sorted sets pairwise until only the first one is left. All
+  // tables of all pairs of a round are merged in parallel.
+  const size_t num_tables = llvm::array_lengthof(g_tables);
+  for (size_t stride = 1; stride < sets.size(); stride *= 2) {
+    const size_t num_pairs = (sets.size() + stride - 1) / (2 * stride);
+    TaskMapOverInt(0, num_pairs * num_tables, [&](size_t task_idx) {
+      const size_t first = task_idx / num_tables * 2 * stride;
+      NameToDIE IndexSet::*table = g_tables[task_idx % num_tables];
+      (sets[first].*table).Merge(sets[first + stride].*table);
+    });
+  }
+  for (NameToDIE IndexSet::*table : g_tables)
+    (m_set.*table).Merge(sets.front().*table);
+
+  if (!cache_path.empty())
+    SaveToCache(cache_path);
+}
+
+std::string ManualDWARFIndex::GetCacheFilePath() const {
+  // The units to avoid depend on the symbol file the index is built for, so
+  // only complete indexes are cached.
+  if (!m_units_to_avoid.empty())
+    return "";
+  const UUID &uuid = m_module.GetUUID();
+  if (!uuid.IsValid())
+    return "";
+  FileSpec cache_dir =
+      ModuleList::GetGlobalModuleListProperties().GetDWARFIndexCachePath();
+  if (!cache_dir)
+    return "";
+  llvm::SmallString<128> path(cache_dir.GetPath());
+  llvm::sys::path::append(path, uuid.GetAsString() + ".dwarf-index");
+  return path.str();
+}
+
+// The cache file starts with a magic string and a version, followed by the
+// names used by the index and by each table in the order of g_tables. All
+// integers are little endian.
+//
+//   magic version name-count name* (entry-count (name-index die-ref)*)*
+//
+// where a name is null terminated, and a die-ref is the DIE offset in the low
+// 32 bits, followed by the section, whether the DWO number is valid and the
+// DWO number.
+static const char g_cache_magic[] = "LLDBDWIX";
+static const uint32_t g_cache_version = 1;
+
+static uint64_t EncodeDIERef(const DIERef &ref) {
+  llvm::Optional<uint32_t> dwo_num = ref.dwo_num();
+  return uint64_t(ref.die_offset()) | uint64_t(ref.section()) << 32 |
+         uint64_t(bool(dwo_num)) << 33 | uint64_t(dwo_num.getValueOr(0)) << 34;
+}
+
+static DIERef DecodeDIERef(uint64_t value) {
+  llvm::Optional<uint32_t> dwo_num;
+  if (value & (uint64_t(1) << 33))
+    dwo_num = uint32_t(value >> 34);
+  return DIERef(dwo_num, DIERef::Section((value >> 32) & 1),
+                dw_offset_t(value));
+}
+
+bool ManualDWARFIndex::LoadFromCache(llvm::StringRef path) {
+  static Timer::Category func_cat(LLVM_PRETTY_FUNCTION);
+  Timer scoped_timer(func_cat, "%s", path.str().c_str());
+
+  auto buffer_or_err = llvm::MemoryBuffer::getFile(
+      path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!buffer_or_err)
+    return false;
+  llvm::StringRef data = (*buffer_or_err)->getBuffer();
+  if (!data.consume_front(llvm::StringRef(g_cache_magic,
+                                          sizeof(g_cache_magic) - 1)))
+    return false;
+
+  llvm::DataExtractor extractor(data, /*IsLittleEndian=*/true,
+                                /*AddressSize=*/8);
+  uint32_t offset = 0;
+  if (!extractor.isValidOffsetForDataOfSize(offset, 8) ||
+      extractor.getU32(&offset) != g_cache_version)
+    return false;
+  std::vector<ConstString> names(extractor.getU32(&offset));
+  for (ConstString &name : names) {
+    const char *cstr = extractor.getCStr(&offset);
+    if (!cstr)
+      return false;
+    name.SetCString(cstr);
+  }
+
+  IndexSet set;
+  for (NameToDIE IndexSet::*table : g_tables) {
+    if (!extractor.isValidOffsetForDataOfSize(offset, 4))
+      return false;
+    const uint32_t count = extractor.getU32(&offset);
+    if (!extractor.isValidOffsetForDataOfSize(offset, uint64_t(count) * 12))
+      return false;
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t name_idx = extractor.getU32(&offset);
+      const uint64_t die_ref = extractor.getU64(&offset);
+      if (name_idx >= names.size())
+        return false;
+      (set.*table).Insert(names[name_idx], DecodeDIERef(die_ref));
+    }
+  }
+
+  // The tables are sorted by the address of the names, which differs from the
+  // process that wrote the cache.
+  TaskMapOverInt(0, llvm::array_lengthof(g_tables), [&](size_t table_idx) {
+    NameToDIE IndexSet::*table = g_tables[table_idx];
+    (set.*table).Finalize();
+    (m_set.*table).Merge(set.*table);
+  });
+  return true;
+}
+
+void ManualDWARFIndex::SaveToCache(llvm::StringRef path) const {
+  static Timer::Category func_cat(LLVM_PRETTY_FUNCTION);
+  Timer scoped_timer(func_cat, "%s", path.str().c_str());
+
+  llvm::DenseMap<const char *, uint32_t> name_indexes;
+  std::vector<ConstString> names;
+  std::vector<std::vector<std::pair<uint32_t, uint64_t>>> tables;
+  for (NameToDIE IndexSet::*table : g_tables) {
+    tables.emplace_back();
+    auto &entries = tables.back();
+    (m_set.*table).ForEach([&](ConstString name, const DIERef &die_ref) {
+      auto insertion = name_indexes.try_emplace(name.GetCString(),
+                                                names.size());
+      if (insertion.second)
+        names.push_back(name);
+      entries.emplace_back(insertion.first->second, EncodeDIERef(die_ref));
+      return true;
+    });
+  }
 
-  TaskPool::RunTasks([&]() { finalize_fn(&IndexSet::function_basenames); },
-                     [&]() { finalize_fn(&IndexSet::function_fullnames); },
-                     [&]() { finalize_fn(&IndexSet::function_methods); },
-                     [&]() { finalize_fn(&IndexSet::function_selectors); },
-                     [&]() { finalize_fn(&IndexSet::objc_class_selectors); },
-                     [&]() { finalize_fn(&IndexSet::globals); },
-                     [&]() { finalize_fn(&IndexSet::types); },
-                     [&]() { finalize_fn(&IndexSet::namespaces); });
+  // Write to a temporary file first, so that concurrent debuggers never read
+  // a partially written index.
+  llvm::StringRef dir = llvm::sys::path::parent_path(path);
+  if (llvm::sys::fs::create_directories(dir))
+    return;
+  int fd;
+  llvm::SmallString<128> temp_path;
+  if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, temp_path))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    llvm::support::endian::Writer writer(os, llvm::support::little);
+    os << llvm::StringRef(g_cache_magic, sizeof(g_cache_magic) - 1);
+    writer.write<uint32_t>(g_cache_version);
+    writer.write<uint32_t>(names.size());
+    for (ConstString name : names)
+      os << name.GetStringRef() << '\0';
+    for (const auto &entries : tables) {
+      writer.write<uint32_t>(entries.size());
+      for (const auto &entry : entries) {
+        writer.write<uint32_t>(entry.first);
+        writer.write<uint64_t>(entry.second);
+      }
+    }
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(temp_path);
+      return;
+    }
+  }
+  if (llvm::sys::fs::rename(temp_path, path))
+    llvm::sys::fs::remove(temp_path);
 }
 
 void ManualDWARFIndex::IndexUnit(DWARFUnit &unit, IndexSet &set) {
@@ -55,9 +55,20 @@ private:
     NameToDIE types;
     NameToDIE namespaces;
   };
+  /// All tables of an IndexSet, in the order in which they are cached.
+  static NameToDIE IndexSet::*const g_tables[8];
+
   void Index();
   void IndexUnit(DWARFUnit &unit, IndexSet &set);
 
+  /// Returns the path of the file that caches the index of this module, or an
+  /// empty string if the index can't be cached.
+  std::string GetCacheFilePath() const;
+  /// Fills m_set from the cache file at \a path. Returns false if the file
+  /// doesn't exist or is malformed.
+  bool LoadFromCache(llvm::StringRef path);
+  void SaveToCache(llvm::StringRef path) const;
+
   static void IndexUnitImpl(DWARFUnit &unit,
                             const lldb::LanguageType cu_language,
                             IndexSet &set);
@@ -22,6 +22,12 @@ void NameToDIE::Finalize() {
   m_map.SizeToFit();
 }
 
+void NameToDIE::Merge(NameToDIE &other) {
+  m_map.MergeSorted(other.m_map);
+  other.m_map.Clear();
+  other.m_map.SizeToFit();
+}
+
 void NameToDIE::Insert(ConstString name, const DIERef &die_ref) {
   m_map.Append(name, die_ref);
 }
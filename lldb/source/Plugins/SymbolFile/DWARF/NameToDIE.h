@@ -32,6 +32,10 @@ public:
 
   void Finalize();
 
+  /// Moves the entries of \a other into this map. Both maps must have been
+  /// finalized, and this map stays finalized.
+  void Merge(NameToDIE &other);
+
   size_t Find(lldb_private::ConstString name,
               DIEArray &info_array) const;
 
@@ -873,7 +873,8 @@ ASTContext *ClangASTContext::getASTContext() {
     llvm::IntrusiveRefCntPtr<clang::ExternalASTSource> ast_source_up(
         new ClangExternalASTSourceCallbacks(
             ClangASTContext::CompleteTagDecl,
-            ClangASTContext::CompleteObjCInterfaceDecl, nullptr,
+            ClangASTContext::CompleteObjCInterfaceDecl,
+            ClangASTContext::FindExternalVisibleDeclsByName,
             ClangASTContext::LayoutRecordType, this));
     SetExternalSource(ast_source_up);
   }
@@ -9900,6 +9901,17 @@ void ClangASTContext::CompleteObjCInterfaceDecl(
   }
 }
 
+void ClangASTContext::FindExternalVisibleDeclsByName(
+    void *baton, const clang::DeclContext *decl_ctx,
+    clang::DeclarationName name,
+    llvm::SmallVectorImpl<clang::NamedDecl *> *results) {
+  // Only classes whose member functions are parsed lazily have external
+  // visible storage.
+  ClangASTContext *ast = (ClangASTContext *)baton;
+  if (ast->m_dwarf_ast_parser_up)
+    ast->m_dwarf_ast_parser_up->ParseDeferredMethods(decl_ctx, name, *results);
+}
+
 DWARFASTParser *ClangASTContext::GetDWARFParser() {
   if (!m_dwarf_ast_parser_up)
     m_dwarf_ast_parser_up.reset(new DWARFASTParserClang(*this));
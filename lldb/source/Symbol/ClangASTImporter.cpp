@@ -952,6 +952,11 @@ void ClangASTImporter::ASTImporterDelegate::ImportDefinitionTo(
     if (clang::TagDecl *from_tag = dyn_cast<clang::TagDecl>(from)) {
       to_tag->setCompleteDefinition(from_tag->isCompleteDefinition());
 
+      // The member functions of the original class that weren't parsed yet
+      // are found by a lookup in the copy (see symbols.lazy-method-parsing).
+      if (from_tag->hasExternalVisibleStorage())
+        to_tag->setHasExternalVisibleStorage();
+
       if (Log *log_ast =
               lldb_private::GetLogIfAllCategoriesSet(LIBLLDB_LOG_AST)) {
         std::string name_string;
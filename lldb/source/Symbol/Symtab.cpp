@@ -12,9 +12,11 @@
 #include "Plugins/Language/ObjC/ObjCLanguage.h"
 
 #include "lldb/Core/Module.h"
+#include "lldb/Core/ModuleList.h"
 #include "lldb/Core/RichManglingContext.h"
 #include "lldb/Core/STLUtils.h"
 #include "lldb/Core/Section.h"
+#include "lldb/Host/FileSystem.h"
 #include "lldb/Symbol/ObjectFile.h"
 #include "lldb/Symbol/Symbol.h"
 #include "lldb/Symbol/SymbolContext.h"
@@ -23,7 +25,15 @@
 #include "lldb/Utility/Stream.h"
 #include "lldb/Utility/Timer.h"
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Support/DataExtractor.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
 
 using namespace lldb;
 using namespace lldb_private;
@@ -256,6 +266,11 @@ void Symtab::InitNameIndexes() {
     m_name_indexes_computed = true;
     static Timer::Category func_cat(LLVM_PRETTY_FUNCTION);
     Timer scoped_timer(func_cat, "%s", LLVM_PRETTY_FUNCTION);
+
+    std::string cache_path = GetNameIndexCachePath();
+    if (!cache_path.empty() && LoadNameIndexesFromCache(cache_path))
+      return;
+
     // Create the name index vector to be able to quickly search by name
     const size_t num_symbols = m_symbols.size();
     m_name_to_index.Reserve(num_symbols);
@@ -338,7 +353,229 @@ void Symtab::InitNameIndexes() {
     m_basename_to_index.SizeToFit();
     m_method_to_index.Sort();
     m_method_to_index.SizeToFit();
+
+    if (!cache_path.empty())
+      SaveNameIndexesToCache(cache_path);
+  }
+}
+
+std::string Symtab::GetNameIndexCachePath() const {
+  FileSpec cache_dir =
+      ModuleList::GetGlobalModuleListProperties().GetSymtabCachePath();
+  if (!cache_dir || !m_objfile)
+    return "";
+  ModuleSP module_sp = m_objfile->GetModule();
+  if (!module_sp || !module_sp->GetUUID().IsValid())
+    return "";
+
+  // A module and its separate debug file have the same UUID, so the path of
+  // the object file is part of the name of the cache file.
+  llvm::SmallString<128> path(cache_dir.GetPath());
+  llvm::sys::path::append(
+      path, module_sp->GetUUID().GetAsString() + "-" +
+                llvm::utohexstr(llvm::hash_value(
+                    m_objfile->GetFileSpec().GetPath())) +
+                ".symtab");
+  return path.str();
+}
+
+// The cache file starts with a magic string and a header that identifies the
+// object file, followed by the names used by the symbol table, the demangled
+// names of the code symbols and the name indexes. All integers are little
+// endian.
+//
+//   magic version mtime symbol-count path name-count name*
+//   demangled-count (symbol-index name-index)*
+//   (entry-count (name-index symbol-index)*)*
+//
+// where the path and the names are null terminated, and the name indexes are
+// the full names, the base names, the methods and the selectors.
+static const char g_symtab_cache_magic[] = "LLDBSYMT";
+static const uint32_t g_symtab_cache_version = 1;
+
+static uint64_t GetModificationTimeForCache(const FileSpec &file) {
+  return FileSystem::Instance()
+      .GetModificationTime(file)
+      .time_since_epoch()
+      .count();
+}
+
+bool Symtab::LoadNameIndexesFromCache(llvm::StringRef path) {
+  static Timer::Category func_cat(LLVM_PRETTY_FUNCTION);
+  Timer scoped_timer(func_cat, "%s", path.str().c_str());
+
+  auto buffer_or_err = llvm::MemoryBuffer::getFile(
+      path, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (!buffer_or_err)
+    return false;
+  llvm::StringRef data = (*buffer_or_err)->getBuffer();
+  if (!data.consume_front(llvm::StringRef(g_symtab_cache_magic,
+                                          sizeof(g_symtab_cache_magic) - 1)))
+    return false;
+
+  llvm::DataExtractor extractor(data, /*IsLittleEndian=*/true,
+                                /*AddressSize=*/8);
+  uint32_t offset = 0;
+  if (!extractor.isValidOffsetForDataOfSize(offset, 16) ||
+      extractor.getU32(&offset) != g_symtab_cache_version ||
+      extractor.getU64(&offset) !=
+          GetModificationTimeForCache(m_objfile->GetFileSpec()) ||
+      extractor.getU32(&offset) != m_symbols.size())
+    return false;
+  const char *objfile_path = extractor.getCStr(&offset);
+  if (!objfile_path || m_objfile->GetFileSpec().GetPath() != objfile_path)
+    return false;
+
+  if (!extractor.isValidOffsetForDataOfSize(offset, 4))
+    return false;
+  std::vector<ConstString> names(extractor.getU32(&offset));
+  for (ConstString &name : names) {
+    const char *cstr = extractor.getCStr(&offset);
+    if (!cstr)
+      return false;
+    name.SetCString(cstr);
+  }
+
+  // Read everything before changing the symbol table, so that a truncated
+  // file leaves it as it was.
+  if (!extractor.isValidOffsetForDataOfSize(offset, 4))
+    return false;
+  const uint32_t num_demangled = extractor.getU32(&offset);
+  if (!extractor.isValidOffsetForDataOfSize(offset,
+                                            uint64_t(num_demangled) * 8))
+    return false;
+  std::vector<std::pair<uint32_t, uint32_t>> demangled(num_demangled);
+  for (auto &entry : demangled) {
+    entry.first = extractor.getU32(&offset);
+    entry.second = extractor.getU32(&offset);
+    if (entry.first >= m_symbols.size() || entry.second >= names.size())
+      return false;
+  }
+
+  NameToIndexMap *const name_indexes[] = {
+      &m_name_to_index, &m_basename_to_index, &m_method_to_index,
+      &m_selector_to_index};
+  const size_t num_indexes = llvm::array_lengthof(name_indexes);
+  std::vector<NameToIndexMap> indexes(num_indexes);
+  for (NameToIndexMap &index : indexes) {
+    if (!extractor.isValidOffsetForDataOfSize(offset, 4))
+      return false;
+    const uint32_t count = extractor.getU32(&offset);
+    if (!extractor.isValidOffsetForDataOfSize(offset, uint64_t(count) * 8))
+      return false;
+    index.Reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t name_idx = extractor.getU32(&offset);
+      const uint32_t symbol_idx = extractor.getU32(&offset);
+      if (name_idx >= names.size() || symbol_idx >= m_symbols.size())
+        return false;
+      index.Append(names[name_idx], symbol_idx);
+    }
+  }
+
+  for (const auto &entry : demangled) {
+    Mangled &mangled = m_symbols[entry.first].GetMangled();
+    ConstString demangled_name;
+    demangled_name.SetStringWithMangledCounterpart(
+        names[entry.second].GetStringRef(), mangled.GetMangledName());
+    mangled.SetDemangledName(demangled_name);
+  }
+
+  // The indexes are sorted by the address of the names, which differs from
+  // the process that wrote the cache.
+  for (size_t i = 0; i < num_indexes; ++i) {
+    *name_indexes[i] = std::move(indexes[i]);
+    name_indexes[i]->Sort();
+  }
+  return true;
+}
+
+void Symtab::SaveNameIndexesToCache(llvm::StringRef path) const {
+  static Timer::Category func_cat(LLVM_PRETTY_FUNCTION);
+  Timer scoped_timer(func_cat, "%s", path.str().c_str());
+
+  llvm::DenseMap<const char *, uint32_t> name_to_index;
+  std::vector<ConstString> names;
+  auto get_name_index = [&](ConstString name) {
+    auto insertion =
+        name_to_index.try_emplace(name.GetCString(), names.size());
+    if (insertion.second)
+      names.push_back(name);
+    return insertion.first->second;
+  };
+
+  // Only the names that were demangled to build the indexes are saved, the
+  // other symbols are demangled on demand as before.
+  std::vector<std::pair<uint32_t, uint32_t>> demangled;
+  for (uint32_t i = 0; i < m_symbols.size(); ++i) {
+    const Symbol &symbol = m_symbols[i];
+    const SymbolType type = symbol.GetType();
+    if (symbol.IsTrampoline() ||
+        (type != eSymbolTypeCode && type != eSymbolTypeResolver))
+      continue;
+    const Mangled &mangled = symbol.GetMangled();
+    if (!mangled.GetMangledName())
+      continue;
+    if (ConstString name = mangled.GetDemangledName(symbol.GetLanguage()))
+      demangled.emplace_back(i, get_name_index(name));
+  }
+
+  const NameToIndexMap *const name_indexes[] = {
+      &m_name_to_index, &m_basename_to_index, &m_method_to_index,
+      &m_selector_to_index};
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> indexes;
+  for (const NameToIndexMap *index : name_indexes) {
+    indexes.emplace_back();
+    const NameToIndexMap &map = *index;
+    for (size_t i = 0, e = map.GetSize(); i < e; ++i)
+      indexes.back().emplace_back(
+          get_name_index(map.GetCStringAtIndexUnchecked(i)),
+          map.GetValueRefAtIndexUnchecked(i));
+  }
+
+  // Write to a temporary file first, so that concurrent debuggers never read
+  // a partially written cache.
+  llvm::StringRef dir = llvm::sys::path::parent_path(path);
+  if (llvm::sys::fs::create_directories(dir))
+    return;
+  int fd;
+  llvm::SmallString<128> temp_path;
+  if (llvm::sys::fs::createUniqueFile(path + ".tmp-%%%%%%", fd, temp_path))
+    return;
+  {
+    llvm::raw_fd_ostream os(fd, /*shouldClose=*/true);
+    llvm::support::endian::Writer writer(os, llvm::support::little);
+    os << llvm::StringRef(g_symtab_cache_magic,
+                          sizeof(g_symtab_cache_magic) - 1);
+    writer.write<uint32_t>(g_symtab_cache_version);
+    writer.write<uint64_t>(
+        GetModificationTimeForCache(m_objfile->GetFileSpec()));
+    writer.write<uint32_t>(m_symbols.size());
+    os << m_objfile->GetFileSpec().GetPath() << '\0';
+    writer.write<uint32_t>(names.size());
+    for (ConstString name : names)
+      os << name.GetStringRef() << '\0';
+    writer.write<uint32_t>(demangled.size());
+    for (const auto &entry : demangled) {
+      writer.write<uint32_t>(entry.first);
+      writer.write<uint32_t>(entry.second);
+    }
+    for (const auto &entries : indexes) {
+      writer.write<uint32_t>(entries.size());
+      for (const auto &entry : entries) {
+        writer.write<uint32_t>(entry.first);
+        writer.write<uint32_t>(entry.second);
+      }
+    }
+    os.close();
+    if (os.has_error()) {
+      os.clear_error();
+      llvm::sys::fs::remove(temp_path);
+      return;
+    }
   }
+  if (llvm::sys::fs::rename(temp_path, path))
+    llvm::sys::fs::remove(temp_path);
 }
 
 void Symtab::RegisterMangledNameEntry(
@@ -13,6 +13,7 @@
 #include "lldb/Utility/RangeMap.h"
 #include "lldb/Utility/State.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <memory>
 
@@ -35,6 +36,8 @@ void MemoryCache::Clear(bool clear_invalid_ranges) {
   if (clear_invalid_ranges)
     m_invalid_ranges.Clear();
   m_L2_cache_line_byte_size = m_process.GetMemoryCacheLineSize();
+  m_next_sequential_line_addr = LLDB_INVALID_ADDRESS;
+  m_prefetch_line_count = 1;
 }
 
 void MemoryCache::AddL1CacheData(lldb::addr_t addr, const void *src,
@@ -224,17 +227,8 @@ size_t MemoryCache::Read(addr_t addr, void *dst, size_t dst_len,
 
       if (bytes_left > 0) {
         assert((curr_addr % cache_line_byte_size) == 0);
-        std::unique_ptr<DataBufferHeap> data_buffer_heap_up(
-            new DataBufferHeap(cache_line_byte_size, 0));
-        size_t process_bytes_read = m_process.ReadMemoryFromInferior(
-            curr_addr, data_buffer_heap_up->GetBytes(),
-            data_buffer_heap_up->GetByteSize(), error);
-        if (process_bytes_read == 0)
+        if (!ReadLinesFromProcess(curr_addr, error))
           return dst_len - bytes_left;
-
-        if (process_bytes_read != cache_line_byte_size)
-          data_buffer_heap_up->SetByteSize(process_bytes_read);
-        m_L2_cache[curr_addr] = DataBufferSP(data_buffer_heap_up.release());
         // We have read data and put it into the cache, continue through the
         // loop again to get the data out of the cache...
       }
@@ -244,6 +238,66 @@ size_t MemoryCache::Read(addr_t addr, void *dst, size_t dst_len,
   return dst_len - bytes_left;
 }
 
+bool MemoryCache::ReadLinesFromProcess(addr_t line_addr, Status &error) {
+  const uint32_t cache_line_byte_size = m_L2_cache_line_byte_size;
+
+  // Double the number of lines that are read at once while memory is read
+  // sequentially, so that scanning a large object takes few round trips to
+  // the process, but scattered reads don't read more than they need.
+  if (line_addr == m_next_sequential_line_addr) {
+    const uint64_t max_lines =
+        std::max<uint64_t>(1, m_process.GetMemoryCacheMaxPrefetchLines());
+    m_prefetch_line_count =
+        std::min<uint64_t>(max_lines, uint64_t(m_prefetch_line_count) * 2);
+  } else {
+    m_prefetch_line_count = 1;
+  }
+
+  // Lines that are already cached are skipped, which may split the lines to
+  // read into several ranges. Reading stops at the first invalid range.
+  std::vector<Process::MemoryRange> ranges;
+  ranges.emplace_back(line_addr, cache_line_byte_size);
+  addr_t curr_addr = line_addr + cache_line_byte_size;
+  for (uint32_t i = 1; i < m_prefetch_line_count;
+       ++i, curr_addr += cache_line_byte_size) {
+    if (m_invalid_ranges.FindEntryThatContains(curr_addr))
+      break;
+    if (m_L2_cache.count(curr_addr))
+      continue;
+    Process::MemoryRange &last = ranges.back();
+    if (last.GetRangeEnd() == curr_addr)
+      last.SetByteSize(last.GetByteSize() + cache_line_byte_size);
+    else
+      ranges.emplace_back(curr_addr, cache_line_byte_size);
+  }
+  m_next_sequential_line_addr = curr_addr;
+
+  size_t total_size = 0;
+  for (const Process::MemoryRange &range : ranges)
+    total_size += range.GetByteSize();
+  std::vector<uint8_t> buffer(total_size);
+  std::vector<size_t> bytes_read =
+      m_process.ReadMemoryRangesFromInferior(ranges, buffer.data(), error);
+  if (bytes_read.empty() || bytes_read.front() == 0)
+    return false;
+  error.Clear();
+
+  // Split what was read into cache lines. A line that was only partially
+  // read is cached too, and ends the reads that run into it.
+  const uint8_t *range_bytes = buffer.data();
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    for (size_t offset = 0; offset < bytes_read[i];
+         offset += cache_line_byte_size) {
+      const size_t line_size =
+          std::min<size_t>(cache_line_byte_size, bytes_read[i] - offset);
+      m_L2_cache[ranges[i].GetRangeBase() + offset] = DataBufferSP(
+          new DataBufferHeap(range_bytes + offset, line_size));
+    }
+    range_bytes += ranges[i].GetByteSize();
+  }
+  return true;
+}
+
 AllocatedBlock::AllocatedBlock(lldb::addr_t addr, uint32_t byte_size,
                                uint32_t permissions, uint32_t chunk_size)
     : m_range(addr, byte_size), m_permissions(permissions),
@@ -146,7 +146,12 @@ static constexpr PropertyDefinition g_properties[] = {
      "If true, stop when a shared library is loaded or unloaded."},
     {"utility-expression-timeout", OptionValue::eTypeUInt64, false, 15,
      nullptr, {},
-     "The time in seconds to wait for LLDB-internal utility expressions."}
+     "The time in seconds to wait for LLDB-internal utility expressions."},
+    {"memory-cache-max-prefetch-lines", OptionValue::eTypeUInt64, false, 16,
+     nullptr, {},
+     "The maximum number of memory cache lines that are read at once when "
+     "memory is read sequentially. The number of lines that are read doubles "
+     "with each sequential cache miss, up to this limit."}
 };
 
 enum {
@@ -161,6 +166,7 @@ enum {
   ePropertyWarningOptimization,
   ePropertyStopOnExec,
   ePropertyUtilityExpressionTimeout,
+  ePropertyMemCacheMaxPrefetchLines,
 };
 
 ProcessProperties::ProcessProperties(lldb_private::Process *process)
@@ -205,6 +211,12 @@ uint64_t ProcessProperties::GetMemoryCacheLineSize() const {
       nullptr, idx, g_properties[idx].default_uint_value);
 }
 
+uint64_t ProcessProperties::GetMemoryCacheMaxPrefetchLines() const {
+  const uint32_t idx = ePropertyMemCacheMaxPrefetchLines;
+  return m_collection_sp->GetPropertyAtIndexAsUInt64(
+      nullptr, idx, g_properties[idx].default_uint_value);
+}
+
 Args ProcessProperties::GetExtraStartupCommands() const {
   Args args;
   const uint32_t idx = ePropertyExtraStartCommand;
@@ -2165,6 +2177,46 @@ size_t Process::ReadMemoryFromInferior(addr_t addr, void *buf, size_t size,
   return bytes_read;
 }
 
+std::vector<size_t>
+Process::DoReadMemoryRanges(llvm::ArrayRef<MemoryRange> ranges, uint8_t *buf,
+                            Status &error) {
+  std::vector<size_t> bytes_read;
+  bytes_read.reserve(ranges.size());
+  for (const MemoryRange &range : ranges) {
+    Status range_error;
+    size_t range_bytes_read = 0;
+    while (range_bytes_read < range.GetByteSize()) {
+      const size_t curr_size = range.GetByteSize() - range_bytes_read;
+      const size_t curr_bytes_read =
+          DoReadMemory(range.GetRangeBase() + range_bytes_read,
+                       buf + range_bytes_read, curr_size, range_error);
+      range_bytes_read += curr_bytes_read;
+      if (curr_bytes_read == curr_size || curr_bytes_read == 0)
+        break;
+    }
+    if (bytes_read.empty())
+      error = range_error;
+    bytes_read.push_back(range_bytes_read);
+    buf += range.GetByteSize();
+  }
+  return bytes_read;
+}
+
+std::vector<size_t>
+Process::ReadMemoryRangesFromInferior(llvm::ArrayRef<MemoryRange> ranges,
+                                      uint8_t *buf, Status &error) {
+  if (ranges.empty())
+    return {};
+  std::vector<size_t> bytes_read = DoReadMemoryRanges(ranges, buf, error);
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    if (bytes_read[i] > 0)
+      RemoveBreakpointOpcodesFromBuffer(ranges[i].GetRangeBase(),
+                                        bytes_read[i], buf);
+    buf += ranges[i].GetByteSize();
+  }
+  return bytes_read;
+}
+
 uint64_t Process::ReadUnsignedIntegerFromMemory(lldb::addr_t vm_addr,
                                                 size_t integer_byte_size,
                                                 uint64_t fail_value,
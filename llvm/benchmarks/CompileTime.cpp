@@ -0,0 +1,406 @@
+//===- CompileTime.cpp - Compile time benchmarks for passes ---------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Times individual passes over a corpus of IR files, so that a compile time
+// regression can be pinned on a pass rather than on a whole build.
+//
+// Every .ll and .bc file in the corpus directory gets one benchmark per pass,
+// named <pass>/<file>. The files should be in the state the pass sees them in
+// a real pipeline, e.g. captured with -print-before. Mid-level passes are run
+// on their own with the new pass manager. Instruction selection and register
+// allocation can only run inside the code generator pipeline, so for them
+// the whole pipeline runs and the time of just that pass is reported, taken
+// from the -time-passes timers; the codegen/<file> benchmark reports the time
+// of the whole pipeline.
+//
+// On Linux the benchmarks also report the peak resident set size of the
+// process in the "peak_rss" counter and, except for isel and regalloc-greedy,
+// the instructions retired by one iteration in the "instructions" counter.
+//
+// Usage:
+//   CompileTime [--corpus=<dir>] [benchmark options]
+//
+// To compare against a baseline, write both runs with
+//   --benchmark_out=<file> --benchmark_out_format=json
+// and pass the two files to compare-compile-time.py next to this file.
+//
+//===----------------------------------------------------------------------===//
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/TargetLibraryInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/Timer.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace llvm;
+
+#ifndef LLVM_COMPILE_TIME_CORPUS
+#define LLVM_COMPILE_TIME_CORPUS "."
+#endif
+
+namespace {
+
+/// Counts the user space instructions retired by this thread. Counting is
+/// silently disabled if the kernel does not allow it.
+class InstructionCounter {
+#ifdef __linux__
+  int FD = -1;
+
+public:
+  InstructionCounter() {
+    perf_event_attr Attr;
+    memset(&Attr, 0, sizeof(Attr));
+    Attr.size = sizeof(Attr);
+    Attr.type = PERF_TYPE_HARDWARE;
+    Attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    Attr.disabled = 1;
+    Attr.exclude_kernel = 1;
+    Attr.exclude_hv = 1;
+    FD = syscall(__NR_perf_event_open, &Attr, 0, -1, -1, 0);
+  }
+  ~InstructionCounter() {
+    if (FD >= 0)
+      close(FD);
+  }
+
+  bool isAvailable() const { return FD >= 0; }
+  void start() {
+    if (FD >= 0)
+      ioctl(FD, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  void stop() {
+    if (FD >= 0)
+      ioctl(FD, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  uint64_t getCount() const {
+    uint64_t Count = 0;
+    if (FD < 0 || read(FD, &Count, sizeof(Count)) != sizeof(Count))
+      return 0;
+    return Count;
+  }
+#else
+public:
+  bool isAvailable() const { return false; }
+  void start() {}
+  void stop() {}
+  uint64_t getCount() const { return 0; }
+#endif
+};
+
+/// Reset the peak resident set size of the process.
+void resetPeakRSS() {
+#ifdef __linux__
+  std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+/// Return the peak resident set size of the process in bytes since the last
+/// resetPeakRSS(), or 0 if it is not known.
+uint64_t getPeakRSS() {
+#ifdef __linux__
+  std::ifstream Status("/proc/self/status");
+  std::string Line;
+  while (std::getline(Status, Line))
+    if (StringRef(Line).startswith("VmHWM:")) {
+      uint64_t KB = 0;
+      StringRef(Line).drop_front(6).trim().consumeInteger(10, KB);
+      return KB * 1024;
+    }
+#endif
+  return 0;
+}
+
+/// Wall time in seconds per pass name of the legacy pass manager timers,
+/// summed over all instances of a pass.
+StringMap<double> getLegacyPassTimes() {
+  std::string JSON;
+  raw_string_ostream OS(JSON);
+  TimerGroup::printAllJSONValues(OS, "");
+  OS.flush();
+
+  StringMap<double> Times;
+  SmallVector<StringRef, 64> Lines;
+  StringRef(JSON).split(Lines, '\n');
+  for (StringRef Line : Lines) {
+    StringRef Key, Value;
+    std::tie(Key, Value) = Line.trim().rsplit(':');
+    Key = Key.trim().trim('"');
+    if (!Key.consume_front("time.pass.") || !Key.consume_back(".wall"))
+      continue;
+    double Seconds;
+    if (!Value.trim().trim(',').getAsDouble(Seconds))
+      Times[Key] += Seconds;
+  }
+  return Times;
+}
+
+/// A file of the corpus, parsed once and cloned for every iteration.
+struct CorpusModule {
+  std::string Name;
+  LLVMContext Context;
+  std::unique_ptr<Module> M;
+  std::unique_ptr<TargetMachine> TM;
+};
+
+std::vector<std::unique_ptr<CorpusModule>> Corpus;
+
+/// Set the counters of a benchmark. \p IC is null if the instructions it
+/// counted are not those of the benchmarked pass.
+void reportCounters(benchmark::State &State, const InstructionCounter *IC) {
+  if (IC && IC->isAvailable())
+    State.counters["instructions"] =
+        double(IC->getCount()) / std::max<size_t>(State.iterations(), 1);
+  if (uint64_t RSS = getPeakRSS())
+    State.counters["peak_rss"] = double(RSS);
+}
+
+/// The mid-level passes, as new pass manager pipelines.
+struct OptPass {
+  const char *Name;
+  const char *Pipeline;
+} OptPasses[] = {
+    {"instcombine", "function(instcombine)"},
+    {"gvn", "function(gvn)"},
+    {"sroa", "function(sroa)"},
+    {"loop-vectorize", "function(loop-vectorize)"},
+};
+
+void runOptPass(benchmark::State &State, CorpusModule &CM, const OptPass &P) {
+  PassBuilder PB(CM.TM.get());
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  ModulePassManager MPM;
+  if (Error E = PB.parsePassPipeline(MPM, P.Pipeline)) {
+    State.SkipWithError(toString(std::move(E)).c_str());
+    return;
+  }
+
+  InstructionCounter IC;
+  resetPeakRSS();
+  for (auto _ : State) {
+    State.PauseTiming();
+    std::unique_ptr<Module> M = CloneModule(*CM.M);
+    State.ResumeTiming();
+
+    IC.start();
+    MPM.run(*M, MAM);
+    IC.stop();
+
+    // Analysis results refer to the module, drop them before it goes away.
+    State.PauseTiming();
+    MAM.clear();
+    M.reset();
+    State.ResumeTiming();
+  }
+  reportCounters(State, &IC);
+}
+
+/// The code generator passes and how to recognize their timers. Each target
+/// has its own SelectionDAG instruction selector pass.
+struct CodeGenPass {
+  const char *Name;
+  bool (*Matches)(StringRef TimerName);
+} CodeGenPasses[] = {
+    {"isel",
+     [](StringRef N) { return N.endswith("Instruction Selection"); }},
+    {"regalloc-greedy", [](StringRef N) { return N == "greedy"; }},
+};
+
+/// Run the code generator pipeline of \p TM over \p M. Return true on
+/// success.
+bool runCodeGen(Module &M, TargetMachine &TM, InstructionCounter &IC) {
+  SmallVector<char, 0> Buffer;
+  raw_svector_ostream OS(Buffer);
+
+  legacy::PassManager PM;
+  TargetLibraryInfoImpl TLII(Triple(M.getTargetTriple()));
+  PM.add(new TargetLibraryInfoWrapperPass(TLII));
+  if (TM.addPassesToEmitFile(PM, OS, nullptr, TargetMachine::CGFT_ObjectFile))
+    return false;
+  IC.start();
+  PM.run(M);
+  IC.stop();
+  return true;
+}
+
+/// Time the whole code generator pipeline, or just the pass \p P if it is
+/// not null.
+void runCodeGenPass(benchmark::State &State, CorpusModule &CM,
+                    const CodeGenPass *P) {
+  InstructionCounter IC;
+  resetPeakRSS();
+  for (auto _ : State) {
+    State.PauseTiming();
+    std::unique_ptr<Module> M = CloneModule(*CM.M);
+    // Drop what the previous iteration measured.
+    reportAndResetTimings(&nulls());
+    State.ResumeTiming();
+
+    if (!runCodeGen(*M, *CM.TM, IC)) {
+      State.SkipWithError("target cannot emit object files");
+      return;
+    }
+    if (!P)
+      continue;
+
+    double Seconds = 0;
+    for (const auto &T : getLegacyPassTimes())
+      if (P->Matches(T.getKey()))
+        Seconds += T.getValue();
+    State.SetIterationTime(Seconds);
+  }
+  reportCounters(State, P ? nullptr : &IC);
+}
+
+/// Parse every IR file in \p Dir into the corpus.
+bool loadCorpus(StringRef Dir) {
+  std::error_code EC;
+  std::vector<std::string> Paths;
+  for (sys::fs::directory_iterator I(Dir, EC), E; I != E && !EC;
+       I.increment(EC)) {
+    StringRef Ext = sys::path::extension(I->path());
+    if (Ext == ".ll" || Ext == ".bc")
+      Paths.push_back(I->path());
+  }
+  if (EC) {
+    errs() << "error: cannot read corpus " << Dir << ": " << EC.message()
+           << "\n";
+    return false;
+  }
+  std::sort(Paths.begin(), Paths.end());
+
+  for (const std::string &Path : Paths) {
+    auto CM = llvm::make_unique<CorpusModule>();
+    CM->Name = sys::path::stem(Path);
+    SMDiagnostic Err;
+    CM->M = parseIRFile(Path, Err, CM->Context);
+    if (!CM->M) {
+      Err.print("CompileTime", errs());
+      return false;
+    }
+
+    Triple TheTriple(CM->M->getTargetTriple());
+    if (TheTriple.getTriple().empty())
+      TheTriple.setTriple(sys::getDefaultTargetTriple());
+    std::string Error;
+    const Target *TheTarget =
+        TargetRegistry::lookupTarget("", TheTriple, Error);
+    if (!TheTarget) {
+      errs() << "error: " << Path << ": " << Error << "\n";
+      return false;
+    }
+    CM->TM.reset(TheTarget->createTargetMachine(
+        TheTriple.getTriple(), "", "", TargetOptions(), None, None,
+        CodeGenOpt::Default));
+    CM->M->setTargetTriple(TheTriple.getTriple());
+    CM->M->setDataLayout(CM->TM->createDataLayout());
+    Corpus.push_back(std::move(CM));
+  }
+  if (Corpus.empty())
+    errs() << "warning: no .ll or .bc files in " << Dir << "\n";
+  return true;
+}
+
+void registerBenchmarks() {
+  for (auto &CM : Corpus) {
+    CorpusModule *M = CM.get();
+    for (const OptPass &P : OptPasses)
+      benchmark::RegisterBenchmark(
+          (std::string(P.Name) + "/" + M->Name).c_str(),
+          [M, &P](benchmark::State &State) { runOptPass(State, *M, P); })
+          ->Unit(benchmark::kMicrosecond);
+    benchmark::RegisterBenchmark(
+        ("codegen/" + M->Name).c_str(),
+        [M](benchmark::State &State) { runCodeGenPass(State, *M, nullptr); })
+        ->Unit(benchmark::kMicrosecond);
+    for (const CodeGenPass &P : CodeGenPasses)
+      benchmark::RegisterBenchmark(
+          (std::string(P.Name) + "/" + M->Name).c_str(),
+          [M, &P](benchmark::State &State) { runCodeGenPass(State, *M, &P); })
+          ->Unit(benchmark::kMicrosecond)
+          ->UseManualTime();
+  }
+}
+
+} // end anonymous namespace
+
+int main(int argc, char **argv) {
+  // Take our own option out before the benchmark library sees it.
+  std::string CorpusDir = LLVM_COMPILE_TIME_CORPUS;
+  int NewArgc = 1;
+  for (int I = 1; I < argc; ++I) {
+    StringRef Arg = argv[I];
+    if (Arg.consume_front("--corpus="))
+      CorpusDir = Arg;
+    else
+      argv[NewArgc++] = argv[I];
+  }
+  argc = NewArgc;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  InitializeAllTargets();
+  InitializeAllTargetMCs();
+  InitializeAllAsmPrinters();
+  PassRegistry &Registry = *PassRegistry::getPassRegistry();
+  initializeCore(Registry);
+  initializeCodeGen(Registry);
+  initializeScalarOpts(Registry);
+  initializeVectorization(Registry);
+
+  // The code generator benchmarks read the legacy pass manager timers.
+  TimePassesIsEnabled = true;
+
+  if (!loadCorpus(CorpusDir))
+    return 1;
+  registerBenchmarks();
+  benchmark::RunSpecifiedBenchmarks();
+
+  // Nothing is left to report, keep the timers from printing at exit.
+  reportAndResetTimings(&nulls());
+  return 0;
+}
@@ -0,0 +1,110 @@
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/FlatHashMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/Allocator.h"
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+// Compare FlatHashMap and DenseMap on the key types that dominate in the
+// compiler: pointers to IR objects, dense numeric IDs and symbol names.
+
+namespace {
+
+struct Object {
+  char Payload[24];
+};
+
+// Pointers handed out by a bump allocator, standing in for Value* and
+// friends. Keys [N, 2N) are never inserted and are used for misses.
+std::vector<const Object *> getPointerKeys(size_t N) {
+  static BumpPtrAllocator Alloc;
+  std::vector<const Object *> Keys;
+  for (size_t I = 0; I != 2 * N; ++I)
+    Keys.push_back(new (Alloc.Allocate<Object>()) Object());
+  return Keys;
+}
+
+std::vector<unsigned> getIDKeys(size_t N) {
+  std::vector<unsigned> Keys;
+  for (size_t I = 0; I != 2 * N; ++I)
+    Keys.push_back(I);
+  return Keys;
+}
+
+std::vector<StringRef> getSymbolKeys(size_t N) {
+  static std::vector<std::string> Names;
+  Names.clear();
+  for (size_t I = 0; I != 2 * N; ++I)
+    Names.push_back("_ZN4llvm6detail" + std::to_string(I * 7919) + "Ev");
+  return std::vector<StringRef>(Names.begin(), Names.end());
+}
+
+template <typename KeyT> std::vector<KeyT> getKeys(size_t N);
+template <> std::vector<const Object *> getKeys(size_t N) {
+  return getPointerKeys(N);
+}
+template <> std::vector<unsigned> getKeys(size_t N) { return getIDKeys(N); }
+template <> std::vector<StringRef> getKeys(size_t N) {
+  return getSymbolKeys(N);
+}
+
+template <typename MapT> void BM_Insert(benchmark::State &State) {
+  size_t N = State.range(0);
+  auto Keys = getKeys<typename MapT::key_type>(N);
+  for (auto _ : State) {
+    MapT Map;
+    for (size_t I = 0; I != N; ++I)
+      Map[Keys[I]] = I;
+    benchmark::DoNotOptimize(Map);
+  }
+  State.SetItemsProcessed(State.iterations() * N);
+}
+
+template <typename MapT> void BM_LookupHit(benchmark::State &State) {
+  size_t N = State.range(0);
+  auto Keys = getKeys<typename MapT::key_type>(N);
+  MapT Map;
+  for (size_t I = 0; I != N; ++I)
+    Map[Keys[I]] = I;
+  for (auto _ : State)
+    for (size_t I = 0; I != N; ++I)
+      benchmark::DoNotOptimize(Map.find(Keys[I]));
+  State.SetItemsProcessed(State.iterations() * N);
+}
+
+template <typename MapT> void BM_LookupMiss(benchmark::State &State) {
+  size_t N = State.range(0);
+  auto Keys = getKeys<typename MapT::key_type>(N);
+  MapT Map;
+  for (size_t I = 0; I != N; ++I)
+    Map[Keys[I]] = I;
+  for (auto _ : State)
+    for (size_t I = N; I != 2 * N; ++I)
+      benchmark::DoNotOptimize(Map.find(Keys[I]));
+  State.SetItemsProcessed(State.iterations() * N);
+}
+
+} // end anonymous namespace
+
+#define MAP_BENCHMARKS(KeyT)                                                   \
+  BENCHMARK_TEMPLATE(BM_Insert, DenseMap<KeyT, unsigned>)                      \
+      ->Range(64, 1 << 18);                                                    \
+  BENCHMARK_TEMPLATE(BM_Insert, FlatHashMap<KeyT, unsigned>)                   \
+      ->Range(64, 1 << 18);                                                    \
+  BENCHMARK_TEMPLATE(BM_LookupHit, DenseMap<KeyT, unsigned>)                   \
+      ->Range(64, 1 << 18);                                                    \
+  BENCHMARK_TEMPLATE(BM_LookupHit, FlatHashMap<KeyT, unsigned>)                \
+      ->Range(64, 1 << 18);                                                    \
+  BENCHMARK_TEMPLATE(BM_LookupMiss, DenseMap<KeyT, unsigned>)                  \
+      ->Range(64, 1 << 18);                                                    \
+  BENCHMARK_TEMPLATE(BM_LookupMiss, FlatHashMap<KeyT, unsigned>)               \
+      ->Range(64, 1 << 18);
+
+MAP_BENCHMARKS(const Object *)
+MAP_BENCHMARKS(unsigned)
+MAP_BENCHMARKS(StringRef)
+
+BENCHMARK_MAIN();
@@ -0,0 +1,72 @@
+; Allocas and redundant memory operations as left by the front end, for SROA
+; and GVN.
+
+%struct.point = type { i32, i32, double }
+
+declare void @use(%struct.point*)
+declare i32 @compute(i32)
+
+define double @build(i32 %x, i32 %y, double %w) {
+entry:
+  %p = alloca %struct.point, align 8
+  %q = alloca %struct.point, align 8
+  %px = getelementptr inbounds %struct.point, %struct.point* %p, i32 0, i32 0
+  store i32 %x, i32* %px, align 8
+  %py = getelementptr inbounds %struct.point, %struct.point* %p, i32 0, i32 1
+  store i32 %y, i32* %py, align 4
+  %pw = getelementptr inbounds %struct.point, %struct.point* %p, i32 0, i32 2
+  store double %w, double* %pw, align 8
+  %src = bitcast %struct.point* %p to i8*
+  %dst = bitcast %struct.point* %q to i8*
+  call void @llvm.memcpy.p0i8.p0i8.i64(i8* align 8 %dst, i8* align 8 %src,
+                                       i64 16, i1 false)
+  %qx = getelementptr inbounds %struct.point, %struct.point* %q, i32 0, i32 0
+  %vx = load i32, i32* %qx, align 8
+  %qy = getelementptr inbounds %struct.point, %struct.point* %q, i32 0, i32 1
+  %vy = load i32, i32* %qy, align 4
+  %sum = add nsw i32 %vx, %vy
+  %conv = sitofp i32 %sum to double
+  %qw = getelementptr inbounds %struct.point, %struct.point* %q, i32 0, i32 2
+  %vw = load double, double* %qw, align 8
+  %r = fmul double %conv, %vw
+  ret double %r
+}
+
+define i32 @redundant(i32* %a, i32* %b, i1 %c) {
+entry:
+  %v0 = load i32, i32* %a, align 4
+  br i1 %c, label %then, label %else
+
+then:
+  %v1 = load i32, i32* %a, align 4
+  %t = add i32 %v0, %v1
+  store i32 %t, i32* %b, align 4
+  br label %join
+
+else:
+  %e = call i32 @compute(i32 %v0)
+  br label %join
+
+join:
+  %phi = phi i32 [ %t, %then ], [ %e, %else ]
+  %v2 = load i32, i32* %a, align 4
+  %m1 = mul i32 %v2, %phi
+  %m2 = mul i32 %v2, %phi
+  %r = add i32 %m1, %m2
+  ret i32 %r
+}
+
+define i32 @escapes(i32 %n) {
+entry:
+  %p = alloca %struct.point, align 8
+  call void @use(%struct.point* %p)
+  %px = getelementptr inbounds %struct.point, %struct.point* %p, i32 0, i32 0
+  %v = load i32, i32* %px, align 8
+  %v.again = load i32, i32* %px, align 8
+  %s = add i32 %v, %v.again
+  %r = add i32 %s, %n
+  ret i32 %r
+}
+
+declare void @llvm.memcpy.p0i8.p0i8.i64(i8* nocapture writeonly,
+                                        i8* nocapture readonly, i64, i1)
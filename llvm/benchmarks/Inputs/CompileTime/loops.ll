@@ -0,0 +1,83 @@
+; Loops in loop simplify form, as the loop vectorizer sees them.
+
+define void @saxpy(float* noalias %y, float* noalias %x, float %a, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %px = getelementptr inbounds float, float* %x, i64 %i
+  %vx = load float, float* %px, align 4
+  %py = getelementptr inbounds float, float* %y, i64 %i
+  %vy = load float, float* %py, align 4
+  %mul = fmul float %vx, %a
+  %add = fadd float %mul, %vy
+  store float %add, float* %py, align 4
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit, label %loop
+
+exit:
+  ret void
+}
+
+define i32 @sum(i32* %p, i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %loop, label %exit
+
+loop:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %loop ]
+  %s = phi i32 [ 0, %entry ], [ %s.next, %loop ]
+  %pi = getelementptr inbounds i32, i32* %p, i64 %i
+  %v = load i32, i32* %pi, align 4
+  %s.next = add nsw i32 %s, %v
+  %i.next = add nuw nsw i64 %i, 1
+  %done = icmp eq i64 %i.next, %n
+  br i1 %done, label %exit.loopexit, label %loop
+
+exit.loopexit:
+  %s.lcssa = phi i32 [ %s.next, %loop ]
+  br label %exit
+
+exit:
+  %r = phi i32 [ 0, %entry ], [ %s.lcssa, %exit.loopexit ]
+  ret i32 %r
+}
+
+define void @matmul(double* noalias %c, double* noalias %a, double* noalias %b,
+                    i64 %n) {
+entry:
+  %cmp = icmp sgt i64 %n, 0
+  br i1 %cmp, label %outer, label %exit
+
+outer:
+  %i = phi i64 [ 0, %entry ], [ %i.next, %outer.latch ]
+  %row = mul nsw i64 %i, %n
+  br label %inner
+
+inner:
+  %j = phi i64 [ 0, %outer ], [ %j.next, %inner ]
+  %ij = add nsw i64 %row, %j
+  %pa = getelementptr inbounds double, double* %a, i64 %ij
+  %va = load double, double* %pa, align 8
+  %pb = getelementptr inbounds double, double* %b, i64 %ij
+  %vb = load double, double* %pb, align 8
+  %pc = getelementptr inbounds double, double* %c, i64 %ij
+  %vc = load double, double* %pc, align 8
+  %m = fmul double %va, %vb
+  %s = fadd double %vc, %m
+  store double %s, double* %pc, align 8
+  %j.next = add nuw nsw i64 %j, 1
+  %j.done = icmp eq i64 %j.next, %n
+  br i1 %j.done, label %outer.latch, label %inner
+
+outer.latch:
+  %i.next = add nuw nsw i64 %i, 1
+  %i.done = icmp eq i64 %i.next, %n
+  br i1 %i.done, label %exit, label %outer
+
+exit:
+  ret void
+}
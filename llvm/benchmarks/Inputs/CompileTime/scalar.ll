@@ -0,0 +1,83 @@
+; Scalar code with patterns for InstCombine to fold and enough live values to
+; keep the register allocator busy.
+
+define i32 @fold(i32 %a, i32 %b) {
+entry:
+  %x1 = xor i32 %a, -1
+  %x2 = xor i32 %x1, -1
+  %s = sub i32 %x2, %a
+  %t = add i32 %s, %b
+  %m = mul i32 %t, 8
+  %sh = lshr i32 %m, 3
+  %and = and i32 %sh, 536870911
+  %cmp = icmp ult i32 %and, 0
+  %sel = select i1 %cmp, i32 %a, i32 %and
+  ret i32 %sel
+}
+
+define i64 @pressure(i64* %p) {
+entry:
+  %p1 = getelementptr i64, i64* %p, i64 1
+  %p2 = getelementptr i64, i64* %p, i64 2
+  %p3 = getelementptr i64, i64* %p, i64 3
+  %p4 = getelementptr i64, i64* %p, i64 4
+  %p5 = getelementptr i64, i64* %p, i64 5
+  %p6 = getelementptr i64, i64* %p, i64 6
+  %p7 = getelementptr i64, i64* %p, i64 7
+  %p8 = getelementptr i64, i64* %p, i64 8
+  %p9 = getelementptr i64, i64* %p, i64 9
+  %p10 = getelementptr i64, i64* %p, i64 10
+  %p11 = getelementptr i64, i64* %p, i64 11
+  %p12 = getelementptr i64, i64* %p, i64 12
+  %p13 = getelementptr i64, i64* %p, i64 13
+  %p14 = getelementptr i64, i64* %p, i64 14
+  %p15 = getelementptr i64, i64* %p, i64 15
+  %v0 = load volatile i64, i64* %p
+  %v1 = load volatile i64, i64* %p1
+  %v2 = load volatile i64, i64* %p2
+  %v3 = load volatile i64, i64* %p3
+  %v4 = load volatile i64, i64* %p4
+  %v5 = load volatile i64, i64* %p5
+  %v6 = load volatile i64, i64* %p6
+  %v7 = load volatile i64, i64* %p7
+  %v8 = load volatile i64, i64* %p8
+  %v9 = load volatile i64, i64* %p9
+  %v10 = load volatile i64, i64* %p10
+  %v11 = load volatile i64, i64* %p11
+  %v12 = load volatile i64, i64* %p12
+  %v13 = load volatile i64, i64* %p13
+  %v14 = load volatile i64, i64* %p14
+  %v15 = load volatile i64, i64* %p15
+  %m0 = mul i64 %v0, %v15
+  %m1 = mul i64 %v1, %v14
+  %m2 = mul i64 %v2, %v13
+  %m3 = mul i64 %v3, %v12
+  %m4 = mul i64 %v4, %v11
+  %m5 = mul i64 %v5, %v10
+  %m6 = mul i64 %v6, %v9
+  %m7 = mul i64 %v7, %v8
+  store volatile i64 %m0, i64* %p
+  store volatile i64 %m1, i64* %p1
+  store volatile i64 %m2, i64* %p2
+  store volatile i64 %m3, i64* %p3
+  store volatile i64 %m4, i64* %p4
+  store volatile i64 %m5, i64* %p5
+  store volatile i64 %m6, i64* %p6
+  store volatile i64 %m7, i64* %p7
+  %a0 = add i64 %v0, %v1
+  %a1 = add i64 %a0, %v2
+  %a2 = add i64 %a1, %v3
+  %a3 = add i64 %a2, %v4
+  %a4 = add i64 %a3, %v5
+  %a5 = add i64 %a4, %v6
+  %a6 = add i64 %a5, %v7
+  %a7 = add i64 %a6, %v8
+  %a8 = add i64 %a7, %v9
+  %a9 = add i64 %a8, %v10
+  %a10 = add i64 %a9, %v11
+  %a11 = add i64 %a10, %v12
+  %a12 = add i64 %a11, %v13
+  %a13 = add i64 %a12, %v14
+  %a14 = add i64 %a13, %v15
+  ret i64 %a14
+}
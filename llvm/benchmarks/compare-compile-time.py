@@ -0,0 +1,97 @@
+#!/usr/bin/env python
+#
+#===- compare-compile-time.py - Compare CompileTime benchmark runs ---------===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+#
+# Compare two runs of the CompileTime benchmark written with
+#   --benchmark_out=<file> --benchmark_out_format=json
+# and print the relative change of the time and of each counter, worst first.
+# With --threshold the script exits with 1 if anything got slower by more than
+# the given percentage, so that it can gate a nightly build.
+#
+#===------------------------------------------------------------------------===#
+
+from __future__ import print_function
+
+import argparse
+import json
+import sys
+
+# Fields of a benchmark entry that are not measurements.
+NON_METRICS = set(['name', 'run_name', 'run_type', 'iterations', 'time_unit',
+                   'cpu_time', 'label', 'error_occurred', 'error_message',
+                   'repetitions', 'repetition_index', 'threads',
+                   'aggregate_name', 'family_index',
+                   'per_family_instance_index'])
+
+
+def load(path):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    for b in data.get('benchmarks', []):
+        if b.get('error_occurred') or b.get('run_type') == 'aggregate':
+            continue
+        results[b['name']] = b
+    return results
+
+
+def metrics(b):
+    for key, value in b.items():
+        if key not in NON_METRICS and isinstance(value, (int, float)):
+            yield key, float(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Compare two runs of the CompileTime benchmark.')
+    parser.add_argument('baseline', help='JSON output of the baseline run')
+    parser.add_argument('current', help='JSON output of the run to check')
+    parser.add_argument('--metric', action='append',
+                        help='only compare this metric (real_time, '
+                        'instructions, peak_rss, ...), may be repeated')
+    parser.add_argument('--threshold', type=float,
+                        help='fail if a metric grew by more than this many '
+                        'percent')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    rows = []
+    for name in sorted(set(baseline) & set(current)):
+        old = dict(metrics(baseline[name]))
+        for metric, new_value in metrics(current[name]):
+            if args.metric and metric not in args.metric:
+                continue
+            old_value = old.get(metric)
+            if not old_value:
+                continue
+            change = (new_value - old_value) / old_value * 100
+            rows.append((change, name, metric, old_value, new_value))
+
+    rows.sort(reverse=True)
+    print('%-48s %-14s %14s %14s %8s' % ('benchmark', 'metric', 'baseline',
+                                         'current', 'change'))
+    for change, name, metric, old_value, new_value in rows:
+        print('%-48s %-14s %14.6g %14.6g %+7.2f%%' % (name, metric, old_value,
+                                                      new_value, change))
+
+    for name in sorted(set(baseline) - set(current)):
+        print('only in baseline: %s' % name)
+    for name in sorted(set(current) - set(baseline)):
+        print('only in current: %s' % name)
+
+    if args.threshold is not None and any(row[0] > args.threshold
+                                          for row in rows):
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
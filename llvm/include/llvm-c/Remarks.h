@@ -30,7 +30,7 @@ extern "C" {
  * @{
  */
 
-#define REMARKS_API_VERSION 0
+#define REMARKS_API_VERSION 1
 
 /**
  * The type of the emitted remark.
@@ -229,6 +229,23 @@ typedef struct LLVMRemarkOpaqueParser *LLVMRemarkParserRef;
 extern LLVMRemarkParserRef LLVMRemarkParserCreateYAML(const void *Buf,
                                                       uint64_t Size);
 
+/**
+ * Creates a remark parser that can be used to parse the bitstream remark
+ * container located in \p Buf of size \p Size bytes.
+ *
+ * \p Buf cannot be `NULL`.
+ *
+ * The strings of the parsed remarks point into \p Buf, which has to outlive
+ * the parser.
+ *
+ * This function should be paired with LLVMRemarkParserDispose() to avoid
+ * leaking resources.
+ *
+ * \since REMARKS_API_VERSION=1
+ */
+extern LLVMRemarkParserRef LLVMRemarkParserCreateBitstream(const void *Buf,
+                                                           uint64_t Size);
+
 /**
  * Returns the next remark in the file.
  *
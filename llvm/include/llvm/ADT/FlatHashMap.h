@@ -0,0 +1,615 @@
+//===- llvm/ADT/FlatHashMap.h - Swiss table style hash map ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the FlatHashMap class, an open addressing hash map in the
+// style of the "Swiss tables" of Abseil.
+//
+// Next to the array of buckets the map keeps one control byte per bucket. A
+// control byte says whether the bucket is empty, erased, or full, and for full
+// buckets holds 7 bits of the hash of the key. Lookups compare the control
+// bytes of a group of 16 buckets at once, with SSE2 when it is available, and
+// only touch the buckets whose control byte matches. Most lookups therefore
+// read one cache line of control bytes and at most one bucket, however large
+// the keys are, and misses rarely read a bucket at all.
+//
+// The interface follows DenseMap, and KeyInfoT is a DenseMapInfo-like traits
+// class, so FlatHashMap can replace a DenseMap without changes to its users.
+// Only getHashValue and isEqual are used: keys equal to the empty or tombstone
+// key of DenseMapInfo can be inserted.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_ADT_FLATHASHMAP_H
+#define LLVM_ADT_FLATHASHMAP_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/EpochTracker.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/MemAlloc.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LLVM_FLATHASHMAP_SSE2 1
+#endif
+
+namespace llvm {
+
+namespace detail {
+
+/// Control byte values for buckets which are not full. Full buckets have the
+/// top bit clear and hold 7 bits of the hash of their key.
+enum : int8_t { FlatCtrlEmpty = -128, FlatCtrlDeleted = -2 };
+
+/// The buckets of a FlatGroup matching some condition, one bit per bucket.
+class FlatGroupMask {
+  uint32_t Mask;
+
+public:
+  explicit FlatGroupMask(uint32_t Mask) : Mask(Mask) {}
+
+  explicit operator bool() const { return Mask != 0; }
+
+  /// The position of the first matching bucket in the group.
+  unsigned lowest() const { return countTrailingZeros(Mask); }
+
+  void clearLowest() { Mask &= Mask - 1; }
+};
+
+/// The control bytes of a group of buckets, probed together.
+class FlatGroup {
+public:
+  enum : unsigned { Width = 16 };
+
+#ifdef LLVM_FLATHASHMAP_SSE2
+  explicit FlatGroup(const int8_t *Pos)
+      : Ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(Pos))) {}
+
+  FlatGroupMask match(int8_t H2) const {
+    return FlatGroupMask(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(H2), Ctrl)));
+  }
+
+  FlatGroupMask matchEmpty() const { return match(FlatCtrlEmpty); }
+
+  FlatGroupMask matchEmptyOrDeleted() const {
+    // Only these have the top bit set.
+    return FlatGroupMask(_mm_movemask_epi8(Ctrl));
+  }
+
+private:
+  __m128i Ctrl;
+#else
+  explicit FlatGroup(const int8_t *Pos) { memcpy(Ctrl, Pos, Width); }
+
+  FlatGroupMask match(int8_t H2) const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I < Width; ++I)
+      Mask |= uint32_t(Ctrl[I] == H2) << I;
+    return FlatGroupMask(Mask);
+  }
+
+  FlatGroupMask matchEmpty() const { return match(FlatCtrlEmpty); }
+
+  FlatGroupMask matchEmptyOrDeleted() const {
+    uint32_t Mask = 0;
+    for (unsigned I = 0; I < Width; ++I)
+      Mask |= uint32_t(Ctrl[I] < 0) << I;
+    return FlatGroupMask(Mask);
+  }
+
+private:
+  int8_t Ctrl[Width];
+#endif
+};
+
+} // end namespace detail
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, bool IsConst>
+class FlatHashMapIterator;
+
+template <typename KeyT, typename ValueT,
+          typename KeyInfoT = DenseMapInfo<KeyT>>
+class FlatHashMap : public DebugEpochBase {
+  template <typename T>
+  using const_arg_type_t = typename const_pointer_or_const_ref<T>::type;
+
+  using GroupT = detail::FlatGroup;
+
+public:
+  using size_type = unsigned;
+  using key_type = KeyT;
+  using mapped_type = ValueT;
+  using value_type = llvm::detail::DenseMapPair<KeyT, ValueT>;
+
+  using iterator = FlatHashMapIterator<KeyT, ValueT, KeyInfoT, false>;
+  using const_iterator = FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+
+  explicit FlatHashMap(unsigned InitialReserve = 0) {
+    if (InitialReserve)
+      reserve(InitialReserve);
+  }
+
+  FlatHashMap(const FlatHashMap &Other) { copyFrom(Other); }
+
+  FlatHashMap(FlatHashMap &&Other) { swap(Other); }
+
+  template <typename InputIt> FlatHashMap(const InputIt &I, const InputIt &E) {
+    reserve(std::distance(I, E));
+    insert(I, E);
+  }
+
+  FlatHashMap(std::initializer_list<value_type> Vals) {
+    reserve(Vals.size());
+    insert(Vals.begin(), Vals.end());
+  }
+
+  ~FlatHashMap() {
+    destroyAll();
+    deallocateBuckets();
+  }
+
+  FlatHashMap &operator=(const FlatHashMap &Other) {
+    if (&Other != this) {
+      destroyAll();
+      deallocateBuckets();
+      copyFrom(Other);
+    }
+    return *this;
+  }
+
+  FlatHashMap &operator=(FlatHashMap &&Other) {
+    destroyAll();
+    deallocateBuckets();
+    Ctrl = nullptr;
+    Buckets = nullptr;
+    NumBuckets = NumEntries = NumTombstones = 0;
+    swap(Other);
+    return *this;
+  }
+
+  void swap(FlatHashMap &RHS) {
+    this->incrementEpoch();
+    RHS.incrementEpoch();
+    std::swap(Ctrl, RHS.Ctrl);
+    std::swap(Buckets, RHS.Buckets);
+    std::swap(NumBuckets, RHS.NumBuckets);
+    std::swap(NumEntries, RHS.NumEntries);
+    std::swap(NumTombstones, RHS.NumTombstones);
+  }
+
+  iterator begin() { return makeIterator(0); }
+  iterator end() { return makeIterator(NumBuckets); }
+  const_iterator begin() const { return makeConstIterator(0); }
+  const_iterator end() const { return makeConstIterator(NumBuckets); }
+
+  LLVM_NODISCARD bool empty() const { return NumEntries == 0; }
+  unsigned size() const { return NumEntries; }
+
+  /// Grow the map so that it can hold at least \p NumEntries entries without
+  /// rehashing.
+  void reserve(size_type NumEntries) {
+    unsigned NewNumBuckets = getMinBucketToReserveForEntries(NumEntries);
+    incrementEpoch();
+    if (NewNumBuckets > NumBuckets)
+      rehash(NewNumBuckets);
+  }
+
+  void clear() {
+    incrementEpoch();
+    if (NumEntries == 0 && NumTombstones == 0)
+      return;
+    destroyAll();
+    memset(Ctrl, detail::FlatCtrlEmpty, NumBuckets + GroupT::Width);
+    NumEntries = 0;
+    NumTombstones = 0;
+  }
+
+  /// Return 1 if the specified key is in the map, 0 otherwise.
+  size_type count(const_arg_type_t<KeyT> Val) const {
+    return findBucket(Val, getHash(Val)) != NumBuckets ? 1 : 0;
+  }
+
+  iterator find(const_arg_type_t<KeyT> Val) {
+    return makeIterator(findBucket(Val, getHash(Val)));
+  }
+  const_iterator find(const_arg_type_t<KeyT> Val) const {
+    return makeConstIterator(findBucket(Val, getHash(Val)));
+  }
+
+  /// Alternate version of find() which allows a different, and possibly
+  /// less expensive, key type. The DenseMapInfo is responsible for supplying
+  /// methods getHashValue(LookupKeyT) and isEqual(LookupKeyT, KeyT) for each
+  /// key type used.
+  template <class LookupKeyT> iterator find_as(const LookupKeyT &Val) {
+    return makeIterator(findBucket(Val, getHash(Val)));
+  }
+  template <class LookupKeyT>
+  const_iterator find_as(const LookupKeyT &Val) const {
+    return makeConstIterator(findBucket(Val, getHash(Val)));
+  }
+
+  /// Return the entry for the specified key, or a default constructed value
+  /// if no such entry exists.
+  ValueT lookup(const_arg_type_t<KeyT> Val) const {
+    unsigned I = findBucket(Val, getHash(Val));
+    if (I != NumBuckets)
+      return Buckets[I].getSecond();
+    return ValueT();
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(const std::pair<KeyT, ValueT> &KV) {
+    return try_emplace(KV.first, KV.second);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // If the key is already in the map, it returns false and doesn't update the
+  // value.
+  std::pair<iterator, bool> insert(std::pair<KeyT, ValueT> &&KV) {
+    return try_emplace(std::move(KV.first), std::move(KV.second));
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(KeyT &&Key, Ts &&... Args) {
+    return tryEmplaceImpl(std::move(Key), std::forward<Ts>(Args)...);
+  }
+
+  // Inserts key,value pair into the map if the key isn't already in the map.
+  // The value is constructed in-place if the key is not in the map, otherwise
+  // it is not moved.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const KeyT &Key, Ts &&... Args) {
+    return tryEmplaceImpl(Key, std::forward<Ts>(Args)...);
+  }
+
+  /// insert - Range insertion of pairs.
+  template <typename InputIt> void insert(InputIt I, InputIt E) {
+    for (; I != E; ++I)
+      insert(*I);
+  }
+
+  bool erase(const KeyT &Val) {
+    unsigned I = findBucket(Val, getHash(Val));
+    if (I == NumBuckets)
+      return false; // not in map.
+    eraseBucket(I);
+    return true;
+  }
+
+  void erase(iterator I) {
+    assert(I.Ctrl >= Ctrl && I.Ctrl < Ctrl + NumBuckets &&
+           "erasing an iterator of another map");
+    eraseBucket(I.Ctrl - Ctrl);
+  }
+
+  value_type &FindAndConstruct(const KeyT &Key) {
+    return *try_emplace(Key).first;
+  }
+
+  ValueT &operator[](const KeyT &Key) { return FindAndConstruct(Key).second; }
+
+  value_type &FindAndConstruct(KeyT &&Key) {
+    return *try_emplace(std::move(Key)).first;
+  }
+
+  ValueT &operator[](KeyT &&Key) {
+    return FindAndConstruct(std::move(Key)).second;
+  }
+
+  /// Return the approximate size (in bytes) of the actual map.
+  /// This is just the raw memory used by FlatHashMap.
+  /// If entries are pointers to objects, the size of the referenced objects
+  /// are not included.
+  size_t getMemorySize() const {
+    if (!NumBuckets)
+      return 0;
+    return NumBuckets * sizeof(value_type) + NumBuckets + GroupT::Width;
+  }
+
+  unsigned getNumBuckets() const { return NumBuckets; }
+
+private:
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, false>;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+
+  /// One control byte per bucket, followed by a copy of the first
+  /// GroupT::Width control bytes so that a group can be loaded at any bucket.
+  int8_t *Ctrl = nullptr;
+  value_type *Buckets = nullptr;
+  /// Zero or a power of two of at least GroupT::Width.
+  unsigned NumBuckets = 0;
+  unsigned NumEntries = 0;
+  unsigned NumTombstones = 0;
+
+  /// Spread the hash of DenseMapInfo, which may be weak in some bits, over 64
+  /// bits. The top 7 bits go into the control byte and the rest select the
+  /// first group to probe.
+  template <typename LookupKeyT>
+  static uint64_t getHash(const LookupKeyT &Val) {
+    uint64_t H = uint64_t(KeyInfoT::getHashValue(Val)) * 0x9E3779B97F4A7C15ULL;
+    return H ^ (H >> 32);
+  }
+  static int8_t getH2(uint64_t Hash) { return int8_t(Hash >> 57); }
+
+  iterator makeIterator(unsigned I) {
+    return iterator(Ctrl + I, Ctrl + NumBuckets, Buckets + I, *this);
+  }
+  const_iterator makeConstIterator(unsigned I) const {
+    return const_iterator(Ctrl + I, Ctrl + NumBuckets, Buckets + I, *this);
+  }
+
+  void setCtrl(unsigned I, int8_t Value) {
+    Ctrl[I] = Value;
+    if (I < GroupT::Width)
+      Ctrl[NumBuckets + I] = Value;
+  }
+
+  /// Return the bucket holding \p Val, or NumBuckets if there is none.
+  template <typename LookupKeyT>
+  unsigned findBucket(const LookupKeyT &Val, uint64_t Hash) const {
+    if (NumBuckets == 0)
+      return 0;
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = unsigned(Hash) & Mask;
+    int8_t H2 = getH2(Hash);
+    // Triangular probing over groups visits every group once.
+    for (unsigned Step = GroupT::Width;; Pos = (Pos + Step) & Mask,
+                  Step += GroupT::Width) {
+      GroupT G(Ctrl + Pos);
+      for (detail::FlatGroupMask M = G.match(H2); M; M.clearLowest()) {
+        unsigned I = (Pos + M.lowest()) & Mask;
+        if (LLVM_LIKELY(KeyInfoT::isEqual(Val, Buckets[I].getFirst())))
+          return I;
+      }
+      if (G.matchEmpty())
+        return NumBuckets;
+    }
+  }
+
+  /// Return the first empty or erased bucket on the probe sequence of Hash.
+  unsigned findFirstNonFull(uint64_t Hash) const {
+    unsigned Mask = NumBuckets - 1;
+    unsigned Pos = unsigned(Hash) & Mask;
+    for (unsigned Step = GroupT::Width;; Pos = (Pos + Step) & Mask,
+                  Step += GroupT::Width) {
+      detail::FlatGroupMask M = GroupT(Ctrl + Pos).matchEmptyOrDeleted();
+      if (M)
+        return (Pos + M.lowest()) & Mask;
+    }
+  }
+
+  // Keep at least one bucket in eight empty so that probing terminates early.
+  static unsigned getMaxLoad(unsigned NumBuckets) {
+    return NumBuckets - NumBuckets / 8;
+  }
+
+  static unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
+    unsigned NumBuckets = GroupT::Width;
+    while (getMaxLoad(NumBuckets) < NumEntries)
+      NumBuckets *= 2;
+    return NumBuckets;
+  }
+
+  template <typename KeyArg, typename... Ts>
+  std::pair<iterator, bool> tryEmplaceImpl(KeyArg &&Key, Ts &&... Args) {
+    uint64_t Hash = getHash(Key);
+    unsigned I = findBucket(Key, Hash);
+    if (I != NumBuckets)
+      return std::make_pair(makeIterator(I), false); // Already in map.
+
+    I = prepareInsert(Hash);
+    value_type &B = Buckets[I];
+    ::new (&B.getFirst()) KeyT(std::forward<KeyArg>(Key));
+    ::new (&B.getSecond()) ValueT(std::forward<Ts>(Args)...);
+    return std::make_pair(makeIterator(I), true);
+  }
+
+  /// Claim a bucket for a new entry with hash \p Hash, growing the map if
+  /// needed.
+  unsigned prepareInsert(uint64_t Hash) {
+    incrementEpoch();
+    if (NumEntries + NumTombstones + 1 > getMaxLoad(NumBuckets)) {
+      // If half of the map is tombstones, rehashing at the same size is
+      // enough to make room.
+      if (NumBuckets && NumEntries + 1 <= getMaxLoad(NumBuckets) / 2)
+        rehash(NumBuckets);
+      else
+        rehash(NumBuckets ? NumBuckets * 2 : unsigned(GroupT::Width));
+    }
+    unsigned I = findFirstNonFull(Hash);
+    if (Ctrl[I] == detail::FlatCtrlDeleted)
+      --NumTombstones;
+    setCtrl(I, getH2(Hash));
+    ++NumEntries;
+    return I;
+  }
+
+  void eraseBucket(unsigned I) {
+    value_type &B = Buckets[I];
+    B.getSecond().~ValueT();
+    B.getFirst().~KeyT();
+    setCtrl(I, detail::FlatCtrlDeleted);
+    --NumEntries;
+    ++NumTombstones;
+  }
+
+  void allocateBuckets(unsigned Num) {
+    NumBuckets = Num;
+    Ctrl = static_cast<int8_t *>(safe_malloc(Num + GroupT::Width));
+    memset(Ctrl, detail::FlatCtrlEmpty, Num + GroupT::Width);
+    Buckets = static_cast<value_type *>(
+        allocate_buffer(sizeof(value_type) * Num, alignof(value_type)));
+  }
+
+  void deallocateBuckets() {
+    if (!NumBuckets)
+      return;
+    free(Ctrl);
+    deallocate_buffer(Buckets, sizeof(value_type) * NumBuckets,
+                      alignof(value_type));
+  }
+
+  void destroyAll() {
+    if (std::is_trivially_destructible<value_type>::value)
+      return;
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      Buckets[I].getSecond().~ValueT();
+      Buckets[I].getFirst().~KeyT();
+    }
+  }
+
+  void rehash(unsigned NewNumBuckets) {
+    int8_t *OldCtrl = Ctrl;
+    value_type *OldBuckets = Buckets;
+    unsigned OldNumBuckets = NumBuckets;
+    allocateBuckets(NewNumBuckets);
+    NumTombstones = 0;
+    if (!OldNumBuckets)
+      return;
+
+    for (unsigned I = 0; I != OldNumBuckets; ++I) {
+      if (OldCtrl[I] < 0)
+        continue;
+      value_type &Old = OldBuckets[I];
+      uint64_t Hash = getHash(Old.getFirst());
+      unsigned J = findFirstNonFull(Hash);
+      setCtrl(J, getH2(Hash));
+      ::new (&Buckets[J].getFirst()) KeyT(std::move(Old.getFirst()));
+      ::new (&Buckets[J].getSecond()) ValueT(std::move(Old.getSecond()));
+      Old.getSecond().~ValueT();
+      Old.getFirst().~KeyT();
+    }
+    free(OldCtrl);
+    deallocate_buffer(OldBuckets, sizeof(value_type) * OldNumBuckets,
+                      alignof(value_type));
+  }
+
+  void copyFrom(const FlatHashMap &Other) {
+    NumEntries = Other.NumEntries;
+    NumTombstones = Other.NumTombstones;
+    if (!Other.NumBuckets) {
+      Ctrl = nullptr;
+      Buckets = nullptr;
+      NumBuckets = 0;
+      return;
+    }
+    allocateBuckets(Other.NumBuckets);
+    memcpy(Ctrl, Other.Ctrl, NumBuckets + GroupT::Width);
+    for (unsigned I = 0; I != NumBuckets; ++I) {
+      if (Ctrl[I] < 0)
+        continue;
+      ::new (&Buckets[I].getFirst()) KeyT(Other.Buckets[I].getFirst());
+      ::new (&Buckets[I].getSecond()) ValueT(Other.Buckets[I].getSecond());
+    }
+  }
+};
+
+template <typename KeyT, typename ValueT, typename KeyInfoT, bool IsConst>
+class FlatHashMapIterator : DebugEpochBase::HandleBase {
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+  friend class FlatHashMapIterator<KeyT, ValueT, KeyInfoT, false>;
+  friend class FlatHashMap<KeyT, ValueT, KeyInfoT>;
+
+  using Bucket = llvm::detail::DenseMapPair<KeyT, ValueT>;
+  using ConstIterator = FlatHashMapIterator<KeyT, ValueT, KeyInfoT, true>;
+
+public:
+  using difference_type = ptrdiff_t;
+  using value_type =
+      typename std::conditional<IsConst, const Bucket, Bucket>::type;
+  using pointer = value_type *;
+  using reference = value_type &;
+  using iterator_category = std::forward_iterator_tag;
+
+private:
+  const int8_t *Ctrl = nullptr;
+  const int8_t *End = nullptr;
+  pointer Ptr = nullptr;
+
+public:
+  FlatHashMapIterator() = default;
+
+  FlatHashMapIterator(const int8_t *Ctrl, const int8_t *End, pointer Pos,
+                      const DebugEpochBase &Epoch)
+      : DebugEpochBase::HandleBase(&Epoch), Ctrl(Ctrl), End(End), Ptr(Pos) {
+    assert(isHandleInSync() && "invalid construction!");
+    AdvancePastEmptyBuckets();
+  }
+
+  // Converting ctor from non-const iterators to const iterators. SFINAE'd out
+  // for const iterator destinations so it doesn't end up as a user defined copy
+  // constructor.
+  template <bool IsConstSrc,
+            typename = typename std::enable_if<!IsConstSrc && IsConst>::type>
+  FlatHashMapIterator(
+      const FlatHashMapIterator<KeyT, ValueT, KeyInfoT, IsConstSrc> &I)
+      : DebugEpochBase::HandleBase(I), Ctrl(I.Ctrl), End(I.End), Ptr(I.Ptr) {}
+
+  reference operator*() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return *Ptr;
+  }
+  pointer operator->() const {
+    assert(isHandleInSync() && "invalid iterator access!");
+    return Ptr;
+  }
+
+  bool operator==(const ConstIterator &RHS) const {
+    assert((!Ptr || isHandleInSync()) && "handle not in sync!");
+    assert((!RHS.Ptr || RHS.isHandleInSync()) && "handle not in sync!");
+    assert(getEpochAddress() == RHS.getEpochAddress() &&
+           "comparing incomparable iterators!");
+    return Ctrl == RHS.Ctrl;
+  }
+  bool operator!=(const ConstIterator &RHS) const { return !(*this == RHS); }
+
+  inline FlatHashMapIterator &operator++() { // Preincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    ++Ctrl;
+    ++Ptr;
+    AdvancePastEmptyBuckets();
+    return *this;
+  }
+  FlatHashMapIterator operator++(int) { // Postincrement
+    assert(isHandleInSync() && "invalid iterator access!");
+    FlatHashMapIterator tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+private:
+  void AdvancePastEmptyBuckets() {
+    while (Ctrl != End && *Ctrl < 0) {
+      ++Ctrl;
+      ++Ptr;
+    }
+  }
+};
+
+} // end namespace llvm
+
+#endif // LLVM_ADT_FLATHASHMAP_H
@@ -303,7 +303,14 @@ public:
   using IsCapturedCacheT = SmallDenseMap<const Value *, bool, 8>;
   IsCapturedCacheT IsCapturedCache;
 
-  AAQueryInfo() : AliasCache(), IsCapturedCache() {}
+  /// The GEP decompositions computed by BasicAA, so that each pointer is
+  /// decomposed once for all the queries sharing this info. Defined in
+  /// BasicAliasAnalysis.h and allocated on first use.
+  struct DecomposedGEPCacheT;
+  std::unique_ptr<DecomposedGEPCacheT> DecomposedGEPCache;
+
+  AAQueryInfo();
+  ~AAQueryInfo();
 };
 
 class BatchAAResults;
@@ -783,6 +790,20 @@ public:
   AliasResult alias(const MemoryLocation &LocA, const MemoryLocation &LocB) {
     return AA.alias(LocA, LocB, AAQI);
   }
+  bool isNoAlias(const MemoryLocation &LocA, const MemoryLocation &LocB) {
+    return alias(LocA, LocB) == NoAlias;
+  }
+  /// Answer the alias query of every location in \p LocsA against every
+  /// location in \p LocsB. Results[I * LocsB.size() + J] is set to
+  /// alias(LocsA[I], LocsB[J]).
+  void alias(ArrayRef<MemoryLocation> LocsA, ArrayRef<MemoryLocation> LocsB,
+             SmallVectorImpl<AliasResult> &Results) {
+    Results.clear();
+    Results.reserve(LocsA.size() * LocsB.size());
+    for (const MemoryLocation &LocA : LocsA)
+      for (const MemoryLocation &LocB : LocsB)
+        Results.push_back(alias(LocA, LocB));
+  }
   bool pointsToConstantMemory(const MemoryLocation &Loc, bool OrLocal = false) {
     return AA.pointsToConstantMemory(Loc, AAQI, OrLocal);
   }
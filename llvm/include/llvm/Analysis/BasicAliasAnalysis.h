@@ -53,6 +53,7 @@ class Value;
 /// to various other analyses and must be recomputed when those analyses are.
 class BasicAAResult : public AAResultBase<BasicAAResult> {
   friend AAResultBase<BasicAAResult>;
+  friend struct AAQueryInfo::DecomposedGEPCacheT;
 
   const DataLayout &DL;
   const Function &F;
@@ -172,6 +173,11 @@ private:
   static bool DecomposeGEPExpression(const Value *V, DecomposedGEP &Decomposed,
       const DataLayout &DL, AssumptionCache *AC, DominatorTree *DT);
 
+  /// Like DecomposeGEPExpression, but reuses the decomposition of \p V that
+  /// is cached in \p AAQI, or caches it there.
+  bool getDecomposedGEP(const Value *V, DecomposedGEP &Decomposed,
+                        AAQueryInfo &AAQI);
+
   static bool isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
       const DecomposedGEP &DecompGEP, const DecomposedGEP &DecompObject,
       LocationSize ObjectAccessSize);
@@ -218,6 +224,16 @@ private:
                          const Value *O2 = nullptr);
 };
 
+/// The GEP decompositions cached in an AAQueryInfo, together with whether
+/// DecomposeGEPExpression gave up at MaxLookupSearchDepth.
+struct AAQueryInfo::DecomposedGEPCacheT {
+  struct Entry {
+    BasicAAResult::DecomposedGEP Decomposed;
+    bool MaxLookupReached;
+  };
+  DenseMap<const Value *, Entry> Entries;
+};
+
 /// Analysis pass providing a never-invalidated alias analysis result.
 class BasicAA : public AnalysisInfoMixin<BasicAA> {
   friend AnalysisInfoMixin<BasicAA>;
@@ -1110,6 +1110,10 @@ private:
 
   public:
     SCEVCallbackVH(Value *V, ScalarEvolution *SE = nullptr);
+
+    /// The value of ValueExprMapClock when the ValueExprMap entry keyed by
+    /// this handle was last inserted or looked up.
+    uint64_t LastUse = 0;
   };
 
   friend class SCEVCallbackVH;
@@ -1178,6 +1182,15 @@ private:
   /// This is a cache of the values we have analyzed so far.
   ValueExprMapType ValueExprMap;
 
+  /// Incremented on every use of a ValueExprMap entry, to find the least
+  /// recently used entries when the map has to be trimmed.
+  uint64_t ValueExprMapClock = 0;
+
+  /// The number of getSCEV calls that are currently creating a new SCEV. The
+  /// ValueExprMap is only trimmed when this is zero, since it holds the
+  /// placeholders of the PHIs that are being analyzed.
+  unsigned GetSCEVDepth = 0;
+
   /// Mark predicate values currently being processed by isImpliedCond.
   SmallPtrSet<Value *, 6> PendingLoopPredicates;
 
@@ -1349,9 +1362,10 @@ private:
     /// value returned by getMax or zero.
     bool isMaxOrZero(ScalarEvolution *SE) const;
 
-    /// Return true if any backedge taken count expressions refer to the given
-    /// subexpression.
-    bool hasOperand(const SCEV *S, ScalarEvolution *SE) const;
+    /// Return true if any backedge taken count expressions refer to any of
+    /// the given subexpressions.
+    bool hasAnyOperand(const SmallPtrSetImpl<const SCEV *> &Ops,
+                       ScalarEvolution *SE) const;
 
     /// Invalidate this result and free associated memory.
     void clear();
@@ -1764,6 +1778,20 @@ private:
   /// Drop memoized information computed for S.
   void forgetMemoizedResults(const SCEV *S);
 
+  /// Drop memoized information computed for any of \p SCEVs. This walks the
+  /// loop-level caches once for all of them.
+  void forgetMemoizedResults(ArrayRef<const SCEV *> SCEVs);
+
+  /// Evict the least recently used entries from ValueExprMap so that it is
+  /// back below the limit set by -scalar-evolution-max-value-cache-size.
+  /// Evicted instructions are forgotten together with their users, as by
+  /// forgetValue().
+  void trimValueExprMap();
+
+  /// Return the number of bytes held by the SCEV allocator and the largest
+  /// caches.
+  size_t getMemorySize() const;
+
   /// Return an existing SCEV for V if there is one, otherwise return nullptr.
   const SCEV *getExistingSCEV(Value *V);
 
@@ -126,6 +126,11 @@ private:
   MCSymbol *CurrentFnEnd = nullptr;
   MCSymbol *CurExceptionSym = nullptr;
 
+  /// The symbol of the cold part of the current function and the end of its
+  /// hot part, if the function was split.
+  MCSymbol *CurrentFnColdSym = nullptr;
+  MCSymbol *CurrentFnHotEnd = nullptr;
+
   // The garbage collection metadata printer table.
   void *GCMetadataPrinters = nullptr; // Really a DenseMap.
 
@@ -639,6 +644,10 @@ private:
   /// This method emits the header for the current function.
   virtual void EmitFunctionHeader();
 
+  /// End the hot part of the current function and start its cold part in
+  /// the cold section, before the first cold block \p MBB.
+  void emitColdFragmentStart(const MachineBasicBlock &MBB);
+
   /// Emit a blob of inline asm to the output streamer.
   void
   EmitInlineAsm(StringRef Str, const MCSubtargetInfo &STI,
@@ -22,6 +22,7 @@
 #include "llvm/CodeGen/SlotIndexes.h"
 #include <cassert>
 #include <limits>
+#include <utility>
 
 namespace llvm {
 
@@ -61,6 +62,16 @@ private:
   unsigned Tag = 0;       // unique tag for current contents.
   LiveSegments Segments;  // union of virtual reg segments
 
+  // The slot index range of the last changes, indexed by the tag they produced
+  // modulo ChangeLogSize. An invalid range stands for a change of everything.
+  enum { ChangeLogSize = 8 };
+  std::pair<SlotIndex, SlotIndex> ChangeLog[ChangeLogSize];
+
+  void logChange(SlotIndex Start, SlotIndex End) {
+    ++Tag;
+    ChangeLog[Tag % ChangeLogSize] = std::make_pair(Start, End);
+  }
+
 public:
   explicit LiveIntervalUnion(Allocator &a) : Segments(a) {}
 
@@ -86,6 +97,24 @@ public:
   /// changedSince - Return true if the union change since getTag returned tag.
   bool changedSince(unsigned tag) const { return tag != Tag; }
 
+  /// getChangesSince - Add the slot index ranges that changed since getTag
+  /// returned \p OldTag to \p Changes. Return false if they are not known
+  /// anymore, in which case anything may have changed.
+  bool getChangesSince(
+      unsigned OldTag,
+      SmallVectorImpl<std::pair<SlotIndex, SlotIndex>> &Changes) const {
+    if (Tag - OldTag > ChangeLogSize)
+      return false;
+    for (unsigned T = OldTag; T != Tag;) {
+      const std::pair<SlotIndex, SlotIndex> &Change =
+          ChangeLog[++T % ChangeLogSize];
+      if (!Change.first.isValid())
+        return false;
+      Changes.push_back(Change);
+    }
+    return true;
+  }
+
   // Add a live virtual register to this union and merge its segments.
   void unify(LiveInterval &VirtReg, const LiveRange &Range);
 
@@ -93,7 +122,10 @@ public:
   void extract(LiveInterval &VirtReg, const LiveRange &Range);
 
   // Remove all inserted virtual registers.
-  void clear() { Segments.clear(); ++Tag; }
+  void clear() {
+    Segments.clear();
+    logChange(SlotIndex(), SlotIndex());
+  }
 
   // Print union, using TRI to translate register names
   void print(raw_ostream &OS, const TargetRegisterInfo *TRI) const;
@@ -129,6 +129,10 @@ private:
   /// Indicate that this basic block is the entry block of a cleanup funclet.
   bool IsCleanupFuncletEntry = false;
 
+  /// Indicate that this basic block was moved to the cold section of its
+  /// function by the machine function splitter.
+  bool IsInColdSection = false;
+
   /// since getSymbol is a relatively heavy-weight operation, the symbol
   /// is only computed once and is cached.
   mutable MCSymbol *CachedMCSymbol = nullptr;
@@ -410,6 +414,13 @@ public:
   /// Indicates if this is the entry block of a cleanup funclet.
   void setIsCleanupFuncletEntry(bool V = true) { IsCleanupFuncletEntry = V; }
 
+  /// Returns true if this block is emitted in the cold section of the
+  /// function, after all the blocks that aren't.
+  bool isInColdSection() const { return IsInColdSection; }
+
+  /// Indicates if this block is emitted in the cold section of the function.
+  void setIsInColdSection(bool V = true) { IsInColdSection = V; }
+
   /// Returns true if it is legal to hoist instructions into this block.
   bool isLegalToHoistInto() const;
 
@@ -450,6 +450,10 @@ namespace llvm {
   /// Create Hardware Loop pass. \see HardwareLoops.cpp
   FunctionPass *createHardwareLoopsPass();
 
+  /// This pass moves the cold blocks of a function to its cold section.
+  /// \see MachineFunctionSplitter.cpp
+  MachineFunctionPass *createMachineFunctionSplitterPass();
+
 } // End llvm namespace
 
 #endif
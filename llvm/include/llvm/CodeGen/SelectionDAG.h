@@ -244,6 +244,11 @@ class SelectionDAG {
   /// A linked list of nodes in the current DAG.
   ilist<SDNode> AllNodes;
 
+  /// The number of nodes in AllNodes, and the most there were at once since
+  /// the DAG was prepared for the current function.
+  unsigned NumNodes = 0;
+  unsigned PeakNumNodes = 0;
+
   /// The AllocatorType for allocating SDNodes. We use
   /// pool allocation with recycling.
   using NodeAllocatorType = RecyclingAllocator<BumpPtrAllocator, SDNode,
@@ -257,7 +262,9 @@ class SelectionDAG {
   /// CSE with existing nodes when a duplicate is requested.
   FoldingSet<SDNode> CSEMap;
 
-  /// Pool allocation for machine-opcode SDNode operands.
+  /// Pool allocation for machine-opcode SDNode operands. Like the nodes, the
+  /// operand arrays are recycled across blocks and functions rather than
+  /// freed along with the DAG.
   BumpPtrAllocator OperandAllocator;
   ArrayRecycler<SDUse> OperandRecycler;
 
@@ -453,6 +460,13 @@ public:
     return AllNodes.size();
   }
 
+  /// Return the most nodes the DAG held at once since init, over all the
+  /// blocks of the function.
+  unsigned getPeakNumNodes() const { return PeakNumNodes; }
+
+  /// Return the memory held for the operands of the nodes, in bytes.
+  size_t getOperandMemory() const { return OperandAllocator.getTotalMemory(); }
+
   iterator_range<allnodes_iterator> allnodes() {
     return make_range(allnodes_begin(), allnodes_end());
   }
@@ -11,6 +11,7 @@
 
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringRef.h"
@@ -198,6 +199,19 @@ public:
     return NormalUnits.getNumTypesUnits();
   }
 
+  /// Prepare the normal units to be read from several threads at the same
+  /// time. The units share the abbreviation tables and parse them lazily;
+  /// this parses the unit headers and their abbreviations up front, after
+  /// which different units can be read concurrently. A single unit must
+  /// still be used from one thread at a time.
+  void prepareNormalUnitsForThreads();
+
+  /// Call \p Fn on each normal unit from up to \p ThreadCount threads, or as
+  /// many as the hardware has if it is 0. The calls on different units run
+  /// at the same time, so \p Fn must synchronize what they share.
+  void forEachNormalUnitInParallel(function_ref<void(DWARFUnit &)> Fn,
+                                   unsigned ThreadCount = 0);
+
   /// Get the number of compile units in the DWO context.
   unsigned getNumDWOCompileUnits() {
     parseDWOUnits();
@@ -13,14 +13,18 @@
 #ifndef LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 #define LLVM_DEBUGINFO_SYMBOLIZE_SYMBOLIZE_H
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
 #include "llvm/Object/Binary.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/RWMutex.h"
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,6 +47,19 @@ public:
     std::vector<std::string> DsymHints;
     std::string FallbackDebugPath;
     std::string DWPName;
+    /// Directory where the index of each binary with a build ID is saved the
+    /// first time the binary is symbolized, and read from afterwards. An index
+    /// answers inlined code queries without parsing the debug info.
+    std::string IndexCacheDir;
+    /// Evict the least recently used modules once the debug info of the
+    /// cached modules is larger than this many bytes. 0 means no limit.
+    uint64_t MaxCacheSize = 0;
+  };
+
+  /// A code address of a module, for the batch queries.
+  struct CodeRequest {
+    std::string ModuleName;
+    object::SectionedAddress ModuleOffset;
   };
 
   LLVMSymbolizer() = default;
@@ -62,6 +79,18 @@ public:
   Expected<std::vector<DILocal>>
   symbolizeFrame(const std::string &ModuleName,
                  object::SectionedAddress ModuleOffset);
+
+  /// Symbolize the inlined frames of all of \p Requests, on up to
+  /// \p ThreadCount threads or as many as the hardware has if it is 0. The
+  /// requests are grouped by module and different modules are symbolized at
+  /// the same time. The results are in the order of the requests.
+  std::vector<Expected<DIInliningInfo>>
+  symbolizeInlinedCode(ArrayRef<CodeRequest> Requests,
+                       unsigned ThreadCount = 0);
+
+  /// Drop all the modules and object files. Unlike the queries, which can run
+  /// from several threads at the same time, this must not run concurrently
+  /// with anything else.
   void flush();
 
   static std::string
@@ -73,13 +102,38 @@ private:
   // corresponding debug info. These objects can be the same.
   using ObjectPair = std::pair<ObjectFile *, ObjectFile *>;
 
-  /// Returns a SymbolizableModule or an error if loading debug info failed.
+  /// A module of the cache. The queries on a module hold on to its entry, so
+  /// that it stays alive if it is evicted in the meantime.
+  struct ModuleEntry {
+    std::unique_ptr<SymbolizableModule> Module;
+    /// The debug info of a module is parsed lazily by the queries, so only
+    /// one query at a time can run on it.
+    std::mutex Lock;
+    /// The size of the debug info of the module, which is what the memory it
+    /// takes grows with.
+    uint64_t Size = 0;
+    std::atomic<uint64_t> LastUse{0};
+  };
+
+  /// Returns the cache entry of a module or an error if loading debug info failed.
   /// Only one attempt is made to load a module, and errors during loading are
   /// only reported once. Subsequent calls to get module info for a module that
-  /// failed to load will return nullptr.
-  Expected<SymbolizableModule *>
+  /// failed to load will return an entry with no module.
+  Expected<std::shared_ptr<ModuleEntry>>
   getOrCreateModuleInfo(const std::string &ModuleName);
 
+  /// Create the module for \p ModuleName. ObjectsLock must be held.
+  Expected<std::unique_ptr<SymbolizableModule>>
+  createModuleInfo(const std::string &ModuleName, uint64_t &Size);
+
+  /// Drop the least recently used modules until the cache fits in
+  /// Opts.MaxCacheSize, keeping \p Keep. ModulesLock must be held for
+  /// writing.
+  void evictModules(const ModuleEntry *Keep);
+
+  DIInliningInfo symbolizeInlinedCode(SymbolizableModule *Info,
+                                      object::SectionedAddress ModuleOffset);
+
   ObjectFile *lookUpDsymFile(const std::string &Path,
                              const MachOObjectFile *ExeObj,
                              const std::string &ArchName);
@@ -97,7 +151,15 @@ private:
   Expected<ObjectFile *> getOrCreateObject(const std::string &Path,
                                           const std::string &ArchName);
 
-  std::map<std::string, std::unique_ptr<SymbolizableModule>> Modules;
+  std::map<std::string, std::shared_ptr<ModuleEntry>> Modules;
+  /// Total size of the modules in the cache.
+  uint64_t ModulesSize = 0;
+  /// Taken for reading to look up Modules, and for writing to change it.
+  sys::RWMutex ModulesLock;
+  /// Serializes the creation of modules and guards the object file caches.
+  std::mutex ObjectsLock;
+  /// Clock of the uses of the modules, for the eviction.
+  std::atomic<uint64_t> UseCount{0};
 
   /// Contains cached results of getOrCreateObjectPair().
   std::map<std::pair<std::string, std::string>, ObjectPair>
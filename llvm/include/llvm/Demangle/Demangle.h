@@ -57,6 +57,11 @@ struct ItaniumPartialDemangler {
   /// \return true on error, false otherwise
   bool partialDemangle(const char *MangledName);
 
+  /// Like partialDemangle(const char *), for the \p Len characters at
+  /// \p MangledName, which need not be null-terminated. They have to outlive
+  /// the AST.
+  bool partialDemangle(const char *MangledName, size_t Len);
+
   /// Just print the entire mangled name into Buf. Buf and N behave like the
   /// second and third parameters to itaniumDemangle.
   char *finishDemangle(char *Buf, size_t *N) const;
@@ -98,6 +103,31 @@ private:
   void *RootNode;
   void *Context;
 };
+
+/// Demangles many Itanium names with the same parser and output buffer. Both
+/// keep their memory between calls, so once a context has demangled its
+/// largest name it does not allocate anymore. This is meant for tools that
+/// demangle large numbers of symbols, one context per thread.
+class ItaniumDemangleContext {
+public:
+  ItaniumDemangleContext() = default;
+  ItaniumDemangleContext(const ItaniumDemangleContext &) = delete;
+  ItaniumDemangleContext &operator=(const ItaniumDemangleContext &) = delete;
+  ~ItaniumDemangleContext();
+
+  /// Demangle the \p Len characters at \p MangledName, which need not be
+  /// null-terminated.
+  /// \return The null-terminated demangled name, which is owned by the context
+  /// and valid until the next call, or nullptr if \p MangledName is not a
+  /// valid mangled name. Its length is stored into \p OutLen, if given.
+  const char *demangle(const char *MangledName, size_t Len,
+                       size_t *OutLen = nullptr);
+
+private:
+  ItaniumPartialDemangler Demangler;
+  char *Buf = nullptr;
+  size_t Capacity = 0;
+};
 } // namespace llvm
 
 #endif
@@ -91,6 +91,12 @@ public:
   /// Sets the partition function.
   void setPartitionFunction(PartitionFunction Partition);
 
+  /// Returns the stubs manager for the functions whose bodies are emitted to
+  /// the implementation dylib ImplD, or null if ImplD is not an
+  /// implementation dylib of this layer. Clients may use it to redirect the
+  /// stubs, e.g. to recompiled bodies.
+  IndirectStubsManager *getImplDylibStubsManager(JITDylib &ImplD);
+
   /// Emits the given module. This should not be called by clients: it will be
   /// called by the JIT when a definition added via the add method is requested.
   void emit(MaterializationResponsibility R, ThreadSafeModule TSM) override;
@@ -20,7 +20,10 @@
 #include "llvm/ExecutionEngine/Orc/IRTransformLayer.h"
 #include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
 #include "llvm/ExecutionEngine/Orc/ObjectTransformLayer.h"
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/Speculation.h"
 #include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
 #include "llvm/Support/ThreadPool.h"
 
 namespace llvm {
@@ -136,6 +139,7 @@ protected:
   DataLayout DL;
   std::unique_ptr<ThreadPool> CompileThreads;
 
+  std::unique_ptr<PersistentObjectCache> ObjCache;
   std::unique_ptr<ObjectLayer> ObjLinkingLayer;
   std::unique_ptr<IRCompileLayer> CompileLayer;
 
@@ -161,6 +165,13 @@ public:
     CODLayer->setPartitionFunction(std::move(Partition));
   }
 
+  /// Set an IR transform (e.g. pass manager pipeline) to run on each hot
+  /// function before it is recompiled. Only used with tiered compilation.
+  void setTierUpTransform(IRTransformLayer::TransformFunction Transform) {
+    if (TierUpTransformLayer)
+      TierUpTransformLayer->setTransform(std::move(Transform));
+  }
+
   /// Add a module to be lazily compiled to JITDylib JD.
   Error addLazyIRModule(JITDylib &JD, ThreadSafeModule M);
 
@@ -176,6 +187,11 @@ private:
 
   std::unique_ptr<LazyCallThroughManager> LCTMgr;
   std::unique_ptr<IRTransformLayer> TransformLayer;
+  std::unique_ptr<IRCompileLayer> TierUpCompileLayer;
+  std::unique_ptr<IRTransformLayer> TierUpTransformLayer;
+  std::unique_ptr<TieredCompileLayer> TieredLayer;
+  std::unique_ptr<Speculator> Spec;
+  std::unique_ptr<IRSpeculationLayer> SpeculationLayer;
   std::unique_ptr<CompileOnDemandLayer> CODLayer;
 };
 
@@ -188,6 +204,8 @@ public:
   Optional<JITTargetMachineBuilder> JTMB;
   CreateObjectLinkingLayerFunction CreateObjectLinkingLayer;
   unsigned NumCompileThreads = 0;
+  std::string ObjectCacheDir;
+  CachePruningPolicy ObjectCachePruningPolicy;
 
   /// Called prior to JIT class construcion to fix up defaults.
   Error prepareForConstruction();
@@ -235,6 +253,21 @@ public:
     return impl();
   }
 
+  /// Cache compiled objects in directory Dir, so that modules compiled by an
+  /// earlier run (or by another process) with the same target settings are
+  /// loaded instead of recompiled. The cache is pruned according to Policy
+  /// when the JIT is created.
+  ///
+  /// If this method is not called, or is called with an empty Dir, objects
+  /// are not cached.
+  SetterImpl &
+  setObjectCacheDirectory(std::string Dir,
+                          CachePruningPolicy Policy = CachePruningPolicy()) {
+    impl().ObjectCacheDir = std::move(Dir);
+    impl().ObjectCachePruningPolicy = std::move(Policy);
+    return impl();
+  }
+
   /// Create an instance of the JIT.
   Expected<std::unique_ptr<JITType>> create() {
     if (auto Err = impl().prepareForConstruction())
@@ -267,6 +300,10 @@ public:
   JITTargetAddress LazyCompileFailureAddr = 0;
   std::unique_ptr<LazyCallThroughManager> LCTMgr;
   IndirectStubsManagerBuilderFunction ISMBuilder;
+  unsigned SpeculativeCompileDepth = 0;
+  uint64_t TierUpThreshold = 0;
+  Optional<JITTargetMachineBuilder> TierUpJTMB;
+  CodeGenOpt::Level TierUpOptLevel = CodeGenOpt::Aggressive;
 
   Error prepareForConstruction();
 };
@@ -302,6 +339,39 @@ public:
     this->impl().ISMBuilder = std::move(ISMBuilder);
     return this->impl();
   }
+
+  /// Set how far speculative compilation may run ahead of execution.
+  ///
+  /// When a function is compiled, the functions it calls directly are queued
+  /// for compilation on the compile threads, highest profile count first,
+  /// and so on up to Depth calls away from a function that was actually
+  /// called. Requires a non-zero number of compile threads.
+  ///
+  /// If this method is not called then the value will default to 0, which
+  /// disables speculation.
+  SetterImpl &setSpeculativeCompileDepth(unsigned Depth) {
+    this->impl().SpeculativeCompileDepth = Depth;
+    return this->impl();
+  }
+
+  /// Enable tiered compilation.
+  ///
+  /// Functions are first compiled at the JITTargetMachineBuilder's
+  /// optimization level (CodeGenOpt::None by default, which uses FastISel),
+  /// with counters on entry and loop back-edges. Once a function's counter
+  /// reaches HotThreshold, it is recompiled at TierUpOptLevel (on the compile
+  /// threads, if there are any) and its stub is redirected to the result. See
+  /// LLLazyJIT::setTierUpTransform to also optimize the IR of hot functions.
+  ///
+  /// If this method is not called, or is called with a zero threshold, every
+  /// function is compiled once.
+  SetterImpl &setTieredCompilation(
+      uint64_t HotThreshold,
+      CodeGenOpt::Level TierUpOptLevel = CodeGenOpt::Aggressive) {
+    this->impl().TierUpThreshold = HotThreshold;
+    this->impl().TierUpOptLevel = TierUpOptLevel;
+    return this->impl();
+  }
 };
 
 /// Constructs LLLazyJIT instances.
@@ -0,0 +1,81 @@
+//===- PersistentObjectCache.h - On-disk cache of JIT'd objects -*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// An ObjectCache that keeps compiled objects on disk, keyed by a hash of the
+// module and of the target it was compiled for.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+#define LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/Error.h"
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+namespace orc {
+
+/// An ObjectCache that stores objects in a directory, so that they survive
+/// the process and can be shared by several processes.
+///
+/// Objects are keyed by a hash of the module's bitcode, of the settings of
+/// the JITTargetMachineBuilder they are compiled with, and of the LLVM
+/// version. New entries are written to a temporary file and renamed into
+/// place, so concurrent readers and writers (in this or other processes)
+/// never see a partial object. Entries are named so that pruneCache() can
+/// evict them; the cache is pruned according to its policy on creation and
+/// whenever prune() is called.
+///
+/// The cache must only be used with compilers built from the same
+/// JITTargetMachineBuilder settings as the cache.
+class PersistentObjectCache : public ObjectCache {
+public:
+  /// Create a cache in CacheDir (which is created if needed) for objects
+  /// compiled with JTMB.
+  static Expected<std::unique_ptr<PersistentObjectCache>>
+  Create(StringRef CacheDir, const JITTargetMachineBuilder &JTMB,
+         CachePruningPolicy Policy = CachePruningPolicy());
+
+  void notifyObjectCompiled(const Module *M, MemoryBufferRef Obj) override;
+
+  std::unique_ptr<MemoryBuffer> getObject(const Module *M) override;
+
+  /// Evict entries according to the pruning policy.
+  void prune();
+
+  /// Returns the key under which M's object is cached.
+  std::string getKey(const Module &M) const;
+
+private:
+  PersistentObjectCache(StringRef CacheDir, std::string TargetKey,
+                        CachePruningPolicy Policy)
+      : CacheDir(CacheDir), TargetKey(std::move(TargetKey)),
+        Policy(std::move(Policy)) {}
+
+  std::string getEntryPath(StringRef Key) const;
+
+  std::string CacheDir;
+  std::string TargetKey;
+  CachePruningPolicy Policy;
+
+  // The keys of modules looked up but not yet compiled, so that a miss does
+  // not hash the module twice.
+  std::mutex PendingKeysMutex;
+  DenseMap<const Module *, std::string> PendingKeys;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_PERSISTENTOBJECTCACHE_H
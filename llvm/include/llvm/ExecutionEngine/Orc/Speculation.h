@@ -0,0 +1,103 @@
+//===--- Speculation.h - Speculative compilation of callees ----*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Start compiling the functions a JIT'd function is likely to call before they
+// are called.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_SPECULATION_H
+#define LLVM_EXECUTIONENGINE_ORC_SPECULATION_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/Layer.h"
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class Function;
+
+namespace orc {
+
+/// Issues lookups for the symbols a function is likely to call, so that they
+/// are materialized (typically on a compile thread pool) before the first
+/// call reaches their lazy call-through stubs.
+///
+/// Speculation cascades: compiling a speculated symbol may speculate its own
+/// targets in turn, up to MaxDepth levels away from a symbol that was
+/// materialized for real. Each symbol is speculated at most once.
+class Speculator {
+public:
+  /// A list of (target symbol, priority) pairs. Higher priority targets are
+  /// requested first.
+  using TargetList = std::vector<std::pair<SymbolStringPtr, uint64_t>>;
+
+  Speculator(ExecutionSession &ES, unsigned MaxDepth,
+             unsigned MaxTargetsPerSymbol = 8)
+      : ES(ES), MaxDepth(MaxDepth), MaxTargetsPerSymbol(MaxTargetsPerSymbol) {}
+
+  /// Notify the speculator that Caller, defined in JD, is being materialized
+  /// and is likely to call the given targets, which are looked up in JD.
+  ///
+  /// Lookups for the targets are issued without waiting for them. A target
+  /// that can not be found or fails to materialize is silently dropped: the
+  /// error will resurface when (and if) it is actually called.
+  void speculateFor(JITDylib &JD, const SymbolStringPtr &Caller,
+                    TargetList Targets);
+
+private:
+  ExecutionSession &ES;
+  unsigned MaxDepth;
+  unsigned MaxTargetsPerSymbol;
+
+  std::mutex SpeculatorMutex;
+  // The distance of each speculated symbol from a symbol that was
+  // materialized for real.
+  DenseMap<JITDylib *, DenseMap<SymbolStringPtr, unsigned>> Depths;
+};
+
+/// An IR layer that feeds the static call graph of each module it emits to a
+/// Speculator before passing the module on to the layer below.
+///
+/// Placed below a CompileOnDemandLayer, it sees each partition when it is
+/// about to be compiled, which is when its callees are worth speculating on.
+class IRSpeculationLayer : public IRLayer {
+public:
+  /// Returns the symbols F is likely to call.
+  using TargetsFunction =
+      std::function<Speculator::TargetList(Function &F, MangleAndInterner &)>;
+
+  IRSpeculationLayer(ExecutionSession &ES, IRLayer &BaseLayer, Speculator &S,
+                     TargetsFunction GetTargets = findDirectCallees);
+
+  void setTargetsFunction(TargetsFunction GetTargets) {
+    this->GetTargets = std::move(GetTargets);
+  }
+
+  void emit(MaterializationResponsibility R, ThreadSafeModule TSM) override;
+
+  /// The default targets function: returns the direct callees of F. A
+  /// callee's priority is its profile entry count when it has one, and
+  /// otherwise the number of call sites F has for it.
+  static Speculator::TargetList findDirectCallees(Function &F,
+                                                  MangleAndInterner &Mangle);
+
+private:
+  IRLayer &BaseLayer;
+  Speculator &S;
+  TargetsFunction GetTargets;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_SPECULATION_H
@@ -0,0 +1,96 @@
+//===- TieredCompileLayer.h - Recompile hot functions -----------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Compile functions quickly first, then recompile the hot ones with an
+// optimizing layer and redirect their stubs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+#define LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
+
+#include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/Layer.h"
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace llvm {
+
+class Function;
+
+namespace orc {
+
+/// An IR layer for tiered compilation.
+///
+/// Each function emitted through this layer is instrumented with a counter
+/// that is bumped on entry and on every loop back-edge, and is then passed on
+/// to BaseLayer, which would typically compile quickly (e.g. at -O0, where
+/// FastISel is used). An uninstrumented copy of the function is kept. When the
+/// counter reaches HotThreshold, the copy is looked up through
+/// OptimizingLayer (and thus compiled on the compile threads, if there are
+/// any), and the stub that callers go through is pointed at the result.
+///
+/// This layer must sit below a CompileOnDemandLayer: GetStubsManager maps the
+/// implementation dylibs that layer emits into to the stubs that call into
+/// them. Functions that are not called through a stub are never recompiled.
+/// Modules with local global variables or aliases are not tiered, as their
+/// definitions can not be shared with a second copy of the code. The counters
+/// live in this process, so the JIT'd code must run in-process.
+class TieredCompileLayer : public IRLayer {
+public:
+  /// Returns the stubs manager for the implementation dylib ImplJD, or null
+  /// if there is none.
+  using GetStubsManagerFunction =
+      std::function<IndirectStubsManager *(JITDylib &ImplJD)>;
+
+  TieredCompileLayer(ExecutionSession &ES, IRLayer &BaseLayer,
+                     IRLayer &OptimizingLayer,
+                     GetStubsManagerFunction GetStubsManager,
+                     uint64_t HotThreshold);
+
+  void emit(MaterializationResponsibility R, ThreadSafeModule TSM) override;
+
+private:
+  class OptimizedFunctionMaterializationUnit;
+
+  struct TieredFunction {
+    TieredFunction(JITDylib &ImplJD, JITDylib &OptJD, SymbolStringPtr Name)
+        : ImplJD(ImplJD), OptJD(OptJD), Name(std::move(Name)) {}
+
+    // Bumped by the instrumented code.
+    uint64_t Counter = 0;
+    JITDylib &ImplJD;
+    JITDylib &OptJD;
+    SymbolStringPtr Name;
+  };
+
+  // Called by instrumented code when a counter reaches the threshold.
+  static void tierUpEntry(TieredCompileLayer *Layer, uint64_t FunctionId);
+
+  void tierUp(uint64_t FunctionId);
+  JITDylib &getOptimizedDylib(JITDylib &ImplJD);
+  void instrument(Function &F, uint64_t FunctionId, uint64_t &Counter);
+
+  IRLayer &BaseLayer;
+  IRLayer &OptimizingLayer;
+  GetStubsManagerFunction GetStubsManager;
+  uint64_t HotThreshold;
+
+  std::mutex TieredLayerMutex;
+  std::map<JITDylib *, JITDylib *> OptimizedDylibs;
+  // A deque, so that the counters do not move as functions are added.
+  std::deque<TieredFunction> Functions;
+};
+
+} // end namespace orc
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_ORC_TIEREDCOMPILELAYER_H
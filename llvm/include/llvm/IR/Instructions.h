@@ -873,8 +873,9 @@ inline Type *checkGEPType(Type *Ty) {
 /// access elements of arrays and structs
 ///
 class GetElementPtrInst : public Instruction {
+  // The result element type is not stored, it is the element type of the
+  // result pointer type.
   Type *SourceElementType;
-  Type *ResultElementType;
 
   GetElementPtrInst(const GetElementPtrInst &GEPI);
 
@@ -972,12 +973,9 @@ public:
   Type *getSourceElementType() const { return SourceElementType; }
 
   void setSourceElementType(Type *Ty) { SourceElementType = Ty; }
-  void setResultElementType(Type *Ty) { ResultElementType = Ty; }
 
   Type *getResultElementType() const {
-    assert(ResultElementType ==
-           cast<PointerType>(getType()->getScalarType())->getElementType());
-    return ResultElementType;
+    return cast<PointerType>(getType()->getScalarType())->getElementType();
   }
 
   /// Returns the address space of this instruction's pointer type.
@@ -1112,10 +1110,8 @@ GetElementPtrInst::GetElementPtrInst(Type *PointeeType, Value *Ptr,
     : Instruction(getGEPReturnType(PointeeType, Ptr, IdxList), GetElementPtr,
                   OperandTraits<GetElementPtrInst>::op_end(this) - Values,
                   Values, InsertBefore),
-      SourceElementType(PointeeType),
-      ResultElementType(getIndexedType(PointeeType, IdxList)) {
-  assert(ResultElementType ==
-         cast<PointerType>(getType()->getScalarType())->getElementType());
+      SourceElementType(PointeeType) {
+  assert(getResultElementType() == getIndexedType(PointeeType, IdxList));
   init(Ptr, IdxList, NameStr);
 }
 
@@ -1126,10 +1122,8 @@ GetElementPtrInst::GetElementPtrInst(Type *PointeeType, Value *Ptr,
     : Instruction(getGEPReturnType(PointeeType, Ptr, IdxList), GetElementPtr,
                   OperandTraits<GetElementPtrInst>::op_end(this) - Values,
                   Values, InsertAtEnd),
-      SourceElementType(PointeeType),
-      ResultElementType(getIndexedType(PointeeType, IdxList)) {
-  assert(ResultElementType ==
-         cast<PointerType>(getType()->getScalarType())->getElementType());
+      SourceElementType(PointeeType) {
+  assert(getResultElementType() == getIndexedType(PointeeType, IdxList));
   init(Ptr, IdxList, NameStr);
 }
 
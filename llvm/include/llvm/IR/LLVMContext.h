@@ -164,6 +164,15 @@ public:
   void enableDebugTypeODRUniquing();
   void disableDebugTypeODRUniquing();
 
+  /// Destroy the uniqued integer, floating-point, data sequential, aggregate
+  /// and expression constants that have no uses and are not referenced from
+  /// metadata. A context that outlives the modules created in it, as in a
+  /// long-running JIT, otherwise keeps every constant it ever uniqued.
+  ///
+  /// Any Constant pointer that is not a use, a value handle or metadata is
+  /// invalidated by this call.
+  void dropTriviallyDeadConstants();
+
   using InlineAsmDiagHandlerTy = void (*)(const SMDiagnostic&, void *Context,
                                           unsigned LocCookie);
 
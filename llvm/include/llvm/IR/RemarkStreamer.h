@@ -90,7 +90,7 @@ struct RemarkSetupFormatError : RemarkSetupErrorInfo<RemarkSetupFormatError> {
   using RemarkSetupErrorInfo<RemarkSetupFormatError>::RemarkSetupErrorInfo;
 };
 
-enum class RemarksSerializerFormat { Unknown, YAML };
+enum class RemarksSerializerFormat { Unknown, YAML, Bitstream };
 
 Expected<RemarksSerializerFormat> parseSerializerFormat(StringRef Format);
 
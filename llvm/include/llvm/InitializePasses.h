@@ -261,6 +261,7 @@ void initializeMachineCopyPropagationPass(PassRegistry&);
 void initializeMachineDominanceFrontierPass(PassRegistry&);
 void initializeMachineDominatorTreePass(PassRegistry&);
 void initializeMachineFunctionPrinterPassPass(PassRegistry&);
+void initializeMachineFunctionSplitterPass(PassRegistry&);
 void initializeMachineLICMPass(PassRegistry&);
 void initializeMachineLoopInfoPass(PassRegistry&);
 void initializeMachineModuleInfoPass(PassRegistry&);
@@ -417,6 +418,7 @@ void initializeXRayInstrumentationPass(PassRegistry&);
 
 void initializeOmpTgtAddrTransPass(PassRegistry&);
 void initializeRestoreLoadPass(PassRegistry&);
+void initializeConcurrentATPass(PassRegistry&);
 
 } // end namespace llvm
 
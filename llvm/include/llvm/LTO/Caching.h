@@ -7,7 +7,8 @@
 //===----------------------------------------------------------------------===//
 //
 // This file defines the localCache function, which allows clients to add a
-// filesystem cache to ThinLTO.
+// filesystem cache to ThinLTO, and the ObjectStore interface, which allows
+// that cache to be backed by a store shared between machines.
 //
 //===----------------------------------------------------------------------===//
 
@@ -15,6 +16,7 @@
 #define LLVM_LTO_CACHING_H
 
 #include "llvm/LTO/LTO.h"
+#include <memory>
 #include <string>
 
 namespace llvm {
@@ -27,11 +29,56 @@ namespace lto {
 using AddBufferFn =
     std::function<void(unsigned Task, std::unique_ptr<MemoryBuffer> MB)>;
 
+/// A store of native object files addressed by their cache key, such as a
+/// cache shared by the machines of a build farm. A local cache asks its store
+/// for the objects it doesn't have and gives it the objects it creates.
+///
+/// The store is only an optimization: a failure to look up or store an object
+/// doesn't fail the link. All members must be thread safe.
+class ObjectStore {
+public:
+  virtual ~ObjectStore();
+
+  /// Return the object stored under \p Key, or null if there is none.
+  virtual Expected<std::unique_ptr<MemoryBuffer>> get(StringRef Key) = 0;
+
+  /// Store \p Object under \p Key. This may return before the object is
+  /// stored.
+  virtual Error put(StringRef Key, MemoryBufferRef Object) = 0;
+
+  /// Tell the store that \p Key is likely to be looked up soon, so that it can
+  /// start fetching the object. The default implementation does nothing.
+  virtual void prefetch(StringRef Key) {}
+};
+
+/// Create a store that runs \p Program to talk to the actual store, so that
+/// any remote protocol can be used without linking it into the tools:
+///
+///   Program get <key> <file>   writes the object to <file> and exits with 0,
+///                              or exits with 1 if there is no such object
+///   Program put <key> <file>   stores the object in <file>
+///
+/// Lookups and stores run in a pool of \p Parallelism threads, which can be
+/// larger than the number of cores, since they mostly wait on the network.
+/// The destructor waits for the pending stores and the lookups that have
+/// started, and drops the prefetches that haven't.
+std::unique_ptr<ObjectStore> createCommandObjectStore(StringRef Program,
+                                                      unsigned Parallelism);
+
+/// Create a Config::CachePrefetchHook that asks \p Store to prefetch the keys
+/// that are missing from the cache directory \p CacheDirectoryPath, since only
+/// those are looked up in the store.
+Config::CachePrefetchHookFn
+localCachePrefetcher(StringRef CacheDirectoryPath,
+                     std::shared_ptr<ObjectStore> Store);
+
 /// Create a local file system cache which uses the given cache directory and
 /// file callback. This function also creates the cache directory if it does not
-/// already exist.
-Expected<NativeObjectCache> localCache(StringRef CacheDirectoryPath,
-                                       AddBufferFn AddBuffer);
+/// already exist. If \p Store is given, it is asked for the objects that are
+/// not in the cache directory, and it gets the objects that are created.
+Expected<NativeObjectCache>
+localCache(StringRef CacheDirectoryPath, AddBufferFn AddBuffer,
+           std::shared_ptr<ObjectStore> Store = nullptr);
 
 } // namespace lto
 } // namespace llvm
@@ -187,6 +187,12 @@ struct Config {
       std::function<bool(const ModuleSummaryIndex &Index)>;
   CombinedIndexHookFn CombinedIndexHook;
 
+  /// A cache prefetch hook is called by the in-process ThinLTO backend with
+  /// the cache key of every module that may be cached, before any backend
+  /// runs, so that a slow cache can start looking them up (ThinLTO-specific).
+  using CachePrefetchHookFn = std::function<void(StringRef Key)>;
+  CachePrefetchHookFn CachePrefetchHook;
+
   /// This is a convenience function that configures this Config object to write
   /// temporary files named after the given OutputFileName for each of the LTO
   /// phases to disk. A client can use this function to implement -save-temps.
@@ -225,7 +225,12 @@ using ThinBackend = std::function<std::unique_ptr<ThinBackendProc>(
     AddStreamFn AddStream, NativeObjectCache Cache)>;
 
 /// This ThinBackend runs the individual backend jobs in-process.
-ThinBackend createInProcessThinBackend(unsigned ParallelismLevel);
+///
+/// If \p MemoryBudget is not zero, a job only starts if the estimated
+/// memory of the running jobs, itself included, stays within that many
+/// bytes; a job always starts if no other is running.
+ThinBackend createInProcessThinBackend(unsigned ParallelismLevel,
+                                       uint64_t MemoryBudget = 0);
 
 /// This ThinBackend writes individual module indexes to files, instead of
 /// running the individual backend jobs. This backend is for distributed builds
@@ -227,6 +227,7 @@ namespace {
 
       (void) llvm::createOmpTgtAddrTransPass();
       (void) llvm::createRestoreLoadPass();
+      (void) llvm::createConcurrentATPass();
 
       (void)new llvm::IntervalPartition();
       (void)new llvm::ScalarEvolutionWrapperPass();
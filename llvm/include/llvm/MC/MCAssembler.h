@@ -187,8 +187,11 @@ private:
   bool layoutOnce(MCAsmLayout &Layout);
 
   /// Perform one layout iteration of the given section and return true
-  /// if any offsets were adjusted.
-  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec);
+  /// if any offsets were adjusted. \p LastRelaxed is the last fragment the
+  /// previous iteration relaxed, or null for the first iteration, and is set
+  /// to the last fragment this iteration relaxed.
+  bool layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                         MCFragment *&LastRelaxed);
 
   bool relaxInstruction(MCAsmLayout &Layout, MCRelaxableFragment &IF);
 
@@ -244,6 +247,11 @@ public:
   void writeSectionData(raw_ostream &OS, const MCSection *Section,
                         const MCAsmLayout &Layout) const;
 
+  /// Free the contents and fixups of the fragments of \p Section once it has
+  /// been written out. The fragments keep their offsets, so symbols can still
+  /// be evaluated, but the section can't be written or laid out again.
+  void releaseSectionData(MCSection &Section);
+
   /// Check whether a given symbol has been flagged with .thumb_func.
   bool isThumbFunc(const MCSymbol *Func) const;
 
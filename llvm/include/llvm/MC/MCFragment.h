@@ -196,6 +196,11 @@ protected:
 public:
   SmallVectorImpl<char> &getContents() { return Contents; }
   const SmallVectorImpl<char> &getContents() const { return Contents; }
+
+  /// Free the contents once they have been written to the object file.
+  void releaseContents() {
+    SmallVector<char, ContentsSize> Released(std::move(Contents));
+  }
 };
 
 /// Interface implemented by fragments that contain encoded instructions and/or
@@ -223,6 +228,11 @@ public:
   SmallVectorImpl<MCFixup> &getFixups() { return Fixups; }
   const SmallVectorImpl<MCFixup> &getFixups() const { return Fixups; }
 
+  /// Free the fixups once they have been applied to the contents.
+  void releaseFixups() {
+    SmallVector<MCFixup, FixupsSize> Released(std::move(Fixups));
+  }
+
   fixup_iterator fixup_begin() { return Fixups.begin(); }
   const_fixup_iterator fixup_begin() const { return Fixups.begin(); }
 
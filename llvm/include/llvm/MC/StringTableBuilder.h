@@ -44,6 +44,10 @@ public:
   size_t add(CachedHashStringRef S);
   size_t add(StringRef S) { return add(CachedHashStringRef(S)); }
 
+  /// Allocate space for NumStrings unique strings up front, so that adding
+  /// that many strings doesn't grow the table.
+  void reserve(size_t NumStrings) { StringIndexMap.reserve(NumStrings); }
+
   /// Analyze the strings and build the final table. No more strings can
   /// be added after this point.
   void finalize();
@@ -0,0 +1,86 @@
+//===- ParallelFunctionPass.h - Run a function pipeline on threads -*- C++ -*-//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+/// \file
+///
+/// This file provides a module pass that runs a function pass pipeline over
+/// the functions of a module on a pool of threads.
+///
+/// An LLVMContext, and the uniquing of types, constants and metadata it does,
+/// is not thread-safe, so the workers cannot share the module being compiled.
+/// Instead the module is written to bitcode once, and every worker loads it
+/// lazily into its own context, materializes only the function bodies it was
+/// assigned and runs its own copy of the pipeline with its own analysis
+/// managers. The optimized bodies are then moved back into the original module
+/// with the IRMover.
+///
+/// This only pays off once the functions are independent, i.e. after
+/// inlining, and only for passes that don't look beyond the function they
+/// run on: module analyses such as GlobalsAA are not available to the
+/// workers.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_PASSES_PARALLELFUNCTIONPASS_H
+#define LLVM_PASSES_PARALLELFUNCTIONPASS_H
+
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Transforms/Scalar/LoopPassManager.h"
+#include <functional>
+#include <memory>
+
+namespace llvm {
+
+class Module;
+class TargetMachine;
+
+/// The pipeline one worker runs and the state it runs it with.
+///
+/// Workers are created on the thread running the pass, before any of them
+/// starts, so building one may use state that is not thread-safe. Once
+/// running, a worker must not share anything with the others, which is why it
+/// owns its analysis managers and its TargetMachine (subtargets are created
+/// and cached lazily by the TargetMachine).
+struct ParallelFunctionPassWorker {
+  explicit ParallelFunctionPassWorker(bool DebugLogging = false);
+  ~ParallelFunctionPassWorker();
+
+  std::unique_ptr<TargetMachine> TM;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  FunctionPassManager FPM;
+};
+
+/// Run a function pass pipeline over the function definitions of a module on
+/// \c NumThreads threads.
+///
+/// The pass falls back to running the pipeline of a single worker on the
+/// calling thread for modules it cannot split: modules with debug info (the
+/// distinct compile units and subprograms would be duplicated when the
+/// bodies are moved back), modules that take the address of basic blocks, and
+/// modules with fewer than two function definitions.
+class ParallelFunctionPass : public PassInfoMixin<ParallelFunctionPass> {
+public:
+  using WorkerFactory =
+      std::function<std::unique_ptr<ParallelFunctionPassWorker>()>;
+
+  ParallelFunctionPass(unsigned NumThreads, WorkerFactory CreateWorker)
+      : NumThreads(NumThreads), CreateWorker(std::move(CreateWorker)) {}
+
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+
+private:
+  unsigned NumThreads;
+  WorkerFactory CreateWorker;
+};
+
+} // end namespace llvm
+
+#endif // LLVM_PASSES_PARALLELFUNCTIONPASS_H
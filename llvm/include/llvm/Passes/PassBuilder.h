@@ -99,6 +99,12 @@ public:
   /// Tuning option to disable promotion to scalars in LICM with MemorySSA, if
   /// the number of access is too large.
   unsigned LicmMssaNoAccForPromotionCap;
+
+  /// Tuning option to run the function passes of the module optimization
+  /// pipeline on this many threads, see ParallelFunctionPass. Values below 2
+  /// run them serially. Its default value is that of the flag:
+  /// `-npm-function-optimization-threads`.
+  unsigned FunctionOptimizationThreads;
 };
 
 /// This class provides access to building LLVM's passes.
@@ -663,6 +669,13 @@ private:
 
   void invokePeepholeEPCallbacks(FunctionPassManager &, OptimizationLevel);
 
+  /// Build the function passes of the module optimization pipeline, which run
+  /// once the module is fully simplified. The OptimizerLast extension point
+  /// callbacks are left to the caller.
+  FunctionPassManager
+  buildFunctionOptimizationPipeline(OptimizationLevel Level, bool DebugLogging,
+                                    bool LTOPreLink);
+
   // Extension Point callbacks
   SmallVector<std::function<void(FunctionPassManager &, OptimizationLevel)>, 2>
       PeepholeEPCallbacks;
@@ -19,6 +19,7 @@
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/None.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/ADT/iterator.h"
@@ -42,11 +43,13 @@
 namespace llvm {
 
 class IndexedInstrProfReader;
+class ThreadPool;
 
 namespace coverage {
 
 class CoverageMappingReader;
 struct CoverageMappingRecord;
+struct DecodedCoverageMappingRecord;
 
 enum class coveragemap_error {
   success = 0,
@@ -508,28 +511,56 @@ public:
 class CoverageMapping {
   DenseMap<size_t, DenseSet<size_t>> RecordProvenance;
   std::vector<FunctionRecord> Functions;
+  DenseMap<size_t, SmallVector<unsigned, 0>> FilenameHash2RecordIndices;
   std::vector<std::pair<std::string, uint64_t>> FuncHashMismatches;
 
   CoverageMapping() = default;
 
-  /// Add a function record corresponding to \p Record.
-  Error loadFunctionRecord(const CoverageMappingRecord &Record,
-                           IndexedInstrProfReader &ProfileReader);
+  /// Add the function records corresponding to \p Records. If \p Pool is not
+  /// null, the region counts are evaluated concurrently on it.
+  Error loadFunctionRecords(ArrayRef<DecodedCoverageMappingRecord> Records,
+                            IndexedInstrProfReader &ProfileReader,
+                            ThreadPool *Pool);
+
+  /// Add \p Function, unless a function with the same name and filenames has
+  /// already been added.
+  void addFunctionRecord(FunctionRecord &&Function);
+
+  /// Returns the indices of the functions which may cover \p Filename. They
+  /// are found by hash, so some of them may not cover it.
+  ArrayRef<unsigned> getImpreciseRecordIndicesForFilename(
+      StringRef Filename) const;
 
 public:
   CoverageMapping(const CoverageMapping &) = delete;
   CoverageMapping &operator=(const CoverageMapping &) = delete;
 
   /// Load the coverage mapping using the given readers.
+  ///
+  /// The coverage mapping is decoded and evaluated using \p NumThreads
+  /// threads, or one thread per core if \p NumThreads is 0.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<std::unique_ptr<CoverageMappingReader>> CoverageReaders,
-       IndexedInstrProfReader &ProfileReader);
+       IndexedInstrProfReader &ProfileReader, unsigned NumThreads = 1);
 
   /// Load the coverage mapping from the given object files and profile. If
   /// \p Arches is non-empty, it must specify an architecture for each object.
+  ///
+  /// If \p CacheDir is not empty, the loaded coverage mapping is cached in
+  /// that directory, keyed by the contents of the object files and of the
+  /// profile, and later loads of the same inputs read it from the cache.
   static Expected<std::unique_ptr<CoverageMapping>>
   load(ArrayRef<StringRef> ObjectFilenames, StringRef ProfileFilename,
-       ArrayRef<StringRef> Arches = None);
+       ArrayRef<StringRef> Arches = None, unsigned NumThreads = 1,
+       StringRef CacheDir = "");
+
+  /// Write the loaded function records to \p OS, in a format that
+  /// loadFromCache() reads back without decoding the coverage mapping again.
+  void writeCache(raw_ostream &OS) const;
+
+  /// Load a coverage mapping written by writeCache().
+  static Expected<std::unique_ptr<CoverageMapping>>
+  loadFromCache(StringRef Buffer);
 
   /// The number of functions that couldn't have their profiles mapped.
   ///
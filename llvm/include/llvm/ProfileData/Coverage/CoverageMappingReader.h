@@ -27,6 +27,9 @@
 #include <vector>
 
 namespace llvm {
+
+class ThreadPool;
+
 namespace coverage {
 
 class CoverageMappingReader;
@@ -40,6 +43,29 @@ struct CoverageMappingRecord {
   ArrayRef<CounterMappingRegion> MappingRegions;
 };
 
+/// Coverage mapping information for a single function, which owns its decoded
+/// filenames, expressions and regions.
+struct DecodedCoverageMappingRecord {
+  StringRef FunctionName;
+  uint64_t FunctionHash = 0;
+  std::vector<StringRef> Filenames;
+  std::vector<CounterExpression> Expressions;
+  std::vector<CounterMappingRegion> MappingRegions;
+
+  DecodedCoverageMappingRecord() = default;
+  DecodedCoverageMappingRecord(const CoverageMappingRecord &Record)
+      : FunctionName(Record.FunctionName), FunctionHash(Record.FunctionHash),
+        Filenames(Record.Filenames.begin(), Record.Filenames.end()),
+        Expressions(Record.Expressions.begin(), Record.Expressions.end()),
+        MappingRegions(Record.MappingRegions.begin(),
+                       Record.MappingRegions.end()) {}
+
+  CoverageMappingRecord getRecord() const {
+    return {FunctionName, FunctionHash, Filenames, Expressions,
+            MappingRegions};
+  }
+};
+
 /// A file format agnostic iterator over coverage mapping data.
 class CoverageMappingIterator
     : public std::iterator<std::input_iterator_tag, CoverageMappingRecord> {
@@ -96,6 +122,15 @@ public:
   virtual ~CoverageMappingReader() = default;
 
   virtual Error readNextRecord(CoverageMappingRecord &Record) = 0;
+
+  /// Decode up to \p MaxRecords of the next records into \p Records, in the
+  /// order readNextRecord would return them. \p Records is left empty at the
+  /// end of the coverage data. If \p Pool is not null, the records may be
+  /// decoded concurrently on it.
+  virtual Error
+  readNextRecords(std::vector<DecodedCoverageMappingRecord> &Records,
+                  size_t MaxRecords, ThreadPool *Pool = nullptr);
+
   CoverageMappingIterator begin() { return CoverageMappingIterator(this); }
   CoverageMappingIterator end() { return CoverageMappingIterator(); }
 };
@@ -193,12 +228,13 @@ private:
   std::vector<ProfileMappingRecord> MappingRecords;
   InstrProfSymtab ProfileNames;
   size_t CurrentRecord = 0;
-  std::vector<StringRef> FunctionsFilenames;
-  std::vector<CounterExpression> Expressions;
-  std::vector<CounterMappingRegion> MappingRegions;
+  DecodedCoverageMappingRecord Decoded;
 
   BinaryCoverageReader() = default;
 
+  Error decodeRecord(const ProfileMappingRecord &R,
+                     DecodedCoverageMappingRecord &Record) const;
+
 public:
   BinaryCoverageReader(const BinaryCoverageReader &) = delete;
   BinaryCoverageReader &operator=(const BinaryCoverageReader &) = delete;
@@ -214,6 +250,9 @@ public:
                                  support::endianness Endian);
 
   Error readNextRecord(CoverageMappingRecord &Record) override;
+
+  Error readNextRecords(std::vector<DecodedCoverageMappingRecord> &Records,
+                        size_t MaxRecords, ThreadPool *Pool) override;
 };
 
 } // end namespace coverage
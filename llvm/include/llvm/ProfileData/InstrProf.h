@@ -157,6 +157,24 @@ inline StringRef getInstrProfRuntimeHookVarUseFuncName() {
   return "__llvm_profile_runtime_user";
 }
 
+/// Return the name of the variable holding the offset that is added to the
+/// counter addresses when runtime counter relocation is enabled.
+inline StringRef getInstrProfCounterBiasVarName() {
+  return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_COUNTER_BIAS_VAR);
+}
+
+/// Return the name of the thread local variable holding the offset to the
+/// counters of the current thread when per-thread counters are enabled.
+inline StringRef getInstrProfThreadCounterBiasVarName() {
+  return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_THREAD_COUNTER_BIAS_VAR);
+}
+
+/// Return the name of the runtime function that allocates the counters of
+/// the current thread and returns the offset to them.
+inline StringRef getInstrProfThreadCounterBiasFuncName() {
+  return INSTR_PROF_QUOTE(INSTR_PROF_PROFILE_GET_THREAD_COUNTER_BIAS_FUNC);
+}
+
 /// Return the marker used to separate PGO names during serialization.
 inline StringRef getInstrProfNameSeparator() { return "\01"; }
 
@@ -27,6 +27,7 @@ namespace llvm {
 
 /// Writer for instrumentation based profile data.
 class InstrProfRecordWriterTrait;
+class InstrProfSummaryBuilder;
 class ProfOStream;
 class raw_fd_ostream;
 
@@ -43,6 +44,14 @@ private:
   // Use raw pointer here for the incomplete type object.
   InstrProfRecordWriterTrait *InfoObj;
 
+  // The records written out by spillRecords(), as offsets and sizes in the
+  // spill file, and the summaries of their counts.
+  StringMap<std::pair<uint64_t, uint64_t>> SpilledData;
+  std::string SpillPath;
+  std::unique_ptr<raw_fd_ostream> SpillFile;
+  std::unique_ptr<InstrProfSummaryBuilder> SpillSummary;
+  std::unique_ptr<InstrProfSummaryBuilder> SpillCSSummary;
+
 public:
   InstrProfWriter(bool Sparse = false);
   ~InstrProfWriter();
@@ -60,6 +69,13 @@ public:
   void mergeRecordsFromWriter(InstrProfWriter &&IPW,
                               function_ref<void(Error)> Warn);
 
+  /// Serialize the records added so far to a temporary file and free them.
+  /// They are copied to the indexed profile by write(), which allows to merge
+  /// a profile that doesn't fit in memory one part at a time. No records may
+  /// be added for a function after it has been spilled, and the text format
+  /// can't be written once records have been spilled.
+  Error spillRecords();
+
   /// Write the profile to \c OS
   void write(raw_fd_ostream &OS);
 
@@ -110,6 +126,7 @@ private:
   void addRecord(StringRef Name, uint64_t Hash, InstrProfRecord &&I,
                  uint64_t Weight, function_ref<void(Error)> Warn);
   bool shouldEncodeData(const ProfilingData &PD);
+  uint64_t writeSpilledRecords(raw_ostream &OS);
   void writeImpl(ProfOStream &OS);
 };
 
@@ -0,0 +1,90 @@
+//===-- BitstreamRemarkContainer.h - Container for remarks ------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file defines the block and record IDs of the bitstream remark
+// container, a compact alternative to YAML remark files. It is laid out as
+// follows:
+//
+//   <magic number: "RMRK">
+//   <BLOCKINFO_BLOCK: abbreviations for the blocks below>
+//   <META_BLOCK: container version, remark version>
+//   <REMARK_BLOCK>*
+//
+// Each REMARK_BLOCK describes one remark. Strings are only emitted once: the
+// first remark that uses a string starts with a RECORD_REMARK_STRING for it,
+// which assigns it the next ID in the string table. All the other records
+// refer to strings by ID. This lets the container be written as a stream, one
+// remark at a time, and be read without copying any string.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_REMARKS_BITSTREAM_REMARK_CONTAINER_H
+#define LLVM_REMARKS_BITSTREAM_REMARK_CONTAINER_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/BitCodes.h"
+#include <cstdint>
+
+namespace llvm {
+namespace remarks {
+
+/// The magic number used for identifying remark blocks.
+constexpr StringRef ContainerMagic("RMRK", 4);
+
+/// Current version for the format used by the bitstream remark container.
+constexpr uint64_t CurrentContainerVersion = 0;
+
+/// The block IDs used by the bitstream remark container.
+enum BlockIDs {
+  /// The metadata block is mandatory. It should always come after the
+  /// BLOCKINFO_BLOCK, and contains metadata that should be used when parsing
+  /// REMARK_BLOCKs.
+  META_BLOCK_ID = bitc::FIRST_APPLICATION_BLOCKID,
+  /// One remark entry is represented using a REMARK_BLOCK.
+  REMARK_BLOCK_ID
+};
+
+constexpr StringRef MetaBlockName = StringRef("Meta", 4);
+constexpr StringRef RemarkBlockName = StringRef("Remark", 6);
+
+/// The record IDs used by the bitstream remark container.
+enum RecordIDs {
+  // Meta block records.
+  RECORD_META_CONTAINER_INFO = 1,
+  RECORD_META_REMARK_VERSION,
+  // Remark block records.
+  RECORD_REMARK_STRING,
+  RECORD_REMARK_HEADER,
+  RECORD_REMARK_DEBUG_LOC,
+  RECORD_REMARK_HOTNESS,
+  RECORD_REMARK_ARG_WITH_DEBUGLOC,
+  RECORD_REMARK_ARG_WITHOUT_DEBUGLOC,
+  // Update this when adding new records.
+  RECORD_FIRST = RECORD_META_CONTAINER_INFO,
+  RECORD_LAST = RECORD_REMARK_ARG_WITHOUT_DEBUGLOC
+};
+
+constexpr StringRef MetaContainerInfoName = StringRef("Container info", 14);
+constexpr StringRef MetaRemarkVersionName = StringRef("Remark version", 14);
+constexpr StringRef RemarkStringName = StringRef("String", 6);
+constexpr StringRef RemarkHeaderName = StringRef("Remark header", 13);
+constexpr StringRef RemarkDebugLocName = StringRef("Remark debug location", 21);
+constexpr StringRef RemarkHotnessName = StringRef("Remark hotness", 14);
+constexpr StringRef RemarkArgWithDebugLocName =
+    StringRef("Argument with debug location", 28);
+constexpr StringRef RemarkArgWithoutDebugLocName = StringRef("Argument", 8);
+
+/// Returns true if \p Buf holds a bitstream remark container.
+inline bool isBitstreamRemarkContainer(StringRef Buf) {
+  return Buf.startswith(ContainerMagic);
+}
+
+} // end namespace remarks
+} // end namespace llvm
+
+#endif /* LLVM_REMARKS_BITSTREAM_REMARK_CONTAINER_H */
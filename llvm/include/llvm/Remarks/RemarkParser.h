@@ -30,7 +30,8 @@ struct Parser {
   std::unique_ptr<ParserImpl> Impl;
 
   /// Create a parser parsing \p Buffer to Remark objects.
-  /// This constructor should be only used for parsing YAML remarks.
+  /// The format is detected from the contents of \p Buffer: bitstream remark
+  /// containers start with a magic number, anything else is parsed as YAML.
   Parser(StringRef Buffer);
 
   /// Create a parser parsing \p Buffer to Remark objects, using \p StrTabBuf as
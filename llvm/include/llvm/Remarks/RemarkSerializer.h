@@ -13,6 +13,8 @@
 #ifndef LLVM_REMARKS_REMARK_SERIALIZER_H
 #define LLVM_REMARKS_REMARK_SERIALIZER_H
 
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitstreamWriter.h"
 #include "llvm/Remarks/Remark.h"
 #include "llvm/Remarks/RemarkStringTable.h"
 #include "llvm/Support/YAMLTraits.h"
@@ -62,6 +64,43 @@ struct YAMLSerializer : public Serializer {
   void emit(const Remark &Remark) override;
 };
 
+/// Serialize the remarks to a bitstream remark container (see
+/// BitstreamRemarkContainer.h). The container is self-contained: its strings
+/// are emitted in the stream the first time they are used, so StrTab is not
+/// used. Each remark is written to the stream as soon as it is emitted.
+struct BitstreamSerializer : public Serializer {
+  /// Holds the encoding of the remark being emitted until it is written out.
+  SmallVector<char, 1024> Encoded;
+  /// The bitstream writer encoding to Encoded.
+  BitstreamWriter Bitstream;
+  /// The strings already emitted, and their IDs.
+  StringTable Strings;
+  /// Reusable buffer for the record being emitted.
+  SmallVector<uint64_t, 8> R;
+
+  /// Abbreviations used in the REMARK_BLOCK.
+  unsigned RecordRemarkStringAbbrevID = 0;
+  unsigned RecordRemarkHeaderAbbrevID = 0;
+  unsigned RecordRemarkDebugLocAbbrevID = 0;
+  unsigned RecordRemarkHotnessAbbrevID = 0;
+  unsigned RecordRemarkArgWithDebugLocAbbrevID = 0;
+  unsigned RecordRemarkArgWithoutDebugLocAbbrevID = 0;
+
+  /// Writes the container header to \p OS.
+  BitstreamSerializer(raw_ostream &OS);
+
+  /// Emit a remark to the stream.
+  void emit(const Remark &Remark) override;
+
+private:
+  /// Returns the ID of \p Str, first emitting it if this is its first use.
+  uint64_t useString(StringRef Str);
+  void setupBlockInfo();
+  void emitMetaBlock();
+  /// Write the encoded bits to the stream.
+  void flush();
+};
+
 } // end namespace remarks
 } // end namespace llvm
 
@@ -7,7 +7,8 @@
 //===----------------------------------------------------------------------===//
 /// \file
 ///
-/// This file defines the MallocAllocator and BumpPtrAllocator interfaces. Both
+/// This file defines the MallocAllocator, BumpPtrAllocator and
+/// ThreadSafeBumpPtrAllocator interfaces. All
 /// of these conform to an LLVM "Allocator" concept which consists of an
 /// Allocate method accepting a size and alignment, and a Deallocate accepting
 /// a pointer and size. Further, the LLVM "Allocator" concept has overloads of
@@ -27,11 +28,13 @@
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemAlloc.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <iterator>
+#include <new>
 #include <type_traits>
 #include <utility>
 
@@ -119,6 +122,10 @@ namespace detail {
 void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
                                 size_t TotalMemory);
 
+// A small number identifying the calling thread, handed out in the order in
+// which threads first ask for it.
+unsigned getBumpPtrAllocatorThreadIndex();
+
 } // end namespace detail
 
 /// Allocate memory in an ever growing pool, as if by bump-pointer.
@@ -490,6 +497,267 @@ public:
   T *Allocate(size_t num = 1) { return Allocator.Allocate<T>(num); }
 };
 
+/// A bump-pointer allocator which can be used by several threads at once.
+///
+/// Allocation is lock-free. The allocator keeps NumShards current slabs, and
+/// each thread bumps an atomic offset in the slab of the shard it maps to, so
+/// threads only contend when they share a shard. A thread which finds its slab
+/// full allocates a new one, publishes it on an atomic list of all slabs and
+/// installs it as the current slab of its shard.
+///
+/// As with BumpPtrAllocatorImpl, memory is only released by Reset() and the
+/// destructor, which must not run concurrently with Allocate(). AllocatorT
+/// must itself be thread-safe, as MallocAllocator is.
+template <typename AllocatorT = MallocAllocator, size_t SlabSize = 4096,
+          size_t SizeThreshold = SlabSize, unsigned NumShards = 16>
+class ThreadSafeBumpPtrAllocatorImpl
+    : public AllocatorBase<ThreadSafeBumpPtrAllocatorImpl<
+          AllocatorT, SlabSize, SizeThreshold, NumShards>> {
+public:
+  static_assert(SizeThreshold <= SlabSize,
+                "The SizeThreshold must be at most the SlabSize to ensure "
+                "that objects larger than a slab go into their own memory "
+                "allocation.");
+  static_assert(NumShards > 0, "At least one shard is needed.");
+
+  ThreadSafeBumpPtrAllocatorImpl() = default;
+
+  template <typename T>
+  ThreadSafeBumpPtrAllocatorImpl(T &&Allocator)
+      : Allocator(std::forward<T &&>(Allocator)) {}
+
+  ThreadSafeBumpPtrAllocatorImpl(const ThreadSafeBumpPtrAllocatorImpl &) =
+      delete;
+  ThreadSafeBumpPtrAllocatorImpl &
+  operator=(const ThreadSafeBumpPtrAllocatorImpl &) = delete;
+
+  ~ThreadSafeBumpPtrAllocatorImpl() { DeallocateSlabs(); }
+
+  /// Deallocate all slabs, freeing all memory allocated so far.
+  void Reset() {
+    DeallocateSlabs();
+    for (Shard &S : Shards)
+      S.Cur.store(nullptr, std::memory_order_relaxed);
+    BytesAllocated.store(0, std::memory_order_relaxed);
+  }
+
+  /// Allocate space at the specified alignment.
+  LLVM_ATTRIBUTE_RETURNS_NONNULL LLVM_ATTRIBUTE_RETURNS_NOALIAS void *
+  Allocate(size_t Size, size_t Alignment) {
+    assert(Alignment > 0 && "0-byte alignnment is not allowed. Use 1 instead.");
+
+    BytesAllocated.fetch_add(Size, std::memory_order_relaxed);
+
+    // If Size is really big, allocate a separate slab for it.
+    size_t PaddedSize = Size + Alignment - 1;
+    assert(PaddedSize >= Size && "Size + Alignment must not overflow");
+    if (PaddedSize > SizeThreshold) {
+      Slab *NewSlab = StartNewSlab(PaddedSize);
+      char *AlignedPtr = NewSlab->tryAllocate(Size, Alignment);
+      assert(AlignedPtr && "Unable to allocate memory!");
+      PublishSlab(NewSlab);
+      return MarkAllocated(AlignedPtr, Size);
+    }
+
+    Shard &S = Shards[detail::getBumpPtrAllocatorThreadIndex() % NumShards];
+    Slab *CurSlab = S.Cur.load(std::memory_order_acquire);
+    if (CurSlab)
+      if (char *AlignedPtr = CurSlab->tryAllocate(Size, Alignment))
+        return MarkAllocated(AlignedPtr, Size);
+
+    // Otherwise, start a new slab. If another thread of the shard has
+    // installed a fresh slab meanwhile, keep that one as the current slab;
+    // ours stays on the slab list and only serves this allocation.
+    Slab *NewSlab = StartNewSlab(
+        computeSlabSize(NumSlabs.fetch_add(1, std::memory_order_relaxed)));
+    char *AlignedPtr = NewSlab->tryAllocate(Size, Alignment);
+    assert(AlignedPtr && "Unable to allocate memory!");
+    PublishSlab(NewSlab);
+    S.Cur.compare_exchange_strong(CurSlab, NewSlab, std::memory_order_release,
+                                  std::memory_order_relaxed);
+    return MarkAllocated(AlignedPtr, Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ThreadSafeBumpPtrAllocatorImpl>::Allocate;
+
+  // Bump pointer allocators are expected to never free their storage; and
+  // clients expect pointers to remain valid for non-dereferencing uses even
+  // after deallocation.
+  void Deallocate(const void *Ptr, size_t Size) {
+    __asan_poison_memory_region(Ptr, Size);
+  }
+
+  // Pull in base class overloads.
+  using AllocatorBase<ThreadSafeBumpPtrAllocatorImpl>::Deallocate;
+
+  size_t GetNumSlabs() const {
+    size_t NumSlabs = 0;
+    for (const Slab *S = SlabList.load(std::memory_order_acquire); S;
+         S = S->Next)
+      ++NumSlabs;
+    return NumSlabs;
+  }
+
+  size_t getTotalMemory() const {
+    size_t TotalMemory = 0;
+    for (const Slab *S = SlabList.load(std::memory_order_acquire); S;
+         S = S->Next)
+      TotalMemory += S->Size;
+    return TotalMemory;
+  }
+
+  size_t getBytesAllocated() const {
+    return BytesAllocated.load(std::memory_order_relaxed);
+  }
+
+  void PrintStats() const {
+    detail::printBumpPtrAllocatorStats(GetNumSlabs(), getBytesAllocated(),
+                                       getTotalMemory());
+  }
+
+private:
+  /// A slab of memory, followed by Size bytes handed out front to back.
+  struct Slab {
+    Slab(size_t Size) : Size(Size) {}
+
+    char *begin() { return reinterpret_cast<char *>(this + 1); }
+    char *end() { return begin() + Used.load(std::memory_order_relaxed); }
+
+    /// Bump Used to make room for \p Size bytes at \p Alignment, or return
+    /// null if the slab is too full.
+    char *tryAllocate(size_t Size, size_t Alignment) {
+      size_t Offset = Used.load(std::memory_order_relaxed);
+      while (true) {
+        size_t Adjustment = alignmentAdjustment(begin() + Offset, Alignment);
+        if (Adjustment + Size > this->Size - Offset)
+          return nullptr;
+        if (Used.compare_exchange_weak(Offset, Offset + Adjustment + Size,
+                                       std::memory_order_relaxed))
+          return begin() + Offset + Adjustment;
+      }
+    }
+
+    /// The next slab in the list of all slabs.
+    Slab *Next = nullptr;
+
+    /// The number of bytes following the header.
+    const size_t Size;
+
+    /// The number of bytes handed out so far, including alignment padding.
+    std::atomic<size_t> Used{0};
+  };
+
+  /// The current slab of a group of threads, on its own cache line so that
+  /// the shards do not contend with each other.
+  struct alignas(64) Shard {
+    std::atomic<Slab *> Cur{nullptr};
+  };
+
+  Shard Shards[NumShards];
+
+  /// All slabs allocated so far, most recent first.
+  std::atomic<Slab *> SlabList{nullptr};
+
+  /// The number of regular slabs started, which drives their growth.
+  std::atomic<unsigned> NumSlabs{0};
+
+  /// How many bytes we've allocated.
+  ///
+  /// Used so that we can compute how much space was wasted.
+  std::atomic<size_t> BytesAllocated{0};
+
+  /// The allocator instance we use to get slabs of memory.
+  AllocatorT Allocator;
+
+  static size_t computeSlabSize(unsigned SlabIdx) {
+    // Grow the slabs as BumpPtrAllocatorImpl does.
+    return SlabSize * ((size_t)1 << std::min<size_t>(30, SlabIdx / 128));
+  }
+
+  static char *MarkAllocated(char *AlignedPtr, size_t Size) {
+    // Update the allocation point of this memory block in MemorySanitizer.
+    // Without this, MemorySanitizer messages for values originated from here
+    // will point to the allocation of the entire slab.
+    __msan_allocated_memory(AlignedPtr, Size);
+    // Similarly, tell ASan about this space.
+    __asan_unpoison_memory_region(AlignedPtr, Size);
+    return AlignedPtr;
+  }
+
+  /// Allocate a new slab of \p Size usable bytes, not yet visible to other
+  /// threads.
+  Slab *StartNewSlab(size_t Size) {
+    void *NewSlab = Allocator.Allocate(sizeof(Slab) + Size, alignof(Slab));
+    Slab *S = new (NewSlab) Slab(Size);
+    // We own the new slab and don't want anyone reading anything other than
+    // pieces returned from this method.  So poison the whole slab.
+    __asan_poison_memory_region(S->begin(), Size);
+    return S;
+  }
+
+  /// Add \p S to the list of all slabs.
+  void PublishSlab(Slab *S) {
+    S->Next = SlabList.load(std::memory_order_relaxed);
+    while (!SlabList.compare_exchange_weak(S->Next, S,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed))
+      ;
+  }
+
+  /// Deallocate all slabs.
+  void DeallocateSlabs() {
+    Slab *S = SlabList.exchange(nullptr, std::memory_order_acquire);
+    while (S) {
+      Slab *Next = S->Next;
+      size_t AllocatedSize = sizeof(Slab) + S->Size;
+      S->~Slab();
+      Allocator.Deallocate(S, AllocatedSize);
+      S = Next;
+    }
+    NumSlabs.store(0, std::memory_order_relaxed);
+  }
+
+  template <typename T> friend class ThreadSafeSpecificBumpPtrAllocator;
+};
+
+/// The standard ThreadSafeBumpPtrAllocator which just uses the default
+/// template parameters.
+typedef ThreadSafeBumpPtrAllocatorImpl<> ThreadSafeBumpPtrAllocator;
+
+/// A ThreadSafeBumpPtrAllocator that allows only elements of a specific type
+/// to be allocated.
+///
+/// This allows calling the destructor in DestroyAll() and when the allocator is
+/// destroyed. Like Reset(), DestroyAll() must not run concurrently with
+/// Allocate().
+template <typename T> class ThreadSafeSpecificBumpPtrAllocator {
+  ThreadSafeBumpPtrAllocator Allocator;
+
+public:
+  ThreadSafeSpecificBumpPtrAllocator() = default;
+  ~ThreadSafeSpecificBumpPtrAllocator() { DestroyAll(); }
+
+  /// Call the destructor of each allocated object and deallocate all slabs,
+  /// freeing all memory allocated so far.
+  void DestroyAll() {
+    // Every slab holds a contiguous run of elements: the first one is aligned
+    // and sizeof(T) keeps the following ones aligned.
+    for (auto *S = Allocator.SlabList.load(std::memory_order_acquire); S;
+         S = S->Next) {
+      char *End = S->end();
+      for (char *Ptr = (char *)alignAddr(S->begin(), alignof(T));
+           Ptr + sizeof(T) <= End; Ptr += sizeof(T))
+        reinterpret_cast<T *>(Ptr)->~T();
+    }
+
+    Allocator.Reset();
+  }
+
+  /// Allocate space for an array of objects without constructing them.
+  T *Allocate(size_t num = 1) { return Allocator.Allocate<T>(num); }
+};
+
 } // end namespace llvm
 
 template <typename AllocatorT, size_t SlabSize, size_t SizeThreshold>
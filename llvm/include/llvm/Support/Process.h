@@ -69,6 +69,11 @@ public:
   /// allocated space.
   static size_t GetMallocUsage();
 
+  /// This static function will return the largest amount of physical memory
+  /// the process has used at once so far, in bytes, or 0 if the operating
+  /// system doesn't tell.
+  static size_t GetPeakRSS();
+
   /// This static function will set \p user_time to the amount of CPU time
   /// spent in user (non-kernel) mode and \p sys_time to the amount of CPU
   /// time spent in system (kernel) mode.  If the operating system does not
@@ -18,8 +18,12 @@ extern TimeTraceProfiler *TimeTraceProfilerInstance;
 
 /// Initialize the time trace profiler.
 /// This sets up the global \p TimeTraceProfilerInstance
-/// variable to be the profiler instance.
-void timeTraceProfilerInitialize();
+/// variable to be the profiler instance. \p ProcName is the process name
+/// shown by trace viewers.
+///
+/// Sections may be opened and closed from any thread; events of each thread
+/// are reported under their own thread id.
+void timeTraceProfilerInitialize(StringRef ProcName);
 
 /// Cleanup the time trace profiler, if it was initialized.
 void timeTraceProfilerCleanup();
@@ -34,6 +38,14 @@ inline bool timeTraceProfilerEnabled() {
 /// https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU/preview
 void timeTraceProfilerWrite(raw_pwrite_stream &OS);
 
+/// Write a summary of all sections to output file, regardless of the time
+/// granularity. For every pair of section name and detail, e.g. a header or a
+/// template specialization, it contains the number of sections, their total
+/// time and their self time (without nested sections) in microseconds.
+/// Data produced is JSON; summaries of several runs can be merged by adding
+/// up the entries with the same name and detail.
+void timeTraceProfilerWriteSummary(raw_pwrite_stream &OS);
+
 /// Manually begin a time section, with the given \p Name and \p Detail.
 /// Profiler copies the string data, so the pointers can be given into
 /// temporaries. Time sections can be hierarchical; every Begin must have a
@@ -13,6 +13,10 @@
 #ifndef LLVM_TABLEGEN_MAIN_H
 #define LLVM_TABLEGEN_MAIN_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include <functional>
+#include <string>
+
 namespace llvm {
 
 class raw_ostream;
@@ -24,6 +28,18 @@ using TableGenMainFn = bool (raw_ostream &OS, RecordKeeper &Records);
 
 int TableGenMain(char *argv0, TableGenMainFn *MainFn);
 
+/// A backend to run on the parsed records, and the file to write its output
+/// to.
+struct TableGenJob {
+  std::string OutputFilename;
+  std::function<bool(raw_ostream &OS, RecordKeeper &Records)> MainFn;
+};
+
+/// Parse the input once and run each of Jobs on the records, in order. This
+/// saves re-parsing the input for each backend. The -o option is ignored, and
+/// the dependency file names every output file.
+int TableGenMain(char *argv0, ArrayRef<TableGenJob> Jobs);
+
 } // end namespace llvm
 
 #endif // LLVM_TABLEGEN_MAIN_H
@@ -118,6 +118,13 @@ public:
   virtual bool shouldPutJumpTableInFunctionSection(bool UsesLabelDifference,
                                                    const Function &F) const;
 
+  /// Return the section for the cold blocks that were split from the rest of
+  /// \p F, or null if they can't be placed in a section of their own.
+  virtual MCSection *getSectionForColdFragment(const Function &F,
+                                               const TargetMachine &TM) const {
+    return nullptr;
+  }
+
   /// Targets should implement this method to assign a section to globals with
   /// an explicit section specfied. The implementation of this method can
   /// assume that GO->hasSection() is true.
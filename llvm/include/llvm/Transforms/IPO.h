@@ -275,6 +275,7 @@ ModulePass *createWriteThinLTOBitcodePass(raw_ostream &Str,
                                           raw_ostream *ThinLinkOS = nullptr);
 ModulePass *createOmpTgtAddrTransPass();
 ModulePass *createRestoreLoadPass();
+ModulePass *createConcurrentATPass();
 
 } // End llvm namespace
 
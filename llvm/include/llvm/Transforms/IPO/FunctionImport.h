@@ -183,10 +183,6 @@ void computeDeadSymbolsWithConstProp(
     function_ref<PrevailingType(GlobalValue::GUID)> isPrevailing,
     bool ImportEnabled);
 
-/// Converts value \p GV to declaration, or replaces with a declaration if
-/// it is an alias. Returns true if converted, false if replaced.
-bool convertToDeclaration(GlobalValue &GV);
-
 /// Compute the set of summaries needed for a ThinLTO backend compilation of
 /// \p ModulePath.
 //
@@ -0,0 +1,35 @@
+//===- FunctionLayout.h - Profile guided function layout --------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass lays out the functions of a module by hotness when a profile is
+// available: hot functions go first, ordered so that callers are next to their
+// hot callees, and cold functions go last. Hot and cold functions also get
+// the .hot and .unlikely section prefixes, so that the linker can group them
+// across modules. It only looks at the module it runs on, so it works in the
+// backends of a ThinLTO build.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_FUNCTIONLAYOUT_H
+#define LLVM_TRANSFORMS_IPO_FUNCTIONLAYOUT_H
+
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+class Module;
+
+/// A pass that orders the functions of a module by the profile.
+class FunctionLayoutPass : public PassInfoMixin<FunctionLayoutPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_FUNCTIONLAYOUT_H
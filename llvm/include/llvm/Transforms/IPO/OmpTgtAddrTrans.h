@@ -0,0 +1,44 @@
+//===-- OmpTgtAddrTrans.h - OpenMP offloading address translation ---------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// \file
+/// New pass manager versions of the address translation passes for NVPTX
+/// OpenMP offloading. The legacy versions are created by
+/// createOmpTgtAddrTransPass, createRestoreLoadPass and
+/// createConcurrentATPass.
+///
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_IPO_OMPTGTADDRTRANS_H
+#define LLVM_TRANSFORMS_IPO_OMPTGTADDRTRANS_H
+
+#include "llvm/IR/PassManager.h"
+
+namespace llvm {
+
+/// Translates host addresses used by offloaded kernels to device addresses.
+class OmpTgtAddrTransPass : public PassInfoMixin<OmpTgtAddrTransPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+/// Turns the fake load calls of OmpTgtAddrTransPass back into loads.
+class RestoreLoadPass : public PassInfoMixin<RestoreLoadPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+/// Translates warp uniform addresses once per warp.
+class ConcurrentATPass : public PassInfoMixin<ConcurrentATPass> {
+public:
+  PreservedAnalyses run(Module &M, ModuleAnalysisManager &AM);
+};
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_IPO_OMPTGTADDRTRANS_H
@@ -13,6 +13,7 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/ValueHandle.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
@@ -27,6 +28,12 @@ class InstCombineWorklist {
   SmallVector<Instruction*, 256> Worklist;
   DenseMap<Instruction*, unsigned> WorklistMap;
 
+  /// Instructions added one at a time since the last call to clearAdded(),
+  /// i.e. the ones a combine created or changed and their users. Entries are
+  /// nulled out when the instruction is deleted.
+  SmallVector<WeakVH, 64> Added;
+  bool AddedTerminator = false;
+
 public:
   InstCombineWorklist() = default;
 
@@ -41,6 +48,9 @@ public:
     if (WorklistMap.insert(std::make_pair(I, Worklist.size())).second) {
       LLVM_DEBUG(dbgs() << "IC: ADD: " << *I << '\n');
       Worklist.push_back(I);
+      Added.push_back(I);
+      AddedTerminator |=
+          I->isTerminator() && I->getOpcode() != Instruction::Ret;
     }
   }
 
@@ -92,6 +102,21 @@ public:
   }
 
 
+  /// getAdded - Return the instructions passed to Add since the last call to
+  /// clearAdded, in the order they were added. Deleted ones are null and an
+  /// instruction may appear more than once.
+  ArrayRef<WeakVH> getAdded() const { return Added; }
+
+  /// hasAddedTerminator - Return true if a terminator other than a return,
+  /// which may have changed what is reachable, was passed to Add since the
+  /// last call to clearAdded.
+  bool hasAddedTerminator() const { return AddedTerminator; }
+
+  void clearAdded() {
+    Added.clear();
+    AddedTerminator = false;
+  }
+
   /// Zap - check that the worklist is empty and nuke the backing store for
   /// the map if it is large.
   void Zap() {
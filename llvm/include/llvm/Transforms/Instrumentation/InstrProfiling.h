@@ -67,6 +67,10 @@ private:
   // vector of counter load/store pairs to be register promoted.
   std::vector<LoadStorePair> PromotionCandidates;
 
+  // The counter bias computed at the start of each function, when runtime
+  // counter relocation or per-thread counters are enabled.
+  DenseMap<const Function *, Instruction *> FunctionToProfileBiasMap;
+
   // The start value of precise value profile range for memory intrinsic sizes.
   int64_t MemOPSizeRangeStart;
   // The end value of precise value profile range for memory intrinsic sizes.
@@ -84,12 +88,29 @@ private:
   /// Returns true if profile counter update register promotion is enabled.
   bool isCounterPromotionEnabled() const;
 
+  /// Returns true if the counters are addressed through a bias that the
+  /// runtime can change, e.g. to point them at a mapped profile file.
+  bool isRuntimeCounterRelocationEnabled() const;
+
+  /// Returns true if each thread updates its own copy of the counters.
+  bool isPerThreadCountersEnabled() const;
+
+  /// Load the bias set by the runtime at the start of \p Fn.
+  Instruction *emitCounterBiasLoad(Function *Fn);
+
+  /// Compute the bias to the counters of the current thread at the start of
+  /// \p Fn, asking the runtime for them on the first call in the thread.
+  Instruction *emitThreadCounterBias(Function *Fn);
+
   /// Count the number of instrumented value sites for the function.
   void computeNumValueSiteCounts(InstrProfValueProfileInst *Ins);
 
   /// Replace instrprof_value_profile with a call to runtime library.
   void lowerValueProfileInst(InstrProfValueProfileInst *Ins);
 
+  /// Return the address of the counter updated by an increment.
+  Value *getCounterAddress(InstrProfIncrementInst *Inc);
+
   /// Replace instrprof_increment with an increment of the appropriate value.
   void lowerIncrement(InstrProfIncrementInst *Inc);
 
@@ -0,0 +1,46 @@
+//===- CallGraphSort.h - Call-Chain Clustering of a call graph --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This header defines computeCallGraphSortOrder, which orders the nodes of a
+// weighted call graph with the Call-Chain Clustering (C³) heuristic. It is
+// shared by the linker, which orders input sections, and by the middle end,
+// which orders the functions of a module.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_TRANSFORMS_UTILS_CALLGRAPHSORT_H
+#define LLVM_TRANSFORMS_UTILS_CALLGRAPHSORT_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+
+/// A call from node \c From to node \c To of the graph, taken \c Weight times.
+/// An edge from a node to itself adds to the weight of the node without
+/// making it a candidate for merging.
+struct CallGraphSortEdge {
+  unsigned From;
+  unsigned To;
+  uint64_t Weight;
+};
+
+/// Order the nodes of a call graph, whose sizes in bytes are \p NodeSizes, so
+/// that callers and their likely callees are close to each other and the
+/// nodes where most time is spent per byte come first.
+///
+/// \returns the indices of the nodes in the order they should be laid out.
+/// Nodes of size zero that were not merged with another node are left out.
+std::vector<unsigned>
+computeCallGraphSortOrder(ArrayRef<uint64_t> NodeSizes,
+                          ArrayRef<CallGraphSortEdge> Edges);
+
+} // end namespace llvm
+
+#endif // LLVM_TRANSFORMS_UTILS_CALLGRAPHSORT_H
@@ -16,10 +16,13 @@
 #define LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
 
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Error.h"
 #include <memory>
 
 namespace llvm {
 
+class GlobalValue;
 class Module;
 
 /// Splits the module M into N linkable partitions. The function ModuleCallback
@@ -37,6 +40,30 @@ void SplitModule(
     function_ref<void(std::unique_ptr<Module> MPart)> ModuleCallback,
     bool PreserveLocals = false);
 
+/// Assign the definitions of M to N partitions the way SplitModule does. The
+/// function PartitionCallback is called once for every global value that has
+/// a definition, passing the (0-based) partition it belongs to.
+///
+/// Unless PreserveLocals is set, M is changed first, exactly as by SplitModule:
+/// local symbols get external hidden linkage and unnamed globals get a name, so
+/// that the partitions can refer to each other by name. This lets a caller
+/// that builds the partitions itself, e.g. by loading M from bitcode once per
+/// partition, get the same partitions as SplitModule without any cloning.
+void computeSplitModulePartitions(
+    Module &M, unsigned N,
+    function_ref<void(const GlobalValue &GV, unsigned Partition)>
+        PartitionCallback,
+    bool PreserveLocals = false);
+
+/// Turn M, loaded lazily from the bitcode of a module partitioned by
+/// computeSplitModulePartitions, into partition I, given the partition of each
+/// definition by name in PartitionOf. The definitions of other partitions
+/// become declarations and only the function bodies of partition I are read.
+/// As with SplitModule, only partition 0 keeps the module-level inline asm.
+Error materializeSplitModulePartition(Module &M,
+                                      const StringMap<unsigned> &PartitionOf,
+                                      unsigned I);
+
 } // end namespace llvm
 
 #endif // LLVM_TRANSFORMS_UTILS_SPLITMODULE_H
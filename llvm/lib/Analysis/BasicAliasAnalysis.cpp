@@ -1281,6 +1281,25 @@ bool BasicAAResult::isGEPBaseAtNegativeOffset(const GEPOperator *GEPOp,
   return GEPBaseOffset.sge(ObjectBaseOffset + (int64_t)ObjectAccessSize);
 }
 
+bool BasicAAResult::getDecomposedGEP(const Value *V, DecomposedGEP &Decomposed,
+                                     AAQueryInfo &AAQI) {
+  if (!AAQI.DecomposedGEPCache)
+    AAQI.DecomposedGEPCache = make_unique<AAQueryInfo::DecomposedGEPCacheT>();
+
+  auto Pair = AAQI.DecomposedGEPCache->Entries.try_emplace(V);
+  auto &Entry = Pair.first->second;
+  if (Pair.second) {
+    unsigned MaxPointerSize = getMaxPointerSize(DL);
+    Entry.Decomposed.StructOffset = Entry.Decomposed.OtherOffset =
+        APInt(MaxPointerSize, 0);
+    Entry.MaxLookupReached =
+        DecomposeGEPExpression(V, Entry.Decomposed, DL, &AC, DT);
+  }
+  // The callers adjust their copy, e.g. with GetIndexDifference.
+  Decomposed = Entry.Decomposed;
+  return Entry.MaxLookupReached;
+}
+
 /// Provides a bunch of ad-hoc rules to disambiguate a GEP instruction against
 /// another pointer.
 ///
@@ -1292,14 +1311,8 @@ AliasResult BasicAAResult::aliasGEP(
     const Value *V2, LocationSize V2Size, const AAMDNodes &V2AAInfo,
     const Value *UnderlyingV1, const Value *UnderlyingV2, AAQueryInfo &AAQI) {
   DecomposedGEP DecompGEP1, DecompGEP2;
-  unsigned MaxPointerSize = getMaxPointerSize(DL);
-  DecompGEP1.StructOffset = DecompGEP1.OtherOffset = APInt(MaxPointerSize, 0);
-  DecompGEP2.StructOffset = DecompGEP2.OtherOffset = APInt(MaxPointerSize, 0);
-
-  bool GEP1MaxLookupReached =
-    DecomposeGEPExpression(GEP1, DecompGEP1, DL, &AC, DT);
-  bool GEP2MaxLookupReached =
-    DecomposeGEPExpression(V2, DecompGEP2, DL, &AC, DT);
+  bool GEP1MaxLookupReached = getDecomposedGEP(GEP1, DecompGEP1, AAQI);
+  bool GEP2MaxLookupReached = getDecomposedGEP(V2, DecompGEP2, AAQI);
 
   APInt GEP1BaseOffset = DecompGEP1.StructOffset + DecompGEP1.OtherOffset;
   APInt GEP2BaseOffset = DecompGEP2.StructOffset + DecompGEP2.OtherOffset;
@@ -1445,7 +1458,7 @@ AliasResult BasicAAResult::aliasGEP(
   }
 
   if (!DecompGEP1.VarIndices.empty()) {
-    APInt Modulo(MaxPointerSize, 0);
+    APInt Modulo(getMaxPointerSize(DL), 0);
     bool AllPositive = true;
     for (unsigned i = 0, e = DecompGEP1.VarIndices.size(); i != e; ++i) {
 
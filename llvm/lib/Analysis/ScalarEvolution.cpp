@@ -145,6 +145,10 @@ STATISTIC(NumTripCountsNotComputed,
           "Number of loops without predictable loop counts");
 STATISTIC(NumBruteForceTripCountsComputed,
           "Number of loops with trip counts computed by force");
+STATISTIC(NumValueExprMapEvictions,
+          "Number of cached SCEVs evicted from the value map");
+STATISTIC(MaxSCEVMemoryKB,
+          "Maximum memory used by ScalarEvolution for a function (KB)");
 
 static cl::opt<unsigned>
 MaxBruteForceIterations("scalar-evolution-max-iterations", cl::ReallyHidden,
@@ -216,6 +220,12 @@ static cl::opt<unsigned>
                   cl::desc("Size of the expression which is considered huge"),
                   cl::init(4096));
 
+static cl::opt<unsigned> MaxValueCacheSize(
+    "scalar-evolution-max-value-cache-size", cl::Hidden,
+    cl::desc("Maximum number of values whose SCEV is cached, the least "
+             "recently used ones are evicted beyond it (0 = unlimited)"),
+    cl::init(0));
+
 //===----------------------------------------------------------------------===//
 //                           SCEV class definitions
 //===----------------------------------------------------------------------===//
@@ -3897,12 +3907,15 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
 
   const SCEV *S = getExistingSCEV(V);
   if (S == nullptr) {
+    ++GetSCEVDepth;
     S = createSCEV(V);
+    --GetSCEVDepth;
     // During PHI resolution, it is possible to create two SCEVs for the same
     // V, so it is needed to double check whether V->S is inserted into
     // ValueExprMap before insert S->{V, 0} into ExprValueMap.
     std::pair<ValueExprMapType::iterator, bool> Pair =
         ValueExprMap.insert({SCEVCallbackVH(V, this), S});
+    Pair.first->first.LastUse = ++ValueExprMapClock;
     if (Pair.second && !SCEVLostPoisonFlags(S, V)) {
       ExprValueMap[S].insert({V, nullptr});
 
@@ -3920,18 +3933,92 @@ const SCEV *ScalarEvolution::getSCEV(Value *V) {
           !isa<GetElementPtrInst>(V))
         ExprValueMap[Stripped].insert({V, Offset});
     }
+    if (MaxValueCacheSize && GetSCEVDepth == 0 &&
+        ValueExprMap.size() > MaxValueCacheSize)
+      trimValueExprMap();
   }
   return S;
 }
 
+/// Push users of the given Instruction onto the given Worklist.
+static void
+PushDefUseChildren(Instruction *I,
+                   SmallVectorImpl<Instruction *> &Worklist) {
+  // Push the def-use children onto the Worklist stack.
+  for (User *U : I->users())
+    Worklist.push_back(cast<Instruction>(U));
+}
+
+void ScalarEvolution::trimValueExprMap() {
+  // Trim down to three quarters of the limit, so that the cost of a trim is
+  // spread over the insertions that fill the map up again.
+  size_t NumToEvict = ValueExprMap.size() - MaxValueCacheSize / 4 * 3;
+  std::vector<uint64_t> Uses;
+  Uses.reserve(ValueExprMap.size());
+  for (auto &Entry : ValueExprMap)
+    Uses.push_back(Entry.first.LastUse);
+  std::nth_element(Uses.begin(), Uses.begin() + (NumToEvict - 1), Uses.end());
+  uint64_t Cutoff = Uses[NumToEvict - 1];
+
+  // forgetValue() only finds the results memoized for an instruction's SCEV,
+  // and for those of its users, through their entries in ValueExprMap. So an
+  // evicted instruction is forgotten together with its users, as forgetValue()
+  // would do, and they get their SCEVs computed again from scratch. Other
+  // values are never forgotten and only lose their cached SCEV.
+  SmallVector<Instruction *, 64> Worklist;
+  SmallVector<Value *, 64> ToEvict;
+  for (auto &Entry : ValueExprMap)
+    if (Entry.first.LastUse <= Cutoff) {
+      Value *V = Entry.first;
+      if (auto *I = dyn_cast<Instruction>(V))
+        Worklist.push_back(I);
+      else
+        ToEvict.push_back(V);
+    }
+  for (Value *V : ToEvict)
+    eraseValueFromMap(V);
+  size_t NumEvicted = ToEvict.size();
+
+  SmallVector<const SCEV *, 64> ToForget;
+  SmallPtrSet<Instruction *, 32> Visited;
+  while (!Worklist.empty()) {
+    Instruction *I = Worklist.pop_back_val();
+    if (!Visited.insert(I).second)
+      continue;
+
+    auto It = ValueExprMap.find_as(static_cast<Value *>(I));
+    if (It != ValueExprMap.end()) {
+      ToForget.push_back(It->second);
+      eraseValueFromMap(It->first);
+      ++NumEvicted;
+      if (PHINode *PN = dyn_cast<PHINode>(I))
+        ConstantEvolutionLoopExitValue.erase(PN);
+    }
+
+    PushDefUseChildren(I, Worklist);
+  }
+  forgetMemoizedResults(ToForget);
+  NumValueExprMapEvictions += NumEvicted;
+}
+
+size_t ScalarEvolution::getMemorySize() const {
+  return SCEVAllocator.getTotalMemory() + ValueExprMap.getMemorySize() +
+         ExprValueMap.getMemorySize() + ValuesAtScopes.getMemorySize() +
+         LoopDispositions.getMemorySize() + BlockDispositions.getMemorySize() +
+         UnsignedRanges.getMemorySize() + SignedRanges.getMemorySize() +
+         BackedgeTakenCounts.getMemorySize();
+}
+
 const SCEV *ScalarEvolution::getExistingSCEV(Value *V) {
   assert(isSCEVable(V->getType()) && "Value is not SCEVable!");
 
   ValueExprMapType::iterator I = ValueExprMap.find_as(V);
   if (I != ValueExprMap.end()) {
     const SCEV *S = I->second;
-    if (checkValidity(S))
+    if (checkValidity(S)) {
+      I->first.LastUse = ++ValueExprMapClock;
       return S;
+    }
     eraseValueFromMap(V);
     forgetMemoizedResults(S);
   }
@@ -4175,15 +4262,6 @@ const SCEV *ScalarEvolution::getPointerBase(const SCEV *V) {
   return V;
 }
 
-/// Push users of the given Instruction onto the given Worklist.
-static void
-PushDefUseChildren(Instruction *I,
-                   SmallVectorImpl<Instruction *> &Worklist) {
-  // Push the def-use children onto the Worklist stack.
-  for (User *U : I->users())
-    Worklist.push_back(cast<Instruction>(U));
-}
-
 void ScalarEvolution::forgetSymbolicName(Instruction *PN, const SCEV *SymName) {
   SmallVector<Instruction *, 16> Worklist;
   PushDefUseChildren(PN, Worklist);
@@ -6679,6 +6757,7 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
     PushLoopPHIs(L, Worklist);
 
     SmallPtrSet<Instruction *, 8> Discovered;
+    SmallVector<const SCEV *, 16> ToForget;
     while (!Worklist.empty()) {
       Instruction *I = Worklist.pop_back_val();
 
@@ -6695,7 +6774,7 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
         // own when it gets to that point.
         if (!isa<PHINode>(I) || !isa<SCEVUnknown>(Old)) {
           eraseValueFromMap(It->first);
-          forgetMemoizedResults(Old);
+          ToForget.push_back(Old);
         }
         if (PHINode *PN = dyn_cast<PHINode>(I))
           ConstantEvolutionLoopExitValue.erase(PN);
@@ -6727,6 +6806,7 @@ ScalarEvolution::getBackedgeTakenInfo(const Loop *L) {
             Worklist.push_back(I);
         }
     }
+    forgetMemoizedResults(ToForget);
   }
 
   // Re-lookup the insert position, since the call to
@@ -6771,30 +6851,26 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
       };
 
   SmallVector<const Loop *, 16> LoopWorklist(1, L);
+  SmallPtrSet<const Loop *, 16> ForgottenLoops;
   SmallVector<Instruction *, 32> Worklist;
   SmallPtrSet<Instruction *, 16> Visited;
+  // The SCEVs whose memoized results are dropped at the end. Dropping them
+  // together walks the per-loop caches once instead of once per SCEV, which
+  // made forgetting a deep loop nest quadratic.
+  SmallVector<const SCEV *, 32> ToForget;
 
   // Iterate over all the loops and sub-loops to drop SCEV information.
   while (!LoopWorklist.empty()) {
     auto *CurrL = LoopWorklist.pop_back_val();
+    ForgottenLoops.insert(CurrL);
 
     RemoveLoopFromBackedgeMap(BackedgeTakenCounts, CurrL);
     RemoveLoopFromBackedgeMap(PredicatedBackedgeTakenCounts, CurrL);
 
-    // Drop information about predicated SCEV rewrites for this loop.
-    for (auto I = PredicatedSCEVRewrites.begin();
-         I != PredicatedSCEVRewrites.end();) {
-      std::pair<const SCEV *, const Loop *> Entry = I->first;
-      if (Entry.second == CurrL)
-        PredicatedSCEVRewrites.erase(I++);
-      else
-        ++I;
-    }
-
     auto LoopUsersItr = LoopUsers.find(CurrL);
     if (LoopUsersItr != LoopUsers.end()) {
-      for (auto *S : LoopUsersItr->second)
-        forgetMemoizedResults(S);
+      ToForget.append(LoopUsersItr->second.begin(),
+                      LoopUsersItr->second.end());
       LoopUsers.erase(LoopUsersItr);
     }
 
@@ -6809,8 +6885,8 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
       ValueExprMapType::iterator It =
           ValueExprMap.find_as(static_cast<Value *>(I));
       if (It != ValueExprMap.end()) {
+        ToForget.push_back(It->second);
         eraseValueFromMap(It->first);
-        forgetMemoizedResults(It->second);
         if (PHINode *PN = dyn_cast<PHINode>(I))
           ConstantEvolutionLoopExitValue.erase(PN);
       }
@@ -6823,6 +6899,18 @@ void ScalarEvolution::forgetLoop(const Loop *L) {
     // ValuesAtScopes map.
     LoopWorklist.append(CurrL->begin(), CurrL->end());
   }
+
+  // Drop information about predicated SCEV rewrites for these loops.
+  for (auto I = PredicatedSCEVRewrites.begin();
+       I != PredicatedSCEVRewrites.end();) {
+    std::pair<const SCEV *, const Loop *> Entry = I->first;
+    if (ForgottenLoops.count(Entry.second))
+      PredicatedSCEVRewrites.erase(I++);
+    else
+      ++I;
+  }
+
+  forgetMemoizedResults(ToForget);
 }
 
 void ScalarEvolution::forgetTopmostLoop(const Loop *L) {
@@ -6840,6 +6928,7 @@ void ScalarEvolution::forgetValue(Value *V) {
   Worklist.push_back(I);
 
   SmallPtrSet<Instruction *, 8> Visited;
+  SmallVector<const SCEV *, 16> ToForget;
   while (!Worklist.empty()) {
     I = Worklist.pop_back_val();
     if (!Visited.insert(I).second)
@@ -6848,14 +6937,15 @@ void ScalarEvolution::forgetValue(Value *V) {
     ValueExprMapType::iterator It =
       ValueExprMap.find_as(static_cast<Value *>(I));
     if (It != ValueExprMap.end()) {
+      ToForget.push_back(It->second);
       eraseValueFromMap(It->first);
-      forgetMemoizedResults(It->second);
       if (PHINode *PN = dyn_cast<PHINode>(I))
         ConstantEvolutionLoopExitValue.erase(PN);
     }
 
     PushDefUseChildren(I, Worklist);
   }
+  forgetMemoizedResults(ToForget);
 }
 
 /// Get the exact loop backedge taken count considering all loop exits. A
@@ -6931,15 +7021,17 @@ bool ScalarEvolution::BackedgeTakenInfo::isMaxOrZero(ScalarEvolution *SE) const
   return MaxOrZero && !any_of(ExitNotTaken, PredicateNotAlwaysTrue);
 }
 
-bool ScalarEvolution::BackedgeTakenInfo::hasOperand(const SCEV *S,
-                                                    ScalarEvolution *SE) const {
+bool ScalarEvolution::BackedgeTakenInfo::hasAnyOperand(
+    const SmallPtrSetImpl<const SCEV *> &Ops, ScalarEvolution *SE) const {
+  auto IsOp = [&](const SCEV *X) { return Ops.count(X); };
+
   if (getMax() && getMax() != SE->getCouldNotCompute() &&
-      SE->hasOperand(getMax(), S))
+      SCEVExprContains(getMax(), IsOp))
     return true;
 
   for (auto &ENT : ExitNotTaken)
     if (ENT.ExactNotTaken != SE->getCouldNotCompute() &&
-        SE->hasOperand(ENT.ExactNotTaken, S))
+        SCEVExprContains(ENT.ExactNotTaken, IsOp))
       return true;
 
   return false;
@@ -11351,6 +11443,7 @@ ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
     : F(Arg.F), HasGuards(Arg.HasGuards), TLI(Arg.TLI), AC(Arg.AC), DT(Arg.DT),
       LI(Arg.LI), CouldNotCompute(std::move(Arg.CouldNotCompute)),
       ValueExprMap(std::move(Arg.ValueExprMap)),
+      ValueExprMapClock(Arg.ValueExprMapClock),
       PendingLoopPredicates(std::move(Arg.PendingLoopPredicates)),
       PendingPhiRanges(std::move(Arg.PendingPhiRanges)),
       PendingMerges(std::move(Arg.PendingMerges)),
@@ -11376,6 +11469,10 @@ ScalarEvolution::ScalarEvolution(ScalarEvolution &&Arg)
 }
 
 ScalarEvolution::~ScalarEvolution() {
+#if LLVM_ENABLE_STATS
+  MaxSCEVMemoryKB.updateMax(getMemorySize() / 1024);
+#endif
+
   // Iterate through all the SCEVUnknown instances and call their
   // destructors, so that they release their references to their values.
   for (SCEVUnknown *U = FirstUnknown; U;) {
@@ -11783,29 +11880,40 @@ bool ScalarEvolution::ExitLimit::hasOperand(const SCEV *S) const {
 
 void
 ScalarEvolution::forgetMemoizedResults(const SCEV *S) {
-  ValuesAtScopes.erase(S);
-  LoopDispositions.erase(S);
-  BlockDispositions.erase(S);
-  UnsignedRanges.erase(S);
-  SignedRanges.erase(S);
-  ExprValueMap.erase(S);
-  HasRecMap.erase(S);
-  MinTrailingZerosCache.erase(S);
+  forgetMemoizedResults(ArrayRef<const SCEV *>(S));
+}
+
+void
+ScalarEvolution::forgetMemoizedResults(ArrayRef<const SCEV *> SCEVs) {
+  if (SCEVs.empty())
+    return;
+
+  SmallPtrSet<const SCEV *, 8> ToForget(SCEVs.begin(), SCEVs.end());
+  for (const SCEV *S : ToForget) {
+    ValuesAtScopes.erase(S);
+    LoopDispositions.erase(S);
+    BlockDispositions.erase(S);
+    UnsignedRanges.erase(S);
+    SignedRanges.erase(S);
+    ExprValueMap.erase(S);
+    HasRecMap.erase(S);
+    MinTrailingZerosCache.erase(S);
+  }
 
   for (auto I = PredicatedSCEVRewrites.begin();
        I != PredicatedSCEVRewrites.end();) {
     std::pair<const SCEV *, const Loop *> Entry = I->first;
-    if (Entry.first == S)
+    if (ToForget.count(Entry.first))
       PredicatedSCEVRewrites.erase(I++);
     else
       ++I;
   }
 
   auto RemoveSCEVFromBackedgeMap =
-      [S, this](DenseMap<const Loop *, BackedgeTakenInfo> &Map) {
+      [&ToForget, this](DenseMap<const Loop *, BackedgeTakenInfo> &Map) {
         for (auto I = Map.begin(), E = Map.end(); I != E;) {
           BackedgeTakenInfo &BEInfo = I->second;
-          if (BEInfo.hasOperand(S, this)) {
+          if (BEInfo.hasAnyOperand(ToForget, this)) {
             BEInfo.clear();
             Map.erase(I++);
           } else
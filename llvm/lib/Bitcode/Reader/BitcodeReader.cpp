@@ -5169,6 +5169,12 @@ SyncScope::ID BitcodeReader::getDecodedSyncScopeID(unsigned Val) {
 //===----------------------------------------------------------------------===//
 
 Error BitcodeReader::materialize(GlobalValue *GV) {
+  // Attachments of global variables and declarations may have been deferred
+  // by the lazy metadata loader.
+  if (auto *GO = dyn_cast<GlobalObject>(GV))
+    if (Error Err = MDLoader->loadGlobalDeclAttachments(*GO))
+      return Err;
+
   Function *F = dyn_cast<Function>(GV);
   // If it's not a function or is already material, ignore the request.
   if (!F || !F->isMaterializable())
@@ -5247,6 +5253,8 @@ Error BitcodeReader::materializeModule() {
     if (Error Err = materialize(&F))
       return Err;
   }
+  if (Error Err = MDLoader->loadAllGlobalDeclAttachments())
+    return Err;
   // At this point, if there are any function bodies, parse the rest of
   // the bits in the module past the last function block we have recorded
   // through either lazy scanning or the VST.
@@ -439,6 +439,17 @@ class MetadataLoader::MetadataLoaderImpl {
   /// populated.
   void lazyLoadOneMetadata(unsigned Idx, PlaceholderQueue &Placeholders);
 
+  /// When lazy-loading, the position and abbrev ID of the
+  /// METADATA_GLOBAL_DECL_ATTACHMENT record of each global object. These are
+  /// only parsed once the global is materialized, so that importing a handful
+  /// of functions does not load the debug info of every global variable.
+  DenseMap<GlobalObject *, std::pair<uint64_t, unsigned>>
+      DeferredGlobalDeclAttachments;
+
+  /// Parse the deferred attachment record at \p Pos for \p GO.
+  Error loadGlobalDeclAttachment(GlobalObject &GO, uint64_t Pos,
+                                 unsigned AbbrevID);
+
   // Keep mapping of seens pair of old-style CU <-> SP, and update pointers to
   // point from SP to CU after a block is completly parsed.
   std::vector<std::pair<DICompileUnit *, Metadata *>> CUSubprograms;
@@ -658,6 +669,9 @@ public:
   Error parseMetadataAttachment(
       Function &F, const SmallVectorImpl<Instruction *> &InstructionList);
 
+  Error loadGlobalDeclAttachments(GlobalObject &GO);
+  Error loadAllGlobalDeclAttachments();
+
   Error parseMetadataKinds();
 
   void setStripTBAA(bool Value) { StripTBAA = Value; }
@@ -808,8 +822,8 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
         break;
       }
       case bitc::METADATA_GLOBAL_DECL_ATTACHMENT: {
-        // FIXME: we need to do this early because we don't materialize global
-        // value explicitly.
+        // Only read the value ID here; the attachments themselves are parsed
+        // when the global is materialized (see loadGlobalDeclAttachments).
         if (Error Err = IndexCursor.JumpToBit(CurrentPos))
           return std::move(Err);
         Record.clear();
@@ -823,10 +837,16 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
         unsigned ValueID = Record[0];
         if (ValueID >= ValueList.size())
           return error("Invalid record");
-        if (auto *GO = dyn_cast<GlobalObject>(ValueList[ValueID]))
-          if (Error Err = parseGlobalObjectAttachment(
-                  *GO, ArrayRef<uint64_t>(Record).slice(1)))
-            return std::move(Err);
+        if (auto *GO = dyn_cast<GlobalObject>(ValueList[ValueID])) {
+          // The writer emits a single record per global; should there be
+          // more, parse the extra ones right away.
+          if (!DeferredGlobalDeclAttachments
+                   .insert({GO, {CurrentPos, Entry.ID}})
+                   .second)
+            if (Error Err = parseGlobalObjectAttachment(
+                    *GO, ArrayRef<uint64_t>(Record).slice(1)))
+              return std::move(Err);
+        }
         break;
       }
       case bitc::METADATA_KIND:
@@ -867,6 +887,7 @@ MetadataLoader::MetadataLoaderImpl::lazyLoadModuleMetadataBlock() {
         // lazy-loading and fallback.
         MDStringRef.clear();
         GlobalMetadataBitPosIndex.clear();
+        DeferredGlobalDeclAttachments.clear();
         return false;
       }
       break;
@@ -1451,12 +1472,19 @@ Error MetadataLoader::MetadataLoaderImpl::parseOneMetadata(
     // Ignore Record[0], which indicates whether this compile unit is
     // distinct.  It's always distinct.
     IsDistinct = true;
+
+    // When importing, the IRMover drops the enums, retained types, globals
+    // and macros lists of the compile unit (they stay with the originating
+    // module), so don't pull everything they reach out of the bitcode.
+    auto getCUListOrNull = [&](unsigned ID) -> Metadata * {
+      return IsImporting ? nullptr : getMDOrNull(ID);
+    };
     auto *CU = DICompileUnit::getDistinct(
         Context, Record[1], getMDOrNull(Record[2]), getMDString(Record[3]),
         Record[4], getMDString(Record[5]), Record[6], getMDString(Record[7]),
-        Record[8], getMDOrNull(Record[9]), getMDOrNull(Record[10]),
-        getMDOrNull(Record[12]), getMDOrNull(Record[13]),
-        Record.size() <= 15 ? nullptr : getMDOrNull(Record[15]),
+        Record[8], getCUListOrNull(Record[9]), getCUListOrNull(Record[10]),
+        getCUListOrNull(Record[12]), getMDOrNull(Record[13]),
+        Record.size() <= 15 ? nullptr : getCUListOrNull(Record[15]),
         Record.size() <= 14 ? 0 : Record[14],
         Record.size() <= 16 ? true : Record[16],
         Record.size() <= 17 ? false : Record[17],
@@ -1961,6 +1989,54 @@ Error MetadataLoader::MetadataLoaderImpl::parseGlobalObjectAttachment(
   return Error::success();
 }
 
+Error MetadataLoader::MetadataLoaderImpl::loadGlobalDeclAttachment(
+    GlobalObject &GO, uint64_t Pos, unsigned AbbrevID) {
+  if (Error Err = IndexCursor.JumpToBit(Pos))
+    return Err;
+  SmallVector<uint64_t, 8> Record;
+  if (Expected<unsigned> MaybeRecord = IndexCursor.readRecord(AbbrevID, Record))
+    assert(MaybeRecord.get() == bitc::METADATA_GLOBAL_DECL_ATTACHMENT);
+  else
+    return MaybeRecord.takeError();
+  if (Error Err =
+          parseGlobalObjectAttachment(GO, ArrayRef<uint64_t>(Record).slice(1)))
+    return Err;
+
+  // The attachments created forward references, load them now.
+  PlaceholderQueue Placeholders;
+  resolveForwardRefsAndPlaceholders(Placeholders);
+  upgradeDebugInfo();
+  return Error::success();
+}
+
+/// Load the attachments of a global variable or function declaration whose
+/// METADATA_GLOBAL_DECL_ATTACHMENT record was deferred.
+Error MetadataLoader::MetadataLoaderImpl::loadGlobalDeclAttachments(
+    GlobalObject &GO) {
+  auto I = DeferredGlobalDeclAttachments.find(&GO);
+  if (I == DeferredGlobalDeclAttachments.end())
+    return Error::success();
+  auto Pos = I->second;
+  DeferredGlobalDeclAttachments.erase(I);
+  return loadGlobalDeclAttachment(GO, Pos.first, Pos.second);
+}
+
+Error MetadataLoader::MetadataLoaderImpl::loadAllGlobalDeclAttachments() {
+  // Load in stream order, which keeps the cursor moving forward.
+  std::vector<std::pair<std::pair<uint64_t, unsigned>, GlobalObject *>>
+      Pending;
+  Pending.reserve(DeferredGlobalDeclAttachments.size());
+  for (auto &Entry : DeferredGlobalDeclAttachments)
+    Pending.push_back({Entry.second, Entry.first});
+  DeferredGlobalDeclAttachments.clear();
+  llvm::sort(Pending.begin(), Pending.end());
+  for (auto &Entry : Pending)
+    if (Error Err = loadGlobalDeclAttachment(*Entry.second, Entry.first.first,
+                                             Entry.first.second))
+      return Err;
+  return Error::success();
+}
+
 /// Parse metadata attachments.
 Error MetadataLoader::MetadataLoaderImpl::parseMetadataAttachment(
     Function &F, const SmallVectorImpl<Instruction *> &InstructionList) {
@@ -2145,6 +2221,14 @@ Error MetadataLoader::parseMetadataAttachment(
   return Pimpl->parseMetadataAttachment(F, InstructionList);
 }
 
+Error MetadataLoader::loadGlobalDeclAttachments(GlobalObject &GO) {
+  return Pimpl->loadGlobalDeclAttachments(GO);
+}
+
+Error MetadataLoader::loadAllGlobalDeclAttachments() {
+  return Pimpl->loadAllGlobalDeclAttachments();
+}
+
 Error MetadataLoader::parseMetadataKinds() {
   return Pimpl->parseMetadataKinds();
 }
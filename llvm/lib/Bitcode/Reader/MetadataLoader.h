@@ -25,6 +25,7 @@ class BitstreamCursor;
 class DISubprogram;
 class Error;
 class Function;
+class GlobalObject;
 class Instruction;
 class Metadata;
 class MDNode;
@@ -71,6 +72,13 @@ public:
   Error parseMetadataAttachment(
       Function &F, const SmallVectorImpl<Instruction *> &InstructionList);
 
+  /// Load the attachments of a global variable or function declaration if
+  /// they were deferred while lazy-loading the module metadata.
+  Error loadGlobalDeclAttachments(GlobalObject &GO);
+
+  /// Load all the attachments deferred by the function above.
+  Error loadAllGlobalDeclAttachments();
+
   /// Parse a `METADATA_KIND` block for the current module.
   Error parseMetadataKinds();
 
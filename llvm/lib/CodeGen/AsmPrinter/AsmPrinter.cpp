@@ -25,6 +25,7 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/ADT/Triple.h"
 #include "llvm/ADT/Twine.h"
@@ -1041,6 +1042,10 @@ void AsmPrinter::EmitFunctionBody() {
   bool HasAnyRealCode = false;
   int NumInstsInFunction = 0;
   for (auto &MBB : *MF) {
+    // The cold blocks of a split function come last, in their own section.
+    if (MBB.isInColdSection() && !CurrentFnColdSym)
+      emitColdFragmentStart(MBB);
+
     // Print a label for the basic block.
     EmitBasicBlockStart(MBB);
     for (auto &MI : MBB) {
@@ -1179,10 +1184,18 @@ void AsmPrinter::EmitFunctionBody() {
   if (MAI->hasDotTypeDotSizeDirective()) {
     // We can get the size as difference between the function label and the
     // temp label.
+    MCSymbol *HotEnd = CurrentFnHotEnd ? CurrentFnHotEnd : CurrentFnEnd;
     const MCExpr *SizeExp = MCBinaryExpr::createSub(
-        MCSymbolRefExpr::create(CurrentFnEnd, OutContext),
+        MCSymbolRefExpr::create(HotEnd, OutContext),
         MCSymbolRefExpr::create(CurrentFnSymForSize, OutContext), OutContext);
     OutStreamer->emitELFSize(CurrentFnSym, SizeExp);
+    if (CurrentFnColdSym)
+      OutStreamer->emitELFSize(
+          CurrentFnColdSym,
+          MCBinaryExpr::createSub(
+              MCSymbolRefExpr::create(CurrentFnEnd, OutContext),
+              MCSymbolRefExpr::create(CurrentFnColdSym, OutContext),
+              OutContext));
   }
 
   for (const HandlerInfo &HI : Handlers) {
@@ -1210,6 +1223,36 @@ void AsmPrinter::EmitFunctionBody() {
   OutStreamer->AddBlankLine();
 }
 
+void AsmPrinter::emitColdFragmentStart(const MachineBasicBlock &MBB) {
+  CurrentFnHotEnd = createTempSymbol("func_hot_end");
+  OutStreamer->EmitLabel(CurrentFnHotEnd);
+  for (const HandlerInfo &HI : Handlers)
+    HI.Handler->endFragment();
+
+  MCSection *ColdSection =
+      getObjFileLowering().getSectionForColdFragment(MF->getFunction(), TM);
+  assert(ColdSection && "Split function without a cold section");
+  OutStreamer->SwitchSection(ColdSection);
+  SmallString<128> ColdName(CurrentFnSym->getName());
+  ColdName += ".cold";
+  if (OutContext.lookupSymbol(ColdName))
+    ColdName += "." + utostr(getFunctionNumber());
+  CurrentFnColdSym = OutContext.getOrCreateSymbol(ColdName);
+  if (MAI->hasDotTypeDotSizeDirective())
+    OutStreamer->EmitSymbolAttribute(CurrentFnColdSym, MCSA_ELF_TypeFunction);
+  OutStreamer->EmitLabel(CurrentFnColdSym);
+  for (const HandlerInfo &HI : Handlers)
+    HI.Handler->beginFragment(&MBB, DwarfCFIException::getExceptionSym);
+
+  // The cold part has a frame description of its own. The splitter only
+  // splits functions where the entry block is the only block with successors
+  // that changes the frame, so its state there is the state of every cold
+  // block.
+  for (const MachineInstr &MI : MF->front())
+    if (MI.isCFIInstruction())
+      emitCFIInstruction(MI);
+}
+
 /// Compute the number of Global Variables that uses a Constant.
 static unsigned getNumGlobalVariableUses(const Constant *C) {
   if (!C)
@@ -1683,6 +1726,8 @@ void AsmPrinter::SetupMachineFunction(MachineFunction &MF) {
   CurrentFnSymForSize = CurrentFnSym;
   CurrentFnBegin = nullptr;
   CurExceptionSym = nullptr;
+  CurrentFnColdSym = nullptr;
+  CurrentFnHotEnd = nullptr;
   bool NeedsLocalForSize = MAI->needsLocalForSize();
   if (needFuncLabelsForEHOrDebugInfo(MF, MMI) || NeedsLocalForSize ||
       MF.getTarget().Options.EmitStackSizeSection) {
@@ -3032,9 +3077,11 @@ isBlockOnlyReachableByFallthrough(const MachineBasicBlock *MBB) const {
   if (MBB->pred_size() > 1)
     return false;
 
-  // The predecessor has to be immediately before this block.
+  // The predecessor has to be immediately before this block, in the same
+  // section.
   MachineBasicBlock *Pred = *MBB->pred_begin();
-  if (!Pred->isLayoutSuccessor(MBB))
+  if (!Pred->isLayoutSuccessor(MBB) ||
+      Pred->isInColdSection() != MBB->isInColdSection())
     return false;
 
   // If the block is completely empty, then it definitely does fall through.
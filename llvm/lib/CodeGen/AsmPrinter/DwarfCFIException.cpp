@@ -80,7 +80,7 @@ void DwarfCFIException::endModule() {
   }
 }
 
-static MCSymbol *getExceptionSym(AsmPrinter *Asm) {
+MCSymbol *DwarfCFIException::getExceptionSym(AsmPrinter *Asm) {
   return Asm->getCurExceptionSym();
 }
 
@@ -66,6 +66,9 @@ public:
 
   void beginFragment(const MachineBasicBlock *MBB,
                      ExceptionSymbolProvider ESP) override;
+
+  /// The ExceptionSymbolProvider of the fragments of a function.
+  static MCSymbol *getExceptionSym(AsmPrinter *Asm);
 };
 
 class LLVM_LIBRARY_VISIBILITY ARMException : public DwarfCFIExceptionBase {
@@ -12,6 +12,7 @@
 
 #include "InterferenceCache.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/CodeGen/LiveInterval.h"
 #include "llvm/CodeGen/LiveIntervalUnion.h"
 #include "llvm/CodeGen/LiveIntervals.h"
@@ -31,6 +32,9 @@ using namespace llvm;
 
 #define DEBUG_TYPE "regalloc"
 
+STATISTIC(NumPartialRevalidations,
+          "Number of interference cache entries only partially invalidated");
+
 // Static member used for null interference cursors.
 const InterferenceCache::BlockInterference
     InterferenceCache::Cursor::NoInterference;
@@ -92,13 +96,45 @@ InterferenceCache::Entry *InterferenceCache::get(unsigned PhysReg) {
 /// revalidate - LIU contents have changed, update tags.
 void InterferenceCache::Entry::revalidate(LiveIntervalUnion *LIUArray,
                                           const TargetRegisterInfo *TRI) {
-  // Invalidate all block entries.
-  ++Tag;
+  // Only invalidate the blocks the LIUs changed in, if they still know. An
+  // eviction round changes a few live ranges, which are often local after
+  // splitting, so most of the blocks stay valid.
+  SmallVector<std::pair<SlotIndex, SlotIndex>, 8> Changes;
+  bool Known = true;
+  unsigned i = 0;
+  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units, ++i) {
+    LiveIntervalUnion &LIU = LIUArray[*Units];
+    if (Known && LIU.changedSince(RegUnits[i].VirtTag))
+      Known = LIU.getChangesSince(RegUnits[i].VirtTag, Changes);
+    RegUnits[i].VirtTag = LIU.getTag();
+  }
+  for (unsigned j = 0, e = Changes.size(); Known && j != e; ++j)
+    Known = invalidateRange(Changes[j].first, Changes[j].second);
+  if (Known)
+    ++NumPartialRevalidations;
+  else
+    // Invalidate all block entries.
+    ++Tag;
   // Invalidate all iterators.
   PrevPos = SlotIndex();
-  unsigned i = 0;
-  for (MCRegUnitIterator Units(PhysReg, TRI); Units.isValid(); ++Units, ++i)
-    RegUnits[i].VirtTag = LIUArray[*Units].getTag();
+}
+
+bool InterferenceCache::Entry::invalidateRange(SlotIndex Start,
+                                               SlotIndex End) {
+  // Walking many blocks costs more than recomputing the few that are asked
+  // for again.
+  const unsigned MaxBlocks = 32;
+  SlotIndexes::MBBIndexIterator I = Indexes->findMBBIndex(Start);
+  // Start is in the block before the first one that starts at or after it.
+  if (I == Indexes->MBBIndexEnd() || I->first > Start)
+    --I;
+  for (unsigned N = 0; I != Indexes->MBBIndexEnd() && I->first < End;
+       ++I, ++N) {
+    if (N == MaxBlocks)
+      return false;
+    Blocks[I->second->getNumber()].Tag = 0;
+  }
+  return true;
 }
 
 void InterferenceCache::Entry::reset(unsigned physReg,
@@ -97,6 +97,11 @@ class LLVM_LIBRARY_VISIBILITY InterferenceCache {
     /// update - Recompute Blocks[MBBNum]
     void update(unsigned MBBNum);
 
+    /// invalidateRange - Invalidate the blocks overlapping [Start, End).
+    /// Return false if there are too many of them to be worth it, and the
+    /// whole entry should be invalidated instead.
+    bool invalidateRange(SlotIndex Start, SlotIndex End);
+
   public:
     Entry() = default;
 
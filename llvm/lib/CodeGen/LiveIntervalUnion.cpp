@@ -29,7 +29,7 @@ using namespace llvm;
 void LiveIntervalUnion::unify(LiveInterval &VirtReg, const LiveRange &Range) {
   if (Range.empty())
     return;
-  ++Tag;
+  logChange(Range.beginIndex(), Range.endIndex());
 
   // Insert each of the virtual register's live segments into the map.
   LiveRange::const_iterator RegPos = Range.begin();
@@ -56,7 +56,7 @@ void LiveIntervalUnion::unify(LiveInterval &VirtReg, const LiveRange &Range) {
 void LiveIntervalUnion::extract(LiveInterval &VirtReg, const LiveRange &Range) {
   if (Range.empty())
     return;
-  ++Tag;
+  logChange(Range.beginIndex(), Range.endIndex());
 
   // Remove each of the virtual register's live segments from the map.
   LiveRange::const_iterator RegPos = Range.begin();
@@ -0,0 +1,187 @@
+//===-- MachineFunctionSplitter.cpp - Split cold blocks out of functions --===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass moves the blocks of a function that the profile says are cold to
+// the end of the function and marks them to be emitted in the cold section.
+// Unlike the hot/cold splitting of the IR, the cold part stays part of the
+// function: it is reached by branches, has the same frame, and costs no call.
+//
+// The pass runs once the layout is final and only splits functions the
+// AsmPrinter can emit in two parts: without exception handling, debug info or
+// jump tables, and where the frame state of every block but the entry block
+// is the one the entry block leaves, so that it can be restated at the start
+// of the cold part.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineBlockFrequencyInfo.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/CodeGen/MachineJumpTableInfo.h"
+#include "llvm/CodeGen/MachineModuleInfo.h"
+#include "llvm/CodeGen/Passes.h"
+#include "llvm/CodeGen/TargetInstrInfo.h"
+#include "llvm/CodeGen/TargetSubtargetInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Target/TargetMachine.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "machine-function-splitter"
+
+STATISTIC(NumSplitFunctions, "Number of functions split");
+STATISTIC(NumColdBlocks, "Number of blocks moved to the cold section");
+
+namespace {
+class MachineFunctionSplitter : public MachineFunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  MachineFunctionSplitter() : MachineFunctionPass(ID) {
+    initializeMachineFunctionSplitterPass(*PassRegistry::getPassRegistry());
+  }
+
+  StringRef getPassName() const override {
+    return "Machine Function Splitter";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<MachineBlockFrequencyInfo>();
+    AU.addRequired<ProfileSummaryInfoWrapperPass>();
+    MachineFunctionPass::getAnalysisUsage(AU);
+  }
+
+  bool runOnMachineFunction(MachineFunction &MF) override;
+};
+} // end anonymous namespace
+
+/// Return true if the cold part of \p MF can be emitted on its own.
+static bool canSplit(const MachineFunction &MF) {
+  const Function &F = MF.getFunction();
+  if (F.hasPersonalityFn() || F.hasSection() || MF.getMMI().hasDebugInfo())
+    return false;
+  Optional<StringRef> Prefix = F.getSectionPrefix();
+  if (Prefix && *Prefix == ".unlikely")
+    return false;
+  const MachineJumpTableInfo *MJTI = MF.getJumpTableInfo();
+  if (MJTI && !MJTI->isEmpty())
+    return false;
+  if (!MF.getTarget().getTargetTriple().isOSBinFormatELF())
+    return false;
+
+  // The frame may only change in the entry block, or in blocks that don't
+  // lead anywhere, like epilogues.
+  for (const MachineBasicBlock &MBB : MF) {
+    if (&MBB == &MF.front() ? !MBB.isReturnBlock() : MBB.succ_empty())
+      continue;
+    for (const MachineInstr &MI : MBB)
+      if (MI.isCFIInstruction())
+        return false;
+  }
+  return true;
+}
+
+/// Make the fallthrough from \p MBB to \p FallThrough an explicit branch.
+/// Return false if the branch of \p MBB can't be analyzed.
+static bool makeFallThroughExplicit(MachineBasicBlock &MBB,
+                                    MachineBasicBlock *FallThrough,
+                                    const TargetInstrInfo &TII) {
+  MachineBasicBlock *TBB = nullptr, *FBB = nullptr;
+  SmallVector<MachineOperand, 4> Cond;
+  if (TII.analyzeBranch(MBB, TBB, FBB, Cond))
+    return false;
+  // Only a branch that doesn't name the block falls through to it.
+  if (TBB && (Cond.empty() || FBB))
+    return true;
+  DebugLoc DL = MBB.findBranchDebugLoc();
+  if (TBB)
+    TII.removeBranch(MBB);
+  TII.insertBranch(MBB, TBB ? TBB : FallThrough, TBB ? FallThrough : nullptr,
+                   Cond, DL);
+  return true;
+}
+
+bool MachineFunctionSplitter::runOnMachineFunction(MachineFunction &MF) {
+  if (skipFunction(MF.getFunction()) || !MF.getFunction().hasProfileData())
+    return false;
+  ProfileSummaryInfo *PSI =
+      &getAnalysis<ProfileSummaryInfoWrapperPass>().getPSI();
+  if (!PSI->hasProfileSummary() || !canSplit(MF))
+    return false;
+
+  auto &MBFI = getAnalysis<MachineBlockFrequencyInfo>();
+  SmallPtrSet<const MachineBasicBlock *, 16> Cold;
+  for (MachineBasicBlock &MBB : MF) {
+    if (&MBB == &MF.front() || MBB.isEHPad())
+      continue;
+    Optional<uint64_t> Count = MBFI.getBlockProfileCount(&MBB);
+    if (Count && PSI->isColdCount(*Count))
+      Cold.insert(&MBB);
+  }
+  if (Cold.empty())
+    return false;
+
+  // Fallthroughs between a hot and a cold block become branches. Check that
+  // all of them can be rewritten before touching anything.
+  const TargetInstrInfo &TII = *MF.getSubtarget().getInstrInfo();
+  SmallVector<std::pair<MachineBasicBlock *, MachineBasicBlock *>, 8> Fixups;
+  for (MachineBasicBlock &MBB : MF) {
+    MachineBasicBlock *FallThrough = MBB.getFallThrough();
+    if (!FallThrough || Cold.count(&MBB) == Cold.count(FallThrough))
+      continue;
+    MachineBasicBlock *TBB = nullptr, *FBB = nullptr;
+    SmallVector<MachineOperand, 4> Cond;
+    if (TII.analyzeBranch(MBB, TBB, FBB, Cond)) {
+      LLVM_DEBUG(dbgs() << "MFS: can't split " << MF.getName()
+                        << ", unanalyzable fallthrough from "
+                        << printMBBReference(MBB) << "\n");
+      return false;
+    }
+    Fixups.push_back({&MBB, FallThrough});
+  }
+  for (auto &Fixup : Fixups) {
+    bool Analyzed = makeFallThroughExplicit(*Fixup.first, Fixup.second, TII);
+    (void)Analyzed;
+    assert(Analyzed && "Branch was analyzable a moment ago");
+  }
+
+  // Move the cold blocks to the end, keeping their order.
+  SmallVector<MachineBasicBlock *, 16> ColdBlocks;
+  for (MachineBasicBlock &MBB : MF)
+    if (Cold.count(&MBB))
+      ColdBlocks.push_back(&MBB);
+  for (MachineBasicBlock *MBB : ColdBlocks) {
+    MBB->setIsInColdSection();
+    MF.splice(MF.end(), MBB);
+  }
+
+  LLVM_DEBUG(dbgs() << "MFS: moved " << ColdBlocks.size()
+                    << " cold blocks of " << MF.getName() << "\n");
+  ++NumSplitFunctions;
+  NumColdBlocks += ColdBlocks.size();
+  return true;
+}
+
+char MachineFunctionSplitter::ID = 0;
+INITIALIZE_PASS_BEGIN(MachineFunctionSplitter, DEBUG_TYPE,
+                      "Split cold blocks out of machine functions", false,
+                      false)
+INITIALIZE_PASS_DEPENDENCY(MachineBlockFrequencyInfo)
+INITIALIZE_PASS_DEPENDENCY(ProfileSummaryInfoWrapperPass)
+INITIALIZE_PASS_END(MachineFunctionSplitter, DEBUG_TYPE,
+                    "Split cold blocks out of machine functions", false,
+                    false)
+
+MachineFunctionPass *llvm::createMachineFunctionSplitterPass() {
+  return new MachineFunctionSplitter();
+}
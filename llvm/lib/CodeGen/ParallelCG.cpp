@@ -11,6 +11,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/CodeGen/ParallelCG.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Bitcode/BitcodeWriter.h"
 #include "llvm/IR/LLVMContext.h"
@@ -48,50 +49,55 @@ std::unique_ptr<Module> llvm::splitCodeGen(
     return M;
   }
 
+  // To multi-thread the codegen every partition has to live in its own
+  // context. Rather than cloning each partition and writing it to bitcode on
+  // this thread, write the whole module once. Every thread then loads it
+  // lazily into its own context and only reads the function bodies of its
+  // partition, so that this thread doesn't do the work of all partitions
+  // before the first one can start.
+  StringMap<unsigned> PartitionOf;
+  computeSplitModulePartitions(
+      *M, OSs.size(),
+      [&](const GlobalValue &GV, unsigned I) {
+        PartitionOf[GV.getName()] = I;
+      },
+      PreserveLocals);
+
+  SmallString<0> BC;
+  raw_svector_ostream BCOS(BC);
+  WriteBitcodeToFile(*M, BCOS);
+  M.reset();
+
   // Create ThreadPool in nested scope so that threads will be joined
   // on destruction.
   {
     ThreadPool CodegenThreadPool(OSs.size());
-    int ThreadCount = 0;
-
-    SplitModule(
-        std::move(M), OSs.size(),
-        [&](std::unique_ptr<Module> MPart) {
-          // We want to clone the module in a new context to multi-thread the
-          // codegen. We do it by serializing partition modules to bitcode
-          // (while still on the main thread, in order to avoid data races) and
-          // spinning up new threads which deserialize the partitions into
-          // separate contexts.
-          // FIXME: Provide a more direct way to do this in LLVM.
-          SmallString<0> BC;
-          raw_svector_ostream BCOS(BC);
-          WriteBitcodeToFile(*MPart, BCOS);
-
-          if (!BCOSs.empty()) {
-            BCOSs[ThreadCount]->write(BC.begin(), BC.size());
-            BCOSs[ThreadCount]->flush();
-          }
-
-          llvm::raw_pwrite_stream *ThreadOS = OSs[ThreadCount++];
-          // Enqueue the task
-          CodegenThreadPool.async(
-              [TMFactory, FileType, ThreadOS](const SmallString<0> &BC) {
-                LLVMContext Ctx;
-                Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
-                    MemoryBufferRef(StringRef(BC.data(), BC.size()),
-                                    "<split-module>"),
-                    Ctx);
-                if (!MOrErr)
-                  report_fatal_error("Failed to read bitcode");
-                std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+    for (unsigned I = 0, E = OSs.size(); I != E; ++I)
+      CodegenThreadPool.async(
+          [&](unsigned ThreadId) {
+            LLVMContext Ctx;
+            Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+                MemoryBufferRef(StringRef(BC.data(), BC.size()),
+                                "<split-module>"),
+                Ctx, /*ShouldLazyLoadMetadata=*/true);
+            if (!MOrErr)
+              report_fatal_error("Failed to read bitcode");
+            std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+            if (Error E = materializeSplitModulePartition(*MPartInCtx,
+                                                          PartitionOf,
+                                                          ThreadId))
+              report_fatal_error("Failed to read bitcode: " +
+                                 toString(std::move(E)));
 
-                codegen(MPartInCtx.get(), *ThreadOS, TMFactory, FileType);
-              },
-              // Pass BC using std::move to ensure that it get moved rather than
-              // copied into the thread's context.
-              std::move(BC));
-        },
-        PreserveLocals);
+            // Every partition goes to its own streams, so the output doesn't
+            // depend on the order the threads finish in.
+            if (!BCOSs.empty()) {
+              WriteBitcodeToFile(*MPartInCtx, *BCOSs[ThreadId]);
+              BCOSs[ThreadId]->flush();
+            }
+            codegen(MPartInCtx.get(), *OSs[ThreadId], TMFactory, FileType);
+          },
+          I);
   }
 
   return {};
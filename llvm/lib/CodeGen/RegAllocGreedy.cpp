@@ -84,6 +84,12 @@ using namespace llvm;
 STATISTIC(NumGlobalSplits, "Number of split global live ranges");
 STATISTIC(NumLocalSplits,  "Number of split local live ranges");
 STATISTIC(NumEvicted,      "Number of interferences evicted");
+STATISTIC(NumRegionSplitCands,
+          "Number of registers tried as region split candidates");
+STATISTIC(NumGrowRegionBailouts,
+          "Number of region split candidates over the growRegion budget");
+STATISTIC(NumCheapSplitFunctions,
+          "Number of functions allocated with limited region splitting");
 
 static cl::opt<SplitEditor::ComplementSpillMode> SplitSpillMode(
     "split-spill-mode", cl::Hidden,
@@ -130,6 +136,24 @@ static cl::opt<unsigned>
                               "high compile time cost in global splitting."),
                      cl::init(5000));
 
+static cl::opt<unsigned> GrowRegionComplexityBudget(
+    "grow-region-complexity-budget", cl::Hidden,
+    cl::desc("growRegion() does not scale with the number of BB edges, so "
+             "limit its budget and bail out once we reach the limit."),
+    cl::init(10000));
+
+static cl::opt<unsigned> CheapSplitVirtRegs(
+    "regalloc-cheap-split-vregs", cl::Hidden,
+    cl::desc("Number of virtual registers above which region splitting only "
+             "tries a few registers per live range (0 = no limit)"),
+    cl::init(0));
+
+static cl::opt<unsigned> CheapSplitCandidates(
+    "regalloc-cheap-split-candidates", cl::Hidden,
+    cl::desc("Number of registers region splitting tries per live range in "
+             "functions above -regalloc-cheap-split-vregs"),
+    cl::init(4));
+
 // FIXME: Find a good default for this flag and remove the flag.
 static cl::opt<unsigned>
 CSRFirstTimeCost("regalloc-csr-first-time-cost",
@@ -408,6 +432,10 @@ class RAGreedy : public MachineFunctionPass,
   /// by a split candidate when choosing the best split candidate.
   bool EnableAdvancedRASplitCost;
 
+  /// The number of registers region splitting may try per live range, or 0
+  /// for all of them. This bounds the compile time on huge functions.
+  unsigned MaxRegionSplitCands;
+
   /// Set of broken hints that may be reconciled later because of eviction.
   SmallSetVector<LiveInterval *, 8> SetOfBrokenHints;
 
@@ -1317,6 +1345,7 @@ bool RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
 #ifndef NDEBUG
   unsigned Visited = 0;
 #endif
+  unsigned Budget = GrowRegionComplexityBudget;
 
   while (true) {
     ArrayRef<unsigned> NewBundles = SpillPlacer->getRecentPositive();
@@ -1325,6 +1354,12 @@ bool RAGreedy::growRegion(GlobalSplitCandidate &Cand) {
       unsigned Bundle = NewBundles[i];
       // Look at all blocks connected to Bundle in the full graph.
       ArrayRef<unsigned> Blocks = Bundles->getBlocks(Bundle);
+      // Limit compilation time by bailing out after we use all our budget.
+      if (Blocks.size() >= Budget) {
+        ++NumGrowRegionBailouts;
+        return false;
+      }
+      Budget -= Blocks.size();
       for (ArrayRef<unsigned>::iterator I = Blocks.begin(), E = Blocks.end();
            I != E; ++I) {
         unsigned Block = *I;
@@ -1830,6 +1865,8 @@ unsigned RAGreedy::tryRegionSplit(LiveInterval &VirtReg, AllocationOrder &Order,
                                   SmallVectorImpl<unsigned> &NewVRegs) {
   if (!isSplitBenefitWorthCost(VirtReg))
     return 0;
+  NamedRegionTimer T("region_split", "Region Splitting", TimerGroupName,
+                     TimerGroupDescription, TimePassesIsEnabled);
   unsigned NumCands = 0;
   BlockFrequency SpillCost = calcSpillCost();
   BlockFrequency BestCost;
@@ -1875,11 +1912,19 @@ unsigned RAGreedy::calculateRegionSplitCost(LiveInterval &VirtReg,
                                             unsigned &NumCands, bool IgnoreCSR,
                                             bool *CanCauseEvictionChain) {
   unsigned BestCand = NoCand;
+  unsigned NumTried = 0;
   Order.rewind();
   while (unsigned PhysReg = Order.next()) {
     if (IgnoreCSR && isUnusedCalleeSavedReg(PhysReg))
       continue;
 
+    // The allocation order puts the best registers first, so stop there when
+    // the function is too large to try them all.
+    if (MaxRegionSplitCands && NumTried == MaxRegionSplitCands)
+      break;
+    ++NumTried;
+    ++NumRegionSplitCands;
+
     // Discard bad candidates before we run out of interference cache cursors.
     // This will only affect register classes with a lot of registers (>32).
     if (NumCands == IntfCache.getMaxCursors()) {
@@ -2019,6 +2064,8 @@ unsigned RAGreedy::doRegionSplit(LiveInterval &VirtReg, unsigned BestCand,
 unsigned RAGreedy::tryBlockSplit(LiveInterval &VirtReg, AllocationOrder &Order,
                                  SmallVectorImpl<unsigned> &NewVRegs) {
   assert(&SA->getParent() == &VirtReg && "Live range wasn't analyzed");
+  NamedRegionTimer T("block_split", "Block Splitting", TimerGroupName,
+                     TimerGroupDescription, TimePassesIsEnabled);
   unsigned Reg = VirtReg.reg;
   bool SingleInstrs = RegClassInfo.isProperSubClass(MRI->getRegClass(Reg));
   LiveRangeEdit LREdit(&VirtReg, NewVRegs, *MF, *LIS, VRM, this, &DeadRemats);
@@ -3223,6 +3270,13 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   EnableAdvancedRASplitCost = ConsiderLocalIntervalCost ||
                               MF->getSubtarget().enableAdvancedRASplitCost();
 
+  MaxRegionSplitCands = 0;
+  if (CheapSplitVirtRegs &&
+      MF->getRegInfo().getNumVirtRegs() > CheapSplitVirtRegs) {
+    MaxRegionSplitCands = CheapSplitCandidates;
+    ++NumCheapSplitFunctions;
+  }
+
   if (VerifyEnabled)
     MF->verify(this, "Before greedy register allocator");
 
@@ -3257,7 +3311,11 @@ bool RAGreedy::runOnMachineFunction(MachineFunction &mf) {
   LastEvicted.clear();
 
   allocatePhysRegs();
-  tryHintsRecoloring();
+  {
+    NamedRegionTimer T("hint_recoloring", "Hint Recoloring", TimerGroupName,
+                       TimerGroupDescription, TimePassesIsEnabled);
+    tryHintsRecoloring();
+  }
   postOptimization();
   reportNumberOfSplillsReloads();
 
@@ -773,6 +773,7 @@ void SelectionDAG::DeallocateNode(SDNode *N) {
   removeOperands(N);
 
   NodeAllocator.Deallocate(AllNodes.remove(N));
+  --NumNodes;
 
   // Set the opcode to DELETED_NODE to help catch bugs when node
   // memory is reallocated.
@@ -832,6 +833,7 @@ static void VerifySDNode(SDNode *N) {
 /// verification and other common operations when a new node is allocated.
 void SelectionDAG::InsertNode(SDNode *N) {
   AllNodes.push_back(N);
+  PeakNumNodes = std::max(PeakNumNodes, ++NumNodes);
 #ifndef NDEBUG
   N->PersistentId = NextPersistentId++;
   VerifySDNode(N);
@@ -1015,6 +1017,7 @@ void SelectionDAG::init(MachineFunction &NewMF,
   LibInfo = LibraryInfo;
   Context = &MF->getFunction().getContext();
   DA = Divergence;
+  PeakNumNodes = NumNodes;
 }
 
 SelectionDAG::~SelectionDAG() {
@@ -1027,6 +1030,7 @@ SelectionDAG::~SelectionDAG() {
 void SelectionDAG::allnodes_clear() {
   assert(&*AllNodes.begin() == &EntryNode);
   AllNodes.remove(AllNodes.begin());
+  --NumNodes;
   while (!AllNodes.empty())
     DeallocateNode(&AllNodes.front());
 #ifndef NDEBUG
@@ -1075,9 +1079,9 @@ SDNode *SelectionDAG::FindNodeOrInsertPos(const FoldingSetNodeID &ID,
 }
 
 void SelectionDAG::clear() {
+  // The operands of the nodes go back to OperandRecycler, which hands them out
+  // again for the next block.
   allnodes_clear();
-  OperandRecycler.clear(OperandAllocator);
-  OperandAllocator.Reset();
   CSEMap.clear();
 
   ExtendedValueTypeNodes.clear();
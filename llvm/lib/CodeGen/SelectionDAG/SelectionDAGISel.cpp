@@ -112,6 +112,7 @@ STATISTIC(NumFastIselBlocks, "Number of blocks selected entirely by fast isel");
 STATISTIC(NumDAGBlocks, "Number of blocks selected using DAG");
 STATISTIC(NumDAGIselRetries,"Number of times dag isel has to try another path");
 STATISTIC(NumEntryBlocks, "Number of entry blocks encountered");
+STATISTIC(MaxDAGNodes, "Largest number of nodes in a DAG at once");
 STATISTIC(NumFastIselFailLowerArguments,
           "Number of entry blocks where fast isel failed to lower arguments");
 
@@ -498,6 +499,15 @@ bool SelectionDAGISel::runOnMachineFunction(MachineFunction &mf) {
     TLI->initializeSplitCSR(EntryMBB);
 
   SelectAllBasicBlocks(Fn);
+  MaxDAGNodes.updateMax(CurDAG->getPeakNumNodes());
+  ORE->emit([&]() {
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "PeakDAGSize",
+                                      Fn.getSubprogram(), &Fn.getEntryBlock())
+           << ore::NV("NumNodes", CurDAG->getPeakNumNodes())
+           << " nodes in the largest DAG, "
+           << ore::NV("OperandBytes", CurDAG->getOperandMemory())
+           << " bytes of operands";
+  });
   if (FastISelFailed && EnableFastISelFallbackReport) {
     DiagnosticInfoISelFallback DiagFallback(Fn);
     Fn.getContext().diagnose(DiagFallback);
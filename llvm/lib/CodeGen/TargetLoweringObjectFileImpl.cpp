@@ -710,6 +710,32 @@ MCSection *TargetLoweringObjectFileELF::getSectionForJumpTable(
                                    /* AssociatedSymbol */ nullptr);
 }
 
+MCSection *TargetLoweringObjectFileELF::getSectionForColdFragment(
+    const Function &F, const TargetMachine &TM) const {
+  // The cold part of a function goes with the function: in its group, and in
+  // a unique section if the function has one.
+  unsigned Flags = ELF::SHF_ALLOC | ELF::SHF_EXECINSTR;
+  StringRef Group = "";
+  if (const Comdat *C = getELFComdat(&F)) {
+    Flags |= ELF::SHF_GROUP;
+    Group = C->getName();
+  }
+
+  SmallString<128> Name(".text.unlikely");
+  unsigned UniqueID = MCContext::GenericSectionID;
+  if (TM.getFunctionSections() || F.hasComdat()) {
+    if (TM.getUniqueSectionNames()) {
+      Name.push_back('.');
+      TM.getNameWithPrefix(Name, &F, getMangler(),
+                           /*MayAlwaysUsePrivate=*/true);
+    } else {
+      UniqueID = NextUniqueID++;
+    }
+  }
+  return getContext().getELFSection(Name, ELF::SHT_PROGBITS, Flags, 0, Group,
+                                    UniqueID);
+}
+
 bool TargetLoweringObjectFileELF::shouldPutJumpTableInFunctionSection(
     bool UsesLabelDifference, const Function &F) const {
   // We can always create relative relocations, so use another section
@@ -45,6 +45,8 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/WithColor.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -886,6 +888,28 @@ void DWARFContext::parseNormalUnits() {
   });
 }
 
+void DWARFContext::prepareNormalUnitsForThreads() {
+  for (const auto &U : normal_units())
+    U->getAbbreviations();
+}
+
+void DWARFContext::forEachNormalUnitInParallel(
+    function_ref<void(DWARFUnit &)> Fn, unsigned ThreadCount) {
+  prepareNormalUnitsForThreads();
+  if (NormalUnits.size() < 2 || ThreadCount == 1) {
+    for (const auto &U : NormalUnits)
+      Fn(*U);
+    return;
+  }
+
+  ThreadPool Pool(ThreadCount ? ThreadCount : hardware_concurrency());
+  for (const auto &U : NormalUnits) {
+    DWARFUnit *Unit = U.get();
+    Pool.async([=] { Fn(*Unit); });
+  }
+  Pool.wait();
+}
+
 void DWARFContext::parseDWOUnits(bool Lazy) {
   if (!DWOUnits.empty())
     return;
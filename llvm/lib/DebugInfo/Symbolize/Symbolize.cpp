@@ -13,6 +13,7 @@
 #include "llvm/DebugInfo/Symbolize/Symbolize.h"
 
 #include "SymbolizableObjectFile.h"
+#include "SymbolizerIndex.h"
 
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/BinaryFormat/COFF.h"
@@ -21,6 +22,7 @@
 #include "llvm/DebugInfo/PDB/PDBContext.h"
 #include "llvm/Demangle/Demangle.h"
 #include "llvm/Object/COFF.h"
+#include "llvm/Object/ELFObjectFile.h"
 #include "llvm/Object/MachO.h"
 #include "llvm/Object/MachOUniversal.h"
 #include "llvm/Support/CRC.h"
@@ -31,6 +33,8 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include <algorithm>
 #include <cassert>
 #include <cstring>
@@ -54,17 +58,17 @@ namespace symbolize {
 Expected<DILineInfo>
 LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
                               object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
+  auto EntryOrErr = getOrCreateModuleInfo(ModuleName);
+  if (!EntryOrErr)
+    return EntryOrErr.takeError();
+  SymbolizableModule *Info = (*EntryOrErr)->Module.get();
 
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
     return DILineInfo();
 
+  std::lock_guard<std::mutex> Lock((*EntryOrErr)->Lock);
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -77,20 +81,9 @@ LLVMSymbolizer::symbolizeCode(const std::string &ModuleName,
   return LineInfo;
 }
 
-Expected<DIInliningInfo>
-LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
+DIInliningInfo
+LLVMSymbolizer::symbolizeInlinedCode(SymbolizableModule *Info,
                                      object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
-
-  // A null module means an error has already been reported. Return an empty
-  // result.
-  if (!Info)
-    return DIInliningInfo();
-
   // If the user is giving us relative addresses, add the preferred base of the
   // object to the offset before we do the query. It's what DIContext expects.
   if (Opts.RelativeAddresses)
@@ -107,20 +100,88 @@ LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
   return InlinedContext;
 }
 
+Expected<DIInliningInfo>
+LLVMSymbolizer::symbolizeInlinedCode(const std::string &ModuleName,
+                                     object::SectionedAddress ModuleOffset) {
+  auto EntryOrErr = getOrCreateModuleInfo(ModuleName);
+  if (!EntryOrErr)
+    return EntryOrErr.takeError();
+  SymbolizableModule *Info = (*EntryOrErr)->Module.get();
+
+  // A null module means an error has already been reported. Return an empty
+  // result.
+  if (!Info)
+    return DIInliningInfo();
+
+  std::lock_guard<std::mutex> Lock((*EntryOrErr)->Lock);
+  return symbolizeInlinedCode(Info, ModuleOffset);
+}
+
+std::vector<Expected<DIInliningInfo>>
+LLVMSymbolizer::symbolizeInlinedCode(ArrayRef<CodeRequest> Requests,
+                                     unsigned ThreadCount) {
+  // Group the requests by module, so that each module is looked up and
+  // locked once.
+  std::map<StringRef, std::vector<size_t>> Groups;
+  for (size_t I = 0, E = Requests.size(); I != E; ++I)
+    Groups[Requests[I].ModuleName].push_back(I);
+
+  std::vector<Optional<Expected<DIInliningInfo>>> Results(Requests.size());
+  auto SymbolizeGroup = [&](const std::vector<size_t> &Group) {
+    auto EntryOrErr = getOrCreateModuleInfo(Requests[Group.front()].ModuleName);
+    if (!EntryOrErr) {
+      // Every request of the module fails the same way.
+      std::string Msg = toString(EntryOrErr.takeError());
+      for (size_t I : Group)
+        Results[I].emplace(createStringError(errc::invalid_argument,
+                                             Msg.c_str()));
+      return;
+    }
+    SymbolizableModule *Info = (*EntryOrErr)->Module.get();
+    if (!Info) {
+      for (size_t I : Group)
+        Results[I].emplace(DIInliningInfo());
+      return;
+    }
+    std::lock_guard<std::mutex> Lock((*EntryOrErr)->Lock);
+    for (size_t I : Group)
+      Results[I].emplace(symbolizeInlinedCode(Info, Requests[I].ModuleOffset));
+  };
+
+  if (ThreadCount == 0)
+    ThreadCount = hardware_concurrency();
+  ThreadCount = std::min<size_t>(ThreadCount, Groups.size());
+  if (ThreadCount <= 1) {
+    for (auto &Group : Groups)
+      SymbolizeGroup(Group.second);
+  } else {
+    ThreadPool Pool(ThreadCount);
+    for (auto &Group : Groups)
+      Pool.async(SymbolizeGroup, std::cref(Group.second));
+    Pool.wait();
+  }
+
+  std::vector<Expected<DIInliningInfo>> Ret;
+  Ret.reserve(Results.size());
+  for (Optional<Expected<DIInliningInfo>> &Result : Results)
+    Ret.push_back(std::move(*Result));
+  return Ret;
+}
+
 Expected<DIGlobal>
 LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
                               object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
+  auto EntryOrErr = getOrCreateModuleInfo(ModuleName);
+  if (!EntryOrErr)
+    return EntryOrErr.takeError();
+  SymbolizableModule *Info = (*EntryOrErr)->Module.get();
 
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
     return DIGlobal();
 
+  std::lock_guard<std::mutex> Lock((*EntryOrErr)->Lock);
   // If the user is giving us relative addresses, add the preferred base of
   // the object to the offset before we do the query. It's what DIContext
   // expects.
@@ -136,17 +197,17 @@ LLVMSymbolizer::symbolizeData(const std::string &ModuleName,
 Expected<std::vector<DILocal>>
 LLVMSymbolizer::symbolizeFrame(const std::string &ModuleName,
                                object::SectionedAddress ModuleOffset) {
-  SymbolizableModule *Info;
-  if (auto InfoOrErr = getOrCreateModuleInfo(ModuleName))
-    Info = InfoOrErr.get();
-  else
-    return InfoOrErr.takeError();
+  auto EntryOrErr = getOrCreateModuleInfo(ModuleName);
+  if (!EntryOrErr)
+    return EntryOrErr.takeError();
+  SymbolizableModule *Info = (*EntryOrErr)->Module.get();
 
   // A null module means an error has already been reported. Return an empty
   // result.
   if (!Info)
     return std::vector<DILocal>();
 
+  std::lock_guard<std::mutex> Lock((*EntryOrErr)->Lock);
   // If the user is giving us relative addresses, add the preferred base of
   // the object to the offset before we do the query. It's what DIContext
   // expects.
@@ -157,10 +218,13 @@ LLVMSymbolizer::symbolizeFrame(const std::string &ModuleName,
 }
 
 void LLVMSymbolizer::flush() {
+  sys::ScopedWriter Writer(ModulesLock);
+  std::lock_guard<std::mutex> Lock(ObjectsLock);
   ObjectForUBPathAndArch.clear();
   BinaryForPath.clear();
   ObjectPairForPathArch.clear();
   Modules.clear();
+  ModulesSize = 0;
 }
 
 namespace {
@@ -394,12 +458,119 @@ LLVMSymbolizer::getOrCreateObject(const std::string &Path,
   return errorCodeToError(object_error::arch_not_found);
 }
 
-Expected<SymbolizableModule *>
+template <typename ELFT>
+static ArrayRef<uint8_t> getBuildID(const ELFFile<ELFT> *Obj) {
+  auto PhdrsOrErr = Obj->program_headers();
+  if (!PhdrsOrErr) {
+    consumeError(PhdrsOrErr.takeError());
+    return {};
+  }
+  for (const auto &P : *PhdrsOrErr) {
+    if (P.p_type != ELF::PT_NOTE)
+      continue;
+    ArrayRef<uint8_t> BuildID;
+    Error Err = Error::success();
+    for (const auto &N : Obj->notes(P, Err)) {
+      if (N.getType() == ELF::NT_GNU_BUILD_ID &&
+          N.getName() == ELF::ELF_NOTE_GNU) {
+        BuildID = N.getDesc();
+        break;
+      }
+    }
+    consumeError(std::move(Err));
+    if (!BuildID.empty())
+      return BuildID;
+  }
+  return {};
+}
+
+static ArrayRef<uint8_t> getBuildID(const ObjectFile *Obj) {
+  if (auto *O = dyn_cast<ELF32LEObjectFile>(Obj))
+    return getBuildID(O->getELFFile());
+  if (auto *O = dyn_cast<ELF32BEObjectFile>(Obj))
+    return getBuildID(O->getELFFile());
+  if (auto *O = dyn_cast<ELF64LEObjectFile>(Obj))
+    return getBuildID(O->getELFFile());
+  if (auto *O = dyn_cast<ELF64BEObjectFile>(Obj))
+    return getBuildID(O->getELFFile());
+  return {};
+}
+
+Expected<std::shared_ptr<LLVMSymbolizer::ModuleEntry>>
 LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
-  auto I = Modules.find(ModuleName);
-  if (I != Modules.end())
-    return I->second.get();
+  {
+    sys::ScopedReader Reader(ModulesLock);
+    auto I = Modules.find(ModuleName);
+    if (I != Modules.end()) {
+      I->second->LastUse = ++UseCount;
+      return I->second;
+    }
+  }
+
+  // Only one thread opens objects at a time, so check again that no other
+  // thread created the module while this one waited.
+  std::lock_guard<std::mutex> Lock(ObjectsLock);
+  {
+    sys::ScopedReader Reader(ModulesLock);
+    auto I = Modules.find(ModuleName);
+    if (I != Modules.end()) {
+      I->second->LastUse = ++UseCount;
+      return I->second;
+    }
+  }
 
+  auto Entry = std::make_shared<ModuleEntry>();
+  auto ModuleOrErr = createModuleInfo(ModuleName, Entry->Size);
+  if (ModuleOrErr)
+    Entry->Module = std::move(*ModuleOrErr);
+  Entry->LastUse = ++UseCount;
+  {
+    sys::ScopedWriter Writer(ModulesLock);
+    // A failed module is remembered too, so that the error is reported once.
+    Modules.emplace(ModuleName, Entry);
+    ModulesSize += Entry->Size;
+    evictModules(Entry.get());
+  }
+  if (!ModuleOrErr)
+    return ModuleOrErr.takeError();
+  return Entry;
+}
+
+void LLVMSymbolizer::evictModules(const ModuleEntry *Keep) {
+  // Queries in flight hold a reference to their entry, so erasing it here is
+  // safe. The objects stay cached, since the modules point into them.
+  while (Opts.MaxCacheSize && ModulesSize > Opts.MaxCacheSize) {
+    auto Oldest = Modules.end();
+    for (auto I = Modules.begin(), E = Modules.end(); I != E; ++I)
+      if (I->second.get() != Keep &&
+          (Oldest == Modules.end() ||
+           I->second->LastUse < Oldest->second->LastUse))
+        Oldest = I;
+    if (Oldest == Modules.end())
+      return;
+    ModulesSize -= Oldest->second->Size;
+    Modules.erase(Oldest);
+  }
+}
+
+/// Return the size of the debug info of \p Obj, which is what a module
+/// mostly holds on to.
+static uint64_t getDebugInfoSize(const ObjectFile &Obj) {
+  uint64_t Size = 0;
+  for (const SectionRef &Section : Obj.sections()) {
+    StringRef Name;
+    if (Section.getName(Name))
+      continue;
+    Name = Name.substr(Name.find_first_not_of("._"));
+    if (Name.startswith("debug_") || Name.startswith("zdebug_"))
+      Size += Section.getSize();
+  }
+  return std::max<uint64_t>(Size, 1);
+}
+
+Expected<std::unique_ptr<SymbolizableModule>>
+LLVMSymbolizer::createModuleInfo(const std::string &ModuleName,
+                                 uint64_t &Size) {
   std::string BinaryName = ModuleName;
   std::string ArchName = Opts.DefaultArch;
   size_t ColonPos = ModuleName.find_last_of(':');
@@ -414,10 +585,10 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
   auto ObjectsOrErr = getOrCreateObjectPair(BinaryName, ArchName);
   if (!ObjectsOrErr) {
     // Failed to find valid object file.
-    Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
     return ObjectsOrErr.takeError();
   }
   ObjectPair Objects = ObjectsOrErr.get();
+  Size = getDebugInfoSize(*Objects.second);
 
   std::unique_ptr<DIContext> Context;
   // If this is a COFF object containing PDB info, use a PDBContext to
@@ -431,7 +602,6 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
       std::unique_ptr<IPDBSession> Session;
       if (auto Err = loadDataForEXE(PDB_ReaderType::DIA,
                                     Objects.first->getFileName(), Session)) {
-        Modules.emplace(ModuleName, std::unique_ptr<SymbolizableModule>());
         // Return along the PDB filename to provide more context
         return createFileError(PDBFileName, std::move(Err));
       }
@@ -442,16 +612,21 @@ LLVMSymbolizer::getOrCreateModuleInfo(const std::string &ModuleName) {
     Context =
         DWARFContext::create(*Objects.second, nullptr,
                              DWARFContext::defaultErrorHandler, Opts.DWPName);
+  auto *DWARFCtx = dyn_cast<DWARFContext>(Context.get());
   auto InfoOrErr =
       SymbolizableObjectFile::create(Objects.first, std::move(Context));
-  std::unique_ptr<SymbolizableModule> SymMod;
-  if (InfoOrErr)
-    SymMod = std::move(InfoOrErr.get());
-  auto InsertResult = Modules.emplace(ModuleName, std::move(SymMod));
-  assert(InsertResult.second);
   if (auto EC = InfoOrErr.getError())
     return errorCodeToError(EC);
-  return InsertResult.first->second.get();
+  std::unique_ptr<SymbolizableModule> SymMod = std::move(InfoOrErr.get());
+  // Answer code queries from the index of the binary if there is a cache.
+  if (DWARFCtx && !Opts.IndexCacheDir.empty()) {
+    ArrayRef<uint8_t> BuildID = getBuildID(Objects.first);
+    if (!BuildID.empty())
+      SymMod = getIndexedModule(std::move(SymMod), *DWARFCtx,
+                                Opts.IndexCacheDir, BuildID,
+                                Opts.PrintFunctions, Opts.UseSymbolTable);
+  }
+  return std::move(SymMod);
 }
 
 namespace {
@@ -493,13 +668,12 @@ LLVMSymbolizer::DemangleName(const std::string &Name,
   // We can spoil names of symbols with C linkage, so use an heuristic
   // approach to check if the name should be demangled.
   if (Name.substr(0, 2) == "_Z") {
-    int status = 0;
-    char *DemangledName = itaniumDemangle(Name.c_str(), nullptr, nullptr, &status);
-    if (status != 0)
+    // Queries run on several threads, each with a context of its own.
+    static thread_local ItaniumDemangleContext Demangler;
+    const char *DemangledName = Demangler.demangle(Name.data(), Name.size());
+    if (!DemangledName)
       return Name;
-    std::string Result = DemangledName;
-    free(DemangledName);
-    return Result;
+    return DemangledName;
   }
 
 #if defined(_MSC_VER)
@@ -0,0 +1,277 @@
+//===- SymbolizerIndex.cpp ------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the on-disk index of the symbolizer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SymbolizerIndex.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/DebugInfo/DWARF/DWARFContext.h"
+#include "llvm/Support/EndianStream.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace symbolize;
+
+static const char IndexMagic[8] = {'L', 'L', 'V', 'M', 'S', 'Y', 'M', 'X'};
+static const uint32_t IndexVersion = 1;
+
+void SymbolizerIndex::write(raw_ostream &OS, DWARFContext &DICtx,
+                            const SymbolizableModule &Module,
+                            FunctionNameKind FNKind, bool UseSymbolTable) {
+  // Collect the addresses where a row starts, and where a sequence ends. The
+  // frames can only change at these addresses.
+  std::vector<std::pair<uint64_t, bool>> Boundaries;
+  for (const auto &CU : DICtx.compile_units()) {
+    const DWARFDebugLine::LineTable *LT = DICtx.getLineTableForUnit(CU.get());
+    if (!LT)
+      continue;
+    for (const DWARFDebugLine::Sequence &Seq : LT->Sequences) {
+      if (!Seq.isValid() ||
+          Seq.SectionIndex != object::SectionedAddress::UndefSection)
+        continue;
+      for (unsigned I = Seq.FirstRowIndex; I + 1 < Seq.LastRowIndex; ++I)
+        Boundaries.push_back({LT->Rows[I].Address.Address, true});
+      Boundaries.push_back({Seq.HighPC, false});
+    }
+  }
+  // Sort the row starts of an address after the sequence ends, so that an
+  // address that starts a row in any sequence is looked up.
+  llvm::sort(Boundaries);
+
+  std::vector<Entry> Entries;
+  std::vector<Frame> Frames;
+  std::string Strings(1, '\0');
+  StringMap<uint32_t> StringOffsets;
+  auto AddString = [&](StringRef S) -> uint32_t {
+    if (S.empty())
+      return 0;
+    auto Res = StringOffsets.insert({S, Strings.size()});
+    if (Res.second) {
+      Strings.append(S.begin(), S.end());
+      Strings.push_back('\0');
+    }
+    return Res.first->second;
+  };
+
+  DIInliningInfo Prev;
+  for (size_t I = 0, E = Boundaries.size(); I != E; ++I) {
+    uint64_t Address = Boundaries[I].first;
+    if (I + 1 != E && Boundaries[I + 1].first == Address)
+      continue;
+    DIInliningInfo Info;
+    if (Boundaries[I].second)
+      Info = Module.symbolizeInlinedCode(
+          {Address, object::SectionedAddress::UndefSection}, FNKind,
+          UseSymbolTable);
+
+    // Consecutive rows often only differ in what the frames don't record.
+    bool Same = Info.getNumberOfFrames() == Prev.getNumberOfFrames();
+    for (unsigned F = 0, FE = Info.getNumberOfFrames(); Same && F != FE; ++F)
+      Same = Info.getFrame(F) == Prev.getFrame(F);
+    if (Same && !Entries.empty())
+      continue;
+
+    Entry Ent;
+    Ent.Address = Address;
+    Ent.FirstFrame = Frames.size();
+    Ent.NumFrames = Info.getNumberOfFrames();
+    Entries.push_back(Ent);
+    for (unsigned F = 0, FE = Info.getNumberOfFrames(); F != FE; ++F) {
+      const DILineInfo &Line = Info.getFrame(F);
+      Frame Fr;
+      Fr.FunctionName = AddString(Line.FunctionName);
+      Fr.FileName = AddString(Line.FileName);
+      Fr.Line = Line.Line;
+      Fr.Column = Line.Column;
+      Fr.StartLine = Line.StartLine;
+      Fr.Discriminator = Line.Discriminator;
+      Frames.push_back(Fr);
+    }
+    Prev = std::move(Info);
+  }
+
+  Header Hdr;
+  std::memcpy(Hdr.Magic, IndexMagic, sizeof(IndexMagic));
+  Hdr.Version = IndexVersion;
+  Hdr.NumEntries = Entries.size();
+  Hdr.NumFrames = Frames.size();
+  Hdr.StringsSize = Strings.size();
+  OS.write(reinterpret_cast<const char *>(&Hdr), sizeof(Hdr));
+  OS.write(reinterpret_cast<const char *>(Entries.data()),
+           Entries.size() * sizeof(Entry));
+  OS.write(reinterpret_cast<const char *>(Frames.data()),
+           Frames.size() * sizeof(Frame));
+  OS << Strings;
+}
+
+Expected<std::unique_ptr<SymbolizerIndex>>
+SymbolizerIndex::create(std::unique_ptr<MemoryBuffer> Buffer) {
+  StringRef Data = Buffer->getBuffer();
+  if (Data.size() < sizeof(Header))
+    return createStringError(errc::invalid_argument,
+                             "symbolizer index is truncated");
+  const auto *Hdr = reinterpret_cast<const Header *>(Data.data());
+  if (std::memcmp(Hdr->Magic, IndexMagic, sizeof(IndexMagic)) ||
+      Hdr->Version != IndexVersion)
+    return createStringError(errc::invalid_argument,
+                             "not a symbolizer index of this version");
+
+  uint64_t EntriesSize = uint64_t(Hdr->NumEntries) * sizeof(Entry);
+  uint64_t FramesSize = uint64_t(Hdr->NumFrames) * sizeof(Frame);
+  if (Data.size() !=
+      sizeof(Header) + EntriesSize + FramesSize + Hdr->StringsSize)
+    return createStringError(errc::invalid_argument,
+                             "symbolizer index has the wrong size");
+  const char *Pos = Data.data() + sizeof(Header);
+  ArrayRef<Entry> Entries(reinterpret_cast<const Entry *>(Pos),
+                          Hdr->NumEntries);
+  Pos += EntriesSize;
+  ArrayRef<Frame> Frames(reinterpret_cast<const Frame *>(Pos),
+                         Hdr->NumFrames);
+  Pos += FramesSize;
+  StringRef Strings(Pos, Hdr->StringsSize);
+  if (Strings.empty() || Strings.back() != '\0')
+    return createStringError(errc::invalid_argument,
+                             "symbolizer index has a bad string table");
+
+  return std::unique_ptr<SymbolizerIndex>(
+      new SymbolizerIndex(std::move(Buffer), Entries, Frames, Strings));
+}
+
+Optional<StringRef> SymbolizerIndex::getString(uint32_t Offset) const {
+  if (Offset >= Strings.size())
+    return None;
+  return StringRef(Strings.data() + Offset);
+}
+
+Optional<DIInliningInfo> SymbolizerIndex::lookup(uint64_t Address) const {
+  auto It = std::upper_bound(
+      Entries.begin(), Entries.end(), Address,
+      [](uint64_t Address, const Entry &E) { return Address < E.Address; });
+  if (It == Entries.begin())
+    return None;
+  --It;
+  if (!It->NumFrames ||
+      uint64_t(It->FirstFrame) + It->NumFrames > Frames.size())
+    return None;
+
+  DIInliningInfo Info;
+  for (const Frame &Fr : Frames.slice(It->FirstFrame, It->NumFrames)) {
+    Optional<StringRef> FunctionName = getString(Fr.FunctionName);
+    Optional<StringRef> FileName = getString(Fr.FileName);
+    if (!FunctionName || !FileName)
+      return None;
+    DILineInfo Line;
+    Line.FunctionName = *FunctionName;
+    Line.FileName = *FileName;
+    Line.Line = Fr.Line;
+    Line.Column = Fr.Column;
+    Line.StartLine = Fr.StartLine;
+    Line.Discriminator = Fr.Discriminator;
+    Info.addFrame(Line);
+  }
+  return Info;
+}
+
+DILineInfo IndexedSymbolizableModule::symbolizeCode(
+    object::SectionedAddress ModuleOffset, FunctionNameKind FNKind,
+    bool UseSymbolTable) const {
+  return Module->symbolizeCode(ModuleOffset, FNKind, UseSymbolTable);
+}
+
+DIInliningInfo IndexedSymbolizableModule::symbolizeInlinedCode(
+    object::SectionedAddress ModuleOffset, FunctionNameKind FNKind,
+    bool UseSymbolTable) const {
+  if (ModuleOffset.SectionIndex == object::SectionedAddress::UndefSection &&
+      FNKind == this->FNKind && UseSymbolTable == this->UseSymbolTable)
+    if (Optional<DIInliningInfo> Info = Index->lookup(ModuleOffset.Address))
+      return std::move(*Info);
+  return Module->symbolizeInlinedCode(ModuleOffset, FNKind, UseSymbolTable);
+}
+
+DIGlobal IndexedSymbolizableModule::symbolizeData(
+    object::SectionedAddress ModuleOffset) const {
+  return Module->symbolizeData(ModuleOffset);
+}
+
+std::vector<DILocal> IndexedSymbolizableModule::symbolizeFrame(
+    object::SectionedAddress ModuleOffset) const {
+  return Module->symbolizeFrame(ModuleOffset);
+}
+
+bool IndexedSymbolizableModule::isWin32Module() const {
+  return Module->isWin32Module();
+}
+
+uint64_t IndexedSymbolizableModule::getModulePreferredBase() const {
+  return Module->getModulePreferredBase();
+}
+
+std::unique_ptr<SymbolizableModule> symbolize::getIndexedModule(
+    std::unique_ptr<SymbolizableModule> Module, DWARFContext &DICtx,
+    StringRef CacheDir, ArrayRef<uint8_t> BuildID, FunctionNameKind FNKind,
+    bool UseSymbolTable) {
+  // The frames depend on the options they were looked up with.
+  SmallString<128> Path = CacheDir;
+  sys::path::append(Path, toHex(BuildID, /*LowerCase=*/true) + "-" +
+                              utostr(static_cast<unsigned>(FNKind)) +
+                              (UseSymbolTable ? "s" : "") + ".symidx");
+
+  auto ReadIndex = [&]() -> std::unique_ptr<SymbolizerIndex> {
+    auto BufOrErr = MemoryBuffer::getFile(Path, /*FileSize=*/-1,
+                                          /*RequiresNullTerminator=*/false);
+    if (!BufOrErr)
+      return nullptr;
+    Expected<std::unique_ptr<SymbolizerIndex>> IndexOrErr =
+        SymbolizerIndex::create(std::move(*BufOrErr));
+    if (!IndexOrErr) {
+      consumeError(IndexOrErr.takeError());
+      return nullptr;
+    }
+    return std::move(*IndexOrErr);
+  };
+
+  std::unique_ptr<SymbolizerIndex> Index = ReadIndex();
+  if (!Index) {
+    // Write the index next to its final name and rename it, so that readers
+    // never see a partial index.
+    int FD;
+    SmallString<128> TempPath;
+    if (sys::fs::create_directories(CacheDir) ||
+        sys::fs::createUniqueFile(Path + ".tmp-%%%%%%", FD, TempPath))
+      return Module;
+    {
+      raw_fd_ostream OS(FD, /*shouldClose=*/true);
+      SymbolizerIndex::write(OS, DICtx, *Module, FNKind, UseSymbolTable);
+      OS.close();
+      if (OS.has_error()) {
+        OS.clear_error();
+        sys::fs::remove(TempPath);
+        return Module;
+      }
+    }
+    if (sys::fs::rename(TempPath, Path)) {
+      sys::fs::remove(TempPath);
+      return Module;
+    }
+    Index = ReadIndex();
+    if (!Index)
+      return Module;
+  }
+  return llvm::make_unique<IndexedSymbolizableModule>(
+      std::move(Module), std::move(Index), FNKind, UseSymbolTable);
+}
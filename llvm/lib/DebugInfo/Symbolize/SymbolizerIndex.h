@@ -0,0 +1,136 @@
+//===- SymbolizerIndex.h ----------------------------------------*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the SymbolizerIndex class, an on-disk table of the
+// inlined frames of every line table row of a binary, and a module that
+// answers queries from it.
+//
+//===----------------------------------------------------------------------===//
+#ifndef LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZERINDEX_H
+#define LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZERINDEX_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/DebugInfo/DIContext.h"
+#include "llvm/DebugInfo/Symbolize/SymbolizableModule.h"
+#include "llvm/Support/Endian.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <cstdint>
+#include <memory>
+
+namespace llvm {
+
+class DWARFContext;
+class raw_ostream;
+
+namespace symbolize {
+
+/// A sorted table of the addresses where a line table row starts, with the
+/// frames the symbolizer returns there, meant to be memory mapped from a file.
+/// An address gets the frames of the last row that starts at or before it. The
+/// ends of the line table sequences are in the table with no frames, so
+/// addresses the line tables don't cover are not found.
+class SymbolizerIndex {
+public:
+  struct Header {
+    char Magic[8];
+    support::ulittle32_t Version;
+    support::ulittle32_t NumEntries;
+    support::ulittle32_t NumFrames;
+    support::ulittle32_t StringsSize;
+  };
+
+  struct Entry {
+    support::ulittle64_t Address;
+    support::ulittle32_t FirstFrame;
+    support::ulittle32_t NumFrames;
+  };
+
+  /// A DILineInfo, with its strings as offsets into the string table.
+  struct Frame {
+    support::ulittle32_t FunctionName;
+    support::ulittle32_t FileName;
+    support::ulittle32_t Line;
+    support::ulittle32_t Column;
+    support::ulittle32_t StartLine;
+    support::ulittle32_t Discriminator;
+  };
+
+  /// Write the index of the binary whose debug info is \p DICtx to \p OS, by
+  /// symbolizing every row of its line tables with \p Module.
+  static void write(raw_ostream &OS, DWARFContext &DICtx,
+                    const SymbolizableModule &Module, FunctionNameKind FNKind,
+                    bool UseSymbolTable);
+
+  /// Check that \p Buffer holds an index and wrap it.
+  static Expected<std::unique_ptr<SymbolizerIndex>>
+  create(std::unique_ptr<MemoryBuffer> Buffer);
+
+  /// Return the frames for \p Address, or None if the index doesn't cover it.
+  Optional<DIInliningInfo> lookup(uint64_t Address) const;
+
+private:
+  SymbolizerIndex(std::unique_ptr<MemoryBuffer> Buffer, ArrayRef<Entry> Entries,
+                  ArrayRef<Frame> Frames, StringRef Strings)
+      : Buffer(std::move(Buffer)), Entries(Entries), Frames(Frames),
+        Strings(Strings) {}
+
+  Optional<StringRef> getString(uint32_t Offset) const;
+
+  std::unique_ptr<MemoryBuffer> Buffer;
+  ArrayRef<Entry> Entries;
+  ArrayRef<Frame> Frames;
+  StringRef Strings;
+};
+
+/// A module that answers inlined code queries from an index when it covers
+/// the address, and forwards everything else to the module it wraps.
+class IndexedSymbolizableModule : public SymbolizableModule {
+public:
+  IndexedSymbolizableModule(std::unique_ptr<SymbolizableModule> Module,
+                            std::unique_ptr<SymbolizerIndex> Index,
+                            FunctionNameKind FNKind, bool UseSymbolTable)
+      : Module(std::move(Module)), Index(std::move(Index)), FNKind(FNKind),
+        UseSymbolTable(UseSymbolTable) {}
+
+  DILineInfo symbolizeCode(object::SectionedAddress ModuleOffset,
+                           FunctionNameKind FNKind,
+                           bool UseSymbolTable) const override;
+  DIInliningInfo symbolizeInlinedCode(object::SectionedAddress ModuleOffset,
+                                      FunctionNameKind FNKind,
+                                      bool UseSymbolTable) const override;
+  DIGlobal symbolizeData(object::SectionedAddress ModuleOffset) const override;
+  std::vector<DILocal>
+  symbolizeFrame(object::SectionedAddress ModuleOffset) const override;
+  bool isWin32Module() const override;
+  uint64_t getModulePreferredBase() const override;
+
+private:
+  std::unique_ptr<SymbolizableModule> Module;
+  std::unique_ptr<SymbolizerIndex> Index;
+  // The options the index was built with.
+  FunctionNameKind FNKind;
+  bool UseSymbolTable;
+};
+
+/// Wrap \p Module, whose debug info is \p DICtx, with the index for
+/// \p BuildID in \p CacheDir, building and saving the index first if the
+/// cache doesn't have it yet. Return \p Module itself if the index can
+/// neither be read nor written.
+std::unique_ptr<SymbolizableModule>
+getIndexedModule(std::unique_ptr<SymbolizableModule> Module,
+                 DWARFContext &DICtx, StringRef CacheDir,
+                 ArrayRef<uint8_t> BuildID, FunctionNameKind FNKind,
+                 bool UseSymbolTable);
+
+} // end namespace symbolize
+} // end namespace llvm
+
+#endif // LLVM_LIB_DEBUGINFO_SYMBOLIZE_SYMBOLIZERINDEX_H
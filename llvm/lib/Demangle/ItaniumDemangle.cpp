@@ -13,6 +13,7 @@
 #include "llvm/Demangle/Demangle.h"
 #include "llvm/Demangle/ItaniumDemangle.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cstdio>
@@ -254,8 +255,20 @@ class BumpPointerAllocator {
 
   alignas(long double) char InitialBuffer[AllocSize];
   BlockMeta* BlockList = nullptr;
+  // Blocks released by reset(), which grow() reuses before calling malloc, so
+  // that a reused allocator stops allocating once it has seen its largest
+  // name.
+  BlockMeta* FreeList = nullptr;
+  // Allocations larger than a block. They are freed by reset().
+  BlockMeta* MassiveList = nullptr;
 
   void grow() {
+    if (FreeList) {
+      BlockMeta* Reused = FreeList;
+      FreeList = FreeList->Next;
+      BlockList = new (Reused) BlockMeta{BlockList, 0};
+      return;
+    }
     char* NewMeta = static_cast<char *>(std::malloc(AllocSize));
     if (NewMeta == nullptr)
       std::terminate();
@@ -267,7 +280,7 @@ class BumpPointerAllocator {
     BlockMeta* NewMeta = reinterpret_cast<BlockMeta*>(std::malloc(NBytes));
     if (NewMeta == nullptr)
       std::terminate();
-    BlockList->Next = new (NewMeta) BlockMeta{BlockList->Next, 0};
+    MassiveList = new (NewMeta) BlockMeta{MassiveList, 0};
     return static_cast<void*>(NewMeta + 1);
   }
 
@@ -291,13 +304,27 @@ public:
     while (BlockList) {
       BlockMeta* Tmp = BlockList;
       BlockList = BlockList->Next;
-      if (reinterpret_cast<char*>(Tmp) != InitialBuffer)
-        std::free(Tmp);
+      if (reinterpret_cast<char*>(Tmp) != InitialBuffer) {
+        Tmp->Next = FreeList;
+        FreeList = Tmp;
+      }
+    }
+    while (MassiveList) {
+      BlockMeta* Tmp = MassiveList;
+      MassiveList = MassiveList->Next;
+      std::free(Tmp);
     }
     BlockList = new (InitialBuffer) BlockMeta{nullptr, 0};
   }
 
-  ~BumpPointerAllocator() { reset(); }
+  ~BumpPointerAllocator() {
+    reset();
+    while (FreeList) {
+      BlockMeta* Tmp = FreeList;
+      FreeList = FreeList->Next;
+      std::free(Tmp);
+    }
+  }
 };
 
 class DefaultAllocator {
@@ -377,8 +404,12 @@ operator=(ItaniumPartialDemangler &&Other) {
 
 // Demangle MangledName into an AST, storing it into this->RootNode.
 bool ItaniumPartialDemangler::partialDemangle(const char *MangledName) {
+  return partialDemangle(MangledName, std::strlen(MangledName));
+}
+
+bool ItaniumPartialDemangler::partialDemangle(const char *MangledName,
+                                              size_t Len) {
   Demangler *Parser = static_cast<Demangler *>(Context);
-  size_t Len = std::strlen(MangledName);
   Parser->reset(MangledName, MangledName + Len);
   RootNode = Parser->parse();
   return RootNode == nullptr;
@@ -520,6 +551,25 @@ char *ItaniumPartialDemangler::finishDemangle(char *Buf, size_t *N) const {
   return printNode(static_cast<Node *>(RootNode), Buf, N);
 }
 
+ItaniumDemangleContext::~ItaniumDemangleContext() { std::free(Buf); }
+
+const char *ItaniumDemangleContext::demangle(const char *MangledName,
+                                             size_t Len, size_t *OutLen) {
+  if (Demangler.partialDemangle(MangledName, Len))
+    return nullptr;
+  // finishDemangle reports the length of the string it printed, not the size
+  // of the buffer it may have grown, but the buffer is at least that large.
+  size_t N = Capacity;
+  char *Result = Demangler.finishDemangle(Buf, &N);
+  if (Result == nullptr)
+    return nullptr;
+  Buf = Result;
+  Capacity = std::max(Capacity, N);
+  if (OutLen != nullptr)
+    *OutLen = N - 1;
+  return Buf;
+}
+
 bool ItaniumPartialDemangler::hasFunctionQualifiers() const {
   assert(RootNode != nullptr && "must call partialDemangle()");
   if (!isFunction())
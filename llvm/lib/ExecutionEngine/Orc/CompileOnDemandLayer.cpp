@@ -117,6 +117,15 @@ void CompileOnDemandLayer::setPartitionFunction(PartitionFunction Partition) {
   this->Partition = std::move(Partition);
 }
 
+IndirectStubsManager *
+CompileOnDemandLayer::getImplDylibStubsManager(JITDylib &ImplD) {
+  std::lock_guard<std::mutex> Lock(CODLayerMutex);
+  for (auto &KV : DylibResources)
+    if (&KV.second.getImplDylib() == &ImplD)
+      return &KV.second.getISManager();
+  return nullptr;
+}
+
 void CompileOnDemandLayer::emit(MaterializationResponsibility R,
                                 ThreadSafeModule TSM) {
   assert(TSM.getModule() && "Null module");
@@ -163,6 +172,7 @@ void CompileOnDemandLayer::emit(MaterializationResponsibility R,
 
 CompileOnDemandLayer::PerDylibResources &
 CompileOnDemandLayer::getPerDylibResources(JITDylib &TargetD) {
+  std::lock_guard<std::mutex> Lock(CODLayerMutex);
   auto I = DylibResources.find(&TargetD);
   if (I == DylibResources.end()) {
     auto &ImplD = getExecutionSession().createJITDylib(
@@ -17,8 +17,9 @@ namespace {
   // A SimpleCompiler that owns its TargetMachine.
   class TMOwningSimpleCompiler : public llvm::orc::SimpleCompiler {
   public:
-    TMOwningSimpleCompiler(std::unique_ptr<llvm::TargetMachine> TM)
-      : llvm::orc::SimpleCompiler(*TM), TM(std::move(TM)) {}
+    TMOwningSimpleCompiler(std::unique_ptr<llvm::TargetMachine> TM,
+                           llvm::ObjectCache *ObjCache = nullptr)
+      : llvm::orc::SimpleCompiler(*TM, ObjCache), TM(std::move(TM)) {}
   private:
     // FIXME: shared because std::functions (and thus
     // IRCompileLayer::CompileFunction) are not moveable.
@@ -95,6 +96,16 @@ LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
 
   ObjLinkingLayer = createObjectLinkingLayer(S, *ES);
 
+  if (!S.ObjectCacheDir.empty()) {
+    if (auto CacheOrErr = PersistentObjectCache::Create(
+            S.ObjectCacheDir, *S.JTMB, std::move(S.ObjectCachePruningPolicy)))
+      ObjCache = std::move(*CacheOrErr);
+    else {
+      Err = CacheOrErr.takeError();
+      return;
+    }
+  }
+
   if (S.NumCompileThreads > 0) {
 
     // Configure multi-threaded.
@@ -108,7 +119,8 @@ LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
 
     {
       auto TmpCompileLayer = llvm::make_unique<IRCompileLayer>(
-          *ES, *ObjLinkingLayer, ConcurrentIRCompiler(std::move(*S.JTMB)));
+          *ES, *ObjLinkingLayer,
+          ConcurrentIRCompiler(std::move(*S.JTMB), ObjCache.get()));
 
       TmpCompileLayer->setCloneToNewContextOnEmit(true);
       CompileLayer = std::move(TmpCompileLayer);
@@ -135,7 +147,8 @@ LLJIT::LLJIT(LLJITBuilderState &S, Error &Err)
     DL = (*TM)->createDataLayout();
 
     CompileLayer = llvm::make_unique<IRCompileLayer>(
-        *ES, *ObjLinkingLayer, TMOwningSimpleCompiler(std::move(*TM)));
+        *ES, *ObjLinkingLayer,
+        TMOwningSimpleCompiler(std::move(*TM), ObjCache.get()));
   }
 }
 
@@ -168,7 +181,15 @@ void LLJIT::recordCtorDtors(Module &M) {
 Error LLLazyJITBuilderState::prepareForConstruction() {
   if (auto Err = LLJITBuilderState::prepareForConstruction())
     return Err;
+  if (SpeculativeCompileDepth > 0 && NumCompileThreads == 0)
+    return make_error<StringError>(
+        "Speculative compilation requires at least one compile thread",
+        inconvertibleErrorCode());
   TT = JTMB->getTargetTriple();
+  if (TierUpThreshold > 0) {
+    TierUpJTMB = *JTMB;
+    TierUpJTMB->setCodeGenOptLevel(TierUpOptLevel);
+  }
   return Error::success();
 }
 
@@ -222,10 +243,46 @@ LLLazyJIT::LLLazyJIT(LLLazyJITBuilderState &S, Error &Err) : LLJIT(S, Err) {
 
   // Create the transform layer.
   TransformLayer = llvm::make_unique<IRTransformLayer>(*ES, *CompileLayer);
+  IRLayer *CODBaseLayer = TransformLayer.get();
+
+  // Create the tier-up layers, if requested. They compile to the same object
+  // linking layer as the baseline code.
+  if (S.TierUpThreshold > 0) {
+    if (S.NumCompileThreads > 0)
+      TierUpCompileLayer = llvm::make_unique<IRCompileLayer>(
+          *ES, *ObjLinkingLayer,
+          ConcurrentIRCompiler(std::move(*S.TierUpJTMB)));
+    else {
+      auto TM = S.TierUpJTMB->createTargetMachine();
+      if (!TM) {
+        Err = TM.takeError();
+        return;
+      }
+      TierUpCompileLayer = llvm::make_unique<IRCompileLayer>(
+          *ES, *ObjLinkingLayer, TMOwningSimpleCompiler(std::move(*TM)));
+    }
+    TierUpTransformLayer =
+        llvm::make_unique<IRTransformLayer>(*ES, *TierUpCompileLayer);
+    TieredLayer = llvm::make_unique<TieredCompileLayer>(
+        *ES, *CODBaseLayer, *TierUpTransformLayer,
+        [this](JITDylib &ImplJD) {
+          return CODLayer->getImplDylibStubsManager(ImplJD);
+        },
+        S.TierUpThreshold);
+    CODBaseLayer = TieredLayer.get();
+  }
+
+  // Create the speculation layer, if requested.
+  if (S.SpeculativeCompileDepth > 0) {
+    Spec = llvm::make_unique<Speculator>(*ES, S.SpeculativeCompileDepth);
+    SpeculationLayer =
+        llvm::make_unique<IRSpeculationLayer>(*ES, *TransformLayer, *Spec);
+    CODBaseLayer = SpeculationLayer.get();
+  }
 
   // Create the COD layer.
   CODLayer = llvm::make_unique<CompileOnDemandLayer>(
-      *ES, *TransformLayer, *LCTMgr, std::move(ISMBuilder));
+      *ES, *CODBaseLayer, *LCTMgr, std::move(ISMBuilder));
 
   if (S.NumCompileThreads > 0)
     CODLayer->setCloneToNewContextOnEmit(true);
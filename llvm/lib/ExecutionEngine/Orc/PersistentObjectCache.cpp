@@ -0,0 +1,157 @@
+//===---- PersistentObjectCache.cpp - On-disk cache of JIT'd objects ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SHA1.h"
+#include "llvm/Support/raw_ostream.h"
+
+#if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+namespace llvm {
+namespace orc {
+
+// Describes everything besides the module that affects the compiled object.
+static std::string getTargetKey(const JITTargetMachineBuilder &JTMB) {
+  std::string Key;
+  raw_string_ostream OS(Key);
+  const TargetOptions &Options = JTMB.getOptions();
+  OS << LLVM_VERSION_STRING << ';' << JTMB.getTargetTriple().str() << ';'
+     << JTMB.getCPU() << ';' << JTMB.getFeatures().getString() << ';'
+     << static_cast<int>(JTMB.getCodeGenOptLevel()) << ';'
+     << (JTMB.getRelocationModel() ? *JTMB.getRelocationModel() + 1 : 0)
+     << ';' << (JTMB.getCodeModel() ? *JTMB.getCodeModel() + 1 : 0) << ';'
+     << Options.UnsafeFPMath << Options.NoInfsFPMath << Options.NoNaNsFPMath
+     << Options.NoTrappingFPMath << Options.NoSignedZerosFPMath
+     << Options.GuaranteedTailCallOpt << Options.UseInitArray
+     << Options.FunctionSections << Options.DataSections
+     << Options.EmulatedTLS << Options.EnableIPRA << ';'
+     << static_cast<int>(Options.FloatABIType) << ';'
+     << static_cast<int>(Options.AllowFPOpFusion) << ';'
+     << static_cast<int>(Options.ThreadModel) << ';'
+     << static_cast<int>(Options.ExceptionModel);
+  return OS.str();
+}
+
+Expected<std::unique_ptr<PersistentObjectCache>>
+PersistentObjectCache::Create(StringRef CacheDir,
+                              const JITTargetMachineBuilder &JTMB,
+                              CachePruningPolicy Policy) {
+  if (auto EC = sys::fs::create_directories(CacheDir))
+    return createFileError(CacheDir, EC);
+
+  std::unique_ptr<PersistentObjectCache> Cache(
+      new PersistentObjectCache(CacheDir, getTargetKey(JTMB),
+                                std::move(Policy)));
+  Cache->prune();
+  return std::move(Cache);
+}
+
+std::string PersistentObjectCache::getKey(const Module &M) const {
+  SmallVector<char, 0> Bitcode;
+  {
+    raw_svector_ostream OS(Bitcode);
+    WriteBitcodeToFile(M, OS);
+  }
+
+  SHA1 Hasher;
+  Hasher.update(TargetKey);
+  Hasher.update(StringRef(Bitcode.data(), Bitcode.size()));
+  return toHex(Hasher.final());
+}
+
+std::string PersistentObjectCache::getEntryPath(StringRef Key) const {
+  // This choice of file name allows the cache to be pruned (see pruneCache()
+  // in include/llvm/Support/CachePruning.h).
+  SmallString<128> EntryPath(CacheDir);
+  sys::path::append(EntryPath, "llvmcache-" + Key);
+  return EntryPath.str();
+}
+
+std::unique_ptr<MemoryBuffer>
+PersistentObjectCache::getObject(const Module *M) {
+  std::string Key = getKey(*M);
+  std::string EntryPath = getEntryPath(Key);
+
+  // Bump the access time of hits so that the pruner evicts cold entries
+  // first. Any failure to read the entry (including another process pruning
+  // it) is a miss.
+  int FD;
+  if (!sys::fs::openFileForRead(EntryPath, FD, sys::fs::OF_UpdateAtime)) {
+    auto MBOrErr = MemoryBuffer::getOpenFile(FD, EntryPath, /*FileSize=*/-1,
+                                             /*RequiresNullTerminator=*/false);
+    close(FD);
+    if (MBOrErr)
+      return std::move(*MBOrErr);
+  }
+
+  std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+  PendingKeys[M] = std::move(Key);
+  return nullptr;
+}
+
+void PersistentObjectCache::notifyObjectCompiled(const Module *M,
+                                                 MemoryBufferRef Obj) {
+  std::string Key;
+  {
+    std::lock_guard<std::mutex> Lock(PendingKeysMutex);
+    auto I = PendingKeys.find(M);
+    if (I != PendingKeys.end()) {
+      Key = std::move(I->second);
+      PendingKeys.erase(I);
+    }
+  }
+  if (Key.empty())
+    Key = getKey(*M);
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // lookups never see a partial entry. The cache is only an optimization:
+  // failing to add an entry is not an error.
+  SmallString<128> TempFilenameModel(CacheDir);
+  sys::path::append(TempFilenameModel, "JIT-%%%%%%.tmp.o");
+  auto Temp = sys::fs::TempFile::create(
+      TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    OS << Obj.getBuffer();
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+
+  // On POSIX systems this atomically replaces an entry that another process
+  // added in the meantime, which has the same contents. On Windows the rename
+  // may fail if that entry is open; keeping the existing entry is fine then.
+  if (auto Err = Temp->keep(getEntryPath(Key))) {
+    consumeError(std::move(Err));
+    consumeError(Temp->discard());
+  }
+}
+
+void PersistentObjectCache::prune() { pruneCache(CacheDir, Policy); }
+
+} // end namespace orc
+} // end namespace llvm
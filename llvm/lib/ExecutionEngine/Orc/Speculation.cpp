@@ -0,0 +1,110 @@
+//===---------- Speculation.cpp - Speculative compilation of callees ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/Speculation.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include <algorithm>
+
+#define DEBUG_TYPE "orc"
+
+namespace llvm {
+namespace orc {
+
+void Speculator::speculateFor(JITDylib &JD, const SymbolStringPtr &Caller,
+                              TargetList Targets) {
+  std::vector<SymbolStringPtr> ToLookup;
+  {
+    std::lock_guard<std::mutex> Lock(SpeculatorMutex);
+    auto &JDDepths = Depths[&JD];
+
+    // Symbols that were not speculated on are being materialized for real.
+    unsigned Depth = JDDepths.lookup(Caller);
+    if (Depth >= MaxDepth)
+      return;
+
+    std::stable_sort(Targets.begin(), Targets.end(),
+                     [](const std::pair<SymbolStringPtr, uint64_t> &LHS,
+                        const std::pair<SymbolStringPtr, uint64_t> &RHS) {
+                       return LHS.second > RHS.second;
+                     });
+    for (auto &Target : Targets) {
+      if (ToLookup.size() == MaxTargetsPerSymbol)
+        break;
+      if (Target.first == Caller)
+        continue;
+      if (JDDepths.insert(std::make_pair(Target.first, Depth + 1)).second)
+        ToLookup.push_back(std::move(Target.first));
+    }
+  }
+
+  // Issue one lookup per target, in priority order, so that materializers are
+  // dispatched in that order and a missing symbol does not hold back the
+  // others.
+  for (auto &Name : ToLookup) {
+    LLVM_DEBUG({
+      dbgs() << "Speculating on " << Name << " for " << Caller << " in "
+             << JD.getName() << "\n";
+    });
+    ES.lookup(JITDylibSearchList({{&JD, true}}), {Name}, SymbolState::Ready,
+              [](Expected<SymbolMap> Result) {
+                // Speculation is best-effort.
+                consumeError(Result.takeError());
+              },
+              NoDependenciesToRegister);
+  }
+}
+
+IRSpeculationLayer::IRSpeculationLayer(ExecutionSession &ES,
+                                       IRLayer &BaseLayer, Speculator &S,
+                                       TargetsFunction GetTargets)
+    : IRLayer(ES), BaseLayer(BaseLayer), S(S),
+      GetTargets(std::move(GetTargets)) {}
+
+void IRSpeculationLayer::emit(MaterializationResponsibility R,
+                              ThreadSafeModule TSM) {
+  assert(TSM.getModule() && "Module must not be null");
+
+  Module &M = *TSM.getModule();
+  MangleAndInterner Mangle(getExecutionSession(), M.getDataLayout());
+  for (auto &F : M) {
+    if (F.isDeclaration() || !F.hasName())
+      continue;
+    auto Targets = GetTargets(F, Mangle);
+    if (!Targets.empty())
+      S.speculateFor(R.getTargetJITDylib(), Mangle(F.getName()),
+                     std::move(Targets));
+  }
+
+  BaseLayer.emit(std::move(R), std::move(TSM));
+}
+
+Speculator::TargetList
+IRSpeculationLayer::findDirectCallees(Function &F, MangleAndInterner &Mangle) {
+  MapVector<Function *, uint64_t> CallSiteCounts;
+  for (auto &I : instructions(F))
+    if (auto *Call = dyn_cast<CallBase>(&I))
+      if (auto *Callee = Call->getCalledFunction())
+        if (!Callee->isIntrinsic() && Callee->hasName())
+          ++CallSiteCounts[Callee];
+
+  Speculator::TargetList Targets;
+  for (auto &KV : CallSiteCounts) {
+    uint64_t Priority = KV.second;
+    if (auto EntryCount = KV.first->getEntryCount())
+      Priority = EntryCount.getCount();
+    Targets.push_back(std::make_pair(Mangle(KV.first->getName()), Priority));
+  }
+  return Targets;
+}
+
+} // end namespace orc
+} // end namespace llvm
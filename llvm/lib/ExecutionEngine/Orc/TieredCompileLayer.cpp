@@ -0,0 +1,245 @@
+//===------ TieredCompileLayer.cpp - Recompile hot functions --------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/TieredCompileLayer.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#define DEBUG_TYPE "orc"
+
+namespace llvm {
+namespace orc {
+
+/// Extracts one function from a copy of its original module and emits it
+/// through the optimizing layer.
+class TieredCompileLayer::OptimizedFunctionMaterializationUnit
+    : public MaterializationUnit {
+public:
+  OptimizedFunctionMaterializationUnit(
+      SymbolFlagsMap SymbolFlags, VModuleKey K, IRLayer &OptimizingLayer,
+      std::shared_ptr<ThreadSafeModule> Source, std::string FunctionName)
+      : MaterializationUnit(std::move(SymbolFlags), std::move(K)),
+        OptimizingLayer(OptimizingLayer), Source(std::move(Source)),
+        FunctionName(std::move(FunctionName)) {}
+
+  StringRef getName() const override { return FunctionName; }
+
+private:
+  void materialize(MaterializationResponsibility R) override {
+    // Local functions are copied along with the function (they can not be
+    // referenced from outside the module); everything else is referenced.
+    auto Extracted = cloneToNewContext(*Source, [&](const GlobalValue &GV) {
+      return GV.getName() == FunctionName ||
+             (isa<Function>(GV) && GV.hasLocalLinkage());
+    });
+    auto &M = *Extracted.getModule();
+    M.setModuleIdentifier(M.getModuleIdentifier() + ".opt");
+    OptimizingLayer.emit(std::move(R), std::move(Extracted));
+  }
+
+  void discard(const JITDylib &JD, const SymbolStringPtr &Name) override {
+    // Another copy of a weak function was tiered first. Nothing to do: the
+    // body is only extracted on materialization.
+  }
+
+  IRLayer &OptimizingLayer;
+  std::shared_ptr<ThreadSafeModule> Source;
+  std::string FunctionName;
+};
+
+TieredCompileLayer::TieredCompileLayer(ExecutionSession &ES,
+                                       IRLayer &BaseLayer,
+                                       IRLayer &OptimizingLayer,
+                                       GetStubsManagerFunction GetStubsManager,
+                                       uint64_t HotThreshold)
+    : IRLayer(ES), BaseLayer(BaseLayer), OptimizingLayer(OptimizingLayer),
+      GetStubsManager(std::move(GetStubsManager)),
+      HotThreshold(HotThreshold) {}
+
+static bool canTierUp(const Module &M) {
+  if (!M.alias_empty())
+    return false;
+  for (auto &G : M.globals())
+    if (G.hasLocalLinkage())
+      return false;
+  return true;
+}
+
+void TieredCompileLayer::emit(MaterializationResponsibility R,
+                              ThreadSafeModule TSM) {
+  assert(TSM.getModule() && "Module must not be null");
+
+  auto &ES = getExecutionSession();
+  auto &M = *TSM.getModule();
+  if (!canTierUp(M)) {
+    BaseLayer.emit(std::move(R), std::move(TSM));
+    return;
+  }
+
+  std::vector<Function *> ToTier;
+  for (auto &F : M)
+    if (!F.isDeclaration() && F.hasName() && !F.hasLocalLinkage() &&
+        !F.hasFnAttribute(Attribute::Naked))
+      ToTier.push_back(&F);
+  if (ToTier.empty()) {
+    BaseLayer.emit(std::move(R), std::move(TSM));
+    return;
+  }
+
+  // Keep a copy of the module to recompile from before instrumenting it.
+  auto Source = std::make_shared<ThreadSafeModule>(cloneToNewContext(TSM));
+
+  auto &ImplJD = R.getTargetJITDylib();
+  MangleAndInterner Mangle(ES, M.getDataLayout());
+  for (auto *F : ToTier) {
+    auto Name = Mangle(F->getName());
+    auto &OptJD = getOptimizedDylib(ImplJD);
+
+    // Define the optimized version now. It is only compiled once tierUp looks
+    // it up.
+    SymbolFlagsMap SymbolFlags;
+    SymbolFlags[Name] = JITSymbolFlags::fromGlobalValue(*F);
+    auto MU = llvm::make_unique<OptimizedFunctionMaterializationUnit>(
+        std::move(SymbolFlags), R.getVModuleKey(), OptimizingLayer, Source,
+        F->getName());
+    if (auto Err = OptJD.define(std::move(MU))) {
+      // The function stays at the baseline tier.
+      ES.reportError(std::move(Err));
+      continue;
+    }
+
+    uint64_t FunctionId;
+    uint64_t *Counter;
+    {
+      std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+      FunctionId = Functions.size();
+      Functions.emplace_back(ImplJD, OptJD, std::move(Name));
+      Counter = &Functions.back().Counter;
+    }
+    instrument(*F, FunctionId, *Counter);
+  }
+
+  BaseLayer.emit(std::move(R), std::move(TSM));
+}
+
+void TieredCompileLayer::tierUpEntry(TieredCompileLayer *Layer,
+                                     uint64_t FunctionId) {
+  Layer->tierUp(FunctionId);
+}
+
+void TieredCompileLayer::tierUp(uint64_t FunctionId) {
+  JITDylib *ImplJD;
+  JITDylib *OptJD;
+  SymbolStringPtr Name;
+  {
+    std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+    auto &TF = Functions[FunctionId];
+    ImplJD = &TF.ImplJD;
+    OptJD = &TF.OptJD;
+    Name = TF.Name;
+  }
+
+  // If callers do not go through a stub there is nothing to redirect.
+  auto *ISMgr = GetStubsManager(*ImplJD);
+  if (!ISMgr || !ISMgr->findPointer(*Name))
+    return;
+
+  LLVM_DEBUG(dbgs() << "Recompiling hot function " << Name << "\n");
+  auto &ES = getExecutionSession();
+  ES.lookup(JITDylibSearchList({{OptJD, true}}), {Name}, SymbolState::Ready,
+            [&ES, ISMgr, Name](Expected<SymbolMap> Result) {
+              if (!Result) {
+                ES.reportError(Result.takeError());
+                return;
+              }
+              if (auto Err = ISMgr->updatePointer(
+                      *Name, (*Result)[Name].getAddress()))
+                ES.reportError(std::move(Err));
+            },
+            NoDependenciesToRegister);
+}
+
+JITDylib &TieredCompileLayer::getOptimizedDylib(JITDylib &ImplJD) {
+  std::lock_guard<std::mutex> Lock(TieredLayerMutex);
+  auto I = OptimizedDylibs.find(&ImplJD);
+  if (I != OptimizedDylibs.end())
+    return *I->second;
+
+  // Resolve references exactly as the baseline code does, i.e. through the
+  // stubs, so that calls from optimized code also reach the best tier.
+  auto &OptJD =
+      getExecutionSession().createJITDylib(ImplJD.getName() + ".opt", false);
+  ImplJD.withSearchOrderDo([&](const JITDylibSearchList &SearchOrder) {
+    OptJD.setSearchOrder(SearchOrder, false);
+  });
+  OptimizedDylibs[&ImplJD] = &OptJD;
+  return OptJD;
+}
+
+void TieredCompileLayer::instrument(Function &F, uint64_t FunctionId,
+                                    uint64_t &Counter) {
+  auto &Ctx = F.getContext();
+  auto &DL = F.getParent()->getDataLayout();
+  auto *IntPtrTy = DL.getIntPtrType(Ctx);
+  auto *Int64Ty = Type::getInt64Ty(Ctx);
+  auto *Int8PtrTy = Type::getInt8PtrTy(Ctx);
+
+  auto *CounterPtr = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, reinterpret_cast<uintptr_t>(&Counter)),
+      Int64Ty->getPointerTo());
+  auto *TierUpTy = FunctionType::get(Type::getVoidTy(Ctx),
+                                     {Int8PtrTy, Int64Ty}, false);
+  auto *TierUpFn = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, reinterpret_cast<uintptr_t>(&tierUpEntry)),
+      TierUpTy->getPointerTo());
+  auto *LayerPtr = ConstantExpr::getIntToPtr(
+      ConstantInt::get(IntPtrTy, reinterpret_cast<uintptr_t>(this)),
+      Int8PtrTy);
+
+  // Count on entry (after the static allocas) and at the end of each loop
+  // latch. Collect all points first: splitting blocks would invalidate the
+  // dominator tree.
+  SmallVector<Instruction *, 8> CountPoints;
+  auto EntryIt = F.getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(*EntryIt))
+    ++EntryIt;
+  CountPoints.push_back(&*EntryIt);
+  DominatorTree DT(F);
+  for (auto &BB : F) {
+    auto *Term = BB.getTerminator();
+    if (Term->isEHPad())
+      continue;
+    if (llvm::any_of(successors(&BB), [&](BasicBlock *Succ) {
+          return DT.dominates(Succ, &BB);
+        }))
+      CountPoints.push_back(Term);
+  }
+
+  // The counter is not updated atomically: racing updates only delay tiering.
+  auto *Unlikely = MDBuilder(Ctx).createBranchWeights(1, 1 << 20);
+  for (auto *CountPoint : CountPoints) {
+    IRBuilder<> Builder(CountPoint);
+    auto *Count = Builder.CreateAdd(Builder.CreateLoad(Int64Ty, CounterPtr),
+                                    Builder.getInt64(1));
+    Builder.CreateStore(Count, CounterPtr);
+    auto *IsHot = Builder.CreateICmpEQ(Count, Builder.getInt64(HotThreshold));
+    auto *TierUpTerm =
+        SplitBlockAndInsertIfThen(IsHot, CountPoint, false, Unlikely);
+    IRBuilder<>(TierUpTerm)
+        .CreateCall(TierUpTy, TierUpFn,
+                    {LayerPtr, ConstantInt::get(Int64Ty, FunctionId)});
+  }
+}
+
+} // end namespace orc
+} // end namespace llvm
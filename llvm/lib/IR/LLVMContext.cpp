@@ -329,6 +329,10 @@ void LLVMContext::enableDebugTypeODRUniquing() {
 
 void LLVMContext::disableDebugTypeODRUniquing() { pImpl->DITypeMap.reset(); }
 
+void LLVMContext::dropTriviallyDeadConstants() {
+  pImpl->dropTriviallyDeadConstants();
+}
+
 void LLVMContext::setDiscardValueNames(bool Discard) {
   pImpl->DiscardValueNames = Discard;
 }
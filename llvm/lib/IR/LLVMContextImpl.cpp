@@ -160,6 +160,66 @@ void Module::dropTriviallyDeadConstantArrays() {
   Context.pImpl->dropTriviallyDeadConstantArrays();
 }
 
+/// A uniqued constant can be collected if nothing refers to it: no use, and
+/// no ConstantAsMetadata (e.g. !range operands), which does not count as one.
+static bool isTriviallyDeadConstant(const Constant *C) {
+  return C->use_empty() && !C->isUsedByMetadata();
+}
+
+template <class ConstantClass>
+static bool dropDeadConstants(ConstantUniqueMap<ConstantClass> &Map) {
+  bool Changed = false;
+  for (auto I = Map.begin(), E = Map.end(); I != E;) {
+    auto *C = *I++;
+    if (isTriviallyDeadConstant(C)) {
+      Changed = true;
+      C->destroyConstant();
+    }
+  }
+  return Changed;
+}
+
+template <class MapTy> static bool dropDeadScalarConstants(MapTy &Map) {
+  bool Changed = false;
+  for (auto I = Map.begin(), E = Map.end(); I != E;) {
+    auto Cur = I++;
+    if (isTriviallyDeadConstant(Cur->second.get())) {
+      Changed = true;
+      Map.erase(Cur);
+    }
+  }
+  return Changed;
+}
+
+void LLVMContextImpl::dropTriviallyDeadConstants() {
+  bool Changed;
+  do {
+    // Destroying an aggregate or an expression drops the uses of its
+    // operands, which may in turn become dead: iterate to a fixed point.
+    Changed = dropDeadConstants(ExprConstants);
+    Changed |= dropDeadConstants(ArrayConstants);
+    Changed |= dropDeadConstants(StructConstants);
+    Changed |= dropDeadConstants(VectorConstants);
+  } while (Changed);
+
+  // The leaves have no operands, so one sweep over each table is enough.
+  SmallVector<ConstantDataSequential *, 16> DeadCDS;
+  for (auto &Entry : CDSConstants)
+    for (ConstantDataSequential *C = Entry.second; C; C = C->Next)
+      if (isTriviallyDeadConstant(C))
+        DeadCDS.push_back(C);
+  for (ConstantDataSequential *C : DeadCDS)
+    C->destroyConstant();
+
+  // i1 true and false are cached outside of the map.
+  if (TheTrueVal && isTriviallyDeadConstant(TheTrueVal))
+    TheTrueVal = nullptr;
+  if (TheFalseVal && isTriviallyDeadConstant(TheFalseVal))
+    TheFalseVal = nullptr;
+  dropDeadScalarConstants(IntConstants);
+  dropDeadScalarConstants(FPConstants);
+}
+
 namespace llvm {
 
 /// Make MDOperand transparent for hashing.
@@ -1408,6 +1408,10 @@ public:
   /// Destroy the ConstantArrays if they are not used.
   void dropTriviallyDeadConstantArrays();
 
+  /// Destroy the uniqued constants that are neither used nor referenced from
+  /// metadata. See LLVMContext::dropTriviallyDeadConstants.
+  void dropTriviallyDeadConstants();
+
   mutable OptPassGate *OPG = nullptr;
 
   /// Access the object which can disable optional passes and individual
@@ -119,6 +119,8 @@ formatToSerializer(RemarksSerializerFormat RemarksFormat, raw_ostream &OS) {
     return nullptr;
   case RemarksSerializerFormat::YAML:
     return llvm::make_unique<remarks::YAMLSerializer>(OS);
+  case RemarksSerializerFormat::Bitstream:
+    return llvm::make_unique<remarks::BitstreamSerializer>(OS);
   };
 }
 
@@ -126,6 +128,7 @@ Expected<RemarksSerializerFormat>
 llvm::parseSerializerFormat(StringRef StrFormat) {
   auto Format = StringSwitch<RemarksSerializerFormat>(StrFormat)
                     .Cases("", "yaml", RemarksSerializerFormat::YAML)
+                    .Case("bitstream", RemarksSerializerFormat::Bitstream)
                     .Default(RemarksSerializerFormat::Unknown);
 
   if (Format == RemarksSerializerFormat::Unknown)
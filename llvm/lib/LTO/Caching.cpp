@@ -12,11 +12,17 @@
 
 #include "llvm/LTO/Caching.h"
 #include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/Process.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <mutex>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
 #include <unistd.h>
@@ -27,16 +33,174 @@
 using namespace llvm;
 using namespace llvm::lto;
 
-Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
-                                            AddBufferFn AddBuffer) {
+ObjectStore::~ObjectStore() = default;
+
+namespace {
+class CommandObjectStore : public ObjectStore {
+  std::string Program;
+
+  /// The lookups started by prefetch() that get() hasn't taken yet.
+  struct Lookup {
+    std::shared_future<void> Done;
+    std::unique_ptr<MemoryBuffer> Object;
+    std::string ErrMsg;
+  };
+  StringMap<std::shared_ptr<Lookup>> Prefetched;
+  std::mutex PrefetchedMu;
+
+  /// Set by the destructor, so that the prefetches that haven't started yet
+  /// don't hold it up.
+  std::atomic<bool> Cancelled{false};
+
+  // Declared last, so that it is destroyed while the rest is still alive.
+  ThreadPool Pool;
+
+  Error run(StringRef Command, StringRef Key, StringRef Path, int &Result) {
+    StringRef Args[] = {Program, Command, Key, Path};
+    std::string ErrMsg;
+    Result = sys::ExecuteAndWait(Program, Args, /*Env=*/None, /*Redirects=*/{},
+                                 /*SecondsToWait=*/0, /*MemoryLimit=*/0,
+                                 &ErrMsg);
+    if (Result < 0)
+      return make_error<StringError>("failed to run " + Program + ": " + ErrMsg,
+                                     inconvertibleErrorCode());
+    return Error::success();
+  }
+
+  Expected<std::unique_ptr<MemoryBuffer>> fetch(StringRef Key) {
+    SmallString<128> Path;
+    if (std::error_code EC =
+            sys::fs::createTemporaryFile("thinlto-store", "o", Path))
+      return errorCodeToError(EC);
+    int Result;
+    Error E = run("get", Key, Path, Result);
+    ErrorOr<std::unique_ptr<MemoryBuffer>> MBOrErr = nullptr;
+    if (!E && Result == 0)
+      MBOrErr = MemoryBuffer::getFile(Path, /*FileSize*/ -1,
+                                      /*RequiresNullTerminator*/ false);
+    sys::fs::remove(Path);
+    if (E)
+      return std::move(E);
+    if (Result != 0 && Result != 1)
+      return make_error<StringError>(Program + " get " + Key + " failed",
+                                     inconvertibleErrorCode());
+    if (!MBOrErr)
+      return errorCodeToError(MBOrErr.getError());
+    return std::move(*MBOrErr);
+  }
+
+public:
+  CommandObjectStore(StringRef Program, unsigned Parallelism)
+      : Program(Program), Pool(Parallelism) {
+    if (ErrorOr<std::string> Path = sys::findProgramByName(Program))
+      this->Program = *Path;
+  }
+
+  ~CommandObjectStore() override {
+    Cancelled = true;
+    Pool.wait();
+  }
+
+  Expected<std::unique_ptr<MemoryBuffer>> get(StringRef Key) override {
+    std::shared_ptr<Lookup> L;
+    {
+      std::lock_guard<std::mutex> Lock(PrefetchedMu);
+      auto It = Prefetched.find(Key);
+      if (It != Prefetched.end()) {
+        L = std::move(It->second);
+        Prefetched.erase(It);
+      }
+    }
+    if (!L)
+      return fetch(Key);
+    L->Done.wait();
+    if (!L->ErrMsg.empty())
+      return make_error<StringError>(L->ErrMsg, inconvertibleErrorCode());
+    return std::move(L->Object);
+  }
+
+  Error put(StringRef Key, MemoryBufferRef Object) override {
+    // The object may be gone once this returns, so write it out first.
+    SmallString<128> Path;
+    int FD;
+    if (std::error_code EC =
+            sys::fs::createTemporaryFile("thinlto-store", "o", FD, Path))
+      return errorCodeToError(EC);
+    {
+      raw_fd_ostream OS(FD, /*shouldClose*/ true);
+      OS << Object.getBuffer();
+      if (OS.has_error()) {
+        OS.clear_error();
+        sys::fs::remove(Path);
+        return make_error<StringError>("failed to write " + Path,
+                                       inconvertibleErrorCode());
+      }
+    }
+    Pool.async(
+        [this](std::string Key, std::string Path) {
+          int Result;
+          consumeError(run("put", Key, Path, Result));
+          sys::fs::remove(Path);
+        },
+        Key.str(), Path.str().str());
+    return Error::success();
+  }
+
+  void prefetch(StringRef Key) override {
+    // The lookup is queued under the lock, so that get() never sees it before
+    // its future is set.
+    std::lock_guard<std::mutex> Lock(PrefetchedMu);
+    auto L = std::make_shared<Lookup>();
+    if (!Prefetched.insert({Key, L}).second)
+      return;
+    L->Done = Pool.async(
+        [this, L](std::string Key) {
+          if (Cancelled)
+            return;
+          Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = fetch(Key);
+          if (MBOrErr)
+            L->Object = std::move(*MBOrErr);
+          else
+            L->ErrMsg = toString(MBOrErr.takeError());
+        },
+        Key.str());
+  }
+};
+} // end anonymous namespace
+
+std::unique_ptr<ObjectStore>
+lto::createCommandObjectStore(StringRef Program, unsigned Parallelism) {
+  return llvm::make_unique<CommandObjectStore>(Program, Parallelism);
+}
+
+static void getEntryPath(SmallVectorImpl<char> &EntryPath,
+                         StringRef CacheDirectoryPath, StringRef Key) {
+  // This choice of file name allows the cache to be pruned (see pruneCache()
+  // in include/llvm/Support/CachePruning.h).
+  sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+}
+
+Config::CachePrefetchHookFn
+lto::localCachePrefetcher(StringRef CacheDirectoryPath,
+                          std::shared_ptr<ObjectStore> Store) {
+  std::string Dir = CacheDirectoryPath;
+  return [=](StringRef Key) {
+    SmallString<64> EntryPath;
+    getEntryPath(EntryPath, Dir, Key);
+    if (!sys::fs::exists(EntryPath))
+      Store->prefetch(Key);
+  };
+}
+
+Expected<NativeObjectCache>
+lto::localCache(StringRef CacheDirectoryPath, AddBufferFn AddBuffer,
+                std::shared_ptr<ObjectStore> Store) {
   if (std::error_code EC = sys::fs::create_directories(CacheDirectoryPath))
     return errorCodeToError(EC);
 
   return [=](unsigned Task, StringRef Key) -> AddStreamFn {
-    // This choice of file name allows the cache to be pruned (see pruneCache()
-    // in include/llvm/Support/CachePruning.h).
     SmallString<64> EntryPath;
-    sys::path::append(EntryPath, CacheDirectoryPath, "llvmcache-" + Key);
+    getEntryPath(EntryPath, CacheDirectoryPath, Key);
     // First, see if we have a cache hit.
     int FD;
     SmallString<64> ResultPath;
@@ -66,19 +230,23 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
                          ": " + EC.message() + "\n");
 
     // This native object stream is responsible for commiting the resulting
-    // file to the cache and calling AddBuffer to add it to the link.
+    // file to the cache, giving it to the store if there is one, and calling
+    // AddBuffer to add it to the link.
     struct CacheStream : NativeObjectStream {
       AddBufferFn AddBuffer;
       sys::fs::TempFile TempFile;
       std::string EntryPath;
       unsigned Task;
+      std::shared_ptr<ObjectStore> Store;
+      std::string Key;
 
       CacheStream(std::unique_ptr<raw_pwrite_stream> OS, AddBufferFn AddBuffer,
                   sys::fs::TempFile TempFile, std::string EntryPath,
-                  unsigned Task)
+                  unsigned Task, std::shared_ptr<ObjectStore> Store,
+                  std::string Key)
           : NativeObjectStream(std::move(OS)), AddBuffer(std::move(AddBuffer)),
             TempFile(std::move(TempFile)), EntryPath(std::move(EntryPath)),
-            Task(Task) {}
+            Task(Task), Store(std::move(Store)), Key(std::move(Key)) {}
 
       ~CacheStream() {
         // Make sure the stream is closed before committing it.
@@ -124,25 +292,50 @@ Expected<NativeObjectCache> lto::localCache(StringRef CacheDirectoryPath,
                              TempFile.TmpName + " to " + EntryPath + ": " +
                              toString(std::move(E)) + "\n");
 
+        // The store is only an optimization, don't fail the link over it.
+        if (Store)
+          consumeError(Store->put(Key, (*MBOrErr)->getMemBufferRef()));
+
         AddBuffer(Task, std::move(*MBOrErr));
       }
     };
 
-    return [=](size_t Task) -> std::unique_ptr<NativeObjectStream> {
-      // Write to a temporary to avoid race condition
-      SmallString<64> TempFilenameModel;
-      sys::path::append(TempFilenameModel, CacheDirectoryPath, "Thin-%%%%%%.tmp.o");
-      Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
-          TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
-      if (!Temp) {
-        errs() << "Error: " << toString(Temp.takeError()) << "\n";
-        report_fatal_error("ThinLTO: Can't get a temporary file");
-      }
+    // Objects that come from the store are only added to the cache directory.
+    auto CreateStream = [=](std::shared_ptr<ObjectStore> PutStore) {
+      return [=](size_t Task) -> std::unique_ptr<NativeObjectStream> {
+        // Write to a temporary to avoid race condition
+        SmallString<64> TempFilenameModel;
+        sys::path::append(TempFilenameModel, CacheDirectoryPath,
+                          "Thin-%%%%%%.tmp.o");
+        Expected<sys::fs::TempFile> Temp = sys::fs::TempFile::create(
+            TempFilenameModel, sys::fs::owner_read | sys::fs::owner_write);
+        if (!Temp) {
+          errs() << "Error: " << toString(Temp.takeError()) << "\n";
+          report_fatal_error("ThinLTO: Can't get a temporary file");
+        }
 
-      // This CacheStream will move the temporary file into the cache when done.
-      return llvm::make_unique<CacheStream>(
-          llvm::make_unique<raw_fd_ostream>(Temp->FD, /* ShouldClose */ false),
-          AddBuffer, std::move(*Temp), EntryPath.str(), Task);
+        // This CacheStream will move the temporary file into the cache when
+        // done.
+        return llvm::make_unique<CacheStream>(
+            llvm::make_unique<raw_fd_ostream>(Temp->FD,
+                                              /* ShouldClose */ false),
+            AddBuffer, std::move(*Temp), EntryPath.str(), Task, PutStore,
+            Key.str());
+      };
     };
+
+    // Then, see if the store has it.
+    if (Store) {
+      Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = Store->get(Key);
+      if (!MBOrErr)
+        consumeError(MBOrErr.takeError());
+      else if (*MBOrErr) {
+        AddStreamFn AddStream = CreateStream(nullptr);
+        *AddStream(Task)->OS << (*MBOrErr)->getBuffer();
+        return AddStreamFn();
+      }
+    }
+
+    return CreateStream(Store);
   };
 }
@@ -47,6 +47,8 @@
 #include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/SplitModule.h"
 
+#include <condition_variable>
+#include <functional>
 #include <set>
 
 using namespace llvm;
@@ -59,6 +61,17 @@ static cl::opt<bool>
     DumpThinCGSCCs("dump-thin-cg-sccs", cl::init(false), cl::Hidden,
                    cl::desc("Dump the SCCs in the ThinLTO index's callgraph"));
 
+// Rough estimate of the peak memory of a ThinLTO backend, for the memory
+// budget of the in-process backend.
+static cl::opt<uint64_t> ThinLTOMemoryPerInstruction(
+    "thinlto-memory-per-instruction", cl::init(2048), cl::Hidden,
+    cl::desc("Estimated bytes of memory a ThinLTO backend uses per "
+             "instruction of its module and imports"));
+static cl::opt<uint64_t> ThinLTOJobBaseMemory(
+    "thinlto-job-base-memory", cl::init(32 << 20), cl::Hidden,
+    cl::desc("Estimated bytes of memory a ThinLTO backend uses regardless of "
+             "the size of its module"));
+
 /// Enable global value internalization in LTO.
 cl::opt<bool> EnableLTOInternalization(
     "enable-lto-internalization", cl::init(true), cl::Hidden,
@@ -1035,15 +1048,28 @@ class InProcessThinBackend : public ThinBackendProc {
   Optional<Error> Err;
   std::mutex ErrMu;
 
+  /// The backends to run, with their estimated cost. They are only queued on
+  /// the thread pool in wait(), largest first, so that a large module doesn't
+  /// start last and delay the whole link.
+  std::vector<std::pair<uint64_t, std::function<void()>>> Jobs;
+
+  /// The estimated memory the queued and running jobs may use at once, and
+  /// the estimated memory of those jobs.
+  uint64_t MemoryBudget;
+  uint64_t MemoryInUse = 0;
+  std::mutex MemoryMu;
+  std::condition_variable MemoryCV;
+
 public:
   InProcessThinBackend(
       Config &Conf, ModuleSummaryIndex &CombinedIndex,
-      unsigned ThinLTOParallelismLevel,
+      unsigned ThinLTOParallelismLevel, uint64_t MemoryBudget,
       const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
       AddStreamFn AddStream, NativeObjectCache Cache)
       : ThinBackendProc(Conf, CombinedIndex, ModuleToDefinedGVSummaries),
         BackendThreadPool(ThinLTOParallelismLevel),
-        AddStream(std::move(AddStream)), Cache(std::move(Cache)) {
+        AddStream(std::move(AddStream)), Cache(std::move(Cache)),
+        MemoryBudget(MemoryBudget) {
     for (auto &Name : CombinedIndex.cfiFunctionDefs())
       CfiFunctionDefs.insert(
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
@@ -1052,9 +1078,28 @@ public:
           GlobalValue::getGUID(GlobalValue::dropLLVMManglingEscape(Name)));
   }
 
+  /// Return true if the backend of \p ModuleID can be cached.
+  bool isCacheable(StringRef ModuleID) {
+    return Cache && CombinedIndex.modulePaths().count(ModuleID) &&
+           !all_of(CombinedIndex.getModuleHash(ModuleID),
+                   [](uint32_t V) { return V == 0; });
+  }
+
+  /// Compute the cache key of the backend of \p ModuleID into \p Key.
+  void computeCacheKey(
+      SmallString<40> &Key, StringRef ModuleID,
+      const FunctionImporter::ImportMapTy &ImportList,
+      const FunctionImporter::ExportSetTy &ExportList,
+      const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
+      const GVSummaryMapTy &DefinedGlobals) {
+    computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
+                       ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
+                       CfiFunctionDecls);
+  }
+
   Error runThinLTOBackendThread(
       AddStreamFn AddStream, NativeObjectCache Cache, unsigned Task,
-      BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
+      SmallString<40> Key, BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
       const FunctionImporter::ImportMapTy &ImportList,
       const FunctionImporter::ExportSetTy &ExportList,
       const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes> &ResolvedODR,
@@ -1072,18 +1117,16 @@ public:
 
     auto ModuleID = BM.getModuleIdentifier();
 
-    if (!Cache || !CombinedIndex.modulePaths().count(ModuleID) ||
-        all_of(CombinedIndex.getModuleHash(ModuleID),
-               [](uint32_t V) { return V == 0; }))
+    if (!isCacheable(ModuleID))
       // Cache disabled or no entry for this module in the combined index or
       // no module hash.
       return RunThinBackend(AddStream);
 
-    SmallString<40> Key;
-    // The module may be cached, this helps handling it.
-    computeLTOCacheKey(Key, Conf, CombinedIndex, ModuleID, ImportList,
-                       ExportList, ResolvedODR, DefinedGlobals, CfiFunctionDefs,
-                       CfiFunctionDecls);
+    // The module may be cached, this helps handling it. The key is only
+    // computed up front when it is prefetched.
+    if (Key.empty())
+      computeCacheKey(Key, ModuleID, ImportList, ExportList, ResolvedODR,
+                      DefinedGlobals);
     if (AddStreamFn CacheAddStream = Cache(Task, Key))
       return RunThinBackend(CacheAddStream);
 
@@ -1100,32 +1143,103 @@ public:
     assert(ModuleToDefinedGVSummaries.count(ModulePath));
     const GVSummaryMapTy &DefinedGlobals =
         ModuleToDefinedGVSummaries.find(ModulePath)->second;
-    BackendThreadPool.async(
-        [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
-            const FunctionImporter::ImportMapTy &ImportList,
-            const FunctionImporter::ExportSetTy &ExportList,
-            const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>
-                &ResolvedODR,
-            const GVSummaryMapTy &DefinedGlobals,
-            MapVector<StringRef, BitcodeModule> &ModuleMap) {
-          Error E = runThinLTOBackendThread(
-              AddStream, Cache, Task, BM, CombinedIndex, ImportList, ExportList,
-              ResolvedODR, DefinedGlobals, ModuleMap);
-          if (E) {
-            std::unique_lock<std::mutex> L(ErrMu);
-            if (Err)
-              Err = joinErrors(std::move(*Err), std::move(E));
-            else
-              Err = std::move(E);
-          }
-        },
-        BM, std::ref(CombinedIndex), std::ref(ImportList), std::ref(ExportList),
-        std::ref(ResolvedODR), std::ref(DefinedGlobals), std::ref(ModuleMap));
+    SmallString<40> Key;
+    if (Conf.CachePrefetchHook && isCacheable(ModulePath)) {
+      computeCacheKey(Key, ModulePath, ImportList, ExportList, ResolvedODR,
+                      DefinedGlobals);
+      Conf.CachePrefetchHook(Key);
+    }
+    Jobs.emplace_back(
+        estimateBackendCost(DefinedGlobals, ImportList),
+        std::bind(
+            [=](BitcodeModule BM, ModuleSummaryIndex &CombinedIndex,
+                const FunctionImporter::ImportMapTy &ImportList,
+                const FunctionImporter::ExportSetTy &ExportList,
+                const std::map<GlobalValue::GUID, GlobalValue::LinkageTypes>
+                    &ResolvedODR,
+                const GVSummaryMapTy &DefinedGlobals,
+                MapVector<StringRef, BitcodeModule> &ModuleMap) {
+              Error E = runThinLTOBackendThread(
+                  AddStream, Cache, Task, Key, BM, CombinedIndex, ImportList,
+                  ExportList, ResolvedODR, DefinedGlobals, ModuleMap);
+              if (E) {
+                std::unique_lock<std::mutex> L(ErrMu);
+                if (Err)
+                  Err = joinErrors(std::move(*Err), std::move(E));
+                else
+                  Err = std::move(E);
+              }
+            },
+            BM, std::ref(CombinedIndex), std::ref(ImportList),
+            std::ref(ExportList), std::ref(ResolvedODR),
+            std::ref(DefinedGlobals), std::ref(ModuleMap)));
     return Error::success();
   }
 
+  /// Estimate the work of the backend of a module by the number of
+  /// instructions of the functions it defines or imports.
+  uint64_t
+  estimateBackendCost(const GVSummaryMapTy &DefinedGlobals,
+                      const FunctionImporter::ImportMapTy &ImportList) {
+    uint64_t Cost = 0;
+    for (auto &Def : DefinedGlobals)
+      if (auto *FS = dyn_cast<FunctionSummary>(Def.second))
+        Cost += FS->instCount();
+    for (auto &Import : ImportList)
+      for (GlobalValue::GUID GUID : Import.second)
+        if (auto *FS = dyn_cast_or_null<FunctionSummary>(
+                CombinedIndex.findSummaryInModule(GUID, Import.first())))
+          Cost += FS->instCount();
+    return Cost;
+  }
+
+  /// Estimate the memory of a job of cost \p Cost. The module and its imports
+  /// are live in the backend for the whole of its pipeline.
+  static uint64_t estimateBackendMemory(uint64_t Cost) {
+    return ThinLTOJobBaseMemory + Cost * ThinLTOMemoryPerInstruction;
+  }
+
   Error wait() override {
+    std::stable_sort(Jobs.begin(), Jobs.end(),
+                     [](const std::pair<uint64_t, std::function<void()>> &A,
+                        const std::pair<uint64_t, std::function<void()>> &B) {
+                       return A.first > B.first;
+                     });
+
+    // Queue the largest job that fits in the budget, or wait for a running
+    // one to finish.
+    std::vector<unsigned> Pending;
+    for (unsigned I = 0, E = Jobs.size(); I != E; ++I)
+      Pending.push_back(I);
+    {
+      std::unique_lock<std::mutex> L(MemoryMu);
+      while (!Pending.empty()) {
+        auto Fits = [&](unsigned I) {
+          return !MemoryBudget || !MemoryInUse ||
+                 MemoryInUse + estimateBackendMemory(Jobs[I].first) <=
+                     MemoryBudget;
+        };
+        auto It = llvm::find_if(Pending, Fits);
+        if (It == Pending.end()) {
+          MemoryCV.wait(L);
+          continue;
+        }
+        unsigned I = *It;
+        Pending.erase(It);
+        uint64_t Memory = estimateBackendMemory(Jobs[I].first);
+        MemoryInUse += Memory;
+        BackendThreadPool.async([this, I, Memory]() {
+          Jobs[I].second();
+          {
+            std::lock_guard<std::mutex> L(MemoryMu);
+            MemoryInUse -= Memory;
+          }
+          MemoryCV.notify_all();
+        });
+      }
+    }
     BackendThreadPool.wait();
+    Jobs.clear();
     if (Err)
       return std::move(*Err);
     else
@@ -1134,13 +1248,14 @@ public:
 };
 } // end anonymous namespace
 
-ThinBackend lto::createInProcessThinBackend(unsigned ParallelismLevel) {
+ThinBackend lto::createInProcessThinBackend(unsigned ParallelismLevel,
+                                            uint64_t MemoryBudget) {
   return [=](Config &Conf, ModuleSummaryIndex &CombinedIndex,
              const StringMap<GVSummaryMapTy> &ModuleToDefinedGVSummaries,
              AddStreamFn AddStream, NativeObjectCache Cache) {
     return llvm::make_unique<InProcessThinBackend>(
-        Conf, CombinedIndex, ParallelismLevel, ModuleToDefinedGVSummaries,
-        AddStream, Cache);
+        Conf, CombinedIndex, ParallelismLevel, MemoryBudget,
+        ModuleToDefinedGVSummaries, AddStream, Cache);
   };
 }
 
@@ -350,43 +350,47 @@ void splitCodeGen(Config &C, TargetMachine *TM, AddStreamFn AddStream,
                   unsigned ParallelCodeGenParallelismLevel,
                   std::unique_ptr<Module> Mod) {
   ThreadPool CodegenThreadPool(ParallelCodeGenParallelismLevel);
-  unsigned ThreadCount = 0;
   const Target *T = &TM->getTarget();
 
-  SplitModule(
-      std::move(Mod), ParallelCodeGenParallelismLevel,
-      [&](std::unique_ptr<Module> MPart) {
-        // We want to clone the module in a new context to multi-thread the
-        // codegen. We do it by serializing partition modules to bitcode
-        // (while still on the main thread, in order to avoid data races) and
-        // spinning up new threads which deserialize the partitions into
-        // separate contexts.
-        // FIXME: Provide a more direct way to do this in LLVM.
-        SmallString<0> BC;
-        raw_svector_ostream BCOS(BC);
-        WriteBitcodeToFile(*MPart, BCOS);
-
-        // Enqueue the task
-        CodegenThreadPool.async(
-            [&](const SmallString<0> &BC, unsigned ThreadId) {
-              LTOLLVMContext Ctx(C);
-              Expected<std::unique_ptr<Module>> MOrErr = parseBitcodeFile(
-                  MemoryBufferRef(StringRef(BC.data(), BC.size()), "ld-temp.o"),
-                  Ctx);
-              if (!MOrErr)
-                report_fatal_error("Failed to read bitcode");
-              std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
-
-              std::unique_ptr<TargetMachine> TM =
-                  createTargetMachine(C, T, *MPartInCtx);
-
-              codegen(C, TM.get(), AddStream, ThreadId, *MPartInCtx);
-            },
-            // Pass BC using std::move to ensure that it get moved rather than
-            // copied into the thread's context.
-            std::move(BC), ThreadCount++);
-      },
-      false);
+  // To multi-thread the codegen every partition has to live in its own
+  // context. Rather than cloning each partition and writing it to bitcode on
+  // this thread, write the whole module once. Every thread then loads it
+  // lazily into its own context and only reads the function bodies of its
+  // partition, so the threads share the cost of reading the bodies and the
+  // partitions are never cloned.
+  StringMap<unsigned> PartitionOf;
+  computeSplitModulePartitions(
+      *Mod, ParallelCodeGenParallelismLevel,
+      [&](const GlobalValue &GV, unsigned I) {
+        PartitionOf[GV.getName()] = I;
+      });
+
+  SmallString<0> BC;
+  raw_svector_ostream BCOS(BC);
+  WriteBitcodeToFile(*Mod, BCOS);
+  Mod.reset();
+
+  for (unsigned I = 0; I != ParallelCodeGenParallelismLevel; ++I)
+    CodegenThreadPool.async(
+        [&](unsigned ThreadId) {
+          LTOLLVMContext Ctx(C);
+          Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+              MemoryBufferRef(StringRef(BC.data(), BC.size()), "ld-temp.o"),
+              Ctx, /*ShouldLazyLoadMetadata=*/true);
+          if (!MOrErr)
+            report_fatal_error("Failed to read bitcode");
+          std::unique_ptr<Module> MPartInCtx = std::move(MOrErr.get());
+          if (Error E = materializeSplitModulePartition(*MPartInCtx,
+                                                         PartitionOf, ThreadId))
+            report_fatal_error("Failed to read bitcode: " +
+                               toString(std::move(E)));
+
+          std::unique_ptr<TargetMachine> TM =
+              createTargetMachine(C, T, *MPartInCtx);
+
+          codegen(C, TM.get(), AddStream, ThreadId, *MPartInCtx);
+        },
+        I);
 
   // Because the inner lambda (which runs in a worker thread) captures our local
   // variables, we need to wait for the worker threads to terminate before we
@@ -975,6 +975,13 @@ Expected<Constant *> IRLinker::linkGlobalValueProto(GlobalValue *SGV,
     if (DoneLinkingBodies)
       return nullptr;
 
+    // The metadata of global variables and declarations is copied with the
+    // prototype, make sure a lazily loaded source module has read it.
+    if (isa<GlobalVariable>(SGV) ||
+        (isa<GlobalObject>(SGV) && SGV->isDeclaration()))
+      if (Error Err = SGV->materialize())
+        return std::move(Err);
+
     NewGV = copyGlobalValueProto(SGV, ShouldLink || ForAlias);
     if (ShouldLink || !ForAlias)
       forceRenaming(NewGV, SGV->getName());
@@ -818,7 +818,7 @@ bool ELFWriter::maybeWriteCompression(
     unsigned Alignment) {
   if (ZLibStyle) {
     uint64_t HdrSize =
-        is64Bit() ? sizeof(ELF::Elf32_Chdr) : sizeof(ELF::Elf64_Chdr);
+        is64Bit() ? sizeof(ELF::Elf64_Chdr) : sizeof(ELF::Elf32_Chdr);
     if (Size <= HdrSize + CompressedContents.size())
       return false;
     // Platform specific header is followed by compressed data.
@@ -855,13 +855,9 @@ void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
   auto &MC = Asm.getContext();
   const auto &MAI = MC.getAsmInfo();
 
-  // Compressing debug_frame requires handling alignment fragments which is
-  // more work (possibly generalizing MCAssembler.cpp:writeFragment to allow
-  // for writing to arbitrary buffers) for little benefit.
   bool CompressionEnabled =
       MAI->compressDebugSections() != DebugCompressionType::None;
-  if (!CompressionEnabled || !SectionName.startswith(".debug_") ||
-      SectionName == ".debug_frame") {
+  if (!CompressionEnabled || !SectionName.startswith(".debug_")) {
     Asm.writeSectionData(W.OS, &Section, Layout);
     return;
   }
@@ -871,6 +867,7 @@ void ELFWriter::writeSectionData(const MCAssembler &Asm, MCSection &Sec,
          "expected zlib or zlib-gnu style compression");
 
   SmallVector<char, 128> UncompressedData;
+  UncompressedData.reserve(Layout.getSectionAddressSize(&Section));
   raw_svector_ostream VecOS(UncompressedData);
   Asm.writeSectionData(VecOS, &Section, Layout);
 
@@ -1107,6 +1104,9 @@ uint64_t ELFWriter::writeObject(MCAssembler &Asm, const MCAsmLayout &Layout) {
 
     const MCSymbolELF *SignatureSymbol = Section.getGroup();
     writeSectionData(Asm, Section, Layout);
+    // Nothing reads the contents of a section once it is written, so don't
+    // keep them alive while the rest of the object is written.
+    Asm.releaseSectionData(Section);
 
     uint64_t SecEnd = W.OS.tell();
     SectionOffsets[&Section] = std::make_pair(SecStart, SecEnd);
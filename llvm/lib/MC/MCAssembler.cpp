@@ -65,8 +65,16 @@ STATISTIC(EmittedOrgFragments,
 STATISTIC(evaluateFixup, "Number of evaluated fixups");
 STATISTIC(FragmentLayouts, "Number of fragment layouts");
 STATISTIC(ObjectBytes, "Number of emitted object file bytes");
+STATISTIC(ReleasedFragmentBytes,
+          "Number of fragment bytes released once written");
 STATISTIC(RelaxationSteps, "Number of assembler layout and relaxation steps");
 STATISTIC(RelaxedInstructions, "Number of relaxed instructions");
+STATISTIC(SectionRelaxationPasses,
+          "Number of relaxation passes over a section");
+STATISTIC(MaxSectionRelaxationPasses,
+          "Maximum number of relaxation passes over a section");
+STATISTIC(RelaxationFragmentVisits,
+          "Number of fragments checked for relaxation");
 STATISTIC(PaddingFragmentsRelaxations,
           "Number of Padding Fragments relaxations");
 STATISTIC(PaddingFragmentsBytes,
@@ -717,6 +725,28 @@ void MCAssembler::writeSectionData(raw_ostream &OS, const MCSection *Sec,
   assert(OS.tell() - Start == Layout.getSectionAddressSize(Sec));
 }
 
+void MCAssembler::releaseSectionData(MCSection &Sec) {
+  // Virtual sections have no contents to free, and the size of the section
+  // header still comes from the layout of their fragments.
+  if (Sec.isVirtualSection())
+    return;
+
+  for (MCFragment &F : Sec) {
+    if (auto *DF = dyn_cast<MCDataFragment>(&F)) {
+      stats::ReleasedFragmentBytes += DF->getContents().size();
+      DF->releaseContents();
+      DF->releaseFixups();
+    } else if (auto *RF = dyn_cast<MCRelaxableFragment>(&F)) {
+      stats::ReleasedFragmentBytes += RF->getContents().size();
+      RF->releaseContents();
+      RF->releaseFixups();
+    } else if (auto *CF = dyn_cast<MCCompactEncodedInstFragment>(&F)) {
+      stats::ReleasedFragmentBytes += CF->getContents().size();
+      CF->releaseContents();
+    }
+  }
+}
+
 std::tuple<MCValue, uint64_t, bool>
 MCAssembler::handleFixup(const MCAsmLayout &Layout, MCFragment &F,
                          const MCFixup &Fixup) {
@@ -1038,15 +1068,21 @@ bool MCAssembler::relaxCVDefRange(MCAsmLayout &Layout,
   return OldSize != F.getContents().size();
 }
 
-bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
-  // Holds the first fragment which needed relaxing during this layout. It will
-  // remain NULL if none were relaxed.
-  // When a fragment is relaxed, all the fragments following it should get
-  // invalidated because their offset is going to change.
-  MCFragment *FirstRelaxedFragment = nullptr;
+bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec,
+                                    MCFragment *&LastRelaxed) {
+  ++stats::SectionRelaxationPasses;
+
+  // The fragments are invalidated as soon as one of them is relaxed, so the
+  // fragments after it are checked against the new offsets in the same pass.
+  // Everything after the last fragment the previous pass relaxed was then
+  // checked against the current layout already; unless this pass relaxes
+  // something before it, the pass can stop there.
+  MCFragment *StopAfter = LastRelaxed;
+  LastRelaxed = nullptr;
 
   // Attempt to relax all the fragments in the section.
   for (MCSection::iterator I = Sec.begin(), IE = Sec.end(); I != IE; ++I) {
+    ++stats::RelaxationFragmentVisits;
     // Check if this is a fragment that needs relaxation.
     bool RelaxedFrag = false;
     switch(I->getKind()) {
@@ -1080,14 +1116,16 @@ bool MCAssembler::layoutSectionOnce(MCAsmLayout &Layout, MCSection &Sec) {
       RelaxedFrag = relaxCVDefRange(Layout, *cast<MCCVDefRangeFragment>(I));
       break;
     }
-    if (RelaxedFrag && !FirstRelaxedFragment)
-      FirstRelaxedFragment = &*I;
-  }
-  if (FirstRelaxedFragment) {
-    Layout.invalidateFragmentsFrom(FirstRelaxedFragment);
-    return true;
+    if (RelaxedFrag) {
+      // When a fragment is relaxed, all the fragments following it should get
+      // invalidated because their offset is going to change.
+      Layout.invalidateFragmentsFrom(&*I);
+      LastRelaxed = &*I;
+    } else if (!LastRelaxed && &*I == StopAfter) {
+      break;
+    }
   }
-  return false;
+  return LastRelaxed;
 }
 
 bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
@@ -1096,8 +1134,11 @@ bool MCAssembler::layoutOnce(MCAsmLayout &Layout) {
   bool WasRelaxed = false;
   for (iterator it = begin(), ie = end(); it != ie; ++it) {
     MCSection &Sec = *it;
-    while (layoutSectionOnce(Layout, Sec))
+    MCFragment *LastRelaxed = nullptr;
+    unsigned Passes = 1;
+    for (; layoutSectionOnce(Layout, Sec, LastRelaxed); ++Passes)
       WasRelaxed = true;
+    stats::MaxSectionRelaxationPasses.updateMax(Passes);
   }
 
   return WasRelaxed;
@@ -12,20 +12,24 @@
 
 #include "llvm/Object/ArchiveWriter.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/BinaryFormat/Magic.h"
-#include "llvm/IR/LLVMContext.h"
+#include "llvm/Bitcode/BitcodeReader.h"
 #include "llvm/Object/Archive.h"
+#include "llvm/Object/IRSymtab.h"
 #include "llvm/Object/ObjectFile.h"
 #include "llvm/Object/SymbolicFile.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/Format.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <algorithm>
 #include <map>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -344,49 +348,106 @@ static void writeSymbolTable(raw_ostream &Out, object::Archive::Kind Kind,
     Out.write(uint8_t(0));
 }
 
-static Expected<std::vector<unsigned>>
-getSymbols(MemoryBufferRef Buf, raw_ostream &SymNames, bool &HasObject) {
-  std::vector<unsigned> Ret;
+namespace {
+/// The archive symbols of a member.
+struct MemberSymbols {
+  /// The symbol names, each followed by a '\0'.
+  SmallString<0> Names;
+  /// The offset of each symbol in Names.
+  std::vector<unsigned> Offsets;
+  /// Whether the member is an object file.
+  bool HasObject = false;
 
-  // In the scenario when LLVMContext is populated SymbolicFile will contain a
-  // reference to it, thus SymbolicFile should be destroyed first.
-  LLVMContext Context;
-  std::unique_ptr<object::SymbolicFile> Obj;
+  void add(StringRef Name) {
+    Offsets.push_back(Names.size());
+    Names += Name;
+    Names.push_back('\0');
+  }
+};
+} // end anonymous namespace
+
+static void getBitcodeSymbols(MemoryBufferRef Buf, MemberSymbols &Syms) {
+  // Read the symbols from the irsymtab, which is usually up to date in the
+  // bitcode file, rather than by loading the modules.
+  Expected<BitcodeFileContents> BFCOrErr = getBitcodeFileContents(Buf);
+  if (!BFCOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(BFCOrErr.takeError());
+    return;
+  }
+  Expected<irsymtab::FileContents> FCOrErr = irsymtab::readBitcode(*BFCOrErr);
+  if (!FCOrErr) {
+    consumeError(FCOrErr.takeError());
+    return;
+  }
+
+  Syms.HasObject = true;
+  // Same as isArchiveSymbol for the flags of an IRObjectFile.
+  for (const irsymtab::Reader::SymbolRef &Sym : FCOrErr->TheReader.symbols())
+    if (!Sym.isFormatSpecific() && Sym.isGlobal() && !Sym.isUndefined())
+      Syms.add(Sym.getName());
+}
+
+static Error getSymbols(MemoryBufferRef Buf, MemberSymbols &Syms) {
   if (identify_magic(Buf.getBuffer()) == file_magic::bitcode) {
-    auto ObjOrErr = object::SymbolicFile::createSymbolicFile(
-        Buf, file_magic::bitcode, &Context);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
-      return Ret;
-    }
-    Obj = std::move(*ObjOrErr);
-  } else {
-    auto ObjOrErr = object::SymbolicFile::createSymbolicFile(Buf);
-    if (!ObjOrErr) {
-      // FIXME: check only for "not an object file" errors.
-      consumeError(ObjOrErr.takeError());
-      return Ret;
-    }
-    Obj = std::move(*ObjOrErr);
+    getBitcodeSymbols(Buf, Syms);
+    return Error::success();
+  }
+
+  auto ObjOrErr = object::SymbolicFile::createSymbolicFile(Buf);
+  if (!ObjOrErr) {
+    // FIXME: check only for "not an object file" errors.
+    consumeError(ObjOrErr.takeError());
+    return Error::success();
   }
+  std::unique_ptr<object::SymbolicFile> Obj = std::move(*ObjOrErr);
 
-  HasObject = true;
+  Syms.HasObject = true;
+  SmallString<64> Name;
   for (const object::BasicSymbolRef &S : Obj->symbols()) {
     if (!isArchiveSymbol(S))
       continue;
-    Ret.push_back(SymNames.tell());
-    if (Error E = S.printName(SymNames))
+    Name.clear();
+    raw_svector_ostream OS(Name);
+    if (Error E = S.printName(OS))
+      return E;
+    Syms.add(Name);
+  }
+  return Error::success();
+}
+
+/// Read the symbols of \p NewMembers. The members are independent, so they are
+/// read in parallel.
+static Expected<std::vector<MemberSymbols>>
+getMembersSymbols(ArrayRef<NewArchiveMember> NewMembers) {
+  std::vector<MemberSymbols> Syms(NewMembers.size());
+  std::vector<char> Failed(NewMembers.size(), false);
+  parallel::for_each_n(parallel::par, size_t(0), NewMembers.size(),
+                       [&](size_t I) {
+                         Error E = getSymbols(
+                             NewMembers[I].Buf->getMemBufferRef(), Syms[I]);
+                         if (E) {
+                           consumeError(std::move(E));
+                           Failed[I] = true;
+                         }
+                       });
+
+  // Read the first member that failed again to report its error, so that the
+  // error doesn't depend on the scheduling.
+  auto FirstFailed = std::find(Failed.begin(), Failed.end(), true);
+  if (FirstFailed != Failed.end()) {
+    size_t I = FirstFailed - Failed.begin();
+    MemberSymbols Ignored;
+    if (Error E = getSymbols(NewMembers[I].Buf->getMemBufferRef(), Ignored))
       return std::move(E);
-    SymNames << '\0';
   }
-  return Ret;
+  return std::move(Syms);
 }
 
 static Expected<std::vector<MemberData>>
 computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
                   object::Archive::Kind Kind, bool Thin, bool Deterministic,
-                  ArrayRef<NewArchiveMember> NewMembers) {
+                  bool NeedSymbols, ArrayRef<NewArchiveMember> NewMembers) {
   static char PaddingData[8] = {'\n', '\n', '\n', '\n', '\n', '\n', '\n', '\n'};
 
   // This ignores the symbol table, but we only need the value mod 8 and the
@@ -396,6 +457,16 @@ computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
   std::vector<MemberData> Ret;
   bool HasObject = false;
 
+  // Without a symbol table, the members don't need to be read at all.
+  std::vector<MemberSymbols> Syms;
+  if (NeedSymbols) {
+    Expected<std::vector<MemberSymbols>> SymsOrErr =
+        getMembersSymbols(NewMembers);
+    if (Error E = SymsOrErr.takeError())
+      return std::move(E);
+    Syms = std::move(*SymsOrErr);
+  }
+
   // Deduplicate long member names in the string table and reuse earlier name
   // offsets. This especially saves space for COFF Import libraries where all
   // members have the same name.
@@ -451,7 +522,8 @@ computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
       Entry.second = Entry.second > 1 ? 1 : 0;
   }
 
-  for (const NewArchiveMember &M : NewMembers) {
+  for (size_t I = 0, E = NewMembers.size(); I != E; ++I) {
+    const NewArchiveMember &M = NewMembers[I];
     std::string Header;
     raw_string_ostream Out(Header);
 
@@ -477,13 +549,18 @@ computeMemberData(raw_ostream &StringTable, raw_ostream &SymNames,
                       ModTime, Buf.getBufferSize() + MemberPadding);
     Out.flush();
 
-    Expected<std::vector<unsigned>> Symbols =
-        getSymbols(Buf, SymNames, HasObject);
-    if (auto E = Symbols.takeError())
-      return std::move(E);
+    std::vector<unsigned> Symbols;
+    if (NeedSymbols) {
+      // Rebase the offsets of the member's symbols on the symbol table.
+      uint64_t SymNamesPos = SymNames.tell();
+      for (unsigned Offset : Syms[I].Offsets)
+        Symbols.push_back(SymNamesPos + Offset);
+      SymNames << Syms[I].Names;
+      HasObject |= Syms[I].HasObject;
+    }
 
     Pos += Header.size() + Data.size() + Padding.size();
-    Ret.push_back({std::move(*Symbols), std::move(Header), Data, Padding});
+    Ret.push_back({std::move(Symbols), std::move(Header), Data, Padding});
   }
   // If there are no symbols, emit an empty symbol table, to satisfy Solaris
   // tools, older versions of which expect a symbol table in a non-empty
@@ -547,8 +624,9 @@ Error writeArchive(StringRef ArcName, ArrayRef<NewArchiveMember> NewMembers,
   SmallString<0> StringTableBuf;
   raw_svector_ostream StringTable(StringTableBuf);
 
-  Expected<std::vector<MemberData>> DataOrErr = computeMemberData(
-      StringTable, SymNames, Kind, Thin, Deterministic, NewMembers);
+  Expected<std::vector<MemberData>> DataOrErr =
+      computeMemberData(StringTable, SymNames, Kind, Thin, Deterministic,
+                        WriteSymtab, NewMembers);
   if (Error E = DataOrErr.takeError())
     return E;
   std::vector<MemberData> &Data = *DataOrErr;
@@ -0,0 +1,334 @@
+//===- ParallelFunctionPass.cpp - Run a function pipeline on threads ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/ParallelFunctionPass.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/DiagnosticHandler.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Linker/IRMover.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/FunctionImportUtils.h"
+#include <algorithm>
+#include <mutex>
+
+using namespace llvm;
+
+ParallelFunctionPassWorker::ParallelFunctionPassWorker(bool DebugLogging)
+    : LAM(DebugLogging), FAM(DebugLogging), CGAM(DebugLogging),
+      MAM(DebugLogging), FPM(DebugLogging) {}
+
+ParallelFunctionPassWorker::~ParallelFunctionPassWorker() = default;
+
+namespace {
+
+/// Hands the diagnostics of a worker's context to the context of the module
+/// being optimized, one at a time, so that remarks and warnings end up where
+/// they would without threads.
+struct ForwardingDiagnosticHandler : public DiagnosticHandler {
+  LLVMContext &Ctx;
+  std::mutex &Lock;
+
+  ForwardingDiagnosticHandler(LLVMContext &Ctx, std::mutex &Lock)
+      : Ctx(Ctx), Lock(Lock) {}
+
+  bool handleDiagnostics(const DiagnosticInfo &DI) override {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Ctx.diagnose(DI);
+    return true;
+  }
+  bool isAnalysisRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isAnalysisRemarkEnabled(PassName);
+  }
+  bool isMissedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isMissedOptRemarkEnabled(PassName);
+  }
+  bool isPassedOptRemarkEnabled(StringRef PassName) const override {
+    return Ctx.getDiagHandlerPtr()->isPassedOptRemarkEnabled(PassName);
+  }
+  bool isAnyRemarkEnabled() const override {
+    return Ctx.getRemarkStreamer() ||
+           Ctx.getDiagHandlerPtr()->isAnyRemarkEnabled();
+  }
+};
+
+/// The linkage of a local symbol of the module being optimized, which is made
+/// external while the optimized bodies are moved back so that the IRMover
+/// links them by name.
+struct SavedLocal {
+  std::string Name;
+  GlobalValue::LinkageTypes Linkage;
+  bool WasUnnamed;
+};
+
+} // end anonymous namespace
+
+static bool canRunInParallel(Module &M) {
+  if (M.getNamedMetadata("llvm.dbg.cu"))
+    return false;
+  for (Function &F : M)
+    for (BasicBlock &BB : F)
+      if (BB.hasAddressTaken())
+        return false;
+  return true;
+}
+
+static unsigned getInstructionCount(const Function &F) {
+  unsigned Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+/// Assign the function definitions of \p M to \p N partitions of about the
+/// same number of instructions, largest functions first.
+static StringMap<unsigned> computePartitions(Module &M, unsigned N) {
+  std::vector<std::pair<unsigned, Function *>> Defs;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      Defs.push_back({getInstructionCount(F), &F});
+  std::stable_sort(Defs.begin(), Defs.end(),
+                   [](const std::pair<unsigned, Function *> &A,
+                      const std::pair<unsigned, Function *> &B) {
+                     return A.first > B.first;
+                   });
+
+  StringMap<unsigned> PartitionOf;
+  std::vector<uint64_t> Load(N);
+  for (auto &Def : Defs) {
+    unsigned I = std::min_element(Load.begin(), Load.end()) - Load.begin();
+    Load[I] += Def.first;
+    PartitionOf[Def.second->getName()] = I;
+  }
+  return PartitionOf;
+}
+
+/// Turn \p M, loaded lazily from the bitcode of the whole module, into
+/// partition \p I: functions of other partitions become declarations and
+/// only the function bodies of this partition are read. Global variables keep
+/// their initializers for the benefit of constant folding.
+static Error materializePartition(Module &M,
+                                  const StringMap<unsigned> &PartitionOf,
+                                  unsigned I) {
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    auto It = PartitionOf.find(F.getName());
+    if (It != PartitionOf.end() && It->second != I)
+      convertToDeclaration(F);
+  }
+  // Aliases of functions that are now declarations are replaced by a new
+  // declaration.
+  std::vector<GlobalValue *> DroppedIndirectSymbols;
+  auto DropIfDangling = [&](GlobalIndirectSymbol &GIS) {
+    const GlobalObject *Base = GIS.getBaseObject();
+    if (!Base || Base->isDeclaration()) {
+      convertToDeclaration(GIS);
+      DroppedIndirectSymbols.push_back(&GIS);
+    }
+  };
+  for (GlobalAlias &GA : M.aliases())
+    DropIfDangling(GA);
+  for (GlobalIFunc &GIF : M.ifuncs())
+    DropIfDangling(GIF);
+  for (GlobalValue *GV : DroppedIndirectSymbols)
+    GV->eraseFromParent();
+  return M.materializeAll();
+}
+
+/// Prepare the optimized partition \p M to be moved back: symbols that were
+/// local in the original module are linked by name, and module level state
+/// the original module already has is dropped so that it isn't duplicated.
+static void prepareForMoveBack(Module &M, const StringSet<> &LocalNames) {
+  for (GlobalValue &GV : M.global_values())
+    if (GV.hasLocalLinkage() && LocalNames.count(GV.getName()))
+      GV.setLinkage(GlobalValue::ExternalLinkage);
+  while (!M.named_metadata_empty())
+    M.eraseNamedMetadata(&*M.named_metadata_begin());
+  M.setModuleInlineAsm("");
+}
+
+/// Carry over to \p M what the pipeline changed in partition \p Part besides
+/// the function bodies, which the IRMover does not move: raised alignments of
+/// global variables and attributes inferred for function declarations, such
+/// as those of library calls. Both only ever get stronger, so the partitions
+/// are merged by keeping the strongest.
+static void mergeGlobalChanges(Module &M, Module &Part) {
+  for (GlobalVariable &GV : Part.globals()) {
+    GlobalVariable *Orig = M.getGlobalVariable(GV.getName(),
+                                               /*AllowInternal=*/true);
+    if (Orig && GV.getAlignment() > Orig->getAlignment())
+      Orig->setAlignment(GV.getAlignment());
+  }
+  for (Function &F : Part) {
+    if (!F.isDeclaration())
+      continue;
+    Function *Orig = M.getFunction(F.getName());
+    if (!Orig || !Orig->isDeclaration() ||
+        Orig->getAttributes() == F.getAttributes())
+      continue;
+    AttributeList Attrs = F.getAttributes();
+    Orig->addAttributes(AttributeList::FunctionIndex,
+                        AttrBuilder(Attrs, AttributeList::FunctionIndex));
+    Orig->addAttributes(AttributeList::ReturnIndex,
+                        AttrBuilder(Attrs, AttributeList::ReturnIndex));
+    for (unsigned I = 0, E = F.arg_size(); I != E; ++I)
+      Orig->addParamAttrs(I, AttrBuilder(Attrs.getParamAttributes(I)));
+  }
+}
+
+PreservedAnalyses ParallelFunctionPass::run(Module &M,
+                                            ModuleAnalysisManager &AM) {
+  unsigned NumDefs = 0;
+  for (Function &F : M)
+    if (!F.isDeclaration())
+      ++NumDefs;
+  unsigned N = std::min(NumThreads, NumDefs);
+
+  if (N < 2 || !canRunInParallel(M)) {
+    std::unique_ptr<ParallelFunctionPassWorker> Worker = CreateWorker();
+    return createModuleToFunctionPassAdaptor(std::move(Worker->FPM))
+        .run(M, AM);
+  }
+
+  // The workers can only refer to the symbols of the module by name, so give
+  // a name to the unnamed ones and remember which ones are local.
+  std::vector<SavedLocal> Locals;
+  StringSet<> LocalNames;
+  for (GlobalValue &GV : M.global_values()) {
+    bool WasUnnamed = !GV.hasName();
+    if (WasUnnamed)
+      GV.setName("__llvm_parallel_unnamed");
+    if (WasUnnamed || GV.hasLocalLinkage()) {
+      Locals.push_back({GV.getName(), GV.getLinkage(), WasUnnamed});
+      LocalNames.insert(GV.getName());
+    }
+  }
+
+  StringMap<unsigned> PartitionOf = computePartitions(M, N);
+
+  // The IRMover appends the functions it moves back, remember the order to
+  // restore it.
+  std::vector<std::string> FunctionOrder;
+  for (Function &F : M)
+    FunctionOrder.push_back(F.getName());
+
+  SmallString<0> BC;
+  raw_svector_ostream BCOS(BC);
+  WriteBitcodeToFile(M, BCOS);
+
+  std::vector<std::unique_ptr<ParallelFunctionPassWorker>> Workers;
+  for (unsigned I = 0; I != N; ++I)
+    Workers.push_back(CreateWorker());
+
+  std::vector<SmallString<0>> Results(N);
+  std::mutex DiagLock;
+  LLVMContext &MainCtx = M.getContext();
+  {
+    ThreadPool Pool(N);
+    for (unsigned I = 0; I != N; ++I)
+      Pool.async(
+          [&](unsigned ThreadId) {
+            LLVMContext Ctx;
+            Ctx.setDiagnosticHandler(
+                llvm::make_unique<ForwardingDiagnosticHandler>(MainCtx,
+                                                               DiagLock));
+            Ctx.setDiagnosticsHotnessRequested(
+                MainCtx.getDiagnosticsHotnessRequested());
+
+            Expected<std::unique_ptr<Module>> MOrErr = getLazyBitcodeModule(
+                MemoryBufferRef(StringRef(BC.data(), BC.size()),
+                                M.getModuleIdentifier()),
+                Ctx, /*ShouldLazyLoadMetadata=*/true);
+            if (!MOrErr)
+              report_fatal_error("Failed to read bitcode: " +
+                                 toString(MOrErr.takeError()));
+            std::unique_ptr<Module> Part = std::move(*MOrErr);
+            if (Error E = materializePartition(*Part, PartitionOf, ThreadId))
+              report_fatal_error("Failed to read bitcode: " +
+                                 toString(std::move(E)));
+
+            auto &Worker = Workers[ThreadId];
+            Worker->MAM.getResult<ProfileSummaryAnalysis>(*Part);
+            createModuleToFunctionPassAdaptor(std::move(Worker->FPM))
+                .run(*Part, Worker->MAM);
+            // The analyses refer to the IR of this context.
+            Worker.reset();
+
+            prepareForMoveBack(*Part, LocalNames);
+            raw_svector_ostream OS(Results[ThreadId]);
+            WriteBitcodeToFile(*Part, OS);
+          },
+          I);
+  }
+
+  // Every function is about to be replaced by its optimized copy, drop what
+  // is cached for the old ones.
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  for (Function &F : M)
+    FAM.clear(F, F.getName());
+
+  for (SavedLocal &Local : Locals)
+    M.getNamedValue(Local.Name)->setLinkage(GlobalValue::ExternalLinkage);
+
+  IRMover Mover(M);
+  for (SmallString<0> &Result : Results) {
+    Expected<std::unique_ptr<Module>> PartOrErr =
+        parseBitcodeFile(MemoryBufferRef(StringRef(Result.data(),
+                                                   Result.size()),
+                                         M.getModuleIdentifier()),
+                         M.getContext());
+    if (!PartOrErr)
+      report_fatal_error("Failed to read bitcode: " +
+                         toString(PartOrErr.takeError()));
+    mergeGlobalChanges(M, **PartOrErr);
+    std::vector<GlobalValue *> ValuesToLink;
+    for (Function &F : **PartOrErr)
+      if (!F.isDeclaration())
+        ValuesToLink.push_back(&F);
+    if (Error E = Mover.move(std::move(*PartOrErr), ValuesToLink,
+                             [](GlobalValue &, IRMover::ValueAdder) {},
+                             /*IsPerformingImport=*/false))
+      report_fatal_error("Failed to move back optimized functions: " +
+                         toString(std::move(E)));
+  }
+
+  // Functions the workers added, such as new intrinsic declarations, go
+  // after the original ones, as if the pipeline had run on this thread.
+  std::vector<Function *> Ordered, Added;
+  StringSet<> Original;
+  for (std::string &Name : FunctionOrder) {
+    Ordered.push_back(M.getFunction(Name));
+    Original.insert(Name);
+  }
+  for (Function &F : M)
+    if (!Original.count(F.getName()))
+      Added.push_back(&F);
+  for (Function *F : Ordered)
+    M.getFunctionList().splice(M.end(), M.getFunctionList(), F);
+  for (Function *F : Added)
+    M.getFunctionList().splice(M.end(), M.getFunctionList(), F);
+
+  for (SavedLocal &Local : Locals) {
+    GlobalValue *GV = M.getNamedValue(Local.Name);
+    GV->setLinkage(Local.Linkage);
+    if (Local.WasUnnamed)
+      GV->setName("");
+  }
+
+  return PreservedAnalyses::none();
+}
@@ -58,9 +58,11 @@
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/SafepointIRVerifier.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Passes/ParallelFunctionPass.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/AggressiveInstCombine/AggressiveInstCombine.h"
 #include "llvm/Transforms/IPO/AlwaysInliner.h"
@@ -74,6 +76,7 @@
 #include "llvm/Transforms/IPO/ForceFunctionAttrs.h"
 #include "llvm/Transforms/IPO/FunctionAttrs.h"
 #include "llvm/Transforms/IPO/FunctionImport.h"
+#include "llvm/Transforms/IPO/FunctionLayout.h"
 #include "llvm/Transforms/IPO/GlobalDCE.h"
 #include "llvm/Transforms/IPO/GlobalOpt.h"
 #include "llvm/Transforms/IPO/GlobalSplit.h"
@@ -82,6 +85,7 @@
 #include "llvm/Transforms/IPO/Inliner.h"
 #include "llvm/Transforms/IPO/Internalize.h"
 #include "llvm/Transforms/IPO/LowerTypeTests.h"
+#include "llvm/Transforms/IPO/OmpTgtAddrTrans.h"
 #include "llvm/Transforms/IPO/PartialInlining.h"
 #include "llvm/Transforms/IPO/SCCP.h"
 #include "llvm/Transforms/IPO/SampleProfile.h"
@@ -205,6 +209,16 @@ static cl::opt<bool> EnableSyntheticCounts(
     cl::desc("Run synthetic function entry count generation "
              "pass"));
 
+static cl::opt<unsigned> FunctionOptimizationThreads(
+    "npm-function-optimization-threads", cl::init(0), cl::Hidden,
+    cl::desc("Run the function passes of the module optimization pipeline "
+             "on this many threads (default = 0, serially)"));
+
+static cl::opt<bool> EnableFunctionLayout(
+    "enable-npm-function-layout", cl::init(false), cl::Hidden,
+    cl::desc("Order the functions of a module by the profile at the end of "
+             "the module optimization pipeline (default = off)"));
+
 static Regex DefaultAliasRegex(
     "^(default|thinlto-pre-link|thinlto|lto-pre-link|lto)<(O[0123sz])>$");
 
@@ -222,6 +236,7 @@ PipelineTuningOptions::PipelineTuningOptions() {
   ForgetAllSCEVInLoopUnroll = ForgetSCEVInLoopUnroll;
   LicmMssaOptCap = SetLicmMssaOptCap;
   LicmMssaNoAccForPromotionCap = SetLicmMssaNoAccForPromotionCap;
+  FunctionOptimizationThreads = ::FunctionOptimizationThreads;
 }
 
 extern cl::opt<bool> EnableHotColdSplit;
@@ -849,6 +864,79 @@ ModulePassManager PassBuilder::buildModuleOptimizationPipeline(
   // memory operations.
   MPM.addPass(RequireAnalysisPass<GlobalsAA, Module>());
 
+  // Split out cold code. Splitting is done late to avoid hiding context from
+  // other optimizations and inadvertently regressing performance. The tradeoff
+  // is that this has a higher code size cost than splitting early.
+  if (EnableHotColdSplit && !LTOPreLink)
+    MPM.addPass(HotColdSplittingPass());
+
+  // Add the core optimizing pipeline.
+  if (PTO.FunctionOptimizationThreads > 1) {
+    // Every worker gets its own copy of the pipeline, built here, and its own
+    // TargetMachine. Instrumentation callbacks are not thread-safe, so the
+    // workers run without them.
+    auto WorkerPB = std::make_shared<PassBuilder>(*this);
+    WorkerPB->PIC = nullptr;
+    TargetMachine *MainTM = TM;
+    auto CreateWorker = [=]() {
+      auto Worker = llvm::make_unique<ParallelFunctionPassWorker>(DebugLogging);
+      if (MainTM)
+        Worker->TM.reset(MainTM->getTarget().createTargetMachine(
+            MainTM->getTargetTriple().str(), MainTM->getTargetCPU(),
+            MainTM->getTargetFeatureString(), MainTM->Options,
+            MainTM->getRelocationModel(), MainTM->getCodeModel(),
+            MainTM->getOptLevel()));
+      WorkerPB->TM = Worker->TM.get();
+      WorkerPB->registerModuleAnalyses(Worker->MAM);
+      WorkerPB->registerCGSCCAnalyses(Worker->CGAM);
+      WorkerPB->registerFunctionAnalyses(Worker->FAM);
+      WorkerPB->registerLoopAnalyses(Worker->LAM);
+      WorkerPB->crossRegisterProxies(Worker->LAM, Worker->FAM, Worker->CGAM,
+                                     Worker->MAM);
+      Worker->FPM = WorkerPB->buildFunctionOptimizationPipeline(
+          Level, DebugLogging, LTOPreLink);
+      return Worker;
+    };
+    MPM.addPass(ParallelFunctionPass(PTO.FunctionOptimizationThreads,
+                                     std::move(CreateWorker)));
+    // The callbacks may add passes that need module analyses or are not
+    // thread-safe, e.g. sanitizers, so they run once on the merged module.
+    if (!OptimizerLastEPCallbacks.empty()) {
+      FunctionPassManager OptimizerLastPM(DebugLogging);
+      for (auto &C : OptimizerLastEPCallbacks)
+        C(OptimizerLastPM, Level);
+      MPM.addPass(createModuleToFunctionPassAdaptor(
+          std::move(OptimizerLastPM)));
+    }
+  } else {
+    FunctionPassManager OptimizePM =
+        buildFunctionOptimizationPipeline(Level, DebugLogging, LTOPreLink);
+    for (auto &C : OptimizerLastEPCallbacks)
+      C(OptimizePM, Level);
+    MPM.addPass(createModuleToFunctionPassAdaptor(std::move(OptimizePM)));
+  }
+
+  MPM.addPass(CGProfilePass());
+
+  // Now we need to do some global optimization transforms.
+  // FIXME: It would seem like these should come first in the optimization
+  // pipeline and maybe be the bottom of the canonicalization pipeline? Weird
+  // ordering here.
+  MPM.addPass(GlobalDCEPass());
+  MPM.addPass(ConstantMergePass());
+
+  // Lay out the functions by hotness. There is no point before LTO, which
+  // will merge the modules anyway.
+  if (EnableFunctionLayout && !LTOPreLink)
+    MPM.addPass(FunctionLayoutPass());
+
+  return MPM;
+}
+
+FunctionPassManager
+PassBuilder::buildFunctionOptimizationPipeline(OptimizationLevel Level,
+                                              bool DebugLogging,
+                                              bool LTOPreLink) {
   FunctionPassManager OptimizePM(DebugLogging);
   OptimizePM.addPass(Float2IntPass());
   // FIXME: We need to run some loop optimizations to re-rotate loops after
@@ -928,12 +1016,6 @@ ModulePassManager PassBuilder::buildModuleOptimizationPipeline(
   // alignment information, try to re-derive it here.
   OptimizePM.addPass(AlignmentFromAssumptionsPass());
 
-  // Split out cold code. Splitting is done late to avoid hiding context from
-  // other optimizations and inadvertently regressing performance. The tradeoff
-  // is that this has a higher code size cost than splitting early.
-  if (EnableHotColdSplit && !LTOPreLink)
-    MPM.addPass(HotColdSplittingPass());
-
   // LoopSink pass sinks instructions hoisted by LICM, which serves as a
   // canonicalization pass that enables other optimizations. As a result,
   // LoopSink pass needs to be a very late IR pass to avoid undoing LICM
@@ -957,22 +1039,7 @@ ModulePassManager PassBuilder::buildModuleOptimizationPipeline(
   // inserting redundancies into the program. This even includes SimplifyCFG.
   OptimizePM.addPass(SpeculateAroundPHIsPass());
 
-  for (auto &C : OptimizerLastEPCallbacks)
-    C(OptimizePM, Level);
-
-  // Add the core optimizing pipeline.
-  MPM.addPass(createModuleToFunctionPassAdaptor(std::move(OptimizePM)));
-
-  MPM.addPass(CGProfilePass());
-
-  // Now we need to do some global optimization transforms.
-  // FIXME: It would seem like these should come first in the optimization
-  // pipeline and maybe be the bottom of the canonicalization pipeline? Weird
-  // ordering here.
-  MPM.addPass(GlobalDCEPass());
-  MPM.addPass(ConstantMergePass());
-
-  return MPM;
+  return OptimizePM;
 }
 
 ModulePassManager
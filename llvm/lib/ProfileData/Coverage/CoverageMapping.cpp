@@ -17,16 +17,24 @@
 #include "llvm/ADT/None.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallBitVector.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringRef.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/ProfileData/Coverage/CoverageMappingReader.h"
 #include "llvm/ProfileData/InstrProfReader.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
 #include <cassert>
@@ -194,31 +202,18 @@ void FunctionRecordIterator::skipOtherFiles() {
     *this = FunctionRecordIterator();
 }
 
-Error CoverageMapping::loadFunctionRecord(
-    const CoverageMappingRecord &Record,
-    IndexedInstrProfReader &ProfileReader) {
+/// Build the function record for \p Record from its counts, or return None if
+/// it should be ignored.
+static Optional<FunctionRecord>
+buildFunctionRecord(const CoverageMappingRecord &Record,
+                    ArrayRef<uint64_t> Counts) {
   StringRef OrigFuncName = Record.FunctionName;
-  if (OrigFuncName.empty())
-    return make_error<CoverageMapError>(coveragemap_error::malformed);
-
   if (Record.Filenames.empty())
     OrigFuncName = getFuncNameWithoutPrefix(OrigFuncName);
   else
     OrigFuncName = getFuncNameWithoutPrefix(OrigFuncName, Record.Filenames[0]);
 
   CounterMappingContext Ctx(Record.Expressions);
-
-  std::vector<uint64_t> Counts;
-  if (Error E = ProfileReader.getFunctionCounts(Record.FunctionName,
-                                                Record.FunctionHash, Counts)) {
-    instrprof_error IPE = InstrProfError::take(std::move(E));
-    if (IPE == instrprof_error::hash_mismatch) {
-      FuncHashMismatches.emplace_back(Record.FunctionName, Record.FunctionHash);
-      return Error::success();
-    } else if (IPE != instrprof_error::unknown_function)
-      return make_error<InstrProfError>(IPE);
-    Counts.assign(Record.MappingRegions.size(), 0);
-  }
   Ctx.setCounts(Counts);
 
   assert(!Record.MappingRegions.empty() && "Function has no regions");
@@ -230,39 +225,126 @@ Error CoverageMapping::loadFunctionRecord(
   // when they have non-zero counts in the profile).
   if (Record.MappingRegions.size() == 1 &&
       Record.MappingRegions[0].Count.isZero() && Counts[0] > 0)
-    return Error::success();
+    return None;
 
   FunctionRecord Function(OrigFuncName, Record.Filenames);
   for (const auto &Region : Record.MappingRegions) {
     Expected<int64_t> ExecutionCount = Ctx.evaluate(Region.Count);
     if (auto E = ExecutionCount.takeError()) {
       consumeError(std::move(E));
-      return Error::success();
+      return None;
     }
     Function.pushRegion(Region, *ExecutionCount);
   }
+  return std::move(Function);
+}
+
+Error CoverageMapping::loadFunctionRecords(
+    ArrayRef<DecodedCoverageMappingRecord> Records,
+    IndexedInstrProfReader &ProfileReader, ThreadPool *Pool) {
+  // The profile reader isn't thread-safe: look up all the counts first. The
+  // records without counts are skipped.
+  std::vector<Optional<std::vector<uint64_t>>> Counts(Records.size());
+  for (size_t I = 0, E = Records.size(); I != E; ++I) {
+    const DecodedCoverageMappingRecord &Record = Records[I];
+    if (Record.FunctionName.empty())
+      return make_error<CoverageMapError>(coveragemap_error::malformed);
+
+    Counts[I].emplace();
+    if (Error E = ProfileReader.getFunctionCounts(
+            Record.FunctionName, Record.FunctionHash, *Counts[I])) {
+      instrprof_error IPE = InstrProfError::take(std::move(E));
+      if (IPE == instrprof_error::hash_mismatch) {
+        FuncHashMismatches.emplace_back(Record.FunctionName,
+                                        Record.FunctionHash);
+        Counts[I] = None;
+        continue;
+      } else if (IPE != instrprof_error::unknown_function)
+        return make_error<InstrProfError>(IPE);
+      Counts[I]->assign(Record.MappingRegions.size(), 0);
+    }
+  }
 
+  // Evaluating the regions of a function only depends on its counts.
+  std::vector<Optional<FunctionRecord>> NewFunctions(Records.size());
+  auto Build = [&](size_t I) {
+    if (Counts[I])
+      NewFunctions[I] = buildFunctionRecord(Records[I].getRecord(), *Counts[I]);
+  };
+  if (!Pool) {
+    for (size_t I = 0, E = Records.size(); I != E; ++I)
+      Build(I);
+  } else {
+    const size_t ChunkSize = 64;
+    for (size_t Begin = 0, E = Records.size(); Begin < E; Begin += ChunkSize) {
+      size_t End = std::min(E, Begin + ChunkSize);
+      Pool->async([&, Begin, End] {
+        for (size_t I = Begin; I != End; ++I)
+          Build(I);
+      });
+    }
+    Pool->wait();
+  }
+
+  // Add the functions in order, so that the first of several records for the
+  // same function is the one that is kept.
+  for (Optional<FunctionRecord> &Function : NewFunctions)
+    if (Function)
+      addFunctionRecord(std::move(*Function));
+  return Error::success();
+}
+
+void CoverageMapping::addFunctionRecord(FunctionRecord &&Function) {
   // Don't create records for (filenames, function) pairs we've already seen.
-  auto FilenamesHash = hash_combine_range(Record.Filenames.begin(),
-                                          Record.Filenames.end());
-  if (!RecordProvenance[FilenamesHash].insert(hash_value(OrigFuncName)).second)
-    return Error::success();
+  auto FilenamesHash = hash_combine_range(Function.Filenames.begin(),
+                                          Function.Filenames.end());
+  if (!RecordProvenance[FilenamesHash].insert(hash_value(Function.Name)).second)
+    return;
+
+  // Index the function by the files it covers, so that looking up the
+  // coverage of a file doesn't need to visit all the functions.
+  unsigned RecordIndex = Functions.size();
+  SmallDenseSet<size_t, 4> SeenFilenameHashes;
+  for (StringRef Filename : Function.Filenames) {
+    size_t FilenameHash = hash_value(Filename);
+    if (SeenFilenameHashes.insert(FilenameHash).second)
+      FilenameHash2RecordIndices[FilenameHash].push_back(RecordIndex);
+  }
 
   Functions.push_back(std::move(Function));
-  return Error::success();
+}
+
+ArrayRef<unsigned> CoverageMapping::getImpreciseRecordIndicesForFilename(
+    StringRef Filename) const {
+  auto RecordIt = FilenameHash2RecordIndices.find(hash_value(Filename));
+  if (RecordIt == FilenameHash2RecordIndices.end())
+    return {};
+  return RecordIt->second;
 }
 
 Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
     ArrayRef<std::unique_ptr<CoverageMappingReader>> CoverageReaders,
-    IndexedInstrProfReader &ProfileReader) {
+    IndexedInstrProfReader &ProfileReader, unsigned NumThreads) {
   auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
 
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads != 1)
+    Pool = llvm::make_unique<ThreadPool>(
+        NumThreads ? NumThreads : heavyweight_hardware_concurrency());
+
+  // Decode and evaluate the records in batches, to bound the memory used by
+  // the decoded records.
+  const size_t BatchSize = 4096;
+  std::vector<DecodedCoverageMappingRecord> Records;
   for (const auto &CoverageReader : CoverageReaders) {
-    for (auto RecordOrErr : *CoverageReader) {
-      if (Error E = RecordOrErr.takeError())
+    while (true) {
+      if (Error E =
+              CoverageReader->readNextRecords(Records, BatchSize, Pool.get()))
         return std::move(E);
-      const auto &Record = *RecordOrErr;
-      if (Error E = Coverage->loadFunctionRecord(Record, ProfileReader))
+      if (Records.empty())
+        break;
+      if (Error E =
+              Coverage->loadFunctionRecords(Records, ProfileReader, Pool.get()))
         return std::move(E);
     }
   }
@@ -270,32 +352,269 @@ Expected<std::unique_ptr<CoverageMapping>> CoverageMapping::load(
   return std::move(Coverage);
 }
 
+/// Identifies the files written by CoverageMapping::writeCache.
+static const StringRef CacheMagic("LLVMCOVC", 8);
+static const uint64_t CacheVersion = 0;
+
+static void writeCacheString(StringRef Str, raw_ostream &OS) {
+  encodeULEB128(Str.size(), OS);
+  OS << Str;
+}
+
+void CoverageMapping::writeCache(raw_ostream &OS) const {
+  OS << CacheMagic;
+  encodeULEB128(CacheVersion, OS);
+
+  encodeULEB128(Functions.size(), OS);
+  for (const FunctionRecord &Function : Functions) {
+    writeCacheString(Function.Name, OS);
+    encodeULEB128(Function.Filenames.size(), OS);
+    for (const std::string &Filename : Function.Filenames)
+      writeCacheString(Filename, OS);
+    encodeULEB128(Function.CountedRegions.size(), OS);
+    for (const CountedRegion &CR : Function.CountedRegions) {
+      encodeULEB128(CR.Count.getKind(), OS);
+      encodeULEB128(CR.Count.getCounterID(), OS);
+      encodeULEB128(CR.FileID, OS);
+      encodeULEB128(CR.ExpandedFileID, OS);
+      encodeULEB128(CR.LineStart, OS);
+      encodeULEB128(CR.ColumnStart, OS);
+      encodeULEB128(CR.LineEnd, OS);
+      encodeULEB128(CR.ColumnEnd, OS);
+      encodeULEB128(CR.Kind, OS);
+      encodeULEB128(CR.ExecutionCount, OS);
+    }
+  }
+
+  encodeULEB128(FuncHashMismatches.size(), OS);
+  for (const auto &Mismatch : FuncHashMismatches) {
+    writeCacheString(Mismatch.first, OS);
+    encodeULEB128(Mismatch.second, OS);
+  }
+}
+
+namespace {
+
+/// Reader for the files written by CoverageMapping::writeCache.
+class CoverageCacheReader : public RawCoverageReader {
+public:
+  CoverageCacheReader(StringRef Data) : RawCoverageReader(Data) {}
+
+  using RawCoverageReader::readIntMax;
+  using RawCoverageReader::readSize;
+  using RawCoverageReader::readString;
+  using RawCoverageReader::readULEB128;
+
+  Error readUnsigned(unsigned &Result) {
+    uint64_t Value;
+    if (Error E = readIntMax(Value, uint64_t(UINT32_MAX) + 1))
+      return E;
+    Result = Value;
+    return Error::success();
+  }
+
+  bool atEnd() const { return Data.empty(); }
+};
+
+} // end anonymous namespace
+
+Expected<std::unique_ptr<CoverageMapping>>
+CoverageMapping::loadFromCache(StringRef Buffer) {
+  if (!Buffer.startswith(CacheMagic))
+    return make_error<CoverageMapError>(coveragemap_error::no_data_found);
+  CoverageCacheReader Reader(Buffer.drop_front(CacheMagic.size()));
+  uint64_t Version;
+  if (Error E = Reader.readULEB128(Version))
+    return std::move(E);
+  if (Version != CacheVersion)
+    return make_error<CoverageMapError>(coveragemap_error::unsupported_version);
+
+  auto Coverage = std::unique_ptr<CoverageMapping>(new CoverageMapping());
+  uint64_t NumFunctions;
+  if (Error E = Reader.readSize(NumFunctions))
+    return std::move(E);
+  std::vector<StringRef> Filenames;
+  for (uint64_t I = 0; I != NumFunctions; ++I) {
+    StringRef Name;
+    uint64_t NumFilenames;
+    if (Error E = Reader.readString(Name))
+      return std::move(E);
+    if (Error E = Reader.readSize(NumFilenames))
+      return std::move(E);
+    Filenames.resize(NumFilenames);
+    for (StringRef &Filename : Filenames)
+      if (Error E = Reader.readString(Filename))
+        return std::move(E);
+
+    FunctionRecord Function(Name, Filenames);
+    uint64_t NumRegions;
+    if (Error E = Reader.readSize(NumRegions))
+      return std::move(E);
+    if (NumRegions == 0)
+      return make_error<CoverageMapError>(coveragemap_error::malformed);
+    for (uint64_t J = 0; J != NumRegions; ++J) {
+      uint64_t CounterKind, RegionKind, ExecutionCount;
+      unsigned CounterID, FileID, ExpandedFileID, LineStart, ColumnStart,
+          LineEnd, ColumnEnd;
+      if (Error E = Reader.readIntMax(CounterKind, Counter::Expression + 1))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(CounterID))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(FileID))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(ExpandedFileID))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(LineStart))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(ColumnStart))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(LineEnd))
+        return std::move(E);
+      if (Error E = Reader.readUnsigned(ColumnEnd))
+        return std::move(E);
+      if (Error E = Reader.readIntMax(RegionKind,
+                                      CounterMappingRegion::GapRegion + 1))
+        return std::move(E);
+      if (Error E = Reader.readULEB128(ExecutionCount))
+        return std::move(E);
+      Function.pushRegion(
+          CounterMappingRegion(
+              CounterKind == Counter::Zero
+                  ? Counter::getZero()
+                  : CounterKind == Counter::CounterValueReference
+                        ? Counter::getCounter(CounterID)
+                        : Counter::getExpression(CounterID),
+              FileID, ExpandedFileID, LineStart, ColumnStart, LineEnd,
+              ColumnEnd,
+              static_cast<CounterMappingRegion::RegionKind>(RegionKind)),
+          ExecutionCount);
+    }
+    Coverage->addFunctionRecord(std::move(Function));
+  }
+
+  uint64_t NumMismatches;
+  if (Error E = Reader.readSize(NumMismatches))
+    return std::move(E);
+  for (uint64_t I = 0; I != NumMismatches; ++I) {
+    StringRef Name;
+    uint64_t Hash;
+    if (Error E = Reader.readString(Name))
+      return std::move(E);
+    if (Error E = Reader.readULEB128(Hash))
+      return std::move(E);
+    Coverage->FuncHashMismatches.emplace_back(Name, Hash);
+  }
+
+  if (!Reader.atEnd())
+    return make_error<CoverageMapError>(coveragemap_error::malformed);
+  return std::move(Coverage);
+}
+
+/// Returns the key under which the coverage mapping of the given inputs is
+/// cached.
+static std::string getCacheKey(ArrayRef<std::unique_ptr<MemoryBuffer>> Objects,
+                               ArrayRef<StringRef> Arches,
+                               const MemoryBuffer &Profile) {
+  MD5 Hash;
+  Hash.update(LLVM_VERSION_STRING);
+  for (const auto &Object : llvm::enumerate(Objects)) {
+    Hash.update(Arches.empty() ? StringRef() : Arches[Object.index()]);
+    Hash.update(Object.value()->getBuffer());
+  }
+  Hash.update(Profile.getBuffer());
+  MD5::MD5Result Result;
+  Hash.final(Result);
+  return Result.digest().str();
+}
+
+/// Write \p Coverage to \p EntryPath. The cache is only an optimization:
+/// failing to write the entry is not an error.
+static void writeCacheEntry(const CoverageMapping &Coverage,
+                            StringRef CacheDir, StringRef EntryPath) {
+  if (sys::fs::create_directories(CacheDir))
+    return;
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers never see a partial entry.
+  SmallString<128> TempFilenameModel(CacheDir);
+  sys::path::append(TempFilenameModel, "cov-%%%%%%.tmp");
+  auto Temp = sys::fs::TempFile::create(TempFilenameModel);
+  if (!Temp) {
+    consumeError(Temp.takeError());
+    return;
+  }
+
+  {
+    raw_fd_ostream OS(Temp->FD, /*shouldClose=*/false);
+    Coverage.writeCache(OS);
+    if (OS.has_error()) {
+      OS.clear_error();
+      consumeError(Temp->discard());
+      return;
+    }
+  }
+
+  if (Error E = Temp->keep(EntryPath)) {
+    consumeError(std::move(E));
+    consumeError(Temp->discard());
+  }
+}
+
 Expected<std::unique_ptr<CoverageMapping>>
 CoverageMapping::load(ArrayRef<StringRef> ObjectFilenames,
-                      StringRef ProfileFilename, ArrayRef<StringRef> Arches) {
-  auto ProfileReaderOrErr = IndexedInstrProfReader::create(ProfileFilename);
+                      StringRef ProfileFilename, ArrayRef<StringRef> Arches,
+                      unsigned NumThreads, StringRef CacheDir) {
+  auto ProfileBufferOrErr = MemoryBuffer::getFileOrSTDIN(ProfileFilename);
+  if (std::error_code EC = ProfileBufferOrErr.getError())
+    return errorCodeToError(EC);
+  std::unique_ptr<MemoryBuffer> ProfileBuffer =
+      std::move(ProfileBufferOrErr.get());
+
+  SmallVector<std::unique_ptr<MemoryBuffer>, 4> ObjectBuffers;
+  for (StringRef ObjectFilename : ObjectFilenames) {
+    auto CovMappingBufOrErr = MemoryBuffer::getFileOrSTDIN(ObjectFilename);
+    if (std::error_code EC = CovMappingBufOrErr.getError())
+      return errorCodeToError(EC);
+    ObjectBuffers.push_back(std::move(CovMappingBufOrErr.get()));
+  }
+
+  // A cache entry that can't be read is ignored, and replaced by a new one.
+  SmallString<128> EntryPath;
+  if (!CacheDir.empty()) {
+    EntryPath = CacheDir;
+    sys::path::append(EntryPath, "llvmcov-" + getCacheKey(ObjectBuffers, Arches,
+                                                          *ProfileBuffer));
+    if (auto EntryOrErr = MemoryBuffer::getFile(EntryPath)) {
+      auto CoverageOrErr = loadFromCache(EntryOrErr.get()->getBuffer());
+      if (CoverageOrErr)
+        return std::move(CoverageOrErr);
+      consumeError(CoverageOrErr.takeError());
+    }
+  }
+
+  auto ProfileReaderOrErr =
+      IndexedInstrProfReader::create(std::move(ProfileBuffer));
   if (Error E = ProfileReaderOrErr.takeError())
     return std::move(E);
   auto ProfileReader = std::move(ProfileReaderOrErr.get());
 
   SmallVector<std::unique_ptr<CoverageMappingReader>, 4> Readers;
   SmallVector<std::unique_ptr<MemoryBuffer>, 4> Buffers;
-  for (const auto &File : llvm::enumerate(ObjectFilenames)) {
-    auto CovMappingBufOrErr = MemoryBuffer::getFileOrSTDIN(File.value());
-    if (std::error_code EC = CovMappingBufOrErr.getError())
-      return errorCodeToError(EC);
+  for (const auto &File : llvm::enumerate(ObjectBuffers)) {
     StringRef Arch = Arches.empty() ? StringRef() : Arches[File.index()];
-    MemoryBufferRef CovMappingBufRef =
-        CovMappingBufOrErr.get()->getMemBufferRef();
+    MemoryBufferRef CovMappingBufRef = File.value()->getMemBufferRef();
     auto CoverageReadersOrErr =
         BinaryCoverageReader::create(CovMappingBufRef, Arch, Buffers);
     if (Error E = CoverageReadersOrErr.takeError())
       return std::move(E);
     for (auto &Reader : CoverageReadersOrErr.get())
       Readers.push_back(std::move(Reader));
-    Buffers.push_back(std::move(CovMappingBufOrErr.get()));
   }
-  return load(Readers, *ProfileReader);
+
+  auto CoverageOrErr = load(Readers, *ProfileReader, NumThreads);
+  if (CoverageOrErr && !CacheDir.empty())
+    writeCacheEntry(**CoverageOrErr, CacheDir, EntryPath);
+  return CoverageOrErr;
 }
 
 namespace {
@@ -607,7 +926,8 @@ CoverageData CoverageMapping::getCoverageForFile(StringRef Filename) const {
   CoverageData FileCoverage(Filename);
   std::vector<CountedRegion> Regions;
 
-  for (const auto &Function : Functions) {
+  for (unsigned RecordIndex : getImpreciseRecordIndicesForFilename(Filename)) {
+    const FunctionRecord &Function = Functions[RecordIndex];
     auto MainFileID = findMainViewFileID(Filename, Function);
     auto FileIDs = gatherFileIDs(Filename, Function);
     for (const auto &CR : Function.CountedRegions)
@@ -627,7 +947,8 @@ CoverageData CoverageMapping::getCoverageForFile(StringRef Filename) const {
 std::vector<InstantiationGroup>
 CoverageMapping::getInstantiationGroups(StringRef Filename) const {
   FunctionInstantiationSetCollector InstantiationSetCollector;
-  for (const auto &Function : Functions) {
+  for (unsigned RecordIndex : getImpreciseRecordIndicesForFilename(Filename)) {
+    const FunctionRecord &Function = Functions[RecordIndex];
     auto MainFileID = findMainViewFileID(Filename, Function);
     if (!MainFileID)
       continue;
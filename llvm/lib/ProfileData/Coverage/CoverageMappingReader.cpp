@@ -31,7 +31,9 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/LEB128.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/ThreadPool.h"
 #include "llvm/Support/raw_ostream.h"
+#include <algorithm>
 #include <vector>
 
 using namespace llvm;
@@ -55,6 +57,29 @@ void CoverageMappingIterator::increment() {
     });
 }
 
+Error CoverageMappingReader::readNextRecords(
+    std::vector<DecodedCoverageMappingRecord> &Records, size_t MaxRecords,
+    ThreadPool *Pool) {
+  Records.clear();
+  CoverageMappingRecord Record;
+  while (Records.size() < MaxRecords) {
+    bool AtEnd = false;
+    if (Error E = handleErrors(
+            readNextRecord(Record),
+            [&](std::unique_ptr<CoverageMapError> CME) -> Error {
+              if (CME->get() != coveragemap_error::eof)
+                return Error(std::move(CME));
+              AtEnd = true;
+              return Error::success();
+            }))
+      return E;
+    if (AtEnd)
+      break;
+    Records.emplace_back(Record);
+  }
+  return Error::success();
+}
+
 Error RawCoverageReader::readULEB128(uint64_t &Result) {
   if (Data.empty())
     return make_error<CoverageMapError>(coveragemap_error::truncated);
@@ -805,27 +830,72 @@ BinaryCoverageReader::create(
   return std::move(Readers);
 }
 
-Error BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
-  if (CurrentRecord >= MappingRecords.size())
-    return make_error<CoverageMapError>(coveragemap_error::eof);
-
-  FunctionsFilenames.clear();
-  Expressions.clear();
-  MappingRegions.clear();
-  auto &R = MappingRecords[CurrentRecord];
+Error BinaryCoverageReader::decodeRecord(
+    const ProfileMappingRecord &R, DecodedCoverageMappingRecord &Record) const {
+  Record.Filenames.clear();
+  Record.Expressions.clear();
+  Record.MappingRegions.clear();
   RawCoverageMappingReader Reader(
       R.CoverageMapping,
       makeArrayRef(Filenames).slice(R.FilenamesBegin, R.FilenamesSize),
-      FunctionsFilenames, Expressions, MappingRegions);
+      Record.Filenames, Record.Expressions, Record.MappingRegions);
   if (auto Err = Reader.read())
     return Err;
 
   Record.FunctionName = R.FunctionName;
   Record.FunctionHash = R.FunctionHash;
-  Record.Filenames = FunctionsFilenames;
-  Record.Expressions = Expressions;
-  Record.MappingRegions = MappingRegions;
+  return Error::success();
+}
+
+Error BinaryCoverageReader::readNextRecord(CoverageMappingRecord &Record) {
+  if (CurrentRecord >= MappingRecords.size())
+    return make_error<CoverageMapError>(coveragemap_error::eof);
+
+  if (auto Err = decodeRecord(MappingRecords[CurrentRecord], Decoded))
+    return Err;
+  Record = Decoded.getRecord();
 
   ++CurrentRecord;
   return Error::success();
 }
+
+Error BinaryCoverageReader::readNextRecords(
+    std::vector<DecodedCoverageMappingRecord> &Records, size_t MaxRecords,
+    ThreadPool *Pool) {
+  size_t NumRecords =
+      std::min(MaxRecords, MappingRecords.size() - CurrentRecord);
+  Records.clear();
+  Records.resize(NumRecords);
+  auto Decode = [&](size_t I) {
+    return decodeRecord(MappingRecords[CurrentRecord + I], Records[I]);
+  };
+
+  if (!Pool) {
+    for (size_t I = 0; I != NumRecords; ++I)
+      if (auto Err = Decode(I))
+        return Err;
+  } else {
+    // The records are independent: decode them in chunks. If any of them is
+    // malformed, decode the first one again to report its error, so that the
+    // error doesn't depend on the scheduling.
+    const size_t ChunkSize = 64;
+    std::vector<char> Failed(NumRecords, false);
+    for (size_t Begin = 0; Begin < NumRecords; Begin += ChunkSize) {
+      size_t End = std::min(NumRecords, Begin + ChunkSize);
+      Pool->async([&, Begin, End] {
+        for (size_t I = Begin; I != End; ++I)
+          if (auto Err = Decode(I)) {
+            consumeError(std::move(Err));
+            Failed[I] = true;
+          }
+      });
+    }
+    Pool->wait();
+    auto FirstFailed = std::find(Failed.begin(), Failed.end(), true);
+    if (FirstFailed != Failed.end())
+      return Decode(FirstFailed - Failed.begin());
+  }
+
+  CurrentRecord += NumRecords;
+  return Error::success();
+}
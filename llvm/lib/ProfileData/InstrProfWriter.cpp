@@ -13,6 +13,7 @@
 
 #include "llvm/ProfileData/InstrProfWriter.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/ProfileSummary.h"
 #include "llvm/ProfileData/InstrProf.h"
@@ -20,6 +21,7 @@
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/EndianStream.h"
 #include "llvm/Support/Error.h"
+#include "llvm/Support/FileSystem.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/OnDiskHashTable.h"
 #include "llvm/Support/raw_ostream.h"
@@ -163,12 +165,54 @@ public:
   }
 };
 
+// Writes the records that were serialized by InstrProfRecordWriterTrait to
+// the spill file.
+class InstrProfSpilledRecordWriterTrait {
+public:
+  using key_type = StringRef;
+  using key_type_ref = StringRef;
+
+  using data_type = StringRef;
+  using data_type_ref = StringRef;
+
+  using hash_value_type = uint64_t;
+  using offset_type = uint64_t;
+
+  static hash_value_type ComputeHash(key_type_ref K) {
+    return IndexedInstrProf::ComputeHash(K);
+  }
+
+  static std::pair<offset_type, offset_type>
+  EmitKeyDataLength(raw_ostream &Out, key_type_ref K, data_type_ref V) {
+    using namespace support;
+
+    endian::Writer LE(Out, little);
+    LE.write<offset_type>(K.size());
+    LE.write<offset_type>(V.size());
+    return std::make_pair(K.size(), V.size());
+  }
+
+  void EmitKey(raw_ostream &Out, key_type_ref K, offset_type N) {
+    Out.write(K.data(), N);
+  }
+
+  void EmitData(raw_ostream &Out, key_type_ref, data_type_ref V, offset_type) {
+    Out << V;
+  }
+};
+
 } // end namespace llvm
 
 InstrProfWriter::InstrProfWriter(bool Sparse)
     : Sparse(Sparse), InfoObj(new InstrProfRecordWriterTrait()) {}
 
-InstrProfWriter::~InstrProfWriter() { delete InfoObj; }
+InstrProfWriter::~InstrProfWriter() {
+  delete InfoObj;
+  if (SpillFile) {
+    SpillFile.reset();
+    sys::fs::remove(SpillPath);
+  }
+}
 
 // Internal interface for testing purpose only.
 void InstrProfWriter::setValueProfDataEndianness(
@@ -254,6 +298,64 @@ void InstrProfWriter::mergeRecordsFromWriter(InstrProfWriter &&IPW,
   for (auto &I : IPW.FunctionData)
     for (auto &Func : I.getValue())
       addRecord(I.getKey(), Func.first, std::move(Func.second), 1, Warn);
+  IPW.FunctionData.clear();
+}
+
+Error InstrProfWriter::spillRecords() {
+  if (!SpillFile) {
+    int FD;
+    SmallString<128> Path;
+    if (std::error_code EC =
+            sys::fs::createTemporaryFile("profdata", "spill", FD, Path))
+      return errorCodeToError(EC);
+    SpillPath = Path.str();
+    SpillFile = llvm::make_unique<raw_fd_ostream>(FD, /*shouldClose=*/true);
+    SpillSummary = llvm::make_unique<InstrProfSummaryBuilder>(
+        ProfileSummaryBuilder::DefaultCutoffs);
+    SpillCSSummary = llvm::make_unique<InstrProfSummaryBuilder>(
+        ProfileSummaryBuilder::DefaultCutoffs);
+  }
+
+  // The records are serialized the same way as when they are written to the
+  // hash table, which also adds them to the summaries.
+  InfoObj->SummaryBuilder = SpillSummary.get();
+  InfoObj->CSSummaryBuilder = SpillCSSummary.get();
+  for (const auto &I : FunctionData) {
+    if (!shouldEncodeData(I.getValue()))
+      continue;
+    uint64_t Start = SpillFile->tell();
+    InfoObj->EmitData(*SpillFile, I.getKey(), &I.getValue(), 0);
+    bool Inserted =
+        SpilledData
+            .try_emplace(I.getKey(), Start, SpillFile->tell() - Start)
+            .second;
+    (void)Inserted;
+    assert(Inserted && "Records of a function were spilled twice");
+  }
+  InfoObj->SummaryBuilder = nullptr;
+  InfoObj->CSSummaryBuilder = nullptr;
+  FunctionData.clear();
+
+  SpillFile->flush();
+  if (SpillFile->has_error())
+    return errorCodeToError(SpillFile->error());
+  return Error::success();
+}
+
+uint64_t InstrProfWriter::writeSpilledRecords(raw_ostream &OS) {
+  auto BufOrErr = MemoryBuffer::getFile(SpillPath, /*FileSize=*/-1,
+                                        /*RequiresNullTerminator=*/false);
+  if (!BufOrErr)
+    report_fatal_error("cannot read back the spilled profile records: " +
+                       BufOrErr.getError().message());
+  StringRef Buf = (*BufOrErr)->getBuffer();
+
+  OnDiskChainedHashTableGenerator<InstrProfSpilledRecordWriterTrait> Generator;
+  for (const auto &I : SpilledData)
+    Generator.insert(I.getKey(),
+                     Buf.substr(I.getValue().first, I.getValue().second));
+  InstrProfSpilledRecordWriterTrait Trait;
+  return Generator.Emit(OS, Trait);
 }
 
 bool InstrProfWriter::shouldEncodeData(const ProfilingData &PD) {
@@ -289,9 +391,17 @@ void InstrProfWriter::writeImpl(ProfOStream &OS) {
 
   OnDiskChainedHashTableGenerator<InstrProfRecordWriterTrait> Generator;
 
+  // Once records have been spilled, the remaining ones are spilled too, and
+  // the summaries were computed while spilling.
+  if (SpillFile)
+    if (Error E = spillRecords())
+      report_fatal_error(std::move(E));
+
   InstrProfSummaryBuilder ISB(ProfileSummaryBuilder::DefaultCutoffs);
-  InfoObj->SummaryBuilder = &ISB;
   InstrProfSummaryBuilder CSISB(ProfileSummaryBuilder::DefaultCutoffs);
+  InstrProfSummaryBuilder &Summary = SpillFile ? *SpillSummary : ISB;
+  InstrProfSummaryBuilder &CSSummary = SpillFile ? *SpillCSSummary : CSISB;
+  InfoObj->SummaryBuilder = &ISB;
   InfoObj->CSSummaryBuilder = &CSISB;
 
   // Populate the hash table generator.
@@ -341,14 +451,15 @@ void InstrProfWriter::writeImpl(ProfOStream &OS) {
   }
 
   // Write the hash table.
-  uint64_t HashTableStart = Generator.Emit(OS.OS, *InfoObj);
+  uint64_t HashTableStart = SpillFile ? writeSpilledRecords(OS.OS)
+                                      : Generator.Emit(OS.OS, *InfoObj);
 
   // Allocate space for data to be serialized out.
   std::unique_ptr<IndexedInstrProf::Summary> TheSummary =
       IndexedInstrProf::allocSummary(SummarySize);
   // Compute the Summary and copy the data to the data
   // structure to be serialized out (to disk or buffer).
-  std::unique_ptr<ProfileSummary> PS = ISB.getSummary();
+  std::unique_ptr<ProfileSummary> PS = Summary.getSummary();
   setSummary(TheSummary.get(), *PS);
   InfoObj->SummaryBuilder = nullptr;
 
@@ -356,7 +467,7 @@ void InstrProfWriter::writeImpl(ProfOStream &OS) {
   std::unique_ptr<IndexedInstrProf::Summary> TheCSSummary = nullptr;
   if (ProfileKind == PF_IRLevelWithCS) {
     TheCSSummary = IndexedInstrProf::allocSummary(SummarySize);
-    std::unique_ptr<ProfileSummary> CSPS = CSISB.getSummary();
+    std::unique_ptr<ProfileSummary> CSPS = CSSummary.getSummary();
     setSummary(TheCSSummary.get(), *CSPS);
   }
   InfoObj->CSSummaryBuilder = nullptr;
@@ -437,6 +548,11 @@ void InstrProfWriter::writeRecordInText(StringRef Name, uint64_t Hash,
 }
 
 Error InstrProfWriter::writeText(raw_fd_ostream &OS) {
+  if (SpillFile)
+    return make_error<StringError>(
+        "spilled records can't be written in the text format",
+        inconvertibleErrorCode());
+
   if (ProfileKind == PF_IRLevel)
     OS << "# IR level Instrumentation Flag\n:ir\n";
   else if (ProfileKind == PF_IRLevelWithCS)
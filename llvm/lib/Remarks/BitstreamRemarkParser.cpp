@@ -0,0 +1,214 @@
+//===- BitstreamRemarkParser.cpp ------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides utility methods used by clients that want to use the
+// parser for remark diagnostics in LLVM.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BitstreamRemarkParser.h"
+#include "llvm/Remarks/BitstreamRemarkContainer.h"
+
+using namespace llvm;
+using namespace llvm::remarks;
+
+static Error malformed(const Twine &Msg) {
+  return make_error<StringError>("malformed remark container: " + Msg,
+                                 std::make_error_code(
+                                     std::errc::illegal_byte_sequence));
+}
+
+/// Enter the block \p BlockID, which must be the next entry.
+static Error enterBlock(BitstreamCursor &Stream, unsigned BlockID,
+                        StringRef BlockName) {
+  Expected<BitstreamEntry> Next = Stream.advance();
+  if (!Next)
+    return Next.takeError();
+  if (Next->Kind != BitstreamEntry::SubBlock || Next->ID != BlockID)
+    return malformed("expected " + BlockName + " block");
+  return Stream.EnterSubBlock(BlockID);
+}
+
+Error BitstreamRemarkParser::parseHeader() {
+  for (char C : ContainerMagic) {
+    Expected<SimpleBitstreamCursor::word_t> Byte = Stream.Read(8);
+    if (!Byte)
+      return Byte.takeError();
+    if (*Byte != static_cast<unsigned char>(C))
+      return malformed("unknown magic number");
+  }
+
+  // The BLOCKINFO_BLOCK is read (and entered) by ReadBlockInfoBlock.
+  Expected<BitstreamEntry> Next = Stream.advance();
+  if (!Next)
+    return Next.takeError();
+  if (Next->Kind != BitstreamEntry::SubBlock ||
+      Next->ID != bitc::BLOCKINFO_BLOCK_ID)
+    return malformed("expected BLOCKINFO block");
+  Expected<Optional<BitstreamBlockInfo>> NewBlockInfo =
+      Stream.ReadBlockInfoBlock();
+  if (!NewBlockInfo)
+    return NewBlockInfo.takeError();
+  if (!*NewBlockInfo)
+    return malformed("truncated BLOCKINFO block");
+  BlockInfo = std::move(**NewBlockInfo);
+  Stream.setBlockInfo(&BlockInfo);
+
+  if (Error E = enterBlock(Stream, META_BLOCK_ID, MetaBlockName))
+    return E;
+  while (true) {
+    Expected<BitstreamEntry> Entry = Stream.advance();
+    if (!Entry)
+      return Entry.takeError();
+    if (Entry->Kind == BitstreamEntry::EndBlock)
+      return Error::success();
+    if (Entry->Kind != BitstreamEntry::Record)
+      return malformed("unexpected entry in META block");
+
+    Record.clear();
+    Expected<unsigned> Code = Stream.readRecord(Entry->ID, Record);
+    if (!Code)
+      return Code.takeError();
+    switch (*Code) {
+    case RECORD_META_CONTAINER_INFO:
+      if (Record.size() != 1 || Record[0] != CurrentContainerVersion)
+        return malformed("unsupported container version");
+      break;
+    case RECORD_META_REMARK_VERSION:
+      if (Record.size() != 1 || Record[0] != remarks::Version)
+        return malformed("unsupported remark version");
+      break;
+    default:
+      // Ignore unknown metadata, so that it can be extended compatibly.
+      break;
+    }
+  }
+}
+
+Expected<StringRef> BitstreamRemarkParser::getString(uint64_t ID) {
+  if (ID >= Strings.size())
+    return malformed("string ID " + Twine(ID) + " is not defined");
+  return Strings[ID];
+}
+
+Expected<RemarkLocation> BitstreamRemarkParser::getLocation(size_t Idx) {
+  Expected<StringRef> File = getString(Record[Idx]);
+  if (!File)
+    return File.takeError();
+  return RemarkLocation{*File, static_cast<unsigned>(Record[Idx + 1]),
+                        static_cast<unsigned>(Record[Idx + 2])};
+}
+
+Error BitstreamRemarkParser::parseRemarkRecord(unsigned AbbrevID,
+                                               bool &HasHeader) {
+  Record.clear();
+  StringRef Blob;
+  Expected<unsigned> Code = Stream.readRecord(AbbrevID, Record, &Blob);
+  if (!Code)
+    return Code.takeError();
+
+  switch (*Code) {
+  case RECORD_REMARK_STRING:
+    // The blob points into the buffer: no copy needed.
+    Strings.push_back(Blob);
+    return Error::success();
+  case RECORD_REMARK_HEADER: {
+    if (Record.size() != 4)
+      return malformed("wrong number of fields in remark header");
+    if (Record[0] > static_cast<uint64_t>(Type::LastTypeValue))
+      return malformed("unknown remark type");
+    TheRemark.RemarkType = static_cast<Type>(Record[0]);
+    Expected<StringRef> RemarkName = getString(Record[1]);
+    if (!RemarkName)
+      return RemarkName.takeError();
+    Expected<StringRef> PassName = getString(Record[2]);
+    if (!PassName)
+      return PassName.takeError();
+    Expected<StringRef> FunctionName = getString(Record[3]);
+    if (!FunctionName)
+      return FunctionName.takeError();
+    TheRemark.RemarkName = *RemarkName;
+    TheRemark.PassName = *PassName;
+    TheRemark.FunctionName = *FunctionName;
+    HasHeader = true;
+    return Error::success();
+  }
+  case RECORD_REMARK_DEBUG_LOC: {
+    if (Record.size() != 3)
+      return malformed("wrong number of fields in remark debug location");
+    Expected<RemarkLocation> Loc = getLocation(0);
+    if (!Loc)
+      return Loc.takeError();
+    TheRemark.Loc = *Loc;
+    return Error::success();
+  }
+  case RECORD_REMARK_HOTNESS:
+    if (Record.size() != 1)
+      return malformed("wrong number of fields in remark hotness");
+    TheRemark.Hotness = Record[0];
+    return Error::success();
+  case RECORD_REMARK_ARG_WITH_DEBUGLOC:
+  case RECORD_REMARK_ARG_WITHOUT_DEBUGLOC: {
+    bool HasLoc = *Code == RECORD_REMARK_ARG_WITH_DEBUGLOC;
+    if (Record.size() != (HasLoc ? 5u : 2u))
+      return malformed("wrong number of fields in remark argument");
+    Expected<StringRef> Key = getString(Record[0]);
+    if (!Key)
+      return Key.takeError();
+    Expected<StringRef> Val = getString(Record[1]);
+    if (!Val)
+      return Val.takeError();
+    TmpArgs.emplace_back();
+    TmpArgs.back().Key = *Key;
+    TmpArgs.back().Val = *Val;
+    if (HasLoc) {
+      Expected<RemarkLocation> Loc = getLocation(2);
+      if (!Loc)
+        return Loc.takeError();
+      TmpArgs.back().Loc = *Loc;
+    }
+    return Error::success();
+  }
+  default:
+    return malformed("unknown record in REMARK block");
+  }
+}
+
+Expected<const Remark *> BitstreamRemarkParser::parseNext() {
+  if (!ParsedHeader) {
+    if (Error E = parseHeader())
+      return std::move(E);
+    ParsedHeader = true;
+  }
+
+  if (Stream.AtEndOfStream())
+    return nullptr;
+
+  if (Error E = enterBlock(Stream, REMARK_BLOCK_ID, RemarkBlockName))
+    return std::move(E);
+
+  TheRemark = Remark();
+  TmpArgs.clear();
+  bool HasHeader = false;
+  while (true) {
+    Expected<BitstreamEntry> Entry = Stream.advance();
+    if (!Entry)
+      return Entry.takeError();
+    if (Entry->Kind == BitstreamEntry::EndBlock)
+      break;
+    if (Entry->Kind != BitstreamEntry::Record)
+      return malformed("unexpected entry in REMARK block");
+    if (Error E = parseRemarkRecord(Entry->ID, HasHeader))
+      return std::move(E);
+  }
+
+  if (!HasHeader)
+    return malformed("missing remark header");
+  TheRemark.Args = TmpArgs;
+  return &TheRemark;
+}
@@ -0,0 +1,84 @@
+//===-- BitstreamRemarkParser.h - Parser for bitstream remarks --*- C++ -*-===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the implementation of the bitstream remark parser.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_REMARKS_BITSTREAM_REMARK_PARSER_H
+#define LLVM_REMARKS_BITSTREAM_REMARK_PARSER_H
+
+#include "RemarkParserImpl.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Bitcode/BitstreamReader.h"
+#include "llvm/Remarks/Remark.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+namespace llvm {
+namespace remarks {
+/// Parses and holds the state of the latest parsed remark.
+///
+/// Strings are not copied: the remarks refer to the parsed buffer, which can
+/// be a memory-mapped file.
+struct BitstreamRemarkParser {
+  /// The cursor in the container.
+  BitstreamCursor Stream;
+  /// The abbreviations read from the BLOCKINFO_BLOCK.
+  BitstreamBlockInfo BlockInfo;
+  /// The strings defined so far, indexed by their ID.
+  SmallVector<StringRef, 64> Strings;
+  /// Temporary parsing buffer for the arguments.
+  SmallVector<Argument, 8> TmpArgs;
+  /// Temporary parsing buffer for the records.
+  SmallVector<uint64_t, 8> Record;
+  /// The latest parsed remark. Invalidated with every call to `parseNext`.
+  Remark TheRemark;
+  /// Set once the container header has been parsed.
+  bool ParsedHeader = false;
+
+  BitstreamRemarkParser(StringRef Buf) : Stream(Buf) {}
+
+  /// Parse the next remark. Returns null at the end of the container.
+  Expected<const Remark *> parseNext();
+
+private:
+  /// Parse the magic number, the BLOCKINFO_BLOCK and the META_BLOCK.
+  Error parseHeader();
+  /// Parse one record of a REMARK_BLOCK into TheRemark.
+  Error parseRemarkRecord(unsigned AbbrevID, bool &HasHeader);
+  /// Return the string with ID \p ID.
+  Expected<StringRef> getString(uint64_t ID);
+  /// Read a location whose fields start at \p Record[Idx].
+  Expected<RemarkLocation> getLocation(size_t Idx);
+};
+
+/// Bitstream remark container parser.
+struct BitstreamParserImpl : public ParserImpl {
+  /// The object parsing the container.
+  BitstreamRemarkParser BitstreamParser;
+  /// Storage for the error stream.
+  std::string ErrorString;
+  /// The error stream.
+  raw_string_ostream ErrorStream;
+  /// Set to `true` if we had any errors during parsing.
+  bool HasErrors = false;
+
+  BitstreamParserImpl(StringRef Buf)
+      : ParserImpl{ParserImpl::Kind::Bitstream}, BitstreamParser(Buf),
+        ErrorString(), ErrorStream(ErrorString) {}
+
+  static bool classof(const ParserImpl *PI) {
+    return PI->ParserKind == ParserImpl::Kind::Bitstream;
+  }
+};
+} // end namespace remarks
+} // end namespace llvm
+
+#endif /* LLVM_REMARKS_BITSTREAM_REMARK_PARSER_H */
@@ -0,0 +1,213 @@
+//===- BitstreamRemarkSerializer.cpp --------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// This file provides the implementation of the bitstream remark serializer
+// using LLVM's bitstream writer.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Remarks/BitstreamRemarkContainer.h"
+#include "llvm/Remarks/RemarkSerializer.h"
+
+using namespace llvm;
+using namespace llvm::remarks;
+
+static void setRecordName(unsigned RecordID, BitstreamWriter &Bitstream,
+                          SmallVectorImpl<uint64_t> &R, StringRef Str) {
+  R.clear();
+  R.push_back(RecordID);
+  R.append(Str.begin(), Str.end());
+  Bitstream.EmitRecord(bitc::BLOCKINFO_CODE_SETRECORDNAME, R);
+}
+
+static void setBlockName(BitstreamWriter &Bitstream,
+                         SmallVectorImpl<uint64_t> &R, StringRef Str) {
+  R.clear();
+  R.append(Str.begin(), Str.end());
+  Bitstream.EmitRecord(bitc::BLOCKINFO_CODE_BLOCKNAME, R);
+}
+
+BitstreamSerializer::BitstreamSerializer(raw_ostream &OS)
+    : Serializer(OS), Bitstream(Encoded) {
+  for (char C : ContainerMagic)
+    Bitstream.Emit(static_cast<unsigned>(C), 8);
+  setupBlockInfo();
+  emitMetaBlock();
+  flush();
+}
+
+void BitstreamSerializer::setupBlockInfo() {
+  Bitstream.EnterBlockInfoBlock();
+
+  // The META_BLOCK records are only emitted once, so they are not abbreviated
+  // and the block only needs names.
+  R.clear();
+  R.push_back(META_BLOCK_ID);
+  Bitstream.EmitRecord(bitc::BLOCKINFO_CODE_SETBID, R);
+  setBlockName(Bitstream, R, MetaBlockName);
+  setRecordName(RECORD_META_CONTAINER_INFO, Bitstream, R,
+                MetaContainerInfoName);
+  setRecordName(RECORD_META_REMARK_VERSION, Bitstream, R,
+                MetaRemarkVersionName);
+
+  auto Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_STRING));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Blob)); // String.
+  RecordRemarkStringAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_HEADER));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::Fixed, 3)); // Type.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // Remark name.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6));   // Pass name.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8));   // Function name.
+  RecordRemarkHeaderAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_DEBUG_LOC));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // File.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // Line.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Column.
+  RecordRemarkDebugLocAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_HOTNESS));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // Hotness.
+  RecordRemarkHotnessAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_ARG_WITH_DEBUGLOC));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // Key.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // Value.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // File.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 8)); // Line.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 6)); // Column.
+  RecordRemarkArgWithDebugLocAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  Abbrev = std::make_shared<BitCodeAbbrev>();
+  Abbrev->Add(BitCodeAbbrevOp(RECORD_REMARK_ARG_WITHOUT_DEBUGLOC));
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // Key.
+  Abbrev->Add(BitCodeAbbrevOp(BitCodeAbbrevOp::VBR, 7)); // Value.
+  RecordRemarkArgWithoutDebugLocAbbrevID =
+      Bitstream.EmitBlockInfoAbbrev(REMARK_BLOCK_ID, Abbrev);
+
+  setBlockName(Bitstream, R, RemarkBlockName);
+  setRecordName(RECORD_REMARK_STRING, Bitstream, R, RemarkStringName);
+  setRecordName(RECORD_REMARK_HEADER, Bitstream, R, RemarkHeaderName);
+  setRecordName(RECORD_REMARK_DEBUG_LOC, Bitstream, R, RemarkDebugLocName);
+  setRecordName(RECORD_REMARK_HOTNESS, Bitstream, R, RemarkHotnessName);
+  setRecordName(RECORD_REMARK_ARG_WITH_DEBUGLOC, Bitstream, R,
+                RemarkArgWithDebugLocName);
+  setRecordName(RECORD_REMARK_ARG_WITHOUT_DEBUGLOC, Bitstream, R,
+                RemarkArgWithoutDebugLocName);
+
+  Bitstream.ExitBlock();
+}
+
+void BitstreamSerializer::emitMetaBlock() {
+  Bitstream.EnterSubblock(META_BLOCK_ID, 3);
+
+  R.clear();
+  R.push_back(CurrentContainerVersion);
+  Bitstream.EmitRecord(RECORD_META_CONTAINER_INFO, R);
+
+  R.clear();
+  R.push_back(remarks::Version);
+  Bitstream.EmitRecord(RECORD_META_REMARK_VERSION, R);
+
+  Bitstream.ExitBlock();
+}
+
+uint64_t BitstreamSerializer::useString(StringRef Str) {
+  size_t NextID = Strings.StrTab.size();
+  unsigned ID = Strings.add(Str).first;
+  if (ID == NextID) {
+    R.clear();
+    R.push_back(RECORD_REMARK_STRING);
+    Bitstream.EmitRecordWithBlob(RecordRemarkStringAbbrevID, R, Str);
+  }
+  return ID;
+}
+
+void BitstreamSerializer::emit(const Remark &Remark) {
+  Bitstream.EnterSubblock(REMARK_BLOCK_ID, 4);
+
+  // New strings are defined at the start of the block, before the records
+  // that use them.
+  uint64_t RemarkNameID = useString(Remark.RemarkName);
+  uint64_t PassNameID = useString(Remark.PassName);
+  uint64_t FunctionNameID = useString(Remark.FunctionName);
+  Optional<uint64_t> FileID;
+  if (const Optional<RemarkLocation> &Loc = Remark.Loc)
+    FileID = useString(Loc->SourceFilePath);
+  SmallVector<std::pair<uint64_t, uint64_t>, 8> ArgIDs;
+  SmallVector<uint64_t, 8> ArgFileIDs;
+  for (const Argument &Arg : Remark.Args) {
+    ArgIDs.emplace_back(useString(Arg.Key), useString(Arg.Val));
+    if (Arg.Loc)
+      ArgFileIDs.push_back(useString(Arg.Loc->SourceFilePath));
+  }
+
+  R.clear();
+  R.push_back(RECORD_REMARK_HEADER);
+  R.push_back(static_cast<uint64_t>(Remark.RemarkType));
+  R.push_back(RemarkNameID);
+  R.push_back(PassNameID);
+  R.push_back(FunctionNameID);
+  Bitstream.EmitRecordWithAbbrev(RecordRemarkHeaderAbbrevID, R);
+
+  if (const Optional<RemarkLocation> &Loc = Remark.Loc) {
+    R.clear();
+    R.push_back(RECORD_REMARK_DEBUG_LOC);
+    R.push_back(*FileID);
+    R.push_back(Loc->SourceLine);
+    R.push_back(Loc->SourceColumn);
+    Bitstream.EmitRecordWithAbbrev(RecordRemarkDebugLocAbbrevID, R);
+  }
+
+  if (Optional<uint64_t> Hotness = Remark.Hotness) {
+    R.clear();
+    R.push_back(RECORD_REMARK_HOTNESS);
+    R.push_back(*Hotness);
+    Bitstream.EmitRecordWithAbbrev(RecordRemarkHotnessAbbrevID, R);
+  }
+
+  auto ArgFileID = ArgFileIDs.begin();
+  for (size_t I = 0, E = Remark.Args.size(); I != E; ++I) {
+    const Argument &Arg = Remark.Args[I];
+    R.clear();
+    R.push_back(Arg.Loc ? RECORD_REMARK_ARG_WITH_DEBUGLOC
+                        : RECORD_REMARK_ARG_WITHOUT_DEBUGLOC);
+    R.push_back(ArgIDs[I].first);
+    R.push_back(ArgIDs[I].second);
+    if (Arg.Loc) {
+      R.push_back(*ArgFileID++);
+      R.push_back(Arg.Loc->SourceLine);
+      R.push_back(Arg.Loc->SourceColumn);
+    }
+    Bitstream.EmitRecordWithAbbrev(Arg.Loc
+                                       ? RecordRemarkArgWithDebugLocAbbrevID
+                                       : RecordRemarkArgWithoutDebugLocAbbrevID,
+                                   R);
+  }
+
+  Bitstream.ExitBlock();
+  flush();
+}
+
+void BitstreamSerializer::flush() {
+  // Blocks end on a 32-bit boundary, so all the bits have been written to
+  // Encoded.
+  OS.write(Encoded.data(), Encoded.size());
+  Encoded.clear();
+}
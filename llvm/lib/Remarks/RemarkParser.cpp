@@ -12,15 +12,23 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Remarks/RemarkParser.h"
+#include "BitstreamRemarkParser.h"
 #include "YAMLRemarkParser.h"
 #include "llvm-c/Remarks.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/Remarks/BitstreamRemarkContainer.h"
 #include "llvm/Support/CBindingWrapping.h"
 
 using namespace llvm;
 using namespace llvm::remarks;
 
-Parser::Parser(StringRef Buf) : Impl(llvm::make_unique<YAMLParserImpl>(Buf)) {}
+static std::unique_ptr<ParserImpl> createParserImpl(StringRef Buf) {
+  if (isBitstreamRemarkContainer(Buf))
+    return llvm::make_unique<BitstreamParserImpl>(Buf);
+  return llvm::make_unique<YAMLParserImpl>(Buf);
+}
+
+Parser::Parser(StringRef Buf) : Impl(createParserImpl(Buf)) {}
 
 Parser::Parser(StringRef Buf, StringRef StrTabBuf)
     : Impl(llvm::make_unique<YAMLParserImpl>(Buf, StrTabBuf)) {}
@@ -56,6 +64,8 @@ static Expected<const Remark *> getNextYAML(YAMLParserImpl &Impl) {
 Expected<const Remark *> Parser::getNext() const {
   if (auto *Impl = dyn_cast<YAMLParserImpl>(this->Impl.get()))
     return getNextYAML(*Impl);
+  if (auto *Impl = dyn_cast<BitstreamParserImpl>(this->Impl.get()))
+    return Impl->BitstreamParser.parseNext();
   llvm_unreachable("Get next called with an unknown parsing implementation.");
 }
 
@@ -93,6 +103,17 @@ extern "C" LLVMRemarkParserRef LLVMRemarkParserCreateYAML(const void *Buf,
       new remarks::Parser(StringRef(static_cast<const char *>(Buf), Size)));
 }
 
+extern "C" LLVMRemarkParserRef LLVMRemarkParserCreateBitstream(const void *Buf,
+                                                               uint64_t Size) {
+  StringRef Buffer(static_cast<const char *>(Buf), Size);
+  auto *TheParser = new remarks::Parser(Buffer);
+  // Don't fall back to YAML: anything that is not a bitstream container is
+  // reported as an error by the first call to LLVMRemarkParserGetNext.
+  if (!isa<remarks::BitstreamParserImpl>(TheParser->Impl.get()))
+    TheParser->Impl = llvm::make_unique<remarks::BitstreamParserImpl>(Buffer);
+  return wrap(TheParser);
+}
+
 static void handleYAMLError(remarks::YAMLParserImpl &Impl, Error E) {
   handleAllErrors(
       std::move(E),
@@ -113,7 +134,11 @@ LLVMRemarkParserGetNext(LLVMRemarkParserRef Parser) {
     // Error during parsing.
     if (auto *Impl = dyn_cast<remarks::YAMLParserImpl>(TheParser.Impl.get()))
       handleYAMLError(*Impl, RemarkOrErr.takeError());
-    else
+    else if (auto *Impl = dyn_cast<remarks::BitstreamParserImpl>(
+                 TheParser.Impl.get())) {
+      logAllUnhandledErrors(RemarkOrErr.takeError(), Impl->ErrorStream);
+      Impl->HasErrors = true;
+    } else
       llvm_unreachable("unkown parser implementation.");
     return nullptr;
   }
@@ -128,6 +153,9 @@ extern "C" LLVMBool LLVMRemarkParserHasError(LLVMRemarkParserRef Parser) {
   if (auto *Impl =
           dyn_cast<remarks::YAMLParserImpl>(unwrap(Parser)->Impl.get()))
     return Impl->HasErrors;
+  if (auto *Impl =
+          dyn_cast<remarks::BitstreamParserImpl>(unwrap(Parser)->Impl.get()))
+    return Impl->HasErrors;
   llvm_unreachable("unkown parser implementation.");
 }
 
@@ -136,6 +164,9 @@ LLVMRemarkParserGetErrorMessage(LLVMRemarkParserRef Parser) {
   if (auto *Impl =
           dyn_cast<remarks::YAMLParserImpl>(unwrap(Parser)->Impl.get()))
     return Impl->YAMLParser.ErrorStream.str().c_str();
+  if (auto *Impl =
+          dyn_cast<remarks::BitstreamParserImpl>(unwrap(Parser)->Impl.get()))
+    return Impl->ErrorStream.str().c_str();
   llvm_unreachable("unkown parser implementation.");
 }
 
@@ -6,7 +6,8 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements the BumpPtrAllocator interface.
+// This file implements the BumpPtrAllocator and ThreadSafeBumpPtrAllocator
+// interfaces.
 //
 //===----------------------------------------------------------------------===//
 
@@ -26,6 +27,15 @@ void printBumpPtrAllocatorStats(unsigned NumSlabs, size_t BytesAllocated,
          << " (includes alignment, etc)\n";
 }
 
+unsigned getBumpPtrAllocatorThreadIndex() {
+  static std::atomic<unsigned> NextIndex(0);
+  // Zero means that the thread has no index yet.
+  static LLVM_THREAD_LOCAL unsigned Index = 0;
+  if (LLVM_UNLIKELY(Index == 0))
+    Index = NextIndex.fetch_add(1, std::memory_order_relaxed) + 1;
+  return Index - 1;
+}
+
 } // End namespace detail.
 
 void PrintRecyclerStats(size_t Size,
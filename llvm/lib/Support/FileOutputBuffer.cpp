@@ -13,9 +13,14 @@
 #include "llvm/Support/FileOutputBuffer.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include <atomic>
+#include <cerrno>
 #include <system_error>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -24,6 +29,10 @@
 #include <io.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/vfs.h>
+#endif
+
 using namespace llvm;
 using namespace llvm::sys;
 
@@ -71,6 +80,76 @@ private:
   fs::TempFile Temp;
 };
 
+// Writes Data to the beginning of FD. Large buffers are written as several
+// chunks at a time, which keeps more requests in flight on file systems with
+// a high latency.
+std::error_code writeToFile(int FD, ArrayRef<uint8_t> Data) {
+#ifdef _WIN32
+  raw_fd_ostream OS(FD, /*shouldClose=*/false, /*unbuffered=*/true);
+  OS << toStringRef(Data);
+  return OS.error();
+#else
+  const size_t ChunkSize = 16 * 1024 * 1024;
+  size_t NumChunks = divideCeil(Data.size(), ChunkSize);
+  std::atomic<int> Errno(0);
+
+  parallel::for_each_n(parallel::par, size_t(0), NumChunks, [&](size_t I) {
+    size_t Off = I * ChunkSize;
+    size_t End = std::min(Off + ChunkSize, Data.size());
+    while (Off < End && Errno == 0) {
+      ssize_t N = ::pwrite(FD, Data.data() + Off, End - Off, Off);
+      if (N < 0) {
+        if (errno != EINTR)
+          Errno = errno;
+        continue;
+      }
+      Off += N;
+    }
+  });
+  return std::error_code(Errno, std::generic_category());
+#endif
+}
+
+// A FileOutputBuffer which keeps data in memory and writes it to a temporary
+// file in the same directory as the final output file on commit(). The final
+// output file is then atomically replaced as with OnDiskBuffer. This is used
+// instead of OnDiskBuffer on file systems where page faults on a shared file
+// mapping are slow.
+class StreamedBuffer : public FileOutputBuffer {
+public:
+  StreamedBuffer(StringRef Path, fs::TempFile Temp, MemoryBlock Buf,
+                 size_t BufSize)
+      : FileOutputBuffer(Path), Buffer(Buf), BufferSize(BufSize),
+        Temp(std::move(Temp)) {}
+
+  uint8_t *getBufferStart() const override { return (uint8_t *)Buffer.base(); }
+
+  uint8_t *getBufferEnd() const override {
+    return (uint8_t *)Buffer.base() + BufferSize;
+  }
+
+  size_t getBufferSize() const override { return BufferSize; }
+
+  Error commit() override {
+    if (std::error_code EC =
+            writeToFile(Temp.FD, makeArrayRef(getBufferStart(), BufferSize)))
+      return errorCodeToError(EC);
+
+    // Release the memory before renaming, as the file has all the contents.
+    Buffer = OwningMemoryBlock();
+    return Temp.keep(FinalPath);
+  }
+
+  ~StreamedBuffer() override { consumeError(Temp.discard()); }
+
+  void discard() override { consumeError(Temp.discard()); }
+
+private:
+  OwningMemoryBlock Buffer;
+  size_t BufferSize;
+  fs::TempFile Temp;
+};
+
 // A FileOutputBuffer which keeps data in memory and writes to the final
 // output file on commit(). This is used only when we cannot use OnDiskBuffer.
 class InMemoryBuffer : public FileOutputBuffer {
@@ -124,6 +203,20 @@ createInMemoryBuffer(StringRef Path, size_t Size, unsigned Mode) {
   return llvm::make_unique<InMemoryBuffer>(Path, MB, Size, Mode);
 }
 
+// Returns true if page faults on a shared mapping of FD are known to be slow,
+// which is the case for network file systems and overlayfs.
+static bool hasSlowMappedWrites(int FD) {
+  if (!fs::is_local(FD))
+    return true;
+#if defined(__linux__)
+  const long OverlayfsSuperMagic = 0x794c7630;
+  struct statfs Buf;
+  if (::fstatfs(FD, &Buf) == 0 && Buf.f_type == OverlayfsSuperMagic)
+    return true;
+#endif
+  return false;
+}
+
 static Expected<std::unique_ptr<FileOutputBuffer>>
 createOnDiskBuffer(StringRef Path, size_t Size, unsigned Mode) {
   Expected<fs::TempFile> FileOrErr =
@@ -132,6 +225,19 @@ createOnDiskBuffer(StringRef Path, size_t Size, unsigned Mode) {
     return FileOrErr.takeError();
   fs::TempFile File = std::move(*FileOrErr);
 
+  // Don't map the file if writing through the mapping would be slow. The
+  // buffer is anonymous memory instead, which is written out on commit().
+  if (hasSlowMappedWrites(File.FD)) {
+    std::error_code EC;
+    MemoryBlock MB = Memory::allocateMappedMemory(
+        Size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+    if (EC) {
+      consumeError(File.discard());
+      return errorCodeToError(EC);
+    }
+    return llvm::make_unique<StreamedBuffer>(Path, std::move(File), MB, Size);
+  }
+
 #ifndef _WIN32
   // On Windows, CreateFileMapping (the mmap function on Windows)
   // automatically extends the underlying file. We don't need to
@@ -14,8 +14,9 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
-#include <stack>
+#include <deque>
 #include <thread>
+#include <vector>
 
 namespace llvm {
 namespace parallel {
@@ -29,6 +30,10 @@ public:
   virtual ~Executor() = default;
   virtual void add(std::function<void()> func) = 0;
 
+  /// Run one of the tasks waiting for a thread, if there is one. Returns false
+  /// if there was nothing to run.
+  virtual bool runPendingTask() { return false; }
+
   static Executor *getDefaultExecutor();
 };
 
@@ -60,19 +65,25 @@ Executor *Executor::getDefaultExecutor() {
 }
 
 #else
-/// An implementation of an Executor that runs closures on a thread pool
-///   in filo order.
+/// An Executor that runs closures on a thread pool with work stealing.
+///
+/// Every worker owns a deque of tasks. Tasks added by a worker go to the back
+/// of its own deque and the worker pops from the back, so nested work runs in
+/// filo order on the thread that created it and stays warm in its caches. A
+/// worker whose deque is empty steals from the front of the others, starting
+/// with its neighbours. Threads outside the pool hand their tasks to the
+/// workers round-robin.
 class ThreadPoolExecutor : public Executor {
 public:
   explicit ThreadPoolExecutor(unsigned ThreadCount = hardware_concurrency())
-      : Done(ThreadCount) {
+      : Queues(ThreadCount), Done(ThreadCount) {
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     std::thread([&, ThreadCount] {
       for (size_t i = 1; i < ThreadCount; ++i) {
-        std::thread([=] { work(); }).detach();
+        std::thread([=] { work(i); }).detach();
       }
-      work();
+      work(0);
     }).detach();
   }
 
@@ -85,34 +96,90 @@ public:
   }
 
   void add(std::function<void()> F) override {
-    std::unique_lock<std::mutex> Lock(Mutex);
-    WorkStack.push(F);
-    Lock.unlock();
-    Cond.notify_one();
+    size_t I = WorkerIndex ? WorkerIndex - 1 : NextQueue++ % Queues.size();
+    {
+      std::lock_guard<std::mutex> Lock(Queues[I].Mutex);
+      Queues[I].Tasks.push_back(std::move(F));
+    }
+    // Pairs with the check of Pending in work(): either the worker sees this
+    // task or we see that it went to sleep and wake it up.
+    Pending.fetch_add(1);
+    if (Sleeping.load() > 0) {
+      std::lock_guard<std::mutex> Lock(Mutex);
+      Cond.notify_one();
+    }
+  }
+
+  bool runPendingTask() override {
+    return runOne(WorkerIndex ? WorkerIndex - 1 : Queues.size());
   }
 
 private:
-  void work() {
-    while (true) {
+  struct alignas(64) WorkQueue {
+    std::mutex Mutex;
+    std::deque<std::function<void()>> Tasks;
+  };
+
+  /// Take a task, from the back of queue \p Self if it is one of ours, or
+  /// from the front of another queue, and run it. Returns false if there was
+  /// no task to take.
+  bool runOne(size_t Self) {
+    std::function<void()> Task;
+    if (Self < Queues.size()) {
+      WorkQueue &Q = Queues[Self];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.back());
+        Q.Tasks.pop_back();
+      }
+    }
+    for (size_t K = 1, N = Queues.size(); !Task && K <= N; ++K) {
+      WorkQueue &Q = Queues[(Self + K) % N];
+      std::lock_guard<std::mutex> Lock(Q.Mutex);
+      if (!Q.Tasks.empty()) {
+        Task = std::move(Q.Tasks.front());
+        Q.Tasks.pop_front();
+      }
+    }
+    if (!Task)
+      return false;
+    Pending.fetch_sub(1);
+    Task();
+    return true;
+  }
+
+  void work(size_t I) {
+    WorkerIndex = I + 1;
+    while (!Stop) {
+      if (runOne(I))
+        continue;
       std::unique_lock<std::mutex> Lock(Mutex);
-      Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
-      if (Stop)
-        break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
-      Lock.unlock();
-      Task();
+      ++Sleeping;
+      Cond.wait(Lock, [&] { return Stop || Pending.load() > 0; });
+      --Sleeping;
     }
     Done.dec();
   }
 
+  /// One plus the index of the worker running on this thread, or zero if it
+  /// is not one of ours.
+  static LLVM_THREAD_LOCAL unsigned WorkerIndex;
+
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
+  std::vector<WorkQueue> Queues;
+  /// The queue that gets the next task added by a thread outside the pool.
+  std::atomic<unsigned> NextQueue{0};
+  /// The number of tasks in all queues.
+  std::atomic<size_t> Pending{0};
+  /// The number of workers waiting on Cond.
+  std::atomic<unsigned> Sleeping{0};
   std::mutex Mutex;
   std::condition_variable Cond;
   parallel::detail::Latch Done;
 };
 
+LLVM_THREAD_LOCAL unsigned ThreadPoolExecutor::WorkerIndex = 0;
+
 Executor *Executor::getDefaultExecutor() {
   static ThreadPoolExecutor exec;
   return &exec;
@@ -120,6 +187,7 @@ Executor *Executor::getDefaultExecutor() {
 #endif
 }
 
+#if defined(_MSC_VER)
 static std::atomic<int> TaskGroupInstances;
 
 // Latch::sync() called by the dtor may cause one thread to block. If is a dead
@@ -129,6 +197,24 @@ static std::atomic<int> TaskGroupInstances;
 TaskGroup::TaskGroup() : Parallel(TaskGroupInstances++ == 0) {}
 TaskGroup::~TaskGroup() { --TaskGroupInstances; }
 
+void TaskGroup::sync() const { L.sync(); }
+#else
+// sync() runs pending tasks instead of blocking, so a thread waiting for a
+// TaskGroup keeps making progress on the tasks it waits for, and nested task
+// groups can run in parallel without tying up workers.
+TaskGroup::TaskGroup() : Parallel(true) {}
+TaskGroup::~TaskGroup() { sync(); }
+
+void TaskGroup::sync() const {
+  while (!L.isDone()) {
+    // The remaining tasks are running on other threads. Wait a little for
+    // them, but come back to help if they spawn more work.
+    if (!Executor::getDefaultExecutor()->runPendingTask())
+      L.syncFor(std::chrono::microseconds(100));
+  }
+}
+#endif
+
 void TaskGroup::spawn(std::function<void()> F) {
   if (Parallel) {
     L.inc();
@@ -15,8 +15,11 @@
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/JSON.h"
+#include "llvm/Support/Threading.h"
 #include <cassert>
 #include <chrono>
+#include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -42,32 +45,81 @@ struct Entry {
   DurationType Duration;
   std::string Name;
   std::string Detail;
+  unsigned Tid;
+  // Time spent in the sections nested in this one.
+  DurationType ChildDuration{};
 
   Entry(time_point<steady_clock> &&S, DurationType &&D, std::string &&N,
-        std::string &&Dt)
+        std::string &&Dt, unsigned T)
       : Start(std::move(S)), Duration(std::move(D)), Name(std::move(N)),
-        Detail(std::move(Dt)){};
+        Detail(std::move(Dt)), Tid(T){};
+};
+
+// Aggregated time of the sections with the same name and detail, e.g. of
+// all inclusions of a header or all instantiations of a specialization.
+struct SummaryEntry {
+  size_t Count = 0;
+  // Time of the sections, not counting recursive ones twice.
+  DurationType Total{};
+  // Time of the sections minus the time of their nested sections.
+  DurationType Self{};
+};
+
+// Each thread that opens a section gets its own stack of open entries and
+// its own "tid" in the output, so that events of worker threads do not
+// interleave with the ones of the thread that created the profiler.
+struct ThreadStack {
+  unsigned Tid;
+  SmallVector<Entry, 16> Entries;
 };
 
 struct TimeTraceProfiler {
-  TimeTraceProfiler() {
+  TimeTraceProfiler(StringRef ProcName) : ProcName(ProcName) {
     StartTime = steady_clock::now();
+    getStack();
+  }
+
+  // Returns the stack of the calling thread. Mu must be held.
+  ThreadStack &getStack() {
+    auto P = Stacks.insert({get_threadid(), ThreadStack()});
+    if (P.second)
+      P.first->second.Tid = Stacks.size() - 1;
+    return P.first->second;
   }
 
   void begin(std::string Name, llvm::function_ref<std::string()> Detail) {
-    Stack.emplace_back(steady_clock::now(), DurationType{}, std::move(Name),
-                       Detail());
+    std::string D = Detail();
+    auto Now = steady_clock::now();
+    std::lock_guard<std::mutex> Lock(Mu);
+    ThreadStack &S = getStack();
+    S.Entries.emplace_back(std::move(Now), DurationType{}, std::move(Name),
+                           std::move(D), S.Tid);
   }
 
   void end() {
+    auto Now = steady_clock::now();
+    std::lock_guard<std::mutex> Lock(Mu);
+    auto &Stack = getStack().Entries;
     assert(!Stack.empty() && "Must call begin() first");
     auto &E = Stack.back();
-    E.Duration = steady_clock::now() - E.Start;
+    E.Duration = Now - E.Start;
 
     // Only include sections longer than TimeTraceGranularity msec.
     if (duration_cast<microseconds>(E.Duration).count() > TimeTraceGranularity)
       Entries.emplace_back(E);
 
+    if (Stack.size() > 1)
+      Stack[Stack.size() - 2].ChildDuration += E.Duration;
+
+    // The summary includes all sections regardless of the granularity.
+    SummaryEntry &Summary = Summaries[{E.Name, E.Detail}];
+    Summary.Count++;
+    Summary.Self += E.Duration - E.ChildDuration;
+    if (std::find_if(++Stack.rbegin(), Stack.rend(), [&](const Entry &Val) {
+          return Val.Name == E.Name && Val.Detail == E.Detail;
+        }) == Stack.rend())
+      Summary.Total += E.Duration;
+
     // Track total time taken by each "name", but only the topmost levels of
     // them; e.g. if there's a template instantiation that instantiates other
     // templates from within, we only want to add the topmost one. "topmost"
@@ -85,7 +137,11 @@ struct TimeTraceProfiler {
   }
 
   void Write(raw_pwrite_stream &OS) {
-    assert(Stack.empty() &&
+    std::lock_guard<std::mutex> Lock(Mu);
+    assert(llvm::all_of(Stacks,
+                        [](const std::pair<uint64_t, ThreadStack> &P) {
+                          return P.second.Entries.empty();
+                        }) &&
            "All profiler sections should be ended when calling Write");
     json::OStream J(OS);
     J.objectBegin();
@@ -99,7 +155,7 @@ struct TimeTraceProfiler {
 
       J.object([&]{
         J.attribute("pid", 1);
-        J.attribute("tid", 0);
+        J.attribute("tid", int64_t(E.Tid));
         J.attribute("ph", "X");
         J.attribute("ts", StartUs);
         J.attribute("dur", DurUs);
@@ -109,8 +165,8 @@ struct TimeTraceProfiler {
     }
 
     // Emit totals by section name as additional "thread" events, sorted from
-    // longest one.
-    int Tid = 1;
+    // longest one. They are numbered after the threads that recorded events.
+    int Tid = Stacks.size();
     std::vector<NameAndCountAndDurationType> SortedTotals;
     SortedTotals.reserve(CountAndTotalPerName.size());
     for (const auto &E : CountAndTotalPerName)
@@ -149,7 +205,7 @@ struct TimeTraceProfiler {
       J.attribute("ts", 0);
       J.attribute("ph", "M");
       J.attribute("name", "process_name");
-      J.attributeObject("args", [&] { J.attribute("name", "clang"); });
+      J.attributeObject("args", [&] { J.attribute("name", ProcName); });
     });
 
     J.arrayEnd();
@@ -157,16 +213,53 @@ struct TimeTraceProfiler {
     J.objectEnd();
   }
 
-  SmallVector<Entry, 16> Stack;
+  void writeSummary(raw_pwrite_stream &OS) {
+    std::lock_guard<std::mutex> Lock(Mu);
+    typedef std::pair<const std::pair<std::string, std::string>,
+                      SummaryEntry>
+        SummaryType;
+    std::vector<const SummaryType *> Sorted;
+    Sorted.reserve(Summaries.size());
+    for (const auto &S : Summaries)
+      Sorted.push_back(&S);
+    llvm::sort(Sorted.begin(), Sorted.end(),
+               [](const SummaryType *A, const SummaryType *B) {
+                 return A->second.Total > B->second.Total;
+               });
+
+    json::OStream J(OS);
+    J.objectBegin();
+    J.attributeBegin("summary");
+    J.arrayBegin();
+    for (const SummaryType *S : Sorted) {
+      J.object([&] {
+        J.attribute("name", S->first.first);
+        J.attribute("detail", S->first.second);
+        J.attribute("count", int64_t(S->second.Count));
+        J.attribute("total",
+                    duration_cast<microseconds>(S->second.Total).count());
+        J.attribute("self",
+                    duration_cast<microseconds>(S->second.Self).count());
+      });
+    }
+    J.arrayEnd();
+    J.attributeEnd();
+    J.objectEnd();
+  }
+
+  std::mutex Mu;
+  std::map<uint64_t, ThreadStack> Stacks;
   SmallVector<Entry, 128> Entries;
   StringMap<CountAndDurationType> CountAndTotalPerName;
+  std::map<std::pair<std::string, std::string>, SummaryEntry> Summaries;
   time_point<steady_clock> StartTime;
+  std::string ProcName;
 };
 
-void timeTraceProfilerInitialize() {
+void timeTraceProfilerInitialize(StringRef ProcName) {
   assert(TimeTraceProfilerInstance == nullptr &&
          "Profiler should not be initialized");
-  TimeTraceProfilerInstance = new TimeTraceProfiler();
+  TimeTraceProfilerInstance = new TimeTraceProfiler(ProcName);
 }
 
 void timeTraceProfilerCleanup() {
@@ -180,6 +273,12 @@ void timeTraceProfilerWrite(raw_pwrite_stream &OS) {
   TimeTraceProfilerInstance->Write(OS);
 }
 
+void timeTraceProfilerWriteSummary(raw_pwrite_stream &OS) {
+  assert(TimeTraceProfilerInstance != nullptr &&
+         "Profiler object can't be null");
+  TimeTraceProfilerInstance->writeSummary(OS);
+}
+
 void timeTraceProfilerBegin(StringRef Name, StringRef Detail) {
   if (TimeTraceProfilerInstance != nullptr)
     TimeTraceProfilerInstance->begin(Name, [&]() { return Detail; });
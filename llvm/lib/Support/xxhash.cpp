@@ -33,14 +33,25 @@
 */
 
 /* based on revision d2df04efcbef7d7f6886d345861e5dfda4edacc1 Removed
- * everything but a simple interface for computing XXh64. */
+ * everything but a simple interface for computing XXh64.
+ *
+ * XXH3 follows the algorithm of xxHash 0.8, restricted to the default secret
+ * and a zero seed. */
 
 #include "llvm/Support/xxhash.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Endian.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
 using namespace llvm;
 using namespace support;
 
@@ -136,3 +147,471 @@ uint64_t llvm::xxHash64(StringRef Data) {
 uint64_t llvm::xxHash64(ArrayRef<uint8_t> Data) {
   return xxHash64({(const char *)Data.data(), Data.size()});
 }
+
+// XXH3 constants. PRIME64_1..5 are shared with XXH64.
+static const uint32_t PRIME32_1 = 0x9E3779B1U;
+static const uint32_t PRIME32_2 = 0x85EBCA77U;
+static const uint32_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+// The default secret.
+static const uint8_t Secret[192] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c,
+    0xf7, 0x21, 0xad, 0x1c, 0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb,
+    0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f, 0xcb, 0x79, 0xe6, 0x4e,
+    0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6,
+    0x81, 0x3a, 0x26, 0x4c, 0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb,
+    0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3, 0x71, 0x64, 0x48, 0x97,
+    0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7,
+    0xc7, 0x0b, 0x4f, 0x1d, 0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31,
+    0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64, 0xea, 0xc5, 0xac, 0x83,
+    0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26,
+    0x29, 0xd4, 0x68, 0x9e, 0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc,
+    0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce, 0x45, 0xcb, 0x3a, 0x8f,
+    0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const size_t SECRET_SIZE = sizeof(Secret);
+static const size_t STRIPE_LEN = 64;
+static const size_t SECRET_CONSUME_RATE = 8;
+static const size_t ACC_NB = STRIPE_LEN / sizeof(uint64_t);
+static const size_t MIDSIZE_MAX = 240;
+static const size_t MIDSIZE_STARTOFFSET = 3;
+static const size_t MIDSIZE_LASTOFFSET = 17;
+static const size_t SECRET_MERGEACCS_START = 11;
+static const size_t SECRET_LASTACC_START = 7;
+static const size_t SECRET_SIZE_MIN = 136;
+
+namespace {
+struct Uint128 {
+  uint64_t Low;
+  uint64_t High;
+};
+} // namespace
+
+static uint64_t rotl32(uint32_t X, size_t R) {
+  return (X << R) | (X >> (32 - R));
+}
+
+static Uint128 mult64to128(uint64_t Lhs, uint64_t Rhs) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t Product = (__uint128_t)Lhs * Rhs;
+  return {(uint64_t)Product, (uint64_t)(Product >> 64)};
+#else
+  uint64_t LoLo = (Lhs & 0xFFFFFFFF) * (Rhs & 0xFFFFFFFF);
+  uint64_t HiLo = (Lhs >> 32) * (Rhs & 0xFFFFFFFF);
+  uint64_t LoHi = (Lhs & 0xFFFFFFFF) * (Rhs >> 32);
+  uint64_t HiHi = (Lhs >> 32) * (Rhs >> 32);
+  uint64_t Cross = (LoLo >> 32) + (HiLo & 0xFFFFFFFF) + LoHi;
+  uint64_t Upper = (HiLo >> 32) + (Cross >> 32) + HiHi;
+  uint64_t Lower = (Cross << 32) | (LoLo & 0xFFFFFFFF);
+  return {Lower, Upper};
+#endif
+}
+
+static uint64_t mul128Fold64(uint64_t Lhs, uint64_t Rhs) {
+  Uint128 Product = mult64to128(Lhs, Rhs);
+  return Product.Low ^ Product.High;
+}
+
+static uint64_t XXH64Avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 33;
+  Hash *= PRIME64_2;
+  Hash ^= Hash >> 29;
+  Hash *= PRIME64_3;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+static uint64_t XXH3Avalanche(uint64_t Hash) {
+  Hash ^= Hash >> 37;
+  Hash *= PRIME_MX1;
+  Hash ^= Hash >> 32;
+  return Hash;
+}
+
+static uint64_t rrmxmx(uint64_t H64, uint64_t Len) {
+  H64 ^= rotl64(H64, 49) ^ rotl64(H64, 24);
+  H64 *= PRIME_MX2;
+  H64 ^= (H64 >> 35) + Len;
+  H64 *= PRIME_MX2;
+  H64 ^= H64 >> 28;
+  return H64;
+}
+
+static uint64_t mix16B(const uint8_t *Input, const uint8_t *Sec,
+                       uint64_t Seed) {
+  uint64_t Lhs = endian::read64le(Input) ^ (endian::read64le(Sec) + Seed);
+  uint64_t Rhs =
+      endian::read64le(Input + 8) ^ (endian::read64le(Sec + 8) - Seed);
+  return mul128Fold64(Lhs, Rhs);
+}
+
+static Uint128 mix32B(Uint128 Acc, const uint8_t *Input1,
+                      const uint8_t *Input2, const uint8_t *Sec,
+                      uint64_t Seed) {
+  Acc.Low += mix16B(Input1, Sec, Seed);
+  Acc.Low ^= endian::read64le(Input2) + endian::read64le(Input2 + 8);
+  Acc.High += mix16B(Input2, Sec + 16, Seed);
+  Acc.High ^= endian::read64le(Input1) + endian::read64le(Input1 + 8);
+  return Acc;
+}
+
+// Process one 64-byte stripe. This is where long inputs spend their time, so
+// it has vector implementations.
+static void accumulate512(uint64_t *Acc,
+                          const uint8_t *Input,
+                          const uint8_t *Sec) {
+#if defined(__AVX2__)
+  __m256i *XAcc = reinterpret_cast<__m256i *>(Acc);
+  for (size_t I = 0; I < STRIPE_LEN / sizeof(__m256i); ++I) {
+    __m256i DataVec = _mm256_loadu_si256((const __m256i *)Input + I);
+    __m256i KeyVec = _mm256_loadu_si256((const __m256i *)Sec + I);
+    __m256i DataKey = _mm256_xor_si256(DataVec, KeyVec);
+    __m256i DataKeyLo = _mm256_srli_epi64(DataKey, 32);
+    __m256i Product = _mm256_mul_epu32(DataKey, DataKeyLo);
+    __m256i DataSwap = _mm256_shuffle_epi32(DataVec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m256i Sum = _mm256_add_epi64(XAcc[I], DataSwap);
+    XAcc[I] = _mm256_add_epi64(Product, Sum);
+  }
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  __m128i *XAcc = reinterpret_cast<__m128i *>(Acc);
+  for (size_t I = 0; I < STRIPE_LEN / sizeof(__m128i); ++I) {
+    __m128i DataVec = _mm_loadu_si128((const __m128i *)Input + I);
+    __m128i KeyVec = _mm_loadu_si128((const __m128i *)Sec + I);
+    __m128i DataKey = _mm_xor_si128(DataVec, KeyVec);
+    __m128i DataKeyLo = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i Product = _mm_mul_epu32(DataKey, DataKeyLo);
+    __m128i DataSwap = _mm_shuffle_epi32(DataVec, _MM_SHUFFLE(1, 0, 3, 2));
+    __m128i Sum = _mm_add_epi64(XAcc[I], DataSwap);
+    XAcc[I] = _mm_add_epi64(Product, Sum);
+  }
+#else
+  for (size_t I = 0; I < ACC_NB; ++I) {
+    uint64_t DataVal = endian::read64le(Input + 8 * I);
+    uint64_t DataKey = DataVal ^ endian::read64le(Sec + 8 * I);
+    Acc[I ^ 1] += DataVal;
+    Acc[I] += (uint32_t)DataKey * (DataKey >> 32);
+  }
+#endif
+}
+
+static void scrambleAcc(uint64_t *Acc,
+                        const uint8_t *Sec) {
+#if defined(__AVX2__)
+  __m256i *XAcc = reinterpret_cast<__m256i *>(Acc);
+  const __m256i Prime32 = _mm256_set1_epi32((int)PRIME32_1);
+  for (size_t I = 0; I < STRIPE_LEN / sizeof(__m256i); ++I) {
+    __m256i AccVec = XAcc[I];
+    __m256i DataVec = _mm256_xor_si256(AccVec, _mm256_srli_epi64(AccVec, 47));
+    __m256i KeyVec = _mm256_loadu_si256((const __m256i *)Sec + I);
+    __m256i DataKey = _mm256_xor_si256(DataVec, KeyVec);
+    __m256i DataKeyHi = _mm256_srli_epi64(DataKey, 32);
+    __m256i ProdLo = _mm256_mul_epu32(DataKey, Prime32);
+    __m256i ProdHi = _mm256_mul_epu32(DataKeyHi, Prime32);
+    XAcc[I] = _mm256_add_epi64(ProdLo, _mm256_slli_epi64(ProdHi, 32));
+  }
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  __m128i *XAcc = reinterpret_cast<__m128i *>(Acc);
+  const __m128i Prime32 = _mm_set1_epi32((int)PRIME32_1);
+  for (size_t I = 0; I < STRIPE_LEN / sizeof(__m128i); ++I) {
+    __m128i AccVec = XAcc[I];
+    __m128i DataVec = _mm_xor_si128(AccVec, _mm_srli_epi64(AccVec, 47));
+    __m128i KeyVec = _mm_loadu_si128((const __m128i *)Sec + I);
+    __m128i DataKey = _mm_xor_si128(DataVec, KeyVec);
+    __m128i DataKeyHi = _mm_shuffle_epi32(DataKey, _MM_SHUFFLE(0, 3, 0, 1));
+    __m128i ProdLo = _mm_mul_epu32(DataKey, Prime32);
+    __m128i ProdHi = _mm_mul_epu32(DataKeyHi, Prime32);
+    XAcc[I] = _mm_add_epi64(ProdLo, _mm_slli_epi64(ProdHi, 32));
+  }
+#else
+  for (size_t I = 0; I < ACC_NB; ++I) {
+    uint64_t Acc64 = Acc[I];
+    Acc64 ^= Acc64 >> 47;
+    Acc64 ^= endian::read64le(Sec + 8 * I);
+    Acc64 *= PRIME32_1;
+    Acc[I] = Acc64;
+  }
+#endif
+}
+
+// Run the stripes of an input longer than MIDSIZE_MAX through Acc.
+static void hashLongInternalLoop(uint64_t *Acc,
+                                 const uint8_t *Input,
+                                 size_t Len) {
+  const size_t NbStripesPerBlock =
+      (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+  const size_t BlockLen = STRIPE_LEN * NbStripesPerBlock;
+  const size_t NbBlocks = (Len - 1) / BlockLen;
+
+  for (size_t N = 0; N < NbBlocks; ++N) {
+    for (size_t S = 0; S < NbStripesPerBlock; ++S)
+      accumulate512(Acc, Input + N * BlockLen + S * STRIPE_LEN,
+                    Secret + S * SECRET_CONSUME_RATE);
+    scrambleAcc(Acc, Secret + SECRET_SIZE - STRIPE_LEN);
+  }
+
+  // The last partial block, then the last stripe which may overlap it.
+  const size_t NbStripes = ((Len - 1) - BlockLen * NbBlocks) / STRIPE_LEN;
+  for (size_t S = 0; S < NbStripes; ++S)
+    accumulate512(Acc, Input + NbBlocks * BlockLen + S * STRIPE_LEN,
+                  Secret + S * SECRET_CONSUME_RATE);
+  accumulate512(Acc, Input + Len - STRIPE_LEN,
+                Secret + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC_START);
+}
+
+static uint64_t mergeAccs(const uint64_t *Acc, const uint8_t *Sec,
+                          uint64_t Start) {
+  uint64_t Result64 = Start;
+  for (size_t I = 0; I < 4; ++I)
+    Result64 +=
+        mul128Fold64(Acc[2 * I] ^ endian::read64le(Sec + 16 * I),
+                     Acc[2 * I + 1] ^ endian::read64le(Sec + 16 * I + 8));
+  return XXH3Avalanche(Result64);
+}
+
+// The accumulators of the long input loop, aligned for the vector code.
+namespace {
+struct alignas(32) Accumulators {
+  uint64_t Acc[ACC_NB] = {PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+                          PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1};
+};
+} // namespace
+
+static uint64_t XXH3_len_1to3_64b(const uint8_t *Input, size_t Len) {
+  uint8_t C1 = Input[0];
+  uint8_t C2 = Input[Len >> 1];
+  uint8_t C3 = Input[Len - 1];
+  uint32_t Combined = ((uint32_t)C1 << 16) | ((uint32_t)C2 << 24) |
+                      ((uint32_t)C3 << 0) | ((uint32_t)Len << 8);
+  uint64_t Bitflip =
+      (uint64_t)(endian::read32le(Secret) ^ endian::read32le(Secret + 4));
+  return XXH64Avalanche((uint64_t)Combined ^ Bitflip);
+}
+
+static uint64_t XXH3_len_4to8_64b(const uint8_t *Input, size_t Len) {
+  uint32_t Input1 = endian::read32le(Input);
+  uint32_t Input2 = endian::read32le(Input + Len - 4);
+  uint64_t Bitflip =
+      endian::read64le(Secret + 8) ^ endian::read64le(Secret + 16);
+  uint64_t Input64 = Input2 + ((uint64_t)Input1 << 32);
+  return rrmxmx(Input64 ^ Bitflip, Len);
+}
+
+static uint64_t XXH3_len_9to16_64b(const uint8_t *Input, size_t Len) {
+  uint64_t Bitflip1 =
+      endian::read64le(Secret + 24) ^ endian::read64le(Secret + 32);
+  uint64_t Bitflip2 =
+      endian::read64le(Secret + 40) ^ endian::read64le(Secret + 48);
+  uint64_t InputLo = endian::read64le(Input) ^ Bitflip1;
+  uint64_t InputHi = endian::read64le(Input + Len - 8) ^ Bitflip2;
+  uint64_t Acc = Len + sys::SwapByteOrder_64(InputLo) + InputHi +
+                 mul128Fold64(InputLo, InputHi);
+  return XXH3Avalanche(Acc);
+}
+
+static uint64_t XXH3_len_17to128_64b(const uint8_t *Input, size_t Len) {
+  uint64_t Acc = Len * PRIME64_1;
+  if (Len > 32) {
+    if (Len > 64) {
+      if (Len > 96) {
+        Acc += mix16B(Input + 48, Secret + 96, 0);
+        Acc += mix16B(Input + Len - 64, Secret + 112, 0);
+      }
+      Acc += mix16B(Input + 32, Secret + 64, 0);
+      Acc += mix16B(Input + Len - 48, Secret + 80, 0);
+    }
+    Acc += mix16B(Input + 16, Secret + 32, 0);
+    Acc += mix16B(Input + Len - 32, Secret + 48, 0);
+  }
+  Acc += mix16B(Input, Secret, 0);
+  Acc += mix16B(Input + Len - 16, Secret + 16, 0);
+  return XXH3Avalanche(Acc);
+}
+
+static uint64_t XXH3_len_129to240_64b(const uint8_t *Input, size_t Len) {
+  const unsigned NbRounds = Len / 16;
+  uint64_t Acc = Len * PRIME64_1;
+  for (unsigned I = 0; I < 8; ++I)
+    Acc += mix16B(Input + 16 * I, Secret + 16 * I, 0);
+  Acc = XXH3Avalanche(Acc);
+  for (unsigned I = 8; I < NbRounds; ++I)
+    Acc += mix16B(Input + 16 * I,
+                  Secret + 16 * (I - 8) + MIDSIZE_STARTOFFSET, 0);
+  // Last bytes
+  Acc += mix16B(Input + Len - 16,
+                Secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET, 0);
+  return XXH3Avalanche(Acc);
+}
+
+uint64_t llvm::xxh3_64bits(ArrayRef<uint8_t> Data) {
+  const uint8_t *In = Data.data();
+  size_t Len = Data.size();
+  if (Len <= 16) {
+    if (Len > 8)
+      return XXH3_len_9to16_64b(In, Len);
+    if (Len >= 4)
+      return XXH3_len_4to8_64b(In, Len);
+    if (Len)
+      return XXH3_len_1to3_64b(In, Len);
+    return XXH64Avalanche(endian::read64le(Secret + 56) ^
+                          endian::read64le(Secret + 64));
+  }
+  if (Len <= 128)
+    return XXH3_len_17to128_64b(In, Len);
+  if (Len <= MIDSIZE_MAX)
+    return XXH3_len_129to240_64b(In, Len);
+
+  Accumulators A;
+  hashLongInternalLoop(A.Acc, In, Len);
+  return mergeAccs(A.Acc, Secret + SECRET_MERGEACCS_START,
+                   (uint64_t)Len * PRIME64_1);
+}
+
+uint64_t llvm::xxh3_64bits(StringRef Data) {
+  return xxh3_64bits(makeArrayRef(Data.bytes_begin(), Data.size()));
+}
+
+static XXH128_hash_t XXH3_len_1to3_128b(const uint8_t *Input, size_t Len) {
+  uint8_t C1 = Input[0];
+  uint8_t C2 = Input[Len >> 1];
+  uint8_t C3 = Input[Len - 1];
+  uint32_t CombinedL = ((uint32_t)C1 << 16) | ((uint32_t)C2 << 24) |
+                       ((uint32_t)C3 << 0) | ((uint32_t)Len << 8);
+  uint32_t CombinedH = rotl32(sys::SwapByteOrder_32(CombinedL), 13);
+  uint64_t BitflipL =
+      (uint64_t)(endian::read32le(Secret) ^ endian::read32le(Secret + 4));
+  uint64_t BitflipH =
+      (uint64_t)(endian::read32le(Secret + 8) ^ endian::read32le(Secret + 12));
+  XXH128_hash_t H128;
+  H128.low64 = XXH64Avalanche((uint64_t)CombinedL ^ BitflipL);
+  H128.high64 = XXH64Avalanche((uint64_t)CombinedH ^ BitflipH);
+  return H128;
+}
+
+static XXH128_hash_t XXH3_len_4to8_128b(const uint8_t *Input, size_t Len) {
+  uint32_t InputLo = endian::read32le(Input);
+  uint32_t InputHi = endian::read32le(Input + Len - 4);
+  uint64_t Input64 = InputLo + ((uint64_t)InputHi << 32);
+  uint64_t Bitflip =
+      endian::read64le(Secret + 16) ^ endian::read64le(Secret + 24);
+  uint64_t Keyed = Input64 ^ Bitflip;
+
+  // Shift Len to the left to ensure it is even, this avoids even multiplies.
+  Uint128 M128 = mult64to128(Keyed, PRIME64_1 + (Len << 2));
+  M128.High += (M128.Low << 1);
+  M128.Low ^= (M128.High >> 3);
+  M128.Low ^= M128.Low >> 35;
+  M128.Low *= PRIME_MX2;
+  M128.Low ^= M128.Low >> 28;
+  XXH128_hash_t H128;
+  H128.low64 = M128.Low;
+  H128.high64 = XXH3Avalanche(M128.High);
+  return H128;
+}
+
+static XXH128_hash_t XXH3_len_9to16_128b(const uint8_t *Input, size_t Len) {
+  uint64_t BitflipL =
+      endian::read64le(Secret + 32) ^ endian::read64le(Secret + 40);
+  uint64_t BitflipH =
+      endian::read64le(Secret + 48) ^ endian::read64le(Secret + 56);
+  uint64_t InputLo = endian::read64le(Input);
+  uint64_t InputHi = endian::read64le(Input + Len - 8);
+  Uint128 M128 = mult64to128(InputLo ^ InputHi ^ BitflipL, PRIME64_1);
+  M128.Low += (uint64_t)(Len - 1) << 54;
+  InputHi ^= BitflipH;
+  M128.High += InputHi + (uint64_t)(uint32_t)InputHi * (PRIME32_2 - 1);
+  M128.Low ^= sys::SwapByteOrder_64(M128.High);
+
+  Uint128 H = mult64to128(M128.Low, PRIME64_2);
+  H.High += M128.High * PRIME64_2;
+  XXH128_hash_t H128;
+  H128.low64 = XXH3Avalanche(H.Low);
+  H128.high64 = XXH3Avalanche(H.High);
+  return H128;
+}
+
+// Shared by the 17-128 and 129-240 byte cases.
+static XXH128_hash_t XXH3_finalizeMid128b(Uint128 Acc, size_t Len) {
+  XXH128_hash_t H128;
+  H128.low64 = XXH3Avalanche(Acc.Low + Acc.High);
+  H128.high64 = 0 - XXH3Avalanche(Acc.Low * PRIME64_1 + Acc.High * PRIME64_4 +
+                                  (uint64_t)Len * PRIME64_2);
+  return H128;
+}
+
+static XXH128_hash_t XXH3_len_17to128_128b(const uint8_t *Input,
+                                           size_t Len) {
+  Uint128 Acc = {Len * PRIME64_1, 0};
+  if (Len > 32) {
+    if (Len > 64) {
+      if (Len > 96)
+        Acc = mix32B(Acc, Input + 48, Input + Len - 64, Secret + 96, 0);
+      Acc = mix32B(Acc, Input + 32, Input + Len - 48, Secret + 64, 0);
+    }
+    Acc = mix32B(Acc, Input + 16, Input + Len - 32, Secret + 32, 0);
+  }
+  Acc = mix32B(Acc, Input, Input + Len - 16, Secret, 0);
+  return XXH3_finalizeMid128b(Acc, Len);
+}
+
+static XXH128_hash_t XXH3_len_129to240_128b(const uint8_t *Input,
+                                            size_t Len) {
+  const unsigned NbRounds = Len / 32;
+  Uint128 Acc = {Len * PRIME64_1, 0};
+  for (unsigned I = 0; I < 4; ++I)
+    Acc = mix32B(Acc, Input + 32 * I, Input + 32 * I + 16, Secret + 32 * I,
+                 0);
+  Acc.Low = XXH3Avalanche(Acc.Low);
+  Acc.High = XXH3Avalanche(Acc.High);
+  for (unsigned I = 4; I < NbRounds; ++I)
+    Acc = mix32B(Acc, Input + 32 * I, Input + 32 * I + 16,
+                 Secret + MIDSIZE_STARTOFFSET + 32 * (I - 4), 0);
+  // Last bytes
+  Acc = mix32B(Acc, Input + Len - 16, Input + Len - 32,
+               Secret + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16, 0);
+  return XXH3_finalizeMid128b(Acc, Len);
+}
+
+XXH128_hash_t llvm::xxh3_128bits(ArrayRef<uint8_t> Data) {
+  const uint8_t *In = Data.data();
+  size_t Len = Data.size();
+  if (Len <= 16) {
+    if (Len > 8)
+      return XXH3_len_9to16_128b(In, Len);
+    if (Len >= 4)
+      return XXH3_len_4to8_128b(In, Len);
+    if (Len)
+      return XXH3_len_1to3_128b(In, Len);
+    XXH128_hash_t H128;
+    H128.low64 = XXH64Avalanche(endian::read64le(Secret + 64) ^
+                                endian::read64le(Secret + 72));
+    H128.high64 = XXH64Avalanche(endian::read64le(Secret + 80) ^
+                                 endian::read64le(Secret + 88));
+    return H128;
+  }
+  if (Len <= 128)
+    return XXH3_len_17to128_128b(In, Len);
+  if (Len <= MIDSIZE_MAX)
+    return XXH3_len_129to240_128b(In, Len);
+
+  Accumulators A;
+  hashLongInternalLoop(A.Acc, In, Len);
+  XXH128_hash_t H128;
+  H128.low64 = mergeAccs(A.Acc, Secret + SECRET_MERGEACCS_START,
+                         (uint64_t)Len * PRIME64_1);
+  H128.high64 = mergeAccs(
+      A.Acc, Secret + SECRET_SIZE - STRIPE_LEN - SECRET_MERGEACCS_START,
+      ~((uint64_t)Len * PRIME64_2));
+  return H128;
+}
+
+XXH128_hash_t llvm::xxh3_128bits(StringRef Data) {
+  return xxh3_128bits(makeArrayRef(Data.bytes_begin(), Data.size()));
+}
@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <system_error>
+#include <vector>
 using namespace llvm;
 
 static cl::opt<std::string>
@@ -59,16 +60,23 @@ static int reportError(const char *ProgName, Twine Msg) {
 ///
 /// This functionality is really only for the benefit of the build system.
 /// It is similar to GCC's `-M*` family of options.
-static int createDependencyFile(const TGParser &Parser, const char *argv0) {
-  if (OutputFilename == "-")
-    return reportError(argv0, "the option -d must be used together with -o\n");
+static int createDependencyFile(const TGParser &Parser,
+                                ArrayRef<TableGenJob> Jobs,
+                                const char *argv0) {
+  for (const auto &Job : Jobs)
+    if (Job.OutputFilename == "-")
+      return reportError(argv0,
+                         "the option -d must be used together with -o\n");
 
   std::error_code EC;
   ToolOutputFile DepOut(DependFilename, EC, sys::fs::F_Text);
   if (EC)
     return reportError(argv0, "error opening " + DependFilename + ":" +
                                   EC.message() + "\n");
-  DepOut.os() << OutputFilename << ":";
+  DepOut.os() << Jobs.front().OutputFilename;
+  for (const auto &Job : Jobs.drop_front())
+    DepOut.os() << ' ' << Job.OutputFilename;
+  DepOut.os() << ":";
   for (const auto &Dep : Parser.getDependencies()) {
     DepOut.os() << ' ' << Dep.first;
   }
@@ -77,7 +85,38 @@ static int createDependencyFile(const TGParser &Parser, const char *argv0) {
   return 0;
 }
 
+/// Write Contents to Filename, unless the file already holds them.
+static int writeOutputFile(StringRef Filename, StringRef Contents,
+                           const char *argv0) {
+  // Only updates the real output file if there are any differences.
+  // This prevents recompilation of all the files depending on it if there
+  // aren't any.
+  if (auto ExistingOrErr = MemoryBuffer::getFile(Filename))
+    if (std::move(ExistingOrErr.get())->getBuffer() == Contents)
+      return 0;
+
+  std::error_code EC;
+  ToolOutputFile OutFile(Filename, EC, sys::fs::F_Text);
+  if (EC)
+    return reportError(argv0, "error opening " + Filename + ":" +
+                                  EC.message() + "\n");
+  OutFile.os() << Contents;
+
+  if (ErrorsPrinted > 0)
+    return reportError(argv0, Twine(ErrorsPrinted) + " errors.\n");
+
+  // Declare success.
+  OutFile.keep();
+  return 0;
+}
+
 int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
+  TableGenJob Job = {OutputFilename, MainFn};
+  return TableGenMain(argv0, Job);
+}
+
+int llvm::TableGenMain(char *argv0, ArrayRef<TableGenJob> Jobs) {
+  assert(!Jobs.empty() && "No backend to run");
   RecordKeeper Records;
 
   // Parse the input file.
@@ -99,39 +138,27 @@ int llvm::TableGenMain(char *argv0, TableGenMainFn *MainFn) {
   if (Parser.ParseFile())
     return 1;
 
-  // Write output to memory.
-  std::string OutString;
-  raw_string_ostream Out(OutString);
-  if (MainFn(Out, Records))
-    return 1;
+  // Write output to memory. Run every backend before touching any output, so
+  // that a failing backend does not leave a partially updated set of files.
+  std::vector<std::string> Outputs(Jobs.size());
+  for (size_t I = 0, E = Jobs.size(); I != E; ++I) {
+    raw_string_ostream Out(Outputs[I]);
+    if (Jobs[I].MainFn(Out, Records))
+      return 1;
+    Out.flush();
+  }
 
   // Always write the depfile, even if the main output hasn't changed.
   // If it's missing, Ninja considers the output dirty.  If this was below
   // the early exit below and someone deleted the .inc.d file but not the .inc
   // file, tablegen would never write the depfile.
   if (!DependFilename.empty()) {
-    if (int Ret = createDependencyFile(Parser, argv0))
+    if (int Ret = createDependencyFile(Parser, Jobs, argv0))
       return Ret;
   }
 
-  // Only updates the real output file if there are any differences.
-  // This prevents recompilation of all the files depending on it if there
-  // aren't any.
-  if (auto ExistingOrErr = MemoryBuffer::getFile(OutputFilename))
-    if (std::move(ExistingOrErr.get())->getBuffer() == Out.str())
-      return 0;
-
-  std::error_code EC;
-  ToolOutputFile OutFile(OutputFilename, EC, sys::fs::F_Text);
-  if (EC)
-    return reportError(argv0, "error opening " + OutputFilename + ":" +
-                                  EC.message() + "\n");
-  OutFile.os() << Out.str();
-
-  if (ErrorsPrinted > 0)
-    return reportError(argv0, Twine(ErrorsPrinted) + " errors.\n");
-
-  // Declare success.
-  OutFile.keep();
+  for (size_t I = 0, E = Jobs.size(); I != E; ++I)
+    if (int Ret = writeOutputFile(Jobs[I].OutputFilename, Outputs[I], argv0))
+      return Ret;
   return 0;
 }
@@ -43,6 +43,11 @@ using namespace llvm;
 
 static BumpPtrAllocator Allocator;
 
+// Large targets create hundreds of thousands of bits, list and dag inits.
+// Their pools start out big, so that filling them does not repeatedly rehash
+// (and thus re-profile) every node.
+static const unsigned LargeInitPoolLog2Size = 16;
+
 STATISTIC(CodeInitsConstructed,
           "The total number of unique CodeInits constructed");
 
@@ -340,7 +345,7 @@ ProfileBitsInit(FoldingSetNodeID &ID, ArrayRef<Init *> Range) {
 }
 
 BitsInit *BitsInit::get(ArrayRef<Init *> Range) {
-  static FoldingSet<BitsInit> ThePool;
+  static FoldingSet<BitsInit> ThePool(LargeInitPoolLog2Size);
 
   FoldingSetNodeID ID;
   ProfileBitsInit(ID, Range);
@@ -458,9 +463,14 @@ Init *BitsInit::resolveReferences(Resolver &R) const {
 }
 
 IntInit *IntInit::get(int64_t V) {
-  static std::map<int64_t, IntInit*> ThePool;
-
-  IntInit *&I = ThePool[V];
+  static DenseMap<int64_t, IntInit*> ThePool;
+  // The two values DenseMap reserves for itself are kept separately.
+  static std::map<int64_t, IntInit*> ReservedPool;
+
+  using KeyInfo = DenseMapInfo<int64_t>;
+  bool IsReserved =
+      V == KeyInfo::getEmptyKey() || V == KeyInfo::getTombstoneKey();
+  IntInit *&I = IsReserved ? ReservedPool[V] : ThePool[V];
   if (!I) I = new(Allocator) IntInit(V);
   return I;
 }
@@ -568,7 +578,7 @@ static void ProfileListInit(FoldingSetNodeID &ID,
 }
 
 ListInit *ListInit::get(ArrayRef<Init *> Range, RecTy *EltTy) {
-  static FoldingSet<ListInit> ThePool;
+  static FoldingSet<ListInit> ThePool(LargeInitPoolLog2Size);
 
   FoldingSetNodeID ID;
   ProfileListInit(ID, Range, EltTy);
@@ -1893,7 +1903,7 @@ static void ProfileDagInit(FoldingSetNodeID &ID, Init *V, StringInit *VN,
 DagInit *
 DagInit::get(Init *V, StringInit *VN, ArrayRef<Init *> ArgRange,
              ArrayRef<StringInit *> NameRange) {
-  static FoldingSet<DagInit> ThePool;
+  static FoldingSet<DagInit> ThePool(LargeInitPoolLog2Size);
 
   FoldingSetNodeID ID;
   ProfileDagInit(ID, V, VN, ArgRange, NameRange);
@@ -105,6 +105,8 @@ private:
                      MachineFunction &MF) const;
   bool selectCondBranch(MachineInstr &I, MachineRegisterInfo &MRI,
                         MachineFunction &MF) const;
+  bool selectSelect(MachineInstr &I, MachineRegisterInfo &MRI,
+                    MachineFunction &MF) const;
   bool selectTurnIntoCOPY(MachineInstr &I, MachineRegisterInfo &MRI,
                           const unsigned DstReg,
                           const TargetRegisterClass *DstRC,
@@ -380,6 +382,8 @@ bool X86InstructionSelector::select(MachineInstr &I,
     return selectInsert(I, MRI, MF);
   case TargetOpcode::G_BRCOND:
     return selectCondBranch(I, MRI, MF);
+  case TargetOpcode::G_SELECT:
+    return selectSelect(I, MRI, MF);
   case TargetOpcode::G_IMPLICIT_DEF:
   case TargetOpcode::G_PHI:
     return selectImplicitDefOrPHI(I, MRI);
@@ -1431,6 +1435,53 @@ bool X86InstructionSelector::selectCondBranch(MachineInstr &I,
   return true;
 }
 
+bool X86InstructionSelector::selectSelect(MachineInstr &I,
+                                          MachineRegisterInfo &MRI,
+                                          MachineFunction &MF) const {
+  assert((I.getOpcode() == TargetOpcode::G_SELECT) && "unexpected instruction");
+
+  const unsigned DstReg = I.getOperand(0).getReg();
+  const unsigned CondReg = I.getOperand(1).getReg();
+  const unsigned TrueReg = I.getOperand(2).getReg();
+  const unsigned FalseReg = I.getOperand(3).getReg();
+  const LLT Ty = MRI.getType(DstReg);
+
+  if (RBI.getRegBank(DstReg, MRI, TRI)->getID() != X86::GPRRegBankID)
+    return false;
+
+  unsigned OpCmov;
+  switch (Ty.getSizeInBits()) {
+  case 16:
+    OpCmov = X86::CMOV16rr;
+    break;
+  case 32:
+    OpCmov = X86::CMOV32rr;
+    break;
+  case 64:
+    OpCmov = X86::CMOV64rr;
+    break;
+  default:
+    return false;
+  }
+
+  MachineInstr &TestInst =
+      *BuildMI(*I.getParent(), I, I.getDebugLoc(), TII.get(X86::TEST8ri))
+           .addReg(CondReg)
+           .addImm(1);
+  // CMOV keeps its first source unless the condition holds.
+  MachineInstr &CmovInst =
+      *BuildMI(*I.getParent(), I, I.getDebugLoc(), TII.get(OpCmov), DstReg)
+           .addReg(FalseReg)
+           .addReg(TrueReg)
+           .addImm(X86::COND_NE);
+
+  constrainSelectedInstRegOperands(TestInst, TII, TRI, RBI);
+  constrainSelectedInstRegOperands(CmovInst, TII, TRI, RBI);
+
+  I.eraseFromParent();
+  return true;
+}
+
 bool X86InstructionSelector::materializeFP(MachineInstr &I,
                                            MachineRegisterInfo &MRI,
                                            MachineFunction &MF) const {
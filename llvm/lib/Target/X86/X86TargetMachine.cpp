@@ -60,6 +60,12 @@ static cl::opt<bool> EnableCondBrFoldingPass("x86-condbr-folding",
                                         "folding pass"),
                                cl::init(false), cl::Hidden);
 
+static cl::opt<bool> EnableMachineFunctionSplitter(
+    "x86-split-machine-functions",
+    cl::desc("Move the cold blocks of functions with a profile to a cold "
+             "section"),
+    cl::init(false), cl::Hidden);
+
 extern "C" void LLVMInitializeX86Target() {
   // Register the target.
   RegisterTargetMachine<X86TargetMachine> X(getTheX86_32Target());
@@ -497,6 +503,10 @@ void X86PassConfig::addPreSched2() { addPass(createX86ExpandPseudoPass()); }
 
 void X86PassConfig::addPreEmitPass() {
   if (getOptLevel() != CodeGenOpt::None) {
+    // The layout is final, split off the cold part of the functions.
+    if (EnableMachineFunctionSplitter &&
+        TM->getTargetTriple().isOSBinFormatELF())
+      addPass(createMachineFunctionSplitterPass());
     addPass(new X86ExecutionDomainFix());
     addPass(createBreakFalseDeps());
   }
@@ -2,14 +2,34 @@
 //
 //
 //===----------------------------------------------------------------------===//
+#include <map>
+#include <set>
+
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/ADT/Statistic.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Analysis/LoopInfo.h"
 #include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Analysis/ValueTracking.h"
+
+/*
+ * Glob2Const serves small read-only array arguments of a kernel from
+ * constant memory. For a kernel K with such arguments it adds the kernel
+ * K__const, which reads argument i from the constant symbol K__const_arg<i>,
+ * and the constant array K__const_args listing the i. libomptarget copies
+ * the arrays into the symbols and launches K__const when no other argument
+ * points into them.
+ * OMP_CONST_ARG_SIZE=N promotes arguments read in the first N bytes
+ * (default 4096)
+ */
 
 using namespace llvm;
 using namespace std;
@@ -22,128 +42,300 @@ using namespace std;
 
 #define DEBUG_TYPE "hello"
 
+#define ConstAddressSpace 4
 
 namespace {
   struct Glob2Const : public ModulePass {
     static char ID; // Pass identification, replacement for typeid
-    unsigned int ParamID = 1;
-    int ConstMemSize = 1024;
-    //string KernelName = "_Z7kernel2PiS_";
-    string KernelName = "_Z7kernel2PiS_";
-    GlobalVariable *ConstArray;
+    // Bytes of constant memory one argument, and all of them, may take
+    uint64_t MaxArgSize = 4096;
+    uint64_t MaxTotalSize = 32768;
+    uint64_t TotalSize;
 
     Glob2Const() : ModulePass(ID) {}
 
-    bool runOnFunction(Function &F) {
-      vector<Instruction*> InstsToDelete;
-      if (!F.getName().equals(KernelName)) {
-        return false;
+    // Warp uniform as far as the constant cache cares: no thread index or
+    // memory read in the computation. Constant data is right either way.
+    bool isUniform(Value *V, set<Value *> &Visited) {
+      if (isa<Constant>(V) || isa<Argument>(V) ||
+          !Visited.insert(V).second) {
+        return true;
+      }
+      if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(V)) {
+        StringRef Name = II->getCalledFunction()->getName();
+        return Name.startswith("llvm.nvvm.read.ptx.sreg.ctaid.") ||
+            Name.startswith("llvm.nvvm.read.ptx.sreg.nctaid.") ||
+            Name.startswith("llvm.nvvm.read.ptx.sreg.ntid.");
       }
-      if (!ConstArray) {
-        errs() << "No symbol\n";
+      Instruction *I = dyn_cast<Instruction>(V);
+      if (!I || !(isa<BinaryOperator>(I) || isa<CastInst>(I) ||
+            isa<CmpInst>(I) || isa<SelectInst>(I) || isa<PHINode>(I) ||
+            isa<GetElementPtrInst>(I))) {
         return false;
       }
-      bool ret = false;
-      DB(F.dump();)
+      for (Value *Op : I->operand_values()) {
+        if (!isUniform(Op, Visited)) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    bool isUniformSCEV(const SCEV *S) {
+      struct UnknownCollector {
+        vector<Value *> Values;
+        bool follow(const SCEV *S) {
+          if (const SCEVUnknown *U = dyn_cast<SCEVUnknown>(S)) {
+            Values.push_back(U->getValue());
+          }
+          return true;
+        }
+        bool isDone() const { return false; }
+      } Collector;
+      visitAll(S, Collector);
+      set<Value *> Visited;
+      for (Value *V : Collector.Values) {
+        if (!isUniform(V, Visited)) {
+          return false;
+        }
+      }
+      return true;
+    }
 
-      // Check arg size
-      if (ParamID >= F.arg_size()) {
-        errs() << "Wrong param id\n";
+    // Other writes of F must not reach the memory of A. Writes through the
+    // other arguments are checked by libomptarget at launch, writes through
+    // loaded pointers or unknown calls cannot be.
+    bool mayWriteToArg(Function &F, Argument *A) {
+      if (A->hasNoAliasAttr()) {
         return false;
       }
-      Argument *array = (F.arg_begin() + ParamID);
-
-      for (auto &bb : F) {
-        for (auto &inst: bb) {
-          if (inst.getOpcode() == Instruction::GetElementPtr) {
-            GetElementPtrInst *gepi = dyn_cast<GetElementPtrInst>(&inst);
-            if (array == gepi->getPointerOperand()) {
-              DB(gepi->dump();)
-              vector<Value*> idxs;
-              idxs.push_back(ConstantInt::get(IntegerType::get(F.getContext(),64), 0));
-              for (auto &idx : gepi->indices ()) {
-                idxs.push_back(idx.get());
-              }
-
-              // Replace find all inst use the Value
-              GetElementPtrInst *gepiNew = GetElementPtrInst::CreateInBounds(ConstArray, idxs,"", gepi);
-              AddrSpaceCastInst *asci = new AddrSpaceCastInst(gepiNew, gepi->getType(), "", gepi);
-              // Remove from use list
-              gepi->replaceAllUsesWith(asci);
-              InstsToDelete.push_back(gepi);
-              ret = true;
+      const DataLayout &DL = F.getParent()->getDataLayout();
+      for (auto &BB : F) {
+        for (auto &I : BB) {
+          if (!I.mayWriteToMemory()) {
+            continue;
+          }
+          Value *Ptr = nullptr;
+          if (StoreInst *SI = dyn_cast<StoreInst>(&I)) {
+            Ptr = SI->getPointerOperand();
+          } else if (AtomicRMWInst *AI = dyn_cast<AtomicRMWInst>(&I)) {
+            Ptr = AI->getPointerOperand();
+          } else if (AtomicCmpXchgInst *AI = dyn_cast<AtomicCmpXchgInst>(&I)) {
+            Ptr = AI->getPointerOperand();
+          } else if (MemIntrinsic *MI = dyn_cast<MemIntrinsic>(&I)) {
+            Ptr = MI->getRawDest();
+          } else if (CallInst *CI = dyn_cast<CallInst>(&I)) {
+            Function *Callee = CI->getCalledFunction();
+            if (Callee && (Callee->getName().startswith("__kmpc_") ||
+                  Callee->getName().startswith("llvm.nvvm.") ||
+                  Callee->onlyReadsMemory() || isa<IntrinsicInst>(CI))) {
+              continue;
+            }
+            return true;
+          } else {
+            return true;
+          }
+          if (Ptr->getType()->getPointerAddressSpace() != 0) {
+            continue;
+          }
+          Value *Obj = GetUnderlyingObject(Ptr, DL);
+          if (Obj == A || !(isa<Argument>(Obj) || isa<AllocaInst>(Obj) ||
+                isa<GlobalVariable>(Obj))) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+    // A is only read, through GEPs and bitcasts, at uniform offsets below
+    // MaxArgSize. Extent is the end of the last byte read.
+    bool getReadExtent(Argument *A, ScalarEvolution &SE, uint64_t &Extent) {
+      const DataLayout &DL = A->getParent()->getParent()->getDataLayout();
+      const SCEV *Base = SE.getSCEV(A);
+      vector<Value *> Worklist(1, A);
+      Extent = 0;
+      while (!Worklist.empty()) {
+        Value *V = Worklist.back();
+        Worklist.pop_back();
+        for (const Use &U : V->uses()) {
+          User *Usr = U.getUser();
+          if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(Usr)) {
+            if (U.getOperandNo() != GEPI->getPointerOperandIndex()) {
+              return false;
             }
+            Worklist.push_back(GEPI);
+            continue;
+          }
+          if (isa<BitCastInst>(Usr)) {
+            Worklist.push_back(Usr);
+            continue;
+          }
+          LoadInst *LI = dyn_cast<LoadInst>(Usr);
+          if (!LI || !LI->isSimple()) {
+            return false;
+          }
+          const SCEV *Offset = SE.getMinusSCEV(SE.getSCEV(V), Base);
+          if (isa<SCEVCouldNotCompute>(Offset) || !isUniformSCEV(Offset)) {
+            return false;
+          }
+          ConstantRange Range = SE.getSignedRange(Offset);
+          if (Range.isFullSet() || Range.getSignedMin().isNegative() ||
+              Range.getSignedMax().uge(MaxArgSize)) {
+            return false;
           }
+          uint64_t End = Range.getSignedMax().getZExtValue() +
+              DL.getTypeStoreSize(LI->getType());
+          if (End > MaxArgSize) {
+            return false;
+          }
+          Extent = std::max(Extent, End);
         }
       }
+      return Extent > 0;
+    }
+
+    // Recreate the GEPs, bitcasts and loads of Old on New, in constant memory
+    void rewriteToConst(Value *Old, Value *New, vector<Instruction *> &Dead) {
+      vector<User *> Users(Old->user_begin(), Old->user_end());
+      for (User *U : Users) {
+        Instruction *I = cast<Instruction>(U);
+        IRBuilder<> B(I);
+        if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(I)) {
+          vector<Value *> Idxs(GEPI->idx_begin(), GEPI->idx_end());
+          Value *N = GEPI->isInBounds() ?
+              B.CreateInBoundsGEP(GEPI->getSourceElementType(), New, Idxs) :
+              B.CreateGEP(GEPI->getSourceElementType(), New, Idxs);
+          rewriteToConst(GEPI, N, Dead);
+        } else if (isa<BitCastInst>(I)) {
+          Type *ElemTy = I->getType()->getPointerElementType();
+          rewriteToConst(I, B.CreateBitCast(New,
+                PointerType::get(ElemTy, ConstAddressSpace)), Dead);
+        } else {
+          LoadInst *LI = cast<LoadInst>(I);
+          LoadInst *N = B.CreateAlignedLoad(LI->getType(), New,
+              LI->getAlignment(), LI->getName() + ".const");
+          N->copyMetadata(*LI);
+          LI->replaceAllUsesWith(N);
+        }
+        Dead.push_back(I);
+      }
+    }
+
+    // Kernel F__const reading the Args, index to size, from constant symbols
+    void promote(Function *F, map<unsigned, uint64_t> &Args) {
+      Module &M = *F->getParent();
+      LLVMContext &Ctx = M.getContext();
+      ValueToValueMapTy VMap;
+      Function *Clone = CloneFunction(F, VMap);
+      Clone->setName(F->getName() + "__const");
 
-      for (auto inst : InstsToDelete) {
-        inst->removeFromParent();
-        inst->dropAllReferences();
+      // Same annotations, the kernel one included
+      NamedMDNode *NVVM = M.getNamedMetadata("nvvm.annotations");
+      vector<MDNode *> CloneMDs;
+      for (MDNode *MD : NVVM->operands()) {
+        if (MD->getNumOperands() == 0 || !MD->getOperand(0)) {
+          continue;
+        }
+        auto *VAM = dyn_cast<ValueAsMetadata>(MD->getOperand(0).get());
+        if (!VAM || VAM->getValue() != F) {
+          continue;
+        }
+        SmallVector<Metadata *, 3> Ops(MD->op_begin(), MD->op_end());
+        Ops[0] = ValueAsMetadata::get(Clone);
+        CloneMDs.push_back(MDNode::get(Ctx, Ops));
+      }
+      for (MDNode *MD : CloneMDs) {
+        NVVM->addOperand(MD);
       }
-      DB(F.dump();)
-        if(ret) {
-          errs() << "Transformed kernel: " << KernelName << "\n";
 
+      vector<Constant *> Indices;
+      for (auto &E : Args) {
+        Argument *A = Clone->arg_begin() + E.first;
+        ArrayType *AT = ArrayType::get(Type::getInt8Ty(Ctx), E.second);
+        GlobalVariable *GV = new GlobalVariable(M, AT, false,
+            GlobalValue::ExternalLinkage, ConstantAggregateZero::get(AT),
+            F->getName() + "__const_arg" + Twine(E.first), nullptr,
+            GlobalVariable::NotThreadLocal, ConstAddressSpace);
+        GV->setAlignment(16);
+        Type *ElemTy = A->getType()->getPointerElementType();
+        Constant *Sym = ConstantExpr::getBitCast(GV,
+            PointerType::get(ElemTy, ConstAddressSpace));
+        vector<Instruction *> Dead;
+        rewriteToConst(A, Sym, Dead);
+        for (auto It = Dead.rbegin(); It != Dead.rend(); ++It) {
+          (*It)->eraseFromParent();
         }
+        Indices.push_back(ConstantInt::get(Type::getInt32Ty(Ctx), E.first));
+        errs() << "Glob2Const: argument " << E.first << " of "
+               << F->getName() << ", " << E.second << " bytes\n";
+      }
 
-      return ret;
+      ArrayType *IdxTy = ArrayType::get(Type::getInt32Ty(Ctx),
+          Indices.size());
+      new GlobalVariable(M, IdxTy, true, GlobalValue::ExternalLinkage,
+          ConstantArray::get(IdxTy, Indices), F->getName() + "__const_args",
+          nullptr, GlobalVariable::NotThreadLocal, ConstAddressSpace);
     }
 
-    // Insert Global symbol
     bool runOnModule(Module &M) override {
-      // TODO
-      //CallGraphWrapperPass &CP = getAnalysis<CallGraphWrapperPass>();
-      LoopInfoWrapperPass &LI = getAnalysis<LoopInfoWrapperPass> (*M.getFunction("main"));
-      LI.dump();
-      DominatorTreeWrapperPass &DT = getAnalysis<DominatorTreeWrapperPass> (*M.getFunction("main"));
-      DT.dump();
-      return false;
+      if (char *Env = getenv("OMP_CONST_ARG_SIZE")) {
+        MaxArgSize = std::max(atol(Env), 1L);
+      }
+      TotalSize = 0;
+      NamedMDNode *NVVM = M.getNamedMetadata("nvvm.annotations");
+      if (!NVVM) {
+        return false;
+      }
+      vector<Function *> Kernels;
+      for (MDNode *MD : NVVM->operands()) {
+        if (MD->getNumOperands() != 3 || !MD->getOperand(0) ||
+            !MD->getOperand(1)) {
+          continue;
+        }
+        auto *VAM = dyn_cast<ValueAsMetadata>(MD->getOperand(0).get());
+        auto *MDS = dyn_cast<MDString>(MD->getOperand(1).get());
+        if (VAM && MDS && MDS->getString() == "kernel") {
+          Function *F = dyn_cast<Function>(VAM->getValue());
+          if (F && !F->isDeclaration()) {
+            Kernels.push_back(F);
+          }
+        }
+      }
 
-      string SymbolName(KernelName); 
       bool ret = false;
-
-      // Avoid name conflict
-      while (M.getGlobalVariable(genName(SymbolName)));
-
-      // FIXME type is not ready
-      ArrayType *at = ArrayType::get(IntegerType::get(M.getContext(),32), ConstMemSize);
-      GlobalVariable *gv = new GlobalVariable(at, false, GlobalVariable::ExternalLinkage, ConstantAggregateZero::get(at), SymbolName, GlobalVariable::NotThreadLocal,4, true);
-      gv->setAlignment(4);
-      gv->setDSOLocal(true);
-      gv->setUnnamedAddr(GlobalValue::UnnamedAddr::Local);
-      ConstArray = gv;
-      for (auto &F : M.functions()) {
-        ret = ret || runOnFunction(F);
-      }
-      if (ret) {
-        M.getGlobalList().push_back(gv); 
+      for (Function *F : Kernels) {
+        ScalarEvolution &SE = getAnalysis<ScalarEvolutionWrapperPass>(*F)
+          .getSE();
+        map<unsigned, uint64_t> Args;
+        for (Argument &A : F->args()) {
+          uint64_t Extent;
+          if (!A.getType()->isPointerTy() || A.hasByValAttr() ||
+              A.getType()->getPointerAddressSpace() != 0 ||
+              !getReadExtent(&A, SE, Extent) || mayWriteToArg(*F, &A) ||
+              TotalSize + Extent > MaxTotalSize) {
+            continue;
+          }
+          TotalSize += Extent;
+          Args[A.getArgNo()] = Extent;
+        }
+        if (!Args.empty()) {
+          promote(F, Args);
+          ret = true;
+        }
       }
       return ret;
     }
 
     void getAnalysisUsage(AnalysisUsage &AU) const override {
-      //AU.getRequiredSet();
-      //AU.setPreservesCFG();
-      //AU.setPreservesAll();
-      //AU.addRequiredID(LoopInfoWrapperPass::ID);
-      AU.addRequired<LoopInfoWrapperPass>();
-      AU.addRequired<DominatorTreeWrapperPass>();
-      //AU.getRequiredSet();
-    }
-
-    private:
-    string genName(string &SymbolName) {
-      SymbolName += "Const";
-      SymbolName = "const_array";
-      return SymbolName;
+      AU.addRequired<ScalarEvolutionWrapperPass>();
     }
   };
 }
 
 char Glob2Const::ID = 0;
 static RegisterPass<Glob2Const>
-Y("Glob2Const", "Test Pass");
+Y("Glob2Const", "Kernel array arguments to constant memory");
 
 //INITIALIZE_PASS_BEGIN(Glob2Const, "Glob2Const", "Scalar Replacement Of Aggregates", false, false)
 //INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
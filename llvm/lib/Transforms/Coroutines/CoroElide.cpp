@@ -15,6 +15,7 @@
 #include "llvm/Analysis/InstructionSimplify.h"
 #include "llvm/IR/Dominators.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/ErrorHandling.h"
 
@@ -36,6 +37,9 @@ struct Lowerer : coro::LowererBase {
 
   void elideHeapAllocations(Function *F, Type *FrameTy, AAResults &AA);
   bool shouldElide(Function *F, DominatorTree &DT) const;
+  bool isDestroyedByCallee(CoroBeginInst *CB,
+                           ArrayRef<Instruction *> Terminators,
+                           DominatorTree &DT) const;
   bool processCoroId(CoroIdInst *, AAResults &AA, DominatorTree &DT);
 };
 } // end anonymous namespace
@@ -141,6 +145,61 @@ void Lowerer::elideHeapAllocations(Function *F, Type *FrameTy, AAResults &AA) {
   removeTailCallAttribute(Frame, AA);
 }
 
+// Returns true if \p Arg is destroyed, via llvm.coro.subfn.addr, before every
+// non-exceptional return from its parent function.
+static bool isDestroyedBeforeReturn(Argument *Arg) {
+  Function *F = Arg->getParent();
+  SmallVector<CoroSubFnInst *, 2> Destroys;
+  for (User *U : Arg->users())
+    if (auto *II = dyn_cast<CoroSubFnInst>(U))
+      if (II->getIndex() == CoroSubFnInst::DestroyIndex)
+        Destroys.push_back(II);
+  if (Destroys.empty())
+    return false;
+
+  DominatorTree DT(*F);
+  for (BasicBlock &B : *F) {
+    auto *TI = B.getTerminator();
+    if (TI->getNumSuccessors() != 0 || TI->isExceptionalTerminator() ||
+        isa<UnreachableInst>(TI))
+      continue;
+    if (none_of(Destroys, [&](CoroSubFnInst *DA) {
+          return DT.dominates(DA, TI);
+        }))
+      return false;
+  }
+  return true;
+}
+
+// Awaiters commonly take the coroutine handle as an argument and destroy it
+// themselves. Look one call deep for such a callee: the handle must be passed
+// to a nocapture parameter of a call that happens on every non-exceptional
+// path, and the callee must destroy it before returning. The frame then cannot
+// outlive the caller, and it can live on its stack. Only a callee with an exact
+// definition is trusted, since any other may be replaced at link time by one
+// that keeps the handle.
+bool Lowerer::isDestroyedByCallee(CoroBeginInst *CB,
+                                  ArrayRef<Instruction *> Terminators,
+                                  DominatorTree &DT) const {
+  for (User *U : CB->users()) {
+    auto *Call = dyn_cast<CallInst>(U);
+    if (!Call || isa<IntrinsicInst>(Call))
+      continue;
+    Function *Callee = Call->getCalledFunction();
+    if (!Callee || !Callee->hasExactDefinition() || Callee == CB->getFunction())
+      continue;
+    if (!all_of(Terminators,
+                [&](Instruction *TI) { return DT.dominates(Call, TI); }))
+      continue;
+    for (unsigned I = 0, E = Call->getNumArgOperands(); I != E; ++I)
+      if (Call->getArgOperand(I) == CB && I < Callee->arg_size() &&
+          Call->doesNotCapture(I) &&
+          isDestroyedBeforeReturn(Callee->arg_begin() + I))
+        return true;
+  }
+  return false;
+}
+
 bool Lowerer::shouldElide(Function *F, DominatorTree &DT) const {
   // If no CoroAllocs, we cannot suppress allocation, so elision is not
   // possible.
@@ -153,12 +212,12 @@ bool Lowerer::shouldElide(Function *F, DominatorTree &DT) const {
   // memory location storing that value and not the virtual register.
 
   // First gather all of the non-exceptional terminators for the function.
-  SmallPtrSet<Instruction *, 8> Terminators;
+  SmallVector<Instruction *, 8> Terminators;
   for (BasicBlock &B : *F) {
     auto *TI = B.getTerminator();
     if (TI->getNumSuccessors() == 0 && !TI->isExceptionalTerminator() &&
         !isa<UnreachableInst>(TI))
-      Terminators.insert(TI);
+      Terminators.push_back(TI);
   }
 
   // Filter out the coro.destroy that lie along exceptional paths.
@@ -181,6 +240,12 @@ bool Lowerer::shouldElide(Function *F, DominatorTree &DT) const {
       return false;
   }
 
+  // The remaining coro.begin may be handed to a callee that destroys them.
+  for (CoroBeginInst *CB : CoroBegins)
+    if (!ReferencedCoroBegins.count(CB) &&
+        isDestroyedByCallee(CB, Terminators, DT))
+      ReferencedCoroBegins.insert(CB);
+
   // If size of the set is the same as total number of coro.begin, that means we
   // found a coro.free or coro.destroy referencing each coro.begin, so we can
   // perform heap elision.
@@ -360,6 +360,16 @@ struct PaddingCalculator {
 };
 } // namespace
 
+namespace {
+// A value that needs a field in the coroutine frame.
+struct FrameField {
+  Value *Def;
+  Type *Ty;
+  uint64_t Count;
+  unsigned Align;
+};
+} // namespace
+
 // Build a struct that will keep state for an active coroutine.
 //   struct f.frame {
 //     ResumeFnTy ResumeFnAddr;
@@ -368,6 +378,9 @@ struct PaddingCalculator {
 //     ... promise (if present) ...
 //     ... spills ...
 //   };
+//
+// The spills are laid out by decreasing alignment, so that only the first of
+// them may need padding and the frame is as small as the spilled values allow.
 static StructType *buildFrameType(Function &F, coro::Shape &Shape,
                                   SpillInfo &Spills) {
   LLVMContext &C = F.getContext();
@@ -393,6 +406,7 @@ static StructType *buildFrameType(Function &F, coro::Shape &Shape,
   Padder.addTypes(Types);
 
   // Create an entry for every spilled value.
+  SmallVector<FrameField, 8> Fields;
   for (auto &S : Spills) {
     if (CurrentDef == S.def())
       continue;
@@ -404,8 +418,32 @@ static StructType *buildFrameType(Function &F, coro::Shape &Shape,
 
     uint64_t Count = 1;
     Type *Ty = nullptr;
+    unsigned Align = 0;
     if (auto *AI = dyn_cast<AllocaInst>(CurrentDef)) {
       Ty = AI->getAllocatedType();
+      Align = AI->getAlignment();
+      if (auto *CI = dyn_cast<ConstantInt>(AI->getArraySize()))
+        Count = CI->getValue().getZExtValue();
+      else
+        report_fatal_error("Coroutines cannot handle non static allocas yet");
+    } else {
+      Ty = CurrentDef->getType();
+    }
+    Align = std::max(Align, DL.getABITypeAlignment(Ty));
+    Fields.push_back({CurrentDef, Ty, Count, Align});
+  }
+
+  // Sort stably, so that the layout does not depend on anything but the order
+  // of the spills.
+  std::stable_sort(Fields.begin(), Fields.end(),
+                   [](const FrameField &A, const FrameField &B) {
+                     return A.Align > B.Align;
+                   });
+
+  DenseMap<Value *, unsigned> FieldIndices;
+  for (const FrameField &Field : Fields) {
+    Type *Ty = Field.Ty;
+    if (auto *AI = dyn_cast<AllocaInst>(Field.Def)) {
       if (unsigned AllocaAlignment = AI->getAlignment()) {
         // If alignment is specified in alloca, see if we need to insert extra
         // padding.
@@ -414,22 +452,20 @@ static StructType *buildFrameType(Function &F, coro::Shape &Shape,
           Padder.addType(PaddingTy);
         }
       }
-      if (auto *CI = dyn_cast<ConstantInt>(AI->getArraySize()))
-        Count = CI->getValue().getZExtValue();
-      else
-        report_fatal_error("Coroutines cannot handle non static allocas yet");
-    } else {
-      Ty = CurrentDef->getType();
     }
-    S.setFieldIndex(Types.size());
-    if (Count == 1)
+    FieldIndices[Field.Def] = Types.size();
+    if (Field.Count == 1)
       Types.push_back(Ty);
     else
-      Types.push_back(ArrayType::get(Ty, Count));
-    Padder.addType(Ty);
+      Types.push_back(ArrayType::get(Ty, Field.Count));
+    Padder.addType(Types.back());
   }
   FrameTy->setBody(Types);
 
+  for (auto &S : Spills)
+    if (S.def() != Shape.PromiseAlloca)
+      S.setFieldIndex(FieldIndices.lookup(S.def()));
+
   return FrameTy;
 }
 
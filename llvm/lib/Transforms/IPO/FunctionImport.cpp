@@ -902,39 +902,6 @@ std::error_code llvm::EmitImportsFiles(
   return std::error_code();
 }
 
-bool llvm::convertToDeclaration(GlobalValue &GV) {
-  LLVM_DEBUG(dbgs() << "Converting to a declaration: `" << GV.getName()
-                    << "\n");
-  if (Function *F = dyn_cast<Function>(&GV)) {
-    F->deleteBody();
-    F->clearMetadata();
-    F->setComdat(nullptr);
-  } else if (GlobalVariable *V = dyn_cast<GlobalVariable>(&GV)) {
-    V->setInitializer(nullptr);
-    V->setLinkage(GlobalValue::ExternalLinkage);
-    V->clearMetadata();
-    V->setComdat(nullptr);
-  } else {
-    GlobalValue *NewGV;
-    if (GV.getValueType()->isFunctionTy())
-      NewGV =
-          Function::Create(cast<FunctionType>(GV.getValueType()),
-                           GlobalValue::ExternalLinkage, GV.getAddressSpace(),
-                           "", GV.getParent());
-    else
-      NewGV =
-          new GlobalVariable(*GV.getParent(), GV.getValueType(),
-                             /*isConstant*/ false, GlobalValue::ExternalLinkage,
-                             /*init*/ nullptr, "",
-                             /*insertbefore*/ nullptr, GV.getThreadLocalMode(),
-                             GV.getType()->getAddressSpace());
-    NewGV->takeName(&GV);
-    GV.replaceAllUsesWith(NewGV);
-    return false;
-  }
-  return true;
-}
-
 /// Fixup prevailing symbol linkages in \p TheModule based on summary analysis.
 void llvm::thinLTOResolvePrevailingInModule(
     Module &TheModule, const GVSummaryMapTy &DefinedGlobals) {
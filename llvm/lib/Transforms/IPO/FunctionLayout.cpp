@@ -0,0 +1,134 @@
+//===- FunctionLayout.cpp - Profile guided function layout ----------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Hot functions are ordered with the Call-Chain Clustering heuristic the
+// linker uses for call graph profiles, over the calls between hot functions
+// of the module. The weight of a hot function also counts the calls it gets
+// from other modules, which only show in its entry count.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/IPO/FunctionLayout.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Analysis/BlockFrequencyInfo.h"
+#include "llvm/Analysis/ProfileSummaryInfo.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Transforms/Utils/CallGraphSort.h"
+
+using namespace llvm;
+
+#define DEBUG_TYPE "function-layout"
+
+STATISTIC(NumHotFunctions, "Number of functions laid out as hot");
+STATISTIC(NumColdFunctions, "Number of functions laid out as cold");
+
+static uint64_t getInstructionCount(const Function &F) {
+  uint64_t Count = 0;
+  for (const BasicBlock &BB : F)
+    Count += BB.size();
+  return Count;
+}
+
+PreservedAnalyses FunctionLayoutPass::run(Module &M,
+                                          ModuleAnalysisManager &AM) {
+  ProfileSummaryInfo &PSI = AM.getResult<ProfileSummaryAnalysis>(M);
+  if (!PSI.hasProfileSummary())
+    return PreservedAnalyses::all();
+  FunctionAnalysisManager &FAM =
+      AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+
+  std::vector<Function *> Hot, Warm, Cold;
+  DenseMap<Function *, unsigned> HotIndex;
+  for (Function &F : M) {
+    if (F.isDeclaration())
+      continue;
+    auto &BFI = FAM.getResult<BlockFrequencyAnalysis>(F);
+    if (PSI.isFunctionHotInCallGraph(&F, BFI)) {
+      HotIndex[&F] = Hot.size();
+      Hot.push_back(&F);
+    } else if (PSI.isFunctionColdInCallGraph(&F, BFI)) {
+      Cold.push_back(&F);
+    } else {
+      Warm.push_back(&F);
+    }
+  }
+  if (Hot.empty() && Cold.empty())
+    return PreservedAnalyses::all();
+
+  // Weigh the calls between hot functions by the profile count of the block
+  // of the call.
+  MapVector<std::pair<unsigned, unsigned>, uint64_t> Calls;
+  std::vector<uint64_t> CallsInModule(Hot.size());
+  for (Function *F : Hot) {
+    unsigned Caller = HotIndex[F];
+    auto &BFI = FAM.getResult<BlockFrequencyAnalysis>(*F);
+    for (BasicBlock &BB : *F) {
+      Optional<uint64_t> BBCount = BFI.getBlockProfileCount(&BB);
+      if (!BBCount || !*BBCount)
+        continue;
+      for (Instruction &I : BB) {
+        CallSite CS(&I);
+        if (!CS)
+          continue;
+        auto It = HotIndex.find(CS.getCalledFunction());
+        if (It == HotIndex.end())
+          continue;
+        uint64_t &Count = Calls[std::make_pair(Caller, It->second)];
+        Count = SaturatingAdd(Count, *BBCount);
+        CallsInModule[It->second] =
+            SaturatingAdd(CallsInModule[It->second], *BBCount);
+      }
+    }
+  }
+
+  std::vector<uint64_t> Sizes;
+  std::vector<CallGraphSortEdge> Edges;
+  for (auto &Call : Calls)
+    Edges.push_back({Call.first.first, Call.first.second, Call.second});
+  for (unsigned I = 0, E = Hot.size(); I != E; ++I) {
+    Sizes.push_back(getInstructionCount(*Hot[I]));
+    Function::ProfileCount EntryCount = Hot[I]->getEntryCount();
+    if (EntryCount.hasValue() && EntryCount.getCount() > CallsInModule[I])
+      Edges.push_back({I, I, EntryCount.getCount() - CallsInModule[I]});
+  }
+
+  // Hot functions first, in the order of the clusters, then the others in
+  // their original order, cold functions last.
+  std::vector<Function *> Order;
+  for (unsigned I : computeCallGraphSortOrder(Sizes, Edges))
+    Order.push_back(Hot[I]);
+  Order.insert(Order.end(), Warm.begin(), Warm.end());
+  Order.insert(Order.end(), Cold.begin(), Cold.end());
+  for (Function *F : Order)
+    M.getFunctionList().splice(M.end(), M.getFunctionList(), F);
+
+  auto SetSectionPrefix = [](Function *F, StringRef Prefix) {
+    if (!F->hasSection() && !F->getSectionPrefix())
+      F->setSectionPrefix(Prefix);
+  };
+  for (Function *F : Hot) {
+    LLVM_DEBUG(dbgs() << "FL: hot function " << F->getName() << "\n");
+    SetSectionPrefix(F, ".hot");
+  }
+  for (Function *F : Cold)
+    SetSectionPrefix(F, ".unlikely");
+  NumHotFunctions += Hot.size();
+  NumColdFunctions += Cold.size();
+
+  // Only the order of the functions and their section prefix changed.
+  PreservedAnalyses PA;
+  PA.preserveSet<AllAnalysesOn<Function>>();
+  PA.preserve<FunctionAnalysisManagerModuleProxy>();
+  PA.preserve<ProfileSummaryAnalysis>();
+  return PA;
+}
@@ -727,6 +727,9 @@ public:
   /// Maximum size of array considered when transforming.
   uint64_t MaxArraySizeForCombine;
 
+  /// Number of instructions run() took off the worklist.
+  unsigned VisitCount = 0;
+
 private:
   /// Performs a few simplifications for operators which are associative
   /// or commutative.
@@ -118,6 +118,9 @@ STATISTIC(NumSunkInst , "Number of instructions sunk");
 STATISTIC(NumExpand,    "Number of expansions");
 STATISTIC(NumFactor   , "Number of factorizations");
 STATISTIC(NumReassoc  , "Number of reassociations");
+STATISTIC(NumIterations, "Number of iterations over the worklist");
+STATISTIC(NumFullScans, "Number of iterations seeded with the whole function");
+STATISTIC(NumVisited  , "Number of insts taken off the worklist");
 DEBUG_COUNTER(VisitCounter, "instcombine-visit",
               "Controls which instructions are visited");
 
@@ -133,6 +136,16 @@ static cl::opt<unsigned>
 MaxArraySize("instcombine-maxarray-size", cl::init(1024),
              cl::desc("Maximum array size considered when doing a combine"));
 
+static cl::opt<bool>
+IncrementalIterations("instcombine-incremental", cl::init(false), cl::Hidden,
+                      cl::desc("Seed the iterations after the first one with "
+                               "the instructions changed by the previous one "
+                               "instead of the whole function"));
+
+static cl::opt<unsigned>
+MaxIterations("instcombine-max-iterations", cl::init(1000), cl::Hidden,
+              cl::desc("Maximum number of iterations over the worklist"));
+
 // FIXME: Remove this flag when it is no longer necessary to convert
 // llvm.dbg.declare to avoid inaccurate debug info. Setting this to false
 // increases variable availability at the cost of accuracy. Variables that
@@ -3186,6 +3199,8 @@ bool InstCombiner::run() {
   while (!Worklist.isEmpty()) {
     Instruction *I = Worklist.RemoveOne();
     if (I == nullptr) continue;  // skip null values.
+    ++NumVisited;
+    ++VisitCount;
 
     // Check to see if we can DCE the instruction.
     if (isInstructionTriviallyDead(I, &TLI)) {
@@ -3482,6 +3497,45 @@ static bool prepareICWorklistFromFunction(Function &F, const DataLayout &DL,
   return MadeIRChange;
 }
 
+/// Populate the IC worklist with the instructions the previous iteration
+/// added to it, i.e. the ones it created or changed along with the users of
+/// the values it replaced, and their users, in the order they appear in the
+/// function. Return the number of instructions added.
+///
+/// This is only valid while the CFG seen by the last full scan is unchanged:
+/// the unreachable blocks it emptied must stay unreachable.
+static unsigned prepareICWorklistFromChanges(Function &F,
+                                             InstCombineWorklist &ICWorklist) {
+  SmallPtrSet<Instruction *, 32> Seeds;
+  SmallPtrSet<BasicBlock *, 16> SeedBlocks;
+  auto AddSeed = [&](Instruction *I) {
+    if (!I->getParent() || isa<DbgInfoIntrinsic>(I))
+      return;
+    if (Seeds.insert(I).second)
+      SeedBlocks.insert(I->getParent());
+  };
+  for (const WeakVH &VH : ICWorklist.getAdded()) {
+    auto *I = cast_or_null<Instruction>(VH);
+    if (!I)
+      continue;
+    AddSeed(I);
+    for (User *U : I->users())
+      AddSeed(cast<Instruction>(U));
+  }
+  ICWorklist.clearAdded();
+
+  SmallVector<Instruction *, 128> InstrsForInstCombineWorklist;
+  for (BasicBlock &BB : F) {
+    if (!SeedBlocks.count(&BB))
+      continue;
+    for (Instruction &I : BB)
+      if (Seeds.count(&I))
+        InstrsForInstCombineWorklist.push_back(&I);
+  }
+  ICWorklist.AddInitialGroup(InstrsForInstCombineWorklist);
+  return InstrsForInstCombineWorklist.size();
+}
+
 static bool combineInstructionsOverFunction(
     Function &F, InstCombineWorklist &Worklist, AliasAnalysis *AA,
     AssumptionCache &AC, TargetLibraryInfo &TLI, DominatorTree &DT,
@@ -3507,22 +3561,57 @@ static bool combineInstructionsOverFunction(
   if (ShouldLowerDbgDeclare)
     MadeIRChange = LowerDbgDeclare(F);
 
-  // Iterate while there is work to do.
-  int Iteration = 0;
+  // Iterate while there is work to do. The first iteration visits the whole
+  // function. Whatever a later one could fold has to involve an instruction
+  // the previous one changed, so it only starts from those and their users,
+  // unless a terminator changed: this may have made blocks unreachable, and
+  // only the full scan removes their instructions.
+  unsigned Iteration = 0;
+  unsigned Visited = 0;
+  Worklist.clearAdded();
   while (true) {
     ++Iteration;
+    ++NumIterations;
+    bool FullScan = Iteration == 1 || !IncrementalIterations ||
+                    Worklist.hasAddedTerminator();
     LLVM_DEBUG(dbgs() << "\n\nINSTCOMBINE ITERATION #" << Iteration << " on "
-                      << F.getName() << "\n");
-
-    MadeIRChange |= prepareICWorklistFromFunction(F, DL, &TLI, Worklist);
+                      << F.getName() << (FullScan ? "" : " (incremental)")
+                      << "\n");
+
+    if (FullScan) {
+      ++NumFullScans;
+      Worklist.clearAdded();
+      MadeIRChange |= prepareICWorklistFromFunction(F, DL, &TLI, Worklist);
+    } else if (!prepareICWorklistFromChanges(F, Worklist)) {
+      break;
+    }
 
     InstCombiner IC(Worklist, Builder, F.hasMinSize(), ExpensiveCombines, AA,
                     AC, TLI, DT, ORE, BFI, PSI, DL, LI);
     IC.MaxArraySizeForCombine = MaxArraySize;
 
-    if (!IC.run())
+    bool Changed = IC.run();
+    Visited += IC.VisitCount;
+    if (!Changed)
       break;
+
+    if (Iteration == MaxIterations) {
+      LLVM_DEBUG(dbgs() << "IC: giving up on " << F.getName() << " after "
+                        << Iteration << " iterations\n");
+      break;
+    }
   }
+  Worklist.clearAdded();
+
+  LLVM_DEBUG(dbgs() << "IC: " << F.getName() << ": " << Iteration
+                    << " iterations, " << Visited << " visits\n");
+  ORE.emit([&]() {
+    return OptimizationRemarkAnalysis(DEBUG_TYPE, "Iterations",
+                                      F.getSubprogram(), &F.getEntryBlock())
+           << "visited " << ore::NV("NumVisited", Visited)
+           << " instructions in " << ore::NV("NumIterations", Iteration)
+           << " iterations";
+  });
 
   return MadeIRChange || Iteration > 1;
 }
@@ -32,9 +32,11 @@
 #include "llvm/IR/GlobalValue.h"
 #include "llvm/IR/GlobalVariable.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InstIterator.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Type.h"
 #include "llvm/Pass.h"
@@ -102,6 +104,19 @@ cl::opt<bool> AtomicCounterUpdateAll(
     cl::desc("Make all profile counter updates atomic (for testing only)"),
     cl::init(false));
 
+cl::opt<bool> RuntimeCounterRelocation(
+    "runtime-counter-relocation", cl::ZeroOrMore,
+    cl::desc("Address the profile counters through a bias set by the runtime, "
+             "which allows them to be mapped onto the profile file"),
+    cl::init(false));
+
+cl::opt<bool> PerThreadCounters(
+    "instrprof-per-thread-counters", cl::ZeroOrMore,
+    cl::desc("Update per-thread copies of the profile counters, which the "
+             "runtime adds up when the profile is written. The updates are "
+             "not atomic and can be register promoted"),
+    cl::init(false));
+
 cl::opt<bool> AtomicCounterUpdatePromoted(
     "atomic-counter-update-promoted", cl::ZeroOrMore,
     cl::desc("Do counter update using atomic fetch add "
@@ -161,7 +176,10 @@ public:
   }
 
   void getAnalysisUsage(AnalysisUsage &AU) const override {
-    AU.setPreservesCFG();
+    // The per-thread counters are set up in a new block on the first call in
+    // each thread.
+    if (!PerThreadCounters)
+      AU.setPreservesCFG();
     AU.addRequired<TargetLibraryInfoWrapperPass>();
   }
 };
@@ -402,6 +420,15 @@ static InstrProfIncrementInst *castToIncrementInst(Instruction *Instr) {
 bool InstrProfiling::lowerIntrinsics(Function *F) {
   bool MadeChange = false;
   PromotionCandidates.clear();
+
+  // Setting up the per-thread counters splits the entry block, so it is done
+  // before the increments are lowered.
+  if (isPerThreadCountersEnabled() &&
+      llvm::any_of(instructions(F), [](Instruction &I) {
+        return castToIncrementInst(&I) != nullptr;
+      }))
+    FunctionToProfileBiasMap[F] = emitThreadCounterBias(F);
+
   for (BasicBlock &BB : *F) {
     for (auto I = BB.begin(), E = BB.end(); I != E;) {
       auto Instr = I++;
@@ -427,7 +454,18 @@ bool InstrProfiling::isCounterPromotionEnabled() const {
   if (DoCounterPromotion.getNumOccurrences() > 0)
     return DoCounterPromotion;
 
-  return Options.DoCounterPromotion;
+  // Per-thread counters are private to the thread, so the updates in loops
+  // can always be accumulated in registers.
+  return Options.DoCounterPromotion || isPerThreadCountersEnabled();
+}
+
+bool InstrProfiling::isRuntimeCounterRelocationEnabled() const {
+  return RuntimeCounterRelocation;
+}
+
+bool InstrProfiling::isPerThreadCountersEnabled() const {
+  // The counters of a continuous profile are updated in the mapped file.
+  return PerThreadCounters && !isRuntimeCounterRelocationEnabled();
 }
 
 void InstrProfiling::promoteCounterLoadStores(Function *F) {
@@ -488,6 +526,7 @@ bool InstrProfiling::run(Module &M, const TargetLibraryInfo &TLI) {
   NamesVar = nullptr;
   NamesSize = 0;
   ProfileDataMap.clear();
+  FunctionToProfileBiasMap.clear();
   UsedVars.clear();
   getMemOPSizeRangeFromOption(MemOPSizeRange, MemOPSizeRangeStart,
                               MemOPSizeRangeLast);
@@ -623,15 +662,117 @@ void InstrProfiling::lowerValueProfileInst(InstrProfValueProfileInst *Ind) {
   Ind->eraseFromParent();
 }
 
-void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
+Instruction *InstrProfiling::emitCounterBiasLoad(Function *Fn) {
+  Type *Int64Ty = Type::getInt64Ty(M->getContext());
+  auto *Bias = M->getGlobalVariable(getInstrProfCounterBiasVarName());
+  if (!Bias) {
+    Bias = new GlobalVariable(*M, Int64Ty, false,
+                              GlobalValue::LinkOnceODRLinkage,
+                              Constant::getNullValue(Int64Ty),
+                              getInstrProfCounterBiasVarName());
+    Bias->setVisibility(GlobalVariable::HiddenVisibility);
+    // The definition overrides the runtime's weak default, which tells the
+    // runtime that the counters can be relocated.
+    if (TT.supportsCOMDAT()) {
+      Bias->setLinkage(GlobalValue::ExternalLinkage);
+      Bias->setComdat(M->getOrInsertComdat(Bias->getName()));
+    }
+  }
+  IRBuilder<> Builder(&*Fn->getEntryBlock().getFirstInsertionPt());
+  return Builder.CreateLoad(Int64Ty, Bias, "pgobias");
+}
+
+Instruction *InstrProfiling::emitThreadCounterBias(Function *Fn) {
+  LLVMContext &Ctx = M->getContext();
+  Type *Int64Ty = Type::getInt64Ty(Ctx);
+  auto *Bias = M->getGlobalVariable(getInstrProfThreadCounterBiasVarName());
+  if (!Bias) {
+    Bias = new GlobalVariable(*M, Int64Ty, false,
+                              GlobalValue::LinkOnceODRLinkage,
+                              Constant::getNullValue(Int64Ty),
+                              getInstrProfThreadCounterBiasVarName(), nullptr,
+                              GlobalVariable::GeneralDynamicTLSModel);
+    Bias->setVisibility(GlobalVariable::HiddenVisibility);
+    if (TT.supportsCOMDAT()) {
+      Bias->setLinkage(GlobalValue::ExternalLinkage);
+      Bias->setComdat(M->getOrInsertComdat(Bias->getName()));
+    }
+  }
+
+  // The bias is zero until the runtime has allocated the counters of the
+  // thread, on the first call to an instrumented function:
+  //
+  //   %pgobias.tls = load i64, i64* @__llvm_profile_thread_counter_bias
+  //   if (%pgobias.tls == 0)
+  //     store (call @__llvm_profile_get_thread_counter_bias()), @...bias
+  //   %pgobias = phi i64 ...
+  BasicBlock &Entry = Fn->getEntryBlock();
+  IRBuilder<> Builder(&*Entry.getFirstInsertionPt());
+  LoadInst *Cur = Builder.CreateLoad(Int64Ty, Bias, "pgobias.tls");
+  Value *IsUnset = Builder.CreateICmpEQ(Cur, ConstantInt::get(Int64Ty, 0));
+  Instruction *Then = SplitBlockAndInsertIfThen(
+      IsUnset, cast<Instruction>(IsUnset)->getNextNode(), false,
+      MDBuilder(Ctx).createBranchWeights(1, (1U << 20) - 1));
+  BasicBlock *Tail = Then->getParent()->getSingleSuccessor();
+
+  // Keep the static allocas in the entry block.
+  for (auto I = Tail->begin(), E = Tail->end(); I != E;) {
+    auto *AI = dyn_cast<AllocaInst>(&*I++);
+    if (AI && AI->isStaticAlloca())
+      AI->moveBefore(Cur);
+  }
+
+  Builder.SetInsertPoint(Then);
+  FunctionCallee GetBias = M->getOrInsertFunction(
+      getInstrProfThreadCounterBiasFuncName(), Int64Ty);
+  if (auto *GetBiasFn = dyn_cast<Function>(GetBias.getCallee()))
+    GetBiasFn->setVisibility(GlobalValue::HiddenVisibility);
+  CallInst *New = Builder.CreateCall(GetBias, {}, "pgobias.new");
+  Builder.CreateStore(New, Bias);
+
+  Builder.SetInsertPoint(&Tail->front());
+  PHINode *Phi = Builder.CreatePHI(Int64Ty, 2, "pgobias");
+  Phi->addIncoming(Cur, &Entry);
+  Phi->addIncoming(New, Then->getParent());
+  return Phi;
+}
+
+Value *InstrProfiling::getCounterAddress(InstrProfIncrementInst *Inc) {
   GlobalVariable *Counters = getOrCreateRegionCounters(Inc);
 
   IRBuilder<> Builder(Inc);
   uint64_t Index = Inc->getIndex()->getZExtValue();
   Value *Addr = Builder.CreateConstInBoundsGEP2_64(Counters->getValueType(),
                                                    Counters, 0, Index);
+  if (!isRuntimeCounterRelocationEnabled() && !isPerThreadCountersEnabled())
+    return Addr;
 
-  if (Options.Atomic || AtomicCounterUpdateAll) {
+  // The bias is computed once at the start of the function, and the relocated
+  // addresses are computed right after it, so that they dominate all the
+  // counter updates, including the ones sunk out of loops by counter
+  // promotion.
+  Function *Fn = Inc->getParent()->getParent();
+  Instruction *&Bias = FunctionToProfileBiasMap[Fn];
+  if (!Bias) {
+    assert(isRuntimeCounterRelocationEnabled() &&
+           "per-thread counter bias is set up before lowering");
+    Bias = emitCounterBiasLoad(Fn);
+  }
+  if (isa<PHINode>(Bias))
+    Builder.SetInsertPoint(&*Bias->getParent()->getFirstInsertionPt());
+  else
+    Builder.SetInsertPoint(Bias->getNextNode());
+  Type *Int64Ty = Type::getInt64Ty(M->getContext());
+  auto *Add = Builder.CreateAdd(Builder.CreatePtrToInt(Addr, Int64Ty), Bias);
+  return Builder.CreateIntToPtr(Add, Addr->getType());
+}
+
+void InstrProfiling::lowerIncrement(InstrProfIncrementInst *Inc) {
+  Value *Addr = getCounterAddress(Inc);
+
+  IRBuilder<> Builder(Inc);
+  if ((Options.Atomic || AtomicCounterUpdateAll) &&
+      !isPerThreadCountersEnabled()) {
     Builder.CreateAtomicRMW(AtomicRMWInst::Add, Addr, Inc->getStep(),
                             AtomicOrdering::Monotonic);
   } else {
@@ -2,11 +2,15 @@
 //
 //
 //===----------------------------------------------------------------------===//
+#include <functional>
 #include <map>
 #include <queue>
+#include <set>
+#include <tuple>
 #include <unordered_set>
 
 #include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/Triple.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/IntrinsicInst.h"
@@ -17,19 +21,47 @@
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/CallGraph.h"
 #include "llvm/Analysis/OrderedInstructions.h"
+#include "llvm/Analysis/PostDominators.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
 #include "llvm/Transforms/IPO.h"
+#include "llvm/Transforms/IPO/OmpTgtAddrTrans.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
 #include "llvm/Transforms/Utils/Cloning.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
+#ifdef LLVM_MODULE
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#endif
 //#include "llvm/Analysis/MemoryDependenceAnalysis.h"
 
 using namespace llvm;
 using namespace std;
 
 /*
- * TODO
- * Reuse translate result???
+ * Translate results are reused by optimizeATCalls and translations of
+ * device addresses (allocas, shared memory, translated values) are dropped,
+ * set OMP_AT_NOOPT to disable both
+ * Table lookups are inlined as a branch-free search, set OMP_AT_TABLE_CALL
+ * to keep the AddrTransTable2 call. OMP_AT_TABLE_SIZE=N sizes the inlined
+ * search for tables up to N entries, bigger tables use the call
+ * OMP_AT_OFFSET reads the offsets from constant memory (AddrTransOffset2),
+ * set OMP_AT_OFFSET_GLOBAL to read the offset list argument instead
+ * OMP_AT_CONCURRENT translates warp uniform addresses once per warp and
+ * shuffles the result, translations of one base at constant offsets share
+ * one lookup
+ * Loads through translations of noalias kernel arguments that are never
+ * written are marked !invariant.load, which NVPTX lowers to ld.global.nc and
+ * the load store vectorizer does not order against stores. It is part of
+ * the optimizations OMP_AT_NOOPT disables
+ * OMP_AT_PREFETCH prefetches the next node of loops that walk p = p->next
+ * through translated pointers, as soon as the next pointer is loaded
+ * OMP_AT_FIELD_USAGE=file appends the pointer fields the kernels dereference
+ * as "<struct> <byte offset>" lines, clang's -openmp-dc-field-usage then
+ * leaves the other pointer fields of those structs out of deep copy
  */
 
 #ifdef DEBUG
@@ -43,8 +75,6 @@ using namespace std;
 #define FAILED 1
 #define SUCCESS 0
 
-#define MAX_ATTable_SIZE 20
-
 #define MyAddressSpace 7
 
 // define LLVM_MODULE if emit llvm module
@@ -58,6 +88,11 @@ namespace {
   //bool EnableAS = false;
   bool DisableFakeLoad = false;
   int InsertedATCount = 0;
+  int HoistedATCount = 0;
+  int ReusedATCount = 0;
+  int SkippedATCount = 0;
+  int InvariantLoadCount = 0;
+  int PrefetchCount = 0;
 
   raw_ostream &dp() {
     std::error_code  EC;
@@ -81,7 +116,8 @@ namespace {
     OMP_AT_OFFSET
   };
   typedef map<ATVer, Function*> ATFunctionSet;
-  const int MaxATTableSize = 20;
+  // Tables up to this size are searched inline unless OMP_AT_TABLE_SIZE
+  const int DefaultInlineTableSize = 31;
   const int ATTableEntyNum = sizeof(struct ATTableTy) / sizeof(uintptr_t);
 
   struct InsertionAT {
@@ -126,7 +162,6 @@ namespace {
     Function *ATFuncTable_tab;    // void *(void *, struct ATTableTy*)
 
     Function *ATFuncTable;        // void *(void *)
-    Function *StoreTableFunc;     // pre-store table
 
     // Index-based
     Function *ATFuncOffset;       // void *(void *, intptr_t *)
@@ -143,6 +178,8 @@ namespace {
 
     // AT mode
     ATVer CurATMode;
+    // Offsets are in constant memory, filled by libomptarget
+    bool UseConstOffsets;
 
     // Metadatas
     MDNode *ATMD;
@@ -156,6 +193,13 @@ namespace {
 
     unique_ptr<raw_fd_ostream> db_ostream;
 
+    // Byte offsets of the traced fields per named struct
+    map<string, set<uint64_t>> FieldUsage;
+
+    // Function analyses of the legacy or the new pass manager
+    function<DominatorTree &(Function &)> GetDT;
+    function<LoopInfo &(Function &)> GetLI;
+
     public:
     static char ID; // Pass identification, replacement for typeid
     // Functions
@@ -165,6 +209,8 @@ namespace {
 #endif
     }
     virtual StringRef getPassName() const override {return "OmpTgtAddrTrans";};
+    bool runImpl(Module &M, function<DominatorTree &(Function &)> DTGetter,
+        function<LoopInfo &(Function &)> LIGetter);
     private:
     Argument *getATArg(Function *F);
     int8_t init(Module &M);
@@ -190,11 +236,26 @@ namespace {
 
     Type *addAddrSpace(Type *T);
     DominatorTree &getDomTree(Function *F);
+    LoopInfo &getLoopInfo(Function *F);
+    bool isTransInst(Instruction *I);
+    bool hoistATCall(Instruction *TransI, Loop *L);
+    bool isDeviceAddr(Value *V);
+    void skipDeviceATs(Function *F);
+    void optimizeATCalls(Function *F);
+    bool isReadOnlyNoAliasArg(Argument *A);
+    void markInvariantLoads(Function *F);
+    void prefetchPointerChase(Function *F);
     void getEntryFuncs(FunctionMapTy &EntryList);
     int16_t doSharedMemOpt();
+    Value *stageToShared(Function *F, GlobalVariable *SM, Value *Src,
+        Value *Count, Intrinsic::ID TidID, Intrinsic::ID BarrierID);
+    Function *genTableLookupFunc();
+    void inlineTableLookups();
     Function *genFakeLoadFunc(LoadInst *LI);
     Function *replaceLoad(LoadInst *LI);
 
+    void recordFieldUse(GetElementPtrInst *GEPI);
+    void writeFieldUsage(const char *Path);
     void getHostAddrInsts(Function *F, Argument*, HostAddrInsts &);
     void epilogue();
 
@@ -221,17 +282,32 @@ namespace {
   class ConcurrentAT : public ModulePass {
   public:
     static char ID;
-    Intrinsic::ID NvvmTidIID, NvvmCtaidIID;
+    // Thread and lane indices, the sources of divergence in a warp
+    SmallVector<Intrinsic::ID, 4> NvvmTidIIDs;
+    Intrinsic::ID NvvmLaneIdIID, NvvmShflIdxIID, CttzIID;
     bool HasError;
     ConcurrentAT(): ModulePass(ID) {
 #ifndef LLVM_MODULE
-      //llvm::initializeConcurrentATPass(*PassRegistry::getPassRegistry());
+      llvm::initializeConcurrentATPass(*PassRegistry::getPassRegistry());
 #endif
     }
     bool runOnModule(Module &M) override;
   private:
+    Module *module;
+    IntegerType *IT32;
+    // Kernels get the same arguments in all threads
+    set<Function *> Kernels;
+    // Values that may differ between the lanes of a warp
+    set<Value *> Divergent;
     int doConcurrentAT(Function *);
     bool init(Module &M);
+    bool isATCall(Instruction *I);
+    bool isSourceOfDivergence(Instruction *I);
+    bool markSyncDependent(BasicBlock *BB, PostDominatorTree &PDT,
+        LoopInfo &LI);
+    void computeDivergence(Function *F);
+    int batchRelatedATs(Function *F, DominatorTree &DT);
+    void broadcastUniformAT(CallInst *CI);
 
   };
 }
@@ -334,20 +410,7 @@ int8_t OmpTgtAddrTrans::init(Module &M) {
       ATFuncOffsetTy, GlobalValue::ExternalLinkage, "AddrTransOffset2", M);
   ATFuncOffset2->addFnAttr(Attribute::ReadNone);
 
-  //struct ATTableTy *StoreTableShared(
-  //    struct ATTableTy*, struct ATTableTy *sm, int16_t, int32_t)
-  ParamTypes.clear();
-  ParamTypes.push_back(ATTablePtrType);
-  /*
-  ParamTypes.push_back(ATTablePtrType);
-  ParamTypes.push_back(IT8);
-  ParamTypes.push_back(IT32);
-  */
-  FunctionType *STSFuncTy = FunctionType::get(ATTablePtrType, ParamTypes, false);
-  StoreTableFunc = Function::Create(STSFuncTy, GlobalValue::ExternalLinkage,
-      "StoreTableShared", M);
-  //FunctionType *SMFTy = FunctionType::get(Type::getVoidTy(*context),
-  //    ITptr, false);
+  UseConstOffsets = !getenv("OMP_AT_OFFSET_GLOBAL");
 
   // Mask0x7f init
   Mask0x7f = ConstantInt::get(ITptr, 0x00007f0000000000L);
@@ -398,77 +461,277 @@ void OmpTgtAddrTrans::epilogue() {
   }
 }
 
-static bool isRelated(Value *V, set<Value*> &RelatedValues, int limit = 0) {
-  if (!isa<Instruction>(V)) {
+// Calls to the table and offset AT functions. The masking of OMP_AT_MASK is
+// a single or and not worth a shuffle.
+bool ConcurrentAT::isATCall(Instruction *I) {
+  CallInst *CI = dyn_cast<CallInst>(I);
+  if (!CI || !CI->getCalledFunction()) {
     return false;
   }
-  if (limit > 50) {
-    errs() << "[ConcurrentAT] isRelated recursive limit reached\n";
+  StringRef Name = CI->getCalledFunction()->getName();
+  return Name == "AddrTransTable" || Name == "AddrTransTable2" ||
+      Name == "AddrTransOffset" || Name == "AddrTransOffset2";
+}
+
+// Same rules as the NVPTX divergence sources, except that AT calls and other
+// readnone calls only depend on their arguments, and that loads are uniform
+// unless they read thread private memory
+bool ConcurrentAT::isSourceOfDivergence(Instruction *I) {
+  if (I->isAtomic()) {
     return true;
   }
-  User *U = dyn_cast<User>(V);
-  for (auto use : U->operand_values()) {
-    if (RelatedValues.find(use) != RelatedValues.end()) {
-      return true;
-    }
-    if (isRelated(use, RelatedValues, limit+1)) {
-      RelatedValues.insert(V);
+  if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(I)) {
+    if (find(NvvmTidIIDs, II->getIntrinsicID()) != NvvmTidIIDs.end() ||
+        II->getIntrinsicID() == NvvmLaneIdIID) {
       return true;
     }
+    return II->mayWriteToMemory();
+  }
+  if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+    Value *Ptr = LI->getPointerOperand();
+    return LI->getPointerAddressSpace() == 5 ||
+        isa<AllocaInst>(GetUnderlyingObject(Ptr, module->getDataLayout()));
+  }
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    return !isATCall(CI) && !CI->doesNotAccessMemory();
   }
   return false;
 }
 
-int ConcurrentAT::doConcurrentAT(Function *F) {
-  errs() << "Run doConcurrentAT on " << F->getName() << "\n";
-  int mergedCall = 0;
+// The lanes of a warp may take different ways from the divergent branch of
+// BB until they meet at its post dominator. Phis on the way and at the join,
+// and values leaving a loop that lanes exit in different iterations, are
+// divergent.
+bool ConcurrentAT::markSyncDependent(BasicBlock *BB, PostDominatorTree &PDT,
+    LoopInfo &LI) {
+  bool Changed = false;
+  DomTreeNode *Node = PDT.getNode(BB);
+  BasicBlock *Join = nullptr;
+  if (Node && Node->getIDom()) {
+    Join = Node->getIDom()->getBlock();
+  }
+  set<BasicBlock *> Reached;
+  vector<BasicBlock *> Worklist(succ_begin(BB), succ_end(BB));
+  while (!Worklist.empty()) {
+    BasicBlock *Cur = Worklist.back();
+    Worklist.pop_back();
+    if (!Reached.insert(Cur).second || Cur == Join) {
+      continue;
+    }
+    Worklist.insert(Worklist.end(), succ_begin(Cur), succ_end(Cur));
+  }
+  for (BasicBlock *Cur : Reached) {
+    for (PHINode &Phi : Cur->phis()) {
+      Changed |= Divergent.insert(&Phi).second;
+    }
+  }
+  for (Loop *L = LI.getLoopFor(BB); L; L = L->getParentLoop()) {
+    bool Exits = false;
+    for (BasicBlock *Cur : Reached) {
+      Exits |= !L->contains(Cur);
+    }
+    if (!Exits) {
+      break;
+    }
+    for (BasicBlock *LoopBB : L->blocks()) {
+      for (Instruction &I : *LoopBB) {
+        for (User *U : I.users()) {
+          Instruction *UI = dyn_cast<Instruction>(U);
+          if (UI && !L->contains(UI)) {
+            Changed |= Divergent.insert(&I).second;
+            break;
+          }
+        }
+      }
+    }
+  }
+  return Changed;
+}
 
-  // Get idx first
-  set<Value*> TidRelatedValues;
-  for (auto &BB : *F) {
-    for (auto &I : BB) {
-      if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(&I)) {
-        if (II->getIntrinsicID() == NvvmTidIID) {
-          TidRelatedValues.insert(II);
-          continue;
-        } else if (II->getIntrinsicID() == NvvmCtaidIID) {
-          TidRelatedValues.insert(II);
+// Forward propagation from the divergence sources to a fixpoint
+void ConcurrentAT::computeDivergence(Function *F) {
+  Divergent.clear();
+  if (!Kernels.count(F)) {
+    for (Argument &A : F->args()) {
+      Divergent.insert(&A);
+    }
+  }
+  DominatorTree DT(*F);
+  PostDominatorTree PDT(*F);
+  LoopInfo LI(DT);
+  set<BasicBlock *> DivergentBranches;
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (auto &BB : *F) {
+      for (auto &I : BB) {
+        if (Divergent.count(&I)) {
           continue;
         }
+        bool IsDivergent = isSourceOfDivergence(&I);
+        for (Value *Op : I.operand_values()) {
+          IsDivergent |= Divergent.count(Op) > 0;
+        }
+        if (IsDivergent) {
+          Divergent.insert(&I);
+          Changed = true;
+        }
+      }
+    }
+    for (auto &BB : *F) {
+      Instruction *T = BB.getTerminator();
+      if (T && T->getNumSuccessors() > 1 && Divergent.count(T) &&
+          DivergentBranches.insert(&BB).second) {
+        Changed |= markSyncDependent(&BB, PDT, LI);
       }
     }
   }
-  errs() << "dump TidRelatedValues\n";
-  for (auto &V : TidRelatedValues) {
-    V->dump();
-  }
+}
+
+// Translations of addresses at constant offsets from the same base in the
+// same object are one table lookup: translate the lowest address and add
+// the distance to the others
+int ConcurrentAT::batchRelatedATs(Function *F, DominatorTree &DT) {
+  const DataLayout &DL = module->getDataLayout();
+  Type *AddrType = Type::getInt8PtrTy(module->getContext());
+  int Batched = 0;
   for (auto &BB : *F) {
-    int ATCallCount = 0;
-    SmallVector<CallInst*, 4> ATs;
+    typedef tuple<Function *, Value *, Value *> GroupKey;
+    map<GroupKey, vector<pair<CallInst *, int64_t>>> Groups;
+    vector<GroupKey> Order;
     for (auto &I : BB) {
-      if (CallInst *CI = dyn_cast<CallInst>(&I)) {
-        if (isa<IntrinsicInst>(CI)) {
-          continue;
+      if (!isATCall(&I)) {
+        continue;
+      }
+      CallInst *CI = cast<CallInst>(&I);
+      Value *Src = CI->getArgOperand(0)->stripPointerCasts();
+      APInt Offset(DL.getIndexTypeSizeInBits(Src->getType()), 0);
+      Value *Base = Src->stripAndAccumulateInBoundsConstantOffsets(DL, Offset);
+      Value *Extra = nullptr;
+      if (CI->getNumArgOperands() > 1) {
+        Extra = CI->getArgOperand(1);
+      }
+      GroupKey Key(CI->getCalledFunction(), Base, Extra);
+      auto &G = Groups[Key];
+      if (G.empty()) {
+        Order.push_back(Key);
+      }
+      G.push_back(make_pair(CI, Offset.getSExtValue()));
+    }
+    for (auto &Key : Order) {
+      auto &G = Groups[Key];
+      Value *Base = get<1>(Key);
+      CallInst *First = G.front().first;
+      Instruction *BaseI = dyn_cast<Instruction>(Base);
+      if (G.size() < 2 || (BaseI && !DT.dominates(BaseI, First))) {
+        continue;
+      }
+      int64_t MinOffset = G.front().second;
+      for (auto &E : G) {
+        MinOffset = std::min(MinOffset, E.second);
+      }
+      IRBuilder<> B(First);
+      Value *Addr = B.CreateInBoundsGEP(B.getInt8Ty(),
+          B.CreatePointerCast(Base, AddrType), B.getInt64(MinOffset),
+          "BatchedAddr");
+      CallInst *Lead = cast<CallInst>(First->clone());
+      Lead->setArgOperand(0, Addr);
+      Lead->setName("BatchedResult");
+      B.Insert(Lead);
+      if (Divergent.count(Base)) {
+        Divergent.insert(Addr);
+        Divergent.insert(Lead);
+      }
+      for (auto &E : G) {
+        CallInst *CI = E.first;
+        Instruction *PreCastI = dyn_cast<Instruction>(CI->getArgOperand(0));
+        B.SetInsertPoint(CI);
+        Value *Res = B.CreateGEP(B.getInt8Ty(), Lead,
+            B.getInt64(E.second - MinOffset), "TransResult");
+        CI->replaceAllUsesWith(Res);
+        CI->eraseFromParent();
+        if (PreCastI && PreCastI->isCast() && PreCastI->use_empty()) {
+          PreCastI->eraseFromParent();
         }
-        Function *Callee = CI->getCalledFunction();
-        if (false/*Callee == ATFuncTable*/) {
-          CI->dump();
-          bool ret = isRelated(CI, TidRelatedValues);
-          if (ret) {
-            errs() << "Is Related\n";
-          } else {
-            errs() << "Not Related\n";
-          }
-          ATCallCount++;
-          ATs.push_back(CI);
+        if (Divergent.count(Lead)) {
+          Divergent.insert(Res);
         }
       }
+      Batched += G.size() - 1;
+    }
+  }
+  return Batched;
+}
+
+// The address of CI is the same in all active lanes: the first active lane
+// translates it and shuffles the result to the others
+void ConcurrentAT::broadcastUniformAT(CallInst *CI) {
+  const DataLayout &DL = module->getDataLayout();
+  unsigned PtrBits = DL.getPointerSizeInBits();
+  IntegerType *ITptr = IntegerType::get(module->getContext(), PtrBits);
+  InlineAsm *ActiveMask = InlineAsm::get(FunctionType::get(IT32, false),
+      "activemask.b32 $0;", "=r", true);
+  Function *LaneId = Intrinsic::getDeclaration(module, NvvmLaneIdIID);
+  Function *Shfl = Intrinsic::getDeclaration(module, NvvmShflIdxIID);
+  Function *Cttz = Intrinsic::getDeclaration(module, CttzIID, {IT32});
+
+  IRBuilder<> B(CI);
+  Value *Mask = B.CreateCall(ActiveMask, {}, "at.mask");
+  Value *Leader = B.CreateCall(Cttz, {Mask, B.getTrue()}, "at.leader");
+  Value *IsLeader = B.CreateICmpEQ(B.CreateCall(LaneId, {}, "at.lane"),
+      Leader);
+  BasicBlock *Head = CI->getParent();
+  Instruction *ThenTerm = SplitBlockAndInsertIfThen(IsLeader, CI, false);
+  BasicBlock *Then = ThenTerm->getParent();
+  BasicBlock *Tail = ThenTerm->getSuccessor(0);
+  CI->moveBefore(ThenTerm);
+
+  B.SetInsertPoint(&*Tail->getFirstInsertionPt());
+  PHINode *Phi = B.CreatePHI(CI->getType(), 2, "at.lead");
+  Value *Int = B.CreatePtrToInt(Phi, ITptr);
+  Value *Res = nullptr;
+  for (unsigned Bit = 0; Bit < PtrBits; Bit += 32) {
+    Value *Part = B.CreateTrunc(B.CreateLShr(Int, Bit), IT32);
+    Part = B.CreateCall(Shfl, {Mask, Part, Leader, B.getInt32(0x1f)});
+    Part = B.CreateShl(B.CreateZExt(Part, ITptr), Bit);
+    Res = Res ? B.CreateOr(Res, Part) : Part;
+  }
+  Res = B.CreateIntToPtr(Res, CI->getType(), "TransResult");
+  CI->replaceAllUsesWith(Res);
+  Phi->addIncoming(CI, Then);
+  Phi->addIncoming(UndefValue::get(CI->getType()), Head);
+}
+
+int ConcurrentAT::doConcurrentAT(Function *F) {
+  dp() << "Run doConcurrentAT on " << F->getName() << "\n";
+  computeDivergence(F);
+  int mergedCall = 0;
+  {
+    DominatorTree DT(*F);
+    mergedCall += batchRelatedATs(F, DT);
+  }
+
+  vector<CallInst *> UniformATs;
+  for (auto &BB : *F) {
+    for (auto &I : BB) {
+      if (!isATCall(&I)) {
+        continue;
+      }
+      CallInst *CI = cast<CallInst>(&I);
+      bool IsUniform = true;
+      for (Value *Arg : CI->arg_operands()) {
+        IsUniform &= !Divergent.count(Arg);
+      }
+      if (IsUniform) {
+        UniformATs.push_back(CI);
+      }
     }
-    /*
-    for (auto &V : ATs) {
-      V->dump();
-    }*/
   }
+  for (auto CI : UniformATs) {
+    dp() << "Broadcast " << *CI << "\n";
+    broadcastUniformAT(CI);
+  }
+  mergedCall += UniformATs.size();
   return mergedCall;
 }
 
@@ -508,7 +771,11 @@ string OmpTgtAddrTrans::strVal(Value *V) {
 }
 
 DominatorTree &OmpTgtAddrTrans::getDomTree(Function *F) {
-  return getAnalysis<DominatorTreeWrapperPass>(*F).getDomTree();
+  return GetDT(*F);
+}
+
+LoopInfo &OmpTgtAddrTrans::getLoopInfo(Function *F) {
+  return GetLI(*F);
 }
 
 static bool isATFunction(Function *Func) {
@@ -1022,6 +1289,7 @@ void OmpTgtAddrTrans::traceArgInFunc(
           if (typeContainPtr(U->getType())) {
             dp() << "\tGEPI mayContainPtr ";
             dp() << "\n";
+            recordFieldUse(GEPI);
             // FIXME inherit depth??
             Vals.push({U, Depth});
           }
@@ -1163,7 +1431,7 @@ Instruction *OmpTgtAddrTrans::insertATFuncBefore2(Instruction *Inst,
     vector<Value*> Args;
     Args.push_back(PreCastI);
     Args.push_back(getATArg(Inst->getFunction()));
-    if (getenv("OMP_OFFSET_CM")) {
+    if (UseConstOffsets) {
       TransI = CallInst::Create(FunctionCallee(ATFuncOffset2),
           Args, "TransResult");
       // NOTE OFFset2 2nd arg is not used
@@ -1234,7 +1502,7 @@ Instruction *OmpTgtAddrTrans::insertATFuncAfter(Value *V, set<User*> &UserList,
     vector<Value*> Args;
     Args.push_back(PreCastI);
     Args.push_back(getATArg(Inst->getFunction()));
-    if (getenv("OMP_OFFSET_CM")) {
+    if (UseConstOffsets) {
       TransI = CallInst::Create(FunctionCallee(ATFuncOffset2),
           Args, "TransResult");
       // NOTE OFFset2 2nd arg is not used
@@ -1537,63 +1805,242 @@ Function *OmpTgtAddrTrans::replaceLoad(LoadInst *LI) {
   return f;
 }
 
-int16_t OmpTgtAddrTrans::doSharedMemOpt() {
-  // TODO evaluate effect
-
-  // Create shared array
-  // @_ZZ13staticReversePiiE1s =
-  //   internal addrspace(3) global [64 x i32] undef, align 4
-  //   @SMforATTablein = internal addrspace(3) global [480 x i64], align 4
-
-  // Type : intptr * 3 * 20  = 480
-  //ArrayType *SMArrayTy = ArrayType::get(ITptr, ATTableEntyNum * MaxATTableSize);
-  /* ShareMem declared in ob
-  Constant *SMInit = UndefValue::get(SMArrayTy);
-  GlobalVariable *SharedMem = new GlobalVariable(*module, SMArrayTy, false,
-      GlobalValue::LinkageTypes::PrivateLinkage , SMInit, "SMforATTable",
-      nullptr, GlobalValue::ThreadLocalMode::NotThreadLocal, 3);
-  SharedMem->setAlignment(64);
-  */
+// Build AddrTransTableInl(void *, struct ATTableTy *), a drop-in for
+// AddrTransTable2. The table is sorted by descending HstPtrBegin with the
+// entry count in table[0].HstPtrBegin, so the last entry whose begin is above
+// the address is found with a fixed number of probes, each a select. Tables
+// too big for the probes go to AddrTransTable2, the branch is warp uniform.
+Function *OmpTgtAddrTrans::genTableLookupFunc() {
+  int64_t MaxSize = DefaultInlineTableSize;
+  if (char *Env = getenv("OMP_AT_TABLE_SIZE")) {
+    MaxSize = std::max(atol(Env), 1L);
+  }
+  unsigned Steps = 0;
+  while ((1L << Steps) <= MaxSize) {
+    Steps++;
+  }
+  int64_t Limit = (1L << Steps) - 1;
+
+  Function *F = Function::Create(ATFuncTable_tab->getFunctionType(),
+      GlobalValue::InternalLinkage, "AddrTransTableInl", module);
+  // It loads the table, so calls may only be merged while nothing is stored
+  F->addFnAttr(Attribute::ReadOnly);
+  Argument *Addr = F->arg_begin();
+  Argument *Table = F->arg_begin() + 1;
+  BasicBlock *Entry = BasicBlock::Create(*context, "entry", F);
+  BasicBlock *Search = BasicBlock::Create(*context, "search", F);
+  BasicBlock *Slow = BasicBlock::Create(*context, "slow", F);
+  BasicBlock *Done = BasicBlock::Create(*context, "done", F);
+  // Table is constant during the kernel
+  MDNode *Invariant = MDNode::get(*context, None);
+  auto loadField = [&](IRBuilder<> &B, Value *Idx, unsigned Field,
+      const Twine &Name) {
+    Value *P = B.CreateInBoundsGEP(ATTableType, Table,
+        {Idx, B.getInt32(Field)});
+    LoadInst *L = B.CreateLoad(ITptr, P, Name);
+    L->setMetadata(LLVMContext::MD_invariant_load, Invariant);
+    return L;
+  };
+
+  IRBuilder<> B(Entry);
+  Value *Size = loadField(B, ConstantInt::get(ITptr, 0), 0, "size");
+  B.CreateCondBr(B.CreateICmpULE(Size, ConstantInt::get(ITptr, Limit)),
+      Search, Slow);
+
+  B.SetInsertPoint(Search);
+  Value *AddrInt = B.CreatePtrToInt(Addr, ITptr, "addr");
+  Value *Base = ConstantInt::get(ITptr, 0);
+  for (int64_t Step = 1L << (Steps - 1); Step; Step >>= 1) {
+    Value *Cand = B.CreateAdd(Base, ConstantInt::get(ITptr, Step), "cand");
+    Value *InRange = B.CreateICmpULE(Cand, Size);
+    Value *Idx = B.CreateSelect(InRange, Cand, Size);
+    Value *Begin = loadField(B, Idx, 0, "begin");
+    Value *Above = B.CreateAnd(InRange, B.CreateICmpUGT(Begin, AddrInt));
+    Base = B.CreateSelect(Above, Cand, Base, "base");
+  }
+  // First entry beginning at or below the address, or the last one
+  Value *Next = B.CreateAdd(Base, ConstantInt::get(ITptr, 1));
+  Value *Hit = B.CreateSelect(B.CreateICmpULT(Next, Size), Next, Size, "hit");
+  Value *HstBegin = loadField(B, Hit, 0, "hst.begin");
+  Value *HstEnd = loadField(B, Hit, 1, "hst.end");
+  Value *TgtBegin = loadField(B, Hit, 2, "tgt.begin");
+  Value *Found = B.CreateAnd(B.CreateICmpUGE(AddrInt, HstBegin),
+      B.CreateICmpULT(AddrInt, HstEnd));
+  Value *Trans = B.CreateAdd(B.CreateSub(AddrInt, HstBegin), TgtBegin);
+  Value *Res = B.CreateIntToPtr(B.CreateSelect(Found, Trans, AddrInt),
+      AddrType);
+  B.CreateBr(Done);
+
+  B.SetInsertPoint(Slow);
+  Value *SlowRes = B.CreateCall(FunctionCallee(ATFuncTable_tab),
+      {Addr, Table});
+  B.CreateBr(Done);
+
+  B.SetInsertPoint(Done);
+  PHINode *Phi = B.CreatePHI(AddrType, 2, "TransResult");
+  Phi->addIncoming(Res, Search);
+  Phi->addIncoming(SlowRes, Slow);
+  B.CreateRet(Phi);
+  return F;
+}
+
+// Replace the table lookup calls by the body of AddrTransTableInl
+void OmpTgtAddrTrans::inlineTableLookups() {
+  vector<CallInst *> Calls;
+  for (User *U : ATFuncTable_tab->users()) {
+    if (CallInst *CI = dyn_cast<CallInst>(U)) {
+      Calls.push_back(CI);
+    }
+  }
+  if (Calls.empty()) {
+    return;
+  }
+  Function *LookupF = genTableLookupFunc();
+  int Inlined = 0;
+  for (auto CI : Calls) {
+    CI->setCalledFunction(LookupF);
+    InlineFunctionInfo IFI;
+    if (InlineFunction(CI, IFI)) {
+      Inlined++;
+    } else {
+      CI->setCalledFunction(ATFuncTable_tab);
+    }
+  }
+  if (LookupF->use_empty()) {
+    LookupF->eraseFromParent();
+  }
+  dp() << "Inlined " << Inlined << " table lookup\n";
+}
+
+// First instruction of the entry block after the static allocas
+static Instruction *getStagingPoint(Function *F) {
+  BasicBlock::iterator It = F->getEntryBlock().getFirstInsertionPt();
+  while (isa<AllocaInst>(&*It)) {
+    ++It;
+  }
+  return &*It;
+}
+
+// Copy Count elements of Src into the shared array SM at the start of the
+// entry function F. The first warp copies cooperatively and the block waits
+// on a barrier. Returns the pointer translations should read, SM if Count
+// fits in it and Src otherwise. Count may be computed at the top of F.
+Value *OmpTgtAddrTrans::stageToShared(Function *F, GlobalVariable *SM,
+    Value *Src, Value *Count, Intrinsic::ID TidID, Intrinsic::ID BarrierID) {
+  const int64_t WarpSize = 32;
+  ArrayType *SMTy = cast<ArrayType>(SM->getValueType());
+  Type *ElemTy = SMTy->getElementType();
+  BasicBlock *Entry = &F->getEntryBlock();
+  Instruction *SplitPt = getStagingPoint(F);
+  if (Instruction *CountI = dyn_cast<Instruction>(Count)) {
+    SplitPt = CountI->getNextNode();
+  }
+  BasicBlock *Rest = SplitBlock(Entry, SplitPt);
+  BasicBlock *Copy = BasicBlock::Create(*context, "sm.copy", F, Rest);
+  BasicBlock *Sync = BasicBlock::Create(*context, "sm.sync", F, Rest);
+  Entry->getTerminator()->eraseFromParent();
+
+  IRBuilder<> B(Entry);
+  Value *Fits = B.CreateICmpULE(Count,
+      ConstantInt::get(ITptr, SMTy->getNumElements()), "sm.fits");
+  Value *Tid = B.CreateZExt(
+      B.CreateCall(Intrinsic::getDeclaration(module, TidID)), ITptr, "tid");
+  Value *DoCopy = B.CreateAnd(Fits, B.CreateAnd(
+      B.CreateICmpULT(Tid, ConstantInt::get(ITptr, WarpSize)),
+      B.CreateICmpULT(Tid, Count)));
+  B.CreateCondBr(DoCopy, Copy, Sync);
+
+  B.SetInsertPoint(Copy);
+  PHINode *I = B.CreatePHI(ITptr, 2, "sm.i");
+  I->addIncoming(Tid, Entry);
+  Value *Elem = B.CreateLoad(ElemTy, B.CreateInBoundsGEP(ElemTy, Src, I));
+  B.CreateStore(Elem, B.CreateInBoundsGEP(SMTy, SM,
+      {ConstantInt::get(ITptr, 0), I}));
+  Value *Next = B.CreateAdd(I, ConstantInt::get(ITptr, WarpSize));
+  I->addIncoming(Next, Copy);
+  B.CreateCondBr(B.CreateICmpULT(Next, Count), Copy, Sync);
+
+  B.SetInsertPoint(Sync);
+  B.CreateCall(Intrinsic::getDeclaration(module, BarrierID));
+  Value *SMPtr = B.CreateAddrSpaceCast(B.CreateConstInBoundsGEP2_64(SM, 0, 0),
+      Src->getType(), "SM2GenericAddr");
+  Value *Res = B.CreateSelect(Fits, SMPtr, Src, "ATArgStaged");
+  B.CreateBr(Rest);
+  return Res;
+}
 
-  Function *TidFunc = module->getFunction("llvm.nvvm.read.ptx.sreg.tid.x");
-  if (!TidFunc) {
-    dp() <<  "llvm.nvvm.read.ptx.sreg.tid.x is not found\n";
+// Stage the AT table (OMP_AT_TABLE) or the offset list (OMP_AT_OFFSET) of
+// each entry function into shared memory once per block. OMP_AT_SM_SIZE sets
+// the shared table entries, bigger tables are read from global memory. The
+// constant memory offsets are not staged.
+int16_t OmpTgtAddrTrans::doSharedMemOpt() {
+  Intrinsic::ID TidID =
+      Function::lookupIntrinsicID("llvm.nvvm.read.ptx.sreg.tid.x");
+  Intrinsic::ID BarrierID = Function::lookupIntrinsicID("llvm.nvvm.barrier0");
+  if (TidID == Intrinsic::not_intrinsic ||
+      BarrierID == Intrinsic::not_intrinsic) {
+    dp() << "nvvm intrinsics are not found\n";
     return FAILED;
   }
+  uint64_t TableSize = 64;
+  if (char *Env = getenv("OMP_AT_SM_SIZE")) {
+    TableSize = std::max(atol(Env), 1L);
+  }
+  // Sync with the offset list allocated by libomptarget
+  const uint64_t OffsetListSize = 32;
+  GlobalVariable *TableSM = nullptr, *OffsetSM = nullptr;
+  auto createSM = [&](Type *ElemTy, uint64_t N, const Twine &Name) {
+    ArrayType *Ty = ArrayType::get(ElemTy, N);
+    auto *GV = new GlobalVariable(*module, Ty, false,
+        GlobalValue::InternalLinkage, UndefValue::get(Ty), Name, nullptr,
+        GlobalValue::NotThreadLocal, 3);
+    GV->setAlignment(16);
+    return GV;
+  };
 
-  // Run from each entry
-  for (auto E : FunctionTransEntry) {
-    Function *F = E.second[OMP_AT_TABLE];
-    if (!F) {
-      break;
+  int Staged = 0;
+  for (auto &E : FunctionTransEntry) {
+    for (auto &Ver : E.second) {
+      Function *F = Ver.second;
+      if (!F || F->isDeclaration()) {
+        continue;
+      }
+      Argument *ATArg = getATArg(F);
+      if (ATArg->use_empty()) {
+        continue;
+      }
+      vector<Use *> Uses;
+      for (Use &U : ATArg->uses()) {
+        Uses.push_back(&U);
+      }
+      Value *Staging;
+      if (Ver.first == OMP_AT_TABLE) {
+        if (!TableSM) {
+          TableSM = createSM(ATTableType, TableSize, "SMforATTable");
+        }
+        // Entry count is in the header, which is copied as well
+        IRBuilder<> B(getStagingPoint(F));
+        Value *Size = B.CreateLoad(ITptr,
+            B.CreateInBoundsGEP(ATTableType, ATArg,
+              {ConstantInt::get(ITptr, 0), B.getInt32(0)}), "at.size");
+        Value *Count = B.CreateAdd(Size, ConstantInt::get(ITptr, 1));
+        Staging = stageToShared(F, TableSM, ATArg, Count, TidID, BarrierID);
+      } else if (Ver.first == OMP_AT_OFFSET && !UseConstOffsets) {
+        if (!OffsetSM) {
+          OffsetSM = createSM(ITptr, OffsetListSize, "SMforATOffset");
+        }
+        Staging = stageToShared(F, OffsetSM, ATArg,
+            ConstantInt::get(ITptr, OffsetListSize), TidID, BarrierID);
+      } else {
+        continue;
+      }
+      for (Use *U : Uses) {
+        U->set(Staging);
+      }
+      Staged++;
     }
-    Instruction *FirstInst = &*F->begin()->begin();
-    // NO -> Find first use of table
-    // insert AddrSpaceCast as first
-
-    /*
-    CastInst *SM2GenericAddr = CastInst::Create(Instruction::AddrSpaceCast,
-        SharedMem, ATTablePtrType, "SM2GenericAddr", FirstInst);
-        */
-    // insert callinst
-    //struct ATTableTy *(struct ATTableTy*, struct ATTableTy *sm, int16, int32)
-    vector<Value*> StoreTableCallArgs;
-    Value *ATArg = getATArg(F);
-    StoreTableCallArgs.push_back(ATArg);
-
-    //auto *DummyInst = new AllocaInst(ATArg->getType(), 0, "dummy", &F->front());
-    auto *DummyInst = new BitCastInst(ATArg, ATArg->getType(), "dummy", &F->front());
-    ATArg->replaceAllUsesWith(DummyInst);
-
-    CallInst *NewTableAddr = CallInst::Create(
-        StoreTableFunc->getFunctionType(), StoreTableFunc,
-        StoreTableCallArgs, "NewTableAddr", FirstInst);
-
-    // replace use
-    DummyInst->replaceAllUsesWith(NewTableAddr);
-    DummyInst->dropAllReferences();
-    DummyInst->eraseFromParent();
   }
+  dp() << "Staged AT data of " << Staged << " kernels in shared memory\n";
   return SUCCESS;
 }
 
@@ -1685,7 +2132,441 @@ void OmpTgtAddrTrans::getHostAddrInsts(Function *F,
   }
 }
 
+// Call to one of the AT functions or the masking inserted for OMP_AT_MASK
+bool OmpTgtAddrTrans::isTransInst(Instruction *I) {
+  if (CallInst *CI = dyn_cast<CallInst>(I)) {
+    Function *Callee = CI->getCalledFunction();
+    return Callee == ATFuncTable || Callee == ATFuncTable_tab ||
+        Callee == ATFuncMask || Callee == ATFuncOffset ||
+        Callee == ATFuncOffset2;
+  }
+  return I->getOpcode() == Instruction::Or && I->getMetadata("at");
+}
+
+// The source pointer of a translation, with the inserted pre-cast skipped
+static Value *getTransSource(Instruction *TransI) {
+  Value *Src;
+  if (CallInst *CI = dyn_cast<CallInst>(TransI)) {
+    return CI->getArgOperand(0)->stripPointerCasts();
+  }
+  Src = TransI->getOperand(1);
+  if (PtrToIntInst *PI = dyn_cast<PtrToIntInst>(Src)) {
+    return PI->getPointerOperand()->stripPointerCasts();
+  }
+  return Src;
+}
+
+// Move TransI and its pre-cast to the preheader of L if they only depend on
+// values defined outside L. AT functions are readnone, so this is safe.
+bool OmpTgtAddrTrans::hoistATCall(Instruction *TransI, Loop *L) {
+  BasicBlock *Preheader = L->getLoopPreheader();
+  if (!Preheader) {
+    return false;
+  }
+  vector<Instruction *> Chain;
+  for (Value *Op : TransI->operands()) {
+    if (L->isLoopInvariant(Op)) {
+      continue;
+    }
+    Instruction *OpI = dyn_cast<Instruction>(Op);
+    if (!OpI || !OpI->isCast() || !OpI->hasOneUse() ||
+        !L->isLoopInvariant(OpI->getOperand(0))) {
+      return false;
+    }
+    Chain.push_back(OpI);
+  }
+  Chain.push_back(TransI);
+  for (Instruction *I : Chain) {
+    I->moveBefore(Preheader->getTerminator());
+  }
+  dp() << "Hoisted " << strVal(TransI) << "\n";
+  return true;
+}
+
+// Device memory the runtime hands out to the kernel
+static bool isDeviceAllocCall(Value *V) {
+  CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI || !CI->getCalledFunction()) {
+    return false;
+  }
+  StringRef Name = CI->getCalledFunction()->getName();
+  return Name == "malloc" || Name == "__kmpc_data_sharing_push_stack" ||
+      Name == "__kmpc_data_sharing_coalesced_push_stack";
+}
+
+// True if every value V may come from is a device address: allocas, globals,
+// non-generic address spaces, device allocations and translation results,
+// through casts, GEPs, phis, selects and loads of private allocas that only
+// ever hold such values. The host pointers traced by traceArgInFunc come from
+// the arguments and from loads of mapped memory, and stay unknown.
+bool OmpTgtAddrTrans::isDeviceAddr(Value *V) {
+  set<Value *> Visited;
+  vector<Value *> Worklist;
+  Worklist.push_back(V);
+  while (!Worklist.empty()) {
+    Value *Cur = Worklist.back();
+    Worklist.pop_back();
+    if (!Visited.insert(Cur).second) {
+      continue;
+    }
+    if (isa<ConstantPointerNull>(Cur) || isa<UndefValue>(Cur) ||
+        isa<GlobalValue>(Cur) || isa<AllocaInst>(Cur) ||
+        isDeviceAllocCall(Cur)) {
+      continue;
+    }
+    if (PointerType *PT = dyn_cast<PointerType>(Cur->getType())) {
+      if (PT->getAddressSpace() != 0) {
+        continue;
+      }
+    }
+    Instruction *I = dyn_cast<Instruction>(Cur);
+    if (!I) {
+      return false;
+    }
+    if (isTransInst(I)) {
+      continue;
+    }
+    if (isa<IntToPtrInst>(I) || isa<PtrToIntInst>(I) || isa<BitCastInst>(I) ||
+        isa<AddrSpaceCastInst>(I)) {
+      Worklist.push_back(I->getOperand(0));
+    } else if (GetElementPtrInst *GEPI = dyn_cast<GetElementPtrInst>(I)) {
+      Worklist.push_back(GEPI->getPointerOperand());
+    } else if (PHINode *Phi = dyn_cast<PHINode>(I)) {
+      Worklist.insert(Worklist.end(), Phi->incoming_values().begin(),
+          Phi->incoming_values().end());
+    } else if (SelectInst *SI = dyn_cast<SelectInst>(I)) {
+      Worklist.push_back(SI->getTrueValue());
+      Worklist.push_back(SI->getFalseValue());
+    } else if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+      // The alloca must not escape, then its stores are all it holds
+      AllocaInst *AI = dyn_cast<AllocaInst>(
+          GetUnderlyingObject(LI->getPointerOperand(),
+              module->getDataLayout()));
+      if (!AI) {
+        return false;
+      }
+      vector<Value *> Addrs(1, AI);
+      set<Value *> SeenAddrs;
+      while (!Addrs.empty()) {
+        Value *Addr = Addrs.back();
+        Addrs.pop_back();
+        if (!SeenAddrs.insert(Addr).second) {
+          continue;
+        }
+        for (User *U : Addr->users()) {
+          if (isa<LoadInst>(U)) {
+            continue;
+          }
+          StoreInst *Store = dyn_cast<StoreInst>(U);
+          if (Store && Store->getValueOperand() != Addr) {
+            Worklist.push_back(Store->getValueOperand());
+          } else if (isa<BitCastInst>(U) || isa<GetElementPtrInst>(U)) {
+            Addrs.push_back(U);
+          } else if (IntrinsicInst *II = dyn_cast<IntrinsicInst>(U)) {
+            if (!II->isLifetimeStartOrEnd()) {
+              return false;
+            }
+          } else {
+            return false;
+          }
+        }
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Drop the translations of pointers that are device addresses already
+void OmpTgtAddrTrans::skipDeviceATs(Function *F) {
+  vector<Instruction *> TransInsts;
+  for (auto &BB : *F) {
+    for (auto &I : BB) {
+      if (isTransInst(&I) && isDeviceAddr(getTransSource(&I))) {
+        TransInsts.push_back(&I);
+      }
+    }
+  }
+  for (auto TransI : TransInsts) {
+    dp() << "Skip device address " << strVal(TransI) << "\n";
+    // The pre-cast has the type of the result, the mask is an integer or
+    TransI->replaceAllUsesWith(
+        TransI->getOperand(isa<CallInst>(TransI) ? 0 : 1));
+    TransI->eraseFromParent();
+    SkippedATCount++;
+  }
+}
+
+// A noalias argument whose memory is only ever read, through the argument
+// itself or through its translations. Captures and unknown calls count as
+// writes.
+bool OmpTgtAddrTrans::isReadOnlyNoAliasArg(Argument *A) {
+  if (!A->getType()->isPointerTy() || !A->hasNoAliasAttr()) {
+    return false;
+  }
+  if (A->onlyReadsMemory()) {
+    return true;
+  }
+  set<Value *> Visited;
+  vector<Value *> Worklist(1, A);
+  while (!Worklist.empty()) {
+    Value *Cur = Worklist.back();
+    Worklist.pop_back();
+    if (!Visited.insert(Cur).second) {
+      continue;
+    }
+    for (User *U : Cur->users()) {
+      Instruction *I = dyn_cast<Instruction>(U);
+      if (!I) {
+        return false;
+      }
+      if (LoadInst *LI = dyn_cast<LoadInst>(I)) {
+        if (LI->isVolatile()) {
+          return false;
+        }
+        continue;
+      }
+      if (isa<ICmpInst>(I)) {
+        continue;
+      }
+      if (isTransInst(I) || isa<CastInst>(I) || isa<GetElementPtrInst>(I) ||
+          isa<PHINode>(I) || isa<SelectInst>(I)) {
+        Worklist.push_back(I);
+        continue;
+      }
+      if (CallInst *CI = dyn_cast<CallInst>(I)) {
+        if (CI->onlyReadsMemory()) {
+          Worklist.push_back(I);
+          continue;
+        }
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+// Kernel arguments that are noalias and never written hold the same values
+// for the whole kernel, which is what !invariant.load means. Mark the loads
+// through their translations, the underlying object of those is the AT call
+// and the arguments cannot be seen by NVPTX or the alias analysis anymore.
+void OmpTgtAddrTrans::markInvariantLoads(Function *F) {
+  const DataLayout &DL = module->getDataLayout();
+  MDNode *Empty = MDNode::get(*context, {});
+  map<Argument *, bool> ReadOnly;
+  for (auto &BB : *F) {
+    for (auto &I : BB) {
+      if (!isTransInst(&I)) {
+        continue;
+      }
+      Argument *A = dyn_cast<Argument>(
+          GetUnderlyingObject(getTransSource(&I), DL));
+      if (!A) {
+        continue;
+      }
+      auto Found = ReadOnly.find(A);
+      if (Found == ReadOnly.end()) {
+        Found = ReadOnly.insert(make_pair(A, isReadOnlyNoAliasArg(A))).first;
+      }
+      if (!Found->second) {
+        continue;
+      }
+      // Only addresses computed from the translation, a phi or select may
+      // mix in other pointers
+      vector<Value *> Addrs(1, &I);
+      while (!Addrs.empty()) {
+        Value *Addr = Addrs.back();
+        Addrs.pop_back();
+        for (User *U : Addr->users()) {
+          if (LoadInst *LI = dyn_cast<LoadInst>(U)) {
+            if (LI->isSimple() && LI->getPointerOperand() == Addr &&
+                !LI->getMetadata(LLVMContext::MD_invariant_load)) {
+              LI->setMetadata(LLVMContext::MD_invariant_load, Empty);
+              InvariantLoadCount++;
+            }
+          } else if (isa<CastInst>(U) || isa<GetElementPtrInst>(U)) {
+            Addrs.push_back(U);
+          }
+        }
+      }
+    }
+  }
+}
+
+// For a loop over a list or tree
+//   p = phi [p0, preheader], [n, latch]
+//   t = AT(p)
+//   n = load (t + Off)
+// translate n once it is loaded and prefetch the same field of the next node
+// to L2, so the next hop overlaps with the rest of the iteration. The load
+// of n is moved up to its address first if nothing in between may write
+// memory. A null n prefetches the current node instead.
+void OmpTgtAddrTrans::prefetchPointerChase(Function *F) {
+  const DataLayout &DL = module->getDataLayout();
+  LoopInfo &LInfo = getLoopInfo(F);
+  // Translation, translated pointer and load of the next node
+  vector<tuple<Instruction *, Value *, LoadInst *>> Chases;
+  for (auto &BB : *F) {
+    for (auto &I : BB) {
+      if (!isTransInst(&I)) {
+        continue;
+      }
+      PHINode *Phi = dyn_cast<PHINode>(getTransSource(&I));
+      Loop *L = Phi ? LInfo.getLoopFor(Phi->getParent()) : nullptr;
+      if (!L || L->getHeader() != Phi->getParent() || !L->getLoopLatch()) {
+        continue;
+      }
+      LoadInst *Next = dyn_cast<LoadInst>(
+          Phi->getIncomingValueForBlock(L->getLoopLatch())
+              ->stripPointerCasts());
+      if (!Next || !Next->isSimple() || !L->contains(Next)) {
+        continue;
+      }
+      int64_t Off;
+      Value *Base = GetPointerBaseWithConstantOffset(
+          Next->getPointerOperand(), Off, DL);
+      CastInst *PostCastI = dyn_cast<CastInst>(Base);
+      if (Base != &I && !(PostCastI && PostCastI->getOperand(0) == &I)) {
+        continue;
+      }
+      Chases.push_back(make_tuple(&I, Base, Next));
+    }
+  }
+
+  InlineAsm *Prefetch = InlineAsm::get(
+      FunctionType::get(Type::getVoidTy(*context),
+                        {PointerType::get(IT8, 1)}, false),
+      "prefetch.global.L2 [$0];", "l", true);
+  ATVer Mode = CurATMode;
+  for (auto &E : Chases) {
+    Instruction *TransI = get<0>(E);
+    LoadInst *Next = get<2>(E);
+    Instruction *Addr = dyn_cast<Instruction>(Next->getPointerOperand());
+    Instruction *Pos = Addr && Addr->getParent() == Next->getParent()
+        ? Addr->getNextNode() : &*Next->getParent()->getFirstInsertionPt();
+    bool CanHoist = true;
+    for (Instruction *I = Pos; I != Next; I = I->getNextNode()) {
+      if (I->mayWriteToMemory() || isa<PHINode>(I)) {
+        CanHoist = false;
+        break;
+      }
+    }
+    if (CanHoist && Pos != Next) {
+      Next->moveBefore(Pos);
+    }
+
+    int64_t Off;
+    GetPointerBaseWithConstantOffset(Next->getPointerOperand(), Off, DL);
+    IRBuilder<> B(Next->getNextNode());
+    Value *NextPtr = B.CreatePointerCast(Next, AddrType);
+    Value *Cur = B.CreatePointerCast(get<1>(E), AddrType);
+    Value *Target = B.CreateSelect(
+        B.CreateICmpEQ(NextPtr, ConstantPointerNull::get(AddrType)),
+        Cur, NextPtr, "chase.next");
+    CallInst *CI = B.CreateCall(Prefetch,
+        {UndefValue::get(PointerType::get(IT8, 1))});
+    // The translation goes in between the select and the prefetch, in the
+    // mode of the loop's own translation
+    if (CallInst *Call = dyn_cast<CallInst>(TransI)) {
+      Function *Callee = Call->getCalledFunction();
+      CurATMode = Callee == ATFuncOffset || Callee == ATFuncOffset2
+          ? OMP_AT_OFFSET : OMP_AT_TABLE;
+    } else {
+      CurATMode = OMP_AT_MASK;
+    }
+    B.SetInsertPoint(CI);
+    Instruction *Trans = insertATFuncBefore2(CI, Target);
+    Value *Field = B.CreateConstGEP1_64(
+        B.CreatePointerCast(Trans, PointerType::get(IT8, 0)), Off);
+    CI->setArgOperand(0, B.CreateAddrSpaceCast(Field,
+        PointerType::get(IT8, 1)));
+    PrefetchCount++;
+  }
+  CurATMode = Mode;
+}
+
+void OmpTgtAddrTrans::optimizeATCalls(Function *F) {
+  vector<Instruction *> TransInsts;
+  for (auto &BB : *F) {
+    for (auto &I : BB) {
+      if (isTransInst(&I)) {
+        TransInsts.push_back(&I);
+      }
+    }
+  }
+  if (TransInsts.empty()) {
+    return;
+  }
+  LoopInfo &LI = getLoopInfo(F);
+  DominatorTree &DT = getDomTree(F);
+
+  // Hoist loop-invariant translations as far out as possible
+  for (auto TransI : TransInsts) {
+    while (Loop *L = LI.getLoopFor(TransI->getParent())) {
+      if (!hoistATCall(TransI, L)) {
+        break;
+      }
+      HoistedATCount++;
+    }
+  }
+
+  // Reuse a dominating translation of the same pointer
+  typedef tuple<Value *, Value *, Value *> TransKey;
+  map<TransKey, vector<Instruction *>> Groups;
+  for (auto TransI : TransInsts) {
+    Value *Kind, *Extra = nullptr;
+    if (CallInst *CI = dyn_cast<CallInst>(TransI)) {
+      Kind = CI->getCalledFunction();
+      if (CI->getNumArgOperands() > 1) {
+        Extra = CI->getArgOperand(1);
+      }
+    } else {
+      Kind = TransI->getOperand(0);
+    }
+    Groups[TransKey(Kind, getTransSource(TransI), Extra)].push_back(TransI);
+  }
+  for (auto &G : Groups) {
+    vector<Instruction *> &Insts = G.second;
+    vector<Instruction *> Kept;
+    for (auto TransI : Insts) {
+      Instruction *Dom = nullptr;
+      for (auto K : Kept) {
+        if (DT.dominates(K, TransI)) {
+          Dom = K;
+          break;
+        }
+      }
+      if (!Dom) {
+        Kept.push_back(TransI);
+        continue;
+      }
+      dp() << "Reuse " << strVal(Dom) << "for " << strVal(TransI) << "\n";
+      Instruction *PreCastI = dyn_cast<Instruction>(
+          TransI->getOperand(isa<CallInst>(TransI) ? 0 : 1));
+      TransI->replaceAllUsesWith(Dom);
+      TransI->eraseFromParent();
+      if (PreCastI && PreCastI->isCast() && PreCastI->use_empty()) {
+        PreCastI->eraseFromParent();
+      }
+      ReusedATCount++;
+    }
+  }
+}
+
 bool OmpTgtAddrTrans::runOnModule(Module &M) {
+  return runImpl(M, [this](Function &F) -> DominatorTree & {
+    return getAnalysis<DominatorTreeWrapperPass>(F).getDomTree();
+  }, [this](Function &F) -> LoopInfo & {
+    return getAnalysis<LoopInfoWrapperPass>(F).getLoopInfo();
+  });
+}
+
+bool OmpTgtAddrTrans::runImpl(Module &M,
+    function<DominatorTree &(Function &)> DTGetter,
+    function<LoopInfo &(Function &)> LIGetter) {
+  GetDT = DTGetter;
+  GetLI = LIGetter;
   dp() << "Entering OmpTgtAddrTrans\n";
   IsDebug = (bool) getenv("DP2");
   //IsNaiveAT = (bool) getenv("OMP_NAIVE_AT");
@@ -1857,22 +2738,120 @@ bool OmpTgtAddrTrans::runOnModule(Module &M) {
     }
   }
 skip_old:
+  if (!getenv("OMP_AT_NOOPT")) {
+    for (auto &F : M) {
+      if (!F.isDeclaration()) {
+        skipDeviceATs(&F);
+        optimizeATCalls(&F);
+      }
+    }
+    // Only the arguments of kernels are unchanged for the whole launch
+    for (auto &E : FunctionTransEntry) {
+      for (auto &Ver : E.second) {
+        markInvariantLoads(Ver.second);
+      }
+    }
+  }
+  if (getenv("OMP_AT_PREFETCH") && Triple(M.getTargetTriple()).isNVPTX()) {
+    for (auto &F : M) {
+      if (!F.isDeclaration()) {
+        prefetchPointerChase(&F);
+      }
+    }
+  }
+  // Before the lookups are inlined, the leader lane then runs the search
+  if (getenv("OMP_AT_CONCURRENT")) {
+    ConcurrentAT().runOnModule(M);
+  }
+  if (!getenv("OMP_AT_TABLE_CALL")) {
+    inlineTableLookups();
+  }
   epilogue();
 
 
-  //doSharedMemOpt();
+  if (getenv("OMP_AT_SHARED")) {
+    doSharedMemOpt();
+  }
+  if (char *Path = getenv("OMP_AT_FIELD_USAGE")) {
+    writeFieldUsage(Path);
+  }
   dp() << "Inserted " << InsertedATCount << " address tranlation\n";
+  dp() << "Hoisted " << HoistedATCount << ", reused " << ReusedATCount
+       << ", skipped " << SkippedATCount << " address tranlation\n";
+  dp() << "Marked " << InvariantLoadCount << " invariant loads\n";
+  dp() << "Prefetched " << PrefetchCount << " pointer chases\n";
   dp() << "OmpTgtAddrTrans Finished\n";
 
   return changed;
 }
 
+// Name of a struct as clang looks it up, without the ".N" suffix of renamed
+// types. Empty for anonymous structs, they cannot be told apart.
+static string getFieldUsageName(StructType *ST) {
+  if (!ST->hasName()) {
+    return "";
+  }
+  StringRef Name = ST->getName();
+  StringRef Base, Suffix;
+  std::tie(Base, Suffix) = Name.rsplit('.');
+  if (Base.contains('.') && !Suffix.empty() &&
+      Suffix.find_first_not_of("0123456789") == StringRef::npos) {
+    Name = Base;
+  }
+  if (Name.split('.').second.startswith("anon")) {
+    return "";
+  }
+  return Name.str();
+}
+
+// Fields of named structs a traced pointer is taken from, e.g.
+//   getelementptr %struct.S, %struct.S* %p, i64 %i, i32 2, i32 1
+// records field 2 of S and field 1 of the struct field 2 holds
+void OmpTgtAddrTrans::recordFieldUse(GetElementPtrInst *GEPI) {
+  const DataLayout &DL = module->getDataLayout();
+  Type *Ty = GEPI->getSourceElementType();
+  for (unsigned I = 2; I <= GEPI->getNumIndices(); ++I) {
+    if (auto *ST = dyn_cast<StructType>(Ty)) {
+      auto *Field = dyn_cast<ConstantInt>(GEPI->getOperand(I));
+      if (!Field) {
+        return;
+      }
+      string Name = getFieldUsageName(ST);
+      if (!Name.empty()) {
+        FieldUsage[Name].insert(
+            DL.getStructLayout(ST)->getElementOffset(Field->getZExtValue()));
+      }
+      Ty = ST->getElementType(Field->getZExtValue());
+    } else if (auto *SeqTy = dyn_cast<SequentialType>(Ty)) {
+      Ty = SeqTy->getElementType();
+    } else {
+      return;
+    }
+  }
+}
+
+// Appended, so that the kernels of all translation units end up in one file
+void OmpTgtAddrTrans::writeFieldUsage(const char *Path) {
+  std::error_code EC;
+  raw_fd_ostream OS(Path, EC, sys::fs::OF_Append | sys::fs::OF_Text);
+  if (EC) {
+    errs() << "[OmpTgtAddrTrans] Cannot write " << Path << ": "
+           << EC.message() << "\n";
+    return;
+  }
+  for (auto &E : FieldUsage) {
+    for (uint64_t Offset : E.second) {
+      OS << E.first << " " << Offset << "\n";
+    }
+  }
+}
+
 void OmpTgtAddrTrans::getAnalysisUsage(AnalysisUsage &AU) const {
-  AU.setPreservesCFG();
+  // inlineTableLookups adds blocks
 //  AU.addRequired<MemoryDependenceWrapperPass>();
   AU.addRequired<DominatorTreeWrapperPass>();
 //  AU.addRequired<AAResultsWrapperPass>();
-//  AU.addRequired<LoopInfoWrapperPass>();
+  AU.addRequired<LoopInfoWrapperPass>();
 //  AU.getRequiredSet();
 }
 
@@ -1982,15 +2961,46 @@ bool RestoreLoad::runOnModule(Module &M) {
 
 bool ConcurrentAT::init(Module &M) {
   HasError = false;
-  NvvmTidIID = Function::lookupIntrinsicID("llvm.nvvm.read.ptx.sreg.tid.x");
-  if (NvvmTidIID == Intrinsic::not_intrinsic) {
-    errs() << "nvvm tid intrinsic not found";
+  module = &M;
+  IT32 = IntegerType::get(M.getContext(), 32);
+  NvvmTidIIDs.clear();
+  for (const char *Dim : {"x", "y", "z"}) {
+    Intrinsic::ID IID = Function::lookupIntrinsicID(
+        string("llvm.nvvm.read.ptx.sreg.tid.") + Dim);
+    if (IID == Intrinsic::not_intrinsic) {
+      errs() << "nvvm tid intrinsic not found";
+      HasError = true;
+    }
+    NvvmTidIIDs.push_back(IID);
+  }
+  NvvmLaneIdIID = Function::lookupIntrinsicID("llvm.nvvm.read.ptx.sreg.laneid");
+  NvvmShflIdxIID = Function::lookupIntrinsicID("llvm.nvvm.shfl.sync.idx.i32");
+  CttzIID = Function::lookupIntrinsicID("llvm.cttz.i32");
+  if (NvvmLaneIdIID == Intrinsic::not_intrinsic ||
+      NvvmShflIdxIID == Intrinsic::not_intrinsic ||
+      CttzIID == Intrinsic::not_intrinsic) {
+    errs() << "nvvm laneid or shfl intrinsic not found";
     HasError = true;
   }
-  NvvmCtaidIID = Function::lookupIntrinsicID("llvm.nvvm.read.ptx.sreg.ctaid.x");
-  if (NvvmCtaidIID == Intrinsic::not_intrinsic) {
-    errs() << "nvvm ttaid intrinsic not found";
+
+  Kernels.clear();
+  NamedMDNode *NVVM = M.getNamedMetadata("nvvm.annotations");
+  if (!NVVM) {
     HasError = true;
+    return false;
+  }
+  for (const auto &MD : NVVM->operands()) {
+    if (MD->getNumOperands() != 3 || !MD->getOperand(0) ||
+        !MD->getOperand(1)) {
+      continue;
+    }
+    auto *VAM = dyn_cast<ValueAsMetadata>(MD->getOperand(0).get());
+    auto *MDS = dyn_cast<MDString>(MD->getOperand(1).get());
+    if (VAM && MDS && MDS->getString() == "kernel") {
+      if (Function *F = dyn_cast<Function>(VAM->getValue())) {
+        Kernels.insert(F);
+      }
+    }
   }
   return true;
 }
@@ -2001,12 +3011,12 @@ bool ConcurrentAT::runOnModule(Module &M) {
   }
   int Count = 0;
   for (auto &F : M) {
-    if (!isATFunction(&F)) {
+    if (!isATFunction(&F) || F.isDeclaration()) {
       continue;
     }
     Count += doConcurrentAT(&F);
   }
-  errs() << "Merged " << Count << " ATCalls\n";
+  dp() << "Merged " << Count << " ATCalls\n";
   return Count > 0;
 }
 
@@ -2037,23 +3047,73 @@ static RegisterPass<OmpTgtAddrTrans> Y(PassBreifName, Description);
 
 static RegisterPass<RestoreLoad> X(PassBreifName2, Description2);
 
-//static RegisterPass<ConcurrentAT> Z(PassBreifName3, Description3);
+static RegisterPass<ConcurrentAT> Z(PassBreifName3, Description3);
 
 #else
 INITIALIZE_PASS(OmpTgtAddrTrans, PassBreifName, Description, false, false)
 INITIALIZE_PASS(RestoreLoad, PassBreifName2, Description2, false, false)
-//INITIALIZE_PASS(ConcurrentAT, PassBreifName2, Description2, false, false)
+INITIALIZE_PASS(ConcurrentAT, PassBreifName3, Description3, false, false)
 ModulePass *llvm::createOmpTgtAddrTransPass() {
   return new OmpTgtAddrTrans();
 }
 ModulePass *llvm::createRestoreLoadPass() {
   return new RestoreLoad();
 }
-/*
 ModulePass *llvm::createConcurrentATPass() {
   return new ConcurrentAT();
 }
-*/
+#endif
+
+// The new pass manager versions share the function analyses cached by the
+// surrounding pipeline
+PreservedAnalyses OmpTgtAddrTransPass::run(Module &M,
+    ModuleAnalysisManager &AM) {
+  auto &FAM = AM.getResult<FunctionAnalysisManagerModuleProxy>(M).getManager();
+  bool Changed = OmpTgtAddrTrans().runImpl(M,
+      [&FAM](Function &F) -> DominatorTree & {
+    return FAM.getResult<DominatorTreeAnalysis>(F);
+  }, [&FAM](Function &F) -> LoopInfo & {
+    return FAM.getResult<LoopAnalysis>(F);
+  });
+  return Changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+}
+
+PreservedAnalyses RestoreLoadPass::run(Module &M, ModuleAnalysisManager &AM) {
+  if (!RestoreLoad().runOnModule(M)) {
+    return PreservedAnalyses::all();
+  }
+  PreservedAnalyses PA;
+  PA.preserveSet<CFGAnalyses>();
+  return PA;
+}
+
+PreservedAnalyses ConcurrentATPass::run(Module &M, ModuleAnalysisManager &AM) {
+  if (!ConcurrentAT().runOnModule(M)) {
+    return PreservedAnalyses::all();
+  }
+  return PreservedAnalyses::none();
+}
+
+#ifdef LLVM_MODULE
+// opt -load-pass-plugin LLVMOmpTgtAddrTrans.so -passes=ompat
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "OmpTgtAddrTrans", LLVM_VERSION_STRING,
+    [](PassBuilder &PB) {
+      PB.registerPipelineParsingCallback([](StringRef Name,
+          ModulePassManager &MPM, ArrayRef<PassBuilder::PipelineElement>) {
+        if (Name == PassBreifName) {
+          MPM.addPass(OmpTgtAddrTransPass());
+        } else if (Name == PassBreifName2) {
+          MPM.addPass(RestoreLoadPass());
+        } else if (Name == PassBreifName3) {
+          MPM.addPass(ConcurrentATPass());
+        } else {
+          return false;
+        }
+        return true;
+      });
+    }};
+}
 #endif
 
 //  Add pass dependency
@@ -712,6 +712,11 @@ PreservedAnalyses LoopLoadEliminationPass::run(Function &F,
   if (!Changed)
     return PreservedAnalyses::all();
 
+  // The loop versioning updates the dominator tree and the loop info as it
+  // goes, like in the legacy pass.
   PreservedAnalyses PA;
+  PA.preserve<LoopAnalysis>();
+  PA.preserve<DominatorTreeAnalysis>();
+  PA.preserve<GlobalsAA>();
   return PA;
 }
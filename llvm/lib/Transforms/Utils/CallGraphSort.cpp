@@ -0,0 +1,170 @@
+//===- CallGraphSort.cpp - Call-Chain Clustering of a call graph ----------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+///
+/// Implementation of Call-Chain Clustering from: Optimizing Function Placement
+/// for Large-Scale Data-Center Applications
+/// https://research.fb.com/wp-content/uploads/2017/01/cgo2017-hfsort-final1.pdf
+///
+/// The goal of this algorithm is to improve runtime performance of the final
+/// executable by arranging code such that page table and i-cache misses are
+/// minimized.
+///
+/// Definitions:
+/// * Cluster
+///   * An ordered list of nodes which are layed out as a unit. At the
+///     beginning of the algorithm each node has its own cluster and the weight
+///     of the cluster is the sum of the weight of all incomming edges.
+/// * Call-Chain Clustering (C³) Heuristic
+///   * Defines when and how clusters are combined. Pick the highest weighted
+///     node then add it to its most likely predecessor if it wouldn't
+///     penalize it too much.
+/// * Density
+///   * The weight of the cluster divided by the size of the cluster. This is a
+///     proxy for the ammount of execution time spent per byte of the cluster.
+///
+/// It does so given a weighted call graph by the following:
+/// * Sort nodes by weight
+/// * For each node starting with the highest weight
+///   * Find its most likely predecessor cluster
+///   * Check if the combined cluster would be too large, or would have too low
+///     a density.
+///   * If not, then combine the clusters.
+/// * Sort non-empty clusters by density
+///
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/CallGraphSort.h"
+#include "llvm/ADT/STLExtras.h"
+
+using namespace llvm;
+
+namespace {
+struct Edge {
+  int From;
+  uint64_t Weight;
+};
+
+struct Cluster {
+  Cluster(int Node, uint64_t S) : Nodes{Node}, Size(S) {}
+
+  double getDensity() const {
+    if (Size == 0)
+      return 0;
+    return double(Weight) / double(Size);
+  }
+
+  std::vector<int> Nodes;
+  uint64_t Size = 0;
+  uint64_t Weight = 0;
+  uint64_t InitialWeight = 0;
+  Edge BestPred = {-1, 0};
+};
+} // end anonymous namespace
+
+// Maximum ammount the combined cluster density can be worse than the original
+// cluster to consider merging.
+static constexpr int MAX_DENSITY_DEGRADATION = 8;
+
+// Maximum cluster size in bytes.
+static constexpr uint64_t MAX_CLUSTER_SIZE = 1024 * 1024;
+
+// It's bad to merge clusters which would degrade the density too much.
+static bool isNewDensityBad(Cluster &A, Cluster &B) {
+  double NewDensity = double(A.Weight + B.Weight) / double(A.Size + B.Size);
+  return NewDensity < A.getDensity() / MAX_DENSITY_DEGRADATION;
+}
+
+static void mergeClusters(Cluster &Into, Cluster &From) {
+  Into.Nodes.insert(Into.Nodes.end(), From.Nodes.begin(), From.Nodes.end());
+  Into.Size += From.Size;
+  Into.Weight += From.Weight;
+  From.Nodes.clear();
+  From.Size = 0;
+  From.Weight = 0;
+}
+
+std::vector<unsigned>
+llvm::computeCallGraphSortOrder(ArrayRef<uint64_t> NodeSizes,
+                                ArrayRef<CallGraphSortEdge> Edges) {
+  std::vector<Cluster> Clusters;
+  for (size_t I = 0; I < NodeSizes.size(); ++I)
+    Clusters.emplace_back(I, NodeSizes[I]);
+
+  // Create the graph.
+  for (const CallGraphSortEdge &E : Edges) {
+    Cluster &ToC = Clusters[E.To];
+    ToC.Weight += E.Weight;
+
+    if (E.From == E.To)
+      continue;
+
+    // Remember the best edge.
+    if (ToC.BestPred.From == -1 || ToC.BestPred.Weight < E.Weight) {
+      ToC.BestPred.From = E.From;
+      ToC.BestPred.Weight = E.Weight;
+    }
+  }
+  for (Cluster &C : Clusters)
+    C.InitialWeight = C.Weight;
+
+  // Group nodes into clusters using the Call-Chain Clustering heuristic then
+  // sort the clusters by density.
+  std::vector<int> SortedNodes(Clusters.size());
+  std::vector<Cluster *> NodeToCluster(Clusters.size());
+
+  for (size_t I = 0; I < Clusters.size(); ++I) {
+    SortedNodes[I] = I;
+    NodeToCluster[I] = &Clusters[I];
+  }
+
+  llvm::stable_sort(SortedNodes, [&](int A, int B) {
+    return Clusters[A].getDensity() > Clusters[B].getDensity();
+  });
+
+  for (int NI : SortedNodes) {
+    // Clusters[NI] is the same as NodeToCluster[NI] here because it has not
+    // been merged into another cluster yet.
+    Cluster &C = Clusters[NI];
+
+    // Don't consider merging if the edge is unlikely.
+    if (C.BestPred.From == -1 || C.BestPred.Weight * 10 <= C.InitialWeight)
+      continue;
+
+    Cluster *PredC = NodeToCluster[C.BestPred.From];
+    if (PredC == &C)
+      continue;
+
+    if (C.Size + PredC->Size > MAX_CLUSTER_SIZE)
+      continue;
+
+    if (isNewDensityBad(*PredC, C))
+      continue;
+
+    // NOTE: Consider using a disjoint-set to track node -> cluster mapping
+    // if this is ever slow.
+    for (int N : C.Nodes)
+      NodeToCluster[N] = PredC;
+
+    mergeClusters(*PredC, C);
+  }
+
+  // Remove empty or dead nodes. Invalidates all cluster indices.
+  llvm::erase_if(Clusters, [](const Cluster &C) {
+    return C.Size == 0 || C.Nodes.empty();
+  });
+
+  // Sort by density.
+  llvm::stable_sort(Clusters, [](const Cluster &A, const Cluster &B) {
+    return A.getDensity() > B.getDensity();
+  });
+
+  std::vector<unsigned> Order;
+  for (const Cluster &C : Clusters)
+    Order.insert(Order.end(), C.Nodes.begin(), C.Nodes.end());
+  return Order;
+}
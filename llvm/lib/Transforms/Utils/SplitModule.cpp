@@ -21,6 +21,7 @@
 #include "llvm/IR/Comdat.h"
 #include "llvm/IR/Constant.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/DerivedTypes.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/GlobalAlias.h"
 #include "llvm/IR/GlobalObject.h"
@@ -37,6 +38,7 @@
 #include "llvm/Support/MD5.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/Transforms/Utils/FunctionImportUtils.h"
 #include "llvm/Transforms/Utils/ValueMapper.h"
 #include <algorithm>
 #include <cassert>
@@ -224,8 +226,8 @@ static void externalize(GlobalValue *GV) {
     GV->setName("__llvmsplit_unnamed");
 }
 
-// Returns whether GV should be in partition (0-based) I of N.
-static bool isInPartition(const GlobalValue *GV, unsigned I, unsigned N) {
+// Returns the partition (0-based) of N that GV should be in.
+static unsigned getPartition(const GlobalValue *GV, unsigned N) {
   if (auto *GIS = dyn_cast<GlobalIndirectSymbol>(GV))
     if (const GlobalObject *Base = GIS->getBaseObject())
       GV = Base;
@@ -243,28 +245,48 @@ static bool isInPartition(const GlobalValue *GV, unsigned I, unsigned N) {
   MD5::MD5Result R;
   H.update(Name);
   H.final(R);
-  return (R[0] | (R[1] << 8)) % N == I;
+  return (R[0] | (R[1] << 8)) % N;
 }
 
-void llvm::SplitModule(
-    std::unique_ptr<Module> M, unsigned N,
-    function_ref<void(std::unique_ptr<Module> MPart)> ModuleCallback,
+void llvm::computeSplitModulePartitions(
+    Module &M, unsigned N,
+    function_ref<void(const GlobalValue &GV, unsigned Partition)>
+        PartitionCallback,
     bool PreserveLocals) {
   if (!PreserveLocals) {
-    for (Function &F : *M)
+    for (Function &F : M)
       externalize(&F);
-    for (GlobalVariable &GV : M->globals())
+    for (GlobalVariable &GV : M.globals())
       externalize(&GV);
-    for (GlobalAlias &GA : M->aliases())
+    for (GlobalAlias &GA : M.aliases())
       externalize(&GA);
-    for (GlobalIFunc &GIF : M->ifuncs())
+    for (GlobalIFunc &GIF : M.ifuncs())
       externalize(&GIF);
   }
 
   // This performs splitting without a need for externalization, which might not
   // always be possible.
   ClusterIDMapType ClusterIDMap;
-  findPartitions(M.get(), ClusterIDMap, N);
+  findPartitions(&M, ClusterIDMap, N);
+
+  for (const GlobalValue &GV : M.global_values()) {
+    if (GV.isDeclaration())
+      continue;
+    auto It = ClusterIDMap.find(&GV);
+    PartitionCallback(GV, It != ClusterIDMap.end() ? It->second
+                                                   : getPartition(&GV, N));
+  }
+}
+
+void llvm::SplitModule(
+    std::unique_ptr<Module> M, unsigned N,
+    function_ref<void(std::unique_ptr<Module> MPart)> ModuleCallback,
+    bool PreserveLocals) {
+  ClusterIDMapType PartitionOf;
+  computeSplitModulePartitions(
+      *M, N,
+      [&](const GlobalValue &GV, unsigned I) { PartitionOf[&GV] = I; },
+      PreserveLocals);
 
   // FIXME: We should be able to reuse M as the last partition instead of
   // cloning it.
@@ -272,13 +294,29 @@ void llvm::SplitModule(
     ValueToValueMapTy VMap;
     std::unique_ptr<Module> MPart(
         CloneModule(*M, VMap, [&](const GlobalValue *GV) {
-          if (ClusterIDMap.count(GV))
-            return (ClusterIDMap[GV] == I);
-          else
-            return isInPartition(GV, I, N);
+          return PartitionOf.lookup(GV) == I;
         }));
     if (I != 0)
       MPart->setModuleInlineAsm("");
     ModuleCallback(std::move(MPart));
   }
 }
+
+Error llvm::materializeSplitModulePartition(
+    Module &M, const StringMap<unsigned> &PartitionOf, unsigned I) {
+  std::vector<GlobalValue *> DroppedIndirectSymbols;
+  for (GlobalValue &GV : M.global_values()) {
+    if (GV.isDeclaration())
+      continue;
+    auto It = PartitionOf.find(GV.getName());
+    if (It == PartitionOf.end() || It->second == I)
+      continue;
+    if (!convertToDeclaration(GV))
+      DroppedIndirectSymbols.push_back(&GV);
+  }
+  for (GlobalValue *GV : DroppedIndirectSymbols)
+    GV->eraseFromParent();
+  if (I != 0)
+    M.setModuleInlineAsm("");
+  return M.materializeAll();
+}
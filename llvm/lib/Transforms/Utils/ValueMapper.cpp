@@ -932,12 +932,9 @@ void Mapper::remapInstruction(Instruction *I) {
   }
   if (auto *AI = dyn_cast<AllocaInst>(I))
     AI->setAllocatedType(TypeMapper->remapType(AI->getAllocatedType()));
-  if (auto *GEP = dyn_cast<GetElementPtrInst>(I)) {
+  if (auto *GEP = dyn_cast<GetElementPtrInst>(I))
     GEP->setSourceElementType(
         TypeMapper->remapType(GEP->getSourceElementType()));
-    GEP->setResultElementType(
-        TypeMapper->remapType(GEP->getResultElementType()));
-  }
   I->mutateType(TypeMapper->remapType(I->getType()));
 }
 
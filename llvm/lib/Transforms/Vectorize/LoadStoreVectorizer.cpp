@@ -622,6 +622,9 @@ Vectorizer::getVectorizablePrefix(ArrayRef<Instruction *> Chain) {
   }
 
   OrderedBasicBlock OBB(Chain[0]->getParent());
+  // The IR does not change while the prefix is computed, so the alias queries
+  // below can share their state, e.g. the decomposition of each pointer.
+  BatchAAResults BatchAA(AA);
 
   // Loop until we find an instruction in ChainInstrs that we can't vectorize.
   unsigned ChainInstrIdx = 0;
@@ -666,8 +669,8 @@ Vectorizer::getVectorizablePrefix(ArrayRef<Instruction *> Chain) {
           (IsInvariantLoad(MemLoad) || OBB.dominates(MemLoad, ChainInstr)))
         continue;
 
-      if (!AA.isNoAlias(MemoryLocation::get(MemInstr),
-                        MemoryLocation::get(ChainInstr))) {
+      if (!BatchAA.isNoAlias(MemoryLocation::get(MemInstr),
+                             MemoryLocation::get(ChainInstr))) {
         LLVM_DEBUG({
           dbgs() << "LSV: Found alias:\n"
                     "  Aliasing instruction and pointer:\n"
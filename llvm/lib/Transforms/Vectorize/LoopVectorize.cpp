@@ -260,6 +260,21 @@ cl::opt<bool> EnableVPlanNativePath(
     cl::desc("Enable VPlan-native vectorization path with "
              "support for outer loop vectorization."));
 
+static cl::opt<bool> VPlanNativeCostModel(
+    "vplan-native-cost-model", cl::init(true), cl::Hidden,
+    cl::desc("Only vectorize outer loops in the VPlan-native path without a "
+             "user provided VF when the cost model expects a speedup."));
+
+static cl::opt<unsigned> VPlanNativeInnerTripCount(
+    "vplan-native-inner-trip-count", cl::init(8), cl::Hidden,
+    cl::desc("The trip count the VPlan-native path cost model assumes for "
+             "inner loops whose trip count is unknown."));
+
+static cl::opt<unsigned> VPlanNativeMaxInnerTripCount(
+    "vplan-native-max-inner-trip-count", cl::init(1024), cl::Hidden,
+    cl::desc("The largest trip count the VPlan-native path cost model weighs "
+             "an inner loop by."));
+
 // FIXME: Remove this switch once we have divergence analysis. Currently we
 // assume divergent non-backedge branches when this switch is true.
 cl::opt<bool> EnableVPlanPredication(
@@ -872,6 +887,12 @@ public:
     collectInstsToScalarize(UserVF);
   }
 
+  /// \return The expected cost of one iteration of the outer loop vectorized
+  /// by the VPlan-native path with vectorization factor \p VF, a factor of one
+  /// being the cost of the scalar loop nest. The blocks of inner loops are
+  /// weighted by their trip count.
+  uint64_t expectedVPlanNativeCost(unsigned VF);
+
   /// \return The size (in bits) of the smallest and widest types in the code
   /// that needs to be vectorized. We ignore values that remain scalar such as
   /// 64 bit loop indices.
@@ -1208,6 +1229,11 @@ private:
   /// width. Vector width of one means scalar.
   VectorizationCostTy getInstructionCost(Instruction *I, unsigned VF);
 
+  /// Returns the execution time cost of an instruction of an outer loop in
+  /// the VPlan-native path, where the analyses behind getInstructionCost are
+  /// not run.
+  unsigned getVPlanNativeInstructionCost(Instruction *I, unsigned VF);
+
   /// The cost-computation logic from getInstructionCost which provides
   /// the vector type as an output parameter.
   unsigned getInstructionCost(Instruction *I, unsigned VF, Type *&VectorTy);
@@ -5455,6 +5481,32 @@ LoopVectorizationCostModel::expectedCost(unsigned VF) {
   return Cost;
 }
 
+uint64_t LoopVectorizationCostModel::expectedVPlanNativeCost(unsigned VF) {
+  uint64_t Cost = 0;
+  for (BasicBlock *BB : TheLoop->blocks()) {
+    uint64_t BlockCost = 0;
+    for (Instruction &I : BB->instructionsWithoutDebug()) {
+      unsigned C = getVPlanNativeInstructionCost(&I, VF);
+      if (ForceTargetInstructionCost.getNumOccurrences() > 0)
+        C = ForceTargetInstructionCost;
+      BlockCost += C;
+      LLVM_DEBUG(dbgs() << "LV: Found an estimated cost of " << C
+                        << " for VF " << VF << " For instruction: " << I
+                        << '\n');
+    }
+
+    // The body of an inner loop runs for every iteration of that loop, in
+    // the scalar and in the vector loop nest alike.
+    for (Loop *L = LI->getLoopFor(BB); L != TheLoop; L = L->getParentLoop()) {
+      unsigned TC = PSE.getSE()->getSmallConstantTripCount(L);
+      BlockCost *= TC ? std::min(TC, VPlanNativeMaxInnerTripCount.getValue())
+                      : VPlanNativeInnerTripCount.getValue();
+    }
+    Cost += BlockCost;
+  }
+  return Cost;
+}
+
 /// Gets Address Access SCEV after verifying that the access pattern
 /// is loop invariant except the induction variable dependence.
 ///
@@ -5668,6 +5720,64 @@ LoopVectorizationCostModel::getInstructionCost(Instruction *I, unsigned VF) {
   return VectorizationCostTy(C, TypeNotScalarized);
 }
 
+unsigned
+LoopVectorizationCostModel::getVPlanNativeInstructionCost(Instruction *I,
+                                                          unsigned VF) {
+  // The VPlan-native path widens every instruction but the branches, which
+  // stay uniform, and turns all memory accesses into gathers and scatters.
+  Type *VectorTy = ToVectorTy(I->getType(), VF);
+  switch (I->getOpcode()) {
+  case Instruction::GetElementPtr:
+    // As for inner loops, the address computation is accounted for by the
+    // memory access.
+    return 0;
+  case Instruction::Br: {
+    // A conditional branch tests the first lane of its widened condition.
+    unsigned Cost = TTI.getCFInstrCost(Instruction::Br);
+    if (VF > 1 && cast<BranchInst>(I)->isConditional())
+      Cost += TTI.getVectorInstrCost(
+          Instruction::ExtractElement,
+          VectorType::get(Type::getInt1Ty(I->getContext()), VF), 0);
+    return Cost;
+  }
+  case Instruction::PHI:
+    return TTI.getCFInstrCost(Instruction::PHI);
+  case Instruction::Load:
+  case Instruction::Store:
+    if (VF == 1)
+      return getMemoryInstructionCost(I, VF);
+    return getGatherScatterCost(I, VF);
+  case Instruction::ICmp:
+  case Instruction::FCmp:
+    return TTI.getCmpSelInstrCost(I->getOpcode(),
+                                  ToVectorTy(I->getOperand(0)->getType(), VF),
+                                  nullptr, VF == 1 ? I : nullptr);
+  case Instruction::Select:
+    return TTI.getCmpSelInstrCost(I->getOpcode(), VectorTy,
+                                  ToVectorTy(I->getOperand(0)->getType(), VF),
+                                  VF == 1 ? I : nullptr);
+  case Instruction::Call: {
+    bool NeedToScalarize;
+    CallInst *CI = cast<CallInst>(I);
+    unsigned CallCost = getVectorCallCost(CI, VF, NeedToScalarize);
+    if (getVectorIntrinsicIDForCall(CI, TLI))
+      return std::min(CallCost, getVectorIntrinsicCost(CI, VF));
+    return CallCost;
+  }
+  default:
+    if (I->isBinaryOp() || I->isUnaryOp())
+      return TTI.getArithmeticInstrCost(I->getOpcode(), VectorTy);
+    if (I->isCast())
+      return TTI.getCastInstrCost(I->getOpcode(), VectorTy,
+                                  ToVectorTy(I->getOperand(0)->getType(), VF),
+                                  VF == 1 ? I : nullptr);
+    // The cost of executing VF copies of the scalar instruction, as for inner
+    // loops.
+    return VF * TTI.getArithmeticInstrCost(Instruction::Mul, VectorTy) +
+           getScalarizationOverhead(I, VF);
+  }
+}
+
 unsigned LoopVectorizationCostModel::getScalarizationOverhead(Instruction *I,
                                                               unsigned VF) {
 
@@ -6181,7 +6291,24 @@ LoopVectorizationPlanner::planInVPlanNativePath(bool OptForSize,
     if (VPlanBuildStressTest)
       return VectorizationFactor::Disabled();
 
-    return {VF, 0};
+    if (VF < 2)
+      return VectorizationFactor::Disabled();
+
+    // Respect a user provided VF, only check the computed one pays off.
+    uint64_t VectorCost = CM.expectedVPlanNativeCost(VF);
+    if (!UserVF && VPlanNativeCostModel) {
+      uint64_t ScalarCost = CM.expectedVPlanNativeCost(1);
+      LLVM_DEBUG(dbgs() << "LV: Outer loop costs " << ScalarCost
+                        << " scalar and " << VectorCost << " for VF " << VF
+                        << ".\n");
+      if (VectorCost >= ScalarCost * VF) {
+        LLVM_DEBUG(dbgs() << "LV: Not vectorizing the outer loop: "
+                          << "vectorization is not beneficial.\n");
+        return VectorizationFactor::Disabled();
+      }
+    }
+
+    return {VF, unsigned(std::min<uint64_t>(VectorCost, UINT_MAX))};
   }
 
   LLVM_DEBUG(
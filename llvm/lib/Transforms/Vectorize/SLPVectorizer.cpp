@@ -118,6 +118,11 @@ static cl::opt<bool>
 ShouldVectorizeHor("slp-vectorize-hor", cl::init(true), cl::Hidden,
                    cl::desc("Attempt to vectorize horizontal reductions"));
 
+static cl::opt<bool> ShouldVectorizeStridedLoads(
+    "slp-vectorize-strided-loads", cl::init(true), cl::Hidden,
+    cl::desc("Attempt to vectorize loads at a constant stride with a masked "
+             "gather where the target supports them"));
+
 static cl::opt<bool> ShouldStartVectorizeHorAtStore(
     "slp-vectorize-hor-store", cl::init(false), cl::Hidden,
     cl::desc(
@@ -485,6 +490,32 @@ static bool isSimple(Instruction *I) {
   return true;
 }
 
+/// \returns True if the pointers \p PointerOps, in this order, are a constant
+/// non-zero stride apart, and sets \p Offsets to their distance in bytes from
+/// the first pointer.
+static bool getConstantStrideOffsets(ArrayRef<Value *> PointerOps,
+                                     ScalarEvolution &SE,
+                                     SmallVectorImpl<int64_t> &Offsets) {
+  Offsets.assign(1, 0);
+  const SCEV *Scev0 = SE.getSCEV(PointerOps.front());
+  int64_t Stride = 0;
+  for (unsigned I = 1, E = PointerOps.size(); I != E; ++I) {
+    if (PointerOps[I]->getType() != PointerOps.front()->getType())
+      return false;
+    const auto *Diff = dyn_cast<SCEVConstant>(
+        SE.getMinusSCEV(SE.getSCEV(PointerOps[I]), Scev0));
+    if (!Diff || Diff->getAPInt().getMinSignedBits() > 32)
+      return false;
+    int64_t Offset = Diff->getAPInt().getSExtValue();
+    if (I == 1)
+      Stride = Offset;
+    if (Stride == 0 || Offset != Stride * I)
+      return false;
+    Offsets.push_back(Offset);
+  }
+  return true;
+}
+
 namespace llvm {
 
 namespace slpvectorizer {
@@ -1326,6 +1357,10 @@ private:
   /// Vectorize a single entry in the tree.
   Value *vectorizeTree(TreeEntry *E);
 
+  /// Vectorize the loads at a constant stride of \p E into a masked gather
+  /// of type \p VecTy.
+  Value *vectorizeStridedLoads(TreeEntry *E, VectorType *VecTy);
+
   /// Vectorize a single entry in the tree, starting in \p VL.
   Value *vectorizeTree(ArrayRef<Value *> VL);
 
@@ -1381,6 +1416,10 @@ private:
     /// Do we need to gather this sequence ?
     bool NeedToGather = false;
 
+    /// Are the Scalars loads at a constant stride, which are vectorized with
+    /// a masked gather rather than a wide load?
+    bool IsStridedLoad = false;
+
     /// Does this sequence require some shuffling?
     SmallVector<unsigned, 4> ReuseShuffleIndices;
 
@@ -1457,6 +1496,7 @@ private:
       for (Value *V : Scalars)
         dbgs().indent(2) << *V << "\n";
       dbgs() << "NeedToGather: " << NeedToGather << "\n";
+      dbgs() << "IsStridedLoad: " << IsStridedLoad << "\n";
       dbgs() << "VectorizedValue: ";
       if (VectorizedValue)
         dbgs() << *VectorizedValue;
@@ -2492,6 +2532,19 @@ void BoUpSLP::buildTree_rec(ArrayRef<Value *> VL, unsigned Depth,
         }
       }
 
+      // Loads at a constant stride, such as the same field of consecutive
+      // elements of an array of structures, can still be loaded at once.
+      SmallVector<int64_t, 4> Offsets;
+      if (ShouldVectorizeStridedLoads &&
+          TTI->isLegalMaskedGather(VectorType::get(ScalarTy, VL.size())) &&
+          getConstantStrideOffsets(PointerOps, *SE, Offsets)) {
+        TreeEntry *TE = newTreeEntry(VL, /*Vectorized=*/true, UserTreeIdx,
+                                     ReuseShuffleIndicies);
+        TE->IsStridedLoad = true;
+        LLVM_DEBUG(dbgs() << "SLP: added a vector of strided loads.\n");
+        return;
+      }
+
       LLVM_DEBUG(dbgs() << "SLP: Gathering non-consecutive loads.\n");
       BS.cancelScheduling(VL, VL0);
       newTreeEntry(VL, false, UserTreeIdx, ReuseShuffleIndicies);
@@ -3162,8 +3215,16 @@ int BoUpSLP::getEntryCost(TreeEntry *E) {
         ReuseShuffleCost -= (ReuseShuffleNumbers - VL.size()) * ScalarEltCost;
       }
       int ScalarLdCost = VecTy->getNumElements() * ScalarEltCost;
-      int VecLdCost =
-          TTI->getMemoryOpCost(Instruction::Load, VecTy, alignment, 0, VL0);
+      int VecLdCost;
+      if (E->IsStridedLoad)
+        VecLdCost = TTI->getAddressComputationCost(VecTy) +
+                    TTI->getGatherScatterOpCost(
+                        Instruction::Load, VecTy,
+                        cast<LoadInst>(VL0)->getPointerOperand(),
+                        /*VariableMask=*/false, alignment);
+      else
+        VecLdCost =
+            TTI->getMemoryOpCost(Instruction::Load, VecTy, alignment, 0, VL0);
       if (!E->ReorderIndices.empty()) {
         // TODO: Merge this shuffle with the ReuseShuffleCost.
         VecLdCost += TTI->getShuffleCost(
@@ -3672,6 +3733,46 @@ static void inversePermutation(ArrayRef<unsigned> Indices,
     Mask[Indices[I]] = I;
 }
 
+Value *BoUpSLP::vectorizeStridedLoads(TreeEntry *E, VectorType *VecTy) {
+  SmallVector<Value *, 4> PointerOps;
+  unsigned Alignment = 0;
+  for (Value *V : E->Scalars) {
+    auto *LI = cast<LoadInst>(V);
+    PointerOps.push_back(LI->getPointerOperand());
+    unsigned LIAlignment = LI->getAlignment();
+    if (!LIAlignment)
+      LIAlignment = DL->getABITypeAlignment(LI->getType());
+    Alignment = Alignment ? std::min(Alignment, LIAlignment) : LIAlignment;
+  }
+  SmallVector<int64_t, 4> Offsets;
+  bool IsStrided = getConstantStrideOffsets(PointerOps, *SE, Offsets);
+  assert(IsStrided && "Expected loads at a constant stride");
+  (void)IsStrided;
+
+  // Address the elements by their byte offset from the first one.
+  Value *Ptr0 = PointerOps.front();
+  unsigned AS = Ptr0->getType()->getPointerAddressSpace();
+  Value *Base = Builder.CreateBitCast(Ptr0, Builder.getInt8PtrTy(AS));
+  SmallVector<Constant *, 4> OffsetVals;
+  for (int64_t Offset : Offsets)
+    OffsetVals.push_back(Builder.getInt64(Offset));
+  Value *Ptrs = Builder.CreateGEP(Builder.getInt8Ty(), Base,
+                                  ConstantVector::get(OffsetVals));
+
+  // The pointer operand uses an in-tree scalar so we add its user to the
+  // ExternalUses list to make sure that an extract will be generated in the
+  // future.
+  if (getTreeEntry(Ptr0))
+    ExternalUses.push_back(
+        ExternalUser(Ptr0, cast<User>(Base != Ptr0 ? Base : Ptrs), 0));
+
+  Ptrs = Builder.CreateBitCast(
+      Ptrs, VectorType::get(VecTy->getElementType()->getPointerTo(AS),
+                            VecTy->getNumElements()));
+  Instruction *Gather = Builder.CreateMaskedGather(Ptrs, Alignment);
+  return propagateMetadata(Gather, E->Scalars);
+}
+
 Value *BoUpSLP::vectorizeTree(TreeEntry *E) {
   IRBuilder<>::InsertPointGuard Guard(Builder);
 
@@ -3969,6 +4070,16 @@ Value *BoUpSLP::vectorizeTree(TreeEntry *E) {
       }
       setInsertPointAfterBundle(E->Scalars, S);
 
+      if (E->IsStridedLoad) {
+        Value *V = vectorizeStridedLoads(E, VecTy);
+        if (NeedToShuffleReuses)
+          V = Builder.CreateShuffleVector(V, UndefValue::get(VecTy),
+                                          E->ReuseShuffleIndices, "shuffle");
+        E->VectorizedValue = V;
+        ++NumVectorInstructions;
+        return V;
+      }
+
       LoadInst *LI = cast<LoadInst>(VL0);
       Type *ScalarLoadTy = LI->getType();
       unsigned AS = LI->getPointerAddressSpace();
@@ -121,6 +121,13 @@ public:
   DIEInfo &getInfo(unsigned Idx) { return Info[Idx]; }
   const DIEInfo &getInfo(unsigned Idx) const { return Info[Idx]; }
 
+  /// Release the per-DIE bookkeeping and the parsed input DIEs once the
+  /// unit has been cloned. Only the unit header is used afterwards.
+  void clearDIEInfo() {
+    std::vector<DIEInfo>().swap(Info);
+    OrigUnit.clearDIEs(/*KeepCUDie=*/false);
+  }
+
   uint64_t getStartOffset() const { return StartOffset; }
   uint64_t getNextUnitOffset() const { return NextUnitOffset; }
   void setStartOffset(uint64_t DebugInfoSize) { StartOffset = DebugInfoSize; }
@@ -2399,6 +2399,14 @@ void DwarfLinker::DIECloner::cloneAllCompileUnits(
                                           ProcessExpr);
   }
 
+  // Cross-unit references into the input DIEs are resolved while cloning,
+  // so once every unit of the object has been cloned the input DIE arrays
+  // and the per-DIE info are dead. Drop them now rather than when the
+  // object is done: the output DIEs of all the units are still alive at
+  // this point and this keeps the peak footprint of the object down.
+  for (auto &CurrentUnit : CompileUnits)
+    CurrentUnit->clearDIEInfo();
+
   if (Linker.Options.NoOutput)
     return;
 
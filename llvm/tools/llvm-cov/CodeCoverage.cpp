@@ -145,6 +145,9 @@ private:
   /// The architecture the coverage mapping data targets.
   std::vector<StringRef> CoverageArches;
 
+  /// The directory in which the loaded coverage mapping is cached, if any.
+  std::string CacheDir;
+
   /// A cache for demangled symbols.
   DemangleCache DC;
 
@@ -352,7 +355,8 @@ std::unique_ptr<CoverageMapping> CodeCoverageTool::load() {
       warning("profile data may be out of date - object is newer",
               ObjectFilename);
   auto CoverageOrErr =
-      CoverageMapping::load(ObjectFilenames, PGOFilename, CoverageArches);
+      CoverageMapping::load(ObjectFilenames, PGOFilename, CoverageArches,
+                            ViewOpts.NumThreads, CacheDir);
   if (Error E = CoverageOrErr.takeError()) {
     error("Failed to load coverage: " + toString(std::move(E)),
           join(ObjectFilenames.begin(), ObjectFilenames.end(), ", "));
@@ -555,6 +559,12 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
       cl::desc(
           "File with the profile data obtained after an instrumented run"));
 
+  cl::opt<std::string, true> CacheDir(
+      "cache-dir", cl::Optional, cl::location(this->CacheDir),
+      cl::desc("Cache the loaded coverage data in the given directory, so "
+               "that reports for the same binaries and profile skip decoding "
+               "it again"));
+
   cl::list<std::string> Arches(
       "arch", cl::desc("architectures of the coverage mapping binaries"));
 
@@ -647,7 +657,8 @@ int CodeCoverageTool::run(Command Cmd, int argc, const char **argv) {
 
   cl::opt<unsigned> NumThreads(
       "num-threads", cl::init(0),
-      cl::desc("Number of merge threads to use (default: autodetect)"));
+      cl::desc("Number of threads to use for loading and merging coverage "
+               "data (default: autodetect)"));
   cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
                         cl::aliasopt(NumThreads));
 
@@ -10,7 +10,9 @@
 #include "BenchmarkResult.h"
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/MC/MCAsmInfo.h"
+#include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
+#include <cmath>
 #include <limits>
 #include <unordered_set>
 #include <vector>
@@ -252,6 +254,29 @@ Analysis::makePointsPerSchedClass() const {
 
 // Uops repeat the same opcode over again. Just show this opcode and show the
 // whole snippet only on hover.
+std::vector<Analysis::SchedClassCluster>
+Analysis::makeSchedClassClusters(llvm::ArrayRef<size_t> PointIds) const {
+  std::vector<SchedClassCluster> SchedClassClusters;
+  for (const size_t PointId : PointIds) {
+    const auto &ClusterId = Clustering_.getClusterIdForPoint(PointId);
+    if (!ClusterId.isValid())
+      continue; // Ignore noise and errors. FIXME: take noise into account ?
+    if (ClusterId.isUnstable() ^ AnalysisDisplayUnstableOpcodes_)
+      continue; // Either display stable or unstable clusters only.
+    auto SchedClassClusterIt =
+        std::find_if(SchedClassClusters.begin(), SchedClassClusters.end(),
+                     [ClusterId](const SchedClassCluster &C) {
+                       return C.id() == ClusterId;
+                     });
+    if (SchedClassClusterIt == SchedClassClusters.end()) {
+      SchedClassClusters.emplace_back();
+      SchedClassClusterIt = std::prev(SchedClassClusters.end());
+    }
+    SchedClassClusterIt->addPoint(PointId, Clustering_);
+  }
+  return SchedClassClusters;
+}
+
 static void writeUopsSnippetHtml(llvm::raw_ostream &OS,
                                  const std::vector<llvm::MCInst> &Instructions,
                                  const llvm::MCInstrInfo &InstrInfo) {
@@ -514,25 +539,8 @@ llvm::Error Analysis::run<Analysis::PrintSchedClassInconsistencies>(
   for (const auto &RSCAndPoints : makePointsPerSchedClass()) {
     if (!RSCAndPoints.RSC.SCDesc)
       continue;
-    // Bucket sched class points into sched class clusters.
-    std::vector<SchedClassCluster> SchedClassClusters;
-    for (const size_t PointId : RSCAndPoints.PointIds) {
-      const auto &ClusterId = Clustering_.getClusterIdForPoint(PointId);
-      if (!ClusterId.isValid())
-        continue; // Ignore noise and errors. FIXME: take noise into account ?
-      if (ClusterId.isUnstable() ^ AnalysisDisplayUnstableOpcodes_)
-        continue; // Either display stable or unstable clusters only.
-      auto SchedClassClusterIt =
-          std::find_if(SchedClassClusters.begin(), SchedClassClusters.end(),
-                       [ClusterId](const SchedClassCluster &C) {
-                         return C.id() == ClusterId;
-                       });
-      if (SchedClassClusterIt == SchedClassClusters.end()) {
-        SchedClassClusters.emplace_back();
-        SchedClassClusterIt = std::prev(SchedClassClusters.end());
-      }
-      SchedClassClusterIt->addPoint(PointId, Clustering_);
-    }
+    const std::vector<SchedClassCluster> SchedClassClusters =
+        makeSchedClassClusters(RSCAndPoints.PointIds);
 
     // Print any scheduling class that has at least one cluster that does not
     // match the checked-in data.
@@ -563,5 +571,141 @@ llvm::Error Analysis::run<Analysis::PrintSchedClassInconsistencies>(
   return llvm::Error::success();
 }
 
+// Returns the name of the sched class, or a made-up name when the names were
+// not compiled in.
+static std::string getSchedClassName(const ResolvedSchedClass &RSC) {
+#if !defined(NDEBUG) || defined(LLVM_ENABLE_DUMP)
+  return RSC.SCDesc->Name;
+#else
+  return "SchedClass" + std::to_string(RSC.SchedClassId);
+#endif
+}
+
+// Returns the average of measure `Key` in `Centroid`, or a negative value if
+// the centroid has no such measure.
+static double getCentroidAvg(const SchedClassClusterCentroid &Centroid,
+                             llvm::StringRef Key) {
+  for (const PerInstructionStats &Stats : Centroid.getStats())
+    if (Stats.key() == Key)
+      return Stats.avg();
+  return -1.0;
+}
+
+template <>
+llvm::Error Analysis::run<Analysis::PrintSchedClassCorrections>(
+    llvm::raw_ostream &OS) const {
+  const auto &FirstPoint = Clustering_.getPoints()[0];
+  const InstructionBenchmark::ModeE Mode = FirstPoint.Mode;
+  const llvm::MCSchedModel &SM = SubtargetInfo_->getSchedModel();
+  OS << "// Scheduling model corrections proposed by llvm-exegesis for "
+     << FirstPoint.CpuName << " (" << FirstPoint.LLVMTriple << ").\n";
+
+  for (const auto &RSCAndPoints : makePointsPerSchedClass()) {
+    const ResolvedSchedClass &RSC = RSCAndPoints.RSC;
+    if (!RSC.SCDesc || !RSC.SCDesc->isValid())
+      continue;
+
+    // Take the worst measurement of the clusters that do not match the model:
+    // a sched class must not promise more than its slowest opcode delivers.
+    double Measured = -1.0;
+    std::set<unsigned> Opcodes;
+    for (const SchedClassCluster &Cluster :
+         makeSchedClassClusters(RSCAndPoints.PointIds)) {
+      if (Cluster.measurementsMatch(*SubtargetInfo_, RSC, Clustering_,
+                                    AnalysisInconsistencyEpsilonSquared_))
+        continue;
+      switch (Mode) {
+      case InstructionBenchmark::Latency:
+        Measured = std::max(
+            Measured, getCentroidAvg(Cluster.getCentroid(), "latency"));
+        break;
+      case InstructionBenchmark::Uops:
+        Measured = std::max(
+            Measured, getCentroidAvg(Cluster.getCentroid(), "NumMicroOps"));
+        break;
+      case InstructionBenchmark::InverseThroughput:
+        Measured =
+            std::max(Measured, getCentroidAvg(Cluster.getCentroid(),
+                                              "inverse_throughput"));
+        break;
+      default:
+        llvm_unreachable("invalid mode");
+      }
+      for (const size_t PointId : Cluster.getPointIds())
+        for (const llvm::MCInst &Inst :
+             Clustering_.getPoints()[PointId].Key.Instructions)
+          Opcodes.insert(Inst.getOpcode());
+    }
+    if (Measured < 0.0)
+      continue; // Nothing weird, or nothing we know how to correct.
+
+    // Start from the current model data and only change what was measured.
+    unsigned Latency = 0;
+    for (unsigned I = 0; I < RSC.SCDesc->NumWriteLatencyEntries; ++I)
+      Latency = std::max<unsigned>(
+          Latency, SubtargetInfo_->getWriteLatencyEntry(RSC.SCDesc, I)->Cycles);
+    unsigned NumMicroOps = RSC.SCDesc->NumMicroOps;
+    llvm::SmallVector<unsigned, 8> ResourceCycles;
+    for (const llvm::MCWriteProcResEntry &WPR : RSC.NonRedundantWriteProcRes)
+      ResourceCycles.push_back(WPR.Cycles);
+
+    const std::string Name = getSchedClassName(RSC);
+    OS << "\n// " << Name << ": ";
+    switch (Mode) {
+    case InstructionBenchmark::Latency:
+      OS << llvm::format("measured latency %.2f, model %u", Measured,
+                         Latency);
+      Latency = std::max(1L, std::lround(Measured));
+      break;
+    case InstructionBenchmark::Uops:
+      OS << llvm::format("measured %.2f uops, model %u", Measured,
+                         NumMicroOps);
+      NumMicroOps = std::max(1L, std::lround(Measured));
+      break;
+    case InstructionBenchmark::InverseThroughput: {
+      const double ModelRThroughput =
+          MCSchedModel::getReciprocalThroughput(*SubtargetInfo_, *RSC.SCDesc);
+      OS << llvm::format("measured inverse throughput %.2f, model %.2f",
+                         Measured, ModelRThroughput);
+      // Scale the resource cycles so that the bottleneck resource matches the
+      // measurement. Sched classes that consume no resource cannot be fixed
+      // this way.
+      if (ModelRThroughput <= 0.0 || ResourceCycles.empty()) {
+        OS << " (no resources to scale)\n";
+        continue;
+      }
+      const double Scale = Measured / ModelRThroughput;
+      for (unsigned &Cycles : ResourceCycles)
+        Cycles = std::max(1L, std::lround(Cycles * Scale));
+      break;
+    }
+    default:
+      llvm_unreachable("invalid mode");
+    }
+    OS << "\n// Opcodes:";
+    for (const unsigned Opcode : Opcodes)
+      OS << " " << InstrInfo_->getName(Opcode);
+    OS << "\ndef : WriteRes<" << Name << ", [";
+    for (const auto &WPR : llvm::enumerate(RSC.NonRedundantWriteProcRes)) {
+      if (WPR.index() > 0)
+        OS << ", ";
+      OS << SM.getProcResource(WPR.value().ProcResourceIdx)->Name;
+    }
+    OS << "]> {\n  let Latency = " << Latency
+       << ";\n  let NumMicroOps = " << NumMicroOps << ";\n";
+    if (!ResourceCycles.empty()) {
+      OS << "  let ResourceCycles = [";
+      for (const auto &Cycles : llvm::enumerate(ResourceCycles)) {
+        if (Cycles.index() > 0)
+          OS << ", ";
+        OS << Cycles.value();
+      }
+      OS << "];\n";
+    }
+    OS << "}\n";
+  }
+  return llvm::Error::success();
+}
+
 } // namespace exegesis
 } // namespace llvm
@@ -46,6 +46,9 @@ public:
   struct PrintClusters {};
   // Find potential errors in the scheduling information given measurements.
   struct PrintSchedClassInconsistencies {};
+  // Proposes scheduling model entries for the sched classes whose
+  // measurements do not match the model, as TableGen `WriteRes` overrides.
+  struct PrintSchedClassCorrections {};
 
   template <typename Pass> llvm::Error run(llvm::raw_ostream &OS) const;
 
@@ -102,6 +105,11 @@ private:
   // Builds a list of ResolvedSchedClassAndPoints.
   std::vector<ResolvedSchedClassAndPoints> makePointsPerSchedClass() const;
 
+  // Buckets the points of a sched class into sched class clusters, ignoring
+  // noise and errors.
+  std::vector<SchedClassCluster>
+  makeSchedClassClusters(llvm::ArrayRef<size_t> PointIds) const;
+
   template <typename EscapeTag, EscapeTag Tag>
   void writeSnippet(llvm::raw_ostream &OS, llvm::ArrayRef<uint8_t> Bytes,
                     const char *Separator) const;
@@ -123,6 +123,11 @@ static cl::opt<std::string>
     AnalysisInconsistenciesOutputFile("analysis-inconsistencies-output-file",
                                       cl::desc(""), cl::cat(AnalysisOptions),
                                       cl::init(""));
+static cl::opt<std::string> AnalysisCorrectionsOutputFile(
+    "analysis-corrections-output-file",
+    cl::desc("file to print TableGen scheduling model corrections to, for the "
+             "sched classes whose measurements do not match the model"),
+    cl::cat(AnalysisOptions), cl::init(""));
 
 static cl::opt<bool> AnalysisDisplayUnstableOpcodes(
     "analysis-display-unstable-clusters",
@@ -444,10 +449,12 @@ static void analysisMain() {
     llvm::report_fatal_error("--benchmarks-file must be set.");
 
   if (AnalysisClustersOutputFile.empty() &&
-      AnalysisInconsistenciesOutputFile.empty()) {
+      AnalysisInconsistenciesOutputFile.empty() &&
+      AnalysisCorrectionsOutputFile.empty()) {
     llvm::report_fatal_error(
-        "At least one of --analysis-clusters-output-file and "
-        "--analysis-inconsistencies-output-file must be specified.");
+        "At least one of --analysis-clusters-output-file, "
+        "--analysis-inconsistencies-output-file and "
+        "--analysis-corrections-output-file must be specified.");
   }
 
   llvm::InitializeNativeTarget();
@@ -488,6 +495,8 @@ static void analysisMain() {
   maybeRunAnalysis<Analysis::PrintSchedClassInconsistencies>(
       Analyzer, "sched class consistency analysis",
       AnalysisInconsistenciesOutputFile);
+  maybeRunAnalysis<Analysis::PrintSchedClassCorrections>(
+      Analyzer, "sched class corrections", AnalysisCorrectionsOutputFile);
 }
 
 } // namespace exegesis
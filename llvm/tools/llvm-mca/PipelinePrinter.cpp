@@ -21,5 +21,15 @@ void PipelinePrinter::printReport(llvm::raw_ostream &OS) const {
   for (const auto &V : Views)
     V->printView(OS);
 }
+
+json::Object PipelinePrinter::getJSONReport() const {
+  json::Object Report;
+  for (const auto &V : Views) {
+    json::Value Data = V->toJSON();
+    if (Data.kind() != json::Value::Null)
+      Report[V->getNameAsString()] = std::move(Data);
+  }
+  return Report;
+}
 } // namespace mca.
 } // namespace llvm
@@ -46,6 +46,9 @@ public:
   }
 
   void printReport(llvm::raw_ostream &OS) const;
+
+  /// Collect the data of the views that are part of the JSON report.
+  llvm::json::Object getJSONReport() const;
 };
 } // namespace mca
 } // namespace llvm
@@ -620,5 +620,28 @@ void BottleneckAnalysis::printView(raw_ostream &OS) const {
   printCriticalSequence(OS);
 }
 
+json::Value BottleneckAnalysis::toJSON() const {
+  auto Percent = [this](unsigned Cycles) {
+    return TotalCycles ? (double)Cycles * 100 / TotalCycles : 0.0;
+  };
+
+  json::Object Resources;
+  if (SeenStallCycles && BPI.PressureIncreaseCycles) {
+    ArrayRef<unsigned> Distribution = Tracker.getResourcePressureDistribution();
+    const MCSchedModel &SM = STI.getSchedModel();
+    for (unsigned I = 0, E = Distribution.size(); I < E; ++I)
+      if (Distribution[I])
+        Resources[SM.getProcResource(I)->Name] = Percent(Distribution[I]);
+  }
+
+  return json::Object(
+      {{"PressureIncrease", Percent(BPI.PressureIncreaseCycles)},
+       {"ResourcePressure", Percent(BPI.ResourcePressureCycles)},
+       {"Resources", std::move(Resources)},
+       {"DataDependencies", Percent(BPI.DataDependencyCycles)},
+       {"RegisterDependencies", Percent(BPI.RegisterDependencyCycles)},
+       {"MemoryDependencies", Percent(BPI.MemoryDependencyCycles)}});
+}
+
 } // namespace mca.
 } // namespace llvm
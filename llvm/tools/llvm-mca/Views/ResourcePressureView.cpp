@@ -180,5 +180,28 @@ void ResourcePressureView::printResourcePressurePerInst(raw_ostream &OS) const {
     ++InstrIndex;
   }
 }
+
+json::Value ResourcePressureView::toJSON() const {
+  json::Object Pressure;
+  const MCSchedModel &SM = STI.getSchedModel();
+  const unsigned Executions = LastInstructionIdx / Source.size() + 1;
+  for (unsigned I = 1, R2VIndex = 0, E = SM.getNumProcResourceKinds(); I < E;
+       ++I) {
+    const MCProcResourceDesc &ProcResource = *SM.getProcResource(I);
+    unsigned NumUnits = ProcResource.NumUnits;
+    // Skip groups and invalid resources with zero units.
+    if (ProcResource.SubUnitsIdxBegin || !NumUnits)
+      continue;
+
+    for (unsigned J = 0; J < NumUnits; ++J, ++R2VIndex) {
+      std::string Name = ProcResource.Name;
+      if (NumUnits > 1)
+        Name += "." + std::to_string(J);
+      double Usage = ResourceUsage[R2VIndex + Source.size() * NumResourceUnits];
+      Pressure[Name] = Usage / Executions;
+    }
+  }
+  return std::move(Pressure);
+}
 } // namespace mca
 } // namespace llvm
@@ -96,6 +96,12 @@ public:
     printResourcePressurePerIter(OS);
     printResourcePressurePerInst(OS);
   }
+  llvm::StringRef getNameAsString() const override {
+    return "ResourcePressureView";
+  }
+  /// Return the pressure per iteration on each resource unit, keyed by the
+  /// name of the resource and the index of the unit.
+  llvm::json::Value toJSON() const override;
 };
 } // namespace mca
 } // namespace llvm
@@ -90,5 +90,23 @@ void SummaryView::printView(raw_ostream &OS) const {
   OS << Buffer;
 }
 
+json::Value SummaryView::toJSON() const {
+  unsigned Instructions = Source.size();
+  unsigned Iterations = (LastInstructionIdx / Instructions) + 1;
+  unsigned TotalInstructions = Instructions * Iterations;
+  unsigned TotalUOps = NumMicroOps * Iterations;
+  return json::Object(
+      {{"Iterations", Iterations},
+       {"Instructions", TotalInstructions},
+       {"TotalCycles", TotalCycles},
+       {"TotaluOps", TotalUOps},
+       {"DispatchWidth", DispatchWidth},
+       {"uOpsPerCycle", (double)TotalUOps / TotalCycles},
+       {"IPC", (double)TotalInstructions / TotalCycles},
+       {"BlockRThroughput", computeBlockRThroughput(SM, DispatchWidth,
+                                                    NumMicroOps,
+                                                    ProcResourceUsage)}});
+}
+
 } // namespace mca.
 } // namespace llvm
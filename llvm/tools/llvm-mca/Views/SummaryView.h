@@ -72,6 +72,8 @@ public:
   void onCycleEnd() override { ++TotalCycles; }
   void onEvent(const HWInstructionEvent &Event) override;
   void printView(llvm::raw_ostream &OS) const override;
+  llvm::StringRef getNameAsString() const override { return "SummaryView"; }
+  llvm::json::Value toJSON() const override;
 };
 
 } // namespace mca
@@ -16,6 +16,7 @@
 #define LLVM_TOOLS_LLVM_MCA_VIEW_H
 
 #include "llvm/MCA/HWEventListener.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace llvm {
@@ -25,6 +26,13 @@ class View : public HWEventListener {
 public:
   virtual void printView(llvm::raw_ostream &OS) const = 0;
   virtual ~View() = default;
+
+  /// Return the key of this view in the JSON report.
+  virtual llvm::StringRef getNameAsString() const { return ""; }
+
+  /// Return the data of this view for the JSON report, or null if the view
+  /// is not part of it.
+  virtual llvm::json::Value toJSON() const { return nullptr; }
   void anchor() override;
 };
 } // namespace mca
@@ -45,12 +45,16 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/WithColor.h"
 
@@ -80,9 +84,26 @@ static cl::opt<std::string>
 
 static cl::opt<std::string>
     MCPU("mcpu",
-         cl::desc("Target a specific cpu type (-mcpu=help for details)"),
+         cl::desc("Target a specific cpu type (-mcpu=help for details). "
+                  "Every code region is simulated on each cpu of a comma "
+                  "separated list"),
          cl::value_desc("cpu-name"), cl::cat(ToolOptions), cl::init("native"));
 
+static cl::opt<unsigned>
+    NumThreads("num-threads",
+               cl::desc("Number of threads used to simulate the code regions "
+                        "(0 = one per hardware thread)"),
+               cl::cat(ToolOptions), cl::init(0));
+
+static cl::alias NumThreadsA("j", cl::desc("Alias for -num-threads"),
+                             cl::aliasopt(NumThreads));
+
+static cl::opt<bool>
+    PrintJson("json",
+              cl::desc("Print the views of every code region and cpu, and a "
+                       "comparison of the cpus, as a single JSON object"),
+              cl::cat(ToolOptions), cl::init(false));
+
 static cl::opt<int>
     OutputAsmVariant("output-asm-variant",
                      cl::desc("Syntax variant to use for output printing"),
@@ -254,16 +275,169 @@ static void processViewOptions() {
 }
 
 // Returns true on success.
-static bool runPipeline(mca::Pipeline &P) {
+static bool runPipeline(mca::Pipeline &P, raw_ostream &ErrOS) {
   // Handle pipeline errors here.
   Expected<unsigned> Cycles = P.run();
   if (!Cycles) {
-    WithColor::error() << toString(Cycles.takeError());
+    WithColor::error(ErrOS) << toString(Cycles.takeError());
     return false;
   }
   return true;
 }
 
+namespace {
+
+/// The target description objects that are shared by the simulations of all
+/// code regions. They are only read by the simulations.
+struct SimulationTarget {
+  const Target &TheTarget;
+  const MCAsmInfo &MAI;
+  const MCRegisterInfo &MRI;
+  const MCInstrInfo &MCII;
+  const MCInstrAnalysis *MCIA;
+  unsigned AssemblerDialect;
+};
+
+/// The simulation of one code region on one cpu. Simulations are independent
+/// of each other, so that they can run in parallel. Their output is buffered
+/// and printed in order once all of them are done.
+struct RegionSimulation {
+  const mca::CodeRegion *Region;
+  const MCSubtargetInfo *STI;
+  /// The text report, including the header of the region.
+  std::string Report;
+  /// The views that are part of the JSON report.
+  json::Object JSONReport;
+  /// The error that stopped the simulation, if any.
+  std::string Error;
+  bool Failed = false;
+};
+
+} // end of anonymous namespace
+
+// Simulates a code region and fills in its report. Returns true on success.
+static bool simulateRegion(const SimulationTarget &T, RegionSimulation &Sim) {
+  const mca::CodeRegion &Region = *Sim.Region;
+  const MCSubtargetInfo &STI = *Sim.STI;
+  const MCSchedModel &SM = STI.getSchedModel();
+  raw_string_ostream OS(Sim.Report);
+  raw_string_ostream ErrOS(Sim.Error);
+
+  // Instruction printers are not thread-safe, give each simulation its own.
+  std::unique_ptr<MCInstPrinter> IP(T.TheTarget.createMCInstPrinter(
+      Triple(TripleName), T.AssemblerDialect, T.MAI, T.MCII, T.MRI));
+
+  // Create an instruction builder.
+  mca::InstrBuilder IB(STI, T.MCII, T.MRI, T.MCIA);
+
+  // Create a context to control ownership of the pipeline hardware.
+  mca::Context MCA(T.MRI, STI);
+
+  mca::PipelineOptions PO(MicroOpQueue, DecoderThroughput, DispatchWidth,
+                          RegisterFileSize, LoadQueueSize, StoreQueueSize,
+                          AssumeNoAlias, EnableBottleneckAnalysis);
+
+  // Lower the MCInst sequence into an mca::Instruction sequence.
+  ArrayRef<MCInst> Insts = Region.getInstructions();
+  std::vector<std::unique_ptr<mca::Instruction>> LoweredSequence;
+  for (const MCInst &MCI : Insts) {
+    Expected<std::unique_ptr<mca::Instruction>> Inst =
+        IB.createInstruction(MCI);
+    if (!Inst) {
+      if (auto NewE = handleErrors(
+              Inst.takeError(),
+              [&IP, &STI, &ErrOS](const mca::InstructionError<MCInst> &IE) {
+                std::string InstructionStr;
+                raw_string_ostream SS(InstructionStr);
+                WithColor::error(ErrOS) << IE.Message << '\n';
+                IP->printInst(&IE.Inst, SS, "", STI);
+                SS.flush();
+                WithColor::note(ErrOS)
+                    << "instruction: " << InstructionStr << '\n';
+              })) {
+        // Default case.
+        WithColor::error(ErrOS) << toString(std::move(NewE));
+      }
+      return false;
+    }
+
+    LoweredSequence.emplace_back(std::move(Inst.get()));
+  }
+
+  mca::SourceMgr S(LoweredSequence, PrintInstructionTables ? 1 : Iterations);
+
+  if (PrintInstructionTables) {
+    //  Create a pipeline, stages, and a printer.
+    auto P = llvm::make_unique<mca::Pipeline>();
+    P->appendStage(llvm::make_unique<mca::EntryStage>(S));
+    P->appendStage(llvm::make_unique<mca::InstructionTables>(SM));
+    mca::PipelinePrinter Printer(*P);
+
+    // Create the views for this pipeline, execute, and emit a report.
+    if (PrintInstructionInfoView) {
+      Printer.addView(llvm::make_unique<mca::InstructionInfoView>(
+          STI, T.MCII, Insts, *IP));
+    }
+    Printer.addView(
+        llvm::make_unique<mca::ResourcePressureView>(STI, *IP, Insts));
+
+    if (!runPipeline(*P, ErrOS))
+      return false;
+
+    Printer.printReport(OS);
+    Sim.JSONReport = Printer.getJSONReport();
+    return true;
+  }
+
+  // Create a basic pipeline simulating an out-of-order backend.
+  auto P = MCA.createDefaultPipeline(PO, IB, S);
+  mca::PipelinePrinter Printer(*P);
+
+  if (PrintSummaryView)
+    Printer.addView(
+        llvm::make_unique<mca::SummaryView>(SM, Insts, DispatchWidth));
+
+  if (EnableBottleneckAnalysis) {
+    Printer.addView(llvm::make_unique<mca::BottleneckAnalysis>(
+        STI, *IP, Insts, S.getNumIterations()));
+  }
+
+  if (PrintInstructionInfoView)
+    Printer.addView(
+        llvm::make_unique<mca::InstructionInfoView>(STI, T.MCII, Insts, *IP));
+
+  if (PrintDispatchStats)
+    Printer.addView(llvm::make_unique<mca::DispatchStatistics>());
+
+  if (PrintSchedulerStats)
+    Printer.addView(llvm::make_unique<mca::SchedulerStatistics>(STI));
+
+  if (PrintRetireStats)
+    Printer.addView(llvm::make_unique<mca::RetireControlUnitStatistics>(SM));
+
+  if (PrintRegisterFileStats)
+    Printer.addView(llvm::make_unique<mca::RegisterFileStatistics>(STI));
+
+  if (PrintResourcePressureView)
+    Printer.addView(
+        llvm::make_unique<mca::ResourcePressureView>(STI, *IP, Insts));
+
+  if (PrintTimelineView) {
+    unsigned TimelineIterations =
+        TimelineMaxIterations ? TimelineMaxIterations : 10;
+    Printer.addView(llvm::make_unique<mca::TimelineView>(
+        STI, *IP, Insts, std::min(TimelineIterations, S.getNumIterations()),
+        TimelineMaxCycles));
+  }
+
+  if (!runPipeline(*P, ErrOS))
+    return false;
+
+  Printer.printReport(OS);
+  Sim.JSONReport = Printer.getJSONReport();
+  return true;
+}
+
 int main(int argc, char **argv) {
   InitLLVM X(argc, argv);
 
@@ -328,32 +502,43 @@ int main(int argc, char **argv) {
   if (!MCPU.compare("native"))
     MCPU = llvm::sys::getHostCPUName();
 
-  std::unique_ptr<MCSubtargetInfo> STI(
-      TheTarget->createMCSubtargetInfo(TripleName, MCPU, /* FeaturesStr */ ""));
-  if (!STI->isCPUStringValid(MCPU))
-    return 1;
+  // Every code region is simulated on each of the requested cpus.
+  SmallVector<StringRef, 4> CPUNames;
+  StringRef(MCPU).split(CPUNames, ',', /*MaxSplit=*/-1, /*KeepEmpty=*/false);
+  if (CPUNames.empty())
+    CPUNames.push_back("");
+
+  std::vector<std::unique_ptr<MCSubtargetInfo>> STIs;
+  for (StringRef CPU : CPUNames) {
+    std::unique_ptr<MCSubtargetInfo> STI(
+        TheTarget->createMCSubtargetInfo(TripleName, CPU, /* FeaturesStr */ ""));
+    if (!STI->isCPUStringValid(CPU))
+      return 1;
 
-  if (!PrintInstructionTables && !STI->getSchedModel().isOutOfOrder()) {
-    WithColor::error() << "please specify an out-of-order cpu. '" << MCPU
-                       << "' is an in-order cpu.\n";
-    return 1;
-  }
+    if (!PrintInstructionTables && !STI->getSchedModel().isOutOfOrder()) {
+      WithColor::error() << "please specify an out-of-order cpu. '" << CPU
+                         << "' is an in-order cpu.\n";
+      return 1;
+    }
 
-  if (!STI->getSchedModel().hasInstrSchedModel()) {
-    WithColor::error()
-        << "unable to find instruction-level scheduling information for"
-        << " target triple '" << TheTriple.normalize() << "' and cpu '" << MCPU
-        << "'.\n";
-
-    if (STI->getSchedModel().InstrItineraries)
-      WithColor::note()
-          << "cpu '" << MCPU << "' provides itineraries. However, "
-          << "instruction itineraries are currently unsupported.\n";
-    return 1;
+    if (!STI->getSchedModel().hasInstrSchedModel()) {
+      WithColor::error()
+          << "unable to find instruction-level scheduling information for"
+          << " target triple '" << TheTriple.normalize() << "' and cpu '"
+          << CPU << "'.\n";
+
+      if (STI->getSchedModel().InstrItineraries)
+        WithColor::note()
+            << "cpu '" << CPU << "' provides itineraries. However, "
+            << "instruction itineraries are currently unsupported.\n";
+      return 1;
+    }
+    STIs.push_back(std::move(STI));
   }
 
   // Parse the input and create CodeRegions that llvm-mca can analyze.
-  mca::AsmCodeRegionGenerator CRG(*TheTarget, SrcMgr, Ctx, *MAI, *STI, *MCII);
+  mca::AsmCodeRegionGenerator CRG(*TheTarget, SrcMgr, Ctx, *MAI, *STIs[0],
+                                  *MCII);
   Expected<const mca::CodeRegions &> RegionsOrErr = CRG.parseCodeRegions();
   if (!RegionsOrErr) {
     if (auto Err =
@@ -398,135 +583,103 @@ int main(int argc, char **argv) {
 
   std::unique_ptr<ToolOutputFile> TOF = std::move(*OF);
 
-  const MCSchedModel &SM = STI->getSchedModel();
-
-  // Create an instruction builder.
-  mca::InstrBuilder IB(*STI, *MCII, *MRI, MCIA.get());
-
-  // Create a context to control ownership of the pipeline hardware.
-  mca::Context MCA(*MRI, *STI);
-
-  mca::PipelineOptions PO(MicroOpQueue, DecoderThroughput, DispatchWidth,
-                          RegisterFileSize, LoadQueueSize, StoreQueueSize,
-                          AssumeNoAlias, EnableBottleneckAnalysis);
-
-  // Number each region in the sequence.
-  unsigned RegionIdx = 0;
-
-  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions) {
-    // Skip empty code regions.
-    if (Region->empty())
-      continue;
-
-    // Don't print the header of this region if it is the default region, and
-    // it doesn't have an end location.
-    if (Region->startLoc().isValid() || Region->endLoc().isValid()) {
-      TOF->os() << "\n[" << RegionIdx++ << "] Code Region";
-      StringRef Desc = Region->getDescription();
-      if (!Desc.empty())
-        TOF->os() << " - " << Desc;
-      TOF->os() << "\n\n";
+  SimulationTarget T = {*TheTarget, *MAI, *MRI, *MCII, MCIA.get(),
+                        AssemblerDialect};
+
+  // Collect the non-empty code regions, and simulate each of them on every
+  // cpu.
+  std::vector<const mca::CodeRegion *> SimulatedRegions;
+  for (const std::unique_ptr<mca::CodeRegion> &Region : Regions)
+    if (!Region->empty())
+      SimulatedRegions.push_back(Region.get());
+
+  std::vector<RegionSimulation> Simulations;
+  Simulations.reserve(STIs.size() * SimulatedRegions.size());
+  for (const std::unique_ptr<MCSubtargetInfo> &STI : STIs) {
+    for (const mca::CodeRegion *Region : SimulatedRegions) {
+      Simulations.emplace_back();
+      Simulations.back().Region = Region;
+      Simulations.back().STI = STI.get();
     }
+  }
 
-    // Lower the MCInst sequence into an mca::Instruction sequence.
-    ArrayRef<MCInst> Insts = Region->getInstructions();
-    std::vector<std::unique_ptr<mca::Instruction>> LoweredSequence;
-    for (const MCInst &MCI : Insts) {
-      Expected<std::unique_ptr<mca::Instruction>> Inst =
-          IB.createInstruction(MCI);
-      if (!Inst) {
-        if (auto NewE = handleErrors(
-                Inst.takeError(),
-                [&IP, &STI](const mca::InstructionError<MCInst> &IE) {
-                  std::string InstructionStr;
-                  raw_string_ostream SS(InstructionStr);
-                  WithColor::error() << IE.Message << '\n';
-                  IP->printInst(&IE.Inst, SS, "", *STI);
-                  SS.flush();
-                  WithColor::note()
-                      << "instruction: " << InstructionStr << '\n';
-                })) {
-          // Default case.
-          WithColor::error() << toString(std::move(NewE));
+  if (Simulations.size() > 1 && NumThreads != 1) {
+    ThreadPool Pool(NumThreads ? NumThreads : hardware_concurrency());
+    for (RegionSimulation &Sim : Simulations)
+      Pool.async([&T, &Sim]() { Sim.Failed = !simulateRegion(T, Sim); });
+    Pool.wait();
+  } else {
+    for (RegionSimulation &Sim : Simulations)
+      if ((Sim.Failed = !simulateRegion(T, Sim)))
+        break;
+  }
+
+  if (PrintJson) {
+    // For each region, the report of every cpu and a comparison of their
+    // throughput.
+    json::Array JSONRegions;
+    for (unsigned RegionIdx = 0, E = SimulatedRegions.size(); RegionIdx < E;
+         ++RegionIdx) {
+      json::Object JSONCPUs, IPCs, RThroughputs;
+      for (unsigned CPUIdx = 0, NumCPUs = STIs.size(); CPUIdx < NumCPUs;
+           ++CPUIdx) {
+        RegionSimulation &Sim = Simulations[CPUIdx * E + RegionIdx];
+        if (Sim.Failed) {
+          errs() << Sim.Error;
+          return 1;
         }
-        return 1;
+        StringRef CPU = CPUNames[CPUIdx];
+        if (const json::Object *Summary =
+                Sim.JSONReport.getObject("SummaryView")) {
+          if (Optional<double> IPC = Summary->getNumber("IPC"))
+            IPCs[CPU] = *IPC;
+          if (Optional<double> RThroughput =
+                  Summary->getNumber("BlockRThroughput"))
+            RThroughputs[CPU] = *RThroughput;
+        }
+        JSONCPUs[CPU] = std::move(Sim.JSONReport);
       }
-
-      LoweredSequence.emplace_back(std::move(Inst.get()));
+      JSONRegions.push_back(json::Object(
+          {{"Index", RegionIdx},
+           {"Description", SimulatedRegions[RegionIdx]->getDescription()},
+           {"CPUs", std::move(JSONCPUs)},
+           {"IPC", std::move(IPCs)},
+           {"BlockRThroughput", std::move(RThroughputs)}}));
     }
+    TOF->os() << formatv("{0:2}", json::Value(json::Object(
+                                      {{"Regions", std::move(JSONRegions)}})))
+              << '\n';
+    TOF->keep();
+    return 0;
+  }
 
-    mca::SourceMgr S(LoweredSequence, PrintInstructionTables ? 1 : Iterations);
-
-    if (PrintInstructionTables) {
-      //  Create a pipeline, stages, and a printer.
-      auto P = llvm::make_unique<mca::Pipeline>();
-      P->appendStage(llvm::make_unique<mca::EntryStage>(S));
-      P->appendStage(llvm::make_unique<mca::InstructionTables>(SM));
-      mca::PipelinePrinter Printer(*P);
-
-      // Create the views for this pipeline, execute, and emit a report.
-      if (PrintInstructionInfoView) {
-        Printer.addView(llvm::make_unique<mca::InstructionInfoView>(
-            *STI, *MCII, Insts, *IP));
+  // Print the reports in order, up to the first simulation that failed.
+  for (unsigned CPUIdx = 0, NumCPUs = STIs.size(); CPUIdx < NumCPUs;
+       ++CPUIdx) {
+    if (NumCPUs > 1)
+      TOF->os() << "\nCPU: " << CPUNames[CPUIdx] << '\n';
+
+    // Number each region in the sequence.
+    unsigned RegionIdx = 0;
+    for (unsigned I = 0, E = SimulatedRegions.size(); I < E; ++I) {
+      const mca::CodeRegion &Region = *SimulatedRegions[I];
+      // Don't print the header of this region if it is the default region,
+      // and it doesn't have an end location.
+      if (Region.startLoc().isValid() || Region.endLoc().isValid()) {
+        TOF->os() << "\n[" << RegionIdx++ << "] Code Region";
+        StringRef Desc = Region.getDescription();
+        if (!Desc.empty())
+          TOF->os() << " - " << Desc;
+        TOF->os() << "\n\n";
       }
-      Printer.addView(
-          llvm::make_unique<mca::ResourcePressureView>(*STI, *IP, Insts));
 
-      if (!runPipeline(*P))
+      RegionSimulation &Sim = Simulations[CPUIdx * E + I];
+      if (Sim.Failed) {
+        errs() << Sim.Error;
         return 1;
-
-      Printer.printReport(TOF->os());
-      continue;
-    }
-
-    // Create a basic pipeline simulating an out-of-order backend.
-    auto P = MCA.createDefaultPipeline(PO, IB, S);
-    mca::PipelinePrinter Printer(*P);
-
-    if (PrintSummaryView)
-      Printer.addView(
-          llvm::make_unique<mca::SummaryView>(SM, Insts, DispatchWidth));
-
-    if (EnableBottleneckAnalysis) {
-      Printer.addView(llvm::make_unique<mca::BottleneckAnalysis>(
-          *STI, *IP, Insts, S.getNumIterations()));
-    }
-
-    if (PrintInstructionInfoView)
-      Printer.addView(
-          llvm::make_unique<mca::InstructionInfoView>(*STI, *MCII, Insts, *IP));
-
-    if (PrintDispatchStats)
-      Printer.addView(llvm::make_unique<mca::DispatchStatistics>());
-
-    if (PrintSchedulerStats)
-      Printer.addView(llvm::make_unique<mca::SchedulerStatistics>(*STI));
-
-    if (PrintRetireStats)
-      Printer.addView(llvm::make_unique<mca::RetireControlUnitStatistics>(SM));
-
-    if (PrintRegisterFileStats)
-      Printer.addView(llvm::make_unique<mca::RegisterFileStatistics>(*STI));
-
-    if (PrintResourcePressureView)
-      Printer.addView(
-          llvm::make_unique<mca::ResourcePressureView>(*STI, *IP, Insts));
-
-    if (PrintTimelineView) {
-      unsigned TimelineIterations =
-          TimelineMaxIterations ? TimelineMaxIterations : 10;
-      Printer.addView(llvm::make_unique<mca::TimelineView>(
-          *STI, *IP, Insts, std::min(TimelineIterations, S.getNumIterations()),
-          TimelineMaxCycles));
+      }
+      TOF->os() << Sim.Report;
     }
-
-    if (!runPipeline(*P))
-      return 1;
-
-    Printer.printReport(TOF->os());
-
-    // Clear the InstrBuilder internal state in preparation for another round.
-    IB.clear();
   }
 
   TOF->keep();
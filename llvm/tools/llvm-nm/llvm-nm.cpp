@@ -692,15 +692,12 @@ static Optional<std::string> demangle(StringRef Name, bool StripUnderscore) {
   if (!Name.startswith("_Z"))
     return None;
 
-  int Status;
-  char *Undecorated =
-      itaniumDemangle(Name.str().c_str(), nullptr, nullptr, &Status);
-  if (Status != 0)
+  // The symbols are demangled one after the other, so they share a context.
+  static ItaniumDemangleContext Demangler;
+  const char *Undecorated = Demangler.demangle(Name.data(), Name.size());
+  if (!Undecorated)
     return None;
-
-  std::string S(Undecorated);
-  free(Undecorated);
-  return S;
+  return std::string(Undecorated);
 }
 
 static bool symbolIsDefined(const NMSymbol &Sym) {
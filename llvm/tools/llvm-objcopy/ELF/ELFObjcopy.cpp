@@ -33,6 +33,7 @@
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/ErrorOr.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 #include <algorithm>
@@ -44,6 +45,7 @@
 #include <string>
 #include <system_error>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 namespace objcopy {
@@ -336,6 +338,37 @@ static void replaceDebugSections(
   };
 }
 
+static void compressDebugSections(Object &Obj, SectionPred &RemovePred,
+                                  DebugCompressionType CompressionType) {
+  // Sections are compressed independently, so compress them in parallel up
+  // front. Adding the compressed sections mutates the section table, so that
+  // is done serially afterwards.
+  SmallVector<const SectionBase *, 13> ToCompress;
+  DenseMap<const SectionBase *, size_t> CompressedIndex;
+  for (const SectionBase &Sec : Obj.sections())
+    if (isCompressable(Sec)) {
+      CompressedIndex[&Sec] = ToCompress.size();
+      ToCompress.push_back(&Sec);
+    }
+
+  std::vector<SmallVector<char, 128>> CompressedData(ToCompress.size());
+  parallel::for_each_n(
+      parallel::par, size_t(0), ToCompress.size(), [&](size_t I) {
+        const SectionBase &Sec = *ToCompress[I];
+        StringRef Data(reinterpret_cast<const char *>(Sec.OriginalData.data()),
+                       Sec.OriginalData.size());
+        if (Error E = zlib::compress(Data, CompressedData[I]))
+          reportError(Sec.Name, std::move(E));
+      });
+
+  replaceDebugSections(Obj, RemovePred, isCompressable,
+                       [&](const SectionBase *S) {
+                         return &Obj.addSection<CompressedSection>(
+                             *S, CompressionType,
+                             std::move(CompressedData[CompressedIndex[S]]));
+                       });
+}
+
 static bool isUnneededSymbol(const Symbol &Sym) {
   return !Sym.Referenced &&
          (Sym.Binding == STB_LOCAL || Sym.getShndx() == SHN_UNDEF) &&
@@ -565,11 +598,7 @@ static Error replaceAndRemoveSections(const CopyConfig &Config, Object &Obj) {
   }
 
   if (Config.CompressionType != DebugCompressionType::None)
-    replaceDebugSections(Obj, RemovePred, isCompressable, 
-                         [&Config, &Obj](const SectionBase *S) {
-                           return &Obj.addSection<CompressedSection>(
-                                *S, Config.CompressionType);
-                        });
+    compressDebugSections(Obj, RemovePred, Config.CompressionType);
   else if (Config.DecompressDebugSections)
     replaceDebugSections(
         Obj, RemovePred,
@@ -20,6 +20,7 @@
 #include "llvm/Support/Endian.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileOutputBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include <algorithm>
 #include <cstddef>
@@ -430,13 +431,14 @@ void ELFSectionWriter<ELFT>::visit(const DecompressedSection &Sec) {
       reinterpret_cast<const char *>(Sec.OriginalData.data()) + DataOffset,
       Sec.OriginalData.size() - DataOffset);
 
-  SmallVector<char, 128> DecompressedContent;
-  if (Error E = zlib::uncompress(CompressedContent, DecompressedContent,
-                                 static_cast<size_t>(Sec.Size)))
+  // Decompress straight into the output buffer.
+  char *Buf = reinterpret_cast<char *>(Out.getBufferStart() + Sec.Offset);
+  size_t DecompressedSize = static_cast<size_t>(Sec.Size);
+  if (Error E = zlib::uncompress(CompressedContent, Buf, DecompressedSize))
     reportError(Sec.Name, std::move(E));
-
-  uint8_t *Buf = Out.getBufferStart() + Sec.Offset;
-  std::copy(DecompressedContent.begin(), DecompressedContent.end(), Buf);
+  if (DecompressedSize != Sec.Size)
+    error("decompressed size of section '" + Sec.Name +
+          "' does not match its header");
 }
 
 void BinarySectionWriter::visit(const DecompressedSection &Sec) {
@@ -501,15 +503,11 @@ void ELFSectionWriter<ELFT>::visit(const CompressedSection &Sec) {
 }
 
 CompressedSection::CompressedSection(const SectionBase &Sec,
-                                     DebugCompressionType CompressionType)
+                                     DebugCompressionType CompressionType,
+                                     SmallVector<char, 128> CompressedData)
     : SectionBase(Sec), CompressionType(CompressionType),
-      DecompressedSize(Sec.OriginalData.size()), DecompressedAlign(Sec.Align) {
-  if (Error E = zlib::compress(
-          StringRef(reinterpret_cast<const char *>(OriginalData.data()),
-                    OriginalData.size()),
-          CompressedData))
-    reportError(Name, std::move(E));
-
+      DecompressedSize(Sec.OriginalData.size()), DecompressedAlign(Sec.Align),
+      CompressedData(std::move(CompressedData)) {
   size_t ChdrSize;
   if (CompressionType == DebugCompressionType::GNU) {
     Name = ".z" + Sec.Name.substr(1);
@@ -1758,12 +1756,18 @@ template <class ELFT> void ELFWriter<ELFT>::writeShdrs() {
 }
 
 template <class ELFT> void ELFWriter<ELFT>::writeSectionData() {
-  for (SectionBase &Sec : Obj.sections())
-    // Segments are responsible for writing their contents, so only write the
-    // section data if the section is not in a segment. Note that this renders
-    // sections in segments effectively immutable.
+  // Segments are responsible for writing their contents, so only write the
+  // section data if the section is not in a segment. Note that this renders
+  // sections in segments effectively immutable.
+  std::vector<const SectionBase *> ToWrite;
+  for (const SectionBase &Sec : Obj.sections())
     if (Sec.ParentSegment == nullptr)
-      Sec.accept(*SecWriter);
+      ToWrite.push_back(&Sec);
+
+  // The sections occupy disjoint parts of the output, so they can be written
+  // (and decompressed) in parallel.
+  parallel::for_each(parallel::par, ToWrite.begin(), ToWrite.end(),
+                     [&](const SectionBase *Sec) { Sec->accept(*SecWriter); });
 }
 
 template <class ELFT> void ELFWriter<ELFT>::writeSegmentData() {
@@ -226,8 +226,17 @@ static void overlapInput(const std::string &BaseFilename,
   }
 }
 
-/// Load an input into a writer context.
+/// Returns the partition of the function \p Name when the function name hash
+/// space is split into \p NumPartitions consecutive ranges.
+static unsigned getPartition(StringRef Name, unsigned NumPartitions) {
+  uint64_t Hash = IndexedInstrProf::ComputeHash(Name);
+  return ((Hash >> 32) * NumPartitions) >> 32;
+}
+
+/// Load the functions of an input that are in \p Partition into a writer
+/// context.
 static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
+                      unsigned Partition, unsigned NumPartitions,
                       WriterContext *WC) {
   std::unique_lock<std::mutex> CtxGuard{WC->Lock};
 
@@ -262,6 +271,8 @@ static void loadInput(const WeightedFile &Input, SymbolRemapper *Remapper,
   for (auto &I : *Reader) {
     if (Remapper)
       I.Name = (*Remapper)(I.Name);
+    if (NumPartitions > 1 && getPartition(I.Name, NumPartitions) != Partition)
+      continue;
     const StringRef FuncName = I.Name;
     bool Reported = false;
     WC->Writer.addRecord(std::move(I), Input.Weight, [&](Error E) {
@@ -305,11 +316,29 @@ static void mergeWriterContexts(WriterContext *Dst, WriterContext *Src) {
   });
 }
 
+/// Report the hard errors that were deferred while merging, and clear them.
+static void handleDeferredErrors(
+    SmallVectorImpl<std::unique_ptr<WriterContext>> &Contexts) {
+  for (std::unique_ptr<WriterContext> &WC : Contexts) {
+    if (!WC->Err)
+      continue;
+    if (!WC->Err.isA<InstrProfError>())
+      exitWithError(std::move(WC->Err), WC->ErrWhence);
+
+    instrprof_error IPE = InstrProfError::take(std::move(WC->Err));
+    if (isFatalError(IPE))
+      exitWithError(make_error<InstrProfError>(IPE), WC->ErrWhence);
+    else
+      warn(toString(make_error<InstrProfError>(IPE)),
+           WC->ErrWhence);
+  }
+}
+
 static void mergeInstrProfile(const WeightedFileVector &Inputs,
                               SymbolRemapper *Remapper,
                               StringRef OutputFilename,
                               ProfileFormat OutputFormat, bool OutputSparse,
-                              unsigned NumThreads) {
+                              unsigned NumThreads, unsigned NumPartitions) {
   if (OutputFilename.compare("-") == 0)
     exitWithError("Cannot write indexed profdata format to stdout.");
 
@@ -317,6 +346,11 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
       OutputFormat != PF_Text)
     exitWithError("Unknown format is specified.");
 
+  if (NumPartitions == 0)
+    exitWithError("The number of partitions must be at least 1.");
+  if (NumPartitions > 1 && OutputFormat == PF_Text)
+    exitWithError("Cannot write the text format with multiple partitions.");
+
   std::error_code EC;
   raw_fd_ostream Output(OutputFilename.data(), EC, sys::fs::F_None);
   if (EC)
@@ -336,52 +370,55 @@ static void mergeInstrProfile(const WeightedFileVector &Inputs,
     Contexts.emplace_back(llvm::make_unique<WriterContext>(
         OutputSparse, ErrorLock, WriterErrorCodes));
 
-  if (NumThreads == 1) {
-    for (const auto &Input : Inputs)
-      loadInput(Input, Remapper, Contexts[0].get());
-  } else {
-    ThreadPool Pool(NumThreads);
-
-    // Load the inputs in parallel (N/NumThreads serial steps).
-    unsigned Ctx = 0;
-    for (const auto &Input : Inputs) {
-      Pool.async(loadInput, Input, Remapper, Contexts[Ctx].get());
-      Ctx = (Ctx + 1) % NumThreads;
-    }
-    Pool.wait();
-
-    // Merge the writer contexts together (~ lg(NumThreads) serial steps).
-    unsigned Mid = Contexts.size() / 2;
-    unsigned End = Contexts.size();
-    assert(Mid > 0 && "Expected more than one context");
-    do {
-      for (unsigned I = 0; I < Mid; ++I)
-        Pool.async(mergeWriterContexts, Contexts[I].get(),
-                   Contexts[I + Mid].get());
-      Pool.wait();
-      if (End & 1) {
-        Pool.async(mergeWriterContexts, Contexts[0].get(),
-                   Contexts[End - 1].get());
-        Pool.wait();
+  std::unique_ptr<ThreadPool> Pool;
+  if (NumThreads > 1)
+    Pool = llvm::make_unique<ThreadPool>(NumThreads);
+
+  // With multiple partitions, every input is read once per partition, and
+  // only the functions whose name hash is in the range of the partition are
+  // merged. The merged records of a partition are spilled to disk before the
+  // next one is started, so the memory used is bounded by the size of a
+  // partition instead of the size of the whole profile.
+  for (unsigned Partition = 0; Partition < NumPartitions; ++Partition) {
+    if (NumThreads == 1) {
+      for (const auto &Input : Inputs)
+        loadInput(Input, Remapper, Partition, NumPartitions,
+                  Contexts[0].get());
+    } else {
+      // Load the inputs in parallel (N/NumThreads serial steps).
+      unsigned Ctx = 0;
+      for (const auto &Input : Inputs) {
+        Pool->async(loadInput, Input, Remapper, Partition, NumPartitions,
+                    Contexts[Ctx].get());
+        Ctx = (Ctx + 1) % NumThreads;
       }
-      End = Mid;
-      Mid /= 2;
-    } while (Mid > 0);
-  }
+      Pool->wait();
+
+      // Merge the writer contexts together (~ lg(NumThreads) serial steps).
+      unsigned Mid = Contexts.size() / 2;
+      unsigned End = Contexts.size();
+      assert(Mid > 0 && "Expected more than one context");
+      do {
+        for (unsigned I = 0; I < Mid; ++I)
+          Pool->async(mergeWriterContexts, Contexts[I].get(),
+                      Contexts[I + Mid].get());
+        Pool->wait();
+        if (End & 1) {
+          Pool->async(mergeWriterContexts, Contexts[0].get(),
+                      Contexts[End - 1].get());
+          Pool->wait();
+        }
+        End = Mid;
+        Mid /= 2;
+      } while (Mid > 0);
+    }
 
-  // Handle deferred hard errors encountered during merging.
-  for (std::unique_ptr<WriterContext> &WC : Contexts) {
-    if (!WC->Err)
-      continue;
-    if (!WC->Err.isA<InstrProfError>())
-      exitWithError(std::move(WC->Err), WC->ErrWhence);
+    // Handle deferred hard errors encountered during merging.
+    handleDeferredErrors(Contexts);
 
-    instrprof_error IPE = InstrProfError::take(std::move(WC->Err));
-    if (isFatalError(IPE))
-      exitWithError(make_error<InstrProfError>(IPE), WC->ErrWhence);
-    else
-      warn(toString(make_error<InstrProfError>(IPE)),
-           WC->ErrWhence);
+    if (NumPartitions > 1)
+      if (Error E = Contexts[0]->Writer.spillRecords())
+        exitWithError(std::move(E), OutputFilename);
   }
 
   InstrProfWriter &Writer = Contexts[0]->Writer;
@@ -596,6 +633,11 @@ static int merge_main(int argc, const char *argv[]) {
       cl::desc("Number of merge threads to use (default: autodetect)"));
   cl::alias NumThreadsA("j", cl::desc("Alias for --num-threads"),
                         cl::aliasopt(NumThreads));
+  cl::opt<unsigned> NumPartitions(
+      "num-partitions", cl::init(1),
+      cl::desc("Merge the functions in this many passes over the inputs, each "
+               "over a range of function name hashes, to bound the memory "
+               "used (only meaningful for -instr)"));
 
   cl::ParseCommandLineOptions(argc, argv, "LLVM profile data merger\n");
 
@@ -626,7 +668,7 @@ static int merge_main(int argc, const char *argv[]) {
 
   if (ProfileKind == instr)
     mergeInstrProfile(WeightedInputs, Remapper.get(), OutputFilename,
-                      OutputFormat, OutputSparse, NumThreads);
+                      OutputFormat, OutputSparse, NumThreads, NumPartitions);
   else
     mergeSampleProfile(WeightedInputs, Remapper.get(), OutputFilename,
                        OutputFormat);
@@ -655,7 +697,8 @@ static void overlapInstrProfile(const std::string &BaseFilename,
     OS << "Sum of edge counts for profile " << TestFilename << " is 0.\n";
     exit(0);
   }
-  loadInput(WeightedInput, nullptr, &Context);
+  loadInput(WeightedInput, nullptr, /*Partition=*/0, /*NumPartitions=*/1,
+            &Context);
   overlapInput(BaseFilename, TestFilename, &Context, Overlap, FuncFilter, OS,
                IsCS);
   Overlap.dump(OS);
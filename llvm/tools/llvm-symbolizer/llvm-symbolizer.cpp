@@ -146,6 +146,16 @@ static cl::opt<std::string>
     ClFallbackDebugPath("fallback-debug-path", cl::init(""),
                         cl::desc("Fallback path for debug binaries."));
 
+static cl::opt<std::string>
+    ClIndexCacheDir("index-cache-dir", cl::init(""),
+                    cl::desc("Directory to save and read the address index "
+                             "of binaries with a build ID"));
+
+static cl::opt<uint64_t>
+    ClCacheSize("cache-size", cl::init(0),
+                cl::desc("Debug info size in bytes of the modules to keep "
+                         "cached, or 0 for no limit"));
+
 static cl::opt<DIPrinter::OutputStyle>
     ClOutputStyle("output-style", cl::init(DIPrinter::OutputStyle::LLVM),
                   cl::desc("Specify print style"),
@@ -293,6 +303,8 @@ int main(int argc, char **argv) {
   Opts.DefaultArch = ClDefaultArch;
   Opts.FallbackDebugPath = ClFallbackDebugPath;
   Opts.DWPName = ClDwpName;
+  Opts.IndexCacheDir = ClIndexCacheDir;
+  Opts.MaxCacheSize = ClCacheSize;
 
   for (const auto &hint : ClDsymHint) {
     if (sys::path::extension(hint) == ".dSYM") {
@@ -0,0 +1,185 @@
+//===- llvm/unittest/ADT/FlatHashMapTest.cpp - FlatHashMap unit tests -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ADT/FlatHashMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "gtest/gtest.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+
+TEST(FlatHashMapTest, EmptyMap) {
+  FlatHashMap<unsigned, unsigned> Map;
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.size());
+  EXPECT_TRUE(Map.begin() == Map.end());
+  EXPECT_EQ(0u, Map.count(1));
+  EXPECT_TRUE(Map.find(1) == Map.end());
+  EXPECT_EQ(0u, Map.lookup(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_EQ(0u, Map.getMemorySize());
+}
+
+TEST(FlatHashMapTest, InsertFindErase) {
+  FlatHashMap<unsigned, unsigned> Map;
+  auto Res = Map.insert(std::make_pair(1u, 2u));
+  EXPECT_TRUE(Res.second);
+  EXPECT_EQ(1u, Res.first->first);
+  EXPECT_EQ(2u, Res.first->second);
+
+  Res = Map.insert(std::make_pair(1u, 3u));
+  EXPECT_FALSE(Res.second);
+  EXPECT_EQ(2u, Res.first->second);
+  EXPECT_EQ(1u, Map.size());
+
+  EXPECT_EQ(2u, Map.lookup(1));
+  EXPECT_EQ(1u, Map.count(1));
+  EXPECT_TRUE(Map.erase(1));
+  EXPECT_FALSE(Map.erase(1));
+  EXPECT_TRUE(Map.empty());
+  EXPECT_TRUE(Map.begin() == Map.end());
+}
+
+// The empty and tombstone keys of DenseMapInfo are ordinary keys here.
+TEST(FlatHashMapTest, DenseMapReservedKeys) {
+  FlatHashMap<unsigned, unsigned> Map;
+  Map[DenseMapInfo<unsigned>::getEmptyKey()] = 1;
+  Map[DenseMapInfo<unsigned>::getTombstoneKey()] = 2;
+  EXPECT_EQ(2u, Map.size());
+  EXPECT_EQ(1u, Map.lookup(DenseMapInfo<unsigned>::getEmptyKey()));
+  EXPECT_EQ(2u, Map.lookup(DenseMapInfo<unsigned>::getTombstoneKey()));
+}
+
+// Compare against std::map over enough inserts and erases to grow the map
+// several times and to rehash away tombstones.
+TEST(FlatHashMapTest, MatchesStdMap) {
+  FlatHashMap<unsigned, unsigned> Map;
+  std::map<unsigned, unsigned> Ref;
+  unsigned Seed = 1;
+  for (unsigned I = 0; I != 20000; ++I) {
+    Seed = Seed * 1103515245 + 12345;
+    unsigned Key = (Seed >> 8) % 2048;
+    if (Seed & 1) {
+      Map[Key] = I;
+      Ref[Key] = I;
+    } else {
+      EXPECT_EQ(Ref.erase(Key) != 0, Map.erase(Key));
+    }
+  }
+  EXPECT_EQ(Ref.size(), Map.size());
+  for (const auto &KV : Ref) {
+    auto It = Map.find(KV.first);
+    ASSERT_TRUE(It != Map.end());
+    EXPECT_EQ(KV.second, It->second);
+  }
+  unsigned Visited = 0;
+  for (const auto &KV : Map) {
+    EXPECT_EQ(Ref[KV.first], KV.second);
+    ++Visited;
+  }
+  EXPECT_EQ(Ref.size(), Visited);
+}
+
+TEST(FlatHashMapTest, EraseIterator) {
+  FlatHashMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map[I] = I;
+  for (unsigned I = 0; I != 100; I += 2)
+    Map.erase(Map.find(I));
+  EXPECT_EQ(50u, Map.size());
+  for (unsigned I = 0; I != 100; ++I)
+    EXPECT_EQ(I % 2, Map.count(I));
+}
+
+TEST(FlatHashMapTest, ReserveAvoidsRehash) {
+  FlatHashMap<unsigned, unsigned> Map;
+  Map.reserve(1000);
+  unsigned NumBuckets = Map.getNumBuckets();
+  EXPECT_GE(NumBuckets, 1000u);
+  for (unsigned I = 0; I != 1000; ++I)
+    Map[I] = I;
+  EXPECT_EQ(NumBuckets, Map.getNumBuckets());
+}
+
+// Erasing and inserting keeps the number of buckets stable instead of
+// growing the map for every tombstone.
+TEST(FlatHashMapTest, TombstonesDoNotGrow) {
+  FlatHashMap<unsigned, unsigned> Map;
+  for (unsigned I = 0; I != 5; ++I)
+    Map[I] = I;
+  unsigned NumBuckets = Map.getNumBuckets();
+  for (unsigned I = 5; I != 10000; ++I) {
+    Map.erase(I - 5);
+    Map[I] = I;
+  }
+  EXPECT_EQ(5u, Map.size());
+  EXPECT_EQ(NumBuckets, Map.getNumBuckets());
+}
+
+TEST(FlatHashMapTest, CopyMoveSwap) {
+  FlatHashMap<unsigned, std::string> Map = {{1, "one"}, {2, "two"}};
+  FlatHashMap<unsigned, std::string> Copy(Map);
+  EXPECT_EQ(2u, Copy.size());
+  EXPECT_EQ("two", Copy.lookup(2));
+
+  FlatHashMap<unsigned, std::string> Moved(std::move(Copy));
+  EXPECT_EQ(2u, Moved.size());
+  EXPECT_EQ("one", Moved.lookup(1));
+
+  FlatHashMap<unsigned, std::string> Other;
+  Other[3] = "three";
+  Other.swap(Moved);
+  EXPECT_EQ(1u, Moved.size());
+  EXPECT_EQ(2u, Other.size());
+
+  Other = Map;
+  EXPECT_EQ("one", Other.lookup(1));
+  Other = FlatHashMap<unsigned, std::string>();
+  EXPECT_TRUE(Other.empty());
+
+  Map.clear();
+  EXPECT_TRUE(Map.empty());
+  EXPECT_EQ(0u, Map.count(1));
+}
+
+TEST(FlatHashMapTest, MoveOnlyValue) {
+  FlatHashMap<unsigned, std::unique_ptr<int>> Map;
+  for (unsigned I = 0; I != 100; ++I)
+    Map.try_emplace(I, new int(I));
+  for (unsigned I = 0; I != 100; ++I)
+    EXPECT_EQ(int(I), *Map.find(I)->second);
+}
+
+TEST(FlatHashMapTest, StringRefKeys) {
+  std::vector<std::string> Names;
+  for (unsigned I = 0; I != 500; ++I)
+    Names.push_back("sym" + std::to_string(I));
+  FlatHashMap<StringRef, unsigned> Map;
+  for (unsigned I = 0; I != Names.size(); ++I)
+    Map[Names[I]] = I;
+  for (unsigned I = 0; I != Names.size(); ++I)
+    EXPECT_EQ(I, Map.lookup(Names[I]));
+  EXPECT_EQ(0u, Map.count("missing"));
+}
+
+TEST(FlatHashMapTest, ConstIterator) {
+  FlatHashMap<unsigned, unsigned> Map;
+  Map[1] = 2;
+  const auto &CMap = Map;
+  FlatHashMap<unsigned, unsigned>::const_iterator It = Map.begin();
+  EXPECT_TRUE(It == CMap.begin());
+  EXPECT_TRUE(CMap.find(1) == It);
+  EXPECT_TRUE(++It == CMap.end());
+}
+
+} // end anonymous namespace
@@ -129,3 +129,42 @@ TEST_F(BasicAATest, AliasInstWithFullObjectOfImpreciseSize) {
                 AAQI),
             AliasResult::MayAlias);
 }
+
+// Check that batched queries, which share the decomposition of each pointer,
+// give the same answers as individual queries.
+TEST_F(BasicAATest, BatchAliasMatrix) {
+  F = Function::Create(
+      FunctionType::get(B.getVoidTy(), {B.getInt64Ty()}, false),
+      GlobalValue::ExternalLinkage, "F", &M);
+
+  BasicBlock *Entry(BasicBlock::Create(C, "", F));
+  B.SetInsertPoint(Entry);
+
+  Value *ArbitraryI64 = F->arg_begin();
+  Type *ArrayTy = ArrayType::get(B.getInt32Ty(), 4);
+  AllocaInst *Array = B.CreateAlloca(ArrayTy);
+  SmallVector<MemoryLocation, 4> Locs;
+  for (unsigned I = 0; I < 3; ++I)
+    Locs.push_back(MemoryLocation(B.CreateConstInBoundsGEP2_64(Array, 0, I),
+                                  LocationSize::precise(4)));
+  Locs.push_back(MemoryLocation(
+      B.CreateInBoundsGEP(ArrayTy, Array, {B.getInt64(0), ArbitraryI64}),
+      LocationSize::precise(4)));
+
+  auto &AllAnalyses = setupAnalyses();
+  AAResults AAR(TLI);
+  AAR.addAAResult(AllAnalyses.BAA);
+  BatchAAResults BatchAA(AAR);
+
+  SmallVector<AliasResult, 16> Results;
+  BatchAA.alias(Locs, Locs, Results);
+  ASSERT_EQ(Results.size(), Locs.size() * Locs.size());
+  for (unsigned I = 0; I < Locs.size(); ++I)
+    for (unsigned J = 0; J < Locs.size(); ++J)
+      EXPECT_EQ(Results[I * Locs.size() + J], AAR.alias(Locs[I], Locs[J]));
+
+  EXPECT_EQ(Results[0 * Locs.size() + 0], AliasResult::MustAlias);
+  EXPECT_EQ(Results[0 * Locs.size() + 1], AliasResult::NoAlias);
+  EXPECT_EQ(Results[2 * Locs.size() + 1], AliasResult::NoAlias);
+  EXPECT_EQ(Results[3 * Locs.size() + 2], AliasResult::MayAlias);
+}
@@ -22,6 +22,7 @@
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/SourceMgr.h"
 #include "gtest/gtest.h"
 
@@ -1637,5 +1638,101 @@ TEST_F(ScalarEvolutionsTest, SCEVExpandInsertCanonicalIV) {
   TestMatchingCanonicalIV(GetAR2, ARBitWidth);
 }
 
+TEST_F(ScalarEvolutionsTest, SCEVBoundedValueCache) {
+  /*
+   * Create the following code:
+   * void func(i64 %a)
+   * entry:
+   *  %s1 = add i64 %a, 1
+   *  %s2 = add i64 %s1, 1
+   *  ...
+   *  %s8 = add i64 %s7, 1
+   *  ret
+   */
+  Module M("SCEVBoundedValueCache", Context);
+
+  Type *T_int64 = Type::getInt64Ty(Context);
+  FunctionType *FTy =
+      FunctionType::get(Type::getVoidTy(Context), { T_int64 }, false);
+  Function *F = Function::Create(FTy, Function::ExternalLinkage, "func", M);
+  Argument *A = &*F->arg_begin();
+  ConstantInt *One = ConstantInt::get(Context, APInt(64, 1));
+
+  BasicBlock *Entry = BasicBlock::Create(Context, "entry", F);
+  IRBuilder<> Builder(Entry);
+  SmallVector<Value *, 8> Sums;
+  Value *Sum = A;
+  for (unsigned I = 1; I <= 8; ++I) {
+    Sum = Builder.CreateAdd(Sum, One, "s" + Twine(I));
+    Sums.push_back(Sum);
+  }
+  Builder.CreateRetVoid();
+
+  auto *MaxCacheSize = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions()["scalar-evolution-max-value-cache-size"]);
+  ASSERT_NE(MaxCacheSize, nullptr);
+  *MaxCacheSize = 2;
+
+  ScalarEvolution SE = buildSE(*F);
+  // Evicted values are analyzed again, which yields the same uniqued SCEVs.
+  const SCEV *Last = SE.getSCEV(Sums.back());
+  EXPECT_EQ(Last, SE.getAddExpr(SE.getSCEV(A), SE.getConstant(T_int64, 8)));
+  for (unsigned I = 0; I < Sums.size(); ++I)
+    EXPECT_EQ(SE.getSCEV(Sums[I]),
+              SE.getAddExpr(SE.getSCEV(A), SE.getConstant(T_int64, I + 1)));
+  EXPECT_EQ(SE.getSCEV(Sums.back()), Last);
+
+  *MaxCacheSize = 0;
+}
+
+TEST_F(ScalarEvolutionsTest, SCEVBoundedValueCacheForgetEvicted) {
+  LLVMContext C;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(
+      "define void @f(i64 %a) { "
+      "entry: "
+      "  %n = mul i64 %a, 3 "
+      "  br label %loop "
+      "loop: "
+      "  %iv = phi i64 [ 0, %entry ], [ %iv.next, %loop ] "
+      "  %iv.next = add i64 %iv, 1 "
+      "  %c = icmp ne i64 %iv.next, %n "
+      "  br i1 %c, label %loop, label %exit "
+      "exit: "
+      "  %x1 = add i64 %a, 1 "
+      "  %x2 = add i64 %a, 2 "
+      "  %x3 = add i64 %a, 3 "
+      "  ret void "
+      "} ",
+      Err, C);
+
+  ASSERT_TRUE(M && "Could not parse module?");
+  ASSERT_TRUE(!verifyModule(*M) && "Must have been well formed!");
+
+  auto *MaxCacheSize = static_cast<cl::opt<unsigned> *>(
+      cl::getRegisteredOptions()["scalar-evolution-max-value-cache-size"]);
+  ASSERT_NE(MaxCacheSize, nullptr);
+
+  runWithSE(*M, "f", [&](Function &F, LoopInfo &LI, ScalarEvolution &SE) {
+    auto *N = cast<BinaryOperator>(getInstructionByName(F, "n"));
+    const Loop *L = LI.getLoopFor(getInstructionByName(F, "iv")->getParent());
+    const SCEV *One = SE.getOne(N->getType());
+    EXPECT_EQ(SE.getBackedgeTakenCount(L),
+              SE.getMinusSCEV(SE.getSCEV(N), One));
+
+    // Evict %n, on which the memoized backedge-taken count depends.
+    *MaxCacheSize = 2;
+    for (StringRef Name : {"x1", "x2", "x3"})
+      SE.getSCEV(getInstructionByName(F, Name));
+    *MaxCacheSize = 0;
+
+    // Forgetting the evicted %n must not leave the count computed from it.
+    N->setOperand(1, ConstantInt::get(N->getType(), 5));
+    SE.forgetValue(N);
+    EXPECT_EQ(SE.getBackedgeTakenCount(L),
+              SE.getMinusSCEV(SE.getSCEV(N), One));
+  });
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -31,6 +31,8 @@
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Testing/Support/Error.h"
 #include "gtest/gtest.h"
+#include <map>
+#include <mutex>
 #include <string>
 
 using namespace llvm;
@@ -3158,4 +3160,58 @@ TEST(DWARFDebugInfo, TestDWARFDieRangeInfoIntersects) {
   AssertRangesIntersect(Ranges, {{0x20, 0x21}, {0x2f, 0x31}});
 }
 
+TEST(DWARFDebugInfo, TestForEachNormalUnitInParallel) {
+  // Create two compile units and read their unit DIEs from different
+  // threads.
+  const char *yamldata = R"(
+    debug_str:
+      - ''
+      - /tmp/a.c
+      - /tmp/b.c
+    debug_abbrev:
+      - Code:            0x00000001
+        Tag:             DW_TAG_compile_unit
+        Children:        DW_CHILDREN_no
+        Attributes:
+          - Attribute:       DW_AT_name
+            Form:            DW_FORM_strp
+    debug_info:
+      - Length:
+          TotalLength:     12
+        Version:         4
+        AbbrOffset:      0
+        AddrSize:        8
+        Entries:
+          - AbbrCode:        0x00000001
+            Values:
+              - Value:           0x0000000000000001
+      - Length:
+          TotalLength:     12
+        Version:         4
+        AbbrOffset:      0
+        AddrSize:        8
+        Entries:
+          - AbbrCode:        0x00000001
+            Values:
+              - Value:           0x000000000000000A
+  )";
+  auto ErrOrSections = DWARFYAML::EmitDebugSections(StringRef(yamldata));
+  ASSERT_TRUE((bool)ErrOrSections);
+  std::unique_ptr<DWARFContext> DwarfContext =
+      DWARFContext::create(*ErrOrSections, 8);
+
+  std::mutex Mutex;
+  std::map<uint32_t, std::string> Names;
+  DwarfContext->forEachNormalUnitInParallel(
+      [&](DWARFUnit &U) {
+        const char *Name = U.getUnitDIE().getName(DINameKind::ShortName);
+        std::lock_guard<std::mutex> Lock(Mutex);
+        Names[U.getOffset()] = Name ? Name : "";
+      },
+      2);
+  ASSERT_EQ(Names.size(), 2u);
+  EXPECT_EQ(Names[0], "/tmp/a.c");
+  EXPECT_EQ(Names[16], "/tmp/b.c");
+}
+
 } // end anonymous namespace
@@ -191,3 +191,27 @@ TEST(PartialDemanglerTest, TestPrintCases) {
 
   std::free(Buf);
 }
+
+TEST(PartialDemanglerTest, TestDemangleContext) {
+  llvm::ItaniumDemangleContext Ctx;
+
+  size_t Len = 0;
+  const char *Res = Ctx.demangle("_Z1fv", 5, &Len);
+  EXPECT_STREQ("f()", Res);
+  EXPECT_EQ(3u, Len);
+
+  // The buffer grows for longer names and is reused afterwards.
+  Res = Ctx.demangle("_ZN1a1b1cIiiiEEvm", 17);
+  EXPECT_STREQ("void a::b::c<int, int, int>(unsigned long)", Res);
+  const char *Buf = Res;
+  Res = Ctx.demangle("_Z1gv", 5);
+  EXPECT_STREQ("g()", Res);
+  EXPECT_EQ(Buf, Res);
+
+  // The name need not be null-terminated.
+  Res = Ctx.demangle("_Z1hvXXX", 5);
+  EXPECT_STREQ("h()", Res);
+
+  EXPECT_EQ(nullptr, Ctx.demangle("Not a mangled name!", 19));
+  EXPECT_STREQ("f()", Ctx.demangle("_Z1fv", 5));
+}
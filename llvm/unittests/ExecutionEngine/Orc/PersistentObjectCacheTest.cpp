@@ -0,0 +1,84 @@
+//===--- PersistentObjectCacheTest.cpp - Unit tests for the object cache --===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/Orc/PersistentObjectCache.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+class PersistentObjectCacheTest : public testing::Test {
+protected:
+  void SetUp() override {
+    ASSERT_FALSE(
+        sys::fs::createUniqueDirectory("orc-object-cache", CacheDir));
+  }
+
+  void TearDown() override { sys::fs::remove_directories(CacheDir); }
+
+  // Builds "int f() { return Result; }".
+  std::unique_ptr<Module> createModule(int Result) {
+    auto M = llvm::make_unique<Module>("cached", Ctx);
+    auto *F = Function::Create(
+        FunctionType::get(Type::getInt32Ty(Ctx), false),
+        GlobalValue::ExternalLinkage, "f", M.get());
+    IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", F));
+    Builder.CreateRet(Builder.getInt32(Result));
+    return M;
+  }
+
+  std::unique_ptr<PersistentObjectCache> createCache(StringRef CPU) {
+    JITTargetMachineBuilder JTMB(Triple("x86_64-unknown-linux-gnu"));
+    JTMB.setCPU(CPU);
+    return cantFail(PersistentObjectCache::Create(CacheDir, JTMB));
+  }
+
+  SmallString<128> CacheDir;
+  LLVMContext Ctx;
+};
+
+TEST_F(PersistentObjectCacheTest, HitAfterCompile) {
+  auto Cache = createCache("generic");
+  auto M = createModule(42);
+  EXPECT_EQ(Cache->getObject(M.get()), nullptr) << "Empty cache should miss";
+
+  StringRef Obj = "not really an object";
+  Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Obj, "obj"));
+  auto Cached = Cache->getObject(M.get());
+  ASSERT_NE(Cached, nullptr) << "Compiled object should be cached";
+  EXPECT_EQ(Cached->getBuffer(), Obj) << "Wrong cached object";
+
+  // The entry survives the cache instance.
+  auto OtherCache = createCache("generic");
+  auto Reloaded = OtherCache->getObject(createModule(42).get());
+  ASSERT_NE(Reloaded, nullptr) << "Entry should persist on disk";
+  EXPECT_EQ(Reloaded->getBuffer(), Obj) << "Wrong persisted object";
+}
+
+TEST_F(PersistentObjectCacheTest, KeyCoversModuleAndTarget) {
+  auto Cache = createCache("generic");
+  auto M = createModule(42);
+  StringRef Obj = "not really an object";
+  Cache->getObject(M.get());
+  Cache->notifyObjectCompiled(M.get(), MemoryBufferRef(Obj, "obj"));
+
+  EXPECT_EQ(Cache->getObject(createModule(43).get()), nullptr)
+      << "Changed module should miss";
+  EXPECT_EQ(createCache("skylake")->getObject(M.get()), nullptr)
+      << "Changed CPU should miss";
+  EXPECT_NE(Cache->getKey(*M), createCache("skylake")->getKey(*M));
+}
+
+} // namespace
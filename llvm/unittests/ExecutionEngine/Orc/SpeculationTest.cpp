@@ -0,0 +1,88 @@
+//===------ SpeculationTest.cpp - Unit tests for speculative lookups ------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/Speculation.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+class SpeculationTest : public CoreAPIsBasedStandardTest {
+protected:
+  // Defines Name in JD, setting Materialized when it is materialized.
+  void defineTracked(SymbolStringPtr Name, JITEvaluatedSymbol Sym,
+                     bool &Materialized) {
+    cantFail(JD.define(llvm::make_unique<SimpleMaterializationUnit>(
+        SymbolFlagsMap({{Name, Sym.getFlags()}}),
+        [Name, Sym, &Materialized](MaterializationResponsibility R) {
+          Materialized = true;
+          R.notifyResolved({{Name, Sym}});
+          R.notifyEmitted();
+        })));
+  }
+};
+
+namespace {
+
+TEST_F(SpeculationTest, HighestPriorityTargetsFirst) {
+  bool BarMaterialized = false;
+  bool BazMaterialized = false;
+  defineTracked(Bar, BarSym, BarMaterialized);
+  defineTracked(Baz, BazSym, BazMaterialized);
+
+  Speculator S(ES, /*MaxDepth=*/1, /*MaxTargetsPerSymbol=*/1);
+  S.speculateFor(JD, Foo, {{Bar, 1}, {Baz, 2}});
+
+  EXPECT_FALSE(BarMaterialized) << "Low priority target was speculated";
+  EXPECT_TRUE(BazMaterialized) << "High priority target was not speculated";
+}
+
+TEST_F(SpeculationTest, DepthLimitAndMissingTargets) {
+  bool BarMaterialized = false;
+  bool BazMaterialized = false;
+  defineTracked(Bar, BarSym, BarMaterialized);
+  defineTracked(Baz, BazSym, BazMaterialized);
+
+  // Qux is not defined: speculating on it must be harmless.
+  Speculator S(ES, /*MaxDepth=*/1);
+  S.speculateFor(JD, Foo, {{Qux, 2}, {Bar, 1}});
+  EXPECT_TRUE(BarMaterialized) << "Target was not speculated";
+
+  // Bar was speculated on, so its own targets are beyond MaxDepth.
+  S.speculateFor(JD, Bar, {{Baz, 1}});
+  EXPECT_FALSE(BazMaterialized) << "Speculation exceeded the depth limit";
+}
+
+TEST_F(SpeculationTest, FindDirectCallees) {
+  LLVMContext Ctx;
+  Module M("M", Ctx);
+  M.setDataLayout("");
+  auto *FTy = FunctionType::get(Type::getVoidTy(Ctx), false);
+  auto *Caller = Function::Create(FTy, GlobalValue::ExternalLinkage, "foo", M);
+  auto *Hot = Function::Create(FTy, GlobalValue::ExternalLinkage, "bar", M);
+  auto *Cold = Function::Create(FTy, GlobalValue::ExternalLinkage, "baz", M);
+  Hot->setEntryCount(100);
+
+  IRBuilder<> Builder(BasicBlock::Create(Ctx, "entry", Caller));
+  Builder.CreateCall(Cold);
+  Builder.CreateCall(Cold);
+  Builder.CreateCall(Hot);
+  Builder.CreateRetVoid();
+
+  MangleAndInterner Mangle(ES, M.getDataLayout());
+  auto Targets = IRSpeculationLayer::findDirectCallees(*Caller, Mangle);
+  ASSERT_EQ(Targets.size(), 2U) << "Expected two distinct callees";
+  EXPECT_EQ(Targets[0].first, Baz);
+  EXPECT_EQ(Targets[0].second, 2U) << "Expected the call site count";
+  EXPECT_EQ(Targets[1].first, Bar);
+  EXPECT_EQ(Targets[1].second, 100U) << "Expected the profile entry count";
+}
+
+} // namespace
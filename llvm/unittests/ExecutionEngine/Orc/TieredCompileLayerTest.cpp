@@ -0,0 +1,60 @@
+//===-- TieredCompileLayerTest.cpp - Unit tests for tiered compilation ----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "OrcTestCommon.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+using namespace llvm::orc;
+
+namespace {
+
+// Builds "int inc(int X) { return X + 1; }".
+static ThreadSafeModule createIncModule() {
+  auto Ctx = llvm::make_unique<LLVMContext>();
+  auto M = llvm::make_unique<Module>("tiered", *Ctx);
+  auto *Int32Ty = Type::getInt32Ty(*Ctx);
+  auto *Inc = Function::Create(FunctionType::get(Int32Ty, {Int32Ty}, false),
+                               GlobalValue::ExternalLinkage, "inc", M.get());
+  IRBuilder<> Builder(BasicBlock::Create(*Ctx, "entry", Inc));
+  Builder.CreateRet(Builder.CreateAdd(&*Inc->arg_begin(), Builder.getInt32(1)));
+  return ThreadSafeModule(std::move(M), std::move(Ctx));
+}
+
+TEST(TieredCompileLayerTest, HotFunctionIsRecompiled) {
+  OrcNativeTarget::initialize();
+
+  // Bail out if the host does not support lazy compilation.
+  auto J = LLLazyJITBuilder().setTieredCompilation(3).create();
+  if (!J) {
+    consumeError(J.takeError());
+    return;
+  }
+
+  cantFail((*J)->addLazyIRModule(createIncModule()));
+  auto IncSym = cantFail((*J)->lookup("inc"));
+  auto *Inc = reinterpret_cast<int (*)(int)>(
+      static_cast<uintptr_t>(IncSym.getAddress()));
+
+  // Calls must keep working before, while and after the function tiers up.
+  for (int I = 0; I != 10; ++I)
+    EXPECT_EQ(Inc(I), I + 1) << "Wrong result at call " << I;
+
+  auto *OptJD = (*J)->getJITDylibByName("<main>.impl.opt");
+  ASSERT_NE(OptJD, nullptr) << "No dylib for recompiled functions";
+  auto OptInc = (*J)->lookup(*OptJD, "inc");
+  ASSERT_TRUE(!!OptInc) << "No definition for the recompiled function";
+  auto *OptIncPtr = reinterpret_cast<int (*)(int)>(
+      static_cast<uintptr_t>(OptInc->getAddress()));
+  EXPECT_EQ(OptIncPtr(41), 42) << "Recompiled function is wrong";
+}
+
+} // namespace
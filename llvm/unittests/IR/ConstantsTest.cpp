@@ -583,5 +583,41 @@ TEST(ConstantsTest, FoldGlobalVariablePtr) {
       Instruction::And, TheConstantExpr, TheConstant)->isNullValue());
 }
 
+TEST(ConstantsTest, DropTriviallyDeadConstants) {
+  LLVMContext Context;
+  Type *Int32Ty = Type::getInt32Ty(Context);
+  Type *Int64Ty = Type::getInt64Ty(Context);
+  Module M("test", Context);
+  auto *Live = ConstantInt::get(Int32Ty, 7);
+  new GlobalVariable(M, Int32Ty, true, GlobalValue::ExternalLinkage, Live);
+  auto *Ranged = ConstantInt::get(Int32Ty, 9);
+  MDNode *Range = MDNode::get(Context, ConstantAsMetadata::get(Ranged));
+
+  // Nothing uses the array, the expression or the data array below.
+  Constant *Elts[] = {ConstantInt::get(Int64Ty, 1234),
+                      ConstantInt::get(Int64Ty, 5678)};
+  auto *Arr = ConstantArray::get(ArrayType::get(Int64Ty, 2), Elts);
+  auto *GV = new GlobalVariable(M, Arr->getType(), true,
+                                GlobalValue::ExternalLinkage, nullptr);
+  ConstantExpr::getPtrToInt(GV, Int64Ty);
+  ConstantDataArray::get(Context, makeArrayRef<uint32_t>({1, 2, 3}));
+  Context.dropTriviallyDeadConstants();
+
+  // The survivors are the same objects as before.
+  EXPECT_EQ(Live, ConstantInt::get(Int32Ty, 7));
+  EXPECT_EQ(Ranged, ConstantInt::get(Int32Ty, 9));
+  EXPECT_EQ(Ranged, mdconst::extract<ConstantInt>(Range->getOperand(0)));
+  EXPECT_TRUE(GV->use_empty());
+
+  // The dead constants can be recreated.
+  EXPECT_EQ(1234u,
+            cast<ConstantInt>(ConstantInt::get(Int64Ty, 1234))->getZExtValue());
+  EXPECT_EQ(ConstantInt::getTrue(Context), ConstantInt::get(Context,
+                                                            APInt(1, 1)));
+  auto *CDA = cast<ConstantDataArray>(
+      ConstantDataArray::get(Context, makeArrayRef<uint32_t>({1, 2, 3})));
+  EXPECT_EQ(3u, CDA->getElementAsInteger(2));
+}
+
 }  // end anonymous namespace
 }  // end namespace llvm
@@ -690,6 +690,39 @@ TEST(InstructionsTest, GEPIndices) {
   delete GEPI;
 }
 
+TEST(InstructionsTest, GEPResultElementType) {
+  // A GEP only stores its source element type, the result element type comes
+  // from the result type.
+  static_assert(sizeof(GetElementPtrInst) ==
+                    sizeof(Instruction) + sizeof(Type *),
+                "GetElementPtrInst grew");
+
+  LLVMContext Context;
+  IRBuilder<NoFolder> Builder(Context);
+  Type *I8Ty = Builder.getInt8Ty();
+  Type *I16Ty = Builder.getInt16Ty();
+  StructType *STy = StructType::get(I8Ty, ArrayType::get(I8Ty, 4));
+  Value *Indices[] = {Builder.getInt32(0), Builder.getInt32(1),
+                      Builder.getInt32(2)};
+  auto *GEPI = cast<GetElementPtrInst>(Builder.CreateGEP(
+      STy, UndefValue::get(PointerType::getUnqual(STy)), Indices));
+  EXPECT_EQ(STy, GEPI->getSourceElementType());
+  EXPECT_EQ(I8Ty, GEPI->getResultElementType());
+
+  // Remapping types, as the IR mover does, keeps both in sync
+  StructType *NewSTy = StructType::get(I16Ty, ArrayType::get(I16Ty, 4));
+  GEPI->setSourceElementType(NewSTy);
+  GEPI->mutateType(PointerType::getUnqual(I16Ty));
+  EXPECT_EQ(NewSTy, GEPI->getSourceElementType());
+  EXPECT_EQ(I16Ty, GEPI->getResultElementType());
+
+  std::unique_ptr<GetElementPtrInst> Clone(
+      cast<GetElementPtrInst>(GEPI->clone()));
+  EXPECT_EQ(I16Ty, Clone->getResultElementType());
+
+  delete GEPI;
+}
+
 TEST(InstructionsTest, SwitchInst) {
   LLVMContext C;
 
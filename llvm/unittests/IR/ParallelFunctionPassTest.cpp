@@ -0,0 +1,261 @@
+//===- ParallelFunctionPassTest.cpp - ParallelFunctionPass unit tests -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Passes/ParallelFunctionPass.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/InstCombine/InstCombine.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace llvm;
+
+namespace {
+
+const char *TestIR = R"IR(
+@table = private constant [4 x i32] [i32 1, i32 2, i32 3, i32 4]
+@counter = internal global i32 0
+
+define internal i32 @helper(i32 %x) {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
+
+define i32 @a() {
+  %p = getelementptr [4 x i32], [4 x i32]* @table, i32 0, i32 1
+  %v = load i32, i32* %p
+  %r = call i32 @helper(i32 %v)
+  ret i32 %r
+}
+
+define i32 @b(i32 %x) {
+  %m = mul i32 %x, 1
+  store i32 %m, i32* @counter
+  %r = call i32 @helper(i32 %m)
+  ret i32 %r
+}
+
+define internal void @0() {
+  ret void
+}
+
+define void @c() {
+  call void @0()
+  ret void
+}
+
+define linkonce_odr i32 @d(i32 %x) {
+  %s = shl i32 %x, 0
+  ret i32 %s
+}
+
+@alias = alias i32 (i32), i32 (i32)* @d
+)IR";
+
+std::unique_ptr<Module> parseIR(LLVMContext &C, const char *IR) {
+  SMDiagnostic Err;
+  return parseAssemblyString(IR, Err, C);
+}
+
+std::string print(const Module &M) {
+  std::string S;
+  raw_string_ostream OS(S);
+  M.print(OS, nullptr);
+  return OS.str();
+}
+
+std::unique_ptr<ParallelFunctionPassWorker> createInstCombineWorker() {
+  auto Worker = llvm::make_unique<ParallelFunctionPassWorker>();
+  PassBuilder PB;
+  PB.registerModuleAnalyses(Worker->MAM);
+  PB.registerCGSCCAnalyses(Worker->CGAM);
+  PB.registerFunctionAnalyses(Worker->FAM);
+  PB.registerLoopAnalyses(Worker->LAM);
+  PB.crossRegisterProxies(Worker->LAM, Worker->FAM, Worker->CGAM,
+                          Worker->MAM);
+  Worker->FPM.addPass(InstCombinePass());
+  return Worker;
+}
+
+/// Run \p P on \p M, with the analysis managers of a worker of its own.
+void run(ParallelFunctionPass P, Module &M) {
+  std::unique_ptr<ParallelFunctionPassWorker> Outer = createInstCombineWorker();
+  P.run(M, Outer->MAM);
+}
+
+TEST(ParallelFunctionPassTest, MatchesSerialRun) {
+  LLVMContext SerialCtx;
+  std::unique_ptr<Module> Serial = parseIR(SerialCtx, TestIR);
+  ASSERT_TRUE(Serial);
+  // A single thread runs the pipeline of a single worker on the module.
+  run(ParallelFunctionPass(1, createInstCombineWorker), *Serial);
+
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(Ctx, TestIR);
+  ASSERT_TRUE(M);
+  run(ParallelFunctionPass(3, createInstCombineWorker), *M);
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(print(*Serial), print(*M));
+}
+
+TEST(ParallelFunctionPassTest, RestoresSymbols) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(Ctx, TestIR);
+  ASSERT_TRUE(M);
+  unsigned NumFunctions = M->size();
+  run(ParallelFunctionPass(2, createInstCombineWorker), *M);
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(NumFunctions, M->size());
+  EXPECT_TRUE(M->getFunction("helper")->hasInternalLinkage());
+  EXPECT_TRUE(M->getNamedGlobal("counter")->hasInternalLinkage());
+  EXPECT_TRUE(M->getFunction("d")->hasLinkOnceODRLinkage());
+  EXPECT_EQ(M->getFunction("d"), M->getNamedAlias("alias")->getAliasee());
+
+  // The unnamed function is still unnamed, and still the one @c calls.
+  Function *Unnamed = &*std::next(M->begin(), 3);
+  EXPECT_FALSE(Unnamed->hasName());
+  EXPECT_TRUE(Unnamed->hasInternalLinkage());
+  Function *C = M->getFunction("c");
+  EXPECT_EQ(Unnamed,
+            cast<CallInst>(C->getEntryBlock().front()).getCalledFunction());
+
+  // The bodies were optimized: the load from @table was folded.
+  Function *A = M->getFunction("a");
+  auto *Call = cast<CallInst>(&A->getEntryBlock().front());
+  EXPECT_EQ(M->getFunction("helper"), Call->getCalledFunction());
+  EXPECT_TRUE(isa<ConstantInt>(Call->getArgOperand(0)));
+}
+
+/// Raises the alignment of @g from @a and marks @ext nounwind from @b, as
+/// InstCombine and the library call simplifier do.
+struct StrengthenGlobalsPass : PassInfoMixin<StrengthenGlobalsPass> {
+  PreservedAnalyses run(Function &F, FunctionAnalysisManager &) {
+    Module &M = *F.getParent();
+    if (F.getName() == "a")
+      M.getGlobalVariable("g", /*AllowInternal=*/true)->setAlignment(16);
+    if (F.getName() == "b")
+      M.getFunction("ext")->addFnAttr(Attribute::NoUnwind);
+    return PreservedAnalyses::none();
+  }
+};
+
+TEST(ParallelFunctionPassTest, MergesGlobalChanges) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(Ctx, R"IR(
+@g = internal global [4 x i32] zeroinitializer, align 4
+
+declare void @ext()
+
+define void @a() {
+  store i32 1, i32* getelementptr ([4 x i32], [4 x i32]* @g, i32 0, i32 0)
+  ret void
+}
+
+define void @b() {
+  call void @ext()
+  ret void
+}
+)IR");
+  ASSERT_TRUE(M);
+  run(ParallelFunctionPass(2,
+                           [] {
+                             auto Worker = createInstCombineWorker();
+                             Worker->FPM.addPass(StrengthenGlobalsPass());
+                             return Worker;
+                           }),
+      *M);
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  EXPECT_EQ(16u, M->getNamedGlobal("g")->getAlignment());
+  EXPECT_TRUE(M->getNamedGlobal("g")->hasInternalLinkage());
+  EXPECT_TRUE(M->getFunction("ext")->hasFnAttribute(Attribute::NoUnwind));
+}
+
+/// Records the threads it runs on.
+struct ThreadRecorderPass : PassInfoMixin<ThreadRecorderPass> {
+  std::vector<std::thread::id> *Threads;
+  explicit ThreadRecorderPass(std::vector<std::thread::id> *Threads)
+      : Threads(Threads) {}
+  PreservedAnalyses run(Function &, FunctionAnalysisManager &) {
+    Threads->push_back(std::this_thread::get_id());
+    return PreservedAnalyses::all();
+  }
+};
+
+TEST(ParallelFunctionPassTest, RunsOptimizerLastOnce) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(Ctx, TestIR);
+  ASSERT_TRUE(M);
+  std::vector<std::thread::id> Threads;
+  PipelineTuningOptions PTO;
+  PTO.FunctionOptimizationThreads = 2;
+  PassBuilder PB(nullptr, PTO);
+  PB.registerOptimizerLastEPCallback(
+      [&](FunctionPassManager &FPM, PassBuilder::OptimizationLevel) {
+        FPM.addPass(ThreadRecorderPass(&Threads));
+      });
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+  ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(PassBuilder::O2);
+  MPM.run(*M, MAM);
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  // On this thread rather than a worker
+  EXPECT_FALSE(Threads.empty());
+  for (std::thread::id Id : Threads)
+    EXPECT_EQ(std::this_thread::get_id(), Id);
+}
+
+TEST(ParallelFunctionPassTest, FallsBackForDebugInfo) {
+  LLVMContext Ctx;
+  std::unique_ptr<Module> M = parseIR(Ctx, R"IR(
+define i32 @f(i32 %x) !dbg !4 {
+  %y = add i32 %x, 0
+  ret i32 %y
+}
+
+define i32 @g(i32 %x) {
+  %y = mul i32 %x, 1
+  ret i32 %y
+}
+
+!llvm.dbg.cu = !{!0}
+!llvm.module.flags = !{!3}
+
+!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, emissionKind: FullDebug)
+!1 = !DIFile(filename: "t.c", directory: "/")
+!2 = !DISubroutineType(types: !{})
+!3 = !{i32 2, !"Debug Info Version", i32 3}
+!4 = distinct !DISubprogram(name: "f", scope: !1, file: !1, type: !2, unit: !0, spFlags: DISPFlagDefinition)
+)IR");
+  ASSERT_TRUE(M);
+  Function *F = M->getFunction("f");
+  run(ParallelFunctionPass(2, createInstCombineWorker), *M);
+
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+  // The functions were optimized in place rather than replaced.
+  EXPECT_EQ(F, M->getFunction("f"));
+  EXPECT_TRUE(isa<ReturnInst>(F->getEntryBlock().front()));
+  EXPECT_EQ(1u, M->getNamedMetadata("llvm.dbg.cu")->getNumOperands());
+}
+
+} // end anonymous namespace
@@ -0,0 +1,119 @@
+//===- CachingTest.cpp - ThinLTO cache unit tests -------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/LTO/Caching.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+#include <chrono>
+#include <mutex>
+
+using namespace llvm;
+using namespace llvm::lto;
+
+namespace {
+
+/// Records the keys it is asked to prefetch.
+class RecordingStore : public ObjectStore {
+public:
+  std::vector<std::string> Prefetched;
+  std::mutex Mu;
+
+  Expected<std::unique_ptr<MemoryBuffer>> get(StringRef) override {
+    return nullptr;
+  }
+  Error put(StringRef, MemoryBufferRef) override { return Error::success(); }
+  void prefetch(StringRef Key) override {
+    std::lock_guard<std::mutex> Lock(Mu);
+    Prefetched.push_back(Key);
+  }
+};
+
+class CachingTest : public testing::Test {
+protected:
+  SmallString<128> Dir;
+
+  void SetUp() override {
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("caching-test", Dir));
+  }
+  void TearDown() override { sys::fs::remove_directories(Dir); }
+
+  void writeFile(StringRef Name, StringRef Contents) {
+    SmallString<128> Path(Dir);
+    sys::path::append(Path, Name);
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+    ASSERT_FALSE(EC);
+    OS << Contents;
+  }
+};
+
+TEST_F(CachingTest, PrefetchesOnlyMisses) {
+  writeFile("llvmcache-hit", "object");
+  auto Store = std::make_shared<RecordingStore>();
+  Config::CachePrefetchHookFn Prefetch = localCachePrefetcher(Dir, Store);
+  Prefetch("hit");
+  Prefetch("miss");
+  ASSERT_EQ(1u, Store->Prefetched.size());
+  EXPECT_EQ("miss", Store->Prefetched[0]);
+}
+
+#ifdef LLVM_ON_UNIX
+/// Create a command store whose objects are their keys, and whose lookups of
+/// the keys starting with "slow" take a second and find nothing.
+std::unique_ptr<ObjectStore> createTestStore(StringRef Dir,
+                                             unsigned Parallelism) {
+  SmallString<128> Path(Dir);
+  sys::path::append(Path, "store.sh");
+  {
+    std::error_code EC;
+    raw_fd_ostream OS(Path, EC, sys::fs::F_None);
+    if (EC)
+      return nullptr;
+    OS << "#!/bin/sh\n"
+          "test \"$1\" = get || exit 0\n"
+          "case \"$2\" in slow*) sleep 1; exit 1;; esac\n"
+          "printf %s \"$2\" > \"$3\"\n";
+  }
+  if (sys::fs::setPermissions(Path, sys::fs::all_read | sys::fs::all_exe |
+                                        sys::fs::owner_write))
+    return nullptr;
+  return createCommandObjectStore(Path, Parallelism);
+}
+
+TEST_F(CachingTest, ReturnsPrefetchedObjects) {
+  std::unique_ptr<ObjectStore> Store = createTestStore(Dir, 2);
+  ASSERT_TRUE(Store);
+  Store->prefetch("a");
+  Store->prefetch("b");
+  for (StringRef Key : {"a", "b", "c"}) {
+    Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = Store->get(Key);
+    ASSERT_TRUE(bool(MBOrErr));
+    ASSERT_TRUE(bool(*MBOrErr));
+    EXPECT_EQ(Key, (*MBOrErr)->getBuffer());
+  }
+  Expected<std::unique_ptr<MemoryBuffer>> MBOrErr = Store->get("slow");
+  ASSERT_TRUE(bool(MBOrErr));
+  EXPECT_FALSE(bool(*MBOrErr));
+}
+
+TEST_F(CachingTest, DropsPendingPrefetches) {
+  std::unique_ptr<ObjectStore> Store = createTestStore(Dir, 1);
+  ASSERT_TRUE(Store);
+  for (int I = 0; I < 30; ++I)
+    Store->prefetch("slow" + std::to_string(I));
+  auto Start = std::chrono::steady_clock::now();
+  Store.reset();
+  // Only the lookup that has started is waited for, not all thirty.
+  EXPECT_LT(std::chrono::steady_clock::now() - Start, std::chrono::seconds(15));
+}
+#endif
+
+} // end anonymous namespace
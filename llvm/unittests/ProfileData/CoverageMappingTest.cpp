@@ -228,7 +228,8 @@ struct CoverageMappingTest : ::testing::TestWithParam<std::pair<bool, bool>> {
     ProfileReader = std::move(ReaderOrErr.get());
   }
 
-  Expected<std::unique_ptr<CoverageMapping>> readOutputFunctions() {
+  Expected<std::unique_ptr<CoverageMapping>>
+  readOutputFunctions(unsigned NumThreads = 1) {
     std::vector<std::unique_ptr<CoverageMappingReader>> CoverageReaders;
     if (UseMultipleReaders) {
       for (const auto &OF : OutputFunctions) {
@@ -241,13 +242,14 @@ struct CoverageMappingTest : ::testing::TestWithParam<std::pair<bool, bool>> {
       CoverageReaders.push_back(
           make_unique<CoverageMappingReaderMock>(Funcs));
     }
-    return CoverageMapping::load(CoverageReaders, *ProfileReader);
+    return CoverageMapping::load(CoverageReaders, *ProfileReader, NumThreads);
   }
 
-  Error loadCoverageMapping(bool EmitFilenames = true) {
+  Error loadCoverageMapping(bool EmitFilenames = true,
+                            unsigned NumThreads = 1) {
     readProfCounts();
     writeAndReadCoverageRegions(EmitFilenames);
-    auto CoverageOrErr = readOutputFunctions();
+    auto CoverageOrErr = readOutputFunctions(NumThreads);
     if (!CoverageOrErr)
       return CoverageOrErr.takeError();
     LoadedCoverage = std::move(CoverageOrErr.get());
@@ -888,6 +890,100 @@ TEST_P(CoverageMappingTest, skip_duplicate_function_record) {
   ASSERT_EQ(3U, NumFuncs);
 }
 
+static void expectSameFunctions(const CoverageMapping &LHS,
+                                const CoverageMapping &RHS) {
+  auto LHSFuncs = LHS.getCoveredFunctions();
+  auto RHSFuncs = RHS.getCoveredFunctions();
+  ASSERT_EQ(std::distance(LHSFuncs.begin(), LHSFuncs.end()),
+            std::distance(RHSFuncs.begin(), RHSFuncs.end()));
+  for (auto L = LHSFuncs.begin(), R = RHSFuncs.begin(); L != LHSFuncs.end();
+       ++L, ++R) {
+    const FunctionRecord &LF = *L, &RF = *R;
+    EXPECT_EQ(LF.Name, RF.Name);
+    EXPECT_EQ(LF.Filenames, RF.Filenames);
+    EXPECT_EQ(LF.ExecutionCount, RF.ExecutionCount);
+    ASSERT_EQ(LF.CountedRegions.size(), RF.CountedRegions.size());
+    for (unsigned I = 0; I < LF.CountedRegions.size(); ++I) {
+      const CountedRegion &LCR = LF.CountedRegions[I];
+      const CountedRegion &RCR = RF.CountedRegions[I];
+      EXPECT_EQ(LCR.Count, RCR.Count);
+      EXPECT_EQ(LCR.FileID, RCR.FileID);
+      EXPECT_EQ(LCR.startLoc(), RCR.startLoc());
+      EXPECT_EQ(LCR.endLoc(), RCR.endLoc());
+      EXPECT_EQ(LCR.Kind, RCR.Kind);
+      EXPECT_EQ(LCR.ExecutionCount, RCR.ExecutionCount);
+    }
+  }
+  EXPECT_EQ(LHS.getHashMismatches(), RHS.getHashMismatches());
+
+  std::vector<StringRef> Files = LHS.getUniqueSourceFiles();
+  EXPECT_EQ(Files, RHS.getUniqueSourceFiles());
+  for (StringRef File : Files) {
+    CoverageData LHSData = LHS.getCoverageForFile(File);
+    CoverageData RHSData = RHS.getCoverageForFile(File);
+    EXPECT_EQ(std::vector<CoverageSegment>(LHSData.begin(), LHSData.end()),
+              std::vector<CoverageSegment>(RHSData.begin(), RHSData.end()));
+    EXPECT_EQ(LHS.getInstantiationGroups(File).size(),
+              RHS.getInstantiationGroups(File).size());
+  }
+}
+
+TEST_P(CoverageMappingTest, load_coverage_with_several_threads) {
+  // Enough functions for several chunks of work.
+  for (unsigned I = 0; I < 300; ++I) {
+    std::string Name = "func" + std::to_string(I);
+    std::string File = "file" + std::to_string(I % 7);
+    ProfileWriter.addRecord({Name, I, {I, I / 2}}, Err);
+    startFunction(Name, I % 50 == 0 ? I + 1 : I); // Some hash mismatches.
+    addCMR(Counter::getCounter(0), File, I + 1, 1, I + 5, 1);
+    addCMR(Counter::getCounter(1), File, I + 2, 1, I + 3, 1);
+    addCMR(Counter::getCounter(0), "header", 1, 1, 2, 1);
+  }
+  // A duplicate of a record above, which is skipped.
+  startFunction("func1", 1);
+  addCMR(Counter::getCounter(0), "file1", 2, 1, 6, 1);
+  addCMR(Counter::getCounter(1), "file1", 3, 1, 4, 1);
+  addCMR(Counter::getCounter(0), "header", 1, 1, 2, 1);
+
+  EXPECT_THAT_ERROR(loadCoverageMapping(), Succeeded());
+  auto CoverageOrErr = readOutputFunctions(/*NumThreads=*/4);
+  ASSERT_THAT_ERROR(CoverageOrErr.takeError(), Succeeded());
+  EXPECT_EQ(6U, LoadedCoverage->getMismatchedCount());
+  expectSameFunctions(*LoadedCoverage, **CoverageOrErr);
+}
+
+TEST_P(CoverageMappingTest, cache_round_trip) {
+  ProfileWriter.addRecord({"func", 0x1234, {10, 3}}, Err);
+  ProfileWriter.addRecord({"mismatch", 0x1234, {1}}, Err);
+  startFunction("func", 0x1234);
+  addCMR(Counter::getCounter(0), "file1", 1, 1, 9, 9);
+  addCMR(Counter::getCounter(1), "file1", 2, 1, 3, 1);
+  addExpansionCMR("file1", "include1", 4, 1, 4, 5);
+  addCMR(Counter::getCounter(1), "include1", 1, 1, 1, 9);
+  addCMR(Counter::getZero(), "file1", 5, 1, 6, 1, /*Skipped=*/true);
+  startFunction("mismatch", 0x2345);
+  addCMR(Counter::getCounter(0), "file2", 1, 1, 2, 2);
+  EXPECT_THAT_ERROR(loadCoverageMapping(), Succeeded());
+
+  std::string Cache;
+  raw_string_ostream OS(Cache);
+  LoadedCoverage->writeCache(OS);
+  OS.flush();
+
+  auto CoverageOrErr = CoverageMapping::loadFromCache(Cache);
+  ASSERT_THAT_ERROR(CoverageOrErr.takeError(), Succeeded());
+  EXPECT_EQ(1U, (*CoverageOrErr)->getMismatchedCount());
+  expectSameFunctions(*LoadedCoverage, **CoverageOrErr);
+
+  // Truncated caches and other files are rejected.
+  EXPECT_THAT_ERROR(
+      CoverageMapping::loadFromCache(StringRef(Cache).drop_back(1))
+          .takeError(),
+      Failed());
+  EXPECT_THAT_ERROR(CoverageMapping::loadFromCache("not a cache").takeError(),
+                    Failed());
+}
+
 // FIXME: Use ::testing::Combine() when llvm updates its copy of googletest.
 INSTANTIATE_TEST_CASE_P(ParameterizedCovMapTest, CoverageMappingTest,
                         ::testing::Values(std::pair<bool, bool>({false, false}),
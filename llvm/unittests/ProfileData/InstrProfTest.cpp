@@ -221,6 +221,40 @@ TEST_F(InstrProfTest, test_writer_merge) {
   ASSERT_EQ(0U, R->Counts[1]);
 }
 
+TEST_P(MaybeSparseInstrProfTest, write_spilled_records) {
+  Writer.addRecord({"func1", 0x1234, {42}}, Err);
+  Writer.addRecord({"func1", 0x1235, {1, 2}}, Err);
+  Writer.addRecord({"func2", 0x1234, {0, 0}}, Err);
+  EXPECT_THAT_ERROR(Writer.spillRecords(), Succeeded());
+  Writer.addRecord({"func3", 0x1234, {7}}, Err);
+
+  auto Profile = Writer.writeBuffer();
+  readProfile(std::move(Profile));
+
+  Expected<InstrProfRecord> R = Reader->getInstrProfRecord("func1", 0x1234);
+  EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+  ASSERT_EQ(1U, R->Counts.size());
+  ASSERT_EQ(42U, R->Counts[0]);
+
+  R = Reader->getInstrProfRecord("func1", 0x1235);
+  EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+  ASSERT_EQ(2U, R->Counts.size());
+  ASSERT_EQ(2U, R->Counts[1]);
+
+  R = Reader->getInstrProfRecord("func2", 0x1234);
+  if (GetParam())
+    ASSERT_TRUE(ErrorEquals(instrprof_error::unknown_function, R.takeError()));
+  else
+    EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+
+  R = Reader->getInstrProfRecord("func3", 0x1234);
+  EXPECT_THAT_ERROR(R.takeError(), Succeeded());
+  ASSERT_EQ(7U, R->Counts[0]);
+
+  ProfileSummary &PS = Reader->getSummary(/* IsCS */ false);
+  ASSERT_EQ(42U, PS.getMaxFunctionCount());
+}
+
 static const char callee1[] = "callee1";
 static const char callee2[] = "callee2";
 static const char callee3[] = "callee3";
@@ -0,0 +1,152 @@
+//===- unittest/Remarks/BitstreamRemarksTest.cpp - Bitstream remarks tests ===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm-c/Remarks.h"
+#include "llvm/Remarks/BitstreamRemarkContainer.h"
+#include "llvm/Remarks/Remark.h"
+#include "llvm/Remarks/RemarkParser.h"
+#include "llvm/Remarks/RemarkSerializer.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+static remarks::Remark makeRemark(ArrayRef<remarks::Argument> Args) {
+  remarks::Remark R;
+  R.RemarkType = remarks::Type::Missed;
+  R.PassName = "inline";
+  R.RemarkName = "NoDefinition";
+  R.FunctionName = "foo";
+  R.Loc = remarks::RemarkLocation{"file.c", 3, 12};
+  R.Hotness = 4;
+  R.Args = Args;
+  return R;
+}
+
+static std::string serialize(ArrayRef<remarks::Remark> Remarks) {
+  std::string Buf;
+  raw_string_ostream OS(Buf);
+  {
+    remarks::BitstreamSerializer S(OS);
+    for (const remarks::Remark &R : Remarks)
+      S.emit(R);
+  }
+  return OS.str();
+}
+
+static std::string parseExpectError(StringRef Buf) {
+  remarks::Parser Parser(Buf);
+  Expected<const remarks::Remark *> Remark = Parser.getNext();
+  EXPECT_FALSE(Remark); // Expect an error here.
+
+  std::string ErrorStr;
+  raw_string_ostream Stream(ErrorStr);
+  handleAllErrors(Remark.takeError(),
+                  [&](const ErrorInfoBase &EIB) { EIB.log(Stream); });
+  return Stream.str();
+}
+
+TEST(BitstreamRemarks, RoundTrip) {
+  remarks::Argument Args[3];
+  Args[0].Key = "Callee";
+  Args[0].Val = "bar";
+  Args[1].Key = "String";
+  Args[1].Val = " will not be inlined into ";
+  Args[2].Key = "Caller";
+  Args[2].Val = "foo";
+  Args[2].Loc = remarks::RemarkLocation{"file.c", 2, 0};
+
+  remarks::Remark First = makeRemark(Args);
+  remarks::Remark Second = makeRemark({});
+  Second.RemarkType = remarks::Type::Passed;
+  Second.FunctionName = "baz";
+  Second.Loc = None;
+  Second.Hotness = None;
+
+  std::string Buf = serialize({First, Second});
+  EXPECT_TRUE(remarks::isBitstreamRemarkContainer(Buf));
+
+  // The format is detected from the magic number.
+  remarks::Parser Parser(Buf);
+  Expected<const remarks::Remark *> Remark = Parser.getNext();
+  EXPECT_FALSE(errorToBool(Remark.takeError()));
+  ASSERT_TRUE(*Remark != nullptr);
+  const remarks::Remark &R = **Remark;
+  EXPECT_EQ(R.RemarkType, remarks::Type::Missed);
+  EXPECT_EQ(R.PassName, "inline");
+  EXPECT_EQ(R.RemarkName, "NoDefinition");
+  EXPECT_EQ(R.FunctionName, "foo");
+  ASSERT_TRUE(R.Loc.hasValue());
+  EXPECT_EQ(R.Loc->SourceFilePath, "file.c");
+  EXPECT_EQ(R.Loc->SourceLine, 3U);
+  EXPECT_EQ(R.Loc->SourceColumn, 12U);
+  EXPECT_EQ(R.Hotness, Optional<uint64_t>(4));
+  ASSERT_EQ(R.Args.size(), 3U);
+  EXPECT_EQ(R.Args[0].Key, "Callee");
+  EXPECT_EQ(R.Args[0].Val, "bar");
+  EXPECT_FALSE(R.Args[0].Loc.hasValue());
+  EXPECT_EQ(R.Args[1].Val, " will not be inlined into ");
+  EXPECT_EQ(R.Args[2].Key, "Caller");
+  ASSERT_TRUE(R.Args[2].Loc.hasValue());
+  EXPECT_EQ(R.Args[2].Loc->SourceFilePath, "file.c");
+  EXPECT_EQ(R.Args[2].Loc->SourceLine, 2U);
+  EXPECT_EQ(R.Args[2].Loc->SourceColumn, 0U);
+
+  // Strings defined by the first remark are reused by the second.
+  Remark = Parser.getNext();
+  EXPECT_FALSE(errorToBool(Remark.takeError()));
+  ASSERT_TRUE(*Remark != nullptr);
+  EXPECT_EQ((*Remark)->RemarkType, remarks::Type::Passed);
+  EXPECT_EQ((*Remark)->PassName, "inline");
+  EXPECT_EQ((*Remark)->FunctionName, "baz");
+  EXPECT_FALSE((*Remark)->Loc.hasValue());
+  EXPECT_FALSE((*Remark)->Hotness.hasValue());
+  EXPECT_TRUE((*Remark)->Args.empty());
+
+  Remark = Parser.getNext();
+  EXPECT_FALSE(errorToBool(Remark.takeError()));
+  EXPECT_TRUE(*Remark == nullptr);
+}
+
+TEST(BitstreamRemarks, Empty) {
+  std::string Buf = serialize({});
+  remarks::Parser Parser(Buf);
+  Expected<const remarks::Remark *> Remark = Parser.getNext();
+  EXPECT_FALSE(errorToBool(Remark.takeError()));
+  EXPECT_TRUE(*Remark == nullptr);
+}
+
+TEST(BitstreamRemarks, Malformed) {
+  std::string Buf = serialize({makeRemark({})});
+  // Cut the last remark block short.
+  EXPECT_FALSE(parseExpectError(StringRef(Buf).drop_back(4)).empty());
+  // Corrupt the magic number of the container.
+  EXPECT_TRUE(StringRef(parseExpectError(StringRef("RMRX\0\0\0\0", 8)))
+                  .contains("unknown magic number"));
+}
+
+TEST(BitstreamRemarks, CAPI) {
+  std::string Buf = serialize({makeRemark({})});
+  LLVMRemarkParserRef Parser =
+      LLVMRemarkParserCreateBitstream(Buf.data(), Buf.size());
+  LLVMRemarkEntryRef Remark = LLVMRemarkParserGetNext(Parser);
+  ASSERT_TRUE(Remark != nullptr);
+  EXPECT_EQ(LLVMRemarkEntryGetType(Remark), LLVMRemarkTypeMissed);
+  EXPECT_EQ(LLVMRemarkEntryGetHotness(Remark), 4U);
+  EXPECT_EQ(LLVMRemarkParserGetNext(Parser), nullptr);
+  EXPECT_FALSE(LLVMRemarkParserHasError(Parser));
+  LLVMRemarkParserDispose(Parser);
+
+  // A YAML buffer is not a bitstream container.
+  StringRef YAML = "--- !Missed\nPass: inline\n";
+  Parser = LLVMRemarkParserCreateBitstream(YAML.data(), YAML.size());
+  EXPECT_EQ(LLVMRemarkParserGetNext(Parser), nullptr);
+  EXPECT_TRUE(LLVMRemarkParserHasError(Parser));
+  EXPECT_TRUE(StringRef(LLVMRemarkParserGetErrorMessage(Parser))
+                  .contains("unknown magic number"));
+  LLVMRemarkParserDispose(Parser);
+}
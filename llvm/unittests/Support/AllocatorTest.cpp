@@ -7,8 +7,11 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/Allocator.h"
+#include "llvm/Config/llvm-config.h"
 #include "gtest/gtest.h"
 #include <cstdlib>
+#include <thread>
+#include <vector>
 
 using namespace llvm;
 
@@ -184,4 +187,100 @@ TEST(AllocatorTest, TestBigAlignment) {
   EXPECT_GT(MockSlabAllocator::GetLastSlabSize(), 4096u);
 }
 
+TEST(AllocatorTest, ThreadSafeBasics) {
+  ThreadSafeBumpPtrAllocator Alloc;
+  int *a = (int*)Alloc.Allocate(sizeof(int), alignof(int));
+  int *b = (int*)Alloc.Allocate(sizeof(int) * 10, alignof(int));
+  int *c = (int*)Alloc.Allocate(sizeof(int), alignof(int));
+  *a = 1;
+  b[0] = 2;
+  b[9] = 2;
+  *c = 3;
+  EXPECT_EQ(1, *a);
+  EXPECT_EQ(2, b[0]);
+  EXPECT_EQ(2, b[9]);
+  EXPECT_EQ(3, *c);
+  EXPECT_EQ(1U, Alloc.GetNumSlabs());
+  EXPECT_EQ(sizeof(int) * 12, Alloc.getBytesAllocated());
+
+  // Big allocations get their own slab.
+  Alloc.Allocate(5000, 1);
+  EXPECT_EQ(2U, Alloc.GetNumSlabs());
+
+  Alloc.Reset();
+  EXPECT_EQ(0U, Alloc.GetNumSlabs());
+  EXPECT_EQ(0U, Alloc.getBytesAllocated());
+}
+
+TEST(AllocatorTest, ThreadSafeAlignment) {
+  ThreadSafeBumpPtrAllocator Alloc;
+  uintptr_t a;
+  a = (uintptr_t)Alloc.Allocate(1, 2);
+  EXPECT_EQ(0U, a & 1);
+  a = (uintptr_t)Alloc.Allocate(1, 4);
+  EXPECT_EQ(0U, a & 3);
+  a = (uintptr_t)Alloc.Allocate(1, 8);
+  EXPECT_EQ(0U, a & 7);
+  a = (uintptr_t)Alloc.Allocate(1, 16);
+  EXPECT_EQ(0U, a & 15);
+  a = (uintptr_t)Alloc.Allocate(1, 2048);
+  EXPECT_EQ(0U, a & 2047);
+}
+
+#if LLVM_ENABLE_THREADS
+// Fill each allocation with the index of its thread and check that no thread
+// overwrote memory handed to another one.
+TEST(AllocatorTest, ThreadSafeConcurrentAllocate) {
+  const unsigned NumThreads = 8;
+  const unsigned NumAllocs = 10000;
+  ThreadSafeBumpPtrAllocator Alloc;
+  std::vector<std::vector<unsigned *>> Ptrs(NumThreads);
+  std::vector<std::thread> Threads;
+  for (unsigned T = 0; T < NumThreads; ++T)
+    Threads.emplace_back([&, T] {
+      for (unsigned I = 0; I < NumAllocs; ++I) {
+        // Mix in sizes above the threshold to exercise custom sized slabs.
+        size_t Num = I % 100 == 0 ? 2000 : 1 + I % 7;
+        unsigned *P = Alloc.Allocate<unsigned>(Num);
+        for (size_t J = 0; J < Num; ++J)
+          P[J] = T;
+        Ptrs[T].push_back(P);
+      }
+    });
+  for (std::thread &T : Threads)
+    T.join();
+
+  for (unsigned T = 0; T < NumThreads; ++T)
+    for (unsigned I = 0; I < NumAllocs; ++I) {
+      size_t Num = I % 100 == 0 ? 2000 : 1 + I % 7;
+      for (size_t J = 0; J < Num; ++J)
+        ASSERT_EQ(T, Ptrs[T][I][J]);
+    }
+  EXPECT_LE(Alloc.getBytesAllocated(), Alloc.getTotalMemory());
+}
+#endif
+
+struct CountedDestructor {
+  static std::atomic<unsigned> NumDestroyed;
+  char Payload[24];
+  ~CountedDestructor() { ++NumDestroyed; }
+};
+
+std::atomic<unsigned> CountedDestructor::NumDestroyed;
+
+TEST(AllocatorTest, ThreadSafeSpecificDestroyAll) {
+  CountedDestructor::NumDestroyed = 0;
+  {
+    ThreadSafeSpecificBumpPtrAllocator<CountedDestructor> Alloc;
+    for (unsigned I = 0; I < 1000; ++I)
+      new (Alloc.Allocate()) CountedDestructor();
+    Alloc.DestroyAll();
+    EXPECT_EQ(1000U, CountedDestructor::NumDestroyed);
+
+    for (unsigned I = 0; I < 10; ++I)
+      new (Alloc.Allocate()) CountedDestructor();
+  }
+  EXPECT_EQ(1010U, CountedDestructor::NumDestroyed);
+}
+
 }  // anonymous namespace
@@ -14,6 +14,7 @@
 #include "llvm/Support/Parallel.h"
 #include "gtest/gtest.h"
 #include <array>
+#include <atomic>
 #include <random>
 
 uint32_t array[1024 * 1024];
@@ -49,4 +50,14 @@ TEST(Parallel, parallel_for) {
   ASSERT_EQ(range[2049], 1u);
 }
 
+TEST(Parallel, nested_parallel_for) {
+  // Inner loops run in parallel too; the waiting threads run pending tasks
+  // instead of blocking, so this must neither deadlock nor lose iterations.
+  std::atomic<uint64_t> sum{0};
+  for_each_n(parallel::par, 0, 100, [&](size_t I) {
+    for_each_n(parallel::par, 0, 1000, [&](size_t J) { sum += J; });
+  });
+  ASSERT_EQ(sum, 100u * 999u * 1000u / 2);
+}
+
 #endif
@@ -8,6 +8,7 @@
 
 #include "llvm/Support/Process.h"
 #include "gtest/gtest.h"
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -25,6 +26,16 @@ TEST(ProcessTest, GetRandomNumberTest) {
   EXPECT_NE((r1 | r2), 0u);
 }
 
+#if defined(__linux__) || defined(__APPLE__) || defined(_WIN32)
+TEST(ProcessTest, GetPeakRSS) {
+  size_t Before = Process::GetPeakRSS();
+  EXPECT_GT(Before, 0u);
+  // Touch a few megabytes, the peak can only grow.
+  std::vector<char> Buffer(16 << 20, 1);
+  EXPECT_GE(Process::GetPeakRSS(), Before);
+}
+#endif
+
 #ifdef _MSC_VER
 #define setenv(name, var, ignore) _putenv_s(name, var)
 #endif
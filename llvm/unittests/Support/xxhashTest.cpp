@@ -17,3 +17,62 @@ TEST(xxhashTest, Basic) {
   EXPECT_EQ(0x69196c1b3af0bff9U,
             xxHash64("0123456789abcdefghijklmnopqrstuvwxyz"));
 }
+
+TEST(xxhashTest, xxh3) {
+  EXPECT_EQ(0x2d06800538d394c2U, xxh3_64bits(""));
+  EXPECT_EQ(0xab6e5f64077e7d8aU, xxh3_64bits("foo"));
+  EXPECT_EQ(0xd463c860a032d362U, xxh3_64bits("bar"));
+  EXPECT_EQ(0xffb92a87c6306d55U,
+            xxh3_64bits("0123456789abcdefghijklmnopqrstuvwxyz"));
+
+  XXH128_hash_t H = xxh3_128bits("");
+  EXPECT_EQ(0x99aa06d3014798d8U, H.high64);
+  EXPECT_EQ(0x6001c324468d497fU, H.low64);
+  H = xxh3_128bits("0123456789abcdefghijklmnopqrstuvwxyz");
+  EXPECT_EQ(0xb62238c22b8a25a8U, H.high64);
+  EXPECT_EQ(0x1072b74f1e5bf3deU, H.low64);
+}
+
+// Cover every length class, including inputs long enough for the block loop.
+TEST(xxhashTest, xxh3Lengths) {
+  uint8_t Buf[4096];
+  for (size_t I = 0; I < sizeof(Buf); ++I)
+    Buf[I] = I * 7 + (I >> 8);
+
+  struct {
+    size_t Len;
+    uint64_t Hash64;
+    uint64_t High64;
+    uint64_t Low64;
+  } Tests[] = {
+      {1, 0xc44bdff4074eecdbU, 0xa6cd5e9392000f6aU, 0xc44bdff4074eecdbU},
+      {2, 0x9093381c8763d62eU, 0xb519c2793d896766U, 0x9093381c8763d62eU},
+      {3, 0xc3489259e968ad9eU, 0x656e81c56e41fe02U, 0xc3489259e968ad9eU},
+      {4, 0xd3d60c1519014e89U, 0xab5c3e7474d809dbU, 0x81a65295de8e7ddeU},
+      {5, 0x559935c0f3f7327fU, 0xf72d100531dfb713U, 0x57c3cf21d8799995U},
+      {8, 0xb88dee77f6bf6980U, 0xe4b9dd0b66ff3c50U, 0xebabbd0695002ff6U},
+      {9, 0x03688dcad730d826U, 0x82ddc95bc7600767U, 0x1c69c3f04aaed08cU},
+      {16, 0x9da23836adf2be1eU, 0xddf6c1254d70f767U, 0x94eaa17b20756f46U},
+      {17, 0xf34c3c9cf5a112d1U, 0x263f67af63088041U, 0x735fe434ded90c3cU},
+      {32, 0x99cb9ad0f1a11fbeU, 0xa86b514658f976a5U, 0x407920045a9a834cU},
+      {64, 0x6efb76ff16f37561U, 0xa7fa95f7f23b64a7U, 0xedae5e0312655703U},
+      {96, 0x764d2d5db92942dfU, 0xdbfa0cd6e568ef54U, 0xacb9f0967e182865U},
+      {128, 0x65f3c2c00fa93185U, 0xdd9e5aa9bd51cc9cU, 0xc6bd21ecc865f29fU},
+      {129, 0x28065c6ec25f5b25U, 0x00433635cf8d872eU, 0x7f4accb76587485bU},
+      {200, 0x7c64f3b17285e96aU, 0xdbfff5e13c798ab9U, 0x0497bdb3d145ccd6U},
+      {240, 0x4917a75c0ef8eed7U, 0x89e3a0a2ee355d25U, 0xd10beb4e0599e4b3U},
+      {241, 0x541b19226f0052e8U, 0x75f4da43f23cce5aU, 0x541b19226f0052e8U},
+      {255, 0x99b37c2c806e33d3U, 0x57619d72d7b77094U, 0x99b37c2c806e33d3U},
+      {300, 0x57a869a051835980U, 0xff95b6d40f8224b8U, 0x57a869a051835980U},
+      {1024, 0x71bee625238addb4U, 0xa3da96fbd6887361U, 0x71bee625238addb4U},
+      {1025, 0xd9b414f4e1bbf7adU, 0xa53cd4fd16206676U, 0xd9b414f4e1bbf7adU},
+      {4096, 0x5c722d9ceb6f9064U, 0x08ef8fc6d37a7191U, 0x5c722d9ceb6f9064U},
+  };
+  for (const auto &T : Tests) {
+    ArrayRef<uint8_t> Data(Buf, T.Len);
+    EXPECT_EQ(T.Hash64, xxh3_64bits(Data)) << "length " << T.Len;
+    XXH128_hash_t H = xxh3_128bits(Data);
+    EXPECT_EQ(T.High64, H.high64) << "length " << T.Len;
+    EXPECT_EQ(T.Low64, H.low64) << "length " << T.Len;
+  }
+}
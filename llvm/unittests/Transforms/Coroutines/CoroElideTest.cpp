@@ -0,0 +1,117 @@
+//===- CoroElideTest.cpp - CoroElide unit tests ---------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Coroutines.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// @caller hands the handle of @f to @destroyer, which destroys it before
+// returning.
+const char *DestroyedByCalleeIR = R"IR(
+%f.frame = type { void (%f.frame*)*, void (%f.frame*)*, i32 }
+
+@f.resumers = private constant [3 x void (%f.frame*)*] [void (%f.frame*)* @f.resume, void (%f.frame*)* @f.destroy, void (%f.frame*)* @f.cleanup]
+
+declare i8* @f()
+
+define internal fastcc void @f.resume(%f.frame* %frame) {
+  ret void
+}
+
+define internal fastcc void @f.destroy(%f.frame* %frame) {
+  ret void
+}
+
+define internal fastcc void @f.cleanup(%f.frame* %frame) {
+  ret void
+}
+
+define LINKAGE void @destroyer(i8* nocapture %hdl) {
+  %addr = call i8* @llvm.coro.subfn.addr(i8* %hdl, i8 1)
+  %fn = bitcast i8* %addr to void (i8*)*
+  call fastcc void %fn(i8* %hdl)
+  ret void
+}
+
+define void @caller() {
+entry:
+  %id = call token @llvm.coro.id(i32 0, i8* null, i8* bitcast (i8* ()* @f to i8*), i8* bitcast ([3 x void (%f.frame*)*]* @f.resumers to i8*))
+  %need.alloc = call i1 @llvm.coro.alloc(token %id)
+  br i1 %need.alloc, label %dyn.alloc, label %begin
+
+dyn.alloc:
+  %alloc = call i8* @malloc(i64 24)
+  br label %begin
+
+begin:
+  %mem = phi i8* [ null, %entry ], [ %alloc, %dyn.alloc ]
+  %hdl = call i8* @llvm.coro.begin(token %id, i8* %mem)
+  call void @destroyer(i8* nocapture %hdl)
+  ret void
+}
+
+declare i8* @malloc(i64)
+declare token @llvm.coro.id(i32, i8*, i8*, i8*)
+declare i1 @llvm.coro.alloc(token)
+declare i8* @llvm.coro.begin(token, i8*)
+declare i8* @llvm.coro.subfn.addr(i8*, i8)
+)IR";
+
+/// Run CoroElide on the module of \p IR, with @destroyer given \p Linkage, and
+/// return whether the frame of @f ended up on the stack of @caller.
+bool elidesFrame(StringRef Linkage) {
+  std::string IR = DestroyedByCalleeIR;
+  IR.replace(IR.find("LINKAGE"), strlen("LINKAGE"), Linkage.str());
+
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(IR, Err, Ctx);
+  EXPECT_TRUE(M);
+  if (!M)
+    return false;
+
+  legacy::PassManager PM;
+  PM.add(createCoroElidePass());
+  PM.run(*M);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  bool HasCoroBegin = false, HasFrameAlloca = false;
+  for (Instruction &I : instructions(*M->getFunction("caller"))) {
+    if (auto *II = dyn_cast<IntrinsicInst>(&I))
+      HasCoroBegin |= II->getIntrinsicID() == Intrinsic::coro_begin;
+    if (auto *AI = dyn_cast<AllocaInst>(&I))
+      HasFrameAlloca |= AI->getAllocatedType() == M->getTypeByName("f.frame");
+  }
+  EXPECT_NE(HasCoroBegin, HasFrameAlloca);
+  return HasFrameAlloca;
+}
+
+TEST(CoroElideTest, ElidesFrameDestroyedByCallee) {
+  EXPECT_TRUE(elidesFrame(""));
+  EXPECT_TRUE(elidesFrame("internal"));
+}
+
+// The definition of @destroyer may be replaced at link time by one that does
+// not destroy the handle, so its body cannot be relied on.
+TEST(CoroElideTest, KeepsFrameOfInexactCallee) {
+  EXPECT_FALSE(elidesFrame("linkonce_odr"));
+  EXPECT_FALSE(elidesFrame("weak"));
+}
+
+} // end anonymous namespace
@@ -0,0 +1,103 @@
+//===- LoopLoadEliminationTest.cpp - LoopLoadElimination unit tests -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Scalar/LoopLoadElimination.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+// The store to D may alias the forwarded store to A, so forwarding needs the
+// loop to be versioned behind a memory check.
+const char *VersionedIR = R"IR(
+define void @f(i32* %A, i32* %B, i64 %N, i32* %D) {
+entry:
+  br label %for.body
+
+for.body:
+  %iv = phi i64 [ 0, %entry ], [ %iv.next, %for.body ]
+  %iv.next = add nuw nsw i64 %iv, 1
+  %Aidx_next = getelementptr inbounds i32, i32* %A, i64 %iv.next
+  %Bidx = getelementptr inbounds i32, i32* %B, i64 %iv
+  %Aidx = getelementptr inbounds i32, i32* %A, i64 %iv
+  %Didx = getelementptr inbounds i32, i32* %D, i64 %iv
+  %b = load i32, i32* %Bidx, align 4
+  %a_p1 = add i32 %b, 2
+  store i32 %a_p1, i32* %Didx, align 4
+  %a = load i32, i32* %Aidx, align 4
+  %c = mul i32 %a, 2
+  store i32 %c, i32* %Aidx_next, align 4
+  %exitcond = icmp eq i64 %iv.next, %N
+  br i1 %exitcond, label %for.end, label %for.body
+
+for.end:
+  ret void
+}
+)IR";
+
+// The preserved dominator tree and loop info must be those a fresh
+// computation gives, which is what -verify-dom-info and -verify-loop-info
+// check after each pass.
+TEST(LoopLoadEliminationTest, PreservesDomTreeAndLoopInfo) {
+  LLVMContext Ctx;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseAssemblyString(VersionedIR, Err, Ctx);
+  ASSERT_TRUE(M);
+  Function &F = *M->getFunction("f");
+
+  PassBuilder PB;
+  LoopAnalysisManager LAM;
+  FunctionAnalysisManager FAM;
+  CGSCCAnalysisManager CGAM;
+  ModuleAnalysisManager MAM;
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  PreservedAnalyses PA = LoopLoadEliminationPass().run(F, FAM);
+  FAM.invalidate(F, PA);
+  EXPECT_FALSE(verifyModule(*M, &errs()));
+
+  // The loop was versioned, so there is something to keep up to date.
+  bool Versioned = false;
+  for (BasicBlock &BB : F)
+    Versioned |= BB.getName() == "for.body.lver.orig";
+  ASSERT_TRUE(Versioned);
+
+  DominatorTree *DT = FAM.getCachedResult<DominatorTreeAnalysis>(F);
+  LoopInfo *LI = FAM.getCachedResult<LoopAnalysis>(F);
+  ASSERT_TRUE(DT);
+  ASSERT_TRUE(LI);
+  EXPECT_TRUE(DT->verify(DominatorTree::VerificationLevel::Full));
+
+  DominatorTree FreshDT(F);
+  LoopInfo FreshLI(FreshDT);
+  ASSERT_EQ(FreshLI.getLoopsInPreorder().size(),
+            LI->getLoopsInPreorder().size());
+  for (BasicBlock &BB : F) {
+    Loop *L = LI->getLoopFor(&BB), *FreshL = FreshLI.getLoopFor(&BB);
+    ASSERT_EQ(!L, !FreshL) << BB.getName();
+    if (L) {
+      EXPECT_EQ(FreshL->getHeader(), L->getHeader()) << BB.getName();
+      EXPECT_EQ(FreshL->getLoopDepth(), L->getLoopDepth()) << BB.getName();
+    }
+  }
+}
+
+} // end anonymous namespace
@@ -0,0 +1,43 @@
+//===- CallGraphSortTest.cpp - Tests for computeCallGraphSortOrder --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/CallGraphSort.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+namespace {
+
+TEST(CallGraphSortTest, NoEdges) {
+  std::vector<unsigned> Order = computeCallGraphSortOrder({10, 20, 30}, {});
+  EXPECT_EQ(std::vector<unsigned>({0, 1, 2}), Order);
+}
+
+TEST(CallGraphSortTest, EmptyNodesAreDropped) {
+  std::vector<unsigned> Order = computeCallGraphSortOrder({0, 10}, {});
+  EXPECT_EQ(std::vector<unsigned>({1}), Order);
+}
+
+TEST(CallGraphSortTest, CalleeFollowsHotCaller) {
+  // Node 2 is the hottest and calls node 0, node 1 is on its own.
+  std::vector<CallGraphSortEdge> Edges = {
+      {2, 0, 100}, {2, 2, 1000}, {1, 1, 50}};
+  std::vector<unsigned> Order = computeCallGraphSortOrder({10, 10, 10}, Edges);
+  EXPECT_EQ(std::vector<unsigned>({2, 0, 1}), Order);
+}
+
+TEST(CallGraphSortTest, UnlikelyEdgeIsNotMerged) {
+  // Most calls to node 1 come from elsewhere, so it isn't pulled next to
+  // node 0 and stays behind the denser node 2.
+  std::vector<CallGraphSortEdge> Edges = {
+      {0, 1, 1}, {1, 1, 100}, {0, 0, 1000}, {2, 2, 500}};
+  std::vector<unsigned> Order = computeCallGraphSortOrder({10, 10, 10}, Edges);
+  EXPECT_EQ(std::vector<unsigned>({0, 2, 1}), Order);
+}
+
+} // end anonymous namespace
@@ -0,0 +1,140 @@
+//===- SplitModuleTest.cpp - Unit tests for SplitModule -------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Transforms/Utils/SplitModule.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "gtest/gtest.h"
+
+using namespace llvm;
+
+static std::unique_ptr<Module> parseIR(LLVMContext &C, const char *IR) {
+  SMDiagnostic Err;
+  std::unique_ptr<Module> Mod = parseAssemblyString(IR, Err, C);
+  if (!Mod)
+    Err.print("SplitModuleTests", errs());
+  return Mod;
+}
+
+static const char *SplitIR = "@g = global i32 0\n"
+                             "@h = internal global i32* @g\n"
+                             "@a = alias void (), void ()* @f1\n"
+                             "define void @f1() {\n"
+                             "  ret void\n"
+                             "}\n"
+                             "define internal void @f2() {\n"
+                             "  call void @f1()\n"
+                             "  ret void\n"
+                             "}\n"
+                             "define void @f3() {\n"
+                             "  call void @f2()\n"
+                             "  ret void\n"
+                             "}\n"
+                             "define void @f4() {\n"
+                             "  ret void\n"
+                             "}\n"
+                             "define i8* @f5() {\n"
+                             "  ret i8* blockaddress(@f6, %bb)\n"
+                             "}\n"
+                             "define void @f6() {\n"
+                             "  br label %bb\n"
+                             "bb:\n"
+                             "  ret void\n"
+                             "}\n"
+                             "declare void @ext()\n";
+
+// The partitions computed up front match the definitions that SplitModule
+// puts into each partition.
+TEST(SplitModuleTest, PartitionsMatchSplitModule) {
+  const unsigned N = 3;
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, SplitIR);
+  ASSERT_TRUE(M);
+
+  StringMap<unsigned> PartitionOf;
+  computeSplitModulePartitions(*M, N, [&](const GlobalValue &GV, unsigned I) {
+    EXPECT_FALSE(GV.isDeclaration());
+    EXPECT_LT(I, N);
+    EXPECT_TRUE(PartitionOf.insert({GV.getName(), I}).second);
+  });
+  // Every definition is assigned, declarations are not.
+  EXPECT_EQ(9u, PartitionOf.size());
+  EXPECT_EQ(0u, PartitionOf.count("ext"));
+  // Locals were made external so that other partitions can refer to them.
+  EXPECT_FALSE(M->getFunction("f2")->hasLocalLinkage());
+  // A blockaddress keeps its user in the partition of the function.
+  EXPECT_EQ(PartitionOf["f5"], PartitionOf["f6"]);
+
+  unsigned Part = 0;
+  SplitModule(parseIR(C, SplitIR), N, [&](std::unique_ptr<Module> MPart) {
+    for (const GlobalValue &GV : MPart->global_values())
+      if (!GV.isDeclaration())
+        EXPECT_EQ(Part, PartitionOf.lookup(GV.getName())) << GV.getName();
+    ++Part;
+  });
+  EXPECT_EQ(N, Part);
+}
+
+TEST(SplitModuleTest, PreserveLocals) {
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, SplitIR);
+  ASSERT_TRUE(M);
+
+  StringMap<unsigned> PartitionOf;
+  computeSplitModulePartitions(
+      *M, 2,
+      [&](const GlobalValue &GV, unsigned I) { PartitionOf[GV.getName()] = I; },
+      /*PreserveLocals=*/true);
+  EXPECT_TRUE(M->getFunction("f2")->hasLocalLinkage());
+  // A local stays in the partition of its users.
+  EXPECT_EQ(PartitionOf["f2"], PartitionOf["f3"]);
+}
+
+// Loading the whole module lazily once per partition gives every definition
+// to exactly one partition, like SplitModule.
+TEST(SplitModuleTest, MaterializePartitions) {
+  const unsigned N = 3;
+  LLVMContext C;
+  std::unique_ptr<Module> M = parseIR(C, SplitIR);
+  ASSERT_TRUE(M);
+
+  StringMap<unsigned> PartitionOf;
+  computeSplitModulePartitions(*M, N, [&](const GlobalValue &GV, unsigned I) {
+    PartitionOf[GV.getName()] = I;
+  });
+  SmallString<0> BC;
+  raw_svector_ostream BCOS(BC);
+  WriteBitcodeToFile(*M, BCOS);
+
+  StringMap<unsigned> Defined;
+  for (unsigned I = 0; I != N; ++I) {
+    LLVMContext PartC;
+    Expected<std::unique_ptr<Module>> MPart = getLazyBitcodeModule(
+        MemoryBufferRef(StringRef(BC.data(), BC.size()), "<split-module>"),
+        PartC, /*ShouldLazyLoadMetadata=*/true);
+    ASSERT_TRUE(!!MPart);
+    ASSERT_FALSE(
+        errorToBool(materializeSplitModulePartition(**MPart, PartitionOf, I)));
+    for (const GlobalValue &GV : (*MPart)->global_values())
+      if (!GV.isDeclaration()) {
+        EXPECT_EQ(I, PartitionOf.lookup(GV.getName())) << GV.getName();
+        ++Defined[GV.getName()];
+      }
+    // Other partitions still see the symbols they use.
+    EXPECT_TRUE((*MPart)->getNamedValue("f1"));
+  }
+  EXPECT_EQ(PartitionOf.size(), Defined.size());
+  for (auto &D : Defined)
+    EXPECT_EQ(1u, D.second) << D.first();
+}
@@ -132,13 +132,20 @@ namespace {
   Class("class", cl::desc("Print Enum list for this class"),
         cl::value_desc("class name"), cl::cat(PrintEnumsCat));
 
+  cl::list<std::string>
+  Emit("emit",
+       cl::desc("Run an action and write its output to a file. May be "
+                "repeated to run several actions on a single parse of the "
+                "input"),
+       cl::value_desc("action=filename"));
+
 cl::opt<bool, true>
     TimeRegionsOpt("time-regions",
                    cl::desc("Time regions of tablegens execution"),
                    cl::location(TimeRegions));
 
-bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
-  switch (Action) {
+bool runAction(ActionType Act, raw_ostream &OS, RecordKeeper &Records) {
+  switch (Act) {
   case PrintRecords:
     OS << Records;           // No argument, dump all contents
     break;
@@ -251,6 +258,10 @@ bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
 
   return false;
 }
+
+bool LLVMTableGenMain(raw_ostream &OS, RecordKeeper &Records) {
+  return runAction(Action, OS, Records);
+}
 }
 
 int main(int argc, char **argv) {
@@ -260,7 +271,26 @@ int main(int argc, char **argv) {
 
   llvm_shutdown_obj Y;
 
-  return TableGenMain(argv[0], &LLVMTableGenMain);
+  if (Emit.empty())
+    return TableGenMain(argv[0], &LLVMTableGenMain);
+
+  std::vector<TableGenJob> Jobs;
+  for (StringRef Arg : Emit) {
+    StringRef ActionName, Filename;
+    std::tie(ActionName, Filename) = Arg.split('=');
+    if (Filename.empty()) {
+      errs() << argv[0] << ": -emit expects <action>=<filename>, got '" << Arg
+             << "'\n";
+      return 1;
+    }
+    ActionType Act;
+    if (Action.getParser().parse(Action, ActionName, ActionName, Act))
+      return 1;
+    Jobs.push_back({Filename, [Act](raw_ostream &OS, RecordKeeper &Records) {
+                      return runAction(Act, OS, Records);
+                    }});
+  }
+  return TableGenMain(argv[0], Jobs);
 }
 
 #ifdef __has_feature
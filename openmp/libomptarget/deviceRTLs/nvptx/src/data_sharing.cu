@@ -363,6 +363,55 @@ EXTERN void __kmpc_data_sharing_init_stack_spmd() {
   __threadfence_block();
 }
 
+// The bits of a data sharing pool state word that hold the arena offset.
+#define DS_POOL_OFFSET_BITS 40
+#define DS_POOL_OFFSET_MASK ((1ULL << DS_POOL_OFFSET_BITS) - 1)
+
+// Carve Size bytes out of the pool arena of this SM. Return null if there is
+// no pool or the arena is exhausted.
+INLINE static void *data_sharing_pool_alloc(size_t Size) {
+  omptarget_nvptx_DataSharingPoolTy &Pool = omptarget_nvptx_dataSharingPool;
+  if (!Pool.Base)
+    return 0;
+
+  // Keep the slots of the arena 8-byte aligned.
+  Size = (Size + 7) & ~(size_t)7;
+  unsigned Arena = GetSMId() % Pool.NumArenas;
+  unsigned long long *State = &Pool.State[Arena];
+  unsigned long long Old = *State, Assumed;
+  do {
+    Assumed = Old;
+    if ((Assumed & DS_POOL_OFFSET_MASK) + Size > Pool.ArenaSize)
+      return 0;
+    // Bump the offset and count the new live slot.
+    Old = atomicCAS(State, Assumed,
+                    Assumed + (1ULL << DS_POOL_OFFSET_BITS) + Size);
+  } while (Old != Assumed);
+
+  return Pool.Base + Arena * Pool.ArenaSize + (Assumed & DS_POOL_OFFSET_MASK);
+}
+
+// Release a slot carved out by data_sharing_pool_alloc. Return false if Ptr
+// does not belong to the pool.
+INLINE static bool data_sharing_pool_free(void *Ptr) {
+  omptarget_nvptx_DataSharingPoolTy &Pool = omptarget_nvptx_dataSharingPool;
+  uintptr_t Offset = (uintptr_t)Ptr - (uintptr_t)Pool.Base;
+  if (!Pool.Base || Offset >= Pool.NumArenas * Pool.ArenaSize)
+    return false;
+
+  unsigned long long *State = &Pool.State[Offset / Pool.ArenaSize];
+  unsigned long long Old = *State, Assumed;
+  do {
+    Assumed = Old;
+    unsigned long long New = Assumed - (1ULL << DS_POOL_OFFSET_BITS);
+    // Rewind the arena once the last live slot is gone.
+    if (!(New >> DS_POOL_OFFSET_BITS))
+      New = 0;
+    Old = atomicCAS(State, Assumed, New);
+  } while (Old != Assumed);
+  return true;
+}
+
 INLINE static void* data_sharing_push_stack_common(size_t PushSize) {
   ASSERT0(LT_FUSSY, isRuntimeInitialized(), "Expected initialized runtime.");
 
@@ -404,9 +453,12 @@ INLINE static void* data_sharing_push_stack_common(size_t PushSize) {
       size_t DefaultSlotSize = DS_Worker_Warp_Slot_Size;
       if (DefaultSlotSize > NewSize)
         NewSize = DefaultSlotSize;
-      NewSlot = (__kmpc_data_sharing_slot *) SafeMalloc(
-          sizeof(__kmpc_data_sharing_slot) + NewSize,
-          "Global memory slot allocation.");
+      NewSlot = (__kmpc_data_sharing_slot *)data_sharing_pool_alloc(
+          sizeof(__kmpc_data_sharing_slot) + NewSize);
+      if (!NewSlot)
+        NewSlot = (__kmpc_data_sharing_slot *) SafeMalloc(
+            sizeof(__kmpc_data_sharing_slot) + NewSize,
+            "Global memory slot allocation.");
 
       NewSlot->Next = 0;
       NewSlot->Prev = SlotP;
@@ -500,7 +552,8 @@ EXTERN void __kmpc_data_sharing_pop_stack(void *FrameStart) {
 
       // Remove the slot.
       SlotP = SlotP->Prev;
-      SafeFree(SlotP->Next, "Free slot.");
+      if (!data_sharing_pool_free(SlotP->Next))
+        SafeFree(SlotP->Next, "Free slot.");
       SlotP->Next = 0;
     }
   }
@@ -435,6 +435,93 @@ EXTERN int32_t __kmpc_nvptx_teams_reduce_nowait_simple(kmp_Ident *loc,
 EXTERN void __kmpc_nvptx_teams_end_reduce_nowait_simple(kmp_Ident *loc,
                                                         int32_t global_tid,
                                                         kmp_CriticalName *crit);
+// Reductions of a single scalar with a builtin operator. The parallel ones
+// reduce *value in place and return 1 in the thread holding the result, the
+// teams ones also combine it into *orig atomically.
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_add_i32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int32_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_min_i32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int32_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_max_i32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int32_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_add_i64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int64_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_min_i64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int64_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_max_i64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           int64_t *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_add_f32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           float *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_min_f32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           float *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_max_f32(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           float *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_add_f64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           double *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_min_f64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           double *value);
+EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_max_f64(kmp_Ident *loc,
+                                                           int32_t global_tid,
+                                                           double *value);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_add_i32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int32_t *value,
+                                                     int32_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_min_i32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int32_t *value,
+                                                     int32_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_max_i32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int32_t *value,
+                                                     int32_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_add_i64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int64_t *value,
+                                                     int64_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_min_i64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int64_t *value,
+                                                     int64_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_max_i64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     int64_t *value,
+                                                     int64_t *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_add_f32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     float *value,
+                                                     float *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_min_f32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     float *value,
+                                                     float *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_max_f32(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     float *value,
+                                                     float *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_add_f64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     double *value,
+                                                     double *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_min_f64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     double *value,
+                                                     double *orig);
+EXTERN void __kmpc_nvptx_teams_reduce_nowait_max_f64(kmp_Ident *loc,
+                                                     int32_t global_tid,
+                                                     double *value,
+                                                     double *orig);
 EXTERN int32_t __kmpc_shuffle_int32(int32_t val, int16_t delta, int16_t size);
 EXTERN int64_t __kmpc_shuffle_int64(int64_t val, int16_t delta, int16_t size);
 
@@ -92,6 +92,8 @@ public:
   ////////////////////////////////////////////////////////////////////////////////
   // Support for Static Init
 
+  // Clang computes the static schedules of the loops of SPMD kernels inline,
+  // in CGOpenMPRuntimeNVPTX::emitForStaticInit, keep both in sync.
   INLINE static void for_static_init(int32_t gtid, int32_t schedtype,
                                      int32_t *plastiter, T *plower, T *pupper,
                                      ST *pstride, ST chunk,
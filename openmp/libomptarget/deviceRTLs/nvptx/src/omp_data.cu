@@ -17,6 +17,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 __device__ omptarget_device_environmentTy omptarget_device_environment;
+__device__ omptarget_nvptx_DataSharingPoolTy omptarget_nvptx_dataSharingPool;
 
 ////////////////////////////////////////////////////////////////////////////////
 // global data holding OpenMP state information
@@ -24,12 +24,6 @@ extern __device__
 // init entry points
 ////////////////////////////////////////////////////////////////////////////////
 
-INLINE static unsigned smid() {
-  unsigned id;
-  asm("mov.u32 %0, %%smid;" : "=r"(id));
-  return id;
-}
-
 EXTERN void __kmpc_kernel_init_params(void *Ptr) {
   PRINT(LD_IO, "call to __kmpc_kernel_init_params with version %f\n",
         OMPTARGET_NVPTX_VERSION);
@@ -52,7 +46,7 @@ EXTERN void __kmpc_kernel_init(int ThreadLimit, int16_t RequiresOMPRuntime) {
   PRINT0(LD_IO, "call to __kmpc_kernel_init for master\n");
 
   // Get a state object from the queue.
-  int slot = smid() % MAX_SM;
+  int slot = GetSMId() % MAX_SM;
   usedSlotIdx = slot;
   omptarget_nvptx_threadPrivateContext =
       omptarget_nvptx_device_State[slot].Dequeue();
@@ -97,7 +91,7 @@ EXTERN void __kmpc_spmd_kernel_init(int ThreadLimit, int16_t RequiresOMPRuntime,
                                                   : RuntimeUninitialized);
   int threadId = GetThreadIdInBlock();
   if (threadId == 0) {
-    usedSlotIdx = smid() % MAX_SM;
+    usedSlotIdx = GetSMId() % MAX_SM;
     parallelLevel[0] =
         1 + (GetNumberOfThreadsInBlock() > 1 ? OMP_ACTIVE_PARALLEL_LEVEL : 0);
   } else if (GetLaneId() == 0) {
@@ -105,8 +99,11 @@ EXTERN void __kmpc_spmd_kernel_init(int ThreadLimit, int16_t RequiresOMPRuntime,
         1 + (GetNumberOfThreadsInBlock() > 1 ? OMP_ACTIVE_PARALLEL_LEVEL : 0);
   }
   if (!RequiresOMPRuntime) {
-    // Runtime is not required - exit.
-    __SYNCTHREADS();
+    // Runtime is not required - exit. Simple SPMD kernels take no state from
+    // the queue and set up no data sharing stack. The parallel level is only
+    // read within the warp and usedSlotIdx only by thread 0, so a warp
+    // barrier is enough.
+    __SYNCWARP(__ACTIVEMASK());
     return;
   }
 
@@ -184,3 +181,18 @@ EXTERN int8_t __kmpc_is_spmd_exec_mode() {
   PRINT0(LD_IO | LD_PAR, "call to __kmpc_is_spmd_exec_mode\n");
   return isSPMDMode();
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// host launched helpers
+////////////////////////////////////////////////////////////////////////////////
+
+// Launched by the CUDA plugin for __tgt_rtl_patch_ptrs. Updates holds N pairs
+// of (target address, pointer value) packed by the host.
+extern "C" __global__ void __omptarget_nvptx_patch_ptrs(void **Updates,
+                                                        int64_t N) {
+  int64_t Stride = (int64_t)blockDim.x * gridDim.x;
+  for (int64_t I = (int64_t)blockIdx.x * blockDim.x + threadIdx.x; I < N;
+       I += Stride) {
+    *(void **)Updates[2 * I] = Updates[2 * I + 1];
+  }
+}
@@ -53,11 +53,14 @@
 #define __SHFL_DOWN_SYNC(mask, var, delta, width)                              \
   __shfl_down_sync((mask), (var), (delta), (width))
 #define __ACTIVEMASK() __activemask()
+#define __SYNCWARP(mask) __syncwarp((mask))
 #else
 #define __SHFL_SYNC(mask, var, srcLane) __shfl((var), (srcLane))
 #define __SHFL_DOWN_SYNC(mask, var, delta, width)                              \
   __shfl_down((var), (delta), (width))
 #define __ACTIVEMASK() __ballot(1)
+// Warps execute in lockstep before Cuda 9.0.
+#define __SYNCWARP(mask)
 #endif
 
 #define __SYNCTHREADS_N(n) asm volatile("bar.sync %0;" : : "r"(n) : "memory");
@@ -371,6 +374,19 @@ struct omptarget_device_environmentTy {
   int32_t debug_level;
 };
 
+/// Global memory preallocated by the plugin for data sharing slots, so that
+/// overflowing warp stacks do not go through device malloc. There is one arena
+/// of ArenaSize bytes per SM, and State[i] holds the bump offset of arena i in
+/// its lower bits and the number of live slots above. The arena
+/// is rewound when its last slot is released. Base is null without a pool.
+/// Manually sync with the plugin side.
+struct omptarget_nvptx_DataSharingPoolTy {
+  char *Base;
+  unsigned long long *State;
+  uint64_t ArenaSize;
+  uint32_t NumArenas;
+};
+
 /// Memory manager for statically allocated memory.
 class omptarget_nvptx_SimpleMemoryManager {
 private:
@@ -392,6 +408,8 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 
 extern __device__ omptarget_device_environmentTy omptarget_device_environment;
+extern __device__ omptarget_nvptx_DataSharingPoolTy
+    omptarget_nvptx_dataSharingPool;
 
 ////////////////////////////////////////////////////////////////////////////////
 
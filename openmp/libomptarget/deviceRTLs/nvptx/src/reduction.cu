@@ -13,6 +13,7 @@
 
 #include <complex.h>
 #include <stdio.h>
+#include <type_traits>
 
 #include "omptarget-nvptx.h"
 
@@ -264,6 +265,180 @@ int32_t __kmpc_nvptx_parallel_reduce_nowait_simple_generic(
       /*isSPMDExecutionMode=*/false, /*isRuntimeUninitialized=*/true);
 }
 
+// Combiners of the typed reductions, in the form clang emits them for the
+// builtin reduction operators.
+template <typename T> struct omptarget_nvptx_ReduceAdd {
+  INLINE static T apply(T LHS, T RHS) { return LHS + RHS; }
+};
+template <typename T> struct omptarget_nvptx_ReduceMin {
+  INLINE static T apply(T LHS, T RHS) { return LHS < RHS ? LHS : RHS; }
+};
+template <typename T> struct omptarget_nvptx_ReduceMax {
+  INLINE static T apply(T LHS, T RHS) { return LHS > RHS ? LHS : RHS; }
+};
+
+template <typename T>
+INLINE static T typed_shuffle_down(uint32_t Mask, T Val, int16_t Delta) {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported type");
+  union {
+    T Val;
+    int32_t I32[2];
+  } U;
+  U.Val = Val;
+  U.I32[0] = __SHFL_DOWN_SYNC(Mask, U.I32[0], Delta, WARPSIZE);
+  if (sizeof(T) == 8)
+    U.I32[1] = __SHFL_DOWN_SYNC(Mask, U.I32[1], Delta, WARPSIZE);
+  return U.Val;
+}
+
+// Reduce Val over the first Size lanes of the warp, the result is on lane 0.
+template <typename T, typename Op>
+INLINE static T typed_warp_reduce(T Val, uint32_t Size) {
+  uint32_t Mask = Size == WARPSIZE ? 0xffffffff : (1u << Size) - 1;
+  uint32_t LaneId = GetLaneId();
+  for (uint32_t Offset = WARPSIZE / 2; Offset > 0; Offset /= 2) {
+    T Remote = typed_shuffle_down(Mask, Val, Offset);
+    if (LaneId + Offset < Size)
+      Val = Op::apply(Val, Remote);
+  }
+  return Val;
+}
+
+// Same steps as nvptx_parallel_reduce_nowait, with the shuffles and the
+// inter-warp copy done on T directly instead of through the callbacks clang
+// emits. The partial values of a parallel region are contiguous in the
+// logical thread ids.
+template <typename T, typename Op>
+INLINE static int32_t nvptx_parallel_reduce_typed(kmp_Ident *loc,
+                                                  int32_t global_tid,
+                                                  T *value) {
+  bool isSPMDExecutionMode = checkSPMDMode(loc);
+  uint32_t BlockThreadId = GetLogicalThreadIdInBlock(isSPMDExecutionMode);
+  uint32_t NumThreads = GetNumberOfOmpThreads(isSPMDExecutionMode);
+  if (NumThreads == 1)
+    return 1;
+
+  uint32_t WarpsNeeded = (NumThreads + WARPSIZE - 1) / WARPSIZE;
+  uint32_t WarpId = BlockThreadId / WARPSIZE;
+  uint32_t WarpSize = WarpId < WarpsNeeded - 1 || NumThreads % WARPSIZE == 0
+                          ? WARPSIZE
+                          : NumThreads % WARPSIZE;
+  T Val = typed_warp_reduce<T, Op>(*value, WarpSize);
+
+  if (NumThreads > WARPSIZE) {
+    // Warp masters hand their values to the first warp.
+    __shared__ volatile T Medium[WARPSIZE];
+    __kmpc_barrier(loc, global_tid);
+    if (GetLaneId() == 0)
+      Medium[WarpId] = Val;
+    __kmpc_barrier(loc, global_tid);
+    if (WarpId == 0 && BlockThreadId < WarpsNeeded)
+      Val = typed_warp_reduce<T, Op>(Medium[BlockThreadId], WarpsNeeded);
+  }
+  if (BlockThreadId == 0)
+    *value = Val;
+  return BlockThreadId == 0;
+}
+
+// Atomically combine Val into *Addr, which other teams update as well.
+template <typename T, typename Op>
+INLINE static void typed_atomic_combine(T *Addr, T Val) {
+  static_assert(sizeof(T) == 4 || sizeof(T) == 8, "unsupported type");
+  typedef typename std::conditional<sizeof(T) == 4, unsigned int,
+                                    unsigned long long>::type BitsTy;
+  union {
+    T Val;
+    BitsTy Bits;
+  } Old, New;
+  BitsTy *BitsAddr = reinterpret_cast<BitsTy *>(Addr);
+  Old.Bits = *(volatile BitsTy *)BitsAddr;
+  do {
+    New.Val = Op::apply(Old.Val, Val);
+    if (New.Bits == Old.Bits)
+      return;
+    BitsTy Seen = atomicCAS(BitsAddr, Old.Bits, New.Bits);
+    if (Seen == Old.Bits)
+      return;
+    Old.Bits = Seen;
+  } while (true);
+}
+
+template <>
+INLINE void typed_atomic_combine<int32_t, omptarget_nvptx_ReduceAdd<int32_t>>(
+    int32_t *Addr, int32_t Val) {
+  atomicAdd(Addr, Val);
+}
+template <>
+INLINE void typed_atomic_combine<int32_t, omptarget_nvptx_ReduceMin<int32_t>>(
+    int32_t *Addr, int32_t Val) {
+  atomicMin(Addr, Val);
+}
+template <>
+INLINE void typed_atomic_combine<int32_t, omptarget_nvptx_ReduceMax<int32_t>>(
+    int32_t *Addr, int32_t Val) {
+  atomicMax(Addr, Val);
+}
+template <>
+INLINE void typed_atomic_combine<int64_t, omptarget_nvptx_ReduceAdd<int64_t>>(
+    int64_t *Addr, int64_t Val) {
+  atomicAdd((unsigned long long *)Addr, (unsigned long long)Val);
+}
+template <>
+INLINE void typed_atomic_combine<float, omptarget_nvptx_ReduceAdd<float>>(
+    float *Addr, float Val) {
+  atomicAdd(Addr, Val);
+}
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 600
+template <>
+INLINE void typed_atomic_combine<double, omptarget_nvptx_ReduceAdd<double>>(
+    double *Addr, double Val) {
+  atomicAdd(Addr, Val);
+}
+#endif
+
+// Teams reduction without the global buffer round trip: the team master
+// combines the team's value into the original variable with an atomic. The
+// original variable holds the result once all teams finished, so nothing is
+// left for the caller to combine.
+template <typename T, typename Op>
+INLINE static void nvptx_teams_reduce_typed(kmp_Ident *loc,
+                                            int32_t global_tid, T *value,
+                                            T *orig) {
+  // The team's value is shared by its threads, the enclosed parallel
+  // reduction already folded the thread values into it. In generic mode the
+  // workers are waiting for parallel work, in SPMD mode every thread of the
+  // block gets here and all but the team master must leave the value alone.
+  if (checkGenericMode(loc)) {
+    if (GetThreadIdInBlock() == GetMasterThreadID())
+      typed_atomic_combine<T, Op>(orig, *value);
+    return;
+  }
+  if (GetThreadIdInBlock() == 0)
+    typed_atomic_combine<T, Op>(orig, *value);
+}
+
+#define TYPED_REDUCTION(OpName, Op, TyName, T)                                 \
+  EXTERN int32_t __kmpc_nvptx_parallel_reduce_nowait_##OpName##_##TyName(      \
+      kmp_Ident *loc, int32_t global_tid, T *value) {                          \
+    return nvptx_parallel_reduce_typed<T, Op<T>>(loc, global_tid, value);      \
+  }                                                                            \
+  EXTERN void __kmpc_nvptx_teams_reduce_nowait_##OpName##_##TyName(            \
+      kmp_Ident *loc, int32_t global_tid, T *value, T *orig) {                 \
+    nvptx_teams_reduce_typed<T, Op<T>>(loc, global_tid, value, orig);          \
+  }
+#define TYPED_REDUCTIONS(TyName, T)                                            \
+  TYPED_REDUCTION(add, omptarget_nvptx_ReduceAdd, TyName, T)                   \
+  TYPED_REDUCTION(min, omptarget_nvptx_ReduceMin, TyName, T)                   \
+  TYPED_REDUCTION(max, omptarget_nvptx_ReduceMax, TyName, T)
+
+TYPED_REDUCTIONS(i32, int32_t)
+TYPED_REDUCTIONS(i64, int64_t)
+TYPED_REDUCTIONS(f32, float)
+TYPED_REDUCTIONS(f64, double)
+
+#undef TYPED_REDUCTIONS
+#undef TYPED_REDUCTION
+
 INLINE
 static int32_t nvptx_teams_reduce_nowait(int32_t global_tid, int32_t num_vars,
                                          size_t reduce_size, void *reduce_data,
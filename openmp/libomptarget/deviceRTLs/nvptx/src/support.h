@@ -42,6 +42,7 @@ INLINE int GetNumberOfBlocksInKernel();
 INLINE int GetNumberOfThreadsInBlock();
 INLINE unsigned GetWarpId();
 INLINE unsigned GetLaneId();
+INLINE unsigned GetSMId();
 
 // get global ids to locate tread/team info (constant regardless of OMP)
 INLINE int GetLogicalThreadIdInBlock(bool isSPMDExecutionMode);
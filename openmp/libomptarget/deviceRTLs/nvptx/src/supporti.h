@@ -106,6 +106,12 @@ INLINE unsigned GetWarpId() { return threadIdx.x / WARPSIZE; }
 
 INLINE unsigned GetLaneId() { return threadIdx.x & (WARPSIZE - 1); }
 
+INLINE unsigned GetSMId() {
+  unsigned id;
+  asm("mov.u32 %0, %%smid;" : "=r"(id));
+  return id;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Calls to the Generic Scheme Implementation Layer (assuming 1D layout)
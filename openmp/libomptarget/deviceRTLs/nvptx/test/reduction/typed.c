@@ -0,0 +1,50 @@
+// RUN: %compile-run-and-check
+
+#include <omp.h>
+#include <stdio.h>
+
+#define N 10000
+
+int main(int argc, char *argv[]) {
+  int Sum = 0, Min = N, Max = -1;
+  long LSum = 0;
+  double DSum = 0;
+
+  // SPMD mode: every thread of a team reaches the teams reduction.
+  #pragma omp target teams distribute parallel for num_teams(8) \
+      thread_limit(128) reduction(+: Sum)
+  for (int I = 0; I < N; ++I)
+    Sum += I;
+  // CHECK: Sum = 49995000
+  printf("Sum = %d\n", Sum);
+
+  #pragma omp target teams distribute parallel for num_teams(8) \
+      thread_limit(96) reduction(min: Min) reduction(max: Max)
+  for (int I = 0; I < N; ++I) {
+    Min = I < Min ? I : Min;
+    Max = I > Max ? I : Max;
+  }
+  // CHECK: Min = 0, Max = 9999
+  printf("Min = %d, Max = %d\n", Min, Max);
+
+  #pragma omp target teams distribute parallel for num_teams(3) \
+      thread_limit(33) reduction(+: LSum)
+  for (int I = 0; I < N; ++I)
+    LSum += I;
+  // CHECK: LSum = 49995000
+  printf("LSum = %ld\n", LSum);
+
+  // Generic mode: only the team master reaches the teams reduction.
+  #pragma omp target teams num_teams(4) reduction(+: DSum)
+  {
+    double Part = 0;
+    #pragma omp parallel for reduction(+: Part)
+    for (int I = 0; I < 100; ++I)
+      Part += 0.5;
+    DSum += Part;
+  }
+  // CHECK: DSum = 200
+  printf("DSum = %g\n", DSum);
+
+  return 0;
+}
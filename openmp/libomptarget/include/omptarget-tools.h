@@ -0,0 +1,147 @@
+//===---- omptarget-tools.h - Tool interface of the OpenMP target RTL -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Interface for performance tools, following the OMPT 5.0 target callbacks
+// and device tracing. The enumerators have the values of their OMPT
+// counterparts. A tool defines __tgt_tool_start, or names its library in
+// OMP_TARGET_TOOL_LIBRARIES, and registers its callbacks there.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _OMPTARGET_TOOLS_H_
+#define _OMPTARGET_TOOLS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TGT_TOOL_VERSION 1
+
+typedef uint64_t tgt_tool_id_t;
+
+// ompt_target_t
+typedef enum tgt_tool_target_t {
+  tgt_tool_target = 1,
+  tgt_tool_target_enter_data = 2,
+  tgt_tool_target_exit_data = 3,
+  tgt_tool_target_update = 4
+} tgt_tool_target_t;
+
+// ompt_scope_endpoint_t
+typedef enum tgt_tool_scope_endpoint_t {
+  tgt_tool_scope_begin = 1,
+  tgt_tool_scope_end = 2
+} tgt_tool_scope_endpoint_t;
+
+// ompt_target_data_op_t
+typedef enum tgt_tool_target_data_op_t {
+  tgt_tool_target_data_alloc = 1,
+  tgt_tool_target_data_transfer_to_device = 2,
+  tgt_tool_target_data_transfer_from_device = 3,
+  tgt_tool_target_data_delete = 4
+} tgt_tool_target_data_op_t;
+
+// ompt_callbacks_t, only the target callbacks are dispatched
+typedef enum tgt_tool_callbacks_t {
+  tgt_tool_callback_target = 8,
+  tgt_tool_callback_target_data_op = 9,
+  tgt_tool_callback_target_submit = 10
+} tgt_tool_callbacks_t;
+
+typedef void (*tgt_tool_callback_t)(void);
+
+// Called on entry and exit of a target construct. target_id names the
+// construct in the data op and submit callbacks issued meanwhile.
+typedef void (*tgt_tool_callback_target_t)(tgt_tool_target_t kind,
+                                           tgt_tool_scope_endpoint_t endpoint,
+                                           int device_num,
+                                           tgt_tool_id_t target_id,
+                                           const void *codeptr_ra);
+
+// Called before each allocation, transfer and release of device memory. The
+// host is device HOST_DEVICE.
+typedef void (*tgt_tool_callback_target_data_op_t)(
+    tgt_tool_id_t target_id, tgt_tool_id_t host_op_id,
+    tgt_tool_target_data_op_t optype, void *src_addr, int src_device_num,
+    void *dest_addr, int dest_device_num, size_t bytes,
+    const void *codeptr_ra);
+
+// Called before each kernel launch
+typedef void (*tgt_tool_callback_target_submit_t)(
+    tgt_tool_id_t target_id, tgt_tool_id_t host_op_id,
+    unsigned int requested_num_teams);
+
+// ompt_record_ompt_t restricted to the target records. Times are
+// CLOCK_MONOTONIC nanoseconds around the host call, queued transfers end
+// once they are queued.
+typedef struct tgt_tool_record_t {
+  tgt_tool_callbacks_t type;
+  uint64_t time;
+  uint64_t end_time;
+  int device_num;
+  tgt_tool_id_t target_id;
+  tgt_tool_id_t host_op_id;
+  union {
+    struct {
+      tgt_tool_target_data_op_t optype;
+      void *src_addr;
+      int src_device_num;
+      void *dest_addr;
+      int dest_device_num;
+      size_t bytes;
+    } data_op;
+    struct {
+      unsigned int requested_num_teams;
+    } submit;
+  } record;
+} tgt_tool_record_t;
+
+// Provide a buffer of *bytes bytes for the records of device_num
+typedef void (*tgt_tool_callback_buffer_request_t)(int device_num,
+                                                   tgt_tool_record_t **buffer,
+                                                   size_t *bytes);
+
+// The records of a buffer from the request callback are complete. The tool
+// owns the buffer again once buffer_owned is set.
+typedef void (*tgt_tool_callback_buffer_complete_t)(int device_num,
+                                                    tgt_tool_record_t *buffer,
+                                                    size_t bytes,
+                                                    int buffer_owned);
+
+// Entry points of the runtime, handed to __tgt_tool_start
+typedef struct tgt_tool_interface_t {
+  // ompt_set_callback, returns 0 if the callback is not dispatched
+  int (*set_callback)(tgt_tool_callbacks_t event,
+                      tgt_tool_callback_t callback);
+  // ompt_start_trace, ompt_flush_trace and ompt_stop_trace, return 1 on
+  // success
+  int (*start_trace)(int device_num,
+                     tgt_tool_callback_buffer_request_t request,
+                     tgt_tool_callback_buffer_complete_t complete);
+  int (*flush_trace)(int device_num);
+  int (*stop_trace)(int device_num);
+  // Counters of the runtime, such as the AT table sizes, the pointer
+  // updates, the bulk segments and the growth of the deep copy heaps. Names
+  // are listed from index 0 until NULL is returned. get_counter returns 0
+  // for an unknown name.
+  const char *(*get_counter_name)(int index);
+  int (*get_counter)(const char *name, uint64_t *count, uint64_t *value);
+} tgt_tool_interface_t;
+
+// Defined by the tool, return 0 to stay detached
+typedef int (*tgt_tool_start_t)(unsigned int version,
+                                const tgt_tool_interface_t *interface);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _OMPTARGET_TOOLS_H_
@@ -66,6 +66,8 @@ enum tgt_map_type {
   OMP_TGT_MAPTYPE_NESTED          = 0x400,
   // neighbors has deep copy mapping
   OMP_TGT_MAPTYPE_HAS_NESTED          = 0x800,
+  // the array of map types is a per construct constant (first entry only)
+  OMP_TGT_MAPTYPE_CONST_DESC      = 0x1000,
   // member of struct, member given by [16 MSBs] - 1
   OMP_TGT_MAPTYPE_MEMBER_OF       = 0xffff000000000000
 };
@@ -101,6 +103,13 @@ enum OpenMPOffloadingMode {
   OMP_OFFMODE_AT_OFFSET           = 0x008
 };
 
+enum OpenMPPrefetchFlags {
+  // migrate to the host instead of the device and wait for it
+  OMP_PREFETCH_TO_HOST            = 0x01,
+  // advise the driver to keep read-only copies on the device
+  OMP_PREFETCH_READ_MOSTLY        = 0x02
+};
+
 /// This struct is a record of an entry point or global. For a function
 /// entry point the size is expected to be zero
 struct __tgt_offload_entry {
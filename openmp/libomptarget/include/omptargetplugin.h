@@ -63,11 +63,48 @@ void *__tgt_rtl_data_alloc(int32_t ID, int64_t Size, void *HostPtr);
 int32_t __tgt_rtl_data_submit(int32_t ID, void *TargetPtr, void *HostPtr,
                               int64_t Size);
 
+// Queue the data content transfer to the target device on the device's
+// transfer stream and return without waiting for completion. The transfer is
+// ordered after all previously queued transfers of the same device. Use
+// __tgt_rtl_synchronize before the data is consumed by a kernel. In case of
+// success, return zero. Otherwise, return an error code.
+int32_t __tgt_rtl_data_submit_async(int32_t ID, void *TargetPtr, void *HostPtr,
+                                    int64_t Size);
+
+// Wait for all transfers queued through __tgt_rtl_data_submit_async on the
+// specified device. In case of success, return zero. Otherwise, return an
+// error code.
+int32_t __tgt_rtl_synchronize(int32_t ID);
+
+// Write N pointer values to the target device in one call. Updates holds N
+// pairs of (target address, pointer value) in host memory. The values are
+// scattered on the device and the call returns after they are visible. In
+// case of success, return zero. Otherwise, return an error code and the
+// caller falls back to per-pointer __tgt_rtl_data_submit.
+int32_t __tgt_rtl_patch_ptrs(int32_t ID, void **Updates, int64_t N);
+
+// Page-lock the host memory range so transfers from and to it can use DMA
+// directly. The range stays registered until it is unregistered or the
+// device is released. In case of success, return zero. Otherwise, return an
+// error code.
+int32_t __tgt_rtl_register_host(int32_t ID, void *HostPtr, int64_t Size);
+
+// Undo __tgt_rtl_register_host for the range starting at HostPtr. In case of
+// success, return zero. Otherwise, return an error code.
+int32_t __tgt_rtl_unregister_host(int32_t ID, void *HostPtr);
+
 // Retrieve the data content from the target device using its address.
 // In case of success, return zero. Otherwise, return an error code.
 int32_t __tgt_rtl_data_retrieve(int32_t ID, void *HostPtr, void *TargetPtr,
                                 int64_t Size);
 
+// Queue the data content transfer from the target device on the device's
+// transfer stream and return without waiting for completion. HostPtr must
+// not be read before __tgt_rtl_synchronize returns. In case of success,
+// return zero. Otherwise, return an error code.
+int32_t __tgt_rtl_data_retrieve_async(int32_t ID, void *HostPtr,
+                                      void *TargetPtr, int64_t Size);
+
 // De-allocate the data referenced by target ptr on the device. In case of
 // success, return zero. Otherwise, return an error code.
 int32_t __tgt_rtl_data_delete(int32_t ID, void *TargetPtr);
@@ -86,8 +123,70 @@ int32_t __tgt_rtl_run_target_team_region(int32_t ID, void *Entry, void **Args,
                                          ptrdiff_t *Offsets, int32_t NumArgs,
                                          int32_t NumTeams, int32_t ThreadLimit,
                                          uint64_t loop_tripcount);
+
+// Similar to __tgt_rtl_run_target_team_region, but launch the kernel variant
+// of the AT mode Mode instead of the one set with __tgt_rtl_set_mode. The
+// arguments must be those of that variant. Optional.
+int32_t __tgt_rtl_run_target_team_region_mode(int32_t ID, void *Entry,
+                                              void **Args, ptrdiff_t *Offsets,
+                                              int32_t NumArgs, int32_t NumTeams,
+                                              int32_t ThreadLimit,
+                                              uint64_t loop_tripcount,
+                                              int32_t Mode);
 int32_t __tgt_rtl_set_mode(int32_t mode);
-void *__tgt_rtl_get_readonly_mem(int64_t *size);
+
+// Fill the read-only device global Name, e.g. a constant memory table read
+// by the kernels, with Size bytes from Data. The content is cached and the
+// copy is skipped when Data did not change since the last call. In case of
+// success, return zero. Otherwise, return an error code, also when the
+// loaded images do not define Name or it is smaller than Size.
+int32_t __tgt_rtl_update_readonly_table(int32_t ID, const char *Name,
+                                        void *Data, int64_t Size);
+
+// Copy Size bytes from SrcPtr on device SrcID to DstPtr on device DstID,
+// both handled by this RTL, without going through the host when the devices
+// can access each other. In case of success, return zero. Otherwise, return
+// an error code.
+int32_t __tgt_rtl_data_exchange(int32_t SrcID, void *SrcPtr, int32_t DstID,
+                                void *DstPtr, int64_t Size);
+
+// Copy a box of Depth slices of Height rows of Width bytes from SrcPtr to
+// DstPtr. Each side is on a device of this RTL, or in host memory when its ID
+// is negative. Consecutive rows are Pitch bytes apart and consecutive slices
+// Pitch * Height bytes apart, with the pitch and height of the array on that
+// side. In case of success, return zero. Otherwise, return an error code and
+// the caller copies the rows one by one.
+int32_t __tgt_rtl_data_copy_rect(int32_t DstID, void *DstPtr, int64_t DstPitch,
+                                 int64_t DstHeight, int32_t SrcID,
+                                 void *SrcPtr, int64_t SrcPitch,
+                                 int64_t SrcHeight, int64_t Width,
+                                 int64_t Height, int64_t Depth);
+
+// Migrate Size bytes of managed memory at Ptr to device ID ahead of its use,
+// Flags is a combination of OpenMPPrefetchFlags. A Size of zero covers the
+// whole allocation Ptr points into. In case of success, return zero.
+// Otherwise, e.g. when Ptr is not managed memory, nothing is migrated and an
+// error code is returned.
+int32_t __tgt_rtl_data_prefetch(int32_t ID, void *Ptr, int64_t Size,
+                                int32_t Flags);
+
+// Record the transfers and launches the calling thread issues on device ID
+// until __tgt_rtl_capture_end instead of running them. In case of success,
+// return zero. Otherwise, return an error code and nothing is recorded.
+int32_t __tgt_rtl_capture_begin(int32_t ID);
+
+// Stop recording and return a graph of the recorded work, ready to be
+// launched, or NULL if some of it could not be recorded. The recorded work
+// has not run in either case.
+void *__tgt_rtl_capture_end(int32_t ID);
+
+// Run a graph returned by __tgt_rtl_capture_end and wait for it. In case of
+// success, return zero. Otherwise, return an error code.
+int32_t __tgt_rtl_graph_launch(int32_t ID, void *Graph);
+
+// Release a graph returned by __tgt_rtl_capture_end. In case of success,
+// return zero. Otherwise, return an error code.
+int32_t __tgt_rtl_graph_destroy(int32_t ID, void *Graph);
 
 #ifdef __cplusplus
 }
@@ -10,10 +10,16 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cuda.h>
+#include <cstdio>
+#include <cstring>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -67,6 +73,32 @@ enum ExecutionModeType {
   NONE
 };
 
+/// Launch limits of one kernel variant, queried once when the binary is loaded
+struct LaunchLimitsTy {
+  // CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, 0 if unknown
+  int MaxThreads;
+  // Block size reaching the maximum occupancy and the number of blocks that
+  // fill the device with it, 0 if unknown
+  int OccThreads;
+  int OccBlocks;
+};
+
+/// Kernel variants, indexes KernelTy::Limits
+enum KernelVariantTy {
+  KV_NORMAL = 0,
+  KV_AT_TABLE,
+  KV_AT_MASK,
+  KV_AT_OFFSET,
+  KV_COUNT
+};
+
+/// Kernel argument served from a constant memory symbol
+struct ConstArgTy {
+  int32_t ArgIdx;
+  CUdeviceptr Sym;
+  size_t Size;
+};
+
 /// Use a single entity to encode a kernel and a set of flags
 struct KernelTy {
   CUfunction Func;
@@ -79,8 +111,19 @@ struct KernelTy {
   // 1 - Generic mode (with master warp)
   int8_t ExecutionMode;
 
+  // Per variant, so launches do not query the driver
+  LaunchLimitsTy Limits[KV_COUNT] = {};
+
   std::string KerName;
 
+  // Copy of the kernel reading some array arguments from constant memory,
+  // see Glob2Const. Launches of it are serialized on ConstDone since they
+  // share the symbols.
+  CUfunction ConstFunc = nullptr;
+  std::vector<ConstArgTy> ConstArgs;
+  CUevent ConstDone = nullptr;
+  std::shared_ptr<std::mutex> ConstMtx;
+
   /*
   KernelTy(CUfunction _Func, int8_t _ExecutionMode, char *_Name)
       : Func(_Func), ExecutionMode(_ExecutionMode), KerName(_Name) {}
@@ -97,12 +140,58 @@ struct omptarget_device_environmentTy {
   int32_t debug_level;
 };
 
+/// Global memory pool for the data sharing slots of the deviceRTL, one arena
+/// per SM. Manually sync with the deviceRTL side.
+struct omptarget_nvptx_DataSharingPoolTy {
+  CUdeviceptr Base;
+  CUdeviceptr State;
+  uint64_t ArenaSize;
+  uint32_t NumArenas;
+};
+
 /// List that contains all the kernels.
 /// FIXME: we may need this to be per device and per library.
 std::list<KernelTy> KernelsList;
 
-void *ConstMem = NULL;
-size_t ConstMemSize = 0;
+/// Device global filled by __tgt_rtl_update_readonly_table
+struct ReadOnlyTableTy {
+  CUdeviceptr Ptr;
+  size_t Size;
+  // Content last uploaded, empty if nothing was uploaded yet
+  std::vector<char> Data;
+};
+
+/// Launch configuration auto-tuning of one kernel and loop trip count bucket,
+/// see OMP_CUDA_AUTOTUNE. Candidates are tried in order over the first
+/// launches, then the fastest one is locked in.
+struct TunedLaunchTy {
+  // Candidate tried next, TuneCandidates once the best one is locked in
+  int Next = 0;
+  // Best candidate so far and its kernel time
+  int Best = -1;
+  float BestMs = 0;
+};
+
+// Threads per block and grid size scale, in halves of the default grid
+static const int TuneThreads[] = {64, 128, 256, 512, 1024};
+static const int TuneGridHalves[] = {1, 2, 4};
+static const int TuneNumScales = sizeof(TuneGridHalves) / sizeof(int);
+static const int TuneCandidates =
+    sizeof(TuneThreads) / sizeof(int) * TuneNumScales;
+
+/// Pinned host ring that small asynchronous submits are copied through, so
+/// that the copies do not wait for the driver to stage pageable memory. The
+/// ring is split in segments, each with an event recorded when the ring moves
+/// past it; a segment is reused once its event has completed.
+struct StagingRingTy {
+  static const int NumSegments = 16;
+  char *Base = nullptr;
+  size_t SegmentSize = 0;
+  int Segment = 0;
+  size_t Head = 0; // offset in the current segment
+  CUevent Events[NumSegments] = {};
+  bool Recorded[NumSegments] = {};
+};
 
 /// Class containing all the device information.
 class RTLDeviceInfoTy {
@@ -112,11 +201,42 @@ public:
   int NumberOfDevices;
   std::vector<CUmodule> Modules;
   std::vector<CUcontext> Contexts;
+  // Stream created with the context, NULL if streams are not usable
+  std::vector<CUstream> Streams;
+  // Streams of the host threads, see getStream
+  std::vector<std::vector<CUstream>> ThreadStreams;
+  std::mutex ThreadStreamsMtx;
+  // Staging rings of the host threads, see getStagingRing, guarded by
+  // ThreadStreamsMtx
+  std::vector<std::vector<std::unique_ptr<StagingRingTy>>> StagingRings;
+  // Peer access between contexts, indexed [dst][src]: 0 not tried yet,
+  // 1 enabled, -1 unavailable
+  std::vector<std::vector<int8_t>> PeerAccess;
+  std::mutex PeerAccessMtx;
+  // Whether kernels may touch managed memory while the host uses it, only
+  // then can it be prefetched
+  std::vector<bool> ConcurrentManaged;
+  // Data sharing slot pool handed to the deviceRTL, Base is 0 until the
+  // first image asking for it is loaded
+  std::vector<omptarget_nvptx_DataSharingPoolTy> DataSharingPools;
+  // Pointer patch kernel from the deviceRTL, NULL if the image lacks it
+  std::vector<CUfunction> PatchPtrFuncs;
+  // Scratch buffer holding the uploaded (address, value) pairs, guarded by
+  // PatchMtx until the patch kernel reading it has finished
+  std::vector<CUdeviceptr> PatchBufs;
+  std::vector<size_t> PatchBufSizes;
+  std::mutex PatchMtx;
+  // Modules loaded per device and the read-only tables found in them
+  std::vector<std::vector<CUmodule>> DeviceModules;
+  std::vector<std::map<std::string, ReadOnlyTableTy>> ReadOnlyTables;
 
   // Device properties
   std::vector<int> ThreadsPerBlock;
   std::vector<int> BlocksPerGrid;
   std::vector<int> WarpSize;
+  // Model name and compute capability, e.g. "Tesla_V100-SXM2-16GB/sm_70",
+  // which tuned launches are kept for
+  std::vector<std::string> Models;
 
   // OpenMP properties
   std::vector<int> NumTeams;
@@ -132,6 +252,21 @@ public:
   // OpenMP Offload Mode
   int32_t OffloadMode;
 
+  // Default launch configuration from the occupancy calculator
+  bool UseOccupancy;
+  // Leave kernels running on the thread's stream after the launch returns
+  bool AsyncLaunch;
+  // Bytes of data sharing pool per SM, 0 leaves the slots to device malloc
+  uint64_t DataSharingArenaSize;
+  // Bytes of pinned staging ring per host thread and device, 0 disables it
+  size_t StagingRingSize;
+  // Launch tuning, keyed by device model, kernel name and trip count bucket,
+  // and the file it is kept in across runs, empty if tuning is off
+  std::string TuneFile;
+  std::map<std::string, TunedLaunchTy> TunedLaunches;
+  std::mutex TuneMtx;
+  bool TuneDirty = false;
+
   //static int EnvNumThreads;
   static const int HardTeamLimit = 1<<16; // 64k
   static const int HardThreadLimit = 1024;
@@ -225,9 +360,21 @@ public:
 
     FuncGblEntries.resize(NumberOfDevices);
     Contexts.resize(NumberOfDevices);
+    Streams.resize(NumberOfDevices);
+    ThreadStreams.resize(NumberOfDevices);
+    StagingRings.resize(NumberOfDevices);
+    PeerAccess.assign(NumberOfDevices, std::vector<int8_t>(NumberOfDevices, 0));
+    ConcurrentManaged.resize(NumberOfDevices);
+    DataSharingPools.resize(NumberOfDevices);
+    PatchPtrFuncs.resize(NumberOfDevices);
+    PatchBufs.resize(NumberOfDevices);
+    PatchBufSizes.resize(NumberOfDevices);
+    DeviceModules.resize(NumberOfDevices);
+    ReadOnlyTables.resize(NumberOfDevices);
     ThreadsPerBlock.resize(NumberOfDevices);
     BlocksPerGrid.resize(NumberOfDevices);
     WarpSize.resize(NumberOfDevices);
+    Models.resize(NumberOfDevices);
     NumTeams.resize(NumberOfDevices);
     NumThreads.resize(NumberOfDevices);
 
@@ -248,12 +395,75 @@ public:
     } else {
       EnvNumTeams = -1;
     }
+    envStr = getenv("OMP_CUDA_OCCUPANCY");
+    UseOccupancy = envStr && std::stoi(envStr);
+    envStr = getenv("OMP_CUDA_ASYNC_LAUNCH");
+    AsyncLaunch = envStr && std::stoi(envStr);
+    DP("Occupancy based launch %s, asynchronous launch %s\n",
+       UseOccupancy ? "on" : "off", AsyncLaunch ? "on" : "off");
+    envStr = getenv("OMP_CUDA_DATA_SHARING_POOL");
+    DataSharingArenaSize = envStr ? std::stoull(envStr) : 0;
+    // Keep the arenas 8-byte aligned, as the slots carved out of them
+    DataSharingArenaSize = (DataSharingArenaSize + 7) & ~(uint64_t)7;
+    DP("Data sharing pool of %" PRIu64 " bytes per SM\n",
+       DataSharingArenaSize);
+    envStr = getenv("OMP_CUDA_AUTOTUNE");
+    if (envStr && *envStr) {
+      TuneFile = envStr;
+      loadTunedLaunches();
+    }
+    envStr = getenv("OMP_CUDA_STAGING_RING");
+    StagingRingSize = envStr ? std::stoull(envStr) : (1 << 20);
+    DP("Staging ring of %zu bytes per host thread\n", StagingRingSize);
 
     // Default state.
     RequiresFlags = OMP_REQ_UNDEFINED;
   }
 
+  // Tuning file lines are "<model>/<kernel>/<bucket> <threads> <grid halves>"
+  void loadTunedLaunches() {
+    FILE *f = fopen(TuneFile.c_str(), "r");
+    if (!f) {
+      return;
+    }
+    char key[1024];
+    int threads, halves;
+    while (fscanf(f, "%1023s %d %d", key, &threads, &halves) == 3) {
+      for (int c = 0; c < TuneCandidates; c++) {
+        if (TuneThreads[c / TuneNumScales] == threads &&
+            TuneGridHalves[c % TuneNumScales] == halves) {
+          TunedLaunchTy &T = TunedLaunches[key];
+          T.Best = c;
+          T.Next = TuneCandidates;
+        }
+      }
+    }
+    fclose(f);
+    DP("Loaded %zu tuned launches from %s\n", TunedLaunches.size(),
+       TuneFile.c_str());
+  }
+
+  void saveTunedLaunches() {
+    FILE *f = fopen(TuneFile.c_str(), "w");
+    if (!f) {
+      DP("Cannot write the tuning file %s\n", TuneFile.c_str());
+      return;
+    }
+    for (auto &KV : TunedLaunches) {
+      if (KV.second.Next == TuneCandidates && KV.second.Best >= 0) {
+        fprintf(f, "%s %d %d\n", KV.first.c_str(),
+                TuneThreads[KV.second.Best / TuneNumScales],
+                TuneGridHalves[KV.second.Best % TuneNumScales]);
+      }
+    }
+    fclose(f);
+  }
+
   ~RTLDeviceInfoTy() {
+    if (TuneDirty) {
+      saveTunedLaunches();
+    }
+
     // Close modules
     for (auto &module : Modules)
       if (module) {
@@ -264,6 +474,32 @@ public:
         }
       }
 
+    // Destroy streams
+    for (auto &stream : Streams)
+      if (stream) {
+        CUresult err = cuStreamDestroy(stream);
+        if (err != CUDA_SUCCESS) {
+          DP("Error when destroying CUDA stream\n");
+          CUDA_ERR_STRING(err);
+        }
+      }
+    for (auto &streams : ThreadStreams)
+      for (auto &stream : streams) {
+        CUresult err = cuStreamDestroy(stream);
+        if (err != CUDA_SUCCESS) {
+          DP("Error when destroying CUDA stream\n");
+          CUDA_ERR_STRING(err);
+        }
+      }
+    for (auto &rings : StagingRings)
+      for (auto &ring : rings) {
+        for (CUevent event : ring->Events)
+          if (event)
+            cuEventDestroy(event);
+        if (ring->Base)
+          cuMemFreeHost(ring->Base);
+      }
+
     // Destroy contexts
     for (auto &ctx : Contexts)
       if (ctx) {
@@ -278,12 +514,24 @@ public:
 
 static RTLDeviceInfoTy DeviceInfo;
 
+// Images that hold PTX code, such as the kernels Polly offloads to this
+// plugin, are NUL-terminated text that the CUDA driver compiles when it loads
+// them.
+static bool isPTXImage(__tgt_device_image *image) {
+  const char *Begin = (const char *)image->ImageStart;
+  const char *End = (const char *)image->ImageEnd;
+  if (End <= Begin || End[-1] != '\0')
+    return false;
+  return strstr(Begin, ".version") && strstr(Begin, ".target");
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int32_t __tgt_rtl_is_valid_binary(__tgt_device_image *image) {
-  return elf_check_machine(image, 190); // EM_CUDA = 190.
+  return elf_check_machine(image, 190) || // EM_CUDA = 190.
+         isPTXImage(image);
 }
 
 int32_t __tgt_rtl_number_of_devices() { return DeviceInfo.NumberOfDevices; }
@@ -314,6 +562,15 @@ int32_t __tgt_rtl_init_device(int32_t device_id) {
     return OFFLOAD_FAIL;
   }
 
+  // Non-blocking so that queued transfers do not serialize with kernels on
+  // the default stream; ordering is enforced by __tgt_rtl_synchronize.
+  err = cuStreamCreate(&DeviceInfo.Streams[device_id], CU_STREAM_NON_BLOCKING);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when creating a CUDA stream, async transfer is disabled\n");
+    CUDA_ERR_STRING(err);
+    DeviceInfo.Streams[device_id] = NULL;
+  }
+
   // Query attributes to determine number of threads/block and blocks/grid.
   int maxGridDimX;
   err = cuDeviceGetAttribute(&maxGridDimX, CU_DEVICE_ATTRIBUTE_MAX_GRID_DIM_X,
@@ -331,6 +588,23 @@ int32_t __tgt_rtl_init_device(int32_t device_id) {
        maxGridDimX, RTLDeviceInfoTy::HardTeamLimit);
   }
 
+  // Tuned launches only carry over to devices of the same model. Spaces are
+  // replaced so that the model is a single word of the tuning file.
+  char name[256];
+  int major, minor;
+  if (cuDeviceGetName(name, sizeof(name), cuDevice) == CUDA_SUCCESS &&
+      cuDeviceGetAttribute(&major, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR,
+                           cuDevice) == CUDA_SUCCESS &&
+      cuDeviceGetAttribute(&minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR,
+                           cuDevice) == CUDA_SUCCESS) {
+    std::string &Model = DeviceInfo.Models[device_id];
+    Model = name;
+    std::replace(Model.begin(), Model.end(), ' ', '_');
+    Model += "/sm_" + std::to_string(major * 10 + minor);
+  } else {
+    DP("Error getting the device model, launches are not tuned\n");
+  }
+
   // We are only exploiting threads along the x axis.
   int maxBlockDimX;
   err = cuDeviceGetAttribute(&maxBlockDimX, CU_DEVICE_ATTRIBUTE_MAX_BLOCK_DIM_X,
@@ -358,6 +632,13 @@ int32_t __tgt_rtl_init_device(int32_t device_id) {
     DeviceInfo.WarpSize[device_id] = warpSize;
   }
 
+  int concurrentManaged;
+  err = cuDeviceGetAttribute(&concurrentManaged,
+                             CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS,
+                             cuDevice);
+  DeviceInfo.ConcurrentManaged[device_id] =
+      err == CUDA_SUCCESS && concurrentManaged;
+
   // Adjust teams to the env variables
   if (DeviceInfo.EnvTeamLimit > 0 &&
       DeviceInfo.BlocksPerGrid[device_id] > DeviceInfo.EnvTeamLimit) {
@@ -400,6 +681,137 @@ int32_t __tgt_rtl_init_device(int32_t device_id) {
   return OFFLOAD_SUCCESS;
 }
 
+// Returns the function launched for the variant, NULL if it is missing.
+static CUfunction getKernelFunc(const KernelTy &K, int Variant) {
+  switch (Variant) {
+  case KV_AT_TABLE:
+    return K.Func_ATTable ? *K.Func_ATTable : NULL;
+  case KV_AT_MASK:
+    return K.Func_ATMask ? *K.Func_ATMask : NULL;
+  case KV_AT_OFFSET:
+    return K.Func_ATOffset ? *K.Func_ATOffset : NULL;
+  }
+  return K.Func;
+}
+
+static int getKernelVariant(int32_t OffloadMode) {
+  switch (OffloadMode) {
+  case OMP_OFFMODE_AT_TABLE:
+    return KV_AT_TABLE;
+  case OMP_OFFMODE_AT_MASK:
+    return KV_AT_MASK;
+  case OMP_OFFMODE_AT_OFFSET:
+    return KV_AT_OFFSET;
+  }
+  return KV_NORMAL;
+}
+
+// Fills K.Limits, the kernel's module must be loaded in the current context.
+static void initLaunchLimits(KernelTy &K) {
+  for (int V = 0; V < KV_COUNT; ++V) {
+    CUfunction func = getKernelFunc(K, V);
+    if (!func) {
+      continue;
+    }
+    LaunchLimitsTy &L = K.Limits[V];
+    if (cuFuncGetAttribute(&L.MaxThreads,
+            CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, func) != CUDA_SUCCESS) {
+      L.MaxThreads = 0;
+    }
+    if (DeviceInfo.UseOccupancy &&
+        cuOccupancyMaxPotentialBlockSize(&L.OccBlocks, &L.OccThreads, func,
+            NULL, 0 /*bytes of shared memory*/, 0) != CUDA_SUCCESS) {
+      L.OccBlocks = L.OccThreads = 0;
+    }
+    DP("Kernel %s variant %d: max threads %d, occupancy %d blocks of %d "
+       "threads\n", K.KerName.c_str(), V, L.MaxThreads, L.OccBlocks,
+       L.OccThreads);
+  }
+}
+
+// Look up the constant memory copy of K, Name__const, and its symbols. The
+// module must be loaded in the current context.
+static void initConstArgs(KernelTy &K, CUmodule cumod) {
+  std::string Name = K.KerName + "__const";
+  CUfunction ConstFunc;
+  if (cuModuleGetFunction(&ConstFunc, cumod, Name.c_str()) != CUDA_SUCCESS) {
+    return;
+  }
+  CUdeviceptr IdxPtr;
+  size_t IdxSize;
+  CUresult err = cuModuleGetGlobal(&IdxPtr, &IdxSize, cumod,
+      (Name + "_args").c_str());
+  std::vector<int32_t> Idxs(IdxSize / sizeof(int32_t));
+  if (err == CUDA_SUCCESS && !Idxs.empty()) {
+    err = cuMemcpyDtoH(Idxs.data(), IdxPtr, Idxs.size() * sizeof(int32_t));
+  }
+  if (err != CUDA_SUCCESS || Idxs.empty()) {
+    DP("Kernel %s has no constant argument list\n", Name.c_str());
+    CUDA_ERR_STRING(err);
+    return;
+  }
+  std::vector<ConstArgTy> Args;
+  for (int32_t Idx : Idxs) {
+    ConstArgTy A;
+    A.ArgIdx = Idx;
+    std::string SymName = Name + "_arg" + std::to_string(Idx);
+    err = cuModuleGetGlobal(&A.Sym, &A.Size, cumod, SymName.c_str());
+    if (err != CUDA_SUCCESS) {
+      DP("Loading constant argument '%s' (Failed)\n", SymName.c_str());
+      CUDA_ERR_STRING(err);
+      return;
+    }
+    Args.push_back(A);
+  }
+  K.ConstFunc = ConstFunc;
+  K.ConstArgs = Args;
+  K.ConstMtx = std::make_shared<std::mutex>();
+  DP("Kernel %s reads %zu arguments from constant memory\n",
+     K.KerName.c_str(), Args.size());
+}
+
+// Allocate the data sharing pool of the device, one arena per SM, in the
+// current context. Leaves Pool.Base at 0 on failure.
+static void initDataSharingPool(int32_t device_id,
+    omptarget_nvptx_DataSharingPoolTy &Pool) {
+  CUdevice cuDevice;
+  int NumSMs;
+  CUresult err = cuDeviceGet(&cuDevice, device_id);
+  if (err == CUDA_SUCCESS) {
+    err = cuDeviceGetAttribute(&NumSMs,
+        CU_DEVICE_ATTRIBUTE_MULTIPROCESSOR_COUNT, cuDevice);
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when getting the SM count of device %d\n", device_id);
+    CUDA_ERR_STRING(err);
+    return;
+  }
+
+  uint64_t ArenaSize = DeviceInfo.DataSharingArenaSize;
+  size_t StateSize = NumSMs * sizeof(unsigned long long);
+  CUdeviceptr Ptr;
+  err = cuMemAlloc(&Ptr, StateSize + NumSMs * ArenaSize);
+  if (err == CUDA_SUCCESS) {
+    err = cuMemsetD8(Ptr, 0, StateSize);
+    if (err != CUDA_SUCCESS) {
+      cuMemFree(Ptr);
+    }
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when allocating the data sharing pool of device %d\n",
+       device_id);
+    CUDA_ERR_STRING(err);
+    return;
+  }
+
+  Pool.State = Ptr;
+  Pool.Base = Ptr + StateSize;
+  Pool.ArenaSize = ArenaSize;
+  Pool.NumArenas = NumSMs;
+  DP("Allocated data sharing pool " DPxMOD " of %d arenas of %" PRIu64
+     " bytes\n", DPxPTR(Pool.Base), NumSMs, ArenaSize);
+}
+
 __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
     __tgt_device_image *image) {
 
@@ -427,17 +839,9 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
 
   DP("CUDA module successfully loaded!\n");
   DeviceInfo.Modules.push_back(cumod);
-
-  if (getenv("OMP_OFFSET_CM")) {
-    err = cuModuleGetGlobal(
-        (CUdeviceptr*)&ConstMem, &ConstMemSize, cumod,"ConstMem");
-    if (err != CUDA_SUCCESS) {
-      fprintf(stderr, "cuda rtl get constmem failed\n");
-      CUDA_ERR_STRING(err);
-    } else {
-      DP("cuda rtl get constmem: %p\n", ConstMem);
-    }
-  }
+  DeviceInfo.DeviceModules[device_id].push_back(cumod);
+  // Tables are looked up again, the new image may define them
+  DeviceInfo.ReadOnlyTables[device_id].clear();
 
   // Find the symbols in the module by name.
   __tgt_offload_entry *HostBegin = image->EntriesBegin;
@@ -614,6 +1018,8 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
     K.Func_ATTable = funATTable;
     K.Func_ATMask = funATMask;
     K.Func_ATOffset = funATOffset;
+    initLaunchLimits(K);
+    initConstArgs(K, cumod);
     KernelsList.push_back(K);
 
     __tgt_offload_entry entry = *e;
@@ -664,6 +1070,43 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
     }
   }
 
+  // Hand the data sharing pool to the deviceRTL of the image
+  if (DeviceInfo.DataSharingArenaSize) {
+    const char *PoolName = "omptarget_nvptx_dataSharingPool";
+    CUdeviceptr PoolPtr;
+    size_t cusize;
+    err = cuModuleGetGlobal(&PoolPtr, &cusize, cumod, PoolName);
+    omptarget_nvptx_DataSharingPoolTy &Pool =
+        DeviceInfo.DataSharingPools[device_id];
+    if (err != CUDA_SUCCESS || cusize != sizeof(Pool)) {
+      DP("Data sharing pool '%s' missing, slots use device malloc\n",
+         PoolName);
+    } else {
+      if (!Pool.Base) {
+        initDataSharingPool(device_id, Pool);
+      }
+      if (Pool.Base) {
+        err = cuMemcpyHtoD(PoolPtr, &Pool, cusize);
+        if (err != CUDA_SUCCESS) {
+          DP("Error when sending the data sharing pool to the device\n");
+          CUDA_ERR_STRING(err);
+        }
+      }
+    }
+  }
+
+  // Look for the pointer patch kernel used by __tgt_rtl_patch_ptrs
+  {
+    CUfunction PatchFunc;
+    err = cuModuleGetFunction(&PatchFunc, cumod, "__omptarget_nvptx_patch_ptrs");
+    if (err == CUDA_SUCCESS) {
+      DP("Found pointer patch kernel (" DPxMOD ")\n", DPxPTR(PatchFunc));
+      DeviceInfo.PatchPtrFuncs[device_id] = PatchFunc;
+    } else {
+      DP("Pointer patch kernel missing, batched pointer patch is disabled\n");
+    }
+  }
+
   return DeviceInfo.getOffloadEntriesTable(device_id);
 }
 
@@ -692,6 +1135,186 @@ void *__tgt_rtl_data_alloc(int32_t device_id, int64_t size, void *hst_ptr) {
   return vptr;
 }
 
+// Stream of the calling host thread on the device, created on first use so
+// that target regions of different host threads do not serialize. The
+// context of the device must be current. Returns NULL if the device has no
+// usable streams.
+static CUstream getStream(int32_t device_id) {
+  static thread_local std::vector<CUstream> Mine;
+  if (!DeviceInfo.Streams[device_id]) {
+    return NULL;
+  }
+  if ((size_t)device_id >= Mine.size()) {
+    Mine.resize(device_id + 1, NULL);
+  }
+  if (!Mine[device_id]) {
+    CUstream stream;
+    CUresult err = cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING);
+    if (err != CUDA_SUCCESS) {
+      DP("Error when creating a CUDA stream, using the shared one\n");
+      CUDA_ERR_STRING(err);
+      stream = DeviceInfo.Streams[device_id];
+    } else {
+      std::lock_guard<std::mutex> Lock(DeviceInfo.ThreadStreamsMtx);
+      DeviceInfo.ThreadStreams[device_id].push_back(stream);
+    }
+    Mine[device_id] = stream;
+  }
+  return Mine[device_id];
+}
+
+// Devices on which the calling thread left kernels running, see
+// RTLDeviceInfoTy::AsyncLaunch
+static thread_local std::vector<bool> PendingLaunches;
+
+static void setPendingLaunch(int32_t device_id, bool Pending) {
+  if ((size_t)device_id >= PendingLaunches.size()) {
+    if (!Pending) {
+      return;
+    }
+    PendingLaunches.resize(device_id + 1, false);
+  }
+  PendingLaunches[device_id] = Pending;
+}
+
+// Capture state of the calling thread per device, see
+// __tgt_rtl_capture_begin
+enum CaptureStateTy : char {
+  CAPTURE_NONE = 0,
+  CAPTURE_ACTIVE,
+  // Some work could not be recorded, __tgt_rtl_capture_end will fail
+  CAPTURE_BROKEN
+};
+static thread_local std::vector<char> CaptureStates;
+
+static bool isCapturing(int32_t device_id) {
+  return (size_t)device_id < CaptureStates.size() &&
+         CaptureStates[device_id] != CAPTURE_NONE;
+}
+
+// Called when work cannot be recorded. The capture goes on, so the caller's
+// bookkeeping stays balanced, and the caller runs the work again once
+// __tgt_rtl_capture_end fails.
+static int32_t breakCapture(int32_t device_id, const char *what) {
+  DP("Cannot capture %s on device %d\n", what, device_id);
+  CaptureStates[device_id] = CAPTURE_BROKEN;
+  return OFFLOAD_SUCCESS;
+}
+
+// Waits for the kernels the calling thread left running on the device. Used
+// before transfers that are not ordered on the thread's stream. The context
+// of the device must be current.
+static int32_t waitPendingLaunches(int32_t device_id) {
+  // Pending kernels were waited for when the capture began
+  if (isCapturing(device_id)) {
+    return OFFLOAD_SUCCESS;
+  }
+  if ((size_t)device_id >= PendingLaunches.size() ||
+      !PendingLaunches[device_id]) {
+    return OFFLOAD_SUCCESS;
+  }
+  PendingLaunches[device_id] = false;
+  CUresult err = cuStreamSynchronize(getStream(device_id));
+  if (err != CUDA_SUCCESS) {
+    DP("Kernel execution error on device %d\n", device_id);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+// Reports a failure of the kernels the calling thread left running on the
+// device without waiting for them, so that an asynchronous launch fails the
+// next launch instead of a later unrelated transfer. The context of the
+// device must be current.
+static int32_t checkPendingLaunches(int32_t device_id) {
+  if (isCapturing(device_id) ||
+      (size_t)device_id >= PendingLaunches.size() ||
+      !PendingLaunches[device_id]) {
+    return OFFLOAD_SUCCESS;
+  }
+  CUresult err = cuStreamQuery(getStream(device_id));
+  if (err == CUDA_ERROR_NOT_READY) {
+    return OFFLOAD_SUCCESS;
+  }
+  PendingLaunches[device_id] = false;
+  if (err != CUDA_SUCCESS) {
+    DP("Kernel execution error on device %d\n", device_id);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+// Staging ring of the calling host thread on the device, created on first
+// use. The context of the device must be current. Returns NULL if staging is
+// disabled or the ring could not be set up.
+static StagingRingTy *getStagingRing(int32_t device_id) {
+  static thread_local std::vector<StagingRingTy *> Mine;
+  if (!DeviceInfo.StagingRingSize) {
+    return NULL;
+  }
+  if ((size_t)device_id >= Mine.size()) {
+    Mine.resize(device_id + 1, NULL);
+  }
+  if (Mine[device_id]) {
+    return Mine[device_id]->Base ? Mine[device_id] : NULL;
+  }
+  std::unique_ptr<StagingRingTy> ring(new StagingRingTy());
+  ring->SegmentSize = DeviceInfo.StagingRingSize / StagingRingTy::NumSegments;
+  CUresult err = cuMemAllocHost((void **)&ring->Base,
+                                ring->SegmentSize * StagingRingTy::NumSegments);
+  for (int i = 0; err == CUDA_SUCCESS && i < StagingRingTy::NumSegments; i++) {
+    err = cuEventCreate(&ring->Events[i], CU_EVENT_DISABLE_TIMING);
+  }
+  if (err != CUDA_SUCCESS || !ring->SegmentSize) {
+    DP("Error when creating the staging ring, copying from host memory\n");
+    CUDA_ERR_STRING(err);
+    if (ring->Base) {
+      cuMemFreeHost(ring->Base);
+      ring->Base = NULL;
+    }
+  }
+  // Kept even if unusable, so that creation is not retried on every copy
+  Mine[device_id] = ring.get();
+  std::lock_guard<std::mutex> Lock(DeviceInfo.ThreadStreamsMtx);
+  DeviceInfo.StagingRings[device_id].push_back(std::move(ring));
+  return Mine[device_id]->Base ? Mine[device_id] : NULL;
+}
+
+// Copy size bytes of hst_ptr into the staging ring and return where, or NULL
+// if it does not fit a segment or waiting for a segment failed.
+static void *stageCopy(StagingRingTy *ring, CUstream stream, void *hst_ptr,
+                       int64_t size) {
+  if ((size_t)size > ring->SegmentSize) {
+    return NULL;
+  }
+  if (ring->Head + size > ring->SegmentSize) {
+    // Move to the next segment once the copies queued from it are done
+    CUresult err = cuEventRecord(ring->Events[ring->Segment], stream);
+    if (err != CUDA_SUCCESS) {
+      CUDA_ERR_STRING(err);
+      return NULL;
+    }
+    ring->Recorded[ring->Segment] = true;
+    int next = (ring->Segment + 1) % StagingRingTy::NumSegments;
+    if (ring->Recorded[next]) {
+      err = cuEventSynchronize(ring->Events[next]);
+      if (err != CUDA_SUCCESS) {
+        CUDA_ERR_STRING(err);
+        return NULL;
+      }
+    }
+    ring->Segment = next;
+    ring->Head = 0;
+  }
+  // Keep the copies 8-byte aligned
+  char *dst = ring->Base + ring->Segment * ring->SegmentSize + ring->Head;
+  ring->Head += (size + 7) & ~(int64_t)7;
+  memcpy(dst, hst_ptr, size);
+  return dst;
+}
+
 int32_t __tgt_rtl_data_submit(int32_t device_id, void *tgt_ptr, void *hst_ptr,
     int64_t size) {
   // Set the context we are using.
@@ -701,6 +1324,19 @@ int32_t __tgt_rtl_data_submit(int32_t device_id, void *tgt_ptr, void *hst_ptr,
     CUDA_ERR_STRING(err);
     return OFFLOAD_FAIL;
   }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  if (isCapturing(device_id)) {
+    err = cuMemcpyHtoDAsync((CUdeviceptr)tgt_ptr, hst_ptr, size,
+                            getStream(device_id));
+    if (err != CUDA_SUCCESS) {
+      CUDA_ERR_STRING(err);
+      return breakCapture(device_id, "host to device copy");
+    }
+    return OFFLOAD_SUCCESS;
+  }
 
   err = cuMemcpyHtoD((CUdeviceptr)tgt_ptr, hst_ptr, size);
   if (err != CUDA_SUCCESS) {
@@ -713,8 +1349,12 @@ int32_t __tgt_rtl_data_submit(int32_t device_id, void *tgt_ptr, void *hst_ptr,
   return OFFLOAD_SUCCESS;
 }
 
-int32_t __tgt_rtl_data_retrieve(int32_t device_id, void *hst_ptr, void *tgt_ptr,
-    int64_t size) {
+int32_t __tgt_rtl_data_submit_async(int32_t device_id, void *tgt_ptr,
+    void *hst_ptr, int64_t size) {
+  if (!DeviceInfo.Streams[device_id]) {
+    return __tgt_rtl_data_submit(device_id, tgt_ptr, hst_ptr, size);
+  }
+
   // Set the context we are using.
   CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
   if (err != CUDA_SUCCESS) {
@@ -722,19 +1362,41 @@ int32_t __tgt_rtl_data_retrieve(int32_t device_id, void *hst_ptr, void *tgt_ptr,
     CUDA_ERR_STRING(err);
     return OFFLOAD_FAIL;
   }
-
-  err = cuMemcpyDtoH(hst_ptr, (CUdeviceptr)tgt_ptr, size);
+  CUstream stream = getStream(device_id);
+
+  // Pageable host memory is copied to a staging buffer before this returns,
+  // so hst_ptr may be reused by the caller right away. Small copies go
+  // through the thread's pinned ring rather than the driver's staging, which
+  // waits for the copy. A recorded graph would read the ring after it has
+  // been reused, so captures copy from hst_ptr.
+  void *src = hst_ptr;
+  if (!isCapturing(device_id)) {
+    if (StagingRingTy *ring = getStagingRing(device_id)) {
+      if (void *staged = stageCopy(ring, stream, hst_ptr, size)) {
+        src = staged;
+      }
+    }
+  }
+  err = cuMemcpyHtoDAsync((CUdeviceptr)tgt_ptr, src, size, stream);
+  if (err != CUDA_SUCCESS && isCapturing(device_id)) {
+    CUDA_ERR_STRING(err);
+    return breakCapture(device_id, "host to device copy");
+  }
   if (err != CUDA_SUCCESS) {
-    DP("Error when copying data from device to host. Pointers: host = " DPxMOD
-        ", device = " DPxMOD ", size = %" PRId64 "\n", DPxPTR(hst_ptr),
-        DPxPTR(tgt_ptr), size);
+    DP("Error when queueing data from host to device. Pointers: host = "
+       DPxMOD ", device = " DPxMOD ", size = %" PRId64 "\n", DPxPTR(hst_ptr),
+       DPxPTR(tgt_ptr), size);
     CUDA_ERR_STRING(err);
     return OFFLOAD_FAIL;
   }
   return OFFLOAD_SUCCESS;
 }
 
-int32_t __tgt_rtl_data_delete(int32_t device_id, void *tgt_ptr) {
+int32_t __tgt_rtl_synchronize(int32_t device_id) {
+  if (!DeviceInfo.Streams[device_id]) {
+    return OFFLOAD_SUCCESS;
+  }
+
   // Set the context we are using.
   CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
   if (err != CUDA_SUCCESS) {
@@ -742,19 +1404,24 @@ int32_t __tgt_rtl_data_delete(int32_t device_id, void *tgt_ptr) {
     CUDA_ERR_STRING(err);
     return OFFLOAD_FAIL;
   }
+  CUstream stream = getStream(device_id);
+  // Recorded work is ordered on the stream and does not run yet
+  if (isCapturing(device_id)) {
+    return OFFLOAD_SUCCESS;
+  }
 
-  err = cuMemFree((CUdeviceptr)tgt_ptr);
+  setPendingLaunch(device_id, false);
+  err = cuStreamSynchronize(stream);
   if (err != CUDA_SUCCESS) {
-    DP("Error when freeing CUDA memory\n");
+    DP("Error when synchronizing CUDA stream\n");
     CUDA_ERR_STRING(err);
     return OFFLOAD_FAIL;
   }
   return OFFLOAD_SUCCESS;
 }
 
-int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
-    void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
-    int32_t thread_limit, uint64_t loop_tripcount) {
+int32_t __tgt_rtl_register_host(int32_t device_id, void *hst_ptr,
+    int64_t size) {
   // Set the context we are using.
   CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
   if (err != CUDA_SUCCESS) {
@@ -763,49 +1430,325 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
     return OFFLOAD_FAIL;
   }
 
-  // All args are references.
-  std::vector<void *> args(arg_num);
-  std::vector<void *> ptrs(arg_num);
-
-  for (int32_t i = 0; i < arg_num; ++i) {
-    ptrs[i] = (void *)((intptr_t)tgt_args[i] + tgt_offsets[i]);
-    args[i] = &ptrs[i];
+  err = cuMemHostRegister(hst_ptr, size, CU_MEMHOSTREGISTER_PORTABLE);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when registering host memory " DPxMOD ", size = %" PRId64 "\n",
+       DPxPTR(hst_ptr), size);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
   }
+  DP("Registered host memory " DPxMOD ", size = %" PRId64 "\n",
+     DPxPTR(hst_ptr), size);
+  return OFFLOAD_SUCCESS;
+}
 
-  KernelTy *KernelInfo = (KernelTy *)tgt_entry_ptr;
-  DP("Load KernelInfo @%p\n", KernelInfo);
-
-  int cudaThreadsPerBlock;
+int32_t __tgt_rtl_unregister_host(int32_t device_id, void *hst_ptr) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
 
-  if (thread_limit > 0) {
-    cudaThreadsPerBlock = thread_limit;
-    DP("Setting CUDA threads per block to requested %d\n", thread_limit);
-    // Add master warp if necessary
-    if (KernelInfo->ExecutionMode == GENERIC) {
-      cudaThreadsPerBlock += DeviceInfo.WarpSize[device_id];
-      DP("Adding master warp: +%d threads\n", DeviceInfo.WarpSize[device_id]);
-    }
-  } else {
-    cudaThreadsPerBlock = DeviceInfo.NumThreads[device_id];
-    DP("Setting CUDA threads per block to default %d\n",
-        DeviceInfo.NumThreads[device_id]);
+  err = cuMemHostUnregister(hst_ptr);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when unregistering host memory " DPxMOD "\n", DPxPTR(hst_ptr));
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
   }
+  DP("Unregistered host memory " DPxMOD "\n", DPxPTR(hst_ptr));
+  return OFFLOAD_SUCCESS;
+}
 
-  if (cudaThreadsPerBlock > DeviceInfo.ThreadsPerBlock[device_id]) {
+int32_t __tgt_rtl_patch_ptrs(int32_t device_id, void **updates, int64_t n) {
+  CUfunction func = DeviceInfo.PatchPtrFuncs[device_id];
+  if (!func) {
+    return OFFLOAD_FAIL;
+  }
+  // The updates buffer is gone by the time a graph would read it
+  if (isCapturing(device_id)) {
+    return breakCapture(device_id, "pointer patching");
+  }
+
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  // Grow the scratch buffer if needed, it is reused across calls and host
+  // threads
+  std::lock_guard<std::mutex> Lock(DeviceInfo.PatchMtx);
+  size_t size = n * 2 * sizeof(void *);
+  if (DeviceInfo.PatchBufSizes[device_id] < size) {
+    if (DeviceInfo.PatchBufs[device_id]) {
+      cuMemFree(DeviceInfo.PatchBufs[device_id]);
+      DeviceInfo.PatchBufs[device_id] = 0;
+      DeviceInfo.PatchBufSizes[device_id] = 0;
+    }
+    size_t new_size = size * 2;
+    err = cuMemAlloc(&DeviceInfo.PatchBufs[device_id], new_size);
+    if (err != CUDA_SUCCESS) {
+      DP("Error when allocating pointer patch buffer\n");
+      CUDA_ERR_STRING(err);
+      return OFFLOAD_FAIL;
+    }
+    DeviceInfo.PatchBufSizes[device_id] = new_size;
+  }
+  CUdeviceptr buf = DeviceInfo.PatchBufs[device_id];
+
+  // The upload and the kernel are ordered on the same stream
+  CUstream stream = getStream(device_id);
+  err = cuMemcpyHtoDAsync(buf, updates, size, stream);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when copying pointer patch buffer to device\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  int threads = 128;
+  int64_t blocks = (n + threads - 1) / threads;
+  if (blocks > DeviceInfo.BlocksPerGrid[device_id]) {
+    // The kernel loops over the remaining updates
+    blocks = DeviceInfo.BlocksPerGrid[device_id];
+  }
+  void *args[] = {&buf, &n};
+  DP("Launch pointer patch kernel for %" PRId64 " pointers with %" PRId64
+     " blocks\n", n, blocks);
+  err = cuLaunchKernel(func, blocks, 1, 1, threads, 1, 1,
+      0 /*bytes of shared memory*/, stream, &args[0], 0);
+  if (err != CUDA_SUCCESS) {
+    DP("Pointer patch kernel launch failed\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  setPendingLaunch(device_id, false);
+  err = cuStreamSynchronize(stream);
+  if (err != CUDA_SUCCESS) {
+    DP("Pointer patch kernel execution error\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_retrieve(int32_t device_id, void *hst_ptr, void *tgt_ptr,
+    int64_t size) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  if (isCapturing(device_id)) {
+    err = cuMemcpyDtoHAsync(hst_ptr, (CUdeviceptr)tgt_ptr, size,
+                            getStream(device_id));
+    if (err != CUDA_SUCCESS) {
+      CUDA_ERR_STRING(err);
+      return breakCapture(device_id, "device to host copy");
+    }
+    return OFFLOAD_SUCCESS;
+  }
+
+  err = cuMemcpyDtoH(hst_ptr, (CUdeviceptr)tgt_ptr, size);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when copying data from device to host. Pointers: host = " DPxMOD
+        ", device = " DPxMOD ", size = %" PRId64 "\n", DPxPTR(hst_ptr),
+        DPxPTR(tgt_ptr), size);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_retrieve_async(int32_t device_id, void *hst_ptr,
+    void *tgt_ptr, int64_t size) {
+  if (!DeviceInfo.Streams[device_id]) {
+    return __tgt_rtl_data_retrieve(device_id, hst_ptr, tgt_ptr, size);
+  }
+
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  // Ordered after the kernels of the calling thread on its stream, so pending
+  // launches need no wait. Copies to pageable host memory only overlap with
+  // each other once the memory is registered, see __tgt_rtl_register_host.
+  err = cuMemcpyDtoHAsync(hst_ptr, (CUdeviceptr)tgt_ptr, size,
+                          getStream(device_id));
+  if (err != CUDA_SUCCESS && isCapturing(device_id)) {
+    CUDA_ERR_STRING(err);
+    return breakCapture(device_id, "device to host copy");
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when queueing data from device to host. Pointers: host = "
+       DPxMOD ", device = " DPxMOD ", size = %" PRId64 "\n", DPxPTR(hst_ptr),
+       DPxPTR(tgt_ptr), size);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_delete(int32_t device_id, void *tgt_ptr) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  // A graph must not refer to freed memory
+  if (isCapturing(device_id)) {
+    breakCapture(device_id, "memory release");
+  }
+
+  err = cuMemFree((CUdeviceptr)tgt_ptr);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when freeing CUDA memory\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+// Copy the constant arguments of K from the device arrays ptrs point to
+// into their symbols, on stream after the previous launch of K.ConstFunc.
+// Fails when an array is not device memory or another argument points into
+// its allocation, the kernel could write it then. On success Lock holds
+// K.ConstMtx until the launch is recorded on K.ConstDone.
+static bool uploadConstArgs(KernelTy &K, const std::vector<void *> &ptrs,
+    CUstream stream, std::unique_lock<std::mutex> &Lock) {
+  std::vector<size_t> Sizes;
+  for (const ConstArgTy &A : K.ConstArgs) {
+    if ((size_t)A.ArgIdx >= ptrs.size()) {
+      return false;
+    }
+    CUdeviceptr Ptr = (CUdeviceptr)ptrs[A.ArgIdx];
+    CUdeviceptr Start;
+    size_t Range;
+    if (cuPointerGetAttribute(&Start, CU_POINTER_ATTRIBUTE_RANGE_START_ADDR,
+            Ptr) != CUDA_SUCCESS ||
+        cuPointerGetAttribute(&Range, CU_POINTER_ATTRIBUTE_RANGE_SIZE, Ptr) !=
+            CUDA_SUCCESS) {
+      return false;
+    }
+    for (size_t i = 0; i < ptrs.size(); ++i) {
+      CUdeviceptr Other = (CUdeviceptr)ptrs[i];
+      if ((int32_t)i != A.ArgIdx && Other >= Start && Other < Start + Range) {
+        DP("Argument %zu of %s may alias constant argument %d\n", i,
+           K.KerName.c_str(), A.ArgIdx);
+        return false;
+      }
+    }
+    Sizes.push_back(std::min(A.Size, (size_t)(Start + Range - Ptr)));
+  }
+
+  Lock = std::unique_lock<std::mutex>(*K.ConstMtx);
+  if (!K.ConstDone &&
+      cuEventCreate(&K.ConstDone, CU_EVENT_DISABLE_TIMING) != CUDA_SUCCESS) {
+    K.ConstDone = nullptr;
+    Lock.unlock();
+    return false;
+  }
+  CUresult err = cuStreamWaitEvent(stream, K.ConstDone, 0);
+  for (size_t i = 0; i < Sizes.size() && err == CUDA_SUCCESS; ++i) {
+    const ConstArgTy &A = K.ConstArgs[i];
+    err = cuMemcpyDtoDAsync(A.Sym, (CUdeviceptr)ptrs[A.ArgIdx], Sizes[i],
+        stream);
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when uploading the constant arguments of %s\n",
+       K.KerName.c_str());
+    CUDA_ERR_STRING(err);
+    Lock.unlock();
+    return false;
+  }
+  return true;
+}
+
+// Launch the kernel variant of the AT mode, see getKernelVariant
+static int32_t runTargetTeamRegion(int32_t device_id, void *tgt_entry_ptr,
+    void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
+    int32_t thread_limit, uint64_t loop_tripcount, int32_t mode) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  if (checkPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  // All args are references.
+  std::vector<void *> args(arg_num);
+  std::vector<void *> ptrs(arg_num);
+
+  for (int32_t i = 0; i < arg_num; ++i) {
+    ptrs[i] = (void *)((intptr_t)tgt_args[i] + tgt_offsets[i]);
+    args[i] = &ptrs[i];
+  }
+
+  KernelTy *KernelInfo = (KernelTy *)tgt_entry_ptr;
+  DP("Load KernelInfo @%p\n", KernelInfo);
+
+  int Variant = getKernelVariant(mode);
+  CUfunction func = getKernelFunc(*KernelInfo, Variant);
+  if (!func) {
+    DP("Kernel %s has no variant %d\n", KernelInfo->KerName.c_str(), Variant);
+    return OFFLOAD_FAIL;
+  }
+  const LaunchLimitsTy &Limits = KernelInfo->Limits[Variant];
+
+  int cudaThreadsPerBlock;
+
+  if (thread_limit > 0) {
+    cudaThreadsPerBlock = thread_limit;
+    DP("Setting CUDA threads per block to requested %d\n", thread_limit);
+    // Add master warp if necessary
+    if (KernelInfo->ExecutionMode == GENERIC) {
+      cudaThreadsPerBlock += DeviceInfo.WarpSize[device_id];
+      DP("Adding master warp: +%d threads\n", DeviceInfo.WarpSize[device_id]);
+    }
+  } else if (Limits.OccThreads > 0) {
+    cudaThreadsPerBlock = Limits.OccThreads;
+    DP("Setting CUDA threads per block to occupancy based %d\n",
+        Limits.OccThreads);
+  } else {
+    cudaThreadsPerBlock = DeviceInfo.NumThreads[device_id];
+    DP("Setting CUDA threads per block to default %d\n",
+        DeviceInfo.NumThreads[device_id]);
+  }
+
+  if (cudaThreadsPerBlock > DeviceInfo.ThreadsPerBlock[device_id]) {
     cudaThreadsPerBlock = DeviceInfo.ThreadsPerBlock[device_id];
     DP("Threads per block capped at device limit %d\n",
         DeviceInfo.ThreadsPerBlock[device_id]);
   }
 
-  int kernel_limit;
-  // FIXME AT function will different??
-  err = cuFuncGetAttribute(&kernel_limit,
-      CU_FUNC_ATTRIBUTE_MAX_THREADS_PER_BLOCK, KernelInfo->Func);
-  if (err == CUDA_SUCCESS) {
-    if (kernel_limit < cudaThreadsPerBlock) {
-      cudaThreadsPerBlock = kernel_limit;
-      DP("Threads per block capped at kernel limit %d\n", kernel_limit);
-    }
+  if (Limits.MaxThreads > 0 && Limits.MaxThreads < cudaThreadsPerBlock) {
+    cudaThreadsPerBlock = Limits.MaxThreads;
+    DP("Threads per block capped at kernel limit %d\n", Limits.MaxThreads);
   }
 
   int cudaBlocksPerGrid;
@@ -835,6 +1778,11 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
       DP("Using %d teams due to loop trip count %" PRIu64 " and number of "
           "threads per block %d\n", cudaBlocksPerGrid, loop_tripcount,
           cudaThreadsPerBlock);
+    } else if (Limits.OccBlocks > 0 && DeviceInfo.EnvNumTeams < 0 &&
+               cudaThreadsPerBlock == Limits.OccThreads) {
+      cudaBlocksPerGrid =
+          std::min(Limits.OccBlocks, DeviceInfo.BlocksPerGrid[device_id]);
+      DP("Using occupancy based number of teams %d\n", cudaBlocksPerGrid);
     } else {
       cudaBlocksPerGrid = DeviceInfo.NumTeams[device_id];
       DP("Using default number of teams %d\n", DeviceInfo.NumTeams[device_id]);
@@ -848,25 +1796,114 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
     DP("Using requested number of teams %d\n", team_num);
   }
 
-  // Run on the device.
+  // Try the next candidate configuration or use the tuned one when neither
+  // the clauses nor the environment fix the launch bounds
+  TunedLaunchTy *Tune = nullptr;
+  int Candidate = -1;
+  if (!DeviceInfo.TuneFile.empty() && !DeviceInfo.Models[device_id].empty() &&
+      thread_limit <= 0 && team_num <= 0 && DeviceInfo.EnvNumTeams < 0 &&
+      !isCapturing(device_id)) {
+    int bucket = 0;
+    while (bucket < 64 && (loop_tripcount >> bucket) > 1) {
+      bucket++;
+    }
+    std::string key = DeviceInfo.Models[device_id] + "/" +
+                      KernelInfo->KerName + "/" + std::to_string(bucket);
+    std::lock_guard<std::mutex> Lock(DeviceInfo.TuneMtx);
+    Tune = &DeviceInfo.TunedLaunches[key];
+    Candidate = Tune->Best;
+    bool Trial = false;
+    while (!Trial && Tune->Next < TuneCandidates) {
+      int c = Tune->Next++;
+      // The grid follows the trip count, so only the block size is tried
+      if (loop_tripcount <= 0 || TuneGridHalves[c % TuneNumScales] == 2) {
+        Candidate = c;
+        Trial = true;
+      }
+    }
+    if (!Trial) {
+      Tune = nullptr;
+    }
+  }
+  if (Candidate >= 0) {
+    int threads = TuneThreads[Candidate / TuneNumScales];
+    threads = std::min(threads, DeviceInfo.ThreadsPerBlock[device_id]);
+    if (Limits.MaxThreads > 0) {
+      threads = std::min(threads, Limits.MaxThreads);
+    }
+    if (loop_tripcount > 0) {
+      if (KernelInfo->ExecutionMode == SPMD) {
+        // Teams beyond the grid limit are not needed, the distribute loop
+        // gives each team more iterations instead
+        uint64_t blocks = ((loop_tripcount - 1) / threads) + 1;
+        cudaBlocksPerGrid = (int)std::min<uint64_t>(
+            blocks, DeviceInfo.BlocksPerGrid[device_id]);
+      }
+    } else {
+      int64_t blocks = (int64_t)cudaBlocksPerGrid *
+                       TuneGridHalves[Candidate % TuneNumScales] / 2;
+      cudaBlocksPerGrid = std::max<int64_t>(
+          1, std::min<int64_t>(blocks, DeviceInfo.BlocksPerGrid[device_id]));
+    }
+    cudaThreadsPerBlock = threads;
+    DP("%s launch configuration %d for %s\n", Tune ? "Trying" : "Using tuned",
+       Candidate, KernelInfo->KerName.c_str());
+  }
+
+  // Run on the device, on the stream of this host thread so that regions of
+  // other threads keep running.
   DP("Launch kernel with %d blocks and %d threads\n", cudaBlocksPerGrid,
      cudaThreadsPerBlock);
+  CUstream stream = getStream(device_id);
+  CUevent TuneStart = nullptr, TuneEnd = nullptr;
+  if (Tune && (cuEventCreate(&TuneStart, CU_EVENT_DEFAULT) != CUDA_SUCCESS ||
+               cuEventCreate(&TuneEnd, CU_EVENT_DEFAULT) != CUDA_SUCCESS ||
+               cuEventRecord(TuneStart, stream) != CUDA_SUCCESS)) {
+    Tune = nullptr;
+  }
 
-  if (DeviceInfo.OffloadMode == OMP_OFFMODE_AT_TABLE) {
-    DP("Using AT Table Kernel\n");
-    err = cuLaunchKernel(*KernelInfo->Func_ATTable, cudaBlocksPerGrid, 1, 1,
-        cudaThreadsPerBlock, 1, 1, 0 /*bytes of shared memory*/, 0, &args[0], 0);
-  } else if (DeviceInfo.OffloadMode == OMP_OFFMODE_AT_MASK) {
-    DP("Using AT Mask Kernel\n");
-    err = cuLaunchKernel(*KernelInfo->Func_ATMask, cudaBlocksPerGrid, 1, 1,
-        cudaThreadsPerBlock, 1, 1, 0 /*bytes of shared memory*/, 0, &args[0], 0);
-  } else if (DeviceInfo.OffloadMode == OMP_OFFMODE_AT_OFFSET) {
-    DP("Using AT Offset Kernel\n");
-    err = cuLaunchKernel(*KernelInfo->Func_ATOffset, cudaBlocksPerGrid, 1, 1,
-        cudaThreadsPerBlock, 1, 1, 0 /*bytes of shared memory*/, 0, &args[0], 0);
-  } else {
-    err = cuLaunchKernel(KernelInfo->Func, cudaBlocksPerGrid, 1, 1,
-        cudaThreadsPerBlock, 1, 1, 0 /*bytes of shared memory*/, 0, &args[0], 0);
+  DP("Using kernel variant %d\n", Variant);
+  std::unique_lock<std::mutex> ConstLock;
+  if (func == KernelInfo->Func && KernelInfo->ConstFunc &&
+      !isCapturing(device_id) &&
+      uploadConstArgs(*KernelInfo, ptrs, stream, ConstLock)) {
+    DP("Using the constant memory copy of %s\n", KernelInfo->KerName.c_str());
+    func = KernelInfo->ConstFunc;
+  }
+  err = cuLaunchKernel(func, cudaBlocksPerGrid, 1, 1, cudaThreadsPerBlock, 1, 1,
+      0 /*bytes of shared memory*/, stream, &args[0], 0);
+  if (ConstLock.owns_lock()) {
+    cuEventRecord(KernelInfo->ConstDone, stream);
+    ConstLock.unlock();
+  }
+  if (Tune && err == CUDA_SUCCESS && cuEventRecord(TuneEnd, stream) ==
+      CUDA_SUCCESS && cuEventSynchronize(TuneEnd) == CUDA_SUCCESS) {
+    float ms;
+    if (cuEventElapsedTime(&ms, TuneStart, TuneEnd) == CUDA_SUCCESS) {
+      std::lock_guard<std::mutex> Lock(DeviceInfo.TuneMtx);
+      if (Tune->Best < 0 || ms < Tune->BestMs) {
+        Tune->Best = Candidate;
+        Tune->BestMs = ms;
+      }
+      if (Tune->Next == TuneCandidates) {
+        DeviceInfo.TuneDirty = true;
+      }
+      DP("Launch configuration %d of %s took %f ms\n", Candidate,
+         KernelInfo->KerName.c_str(), ms);
+    }
+  }
+  if (TuneStart) {
+    cuEventDestroy(TuneStart);
+  }
+  if (TuneEnd) {
+    cuEventDestroy(TuneEnd);
+  }
+  if (isCapturing(device_id)) {
+    if (err != CUDA_SUCCESS) {
+      CUDA_ERR_STRING(err);
+      breakCapture(device_id, "kernel launch");
+    }
+    return cudaBlocksPerGrid*cudaThreadsPerBlock;
   }
   if (err != CUDA_SUCCESS) {
     DP("Device kernel launch failed!\n");
@@ -878,7 +1915,14 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
   DP("Launch of entry point at " DPxMOD " successful!\n",
       DPxPTR(tgt_entry_ptr));
 
-  CUresult sync_err = cuCtxSynchronize();
+  // Later work of this thread is ordered on the stream, transfers that are
+  // not wait in waitPendingLaunches.
+  if (DeviceInfo.AsyncLaunch && stream) {
+    setPendingLaunch(device_id, true);
+    return cudaBlocksPerGrid*cudaThreadsPerBlock;
+  }
+
+  CUresult sync_err = stream ? cuStreamSynchronize(stream) : cuCtxSynchronize();
   if (sync_err != CUDA_SUCCESS) {
     DP("Kernel execution error at " DPxMOD "!\n", DPxPTR(tgt_entry_ptr));
     CUDA_ERR_STRING(sync_err);
@@ -891,6 +1935,21 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
   //return OFFLOAD_SUCCESS;
 }
 
+int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
+    void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
+    int32_t thread_limit, uint64_t loop_tripcount) {
+  return runTargetTeamRegion(device_id, tgt_entry_ptr, tgt_args, tgt_offsets,
+      arg_num, team_num, thread_limit, loop_tripcount, DeviceInfo.OffloadMode);
+}
+
+int32_t __tgt_rtl_run_target_team_region_mode(int32_t device_id,
+    void *tgt_entry_ptr, void **tgt_args, ptrdiff_t *tgt_offsets,
+    int32_t arg_num, int32_t team_num, int32_t thread_limit,
+    uint64_t loop_tripcount, int32_t mode) {
+  return runTargetTeamRegion(device_id, tgt_entry_ptr, tgt_args, tgt_offsets,
+      arg_num, team_num, thread_limit, loop_tripcount, mode);
+}
+
 int32_t __tgt_rtl_run_target_region(int32_t device_id, void *tgt_entry_ptr,
     void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num) {
   // use one team and the default number of threads.
@@ -950,9 +2009,398 @@ int32_t __tgt_rtl_set_mode(int32_t mode) {
   return OFFLOAD_SUCCESS;
 }
 
-void *__tgt_rtl_get_readonly_mem(int64_t *size) {
-  *size = (int64_t)ConstMemSize;
-  return ConstMem;
+int32_t __tgt_rtl_update_readonly_table(int32_t device_id, const char *name,
+    void *data, int64_t size) {
+  auto &Tables = DeviceInfo.ReadOnlyTables[device_id];
+  auto It = Tables.find(name);
+  if (It == Tables.end()) {
+    CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+    if (err != CUDA_SUCCESS) {
+      DP("Error when setting CUDA context\n");
+      CUDA_ERR_STRING(err);
+      return OFFLOAD_FAIL;
+    }
+    ReadOnlyTableTy Table = {0, 0, std::vector<char>()};
+    for (CUmodule cumod : DeviceInfo.DeviceModules[device_id]) {
+      if (cuModuleGetGlobal(&Table.Ptr, &Table.Size, cumod, name) ==
+          CUDA_SUCCESS) {
+        break;
+      }
+      Table.Ptr = 0;
+    }
+    if (!Table.Ptr) {
+      DP("Read-only table %s not found on device %d\n", name, device_id);
+    } else {
+      DP("Read-only table %s at " DPxMOD ", size = %zu\n", name,
+         DPxPTR(Table.Ptr), Table.Size);
+    }
+    // Missing tables are remembered as well
+    It = Tables.emplace(name, Table).first;
+  }
+
+  ReadOnlyTableTy &Table = It->second;
+  if (!Table.Ptr || (size_t)size > Table.Size) {
+    return OFFLOAD_FAIL;
+  }
+  if (Table.Data.size() == (size_t)size &&
+      !memcmp(Table.Data.data(), data, size)) {
+    return OFFLOAD_SUCCESS;
+  }
+
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+  // The cached content would no longer match the device after a replay
+  if (isCapturing(device_id)) {
+    breakCapture(device_id, "read-only table update");
+  }
+  err = cuMemcpyHtoD(Table.Ptr, data, size);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when copying read-only table %s to device\n", name);
+    CUDA_ERR_STRING(err);
+    Table.Data.clear();
+    return OFFLOAD_FAIL;
+  }
+  Table.Data.assign((char *)data, (char *)data + size);
+  return OFFLOAD_SUCCESS;
+}
+
+// Let the context of dst_id access the memory of src_id if the hardware
+// allows it. The context of dst_id must be current.
+static void enablePeerAccess(int32_t src_id, int32_t dst_id) {
+  std::lock_guard<std::mutex> Lock(DeviceInfo.PeerAccessMtx);
+  int8_t &State = DeviceInfo.PeerAccess[dst_id][src_id];
+  if (State) {
+    return;
+  }
+  State = -1;
+  CUdevice src_dev, dst_dev;
+  int can_access = 0;
+  if (cuDeviceGet(&src_dev, src_id) != CUDA_SUCCESS ||
+      cuDeviceGet(&dst_dev, dst_id) != CUDA_SUCCESS ||
+      cuDeviceCanAccessPeer(&can_access, dst_dev, src_dev) != CUDA_SUCCESS ||
+      !can_access) {
+    DP("No peer access from device %d to device %d\n", dst_id, src_id);
+    return;
+  }
+  CUresult err = cuCtxEnablePeerAccess(DeviceInfo.Contexts[src_id], 0);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when enabling peer access from device %d to device %d\n",
+       dst_id, src_id);
+    CUDA_ERR_STRING(err);
+    return;
+  }
+  DP("Enabled peer access from device %d to device %d\n", dst_id, src_id);
+  State = 1;
+}
+
+int32_t __tgt_rtl_data_exchange(int32_t src_id, void *src_ptr, int32_t dst_id,
+    void *dst_ptr, int64_t size) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[dst_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(dst_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+  // Without peer access the driver stages the copy through the host
+  enablePeerAccess(src_id, dst_id);
+
+  CUstream stream = getStream(dst_id);
+  if (!stream) {
+    err = cuMemcpyPeer((CUdeviceptr)dst_ptr, DeviceInfo.Contexts[dst_id],
+        (CUdeviceptr)src_ptr, DeviceInfo.Contexts[src_id], size);
+  } else {
+    err = cuMemcpyPeerAsync((CUdeviceptr)dst_ptr, DeviceInfo.Contexts[dst_id],
+        (CUdeviceptr)src_ptr, DeviceInfo.Contexts[src_id], size, stream);
+    if (err == CUDA_SUCCESS) {
+      err = cuStreamSynchronize(stream);
+    }
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when copying data from device %d to device %d. Pointers: "
+       "src = " DPxMOD ", dst = " DPxMOD ", size = %" PRId64 "\n", src_id,
+       dst_id, DPxPTR(src_ptr), DPxPTR(dst_ptr), size);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_copy_rect(int32_t dst_id, void *dst_ptr,
+    int64_t dst_pitch, int64_t dst_height, int32_t src_id, void *src_ptr,
+    int64_t src_pitch, int64_t src_height, int64_t width, int64_t height,
+    int64_t depth) {
+  // Kernels of the calling thread may still use either side. Wait for them
+  // with the context of the source first, so the destination one is left
+  // current for the copy.
+  int32_t ids[2] = {src_id, dst_id};
+  for (int32_t id : ids) {
+    if (id < 0) {
+      continue;
+    }
+    CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[id]);
+    if (err != CUDA_SUCCESS) {
+      DP("Error when setting CUDA context\n");
+      CUDA_ERR_STRING(err);
+      return OFFLOAD_FAIL;
+    }
+    // Let the runtime copy the rows one by one, they can be recorded
+    if (isCapturing(id)) {
+      return OFFLOAD_FAIL;
+    }
+    if (waitPendingLaunches(id) != OFFLOAD_SUCCESS) {
+      return OFFLOAD_FAIL;
+    }
+  }
+  int32_t stream_id = dst_id >= 0 ? dst_id : src_id;
+  if (src_id >= 0 && dst_id >= 0 && src_id != dst_id) {
+    enablePeerAccess(src_id, dst_id);
+  }
+
+  CUDA_MEMCPY3D_PEER copy;
+  memset(&copy, 0, sizeof(copy));
+  if (src_id < 0) {
+    copy.srcMemoryType = CU_MEMORYTYPE_HOST;
+    copy.srcHost = src_ptr;
+  } else {
+    copy.srcMemoryType = CU_MEMORYTYPE_DEVICE;
+    copy.srcDevice = (CUdeviceptr)src_ptr;
+    copy.srcContext = DeviceInfo.Contexts[src_id];
+  }
+  copy.srcPitch = src_pitch;
+  copy.srcHeight = src_height;
+  if (dst_id < 0) {
+    copy.dstMemoryType = CU_MEMORYTYPE_HOST;
+    copy.dstHost = dst_ptr;
+  } else {
+    copy.dstMemoryType = CU_MEMORYTYPE_DEVICE;
+    copy.dstDevice = (CUdeviceptr)dst_ptr;
+    copy.dstContext = DeviceInfo.Contexts[dst_id];
+  }
+  copy.dstPitch = dst_pitch;
+  copy.dstHeight = dst_height;
+  copy.WidthInBytes = width;
+  copy.Height = height;
+  copy.Depth = depth;
+
+  CUresult err;
+  CUstream stream = getStream(stream_id);
+  if (!stream) {
+    err = cuMemcpy3DPeer(&copy);
+  } else {
+    err = cuMemcpy3DPeerAsync(&copy, stream);
+    if (err == CUDA_SUCCESS) {
+      err = cuStreamSynchronize(stream);
+    }
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when copying a %" PRId64 " x %" PRId64 " x %" PRId64 " bytes "
+       "box from device %d to device %d. Pointers: src = " DPxMOD ", dst = "
+       DPxMOD "\n", depth, height, width, src_id, dst_id, DPxPTR(src_ptr),
+       DPxPTR(dst_ptr));
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_data_prefetch(int32_t device_id, void *ptr, int64_t size,
+    int32_t flags) {
+  if (!DeviceInfo.ConcurrentManaged[device_id]) {
+    return OFFLOAD_FAIL;
+  }
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  unsigned int managed = 0;
+  err = cuPointerGetAttribute(&managed, CU_POINTER_ATTRIBUTE_IS_MANAGED,
+                              (CUdeviceptr)ptr);
+  if (err != CUDA_SUCCESS || !managed) {
+    return OFFLOAD_FAIL;
+  }
+  CUdeviceptr begin = (CUdeviceptr)ptr;
+  size_t bytes = size;
+  if (!size &&
+      (cuPointerGetAttribute(&begin, CU_POINTER_ATTRIBUTE_RANGE_START_ADDR,
+                             (CUdeviceptr)ptr) != CUDA_SUCCESS ||
+       cuPointerGetAttribute(&bytes, CU_POINTER_ATTRIBUTE_RANGE_SIZE,
+                             (CUdeviceptr)ptr) != CUDA_SUCCESS)) {
+    return OFFLOAD_FAIL;
+  }
+  // Migrations are not recorded, a replayed graph would fault the pages in
+  if (isCapturing(device_id)) {
+    return breakCapture(device_id, "managed memory prefetch");
+  }
+  CUdevice cuDevice;
+  err = cuDeviceGet(&cuDevice, device_id);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when getting CUDA device with id = %d\n", device_id);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  if (flags & OMP_PREFETCH_READ_MOSTLY) {
+    err = cuMemAdvise(begin, bytes, CU_MEM_ADVISE_SET_READ_MOSTLY, cuDevice);
+    if (err != CUDA_SUCCESS) {
+      DP("Error when advising read mostly on " DPxMOD "\n", DPxPTR(begin));
+      CUDA_ERR_STRING(err);
+    }
+  }
+  bool to_host = flags & OMP_PREFETCH_TO_HOST;
+  CUstream stream = getStream(device_id);
+  DP("Prefetching %zu bytes at " DPxMOD " to the %s\n", bytes, DPxPTR(begin),
+     to_host ? "host" : "device");
+  // Kernels still running on the stream are ordered before the migration
+  err = cuMemPrefetchAsync(begin, bytes, to_host ? CU_DEVICE_CPU : cuDevice,
+                           stream);
+  if (err == CUDA_SUCCESS && to_host) {
+    if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+      return OFFLOAD_FAIL;
+    }
+    err = stream ? cuStreamSynchronize(stream) : cuCtxSynchronize();
+  }
+  if (err != CUDA_SUCCESS) {
+    DP("Error when prefetching " DPxMOD ", size = %zu\n", DPxPTR(begin),
+       bytes);
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_capture_begin(int32_t device_id) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  // Capture records all work queued on the stream, so it must be private to
+  // the calling thread
+  CUstream stream = getStream(device_id);
+  if (!stream || stream == DeviceInfo.Streams[device_id] ||
+      isCapturing(device_id)) {
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  err = cuStreamBeginCapture(stream, CU_STREAM_CAPTURE_MODE_THREAD_LOCAL);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when beginning stream capture\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if ((size_t)device_id >= CaptureStates.size()) {
+    CaptureStates.resize(device_id + 1, CAPTURE_NONE);
+  }
+  CaptureStates[device_id] = CAPTURE_ACTIVE;
+  return OFFLOAD_SUCCESS;
+}
+
+void *__tgt_rtl_capture_end(int32_t device_id) {
+  if (!isCapturing(device_id)) {
+    return NULL;
+  }
+  bool broken = CaptureStates[device_id] == CAPTURE_BROKEN;
+  CaptureStates[device_id] = CAPTURE_NONE;
+
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return NULL;
+  }
+
+  CUgraph graph;
+  err = cuStreamEndCapture(getStream(device_id), &graph);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when ending stream capture\n");
+    CUDA_ERR_STRING(err);
+    return NULL;
+  }
+  if (broken) {
+    cuGraphDestroy(graph);
+    return NULL;
+  }
+
+  CUgraphExec exec;
+  err = cuGraphInstantiate(&exec, graph, NULL, NULL, 0);
+  cuGraphDestroy(graph);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when instantiating CUDA graph\n");
+    CUDA_ERR_STRING(err);
+    return NULL;
+  }
+  DP("Captured CUDA graph " DPxMOD " on device %d\n", DPxPTR(exec),
+     device_id);
+  return exec;
+}
+
+int32_t __tgt_rtl_graph_launch(int32_t device_id, void *graph) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  if (waitPendingLaunches(device_id) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
+
+  // The graph copies results to the host, wait for them
+  CUstream stream = getStream(device_id);
+  err = cuGraphLaunch((CUgraphExec)graph, stream);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when launching CUDA graph\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  err = cuStreamSynchronize(stream);
+  if (err != CUDA_SUCCESS) {
+    DP("CUDA graph execution error\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
+int32_t __tgt_rtl_graph_destroy(int32_t device_id, void *graph) {
+  // Set the context we are using.
+  CUresult err = cuCtxSetCurrent(DeviceInfo.Contexts[device_id]);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when setting CUDA context\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+
+  err = cuGraphExecDestroy((CUgraphExec)graph);
+  if (err != CUDA_SUCCESS) {
+    DP("Error when destroying CUDA graph\n");
+    CUDA_ERR_STRING(err);
+    return OFFLOAD_FAIL;
+  }
+  return OFFLOAD_SUCCESS;
 }
 
 #ifdef __cplusplus
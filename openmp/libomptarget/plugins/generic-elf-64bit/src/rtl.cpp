@@ -19,7 +19,10 @@
 #include <gelf.h>
 #include <link.h>
 #include <list>
+#include <mutex>
 #include <string>
+#include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 #include "omptargetplugin.h"
@@ -63,6 +66,11 @@ struct FuncOrGblEntryTy {
   __tgt_target_table Table;
 };
 
+/// Entry points of the host OpenMP runtime, which runs the teams of the
+/// target regions on its thread pool.
+typedef int32_t(global_thread_num_ty)(void *);
+typedef void(push_num_teams_ty)(void *, int32_t, int32_t, int32_t);
+
 /// Class containing all the device information.
 class RTLDeviceInfoTy {
   std::vector<std::list<FuncOrGblEntryTy>> FuncGblEntries;
@@ -70,6 +78,20 @@ class RTLDeviceInfoTy {
 public:
   std::list<DynLibTy> DynLibs;
 
+  // Host memory is the device memory: mapped data is used in place and the
+  // transfers are skipped. Disabled with LIBOMPTARGET_HOST_ZERO_COPY=0.
+  bool ZeroCopy;
+  // Host pointers handed out by data_alloc, they are not freed on delete.
+  std::unordered_map<void *, int32_t> Aliased;
+  std::mutex AliasedMtx;
+
+  // Number of teams of a teams region without num_teams clause, one per
+  // processor unless LIBOMPTARGET_HOST_NUM_TEAMS is set. The host runtime
+  // would only start one team.
+  int32_t NumTeams;
+  global_thread_num_ty *GlobalThreadNum;
+  push_num_teams_ty *PushNumTeams;
+
   // Record entry point associated with device.
   void createOffloadTable(int32_t device_id, __tgt_offload_entry *begin,
                           __tgt_offload_entry *end) {
@@ -114,6 +136,20 @@ public:
 #endif // OMPTARGET_DEBUG
 
     FuncGblEntries.resize(num_devices);
+
+    ZeroCopy = true;
+    if (char *envStr = getenv("LIBOMPTARGET_HOST_ZERO_COPY")) {
+      ZeroCopy = std::stoi(envStr) != 0;
+    }
+    NumTeams = sysconf(_SC_NPROCESSORS_ONLN);
+    if (char *envStr = getenv("LIBOMPTARGET_HOST_NUM_TEAMS")) {
+      NumTeams = std::stoi(envStr);
+    }
+    *((void **)&GlobalThreadNum) =
+        dlsym(RTLD_DEFAULT, "__kmpc_global_thread_num");
+    *((void **)&PushNumTeams) = dlsym(RTLD_DEFAULT, "__kmpc_push_num_teams");
+    DP("Zero-copy mapping %s, %d teams by default\n",
+       ZeroCopy ? "enabled" : "disabled", NumTeams);
   }
 
   ~RTLDeviceInfoTy() {
@@ -272,32 +308,46 @@ __tgt_target_table *__tgt_rtl_load_binary(int32_t device_id,
 }
 
 void *__tgt_rtl_data_alloc(int32_t device_id, int64_t size, void *hst_ptr) {
+  if (hst_ptr && DeviceInfo.ZeroCopy) {
+    std::lock_guard<std::mutex> Lock(DeviceInfo.AliasedMtx);
+    DeviceInfo.Aliased[hst_ptr]++;
+    return hst_ptr;
+  }
   void *ptr = malloc(size);
   return ptr;
 }
 
 int32_t __tgt_rtl_data_submit(int32_t device_id, void *tgt_ptr, void *hst_ptr,
                               int64_t size) {
-  memcpy(tgt_ptr, hst_ptr, size);
+  if (tgt_ptr != hst_ptr)
+    memcpy(tgt_ptr, hst_ptr, size);
   return OFFLOAD_SUCCESS;
 }
 
 int32_t __tgt_rtl_data_retrieve(int32_t device_id, void *hst_ptr, void *tgt_ptr,
                                 int64_t size) {
-  memcpy(hst_ptr, tgt_ptr, size);
+  if (hst_ptr != tgt_ptr)
+    memcpy(hst_ptr, tgt_ptr, size);
   return OFFLOAD_SUCCESS;
 }
 
 int32_t __tgt_rtl_data_delete(int32_t device_id, void *tgt_ptr) {
+  if (DeviceInfo.ZeroCopy) {
+    std::lock_guard<std::mutex> Lock(DeviceInfo.AliasedMtx);
+    auto It = DeviceInfo.Aliased.find(tgt_ptr);
+    if (It != DeviceInfo.Aliased.end()) {
+      if (--It->second == 0)
+        DeviceInfo.Aliased.erase(It);
+      return OFFLOAD_SUCCESS;
+    }
+  }
   free(tgt_ptr);
   return OFFLOAD_SUCCESS;
 }
 
-int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
-    void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
-    int32_t thread_limit, uint64_t loop_tripcount /*not used*/) {
-  // ignore team num and thread limit.
-
+// Call the entry point on the calling thread.
+static int32_t runEntry(void *tgt_entry_ptr, void **tgt_args,
+                        ptrdiff_t *tgt_offsets, int32_t arg_num) {
   // Use libffi to launch execution.
   ffi_cif cif;
 
@@ -327,11 +377,31 @@ int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
   return OFFLOAD_SUCCESS;
 }
 
+int32_t __tgt_rtl_run_target_team_region(int32_t device_id, void *tgt_entry_ptr,
+    void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num, int32_t team_num,
+    int32_t thread_limit, uint64_t loop_tripcount /*not used*/) {
+  // The entry forks the teams with the host runtime, which takes the number
+  // of teams pushed last on this thread. Clauses of the region push their
+  // own values in the entry and override these ones.
+  if (DeviceInfo.GlobalThreadNum && DeviceInfo.PushNumTeams) {
+    if (team_num <= 0)
+      team_num = DeviceInfo.NumTeams;
+    if (thread_limit < 0)
+      thread_limit = 0;
+    if (team_num > 0) {
+      DP("Running teams region with %d teams, thread limit %d\n", team_num,
+         thread_limit);
+      DeviceInfo.PushNumTeams(NULL, DeviceInfo.GlobalThreadNum(NULL), team_num,
+                              thread_limit);
+    }
+  }
+  return runEntry(tgt_entry_ptr, tgt_args, tgt_offsets, arg_num);
+}
+
 int32_t __tgt_rtl_run_target_region(int32_t device_id, void *tgt_entry_ptr,
     void **tgt_args, ptrdiff_t *tgt_offsets, int32_t arg_num) {
-  // use one team and one thread.
-  return __tgt_rtl_run_target_team_region(device_id, tgt_entry_ptr, tgt_args,
-      tgt_offsets, arg_num, 1, 1, 0);
+  // Parallel regions in the entry use the threads of the host runtime.
+  return runEntry(tgt_entry_ptr, tgt_args, tgt_offsets, arg_num);
 }
 
 #ifdef __cplusplus
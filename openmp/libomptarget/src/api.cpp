@@ -84,6 +84,9 @@ EXTERN void omp_target_free(void *device_ptr, int device_num) {
   }
 
   DeviceTy &Device = Devices[device_num];
+  if (Device.IsReplicateEnabled) {
+    SegmentReplicas.freed(Device, (uintptr_t)device_ptr);
+  }
   Device.RTL->data_delete(Device.RTLDeviceID, (void *)device_ptr);
   DP("omp_target_free deallocated device ptr\n");
 }
@@ -160,18 +163,62 @@ EXTERN int omp_target_memcpy(void *dst, void *src, size_t length,
     rc = SrcDev.data_retrieve(dstAddr, srcAddr, length);
   } else {
     DP("copy from device to device\n");
-    void *buffer = malloc(length);
     DeviceTy& SrcDev = Devices[src_device];
     DeviceTy& DstDev = Devices[dst_device];
-    rc = SrcDev.data_retrieve(buffer, srcAddr, length);
-    if (rc == OFFLOAD_SUCCESS)
-      rc = DstDev.data_submit(dstAddr, buffer, length);
+    rc = DstDev.data_exchange(SrcDev, srcAddr, dstAddr, length);
+    if (rc != OFFLOAD_SUCCESS) {
+      DP("no direct copy between the devices, going through the host\n");
+      void *buffer = malloc(length);
+      if (!buffer) {
+        DP("omp_target_memcpy returns OFFLOAD_FAIL\n");
+        return OFFLOAD_FAIL;
+      }
+      rc = SrcDev.data_retrieve(buffer, srcAddr, length);
+      if (rc == OFFLOAD_SUCCESS)
+        rc = DstDev.data_submit(dstAddr, buffer, length);
+      free(buffer);
+    }
   }
 
   DP("omp_target_memcpy returns %d\n", rc);
   return rc;
 }
 
+// Copy the innermost two or three dimensions of a rectangular region as one
+// strided transfer of the plugin instead of one transfer per row.
+static int memcpy_rect_strided(void *dst, void *src, size_t element_size,
+    int num_dims, const size_t *volume, const size_t *dst_offsets,
+    const size_t *src_offsets, const size_t *dst_dimensions,
+    const size_t *src_dimensions, int dst_device, int src_device) {
+  DeviceTy *DstDev = NULL, *SrcDev = NULL;
+  if (dst_device != omp_get_initial_device()) {
+    if (!device_is_ready(dst_device))
+      return OFFLOAD_FAIL;
+    DstDev = &Devices[dst_device];
+  }
+  if (src_device != omp_get_initial_device()) {
+    if (!device_is_ready(src_device))
+      return OFFLOAD_FAIL;
+    SrcDev = &Devices[src_device];
+  }
+  if (!DstDev && !SrcDev)
+    return OFFLOAD_FAIL;
+
+  size_t dst_off = 0, src_off = 0;
+  for (int i = 0; i < num_dims; ++i) {
+    dst_off = dst_off * dst_dimensions[i] + dst_offsets[i];
+    src_off = src_off * src_dimensions[i] + src_offsets[i];
+  }
+  int last = num_dims - 1;
+  DeviceTy &Dev = DstDev ? *DstDev : *SrcDev;
+  return Dev.data_copy_rect(DstDev, (char *)dst + dst_off * element_size,
+      dst_dimensions[last] * element_size, dst_dimensions[last - 1], SrcDev,
+      (char *)src + src_off * element_size,
+      src_dimensions[last] * element_size, src_dimensions[last - 1],
+      volume[last] * element_size, volume[last - 1],
+      num_dims == 3 ? volume[0] : 1);
+}
+
 EXTERN int omp_target_memcpy_rect(void *dst, void *src, size_t element_size,
     int num_dims, const size_t *volume, const size_t *dst_offsets,
     const size_t *src_offsets, const size_t *dst_dimensions,
@@ -201,6 +248,11 @@ EXTERN int omp_target_memcpy_rect(void *dst, void *src, size_t element_size,
     rc = omp_target_memcpy(dst, src, element_size * volume[0],
         element_size * dst_offsets[0], element_size * src_offsets[0],
         dst_device, src_device);
+  } else if (num_dims <= 3 &&
+      memcpy_rect_strided(dst, src, element_size, num_dims, volume,
+          dst_offsets, src_offsets, dst_dimensions, src_dimensions,
+          dst_device, src_device) == OFFLOAD_SUCCESS) {
+    rc = OFFLOAD_SUCCESS;
   } else {
     size_t dst_slice_size = element_size;
     size_t src_slice_size = element_size;
@@ -1,7 +1,5 @@
 #include "at.h"
 
-AddressTranslateTy AT;
-
 
 // Tmp function before kernel rewriter
 void *AddressTranslate::passArg(void *addr, int64_t size) {
@@ -25,6 +25,4 @@ typedef struct AddressTranslate {
   void addTableSize(int64_t table_size);
 } AddressTranslateTy;
 
-extern AddressTranslateTy AT;
-
 #endif
@@ -0,0 +1,224 @@
+// Coalescing of deep copy transfers
+#include <algorithm>
+#include <cstring>
+
+#include "device.h"
+#include "private.h"
+#include "perf.h"
+
+void TransferBatchTy::addRegion(void *TgtPtrBegin, void *HstPtrBegin,
+    int64_t Size, bool IsNew) {
+  if (!Size) {
+    return;
+  }
+  Regions.push_back({(uintptr_t)HstPtrBegin, (uintptr_t)TgtPtrBegin, Size,
+      IsNew});
+}
+
+void TransferBatchTy::addPointer(void *TgtPtrAddr, void *TgtPtrVal) {
+  // HstPtrBegin keeps the insertion order, the later update wins
+  Pointers.push_back({(uintptr_t)PtrVals.size(), (uintptr_t)TgtPtrAddr,
+      sizeof(void *), false});
+  PtrVals.push_back(TgtPtrVal);
+}
+
+int32_t TransferBatchTy::flush(DeviceTy &Device) {
+  int32_t ret;
+  // Regions, merged by host address
+  std::sort(Regions.begin(), Regions.end(),
+      [](const PendingTransferTy &a, const PendingTransferTy &b) {
+        return a.HstPtrBegin < b.HstPtrBegin;
+      });
+  size_t i = 0;
+  while (i < Regions.size()) {
+    PendingTransferTy cur = Regions[i];
+    uintptr_t HstPtrEnd = cur.HstPtrBegin + cur.Size;
+    size_t j = i + 1;
+    for (; j < Regions.size(); j++) {
+      PendingTransferTy &next = Regions[j];
+      // Displacement on target must be the same as on host
+      if (next.TgtPtrBegin - cur.TgtPtrBegin !=
+          next.HstPtrBegin - cur.HstPtrBegin) {
+        break;
+      }
+      uintptr_t NextEnd = next.HstPtrBegin + next.Size;
+      if (next.HstPtrBegin > HstPtrEnd) {
+        // Pad the gap only inside a single new mapping
+        if ((int64_t)(next.HstPtrBegin - HstPtrEnd) > GapThreshold ||
+            !cur.IsNew || !next.IsNew) {
+          break;
+        }
+        Device.DataMapMtx.lock_shared();
+        LookupResult lr = Device.lookupMapping((void *)cur.HstPtrBegin,
+            std::max(NextEnd, HstPtrEnd) - cur.HstPtrBegin);
+        Device.DataMapMtx.unlock_shared();
+        if (!lr.Flags.IsContained) {
+          break;
+        }
+      }
+      HstPtrEnd = std::max(NextEnd, HstPtrEnd);
+    }
+    int64_t Size = HstPtrEnd - cur.HstPtrBegin;
+    DP2("Coalesced %zu regions to [" DPxMOD ":" DPxMOD "]\n", j - i,
+        DPxPTR(cur.HstPtrBegin), DPxPTR(HstPtrEnd));
+    PERF_WRAP(Perf.Coalesce.add(j - i);)
+    ret = Device.data_submit_async((void *)cur.TgtPtrBegin,
+        (void *)cur.HstPtrBegin, Size);
+    if (ret != OFFLOAD_SUCCESS) {
+      return ret;
+    }
+    i = j;
+  }
+  Regions.clear();
+
+  // Pointer updates, merged by target address through the staging buffer
+  std::stable_sort(Pointers.begin(), Pointers.end(),
+      [](const PendingTransferTy &a, const PendingTransferTy &b) {
+        return a.TgtPtrBegin < b.TgtPtrBegin;
+      });
+  i = 0;
+  while (i < Pointers.size()) {
+    Staging.clear();
+    uintptr_t TgtPtrBegin = Pointers[i].TgtPtrBegin;
+    uintptr_t TgtPtrEnd = TgtPtrBegin;
+    size_t j = i;
+    for (; j < Pointers.size(); j++) {
+      PendingTransferTy &p = Pointers[j];
+      void *val = PtrVals[p.HstPtrBegin];
+      if (p.TgtPtrBegin == TgtPtrEnd - sizeof(void *) && j != i) {
+        // Same slot updated again
+        memcpy(&Staging[Staging.size() - sizeof(void *)], &val,
+            sizeof(void *));
+        continue;
+      }
+      if (p.TgtPtrBegin != TgtPtrEnd) {
+        break;
+      }
+      Staging.insert(Staging.end(), (char *)&val,
+          (char *)&val + sizeof(void *));
+      TgtPtrEnd += sizeof(void *);
+    }
+    DP2("Coalesced %zu pointer updates to " DPxMOD "\n", j - i,
+        DPxPTR(TgtPtrBegin));
+    PERF_WRAP(Perf.Coalesce.add(j - i);)
+    // Staging is reused for the next run, the RTL copies it before returning
+    ret = Device.data_submit_async((void *)TgtPtrBegin, &Staging[0],
+        Staging.size());
+    if (ret != OFFLOAD_SUCCESS) {
+      return ret;
+    }
+    i = j;
+  }
+  Pointers.clear();
+  PtrVals.clear();
+  return OFFLOAD_SUCCESS;
+}
+
+void RetrieveBatchTy::addRegion(void *TgtPtrBegin, void *HstPtrBegin,
+    int64_t Size) {
+  if (!Size) {
+    return;
+  }
+  Regions.push_back({(uintptr_t)HstPtrBegin, (uintptr_t)TgtPtrBegin, Size,
+      false});
+}
+
+void RetrieveBatchTy::addRestore(void *HstPtrBegin, int64_t Size,
+    bool Restore, bool Erase) {
+  Restores.push_back({(uintptr_t)HstPtrBegin, (uintptr_t)HstPtrBegin + Size,
+      Restore, Erase});
+}
+
+void RetrieveBatchTy::addDelete(void *HstPtrBegin, int64_t Size,
+    bool ForceDelete) {
+  Deletes.push_back({HstPtrBegin, Size, ForceDelete});
+  uintptr_t &End = DeleteRanges[(uintptr_t)HstPtrBegin];
+  End = std::max(End, (uintptr_t)HstPtrBegin + Size);
+}
+
+bool RetrieveBatchTy::isDeleting(void *HstPtrBegin, int64_t Size) const {
+  uintptr_t Begin = (uintptr_t)HstPtrBegin;
+  auto it = DeleteRanges.upper_bound(Begin);
+  if (it != DeleteRanges.end() && it->first < Begin + Size) {
+    return true;
+  }
+  return it != DeleteRanges.begin() && (--it)->second > Begin;
+}
+
+int32_t RetrieveBatchTy::flush(DeviceTy &Device) {
+  int32_t ret;
+  std::sort(Regions.begin(), Regions.end(),
+      [](const PendingTransferTy &a, const PendingTransferTy &b) {
+        return a.HstPtrBegin < b.HstPtrBegin;
+      });
+  size_t i = 0;
+  while (i < Regions.size()) {
+    PendingTransferTy cur = Regions[i];
+    uintptr_t HstPtrEnd = cur.HstPtrBegin + cur.Size;
+    size_t j = i + 1;
+    for (; j < Regions.size(); j++) {
+      PendingTransferTy &next = Regions[j];
+      if (next.HstPtrBegin > HstPtrEnd ||
+          next.TgtPtrBegin - cur.TgtPtrBegin !=
+          next.HstPtrBegin - cur.HstPtrBegin) {
+        break;
+      }
+      HstPtrEnd = std::max(next.HstPtrBegin + next.Size, HstPtrEnd);
+    }
+    int64_t Size = HstPtrEnd - cur.HstPtrBegin;
+    DP2("Coalesced %zu retrievals to [" DPxMOD ":" DPxMOD "]\n", j - i,
+        DPxPTR(cur.HstPtrBegin), DPxPTR(HstPtrEnd));
+    PERF_WRAP(Perf.Coalesce.add(j - i);)
+    ret = Device.data_retrieve_async((void *)cur.HstPtrBegin,
+        (void *)cur.TgtPtrBegin, Size);
+    if (ret != OFFLOAD_SUCCESS) {
+      DP("Copying data from device failed.\n");
+      return ret;
+    }
+    i = j;
+  }
+  Regions.clear();
+  ret = Device.synchronize();
+  if (ret != OFFLOAD_SUCCESS) {
+    return ret;
+  }
+
+  // Collect the shadow pointers under one lock, then restore them in a
+  // plain loop
+  Device.ShadowMtx.lock();
+  for (PendingRestoreTy &R : Restores) {
+    // The map is sorted from high to low addresses
+    for (auto it = Device.ShadowPtrMap.upper_bound((void *)R.End);
+         it != Device.ShadowPtrMap.end() &&
+         (uintptr_t)it->first >= R.Begin;) {
+      if (R.Restore) {
+        ShadowAddrs.push_back((void **)it->first);
+        ShadowVals.push_back(it->second.HstPtrVal);
+      }
+      if (R.Erase) {
+        it = Device.ShadowPtrMap.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  Device.ShadowMtx.unlock();
+  Restores.clear();
+  DP("Restoring %zu original host pointer values\n", ShadowAddrs.size());
+  for (size_t k = 0; k < ShadowAddrs.size(); k++) {
+    *ShadowAddrs[k] = ShadowVals[k];
+  }
+  ShadowAddrs.clear();
+  ShadowVals.clear();
+
+  for (PendingDeleteTy &D : Deletes) {
+    ret = Device.deallocTgtPtr(D.HstPtrBegin, D.Size, D.ForceDelete);
+    if (ret != OFFLOAD_SUCCESS) {
+      DP("Deallocating data from device failed.\n");
+      return ret;
+    }
+  }
+  Deletes.clear();
+  DeleteRanges.clear();
+  return OFFLOAD_SUCCESS;
+}
@@ -15,7 +15,9 @@
 #include "rtl.h"
 
 #include "perf.h"
+#include "tool.h"
 
+#include <algorithm>
 #include <cassert>
 #include <climits>
 #include <string>
@@ -70,6 +72,7 @@ int DeviceTy::associatePtr(void *HstPtrBegin, void *TgtPtrBegin, int64_t Size) {
       DPxPTR(newEntry.HstPtrBegin), DPxPTR(newEntry.HstPtrEnd),
       DPxPTR(newEntry.TgtPtrBegin));
   HostDataToTargetMap.emplace(std::move(newEntry));
+  MapGeneration++;
 
   DataMapMtx.unlock();
 
@@ -90,6 +93,7 @@ int DeviceTy::disassociatePtr(void *HstPtrBegin) {
       if (CONSIDERED_INF(ii->RefCount)) {
         DP("Association found, removing it\n");
         HostDataToTargetMap.erase(ii);
+        MapGeneration++;
         DataMapMtx.unlock();
         return OFFLOAD_SUCCESS;
       } else {
@@ -110,7 +114,7 @@ long DeviceTy::getMapEntryRefCnt(void *HstPtrBegin) {
   uintptr_t hp = (uintptr_t)HstPtrBegin;
   long RefCnt = -1;
 
-  DataMapMtx.lock();
+  DataMapMtx.lock_shared();
 
   auto it = HostDataToTargetMap.lower_bound(HstPtrBegin);
   if (it != HostDataToTargetMap.end()) {
@@ -121,7 +125,7 @@ long DeviceTy::getMapEntryRefCnt(void *HstPtrBegin) {
     }
   }
 
-  DataMapMtx.unlock();
+  DataMapMtx.unlock_shared();
 
   if (RefCnt < 0) {
     DP("DeviceTy::getMapEntry: requested entry not found\n");
@@ -184,6 +188,22 @@ LookupResult DeviceTy::lookupMapping(void *HstPtrBegin, int64_t Size) {
 
 
 
+// Return the target address of HstPtrBegin inside the existing mapping HT,
+// taking a new reference if requested. HT.RefCount is atomic, so the caller
+// only needs to hold DataMapMtx in shared mode.
+static void *reuseMapping(const HostDataToTargetTy &HT, void *HstPtrBegin,
+    int64_t Size, bool IsImplicit, bool UpdateRefCount) {
+  long RefCount = UpdateRefCount ? ++HT.RefCount : HT.RefCount.load();
+
+  uintptr_t tp = HT.TgtPtrBegin + ((uintptr_t)HstPtrBegin - HT.HstPtrBegin);
+  DP("Mapping exists%s with HstPtrBegin=" DPxMOD ", TgtPtrBegin=" DPxMOD ", "
+      "Size=%ld,%s RefCount=%s\n", (IsImplicit ? " (implicit)" : ""),
+      DPxPTR(HstPtrBegin), DPxPTR(tp), Size,
+      (UpdateRefCount ? " updated" : ""),
+      (CONSIDERED_INF(RefCount)) ? "INF" : std::to_string(RefCount).c_str());
+  return (void *)tp;
+}
+
 // Used by target_data_begin
 // Return the target pointer begin (where the data will be moved).
 // Allocate memory if this is the first occurrence of this mapping.
@@ -191,29 +211,33 @@ LookupResult DeviceTy::lookupMapping(void *HstPtrBegin, int64_t Size) {
 // If NULL is returned, then either data allocation failed or the user tried
 // to do an illegal mapping.
 void *DeviceTy::getOrAllocTgtPtr(void *HstPtrBegin, void *HstPtrBase,
-    int64_t Size, bool &IsNew, bool IsImplicit, bool UpdateRefCount) {
+    int64_t Size, bool &IsNew, bool IsImplicit, bool UpdateRefCount,
+    int CompactLevel) {
   void *rc = NULL;
-  mm_context_t *context = NULL;
-  DataMapMtx.lock();
-  LookupResult lr = lookupMapping(HstPtrBegin, Size);
 
-  // Check if the pointer is contained.
+  // Most calls hit an existing mapping, which does not change the map itself.
+  DataMapMtx.lock_shared();
+  LookupResult lr = lookupMapping(HstPtrBegin, Size);
   if (lr.Flags.IsContained ||
       ((lr.Flags.ExtendsBefore || lr.Flags.ExtendsAfter) && IsImplicit)) {
-    auto &HT = *lr.Entry;
     IsNew = false;
+    rc = reuseMapping(*lr.Entry, HstPtrBegin, Size, IsImplicit,
+        UpdateRefCount);
+    DataMapMtx.unlock_shared();
+    return rc;
+  }
+  DataMapMtx.unlock_shared();
 
-    if (UpdateRefCount)
-      ++HT.RefCount;
+  // Look up again, another thread may have mapped it in between.
+  DataMapMtx.lock();
+  lr = lookupMapping(HstPtrBegin, Size);
 
-    uintptr_t tp = HT.TgtPtrBegin + ((uintptr_t)HstPtrBegin - HT.HstPtrBegin);
-    DP("Mapping exists%s with HstPtrBegin=" DPxMOD ", TgtPtrBegin=" DPxMOD ", "
-        "Size=%ld,%s RefCount=%s\n", (IsImplicit ? " (implicit)" : ""),
-        DPxPTR(HstPtrBegin), DPxPTR(tp), Size,
-        (UpdateRefCount ? " updated" : ""),
-        (CONSIDERED_INF(HT.RefCount)) ? "INF" :
-            std::to_string(HT.RefCount).c_str());
-    rc = (void *)tp;
+  // Check if the pointer is contained.
+  if (lr.Flags.IsContained ||
+      ((lr.Flags.ExtendsBefore || lr.Flags.ExtendsAfter) && IsImplicit)) {
+    IsNew = false;
+    rc = reuseMapping(*lr.Entry, HstPtrBegin, Size, IsImplicit,
+        UpdateRefCount);
   } else if ((lr.Flags.ExtendsBefore || lr.Flags.ExtendsAfter) && !IsImplicit) {
     // Explicit extension of mapped data - not allowed.
     DP("Explicit extension of mapping is not allowed.\n");
@@ -224,18 +248,26 @@ void *DeviceTy::getOrAllocTgtPtr(void *HstPtrBegin, void *HstPtrBase,
     if (IsBulkEnabled) {
       // return value is meaningless
       tp = (uintptr_t)HstPtrBegin;
-      int32_t ret = bulk_data_alloc(HstPtrBegin, Size);
+      int32_t ret = CompactLevel >= 0
+          ? bulk_compact_alloc(HstPtrBegin, Size, CompactLevel)
+          : bulk_data_alloc(HstPtrBegin, Size);
       if (ret) {
         tp = 0;
       }
     } else {
+      tgt_tool_record_t ToolOp;
+      TOOL_WRAP(Tool.beginDataOp(ToolOp, tgt_tool_target_data_alloc,
+          HstPtrBegin, HOST_DEVICE, NULL, DeviceID, Size);)
       tp = (uintptr_t)RTL->data_alloc(RTLDeviceID, Size, HstPtrBegin);
+      TOOL_WRAP(ToolOp.record.data_op.dest_addr = (void *)tp;
+                Tool.end(ToolOp);)
     }
     DP("Creating new map entry: HstBase=" DPxMOD ", HstBegin=" DPxMOD ", "
         "HstEnd=" DPxMOD ", TgtBegin=" DPxMOD "\n", DPxPTR(HstPtrBase),
         DPxPTR(HstPtrBegin), DPxPTR((uintptr_t)HstPtrBegin + Size), DPxPTR(tp));
     HostDataToTargetMap.emplace((uintptr_t)HstPtrBase, (uintptr_t)HstPtrBegin,
         (uintptr_t)HstPtrBegin + Size, tp);
+    MapGeneration++;
     rc = (void *)tp;
   }
   DataMapMtx.unlock();
@@ -248,27 +280,31 @@ void *DeviceTy::getOrAllocTgtPtr(void *HstPtrBegin, void *HstPtrBase,
 void *DeviceTy::getTgtPtrBegin(void *HstPtrBegin, int64_t Size, bool &IsLast,
     bool UpdateRefCount) {
   void *rc = NULL;
-  DataMapMtx.lock();
+  // The count never drops to zero here, so the entry cannot go away and the
+  // map is only read.
+  DataMapMtx.lock_shared();
   LookupResult lr = lookupMapping(HstPtrBegin, Size);
 
   if (lr.Flags.IsContained || lr.Flags.ExtendsBefore || lr.Flags.ExtendsAfter) {
     auto &HT = *lr.Entry;
-    IsLast = !(HT.RefCount > 1);
-
-    if (HT.RefCount > 1 && UpdateRefCount)
-      --HT.RefCount;
+    long RefCount = HT.RefCount.load();
+    do {
+      IsLast = !(RefCount > 1);
+    } while (!IsLast && UpdateRefCount &&
+             !HT.RefCount.compare_exchange_weak(RefCount, RefCount - 1));
+    if (!IsLast && UpdateRefCount)
+      --RefCount;
 
     uintptr_t tp = HT.TgtPtrBegin + ((uintptr_t)HstPtrBegin - HT.HstPtrBegin);
     DP("Mapping exists with HstPtrBegin=" DPxMOD ", TgtPtrBegin=" DPxMOD ", "
         "Size=%ld,%s RefCount=%s\n", DPxPTR(HstPtrBegin), DPxPTR(tp), Size,
         (UpdateRefCount ? " updated" : ""),
-        (CONSIDERED_INF(HT.RefCount)) ? "INF" :
-            std::to_string(HT.RefCount).c_str());
+        (CONSIDERED_INF(RefCount)) ? "INF" : std::to_string(RefCount).c_str());
     rc = (void *)tp;
   } else {
     IsLast = false;
   }
-  DataMapMtx.unlock();
+  DataMapMtx.unlock_shared();
 
   if (rc == NULL) {
     if (IsUVMEnabled) {
@@ -310,12 +346,20 @@ int DeviceTy::deallocTgtPtr(void *HstPtrBegin, int64_t Size, bool ForceDelete) {
       DP("Deleting tgt data " DPxMOD " of size %ld\n",
           DPxPTR(HT.TgtPtrBegin), Size);
       if (!IsBulkEnabled && !_MYMALLOC_ISMYSPACE(HstPtrBegin)) {
+        if (IsReplicateEnabled) {
+          SegmentReplicas.freed(*this, HT.TgtPtrBegin);
+        }
+        tgt_tool_record_t ToolOp;
+        TOOL_WRAP(Tool.beginDataOp(ToolOp, tgt_tool_target_data_delete,
+            (void *)HT.TgtPtrBegin, DeviceID, NULL, HOST_DEVICE, Size);)
         RTL->data_delete(RTLDeviceID, (void *)HT.TgtPtrBegin);
+        TOOL_WRAP(Tool.end(ToolOp);)
       }
       DP("Removing%s mapping with HstPtrBegin=" DPxMOD ", TgtPtrBegin=" DPxMOD
           ", Size=%ld\n", (ForceDelete ? " (forced)" : ""),
           DPxPTR(HT.HstPtrBegin), DPxPTR(HT.TgtPtrBegin), Size);
       HostDataToTargetMap.erase(lr.Entry);
+      MapGeneration++;
     }
     rc = OFFLOAD_SUCCESS;
   } else {
@@ -346,6 +390,18 @@ void DeviceTy::init() {
     IsNoBulkEnabled = false;
     IsDCEnabled = false;
     IsUVMEnabled = false;
+    IsUVMPrefetchEnabled = false;
+    UVMPrefetchFlags = 0;
+    IsAsyncEnabled = false;
+    IsCoalesceEnabled = false;
+    CoalesceGap = 0;
+    IsPatchPtrEnabled = false;
+    IsReplicateEnabled = false;
+    DCThreads = 1;
+    IsDCDedupEnabled = false;
+    IsDCSnapshotEnabled = false;
+    IsDCCompactEnabled = false;
+    DCCompactBySize = false;
     ATMode = OMP_OFFMODE_NORMAL;
     EnabledOpt.append(" Offloading");
     if (getenv("OMP_UVM")) {
@@ -383,11 +439,12 @@ void DeviceTy::init() {
         DP2("SET OMP_OFFMODE_AT_TABLE\n");
       }
     }
-    /*
-    if (getenv("OMP_BULK") || getenv("OMP_AT")) {
+    // The AT modes translate the pointers bulk transfers update
+    if (getenv("OMP_BULK") && ATMode == OMP_OFFMODE_NORMAL) {
       EnabledOpt.append(" BulkTransfer");
       IsBulkEnabled = true;
     }
+    /*
     if (getenv("OMP_NOBULK")) {
       EnabledOpt.append(" NoBulkTransfer");
       IsNoBulkEnabled = true;
@@ -406,10 +463,91 @@ skip:
     if (IsDCEnabled) {
       EnabledOpt.append(" DeepCopy");
     }
+    if (IsUVMEnabled && getenv("OMP_UVM_PREFETCH") && RTL->data_prefetch) {
+      EnabledOpt.append(" UVMPrefetch");
+      IsUVMPrefetchEnabled = true;
+      if (getenv("OMP_UVM_READ_MOSTLY")) {
+        // Regions only read by the kernels keep a copy on the host too
+        UVMPrefetchFlags |= OMP_PREFETCH_READ_MOSTLY;
+      }
+    }
+    if (getenv("OMP_ASYNC") && RTL->data_submit_async && RTL->synchronize) {
+      EnabledOpt.append(" AsyncTransfer");
+      IsAsyncEnabled = true;
+    }
+    if (char *envStr = getenv("OMP_DC_THREADS")) {
+      // Value is the number of host threads, the caller included
+      if (IsDCEnabled && atoi(envStr) > 1) {
+        EnabledOpt.append(" ParallelDeepCopy");
+        DCThreads = atoi(envStr);
+      }
+    }
+    if (IsDCEnabled && getenv("OMP_DC_DEDUP")) {
+      EnabledOpt.append(" DeepCopyDedup");
+      IsDCDedupEnabled = true;
+    }
+    if (IsDCEnabled && getenv("OMP_DC_SNAPSHOT")) {
+      EnabledOpt.append(" DeepCopySnapshot");
+      IsDCSnapshotEnabled = true;
+    }
+    if (char *envStr = getenv("OMP_DC_COMPACT")) {
+      // Value "size" groups the nodes by size, i.e. by type, before level
+      if (IsBulkEnabled) {
+        EnabledOpt.append(" DeepCopyCompact");
+        IsDCCompactEnabled = true;
+        DCCompactBySize = !strcmp(envStr, "size");
+      }
+    }
+    if (char *envStr = getenv("OMP_COALESCE")) {
+      // Value is the max gap in bytes padded between two regions
+      EnabledOpt.append(" CoalesceTransfer");
+      IsCoalesceEnabled = true;
+      CoalesceGap = atol(envStr);
+    }
+    if (getenv("OMP_DEVPOOL")) {
+      EnabledOpt.append(" DevicePool");
+      Pool.Enabled = true;
+      if (char *envStr = getenv("OMP_DEVPOOL_ARENA")) {
+        // Value is the arena chunk size in bytes
+        Pool.ArenaSize = atol(envStr);
+      }
+    }
+    if (getenv("OMP_PATCH_PTR") && RTL->patch_ptrs) {
+      EnabledOpt.append(" BatchPtrPatch");
+      IsPatchPtrEnabled = true;
+    }
+    if (getenv("OMP_BULK_REPLICATE") && RTL->data_exchange) {
+      EnabledOpt.append(" SegmentReplication");
+      IsReplicateEnabled = true;
+    }
+    if (getenv("OMP_TARGET_GRAPH") && RTL->capture_begin &&
+        RTL->capture_end && RTL->graph_launch && RTL->graph_destroy) {
+      EnabledOpt.append(" TargetGraph");
+      Graphs.Enabled = true;
+    }
+    if (char *envStr = getenv("OMP_AT_AUTO")) {
+      // Value is the number of timed launches per mode and region. The
+      // candidates are launched through run_team_region_mode.
+      if (ATMode != OMP_OFFMODE_NORMAL && RTL->run_team_region_mode) {
+        EnabledOpt.append(" AutoATMode");
+        ModeSel.init(ATMode, atoi(envStr));
+      }
+    }
+    if (char *envStr = getenv("PERF_TRACE")) {
+      Perf.init();
+      Perf.Trace.init(envStr);
+      EnabledOpt.append(" OmpTracing");
+    }
     if (getenv("PERF")) {
       Perf.init();
       EnabledOpt.append(" OmpProfiling");
     }
+    if (char *envStr = getenv("PERF_JSON")) {
+      Perf.init();
+      Perf.JsonPath = envStr;
+      EnabledOpt.append(" OmpProfilingJson");
+      Perf.Modes = EnabledOpt;
+    }
     fprintf(stdout, "[omp-dc]%s Enabled\n", EnabledOpt.c_str());
     IsInit = true;
   }
@@ -442,26 +580,151 @@ __tgt_target_table *DeviceTy::load_binary(void *Img) {
 // Submit data to device.
 int32_t DeviceTy::data_submit(void *TgtPtrBegin, void *HstPtrBegin,
     int64_t Size) {
+  if (IsReplicateEnabled) {
+    SegmentReplicas.written(*this, (uintptr_t)TgtPtrBegin, Size);
+  }
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginDataOp(ToolOp, tgt_tool_target_data_transfer_to_device,
+      HstPtrBegin, HOST_DEVICE, TgtPtrBegin, DeviceID, Size);)
   PERF_WRAP(Perf.H2DTransfer.start();)
   int32_t ret = RTL->data_submit(RTLDeviceID, TgtPtrBegin, HstPtrBegin, Size);
-  PERF_WRAP(Perf.H2DTransfer.end();)
+  PERF_WRAP(Perf.H2DTransfer.end(Size);)
+  TOOL_WRAP(Tool.end(ToolOp);)
+  return ret;
+}
+
+int32_t DeviceTy::data_exchange(DeviceTy &SrcDevice, void *SrcPtrBegin,
+    void *TgtPtrBegin, int64_t Size) {
+  if (SrcDevice.RTL != RTL || !RTL->data_exchange) {
+    return OFFLOAD_FAIL;
+  }
+  if (IsReplicateEnabled) {
+    SegmentReplicas.written(*this, (uintptr_t)TgtPtrBegin, Size);
+  }
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginDataOp(ToolOp, tgt_tool_target_data_transfer_to_device,
+      SrcPtrBegin, SrcDevice.DeviceID, TgtPtrBegin, DeviceID, Size);)
+  PERF_WRAP(Perf.D2DTransfer.start();)
+  int32_t ret = RTL->data_exchange(SrcDevice.RTLDeviceID, SrcPtrBegin,
+      RTLDeviceID, TgtPtrBegin, Size);
+  PERF_WRAP(Perf.D2DTransfer.end(Size);)
+  TOOL_WRAP(Tool.end(ToolOp);)
+  return ret;
+}
+
+int32_t DeviceTy::data_copy_rect(DeviceTy *DstDevice, void *DstPtr,
+    int64_t DstPitch, int64_t DstHeight, DeviceTy *SrcDevice, void *SrcPtr,
+    int64_t SrcPitch, int64_t SrcHeight, int64_t Width, int64_t Height,
+    int64_t Depth) {
+  if (!RTL->data_copy_rect || (SrcDevice && SrcDevice->RTL != RTL) ||
+      (DstDevice && DstDevice->RTL != RTL)) {
+    return OFFLOAD_FAIL;
+  }
+  if (DstDevice && DstDevice->IsReplicateEnabled) {
+    SegmentReplicas.written(*DstDevice, (uintptr_t)DstPtr,
+                            DstPitch * DstHeight * Depth);
+  }
+  int32_t SrcID = SrcDevice ? SrcDevice->RTLDeviceID : -1;
+  int32_t DstID = DstDevice ? DstDevice->RTLDeviceID : -1;
+  PERF_WRAP((!SrcDevice ? Perf.H2DTransfer : !DstDevice ? Perf.D2HTransfer
+      : Perf.D2DTransfer).start();)
+  int32_t ret = RTL->data_copy_rect(DstID, DstPtr, DstPitch, DstHeight, SrcID,
+      SrcPtr, SrcPitch, SrcHeight, Width, Height, Depth);
+  PERF_WRAP((!SrcDevice ? Perf.H2DTransfer : !DstDevice ? Perf.D2HTransfer
+      : Perf.D2DTransfer).end(Width * Height * Depth);)
+  return ret;
+}
+
+int32_t DeviceTy::uvm_prefetch(void *HstPtr, int64_t Size, int32_t Flags) {
+  if (!HstPtr || !xfer().UVMPrefetched.insert(HstPtr).second) {
+    return OFFLOAD_SUCCESS;
+  }
+  // Read mostly is only a hint of the caller, it is applied when asked for
+  Flags &= UVMPrefetchFlags | OMP_PREFETCH_TO_HOST;
+  PERF_WRAP(Perf.UVMPrefetch.start();)
+  int32_t ret = RTL->data_prefetch(RTLDeviceID, HstPtr, Size, Flags);
+  PERF_WRAP(Perf.UVMPrefetch.end();)
+  if (ret == OFFLOAD_SUCCESS) {
+    DP2("[UVM] Prefetched " DPxMOD "\n", DPxPTR(HstPtr));
+  }
+  return ret;
+}
+
+// Queue data to device, the copy is done once synchronize() returns.
+int32_t DeviceTy::data_submit_async(void *TgtPtrBegin, void *HstPtrBegin,
+    int64_t Size) {
+  TransferStateTy &Xfer = xfer();
+  if (!IsAsyncEnabled) {
+    return data_submit(TgtPtrBegin, HstPtrBegin, Size);
+  }
+  if (IsReplicateEnabled) {
+    SegmentReplicas.written(*this, (uintptr_t)TgtPtrBegin, Size);
+  }
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginDataOp(ToolOp, tgt_tool_target_data_transfer_to_device,
+      HstPtrBegin, HOST_DEVICE, TgtPtrBegin, DeviceID, Size);)
+  PERF_WRAP(Perf.H2DTransfer.start();)
+  int32_t ret = RTL->data_submit_async(RTLDeviceID, TgtPtrBegin, HstPtrBegin,
+      Size);
+  PERF_WRAP(Perf.H2DTransfer.end(Size);)
+  TOOL_WRAP(Tool.end(ToolOp);)
+  Xfer.HasPendingAsync = true;
+  return ret;
+}
+
+// Wait for all queued transfers of this device.
+int32_t DeviceTy::synchronize() {
+  TransferStateTy &Xfer = xfer();
+  if (!Xfer.HasPendingAsync) {
+    return OFFLOAD_SUCCESS;
+  }
+  PERF_WRAP(Perf.H2DSync.start();)
+  int32_t ret = RTL->synchronize(RTLDeviceID);
+  PERF_WRAP(Perf.H2DSync.end();)
+  Xfer.HasPendingAsync = false;
+  return ret;
+}
+
+// Queue data from device, the copy is done once synchronize() returns.
+int32_t DeviceTy::data_retrieve_async(void *HstPtrBegin, void *TgtPtrBegin,
+    int64_t Size) {
+  TransferStateTy &Xfer = xfer();
+  if (!IsAsyncEnabled || !RTL->data_retrieve_async) {
+    return data_retrieve(HstPtrBegin, TgtPtrBegin, Size);
+  }
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginDataOp(ToolOp,
+      tgt_tool_target_data_transfer_from_device, TgtPtrBegin, DeviceID,
+      HstPtrBegin, HOST_DEVICE, Size);)
+  PERF_WRAP(Perf.D2HTransfer.start();)
+  int32_t ret = RTL->data_retrieve_async(RTLDeviceID, HstPtrBegin,
+      TgtPtrBegin, Size);
+  PERF_WRAP(Perf.D2HTransfer.end(Size);)
+  TOOL_WRAP(Tool.end(ToolOp);)
+  Xfer.HasPendingAsync = true;
   return ret;
 }
 
 // Retrieve data from device.
 int32_t DeviceTy::data_retrieve(void *HstPtrBegin, void *TgtPtrBegin,
     int64_t Size) {
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginDataOp(ToolOp,
+      tgt_tool_target_data_transfer_from_device, TgtPtrBegin, DeviceID,
+      HstPtrBegin, HOST_DEVICE, Size);)
   PERF_WRAP(Perf.D2HTransfer.start();)
   int32_t ret =  RTL->data_retrieve(RTLDeviceID, HstPtrBegin, TgtPtrBegin, Size);
-  PERF_WRAP(Perf.D2HTransfer.end();)
+  PERF_WRAP(Perf.D2HTransfer.end(Size);)
+  TOOL_WRAP(Tool.end(ToolOp);)
   return ret;
 }
 
 // Add pointer update to suspend list.
 int32_t DeviceTy::suspend_update(void *HstPtrBaseAddr, void *HstPtrValue, uint64_t Delta, void *HstPtrBase) {
+  TransferStateTy &Xfer = xfer();
 
   // Check redundant and if duplicated
-  /*for (auto i: UpdatePtrList) {
+  /*for (auto i: Xfer.UpdatePtrList) {
     uintptr_t OldPtrVal = (uintptr_t) i.PtrValue - i.Delta;
     uintptr_t NewPtrVal = (uintptr_t) HstPtrValue - Delta;
     if (i.PtrBaseAddr == HstPtrBaseAddr) {
@@ -475,21 +738,24 @@ int32_t DeviceTy::suspend_update(void *HstPtrBaseAddr, void *HstPtrValue, uint64
   DP2("Suspend update pointer (" DPxMOD ") -> [" DPxMOD "]\n",
       DPxPTR(HstPtrBaseAddr), DPxPTR(HstPtrValue));
   UpdatePtrTy upl = {HstPtrBaseAddr, HstPtrValue, Delta, HstPtrBase};
-  UpdatePtrList.push(upl);
+  Xfer.UpdatePtrList.push(upl);
   return OFFLOAD_SUCCESS;
 }
 
 // Update the suspend ptr update list
 int32_t DeviceTy::update_suspend_list() {
+  TransferStateTy &Xfer = xfer();
   int32_t ret;
 
   list<HostDataToTargetListTy::iterator> HostShadows;
+  // (target address, value) pairs for the batched patch
+  std::vector<void *> Patches;
 
   int i = 0;
   // FIXME incorrect update pointer method
-  while (!UpdatePtrList.empty()) {
+  while (!Xfer.UpdatePtrList.empty()) {
     PERF_WRAP(Perf.UpdatePtr.start();)
-    struct UpdatePtrTy &upt = UpdatePtrList.front();
+    struct UpdatePtrTy &upt = Xfer.UpdatePtrList.front();
     void *TgtPtrBaseAddr, *TgtPtrValue, *TgtPtrValueBegin;
     TgtPtrBaseAddr = bulkGetTgtPtrBegin(upt.PtrBaseAddr,sizeof(void*));
     TgtPtrValueBegin = bulkGetTgtPtrBegin(upt.PtrValue,sizeof(void*));
@@ -497,10 +763,15 @@ int32_t DeviceTy::update_suspend_list() {
 //#ifndef HOST_SHADOW_PTR
     if (!OptHostShadow) {
       DP2("Update target pointer:" DPxMOD " to val:" DPxMOD "\n", DPxPTR(TgtPtrBaseAddr), DPxPTR(TgtPtrValue));
-      ret = data_submit(TgtPtrBaseAddr,  &TgtPtrValue, sizeof(void*));
-      if (ret) {
-        DP2("Update_suspend_list failed\n");
-        //return ret;
+      if (IsPatchPtrEnabled) {
+        Patches.push_back(TgtPtrBaseAddr);
+        Patches.push_back(TgtPtrValue);
+      } else {
+        ret = data_submit(TgtPtrBaseAddr,  &TgtPtrValue, sizeof(void*));
+        if (ret) {
+          DP2("Update_suspend_list failed\n");
+          //return ret;
+        }
       }
     } else {
       // find PtrBaseAddr
@@ -533,11 +804,34 @@ int32_t DeviceTy::update_suspend_list() {
     ShadowPtrMap[upt.PtrBaseAddr] = {upt.HstPtrBase, TgtPtrBaseAddr,TgtPtrValue};
     ShadowMtx.unlock();
 
-    UpdatePtrList.pop();
+    Xfer.UpdatePtrList.pop();
     ++i;
     PERF_WRAP(Perf.UpdatePtr.end();)
   }
 
+  if (!Patches.empty()) {
+    // Upload all pairs at once and scatter them on the device
+    int64_t N = Patches.size() / 2;
+    if (IsReplicateEnabled) {
+      for (int64_t j = 0; j < N; j++) {
+        SegmentReplicas.written(*this, (uintptr_t)Patches[2*j],
+                                sizeof(void*));
+      }
+    }
+    PERF_WRAP(Perf.PatchPtr.start();)
+    ret = RTL->patch_ptrs(RTLDeviceID, &Patches[0], N);
+    PERF_WRAP(Perf.PatchPtr.end();)
+    if (ret != OFFLOAD_SUCCESS) {
+      DP2("Batched pointer patch failed, update %ld pointers one by one\n", N);
+      for (int64_t j = 0; j < N; j++) {
+        ret = data_submit(Patches[2*j], &Patches[2*j+1], sizeof(void*));
+        if (ret) {
+          DP2("Update_suspend_list failed\n");
+        }
+      }
+    }
+  }
+
   if (OptHostShadow) {
     // Transfer pointer bulks
     while (!HostShadows.empty()) {
@@ -559,10 +853,11 @@ int32_t DeviceTy::update_suspend_list() {
 }
 
 int32_t DeviceTy::dump_segmentlist() {
+  std::lock_guard<std::mutex> Lock(SegmentMtx);
   DP2("--- Dump SegmentList -----------\n");
-  DP2("|\tSize :%lu\n", SegmentList.size());
-  auto it = SegmentList.begin();
-  while (it != SegmentList.end()) {
+  DP2("|\tSize :%lu\n", Segments.size());
+  auto it = Segments.begin();
+  while (it != Segments.end()) {
     DP2("|%s\n", it->second.getString().c_str());
     it++;
   }
@@ -572,8 +867,8 @@ int32_t DeviceTy::dump_segmentlist() {
 
 int32_t DeviceTy::dump_map() {
   DP2("--- Dump HostDataToTargetMap -----------\n");
-  for (auto entry: HostDataToTargetMap) {
-    DP2("|[" DPxMOD "-" DPxMOD "],Ref: %ld]\n", DPxPTR(entry.HstPtrBegin), DPxPTR(entry.HstPtrEnd),entry.RefCount);
+  for (auto &entry: HostDataToTargetMap) {
+    DP2("|[" DPxMOD "-" DPxMOD "],Ref: %ld]\n", DPxPTR(entry.HstPtrBegin), DPxPTR(entry.HstPtrEnd),entry.RefCount.load());
   }
   DP2("-------------------------------\n");
   return 0;
@@ -583,57 +878,130 @@ int32_t DeviceTy::dump_map() {
 
 // Run region on device
 int32_t DeviceTy::run_region(void *TgtEntryPtr, void **TgtVarsPtr,
-    ptrdiff_t *TgtOffsets, int32_t TgtVarsSize) {
+    ptrdiff_t *TgtOffsets, int32_t TgtVarsSize, OpenMPOffloadingMode Mode) {
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginSubmit(ToolOp, DeviceID, 1);)
   PERF_WRAP(Perf.Kernel.start();)
-  int32_t ret = RTL->run_region(RTLDeviceID, TgtEntryPtr, TgtVarsPtr, TgtOffsets,
-      TgtVarsSize);
+  int32_t ret;
+  if (Mode != OMP_OFFMODE_NORMAL && Mode != ATMode) {
+    // One team with the default number of threads, as run_region does
+    ret = RTL->run_team_region_mode(RTLDeviceID, TgtEntryPtr, TgtVarsPtr,
+        TgtOffsets, TgtVarsSize, 1, 0, 0, Mode);
+  } else {
+    ret = RTL->run_region(RTLDeviceID, TgtEntryPtr, TgtVarsPtr, TgtOffsets,
+        TgtVarsSize);
+  }
   PERF_WRAP(Perf.Kernel.end();)
+  TOOL_WRAP(Tool.end(ToolOp);)
   return ret;
 }
 
 // Run team region on device.
 int32_t DeviceTy::run_team_region(void *TgtEntryPtr, void **TgtVarsPtr,
     ptrdiff_t *TgtOffsets, int32_t TgtVarsSize, int32_t NumTeams,
-    int32_t ThreadLimit, uint64_t LoopTripCount) {
+    int32_t ThreadLimit, uint64_t LoopTripCount, OpenMPOffloadingMode Mode) {
+  tgt_tool_record_t ToolOp;
+  TOOL_WRAP(Tool.beginSubmit(ToolOp, DeviceID, NumTeams);)
   PERF_WRAP(Perf.Kernel.start();)
-  int32_t ret = RTL->run_team_region(RTLDeviceID, TgtEntryPtr, TgtVarsPtr, TgtOffsets,
-      TgtVarsSize, NumTeams, ThreadLimit, LoopTripCount);
+  int32_t ret;
+  if (Mode != OMP_OFFMODE_NORMAL && Mode != ATMode) {
+    ret = RTL->run_team_region_mode(RTLDeviceID, TgtEntryPtr, TgtVarsPtr,
+        TgtOffsets, TgtVarsSize, NumTeams, ThreadLimit, LoopTripCount, Mode);
+  } else {
+    ret = RTL->run_team_region(RTLDeviceID, TgtEntryPtr, TgtVarsPtr,
+        TgtOffsets, TgtVarsSize, NumTeams, ThreadLimit, LoopTripCount);
+  }
   PERF_WRAP(Perf.Kernel.end();)
+  TOOL_WRAP(Tool.end(ToolOp);)
   return ret;
 }
 
 // bulk transfer depends on Transfer type
+// Allocates and copies every segment no thread has placed yet, including
+// those added by data regions of other threads that this region may use.
+// A segment is claimed under SegmentMtx, placed without it, then published.
 int32_t DeviceTy::bulk_transfer() {
-  auto it = SegmentList.begin();
-
-  while (it != SegmentList.end()) {
-    size_t size = it->second.HstPtrEnd - it->second.HstPtrBegin;
-    if (!it->second.TgtPtrBegin) {
-      DP2("Alloc and copy segment " DPxMOD "\n", DPxPTR(it->second.HstPtrBegin));
-      void *TgtPtrBegin = RTL->data_alloc(RTLDeviceID, size, NULL);
-      if (!TgtPtrBegin) {
-        DP("Failed to alloc data\n");
-        return OFFLOAD_FAIL;
+  int32_t rc = bulk_compact_place();
+  std::unique_lock<std::mutex> Lock(SegmentMtx);
+  // Segments other threads are placing at the moment
+  std::vector<uintptr_t> Placing;
+  auto it = Segments.begin();
+
+  while (it != Segments.end()) {
+    if (it->second.TgtPtrBegin) {
+      it++;
+      continue;
+    }
+    if (ClaimedSegments.count(it->first)) {
+      Placing.push_back(it->first);
+      it++;
+      continue;
+    }
+    // Claimed segments are neither merged nor erased, so it stays valid
+    ClaimedSegments.insert(it->first);
+    SegmentTy Seg = it->second;
+    Lock.unlock();
+
+    size_t size = Seg.HstPtrEnd - Seg.HstPtrBegin;
+    DP2("Alloc and copy segment " DPxMOD "\n", DPxPTR(Seg.HstPtrBegin));
+    void *TgtPtrBegin = Pool.alloc(*this, size);
+    if (TgtPtrBegin) {
+      PERF_WRAP(Perf.BulkSegment.add(size);)
+      SegmentReplicasTy::ReplicaTy R;
+      if (IsReplicateEnabled &&
+          SegmentReplicas.find(*this, Seg.HstPtrBegin, Seg.HstPtrEnd, R) &&
+          data_exchange(Devices[R.DeviceID], (void *)R.TgtPtrBegin,
+                        TgtPtrBegin, size) == OFFLOAD_SUCCESS) {
+        DP2("Copied segment from device %d\n", R.DeviceID);
+      } else {
+        data_submit(TgtPtrBegin, (void *)Seg.HstPtrBegin, size);
+      }
+      if (IsReplicateEnabled) {
+        SegmentReplicas.add(*this, Seg.HstPtrBegin, Seg.HstPtrEnd,
+                            (uintptr_t)TgtPtrBegin);
       }
-      it->second.TgtPtrBegin = (intptr_t)TgtPtrBegin;
-      data_submit(TgtPtrBegin,(void*)it->second.HstPtrBegin,size);
     }
+
+    Lock.lock();
+    ClaimedSegments.erase(it->first);
+    SegmentCV.notify_all();
+    if (!TgtPtrBegin) {
+      DP("Failed to alloc data\n");
+      rc = OFFLOAD_FAIL;
+      break;
+    }
+    it->second.TgtPtrBegin = (uintptr_t)TgtPtrBegin;
+    Segments.invalidate();
     it++;
   }
+  // Kernels of this region may read them, wait until they are published
+  SegmentCV.wait(Lock, [&]() {
+    for (uintptr_t Begin : Placing) {
+      if (ClaimedSegments.count(Begin)) {
+        return false;
+      }
+    }
+    return true;
+  });
   DP2("Bulk Transfered\n");
-  return OFFLOAD_SUCCESS;
+  return rc;
 }
 
 int32_t DeviceTy::bulk_map_from( void *HstPtrBegin, size_t Size) {
   void *TgtPtrBegin = bulkGetTgtPtrBegin(HstPtrBegin, Size);
   if (TgtPtrBegin) {
+    // The device may have written it, other copies are stale
+    if (IsReplicateEnabled) {
+      SegmentReplicas.drop((uintptr_t)HstPtrBegin,
+                           (uintptr_t)HstPtrBegin + Size);
+    }
     data_retrieve(HstPtrBegin, TgtPtrBegin, Size);
     return OFFLOAD_SUCCESS;
   }
   return OFFLOAD_FAIL;
 }
 
-// TODO multithreading support??
+// Segments are shared by the host threads, see DeviceTy::Segments
 // suspend the copy
 int32_t DeviceTy::bulk_data_submit(void *HstPtrBegin, int64_t Size) {
   // TODO Raise error if paritally overlapped with mapped segment
@@ -641,52 +1009,276 @@ int32_t DeviceTy::bulk_data_submit(void *HstPtrBegin, int64_t Size) {
   // Direct copy if the segment has been mapped
   if (TgtPtrBegin) {
     DP2("Direct submit %d -> %p\n", *(int*)HstPtrBegin, TgtPtrBegin);
-    data_submit(TgtPtrBegin, HstPtrBegin, Size);
+    // Drops the replicas of the segment, see SegmentReplicasTy::written.
+    // Waited for at the end of bulk_target_data_begin
+    data_submit_async(TgtPtrBegin, HstPtrBegin, Size);
   }
   return OFFLOAD_SUCCESS;
 }
 
+// Build the AT table of this thread from the shared segments and upload it
+// to the table memory of the thread, which kernels of other threads never
+// read.
 void DeviceTy::table_transfer() {
+  TransferStateTy &Xfer = xfer();
+  std::unique_lock<std::mutex> Lock(SegmentMtx);
   // TODO Remove bias
   /*// Compute bias
   for (auto &i : table) {
     i.bias = (intptr_t)i.TgtPtrBegin - (intptr_t)i.HstPtrBegin;
   }*/
-  // TODO Only copy useful page
   // TODO Using Small vector
-  auto &table = SegmentList.TgtList;
+  // No segment changed since the last upload
+  if (Xfer.SegmentList.TgtMemPtr &&
+      Xfer.SegmentList.UploadedGen == Xfer.SegmentList.Generation &&
+      Xfer.SegmentsGen == Segments.Generation) {
+    DP2("AT table unchanged, skip transfer\n");
+    return;
+  }
+  auto &table = Xfer.SegmentList.TgtList;
   table.clear();
 
   // First segment stores the size
   table.push_back(SegmentTy());
-  for (auto &it : SegmentList) {
+  for (auto &it : Segments) {
     table.push_back(it.second);
   }
   table[0].HstPtrBegin = table.size() - 1;
+  Xfer.SegmentsGen = Segments.Generation;
+  Xfer.SegmentList.invalidate();
+  Lock.unlock();
 
+  upload_table();
+  PERF_WRAP(Perf.ATTableSize.add(table.size());)
+  DP2("Transfered AT table\n");
+}
+
+// Upload SegmentList.TgtList to TgtMemPtr. Only runs of entries differing
+// from the previous upload are sent.
+int32_t DeviceTy::upload_table() {
+  TransferStateTy &Xfer = xfer();
+  auto &table = Xfer.SegmentList.TgtList;
+  auto &old = Xfer.SegmentList.Uploaded;
   int table_size = table.size() * sizeof(SegmentTy);
 
   // Size is bigger than before
-  if (SegmentList.TgtMemSize < table_size) {
+  if (!Xfer.SegmentList.TgtMemPtr ||
+      Xfer.SegmentList.TgtMemSize < table_size) {
     int NewSize = table_size + 4 * sizeof(SegmentTy);
-    if (SegmentList.TgtMemPtr) {
-      RTL->data_delete(RTLDeviceID, SegmentList.TgtMemPtr);
+    if (Xfer.SegmentList.TgtMemPtr) {
+      Pool.release(*this, Xfer.SegmentList.TgtMemPtr);
+    }
+    Xfer.SegmentList.TgtMemPtr = Pool.alloc(*this, NewSize);
+    Xfer.SegmentList.TgtMemSize = NewSize;
+    old.clear();
+    if (!Xfer.SegmentList.TgtMemPtr) {
+      Xfer.SegmentList.TgtMemSize = 0;
+      return OFFLOAD_FAIL;
     }
-    SegmentList.TgtMemPtr = RTL->data_alloc(RTLDeviceID, NewSize, NULL);
-    SegmentList.TgtMemSize = NewSize;
   }
-  data_submit(SegmentList.TgtMemPtr, &table[0],table_size);
-  PERF_WRAP(Perf.ATTableSize.add(table.size());)
-  DP2("Transfered AT table\n");
+
+  // Equal entries shorter than this inside a run are sent along
+  const size_t MaxCleanGap = 4;
+  auto isDirty = [&](size_t i) {
+    return i >= old.size() || memcmp(&table[i], &old[i], sizeof(SegmentTy));
+  };
+  size_t n = table.size();
+  size_t sent = 0;
+  size_t i = 0;
+  while (i < n) {
+    if (!isDirty(i)) {
+      i++;
+      continue;
+    }
+    size_t last = i;
+    for (size_t j = i + 1; j < n && j - last <= MaxCleanGap; j++) {
+      if (isDirty(j)) {
+        last = j;
+      }
+    }
+    size_t cnt = last - i + 1;
+    int32_t ret = data_submit((char *)Xfer.SegmentList.TgtMemPtr +
+        i * sizeof(SegmentTy), &table[i], cnt * sizeof(SegmentTy));
+    if (ret != OFFLOAD_SUCCESS) {
+      old.clear();
+      return ret;
+    }
+    sent += cnt;
+    i = last + 1;
+  }
+  DP2("AT table upload %zu of %zu entries\n", sent, n);
+  old = table;
+  Xfer.SegmentList.UploadedGen = Xfer.SegmentList.Generation;
+  return OFFLOAD_SUCCESS;
+}
+
+// Transfer state of the calling thread on this device, created on first use
+TransferStateTy &DeviceTy::xfer() {
+  static thread_local std::vector<TransferStateTy *> States;
+  if ((size_t)DeviceID >= States.size()) {
+    States.resize(DeviceID + 1, NULL);
+  }
+  TransferStateTy *&State = States[DeviceID];
+  if (!State) {
+    std::lock_guard<std::mutex> Lock(TransferStatesMtx);
+    TransferStates.emplace_back();
+    State = &TransferStates.back();
+  }
+  return *State;
+}
+
+// Upload the AT offset list. Kernels built with constant memory offsets
+// (AddrTransOffset2) read the copy in the ConstMem table, the others read
+// OffsetListPtr, which is passed as the last kernel argument.
+int32_t DeviceTy::upload_offset_list(const std::vector<intptr_t> &List) {
+  TransferStateTy &Xfer = xfer();
+  int64_t Size = List.size() * sizeof(intptr_t);
+  // The RTL skips the copy if unchanged. Sync the name with the AT device
+  // library.
+  if (!RTL->update_readonly_table || RTL->update_readonly_table(RTLDeviceID,
+        "ConstMem", (void *)List.data(), Size) != OFFLOAD_SUCCESS) {
+    DP("No constant memory offset list on device %d\n", DeviceID);
+  }
+  if (Xfer.OffsetListPtr && List == Xfer.OffsetList) {
+    return OFFLOAD_SUCCESS;
+  }
+  if (!Xfer.OffsetListPtr || Xfer.OffsetListCap < (size_t)Size) {
+    if (Xfer.OffsetListPtr) {
+      Pool.release(*this, Xfer.OffsetListPtr);
+    }
+    Xfer.OffsetListPtr = Pool.alloc(*this, Size);
+    Xfer.OffsetListCap = Xfer.OffsetListPtr ? Size : 0;
+    if (!Xfer.OffsetListPtr) {
+      Xfer.OffsetList.clear();
+      return OFFLOAD_FAIL;
+    }
+  }
+  int32_t ret = data_submit(Xfer.OffsetListPtr, (void *)List.data(), Size);
+  if (ret != OFFLOAD_SUCCESS) {
+    Xfer.OffsetList.clear();
+    return ret;
+  }
+  Xfer.OffsetList = List;
+  return OFFLOAD_SUCCESS;
+}
+
+// Queue a deep copy node of this thread, placed by bulk_compact_place
+int32_t DeviceTy::bulk_compact_alloc(void *HstPtrBegin, size_t Size,
+    int Level) {
+  if (!Size) {
+    return OFFLOAD_FAIL;
+  }
+  xfer().CompactNodes.push_back({(uintptr_t)HstPtrBegin, Size, Level});
+  return OFFLOAD_SUCCESS;
+}
+
+// Place the queued deep copy nodes of this thread in one allocation with
+// one copy, the nodes of a level next to each other. Nodes overlapping a
+// segment, including nodes placed before them, are left to bulk_data_alloc.
+// The placed segments are claimed until published, see bulk_transfer.
+int32_t DeviceTy::bulk_compact_place() {
+  std::vector<CompactNodeTy> Nodes;
+  Nodes.swap(xfer().CompactNodes);
+  if (Nodes.empty()) {
+    return OFFLOAD_SUCCESS;
+  }
+  std::stable_sort(Nodes.begin(), Nodes.end(),
+      [](const CompactNodeTy &A, const CompactNodeTy &B) {
+        return A.Level < B.Level;
+      });
+  // Nodes of one size are mostly of one type
+  if (DCCompactBySize) {
+    std::stable_sort(Nodes.begin(), Nodes.end(),
+        [](const CompactNodeTy &A, const CompactNodeTy &B) {
+          return A.Size < B.Size;
+        });
+  }
+
+  std::vector<CompactNodeTy> Placed, Overlapped;
+  std::vector<size_t> Offsets;
+  size_t Total = 0;
+  std::unique_lock<std::mutex> Lock(SegmentMtx);
+  for (auto &N : Nodes) {
+    uintptr_t HstPtrEnd = N.HstPtrBegin + N.Size;
+    // Segments are in descending order, lower_bound is the one at or below
+    auto it = Segments.lower_bound(N.HstPtrBegin);
+    if ((it != Segments.end() && it->second.HstPtrEnd > N.HstPtrBegin) ||
+        (it != Segments.begin() && std::prev(it)->first < HstPtrEnd)) {
+      Overlapped.push_back(N);
+      continue;
+    }
+    size_t Offset = (Total + 15) & ~(size_t)15;
+    Offsets.push_back(Offset);
+    Placed.push_back(N);
+    Total = Offset + N.Size;
+    Segments[N.HstPtrBegin] = {N.HstPtrBegin, HstPtrEnd, 0};
+    ClaimedSegments.insert(N.HstPtrBegin);
+  }
+  Segments.invalidate();
+  Lock.unlock();
+
+  char *TgtPtrBegin = NULL;
+  if (Total) {
+    DP2("Alloc and copy %zu deep copy nodes, %zu bytes\n", Placed.size(),
+        Total);
+    TgtPtrBegin = (char *)Pool.alloc(*this, Total);
+  }
+  if (TgtPtrBegin) {
+    PERF_WRAP(Perf.BulkSegment.add(Total);)
+    std::vector<char> Staging(Total);
+    for (size_t i = 0; i < Placed.size(); i++) {
+      memcpy(&Staging[Offsets[i]], (void *)Placed[i].HstPtrBegin,
+             Placed[i].Size);
+    }
+    data_submit(TgtPtrBegin, Staging.data(), Total);
+    if (IsReplicateEnabled) {
+      for (size_t i = 0; i < Placed.size(); i++) {
+        SegmentReplicas.add(*this, Placed[i].HstPtrBegin,
+                            Placed[i].HstPtrBegin + Placed[i].Size,
+                            (uintptr_t)TgtPtrBegin + Offsets[i]);
+      }
+    }
+  }
+
+  int32_t rc = OFFLOAD_SUCCESS;
+  Lock.lock();
+  for (size_t i = 0; i < Placed.size(); i++) {
+    ClaimedSegments.erase(Placed[i].HstPtrBegin);
+    if (TgtPtrBegin) {
+      Segments[Placed[i].HstPtrBegin].TgtPtrBegin =
+          (uintptr_t)TgtPtrBegin + Offsets[i];
+    } else {
+      Segments.erase(Placed[i].HstPtrBegin);
+    }
+  }
+  Segments.invalidate();
+  SegmentCV.notify_all();
+  Lock.unlock();
+  if (Total && !TgtPtrBegin) {
+    DP("Failed to alloc data\n");
+    rc = OFFLOAD_FAIL;
+  }
+
+  for (auto &N : Overlapped) {
+    if (bulk_data_alloc((void *)N.HstPtrBegin, N.Size) != OFFLOAD_SUCCESS) {
+      rc = OFFLOAD_FAIL;
+    }
+  }
+  return rc;
 }
 
 // Add segment, alloc later
 // Transfer right new if overlapped
 // suspend if segment found and wait for bulk transfer
+// Segments claimed by bulk_transfer are treated as allocated.
 int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
   if (!Size) {
     return OFFLOAD_FAIL;
   }
+  std::lock_guard<std::mutex> Lock(SegmentMtx);
+  auto isPlaced = [&](SegmentListTy::iterator Seg) {
+    return Seg->second.TgtPtrBegin || ClaimedSegments.count(Seg->first);
+  };
   if (IsNoBulkEnabled) {
 
   }
@@ -696,7 +1288,7 @@ int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
   intptr_t HstPtrBeginCur, HstPtrEndCur;
   intptr_t TgtPtrBegin = 0;
 
-  auto it = SegmentList.lower_bound((intptr_t)HstPtrBegin);
+  auto it = Segments.lower_bound((intptr_t)HstPtrBegin);
 
   // Try merge
   bool TryExtendHigh = false;
@@ -712,7 +1304,7 @@ int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
   //                 addr |   .lower_bound = seg2
   // Check forward
   // TODO No new if it's alloced
-  if (it != SegmentList.end()) {
+  if (it != Segments.end()) {
     HstPtrBeginCur = (intptr_t) it->second.HstPtrBegin;
     HstPtrEndCur = (intptr_t) it->second.HstPtrEnd;
 
@@ -720,7 +1312,7 @@ int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
       // Exceed segment cur end
       if (HstPtrEndNew > HstPtrEndCur) {
         // Alloced segment cannot be extended
-        if (it->second.TgtPtrBegin) {
+        if (isPlaced(it)) {
 
           // Check overlap
           if (HstPtrBeginNew < HstPtrEndCur) {
@@ -735,13 +1327,13 @@ int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
       } else {
         HstPtrEndNew = HstPtrEndCur;
         ContainedInOld = true;
-        if (it->second.TgtPtrBegin) {
+        if (isPlaced(it)) {
           DP2("Contained in %s, return\n", it->second.getString().c_str());
           return OFFLOAD_SUCCESS;
         }
       }
       HstPtrBeginNew = HstPtrBeginCur;
-      if (!it->second.TgtPtrBegin) {
+      if (!isPlaced(it)) {
         Found = true;
         EraseSegs.push_back(it);
       } else {
@@ -755,7 +1347,7 @@ int32_t DeviceTy::bulk_data_alloc(void *HstPtrBegin, size_t Size) {
 BACKWARD:
   // FIXME always extendhigh??
   // Check backward, higher addr
-  while (it != SegmentList.begin() && (!Found || TryExtendHigh || ContainedInOld)) {
+  while (it != Segments.begin() && (!Found || TryExtendHigh || ContainedInOld)) {
     it--;
     HstPtrBeginCur = (intptr_t)  it->second.HstPtrBegin;
     HstPtrEndCur = (intptr_t) it->second.HstPtrEnd;
@@ -763,7 +1355,7 @@ BACKWARD:
     intptr_t gap = HstPtrBeginCur - HstPtrEndNew;
 
     if (gap < threshold) {
-      if (it->second.TgtPtrBegin) {
+      if (isPlaced(it)) {
         if (gap < 0) {
         // check overlap with alloced segment
           DP2("Overlap with alloced segment %s is not allowed for %p, size %zu\n",
@@ -803,7 +1395,7 @@ CHECK:
     return OFFLOAD_SUCCESS;
   }*/
   for (auto seg : EraseSegs) {
-    SegmentList.erase(seg);
+    Segments.erase(seg);
   }
 
 NEW:
@@ -812,7 +1404,8 @@ NEW:
   r.HstPtrBegin = HstPtrBeginNew;
   r.HstPtrEnd = HstPtrEndNew;
   r.TgtPtrBegin = 0;
-  SegmentList[(intptr_t) HstPtrBeginNew] = r;
+  Segments[(intptr_t) HstPtrBeginNew] = r;
+  Segments.invalidate();
   if (Found) {
     DP2("Added [%p,%p] to segment: %s\n", (void*)HstPtrBegin, (char*)HstPtrBegin + Size, r.getString().c_str());
   } else {
@@ -821,8 +1414,18 @@ NEW:
   return OFFLOAD_SUCCESS;
 }
 
+// NULL until the segment of HstPtrBegin is published by bulk_transfer
 void *DeviceTy::bulkGetTgtPtrBegin(void *HstPtrBegin, int64_t Size) {
+  std::lock_guard<std::mutex> Lock(SegmentMtx);
   void *ret;
+  // Fast path over the flat index, fall back to the map to report errors
+  if (IsBulkEnabled) {
+    const SegmentTy *Seg = Segments.find((uintptr_t)HstPtrBegin, Size);
+    if (Seg && Seg->TgtPtrBegin) {
+      uintptr_t Delta = (uintptr_t)HstPtrBegin - Seg->HstPtrBegin;
+      return (void*)(Seg->TgtPtrBegin + Delta);
+    }
+  }
   BulkLookupResult r = bulkLookupMapping(HstPtrBegin, Size);
   auto entry = r.Entry;
 
@@ -850,8 +1453,8 @@ BulkLookupResult DeviceTy::bulkLookupMapping(void *HstPtrBegin, int64_t Size) {
     DP2("(BULK) Looking up mapping(HstPtrBegin=" DPxMOD ", Size=%ld)...\n",
        DPxPTR(HstPtrBegin), Size);
     // TODO lower latency
-    auto entry = SegmentList.lower_bound((intptr_t)HstPtrBegin);
-    if (entry != SegmentList.end()) {
+    auto entry = Segments.lower_bound((intptr_t)HstPtrBegin);
+    if (entry != Segments.end()) {
         //DP2("[%p, %p]\n", (void*)entry->second.HstPtrBegin, (void*) entry->second.HstPtrEnd);
       if ((intptr_t) HstPtrBegin < entry->second.HstPtrEnd) {
         if ((intptr_t) HstPtrBegin + Size <= entry->second.HstPtrEnd) {
@@ -861,15 +1464,15 @@ BulkLookupResult DeviceTy::bulkLookupMapping(void *HstPtrBegin, int64_t Size) {
           r.Flags.ExtendsAfter  = true;
           r.Entry = entry;
         }
-      } else if (entry != SegmentList.begin()) {
+      } else if (entry != Segments.begin()) {
         if ((intptr_t) HstPtrBegin + Size < (--entry)->second.HstPtrEnd) {
           r.Entry = entry;
           r.Flags.ExtendsBefore = true;
         }
       }
     } else {
-      if (SegmentList.size() > 1) {
-        auto last = SegmentList.end();
+      if (Segments.size() > 1) {
+        auto last = Segments.end();
         last--;
         if ((intptr_t) HstPtrBegin + Size < last->second.HstPtrBegin) {
           r.Entry = last;
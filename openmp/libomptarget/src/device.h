@@ -13,19 +13,28 @@
 #ifndef _OMPTARGET_DEVICE_H
 #define _OMPTARGET_DEVICE_H
 
+#include <atomic>
 #include <cstddef>
 #include <climits>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 #include <set>
+#include <shared_mutex>
 #include <queue>
 
 #include "omptarget.h"
 #include "mymalloc.h"
+#include "rttype.h"
 
 // Forward declarations.
+struct DeviceTy;
 struct RTLInfoTy;
 struct __tgt_bin_desc;
 struct __tgt_target_table;
@@ -41,7 +50,9 @@ struct HostDataToTargetTy {
 
   mutable uintptr_t TgtPtrBegin; // target info.
 
-  mutable long RefCount;
+  // Atomic so that existing mappings can be reused while DataMapMtx is only
+  // held in shared mode.
+  mutable std::atomic<long> RefCount;
   // Additional ptr
   union {
     mutable void **HostShadowPtrSpace;
@@ -57,6 +68,10 @@ struct HostDataToTargetTy {
       long RF)
       : HstPtrBase(BP), HstPtrBegin(B), HstPtrEnd(E), ptr(NULL),
         TgtPtrBegin(TB), RefCount(RF) {}
+  HostDataToTargetTy(const HostDataToTargetTy &HT)
+      : HstPtrBase(HT.HstPtrBase), HstPtrBegin(HT.HstPtrBegin),
+        HstPtrEnd(HT.HstPtrEnd), ptr(HT.ptr), TgtPtrBegin(HT.TgtPtrBegin),
+        RefCount(HT.RefCount.load()) {}
 };
 
 struct H2DCmp {
@@ -138,9 +153,272 @@ struct SegmentListTy : public SegMap {
   void *TgtMemPtr;
   int TgtMemSize;
 
-  SegmentListTy() : TgtMemSize (0), TgtMemPtr (NULL) {}
+  // Flat copy of the map in ascending host order, rebuilt lazily after the
+  // map is modified. Call invalidate() after changing the map.
+  std::vector<SegmentTy> Index;
+  size_t LastHit;
+  bool IndexDirty;
+
+  // Bumped by invalidate(), compared with the generation last uploaded
+  uint64_t Generation;
+  uint64_t UploadedGen;
+  // Copy of the table currently at TgtMemPtr, used to find dirty entries
+  std::vector<SegmentTy> Uploaded;
+
+  SegmentListTy() : TgtMemSize (0), TgtMemPtr (NULL), LastHit(0),
+      IndexDirty(true), Generation(1), UploadedGen(0) {}
+  void invalidate() { IndexDirty = true; Generation++; }
+  // Segment containing [HstPtrBegin, HstPtrBegin + Size), or NULL
+  const SegmentTy *find(uintptr_t HstPtrBegin, int64_t Size);
 };
 
+// Transfer coalescing for deep copy regions
+struct PendingTransferTy {
+  uintptr_t HstPtrBegin;
+  uintptr_t TgtPtrBegin;
+  int64_t Size;
+  bool IsNew; // gaps may only be padded into freshly allocated mappings
+};
+
+// Collect regions produced by RttTy::computeRegion and emit one transfer
+// per run of host/target contiguous regions. Pointer updates are applied
+// after all regions so they are never overwritten by a padded gap.
+struct TransferBatchTy {
+  std::vector<PendingTransferTy> Regions;
+  std::vector<PendingTransferTy> Pointers;
+  std::vector<void *> PtrVals;
+  std::vector<char> Staging;
+  int64_t GapThreshold;
+
+  TransferBatchTy(int64_t Gap) : GapThreshold(Gap) {}
+  void addRegion(void *TgtPtrBegin, void *HstPtrBegin, int64_t Size,
+      bool IsNew);
+  void addPointer(void *TgtPtrAddr, void *TgtPtrVal);
+  int32_t flush(DeviceTy &Device);
+  bool empty() { return Regions.empty() && Pointers.empty(); }
+};
+
+// Shadow pointers in [Begin, End) to restore and/or drop after a retrieval
+struct PendingRestoreTy {
+  uintptr_t Begin;
+  uintptr_t End;
+  bool Restore;
+  bool Erase;
+};
+
+struct PendingDeleteTy {
+  void *HstPtrBegin;
+  int64_t Size;
+  bool ForceDelete;
+};
+
+// Collect the copies back to the host of target_data_end and emit one
+// transfer per run of host/target contiguous regions. Gaps are never padded,
+// they would overwrite host data. Shadow pointers are restored and mappings
+// released only once all copies have landed.
+struct RetrieveBatchTy {
+  std::vector<PendingTransferTy> Regions;
+  std::vector<PendingRestoreTy> Restores;
+  std::vector<PendingDeleteTy> Deletes;
+  // Host ranges of Deletes, begin -> end
+  std::map<uintptr_t, uintptr_t> DeleteRanges;
+  std::vector<void **> ShadowAddrs;
+  std::vector<void *> ShadowVals;
+
+  void addRegion(void *TgtPtrBegin, void *HstPtrBegin, int64_t Size);
+  void addRestore(void *HstPtrBegin, int64_t Size, bool Restore, bool Erase);
+  void addDelete(void *HstPtrBegin, int64_t Size, bool ForceDelete);
+  // Whether [HstPtrBegin, HstPtrBegin + Size) overlaps a pending delete
+  bool isDeleting(void *HstPtrBegin, int64_t Size) const;
+  int32_t flush(DeviceTy &Device);
+  bool empty() {
+    return Regions.empty() && Restores.empty() && Deletes.empty();
+  }
+};
+
+// Deep copy node placed in the compacted allocation of OMP_DC_COMPACT
+struct CompactNodeTy {
+  uintptr_t HstPtrBegin;
+  size_t Size;
+  int Level; // RttTy::Level
+};
+
+// Caching allocator for device memory owned by the runtime itself, such as
+// bulk segments, AT tables and first-private arrays. Sizes are rounded up to
+// power-of-two classes and released blocks are kept for reuse instead of
+// going back to the RTL. Small classes can be carved from large arenas.
+struct DevicePoolTy {
+  static const int MinClassShift = 8;   // 256 bytes
+  static const int MaxClassShift = 30;  // bigger requests bypass the pool
+  static const int NumClasses = MaxClassShift - MinClassShift + 1;
+  static const int ArenaClassShift = 16; // classes served from the arena
+
+  bool Enabled;
+  int64_t ArenaSize; // 0 disables the arena
+  std::vector<void *> FreeLists[NumClasses];
+  // Block to size class, for blocks handed out by the pool
+  std::map<void *, int> Owned;
+  // Current arena chunk
+  uintptr_t ArenaCur, ArenaEnd;
+  std::mutex Mtx;
+
+  DevicePoolTy() : Enabled(false), ArenaSize(0), ArenaCur(0), ArenaEnd(0) {}
+  void *alloc(DeviceTy &Device, int64_t Size);
+  int32_t release(DeviceTy &Device, void *TgtPtr);
+};
+
+// Transfer state of one host thread on a device. Deep copy target regions
+// only touch the state of their own thread, so regions offloaded by
+// different host threads run in parallel, each on the RTL stream of its
+// thread. Bulk segments are shared, see DeviceTy::Segments.
+struct TransferStateTy {
+  UpdatePtrListTy UpdatePtrList;
+  // AT table of the launches of this thread: the mapped heaps with
+  // OMP_OFFMODE_AT_TABLE, a copy of DeviceTy::Segments in bulk AT mode
+  SegmentListTy SegmentList;
+  // Generation of DeviceTy::Segments the bulk AT table was built from
+  uint64_t SegmentsGen;
+  bool HasPendingAsync;
+  // OMP_OFFMODE_AT_OFFSET list, kept on the device across launches
+  std::vector<intptr_t> OffsetList;
+  void *OffsetListPtr;
+  size_t OffsetListCap;
+  // get_heap_generation() the OFFSET list and the TABLE heap segments were
+  // built for
+  uint64_t OffsetListGen;
+  uint64_t HeapTableGen;
+  // Managed allocations already migrated for the current region
+  std::set<void *> UVMPrefetched;
+  // Deep copy objects walked by this thread, see OMP_DC_SNAPSHOT
+  RttSnapshotsTy RttSnapshots;
+  // Deep copy nodes not placed yet, in the order they were found
+  std::vector<CompactNodeTy> CompactNodes;
+
+  TransferStateTy()
+      : SegmentsGen(0), HasPendingAsync(false), OffsetListPtr(NULL),
+        OffsetListCap(0), OffsetListGen(0), HeapTableGen(0) {}
+};
+
+// Per target region choice of the AT mode. Every candidate mode is timed
+// over a few launches of the region, then the fastest one is kept. Choices
+// are read from and written to an optional profile file so later runs skip
+// the trials.
+struct ModeSelectorTy {
+  struct RegionTy {
+    std::vector<double> Time; // seconds spent per candidate
+    std::vector<int> Runs;
+    // Whether the first, untimed launch of a candidate is done
+    std::vector<bool> Warm;
+    int Chosen; // index in Candidates, -1 while trying
+    RegionTy() : Chosen(-1) {}
+  };
+
+  bool Enabled;
+  int Trials; // launches per candidate
+  std::string ProfilePath;
+  std::vector<OpenMPOffloadingMode> Candidates;
+  std::map<std::string, RegionTy> Regions;
+  std::mutex Mtx;
+
+  // Time one launch of a region and report it on scope exit
+  struct ScopeTy {
+    ModeSelectorTy *Sel;
+    std::string Name;
+    int Cand;
+    std::chrono::steady_clock::time_point Start;
+    ScopeTy() : Sel(nullptr), Cand(-1) {}
+    ~ScopeTy();
+  };
+
+  ModeSelectorTy() : Enabled(false), Trials(1) {}
+  void init(OpenMPOffloadingMode BaseMode, int NumTrials);
+  int pick(const std::string &Name);
+  void record(const std::string &Name, int Cand, double Sec);
+private:
+  void load();
+  void save();
+};
+
+// Device graphs of repeated target regions. A region whose arguments are
+// all mapped already issues the same transfers and kernel launch every time
+// it runs with the same arguments, so from its second run on it is recorded
+// by the RTL into a graph that later runs replay with a single call. Graphs
+// are only used while no mapping was added or removed since they were
+// recorded. Literal arguments are part of the key, so the least recently run
+// regions are dropped once MaxEntries is reached.
+struct GraphCacheTy {
+  struct KeyTy {
+    void *HostPtr;
+    int32_t TeamNum;
+    int32_t ThreadLimit;
+    uint64_t LoopTripCount;
+    std::vector<void *> Args;   // args_base and args, interleaved
+    std::vector<int64_t> Types; // arg_sizes and arg_types, interleaved
+    bool operator<(const KeyTy &Other) const;
+  };
+  // Destroys the graph once no thread launches it anymore
+  typedef std::shared_ptr<void> GraphRefTy;
+  struct EntryTy {
+    int Runs;
+    int Stale; // graphs dropped because the mapping changed
+    bool Failed;
+    uint64_t MapGeneration;
+    uint64_t LastRun; // value of Clock
+    GraphRefTy Graph;
+    EntryTy()
+        : Runs(0), Stale(0), Failed(false), MapGeneration(0), LastRun(0) {}
+  };
+
+  static const size_t MaxEntries = 256;
+
+  bool Enabled;
+  std::map<KeyTy, EntryTy> Entries;
+  uint64_t Clock;
+  std::mutex Mtx;
+
+  GraphCacheTy() : Enabled(false), Clock(0) {}
+  bool getKey(DeviceTy &Device, void *HostPtr, int32_t ArgNum,
+      void **ArgsBase, void **Args, int64_t *ArgSizes, int64_t *ArgTypes,
+      int32_t TeamNum, int32_t ThreadLimit, KeyTy &Key);
+  int run(DeviceTy &Device, const KeyTy &Key,
+      const std::function<int()> &Region);
+  // Drops all graphs, e.g. before the kernels they launch are unloaded
+  void clear();
+private:
+  EntryTy &lookup(const KeyTy &Key);
+};
+
+// Bulk segments resident on some device with the content they were uploaded
+// with, by host range. With OMP_BULK_REPLICATE a device that needs the same
+// segment copies it from a peer instead of the host. Replicated segments are
+// expected to stay unchanged; writes seen by the runtime drop the range: any
+// transfer into one of its device copies and copies back to the host. A copy
+// whose device memory is freed is forgotten.
+struct SegmentReplicasTy {
+  struct ReplicaTy {
+    int32_t DeviceID;
+    uintptr_t TgtPtrBegin;
+  };
+  typedef std::pair<uintptr_t, uintptr_t> RangeTy;
+  std::map<RangeTy, std::vector<ReplicaTy>> Replicas;
+  // Host range of each copy by device and begin of its device memory
+  std::map<std::pair<int32_t, uintptr_t>, RangeTy> ByTarget;
+  std::mutex Mtx;
+
+  bool find(DeviceTy &Device, uintptr_t HstPtrBegin, uintptr_t HstPtrEnd,
+      ReplicaTy &Replica);
+  void add(DeviceTy &Device, uintptr_t HstPtrBegin, uintptr_t HstPtrEnd,
+      uintptr_t TgtPtrBegin);
+  void drop(uintptr_t HstPtrBegin, uintptr_t HstPtrEnd);
+  // [TgtPtrBegin, TgtPtrBegin + Size) of Device is about to be written
+  void written(DeviceTy &Device, uintptr_t TgtPtrBegin, int64_t Size);
+  // Device memory at TgtPtrBegin is about to be freed
+  void freed(DeviceTy &Device, uintptr_t TgtPtrBegin);
+private:
+  void eraseLocked(std::map<RangeTy, std::vector<ReplicaTy>>::iterator It);
+};
+extern SegmentReplicasTy SegmentReplicas;
+
 struct BulkLookupResult {
   struct {
     unsigned IsContained   : 1;
@@ -167,12 +445,18 @@ struct DeviceTy {
 
   ShadowPtrListTy ShadowPtrMap;
 
-  std::mutex DataMapMtx, PendingGlobalsMtx, ShadowMtx;
+  // Lookups of existing mappings take DataMapMtx shared, inserting or erasing
+  // a mapping takes it exclusive.
+  std::shared_timed_mutex DataMapMtx;
+  std::mutex PendingGlobalsMtx, ShadowMtx;
 
   uint64_t loopTripCnt;
 
   int64_t RTLRequiresFlags;
 
+  // Bumped whenever a mapping is added or removed, see GraphCacheTy
+  std::atomic<uint64_t> MapGeneration{0};
+
   DeviceTy(RTLInfoTy *RTL)
       : DeviceID(-1), RTL(RTL), RTLDeviceID(-1), IsInit(false), InitFlag(),
         HasPendingGlobals(false), HostDataToTargetMap(),
@@ -207,8 +491,11 @@ struct DeviceTy {
 
   long getMapEntryRefCnt(void *HstPtrBegin);
   LookupResult lookupMapping(void *HstPtrBegin, int64_t Size);
+  // With bulk transfers a CompactLevel >= 0 queues a new region for the
+  // compacted allocation, see bulk_compact_alloc
   void *getOrAllocTgtPtr(void *HstPtrBegin, void *HstPtrBase, int64_t Size,
-      bool &IsNew, bool IsImplicit, bool UpdateRefCount = true);
+      bool &IsNew, bool IsImplicit, bool UpdateRefCount = true,
+      int CompactLevel = -1);
   void *getTgtPtrBegin(void *HstPtrBegin, int64_t Size);
   void *getTgtPtrBegin(void *HstPtrBegin, int64_t Size, bool &IsLast,
       bool UpdateRefCount);
@@ -222,17 +509,50 @@ struct DeviceTy {
 
   int32_t data_submit(void *TgtPtrBegin, void *HstPtrBegin, int64_t Size);
   int32_t data_retrieve(void *HstPtrBegin, void *TgtPtrBegin, int64_t Size);
-
-
+  // Queue a transfer on the device stream, fall back to data_submit if the
+  // RTL has no async support. Must be followed by synchronize().
+  int32_t data_submit_async(void *TgtPtrBegin, void *HstPtrBegin,
+      int64_t Size);
+  // Same for data_retrieve, HstPtrBegin is valid after synchronize().
+  int32_t data_retrieve_async(void *HstPtrBegin, void *TgtPtrBegin,
+      int64_t Size);
+  // Copy from another device of the same RTL
+  int32_t data_exchange(DeviceTy &SrcDevice, void *SrcPtrBegin,
+      void *TgtPtrBegin, int64_t Size);
+  // Copy a box between this device and the host or another device of the
+  // same RTL, see __tgt_rtl_data_copy_rect. A NULL device is the host side.
+  int32_t data_copy_rect(DeviceTy *DstDevice, void *DstPtr, int64_t DstPitch,
+      int64_t DstHeight, DeviceTy *SrcDevice, void *SrcPtr, int64_t SrcPitch,
+      int64_t SrcHeight, int64_t Width, int64_t Height, int64_t Depth);
+  // Migrate managed memory at HstPtr, see __tgt_rtl_data_prefetch. Each
+  // address is migrated once until xfer().UVMPrefetched is cleared.
+  int32_t uvm_prefetch(void *HstPtr, int64_t Size, int32_t Flags);
+  int32_t synchronize();
+
+  // Mode is the AT mode of the kernel variant to launch, ATMode if it is
+  // OMP_OFFMODE_NORMAL
   int32_t run_region(void *TgtEntryPtr, void **TgtVarsPtr,
-      ptrdiff_t *TgtOffsets, int32_t TgtVarsSize);
+      ptrdiff_t *TgtOffsets, int32_t TgtVarsSize,
+      OpenMPOffloadingMode Mode = OMP_OFFMODE_NORMAL);
   int32_t run_team_region(void *TgtEntryPtr, void **TgtVarsPtr,
       ptrdiff_t *TgtOffsets, int32_t TgtVarsSize, int32_t NumTeams,
-      int32_t ThreadLimit, uint64_t LoopTripCount);
+      int32_t ThreadLimit, uint64_t LoopTripCount,
+      OpenMPOffloadingMode Mode = OMP_OFFMODE_NORMAL);
 
   // pschen custom
-  UpdatePtrListTy UpdatePtrList;
-  SegmentListTy SegmentList; // used in bulk and OMP_OFFMODE_AT_TABLE
+  // Per host thread state, see TransferStateTy
+  std::list<TransferStateTy> TransferStates;
+  std::mutex TransferStatesMtx;
+  TransferStateTy &xfer();
+  // Bulk segments of all host threads, so that a host range mapped by one
+  // region is found by the others. SegmentMtx is only held to look up, merge
+  // or publish segments, never across a transfer or a kernel launch.
+  SegmentListTy Segments;
+  // Segments bulk_transfer is allocating and copying, by host begin
+  std::set<uintptr_t> ClaimedSegments;
+  std::mutex SegmentMtx;
+  // Notified when claimed segments are published
+  std::condition_variable SegmentCV;
 
 
   bool IsBulkEnabled;
@@ -240,7 +560,28 @@ struct DeviceTy {
   // FIXME remove you
   bool IsATEnabled;
   bool IsUVMEnabled;
+  // Migrate managed memory reached by the regions instead of faulting it in
+  bool IsUVMPrefetchEnabled;
+  int32_t UVMPrefetchFlags;
   bool IsDCEnabled;
+  bool IsAsyncEnabled;
+  bool IsCoalesceEnabled;
+  int64_t CoalesceGap;
+  bool IsPatchPtrEnabled;
+  bool IsReplicateEnabled;
+  // Host threads walking large deep copy objects, 1 walks them inline
+  int32_t DCThreads;
+  // Walk sub-objects shared by several pointers once per object
+  bool IsDCDedupEnabled;
+  // Reuse the regions of deep copy objects whose pointers did not change
+  bool IsDCSnapshotEnabled;
+  // Lay out the nodes of deep copy objects in one device allocation, by
+  // level or grouped by size first
+  bool IsDCCompactEnabled;
+  bool DCCompactBySize;
+  DevicePoolTy Pool;
+  ModeSelectorTy ModeSel;
+  GraphCacheTy Graphs;
   OpenMPOffloadingMode ATMode;
   int32_t suspend_update(void *HstPtrAddr, void *HstPtrValue, uint64_t Delta, void *HstPtrBase);
   int32_t update_suspend_list();
@@ -250,10 +591,15 @@ struct DeviceTy {
   // bulk related
   int32_t bulk_map_from(void *HstPtrBegin, size_t size);
   int32_t bulk_data_alloc(void *HstPtrBegin, size_t size);
+  int32_t bulk_compact_alloc(void *HstPtrBegin, size_t Size, int Level);
+  int32_t bulk_compact_place();
   int32_t bulk_data_submit(void *HstPtrBegin, int64_t Size);
   int32_t bulk_transfer();
   void table_transfer();
+  int32_t upload_table();
+  int32_t upload_offset_list(const std::vector<intptr_t> &List);
 
+  // Call with SegmentMtx held
   BulkLookupResult bulkLookupMapping(void *HstPtrBegin, int64_t Size);
   void *bulkGetTgtPtrBegin(void *HstPtrBegin, int64_t Size);
 private:
@@ -0,0 +1,80 @@
+// Size-class pool for runtime owned device memory
+#include "device.h"
+#include "private.h"
+#include "rtl.h"
+#include "perf.h"
+
+static int sizeClass(int64_t Size) {
+  int Shift = DevicePoolTy::MinClassShift;
+  while (Shift <= DevicePoolTy::MaxClassShift && ((int64_t)1 << Shift) < Size) {
+    Shift++;
+  }
+  return Shift - DevicePoolTy::MinClassShift;
+}
+
+void *DevicePoolTy::alloc(DeviceTy &Device, int64_t Size) {
+  if (!Enabled || Size <= 0) {
+    return Device.RTL->data_alloc(Device.RTLDeviceID, Size, NULL);
+  }
+  int Class = sizeClass(Size);
+  if (Class >= NumClasses) {
+    PERF_WRAP(Perf.PoolMiss.add(Size);)
+    return Device.RTL->data_alloc(Device.RTLDeviceID, Size, NULL);
+  }
+  int64_t ClassSize = (int64_t)1 << (Class + MinClassShift);
+
+  std::lock_guard<std::mutex> Lock(Mtx);
+  auto &FreeList = FreeLists[Class];
+  if (!FreeList.empty()) {
+    void *Ptr = FreeList.back();
+    FreeList.pop_back();
+    PERF_WRAP(Perf.PoolHit.add(ClassSize);)
+    return Ptr;
+  }
+  PERF_WRAP(Perf.PoolMiss.add(ClassSize);)
+
+  void *Ptr;
+  if (ArenaSize >= ClassSize &&
+      Class + MinClassShift <= ArenaClassShift) {
+    // Carve from the arena, start a new chunk if the current one is full
+    // Arena blocks are never returned to the RTL
+    if (ArenaEnd - ArenaCur < (uintptr_t)ClassSize) {
+      void *Chunk = Device.RTL->data_alloc(Device.RTLDeviceID, ArenaSize,
+          NULL);
+      if (!Chunk) {
+        return NULL;
+      }
+      DP2("Device pool new arena " DPxMOD " size %ld\n", DPxPTR(Chunk),
+          ArenaSize);
+      ArenaCur = (uintptr_t)Chunk;
+      ArenaEnd = ArenaCur + ArenaSize;
+    }
+    Ptr = (void *)ArenaCur;
+    ArenaCur += ClassSize;
+  } else {
+    Ptr = Device.RTL->data_alloc(Device.RTLDeviceID, ClassSize, NULL);
+    if (!Ptr) {
+      return NULL;
+    }
+  }
+  Owned[Ptr] = Class;
+  return Ptr;
+}
+
+int32_t DevicePoolTy::release(DeviceTy &Device, void *TgtPtr) {
+  if (!TgtPtr) {
+    return OFFLOAD_SUCCESS;
+  }
+  if (Device.IsReplicateEnabled) {
+    SegmentReplicas.freed(Device, (uintptr_t)TgtPtr);
+  }
+  if (Enabled) {
+    std::lock_guard<std::mutex> Lock(Mtx);
+    auto It = Owned.find(TgtPtr);
+    if (It != Owned.end()) {
+      FreeLists[It->second].push_back(TgtPtr);
+      return OFFLOAD_SUCCESS;
+    }
+  }
+  return Device.RTL->data_delete(Device.RTLDeviceID, TgtPtr);
+}
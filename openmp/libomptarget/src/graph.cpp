@@ -0,0 +1,151 @@
+// Replay of repeated target regions as device graphs
+#include <tuple>
+
+#include "device.h"
+#include "private.h"
+#include "rtl.h"
+
+// Graphs of a region are given up after the mapping changed this often
+static const int MaxStaleGraphs = 4;
+
+bool GraphCacheTy::KeyTy::operator<(const KeyTy &Other) const {
+  return std::tie(HostPtr, TeamNum, ThreadLimit, LoopTripCount, Args, Types) <
+         std::tie(Other.HostPtr, Other.TeamNum, Other.ThreadLimit,
+                  Other.LoopTripCount, Other.Args, Other.Types);
+}
+
+// Return false if the region may issue different work on its next run, e.g.
+// because it maps new data or uploads from temporary host buffers. Fills Key
+// otherwise.
+bool GraphCacheTy::getKey(DeviceTy &Device, void *HostPtr, int32_t ArgNum,
+    void **ArgsBase, void **Args, int64_t *ArgSizes, int64_t *ArgTypes,
+    int32_t TeamNum, int32_t ThreadLimit, KeyTy &Key) {
+  if (Device.ATMode != OMP_OFFMODE_NORMAL || Device.IsBulkEnabled ||
+      Device.IsATEnabled || Device.IsDCEnabled || Device.IsCoalesceEnabled ||
+      Device.IsPatchPtrEnabled) {
+    return false;
+  }
+
+  std::shared_lock<std::shared_timed_mutex> Lock(Device.DataMapMtx);
+  for (int32_t i = 0; i < ArgNum; ++i) {
+    int64_t Type = ArgTypes[i];
+    // Lambda captures and pointer members are patched from host temporaries,
+    // private copies come from the pool
+    if (!(Type & OMP_TGT_MAPTYPE_TARGET_PARAM) ||
+        (Type & (OMP_TGT_MAPTYPE_PTR_AND_OBJ | OMP_TGT_MAPTYPE_PRIVATE))) {
+      return false;
+    }
+    if (Type & OMP_TGT_MAPTYPE_LITERAL) {
+      continue;
+    }
+    if (_MYMALLOC_ISMYSPACE(Args[i]) ||
+        !Device.lookupMapping(Args[i], ArgSizes[i]).Flags.IsContained) {
+      return false;
+    }
+  }
+
+  Key.HostPtr = HostPtr;
+  Key.TeamNum = TeamNum;
+  Key.ThreadLimit = ThreadLimit;
+  Key.LoopTripCount = Device.loopTripCnt;
+  Key.Args.resize(2 * ArgNum);
+  Key.Types.resize(2 * ArgNum);
+  for (int32_t i = 0; i < ArgNum; ++i) {
+    Key.Args[2 * i] = ArgsBase[i];
+    Key.Args[2 * i + 1] = Args[i];
+    Key.Types[2 * i] = ArgSizes[i];
+    Key.Types[2 * i + 1] = ArgTypes[i];
+  }
+  return true;
+}
+
+// Entry of Key, created if missing. Mtx must be held. Dropping an entry
+// only releases its graph, launches in progress keep their reference.
+GraphCacheTy::EntryTy &GraphCacheTy::lookup(const KeyTy &Key) {
+  auto It = Entries.find(Key);
+  if (It == Entries.end()) {
+    if (Entries.size() >= MaxEntries) {
+      auto Oldest = Entries.begin();
+      for (auto I = Entries.begin(), IE = Entries.end(); I != IE; ++I) {
+        if (I->second.LastRun < Oldest->second.LastRun) {
+          Oldest = I;
+        }
+      }
+      DP("Dropping graph entry of target region " DPxMOD "\n",
+         DPxPTR(Oldest->first.HostPtr));
+      Entries.erase(Oldest);
+    }
+    It = Entries.emplace(Key, EntryTy()).first;
+  }
+  It->second.LastRun = ++Clock;
+  return It->second;
+}
+
+void GraphCacheTy::clear() {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  Entries.clear();
+}
+
+// Run the region through its graph: replay it when there is a current one,
+// record it when the region was seen before, or run Region directly.
+int GraphCacheTy::run(DeviceTy &Device, const KeyTy &Key,
+    const std::function<int()> &Region) {
+  RTLInfoTy *RTL = Device.RTL;
+  int32_t ID = Device.RTLDeviceID;
+  uint64_t Generation = Device.MapGeneration;
+  GraphRefTy Ref;
+  bool Capture = false;
+  {
+    std::lock_guard<std::mutex> Lock(Mtx);
+    EntryTy &E = lookup(Key);
+    if (E.Graph && E.MapGeneration == Generation) {
+      Ref = E.Graph;
+    } else {
+      if (E.Graph) {
+        E.Graph.reset();
+        E.Failed = ++E.Stale > MaxStaleGraphs;
+        E.Runs = 0;
+      }
+      Capture = !E.Failed && ++E.Runs > 1;
+    }
+  }
+
+  if (Ref) {
+    DP("Replaying graph " DPxMOD " of target region " DPxMOD "\n",
+       DPxPTR(Ref.get()), DPxPTR(Key.HostPtr));
+    Device.loopTripCnt = 0;
+    return RTL->graph_launch(ID, Ref.get());
+  }
+  if (!Capture || RTL->capture_begin(ID) != OFFLOAD_SUCCESS) {
+    return Region();
+  }
+
+  int rc = Region();
+  void *Graph = RTL->capture_end(ID);
+  if (rc == OFFLOAD_SUCCESS && Graph) {
+    RTLInfoTy::graph_destroy_ty *Destroy = RTL->graph_destroy;
+    Ref = GraphRefTy(Graph, [Destroy, ID](void *G) { Destroy(ID, G); });
+    // Recording did not run anything yet
+    rc = RTL->graph_launch(ID, Graph);
+    std::lock_guard<std::mutex> Lock(Mtx);
+    EntryTy &E = lookup(Key);
+    if (rc == OFFLOAD_SUCCESS && !E.Graph &&
+        Device.MapGeneration == Generation) {
+      E.Graph = Ref;
+      E.MapGeneration = Generation;
+    }
+    return rc;
+  }
+
+  DP("Cannot record target region " DPxMOD ", running it directly\n",
+     DPxPTR(Key.HostPtr));
+  if (Graph) {
+    RTL->graph_destroy(ID, Graph);
+  }
+  {
+    std::lock_guard<std::mutex> Lock(Mtx);
+    lookup(Key).Failed = true;
+  }
+  Device.loopTripCnt = Key.LoopTripCount;
+  return Region();
+}
@@ -18,10 +18,16 @@
 #include "rtl.h"
 
 #include "perf.h"
+#include "tool.h"
 
 #include <cassert>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
+#include <functional>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 // Store target policy (disabled, mandatory, default)
 // FIXME force mandatory
@@ -75,6 +81,163 @@ static void HandleTargetOutcome(bool success) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// asynchronous execution of the nowait entry points
+///
+/// A nowait construct is handed to a host thread of the runtime, so the
+/// encountering thread goes back to host work while the device copies and
+/// computes. The construct is tied to a detachable libomp task whose event is
+/// fulfilled once the device is done, so taskwait, barriers and dependent
+/// tasks wait for it. Failures after the hand-off are reported by
+/// HandleTargetOutcome; the host fallback is only taken for failures found
+/// before it.
+
+namespace {
+// Host thread running the nowait constructs in the order they were handed
+// off. It is started on first use.
+class NowaitWorkerTy {
+  std::thread Worker;
+  std::deque<std::function<void()>> Jobs;
+  std::mutex Mtx;
+  std::condition_variable CV;
+  std::condition_variable IdleCV;
+  bool Busy = false;
+  bool Stop = false;
+
+  void work() {
+    std::unique_lock<std::mutex> Lock(Mtx);
+    while (true) {
+      if (Jobs.empty()) {
+        Busy = false;
+        IdleCV.notify_all();
+        if (Stop) {
+          return;
+        }
+        CV.wait(Lock);
+        continue;
+      }
+      std::function<void()> Job = std::move(Jobs.front());
+      Jobs.pop_front();
+      Busy = true;
+      Lock.unlock();
+      Job();
+      Lock.lock();
+    }
+  }
+
+public:
+  ~NowaitWorkerTy() {
+    {
+      std::lock_guard<std::mutex> Lock(Mtx);
+      Stop = true;
+    }
+    CV.notify_all();
+    if (Worker.joinable()) {
+      Worker.join();
+    }
+  }
+
+  void push(std::function<void()> Job) {
+    std::lock_guard<std::mutex> Lock(Mtx);
+    if (!Worker.joinable()) {
+      Worker = std::thread(&NowaitWorkerTy::work, this);
+    }
+    Jobs.push_back(std::move(Job));
+    CV.notify_one();
+  }
+
+  // Wait for the constructs handed off so far
+  void drain() {
+    std::unique_lock<std::mutex> Lock(Mtx);
+    IdleCV.wait(Lock, [&]() { return Jobs.empty() && !Busy; });
+  }
+};
+
+// Copies of the arrays of a nowait construct. Clang builds them on the stack
+// of the encountering thread, except for the map types which are constant.
+struct NowaitArgsTy {
+  std::vector<void *> ArgsBase;
+  std::vector<void *> Args;
+  std::vector<int64_t> ArgSizes;
+  int64_t *ArgTypes;
+
+  NowaitArgsTy(int32_t ArgNum, void **ArgsBase, void **Args,
+               int64_t *ArgSizes, int64_t *ArgTypes)
+      : ArgsBase(ArgsBase, ArgsBase + ArgNum), Args(Args, Args + ArgNum),
+        ArgSizes(ArgSizes, ArgSizes + ArgNum), ArgTypes(ArgTypes) {}
+};
+} // namespace
+
+static NowaitWorkerTy NowaitWorker;
+
+// Body of a nowait task with dependences, run once they are met
+static int32_t StartNowaitTask(int32_t gtid, void *Task) {
+  auto *Job = *(std::function<void()> **)((kmp_task_t *)Task)->shareds;
+  NowaitWorker.push(std::move(*Job));
+  delete Job;
+  return 0;
+}
+
+// Body of a nowait task without dependences, the construct was handed off
+// when the task was created
+static int32_t SkipNowaitTask(int32_t gtid, void *Task) { return 0; }
+
+// Trip count pushed by the encountering thread for its next region, the
+// region may run on the nowait worker
+static uint64_t TakeTripCount(int64_t device_id) {
+  uint64_t ltc = Devices[device_id].loopTripCnt;
+  Devices[device_id].loopTripCnt = 0;
+  return ltc;
+}
+
+/// Hands Fn off to the nowait worker once the dependences are met and
+/// returns right away. Returns false if Fn cannot be run asynchronously; the
+/// caller then runs the construct itself.
+static bool RunNowait(int32_t arg_num, int64_t *arg_types,
+    std::function<void()> Fn, int32_t depNum, void *depList,
+    int32_t noAliasDepNum, void *noAliasDepList) {
+  // The runtime type infos of nested mappings follow args on the stack of
+  // the encountering thread and are not copied
+  if (arg_num && (arg_types[0] & OMP_TGT_MAPTYPE_HAS_NESTED)) {
+    return false;
+  }
+  if (!__kmpc_global_thread_num || !__kmpc_omp_task_alloc ||
+      !__kmpc_omp_task || !__kmpc_omp_task_with_deps ||
+      !__kmpc_task_allow_completion_event || !omp_fulfill_event) {
+    return false;
+  }
+
+  bool HasDeps = depNum + noAliasDepNum > 0;
+  int32_t gtid = __kmpc_global_thread_num(NULL);
+  kmp_task_t *Task = __kmpc_omp_task_alloc(NULL, gtid,
+      KMP_TASK_TIED | KMP_TASK_DETACHABLE, sizeof(kmp_task_t),
+      sizeof(std::function<void()> *),
+      HasDeps ? StartNowaitTask : SkipNowaitTask);
+  if (!Task) {
+    return false;
+  }
+  void *Event = __kmpc_task_allow_completion_event(NULL, gtid, Task);
+  std::function<void()> Job = [Fn, Event]() {
+    Fn();
+    omp_fulfill_event(Event);
+  };
+
+  if (HasDeps) {
+    DP("Deferring nowait construct with %d dependences\n",
+       depNum + noAliasDepNum);
+    *(std::function<void()> **)Task->shareds =
+        new std::function<void()>(std::move(Job));
+    __kmpc_omp_task_with_deps(NULL, gtid, Task, depNum, depList,
+                              noAliasDepNum, noAliasDepList);
+  } else {
+    // The event may be fulfilled before the task runs, it then completes
+    // without detaching
+    __kmpc_omp_task(NULL, gtid, Task);
+    NowaitWorker.push(std::move(Job));
+  }
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// adds requires flags
 EXTERN void __tgt_register_requires(int64_t flags) {
@@ -104,9 +267,12 @@ EXTERN void __tgt_register_lib(__tgt_bin_desc *desc) {
 ////////////////////////////////////////////////////////////////////////////////
 /// unloads a target shared library
 EXTERN void __tgt_unregister_lib(__tgt_bin_desc *desc) {
-  if (Perf.isEnabled()) {
+  // Nowait constructs still running use the device images
+  NowaitWorker.drain();
+  if (Perf.Report) {
     PERF_WRAP(Perf.dump();)
   }
+  TOOL_WRAP(Tool.flushTraces();)
   RTLs.UnregisterLib(desc);
 }
 
@@ -147,8 +313,11 @@ EXTERN void __tgt_target_data_begin(int64_t device_id, int32_t arg_num,
   }
 #endif
 
+  TOOL_WRAP(Tool.beginTarget(tgt_tool_target_enter_data, device_id,
+      __builtin_return_address(0));)
   int rc = target_data_begin(Device, arg_num, args_base,
       args, arg_sizes, arg_types);
+  TOOL_WRAP(Tool.endTarget(tgt_tool_target_enter_data, device_id);)
   HandleTargetOutcome(rc == OFFLOAD_SUCCESS);
   PERF_WRAP(Perf.RTDataBegin.end();)
   PERF_WRAP(Perf.Runtime.end();)
@@ -158,11 +327,20 @@ EXTERN void __tgt_target_data_begin_nowait(int64_t device_id, int32_t arg_num,
     void **args_base, void **args, int64_t *arg_sizes, int64_t *arg_types,
     int32_t depNum, void *depList, int32_t noAliasDepNum,
     void *noAliasDepList) {
-  if (depNum + noAliasDepNum > 0)
-    __kmpc_omp_taskwait(NULL, 0);
+  if (IsOffloadDisabled()) return;
+  // The default device is an ICV of the encountering thread
+  if (device_id == OFFLOAD_DEVICE_DEFAULT) {
+    device_id = omp_get_default_device();
+  }
 
-  __tgt_target_data_begin(device_id, arg_num, args_base, args, arg_sizes,
-                          arg_types);
+  NowaitArgsTy A(arg_num, args_base, args, arg_sizes, arg_types);
+  if (!RunNowait(arg_num, arg_types, [device_id, arg_num, A]() mutable {
+        __tgt_target_data_begin(device_id, arg_num, A.ArgsBase.data(),
+                                A.Args.data(), A.ArgSizes.data(), A.ArgTypes);
+      }, depNum, depList, noAliasDepNum, noAliasDepList)) {
+    __tgt_target_data_begin(device_id, arg_num, args_base, args, arg_sizes,
+                            arg_types);
+  }
 }
 
 /// passes data from the target, releases target memory and destroys
@@ -204,8 +382,11 @@ EXTERN void __tgt_target_data_end(int64_t device_id, int32_t arg_num,
   }
 #endif
 
+  TOOL_WRAP(Tool.beginTarget(tgt_tool_target_exit_data, device_id,
+      __builtin_return_address(0));)
   int rc = target_data_end(Device, arg_num, args_base,
       args, arg_sizes, arg_types);
+  TOOL_WRAP(Tool.endTarget(tgt_tool_target_exit_data, device_id);)
   HandleTargetOutcome(rc == OFFLOAD_SUCCESS);
   PERF_WRAP(Perf.Runtime.end();)
 }
@@ -214,11 +395,19 @@ EXTERN void __tgt_target_data_end_nowait(int64_t device_id, int32_t arg_num,
     void **args_base, void **args, int64_t *arg_sizes, int64_t *arg_types,
     int32_t depNum, void *depList, int32_t noAliasDepNum,
     void *noAliasDepList) {
-  if (depNum + noAliasDepNum > 0)
-    __kmpc_omp_taskwait(NULL, 0);
+  if (IsOffloadDisabled()) return;
+  if (device_id == OFFLOAD_DEVICE_DEFAULT) {
+    device_id = omp_get_default_device();
+  }
 
-  __tgt_target_data_end(device_id, arg_num, args_base, args, arg_sizes,
-                        arg_types);
+  NowaitArgsTy A(arg_num, args_base, args, arg_sizes, arg_types);
+  if (!RunNowait(arg_num, arg_types, [device_id, arg_num, A]() mutable {
+        __tgt_target_data_end(device_id, arg_num, A.ArgsBase.data(),
+                              A.Args.data(), A.ArgSizes.data(), A.ArgTypes);
+      }, depNum, depList, noAliasDepNum, noAliasDepList)) {
+    __tgt_target_data_end(device_id, arg_num, args_base, args, arg_sizes,
+                          arg_types);
+  }
 }
 
 EXTERN void __tgt_target_data_update(int64_t device_id, int32_t arg_num,
@@ -240,8 +429,11 @@ EXTERN void __tgt_target_data_update(int64_t device_id, int32_t arg_num,
   PERF_WRAP(Perf.Runtime.start();)
   PERF_WRAP(Perf.RTDataUpdate.start();)
   DeviceTy& Device = Devices[device_id];
+  TOOL_WRAP(Tool.beginTarget(tgt_tool_target_update, device_id,
+      __builtin_return_address(0));)
   int rc = target_data_update(Device, arg_num, args_base,
       args, arg_sizes, arg_types);
+  TOOL_WRAP(Tool.endTarget(tgt_tool_target_update, device_id);)
   HandleTargetOutcome(rc == OFFLOAD_SUCCESS);
   PERF_WRAP(Perf.RTDataUpdate.end();)
   PERF_WRAP(Perf.Runtime.end();)
@@ -251,11 +443,20 @@ EXTERN void __tgt_target_data_update_nowait(
     int64_t device_id, int32_t arg_num, void **args_base, void **args,
     int64_t *arg_sizes, int64_t *arg_types, int32_t depNum, void *depList,
     int32_t noAliasDepNum, void *noAliasDepList) {
-  if (depNum + noAliasDepNum > 0)
-    __kmpc_omp_taskwait(NULL, 0);
+  if (IsOffloadDisabled()) return;
+  if (device_id == OFFLOAD_DEVICE_DEFAULT) {
+    device_id = omp_get_default_device();
+  }
 
-  __tgt_target_data_update(device_id, arg_num, args_base, args, arg_sizes,
-                           arg_types);
+  NowaitArgsTy A(arg_num, args_base, args, arg_sizes, arg_types);
+  if (!RunNowait(arg_num, arg_types, [device_id, arg_num, A]() mutable {
+        __tgt_target_data_update(device_id, arg_num, A.ArgsBase.data(),
+                                 A.Args.data(), A.ArgSizes.data(),
+                                 A.ArgTypes);
+      }, depNum, depList, noAliasDepNum, noAliasDepList)) {
+    __tgt_target_data_update(device_id, arg_num, args_base, args, arg_sizes,
+                             arg_types);
+  }
 }
 
 EXTERN int __tgt_target(int64_t device_id, void *host_ptr, int32_t arg_num,
@@ -275,6 +476,7 @@ EXTERN int __tgt_target(int64_t device_id, void *host_ptr, int32_t arg_num,
   }
 
   PERF_WRAP(Perf.Runtime.start();)
+  PERF_WRAP(PerfTraceTy::setRegion((uintptr_t)host_ptr);)
   PERF_WRAP(Perf.RTTarget.start();)
 #ifdef OMPTARGET_DEBUG
   for (int i=0; i<arg_num; ++i) {
@@ -284,10 +486,14 @@ EXTERN int __tgt_target(int64_t device_id, void *host_ptr, int32_t arg_num,
   }
 #endif
 
+  TOOL_WRAP(Tool.beginTarget(tgt_tool_target, device_id,
+      __builtin_return_address(0));)
   int rc = target(device_id, host_ptr, arg_num, args_base, args, arg_sizes,
       arg_types, 0, 0, false /*team*/);
+  TOOL_WRAP(Tool.endTarget(tgt_tool_target, device_id);)
   HandleTargetOutcome(rc == OFFLOAD_SUCCESS);
   PERF_WRAP(Perf.RTTarget.end();)
+  PERF_WRAP(PerfTraceTy::setRegion(0);)
   PERF_WRAP(Perf.Runtime.end();)
   return rc;
 }
@@ -296,11 +502,29 @@ EXTERN int __tgt_target_nowait(int64_t device_id, void *host_ptr,
     int32_t arg_num, void **args_base, void **args, int64_t *arg_sizes,
     int64_t *arg_types, int32_t depNum, void *depList, int32_t noAliasDepNum,
     void *noAliasDepList) {
-  if (depNum + noAliasDepNum > 0)
-    __kmpc_omp_taskwait(NULL, 0);
+  if (IsOffloadDisabled()) return OFFLOAD_FAIL;
+  if (device_id == OFFLOAD_DEVICE_DEFAULT) {
+    device_id = omp_get_default_device();
+  }
+  // Failures found here still let the caller run the host version
+  if (CheckDeviceAndCtors(device_id) != OFFLOAD_SUCCESS) {
+    DP("Failed to get device %" PRId64 " ready\n", device_id);
+    HandleTargetOutcome(false);
+    return OFFLOAD_FAIL;
+  }
 
-  return __tgt_target(device_id, host_ptr, arg_num, args_base, args, arg_sizes,
-                      arg_types);
+  NowaitArgsTy A(arg_num, args_base, args, arg_sizes, arg_types);
+  uint64_t ltc = TakeTripCount(device_id);
+  if (!RunNowait(arg_num, arg_types, [=]() mutable {
+        Devices[device_id].loopTripCnt = ltc;
+        __tgt_target(device_id, host_ptr, arg_num, A.ArgsBase.data(),
+                     A.Args.data(), A.ArgSizes.data(), A.ArgTypes);
+      }, depNum, depList, noAliasDepNum, noAliasDepList)) {
+    Devices[device_id].loopTripCnt = ltc;
+    return __tgt_target(device_id, host_ptr, arg_num, args_base, args,
+                        arg_sizes, arg_types);
+  }
+  return OFFLOAD_SUCCESS;
 }
 
 EXTERN int __tgt_target_teams(int64_t device_id, void *host_ptr,
@@ -321,6 +545,7 @@ EXTERN int __tgt_target_teams(int64_t device_id, void *host_ptr,
   }
 
   PERF_WRAP(Perf.Runtime.start();)
+  PERF_WRAP(PerfTraceTy::setRegion((uintptr_t)host_ptr);)
   PERF_WRAP(Perf.RTTarget.start();)
 #ifdef OMPTARGET_DEBUG
   for (int i=0; i<arg_num; ++i) {
@@ -330,11 +555,15 @@ EXTERN int __tgt_target_teams(int64_t device_id, void *host_ptr,
   }
 #endif
 
+  TOOL_WRAP(Tool.beginTarget(tgt_tool_target, device_id,
+      __builtin_return_address(0));)
   int rc = target(device_id, host_ptr, arg_num, args_base, args, arg_sizes,
       arg_types, team_num, thread_limit, true /*team*/);
+  TOOL_WRAP(Tool.endTarget(tgt_tool_target, device_id);)
   HandleTargetOutcome(rc == OFFLOAD_SUCCESS);
 
   PERF_WRAP(Perf.RTTarget.end();)
+  PERF_WRAP(PerfTraceTy::setRegion(0);)
   PERF_WRAP(Perf.Runtime.end();)
   PERF_WRAP(Perf.TargetMem.get(device_id);)
   return rc;
@@ -344,11 +573,29 @@ EXTERN int __tgt_target_teams_nowait(int64_t device_id, void *host_ptr,
     int32_t arg_num, void **args_base, void **args, int64_t *arg_sizes,
     int64_t *arg_types, int32_t team_num, int32_t thread_limit, int32_t depNum,
     void *depList, int32_t noAliasDepNum, void *noAliasDepList) {
-  if (depNum + noAliasDepNum > 0)
-    __kmpc_omp_taskwait(NULL, 0);
+  if (IsOffloadDisabled()) return OFFLOAD_FAIL;
+  if (device_id == OFFLOAD_DEVICE_DEFAULT) {
+    device_id = omp_get_default_device();
+  }
+  if (CheckDeviceAndCtors(device_id) != OFFLOAD_SUCCESS) {
+    DP("Failed to get device %" PRId64 " ready\n", device_id);
+    HandleTargetOutcome(false);
+    return OFFLOAD_FAIL;
+  }
 
-  return __tgt_target_teams(device_id, host_ptr, arg_num, args_base, args,
-                            arg_sizes, arg_types, team_num, thread_limit);
+  NowaitArgsTy A(arg_num, args_base, args, arg_sizes, arg_types);
+  uint64_t ltc = TakeTripCount(device_id);
+  if (!RunNowait(arg_num, arg_types, [=]() mutable {
+        Devices[device_id].loopTripCnt = ltc;
+        __tgt_target_teams(device_id, host_ptr, arg_num, A.ArgsBase.data(),
+                           A.Args.data(), A.ArgSizes.data(), A.ArgTypes,
+                           team_num, thread_limit);
+      }, depNum, depList, noAliasDepNum, noAliasDepList)) {
+    Devices[device_id].loopTripCnt = ltc;
+    return __tgt_target_teams(device_id, host_ptr, arg_num, args_base, args,
+                              arg_sizes, arg_types, team_num, thread_limit);
+  }
+  return OFFLOAD_SUCCESS;
 }
 
 
@@ -0,0 +1,119 @@
+// Per target region selection of the AT mode
+#include <cstdio>
+#include <cstdlib>
+
+#include "device.h"
+#include "private.h"
+
+ModeSelectorTy::ScopeTy::~ScopeTy() {
+  if (!Sel) {
+    return;
+  }
+  std::chrono::duration<double> Sec = std::chrono::steady_clock::now() - Start;
+  Sel->record(Name, Cand, Sec.count());
+}
+
+// The heap layout is fixed by the mode chosen at start up. Table lookup works
+// on any layout, mask and offset only on their own.
+void ModeSelectorTy::init(OpenMPOffloadingMode BaseMode, int NumTrials) {
+  Candidates.clear();
+  Candidates.push_back(BaseMode);
+  if (BaseMode != OMP_OFFMODE_AT_TABLE) {
+    Candidates.push_back(OMP_OFFMODE_AT_TABLE);
+  }
+  Trials = NumTrials > 0 ? NumTrials : 1;
+  if (char *envStr = getenv("OMP_AT_PROFILE")) {
+    ProfilePath = envStr;
+    load();
+  }
+  Enabled = true;
+}
+
+// Return the candidate for the next launch of region Name: the chosen one,
+// or the least tried one while trying
+int ModeSelectorTy::pick(const std::string &Name) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  RegionTy &R = Regions[Name];
+  if (R.Chosen >= 0) {
+    return R.Chosen;
+  }
+  if (R.Runs.size() != Candidates.size()) {
+    R.Runs.assign(Candidates.size(), 0);
+    R.Time.assign(Candidates.size(), 0);
+    R.Warm.assign(Candidates.size(), false);
+  }
+  int Best = 0;
+  for (size_t i = 1; i < Candidates.size(); i++) {
+    if (R.Runs[i] < R.Runs[Best]) {
+      Best = i;
+    }
+  }
+  return Best;
+}
+
+void ModeSelectorTy::record(const std::string &Name, int Cand, double Sec) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  RegionTy &R = Regions[Name];
+  if (R.Chosen >= 0 || Cand < 0 || (size_t)Cand >= R.Runs.size()) {
+    return;
+  }
+  // The first launch of a variant pays for its loading and the first
+  // transfers, it is not counted
+  if (!R.Warm[Cand]) {
+    R.Warm[Cand] = true;
+    return;
+  }
+  R.Runs[Cand]++;
+  R.Time[Cand] += Sec;
+  int Best = 0;
+  for (size_t i = 0; i < Candidates.size(); i++) {
+    if (R.Runs[i] < Trials) {
+      return;
+    }
+    if (R.Time[i] < R.Time[Best]) {
+      Best = i;
+    }
+  }
+  R.Chosen = Best;
+  DP("Region %s uses AT mode 0x%x, %lf s per launch\n", Name.c_str(),
+     Candidates[Best], R.Time[Best] / Trials);
+  save();
+}
+
+// Profile lines are "<region name> <mode>"
+void ModeSelectorTy::load() {
+  FILE *F = fopen(ProfilePath.c_str(), "r");
+  if (!F) {
+    return;
+  }
+  char Name[1024];
+  int Mode;
+  while (fscanf(F, "%1023s %i", Name, &Mode) == 2) {
+    for (size_t i = 0; i < Candidates.size(); i++) {
+      if (Candidates[i] == Mode) {
+        Regions[Name].Chosen = i;
+        break;
+      }
+    }
+  }
+  fclose(F);
+  DP("Loaded %zu region AT modes from %s\n", Regions.size(),
+     ProfilePath.c_str());
+}
+
+void ModeSelectorTy::save() {
+  if (ProfilePath.empty()) {
+    return;
+  }
+  FILE *F = fopen(ProfilePath.c_str(), "w");
+  if (!F) {
+    DP("Cannot write AT mode profile %s\n", ProfilePath.c_str());
+    return;
+  }
+  for (auto &R : Regions) {
+    if (R.second.Chosen >= 0) {
+      fprintf(F, "%s %d\n", R.first.c_str(), Candidates[R.second.Chosen]);
+    }
+  }
+  fclose(F);
+}
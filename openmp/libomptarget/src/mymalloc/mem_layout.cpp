@@ -10,8 +10,6 @@
 
 #include "mmprivate.h"
 
-ssize_t readline(char *buf, size_t sz, int fd, off_t *offset);
-
 // credit:
 // https://stackoverflow.com/questions/36523584/how-to-see-memory-layout-of-my-program-in-c-during-run-time/36524010#36524010
 
@@ -174,117 +172,25 @@ static int trailing_zeros(uintptr_t indexs) {
   return count;
 }
 
-int if_overlaped(int mapfd, intptr_t begin, intptr_t end) {
-#define LINE_BUFSZ 128
-  size_t size = 0;
-  char line[LINE_BUFSZ];
-  off_t offset = 0;
-  ssize_t len = 0;
-  size_t i = 0;
-  int overlaped = 0;
-  int count = 0;
-  while (readline(line, LINE_BUFSZ, mapfd, &offset) > 0) {
-    address_range curr;
-    char perms[8];
-    unsigned int devmajor, devminor;
-    uintptr_t addr_start, addr_end, offset, inode;
-
-    int matched_count =
-        sscanf(line, "%lx-%lx %7s %lx %x:%x %lu %s", &addr_start, &addr_end,
-               perms, &offset, &devmajor, &devminor, &inode, curr.name);
-    if (matched_count < 7) {
-      return -1;
-    }
-    // check overlap here
-
-    count++;
-    if ((uintptr_t)addr_end <= begin) {
-      continue;
-    }
-    if ((uintptr_t)addr_end >= end) {
-      break;
-    }
-    overlaped = 1;
-    break;
-  }
-  if (overlaped == 1) {
-    return 1;
-  }
-  return 0;
-}
-
-// implement without malloc
+// Reserve the first free window below the top of user space, the window
+// stays reserved with PROT_NONE and heaps commit sub-ranges of it
+// pid is kept for the interface, the search does not read /proc
 intptr_t find_mem_hole(pid_t pid) {
-  char namebuf[128];
-  int mapfd;
-
-  if (pid > 0) {
-    int namelen = 0;
-    namelen = snprintf(namebuf, sizeof namebuf, "/proc/%ld/maps", (long)pid);
-    if (namelen < 12) {
-      puts("snprintf");
-      return -1;
-    }
-  } else {
-    return -1;
-  }
-  mapfd = open(namebuf, O_RDONLY, 0);
-  if (mapfd == -1) {
-    puts("open");
-    return -1;
-  }
   intptr_t indexs = user_ub & _omp_header_mask;
   intptr_t size = ~_omp_header_mask + 1;
   int trailing0 = trailing_zeros(indexs);
   int index_ub = indexs >> trailing0;
 
-  // Search from low address, high address like to be heap
-  for (intptr_t i = index_ub - 0x20; i >= 0; i--) {
-    // for (intptr_t i = 1; i < index_ub; i++) {
-    lseek(mapfd, 0, SEEK_SET);
+  // Search from high address, window 0 starts at the null page
+  for (intptr_t i = index_ub - 0x20; i > 0; i--) {
     intptr_t begin = i << trailing0;
-    intptr_t end = begin + size;
-    int ret = if_overlaped(mapfd, begin, end);
-    if (ret == 0) {
+    if (mmap_window_reserve((void *)begin, size) == 0) {
       //_omp_h2dmask |= begin; //
       _omp_d2hmask |= begin;
       _omp_check_mask = begin;
-      close(mapfd);
       return begin;
-    } else if (ret < 0) {
-      puts("if_overlaped");
-      return -1; // failed
     }
   }
   puts("No result");
   return -1;
 }
-
-// credit
-// https://stackoverflow.com/questions/33106505/read-file-line-by-line-in-c-mostly-with-syscalls
-ssize_t readline(char *buf, size_t sz, int fd, off_t *offset) {
-  ssize_t nchr = 0;
-  ssize_t idx = 0;
-  char *p = NULL;
-  /* position fd & read line */
-  if ((nchr = lseek(fd, *offset, SEEK_SET)) != -1)
-    nchr = read(fd, buf, sz);
-
-  if (nchr == -1) { /* read error   */
-    return nchr;
-  }
-  /* end of file - no chars read
-  (not an error, but return -1 )*/
-  if (nchr == 0)
-    return -1;
-  p = buf; /* check each chacr */
-  while (idx < nchr && *p != '\n')
-    p++, idx++;
-  *p = 0;
-  if (idx == nchr) { /* newline not found  */
-    *offset += nchr;
-    return nchr < (ssize_t)sz ? nchr : 0;
-  }
-  *offset += idx + 1;
-  return idx;
-}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -19,6 +20,33 @@ static uintptr_t page_mask;
 
 static struct mmap_region *list;
 
+// Huge page mode
+// Address space is reserved up front with PROT_NONE and registering a range
+// only commits it with mprotect, rounded to huge pages. OMP_HUGEPAGE=thp
+// uses transparent huge pages, OMP_HUGEPAGE=hugetlb uses MAP_HUGETLB.
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+#define HUGE_PAGE_SIZE (2UL << 20)
+#define HUGE_PAGE_MASK (~(HUGE_PAGE_SIZE - 1))
+#define DEFAULT_RESERVE_SIZE (1UL << 30)
+
+enum { HUGE_NONE, HUGE_THP, HUGE_TLB };
+static int huge_mode = HUGE_NONE;
+static size_t reserve_size = DEFAULT_RESERVE_SIZE;
+// Reserved windows sorted by address, regions are not tracked in this mode
+static struct mmap_region *reserved;
+
+// Window reserved by find_mem_hole, committed ranges inside it can grow by
+// mapping over the reservation
+static uintptr_t window_begin;
+static uintptr_t window_end;
+
+static int init();
+
 static int insert_new_region(void *begin, size_t size, mmap_region *pos) {
   // mmap
   uintptr_t align_begin = (uintptr_t)begin & page_mask;
@@ -56,7 +84,16 @@ static int extend_region(void *begin, size_t size, mmap_region *target) {
   size_t new_region_size = new_align_end - align_begin;
   size_t region_size = (uintptr_t)target->end - align_begin;
 
-  void *ret = mremap((void *)align_begin, region_size, new_region_size, 0);
+  void *ret;
+  if (align_begin >= window_begin && new_align_end <= window_end) {
+    // The tail is still reserved, mremap would find it taken
+    uintptr_t old_end = (uintptr_t)target->end;
+    ret = mmap((void *)old_end, new_align_end - old_end,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  } else {
+    ret = mremap((void *)align_begin, region_size, new_region_size, 0);
+  }
   if (ret == (void *)-1) {
     perror("");
     return -1;
@@ -65,14 +102,147 @@ static int extend_region(void *begin, size_t size, mmap_region *target) {
   return 0;
 }
 
+// Map [begin, end) with PROT_NONE, fail if any of it is already mapped
+static void *map_none(uintptr_t begin, uintptr_t end, bool hugetlb) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE;
+  if (hugetlb) {
+    flags |= MAP_HUGETLB;
+  }
+  void *ret = mmap((void *)begin, end - begin, PROT_NONE, flags, -1, 0);
+  if (ret == (void *)-1) {
+    return NULL;
+  }
+  if (ret != (void *)begin) {
+    // Kernel without MAP_FIXED_NOREPLACE took it as a hint
+    munmap(ret, end - begin);
+    return NULL;
+  }
+  if (huge_mode == HUGE_THP) {
+    madvise(ret, end - begin, MADV_HUGEPAGE);
+  }
+  return ret;
+}
+
+// Reserve a window starting at begin, clipped before the next reservation
+static mmap_region *reserve_window(uintptr_t begin, uintptr_t end,
+                                   mmap_region *pos) {
+  uintptr_t win_end = begin + reserve_size;
+  if (win_end < end) {
+    win_end = (end + HUGE_PAGE_SIZE - 1) & HUGE_PAGE_MASK;
+  }
+  mmap_region *next = pos ? pos->next : reserved;
+  if (next && win_end > (uintptr_t)next->begin) {
+    win_end = (uintptr_t)next->begin;
+  }
+  void *ret = map_none(begin, win_end, huge_mode == HUGE_TLB);
+  if (!ret) {
+    return NULL;
+  }
+  mmap_region *r = (mmap_region *)mallocp(sizeof(mmap_region));
+  r->begin = ret;
+  r->end = (void *)win_end;
+  r->ref_count = 1;
+  if (pos) {
+    r->next = pos->next;
+    pos->next = r;
+  } else {
+    r->next = reserved;
+    reserved = r;
+  }
+  return r;
+}
+
+// Commit [begin, begin + size), reserving more windows as needed
+static int huge_region_register(void *begin, size_t size) {
+  uintptr_t cur = (uintptr_t)begin & HUGE_PAGE_MASK;
+  uintptr_t end = ((uintptr_t)begin + size + HUGE_PAGE_SIZE - 1) &
+                  HUGE_PAGE_MASK;
+  mmap_region *pos = NULL;
+  mmap_region *r = reserved;
+  while (cur < end) {
+    while (r && (uintptr_t)r->end <= cur) {
+      pos = r;
+      r = r->next;
+    }
+    if (!r || (uintptr_t)r->begin > cur) {
+      r = reserve_window(cur, end, pos);
+      if (!r) {
+        return -1;
+      }
+    }
+    uintptr_t commit_end = end < (uintptr_t)r->end ? end : (uintptr_t)r->end;
+    if (mprotect((void *)cur, commit_end - cur, PROT_READ | PROT_WRITE)) {
+      perror("mprotect");
+      return -1;
+    }
+    cur = commit_end;
+  }
+  return 0;
+}
+
+// Also called from mmap_window_reserve, which may run first
 __attribute__((constructor)) static int init() {
+  if (page_size) {
+    return 0;
+  }
   page_size = getpagesize();
   page_mask = ~((uintptr_t)page_size - 1);
+  if (char *env = getenv("OMP_HUGEPAGE")) {
+    huge_mode = strcmp(env, "hugetlb") ? HUGE_THP : HUGE_TLB;
+    if (char *env_size = getenv("OMP_HUGEPAGE_RESERVE")) {
+      // Window size in bytes reserved at a time
+      reserve_size = (atol(env_size) + HUGE_PAGE_SIZE - 1) & HUGE_PAGE_MASK;
+      if (!reserve_size) {
+        reserve_size = DEFAULT_RESERVE_SIZE;
+      }
+    }
+  }
+  return 0;
+}
+
+int mmap_window_reserve(void *begin, size_t size) {
+  init();
+  uintptr_t end = (uintptr_t)begin + size;
+  if (huge_mode == HUGE_TLB) {
+    // hugetlb windows are reserved as heaps grow, only check the range is
+    // free now
+    void *ret = map_none((uintptr_t)begin, end, false);
+    if (!ret) {
+      return 1;
+    }
+    munmap(ret, size);
+    return 0;
+  }
+  void *ret = map_none((uintptr_t)begin, end, false);
+  if (!ret) {
+    return 1;
+  }
+  window_begin = (uintptr_t)begin;
+  window_end = end;
+  if (huge_mode == HUGE_THP) {
+    // Commit by mprotect like any other reservation
+    mmap_region *r = (mmap_region *)mallocp(sizeof(mmap_region));
+    r->begin = ret;
+    r->end = (void *)end;
+    r->ref_count = 1;
+    mmap_region **pos = &reserved;
+    while (*pos && (*pos)->begin < ret) {
+      pos = &(*pos)->next;
+    }
+    r->next = *pos;
+    *pos = r;
+  }
   return 0;
 }
 
 int mmap_region_register(void *begin, size_t size) {
   // static size_t dummy = init();
+  if (huge_mode != HUGE_NONE) {
+    if (!huge_region_register(begin, size)) {
+      return 0;
+    }
+    // Range is taken by a foreign mapping, use normal pages
+  }
   // TODO merge neighbor region
   int found = 0;
   mmap_region *pos = NULL;
@@ -4,6 +4,9 @@
 // mmap_mgr.h
 extern int mmap_region_register(void *begin, size_t size);
 extern void mmap_region_dump();
+// Reserve [begin, begin + size) with PROT_NONE, return non-zero if any of it
+// is already mapped
+extern int mmap_window_reserve(void *begin, size_t size);
 
 #include <inttypes.h>
 #include <stdlib.h>
@@ -1,5 +1,8 @@
+#include <atomic>
 #include <dlfcn.h>
+#include <fcntl.h>
 #include <inttypes.h>
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,8 +49,37 @@
 
 typedef struct blk_hdr {
   size_t size;
+  unsigned int context_id; // owner context, checked before recycling
 } __attribute__((aligned(ALIGNMENT))) blk_hdr_t;
 
+// Thread-local arenas
+// Each thread carves ARENA_CHUNK_SZ chunks out of the current context heap
+// under heap_lock and serves small requests from them without locking.
+// Freed small blocks go to per-thread bins, one per 16-byte size class.
+#define ARENA_CHUNK_SZ (64 * 1024)
+#define SMALL_MAX 1024
+#define MIN_BLK_SZ (2 * HEADER_SIZE)
+#define NUM_BINS (SMALL_MAX >> ALIGN_SHIFT)
+#define BIN_INDEX(size) (((size) >> ALIGN_SHIFT) - 1)
+
+typedef struct free_blk {
+  blk_hdr_t hdr;
+  struct free_blk *next;
+} free_blk_t;
+
+typedef struct arena {
+  mm_context_t *context; // arena is dropped when the context changes
+  unsigned int release_count; // or when the context is released
+  char *cur;
+  char *end;
+  free_blk_t *bins[NUM_BINS];
+  char busy; // set while holding heap_lock, nested mallocs use default
+} arena_t;
+
+// initial-exec so that TLS access never calls malloc
+static __thread arena_t tl_arena __attribute__((tls_model("initial-exec")));
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static size_t pg_size;
 static char pg_shift = 0;
 static uintptr_t pg_mask = 0;
@@ -62,6 +94,26 @@ static bool IsOffsetEnabled = false;
 
 static bool using_uvm = false;
 static bool FixedHeap = false;
+static bool PinHeap = false;
+
+// Ranges registered by pin_range, unregistered by mymalloc_unpin_all
+typedef struct pinned_range {
+  void *begin;
+  size_t size;
+  struct RTLInfoTy *RTL;
+  int64_t device_id;
+} pinned_range_t;
+static pinned_range_t *pinned = NULL;
+static size_t pinned_count = 0;
+static size_t pinned_cap = 0;
+
+// Dirty page tracking with the kernel soft-dirty bits
+// Bits are folded into the per-heap dirty maps before every clear, since
+// clear_refs resets the whole process.
+#define PM_SOFT_DIRTY (1ULL << 55)
+static bool DirtyTrack = false;
+static int pagemap_fd = -1;
+static int clear_refs_fd = -1;
 
 // pointer to default allocators
 void *(*mallocp)(size_t size) = NULL;
@@ -74,6 +126,7 @@ static void *(*myreallocp)(void *ptr, size_t size) = NULL;
 static void (*myfreep)(void *) = NULL;
 
 static mm_context_t contexts[10];
+static std::atomic<uint64_t> heap_generation(1);
 
 static void *myrealloc(void *ptr, size_t size);
 static void *mymalloc(size_t size);
@@ -93,7 +146,9 @@ static int is_myspace(void *ptr) {
   return !(index ^ _omp_check_mask);
 }
 void mymalloc_begin(int64_t device_id) {
+  pthread_mutex_lock(&heap_lock);
   context_create(device_id);
+  pthread_mutex_unlock(&heap_lock);
   use_default = 0;
 }
 void mymalloc_end() {
@@ -131,6 +186,28 @@ void *calloc(size_t count, size_t size) {
 #endif
 
 // warning dlsym calls memory allocation
+// The files exist without CONFIG_MEM_SOFT_DIRTY, but the bit is never set.
+// Clear the bits, write a probe page and check that it reads back dirty.
+static bool probe_soft_dirty() {
+  long page = sysconf(_SC_PAGESIZE);
+  char *probe = (char *)mmap(NULL, page, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (probe == MAP_FAILED) {
+    return false;
+  }
+  probe[0] = 1;
+  uint64_t entry = 0;
+  bool ok = write(clear_refs_fd, "4", 1) == 1;
+  if (ok) {
+    probe[0] = 2;
+    off_t off = ((uintptr_t)probe / page) * sizeof(uint64_t);
+    ok = pread(pagemap_fd, &entry, sizeof(entry), off) == sizeof(entry) &&
+         (entry & PM_SOFT_DIRTY);
+  }
+  munmap(probe, page);
+  return ok;
+}
+
 __attribute__((constructor)) static void init() {
   // static void init() {
   // puts("mmminit");
@@ -191,11 +268,72 @@ __attribute__((constructor)) static void init() {
   } else if (getenv("OMP_MASK")) {
     IsMaskEnabled = true;
   }
+  if (getenv("OMP_PIN_HEAP")) {
+    PinHeap = true;
+  }
+  if (getenv("OMP_DIRTY_HEAP")) {
+    pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+    clear_refs_fd = open("/proc/self/clear_refs", O_WRONLY);
+    if (pagemap_fd >= 0 && clear_refs_fd >= 0 && probe_soft_dirty()) {
+      DirtyTrack = true;
+    } else {
+      fprintf(stderr, "[omp-dc] Soft-dirty tracking unavailable\n");
+    }
+  }
   inited = 1;
 }
 
 #define DEFAULT_BLOCK_SZ 2
 
+// Page-lock a new heap range so its transfers skip the driver staging copy
+static void pin_range(void *begin, size_t size) {
+  if (!PinHeap || !curr_context->RTL->register_host) {
+    return;
+  }
+  int32_t ret = curr_context->RTL->register_host(curr_context->device_id,
+      begin, size);
+  if (ret) {
+    DP2("Pin heap %p-%p failed\n", begin, (char *)begin + size);
+    return;
+  }
+  if (pinned_count == pinned_cap) {
+    size_t cap = pinned_cap ? pinned_cap * 2 : 16;
+    pinned_range_t *grown =
+        (pinned_range_t *)reallocp(pinned, cap * sizeof(pinned_range_t));
+    if (!grown) {
+      // Keep it pinned for the process lifetime rather than lose track
+      return;
+    }
+    pinned = grown;
+    pinned_cap = cap;
+  }
+  pinned[pinned_count++] = {begin, size, curr_context->RTL,
+                            curr_context->device_id};
+}
+
+void mymalloc_unpin_all() {
+  for (size_t i = 0; i < pinned_count; i++) {
+    pinned_range_t &r = pinned[i];
+    if (r.RTL->unregister_host &&
+        r.RTL->unregister_host(r.device_id, r.begin)) {
+      DP2("Unpin heap %p-%p failed\n", r.begin, (char *)r.begin + r.size);
+    }
+  }
+  pinned_count = 0;
+}
+
+// Whether some of [begin, end) is page-locked. madvise would give the pinned
+// pages new frames that the device does not see.
+static bool is_pinned(uintptr_t begin, uintptr_t end) {
+  for (size_t i = 0; i < pinned_count; i++) {
+    uintptr_t pbegin = (uintptr_t)pinned[i].begin;
+    if (begin < pbegin + pinned[i].size && pbegin < end) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // pre and next are uninited
 // Allocate new heap and init first block
 static heap_t *new_heap(int page_count) {
@@ -204,6 +342,8 @@ static heap_t *new_heap(int page_count) {
   }
   heap_t *ret = (heap_t *)mallocp(sizeof(heap_t));
   ret->tbegin = NULL;
+  ret->dirty = NULL;
+  ret->tracked_pages = 0;
   ret->page_count = page_count;
   size_t size = page_count * PAGE_SIZE;
   void *get_new = NULL;
@@ -229,6 +369,12 @@ static heap_t *new_heap(int page_count) {
   ret->begin = get_new;
   ret->next_free = ret->begin;
   ret->end = (void *)((char *)ret->begin + size);
+  if (IsMaskEnabled) {
+    // Mapped from the start, so AT table lookups also find it
+    ret->tbegin = (void *)_MYMALLOC_H2D(get_new);
+    heap_generation++;
+  }
+  pin_range(ret->begin, size);
   // init first blk
   blk_hdr_t *first_blk = (blk_hdr_t *)ret->begin;
   first_blk->size = (uintptr_t)ret->end - (uintptr_t)ret->begin;
@@ -256,7 +402,10 @@ void *enlarge_heap(int page_count) {
     puts("mmap_region_register failed");
     exit(90);
   }
+  pin_range(end, size);
   end += size;
+  // Heap bounds and offsets sent to the device are stale
+  heap_generation++;
   return (void*)end;
 }
 
@@ -297,6 +446,8 @@ static blk_hdr_t *find_next_fit(size_t size) {
     } else {
       new_end = enlarge_heap(0); //
     }
+    PERF_WRAP(Perf.HeapGrow.add((uintptr_t)new_end -
+                                (uintptr_t)curr_heap->end);)
     curr_heap->end = new_end;
     // expand the last blk
     blk_hdr_t *last_blk = (blk_hdr_t *)curr_heap->next_free;
@@ -321,6 +472,8 @@ static blk_hdr_t *find_next_fit(size_t size) {
     // Error oom
     return NULL;
   }
+  PERF_WRAP(Perf.HeapGrow.add((uintptr_t)heap_new->end -
+                              (uintptr_t)heap_new->begin);)
   heap_new->next = curr_heap->next;
   heap_new->pre = curr_heap;
   curr_heap->next = heap_new;
@@ -355,7 +508,11 @@ void context_create(int64_t device_id) {
       puts("mmap_region_register failed");
       exit(91);
     }
+    pin_range(begin, size);
     heap_new = (heap_t*) mallocp(sizeof(heap_t));
+    heap_new->tbegin = NULL;
+    heap_new->dirty = NULL;
+    heap_new->tracked_pages = 0;
     heap_new->begin = begin;
     heap_new->next_free = begin;
     heap_new->end = (void *)((char *)begin + size);
@@ -368,75 +525,183 @@ void context_create(int64_t device_id) {
   heap_new->next = heap_new;
   curr_context->heap_list = heap_new;
   curr_heap = curr_context->heap_list;
-  curr_heap->tbegin = NULL;
+  heap_generation++;
   DP2("Create new mm context #%d\n", curr_context->id);
 }
 
+// Slow path, take a block from the shared context heap
+static blk_hdr_t *heap_alloc_blk(size_t blk_size) {
+  pthread_mutex_lock(&heap_lock);
+  tl_arena.busy = 1;
+  blk_hdr_t *found = find_next_fit(blk_size);
+  if (found) {
+    found->size |= 1;
+    found->context_id = curr_context->id;
+  }
+  tl_arena.busy = 0;
+  pthread_mutex_unlock(&heap_lock);
+  if (!found) {
+    puts("malloc failed");
+    exit(87);
+  }
+  return found;
+}
+
+static void arena_push(arena_t *a, blk_hdr_t *blk, size_t blk_size) {
+  free_blk_t *b = (free_blk_t *)blk;
+  b->hdr.size = blk_size;
+  b->next = a->bins[BIN_INDEX(blk_size)];
+  a->bins[BIN_INDEX(blk_size)] = b;
+}
+
 static void *mymalloc(size_t size) {
-  if (use_default) {
+  arena_t *a = &tl_arena;
+  if (use_default || a->busy) {
     return dlmalloc(size);
   }
-  use_default |= 2;
   size_t blk_size = ALIGN(size + HEADER_SIZE);
-  if (blk_size == 0) {
+  if (blk_size < size) {
     return NULL;
   }
-  blk_hdr_t *found = find_next_fit(blk_size);
-  if (found) {
-    // printf("find_next_fit: %p 0x%zx\n", found, found->size);
+  if (blk_size > SMALL_MAX) {
+    return (char *)heap_alloc_blk(blk_size) + HEADER_SIZE;
+  }
+  if (blk_size < MIN_BLK_SZ) {
+    blk_size = MIN_BLK_SZ;
+  }
+
+  if (a->context != curr_context ||
+      a->release_count != curr_context->release_count) {
+    memset(a, 0, sizeof(arena_t));
+    a->context = curr_context;
+    a->release_count = curr_context->release_count;
+  }
+  blk_hdr_t *blk;
+  free_blk_t **bin = &a->bins[BIN_INDEX(blk_size)];
+  if (*bin) {
+    blk = &(*bin)->hdr;
+    *bin = (*bin)->next;
   } else {
-    puts("malloc failed");
-    exit(87);
+    if ((size_t)(a->end - a->cur) < blk_size) {
+      // Keep the tail of the old chunk if it fits a bin
+      size_t rest = a->end - a->cur;
+      if (rest >= MIN_BLK_SZ) {
+        arena_push(a, (blk_hdr_t *)a->cur, rest);
+      }
+      blk_hdr_t *chunk = heap_alloc_blk(ARENA_CHUNK_SZ);
+      a->cur = (char *)chunk + HEADER_SIZE;
+      a->end = (char *)chunk + (chunk->size & ~1L);
+    }
+    blk = (blk_hdr_t *)a->cur;
+    a->cur += blk_size;
   }
-  found->size |= 1;
-  use_default &= ~(unsigned char)2;
-  return (char *)found + HEADER_SIZE;
+  blk->size = blk_size | 1;
+  blk->context_id = curr_context->id;
+  return (char *)blk + HEADER_SIZE;
 }
-// FIXME
+
+// Is blk a large block of the current heap that ends at next_free
+// Needs heap_lock
+static bool is_tail_blk(blk_hdr_t *blk, size_t blk_size) {
+  return blk_size > SMALL_MAX && blk->context_id == curr_context->id &&
+         (void *)blk >= curr_heap->begin && (void *)blk < curr_heap->end &&
+         (char *)blk + blk_size == (char *)curr_heap->next_free;
+}
+
+// Give a large block at the tail of the current heap back to next_free
+static void heap_free_tail(blk_hdr_t *blk, size_t blk_size) {
+  pthread_mutex_lock(&heap_lock);
+  if (is_tail_blk(blk, blk_size)) {
+    if (curr_heap->next_free < curr_heap->end) {
+      blk_size += ((blk_hdr_t *)curr_heap->next_free)->size;
+    }
+    blk->size = blk_size;
+    curr_heap->next_free = blk;
+  }
+  pthread_mutex_unlock(&heap_lock);
+}
+
+// Grow a large block at the tail of the current heap into the free block at
+// next_free, return false if it is not the tail or there is no room
+static bool heap_grow_tail(blk_hdr_t *blk, size_t blk_size, size_t new_size) {
+  bool grown = false;
+  pthread_mutex_lock(&heap_lock);
+  if (is_tail_blk(blk, blk_size) && curr_heap->next_free < curr_heap->end) {
+    blk_hdr_t *next = (blk_hdr_t *)curr_heap->next_free;
+    size_t need = new_size - blk_size;
+    // Same split rule as find_next_fit, the rest keeps a header
+    if (need + HEADER_SIZE < next->size) {
+      blk_hdr_t *rest = (blk_hdr_t *)((char *)blk + new_size);
+      rest->size = next->size - need;
+      curr_heap->next_free = rest;
+      blk->size = new_size | 1;
+      grown = true;
+    }
+  }
+  pthread_mutex_unlock(&heap_lock);
+  return grown;
+}
+
 static void myfree(void *ptr) {
   if (!is_myspace(ptr)) {
     freep(ptr);
+    return;
   }
-  // TODO implement free
-  // cuMemFree((CUdeviceptr)((uintptr_t)ptr | _omp_h2dmask));
+  // Small blocks of the current context are recycled, large ones only when
+  // they are the last block before next_free, others stay until the context
+  // is released
+  arena_t *a = &tl_arena;
+  blk_hdr_t *blk = (blk_hdr_t *)((char *)ptr - HEADER_SIZE);
+  size_t blk_size = blk->size & ~1L;
+  if (use_default || a->busy || blk->context_id != curr_context->id) {
+    return;
+  }
+  if (blk_size > SMALL_MAX) {
+    heap_free_tail(blk, blk_size);
+    return;
+  }
+  if (a->context != curr_context ||
+      a->release_count != curr_context->release_count) {
+    return;
+  }
+  arena_push(a, blk, blk_size);
 }
 
 static void *myrealloc(void *ptr, size_t size) {
-  exit(99);
-  if (is_myspace(ptr)) {
-    if (use_default) {
-      blk_hdr_t *blk = (blk_hdr_t *)((char *)ptr - HEADER_SIZE);
-      void *ret = dlmalloc(size);
-      int copy_size = size > blk->size ? blk->size : size;
-      memcpy(ret, ptr, copy_size);
-      myfree(ptr);
-      return ret;
-    } else {
-      goto my;
-    }
-  } else {
+  if (!ptr) {
+    return use_default ? dlmalloc(size) : mymalloc(size);
+  }
+  if (!is_myspace(ptr)) {
     if (use_default) {
       return dlrealloc(ptr, size);
-    } else {
-      goto my;
     }
-  }
-my:
-  void *ret;
-  if (!is_myspace(ptr)) {
+    // Move the block into the context heap
     void *tmp_ptr = dlrealloc(ptr, size);
-    ret = mymalloc(size);
+    void *ret = mymalloc(size);
     memcpy(ret, tmp_ptr, size);
     freep(tmp_ptr);
     return ret;
   }
-  exit(88);
-  /*
-  ret = mymalloc(size);
-  size_t old_size = head->size;
-  memcpy(ret, ptr, old_size);
+
+  blk_hdr_t *blk = (blk_hdr_t *)((char *)ptr - HEADER_SIZE);
+  size_t blk_size = blk->size & ~1L;
+  size_t old_size = blk_size - HEADER_SIZE;
+  if (!use_default) {
+    if (size <= old_size) {
+      return ptr;
+    }
+    // std::vector style growth of the last block needs no copy
+    size_t new_size = ALIGN(size + HEADER_SIZE);
+    if (new_size > size && heap_grow_tail(blk, blk_size, new_size)) {
+      return ptr;
+    }
+  }
+  void *ret = use_default ? dlmalloc(size) : mymalloc(size);
+  if (!ret) {
+    return NULL;
+  }
+  memcpy(ret, ptr, size > old_size ? old_size : size);
   myfree(ptr);
-  */
   return ret;
 }
 
@@ -468,12 +733,110 @@ static void *dlcalloc(size_t count, size_t size) {
   return callocp(count, size);
 }
 
+static size_t heap_pages(heap_t *h) {
+  uintptr_t first = (uintptr_t)h->begin >> pg_shift;
+  uintptr_t last = ((uintptr_t)h->end - 1) >> pg_shift;
+  return last - first + 1;
+}
+
+// Fold the kernel soft-dirty bits into the dirty maps, then clear them
+static void collect_dirty() {
+  uint64_t entries[512];
+  for (int i = 0; i < context_count; i++) {
+    heap_t *first = contexts[i].heap_list;
+    heap_t *curr = first;
+    do {
+      size_t pages = curr->tracked_pages;
+      off_t base = ((uintptr_t)curr->begin >> pg_shift) * sizeof(uint64_t);
+      for (size_t p = 0; curr->dirty && p < pages; p += 512) {
+        size_t n = pages - p < 512 ? pages - p : 512;
+        ssize_t got = pread(pagemap_fd, entries, n * sizeof(uint64_t),
+            base + p * sizeof(uint64_t));
+        if (got != (ssize_t)(n * sizeof(uint64_t))) {
+          // Be safe and send everything
+          memset(curr->dirty + p, 1, pages - p);
+          break;
+        }
+        for (size_t j = 0; j < n; j++) {
+          if (entries[j] & PM_SOFT_DIRTY) {
+            curr->dirty[p + j] = 1;
+          }
+        }
+      }
+      curr = curr->next;
+    } while (curr != first);
+  }
+  if (write(clear_refs_fd, "4", 1) != 1) {
+    DP2("clear_refs failed, disable dirty tracking\n");
+    DirtyTrack = false;
+  }
+}
+
+// Reset the dirty maps of a context after host and device agree
+static void reset_dirty(mm_context_t *c) {
+  collect_dirty();
+  heap_t *first = c->heap_list;
+  heap_t *curr = first;
+  do {
+    size_t pages = heap_pages(curr);
+    if (curr->tracked_pages != pages) {
+      freep(curr->dirty);
+      curr->dirty = (unsigned char *)mallocp(pages);
+      curr->tracked_pages = curr->dirty ? pages : 0;
+    }
+    if (curr->dirty) {
+      memset(curr->dirty, 0, pages);
+    }
+    curr = curr->next;
+  } while (curr != first);
+}
+
+// Send the dirty pages of a heap in runs, clipped to [begin, next_free)
+static int32_t submit_dirty(mm_context_t *c, heap_t *h, void *tbegin,
+                            unsigned int *count) {
+  uintptr_t page_base = (uintptr_t)h->begin & pg_mask;
+  uintptr_t hbegin = (uintptr_t)h->begin;
+  uintptr_t hend = (uintptr_t)h->next_free;
+  size_t pages = heap_pages(h);
+  size_t p = 0;
+  while (p < pages) {
+    if (p < h->tracked_pages && !h->dirty[p]) {
+      p++;
+      continue;
+    }
+    size_t q = p + 1;
+    while (q < pages && (q >= h->tracked_pages || h->dirty[q])) {
+      q++;
+    }
+    uintptr_t b = page_base + (p << pg_shift);
+    uintptr_t e = page_base + (q << pg_shift);
+    b = b < hbegin ? hbegin : b;
+    e = e > hend ? hend : e;
+    if (b >= hend) {
+      break;
+    }
+    if (b < e) {
+      int32_t ret = c->RTL->data_submit(c->device_id,
+          (char *)tbegin + (b - hbegin), (void *)b, e - b);
+      if (ret) {
+        return ret;
+      }
+      (*count)++;
+    }
+    p = q;
+  }
+  return OFFLOAD_SUCCESS;
+}
+
 int32_t mm_context_t::data_submit() {
   DP2("Obj#%d data_submit\n", id);
   unsigned int count = 0;
   heap_t *first = heap_list;
   heap_t *curr = first;
   int32_t ret;
+  if (DirtyTrack) {
+    collect_dirty();
+  }
   do  {
     count++;
     PERF_WRAP(Perf.H2DTransfer.start();)
@@ -486,8 +849,11 @@ int32_t mm_context_t::data_submit() {
       tbegin = curr->tbegin;
       if (tbegin == NULL) {
         //puts("context_submit call RTL alloc");
-        tbegin = curr_context->RTL->data_alloc(curr_context->device_id, size, NULL);
+        // The whole heap, so the mapping holds once more of it is used
+        tbegin = curr_context->RTL->data_alloc(curr_context->device_id,
+            (uintptr_t)curr->end - (uintptr_t)hbegin, NULL);
         curr->tbegin = tbegin;
+        heap_generation++;
       }
       // TODO when to init
     } else {
@@ -497,9 +863,13 @@ int32_t mm_context_t::data_submit() {
       goto end;
     }
     //size = curr->page_count*PAGE_SIZE;
-    ret = RTL->data_submit(device_id,
-        tbegin, hbegin, size);
-        //tbegin, hbegin, curr->page_count*PAGE_SIZE);
+    if (DirtyTrack && curr->dirty) {
+      ret = submit_dirty(this, curr, tbegin, &count);
+    } else {
+      ret = RTL->data_submit(device_id,
+          tbegin, hbegin, size);
+          //tbegin, hbegin, curr->page_count*PAGE_SIZE);
+    }
     if (ret) {
       DP2("mm_context_t data_submit failed\n");
       return OFFLOAD_FAIL;
@@ -508,6 +878,9 @@ end:
     PERF_WRAP(Perf.H2DTransfer.end();)
     curr = curr->next;
   } while(curr != first);
+  if (DirtyTrack) {
+    reset_dirty(this);
+  }
   DP2("data_submit accum count: %d\n", count);
   return OFFLOAD_SUCCESS;
   //return 0;
@@ -542,6 +915,10 @@ end:
     PERF_WRAP(Perf.D2HTransfer.end();)
     curr = curr->next;
   } while(curr != first);
+  if (DirtyTrack) {
+    // Pages written by the retrieve match the device
+    reset_dirty(this);
+  }
   DP2("data_retrieve accum count: %d\n", count);
   return OFFLOAD_SUCCESS;
 }
@@ -598,6 +975,59 @@ void get_offset_table(int *size, intptr_t *ret) {
   }
 }
 
+// Drop every block of a context at once. The heaps and their device
+// allocations are kept for the next region, their pages are returned to the
+// kernel unless they are pinned.
+void mymalloc_release(mm_context_t *c) {
+  pthread_mutex_lock(&heap_lock);
+  c->release_count++;
+  heap_t *first = c->heap_list;
+  heap_t *curr = first;
+  do {
+    uintptr_t keep = ((uintptr_t)curr->begin + HEADER_SIZE + PAGE_SIZE - 1) &
+                     pg_mask;
+    uintptr_t end = (uintptr_t)curr->end & pg_mask;
+    if (keep < end && !is_pinned(keep, end) &&
+        madvise((void *)keep, end - keep, MADV_DONTNEED)) {
+      DP2("madvise %p-%p failed\n", (void *)keep, (void *)end);
+    }
+    blk_hdr_t *first_blk = (blk_hdr_t *)curr->begin;
+    first_blk->size = (uintptr_t)curr->end - (uintptr_t)curr->begin;
+    curr->next_free = curr->begin;
+    curr = curr->next;
+  } while (curr != first);
+  if (c == curr_context) {
+    curr_heap = c->heap_list;
+  }
+  pthread_mutex_unlock(&heap_lock);
+  DP2("Released mm context #%d\n", c->id);
+}
+
+uint64_t get_heap_generation() {
+  return heap_generation.load();
+}
+
+int get_mapped_heaps(heap_t **ret, int max, int64_t device_id) {
+  int n = 0;
+  for (int i = 0; i < context_count; i++) {
+    if (contexts[i].device_id != device_id) {
+      continue;
+    }
+    heap_t *first = contexts[i].heap_list;
+    heap_t *curr = first;
+    do {
+      if (curr->tbegin) {
+        if (n < max) {
+          ret[n] = curr;
+        }
+        n++;
+      }
+      curr = curr->next;
+    } while (curr != first);
+  }
+  return n;
+}
+
 intptr_t get_offset(mm_context_t *context) {
   if (IsOffsetEnabled) {
     heap_t *h = context->heap_list;
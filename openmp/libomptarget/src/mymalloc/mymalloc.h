@@ -7,8 +7,6 @@ extern void *(*mallocp)(size_t size);
 extern void *(*reallocp)(void *ptr, size_t size);
 extern void (*freep)(void *);
 extern void *(*callocp)(size_t count, size_t size);
-extern void pragma_omp_enter();
-extern void pragma_omp_exit();
 
 #define _MYMALLOC_ISMYSPACE(ptr)                                               \
   (((uintptr_t)ptr & _omp_header_mask) == _omp_check_mask)
@@ -30,6 +28,10 @@ typedef struct heap {
   void *next_free; // for next fit
   void *tbegin;
   size_t page_count;
+  // Dirty page map for OMP_DIRTY_HEAP, one byte per page from the page of
+  // begin. Pages at or beyond tracked_pages are always sent.
+  unsigned char *dirty;
+  size_t tracked_pages;
   // maybe free count??
   // Navigator
   struct heap *next;
@@ -42,6 +44,7 @@ typedef struct mm_context {
   int64_t device_id;
   struct heap *heap_list;
   struct RTLInfoTy *RTL;
+  unsigned int release_count; // bumped by mymalloc_release
   int32_t data_submit();
   int32_t data_retrieve();
   // TODO buddy system is needed
@@ -49,9 +52,20 @@ typedef struct mm_context {
 
 extern mm_context_t *get_mm_context(void *p);
 extern heap_t *get_heap(void*p, mm_context_t **return_context);
+// Free all blocks of a context
+extern void mymalloc_release(mm_context_t *c);
+// Unregister the heap ranges page-locked for OMP_PIN_HEAP
+extern void mymalloc_unpin_all();
 
 //extern intptr_t *get_offset_table(int *size);
 extern void get_offset_table(int *size, intptr_t *ret);
 extern intptr_t get_offset(mm_context_t* c);
+// Heaps keep their device allocation for their lifetime. The generation
+// changes whenever a heap gets one, grows or a context is created, so tables
+// built from the heaps stay valid while it does not.
+extern uint64_t get_heap_generation();
+// Store up to max heaps of the contexts of device_id that have a device
+// allocation in ret and return how many there are.
+extern int get_mapped_heaps(heap_t **ret, int max, int64_t device_id);
 
 #endif // __MYMALLOC_H__
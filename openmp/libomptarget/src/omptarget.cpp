@@ -18,6 +18,8 @@
 #include "rtl.h"
 
 #include <cassert>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <inttypes.h>
 
@@ -215,6 +217,65 @@ static int32_t member_of(int64_t type) {
   return ((type & OMP_TGT_MAPTYPE_MEMBER_OF) >> 48) - 1;
 }
 
+// Migrate the managed memory of a region and, for a pointer, the whole
+// allocation it points to, so kernels and the host do not fault them in.
+// Not an error if the memory is not managed.
+static void uvm_prefetch_region(DeviceTy &Device, void *HstPtrBegin,
+    int64_t data_size, int64_t data_type, int32_t Flags) {
+  if (!data_size) {
+    return;
+  }
+  if (!(data_type & OMP_TGT_MAPTYPE_FROM)) {
+    Flags |= OMP_PREFETCH_READ_MOSTLY;
+  }
+  Device.uvm_prefetch(HstPtrBegin, data_size, Flags);
+  if (Device.IsDCEnabled && data_size == sizeof(void*)) {
+    Device.uvm_prefetch(*(void**)HstPtrBegin, 0, Flags);
+  }
+}
+
+
+/// What is derived from an array of map types alone. Clang flags its arrays
+/// with OMP_TGT_MAPTYPE_CONST_DESC, they are constants of their construct and
+/// their info is computed on the first launch and then found by address.
+struct MapTypesInfoTy {
+  int32_t NumTargetParams = 0;
+  int32_t NumNested = 0;
+};
+static std::unordered_map<const int64_t *, MapTypesInfoTy> MapTypesInfoCache;
+static std::mutex MapTypesInfoMtx;
+
+static MapTypesInfoTy computeMapTypesInfo(int32_t arg_num,
+    int64_t *arg_types) {
+  MapTypesInfoTy Info;
+  for (int32_t i = 0; i < arg_num; ++i) {
+    if (arg_types[i] & OMP_TGT_MAPTYPE_TARGET_PARAM) {
+      Info.NumTargetParams++;
+    }
+    if (arg_types[i] & OMP_TGT_MAPTYPE_NESTED) {
+      Info.NumNested++;
+    }
+  }
+  return Info;
+}
+
+static MapTypesInfoTy getMapTypesInfo(int32_t arg_num, int64_t *arg_types) {
+  if (!arg_num || !(arg_types[0] & OMP_TGT_MAPTYPE_CONST_DESC)) {
+    return computeMapTypesInfo(arg_num, arg_types);
+  }
+  std::lock_guard<std::mutex> Lock(MapTypesInfoMtx);
+  auto It = MapTypesInfoCache.find(arg_types);
+  if (It == MapTypesInfoCache.end()) {
+    It = MapTypesInfoCache.emplace(arg_types,
+        computeMapTypesInfo(arg_num, arg_types)).first;
+  }
+  return It->second;
+}
+
+void clearMapTypesInfo() {
+  std::lock_guard<std::mutex> Lock(MapTypesInfoMtx);
+  MapTypesInfoCache.clear();
+}
 
 /// Internal function to do the mapping and transfer the data to the device
 int target_data_begin(DeviceTy &Device, int32_t arg_num,
@@ -230,6 +291,15 @@ int target_data_begin(DeviceTy &Device, int32_t arg_num,
   RttTy Rtt;
   if (arg_num && arg_types[0] & OMP_TGT_MAPTYPE_HAS_NESTED) {
     Rtt.init(args + arg_num);
+    Rtt.Threads = Device.DCThreads;
+    Rtt.Dedup = Device.IsDCDedupEnabled;
+    if (Device.IsDCSnapshotEnabled) {
+      Rtt.Snapshots = &Device.xfer().RttSnapshots;
+    }
+  }
+  TransferBatchTy Batch(Device.CoalesceGap);
+  if (Device.IsUVMPrefetchEnabled) {
+    Device.xfer().UVMPrefetched.clear();
   }
 
   // process each input.
@@ -281,6 +351,10 @@ DCGEN_REPEAT:
       }
     }
 
+    if (Device.IsUVMPrefetchEnabled) {
+      uvm_prefetch_region(Device, HstPtrBegin, data_size, data_type, 0);
+    }
+
     // Address of pointer on the host and device, respectively.
     void *Pointer_HstPtrBegin, *Pointer_TgtPtrBegin;
     bool IsNew, Pointer_IsNew;
@@ -294,8 +368,12 @@ DCGEN_REPEAT:
     if (data_type & OMP_TGT_MAPTYPE_PTR_AND_OBJ) {
       DP("Has a pointer entry: \n");
       // base is address of pointer.
+      // A deep copy pointer lies in an object the walk mapped before and is
+      // never released by target_data_end, it takes no reference
+      bool Pointer_UpdateRef = UpdateRef &&
+          !(data_type & OMP_TGT_MAPTYPE_NESTED);
       Pointer_TgtPtrBegin = Device.getOrAllocTgtPtr(HstPtrBase, HstPtrBase,
-          sizeof(void *), Pointer_IsNew, IsImplicit, UpdateRef);
+          sizeof(void *), Pointer_IsNew, IsImplicit, Pointer_UpdateRef);
       if (!Pointer_TgtPtrBegin) {
         DP("Call to getOrAllocTgtPtr returned null pointer (device failure or "
             "illegal mapping).\n");
@@ -348,7 +426,12 @@ DCGEN_REPEAT:
       if (copy) {
         DP("Moving %" PRId64 " bytes (hst:" DPxMOD ") -> (tgt:" DPxMOD ")\n",
             data_size, DPxPTR(HstPtrBegin), DPxPTR(TgtPtrBegin));
-        int rt = Device.data_submit(TgtPtrBegin, HstPtrBegin, data_size);
+        int rt = OFFLOAD_SUCCESS;
+        if (Device.IsCoalesceEnabled && (data_type & OMP_TGT_MAPTYPE_NESTED)) {
+          Batch.addRegion(TgtPtrBegin, HstPtrBegin, data_size, IsNew);
+        } else {
+          rt = Device.data_submit_async(TgtPtrBegin, HstPtrBegin, data_size);
+        }
         if (rt != OFFLOAD_SUCCESS) {
           DP("Copying data to device failed.\n");
           return OFFLOAD_FAIL;
@@ -380,8 +463,16 @@ DCGEN_REPEAT:
           DPxPTR(Pointer_TgtPtrBegin), DPxPTR(TgtPtrBegin));
       uint64_t Delta = (uint64_t)HstPtrBegin - (uint64_t)HstPtrBase;
       void *TgtPtrBase = (void *)((uint64_t)TgtPtrBegin - Delta);
-      int rt = Device.data_submit(Pointer_TgtPtrBegin, &TgtPtrBase,
-          sizeof(void *));
+      // Queued on the same stream as the pointee copy above, so the pointer
+      // is not overwritten by a later-completing copy of its enclosing struct.
+      // TgtPtrBase is pageable and staged by the RTL before it returns.
+      int rt = OFFLOAD_SUCCESS;
+      if (Device.IsCoalesceEnabled && (data_type & OMP_TGT_MAPTYPE_NESTED)) {
+        Batch.addPointer(Pointer_TgtPtrBegin, TgtPtrBase);
+      } else {
+        rt = Device.data_submit_async(Pointer_TgtPtrBegin, &TgtPtrBase,
+            sizeof(void *));
+      }
       if (rt != OFFLOAD_SUCCESS) {
         DP("Copying data to device failed.\n");
         return OFFLOAD_FAIL;
@@ -399,6 +490,15 @@ skip_update:
     }
   }
 
+  if (!Batch.empty() && Batch.flush(Device) != OFFLOAD_SUCCESS) {
+    DP("Copying coalesced data to device failed.\n");
+    return OFFLOAD_FAIL;
+  }
+  // Single fence for all the transfers queued above
+  if (Device.synchronize() != OFFLOAD_SUCCESS) {
+    DP("Waiting for data transfers to device failed.\n");
+    return OFFLOAD_FAIL;
+  }
   return OFFLOAD_SUCCESS;
 }
 
@@ -415,6 +515,11 @@ int bulk_target_data_begin(DeviceTy &Device, int32_t arg_num,
   RttTy Rtt;
   if (arg_num && arg_types[0] & OMP_TGT_MAPTYPE_HAS_NESTED) {
     Rtt.init(args + arg_num, arg_sizes + arg_num);
+    Rtt.Threads = Device.DCThreads;
+    Rtt.Dedup = Device.IsDCDedupEnabled;
+    if (Device.IsDCSnapshotEnabled) {
+      Rtt.Snapshots = &Device.xfer().RttSnapshots;
+    }
   }
 
   // process each input.
@@ -484,8 +589,11 @@ DCGEN_REPEAT:
       intptr_t ret;
       //Pointer_TgtPtrBegin = AT(HstPtrBase) translated;
       //Pointer_TgtPtrBegin = Device.getOrAllocTgtPtr(HstPtrBase, HstPtrBase,
+      // See target_data_begin, the object holding it is mapped already
+      bool Pointer_UpdateRef = UpdateRef &&
+          !(data_type & OMP_TGT_MAPTYPE_NESTED);
       ret = (intptr_t) Device.getOrAllocTgtPtr(HstPtrBase, HstPtrBase,
-          sizeof(void *), Pointer_IsNew, IsImplicit, UpdateRef);
+          sizeof(void *), Pointer_IsNew, IsImplicit, Pointer_UpdateRef);
       if (!ret) {
         DP2("Call to getOrAllocTgtPtr failed (device failure or "
             "illegal mapping).\n");
@@ -500,10 +608,17 @@ DCGEN_REPEAT:
       UpdateRef = true; // subsequently update ref count of pointee
     }
 
+    // Pointees of deep copy objects are placed by level, see
+    // DeviceTy::bulk_compact_place
+    int CompactLevel = -1;
+    if (Device.IsDCCompactEnabled && (data_type & OMP_TGT_MAPTYPE_NESTED) &&
+        (data_type & OMP_TGT_MAPTYPE_PTR_AND_OBJ)) {
+      CompactLevel = Rtt.Level;
+    }
     //void *TgtPtrBegin = AT(HstPtrBegin);
     intptr_t ret = (intptr_t) Device.getOrAllocTgtPtr(HstPtrBegin, HstPtrBase,
     //void *TgtPtrBegin = Device.getOrAllocTgtPtr(HstPtrBegin, HstPtrBase,
-        data_size, IsNew, IsImplicit, UpdateRef);
+        data_size, IsNew, IsImplicit, UpdateRef, CompactLevel);
     //if (!TgtPtrBegin && data_size) {
     if (!ret && data_size) {
       // If data_size==0, then the argument could be a zero-length pointer to
@@ -574,6 +689,11 @@ DCGEN_REPEAT:
     }
   }
 
+  // Copies to segments mapped already may be queued, see bulk_data_submit
+  if (Device.synchronize() != OFFLOAD_SUCCESS) {
+    DP("Waiting for data transfers to device failed.\n");
+    return OFFLOAD_FAIL;
+  }
   return OFFLOAD_SUCCESS;
 }
 
@@ -584,8 +704,18 @@ int target_data_end(DeviceTy &Device, int32_t arg_num, void **args_base,
   // process each input.
   RttTy Rtt;
   if (arg_num && arg_types[0] & OMP_TGT_MAPTYPE_HAS_NESTED) {
-    Rtt.initIsFrom(args, arg_types, arg_num);
+    Rtt.initIsFrom(args, arg_num,
+        getMapTypesInfo(arg_num, arg_types).NumNested);
+    Rtt.Threads = Device.DCThreads;
+    Rtt.Dedup = Device.IsDCDedupEnabled;
+    if (Device.IsDCSnapshotEnabled) {
+      Rtt.Snapshots = &Device.xfer().RttSnapshots;
+    }
   }
+  if (Device.IsUVMPrefetchEnabled) {
+    Device.xfer().UVMPrefetched.clear();
+  }
+  RetrieveBatchTy Batch;
 
   for (int32_t i = arg_num - 1; i >= 0; --i) {
     // Ignore private variables and arrays - there is no mapping for them.
@@ -641,6 +771,12 @@ DCGEN_REPEAT:
         (data_type & OMP_TGT_MAPTYPE_PTR_AND_OBJ);
     bool ForceDelete = data_type & OMP_TGT_MAPTYPE_DELETE;
 
+    // The mapping may be released by an earlier argument, finish that first
+    if (Device.IsCoalesceEnabled && Batch.isDeleting(HstPtrBegin, data_size) &&
+        Batch.flush(Device) != OFFLOAD_SUCCESS) {
+      return OFFLOAD_FAIL;
+    }
+
     // If PTR_AND_OBJ, HstPtrBegin is address of pointee
     void *TgtPtrBegin = Device.getTgtPtrBegin(HstPtrBegin, data_size, IsLast,
         UpdateRef);
@@ -662,6 +798,10 @@ DCGEN_REPEAT:
     if ((data_type & OMP_TGT_MAPTYPE_FROM) || DelEntry) {
       // Move data back to the host
       if (data_type & OMP_TGT_MAPTYPE_FROM) {
+        if (Device.IsUVMPrefetchEnabled) {
+          uvm_prefetch_region(Device, HstPtrBegin, data_size, data_type,
+              OMP_PREFETCH_TO_HOST);
+        }
         bool Always = data_type & OMP_TGT_MAPTYPE_ALWAYS;
         //Always = true;
         bool CopyMember = false;
@@ -676,7 +816,14 @@ DCGEN_REPEAT:
           }
         }
 
-        if (DelEntry || Always || CopyMember) {
+        // Deep copy contexts are looked up from the retrieved pointer
+        bool NeedsData = Device.IsDCEnabled && data_size == sizeof(void*);
+        if ((DelEntry || Always || CopyMember) && Device.IsCoalesceEnabled &&
+            !NeedsData) {
+          DP("Queueing %" PRId64 " bytes (tgt:" DPxMOD ") -> (hst:" DPxMOD
+              ")\n", data_size, DPxPTR(TgtPtrBegin), DPxPTR(HstPtrBegin));
+          Batch.addRegion(TgtPtrBegin, HstPtrBegin, data_size);
+        } else if (DelEntry || Always || CopyMember) {
           DP("Moving %" PRId64 " bytes (tgt:" DPxMOD ") -> (hst:" DPxMOD ")\n",
               data_size, DPxPTR(TgtPtrBegin), DPxPTR(HstPtrBegin));
           int rt = Device.data_retrieve(HstPtrBegin, TgtPtrBegin, data_size);
@@ -716,6 +863,11 @@ DCGEN_REPEAT:
       if (Device.IsATEnabled) {
         goto DEL;
       }
+      if (Device.IsCoalesceEnabled) {
+        Batch.addRestore(HstPtrBegin, data_size,
+            data_type & OMP_TGT_MAPTYPE_FROM, DelEntry);
+        goto DEL;
+      }
 
       Device.ShadowMtx.lock();
       for (auto it = Device.ShadowPtrMap.upper_bound((void*)ub);
@@ -750,7 +902,10 @@ DCGEN_REPEAT:
 
 DEL:
       // Deallocate map
-      if (DelEntry) {
+      if (DelEntry && Device.IsCoalesceEnabled) {
+        // Device memory is in use until the batch is flushed
+        Batch.addDelete(HstPtrBegin, data_size, ForceDelete);
+      } else if (DelEntry) {
         int rt = Device.deallocTgtPtr(HstPtrBegin, data_size, ForceDelete);
         if (rt != OFFLOAD_SUCCESS) {
           DP("Deallocating data from device failed.\n");
@@ -762,6 +917,9 @@ DEL:
       goto DCGEN_REPEAT;
     }
   }
+  if (!Batch.empty() && Batch.flush(Device) != OFFLOAD_SUCCESS) {
+    return OFFLOAD_FAIL;
+  }
   PERF_WRAP(Perf.RTDataEnd.end();)
   return OFFLOAD_SUCCESS;
 }
@@ -769,9 +927,6 @@ DEL:
 /// Internal function to pass data to/from the target.
 int target_data_update(DeviceTy &Device, int32_t arg_num,
     void **args_base, void **args, int64_t *arg_sizes, int64_t *arg_types) {
-  if (Device.IsBulkEnabled) {
-    assert(0 && "target_data_update should not be used");
-  }
   // process each input.
   for (int32_t i = 0; i < arg_num; ++i) {
     if ((arg_types[i] & OMP_TGT_MAPTYPE_LITERAL) ||
@@ -785,6 +940,11 @@ int target_data_update(DeviceTy &Device, int32_t arg_num,
     bool IsLast;
     void *TgtPtrBegin = Device.getTgtPtrBegin(HstPtrBegin, MapSize, IsLast,
         false);
+    // Map entries of bulk transfers hold no device address, the segment does.
+    // NULL until the region is transferred by a target region
+    if (TgtPtrBegin && Device.IsBulkEnabled) {
+      TgtPtrBegin = Device.bulkGetTgtPtrBegin(HstPtrBegin, MapSize);
+    }
     if (!TgtPtrBegin) {
       DP("hst data:" DPxMOD " not found, becomes a noop\n", DPxPTR(HstPtrBegin));
       continue;
@@ -866,16 +1026,14 @@ static bool isLambdaMapping(int64_t Mapping) {
   return (Mapping & LambdaMapping) == LambdaMapping;
 }
 
-/// performs the same actions as data_begin in case arg_num is
-/// non-zero and initiates run of the offloaded region on the target platform;
-/// if arg_num is non-zero after the region execution is done it also
-/// performs the same action as data_update and data_end above. This function
-/// returns 0 if it was able to transfer the execution to a target and an
-/// integer different from zero otherwise.
-int target(int64_t device_id, void *host_ptr, int32_t arg_num,
+/// runs the region as described for target() below, without graphs
+static int run_target(int64_t device_id, void *host_ptr, int32_t arg_num,
     void **args_base, void **args, int64_t *arg_sizes, int64_t *arg_types,
     int32_t team_num, int32_t thread_limit, int IsTeamConstruct) {
   DeviceTy &Device = Devices[device_id];
+  // Table arguments of this launch, kept per region since the table of
+  // each host thread differs
+  AddressTranslateTy AT = AddressTranslateTy();
 
   // Find the table information in the map or look it up in the translation
   // tables.
@@ -920,6 +1078,20 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
     return OFFLOAD_FAIL;
   }
 
+  // Pick the AT mode of this launch, the whole region is timed for it. The
+  // device mode is left alone since other regions may run concurrently.
+  OpenMPOffloadingMode LaunchMode = Device.ATMode;
+  ModeSelectorTy::ScopeTy ModeScope;
+  if (Device.ModeSel.Enabled) {
+    std::string Name = TM->Table->HostTable.EntriesBegin[TM->Index].name;
+    int Cand = Device.ModeSel.pick(Name);
+    LaunchMode = Device.ModeSel.Candidates[Cand];
+    ModeScope.Sel = &Device.ModeSel;
+    ModeScope.Name = Name;
+    ModeScope.Cand = Cand;
+    ModeScope.Start = std::chrono::steady_clock::now();
+  }
+
   // get target table.
   TrlTblMtx.lock();
   assert(TM->Table->TargetsTable.size() > (size_t)device_id &&
@@ -952,8 +1124,8 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
     // convert region list to table
     Device.table_transfer();
     // Add tgt table
-    AT.addTable(Device.SegmentList.TgtMemPtr);
-    AT.addTableSize(Device.SegmentList.TgtList.size());
+    AT.addTable(Device.xfer().SegmentList.TgtMemPtr);
+    AT.addTableSize(Device.xfer().SegmentList.TgtList.size());
 
     int fake_literal = 878787;
     int fake_table_size = 13;
@@ -965,11 +1137,14 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
 
   std::vector<void *> tgt_args;
   std::vector<ptrdiff_t> tgt_offsets;
+  int32_t NumTargetParams =
+      getMapTypesInfo(arg_num, arg_types).NumTargetParams;
+  tgt_args.reserve(NumTargetParams);
+  tgt_offsets.reserve(NumTargetParams);
 
   // List of (first-)private arrays allocated for this target region
   std::vector<void *> fpArrays;
   std::vector<int> tgtArgsPositions(arg_num, -1);
-  std::vector<mm_context_t *> contexts_for_ATTable;
 
   for (int32_t i = 0; i < arg_num; ++i) {
     if (!(arg_types[i] & OMP_TGT_MAPTYPE_TARGET_PARAM)) {
@@ -1029,8 +1204,7 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
 
     } else if (arg_types[i] & OMP_TGT_MAPTYPE_PRIVATE) {
       // Allocate memory for (first-)private array
-      TgtPtrBegin = Device.RTL->data_alloc(Device.RTLDeviceID,
-          arg_sizes[i], HstPtrBegin);
+      TgtPtrBegin = Device.Pool.alloc(Device, arg_sizes[i]);
       if (!TgtPtrBegin) {
         DP ("Data allocation for %sprivate array " DPxMOD " failed, "
             "abort target.\n",
@@ -1072,24 +1246,22 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
       TgtPtrBegin = Device.getTgtPtrBegin(HstPtrBegin, arg_sizes[i], IsLast,
           false);
       if (_MYMALLOC_ISMYSPACE(HstPtrBegin)) {
-        if (Device.ATMode & OMP_OFFMODE_AT_MASK) {
+        if (LaunchMode & OMP_OFFMODE_AT_MASK) {
           TgtPtrBegin = (void*)_MYMALLOC_H2D(HstPtrBegin);
           DP2("omp target launching with myspace arg: %p->%p\n",
               HstPtrBegin, TgtPtrBegin);
-        } else if (Device.ATMode & OMP_OFFMODE_AT_OFFSET) {
+        } else if (LaunchMode & OMP_OFFMODE_AT_OFFSET) {
           TgtPtrBegin = (void*)((intptr_t)HstPtrBegin +
               get_offset(get_mm_context(HstPtrBegin)));
           DP2("Offset: arg of kernel: %p->%p\n", HstPtrBegin, TgtPtrBegin);
         }
       }
-        if (TgtPtrBegin == NULL && (Device.ATMode & OMP_OFFMODE_AT_TABLE)) {
+        if (TgtPtrBegin == NULL && (LaunchMode & OMP_OFFMODE_AT_TABLE)) {
           mm_context_t *context;
           heap_t *heap = get_heap(HstPtrBegin, &context);
           if (heap && heap->tbegin) {
             TgtPtrBegin = (void*)((uintptr_t)heap->tbegin -
                 (uintptr_t)heap->begin + (uintptr_t)HstPtrBegin);
-            // Add context to table
-            contexts_for_ATTable.push_back(context);
           }
           DP2("OMP_TABLE need to translate NULL args %p\n", TgtPtrBegin);
         }
@@ -1120,49 +1292,45 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
   // Insert  table
   /*
   if (Device.IsATEnabled) {
-    tgt_args.push_back(Device.SegmentList.TgtMemPtr);
+    tgt_args.push_back(Device.xfer().SegmentList.TgtMemPtr);
     tgt_offsets.push_back(0);
   }*/
-  if (Device.ATMode & OMP_OFFMODE_AT_TABLE) {
-    printf("Constructing  tableATTable\n");
-    SegmentListTy &SegmentList = Device.SegmentList;
-    SegmentList.clear();
-    for (auto e : contexts_for_ATTable) {
-      printf("construct with context %d\n", e->id);
-      heap_t *first_heap = e->heap_list;
-      heap_t *curr_heap = first_heap;
-      do {
-        if (!curr_heap->tbegin) {
-          curr_heap = curr_heap->next;
-          continue;
-        }
+  if (LaunchMode & OMP_OFFMODE_AT_TABLE) {
+    TransferStateTy &Xfer = Device.xfer();
+    SegmentListTy &SegmentList = Xfer.SegmentList;
+    // One table of all mapped heaps, shared by the kernels until a heap is
+    // mapped. The table stays on the device across launches, only changed
+    // entries are sent.
+    uint64_t Gen = get_heap_generation();
+    if (!SegmentList.TgtMemPtr || Xfer.HeapTableGen != Gen) {
+      std::vector<heap_t *> Heaps(get_mapped_heaps(NULL, 0, Device.DeviceID));
+      Heaps.resize(get_mapped_heaps(Heaps.data(), Heaps.size(),
+                                    Device.DeviceID));
+      SegmentList.clear();
+      SegmentList.TgtList.clear();
+      SegmentList.invalidate();
+      for (heap_t *h : Heaps) {
         SegmentTy seg;
-        seg.HstPtrBegin = (uintptr_t)curr_heap->begin;
-        seg.HstPtrEnd =  (uintptr_t)curr_heap->end;
-        seg.TgtPtrBegin = (uintptr_t)curr_heap->tbegin;
-        SegmentList.emplace((uintptr_t)curr_heap->begin,
-            seg);
-        curr_heap = curr_heap->next;
-        printf("push hst: 0x%p 0x%p\n", (void*)seg.HstPtrBegin, (void*)seg.TgtPtrBegin);
-      } while(first_heap != curr_heap);
-    }
-    SegmentTy seg;
-    seg.HstPtrBegin = (uintptr_t)SegmentList.size();
-    SegmentList.TgtList.emplace_back(seg);
-    for (auto &entry : SegmentList) {
-      auto &e = entry.second;
-      //printf("%lu %lu %lu\n", e.HstPtrBegin, e.HstPtrEnd, e.TgtPtrBegin);
-      SegmentList.TgtList.push_back(e);
-    }
-    printf("AT Table size: %lu\n", SegmentList.size());
-    SegmentList.TgtMemPtr = Device.RTL->data_alloc(Device.RTLDeviceID,
-        SegmentList.size()*sizeof(SegmentTy), NULL);
-    int rt = Device.data_submit(SegmentList.TgtMemPtr,
-        &SegmentList.TgtList[0],
-        SegmentList.size() * sizeof(SegmentTy));
-    if (rt != OFFLOAD_SUCCESS) {
-      DP("Transfer AT table failed\n");
-      return OFFLOAD_FAIL;
+        seg.HstPtrBegin = (uintptr_t)h->begin;
+        seg.HstPtrEnd = (uintptr_t)h->end;
+        seg.TgtPtrBegin = (uintptr_t)h->tbegin;
+        SegmentList.emplace((uintptr_t)h->begin, seg);
+        DP2("push hst: 0x%p 0x%p\n", (void*)seg.HstPtrBegin,
+            (void*)seg.TgtPtrBegin);
+      }
+      SegmentTy seg = SegmentTy();
+      seg.HstPtrBegin = (uintptr_t)SegmentList.size();
+      SegmentList.TgtList.emplace_back(seg);
+      for (auto &entry : SegmentList) {
+        SegmentList.TgtList.push_back(entry.second);
+      }
+      DP2("AT Table size: %lu\n", SegmentList.size());
+      int rt = Device.upload_table();
+      if (rt != OFFLOAD_SUCCESS) {
+        DP("Transfer AT table failed\n");
+        return OFFLOAD_FAIL;
+      }
+      Xfer.HeapTableGen = Gen;
     }
     // insert arg
     tgt_args.push_back(SegmentList.TgtMemPtr);
@@ -1170,44 +1338,40 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
   }
 
   // Insert Mask
-  if (Device.ATMode & OMP_OFFMODE_AT_MASK) {
+  if (LaunchMode & OMP_OFFMODE_AT_MASK) {
     DP2("Append h2d mask %p to kernel\n", (void*&)_omp_h2dmask);
     tgt_args.push_back((void*)_omp_h2dmask);
     tgt_offsets.push_back(0);
   }
-  if (Device.ATMode & OMP_OFFMODE_AT_OFFSET) {
-    void *t_offset_list = NULL;
-    if (!t_offset_list) {
-      if (getenv("OMP_OFFSET_CM")) {
-        int64_t size;
-        t_offset_list = Device.RTL->get_readonly_mem(&size);
-      } else {
-        t_offset_list = Device.RTL->data_alloc(Device.RTLDeviceID,
-            32*sizeof(intptr_t), NULL);
-        Device.SegmentList.TgtMemPtr = t_offset_list;
+  if (LaunchMode & OMP_OFFMODE_AT_OFFSET) {
+    TransferStateTy &Xfer = Device.xfer();
+    // Heap offsets only change when a heap is mapped, the list stays on the
+    // device until then
+    uint64_t Gen = get_heap_generation();
+    if (!Xfer.OffsetListPtr || Xfer.OffsetListGen != Gen) {
+      intptr_t offset_list[32];
+      int size;
+      // Here is hardcode
+      // mask
+      offset_list[0] = 0x000000f000000000L;
+      // shift
+      offset_list[1] = 9 * 4;
+      get_offset_table(&size, offset_list + 2);
+      // size
+      if (size < 1) {
+        exit(39);
       }
+      int rt = Device.upload_offset_list(
+          std::vector<intptr_t>(offset_list, offset_list + size + 2));
+      if (rt != OFFLOAD_SUCCESS) {
+        DP("Map offset list failed\n");
+        return OFFLOAD_FAIL;
+      }
+      Xfer.OffsetListGen = Gen;
     }
-    intptr_t offset_list[32];
-    int size;
-    // Here is hardcode
-    // mask
-    offset_list[0] = 0x000000f000000000L;
-    // shift
-    offset_list[1] = 9 * 4;
-    get_offset_table(&size, offset_list + 2);
-    // size
-    if (size < 1) {
-      exit(39);
-    }
-    // data_submit
-    int rt = Device.data_submit(t_offset_list, offset_list, sizeof(intptr_t)*(size+4));
-    if (rt != OFFLOAD_SUCCESS) {
-      DP("Map offset list failed\n");
-      return OFFLOAD_FAIL;
-    }
-    tgt_args.push_back(t_offset_list);
+    tgt_args.push_back(Device.xfer().OffsetListPtr);
     tgt_offsets.push_back(0);
-    DP2("Append offset list %p to kernel\n", offset_list);
+    DP2("Append offset list %p to kernel\n", Device.xfer().OffsetListPtr);
   }
 
   assert(tgt_args.size() == tgt_offsets.size() &&
@@ -1229,10 +1393,10 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
   if (IsTeamConstruct) {
     rc = Device.run_team_region(TargetTable->EntriesBegin[TM->Index].addr,
         &tgt_args[0], &tgt_offsets[0], tgt_args.size(), team_num,
-        thread_limit, ltc);
+        thread_limit, ltc, LaunchMode);
   } else {
     rc = Device.run_region(TargetTable->EntriesBegin[TM->Index].addr,
-        &tgt_args[0], &tgt_offsets[0], tgt_args.size());
+        &tgt_args[0], &tgt_offsets[0], tgt_args.size(), LaunchMode);
   }
   if (rc == OFFLOAD_FAIL) {
     DP ("Executing target region abort target.\n");
@@ -1242,25 +1406,12 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
 
   // Deallocate (first-)private arrays
   for (auto it : fpArrays) {
-    int rt = Device.RTL->data_delete(Device.RTLDeviceID, it);
+    int rt = Device.Pool.release(Device, it);
     if (rt != OFFLOAD_SUCCESS) {
       DP("Deallocation of (first-)private arrays failed.\n");
       return OFFLOAD_FAIL;
     }
   }
-  // Deallocate table for AT
-  if (Device.ATMode & (OMP_OFFMODE_AT_TABLE | OMP_OFFMODE_AT_OFFSET)) {
-    if (Device.SegmentList.TgtMemPtr) {
-      int rt = Device.RTL->data_delete(Device.RTLDeviceID,
-          Device.SegmentList.TgtMemPtr);
-      if (rt != OFFLOAD_SUCCESS) {
-        DP("Deallocation AT table failed.\n");
-        return OFFLOAD_FAIL;
-      }
-      Device.SegmentList.TgtMemPtr = NULL;
-    }
-  }
-
   // Move data from device.
   int rt = target_data_end(Device, arg_num, args_base, args, arg_sizes,
       arg_types);
@@ -1276,3 +1427,29 @@ int target(int64_t device_id, void *host_ptr, int32_t arg_num,
 
   return OFFLOAD_SUCCESS;
 }
+
+/// performs the same actions as data_begin in case arg_num is
+/// non-zero and initiates run of the offloaded region on the target platform;
+/// if arg_num is non-zero after the region execution is done it also
+/// performs the same action as data_update and data_end above. This function
+/// returns 0 if it was able to transfer the execution to a target and an
+/// integer different from zero otherwise. Repeated regions may be replayed
+/// from a device graph, see GraphCacheTy.
+int target(int64_t device_id, void *host_ptr, int32_t arg_num,
+    void **args_base, void **args, int64_t *arg_sizes, int64_t *arg_types,
+    int32_t team_num, int32_t thread_limit, int IsTeamConstruct) {
+  DeviceTy &Device = Devices[device_id];
+  GraphCacheTy::KeyTy Key;
+  if (Device.Graphs.Enabled &&
+      Device.Graphs.getKey(Device, host_ptr, arg_num, args_base, args,
+                           arg_sizes, arg_types, team_num, thread_limit,
+                           Key)) {
+    return Device.Graphs.run(Device, Key, [&]() {
+      return run_target(device_id, host_ptr, arg_num, args_base, args,
+                        arg_sizes, arg_types, team_num, thread_limit,
+                        IsTeamConstruct);
+    });
+  }
+  return run_target(device_id, host_ptr, arg_num, args_base, args, arg_sizes,
+                    arg_types, team_num, thread_limit, IsTeamConstruct);
+}
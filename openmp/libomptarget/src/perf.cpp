@@ -1,4 +1,7 @@
 #include <cassert>
+#include <cinttypes>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "perf.h"
 
@@ -6,53 +9,108 @@
 
 PerfRecordTy Perf;
 
+// Shards of every thread that recorded an event, kept until exit
+static std::mutex ShardsMtx;
+static std::vector<PerfShardSetTy *> AllShards;
+static thread_local PerfShardSetTy *ThreadShards = NULL;
+
+static PerfEventShardTy &getShard(int Id) {
+  if (!ThreadShards) {
+    ThreadShards = new PerfShardSetTy();
+    std::lock_guard<std::mutex> Lock(ShardsMtx);
+    AllShards.push_back(ThreadShards);
+  }
+  return ThreadShards->Events[Id];
+}
+
 // start timer
 void PerfEventTy::start() {
-  if (Lock) {
+  PerfEventShardTy &S = getShard(Id);
+  if (S.Lock) {
     if (LockAction) {
       LockAction->start();
     }
     return;
   }
   if (LockTarget) {
-    LockTarget->Lock = true;
+    getShard(LockTarget->Id).Lock = true;
   }
-  StartTime = high_resolution_clock::now();
-  StartCnt++;
-  Count++;
-
+  S.StartTime = steady_clock::now();
+  S.StartCnt++;
+  S.Count.store(S.Count.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
 }
 
 // end timer
-void PerfEventTy::end() {
-  if (Lock) {
+void PerfEventTy::end(int64_t Bytes) {
+  PerfEventShardTy &S = getShard(Id);
+  if (S.Lock) {
     if (LockAction) {
-      LockAction->end();
+      LockAction->end(Bytes);
     }
     return;
   }
-  assert(StartCnt > 0 && "PerfEvent end withnot started");
-  auto EndTime = high_resolution_clock::now();
-  time_span += duration_cast<duration<double>>(EndTime - StartTime);
-  StartCnt--;
+  assert(S.StartCnt > 0 && "PerfEvent end withnot started");
+  auto EndTime = steady_clock::now();
+  int64_t Ns = duration_cast<nanoseconds>(EndTime - S.StartTime).count();
+  S.TimeNs.store(S.TimeNs.load(std::memory_order_relaxed) + Ns,
+      std::memory_order_relaxed);
+  if (Perf.Trace.Enabled) {
+    Perf.Trace.add(Name.c_str(), S.StartTime, EndTime, Bytes);
+  }
+  S.StartCnt--;
   if (LockTarget) {
-    LockTarget->Lock = false;
+    getShard(LockTarget->Id).Lock = false;
   }
 }
 
+// Sum the shards of all threads
 void PerfEventTy::dump() {
+  int64_t Count = 0, TimeNs = 0;
+  int StartCnt = 0;
+  {
+    std::lock_guard<std::mutex> Lock(ShardsMtx);
+    for (auto Shards : AllShards) {
+      PerfEventShardTy &S = Shards->Events[Id];
+      Count += S.Count.load(std::memory_order_relaxed);
+      TimeNs += S.TimeNs.load(std::memory_order_relaxed);
+    }
+  }
+  if (ThreadShards) {
+    StartCnt = ThreadShards->Events[Id].StartCnt;
+  }
   assert(StartCnt == 0 && "PerfEvent didn't end");
-  fprintf(stderr, "%-11s , %7d , %10lf", Name.c_str(), Count, time_span.count());
+  fprintf(stderr, "%-11s , %7" PRId64 " , %10lf", Name.c_str(), Count,
+      TimeNs / 1e9);
   if (StartCnt != 0) {
     fprintf(stderr, ", StartCnt: %d", StartCnt);
   }
   fprintf(stderr, "\n");
 }
 
+void PerfEventTy::get(int64_t &Count, int64_t &TimeNs) {
+  Count = 0;
+  TimeNs = 0;
+  std::lock_guard<std::mutex> Lock(ShardsMtx);
+  for (auto Shards : AllShards) {
+    PerfEventShardTy &S = Shards->Events[Id];
+    Count += S.Count.load(std::memory_order_relaxed);
+    TimeNs += S.TimeNs.load(std::memory_order_relaxed);
+  }
+}
+
+void PerfEventTy::dumpJson(FILE *F) {
+  int64_t Count, TimeNs;
+  get(Count, TimeNs);
+  fprintf(F, "{\"name\":\"%s\",\"kind\":\"event\",\"count\":%" PRId64
+      ",\"time_ns\":%" PRId64 "}", Name.c_str(), Count, TimeNs);
+}
+
 void BulkMemCount::get(int64_t device_id) {
   DeviceTy &Device = Devices[device_id];
   uintptr_t sum = 0;
-  for (auto i : Device.SegmentList) {
+  std::lock_guard<std::mutex> Lock(Device.SegmentMtx);
+  for (auto i : Device.Segments) {
     sum += i.second.HstPtrEnd - i.second.HstPtrBegin;
   }
   Sum = sum;
@@ -64,4 +122,101 @@ void PerfRecordTy::dump() {
   for (auto p : Perfs) {
     p->dump();
   }
+  writeJson();
+  Trace.write();
+}
+
+void PerfRecordTy::writeJson() {
+  if (JsonPath.empty()) {
+    return;
+  }
+  FILE *F = fopen(JsonPath.c_str(), "w");
+  if (!F) {
+    DP("Cannot write perf record %s\n", JsonPath.c_str());
+    return;
+  }
+  // Modes starts with a space, see DeviceTy::init
+  fprintf(F, "{\"modes\":\"%s\",\"records\":[",
+      Modes.empty() ? "" : Modes.c_str() + 1);
+  bool First = true;
+  for (auto p : Perfs) {
+    fprintf(F, "%s\n", First ? "" : ",");
+    p->dumpJson(F);
+    First = false;
+  }
+  fprintf(F, "\n]}\n");
+  fclose(F);
+}
+
+// PerfTraceTy
+static thread_local PerfTraceBufTy *TraceBuf = NULL;
+static thread_local uintptr_t TraceRegion = 0;
+
+void PerfTraceTy::init(const char *TracePath) {
+  Path = TracePath;
+  if (char *envStr = getenv("PERF_TRACE_EVENTS")) {
+    RingSize = std::max(atol(envStr), 1L);
+  }
+  Enabled = true;
+}
+
+void PerfTraceTy::setRegion(uintptr_t Region) {
+  TraceRegion = Region;
+}
+
+void PerfTraceTy::add(const char *Name, steady_clock::time_point Start,
+    steady_clock::time_point End, int64_t Bytes) {
+  PerfTraceBufTy *Buf = TraceBuf;
+  if (!Buf) {
+    // Buffers live until exit, the thread may be gone when they are written
+    Buf = new PerfTraceBufTy();
+    Buf->Events.resize(RingSize);
+    Buf->Next = 0;
+    Buf->Wrapped = false;
+    Buf->Tid = syscall(SYS_gettid);
+    std::lock_guard<std::mutex> Lock(Mtx);
+    Bufs.push_back(Buf);
+    TraceBuf = Buf;
+  }
+  PerfTraceEventTy &E = Buf->Events[Buf->Next];
+  E.Name = Name;
+  E.StartNs = duration_cast<nanoseconds>(Start.time_since_epoch()).count();
+  E.DurNs = duration_cast<nanoseconds>(End - Start).count();
+  E.Bytes = Bytes;
+  E.Region = TraceRegion;
+  if (++Buf->Next == Buf->Events.size()) {
+    Buf->Next = 0;
+    Buf->Wrapped = true;
+  }
+}
+
+void PerfTraceTy::write() {
+  if (!Enabled) {
+    return;
+  }
+  FILE *F = fopen(Path.c_str(), "w");
+  if (!F) {
+    DP("Cannot write trace %s\n", Path.c_str());
+    return;
+  }
+  std::lock_guard<std::mutex> Lock(Mtx);
+  long Pid = getpid();
+  bool First = true;
+  fprintf(F, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+  for (auto Buf : Bufs) {
+    size_t N = Buf->Wrapped ? Buf->Events.size() : Buf->Next;
+    size_t Begin = Buf->Wrapped ? Buf->Next : 0;
+    for (size_t i = 0; i < N; i++) {
+      PerfTraceEventTy &E = Buf->Events[(Begin + i) % Buf->Events.size()];
+      // Chrome trace times are in microseconds
+      fprintf(F, "%s\n{\"name\":\"%s\",\"cat\":\"omptarget\",\"ph\":\"X\","
+          "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld,"
+          "\"args\":{\"bytes\":%" PRId64 ",\"region\":\"0x%" PRIxPTR "\"}}",
+          First ? "" : ",", E.Name, E.StartNs / 1e3, E.DurNs / 1e3, Pid,
+          Buf->Tid, E.Bytes, E.Region);
+      First = false;
+    }
+  }
+  fprintf(F, "\n]}\n");
+  fclose(F);
 }
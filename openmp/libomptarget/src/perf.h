@@ -2,16 +2,20 @@
 #define _OMPTARGET_PERF_H_
 #include <string>
 #include <omptarget.h>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 #include <iomanip>
+#include <cassert>
+#include <mutex>
+#include <vector>
 
 #include "device.h"
 
 # define _PERF
 
 #ifdef _PERF
-#define PERF_WRAP(...) if (Perf.Enabled) do { __VA_ARGS__;} while(0);
+#define PERF_WRAP(...) if (__builtin_expect(Perf.Enabled, 0)) do { __VA_ARGS__;} while(0);
 #else
 #define PERF_WRAP(...)
 #endif
@@ -23,24 +27,80 @@ struct PerfBaseTy {
   string Name;
   int func();
   virtual void dump() {};
+  // One JSON object, see PerfRecordTy::writeJson
+  virtual void dumpJson(FILE *F) {};
+  // Totals for the tool interface: the number of samples and their time in
+  // ns or their sum
+  virtual void get(int64_t &Count, int64_t &Value) { Count = Value = 0; };
   struct PerfBaseTy *setName(string str) {
     Name = str;
     return this;
   };
 };
 
-struct PerfEventTy : public PerfBaseTy {
-  float Time; // elapsed time in sec
-  int Count;
+// One finished PerfEventTy interval
+struct PerfTraceEventTy {
+  const char *Name;
+  int64_t StartNs; // steady_clock, same base as CLOCK_MONOTONIC
+  int64_t DurNs;
+  int64_t Bytes;
+  uintptr_t Region;
+};
+
+// Ring buffer of the events of one thread, the oldest are overwritten
+struct PerfTraceBufTy {
+  std::vector<PerfTraceEventTy> Events;
+  size_t Next;
+  bool Wrapped;
+  long Tid;
+};
+
+// Timeline of PerfEventTy intervals, written as Chrome trace JSON (also read
+// by Perfetto) when the runtime is unloaded. PERF_TRACE=<file> enables it,
+// PERF_TRACE_EVENTS sets the ring size per thread.
+struct PerfTraceTy {
+  bool Enabled;
+  std::string Path;
+  size_t RingSize;
+  std::mutex Mtx; // guards Bufs
+  std::vector<PerfTraceBufTy *> Bufs;
+
+  PerfTraceTy() : Enabled(false), RingSize(1 << 16) {}
+  void init(const char *TracePath);
+  void add(const char *Name, steady_clock::time_point Start,
+      steady_clock::time_point End, int64_t Bytes);
+  void write();
+  // Target region of the calling thread, tagged on its events
+  static void setRegion(uintptr_t Region);
+};
+
+// State of one PerfEventTy for one thread. Only the owning thread writes,
+// dump() reads the totals from any thread.
+struct PerfEventShardTy {
+  steady_clock::time_point StartTime;
   int StartCnt;
   bool Lock;
-  PerfEventTy *LockTarget, *LockAction;
+  std::atomic<int64_t> Count;
+  std::atomic<int64_t> TimeNs;
+  PerfEventShardTy() : StartCnt(0), Lock(false), Count(0), TimeNs(0) {}
+};
 
-  high_resolution_clock::time_point StartTime;
-  duration<double> time_span;
+const int PerfMaxEvents = 32;
 
-  PerfEventTy(): Time(0), Count(0), StartCnt(0),
-      Lock(false), LockTarget(NULL) {};
+// Shards of all PerfEventTy of one thread
+struct PerfShardSetTy {
+  PerfEventShardTy Events[PerfMaxEvents];
+};
+
+struct PerfEventTy : public PerfBaseTy {
+  int Id; // index in PerfShardSetTy::Events
+  PerfEventTy *LockTarget, *LockAction;
+
+  PerfEventTy(): LockTarget(NULL), LockAction(NULL) {
+    static int NumEvents = 0;
+    Id = NumEvents++;
+    assert(Id < PerfMaxEvents && "Too many PerfEventTy");
+  };
   void setLockTarget(PerfEventTy *target) {
     LockTarget = target;
   };
@@ -48,20 +108,32 @@ struct PerfEventTy : public PerfBaseTy {
     LockAction = action_target;
   }
   void start();
-  void end();
+  // Bytes is recorded in the trace only
+  void end(int64_t Bytes = 0);
   void dump();
+  void dumpJson(FILE *F);
+  void get(int64_t &Count, int64_t &Value);
 };
 
 // Try to get bulk alloc size
 struct PerfCountTy : public PerfBaseTy {
-  unsigned long Sum;
-  int Count;
+  std::atomic<unsigned long> Sum;
+  std::atomic<int> Count;
   void add(unsigned long count) {
-    Sum += count;
-    Count++;
+    Sum.fetch_add(count, std::memory_order_relaxed);
+    Count.fetch_add(1, std::memory_order_relaxed);
   }
   void dump() {
-    fprintf(stderr, "%-11s , %7d , %10lu\n", Name.c_str(), Count, Sum);
+    fprintf(stderr, "%-11s , %7d , %10lu\n", Name.c_str(), Count.load(),
+        Sum.load());
+  }
+  void dumpJson(FILE *F) {
+    fprintf(F, "{\"name\":\"%s\",\"kind\":\"count\",\"count\":%d,"
+        "\"sum\":%lu}", Name.c_str(), Count.load(), Sum.load());
+  }
+  void get(int64_t &C, int64_t &V) {
+    C = Count.load();
+    V = Sum.load();
   }
   PerfCountTy(): Count(0), Sum(0) {}
 };
@@ -73,12 +145,19 @@ struct BulkMemCount : public PerfCountTy {
 
 struct PerfRecordTy {
   bool Enabled;
+  // Dump the records when the runtime is unloaded, unset if only a tool
+  // reads them
+  bool Report;
 
   PerfEventTy Runtime;
   PerfEventTy Kernel;
   PerfEventTy H2DTransfer;
   PerfEventTy UpdatePtr;
   PerfEventTy D2HTransfer;
+  PerfEventTy H2DSync;
+  PerfEventTy PatchPtr;
+  PerfEventTy D2DTransfer;
+  PerfEventTy UVMPrefetch;
 
   PerfEventTy updateH2D;
   PerfEventTy updateD2H;
@@ -92,17 +171,33 @@ struct PerfRecordTy {
 
   PerfCountTy Parallelism;
   PerfCountTy ATTableSize;
+  PerfCountTy Coalesce;
+  PerfCountTy PoolHit;
+  PerfCountTy PoolMiss;
+  PerfCountTy BulkSegment;
+  PerfCountTy HeapGrow;
 
   BulkMemCount TargetMem;
 
+  PerfTraceTy Trace;
+
+  // PERF_JSON=<file> writes the totals there as JSON when the runtime is
+  // unloaded, tagged with the enabled modes of the device
+  std::string JsonPath;
+  std::string Modes;
+
   std::vector<PerfBaseTy*> Perfs;
-  PerfRecordTy() : Enabled(false) {
+  PerfRecordTy() : Enabled(false), Report(false) {
 #define SET_PERF_NAME(Name) Perfs.push_back(Name.setName(#Name));
     SET_PERF_NAME(Runtime); // NOTE this contains following 4
     SET_PERF_NAME(Kernel);
     SET_PERF_NAME(UpdatePtr);
     SET_PERF_NAME(H2DTransfer); //  NOTE this contains UpdatePtr
     SET_PERF_NAME(D2HTransfer);
+    SET_PERF_NAME(H2DSync);
+    SET_PERF_NAME(PatchPtr);
+    SET_PERF_NAME(D2DTransfer);
+    SET_PERF_NAME(UVMPrefetch);
 
     SET_PERF_NAME(updateH2D);
     SET_PERF_NAME(updateD2H);
@@ -116,6 +211,11 @@ struct PerfRecordTy {
 
     SET_PERF_NAME(Parallelism);
     SET_PERF_NAME(ATTableSize);
+    SET_PERF_NAME(Coalesce);
+    SET_PERF_NAME(PoolHit);
+    SET_PERF_NAME(PoolMiss);
+    SET_PERF_NAME(BulkSegment);
+    SET_PERF_NAME(HeapGrow);
     SET_PERF_NAME(TargetMem);
 #undef SET_PERF_NAME
     UpdatePtr.setLockTarget(&H2DTransfer);
@@ -125,7 +225,8 @@ struct PerfRecordTy {
 
   };
   void dump();
-  void init() {Enabled = true;}
+  void writeJson();
+  void init(bool Dump = true) {Enabled = true; Report |= Dump;}
   bool isEnabled() {return Enabled;}
 };
 
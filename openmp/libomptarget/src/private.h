@@ -14,6 +14,7 @@
 #define _OMPTARGET_PRIVATE_H
 
 #include <omptarget.h>
+#include <cstddef>
 #include <cstdint>
 #include "device.h"
 #include "mymalloc.h"
@@ -36,6 +37,9 @@ extern int target(int64_t device_id, void *host_ptr, int32_t arg_num,
 
 extern int CheckDeviceAndCtors(int64_t device_id);
 
+// Drop what was derived from map types arrays, they may go away with a library
+extern void clearMapTypesInfo();
+
 // enum for OMP_TARGET_OFFLOAD; keep in sync with kmp.h definition
 enum kmp_target_offload_kind {
   tgt_disabled = 0,
@@ -62,6 +66,24 @@ extern kmp_target_offload_kind_t TargetOffloadPolicy;
     exit(1);                                                        \
   } while (0)
 
+// Task layout shared with libomp; keep in sync with kmp_task_t in kmp.h
+typedef int32_t (*kmp_routine_entry_t)(int32_t, void *);
+typedef union kmp_cmplrdata {
+  int32_t priority;
+  kmp_routine_entry_t destructors;
+} kmp_cmplrdata_t;
+typedef struct kmp_task {
+  void *shareds;
+  kmp_routine_entry_t routine;
+  int32_t part_id;
+  kmp_cmplrdata_t data1;
+  kmp_cmplrdata_t data2;
+} kmp_task_t;
+
+// Task flags for __kmpc_omp_task_alloc; keep in sync with kmp_tasking_flags
+#define KMP_TASK_TIED 0x01
+#define KMP_TASK_DETACHABLE 0x40
+
 // Implemented in libomp, they are called from within __tgt_* functions.
 #ifdef __cplusplus
 extern "C" {
@@ -70,6 +92,18 @@ extern "C" {
 int omp_get_default_device(void) __attribute__((weak));
 int32_t __kmpc_omp_taskwait(void *loc_ref, int32_t gtid) __attribute__((weak));
 int __kmpc_get_target_offload(void) __attribute__((weak));
+int32_t __kmpc_global_thread_num(void *loc_ref) __attribute__((weak));
+kmp_task_t *__kmpc_omp_task_alloc(void *loc_ref, int32_t gtid, int32_t flags,
+    size_t sizeof_kmp_task_t, size_t sizeof_shareds,
+    kmp_routine_entry_t task_entry) __attribute__((weak));
+int32_t __kmpc_omp_task(void *loc_ref, int32_t gtid, kmp_task_t *new_task)
+    __attribute__((weak));
+int32_t __kmpc_omp_task_with_deps(void *loc_ref, int32_t gtid,
+    kmp_task_t *new_task, int32_t ndeps, void *dep_list,
+    int32_t ndeps_noalias, void *noalias_dep_list) __attribute__((weak));
+void *__kmpc_task_allow_completion_event(void *loc_ref, int gtid,
+    kmp_task_t *task) __attribute__((weak));
+void omp_fulfill_event(void *event) __attribute__((weak));
 #ifdef __cplusplus
 }
 #endif
@@ -13,6 +13,7 @@
 #include "device.h"
 #include "private.h"
 #include "rtl.h"
+#include "tool.h"
 
 #include <cassert>
 #include <cstdlib>
@@ -58,6 +59,9 @@ void RTLsTy::LoadRTLs() {
     return;
   }
 
+  // Before any device exists, so the tool sees all of their operations
+  Tool.init();
+
   DP("Loading RTLs...\n");
 
   // Attempt to open all the plugins and, if they exist, check if the interface
@@ -118,11 +122,41 @@ void RTLsTy::LoadRTLs() {
     // Optional functions
     *((void**) &R.init_requires) = dlsym(
         dynlib_handle, "__tgt_rtl_init_requires");
+    *((void**) &R.run_team_region_mode) = dlsym(
+        dynlib_handle, "__tgt_rtl_run_target_team_region_mode");
     *((void**) &R.set_mode) = dlsym(
         dynlib_handle, "__tgt_rtl_set_mode");
 
-    *((void**) &R.get_readonly_mem) = dlsym(
-        dynlib_handle, "__tgt_rtl_get_readonly_mem");
+    *((void**) &R.update_readonly_table) = dlsym(
+        dynlib_handle, "__tgt_rtl_update_readonly_table");
+
+    *((void**) &R.data_submit_async) = dlsym(
+        dynlib_handle, "__tgt_rtl_data_submit_async");
+    *((void**) &R.data_retrieve_async) = dlsym(
+        dynlib_handle, "__tgt_rtl_data_retrieve_async");
+    *((void**) &R.synchronize) = dlsym(
+        dynlib_handle, "__tgt_rtl_synchronize");
+    *((void**) &R.patch_ptrs) = dlsym(
+        dynlib_handle, "__tgt_rtl_patch_ptrs");
+    *((void**) &R.register_host) = dlsym(
+        dynlib_handle, "__tgt_rtl_register_host");
+    *((void**) &R.unregister_host) = dlsym(
+        dynlib_handle, "__tgt_rtl_unregister_host");
+    *((void**) &R.data_exchange) = dlsym(
+        dynlib_handle, "__tgt_rtl_data_exchange");
+    *((void**) &R.data_copy_rect) = dlsym(
+        dynlib_handle, "__tgt_rtl_data_copy_rect");
+    *((void**) &R.data_prefetch) = dlsym(
+        dynlib_handle, "__tgt_rtl_data_prefetch");
+
+    *((void**) &R.capture_begin) = dlsym(
+        dynlib_handle, "__tgt_rtl_capture_begin");
+    *((void**) &R.capture_end) = dlsym(
+        dynlib_handle, "__tgt_rtl_capture_end");
+    *((void**) &R.graph_launch) = dlsym(
+        dynlib_handle, "__tgt_rtl_graph_launch");
+    *((void**) &R.graph_destroy) = dlsym(
+        dynlib_handle, "__tgt_rtl_graph_destroy");
 
     // No devices are supported by this RTL?
     if (!(R.NumberOfDevices = R.number_of_devices())) {
@@ -364,6 +398,7 @@ void RTLsTy::UnregisterLib(__tgt_bin_desc *desc) {
       // if its PendingCtors list has been emptied.
       for (int32_t i = 0; i < FoundRTL->NumberOfDevices; ++i) {
         DeviceTy &Device = Devices[FoundRTL->Idx + i];
+        Device.Graphs.clear();
         Device.PendingGlobalsMtx.lock();
         if (Device.PendingCtorsDtors[desc].PendingCtors.empty()) {
           for (auto &dtor : Device.PendingCtorsDtors[desc].PendingDtors) {
@@ -400,6 +435,7 @@ void RTLsTy::UnregisterLib(__tgt_bin_desc *desc) {
       cur < desc->HostEntriesEnd; ++cur) {
     HostPtrToTableMap.erase(cur->addr);
   }
+  clearMapTypesInfo();
 
   // Remove translation table for this descriptor.
   auto tt = HostEntriesBeginToTransTable.find(desc->HostEntriesBegin);
@@ -411,9 +447,16 @@ void RTLsTy::UnregisterLib(__tgt_bin_desc *desc) {
     DP("Translation table for descriptor " DPxMOD " cannot be found, probably "
         "it has been already removed.\n", DPxPTR(desc->HostEntriesBegin));
   }
+  // The heaps outlive the libraries, but the devices are released after the
+  // last one is gone.
+  bool LastLib = HostEntriesBeginToTransTable.empty();
 
   TblMapMtx.unlock();
 
+  if (LastLib) {
+    mymalloc_unpin_all();
+  }
+
   // TODO: Remove RTL and the devices it manages if it's not used anymore?
   // TODO: Write some RTL->unload_image(...) function?
 
@@ -31,14 +31,34 @@ struct RTLInfoTy {
   typedef void *(data_alloc_ty)(int32_t, int64_t, void *);
   typedef int32_t(data_submit_ty)(int32_t, void *, void *, int64_t);
   typedef int32_t(data_retrieve_ty)(int32_t, void *, void *, int64_t);
+  typedef int32_t(data_submit_async_ty)(int32_t, void *, void *, int64_t);
+  typedef int32_t(data_retrieve_async_ty)(int32_t, void *, void *, int64_t);
+  typedef int32_t(synchronize_ty)(int32_t);
+  typedef int32_t(patch_ptrs_ty)(int32_t, void **, int64_t);
+  typedef int32_t(register_host_ty)(int32_t, void *, int64_t);
+  typedef int32_t(unregister_host_ty)(int32_t, void *);
   typedef int32_t(data_delete_ty)(int32_t, void *);
   typedef int32_t(run_region_ty)(int32_t, void *, void **, ptrdiff_t *,
                                  int32_t);
   typedef int32_t(run_team_region_ty)(int32_t, void *, void **, ptrdiff_t *,
                                       int32_t, int32_t, int32_t, uint64_t);
+  typedef int32_t(run_team_region_mode_ty)(int32_t, void *, void **,
+                                           ptrdiff_t *, int32_t, int32_t,
+                                           int32_t, uint64_t, int32_t);
   typedef int64_t(init_requires_ty)(int64_t);
   typedef int32_t(set_mode_ty)(int32_t);
-  typedef void *(get_readonly_mem_ty)(int64_t*);
+  typedef int32_t(update_readonly_table_ty)(int32_t, const char *, void *,
+                                            int64_t);
+  typedef int32_t(data_exchange_ty)(int32_t, void *, int32_t, void *,
+                                    int64_t);
+  typedef int32_t(data_copy_rect_ty)(int32_t, void *, int64_t, int64_t,
+                                     int32_t, void *, int64_t, int64_t,
+                                     int64_t, int64_t, int64_t);
+  typedef int32_t(data_prefetch_ty)(int32_t, void *, int64_t, int32_t);
+  typedef int32_t(capture_begin_ty)(int32_t);
+  typedef void *(capture_end_ty)(int32_t);
+  typedef int32_t(graph_launch_ty)(int32_t, void *);
+  typedef int32_t(graph_destroy_ty)(int32_t, void *);
 
   int32_t Idx;                     // RTL index, index is the number of devices
                                    // of other RTLs that were registered before,
@@ -63,9 +83,23 @@ struct RTLInfoTy {
   data_delete_ty *data_delete;
   run_region_ty *run_region;
   run_team_region_ty *run_team_region;
+  run_team_region_mode_ty *run_team_region_mode;
   init_requires_ty *init_requires;
   set_mode_ty *set_mode;
-  get_readonly_mem_ty *get_readonly_mem;
+  update_readonly_table_ty *update_readonly_table;
+  data_submit_async_ty *data_submit_async;
+  data_retrieve_async_ty *data_retrieve_async;
+  synchronize_ty *synchronize;
+  patch_ptrs_ty *patch_ptrs;
+  register_host_ty *register_host;
+  unregister_host_ty *unregister_host;
+  data_exchange_ty *data_exchange;
+  data_copy_rect_ty *data_copy_rect;
+  data_prefetch_ty *data_prefetch;
+  capture_begin_ty *capture_begin;
+  capture_end_ty *capture_end;
+  graph_launch_ty *graph_launch;
+  graph_destroy_ty *graph_destroy;
 
   // Are there images associated with this RTL.
   bool isUsed;
@@ -85,7 +119,13 @@ struct RTLInfoTy {
         is_valid_binary(0), number_of_devices(0), init_device(0),
         load_binary(0), data_alloc(0), data_submit(0), data_retrieve(0),
         data_delete(0), run_region(0), run_team_region(0),
-        init_requires(0), set_mode(0), get_readonly_mem(0),
+        run_team_region_mode(0),
+        init_requires(0), set_mode(0), update_readonly_table(0),
+        data_submit_async(0), data_retrieve_async(0), synchronize(0),
+        patch_ptrs(0),
+        register_host(0), unregister_host(0), data_exchange(0), data_copy_rect(0),
+        data_prefetch(0),
+        capture_begin(0), capture_end(0), graph_launch(0), graph_destroy(0),
         isUsed(false), Mtx() {}
 
   RTLInfoTy(const RTLInfoTy &r) : Mtx() {
@@ -105,10 +145,24 @@ struct RTLInfoTy {
     data_delete = r.data_delete;
     run_region = r.run_region;
     run_team_region = r.run_team_region;
+    run_team_region_mode = r.run_team_region_mode;
     init_requires = r.init_requires;
     isUsed = r.isUsed;
     set_mode = r.set_mode;
-    get_readonly_mem = r.get_readonly_mem;
+    update_readonly_table = r.update_readonly_table;
+    data_submit_async = r.data_submit_async;
+    data_retrieve_async = r.data_retrieve_async;
+    synchronize = r.synchronize;
+    patch_ptrs = r.patch_ptrs;
+    register_host = r.register_host;
+    unregister_host = r.unregister_host;
+    data_exchange = r.data_exchange;
+    data_copy_rect = r.data_copy_rect;
+    data_prefetch = r.data_prefetch;
+    capture_begin = r.capture_begin;
+    capture_end = r.capture_end;
+    graph_launch = r.graph_launch;
+    graph_destroy = r.graph_destroy;
   }
 };
 
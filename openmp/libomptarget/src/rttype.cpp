@@ -1,18 +1,117 @@
-#include <list>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <map>
+#include <mutex>
 #include <string.h>
+#include <thread>
 
 #include "omptarget.h"
 #include "private.h"
 #include "rttype.h"
 
 // ID to RttJobs
-// cache result
-static std::map<uint64_t, RttJobsTy*> RttJobsCache;
+// cache result, entries are immutable once published
+// Small IDs are looked up without locking, others go through the map
+#define RTT_JOBS_TABLE_SIZE 1024
+static std::atomic<const RttJobsTy *> RttJobsTable[RTT_JOBS_TABLE_SIZE];
+static std::map<uint64_t, const RttJobsTy*> RttJobsCache;
+static std::mutex RttJobsMtx;
 
 // For dump
 static bool first = true;
 
+// Top-level pointers per task of the parallel walk, smaller objects are
+// walked inline
+#define RTT_PARALLEL_CHUNK 4096
+
+// Snapshots kept per thread and device, all are dropped past this count
+#define RTT_SNAPSHOT_MAX 256
+
+// Pointees RttVisitedTy reserves room for at most, it grows past it
+#define RTT_VISITED_RESERVE_MAX (1 << 16)
+
+void RttVisitedTy::reset(int64_t Expected) {
+  Set.clear();
+  Set.reserve(std::min<int64_t>(Expected, RTT_VISITED_RESERVE_MAX));
+}
+
+bool RttVisitedTy::insert(void *Ptr) {
+  return Set.insert(Ptr).second;
+}
+
+// Host threads for the parallel walk, started on first use and kept
+class RttWorkersTy {
+  std::vector<std::thread> Workers;
+  std::deque<std::function<void()>> Tasks;
+  std::mutex Mtx;
+  std::condition_variable CV;
+  bool Stop = false;
+
+  // Pop and run one task, false if there is none
+  bool runOne(std::unique_lock<std::mutex> &Lock) {
+    if (Tasks.empty()) {
+      return false;
+    }
+    std::function<void()> Task = std::move(Tasks.front());
+    Tasks.pop_front();
+    Lock.unlock();
+    Task();
+    Lock.lock();
+    return true;
+  }
+
+  void work() {
+    std::unique_lock<std::mutex> Lock(Mtx);
+    while (!Stop) {
+      if (!runOne(Lock)) {
+        CV.wait(Lock);
+      }
+    }
+  }
+
+public:
+  ~RttWorkersTy() {
+    {
+      std::lock_guard<std::mutex> Lock(Mtx);
+      Stop = true;
+    }
+    CV.notify_all();
+    for (auto &W : Workers) {
+      W.join();
+    }
+  }
+
+  // Run Fn(0) ... Fn(N - 1) on up to Threads threads, the caller included
+  void run(int32_t Threads, int64_t N, const std::function<void(int64_t)> &Fn) {
+    std::mutex DoneMtx;
+    std::condition_variable DoneCV;
+    int64_t Pending = N;
+    std::unique_lock<std::mutex> Lock(Mtx);
+    while ((int32_t)Workers.size() < Threads - 1) {
+      Workers.emplace_back(&RttWorkersTy::work, this);
+    }
+    for (int64_t I = 0; I < N; ++I) {
+      Tasks.emplace_back([&, I]() {
+        Fn(I);
+        std::lock_guard<std::mutex> DoneLock(DoneMtx);
+        if (--Pending == 0) {
+          DoneCV.notify_all();
+        }
+      });
+    }
+    CV.notify_all();
+    while (runOne(Lock)) {
+    }
+    Lock.unlock();
+    std::unique_lock<std::mutex> DoneLock(DoneMtx);
+    DoneCV.wait(DoneLock, [&]() { return Pending == 0; });
+  }
+};
+static RttWorkersTy RttWorkers;
+
 int RttTy::newRttObject(void **ptr_begin, void **ptr_base,
   int64_t *data_size, int64_t *data_type) {
   isFirst = true;
@@ -41,16 +140,58 @@ int RttTy::newRttObject(void **ptr_begin, void **ptr_base,
     DP2("rtt Data size mismatch\n");
     return RTT_FAILED;
   }
-  if (!(this->Jobs = getOrGenJobs(type_array))) {
+  this->HasRegions = false;
+  this->Recording = nullptr;
+  // Not snapshotted, the pointers recorded would not include null fields
+  // set since
+  if (walkStructs(info)) {
+    return RTT_SUCCESS;
+  }
+  if (Snapshots && replaySnapshot(info)) {
+    return RTT_SUCCESS;
+  }
+  if (RTT_HAS_MARSHAL(*type_array) && info->Marshaller) {
+    // The compiled walk lists all nested regions at once
+    Regions.clear();
+    info->Marshaller(*ptr_begin, size_array, emitRegion, this);
+    this->HasRegions = true;
+    this->NextRegion = 0;
+    // See the RootRegionJob, the root is skipped if isFrom
+    this->RootPending = !this->isFrom;
+    DP2("rtt marshalled %zu regions\n", Regions.size());
+    if (Recording) {
+      Recording->Regions = Regions;
+      Recording->HasRoot = RootPending;
+      Recording->Valid = true;
+      Recording = nullptr;
+    }
+    return RTT_SUCCESS;
+  }
+  const RttJobsTy *Tmpl = getOrGenJobs(type_array);
+  if (!Tmpl) {
       DP2("rtt getOrGenJobs failed\n");
       return RTT_FAILED;
   }
+  // fillData and the walk write to the jobs
+  Jobs.assign(Tmpl->begin(), Tmpl->end());
 
   // assign size
   fillData(size_array, *ptr_begin);
   // set CurJob to 2nd Job
-  this->CurJob = ++this->Jobs->begin();
+  this->CurJob = ++this->Jobs.begin();
   this->BackReturning = false;
+  if (Dedup) {
+    resetVisited(Jobs.size() > 2 ? Jobs[2].size : 0);
+  }
+  if (Threads > 1 && walkParallel()) {
+    if (Recording) {
+      Recording->Regions = Regions;
+      Recording->HasRoot = RootPending;
+      Recording->Valid = true;
+      Recording = nullptr;
+    }
+    return RTT_SUCCESS;
+  }
 #ifdef OMPTARGET_DEBUG
   dumpJobs();
 #endif
@@ -61,6 +202,64 @@ int RttTy::newRttObject(void **ptr_begin, void **ptr_base,
   return RTT_SUCCESS;
 }
 
+// Entries of the size array read by the walk of type array T, one per pointer
+// level
+static size_t getSizeCount(const RttTypes *T) {
+  size_t N = 0;
+  for (T++; RTT_IS_PTR(*T); T++) {
+    N++;
+  }
+  return std::max<size_t>(N, 1);
+}
+
+// List the regions of the object from its snapshot if none of the pointers
+// it went through and none of the sizes changed. Otherwise start recording a
+// new snapshot for the walk about to run and return false.
+bool RttTy::replaySnapshot(RttInfoTy *info) {
+  RttSnapshotsTy::KeyTy Key(info->RttTypeArray, *ptr_begin, isFrom);
+  const int64_t *SizesBegin = info->RttSizeArray;
+  const int64_t *SizesEnd = SizesBegin + getSizeCount(info->RttTypeArray);
+  auto It = Snapshots->Objects.find(Key);
+  if (It != Snapshots->Objects.end() && It->second.Valid) {
+    RttSnapshotTy &Snap = It->second;
+    bool Changed = !std::equal(Snap.Sizes.begin(), Snap.Sizes.end(),
+                               SizesBegin, SizesEnd);
+    // Each region begins where the pointer it was reached through pointed.
+    // Regions are recorded parent before child, so the pointer of a region
+    // lies in a pointee already checked; stop at the first change, since the
+    // slots after it may be in memory the program has freed since.
+    if (!Changed) {
+      for (const RttRegionTy &R : Snap.Regions) {
+        if (*R.Base != R.Begin) {
+          Changed = true;
+          break;
+        }
+      }
+    }
+    if (!Changed) {
+      Regions = Snap.Regions;
+      HasRegions = true;
+      NextRegion = 0;
+      RootPending = Snap.HasRoot;
+      DP2("rtt snapshot of %zu regions reused\n", Regions.size());
+      return true;
+    }
+    DP2("rtt snapshot of " DPxMOD " is stale\n", DPxPTR(*ptr_begin));
+  }
+  if (It == Snapshots->Objects.end()) {
+    if (Snapshots->Objects.size() >= RTT_SNAPSHOT_MAX) {
+      Snapshots->Objects.clear();
+    }
+    It = Snapshots->Objects.emplace(Key, RttSnapshotTy()).first;
+  }
+  Recording = &It->second;
+  Recording->Regions.clear();
+  Recording->Sizes.assign(SizesBegin, SizesEnd);
+  Recording->HasRoot = false;
+  Recording->Valid = false;
+  return false;
+}
+
 void RttTy::dumpRttInfo(RttInfoTy *info) {
   //info++;
   RttTypes *type_array = info->RttTypeArray;
@@ -69,7 +268,7 @@ void RttTy::dumpRttInfo(RttInfoTy *info) {
   char buf[80];
 
   if (RTT_IS_TID(*type_array)) {
-    int32_t ID = (int32_t) (*type_array & ~RTT_TID);
+    int32_t ID = (int32_t) RTT_GET_TID(*type_array);
     sprintf(buf, "TID #%d -", ID);
     strcat(str, buf);
   } else {
@@ -84,12 +283,15 @@ void RttTy::dumpRttInfo(RttInfoTy *info) {
       sprintf(buf, ":%ld ", *size_array);
       strcat(str, buf);
       size_array++;
+    } else if (RTT_IS_TID(*type_array)) {
+      // Struct, its descriptors follow
+      break;
     } else if (!RTT_IS_BUILTIN(*type_array)) {
       printf("Not a valid type");
       break;
     }
     type_array++;
-  } while (!(*type_array & RTT_BUILTIN));
+  } while (!RTT_IS_BUILTIN(*type_array));
   //  printf("HERE\n");
   DP2("%s\n", str);
 }
@@ -98,7 +300,7 @@ void RttTy::dumpJobs() {
   if (this->isFrom) {
     DP2("IsFrom\n");
   }
-  for (auto &it : *this->Jobs) {
+  for (auto &it : this->Jobs) {
     char str[160];
     switch(it.Kind) {
       case RttJob::UpdatePtrJob:
@@ -144,12 +346,20 @@ struct RttRegionInfoTy {
     size(s), type(t) {};
 };
 
-RttJobsTy *RttTy::getOrGenJobs(RttTypes *T) {
+const RttJobsTy *RttTy::getOrGenJobs(RttTypes *T) {
   // check cache
   // 1st type is ID
-  int32_t ID = (int32_t) (*T++ & ~RTT_TID);
+  int32_t ID = (int32_t) RTT_GET_TID(*T);
+  T++;
+  bool InTable = ID >= 0 && ID < RTT_JOBS_TABLE_SIZE;
+  if (InTable) {
+    const RttJobsTy *Cached = RttJobsTable[ID].load(std::memory_order_acquire);
+    if (Cached) {
+      return Cached;
+    }
+  }
+  std::lock_guard<std::mutex> Lock(RttJobsMtx);
   auto JobsItr = RttJobsCache.find(ID);
-  // FIXME thread unsafe
   if (JobsItr != RttJobsCache.end()) {
     return JobsItr->second;
   }
@@ -176,11 +386,14 @@ RttJobsTy *RttTy::getOrGenJobs(RttTypes *T) {
     Jobs->emplace_back(RttJob::DataTransferJob, *T);
   }
   RttJobsCache[ID] = Jobs;
+  if (InTable) {
+    RttJobsTable[ID].store(Jobs, std::memory_order_release);
+  }
   return Jobs;
 }
 
 enum RttReturn RttTy::fillData(int64_t *size_array, void *first_base) {
-  for (auto &it : *this->Jobs) {
+  for (auto &it : this->Jobs) {
     switch(it.Kind) {
       case RttJob::UpdatePtrJob:
         it.size = DIVID_PTR_SIZE(*size_array) ;
@@ -200,7 +413,222 @@ enum RttReturn RttTy::fillData(int64_t *size_array, void *first_base) {
   return RTT_SUCCESS;
 }
 
+void RttTy::emitRegion(void *Ctx, void **Base, void *Begin, int64_t Size) {
+  ((RttTy *)Ctx)->Regions.push_back({Base, Begin, Size});
+}
+
+enum RttReturn RttTy::nextRegion() {
+  if (RootPending) {
+    // The root region is the argument itself
+    RootPending = false;
+    Level = 0;
+    return RTT_SUCCESS;
+  }
+  if (NextRegion == Regions.size()) {
+    return RTT_END;
+  }
+  RttRegionTy &R = Regions[NextRegion++];
+  *ptr_base = R.Base;
+  *ptr_begin = R.Begin;
+  *data_size = R.Size;
+  Level = R.Level;
+  *data_type = origin_type | OMP_TGT_MAPTYPE_PTR_AND_OBJ;
+  return RTT_SUCCESS;
+}
+
+// Expected is the number of top-level pointers, bounding the distinct
+// pointees of each level from below
+void RttTy::resetVisited(int64_t Expected) {
+  Visited.resize(Jobs.size());
+  for (size_t I = 0; I < Jobs.size(); ++I) {
+    if (Jobs[I].Kind == RttJob::UpdatePtrJob) {
+      Visited[I].reset(Expected);
+    }
+  }
+}
+
+// Walk the pointers [Begin, End) of the top-level UpdatePtrJob with a
+// private copy of the jobs and append the regions produced to Out.
+void RttTy::collectRegions(int64_t Begin, int64_t End,
+                           std::vector<RttRegionTy> &Out) const {
+  void *HstPtrBegin, *HstPtrBase;
+  int64_t Size, Type;
+  RttTy W;
+  W.Jobs = Jobs;
+  W.Jobs[2].base = *ptr_begin;
+  W.Jobs[2].idx = Begin;
+  W.Jobs[2].size = End;
+  W.CurJob = W.Jobs.begin() + 2;
+  W.BackReturning = false;
+  W.HasRegions = false;
+  W.isFrom = isFrom;
+  W.origin_type = origin_type;
+  W.Dedup = Dedup;
+  if (Dedup) {
+    W.resetVisited(End - Begin);
+  }
+  W.ptr_begin = &HstPtrBegin;
+  W.ptr_base = &HstPtrBase;
+  W.data_size = &Size;
+  W.data_type = &Type;
+  while (W.computeRegion() == RTT_SUCCESS) {
+    Out.push_back({(void **)HstPtrBase, HstPtrBegin, Size, W.Level});
+  }
+}
+
+// List the regions up front, splitting the top-level pointers across the
+// host threads. Return false if the object is too small to be worth it.
+bool RttTy::walkParallel() {
+  // Jobs are [End, Root, UpdatePtr, ...] for objects with pointers below
+  // the root
+  if (Jobs.size() < 4 || Jobs[1].Kind != RttJob::RootRegionJob ||
+      Jobs[2].Kind != RttJob::UpdatePtrJob ||
+      Jobs[2].size < 2 * RTT_PARALLEL_CHUNK) {
+    return false;
+  }
+  int64_t Count = Jobs[2].size;
+  int64_t NumChunks = (Count + RTT_PARALLEL_CHUNK - 1) / RTT_PARALLEL_CHUNK;
+  // Per chunk so the regions keep the order of the sequential walk
+  std::vector<std::vector<RttRegionTy>> Chunks(NumChunks);
+  RttWorkers.run(Threads, NumChunks, [&](int64_t I) {
+    collectRegions(I * RTT_PARALLEL_CHUNK,
+                   std::min(Count, (I + 1) * RTT_PARALLEL_CHUNK), Chunks[I]);
+  });
+
+  size_t Total = 0;
+  for (auto &C : Chunks) {
+    Total += C.size();
+  }
+  Regions.clear();
+  Regions.reserve(Total);
+  for (auto &C : Chunks) {
+    Regions.insert(Regions.end(), C.begin(), C.end());
+  }
+  HasRegions = true;
+  NextRegion = 0;
+  RootPending = !isFrom;
+  DP2("rtt walked %" PRId64 " pointers in %" PRId64 " chunks, %zu regions\n",
+      Count, NumChunks, Regions.size());
+  return true;
+}
+
+// Descriptor of struct TID among the ones following a type array
+static const RttTypes *findStruct(const RttTypes *Descs, uint64_t TID) {
+  while (RTT_IS_TID(Descs[0]) && RTT_IS_STRUCT(Descs[1])) {
+    if (RTT_GET_TID(Descs[0]) == TID) {
+      return Descs;
+    }
+    Descs += 3 + 3 * RTT_GET_FIELDS(Descs[1]);
+  }
+  return nullptr;
+}
+
+// Structs left to walk, Count of them from Begin on, Level pointers below
+// the root
+struct RttStructRangeTy {
+  char *Begin;
+  int64_t Count;
+  const RttTypes *Desc;
+  int Level;
+};
+
+// Append a region for every non-null pointer field of the Size bytes of
+// structs at Begin, and of the structs reached through them. A struct is
+// walked once, pointers to it are still produced to be updated.
+static void walkStructArray(void *Begin, int64_t Size, int Level,
+                            const RttTypes *Desc, const RttTypes *Descs,
+                            RttVisitedTy &Walked,
+                            std::vector<RttRegionTy> &Out) {
+  if (Desc[2] <= 0 || Size < (int64_t)Desc[2]) {
+    return;
+  }
+  // Depth first without recursion, linked structures are deep
+  std::vector<RttStructRangeTy> Todo;
+  Todo.push_back({(char *)Begin, Size / (int64_t)Desc[2], Desc, Level});
+  while (!Todo.empty()) {
+    RttStructRangeTy &R = Todo.back();
+    char *Elem = R.Begin;
+    const RttTypes *D = R.Desc;
+    int Below = R.Level + 1;
+    R.Begin += D[2];
+    if (--R.Count == 0) {
+      Todo.pop_back();
+    }
+    if (!Walked.insert(Elem)) {
+      continue;
+    }
+    const RttTypes *F = D + 3;
+    for (uint64_t I = 0; I < RTT_GET_FIELDS(D[1]); ++I, F += 3) {
+      void **Slot = (void **)(Elem + F[0]);
+      void *Ptr = *Slot;
+      if (!Ptr) {
+        continue;
+      }
+      Out.push_back({Slot, Ptr, (int64_t)F[1], Below});
+      if (RTT_IS_TID(F[2])) {
+        if (const RttTypes *PD = findStruct(Descs, RTT_GET_TID(F[2]))) {
+          Todo.push_back({(char *)Ptr, 1, PD, Below});
+        }
+      }
+    }
+  }
+}
+
+// Walk the pointer arrays of Depth down to the struct arrays, producing each
+// region before the ones below it as the job walk does
+void RttTy::walkStructLevel(void *Array, size_t Depth, size_t Levels,
+                            const int64_t *Sizes, const RttTypes *Leaf,
+                            const RttTypes *Descs, RttVisitedTy &Walked) {
+  if (Depth + 1 == Levels) {
+    if (Leaf) {
+      walkStructArray(Array, Sizes[Depth], Depth, Leaf, Descs, Walked,
+                      Regions);
+    }
+    return;
+  }
+  void **Slots = (void **)Array;
+  for (int64_t I = 0; I < DIVID_PTR_SIZE(Sizes[Depth]); ++I) {
+    if (!Slots[I]) {
+      continue;
+    }
+    Regions.push_back({&Slots[I], Slots[I], Sizes[Depth + 1],
+                       (int)Depth + 1});
+    walkStructLevel(Slots[I], Depth + 1, Levels, Sizes, Leaf, Descs, Walked);
+  }
+}
+
+// List the regions up front if the pointer chain of the type ends in a
+// struct, following its pointer fields. Return false for other types.
+bool RttTy::walkStructs(RttInfoTy *info) {
+  const RttTypes *T = info->RttTypeArray + 1;
+  size_t Levels = 0;
+  for (; RTT_IS_PTR(*T); T++) {
+    Levels++;
+  }
+  if (!Levels || !RTT_IS_TID(*T)) {
+    return false;
+  }
+  const RttTypes *Leaf = findStruct(T + 1, RTT_GET_TID(*T));
+  if (!Leaf) {
+    DP2("rtt no descriptor for struct TID #%d\n", (int32_t)RTT_GET_TID(*T));
+  }
+  RttVisitedTy Walked;
+  Walked.reset(0);
+  Regions.clear();
+  walkStructLevel(*ptr_begin, 0, Levels, info->RttSizeArray, Leaf, T + 1,
+                  Walked);
+  HasRegions = true;
+  NextRegion = 0;
+  // See the RootRegionJob, a root of pointers is skipped if isFrom
+  RootPending = !isFrom || Levels == 1;
+  DP2("rtt walked struct fields, %zu regions\n", Regions.size());
+  return true;
+}
+
 enum RttReturn RttTy::computeRegion() {
+  if (HasRegions) {
+    return nextRegion();
+  }
   //dumpJobs();
   // Depends on CurJob
   // Deal with back
@@ -213,6 +641,10 @@ COMPUTE:
         break;
       }
     } else if (CurJob->Kind == RttJob::EndJob) {
+      if (Recording) {
+        Recording->Valid = true;
+        Recording = nullptr;
+      }
       return RTT_END;
     } else {
       CurJob--;
@@ -236,14 +668,28 @@ COMPUTE:
       *ptr_begin = ptr;
       *data_size = CurJob->size;
       *data_type = origin_type | OMP_TGT_MAPTYPE_PTR_AND_OBJ;
+      // Jobs are [End, Root, UpdatePtr, DataTransfer, UpdatePtr, ...]
+      Level = (CurJob - Jobs.begin() - 1) / 2;
+      if (Recording) {
+        Recording->Regions.push_back({base, ptr, CurJob->size, Level});
+      }
       CurJob++;
-      if (CurJob->Kind == RttJob::UpdatePtrJob) {
+      if (CurJob != this->Jobs.end() &&
+          CurJob->Kind == RttJob::UpdatePtrJob) {
+        if (Dedup && !Visited[CurJob - Jobs.begin()].insert(ptr)) {
+          // The pointees were walked through another pointer, go back up
+          // as if they were done
+          CurJob--;
+          BackReturning = true;
+          return RTT_SUCCESS;
+        }
         CurJob->base = ptr;
         CurJob->idx = 0;
       }
       break;
     }
     case RttJob::RootRegionJob: {
+      Level = 0;
       CurJob++;
       if (CurJob->Kind == RttJob::UpdatePtrJob) {
         CurJob->base = *ptr_begin;
@@ -253,6 +699,9 @@ COMPUTE:
       if (this->isFrom && (CurJob->DataType & RTT_PTR)) {
         goto COMPUTE;
       }
+      if (Recording) {
+        Recording->HasRoot = true;
+      }
       break;
     }
     case RttJob::SkipJob:
@@ -263,7 +712,7 @@ COMPUTE:
       DP2("This should not happend");
       return RTT_FAILED;
   }
-  if (CurJob == this->Jobs->end()) {
+  if (CurJob == this->Jobs.end()) {
     CurJob--;
     BackReturning = true;
     //DP2("Going back\n");
@@ -1,6 +1,11 @@
 #ifndef _OMPTARGET_RTTYPE_H_
 #define _OMPTARGET_RTTYPE_H_
 
+#include <map>
+#include <tuple>
+#include <unordered_set>
+#include <vector>
+
 #include "omptarget.h"
 // constraint in 1 byte
 // int64_t for unify
@@ -11,10 +16,14 @@
 //#define RTT_GET_BYTE(T)    1 << (T & RTT_BYTE_MASK)
 
 // type hepler
-#define RTT_IS_BUILTIN(T)   (T & RTT_BUILTIN)
+// BUILTIN and PTR are whole words, a TID word may have their bits set
+#define RTT_IS_BUILTIN(T)   (T == RTT_BUILTIN)
 #define RTT_IS_STRUCT(T)    (T & RTT_STRUCT)
-#define RTT_IS_PTR(T)       (T & RTT_PTR)
+#define RTT_IS_PTR(T)       (T == RTT_PTR)
 #define RTT_IS_TID(T)       (T & RTT_TID)
+#define RTT_HAS_MARSHAL(T)  (T & RTT_MARSHAL)
+#define RTT_GET_TID(T)      (T & ~(RTT_TID | RTT_MARSHAL))
+#define RTT_GET_FIELDS(T)   (T & ~RTT_STRUCT)
 
 #define DIVID_PTR_SIZE(INT) (INT >> 3) // FIXME not portable
 
@@ -28,17 +37,62 @@ enum RttReturn {
 enum RttTypes : uint64_t {
   RTT_BUILTIN       = 0x01,
   RTT_PTR           = 0x02,
+  // Set on the TID when the rtt info holds a Marshaller
+  RTT_MARSHAL       = 0x1UL << 60,
   RTT_STRUCT        = 0x2UL << 60,
   RTT_TID           = 0x4UL << 60,
 };
 
+// Called by a marshaller for every nested region, Base holds Begin
+typedef void RttEmitFnTy(void *Ctx, void **Base, void *Begin, int64_t Size);
+// Compiled walk over one type emitted by clang with -openmp-dc-marshaller
+typedef void RttMarshalFnTy(void *Root, int64_t *Sizes, RttEmitFnTy *Emit,
+                            void *Ctx);
+
+// A type array whose pointer chain ends in a struct, [TID, PTR..., TID of S],
+// is followed by the descriptors of S and of every struct reachable from its
+// fields, each
+//   [TID, RTT_STRUCT | Fields, sizeof, (offset, pointee size, pointee)...]
+// and a 0 word. A pointee is RTT_BUILTIN, or the TID of a struct whose
+// fields are walked as well. Only the pointer fields deep copy follows are
+// listed, each maps one pointee.
 struct RttInfoTy {
   RttTypes *RttTypeArray;
   int64_t *RttSizeArray;
+  // Only present if the TID has RTT_MARSHAL, null if the type has none
+  RttMarshalFnTy *Marshaller;
+};
+
+// Region produced by a marshaller
+struct RttRegionTy {
+  void **Base;
+  void *Begin;
+  int64_t Size;
+  // Pointers followed from the root, 0 if unknown
+  int Level;
 };
 
 bool RttValidMaptype(int Type);
 
+// Regions of one object listed by an earlier walk. The object is walked
+// again only once one of the listed pointers holds another value.
+struct RttSnapshotTy {
+  std::vector<RttRegionTy> Regions;
+  // Size array the walk ran with, its counts change the regions as well
+  std::vector<int64_t> Sizes;
+  // Whether the walk produced the root region before the nested ones
+  bool HasRoot = false;
+  // Set once the walk reached its end
+  bool Valid = false;
+};
+
+// Snapshots by rtt type array, root object and direction. The type arrays are
+// emitted once per type, the rtt infos pointing to them may be temporaries.
+struct RttSnapshotsTy {
+  typedef std::tuple<RttTypes *, void *, bool> KeyTy;
+  std::map<KeyTy, RttSnapshotTy> Objects;
+};
+
 struct RttJob {
   enum kind{
     UpdatePtrJob,
@@ -57,7 +111,20 @@ struct RttJob {
   RttJob(enum kind k, enum RttTypes T) : Kind(k), DataType(T) {idx = 0;};
 };
 
-class RttJobsTy : public std::list<RttJob> {
+// Pointees already walked during one object, so that pointers aliasing a
+// shared sub-object do not walk it again.
+class RttVisitedTy {
+  std::unordered_set<void *> Set;
+
+public:
+  // Forget all visits, sizing the set for about Expected pointees
+  void reset(int64_t Expected);
+  // Return true if Ptr was not visited before
+  bool insert(void *Ptr);
+};
+
+// Contiguous so the CurJob++/-- walk stays in cache
+class RttJobsTy : public std::vector<RttJob> {
 };
 typedef RttJobsTy::iterator RttJobsItrTy;
 
@@ -81,10 +148,30 @@ struct RttTy {
   // OMP_MAP_TYPE
   int64_t origin_type;
 
-  // Job list
-  RttJobsTy *Jobs;
+  // Job list, private copy of the cached template
+  RttJobsTy Jobs;
   // Iterator
   RttJobsItrTy CurJob;
+  // Regions listed up front by a marshaller or the parallel walk, used
+  // instead of the jobs
+  std::vector<RttRegionTy> Regions;
+  size_t NextRegion;
+  bool HasRegions;
+  bool RootPending;
+  // Host threads for objects with many top-level pointers
+  int32_t Threads = 1;
+  // Walk the pointees of aliasing pointers once, the pointers themselves
+  // are still produced to be updated
+  bool Dedup = false;
+  // Per job, only UpdatePtrJobs use theirs
+  std::vector<RttVisitedTy> Visited;
+  // Regions of objects walked before, reused while their pointers hold the
+  // same values. Null disables snapshots.
+  RttSnapshotsTy *Snapshots = nullptr;
+  // Snapshot filled by the current walk
+  RttSnapshotTy *Recording = nullptr;
+  // Pointers followed from the root to the last region, see RttRegionTy
+  int Level = 0;
   bool BackReturning;
   bool isFirst;
   bool isFrom;
@@ -94,16 +181,10 @@ struct RttTy {
     this->isFrom = false;
     this->isFirst = true;
   }
-  void initIsFrom(void **args, int64_t *arg_types, int32_t arg_num) {
+  // count is the number of OMP_TGT_MAPTYPE_NESTED entries
+  void initIsFrom(void **args, int32_t arg_num, int32_t count) {
     this->isFrom = true;
     this->isFirst = true;
-    // get Rtt count
-    int count = 0;
-    for (int i = 0; i < arg_num; i++) {
-      if (arg_types[i] & OMP_TGT_MAPTYPE_NESTED) {
-        count++;
-      }
-    }
     //get last INFO
     this->rtt_infos = (RttInfoTy **)(args + arg_num + count - 1);
   }
@@ -114,7 +195,18 @@ struct RttTy {
   private:
   int computeRegion1();
   static int validMaptype(int Type);
-  RttJobsTy *getOrGenJobs(RttTypes *);
+  static const RttJobsTy *getOrGenJobs(RttTypes *);
+  static void emitRegion(void *Ctx, void **Base, void *Begin, int64_t Size);
+  enum RttReturn nextRegion();
+  void resetVisited(int64_t Expected);
+  void collectRegions(int64_t Begin, int64_t End,
+                      std::vector<RttRegionTy> &Out) const;
+  bool walkParallel();
+  bool walkStructs(RttInfoTy *info);
+  void walkStructLevel(void *Array, size_t Depth, size_t Levels,
+                       const int64_t *Sizes, const RttTypes *Leaf,
+                       const RttTypes *Descs, RttVisitedTy &Walked);
+  bool replaySnapshot(RttInfoTy *info);
   void dumpRttInfo(RttInfoTy *);
   void dumpJobs();
   enum RttReturn fillData(int64_t *size_array, void* first_base);
@@ -20,3 +20,154 @@ std::string SegmentTy::getString() {
 #endif
   return std::string(buf);
 }
+
+static inline bool segContains(const SegmentTy *Seg, uintptr_t HstPtrBegin,
+    uintptr_t HstPtrEnd) {
+  return HstPtrBegin >= Seg->HstPtrBegin && HstPtrBegin < Seg->HstPtrEnd &&
+      HstPtrEnd <= Seg->HstPtrEnd;
+}
+
+const SegmentTy *SegmentListTy::find(uintptr_t HstPtrBegin, int64_t Size) {
+  if (IndexDirty) {
+    Index.clear();
+    Index.reserve(size());
+    // Map is ordered high to low
+    for (auto it = rbegin(); it != rend(); ++it) {
+      Index.push_back(it->second);
+    }
+    LastHit = 0;
+    IndexDirty = false;
+  }
+  size_t N = Index.size();
+  if (N == 0) {
+    return NULL;
+  }
+  uintptr_t HstPtrEnd = HstPtrBegin + Size;
+
+  // Pointer chains mostly stay within one segment
+  const SegmentTy *Seg = &Index[LastHit];
+  if (segContains(Seg, HstPtrBegin, HstPtrEnd)) {
+    return Seg;
+  }
+
+  // Branchless search for the last segment starting at or below HstPtrBegin
+  Seg = Index.data();
+  while (N > 1) {
+    size_t Half = N / 2;
+    Seg = (Seg[Half].HstPtrBegin <= HstPtrBegin) ? Seg + Half : Seg;
+    N -= Half;
+  }
+  if (!segContains(Seg, HstPtrBegin, HstPtrEnd)) {
+    return NULL;
+  }
+  LastHit = Seg - Index.data();
+  return Seg;
+}
+
+SegmentReplicasTy SegmentReplicas;
+
+// Return a copy of [HstPtrBegin, HstPtrEnd) on another device that Device
+// can copy from
+bool SegmentReplicasTy::find(DeviceTy &Device, uintptr_t HstPtrBegin,
+    uintptr_t HstPtrEnd, ReplicaTy &Replica) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  auto It = Replicas.find(RangeTy(HstPtrBegin, HstPtrEnd));
+  if (It == Replicas.end()) {
+    return false;
+  }
+  for (auto &R : It->second) {
+    if (R.DeviceID != Device.DeviceID &&
+        Devices[R.DeviceID].RTL == Device.RTL) {
+      Replica = R;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SegmentReplicasTy::add(DeviceTy &Device, uintptr_t HstPtrBegin,
+    uintptr_t HstPtrEnd, uintptr_t TgtPtrBegin) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  RangeTy Range(HstPtrBegin, HstPtrEnd);
+  auto &List = Replicas[Range];
+  ByTarget[std::make_pair(Device.DeviceID, TgtPtrBegin)] = Range;
+  for (auto &R : List) {
+    if (R.DeviceID == Device.DeviceID) {
+      if (R.TgtPtrBegin != TgtPtrBegin) {
+        ByTarget.erase(std::make_pair(R.DeviceID, R.TgtPtrBegin));
+        R.TgtPtrBegin = TgtPtrBegin;
+      }
+      return;
+    }
+  }
+  List.push_back({Device.DeviceID, TgtPtrBegin});
+}
+
+// Erase a range and the index entries of its copies, Mtx must be held
+void SegmentReplicasTy::eraseLocked(
+    std::map<RangeTy, std::vector<ReplicaTy>>::iterator It) {
+  for (auto &R : It->second) {
+    ByTarget.erase(std::make_pair(R.DeviceID, R.TgtPtrBegin));
+  }
+  Replicas.erase(It);
+}
+
+// Drop every range overlapping [HstPtrBegin, HstPtrEnd)
+void SegmentReplicasTy::drop(uintptr_t HstPtrBegin, uintptr_t HstPtrEnd) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  // Ranges are ordered by begin, the ones starting at or after HstPtrEnd
+  // cannot overlap
+  auto End = Replicas.lower_bound(RangeTy(HstPtrEnd, 0));
+  for (auto It = Replicas.begin(); It != End;) {
+    if (It->first.second > HstPtrBegin) {
+      eraseLocked(It++);
+    } else {
+      ++It;
+    }
+  }
+}
+
+// The other copies no longer hold the content of the written one, drop the
+// ranges of all copies on Device overlapping the write
+void SegmentReplicasTy::written(DeviceTy &Device, uintptr_t TgtPtrBegin,
+    int64_t Size) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  uintptr_t TgtPtrEnd = TgtPtrBegin + Size;
+  // Copies on one device do not overlap, walk back from the last one
+  // starting before the end of the write
+  auto It = ByTarget.lower_bound(std::make_pair(Device.DeviceID, TgtPtrEnd));
+  while (It != ByTarget.begin()) {
+    --It;
+    if (It->first.first != Device.DeviceID) {
+      break;
+    }
+    RangeTy Range = It->second;
+    if (It->first.second + (Range.second - Range.first) <= TgtPtrBegin) {
+      break;
+    }
+    DP("Write to copy " DPxMOD " on device %d drops its segment\n",
+       DPxPTR(It->first.second), Device.DeviceID);
+    eraseLocked(Replicas.find(Range));
+    It = ByTarget.lower_bound(std::make_pair(Device.DeviceID, TgtPtrEnd));
+  }
+}
+
+void SegmentReplicasTy::freed(DeviceTy &Device, uintptr_t TgtPtrBegin) {
+  std::lock_guard<std::mutex> Lock(Mtx);
+  auto It = ByTarget.find(std::make_pair(Device.DeviceID, TgtPtrBegin));
+  if (It == ByTarget.end()) {
+    return;
+  }
+  auto RIt = Replicas.find(It->second);
+  ByTarget.erase(It);
+  auto &List = RIt->second;
+  for (auto LIt = List.begin(); LIt != List.end(); ++LIt) {
+    if (LIt->DeviceID == Device.DeviceID) {
+      List.erase(LIt);
+      break;
+    }
+  }
+  if (List.empty()) {
+    Replicas.erase(RIt);
+  }
+}
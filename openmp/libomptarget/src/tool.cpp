@@ -0,0 +1,260 @@
+// Tool interface, see omptarget-tools.h
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <string>
+
+#include "perf.h"
+#include "private.h"
+#include "tool.h"
+
+ToolTy Tool;
+
+// Target construct of the calling thread, 0 outside of any
+static thread_local tgt_tool_id_t CurTarget = 0;
+static thread_local const void *CurCodePtr = nullptr;
+
+static uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void ToolTraceTy::flush() {
+  if (Buffer) {
+    Complete(DeviceNum, Buffer, Used * sizeof(tgt_tool_record_t), 1);
+  }
+  Buffer = nullptr;
+  Capacity = 0;
+  Used = 0;
+}
+
+static int setCallback(tgt_tool_callbacks_t Event,
+    tgt_tool_callback_t Callback) {
+  switch (Event) {
+  case tgt_tool_callback_target:
+    Tool.TargetCb = (tgt_tool_callback_target_t)Callback;
+    return 1;
+  case tgt_tool_callback_target_data_op:
+    Tool.DataOpCb = (tgt_tool_callback_target_data_op_t)Callback;
+    return 1;
+  case tgt_tool_callback_target_submit:
+    Tool.SubmitCb = (tgt_tool_callback_target_submit_t)Callback;
+    return 1;
+  }
+  return 0;
+}
+
+static int startTrace(int DeviceNum,
+    tgt_tool_callback_buffer_request_t Request,
+    tgt_tool_callback_buffer_complete_t Complete) {
+  if (!Request || !Complete) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> Lock(Tool.TracesMtx);
+  ToolTraceTy *&T = Tool.Traces[DeviceNum];
+  if (!T) {
+    T = new ToolTraceTy(DeviceNum);
+  }
+  std::lock_guard<std::mutex> TraceLock(T->Mtx);
+  if (T->Request) {
+    // Already running, the buffer belongs to the first callbacks
+    T->flush();
+  }
+  T->Request = Request;
+  T->Complete = Complete;
+  Tool.Tracing = true;
+  return 1;
+}
+
+static ToolTraceTy *findTrace(int DeviceNum) {
+  std::lock_guard<std::mutex> Lock(Tool.TracesMtx);
+  auto It = Tool.Traces.find(DeviceNum);
+  return It == Tool.Traces.end() ? nullptr : It->second;
+}
+
+static int flushTrace(int DeviceNum) {
+  ToolTraceTy *T = findTrace(DeviceNum);
+  if (!T) {
+    return 0;
+  }
+  std::lock_guard<std::mutex> Lock(T->Mtx);
+  if (!T->Request) {
+    return 0;
+  }
+  T->flush();
+  return 1;
+}
+
+static int stopTrace(int DeviceNum) {
+  ToolTraceTy *T = findTrace(DeviceNum);
+  if (!T) {
+    return 0;
+  }
+  {
+    std::lock_guard<std::mutex> Lock(T->Mtx);
+    if (!T->Request) {
+      return 0;
+    }
+    T->flush();
+    T->Request = nullptr;
+    T->Complete = nullptr;
+  }
+  std::lock_guard<std::mutex> Lock(Tool.TracesMtx);
+  bool Any = false;
+  for (auto &KV : Tool.Traces) {
+    Any |= KV.second->Request != nullptr;
+  }
+  Tool.Tracing = Any;
+  return 1;
+}
+
+static const char *getCounterName(int Index) {
+  if (Index < 0 || (size_t)Index >= Perf.Perfs.size()) {
+    return nullptr;
+  }
+  return Perf.Perfs[Index]->Name.c_str();
+}
+
+static int getCounter(const char *Name, uint64_t *Count, uint64_t *Value) {
+  for (auto P : Perf.Perfs) {
+    if (P->Name == Name) {
+      int64_t C = 0, V = 0;
+      P->get(C, V);
+      *Count = C;
+      *Value = V;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static const tgt_tool_interface_t Interface = {
+    setCallback, startTrace, flushTrace, stopTrace, getCounterName,
+    getCounter};
+
+// A tool linked into the program wins over OMP_TARGET_TOOL_LIBRARIES, a
+// ':' separated list tried in order
+void ToolTy::init() {
+  tgt_tool_start_t Start =
+      (tgt_tool_start_t)dlsym(RTLD_DEFAULT, "__tgt_tool_start");
+  if (Start && Start(TGT_TOOL_VERSION, &Interface)) {
+    Enabled = true;
+  } else if (char *envStr = getenv("OMP_TARGET_TOOL_LIBRARIES")) {
+    std::string Libs = envStr;
+    size_t Pos = 0;
+    while (!Enabled && Pos <= Libs.size()) {
+      size_t Next = Libs.find(':', Pos);
+      if (Next == std::string::npos) {
+        Next = Libs.size();
+      }
+      std::string Lib = Libs.substr(Pos, Next - Pos);
+      Pos = Next + 1;
+      void *Handle = Lib.empty() ? nullptr : dlopen(Lib.c_str(), RTLD_NOW);
+      if (!Handle) {
+        continue;
+      }
+      Start = (tgt_tool_start_t)dlsym(Handle, "__tgt_tool_start");
+      if (Start && Start(TGT_TOOL_VERSION, &Interface)) {
+        DP("Attached tool %s\n", Lib.c_str());
+        Enabled = true;
+      } else {
+        dlclose(Handle);
+      }
+    }
+  }
+  if (Enabled) {
+    // The counters are only kept while Perf is enabled
+    Perf.init(false);
+  }
+}
+
+void ToolTy::flushTraces() {
+  std::lock_guard<std::mutex> Lock(TracesMtx);
+  for (auto &KV : Traces) {
+    std::lock_guard<std::mutex> TraceLock(KV.second->Mtx);
+    if (KV.second->Request) {
+      KV.second->flush();
+    }
+  }
+}
+
+void ToolTy::beginTarget(tgt_tool_target_t Kind, int64_t DeviceNum,
+    const void *CodePtr) {
+  CurTarget = NextId++;
+  CurCodePtr = CodePtr;
+  if (TargetCb) {
+    TargetCb(Kind, tgt_tool_scope_begin, DeviceNum, CurTarget, CodePtr);
+  }
+}
+
+void ToolTy::endTarget(tgt_tool_target_t Kind, int64_t DeviceNum) {
+  if (TargetCb) {
+    TargetCb(Kind, tgt_tool_scope_end, DeviceNum, CurTarget, CurCodePtr);
+  }
+  CurTarget = 0;
+  CurCodePtr = nullptr;
+}
+
+void ToolTy::beginDataOp(tgt_tool_record_t &Op,
+    tgt_tool_target_data_op_t OpType, void *Src, int SrcDevice, void *Dst,
+    int DstDevice, size_t Bytes) {
+  Op.type = tgt_tool_callback_target_data_op;
+  Op.device_num = DstDevice != HOST_DEVICE ? DstDevice : SrcDevice;
+  Op.target_id = CurTarget;
+  Op.host_op_id = NextId++;
+  Op.record.data_op.optype = OpType;
+  Op.record.data_op.src_addr = Src;
+  Op.record.data_op.src_device_num = SrcDevice;
+  Op.record.data_op.dest_addr = Dst;
+  Op.record.data_op.dest_device_num = DstDevice;
+  Op.record.data_op.bytes = Bytes;
+  if (DataOpCb) {
+    DataOpCb(CurTarget, Op.host_op_id, OpType, Src, SrcDevice, Dst, DstDevice,
+        Bytes, CurCodePtr);
+  }
+  Op.time = nowNs();
+}
+
+void ToolTy::beginSubmit(tgt_tool_record_t &Op, int DeviceNum,
+    unsigned Teams) {
+  Op.type = tgt_tool_callback_target_submit;
+  Op.device_num = DeviceNum;
+  Op.target_id = CurTarget;
+  Op.host_op_id = NextId++;
+  Op.record.submit.requested_num_teams = Teams;
+  if (SubmitCb) {
+    SubmitCb(CurTarget, Op.host_op_id, Teams);
+  }
+  Op.time = nowNs();
+}
+
+void ToolTy::end(tgt_tool_record_t &Op) {
+  Op.end_time = nowNs();
+  if (!Tracing.load(std::memory_order_relaxed)) {
+    return;
+  }
+  ToolTraceTy *T = findTrace(Op.device_num);
+  if (!T) {
+    return;
+  }
+  std::lock_guard<std::mutex> Lock(T->Mtx);
+  if (!T->Request) {
+    return;
+  }
+  if (!T->Buffer) {
+    size_t Bytes = 0;
+    T->Request(T->DeviceNum, &T->Buffer, &Bytes);
+    T->Capacity = Bytes / sizeof(tgt_tool_record_t);
+    T->Used = 0;
+    if (!T->Buffer || !T->Capacity) {
+      // Dropped, the tool has no room
+      T->Buffer = nullptr;
+      return;
+    }
+  }
+  T->Buffer[T->Used++] = Op;
+  if (T->Used == T->Capacity) {
+    T->flush();
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef _OMPTARGET_TOOL_H_
+#define _OMPTARGET_TOOL_H_
+#include <atomic>
+#include <map>
+#include <mutex>
+
+#include <omptarget-tools.h>
+
+#define TOOL_WRAP(...) if (__builtin_expect(Tool.Enabled, 0)) do { __VA_ARGS__;} while(0);
+
+// Trace buffer of one device, see tgt_tool_interface_t::start_trace
+struct ToolTraceTy {
+  int DeviceNum;
+  // Null once the trace is stopped
+  tgt_tool_callback_buffer_request_t Request;
+  tgt_tool_callback_buffer_complete_t Complete;
+  tgt_tool_record_t *Buffer;
+  size_t Capacity; // records
+  size_t Used;
+  std::mutex Mtx;
+
+  ToolTraceTy(int DeviceNum)
+      : DeviceNum(DeviceNum), Request(nullptr), Complete(nullptr),
+        Buffer(nullptr), Capacity(0), Used(0) {}
+  // Hand the records so far back to the tool
+  void flush();
+};
+
+// Tool attached through omptarget-tools.h. Target constructs are reported
+// by the interface functions, data ops and kernel launches by DeviceTy,
+// each with a begin/end pair on the same record.
+struct ToolTy {
+  bool Enabled;
+  tgt_tool_callback_target_t TargetCb;
+  tgt_tool_callback_target_data_op_t DataOpCb;
+  tgt_tool_callback_target_submit_t SubmitCb;
+
+  // Devices traced at some point, entries are kept until exit. Tracing is
+  // set while any trace is running.
+  std::map<int, ToolTraceTy *> Traces;
+  std::mutex TracesMtx;
+  std::atomic<bool> Tracing;
+
+  std::atomic<tgt_tool_id_t> NextId;
+
+  ToolTy() : Enabled(false), TargetCb(nullptr), DataOpCb(nullptr),
+      SubmitCb(nullptr), Tracing(false), NextId(1) {}
+  // Look for a tool, once before the first device is used
+  void init();
+  // Complete the buffers of all traced devices
+  void flushTraces();
+
+  void beginTarget(tgt_tool_target_t Kind, int64_t DeviceNum,
+      const void *CodePtr);
+  void endTarget(tgt_tool_target_t Kind, int64_t DeviceNum);
+
+  void beginDataOp(tgt_tool_record_t &Op, tgt_tool_target_data_op_t OpType,
+      void *Src, int SrcDevice, void *Dst, int DstDevice, size_t Bytes);
+  void beginSubmit(tgt_tool_record_t &Op, int DeviceNum, unsigned Teams);
+  // Stamp the end of Op and add it to the trace of its device
+  void end(tgt_tool_record_t &Op);
+};
+
+extern ToolTy Tool;
+
+#endif
@@ -0,0 +1,46 @@
+//===---- dc-matrix.c - Deep copy of a matrix of row pointers -------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// The rows are mapped through the nested array section, so each launch runs
+// the RTT walk and the pointer updates of every row.
+//
+//===----------------------------------------------------------------------===//
+
+#include "workload.h"
+
+#define ROWS 2048
+#define COLS 1024
+
+static int run(void) {
+  int **A = (int **)malloc(ROWS * sizeof(int *));
+  for (int i = 0; i < ROWS; i++) {
+    A[i] = (int *)malloc(COLS * sizeof(int));
+    for (int j = 0; j < COLS; j++) {
+      A[i][j] = i + j;
+    }
+  }
+
+  for (int It = 0; It < WORKLOAD_ITERS; It++) {
+#pragma omp target teams distribute parallel for map(tofrom: A[0:ROWS][0:COLS])
+    for (int i = 0; i < ROWS; i++) {
+      for (int j = 0; j < COLS; j++) {
+        A[i][j] += 1;
+      }
+    }
+  }
+
+  int Errors = 0;
+  for (int i = 0; i < ROWS; i++) {
+    for (int j = 0; j < COLS; j++) {
+      Errors += A[i][j] != i + j + WORKLOAD_ITERS;
+    }
+    free(A[i]);
+  }
+  free(A);
+  return Errors != 0;
+}
@@ -0,0 +1,69 @@
+//===---- list-walk.c - Walk linked lists through translated pointers -----===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Every node is a separate allocation, shuffled across the lists, so each
+// hop is a dependent load behind an address translation.
+//
+//===----------------------------------------------------------------------===//
+
+#include "workload.h"
+
+#define LISTS 4096
+#define NODES 64
+
+struct Node {
+  long Value;
+  struct Node *Next;
+};
+
+static int run(void) {
+  struct Node **Heads = (struct Node **)malloc(LISTS * sizeof(*Heads));
+  long *Sums = (long *)malloc(LISTS * sizeof(long));
+  long *Expected = (long *)malloc(LISTS * sizeof(long));
+  unsigned Seed = 1;
+  for (int i = 0; i < LISTS; i++) {
+    Heads[i] = NULL;
+    Expected[i] = 0;
+  }
+  // Allocate round robin over the lists so neighbours are far apart
+  for (int n = 0; n < NODES; n++) {
+    for (int i = 0; i < LISTS; i++) {
+      struct Node *N = (struct Node *)malloc(sizeof(*N));
+      N->Value = workload_rand(&Seed) % 1000;
+      N->Next = Heads[i];
+      Heads[i] = N;
+      Expected[i] += N->Value;
+    }
+  }
+
+  for (int It = 0; It < WORKLOAD_ITERS; It++) {
+#pragma omp target teams distribute parallel for map(to: Heads[0:LISTS]) \
+    map(from: Sums[0:LISTS])
+    for (int i = 0; i < LISTS; i++) {
+      long Sum = 0;
+      for (struct Node *P = Heads[i]; P; P = P->Next) {
+        Sum += P->Value;
+      }
+      Sums[i] = Sum;
+    }
+  }
+
+  int Errors = 0;
+  for (int i = 0; i < LISTS; i++) {
+    Errors += Sums[i] != Expected[i];
+    while (Heads[i]) {
+      struct Node *N = Heads[i]->Next;
+      free(Heads[i]);
+      Heads[i] = N;
+    }
+  }
+  free(Heads);
+  free(Sums);
+  free(Expected);
+  return Errors != 0;
+}
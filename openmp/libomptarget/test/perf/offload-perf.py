@@ -0,0 +1,247 @@
+#!/usr/bin/env python
+#
+#===- offload-perf.py - Time the offload workloads against a baseline ------===#
+#
+# Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+# See https://llvm.org/LICENSE.txt for license information.
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#
+#===------------------------------------------------------------------------===#
+#
+# Run every workload in each of its offloading modes on every device, with
+# PERF_JSON set, and compare the kernel, transfer and pointer update times of
+# the runtime with a baseline. Translation costs show up in the kernel time of
+# the AT modes and in the ATTableSize counter. Each run is repeated and the
+# minimum of each metric is kept.
+#
+# The baseline is written when it does not exist yet, or with --update. The
+# script exits with 1 if a workload fails or a metric grew by more than
+# --threshold percent; times below --min-ns in both runs are not compared.
+# A run also fails if its PERF_JSON file is malformed or reports other modes
+# than the ones requested.
+#
+#===------------------------------------------------------------------------===#
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+# Environment of each OpenMPOffloadingMode, see DeviceTy::initOnce
+MODES = {
+    'NORMAL': {},
+    'UVM': {'OMP_UVM': '1'},
+    'MASK': {'OMP_MASK': '1'},
+    'OFFSET': {'OMP_OFFSET': '1'},
+    'TABLE': {'OMP_TABLE': '1'},
+    'BULK': {'OMP_BULK': '1'},
+    'BULK_COMPACT': {'OMP_BULK': '1', 'OMP_DC_COMPACT': '1'},
+}
+
+# PerfRecordTy events compared by their time, in ns
+EVENTS = ['Kernel', 'H2DTransfer', 'D2HTransfer', 'UpdatePtr', 'PatchPtr',
+          'RTTarget']
+# PerfRecordTy counters compared by their sum
+COUNTS = ['ATTableSize']
+
+# Options each mode adds to the "modes" of PERF_JSON, see DeviceTy::init
+MODE_OPTIONS = {
+    'MASK': ['AT_MASK'],
+    'OFFSET': ['AT_OFFSET'],
+    'TABLE': ['AT_TABLE'],
+    'BULK': ['BulkTransfer'],
+    'BULK_COMPACT': ['BulkTransfer', 'DeepCopyCompact'],
+}
+
+# JSON strings and numbers, Python 2 decodes them as unicode and long too
+STRING_TYPES = (str, type(u''))
+INT_TYPES = (int, type(2**64))
+
+
+def check_json(data, mode):
+    """Return why the PERF_JSON output of a run in mode is wrong, or None."""
+    if not isinstance(data, dict) or not isinstance(data.get('modes'), STRING_TYPES):
+        return 'no modes'
+    options = data['modes'].split()
+    if 'OmpProfilingJson' not in options:
+        return 'OmpProfilingJson missing from modes "%s"' % data['modes']
+    expected = MODE_OPTIONS.get(mode, [])
+    for option in set(sum(MODE_OPTIONS.values(), [])):
+        if (option in options) != (option in expected):
+            return 'modes "%s" do not match %s' % (data['modes'], mode)
+    records = data.get('records')
+    if not isinstance(records, list):
+        return 'no records'
+    names = set()
+    for r in records:
+        kind = r.get('kind')
+        value = {'event': 'time_ns', 'count': 'sum'}.get(kind)
+        if (value is None or not isinstance(r.get('name'), STRING_TYPES) or
+                not isinstance(r.get('count'), INT_TYPES) or
+                not isinstance(r.get(value), INT_TYPES) or r['count'] < 0):
+            return 'malformed record %s' % json.dumps(r)
+        if r['name'] in names:
+            return 'duplicate record %s' % r['name']
+        names.add(r['name'])
+    for name in EVENTS + COUNTS:
+        if name not in names:
+            return 'record %s missing' % name
+    kernel = [r for r in records if r['name'] == 'Kernel'][0]
+    if kernel['count'] == 0:
+        return 'no kernel launch recorded'
+    return None
+
+
+def num_devices(binary):
+    env = dict(os.environ, OFFLOAD_PERF_DEVICES='1')
+    out = subprocess.check_output([binary], env=env)
+    return int(out.decode().strip() or 0)
+
+
+def run_once(binary, mode, device):
+    fd, path = tempfile.mkstemp(suffix='.json')
+    os.close(fd)
+    env = dict(os.environ)
+    for var in MODES.values():
+        for key in var:
+            env.pop(key, None)
+    env.update(MODES[mode])
+    env['OMP_DEFAULT_DEVICE'] = str(device)
+    env['PERF_JSON'] = path
+    try:
+        start = time.time()
+        ret = subprocess.call([binary], env=env)
+        wall = (time.time() - start) * 1e9
+        if ret != 0:
+            return None
+        with open(path) as f:
+            try:
+                data = json.load(f)
+            except ValueError as e:
+                data = str(e)
+    finally:
+        os.remove(path)
+    error = check_json(data, mode)
+    if error:
+        print('%s/%s: PERF_JSON: %s' % (os.path.basename(binary), mode, error))
+        return None
+    metrics = {'Wall': wall}
+    for r in data.get('records', []):
+        if r['kind'] == 'event' and r['name'] in EVENTS:
+            metrics[r['name']] = float(r['time_ns'])
+        elif r['kind'] == 'count' and r['name'] in COUNTS:
+            metrics[r['name']] = float(r['sum'])
+    return metrics
+
+
+def measure(workloads, repeat):
+    results = {}
+    failed = []
+    for binary, modes in workloads:
+        name = os.path.basename(binary)
+        for device in range(num_devices(binary)):
+            for mode in modes:
+                key = '%s/%s/%d' % (name, mode, device)
+                best = None
+                for _ in range(repeat):
+                    m = run_once(binary, mode, device)
+                    if m is None:
+                        failed.append(key)
+                        best = None
+                        break
+                    if best is None:
+                        best = m
+                    else:
+                        for metric, value in m.items():
+                            best[metric] = min(best.get(metric, value), value)
+                if best is not None:
+                    results[key] = best
+    return results, failed
+
+
+def compare(baseline, current, threshold, min_ns):
+    rows = []
+    for key in sorted(set(baseline) & set(current)):
+        for metric, new_value in current[key].items():
+            old_value = baseline[key].get(metric)
+            if not old_value or (metric not in COUNTS and
+                                 max(old_value, new_value) < min_ns):
+                continue
+            change = (new_value - old_value) / old_value * 100
+            rows.append((change, key, metric, old_value, new_value))
+    rows.sort(reverse=True)
+    print('%-36s %-12s %14s %14s %8s' % ('workload/mode/device', 'metric',
+                                         'baseline', 'current', 'change'))
+    for change, key, metric, old_value, new_value in rows:
+        mark = ' <--' if threshold is not None and change > threshold else ''
+        print('%-36s %-12s %14.6g %14.6g %+7.2f%%%s' %
+              (key, metric, old_value, new_value, change, mark))
+    for key in sorted(set(baseline) - set(current)):
+        print('only in baseline: %s' % key)
+    for key in sorted(set(current) - set(baseline)):
+        print('only in current: %s' % key)
+    return [row for row in rows if threshold is not None and
+            row[0] > threshold]
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Time the offload workloads against a baseline.')
+    parser.add_argument('workloads', nargs='+', metavar='BINARY:MODES',
+                        help='workload and its comma separated modes, e.g. '
+                        'list-walk:UVM,MASK,OFFSET,TABLE')
+    parser.add_argument('--baseline', required=True,
+                        help='JSON file of the baseline run')
+    parser.add_argument('--output', help='also write this run here')
+    parser.add_argument('--threshold', type=float, default=10,
+                        help='fail if a metric grew by more than this many '
+                        'percent')
+    parser.add_argument('--min-ns', type=float, default=1e5,
+                        help='ignore times smaller than this')
+    parser.add_argument('--repeat', type=int, default=3,
+                        help='runs per workload, mode and device')
+    parser.add_argument('--update', action='store_true',
+                        help='replace the baseline with this run')
+    args = parser.parse_args()
+
+    workloads = []
+    for w in args.workloads:
+        binary, _, modes = w.partition(':')
+        modes = [m for m in modes.split(',') if m] or ['NORMAL']
+        for m in modes:
+            if m not in MODES:
+                parser.error('unknown mode %s' % m)
+        workloads.append((binary, modes))
+
+    current, failed = measure(workloads, args.repeat)
+    if not current and not failed:
+        print('No offload device available, nothing to time')
+        return 0
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(current, f, indent=1, sort_keys=True)
+
+    regressions = []
+    if args.update or not os.path.exists(args.baseline):
+        with open(args.baseline, 'w') as f:
+            json.dump(current, f, indent=1, sort_keys=True)
+        print('Wrote baseline %s' % args.baseline)
+    else:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        regressions = compare(baseline, current, args.threshold, args.min_ns)
+
+    for key in failed:
+        print('failed: %s' % key)
+    if failed or regressions:
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
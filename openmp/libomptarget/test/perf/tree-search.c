@@ -0,0 +1,69 @@
+//===---- tree-search.c - Search a tree through translated pointers -------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Threads descend one unbalanced search tree from the same root, so the
+// upper levels are shared and the lower ones diverge.
+//
+//===----------------------------------------------------------------------===//
+
+#include "workload.h"
+
+#define KEYS (1 << 16)
+#define QUERIES (1 << 18)
+
+struct Tree {
+  unsigned Key;
+  struct Tree *Child[2];
+};
+
+static int run(void) {
+  unsigned Seed = 7;
+  struct Tree *Root = NULL;
+  for (int i = 0; i < KEYS; i++) {
+    unsigned Key = workload_rand(&Seed) % (4 * KEYS);
+    struct Tree **Slot = &Root;
+    while (*Slot && (*Slot)->Key != Key) {
+      Slot = &(*Slot)->Child[Key > (*Slot)->Key];
+    }
+    if (!*Slot) {
+      struct Tree *T = (struct Tree *)malloc(sizeof(*T));
+      T->Key = Key;
+      T->Child[0] = T->Child[1] = NULL;
+      *Slot = T;
+    }
+  }
+  unsigned *Queries = (unsigned *)malloc(QUERIES * sizeof(unsigned));
+  int *Found = (int *)malloc(QUERIES * sizeof(int));
+  for (int i = 0; i < QUERIES; i++) {
+    Queries[i] = workload_rand(&Seed) % (4 * KEYS);
+  }
+
+  for (int It = 0; It < WORKLOAD_ITERS; It++) {
+#pragma omp target teams distribute parallel for map(to: Root[0:1]) \
+    map(to: Queries[0:QUERIES]) map(from: Found[0:QUERIES])
+    for (int i = 0; i < QUERIES; i++) {
+      struct Tree *T = Root;
+      while (T && T->Key != Queries[i]) {
+        T = T->Child[Queries[i] > T->Key];
+      }
+      Found[i] = T != NULL;
+    }
+  }
+
+  int Errors = 0;
+  for (int i = 0; i < QUERIES; i++) {
+    struct Tree *T = Root;
+    while (T && T->Key != Queries[i]) {
+      T = T->Child[Queries[i] > T->Key];
+    }
+    Errors += Found[i] != (T != NULL);
+  }
+  free(Queries);
+  free(Found);
+  return Errors != 0;
+}
@@ -0,0 +1,48 @@
+//===---- workload.h - Common driver of the offload perf workloads --------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+//
+// Each workload defines run(), which offloads to the default device and
+// returns 0 if the results check out. offload-perf.py selects the device
+// with OMP_DEFAULT_DEVICE and the mode with OMP_MASK, OMP_OFFSET, ...
+// With OFFLOAD_PERF_DEVICES set, the number of devices is printed instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef OFFLOAD_PERF_WORKLOAD_H
+#define OFFLOAD_PERF_WORKLOAD_H
+
+#include <omp.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int run(void);
+
+// Repeat the offload so that one-time costs do not dominate
+#ifndef WORKLOAD_ITERS
+#define WORKLOAD_ITERS 10
+#endif
+
+// Small deterministic generator, rand() differs between C libraries
+static unsigned workload_rand(unsigned *State) {
+  *State = *State * 1103515245u + 12345u;
+  return *State >> 8;
+}
+
+int main(void) {
+  if (getenv("OFFLOAD_PERF_DEVICES")) {
+    printf("%d\n", omp_get_num_devices());
+    return 0;
+  }
+  int Ret = run();
+  if (Ret) {
+    fprintf(stderr, "workload failed\n");
+  }
+  return Ret;
+}
+
+#endif // OFFLOAD_PERF_WORKLOAD_H
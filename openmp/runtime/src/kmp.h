@@ -986,6 +986,7 @@ typedef struct kmp_allocator_t {
   kmp_allocator_t *fb_data;
   kmp_uint64 pool_size;
   kmp_uint64 pool_used;
+  omp_alloctrait_value_t partition;
 } kmp_allocator_t;
 
 extern omp_allocator_handle_t __kmpc_init_allocator(int gtid,
@@ -1781,6 +1782,14 @@ typedef struct kmp_disp {
   void *dummy_padding[2]; // make it 64 bytes on Intel(R) 64
 #endif
 #endif
+#if KMP_STATIC_STEAL_ENABLED
+  // adaptive static_steal, see __kmp_steal_adapt
+  kmp_uint64 th_steal_stamp; // time the last chunks were handed out
+  kmp_uint64 th_steal_cost; // average time per chunk
+  kmp_uint64 th_steal_dev; // average deviation from th_steal_cost
+  kmp_uint32 th_steal_batch; // own chunks to take at once
+  kmp_uint32 th_steal_chunks; // chunks handed out last time
+#endif
 #if KMP_USE_INTERNODE_ALIGNMENT
   char more_padding[INTERNODE_CACHE_LINE];
 #endif
@@ -1892,7 +1901,9 @@ typedef struct KMP_ALIGN_CACHE kmp_bstate {
   volatile kmp_uint64 b_go; // STATE => task should proceed (hierarchical)
   KMP_ALIGN_CACHE volatile kmp_uint64
       b_arrived; // STATE => task reached synch point.
-  kmp_uint32 *skip_per_level;
+  // Children update b_arrived while this thread reads the fields below, keep
+  // them off its cache line
+  KMP_ALIGN_CACHE kmp_uint32 *skip_per_level;
   kmp_uint32 my_level;
   kmp_int32 parent_tid;
   kmp_int32 old_tid;
@@ -2410,7 +2421,8 @@ typedef struct kmp_base_thread_data {
   kmp_int32 td_deque_size; // Size of deck
   kmp_uint32 td_deque_head; // Head of deque (will wrap)
   kmp_uint32 td_deque_tail; // Tail of deque (will wrap)
-  kmp_int32 td_deque_ntasks; // Number of tasks in deque
+  kmp_int32 td_deque_ntasks; // Number of tasks in deque (not yet claimed by
+  // a thief or the owner with KMP_USE_LOCKFREE_TASK_DEQUE)
   // GEH: shouldn't this be volatile since used in while-spin?
   kmp_int32 td_deque_last_stolen; // Thread number of last successful steal
 #ifdef BUILD_TIED_TASK_STACK
@@ -2982,6 +2994,9 @@ extern enum sched_type __kmp_sched; /* default runtime scheduling */
 extern enum sched_type __kmp_static; /* default static scheduling method */
 extern enum sched_type __kmp_guided; /* default guided scheduling method */
 extern enum sched_type __kmp_auto; /* default auto scheduling method */
+#if KMP_STATIC_STEAL_ENABLED
+extern int __kmp_static_steal_adaptive; /* adapt static_steal batch sizes */
+#endif
 extern int __kmp_chunk; /* default runtime chunk size */
 
 extern size_t __kmp_stksize; /* stack size per thread         */
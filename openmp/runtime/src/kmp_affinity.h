@@ -733,6 +733,23 @@ public:
     if (branch < minBranch)
       branch = minBranch;
     for (kmp_uint32 d = 0; d < depth - 1; ++d) { // optimize hierarchy width
+      // Split a level that is too wide into two levels when it factors evenly,
+      // so packages, NUMA nodes and tiles each stay the root of a subtree and
+      // a barrier crosses their boundaries only once. Levels that don't factor
+      // get rebalanced below, which may straddle those boundaries.
+      kmp_uint32 limit = (d == 0 && branch > maxLeaves) ? maxLeaves : branch;
+      while (numPerLevel[d] > limit && depth < maxLevels) {
+        kmp_uint32 fanin = limit;
+        while (fanin > 1 && numPerLevel[d] % fanin)
+          --fanin;
+        if (fanin < 2)
+          break;
+        for (kmp_uint32 i = depth; i > d + 1; --i)
+          numPerLevel[i] = numPerLevel[i - 1];
+        numPerLevel[d + 1] = numPerLevel[d] / fanin;
+        numPerLevel[d] = fanin;
+        depth++;
+      }
       while (numPerLevel[d] > branch ||
              (d == 0 && numPerLevel[d] > maxLeaves)) { // max 4 on level 0!
         if (numPerLevel[d] & 1)
@@ -1241,7 +1241,61 @@ static void **mk_hugetlb;
 static void **mk_hbw_hugetlb;
 static void **mk_hbw_preferred_hugetlb;
 
+/* libnuma API, places omp_atv_nearest and omp_atv_interleaved partitions */
+static void *h_libnuma;
+static int kmp_numa_nodes; // number of NUMA nodes, 0 if libnuma is not used
+// numa_alloc_local
+static void *(*kmp_numa_alloc_local)(size_t sz);
+// numa_alloc_interleaved
+static void *(*kmp_numa_alloc_interleaved)(size_t sz);
+// numa_free
+static void (*kmp_numa_free)(void *ptr, size_t sz);
+// Smaller blocks come from the thread's own pool: it is first touched by the
+// thread that owns it, so it normally lives on that thread's node already,
+// and libnuma would round every block up to whole pages
+static const size_t kmp_numa_min_size = 64 * 1024;
+
 #if KMP_OS_UNIX && KMP_DYNAMIC_LIB
+static void kmp_init_libnuma() {
+  h_libnuma = dlopen("libnuma.so.1", RTLD_LAZY);
+  if (h_libnuma) {
+    int (*numa_available)(void) =
+        (int (*)(void))dlsym(h_libnuma, "numa_available");
+    int (*numa_max_node)(void) =
+        (int (*)(void))dlsym(h_libnuma, "numa_max_node");
+    kmp_numa_alloc_local =
+        (void *(*)(size_t))dlsym(h_libnuma, "numa_alloc_local");
+    kmp_numa_alloc_interleaved =
+        (void *(*)(size_t))dlsym(h_libnuma, "numa_alloc_interleaved");
+    kmp_numa_free = (void (*)(void *, size_t))dlsym(h_libnuma, "numa_free");
+    if (numa_available && numa_max_node && kmp_numa_alloc_local &&
+        kmp_numa_alloc_interleaved && kmp_numa_free && numa_available() >= 0 &&
+        numa_max_node() > 0) {
+      kmp_numa_nodes = numa_max_node() + 1;
+      KE_TRACE(25, ("__kmp_init_memkind: libnuma initialized, %d nodes\n",
+                    kmp_numa_nodes));
+      return; // success, a single node needs no placement
+    }
+    dlclose(h_libnuma); // failure
+    h_libnuma = NULL;
+  }
+  kmp_numa_nodes = 0;
+  kmp_numa_alloc_local = NULL;
+  kmp_numa_alloc_interleaved = NULL;
+  kmp_numa_free = NULL;
+}
+
+static void kmp_fini_libnuma() {
+  if (h_libnuma) {
+    dlclose(h_libnuma);
+    h_libnuma = NULL;
+  }
+  kmp_numa_nodes = 0;
+  kmp_numa_alloc_local = NULL;
+  kmp_numa_alloc_interleaved = NULL;
+  kmp_numa_free = NULL;
+}
+
 static inline void chk_kind(void ***pkind) {
   KMP_DEBUG_ASSERT(pkind);
   if (*pkind) // symbol found
@@ -1253,6 +1307,7 @@ static inline void chk_kind(void ***pkind) {
 void __kmp_init_memkind() {
 // as of 2018-07-31 memkind does not support Windows*, exclude it for now
 #if KMP_OS_UNIX && KMP_DYNAMIC_LIB
+  kmp_init_libnuma();
   // use of statically linked memkind is problematic, as it depends on libnuma
   kmp_mk_lib_name = "libmemkind.so";
   h_memkind = dlopen(kmp_mk_lib_name, RTLD_LAZY);
@@ -1298,6 +1353,11 @@ void __kmp_init_memkind() {
   mk_hbw_hugetlb = NULL;
   mk_hbw_preferred_hugetlb = NULL;
 #else
+  h_libnuma = NULL;
+  kmp_numa_nodes = 0;
+  kmp_numa_alloc_local = NULL;
+  kmp_numa_alloc_interleaved = NULL;
+  kmp_numa_free = NULL;
   kmp_mk_lib_name = "";
   h_memkind = NULL;
   kmp_mk_check = NULL;
@@ -1316,6 +1376,7 @@ void __kmp_init_memkind() {
 
 void __kmp_fini_memkind() {
 #if KMP_OS_UNIX && KMP_DYNAMIC_LIB
+  kmp_fini_libnuma();
   if (__kmp_memkind_available)
     KE_TRACE(25, ("__kmp_fini_memkind: finalize memkind library\n"));
   if (h_memkind) {
@@ -1370,7 +1431,12 @@ omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
       al->fb_data = RCAST(kmp_allocator_t *, traits[i].value);
       break;
     case OMP_ATK_PARTITION:
-      al->memkind = RCAST(void **, traits[i].value);
+      al->partition = (omp_alloctrait_value_t)traits[i].value;
+      KMP_DEBUG_ASSERT(
+          al->partition == OMP_ATV_ENVIRONMENT ||
+          al->partition == OMP_ATV_NEAREST ||
+          al->partition == OMP_ATV_BLOCKED ||
+          al->partition == OMP_ATV_INTERLEAVED);
       break;
     default:
       KMP_ASSERT2(0, "Unexpected allocator trait");
@@ -1388,7 +1454,7 @@ omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
   if (__kmp_memkind_available) {
     // Let's use memkind library if available
     if (ms == omp_high_bw_mem_space) {
-      if (al->memkind == (void *)OMP_ATV_INTERLEAVED && mk_hbw_interleave) {
+      if (al->partition == OMP_ATV_INTERLEAVED && mk_hbw_interleave) {
         al->memkind = mk_hbw_interleave;
       } else if (mk_hbw_preferred) {
         // AC: do not try to use MEMKIND_HBW for now, because memkind library
@@ -1403,7 +1469,7 @@ omp_allocator_handle_t __kmpc_init_allocator(int gtid, omp_memspace_handle_t ms,
         return omp_null_allocator;
       }
     } else {
-      if (al->memkind == (void *)OMP_ATV_INTERLEAVED && mk_interleave) {
+      if (al->partition == OMP_ATV_INTERLEAVED && mk_interleave) {
         al->memkind = mk_interleave;
       } else {
         al->memkind = mk_default;
@@ -1442,6 +1508,42 @@ typedef struct kmp_mem_desc { // Memory block descriptor
 } kmp_mem_desc_t;
 static int alignment = sizeof(void *); // let's align to pointer size
 
+// Blocks of custom allocators that libnuma places; must give the same answer
+// in __kmpc_alloc and __kmpc_free
+static inline bool kmp_numa_partitioned(kmp_allocator_t *al, size_t size) {
+  if (kmp_numa_nodes == 0 || size < kmp_numa_min_size ||
+      al->memspace == omp_high_bw_mem_space)
+    return false;
+  if (al->partition == OMP_ATV_NEAREST)
+    return true;
+  // memkind interleaves itself when it can
+  return al->partition == OMP_ATV_INTERLEAVED &&
+         !(__kmp_memkind_available && mk_interleave);
+}
+
+// Allocate a block of a custom allocator
+static void *kmp_al_alloc(int gtid, kmp_allocator_t *al, size_t size) {
+  if (kmp_numa_partitioned(al, size)) {
+    if (al->partition == OMP_ATV_INTERLEAVED)
+      return kmp_numa_alloc_interleaved(size);
+    return kmp_numa_alloc_local(size);
+  }
+  if (__kmp_memkind_available)
+    return kmp_mk_alloc(*al->memkind, size);
+  return __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), size);
+}
+
+// Free a block allocated by kmp_al_alloc
+static void kmp_al_free(int gtid, kmp_allocator_t *al, void *ptr,
+                        size_t size) {
+  if (kmp_numa_partitioned(al, size))
+    kmp_numa_free(ptr, size);
+  else if (__kmp_memkind_available)
+    kmp_mk_free(*al->memkind, ptr);
+  else
+    __kmp_thread_free(__kmp_thread_from_gtid(gtid), ptr);
+}
+
 void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
   void *ptr = NULL;
   kmp_allocator_t *al;
@@ -1490,7 +1592,7 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
         } // else ptr == NULL;
       } else {
         // pool has enough space
-        ptr = kmp_mk_alloc(*al->memkind, desc.size_a);
+        ptr = kmp_al_alloc(gtid, al, desc.size_a);
         if (ptr == NULL) {
           if (al->fb == OMP_ATV_DEFAULT_MEM_FB) {
             al = (kmp_allocator_t *)omp_default_mem_alloc;
@@ -1506,7 +1608,7 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
       }
     } else {
       // custom allocator, pool size not requested
-      ptr = kmp_mk_alloc(*al->memkind, desc.size_a);
+      ptr = kmp_al_alloc(gtid, al, desc.size_a);
       if (ptr == NULL) {
         if (al->fb == OMP_ATV_DEFAULT_MEM_FB) {
           al = (kmp_allocator_t *)omp_default_mem_alloc;
@@ -1546,14 +1648,14 @@ void *__kmpc_alloc(int gtid, size_t size, omp_allocator_handle_t allocator) {
       } // else ptr == NULL;
     } else {
       // pool has enough space
-      ptr = __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), desc.size_a);
+      ptr = kmp_al_alloc(gtid, al, desc.size_a);
       if (ptr == NULL && al->fb == OMP_ATV_ABORT_FB) {
         KMP_ASSERT(0); // abort fallback requested
       } // no sense to look for another fallback because of same internal alloc
     }
   } else {
     // custom allocator, pool size not requested
-    ptr = __kmp_thread_malloc(__kmp_thread_from_gtid(gtid), desc.size_a);
+    ptr = kmp_al_alloc(gtid, al, desc.size_a);
     if (ptr == NULL && al->fb == OMP_ATV_ABORT_FB) {
       KMP_ASSERT(0); // abort fallback requested
     } // no sense to look for another fallback because of same internal alloc
@@ -1615,16 +1717,18 @@ void __kmpc_free(int gtid, void *ptr, const omp_allocator_handle_t allocator) {
         (void)used; // to suppress compiler warning
         KMP_DEBUG_ASSERT(used >= desc.size_a);
       }
-      kmp_mk_free(*al->memkind, desc.ptr_alloc);
+      kmp_al_free(gtid, al, desc.ptr_alloc, desc.size_a);
     }
+  } else if (oal < kmp_max_mem_alloc) {
+    __kmp_thread_free(__kmp_thread_from_gtid(gtid), desc.ptr_alloc);
   } else {
-    if (oal > kmp_max_mem_alloc && al->pool_size > 0) {
+    if (al->pool_size > 0) {
       kmp_uint64 used =
           KMP_TEST_THEN_ADD64((kmp_int64 *)&al->pool_used, -desc.size_a);
       (void)used; // to suppress compiler warning
       KMP_DEBUG_ASSERT(used >= desc.size_a);
     }
-    __kmp_thread_free(__kmp_thread_from_gtid(gtid), desc.ptr_alloc);
+    kmp_al_free(gtid, al, desc.ptr_alloc, desc.size_a);
   }
   KE_TRACE(10, ("__kmpc_free: T#%d freed %p (%p)\n", gtid, desc.ptr_alloc,
                 allocator));
@@ -14,6 +14,7 @@
 #include "kmp_wait_release.h"
 #include "kmp_itt.h"
 #include "kmp_os.h"
+#include "kmp_sample.h"
 #include "kmp_stats.h"
 #if OMPT_SUPPORT
 #include "ompt-specific.h"
@@ -1600,8 +1601,11 @@ static int __kmp_barrier_template(enum barrier_type bt, int gtid, int is_split,
 int __kmp_barrier(enum barrier_type bt, int gtid, int is_split,
                   size_t reduce_size, void *reduce_data,
                   void (*reduce)(void *, void *)) {
-  return __kmp_barrier_template<>(bt, gtid, is_split, reduce_size, reduce_data,
-                                  reduce);
+  KMP_SAMPLE_BEGIN(sample_start);
+  int status = __kmp_barrier_template<>(bt, gtid, is_split, reduce_size,
+                                        reduce_data, reduce);
+  KMP_SAMPLE_END(gtid, ks_barrier, sample_start);
+  return status;
 }
 
 #if defined(KMP_GOMP_COMPAT)
@@ -1672,6 +1676,7 @@ void __kmp_end_split_barrier(enum barrier_type bt, int gtid) {
 void __kmp_join_barrier(int gtid) {
   KMP_TIME_PARTITIONED_BLOCK(OMP_join_barrier);
   KMP_SET_THREAD_STATE_BLOCK(FORK_JOIN_BARRIER);
+  KMP_SAMPLE_BEGIN(sample_start);
   kmp_info_t *this_thr = __kmp_threads[gtid];
   kmp_team_t *team;
   kmp_uint nproc;
@@ -1907,6 +1912,7 @@ void __kmp_join_barrier(int gtid) {
            ("__kmp_join_barrier: T#%d(%d:%d) leaving\n", gtid, team_id, tid));
 
   ANNOTATE_BARRIER_END(&team->t.t_bar);
+  KMP_SAMPLE_END(gtid, ks_barrier, sample_start);
 }
 
 // TODO release worker threads' fork barriers as we are ready instead of all at
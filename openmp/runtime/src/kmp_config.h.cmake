@@ -51,6 +51,8 @@
 #define KMP_DEBUG_ADAPTIVE_LOCKS 0
 #cmakedefine01 LIBOMP_USE_INTERNODE_ALIGNMENT
 #define KMP_USE_INTERNODE_ALIGNMENT LIBOMP_USE_INTERNODE_ALIGNMENT
+#cmakedefine01 LIBOMP_USE_LOCKFREE_TASK_DEQUE
+#define KMP_USE_LOCKFREE_TASK_DEQUE LIBOMP_USE_LOCKFREE_TASK_DEQUE
 #cmakedefine01 LIBOMP_ENABLE_ASSERTIONS
 #define KMP_USE_ASSERT LIBOMP_ENABLE_ASSERTIONS
 #cmakedefine01 LIBOMP_USE_HIER_SCHED
@@ -21,6 +21,7 @@
 #include "kmp_error.h"
 #include "kmp_i18n.h"
 #include "kmp_itt.h"
+#include "kmp_sample.h"
 #include "kmp_stats.h"
 #include "kmp_str.h"
 #if KMP_USE_X87CONTROL
@@ -68,6 +69,62 @@ void __kmp_dispatch_dxo_error(int *gtid_ref, int *cid_ref, ident_t *loc_ref) {
   }
 }
 
+#if KMP_STATIC_STEAL_ENABLED
+// Time stamp counter
+#if KMP_ARCH_X86 || KMP_ARCH_X86_64
+#define __kmp_steal_tsc() __kmp_hardware_timestamp()
+#else
+extern kmp_uint64 __kmp_now_nsec();
+#define __kmp_steal_tsc() __kmp_now_nsec()
+#endif
+
+// Most own chunks an adaptive static_steal thread takes at once
+#define KMP_STEAL_MAX_BATCH 64
+
+// KMP_STATIC_STEAL_ADAPTIVE: instead of one chunk, a static_steal thread takes
+// a batch of its own chunks at a time. The time between two calls measures the
+// cost of the chunks handed out by the first one; the batch doubles while that
+// cost is steady and halves when it varies, in the spirit of adaptive
+// factoring, so irregular loops keep small chunks.
+static void __kmp_steal_adapt(kmp_disp_t *disp) {
+  kmp_uint64 now = __kmp_steal_tsc();
+  if (disp->th_steal_chunks) {
+    kmp_uint64 cost = (now - disp->th_steal_stamp) / disp->th_steal_chunks;
+    if (disp->th_steal_cost == 0) { // first sample of this loop
+      disp->th_steal_cost = cost;
+    } else {
+      kmp_uint64 dev = cost > disp->th_steal_cost ? cost - disp->th_steal_cost
+                                                    : disp->th_steal_cost - cost;
+      disp->th_steal_cost = (3 * disp->th_steal_cost + cost) / 4;
+      disp->th_steal_dev = (3 * disp->th_steal_dev + dev) / 4;
+      if (4 * disp->th_steal_dev <= disp->th_steal_cost) {
+        if (disp->th_steal_batch < KMP_STEAL_MAX_BATCH)
+          disp->th_steal_batch *= 2;
+      } else if (2 * disp->th_steal_dev > disp->th_steal_cost &&
+                 disp->th_steal_batch > 1) {
+        disp->th_steal_batch /= 2;
+      }
+    }
+  }
+  disp->th_steal_stamp = now;
+}
+
+// Number of own chunks to take out of count..ub-1, at most half of them
+// so that thieves still find work at the end of the range
+template <typename T>
+static inline T __kmp_steal_batch(kmp_disp_t *disp,
+                                  typename traits_t<T>::unsigned_t count,
+                                  T ub) {
+  typedef typename traits_t<T>::unsigned_t UT;
+  if (!__kmp_static_steal_adaptive || count >= (UT)ub)
+    return 1;
+  UT half = ((UT)ub - count) / 2;
+  if (half < disp->th_steal_batch)
+    return half ? (T)half : 1;
+  return (T)disp->th_steal_batch;
+}
+#endif // KMP_STATIC_STEAL_ENABLED
+
 // Returns either SCHEDULE_MONOTONIC or SCHEDULE_NONMONOTONIC
 static inline int __kmp_get_monotonicity(enum sched_type schedule,
                                          bool use_hier = false) {
@@ -371,6 +428,10 @@ void __kmp_dispatch_init_algorithm(ident_t *loc, int gtid,
       pr->u.p.parm3 = KMP_MIN(small_chunk + extras, nproc);
       pr->u.p.parm4 = (id + 1) % nproc; // remember neighbour tid
       pr->u.p.st = st;
+      th->th.th_dispatch->th_steal_cost = 0;
+      th->th.th_dispatch->th_steal_dev = 0;
+      th->th.th_dispatch->th_steal_batch = 1;
+      th->th.th_dispatch->th_steal_chunks = 0;
       if (traits_t<T>::type_size > 4) {
         // AC: TODO: check if 16-byte CAS available and use it to
         // improve performance (probably wait for explicit request
@@ -1198,12 +1259,16 @@ int __kmp_dispatch_next_algorithm(int gtid,
 #if (KMP_STATIC_STEAL_ENABLED)
   case kmp_sch_static_steal: {
     T chunk = pr->u.p.parm1;
+    T nchunks = 1; // chunks handed out starting at init
+    kmp_disp_t *disp = th->th.th_dispatch;
 
     KD_TRACE(100,
              ("__kmp_dispatch_next_algorithm: T#%d kmp_sch_static_steal case\n",
               gtid));
 
     trip = pr->u.p.tc - 1;
+    if (__kmp_static_steal_adaptive)
+      __kmp_steal_adapt(disp);
 
     if (traits_t<T>::type_size > 4) {
       // use lock for 8-byte and CAS for 4-byte induction
@@ -1213,7 +1278,9 @@ int __kmp_dispatch_next_algorithm(int gtid,
       if (pr->u.p.count < (UT)pr->u.p.ub) {
         __kmp_acquire_lock(lck, gtid);
         // try to get own chunk of iterations
-        init = (pr->u.p.count)++;
+        init = pr->u.p.count;
+        nchunks = __kmp_steal_batch<T>(disp, init, pr->u.p.ub);
+        pr->u.p.count += nchunks;
         status = (init < (UT)pr->u.p.ub);
         __kmp_release_lock(lck, gtid);
       } else {
@@ -1302,7 +1369,8 @@ int __kmp_dispatch_next_algorithm(int gtid,
         union_i4 vold, vnew;
         vold.b = *(volatile kmp_int64 *)(&pr->u.p.count);
         vnew = vold;
-        vnew.p.count++;
+        nchunks = __kmp_steal_batch<T>(disp, vnew.p.count, vnew.p.ub);
+        vnew.p.count += nchunks;
         while (!KMP_COMPARE_AND_STORE_ACQ64(
             (volatile kmp_int64 *)&pr->u.p.count,
             *VOLATILE_CAST(kmp_int64 *) & vold.b,
@@ -1310,7 +1378,8 @@ int __kmp_dispatch_next_algorithm(int gtid,
           KMP_CPU_PAUSE();
           vold.b = *(volatile kmp_int64 *)(&pr->u.p.count);
           vnew = vold;
-          vnew.p.count++;
+          nchunks = __kmp_steal_batch<T>(disp, vnew.p.count, vnew.p.ub);
+          vnew.p.count += nchunks;
         }
         vnew = vold;
         init = vnew.p.count;
@@ -1390,6 +1459,7 @@ int __kmp_dispatch_next_algorithm(int gtid,
         } // while (search for victim)
       } // if (try to find victim and steal)
     } // if (4-byte induction variable)
+    disp->th_steal_chunks = status ? nchunks : 0;
     if (!status) {
       *p_lb = 0;
       *p_ub = 0;
@@ -1398,9 +1468,9 @@ int __kmp_dispatch_next_algorithm(int gtid,
     } else {
       start = pr->u.p.parm2;
       init *= chunk;
-      limit = chunk + init - 1;
+      limit = nchunks * chunk + init - 1;
       incr = pr->u.p.st;
-      KMP_COUNT_DEVELOPER_VALUE(FOR_static_steal_chunks, 1);
+      KMP_COUNT_DEVELOPER_VALUE(FOR_static_steal_chunks, nchunks);
 
       KMP_DEBUG_ASSERT(init <= trip);
       if ((last = (limit >= trip)) != 0)
@@ -1911,6 +1981,7 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
   // disadavantage of schedule(runtime): even when static scheduling is used it
   // costs more than a compile time choice to use static scheduling would.)
   KMP_TIME_PARTITIONED_BLOCK(OMP_loop_dynamic_scheduling);
+  KMP_SAMPLE_BEGIN(sample_start);
 
   int status;
   dispatch_private_info_template<T> *pr;
@@ -2035,6 +2106,7 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
 #endif
     OMPT_LOOP_END;
     KMP_STATS_LOOP_END;
+    KMP_SAMPLE_END(gtid, ks_dispatch, sample_start);
     return status;
   } else {
     kmp_int32 last = 0;
@@ -2153,6 +2225,7 @@ static int __kmp_dispatch_next(ident_t *loc, int gtid, kmp_int32 *p_last,
 #endif
   OMPT_LOOP_END;
   KMP_STATS_LOOP_END;
+  KMP_SAMPLE_END(gtid, ks_dispatch, sample_start);
   return status;
 }
 
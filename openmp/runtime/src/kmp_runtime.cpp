@@ -18,6 +18,7 @@
 #include "kmp_i18n.h"
 #include "kmp_io.h"
 #include "kmp_itt.h"
+#include "kmp_sample.h"
 #include "kmp_settings.h"
 #include "kmp_stats.h"
 #include "kmp_str.h"
@@ -6781,6 +6782,7 @@ static void __kmp_do_serial_initialize(void) {
   __kmp_global.g.g_dynamic_mode = dynamic_default;
 
   __kmp_env_initialize(NULL);
+  __kmp_sample_init();
 
 // Print all messages in message catalog for testing purposes.
 #ifdef KMP_DEBUG
@@ -7661,6 +7663,9 @@ void __kmp_cleanup(void) {
   __kmp_stats_fini();
 #endif
 
+  __kmp_sample_fini();
+  __kmp_str_free(&__kmp_sample_file);
+
   KA_TRACE(10, ("__kmp_cleanup: exit\n"));
 }
 
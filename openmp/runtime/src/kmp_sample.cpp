@@ -0,0 +1,138 @@
+/** @file kmp_sample.cpp
+ * Sampled recording of runtime overheads for production runs.
+ */
+
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include "kmp.h"
+#include "kmp_sample.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+// Time stamp counter
+#if KMP_ARCH_X86 || KMP_ARCH_X86_64
+#define __kmp_sample_tsc() __kmp_hardware_timestamp()
+#else
+#define __kmp_sample_tsc() __kmp_now_nsec()
+#endif
+extern kmp_uint64 __kmp_now_nsec();
+
+// Records kept per thread before they are written out
+#define KMP_SAMPLE_BUF_SIZE 4096
+
+typedef struct kmp_sample_buf {
+  kmp_sample_t records[KMP_SAMPLE_BUF_SIZE];
+  int used;
+  struct kmp_sample_buf *next; // all buffers, to flush them at shutdown
+} kmp_sample_buf_t;
+
+char *__kmp_sample_file = NULL;
+int __kmp_sample_period = 100;
+int __kmp_sample_enabled = FALSE;
+
+static FILE *sample_out = NULL;
+static kmp_sample_buf_t *sample_bufs = NULL;
+static kmp_bootstrap_lock_t sample_lock =
+    KMP_BOOTSTRAP_LOCK_INITIALIZER(sample_lock);
+// Both clocks at __kmp_sample_init, to derive the timestamp frequency
+static kmp_uint64 sample_tsc0, sample_nsec0;
+
+static KMP_THREAD_LOCAL kmp_sample_buf_t *sample_thread_buf = NULL;
+static KMP_THREAD_LOCAL int sample_countdown = 0;
+
+// Write the header, ticks_per_sec is only known at the end of the run
+static void __kmp_sample_write_header(kmp_uint64 ticks_per_sec) {
+  kmp_sample_header_t header;
+  memcpy(header.magic, KMP_SAMPLE_MAGIC, sizeof(header.magic));
+  header.record_size = sizeof(kmp_sample_t);
+  header.period = __kmp_sample_period;
+  header.ticks_per_sec = ticks_per_sec;
+  fseek(sample_out, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, sample_out);
+  fseek(sample_out, 0, SEEK_END);
+}
+
+// Append the records of a buffer to the file, sample_lock must be held
+static void __kmp_sample_flush(kmp_sample_buf_t *buf) {
+  if (buf->used && sample_out)
+    fwrite(buf->records, sizeof(kmp_sample_t), buf->used, sample_out);
+  buf->used = 0;
+}
+
+void __kmp_sample_init(void) {
+  if (__kmp_sample_file == NULL || __kmp_sample_enabled)
+    return;
+  sample_out = fopen(__kmp_sample_file, "wb");
+  if (sample_out == NULL) {
+    // Sampling stays disabled
+    int code = errno;
+    __kmp_msg(kmp_ms_warning,
+              KMP_MSG(StgInvalidValue, "KMP_SAMPLE_FILE", __kmp_sample_file),
+              KMP_ERR(code), __kmp_msg_null);
+    return;
+  }
+  sample_tsc0 = __kmp_sample_tsc();
+  sample_nsec0 = __kmp_now_nsec();
+  __kmp_sample_write_header(0);
+  __kmp_sample_enabled = TRUE;
+}
+
+void __kmp_sample_fini(void) {
+  if (!__kmp_sample_enabled)
+    return;
+  __kmp_sample_enabled = FALSE;
+  __kmp_acquire_bootstrap_lock(&sample_lock);
+  kmp_uint64 nsec = __kmp_now_nsec() - sample_nsec0;
+  kmp_uint64 tsc = __kmp_sample_tsc() - sample_tsc0;
+  // Buffers are kept: a thread may still be ending an event it began before
+  // sampling was disabled, and it keeps its buffer if sampling starts again
+  for (kmp_sample_buf_t *buf = sample_bufs; buf; buf = buf->next)
+    __kmp_sample_flush(buf);
+  __kmp_sample_write_header(
+      nsec ? (kmp_uint64)((double)tsc * KMP_NSEC_PER_SEC / nsec) : 0);
+  fclose(sample_out);
+  sample_out = NULL;
+  __kmp_release_bootstrap_lock(&sample_lock);
+}
+
+// Returns the start timestamp if this event of the thread is sampled, else 0
+kmp_uint64 __kmp_sample_begin(void) {
+  if (--sample_countdown > 0)
+    return 0;
+  sample_countdown = __kmp_sample_period;
+  return __kmp_sample_tsc();
+}
+
+void __kmp_sample_end(int gtid, enum kmp_sample_kind kind, kmp_uint64 start) {
+  kmp_uint64 ticks = __kmp_sample_tsc() - start;
+  kmp_sample_buf_t *buf = sample_thread_buf;
+  if (buf == NULL) {
+    buf = (kmp_sample_buf_t *)KMP_INTERNAL_MALLOC(sizeof(kmp_sample_buf_t));
+    if (buf == NULL)
+      return;
+    buf->used = 0;
+    __kmp_acquire_bootstrap_lock(&sample_lock);
+    buf->next = sample_bufs;
+    sample_bufs = buf;
+    __kmp_release_bootstrap_lock(&sample_lock);
+    sample_thread_buf = buf;
+  }
+  kmp_sample_t *rec = &buf->records[buf->used];
+  rec->start = start;
+  rec->ticks = ticks;
+  rec->gtid = gtid;
+  rec->kind = kind;
+  if (++buf->used == KMP_SAMPLE_BUF_SIZE) {
+    __kmp_acquire_bootstrap_lock(&sample_lock);
+    __kmp_sample_flush(buf);
+    __kmp_release_bootstrap_lock(&sample_lock);
+  }
+}
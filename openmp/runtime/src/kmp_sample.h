@@ -0,0 +1,67 @@
+#ifndef KMP_SAMPLE_H
+#define KMP_SAMPLE_H
+
+/** @file kmp_sample.h
+ * Sampled recording of runtime overheads for production runs.
+ */
+
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+/* Unlike kmp_stats this is always built and costs one test of a global when it
+   is off. KMP_SAMPLE_FILE=<path> turns it on, then every KMP_SAMPLE_PERIOD-th
+   event of a thread is timed and stored in a per-thread buffer, which is
+   appended to the file whenever it fills up and at shutdown. The file starts
+   with a kmp_sample_header_t followed by kmp_sample_t records in host byte
+   order; tools/kmp_sample_dump.py converts it to CSV. */
+
+#include "kmp_os.h"
+
+enum kmp_sample_kind {
+  ks_barrier = 0, // wait in a barrier, including the join barrier
+  ks_task, // execution of an explicit task
+  ks_dispatch, // time spent in __kmpc_dispatch_next
+  ks_last
+};
+
+#define KMP_SAMPLE_MAGIC "KMPSMP01"
+
+typedef struct kmp_sample_header {
+  char magic[8]; // KMP_SAMPLE_MAGIC without terminating 0
+  kmp_uint32 record_size; // sizeof(kmp_sample_t)
+  kmp_uint32 period; // one event in period is recorded
+  kmp_uint64 ticks_per_sec; // timestamp frequency
+} kmp_sample_header_t;
+
+typedef struct kmp_sample {
+  kmp_uint64 start; // timestamp when the event started
+  kmp_uint64 ticks; // duration
+  kmp_int32 gtid;
+  kmp_int32 kind; // kmp_sample_kind
+} kmp_sample_t;
+
+extern char *__kmp_sample_file; // KMP_SAMPLE_FILE
+extern int __kmp_sample_period; // KMP_SAMPLE_PERIOD
+extern int __kmp_sample_enabled;
+
+extern void __kmp_sample_init(void);
+extern void __kmp_sample_fini(void);
+extern kmp_uint64 __kmp_sample_begin(void);
+extern void __kmp_sample_end(int gtid, enum kmp_sample_kind kind,
+                             kmp_uint64 start);
+
+// Start timing an event, stores 0 in var when the event is not sampled
+#define KMP_SAMPLE_BEGIN(var)                                                  \
+  kmp_uint64 var = __kmp_sample_enabled ? __kmp_sample_begin() : 0
+#define KMP_SAMPLE_END(gtid, kind, var)                                        \
+  do {                                                                         \
+    if (var)                                                                   \
+      __kmp_sample_end(gtid, kind, var);                                       \
+  } while (0)
+
+#endif // KMP_SAMPLE_H
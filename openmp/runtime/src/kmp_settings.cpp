@@ -21,6 +21,7 @@
 #include "kmp_io.h"
 #include "kmp_itt.h"
 #include "kmp_lock.h"
+#include "kmp_sample.h"
 #include "kmp_settings.h"
 #include "kmp_str.h"
 #include "kmp_wrapper_getpid.h"
@@ -1340,6 +1341,54 @@ static void __kmp_stg_print_disp_buffers(kmp_str_buf_t *buffer,
   __kmp_stg_print_int(buffer, name, __kmp_dispatch_num_buffers);
 } // __kmp_stg_print_disp_buffers
 
+#if KMP_STATIC_STEAL_ENABLED
+// -----------------------------------------------------------------------------
+// KMP_STATIC_STEAL_ADAPTIVE
+static void __kmp_stg_parse_static_steal_adaptive(char const *name,
+                                                  char const *value,
+                                                  void *data) {
+  __kmp_stg_parse_bool(name, value, &__kmp_static_steal_adaptive);
+} // __kmp_stg_parse_static_steal_adaptive
+
+static void __kmp_stg_print_static_steal_adaptive(kmp_str_buf_t *buffer,
+                                                  char const *name,
+                                                  void *data) {
+  __kmp_stg_print_bool(buffer, name, __kmp_static_steal_adaptive);
+} // __kmp_stg_print_static_steal_adaptive
+#endif // KMP_STATIC_STEAL_ENABLED
+
+// -----------------------------------------------------------------------------
+// KMP_SAMPLE_FILE, KMP_SAMPLE_PERIOD
+
+static void __kmp_stg_parse_sample_file(char const *name, char const *value,
+                                        void *data) {
+  __kmp_stg_parse_str(name, value, &__kmp_sample_file);
+} // __kmp_stg_parse_sample_file
+
+static void __kmp_stg_print_sample_file(kmp_str_buf_t *buffer,
+                                        char const *name, void *data) {
+  if (__kmp_env_format) {
+    KMP_STR_BUF_PRINT_NAME;
+  } else {
+    __kmp_str_buf_print(buffer, "   %s", name);
+  }
+  if (__kmp_sample_file) {
+    __kmp_str_buf_print(buffer, "='%s'\n", __kmp_sample_file);
+  } else {
+    __kmp_str_buf_print(buffer, ": %s\n", KMP_I18N_STR(NotDefined));
+  }
+} // __kmp_stg_print_sample_file
+
+static void __kmp_stg_parse_sample_period(char const *name, char const *value,
+                                          void *data) {
+  __kmp_stg_parse_int(name, value, 1, INT_MAX, &__kmp_sample_period);
+} // __kmp_stg_parse_sample_period
+
+static void __kmp_stg_print_sample_period(kmp_str_buf_t *buffer,
+                                          char const *name, void *data) {
+  __kmp_stg_print_int(buffer, name, __kmp_sample_period);
+} // __kmp_stg_print_sample_period
+
 #if KMP_NESTED_HOT_TEAMS
 // -----------------------------------------------------------------------------
 // KMP_HOT_TEAMS_MAX_LEVEL, KMP_HOT_TEAMS_MODE
@@ -4952,6 +5001,14 @@ static kmp_setting_t __kmp_stg_table[] = {
      0, 0},
     {"OMP_SCHEDULE", __kmp_stg_parse_omp_schedule, __kmp_stg_print_omp_schedule,
      NULL, 0, 0},
+#if KMP_STATIC_STEAL_ENABLED
+    {"KMP_STATIC_STEAL_ADAPTIVE", __kmp_stg_parse_static_steal_adaptive,
+     __kmp_stg_print_static_steal_adaptive, NULL, 0, 0},
+#endif
+    {"KMP_SAMPLE_FILE", __kmp_stg_parse_sample_file,
+     __kmp_stg_print_sample_file, NULL, 0, 0},
+    {"KMP_SAMPLE_PERIOD", __kmp_stg_parse_sample_period,
+     __kmp_stg_print_sample_period, NULL, 0, 0},
 #if KMP_USE_HIER_SCHED
     {"KMP_DISP_HAND_THREAD", __kmp_stg_parse_kmp_hand_thread,
      __kmp_stg_print_kmp_hand_thread, NULL, 0, 0},
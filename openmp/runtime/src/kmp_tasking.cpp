@@ -13,6 +13,7 @@
 #include "kmp.h"
 #include "kmp_i18n.h"
 #include "kmp_itt.h"
+#include "kmp_sample.h"
 #include "kmp_stats.h"
 #include "kmp_wait_release.h"
 #include "kmp_taskdeps.h"
@@ -323,6 +324,34 @@ static void __kmp_realloc_task_deque(kmp_info_t *thread,
   thread_data->td.td_deque_size = new_size;
 }
 
+#if KMP_USE_LOCKFREE_TASK_DEQUE
+// Lock-free task deque (the THE protocol of Cilk-5):
+// The owner pushes and pops at the tail without taking td_deque_lock, thieves
+// and __kmp_give_task still serialize on it and work at the head. A task is
+// claimed by decrementing td_deque_ntasks before its slot is read, so the owner
+// and a thief racing for the last task cannot both get it; head and tail only
+// move once the claim succeeded. At most one thread holding the lock can be in
+// the middle of an operation, hence the owner treats its deque as full one
+// task early and falls back to the lock.
+
+// __kmp_claim_deque_task: reserve one task of the deque, false if none is left
+static inline bool __kmp_claim_deque_task(kmp_thread_data_t *thread_data) {
+  kmp_int32 ntasks = TCR_4(thread_data->td.td_deque_ntasks);
+  while (ntasks > 0) {
+    if (KMP_COMPARE_AND_STORE_ACQ32(&thread_data->td.td_deque_ntasks, ntasks,
+                                    ntasks - 1))
+      return true;
+    ntasks = TCR_4(thread_data->td.td_deque_ntasks);
+  }
+  return false;
+}
+
+// __kmp_unclaim_deque_task: give back a task that could not be taken
+static inline void __kmp_unclaim_deque_task(kmp_thread_data_t *thread_data) {
+  KMP_TEST_THEN_INC32(&thread_data->td.td_deque_ntasks);
+}
+#endif // KMP_USE_LOCKFREE_TASK_DEQUE
+
 //  __kmp_push_task: Add a task to the thread's deque
 static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
   kmp_info_t *thread = __kmp_threads[gtid];
@@ -370,6 +399,46 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
     __kmp_alloc_task_deque(thread, thread_data);
   }
 
+#if KMP_USE_LOCKFREE_TASK_DEQUE
+  if (TCR_4(thread_data->td.td_deque_ntasks) >=
+      TASK_DEQUE_SIZE(thread_data->td) - 1) {
+    // A thief may still hold a slot it claimed, so sort this out under the
+    // lock where the count is exact
+    __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+    if (TCR_4(thread_data->td.td_deque_ntasks) >=
+        TASK_DEQUE_SIZE(thread_data->td)) {
+      if (__kmp_task_is_allowed(gtid, __kmp_task_stealing_constraint, taskdata,
+                                thread->th.th_current_task)) {
+        __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+        KA_TRACE(20, ("__kmp_push_task: T#%d deque is full; returning "
+                      "TASK_NOT_PUSHED for task %p\n",
+                      gtid, taskdata));
+        return TASK_NOT_PUSHED;
+      }
+      // expand deque to push the task which is not allowed to execute
+      __kmp_realloc_task_deque(thread, thread_data);
+    }
+    thread_data->td.td_deque[thread_data->td.td_deque_tail] = taskdata;
+    thread_data->td.td_deque_tail =
+        (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
+    KMP_TEST_THEN_INC32(&thread_data->td.td_deque_ntasks);
+    __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+  } else {
+    // The slot at the tail is free and only this thread writes the tail, the
+    // increment publishes the task to thieves
+    thread_data->td.td_deque[thread_data->td.td_deque_tail] = taskdata;
+    thread_data->td.td_deque_tail =
+        (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
+    KMP_TEST_THEN_INC32(&thread_data->td.td_deque_ntasks);
+  }
+
+  KA_TRACE(20, ("__kmp_push_task: T#%d returning TASK_SUCCESSFULLY_PUSHED: "
+                "task=%p ntasks=%d head=%u tail=%u\n",
+                gtid, taskdata, thread_data->td.td_deque_ntasks,
+                thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+
+  return TASK_SUCCESSFULLY_PUSHED;
+#else
   int locked = 0;
   // Check if deque is full
   if (TCR_4(thread_data->td.td_deque_ntasks) >=
@@ -428,6 +497,7 @@ static kmp_int32 __kmp_push_task(kmp_int32 gtid, kmp_task_t *task) {
   __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
 
   return TASK_SUCCESSFULLY_PUSHED;
+#endif // KMP_USE_LOCKFREE_TASK_DEQUE
 }
 
 // __kmp_pop_current_task_from_thread: set up current task from called thread
@@ -1621,6 +1691,7 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
     }
 #endif
 
+    KMP_SAMPLE_BEGIN(sample_start);
 #ifdef KMP_GOMP_COMPAT
     if (taskdata->td_flags.native) {
       ((void (*)(void *))(*(task->routine)))(task->shareds);
@@ -1629,6 +1700,7 @@ static void __kmp_invoke_task(kmp_int32 gtid, kmp_task_t *task,
     {
       (*(task->routine))(gtid, task);
     }
+    KMP_SAMPLE_END(gtid, ks_task, sample_start);
     KMP_POP_PARTITIONED_TIMER();
 
 #if USE_ITT_BUILD && USE_ITT_NOTIFY
@@ -2702,6 +2774,35 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
     return NULL;
   }
 
+#if KMP_USE_LOCKFREE_TASK_DEQUE
+  // Thieves take from the head, the claim leaves the tail task to this thread
+  if (!__kmp_claim_deque_task(thread_data)) {
+    KA_TRACE(10,
+             ("__kmp_remove_my_task(exit #2): T#%d No tasks to remove: "
+              "ntasks=%d head=%u tail=%u\n",
+              gtid, thread_data->td.td_deque_ntasks,
+              thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+    return NULL;
+  }
+
+  tail = (thread_data->td.td_deque_tail - 1) &
+         TASK_DEQUE_MASK(thread_data->td); // Wrap index.
+  taskdata = thread_data->td.td_deque[tail];
+
+  if (!__kmp_task_is_allowed(gtid, is_constrained, taskdata,
+                             thread->th.th_current_task)) {
+    // The TSC does not allow to steal victim task
+    __kmp_unclaim_deque_task(thread_data);
+    KA_TRACE(10,
+             ("__kmp_remove_my_task(exit #3): T#%d TSC blocks tail task: "
+              "ntasks=%d head=%u tail=%u\n",
+              gtid, thread_data->td.td_deque_ntasks,
+              thread_data->td.td_deque_head, thread_data->td.td_deque_tail));
+    return NULL;
+  }
+
+  thread_data->td.td_deque_tail = tail;
+#else
   __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
 
   if (TCR_4(thread_data->td.td_deque_ntasks) == 0) {
@@ -2734,6 +2835,7 @@ static kmp_task_t *__kmp_remove_my_task(kmp_info_t *thread, kmp_int32 gtid,
   TCW_4(thread_data->td.td_deque_ntasks, thread_data->td.td_deque_ntasks - 1);
 
   __kmp_release_bootstrap_lock(&thread_data->td.td_deque_lock);
+#endif // KMP_USE_LOCKFREE_TASK_DEQUE
 
   KA_TRACE(10, ("__kmp_remove_my_task(exit #4): T#%d task %p removed: "
                 "ntasks=%d head=%u tail=%u\n",
@@ -2756,7 +2858,6 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   kmp_taskdata_t *taskdata;
   kmp_taskdata_t *current;
   kmp_thread_data_t *victim_td, *threads_data;
-  kmp_int32 target;
   kmp_int32 victim_tid;
 
   KMP_DEBUG_ASSERT(__kmp_tasking_mode != tskm_immediate_exec);
@@ -2784,6 +2885,59 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
 
   __kmp_acquire_bootstrap_lock(&victim_td->td.td_deque_lock);
 
+#if KMP_USE_LOCKFREE_TASK_DEQUE
+  // The victim pops without the lock and may run out of tasks as soon as the
+  // claim below succeeds, so this thread must be un-marked as a finished
+  // victim before claiming, or else other threads might be prematurely
+  // released from the barrier
+  int was_finished = *thread_finished;
+  if (was_finished) {
+    kmp_int32 count = KMP_ATOMIC_INC(unfinished_threads);
+    KMP_DEBUG_USE_VAR(count);
+    KA_TRACE(
+        20,
+        ("__kmp_steal_task: T#%d inc unfinished_threads to %d: task_team=%p\n",
+         gtid, count + 1, task_team));
+    *thread_finished = FALSE;
+  }
+
+  int ntasks = TCR_4(victim_td->td.td_deque_ntasks);
+  KMP_DEBUG_USE_VAR(ntasks);
+  taskdata = NULL;
+  if (__kmp_claim_deque_task(victim_td)) {
+    KMP_DEBUG_ASSERT(victim_td->td.td_deque != NULL);
+    current = __kmp_threads[gtid]->th.th_current_task;
+    taskdata = victim_td->td.td_deque[victim_td->td.td_deque_head];
+    if (__kmp_task_is_allowed(gtid, is_constrained, taskdata, current)) {
+      // Bump head pointer and Wrap.
+      victim_td->td.td_deque_head =
+          (victim_td->td.td_deque_head + 1) & TASK_DEQUE_MASK(victim_td->td);
+    } else {
+      // The TSC does not allow to steal victim task. Tasks behind the head are
+      // not searched for untied ones since the owner may be popping the tail.
+      __kmp_unclaim_deque_task(victim_td);
+      taskdata = NULL;
+    }
+  }
+  if (taskdata == NULL) {
+    if (was_finished) {
+      kmp_int32 count = KMP_ATOMIC_DEC(unfinished_threads);
+      KMP_DEBUG_USE_VAR(count);
+      KA_TRACE(20, ("__kmp_steal_task: T#%d dec unfinished_threads to %d: "
+                    "task_team=%p\n",
+                    gtid, count - 1, task_team));
+      *thread_finished = TRUE;
+    }
+    __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+    KA_TRACE(10, ("__kmp_steal_task(exit #2): T#%d could not steal from T#%d: "
+                  "task_team=%p ntasks=%d head=%u tail=%u\n",
+                  gtid, __kmp_gtid_from_thread(victim_thr), task_team, ntasks,
+                  victim_td->td.td_deque_head, victim_td->td.td_deque_tail));
+    return NULL;
+  }
+
+  __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+#else
   int ntasks = TCR_4(victim_td->td.td_deque_ntasks);
   // Check again after we acquire the lock
   if (ntasks == 0) {
@@ -2814,7 +2968,7 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
     }
     int i;
     // walk through victim's deque trying to steal any task
-    target = victim_td->td.td_deque_head;
+    kmp_int32 target = victim_td->td.td_deque_head;
     taskdata = NULL;
     for (i = 1; i < ntasks; ++i) {
       target = (target + 1) & TASK_DEQUE_MASK(victim_td->td);
@@ -2864,6 +3018,7 @@ static kmp_task_t *__kmp_steal_task(kmp_info_t *victim_thr, kmp_int32 gtid,
   TCW_4(victim_td->td.td_deque_ntasks, ntasks - 1);
 
   __kmp_release_bootstrap_lock(&victim_td->td.td_deque_lock);
+#endif // KMP_USE_LOCKFREE_TASK_DEQUE
 
   KMP_COUNT_BLOCK(TASK_stolen);
   KA_TRACE(10,
@@ -3771,6 +3926,24 @@ static bool __kmp_give_task(kmp_info_t *thread, kmp_int32 tid, kmp_task_t *task,
     return result;
   }
 
+#if KMP_USE_LOCKFREE_TASK_DEQUE
+  // The owner may be pushing or popping at the tail, so the task goes in at
+  // the head and the deque cannot be reallocated from here. One slot is kept
+  // for the owner, the caller moves on to another thread when this one is full
+  __kmp_acquire_bootstrap_lock(&thread_data->td.td_deque_lock);
+  if (TCR_4(thread_data->td.td_deque_ntasks) >=
+      TASK_DEQUE_SIZE(thread_data->td) - 1) {
+    KA_TRACE(30, ("__kmp_give_task: queue is full while giving task %p to "
+                  "thread %d.\n",
+                  taskdata, tid));
+    goto release_and_exit;
+  }
+
+  thread_data->td.td_deque_head =
+      (thread_data->td.td_deque_head - 1) & TASK_DEQUE_MASK(thread_data->td);
+  thread_data->td.td_deque[thread_data->td.td_deque_head] = taskdata;
+  KMP_TEST_THEN_INC32(&thread_data->td.td_deque_ntasks);
+#else
   if (TCR_4(thread_data->td.td_deque_ntasks) >=
       TASK_DEQUE_SIZE(thread_data->td)) {
     KA_TRACE(
@@ -3813,6 +3986,7 @@ static bool __kmp_give_task(kmp_info_t *thread, kmp_int32 tid, kmp_task_t *task,
       (thread_data->td.td_deque_tail + 1) & TASK_DEQUE_MASK(thread_data->td);
   TCW_4(thread_data->td.td_deque_ntasks,
         TCR_4(thread_data->td.td_deque_ntasks) + 1);
+#endif // KMP_USE_LOCKFREE_TASK_DEQUE
 
   result = true;
   KA_TRACE(30, ("__kmp_give_task: successfully gave task %p to thread %d.\n",
@@ -0,0 +1,45 @@
+// RUN: %libomp-compile-and-run
+
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+
+int main() {
+  omp_alloctrait_t at[2];
+  omp_allocator_handle_t a[2];
+  char *p[2][2];
+  int j, err = 0;
+  at[0].key = OMP_ATK_PARTITION;
+  at[0].value = OMP_ATV_NEAREST;
+  a[0] = omp_init_allocator(omp_default_mem_space, 1, at);
+  at[0].value = OMP_ATV_INTERLEAVED;
+  a[1] = omp_init_allocator(omp_default_mem_space, 1, at);
+  printf("allocators created: %p %p\n", a[0], a[1]);
+  #pragma omp parallel num_threads(2) private(j)
+  {
+    int i = omp_get_thread_num();
+    for (j = 0; j < 2; ++j) {
+      // large enough blocks to be placed page by page
+      p[i][j] = (char *)omp_alloc(1024 * 1024, a[j]);
+      if (p[i][j])
+        memset(p[i][j], i + 1, 1024 * 1024);
+    }
+    #pragma omp barrier
+    for (j = 0; j < 2; ++j) {
+      if (p[i][j] == NULL || p[i][j][1024 * 1024 - 1] != i + 1) {
+        #pragma omp atomic
+        err++;
+      }
+      omp_free(p[i][j], a[j]);
+    }
+  }
+  for (j = 0; j < 2; ++j)
+    omp_destroy_allocator(a[j]);
+  if (err == 0) {
+    printf("passed\n");
+    return 0;
+  } else {
+    printf("failed: %d bad blocks\n", err);
+    return 1;
+  }
+}
@@ -0,0 +1,86 @@
+// RUN: %libomp-compile && env KMP_SAMPLE_FILE=%t.smp KMP_SAMPLE_PERIOD=1 %libomp-run
+// RUN: %libomp-run %t.smp
+//
+// The first run records every barrier, task and dispatch event into the
+// sample file, which is written when the runtime shuts down. The second run
+// checks the header and the records left by the first one.
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "omp_testsuite.h"
+
+// Mirrors kmp_sample_header_t and kmp_sample_t in kmp_sample.h
+typedef struct {
+  char magic[8];
+  uint32_t record_size;
+  uint32_t period;
+  uint64_t ticks_per_sec;
+} header_t;
+
+typedef struct {
+  uint64_t start;
+  uint64_t ticks;
+  int32_t gtid;
+  int32_t kind;
+} record_t;
+
+static int record_events() {
+  int i, sum = 0, tasks = 0;
+  #pragma omp parallel num_threads(2) reduction(+:sum) shared(tasks)
+  {
+    #pragma omp for schedule(dynamic)
+    for (i = 0; i < 100; ++i)
+      sum += i;
+    #pragma omp single
+    {
+      #pragma omp task shared(tasks)
+      {
+        #pragma omp atomic
+        tasks++;
+      }
+    }
+    #pragma omp barrier
+  }
+  return sum == 4950 && tasks == 1 ? 0 : 1;
+}
+
+static int check_file(const char *name) {
+  header_t header;
+  record_t record;
+  int seen[3] = {0, 0, 0};
+  FILE *f = fopen(name, "rb");
+  if (f == NULL) {
+    fprintf(stderr, "error: cannot open %s\n", name);
+    return 1;
+  }
+  if (fread(&header, sizeof(header), 1, f) != 1 ||
+      memcmp(header.magic, "KMPSMP01", 8) != 0 ||
+      header.record_size != sizeof(record_t) || header.period != 1 ||
+      header.ticks_per_sec == 0) {
+    fprintf(stderr, "error: bad header\n");
+    fclose(f);
+    return 1;
+  }
+  while (fread(&record, sizeof(record), 1, f) == 1) {
+    if (record.kind < 0 || record.kind > 2 || record.gtid < 0) {
+      fprintf(stderr, "error: bad record kind %d gtid %d\n", record.kind,
+              record.gtid);
+      fclose(f);
+      return 1;
+    }
+    seen[record.kind]++;
+  }
+  fclose(f);
+  if (!seen[0] || !seen[1] || !seen[2]) {
+    fprintf(stderr, "error: missing records %d %d %d\n", seen[0], seen[1],
+            seen[2]);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1)
+    return check_file(argv[1]);
+  return record_events();
+}
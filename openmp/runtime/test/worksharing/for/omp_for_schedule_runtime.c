@@ -10,6 +10,7 @@
 // RUN: env OMP_SCHEDULE=trapezoidal,13 %libomp-run 101 13
 // RUN: env OMP_SCHEDULE=static_steal %libomp-run 102 1
 // RUN: env OMP_SCHEDULE=static_steal,14 %libomp-run 102 14
+// RUN: env OMP_SCHEDULE=static_steal,2 KMP_STATIC_STEAL_ADAPTIVE=1 %libomp-run 102 2
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -0,0 +1,71 @@
+#!/usr/bin/env python
+#
+#//===----------------------------------------------------------------------===//
+#//
+#// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+#// See https://llvm.org/LICENSE.txt for license information.
+#// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+#//
+#//===----------------------------------------------------------------------===//
+#
+
+# Convert a file written by the runtime with KMP_SAMPLE_FILE=<path> to CSV.
+# The layout mirrors kmp_sample_header_t and kmp_sample_t in kmp_sample.h.
+
+import argparse
+import struct
+import sys
+
+MAGIC = b'KMPSMP01'
+HEADER = struct.Struct('=8sIIQ')
+RECORD = struct.Struct('=QQii')
+KINDS = ['barrier', 'task', 'dispatch']
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Print the records of a libomp sample file as CSV.')
+    parser.add_argument('file', help='file written with KMP_SAMPLE_FILE')
+    parser.add_argument('--summary', action='store_true',
+                        help='print per kind totals instead of the records')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    if len(data) < HEADER.size:
+        sys.exit('%s: file is too short' % args.file)
+    magic, record_size, period, ticks_per_sec = HEADER.unpack_from(data, 0)
+    if magic != MAGIC:
+        sys.exit('%s: not a libomp sample file' % args.file)
+    if record_size != RECORD.size:
+        sys.exit('%s: unexpected record size %d' % (args.file, record_size))
+    if ticks_per_sec == 0:
+        sys.stderr.write('%s: timestamp frequency unknown, the run did not '
+                         'finish cleanly\n' % args.file)
+
+    def usec(ticks):
+        return ticks * 1e6 / ticks_per_sec if ticks_per_sec else 0.0
+
+    totals = {}
+    if not args.summary:
+        print('gtid,kind,start,ticks,usec')
+    for offset in range(HEADER.size, len(data) - RECORD.size + 1, RECORD.size):
+        start, ticks, gtid, kind = RECORD.unpack_from(data, offset)
+        name = KINDS[kind] if 0 <= kind < len(KINDS) else str(kind)
+        if args.summary:
+            count, sum_ticks = totals.get(name, (0, 0))
+            totals[name] = (count + 1, sum_ticks + ticks)
+        else:
+            print('%d,%s,%d,%d,%.3f' % (gtid, name, start, ticks, usec(ticks)))
+
+    if args.summary:
+        # Each record stands for period events
+        print('kind,samples,estimated_events,total_usec,mean_usec')
+        for name, (count, sum_ticks) in sorted(totals.items()):
+            print('%s,%d,%d,%.3f,%.3f' % (name, count, count * period,
+                                          usec(sum_ticks) * period,
+                                          usec(sum_ticks) / count))
+
+
+if __name__ == '__main__':
+    main()
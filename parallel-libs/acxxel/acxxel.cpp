@@ -55,6 +55,20 @@ Status Stream::waitOnEvent(Event &Event) {
       TheHandle.get(), ThePlatform->getEventHandle(Event)));
 }
 
+Status Stream::waitOnStream(Stream &Other) {
+  Expected<Event> MaybeEvent = ThePlatform->createEvent(Other.TheDeviceIndex);
+  if (MaybeEvent.isError())
+    return takeStatusOr(MaybeEvent.getError());
+  Event &OtherDone = MaybeEvent.getValue();
+  Status S = ThePlatform->enqueueEvent(ThePlatform->getEventHandle(OtherDone),
+                                       Other.TheHandle.get());
+  if (S.isError())
+    return takeStatusOr(S);
+  // The platforms keep the event alive for the wait, so it can be destroyed
+  // as soon as the wait is enqueued.
+  return waitOnEvent(OtherDone);
+}
+
 Stream &
 Stream::addCallback(std::function<void(Stream &, const Status &)> Callback) {
   setStatus(ThePlatform->addStreamCallback(*this, std::move(Callback)));
@@ -78,6 +92,44 @@ Stream &Stream::enqueueEvent(Event &E) {
   return *this;
 }
 
+Expected<StagingBufferPool>
+StagingBufferPool::create(Platform *APlatform, int DeviceIndex,
+                          ptrdiff_t BufferByteSize, int BufferCount) {
+  if (BufferByteSize <= 0 || BufferCount <= 0)
+    return Status("staging buffer pool needs a positive buffer size and count");
+  std::vector<Buffer> Buffers;
+  Buffers.reserve(BufferCount);
+  for (int I = 0; I < BufferCount; ++I) {
+    Expected<OwnedAsyncHostMemory<char>> MaybeMemory =
+        APlatform->newAsyncHostMem<char>(BufferByteSize);
+    if (MaybeMemory.isError())
+      return MaybeMemory.getError();
+    Expected<Event> MaybeEvent = APlatform->createEvent(DeviceIndex);
+    if (MaybeEvent.isError())
+      return MaybeEvent.getError();
+    Buffers.push_back(Buffer{MaybeMemory.takeValue(), MaybeEvent.takeValue()});
+  }
+  return StagingBufferPool(DeviceIndex, BufferByteSize, std::move(Buffers));
+}
+
+StagingBufferPool::StagingBufferPool(StagingBufferPool &&) noexcept = default;
+StagingBufferPool &StagingBufferPool::
+operator=(StagingBufferPool &&) noexcept = default;
+
+Expected<char *> StagingBufferPool::acquireBuffer() {
+  Buffer &Next = TheBuffers[TheNextBuffer];
+  Status S = Next.Released.sync();
+  if (S.isError())
+    return S;
+  return Next.Memory.get();
+}
+
+Event &StagingBufferPool::releaseBuffer() {
+  Event &Released = TheBuffers[TheNextBuffer].Released;
+  TheNextBuffer = (TheNextBuffer + 1) % TheBuffers.size();
+  return Released;
+}
+
 Event::Event(Event &&) noexcept = default;
 Event &Event::operator=(Event &&) noexcept = default;
 
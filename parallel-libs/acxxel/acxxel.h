@@ -103,10 +103,13 @@
 #include "span.h"
 #include "status.h"
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #if defined(__clang__) || defined(__GNUC__)
 #define ACXXEL_WARN_UNUSED_RESULT __attribute__((warn_unused_result))
@@ -128,6 +131,7 @@ namespace acxxel {
 
 class Event;
 class Platform;
+class StagingBufferPool;
 class Stream;
 
 template <typename T> class DeviceMemory;
@@ -260,6 +264,20 @@ public:
   /// Status state of the stream.
   Status waitOnEvent(Event &Event) ACXXEL_WARN_UNUSED_RESULT;
 
+  /// Makes all future work submitted to this stream wait until all the work
+  /// enqueued so far on another stream is complete.
+  ///
+  /// Each call adds an edge to a dependency graph between streams: independent
+  /// work runs concurrently on separate streams, and a stream only waits for
+  /// the streams it depends on, without blocking the host. The other stream
+  /// may be on a different device only if the platform supports waiting on
+  /// events across devices.
+  ///
+  /// Returns a Status for any errors emitted by the asynchronous work on the
+  /// Stream, or by any error in the synchronization process itself. Clears the
+  /// Status state of the stream.
+  Status waitOnStream(Stream &Other) ACXXEL_WARN_UNUSED_RESULT;
+
   /// Adds a host callback function to the stream.
   ///
   /// The callback will be called on the host after all previously enqueued work
@@ -312,6 +330,36 @@ public:
 
   /// \}
 
+  /// \name Staged copies of pageable host memory.
+  ///
+  /// These functions copy between device memory and ordinary host memory
+  /// without registering the host memory. The copy is split into chunks that
+  /// go through the registered buffers of a StagingBufferPool, so the host-side
+  /// copy of a chunk overlaps with the device transfers of the previous ones.
+  ///
+  /// asyncStagedCopyHToD returns once the whole source has been copied into
+  /// staging buffers, so the source may be reused as soon as it returns.
+  /// asyncStagedCopyDToH returns once all the chunks are enqueued, and the
+  /// destination is only filled in when the stream reaches them. In both
+  /// cases, the pool must outlive the enqueued work.
+  ///
+  /// For these functions, DeviceSrcTy must be convertible to
+  /// DeviceMemorySpan<const T>, DeviceDstTy must be convertible to
+  /// DeviceMemorySpan<T>, HostSrcTy must be convertible to Span<const T> and
+  /// HostDstTy must be convertible to Span<T>. The pool must have been created
+  /// for the device of the stream.
+  /// \{
+
+  template <typename HostSrcTy, typename DeviceDstTy>
+  Stream &asyncStagedCopyHToD(HostSrcTy &&HostSrc, DeviceDstTy &&DeviceDst,
+                              StagingBufferPool &Pool);
+
+  template <typename DeviceSrcTy, typename HostDstTy>
+  Stream &asyncStagedCopyDToH(DeviceSrcTy &&DeviceSrc, HostDstTy &&HostDst,
+                              StagingBufferPool &Pool);
+
+  /// \}
+
   /// \name Stream-synchronous device memory copies
   ///
   /// These functions block the host until the copy and all previously-enqueued
@@ -1377,6 +1425,178 @@ private:
   Span<ElementType> TheSpan;
 };
 
+/// A pool of registered host buffers used to stage copies of pageable host
+/// memory.
+///
+/// The staged copy functions of Stream cycle through the buffers of the pool,
+/// and only wait for a buffer when it is still in use by an earlier chunk.
+/// Allocating registered memory is expensive, so a pool should be created once
+/// and reused for many copies.
+///
+/// A pool is tied to a device, and it is not thread-safe.
+class StagingBufferPool {
+public:
+  /// Creates a pool of BufferCount buffers of BufferByteSize bytes each.
+  static Expected<StagingBufferPool> create(Platform *APlatform,
+                                            int DeviceIndex = 0,
+                                            ptrdiff_t BufferByteSize = 1 << 20,
+                                            int BufferCount = 4);
+
+  StagingBufferPool(const StagingBufferPool &) = delete;
+  StagingBufferPool &operator=(const StagingBufferPool &) = delete;
+  StagingBufferPool(StagingBufferPool &&) noexcept;
+  StagingBufferPool &operator=(StagingBufferPool &&) noexcept;
+  ~StagingBufferPool() = default;
+
+  /// Gets the index of the device for which the pool stages copies.
+  int getDeviceIndex() const { return TheDeviceIndex; }
+
+  /// Gets the size of each buffer, which is the size of the copy chunks.
+  ptrdiff_t getBufferByteSize() const { return TheBufferByteSize; }
+
+private:
+  friend class Stream;
+
+  struct Buffer {
+    OwnedAsyncHostMemory<char> Memory;
+    // Recorded on the stream after the last chunk that used the buffer.
+    Event Released;
+  };
+
+  StagingBufferPool(int DeviceIndex, ptrdiff_t BufferByteSize,
+                    std::vector<Buffer> &&Buffers)
+      : TheDeviceIndex(DeviceIndex), TheBufferByteSize(BufferByteSize),
+        TheBuffers(std::move(Buffers)), TheNextBuffer(0) {}
+
+  // Waits until the next buffer is no longer used by an earlier chunk, and
+  // returns it.
+  Expected<char *> acquireBuffer();
+
+  // Returns the event that marks the end of the use of the buffer returned by
+  // the last acquireBuffer call, and moves on to the next buffer.
+  Event &releaseBuffer();
+
+  int TheDeviceIndex;
+  ptrdiff_t TheBufferByteSize;
+  std::vector<Buffer> TheBuffers;
+  size_t TheNextBuffer;
+};
+
+// Implementation of the staged copy functions of Stream.
+
+template <typename HostSrcTy, typename DeviceDstTy>
+Stream &Stream::asyncStagedCopyHToD(HostSrcTy &&HostSrc,
+                                    DeviceDstTy &&DeviceDst,
+                                    StagingBufferPool &Pool) {
+  using DstElementTy =
+      typename std::remove_reference<DeviceDstTy>::type::value_type;
+  Span<const DstElementTy> HostSrcSpan(HostSrc);
+  DeviceMemorySpan<DstElementTy> DeviceDstSpan(DeviceDst);
+  if (HostSrcSpan.size() != DeviceDstSpan.size()) {
+    setStatus(Status("copyHToD source element count " +
+                     std::to_string(HostSrcSpan.size()) +
+                     " does not equal destination element count " +
+                     std::to_string(DeviceDstSpan.size())));
+    return *this;
+  }
+  if (Pool.getDeviceIndex() != TheDeviceIndex) {
+    setStatus(Status("staging buffer pool for device " +
+                     std::to_string(Pool.getDeviceIndex()) +
+                     " used on a stream for device " +
+                     std::to_string(TheDeviceIndex)));
+    return *this;
+  }
+  const char *Src = reinterpret_cast<const char *>(HostSrcSpan.data());
+  ptrdiff_t ByteCount = DeviceDstSpan.byte_size();
+  ptrdiff_t ChunkSize = Pool.getBufferByteSize();
+  for (ptrdiff_t Offset = 0; Offset < ByteCount; Offset += ChunkSize) {
+    ptrdiff_t ChunkByteCount = std::min(ChunkSize, ByteCount - Offset);
+    Expected<char *> MaybeBuffer = Pool.acquireBuffer();
+    if (MaybeBuffer.isError()) {
+      setStatus(MaybeBuffer.getError());
+      return *this;
+    }
+    char *Buffer = MaybeBuffer.getValue();
+    std::memcpy(Buffer, Src + Offset, ChunkByteCount);
+    if (setStatus(ThePlatform->asyncCopyHToD(
+                      Buffer, DeviceDstSpan.baseHandle(),
+                      DeviceDstSpan.byte_offset() + Offset, ChunkByteCount,
+                      TheHandle.get()))
+            .isError()) {
+      return *this;
+    }
+    if (setStatus(ThePlatform->enqueueEvent(
+                      ThePlatform->getEventHandle(Pool.releaseBuffer()),
+                      TheHandle.get()))
+            .isError()) {
+      return *this;
+    }
+  }
+  return *this;
+}
+
+template <typename DeviceSrcTy, typename HostDstTy>
+Stream &Stream::asyncStagedCopyDToH(DeviceSrcTy &&DeviceSrc,
+                                    HostDstTy &&HostDst,
+                                    StagingBufferPool &Pool) {
+  using SrcElementTy =
+      typename std::remove_reference<DeviceSrcTy>::type::value_type;
+  DeviceMemorySpan<const SrcElementTy> DeviceSrcSpan(DeviceSrc);
+  Span<SrcElementTy> HostDstSpan(HostDst);
+  if (DeviceSrcSpan.size() != HostDstSpan.size()) {
+    setStatus(Status("copyDToH source element count " +
+                     std::to_string(DeviceSrcSpan.size()) +
+                     " does not equal destination element count " +
+                     std::to_string(HostDstSpan.size())));
+    return *this;
+  }
+  if (Pool.getDeviceIndex() != TheDeviceIndex) {
+    setStatus(Status("staging buffer pool for device " +
+                     std::to_string(Pool.getDeviceIndex()) +
+                     " used on a stream for device " +
+                     std::to_string(TheDeviceIndex)));
+    return *this;
+  }
+  char *Dst = reinterpret_cast<char *>(HostDstSpan.data());
+  ptrdiff_t ByteCount = DeviceSrcSpan.byte_size();
+  ptrdiff_t ChunkSize = Pool.getBufferByteSize();
+  for (ptrdiff_t Offset = 0; Offset < ByteCount; Offset += ChunkSize) {
+    ptrdiff_t ChunkByteCount = std::min(ChunkSize, ByteCount - Offset);
+    Expected<char *> MaybeBuffer = Pool.acquireBuffer();
+    if (MaybeBuffer.isError()) {
+      setStatus(MaybeBuffer.getError());
+      return *this;
+    }
+    char *Buffer = MaybeBuffer.getValue();
+    if (setStatus(ThePlatform->asyncCopyDToH(
+                      DeviceSrcSpan.baseHandle(),
+                      DeviceSrcSpan.byte_offset() + Offset, Buffer,
+                      ChunkByteCount, TheHandle.get()))
+            .isError()) {
+      return *this;
+    }
+    // The platforms do not start the work enqueued after a callback before the
+    // callback returns, so the buffer is released after this copy-out.
+    if (setStatus(ThePlatform->addStreamCallback(
+                      *this,
+                      [Buffer, Dst, Offset, ChunkByteCount](Stream &,
+                                                            const Status &S) {
+                        if (!S.isError())
+                          std::memcpy(Dst + Offset, Buffer, ChunkByteCount);
+                      }))
+            .isError()) {
+      return *this;
+    }
+    if (setStatus(ThePlatform->enqueueEvent(
+                      ThePlatform->getEventHandle(Pool.releaseBuffer()),
+                      TheHandle.get()))
+            .isError()) {
+      return *this;
+    }
+  }
+  return *this;
+}
+
 } // namespace acxxel
 
 #endif // ACXXEL_ACXXEL_H
@@ -14,6 +14,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 namespace {
 
@@ -213,6 +214,27 @@ TEST_P(AcxxelTest, AsyncCopyHostAndDevice) {
     EXPECT_EQ(A[I], B[I]);
 }
 
+TEST_P(AcxxelTest, AsyncStagedCopyHostAndDevice) {
+  acxxel::Platform *Platform = GetParam()().takeValue();
+  // Three buffers of 64 bytes, so the copies cycle through the pool.
+  acxxel::StagingBufferPool Pool =
+      acxxel::StagingBufferPool::create(Platform, 0, 64, 3).takeValue();
+  std::vector<int> A(1000);
+  for (size_t I = 0; I < A.size(); ++I)
+    A[I] = static_cast<int>(I);
+  std::vector<int> B(A.size());
+  acxxel::DeviceMemory<int> X = Platform->mallocD<int>(A.size()).takeValue();
+  acxxel::Stream Stream = Platform->createStream().takeValue();
+  EXPECT_FALSE(Stream.asyncStagedCopyHToD(A, X, Pool).takeStatus().isError());
+  EXPECT_FALSE(Stream.asyncStagedCopyDToH(X, B, Pool).takeStatus().isError());
+  EXPECT_FALSE(Stream.sync().isError());
+  EXPECT_EQ(A, B);
+
+  std::vector<int> Short(10);
+  EXPECT_TRUE(
+      Stream.asyncStagedCopyHToD(Short, X, Pool).takeStatus().isError());
+}
+
 TEST_P(AcxxelTest, AsyncMemsetD) {
   acxxel::Platform *Platform = GetParam()().takeValue();
   constexpr size_t ArrayLength = 10;
@@ -401,6 +423,48 @@ TEST_P(AcxxelTest, WaitForEventsInAStream) {
   EXPECT_FALSE(Stream1.sync().isError());
 }
 
+TEST_P(AcxxelTest, WaitOnStream) {
+  acxxel::Platform *Platform = GetParam()().takeValue();
+  acxxel::Stream Stream0 = Platform->createStream().takeValue();
+  acxxel::Stream Stream1 = Platform->createStream().takeValue();
+
+  std::mutex Mutex;
+  std::condition_variable ConditionVar;
+  bool GoFlag = false;
+  bool MarkerFlag = false;
+
+  EXPECT_FALSE(Stream0
+                   .addCallback([&Mutex, &ConditionVar, &GoFlag, &MarkerFlag](
+                       acxxel::Stream &, const acxxel::Status &) {
+                     std::unique_lock<std::mutex> Lock(Mutex);
+                     ConditionVar.wait(Lock,
+                                       [&GoFlag] { return GoFlag == true; });
+                     MarkerFlag = true;
+                   })
+                   .takeStatus()
+                   .isError());
+
+  // The callback on Stream1 must run after everything enqueued on Stream0.
+  EXPECT_FALSE(Stream1.waitOnStream(Stream0).isError());
+  EXPECT_FALSE(Stream1
+                   .addCallback([&Mutex, &MarkerFlag](acxxel::Stream &,
+                                                      const acxxel::Status &) {
+                     std::unique_lock<std::mutex> Lock(Mutex);
+                     EXPECT_TRUE(MarkerFlag);
+                   })
+                   .takeStatus()
+                   .isError());
+
+  {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    GoFlag = true;
+  }
+  ConditionVar.notify_one();
+
+  EXPECT_FALSE(Stream1.sync().isError());
+  EXPECT_FALSE(Stream0.sync().isError());
+}
+
 #if defined(ACXXEL_ENABLE_CUDA) || defined(ACXXEL_ENABLE_OPENCL)
 INSTANTIATE_TEST_CASE_P(BothPlatformTest, AcxxelTest,
                         ::testing::Values(
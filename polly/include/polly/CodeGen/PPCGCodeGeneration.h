@@ -18,7 +18,10 @@
 enum GPUArch { NVPTX64, SPIR32, SPIR64 };
 
 /// The GPU Runtime implementation to use.
-enum GPURuntime { CUDA, OpenCL };
+///
+/// LibOMPTarget launches the kernels through the OpenMP offloading runtime,
+/// so that they share its device data environment with OpenMP target regions.
+enum GPURuntime { CUDA, OpenCL, LibOMPTarget };
 
 namespace polly {
 extern bool PollyManagedMemory;
@@ -93,6 +93,14 @@ struct Dependences {
   /// Report if valid dependences are available.
   bool hasValidDependences() const;
 
+  /// Check whether these dependences are still those of @p S.
+  ///
+  /// Dependences relate statement instances in the order of the original
+  /// schedule, which legal schedule transformations preserve. They therefore
+  /// stay valid as long as the statement domains and memory accesses of @p S
+  /// are unchanged.
+  bool isUpToDate(Scop &S) const;
+
   /// Return the reduction dependences caused by @p MA.
   ///
   /// @return The reduction dependences caused by @p MA or nullptr if none.
@@ -179,6 +187,15 @@ private:
   /// The (reverse) transitive closure of reduction dependences.
   isl_union_map *TC_RED;
 
+  /// The statement domains and memory accesses the dependences were computed
+  /// from, see isUpToDate.
+  isl::union_set InputDomain;
+  isl::union_map InputRead;
+  isl::union_map InputMustWrite;
+  isl::union_map InputMayWrite;
+  isl::union_map InputReductionTags;
+  SmallVector<MemoryAccess *, 8> InputReductionAccesses;
+
   /// Mapping from memory accesses to their reduction dependences.
   ReductionDependencesMapTy ReductionDependences;
 
@@ -195,6 +212,10 @@ struct DependenceAnalysis : public AnalysisInfoMixin<DependenceAnalysis> {
     Scop &S;
     std::unique_ptr<Dependences> D[Dependences::NumAnalysisLevels];
 
+    /// Whether the dependences of a level must be checked with
+    /// Dependences::isUpToDate before they are used again.
+    bool NeedsCheck[Dependences::NumAnalysisLevels] = {};
+
     /// Return the dependence information for the current SCoP.
     ///
     /// @param Level The granularity of dependence analysis result.
@@ -204,7 +225,17 @@ struct DependenceAnalysis : public AnalysisInfoMixin<DependenceAnalysis> {
     const Dependences &getDependences(Dependences::AnalysisLevel Level);
 
     /// Recompute dependences from schedule and memory accesses.
+    ///
+    /// Dependences that are still up to date are kept.
     const Dependences &recomputeDependences(Dependences::AnalysisLevel Level);
+
+    /// Keep the dependences when a pass does not preserve them.
+    ///
+    /// They are checked with Dependences::isUpToDate before their next use
+    /// instead, so that passes that only change the schedule do not cause
+    /// them to be recomputed.
+    bool invalidate(Scop &S, const PreservedAnalyses &PA,
+                    ScopAnalysisManager::Invalidator &Inv);
   };
   Result run(Scop &S, ScopAnalysisManager &SAM,
              ScopStandardAnalysisResults &SAR);
@@ -236,6 +267,8 @@ public:
   const Dependences &getDependences(Dependences::AnalysisLevel Level);
 
   /// Recompute dependences from schedule and memory accesses.
+  ///
+  /// Dependences that are still up to date are kept.
   const Dependences &recomputeDependences(Dependences::AnalysisLevel Level);
 
   /// Compute the dependence information for the SCoP @p S.
@@ -278,6 +311,8 @@ public:
   const Dependences &getDependences(Scop *S, Dependences::AnalysisLevel Level);
 
   /// Recompute dependences from schedule and memory accesses.
+  ///
+  /// Dependences that are still up to date are kept.
   const Dependences &recomputeDependences(Scop *S,
                                           Dependences::AnalysisLevel Level);
 
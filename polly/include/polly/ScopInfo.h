@@ -1709,6 +1709,13 @@ private:
   /// Flag to indicate if the Scop is to be skipped.
   bool SkipScop = false;
 
+  /// The number of isl operations that the construction, dependence analysis
+  /// and scheduling of this SCoP may perform together, 0 if unlimited.
+  unsigned long MaxIslOps;
+
+  /// The number of isl operations charged to this SCoP so far.
+  unsigned long SpentIslOps = 0;
+
   using StmtSet = std::list<ScopStmt>;
 
   /// The statements in this Scop.
@@ -2447,6 +2454,24 @@ public:
   /// Check if the SCoP is to be skipped by ScopPass passes.
   bool isToBeSkipped() const { return SkipScop; }
 
+  /// Charge the isl operations performed since the last charge to the
+  /// compile-time budget of this SCoP.
+  ///
+  /// The operations are counted by the isl context of the SCoP, which an
+  /// IslMaxOperationsGuard restarts. Must not be called inside such a guard.
+  ///
+  /// @returns False if the budget is exhausted. The SCoP is then marked to be
+  ///          skipped, which leaves its code unoptimized.
+  bool chargeIslOperations();
+
+  /// Return the isl operations limit for an analysis of this SCoP.
+  ///
+  /// @param LocalMaxOps The limit of the analysis itself, 0 if it has none.
+  ///
+  /// @returns The smaller of @p LocalMaxOps and the remaining compile-time
+  ///          budget of this SCoP, 0 if neither is limited.
+  unsigned long getMaxIslOperations(unsigned long LocalMaxOps) const;
+
   /// Return the ID of the Scop
   int getID() const { return ID; }
 
@@ -187,6 +187,16 @@ static void collectInfo(Scop &S, isl_union_map *&Read,
   MayWrite = isl_union_map_coalesce(MayWrite);
 }
 
+/// Collect the memory accesses of @p S that can take part in reductions.
+static SmallVector<MemoryAccess *, 8> collectReductionAccesses(Scop &S) {
+  SmallVector<MemoryAccess *, 8> Accesses;
+  for (ScopStmt &Stmt : S)
+    for (MemoryAccess *MA : Stmt)
+      if (MA->isReductionLike())
+        Accesses.push_back(MA);
+  return Accesses;
+}
+
 /// Fix all dimension of @p Zero to 0 and add it to @p user
 static void fixSetToZero(isl::set Zero, isl::union_set *User) {
   for (unsigned i = 0; i < Zero.dim(isl::dim::set); i++)
@@ -412,9 +422,21 @@ void Dependences::calculateDependences(Scop &S) {
 
   LLVM_DEBUG(dbgs() << "Scop: \n" << S << "\n");
 
+  // A SCoP that exhausted its compile-time budget is left unoptimized, so it
+  // needs no dependences.
+  if (!S.chargeIslOperations())
+    return;
+
   collectInfo(S, Read, MustWrite, MayWrite, ReductionTagMap, TaggedStmtDomain,
               Level);
 
+  InputRead = isl::manage_copy(Read);
+  InputMustWrite = isl::manage_copy(MustWrite);
+  InputMayWrite = isl::manage_copy(MayWrite);
+  InputReductionTags = isl::manage_copy(ReductionTagMap);
+  InputDomain = isl::manage_copy(TaggedStmtDomain);
+  InputReductionAccesses = collectReductionAccesses(S);
+
   bool HasReductions = !isl_union_map_is_empty(ReductionTagMap);
 
   LLVM_DEBUG(dbgs() << "Read: " << Read << '\n';
@@ -465,7 +487,8 @@ void Dependences::calculateDependences(Scop &S) {
 
   isl_union_map *StrictWAW = nullptr;
   {
-    IslMaxOperationsGuard MaxOpGuard(IslCtx.get(), OptComputeOut);
+    IslMaxOperationsGuard MaxOpGuard(IslCtx.get(),
+                                     S.getMaxIslOperations(OptComputeOut));
 
     RAW = WAW = WAR = RED = nullptr;
     isl_union_map *Write = isl_union_map_union(isl_union_map_copy(MustWrite),
@@ -576,6 +599,8 @@ void Dependences::calculateDependences(Scop &S) {
     // End of max_operations scope.
   }
 
+  S.chargeIslOperations();
+
   if (isl_ctx_last_error(IslCtx.get()) == isl_error_quota) {
     isl_union_map_free(RAW);
     isl_union_map_free(WAW);
@@ -901,6 +926,30 @@ bool Dependences::hasValidDependences() const {
   return (RAW != nullptr) && (WAR != nullptr) && (WAW != nullptr);
 }
 
+bool Dependences::isUpToDate(Scop &S) const {
+  if (!hasValidDependences() || S.getSharedIslCtx() != IslCtx)
+    return false;
+
+  if (collectReductionAccesses(S) != InputReductionAccesses)
+    return false;
+
+  isl_union_map *Read, *MustWrite, *MayWrite, *ReductionTagMap;
+  isl_union_set *TaggedStmtDomain;
+  collectInfo(S, Read, MustWrite, MayWrite, ReductionTagMap, TaggedStmtDomain,
+              Level);
+  isl::union_set Domain = isl::manage(TaggedStmtDomain);
+  isl::union_map Reads = isl::manage(Read);
+  isl::union_map MustWrites = isl::manage(MustWrite);
+  isl::union_map MayWrites = isl::manage(MayWrite);
+  isl::union_map ReductionTags = isl::manage(ReductionTagMap);
+
+  return InputDomain.is_equal(Domain).is_true() &&
+         InputRead.is_equal(Reads).is_true() &&
+         InputMustWrite.is_equal(MustWrites).is_true() &&
+         InputMayWrite.is_equal(MayWrites).is_true() &&
+         InputReductionTags.is_equal(ReductionTags).is_true();
+}
+
 __isl_give isl_map *
 Dependences::getReductionDependences(MemoryAccess *MA) const {
   return isl_map_copy(ReductionDependences.lookup(MA));
@@ -915,18 +964,37 @@ void Dependences::setReductionDependences(MemoryAccess *MA, isl_map *D) {
 const Dependences &
 DependenceAnalysis::Result::getDependences(Dependences::AnalysisLevel Level) {
   if (Dependences *d = D[Level].get())
-    return *d;
+    if (!NeedsCheck[Level])
+      return *d;
 
   return recomputeDependences(Level);
 }
 
 const Dependences &DependenceAnalysis::Result::recomputeDependences(
     Dependences::AnalysisLevel Level) {
+  NeedsCheck[Level] = false;
+  if (D[Level] && D[Level]->isUpToDate(S))
+    return *D[Level];
+
   D[Level].reset(new Dependences(S.getSharedIslCtx(), Level));
   D[Level]->calculateDependences(S);
   return *D[Level];
 }
 
+bool DependenceAnalysis::Result::invalidate(
+    Scop &S, const PreservedAnalyses &PA,
+    ScopAnalysisManager::Invalidator &Inv) {
+  auto PAC = PA.getChecker<DependenceAnalysis>();
+  if (PAC.preserved() || PAC.preservedSet<AllAnalysesOn<Scop>>())
+    return false;
+
+  // Passes that only change the schedule keep the dependences valid. Instead
+  // of dropping them, check them against the SCoP before their next use.
+  for (bool &Check : NeedsCheck)
+    Check = true;
+  return false;
+}
+
 DependenceAnalysis::Result
 DependenceAnalysis::run(Scop &S, ScopAnalysisManager &SAM,
                         ScopStandardAnalysisResults &SAR) {
@@ -964,6 +1032,9 @@ DependenceInfo::getDependences(Dependences::AnalysisLevel Level) {
 
 const Dependences &
 DependenceInfo::recomputeDependences(Dependences::AnalysisLevel Level) {
+  if (D[Level] && D[Level]->isUpToDate(*S))
+    return *D[Level];
+
   D[Level].reset(new Dependences(S->getSharedIslCtx(), Level));
   D[Level]->calculateDependences(*S);
   return *D[Level];
@@ -1018,10 +1089,13 @@ DependenceInfoWrapperPass::getDependences(Scop *S,
 
 const Dependences &DependenceInfoWrapperPass::recomputeDependences(
     Scop *S, Dependences::AnalysisLevel Level) {
-  std::unique_ptr<Dependences> D(new Dependences(S->getSharedIslCtx(), Level));
+  std::unique_ptr<Dependences> &D = ScopToDepsMap[S];
+  if (D && D->getDependenceLevel() == Level && D->isUpToDate(*S))
+    return *D;
+
+  D.reset(new Dependences(S->getSharedIslCtx(), Level));
   D->calculateDependences(*S);
-  auto Inserted = ScopToDepsMap.insert(std::make_pair(S, std::move(D)));
-  return *Inserted.first->second;
+  return *D;
 }
 
 bool DependenceInfoWrapperPass::runOnFunction(Function &F) {
@@ -1946,6 +1946,13 @@ void ScopBuilder::buildScop(Region &R, AssumptionCache &AC,
       checkForReductions(Stmt);
   }
 
+  if (!scop->chargeIslOperations()) {
+    scop->invalidate(COMPLEXITY, DebugLoc());
+    LLVM_DEBUG(dbgs() << "Bailing-out because the isl operations budget was "
+                         "exhausted (early)\n");
+    return;
+  }
+
   // Check early for a feasible runtime context.
   if (!scop->hasFeasibleRuntimeContext()) {
     LLVM_DEBUG(dbgs() << "Bailing-out because of unfeasible context (early)\n");
@@ -1984,6 +1991,13 @@ void ScopBuilder::buildScop(Region &R, AssumptionCache &AC,
   verifyInvariantLoads();
   scop->simplifySCoP(true);
 
+  if (!scop->chargeIslOperations()) {
+    scop->invalidate(COMPLEXITY, DebugLoc());
+    LLVM_DEBUG(dbgs() << "Bailing-out because the isl operations budget was "
+                         "exhausted (late)\n");
+    return;
+  }
+
   // Check late for a feasible runtime context because profitability did not
   // change.
   if (!scop->hasFeasibleRuntimeContext()) {
@@ -76,6 +76,8 @@ STATISTIC(AssumptionsInbounds, "Number of inbounds assumptions taken.");
 STATISTIC(AssumptionsWrapping, "Number of wrapping assumptions taken.");
 STATISTIC(AssumptionsUnsigned, "Number of unsigned assumptions taken.");
 STATISTIC(AssumptionsComplexity, "Number of too complex SCoPs.");
+STATISTIC(ScopsOverBudget,
+          "Number of SCoPs that exhausted their isl operations budget.");
 STATISTIC(AssumptionsUnprofitable, "Number of unprofitable SCoPs.");
 STATISTIC(AssumptionsErrorBlock, "Number of error block assumptions taken.");
 STATISTIC(AssumptionsInfiniteLoop, "Number of bounded loop assumptions taken.");
@@ -124,6 +126,13 @@ static cl::opt<int>
                   cl::Hidden, cl::init(800000), cl::ZeroOrMore,
                   cl::cat(PollyCategory));
 
+static cl::opt<unsigned long> OptScopMaxOps(
+    "polly-scop-max-operations",
+    cl::desc("Bound the isl operations that the construction, dependence "
+             "analysis and scheduling of a SCoP may perform together. SCoPs "
+             "that exceed it are left unoptimized (0 means no bound)"),
+    cl::Hidden, cl::init(0), cl::ZeroOrMore, cl::cat(PollyCategory));
+
 static cl::opt<bool> PollyRemarksMinimal(
     "polly-remarks-minimal",
     cl::desc("Do not emit remarks about assumptions that are known"),
@@ -3084,13 +3093,20 @@ bool Scop::buildAliasGroups(AliasAnalysis &AA) {
     if (!hasFeasibleRuntimeContext())
       return false;
 
+    if (!chargeIslOperations()) {
+      invalidate(COMPLEXITY, DebugLoc());
+      return false;
+    }
+
     {
-      IslMaxOperationsGuard MaxOpGuard(getIslCtx().get(), OptComputeOut);
+      IslMaxOperationsGuard MaxOpGuard(getIslCtx().get(),
+                                       getMaxIslOperations(OptComputeOut));
       bool Valid = buildAliasGroup(AG, HasWriteAccess);
       if (!Valid)
         return false;
     }
-    if (isl_ctx_last_error(getIslCtx().get()) == isl_error_quota) {
+    if (!chargeIslOperations() ||
+        isl_ctx_last_error(getIslCtx().get()) == isl_error_quota) {
       invalidate(COMPLEXITY, DebugLoc());
       return false;
     }
@@ -3215,8 +3231,8 @@ Scop::Scop(Region &R, ScalarEvolution &ScalarEvolution, LoopInfo &LI,
            DominatorTree &DT, ScopDetection::DetectionContext &DC,
            OptimizationRemarkEmitter &ORE)
     : IslCtx(isl_ctx_alloc(), isl_ctx_free), SE(&ScalarEvolution), DT(&DT),
-      R(R), name(None), HasSingleExitEdge(R.getExitingBlock()), DC(DC),
-      ORE(ORE), Affinator(this, LI),
+      R(R), name(None), HasSingleExitEdge(R.getExitingBlock()),
+      MaxIslOps(OptScopMaxOps), DC(DC), ORE(ORE), Affinator(this, LI),
       ID(getNextID((*R.getEntry()->getParent()).getName().str())) {
   if (IslOnErrorAbort)
     isl_options_set_on_error(getIslCtx().get(), ISL_ON_ERROR_ABORT);
@@ -3225,6 +3241,37 @@ Scop::Scop(Region &R, ScalarEvolution &ScalarEvolution, LoopInfo &LI,
 
 Scop::~Scop() = default;
 
+bool Scop::chargeIslOperations() {
+  if (!MaxIslOps)
+    return true;
+
+  assert(isl_ctx_get_max_operations(getIslCtx().get()) == 0 &&
+         "Cannot charge operations inside of an operations limit");
+  SpentIslOps += isl_ctx_get_operations(getIslCtx().get());
+  isl_ctx_reset_operations(getIslCtx().get());
+  if (SpentIslOps < MaxIslOps)
+    return true;
+
+  if (!SkipScop) {
+    LLVM_DEBUG(dbgs() << getNameStr() << " exhausted its budget of "
+                      << MaxIslOps << " isl operations\n");
+    ScopsOverBudget++;
+    markAsToBeSkipped();
+  }
+  return false;
+}
+
+unsigned long Scop::getMaxIslOperations(unsigned long LocalMaxOps) const {
+  if (!MaxIslOps)
+    return LocalMaxOps;
+
+  // An exhausted budget still has to limit the operations, as a limit of 0
+  // would lift it.
+  unsigned long Remaining =
+      SpentIslOps < MaxIslOps ? MaxIslOps - SpentIslOps : 1;
+  return LocalMaxOps ? std::min(LocalMaxOps, Remaining) : Remaining;
+}
+
 void Scop::foldSizeConstantsToRight() {
   isl::union_set Accessed = getAccesses().range();
 
@@ -34,6 +34,7 @@
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "llvm/Transforms/Utils/ModuleUtils.h"
 #include "isl/union_map.h"
 
 extern "C" {
@@ -304,6 +305,26 @@ static __isl_give isl_id_to_ast_expr *pollyBuildAstExprForStmt(
   return RefToExpr.release();
 }
 
+/// The device and map type flags of the libomptarget interface, see
+/// openmp/libomptarget/include/omptarget.h.
+static const int64_t OffloadDeviceDefault = -1;
+
+enum OffloadMapType : uint64_t {
+  OffloadMapAlloc = 0x000,
+  OffloadMapTo = 0x001,
+  OffloadMapFrom = 0x002,
+  OffloadMapTargetParam = 0x020,
+  OffloadMapLiteral = 0x100,
+};
+
+/// Compute the number of threads in a thread block of @p Kernel.
+static int getNumThreadsPerBlock(ppcg_kernel *Kernel) {
+  int NumThreads = 1;
+  for (int i = 0; i < Kernel->n_block; i++)
+    NumThreads *= Kernel->block_dim[i];
+  return NumThreads;
+}
+
 /// Given a LLVM Type, compute its size in bytes,
 static int computeSizeInBytes(const Type *T) {
   int bytes = T->getPrimitiveSizeInBits() / 8;
@@ -364,6 +385,13 @@ private:
   /// The current GPU context.
   Value *GPUContext;
 
+  /// The kernel argument that holds the first grid dimension.
+  ///
+  /// libomptarget launches kernels on a one dimensional grid, so kernels with
+  /// a two dimensional grid compute their block ids from this argument. It is
+  /// only set while generating such a kernel.
+  Value *KernelGridDimX = nullptr;
+
   /// The set of isl_ids allocated in the kernel
   std::vector<isl_id *> KernelIds;
 
@@ -375,7 +403,7 @@ private:
   /// The GPU program we generate code for.
   gpu_prog *Prog;
 
-  /// The GPU Runtime implementation to use (OpenCL or CUDA).
+  /// The GPU Runtime implementation to use (CUDA, OpenCL or libomptarget).
   GPURuntime Runtime;
 
   /// The GPU Architecture to target.
@@ -568,6 +596,18 @@ private:
   /// @param The kernel to generate the intrinsic functions for.
   void insertKernelIntrinsics(ppcg_kernel *Kernel);
 
+  /// Insert the intrinsics for the block and thread ids of a kernel that is
+  /// launched on a one dimensional grid of one dimensional blocks.
+  ///
+  /// The ids of all dimensions are recovered from the linear ids.
+  ///
+  /// @param Kernel     The kernel to generate the intrinsic functions for.
+  /// @param BlockIntr  The intrinsic that returns the linear block id.
+  /// @param ThreadIntr The intrinsic that returns the linear thread id.
+  void insertLinearizedKernelIntrinsics(ppcg_kernel *Kernel,
+                                        Intrinsic::ID BlockIntr,
+                                        Intrinsic::ID ThreadIntr);
+
   /// Insert function calls to retrieve the SPIR group/local ids.
   ///
   /// @param Kernel The kernel to generate the function calls for.
@@ -734,6 +774,69 @@ private:
                               Value *GridDimY, Value *BlockDimX,
                               Value *BlockDimY, Value *BlockDimZ,
                               Value *Parameters);
+
+  /// An argument of a libomptarget call.
+  struct OffloadArg {
+    /// The base address of the host object.
+    Value *Base;
+
+    /// The host address of the first mapped byte, or the value of a literal.
+    Value *Begin;
+
+    /// The number of mapped bytes.
+    Value *Size;
+
+    /// The OffloadMapType flags of the argument.
+    uint64_t Type;
+  };
+
+  /// Describe the part of an array that is used on the device.
+  ///
+  /// @param Array The array to describe.
+  /// @param Type  The OffloadMapType flags to pass.
+  OffloadArg getOffloadArrayArg(gpu_array_info *Array, uint64_t Type);
+
+  /// Describe a kernel argument that is passed by value.
+  ///
+  /// @param Val The value to pass, of at most 64 bits.
+  OffloadArg getOffloadLiteralArg(Value *Val);
+
+  /// Store arguments into the four argument arrays of a libomptarget call.
+  ///
+  /// @param Args   The arguments to store.
+  /// @param Prefix The prefix of the names of the arrays.
+  ///
+  /// @returns Pointers to the base, begin, size and map type arrays.
+  std::tuple<Value *, Value *, Value *, Value *>
+  createOffloadArgArrays(ArrayRef<OffloadArg> Args, const std::string &Prefix);
+
+  /// Create a call to one of the __tgt_target_data_* functions.
+  ///
+  /// @param Name The function to call, which maps, updates or unmaps @p Args
+  ///             on the default device.
+  /// @param Args The arrays to work on.
+  void createCallTargetData(const char *Name, ArrayRef<OffloadArg> Args);
+
+  /// Create the offload entry and the device image of a kernel, and a
+  /// constructor that registers them with libomptarget.
+  ///
+  /// @param Name     The name of the kernel function.
+  /// @param Assembly The PTX code of the kernel.
+  ///
+  /// @returns The host address that identifies the kernel to libomptarget.
+  Constant *createOffloadEntry(const std::string &Name,
+                               const std::string &Assembly);
+
+  /// Create a call to launch a kernel through __tgt_target_teams.
+  ///
+  /// @param Kernel        The kernel to launch.
+  /// @param RegionId      The host address that identifies the kernel.
+  /// @param SubtreeValues The host values the kernel uses.
+  /// @param GridDimX      The size of the first grid dimension.
+  /// @param GridDimY      The size of the second grid dimension.
+  void createCallTargetTeams(ppcg_kernel *Kernel, Constant *RegionId,
+                             SetVector<Value *> &SubtreeValues,
+                             Value *GridDimX, Value *GridDimY);
 };
 
 std::string GPUNodeBuilder::getKernelFuncName(int Kernel_id) {
@@ -747,6 +850,16 @@ void GPUNodeBuilder::initializeAfterRTH() {
   NewBB->setName("polly.acc.initialize");
   Builder.SetInsertPoint(&NewBB->front());
 
+  // libomptarget keeps its own device context, and reuses the device copies
+  // of arrays that are already mapped by enclosing OpenMP data regions.
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    SmallVector<OffloadArg, 8> Args;
+    for (int i = 0; i < Prog->n_array; ++i)
+      Args.push_back(getOffloadArrayArg(&Prog->array[i], OffloadMapAlloc));
+    createCallTargetData("__tgt_target_data_begin", Args);
+    return;
+  }
+
   GPUContext = createCallInitContext();
 
   if (!PollyManagedMemory)
@@ -756,6 +869,15 @@ void GPUNodeBuilder::initializeAfterRTH() {
 }
 
 void GPUNodeBuilder::finalize() {
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    SmallVector<OffloadArg, 8> Args;
+    for (int i = 0; i < Prog->n_array; ++i)
+      Args.push_back(getOffloadArrayArg(&Prog->array[i], OffloadMapAlloc));
+    createCallTargetData("__tgt_target_data_end", Args);
+    IslNodeBuilder::finalize();
+    return;
+  }
+
   if (!PollyManagedMemory)
     freeDeviceArrays();
 
@@ -918,6 +1040,372 @@ void GPUNodeBuilder::createCallLaunchKernel(Value *GPUKernel, Value *GridDimX,
                          BlockDimZ, Parameters});
 }
 
+GPUNodeBuilder::OffloadArg
+GPUNodeBuilder::getOffloadArrayArg(gpu_array_info *Array, uint64_t Type) {
+  auto ScopArray = (ScopArrayInfo *)(Array->user);
+
+  Value *Size = getArraySize(Array);
+  Value *Offset = getArrayOffset(Array);
+
+  Value *HostPtr;
+
+  if (gpu_array_is_scalar(Array))
+    HostPtr = BlockGen.getOrCreateAlloca(ScopArray);
+  else
+    HostPtr = ScopArray->getBasePtr();
+  HostPtr = getLatestValue(HostPtr);
+
+  Value *Base = Builder.CreatePointerCast(HostPtr, Builder.getInt8PtrTy());
+  Value *Begin = Base;
+
+  // libomptarget translates the base address of a kernel argument to the
+  // device, so that the kernel can keep indexing the array from its start
+  // even if only a part of it is mapped.
+  if (Offset) {
+    Begin = Builder.CreatePointerCast(
+        HostPtr, ScopArray->getElementType()->getPointerTo());
+    Begin = Builder.CreateGEP(Begin, Offset);
+    Begin = Builder.CreatePointerCast(Begin, Builder.getInt8PtrTy());
+    Size = Builder.CreateSub(
+        Size, Builder.CreateMul(
+                  Offset, Builder.getInt64(ScopArray->getElemSizeInBytes())));
+  }
+
+  return {Base, Begin, Size, Type};
+}
+
+GPUNodeBuilder::OffloadArg GPUNodeBuilder::getOffloadLiteralArg(Value *Val) {
+  Type *Ty = Val->getType();
+  uint64_t Size = DL.getTypeAllocSize(Ty);
+
+  if (Size > 8 || !(Ty->isIntegerTy() || Ty->isFloatingPointTy() ||
+                    Ty->isPointerTy())) {
+    LLVM_DEBUG(dbgs() << "Cannot pass a value of type " << *Ty
+                      << " to a libomptarget kernel\n");
+    BuildSuccessful = false;
+    Val = Builder.getInt64(0);
+  } else if (Ty->isPointerTy()) {
+    Val = Builder.CreatePtrToInt(Val, Builder.getInt64Ty());
+  } else {
+    if (Ty->isFloatingPointTy())
+      Val = Builder.CreateBitCast(
+          Val, Builder.getIntNTy(Ty->getPrimitiveSizeInBits()));
+    Val = Builder.CreateZExtOrTrunc(Val, Builder.getInt64Ty());
+  }
+
+  Val = Builder.CreateIntToPtr(Val, Builder.getInt8PtrTy());
+  return {Val, Val, Builder.getInt64(Size),
+          OffloadMapLiteral | OffloadMapTargetParam};
+}
+
+std::tuple<Value *, Value *, Value *, Value *>
+GPUNodeBuilder::createOffloadArgArrays(ArrayRef<OffloadArg> Args,
+                                       const std::string &Prefix) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  BasicBlock *EntryBlock =
+      &Builder.GetInsertBlock()->getParent()->getEntryBlock();
+  auto AddressSpace = M->getDataLayout().getAllocaAddrSpace();
+
+  Type *PtrArrayTy = ArrayType::get(Builder.getInt8PtrTy(), Args.size());
+  Type *SizeArrayTy = ArrayType::get(Builder.getInt64Ty(), Args.size());
+  Instruction *Bases =
+      new AllocaInst(PtrArrayTy, AddressSpace, Prefix + "_baseptrs",
+                     EntryBlock->getTerminator());
+  Instruction *Begins = new AllocaInst(PtrArrayTy, AddressSpace,
+                                       Prefix + "_ptrs",
+                                       EntryBlock->getTerminator());
+  Instruction *Sizes = new AllocaInst(SizeArrayTy, AddressSpace,
+                                      Prefix + "_sizes",
+                                      EntryBlock->getTerminator());
+
+  std::vector<uint64_t> Types;
+  for (unsigned i = 0; i < Args.size(); i++) {
+    Value *Idx[] = {Builder.getInt64(0), Builder.getInt64(i)};
+    Builder.CreateStore(Args[i].Base, Builder.CreateGEP(Bases, Idx));
+    Builder.CreateStore(Args[i].Begin, Builder.CreateGEP(Begins, Idx));
+    Builder.CreateStore(Args[i].Size, Builder.CreateGEP(Sizes, Idx));
+    Types.push_back(Args[i].Type);
+  }
+
+  Constant *TypesInit = ConstantDataArray::get(M->getContext(), Types);
+  auto *MapTypes = new GlobalVariable(*M, TypesInit->getType(), true,
+                                      GlobalValue::PrivateLinkage, TypesInit,
+                                      Prefix + "_maptypes");
+  MapTypes->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+
+  Value *Zero[] = {Builder.getInt64(0), Builder.getInt64(0)};
+  return std::make_tuple(Builder.CreateGEP(Bases, Zero),
+                         Builder.CreateGEP(Begins, Zero),
+                         Builder.CreateGEP(Sizes, Zero),
+                         ConstantExpr::getInBoundsGetElementPtr(
+                             TypesInit->getType(), MapTypes, Zero));
+}
+
+void GPUNodeBuilder::createCallTargetData(const char *Name,
+                                          ArrayRef<OffloadArg> Args) {
+  if (Args.empty())
+    return;
+
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+    std::vector<Type *> Params;
+    Params.push_back(Builder.getInt64Ty());
+    Params.push_back(Builder.getInt32Ty());
+    Params.push_back(Builder.getInt8PtrTy()->getPointerTo());
+    Params.push_back(Builder.getInt8PtrTy()->getPointerTo());
+    Params.push_back(Builder.getInt64Ty()->getPointerTo());
+    Params.push_back(Builder.getInt64Ty()->getPointerTo());
+    FunctionType *Ty = FunctionType::get(Builder.getVoidTy(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Bases, *Begins, *Sizes, *Types;
+  std::tie(Bases, Begins, Sizes, Types) =
+      createOffloadArgArrays(Args, std::string("polly_") + Name);
+
+  Builder.CreateCall(F, {Builder.getInt64(OffloadDeviceDefault),
+                         Builder.getInt32(Args.size()), Bases, Begins, Sizes,
+                         Types});
+}
+
+Constant *GPUNodeBuilder::createOffloadEntry(const std::string &Name,
+                                             const std::string &Assembly) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  LLVMContext &Ctx = M->getContext();
+  Type *Int8PtrTy = Builder.getInt8PtrTy();
+  Type *Int32Ty = Builder.getInt32Ty();
+
+  // The address of this variable identifies the kernel in calls to
+  // __tgt_target_teams. libomptarget looks up the device function by the name
+  // of the offload entry.
+  auto *RegionId = new GlobalVariable(
+      *M, Builder.getInt8Ty(), true, GlobalValue::InternalLinkage,
+      Builder.getInt8(0), Name + ".region_id");
+
+  Constant *EntryName = ConstantDataArray::getString(Ctx, Name);
+  auto *EntryNameVar =
+      new GlobalVariable(*M, EntryName->getType(), true,
+                         GlobalValue::PrivateLinkage, EntryName,
+                         Name + ".entry_name");
+  EntryNameVar->setUnnamedAddr(GlobalValue::UnnamedAddr::Global);
+
+  // struct __tgt_offload_entry { void *addr; char *name; size_t size;
+  //                              int32_t flags; int32_t reserved; };
+  StructType *EntryTy = StructType::get(Int8PtrTy, Int8PtrTy,
+                                        Builder.getInt64Ty(), Int32Ty, Int32Ty);
+  Constant *Entry = ConstantStruct::get(
+      EntryTy, {ConstantExpr::getBitCast(RegionId, Int8PtrTy),
+                ConstantExpr::getBitCast(EntryNameVar, Int8PtrTy),
+                Builder.getInt64(0), Builder.getInt32(0),
+                Builder.getInt32(0)});
+  ArrayType *EntriesTy = ArrayType::get(EntryTy, 1);
+  auto *Entries = new GlobalVariable(
+      *M, EntriesTy, true, GlobalValue::InternalLinkage,
+      ConstantArray::get(EntriesTy, Entry), Name + ".offload_entries");
+
+  // The CUDA plugin loads the PTX code of the image with the CUDA driver,
+  // which expects it to be NUL-terminated.
+  Constant *Image = ConstantDataArray::getString(Ctx, Assembly, true);
+  auto *ImageVar = new GlobalVariable(*M, Image->getType(), true,
+                                      GlobalValue::InternalLinkage, Image,
+                                      Name + ".device_image");
+
+  Constant *EntriesBegin = ConstantExpr::getInBoundsGetElementPtr(
+      EntriesTy, Entries,
+      ArrayRef<Constant *>({Builder.getInt32(0), Builder.getInt32(0)}));
+  Constant *EntriesEnd = ConstantExpr::getInBoundsGetElementPtr(
+      EntriesTy, Entries,
+      ArrayRef<Constant *>({Builder.getInt32(0), Builder.getInt32(1)}));
+  Constant *ImageBegin = ConstantExpr::getInBoundsGetElementPtr(
+      Image->getType(), ImageVar,
+      ArrayRef<Constant *>({Builder.getInt32(0), Builder.getInt32(0)}));
+  Constant *ImageEnd = ConstantExpr::getInBoundsGetElementPtr(
+      Image->getType(), ImageVar,
+      ArrayRef<Constant *>(
+          {Builder.getInt32(0), Builder.getInt32(Assembly.size() + 1)}));
+
+  // struct __tgt_device_image { void *ImageStart; void *ImageEnd;
+  //                             __tgt_offload_entry *EntriesBegin;
+  //                             __tgt_offload_entry *EntriesEnd; };
+  Type *EntryPtrTy = EntryTy->getPointerTo();
+  StructType *DeviceImageTy =
+      StructType::get(Int8PtrTy, Int8PtrTy, EntryPtrTy, EntryPtrTy);
+  ArrayType *DeviceImagesTy = ArrayType::get(DeviceImageTy, 1);
+  auto *DeviceImages = new GlobalVariable(
+      *M, DeviceImagesTy, true, GlobalValue::InternalLinkage,
+      ConstantArray::get(
+          DeviceImagesTy,
+          ConstantStruct::get(DeviceImageTy, {ImageBegin, ImageEnd,
+                                              EntriesBegin, EntriesEnd})),
+      Name + ".device_images");
+
+  // struct __tgt_bin_desc { int32_t NumDeviceImages;
+  //                         __tgt_device_image *DeviceImages;
+  //                         __tgt_offload_entry *HostEntriesBegin;
+  //                         __tgt_offload_entry *HostEntriesEnd; };
+  StructType *BinDescTy = StructType::get(
+      Int32Ty, DeviceImageTy->getPointerTo(), EntryPtrTy, EntryPtrTy);
+  auto *BinDesc = new GlobalVariable(
+      *M, BinDescTy, true, GlobalValue::InternalLinkage,
+      ConstantStruct::get(
+          BinDescTy,
+          {Builder.getInt32(1),
+           ConstantExpr::getInBoundsGetElementPtr(
+               DeviceImagesTy, DeviceImages,
+               ArrayRef<Constant *>(
+                   {Builder.getInt32(0), Builder.getInt32(0)})),
+           EntriesBegin, EntriesEnd}),
+      Name + ".bin_desc");
+
+  auto getRuntimeFunction = [M](const char *FnName, Type *RetTy,
+                                ArrayRef<Type *> Params) {
+    Function *F = M->getFunction(FnName);
+    if (!F)
+      F = Function::Create(FunctionType::get(RetTy, Params, false),
+                           Function::ExternalLinkage, FnName, M);
+    return F;
+  };
+
+  Type *VoidTy = Builder.getVoidTy();
+  Type *BinDescPtrTy = Int8PtrTy;
+  Function *RegisterLib =
+      getRuntimeFunction("__tgt_register_lib", VoidTy, BinDescPtrTy);
+  Function *UnregisterLib =
+      getRuntimeFunction("__tgt_unregister_lib", VoidTy, BinDescPtrTy);
+  Function *AtExit = getRuntimeFunction(
+      "atexit", Int32Ty,
+      FunctionType::get(VoidTy, false)->getPointerTo());
+
+  auto castArg = [](Function *F, unsigned Idx, Constant *C) {
+    return ConstantExpr::getPointerCast(
+        C, F->getFunctionType()->getParamType(Idx));
+  };
+
+  FunctionType *VoidFnTy = FunctionType::get(VoidTy, false);
+  Function *Unregister = Function::Create(
+      VoidFnTy, Function::InternalLinkage, Name + ".unregister", M);
+  IRBuilder<> UnregisterBuilder(BasicBlock::Create(Ctx, "entry", Unregister));
+  UnregisterBuilder.CreateCall(UnregisterLib,
+                               {castArg(UnregisterLib, 0, BinDesc)});
+  UnregisterBuilder.CreateRetVoid();
+
+  Function *Register = Function::Create(VoidFnTy, Function::InternalLinkage,
+                                        Name + ".register", M);
+  IRBuilder<> RegisterBuilder(BasicBlock::Create(Ctx, "entry", Register));
+  RegisterBuilder.CreateCall(RegisterLib, {castArg(RegisterLib, 0, BinDesc)});
+  RegisterBuilder.CreateCall(AtExit, {castArg(AtExit, 0, Unregister)});
+  RegisterBuilder.CreateRetVoid();
+
+  appendToGlobalCtors(*M, Register, 0);
+
+  return ConstantExpr::getBitCast(RegionId, Int8PtrTy);
+}
+
+void GPUNodeBuilder::createCallTargetTeams(ppcg_kernel *Kernel,
+                                           Constant *RegionId,
+                                           SetVector<Value *> &SubtreeValues,
+                                           Value *GridDimX, Value *GridDimY) {
+  SmallVector<OffloadArg, 16> Args;
+
+  // The arguments follow the order of the parameters of the kernel function,
+  // see createKernelFunctionDecl.
+  for (long i = 0; i < Prog->n_array; i++) {
+    if (!ppcg_kernel_requires_array_argument(Kernel, i))
+      continue;
+
+    if (gpu_array_is_read_only_scalar(&Prog->array[i])) {
+      isl_id *Id = isl_space_get_tuple_id(Prog->array[i].space, isl_dim_set);
+      const ScopArrayInfo *SAI = ScopArrayInfo::getFromId(isl::manage(Id));
+      Value *ValPtr = BlockGen.getOrCreateAlloca(SAI);
+      Args.push_back(getOffloadLiteralArg(Builder.CreateLoad(ValPtr)));
+    } else {
+      Args.push_back(getOffloadArrayArg(&Prog->array[i],
+                                        OffloadMapTargetParam));
+    }
+  }
+
+  int NumHostIters = isl_space_dim(Kernel->space, isl_dim_set);
+
+  for (long i = 0; i < NumHostIters; i++) {
+    isl_id *Id = isl_space_get_dim_id(Kernel->space, isl_dim_set, i);
+    Value *Val = IDToValue[Id];
+    isl_id_free(Id);
+    Args.push_back(getOffloadLiteralArg(Val));
+  }
+
+  int NumVars = isl_space_dim(Kernel->space, isl_dim_param);
+
+  for (long i = 0; i < NumVars; i++) {
+    isl_id *Id = isl_space_get_dim_id(Kernel->space, isl_dim_param, i);
+    Value *Val = IDToValue[Id];
+    if (ValueMap.count(Val))
+      Val = ValueMap[Val];
+    isl_id_free(Id);
+    Args.push_back(getOffloadLiteralArg(Val));
+  }
+
+  for (auto Val : SubtreeValues)
+    Args.push_back(getOffloadLiteralArg(Val));
+
+  if (Kernel->n_grid > 1)
+    Args.push_back(getOffloadLiteralArg(GridDimX));
+
+  if (!BuildSuccessful)
+    return;
+
+  const char *Name = "__tgt_target_teams";
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+  Function *F = M->getFunction(Name);
+
+  // If F is not available, declare it.
+  if (!F) {
+    GlobalValue::LinkageTypes Linkage = Function::ExternalLinkage;
+    std::vector<Type *> Params;
+    Params.push_back(Builder.getInt64Ty());
+    Params.push_back(Builder.getInt8PtrTy());
+    Params.push_back(Builder.getInt32Ty());
+    Params.push_back(Builder.getInt8PtrTy()->getPointerTo());
+    Params.push_back(Builder.getInt8PtrTy()->getPointerTo());
+    Params.push_back(Builder.getInt64Ty()->getPointerTo());
+    Params.push_back(Builder.getInt64Ty()->getPointerTo());
+    Params.push_back(Builder.getInt32Ty());
+    Params.push_back(Builder.getInt32Ty());
+    FunctionType *Ty = FunctionType::get(Builder.getInt32Ty(), Params, false);
+    F = Function::Create(Ty, Linkage, Name, M);
+  }
+
+  Value *Bases, *Begins, *Sizes, *Types;
+  std::tie(Bases, Begins, Sizes, Types) = createOffloadArgArrays(
+      Args, "polly_launch_" + std::to_string(Kernel->id));
+
+  // libomptarget launches a one dimensional grid of teams whose threads are
+  // laid out along the first dimension. The kernel recovers the block and
+  // thread ids from the linear ones, see insertKernelIntrinsics.
+  Value *NumTeams = Builder.CreateMul(GridDimX, GridDimY);
+  Value *ThreadLimit = Builder.getInt32(getNumThreadsPerBlock(Kernel));
+
+  // An empty grid would make libomptarget fall back to its default number of
+  // teams, so skip the launch in that case.
+  Instruction *LaunchTerm = SplitBlockAndInsertIfThen(
+      Builder.CreateICmpSGT(NumTeams, Builder.getInt32(0)),
+      &*Builder.GetInsertPoint(), false, nullptr, &DT, &LI);
+  LaunchTerm->getParent()->setName("polly.launch_" +
+                                   std::to_string(Kernel->id));
+  Builder.SetInsertPoint(LaunchTerm);
+
+  // A failing launch makes libomptarget fall back to the host version of the
+  // region, which Polly does not provide, so the return code is not checked.
+  Builder.CreateCall(F, {Builder.getInt64(OffloadDeviceDefault), RegionId,
+                         Builder.getInt32(Args.size()), Bases, Begins, Sizes,
+                         Types, NumTeams, ThreadLimit});
+
+  Builder.SetInsertPoint(&*LaunchTerm->getSuccessor(0)->begin());
+}
+
 void GPUNodeBuilder::createCallFreeKernel(Value *GPUKernel) {
   const char *Name = "polly_freeKernel";
   Module *M = Builder.GetInsertBlock()->getParent()->getParent();
@@ -1050,6 +1538,8 @@ Value *GPUNodeBuilder::createCallInitContext() {
   case GPURuntime::OpenCL:
     Name = "polly_initContextCL";
     break;
+  case GPURuntime::LibOMPTarget:
+    llvm_unreachable("libomptarget manages its own device context");
   }
 
   Module *M = Builder.GetInsertBlock()->getParent()->getParent();
@@ -1170,6 +1660,18 @@ void GPUNodeBuilder::createDataTransfer(__isl_take isl_ast_node *TransferStmt,
   auto Array = (gpu_array_info *)isl_id_get_user(Id);
   auto ScopArray = (ScopArrayInfo *)(Array->user);
 
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    OffloadArg Transfer = getOffloadArrayArg(
+        Array, Direction == HOST_TO_DEVICE ? OffloadMapTo : OffloadMapFrom);
+    createCallTargetData("__tgt_target_data_update", Transfer);
+
+    isl_id_free(Id);
+    isl_ast_expr_free(Arg);
+    isl_ast_expr_free(Expr);
+    isl_ast_node_free(TransferStmt);
+    return;
+  }
+
   Value *Size = getArraySize(Array);
   Value *Offset = getArrayOffset(Array);
   Value *DevPtr = DeviceAllocations[ScopArray];
@@ -1828,7 +2330,11 @@ void GPUNodeBuilder::createKernel(__isl_take isl_ast_node *KernelStmt) {
 
   finalizeKernelArguments(Kernel);
   Function *F = Builder.GetInsertBlock()->getParent();
-  if (Arch == GPUArch::NVPTX64)
+  if (Runtime == GPURuntime::LibOMPTarget)
+    addCUDAAnnotations(F->getParent(),
+                       Builder.getInt32(getNumThreadsPerBlock(Kernel)),
+                       Builder.getInt32(1), Builder.getInt32(1));
+  else if (Arch == GPUArch::NVPTX64)
     addCUDAAnnotations(F->getParent(), BlockDimX, BlockDimY, BlockDimZ);
   clearDominators(F);
   clearScalarEvolution(F);
@@ -1847,6 +2353,25 @@ void GPUNodeBuilder::createKernel(__isl_take isl_ast_node *KernelStmt) {
 
   std::string ASMString = finalizeKernelFunction();
   Builder.SetInsertPoint(&HostInsertPoint);
+
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    KernelGridDimX = nullptr;
+    if (BuildSuccessful) {
+      Value *GridDimX, *GridDimY;
+      std::tie(GridDimX, GridDimY) = getGridSizes(Kernel);
+      Constant *RegionId =
+          createOffloadEntry(getKernelFuncName(Kernel->id), ASMString);
+      createCallTargetTeams(Kernel, RegionId, SubtreeValues, GridDimX,
+                            GridDimY);
+    }
+
+    for (auto Id : KernelIds)
+      isl_id_free(Id);
+
+    KernelIds.clear();
+    return;
+  }
+
   Value *Parameters = createLaunchParameters(Kernel, F, SubtreeValues);
 
   std::string Name = getKernelFuncName(Kernel->id);
@@ -1958,6 +2483,11 @@ GPUNodeBuilder::createKernelFunctionDecl(ppcg_kernel *Kernel,
         ConstantAsMetadata::get(ConstantInt::get(Builder.getInt32Ty(), 0)));
   }
 
+  bool PassGridDimX =
+      Runtime == GPURuntime::LibOMPTarget && Kernel->n_grid > 1;
+  if (PassGridDimX)
+    Args.push_back(Builder.getInt32Ty());
+
   auto *FT = FunctionType::get(Builder.getVoidTy(), Args, false);
   auto *FN = Function::Create(FT, Function::ExternalLinkage, Identifier,
                               GPUModule.get());
@@ -2048,6 +2578,23 @@ GPUNodeBuilder::createKernelFunctionDecl(ppcg_kernel *Kernel,
     Arg++;
   }
 
+  if (PassGridDimX) {
+    Arg->setName("polly.grid.dim.x");
+    KernelGridDimX = &*Arg;
+    Arg++;
+  }
+
+  // The CUDA plugin of libomptarget runs kernels without an execution mode
+  // in generic mode, which starts an additional warp for the master thread of
+  // an OpenMP target region. Polly kernels use all threads of a block.
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    static const int OffloadExecModeSPMD = 0;
+    new GlobalVariable(*GPUModule, Builder.getInt8Ty(), true,
+                       GlobalValue::ExternalLinkage,
+                       Builder.getInt8(OffloadExecModeSPMD),
+                       Identifier + "_exec_mode");
+  }
+
   return FN;
 }
 
@@ -2079,6 +2626,12 @@ void GPUNodeBuilder::insertKernelIntrinsics(ppcg_kernel *Kernel) {
     KernelIDs.insert(std::unique_ptr<isl_id, IslIdDeleter>(Id));
   };
 
+  if (Runtime == GPURuntime::LibOMPTarget) {
+    insertLinearizedKernelIntrinsics(Kernel, IntrinsicsBID[0],
+                                     IntrinsicsTID[0]);
+    return;
+  }
+
   for (int i = 0; i < Kernel->n_grid; ++i) {
     isl_id *Id = isl_id_list_get_id(Kernel->block_ids, i);
     addId(Id, IntrinsicsBID[i]);
@@ -2090,6 +2643,46 @@ void GPUNodeBuilder::insertKernelIntrinsics(ppcg_kernel *Kernel) {
   }
 }
 
+void GPUNodeBuilder::insertLinearizedKernelIntrinsics(ppcg_kernel *Kernel,
+                                                      Intrinsic::ID BlockIntr,
+                                                      Intrinsic::ID ThreadIntr) {
+  Module *M = Builder.GetInsertBlock()->getParent()->getParent();
+
+  auto setId = [this](__isl_take isl_id *Id, Value *Val) mutable {
+    Val->setName(isl_id_get_name(Id));
+    IDToValue[Id] = Val;
+    KernelIDs.insert(std::unique_ptr<isl_id, IslIdDeleter>(Id));
+  };
+
+  Value *BlockId = Builder.CreateCall(Intrinsic::getDeclaration(M, BlockIntr));
+  BlockId = Builder.CreateZExt(BlockId, Builder.getInt64Ty());
+
+  if (Kernel->n_grid > 1) {
+    assert(KernelGridDimX && "Kernel lacks the size of its grid");
+    Value *GridDimX = Builder.CreateZExt(KernelGridDimX, Builder.getInt64Ty());
+    setId(isl_id_list_get_id(Kernel->block_ids, 0),
+          Builder.CreateURem(BlockId, GridDimX));
+    setId(isl_id_list_get_id(Kernel->block_ids, 1),
+          Builder.CreateUDiv(BlockId, GridDimX));
+  } else if (Kernel->n_grid > 0) {
+    setId(isl_id_list_get_id(Kernel->block_ids, 0), BlockId);
+  }
+
+  Value *ThreadId =
+      Builder.CreateCall(Intrinsic::getDeclaration(M, ThreadIntr));
+  ThreadId = Builder.CreateZExt(ThreadId, Builder.getInt64Ty());
+
+  // The block sizes are constants, so dividing by them is cheap.
+  for (int i = 0; i < Kernel->n_block; ++i) {
+    Value *Id = ThreadId;
+    if (i + 1 < Kernel->n_block)
+      Id = Builder.CreateURem(Id, Builder.getInt64(Kernel->block_dim[i]));
+    setId(isl_id_list_get_id(Kernel->thread_ids, i), Id);
+    ThreadId =
+        Builder.CreateUDiv(ThreadId, Builder.getInt64(Kernel->block_dim[i]));
+  }
+}
+
 void GPUNodeBuilder::insertKernelCallsSPIR(ppcg_kernel *Kernel,
                                            bool SizeTypeIs64bit) {
   const char *GroupName[3] = {"__gen_ocl_get_group_id0",
@@ -2268,10 +2861,10 @@ void GPUNodeBuilder::createKernelFunction(
 
   switch (Arch) {
   case GPUArch::NVPTX64:
-    if (Runtime == GPURuntime::CUDA)
-      GPUModule->setTargetTriple(Triple::normalize("nvptx64-nvidia-cuda"));
-    else if (Runtime == GPURuntime::OpenCL)
+    if (Runtime == GPURuntime::OpenCL)
       GPUModule->setTargetTriple(Triple::normalize("nvptx64-nvidia-nvcl"));
+    else
+      GPUModule->setTargetTriple(Triple::normalize("nvptx64-nvidia-cuda"));
     GPUModule->setDataLayout(computeNVPTXDataLayout(true /* is64Bit */));
     break;
   case GPUArch::SPIR32:
@@ -2320,6 +2913,7 @@ std::string GPUNodeBuilder::createKernelASM() {
   case GPUArch::NVPTX64:
     switch (Runtime) {
     case GPURuntime::CUDA:
+    case GPURuntime::LibOMPTarget:
       GPUTriple = llvm::Triple(Triple::normalize("nvptx64-nvidia-cuda"));
       break;
     case GPURuntime::OpenCL:
@@ -3552,6 +4146,16 @@ public:
     LLVM_DEBUG(dbgs() << "PPCGCodeGen running on : " << getUniqueScopName(S)
                       << " | loop depth: " << S->getMaxLoopDepth() << "\n");
 
+    // libomptarget loads the kernels with its CUDA plugin and maps the arrays
+    // into its own device data environment.
+    if (Runtime == GPURuntime::LibOMPTarget &&
+        (Architecture != GPUArch::NVPTX64 || PollyManagedMemory)) {
+      LLVM_DEBUG(dbgs() << getUniqueScopName(S)
+                        << " needs NVPTX64 kernels and unmanaged memory to be "
+                           "offloaded through libomptarget. Bailing out.\n");
+      return false;
+    }
+
     // We currently do not support functions other than intrinsics inside
     // kernels, as code generation will need to offload function calls to the
     // kernel. This may lead to a kernel trying to call a function on the host.
@@ -371,6 +371,14 @@ unsigned long isl_ctx_get_max_operations(isl_ctx *ctx)
 	return ctx ? ctx->max_operations : 0;
 }
 
+/* Return the number of operations performed by "ctx"
+ * since the last reset.
+ */
+unsigned long isl_ctx_get_operations(isl_ctx *ctx)
+{
+	return ctx ? ctx->operations : 0;
+}
+
 /* Reset the number of operations performed by "ctx".
  */
 void isl_ctx_reset_operations(isl_ctx *ctx)
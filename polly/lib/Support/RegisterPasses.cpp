@@ -111,7 +111,9 @@ static cl::opt<GPURuntime> GPURuntimeChoice(
     cl::values(clEnumValN(GPURuntime::CUDA, "libcudart",
                           "use the CUDA Runtime API"),
                clEnumValN(GPURuntime::OpenCL, "libopencl",
-                          "use the OpenCL Runtime API")),
+                          "use the OpenCL Runtime API"),
+               clEnumValN(GPURuntime::LibOMPTarget, "libomptarget",
+                          "use the OpenMP offloading runtime (libomptarget)")),
     cl::init(GPURuntime::CUDA), cl::ZeroOrMore, cl::cat(PollyCategory));
 
 static cl::opt<GPUArch>
@@ -0,0 +1,261 @@
+// -*- C++ -*-
+//===-- algorithm_impl.h --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_ALGORITHM_IMPL_H
+#define _PSTL_ALGORITHM_IMPL_H
+
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <type_traits>
+
+#include "execution_impl.h"
+#include "parallel_backend.h"
+#include "unseq_backend_simd.h"
+#include "utils.h"
+
+// A brick processes a range on the calling thread, with a vectorized loop if
+// its last argument is std::true_type. A pattern runs the bricks on the
+// subranges that the parallel backend hands out if its last argument is
+// std::true_type. The bricks are noexcept, so that an element access function
+// that exits via an exception calls std::terminate.
+
+namespace __pstl
+{
+namespace __internal
+{
+
+//------------------------------------------------------------------------
+// any_of, all_of, none_of, find, find_if
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator, class _Predicate, class _IsVector>
+_ForwardIterator
+__brick_find_if(_ForwardIterator __first, _ForwardIterator __last, _Predicate __pred, _IsVector) noexcept
+{
+    return std::find_if(__first, __last, __pred);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Predicate, class _IsVector>
+_ForwardIterator
+__pattern_find_if(_ExecutionPolicy&&, _ForwardIterator __first, _ForwardIterator __last, _Predicate __pred,
+                  _IsVector __is_vector,
+                  /*is_parallel=*/std::false_type) noexcept
+{
+    return __brick_find_if(__first, __last, __pred, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Predicate, class _IsVector>
+_ForwardIterator
+__pattern_find_if(_ExecutionPolicy&& __exec, _ForwardIterator __first, _ForwardIterator __last, _Predicate __pred,
+                  _IsVector __is_vector,
+                  /*is_parallel=*/std::true_type)
+{
+    typedef typename std::iterator_traits<_ForwardIterator>::difference_type _DifferenceType;
+
+    // The position of the first match found so far. Subranges that start
+    // after it are not searched.
+    std::atomic<_DifferenceType> __extremum(__last - __first);
+    __par_backend::__parallel_for(
+        std::forward<_ExecutionPolicy>(__exec), __first, __last,
+        [__first, __pred, __is_vector, &__extremum](_ForwardIterator __i, _ForwardIterator __j) {
+            if (__i - __first >= __extremum.load(std::memory_order_relaxed))
+                return;
+            _ForwardIterator __res = __brick_find_if(__i, __j, __pred, __is_vector);
+            if (__res == __j)
+                return;
+            const _DifferenceType __k = __res - __first;
+            _DifferenceType __old = __extremum.load(std::memory_order_relaxed);
+            while (__k < __old && !__extremum.compare_exchange_weak(__old, __k, std::memory_order_relaxed))
+            {
+            }
+        });
+    return __first + __extremum.load(std::memory_order_relaxed);
+}
+
+//------------------------------------------------------------------------
+// for_each, fill, generate
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator, class _Function>
+void
+__brick_walk1(_ForwardIterator __first, _ForwardIterator __last, _Function __f,
+              /*vector=*/std::false_type) noexcept
+{
+    std::for_each(__first, __last, __f);
+}
+
+template <class _RandomAccessIterator, class _Function>
+void
+__brick_walk1(_RandomAccessIterator __first, _RandomAccessIterator __last, _Function __f,
+              /*vector=*/std::true_type) noexcept
+{
+    __unseq_backend::__simd_walk_1(__first, __last - __first, __f);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Function, class _IsVector>
+void
+__pattern_walk1(_ExecutionPolicy&&, _ForwardIterator __first, _ForwardIterator __last, _Function __f,
+                _IsVector __is_vector,
+                /*parallel=*/std::false_type) noexcept
+{
+    __brick_walk1(__first, __last, __f, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Function, class _IsVector>
+void
+__pattern_walk1(_ExecutionPolicy&& __exec, _ForwardIterator __first, _ForwardIterator __last, _Function __f,
+                _IsVector __is_vector,
+                /*parallel=*/std::true_type)
+{
+    __par_backend::__parallel_for(std::forward<_ExecutionPolicy>(__exec), __first, __last,
+                                  [__f, __is_vector](_ForwardIterator __i, _ForwardIterator __j) {
+                                      __brick_walk1(__i, __j, __f, __is_vector);
+                                  });
+}
+
+//------------------------------------------------------------------------
+// copy, transform
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator1, class _ForwardIterator2, class _Function>
+_ForwardIterator2
+__brick_walk2(_ForwardIterator1 __first1, _ForwardIterator1 __last1, _ForwardIterator2 __first2, _Function __f,
+              /*vector=*/std::false_type) noexcept
+{
+    for (; __first1 != __last1; ++__first1, ++__first2)
+        __f(*__first1, *__first2);
+    return __first2;
+}
+
+template <class _RandomAccessIterator1, class _RandomAccessIterator2, class _Function>
+_RandomAccessIterator2
+__brick_walk2(_RandomAccessIterator1 __first1, _RandomAccessIterator1 __last1, _RandomAccessIterator2 __first2,
+              _Function __f,
+              /*vector=*/std::true_type) noexcept
+{
+    return __unseq_backend::__simd_walk_2(__first1, __last1 - __first1, __first2, __f);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator1, class _ForwardIterator2, class _Function, class _IsVector>
+_ForwardIterator2
+__pattern_walk2(_ExecutionPolicy&&, _ForwardIterator1 __first1, _ForwardIterator1 __last1,
+                _ForwardIterator2 __first2, _Function __f, _IsVector __is_vector,
+                /*parallel=*/std::false_type) noexcept
+{
+    return __brick_walk2(__first1, __last1, __first2, __f, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator1, class _ForwardIterator2, class _Function, class _IsVector>
+_ForwardIterator2
+__pattern_walk2(_ExecutionPolicy&& __exec, _ForwardIterator1 __first1, _ForwardIterator1 __last1,
+                _ForwardIterator2 __first2, _Function __f, _IsVector __is_vector,
+                /*parallel=*/std::true_type)
+{
+    __par_backend::__parallel_for(
+        std::forward<_ExecutionPolicy>(__exec), __first1, __last1,
+        [__f, __first1, __first2, __is_vector](_ForwardIterator1 __i, _ForwardIterator1 __j) {
+            __brick_walk2(__i, __j, __first2 + (__i - __first1), __f, __is_vector);
+        });
+    return __first2 + (__last1 - __first1);
+}
+
+template <class _ForwardIterator1, class _ForwardIterator2, class _ForwardIterator3, class _Function>
+_ForwardIterator3
+__brick_walk3(_ForwardIterator1 __first1, _ForwardIterator1 __last1, _ForwardIterator2 __first2,
+              _ForwardIterator3 __first3, _Function __f,
+              /*vector=*/std::false_type) noexcept
+{
+    for (; __first1 != __last1; ++__first1, ++__first2, ++__first3)
+        __f(*__first1, *__first2, *__first3);
+    return __first3;
+}
+
+template <class _RandomAccessIterator1, class _RandomAccessIterator2, class _RandomAccessIterator3, class _Function>
+_RandomAccessIterator3
+__brick_walk3(_RandomAccessIterator1 __first1, _RandomAccessIterator1 __last1, _RandomAccessIterator2 __first2,
+              _RandomAccessIterator3 __first3, _Function __f,
+              /*vector=*/std::true_type) noexcept
+{
+    return __unseq_backend::__simd_walk_3(__first1, __last1 - __first1, __first2, __first3, __f);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator1, class _ForwardIterator2, class _ForwardIterator3,
+          class _Function, class _IsVector>
+_ForwardIterator3
+__pattern_walk3(_ExecutionPolicy&&, _ForwardIterator1 __first1, _ForwardIterator1 __last1,
+                _ForwardIterator2 __first2, _ForwardIterator3 __first3, _Function __f, _IsVector __is_vector,
+                /*parallel=*/std::false_type) noexcept
+{
+    return __brick_walk3(__first1, __last1, __first2, __first3, __f, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator1, class _ForwardIterator2, class _ForwardIterator3,
+          class _Function, class _IsVector>
+_ForwardIterator3
+__pattern_walk3(_ExecutionPolicy&& __exec, _ForwardIterator1 __first1, _ForwardIterator1 __last1,
+                _ForwardIterator2 __first2, _ForwardIterator3 __first3, _Function __f, _IsVector __is_vector,
+                /*parallel=*/std::true_type)
+{
+    __par_backend::__parallel_for(
+        std::forward<_ExecutionPolicy>(__exec), __first1, __last1,
+        [__f, __first1, __first2, __first3, __is_vector](_ForwardIterator1 __i, _ForwardIterator1 __j) {
+            __brick_walk3(__i, __j, __first2 + (__i - __first1), __first3 + (__i - __first1), __f, __is_vector);
+        });
+    return __first3 + (__last1 - __first1);
+}
+
+//------------------------------------------------------------------------
+// sort, stable_sort
+//------------------------------------------------------------------------
+
+template <class _ExecutionPolicy, class _RandomAccessIterator, class _Compare, class _IsVector>
+void
+__pattern_sort(_ExecutionPolicy&&, _RandomAccessIterator __first, _RandomAccessIterator __last, _Compare __comp,
+               _IsVector,
+               /*is_parallel=*/std::false_type) noexcept
+{
+    std::sort(__first, __last, __comp);
+}
+
+template <class _ExecutionPolicy, class _RandomAccessIterator, class _Compare, class _IsVector>
+void
+__pattern_sort(_ExecutionPolicy&& __exec, _RandomAccessIterator __first, _RandomAccessIterator __last,
+               _Compare __comp, _IsVector,
+               /*is_parallel=*/std::true_type)
+{
+    __par_backend::__parallel_stable_sort(
+        std::forward<_ExecutionPolicy>(__exec), __first, __last, __comp,
+        [](_RandomAccessIterator __b, _RandomAccessIterator __e, _Compare __c) noexcept { std::sort(__b, __e, __c); });
+}
+
+template <class _ExecutionPolicy, class _RandomAccessIterator, class _Compare, class _IsVector>
+void
+__pattern_stable_sort(_ExecutionPolicy&&, _RandomAccessIterator __first, _RandomAccessIterator __last,
+                      _Compare __comp, _IsVector,
+                      /*is_parallel=*/std::false_type) noexcept
+{
+    std::stable_sort(__first, __last, __comp);
+}
+
+template <class _ExecutionPolicy, class _RandomAccessIterator, class _Compare, class _IsVector>
+void
+__pattern_stable_sort(_ExecutionPolicy&& __exec, _RandomAccessIterator __first, _RandomAccessIterator __last,
+                      _Compare __comp, _IsVector,
+                      /*is_parallel=*/std::true_type)
+{
+    __par_backend::__parallel_stable_sort(std::forward<_ExecutionPolicy>(__exec), __first, __last, __comp,
+                                          [](_RandomAccessIterator __b, _RandomAccessIterator __e,
+                                             _Compare __c) noexcept { std::stable_sort(__b, __e, __c); });
+}
+
+} // namespace __internal
+} // namespace __pstl
+
+#endif /* _PSTL_ALGORITHM_IMPL_H */
@@ -0,0 +1,57 @@
+// -*- C++ -*-
+//===-- execution_impl.h --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_EXECUTION_IMPL_H
+#define _PSTL_EXECUTION_IMPL_H
+
+#include <iterator>
+#include <type_traits>
+
+#include "execution_defs.h"
+
+namespace __pstl
+{
+namespace __internal
+{
+
+template <typename _IteratorTag, typename... _IteratorTypes>
+struct __is_iterator_of;
+
+template <typename _IteratorTag>
+struct __is_iterator_of<_IteratorTag> : std::true_type
+{
+};
+
+template <typename _IteratorTag, typename _Iterator, typename... _IteratorTypes>
+struct __is_iterator_of<_IteratorTag, _Iterator, _IteratorTypes...>
+    : std::integral_constant<
+          bool, std::is_base_of<_IteratorTag, typename std::iterator_traits<_Iterator>::iterator_category>::value &&
+                    __is_iterator_of<_IteratorTag, _IteratorTypes...>::value>
+{
+};
+
+template <typename... _IteratorTypes>
+using __are_random_access_iterators = __is_iterator_of<std::random_access_iterator_tag, _IteratorTypes...>;
+
+// Only random access iterators can be split into chunks for the threads, or
+// indexed by the vectorized loops, without walking the whole range first.
+template <typename _ExecutionPolicy, typename... _IteratorTypes>
+using __is_vectorization_preferred = std::integral_constant<
+    bool, decltype(std::decay<_ExecutionPolicy>::type::__allow_vector())::value &&
+              __are_random_access_iterators<_IteratorTypes...>::value>;
+
+template <typename _ExecutionPolicy, typename... _IteratorTypes>
+using __is_parallelization_preferred = std::integral_constant<
+    bool, decltype(std::decay<_ExecutionPolicy>::type::__allow_parallel())::value &&
+              __are_random_access_iterators<_IteratorTypes...>::value>;
+
+} // namespace __internal
+} // namespace __pstl
+
+#endif /* _PSTL_EXECUTION_IMPL_H */
@@ -0,0 +1,251 @@
+// -*- C++ -*-
+//===-- numeric_impl.h ----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_NUMERIC_IMPL_H
+#define _PSTL_NUMERIC_IMPL_H
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "execution_impl.h"
+#include "parallel_backend.h"
+#include "parallel_backend_utils.h"
+#include "unseq_backend_simd.h"
+
+namespace __pstl
+{
+namespace __internal
+{
+
+//------------------------------------------------------------------------
+// transform_reduce (version with two binary functions)
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator1, class _ForwardIterator2, class _Tp, class _BinaryOperation1,
+          class _BinaryOperation2>
+_Tp
+__brick_transform_reduce(_ForwardIterator1 __first1, _ForwardIterator1 __last1, _ForwardIterator2 __first2, _Tp __init,
+                         _BinaryOperation1 __binary_op1, _BinaryOperation2 __binary_op2,
+                         /*is_vector=*/std::false_type) noexcept
+{
+    for (; __first1 != __last1; ++__first1, ++__first2)
+        __init = __binary_op1(__init, __binary_op2(*__first1, *__first2));
+    return __init;
+}
+
+template <class _RandomAccessIterator1, class _RandomAccessIterator2, class _Tp, class _BinaryOperation1,
+          class _BinaryOperation2>
+_Tp
+__brick_transform_reduce(_RandomAccessIterator1 __first1, _RandomAccessIterator1 __last1,
+                         _RandomAccessIterator2 __first2, _Tp __init, _BinaryOperation1 __binary_op1,
+                         _BinaryOperation2 __binary_op2,
+                         /*is_vector=*/std::true_type) noexcept
+{
+    typedef typename std::iterator_traits<_RandomAccessIterator1>::difference_type _DifferenceType;
+    return __unseq_backend::__simd_transform_reduce(
+        __last1 - __first1, __init, __binary_op1,
+        [=, &__binary_op2](_DifferenceType __i) { return __binary_op2(__first1[__i], __first2[__i]); });
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator1, class _ForwardIterator2, class _Tp,
+          class _BinaryOperation1, class _BinaryOperation2, class _IsVector>
+_Tp
+__pattern_transform_reduce(_ExecutionPolicy&&, _ForwardIterator1 __first1, _ForwardIterator1 __last1,
+                           _ForwardIterator2 __first2, _Tp __init, _BinaryOperation1 __binary_op1,
+                           _BinaryOperation2 __binary_op2, _IsVector __is_vector,
+                           /*is_parallel=*/std::false_type) noexcept
+{
+    return __brick_transform_reduce(__first1, __last1, __first2, __init, __binary_op1, __binary_op2, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _RandomAccessIterator1, class _RandomAccessIterator2, class _Tp,
+          class _BinaryOperation1, class _BinaryOperation2, class _IsVector>
+_Tp
+__pattern_transform_reduce(_ExecutionPolicy&& __exec, _RandomAccessIterator1 __first1,
+                           _RandomAccessIterator1 __last1, _RandomAccessIterator2 __first2, _Tp __init,
+                           _BinaryOperation1 __binary_op1, _BinaryOperation2 __binary_op2, _IsVector __is_vector,
+                           /*is_parallel=*/std::true_type)
+{
+    return __par_backend::__parallel_transform_reduce(
+        std::forward<_ExecutionPolicy>(__exec), __first1, __last1,
+        [__first1, __first2, __binary_op2](_RandomAccessIterator1 __i) mutable {
+            return __binary_op2(*__i, *(__first2 + (__i - __first1)));
+        },
+        __init,
+        __binary_op1, // Combine
+        [__first1, __first2, __binary_op1, __binary_op2,
+         __is_vector](_RandomAccessIterator1 __i, _RandomAccessIterator1 __j, _Tp __init) -> _Tp {
+            return __brick_transform_reduce(__i, __j, __first2 + (__i - __first1), __init, __binary_op1,
+                                            __binary_op2, __is_vector);
+        });
+}
+
+//------------------------------------------------------------------------
+// transform_reduce (version with unary and binary functions)
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator, class _Tp, class _BinaryOperation, class _UnaryOperation>
+_Tp
+__brick_transform_reduce(_ForwardIterator __first, _ForwardIterator __last, _Tp __init, _BinaryOperation __binary_op,
+                         _UnaryOperation __unary_op,
+                         /*is_vector=*/std::false_type) noexcept
+{
+    for (; __first != __last; ++__first)
+        __init = __binary_op(__init, __unary_op(*__first));
+    return __init;
+}
+
+template <class _RandomAccessIterator, class _Tp, class _BinaryOperation, class _UnaryOperation>
+_Tp
+__brick_transform_reduce(_RandomAccessIterator __first, _RandomAccessIterator __last, _Tp __init,
+                         _BinaryOperation __binary_op, _UnaryOperation __unary_op,
+                         /*is_vector=*/std::true_type) noexcept
+{
+    typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _DifferenceType;
+    return __unseq_backend::__simd_transform_reduce(
+        __last - __first, __init, __binary_op,
+        [=, &__unary_op](_DifferenceType __i) { return __unary_op(__first[__i]); });
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Tp, class _BinaryOperation, class _UnaryOperation,
+          class _IsVector>
+_Tp
+__pattern_transform_reduce(_ExecutionPolicy&&, _ForwardIterator __first, _ForwardIterator __last, _Tp __init,
+                           _BinaryOperation __binary_op, _UnaryOperation __unary_op, _IsVector __is_vector,
+                           /*is_parallel=*/std::false_type) noexcept
+{
+    return __brick_transform_reduce(__first, __last, __init, __binary_op, __unary_op, __is_vector);
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _Tp, class _BinaryOperation, class _UnaryOperation,
+          class _IsVector>
+_Tp
+__pattern_transform_reduce(_ExecutionPolicy&& __exec, _ForwardIterator __first, _ForwardIterator __last, _Tp __init,
+                           _BinaryOperation __binary_op, _UnaryOperation __unary_op, _IsVector __is_vector,
+                           /*is_parallel=*/std::true_type)
+{
+    return __par_backend::__parallel_transform_reduce(
+        std::forward<_ExecutionPolicy>(__exec), __first, __last,
+        [__unary_op](_ForwardIterator __i) mutable { return __unary_op(*__i); }, __init, __binary_op,
+        [__unary_op, __binary_op, __is_vector](_ForwardIterator __i, _ForwardIterator __j, _Tp __init) -> _Tp {
+            return __brick_transform_reduce(__i, __j, __init, __binary_op, __unary_op, __is_vector);
+        });
+}
+
+//------------------------------------------------------------------------
+// transform_exclusive_scan, transform_inclusive_scan
+//------------------------------------------------------------------------
+
+template <class _ForwardIterator, class _OutputIterator, class _UnaryOperation, class _Tp, class _BinaryOperation,
+          class _Inclusive>
+_OutputIterator
+__brick_transform_scan(_ForwardIterator __first, _ForwardIterator __last, _OutputIterator __result,
+                       _UnaryOperation __unary_op, _Tp __init, _BinaryOperation __binary_op,
+                       _Inclusive) noexcept
+{
+    for (; __first != __last; ++__first, ++__result)
+    {
+        // The element is read before anything is written, so that the scan
+        // can be done in place.
+        if (_Inclusive::value)
+        {
+            __init = __binary_op(__init, __unary_op(*__first));
+            *__result = __init;
+        }
+        else
+        {
+            _Tp __next = __binary_op(__init, __unary_op(*__first));
+            *__result = __init;
+            __init = __next;
+        }
+    }
+    return __result;
+}
+
+template <class _ExecutionPolicy, class _ForwardIterator, class _OutputIterator, class _UnaryOperation, class _Tp,
+          class _BinaryOperation, class _Inclusive, class _IsVector>
+_OutputIterator
+__pattern_transform_scan(_ExecutionPolicy&&, _ForwardIterator __first, _ForwardIterator __last,
+                         _OutputIterator __result, _UnaryOperation __unary_op, _Tp __init,
+                         _BinaryOperation __binary_op, _Inclusive, _IsVector,
+                         /*is_parallel=*/std::false_type) noexcept
+{
+    return __brick_transform_scan(__first, __last, __result, __unary_op, __init, __binary_op, _Inclusive());
+}
+
+//! Subranges shorter than this are not split any further when scanning.
+const std::ptrdiff_t __scan_grain = 4096;
+
+//! The most subranges a scan is split into.
+const std::ptrdiff_t __scan_max_chunks = 256;
+
+template <class _ExecutionPolicy, class _RandomAccessIterator, class _OutputIterator, class _UnaryOperation,
+          class _Tp, class _BinaryOperation, class _Inclusive, class _IsVector>
+_OutputIterator
+__pattern_transform_scan(_ExecutionPolicy&& __exec, _RandomAccessIterator __first, _RandomAccessIterator __last,
+                         _OutputIterator __result, _UnaryOperation __unary_op, _Tp __init,
+                         _BinaryOperation __binary_op, _Inclusive, _IsVector __is_vector,
+                         /*is_parallel=*/std::true_type)
+{
+    typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _DifferenceType;
+    const _DifferenceType __n = __last - __first;
+    const _DifferenceType __chunks = std::min<_DifferenceType>(__n / __scan_grain, __scan_max_chunks);
+    if (__chunks <= 1)
+        return __brick_transform_scan(__first, __last, __result, __unary_op, __init, __binary_op, _Inclusive());
+
+    // The scan takes two passes. The first one reduces every chunk, the
+    // partial sums are then scanned on this thread, and the second pass scans
+    // every chunk starting from the sum of everything before it.
+    __par_backend::__buffer<_Tp> __sums_buf(__chunks);
+    _Tp* __sums = __sums_buf.get();
+    __par_backend::__parallel_for(
+        __exec, _DifferenceType(0), __chunks,
+        [__first, __n, __chunks, __sums, __unary_op, __binary_op, __is_vector](_DifferenceType __k,
+                                                                               _DifferenceType __l) {
+            for (; __k != __l; ++__k)
+            {
+                _RandomAccessIterator __b = __first + __par_backend::__chunk_begin(__n, __chunks, __k);
+                _RandomAccessIterator __e = __first + __par_backend::__chunk_begin(__n, __chunks, __k + 1);
+                ::new (static_cast<void*>(__sums + __k))
+                    _Tp(__brick_transform_reduce(__b + 1, __e, _Tp(__unary_op(*__b)), __binary_op, __unary_op,
+                                                 __is_vector));
+            }
+        });
+
+    std::vector<_Tp> __offsets;
+    __offsets.reserve(__chunks);
+    __offsets.push_back(__init);
+    for (_DifferenceType __k = 1; __k < __chunks; ++__k)
+        __offsets.push_back(__binary_op(__offsets.back(), __sums[__k - 1]));
+    for (_DifferenceType __k = 0; __k < __chunks; ++__k)
+        __sums[__k].~_Tp();
+
+    const _Tp* __offs = __offsets.data();
+    __par_backend::__parallel_for(
+        std::forward<_ExecutionPolicy>(__exec), _DifferenceType(0), __chunks,
+        [__first, __result, __n, __chunks, __offs, __unary_op, __binary_op](_DifferenceType __k,
+                                                                            _DifferenceType __l) {
+            for (; __k != __l; ++__k)
+            {
+                const _DifferenceType __b = __par_backend::__chunk_begin(__n, __chunks, __k);
+                const _DifferenceType __e = __par_backend::__chunk_begin(__n, __chunks, __k + 1);
+                __brick_transform_scan(__first + __b, __first + __e, __result + __b, __unary_op, __offs[__k],
+                                       __binary_op, _Inclusive());
+            }
+        });
+    return __result + __n;
+}
+
+} // namespace __internal
+} // namespace __pstl
+
+#endif /* _PSTL_NUMERIC_IMPL_H */
@@ -0,0 +1,40 @@
+// -*- C++ -*-
+//===-- parallel_backend.h ------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_PARALLEL_BACKEND_H
+#define _PSTL_PARALLEL_BACKEND_H
+
+#include "pstl_config.h"
+
+// Every backend provides the following in namespace __pstl::__par_backend:
+//
+//   void __parallel_for(__exec, __first, __last, __f)
+//     Calls __f(__b, __e) on disjoint subranges that cover [__first, __last).
+//
+//   _Tp __parallel_transform_reduce(__exec, __first, __last, __u, __init,
+//                                   __combine, __brick_reduce)
+//     Reduces [__first, __last) in order, where __u(__i) transforms the first
+//     element of a subrange and __brick_reduce(__b, __e, __acc) folds the rest
+//     of it into __acc. The partial results are joined with __combine.
+//
+//   void __parallel_stable_sort(__exec, __first, __last, __comp, __leaf_sort)
+//     Stably sorts [__first, __last), calling __leaf_sort(__b, __e, __comp)
+//     on the subranges.
+
+#if defined(_PSTL_PAR_BACKEND_SERIAL)
+#    include "parallel_backend_serial.h"
+#elif defined(_PSTL_PAR_BACKEND_OMP)
+#    include "parallel_backend_omp.h"
+#elif defined(_PSTL_PAR_BACKEND_TBB)
+#    include "parallel_backend_tbb.h"
+#else
+#    error "Parallel backend was not specified"
+#endif
+
+#endif /* _PSTL_PARALLEL_BACKEND_H */
@@ -0,0 +1,118 @@
+// -*- C++ -*-
+//===-- parallel_backend_omp.h --------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_PARALLEL_BACKEND_OMP_H
+#define _PSTL_PARALLEL_BACKEND_OMP_H
+
+#if !defined(_OPENMP)
+#    error "The OpenMP backend requires compiling with OpenMP enabled (e.g. -fopenmp)"
+#endif
+
+#include <omp.h>
+
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+#include "parallel_backend_utils.h"
+
+namespace __pstl
+{
+namespace __par_backend
+{
+
+//! Calls __f(__i) for every __i in [0, __count) on the threads of a new
+//! parallel region. Inside a parallel region, e.g. when an element access
+//! function calls a parallel algorithm, the calls are made on this thread.
+template <typename _Size, typename _Fp>
+void
+__omp_run(_Size __count, _Fp __f)
+{
+    if (__count == 1 || omp_in_parallel())
+    {
+        for (_Size __i = 0; __i < __count; ++__i)
+            __f(__i);
+        return;
+    }
+#pragma omp parallel for schedule(dynamic)
+    for (_Size __i = 0; __i < __count; ++__i)
+        __f(__i);
+}
+
+template <class _ExecutionPolicy, class _Index, class _Fp>
+void
+__parallel_for(_ExecutionPolicy&&, _Index __first, _Index __last, _Fp __f)
+{
+    typedef typename std::decay<decltype(__last - __first)>::type _Size;
+    const _Size __n = __last - __first;
+    if (__n <= 1 || omp_in_parallel())
+    {
+        __f(__first, __last);
+        return;
+    }
+    const _Size __chunks = __chunk_count(__n, omp_get_max_threads());
+    __omp_run(__chunks, [=](_Size __i) {
+        __f(__first + __chunk_begin(__n, __chunks, __i), __first + __chunk_begin(__n, __chunks, __i + 1));
+    });
+}
+
+template <class _ExecutionPolicy, class _Index, class _Up, class _Tp, class _Cp, class _Rp>
+_Tp
+__parallel_transform_reduce(_ExecutionPolicy&&, _Index __first, _Index __last, _Up __u, _Tp __init, _Cp __combine,
+                            _Rp __brick_reduce)
+{
+    typedef typename std::decay<decltype(__last - __first)>::type _Size;
+    const _Size __n = __last - __first;
+    if (__n <= 1 || omp_in_parallel())
+        return __brick_reduce(__first, __last, __init);
+
+    // Every chunk is reduced on its own, starting from its first element, and
+    // the partial results are then combined in order on this thread.
+    const _Size __chunks = __chunk_count(__n, omp_get_max_threads());
+    __buffer<_Tp> __partial(__chunks);
+    _Tp* __p = __partial.get();
+    __omp_run(__chunks, [=](_Size __i) {
+        _Index __b = __first + __chunk_begin(__n, __chunks, __i);
+        _Index __e = __first + __chunk_begin(__n, __chunks, __i + 1);
+        _Up __uc = __u;
+        ::new (static_cast<void*>(__p + __i)) _Tp(__brick_reduce(__b + 1, __e, __uc(__b)));
+    });
+    for (_Size __i = 0; __i < __chunks; ++__i)
+    {
+        __init = __combine(__init, __p[__i]);
+        __p[__i].~_Tp();
+    }
+    return __init;
+}
+
+template <class _ExecutionPolicy, typename _RandomAccessIterator, typename _Compare, typename _LeafSort>
+void
+__parallel_stable_sort(_ExecutionPolicy&&, _RandomAccessIterator __first, _RandomAccessIterator __last,
+                       _Compare __comp, _LeafSort __leaf_sort)
+{
+    typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Size;
+    const _Size __n = __last - __first;
+    if (__n <= __sort_cutoff || omp_in_parallel())
+    {
+        __leaf_sort(__first, __last, __comp);
+        return;
+    }
+    const _Size __chunks = std::min<_Size>(__n / __sort_cutoff, omp_get_max_threads());
+    auto __run = [](_Size __count, auto __f) { __omp_run(__count, __f); };
+    __run(__chunks, [=](_Size __i) {
+        __leaf_sort(__first + __chunk_begin(__n, __chunks, __i), __first + __chunk_begin(__n, __chunks, __i + 1),
+                    __comp);
+    });
+    __merge_sorted_chunks(__first, __n, __chunks, __comp, __run);
+}
+
+} // namespace __par_backend
+} // namespace __pstl
+
+#endif /* _PSTL_PARALLEL_BACKEND_OMP_H */
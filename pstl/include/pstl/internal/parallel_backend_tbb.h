@@ -0,0 +1,145 @@
+// -*- C++ -*-
+//===-- parallel_backend_tbb.h --------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_PARALLEL_BACKEND_TBB_H
+#define _PSTL_PARALLEL_BACKEND_TBB_H
+
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/task_arena.h>
+
+#include "parallel_backend_utils.h"
+
+namespace __pstl
+{
+namespace __par_backend
+{
+
+template <class _ExecutionPolicy, class _Index, class _Fp>
+void
+__parallel_for(_ExecutionPolicy&&, _Index __first, _Index __last, _Fp __f)
+{
+    tbb::this_task_arena::isolate([=]() {
+        tbb::parallel_for(tbb::blocked_range<_Index>(__first, __last),
+                          [__f](const tbb::blocked_range<_Index>& __r) { __f(__r.begin(), __r.end()); });
+    });
+}
+
+//! The body of tbb::parallel_reduce. A body that was split off another one
+//! has no sum until it reduces its first subrange, so no identity is needed.
+template <class _Index, class _Up, class _Tp, class _Cp, class _Rp>
+struct __par_trans_red_body
+{
+    alignas(_Tp) char _M_sum_storage[sizeof(_Tp)];
+    _Rp _M_brick_reduce;
+    _Up _M_u;
+    _Cp _M_combine;
+    bool _M_has_sum;
+
+    _Tp&
+    sum()
+    {
+        return *reinterpret_cast<_Tp*>(_M_sum_storage);
+    }
+
+    __par_trans_red_body(_Up __u, _Tp __init, _Cp __c, _Rp __r)
+        : _M_brick_reduce(__r), _M_u(__u), _M_combine(__c), _M_has_sum(true)
+    {
+        ::new (_M_sum_storage) _Tp(__init);
+    }
+
+    __par_trans_red_body(__par_trans_red_body& __left, tbb::split)
+        : _M_brick_reduce(__left._M_brick_reduce), _M_u(__left._M_u), _M_combine(__left._M_combine),
+          _M_has_sum(false)
+    {
+    }
+
+    ~__par_trans_red_body()
+    {
+        if (_M_has_sum)
+            sum().~_Tp();
+    }
+
+    void
+    join(__par_trans_red_body& __rhs)
+    {
+        if (!__rhs._M_has_sum)
+            return;
+        if (!_M_has_sum)
+        {
+            ::new (_M_sum_storage) _Tp(__rhs.sum());
+            _M_has_sum = true;
+            return;
+        }
+        sum() = _M_combine(sum(), __rhs.sum());
+    }
+
+    void
+    operator()(const tbb::blocked_range<_Index>& __range)
+    {
+        _Index __i = __range.begin();
+        _Index __j = __range.end();
+        if (!_M_has_sum)
+        {
+            ::new (_M_sum_storage) _Tp(_M_u(__i));
+            _M_has_sum = true;
+            ++__i;
+            if (__i == __j)
+                return;
+        }
+        sum() = _M_brick_reduce(__i, __j, sum());
+    }
+};
+
+template <class _ExecutionPolicy, class _Index, class _Up, class _Tp, class _Cp, class _Rp>
+_Tp
+__parallel_transform_reduce(_ExecutionPolicy&&, _Index __first, _Index __last, _Up __u, _Tp __init, _Cp __combine,
+                            _Rp __brick_reduce)
+{
+    __par_trans_red_body<_Index, _Up, _Tp, _Cp, _Rp> __body(__u, __init, __combine, __brick_reduce);
+    tbb::this_task_arena::isolate([__first, __last, &__body]() {
+        tbb::parallel_reduce(tbb::blocked_range<_Index>(__first, __last), __body);
+    });
+    return __body.sum();
+}
+
+template <class _ExecutionPolicy, typename _RandomAccessIterator, typename _Compare, typename _LeafSort>
+void
+__parallel_stable_sort(_ExecutionPolicy&&, _RandomAccessIterator __first, _RandomAccessIterator __last,
+                       _Compare __comp, _LeafSort __leaf_sort)
+{
+    typedef typename std::iterator_traits<_RandomAccessIterator>::difference_type _Size;
+    const _Size __n = __last - __first;
+    if (__n <= __sort_cutoff)
+    {
+        __leaf_sort(__first, __last, __comp);
+        return;
+    }
+    const _Size __chunks = std::min<_Size>(__n / __sort_cutoff, tbb::this_task_arena::max_concurrency());
+    auto __run = [](_Size __count, auto __f) {
+        tbb::this_task_arena::isolate([__count, &__f]() {
+            tbb::parallel_for(_Size(0), __count, [&__f](_Size __i) { __f(__i); });
+        });
+    };
+    __run(__chunks, [=](_Size __i) {
+        __leaf_sort(__first + __chunk_begin(__n, __chunks, __i), __first + __chunk_begin(__n, __chunks, __i + 1),
+                    __comp);
+    });
+    __merge_sorted_chunks(__first, __n, __chunks, __comp, __run);
+}
+
+} // namespace __par_backend
+} // namespace __pstl
+
+#endif /* _PSTL_PARALLEL_BACKEND_TBB_H */
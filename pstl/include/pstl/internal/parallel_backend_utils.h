@@ -0,0 +1,92 @@
+// -*- C++ -*-
+//===-- parallel_backend_utils.h ------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_PARALLEL_BACKEND_UTILS_H
+#define _PSTL_PARALLEL_BACKEND_UTILS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+namespace __pstl
+{
+namespace __par_backend
+{
+
+//! Raw memory for __n objects of type _Tp. The objects are constructed and
+//! destroyed by the user of the buffer.
+template <typename _Tp>
+class __buffer
+{
+    std::allocator<_Tp> _M_allocator;
+    _Tp* _M_ptr;
+    const std::size_t _M_buf_size;
+
+    __buffer(const __buffer&) = delete;
+    void
+    operator=(const __buffer&) = delete;
+
+  public:
+    explicit __buffer(std::size_t __n) : _M_allocator(), _M_ptr(_M_allocator.allocate(__n)), _M_buf_size(__n) {}
+
+    ~__buffer() { _M_allocator.deallocate(_M_ptr, _M_buf_size); }
+
+    _Tp*
+    get() const
+    {
+        return _M_ptr;
+    }
+};
+
+//! Where the __i-th of __chunks nearly equal parts of [0, __n) starts.
+template <typename _Size>
+_Size
+__chunk_begin(_Size __n, _Size __chunks, _Size __i)
+{
+    return __n / __chunks * __i + std::min(__i, __n % __chunks);
+}
+
+//! The number of chunks that [0, __n) is split into for __threads workers.
+//! There are a few chunks per worker so that uneven chunks balance out.
+template <typename _Size>
+_Size
+__chunk_count(_Size __n, int __threads)
+{
+    return std::min<_Size>(__n, _Size(__threads) * 4);
+}
+
+//! Subranges shorter than this are not split any further when sorting.
+const std::ptrdiff_t __sort_cutoff = 2048;
+
+//! Merges the __chunks sorted chunks of [__first, __first + __n) pairwise,
+//! doubling their length each round. __run(__count, __f) calls __f(__i) for
+//! every __i in [0, __count), possibly in parallel.
+template <typename _RandomAccessIterator, typename _Size, typename _Compare, typename _Runner>
+void
+__merge_sorted_chunks(_RandomAccessIterator __first, _Size __n, _Size __chunks, _Compare __comp, _Runner __run)
+{
+    for (_Size __width = 1; __width < __chunks; __width *= 2)
+    {
+        const _Size __pairs = (__chunks + 2 * __width - 1) / (2 * __width);
+        __run(__pairs, [=](_Size __k) {
+            const _Size __i = 2 * __width * __k;
+            if (__i + __width >= __chunks)
+                return;
+            const _Size __j = std::min(__i + 2 * __width, __chunks);
+            std::inplace_merge(__first + __chunk_begin(__n, __chunks, __i),
+                               __first + __chunk_begin(__n, __chunks, __i + __width),
+                               __first + __chunk_begin(__n, __chunks, __j), __comp);
+        });
+    }
+}
+
+} // namespace __par_backend
+} // namespace __pstl
+
+#endif /* _PSTL_PARALLEL_BACKEND_UTILS_H */
@@ -0,0 +1,37 @@
+// -*- C++ -*-
+//===-- pstl_config.h -----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_CONFIG_H
+#define _PSTL_CONFIG_H
+
+// The version is XYYZ, where X is major, YY is minor, and Z is patch (i.e. X.YY.Z)
+#define _PSTL_VERSION 9000
+#define _PSTL_VERSION_MAJOR (_PSTL_VERSION / 1000)
+#define _PSTL_VERSION_MINOR ((_PSTL_VERSION % 1000) / 10)
+#define _PSTL_VERSION_PATCH (_PSTL_VERSION % 10)
+
+#if !defined(_PSTL_PAR_BACKEND_SERIAL) && !defined(_PSTL_PAR_BACKEND_OMP) && !defined(_PSTL_PAR_BACKEND_TBB)
+#    error "A parallel backend must be specified"
+#endif
+
+#define _PSTL_PRAGMA(x) _Pragma(#x)
+
+// Loops over the elements of unsequenced policies are annotated so that they
+// are vectorized even when the compiler cannot prove that it is safe.
+#if defined(_OPENMP) && _OPENMP >= 201307
+#    define _PSTL_PRAGMA_SIMD _PSTL_PRAGMA(omp simd)
+#elif defined(__clang__)
+#    define _PSTL_PRAGMA_SIMD _PSTL_PRAGMA(clang loop vectorize(enable) interleave(enable))
+#elif defined(__GNUC__)
+#    define _PSTL_PRAGMA_SIMD _PSTL_PRAGMA(GCC ivdep)
+#else
+#    define _PSTL_PRAGMA_SIMD
+#endif
+
+#endif /* _PSTL_CONFIG_H */
@@ -0,0 +1,68 @@
+// -*- C++ -*-
+//===-- unseq_backend_simd.h ----------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_UNSEQ_BACKEND_SIMD_H
+#define _PSTL_UNSEQ_BACKEND_SIMD_H
+
+#include "pstl_config.h"
+
+// The loops of the unsequenced policies. They index the ranges instead of
+// incrementing iterators so that the compiler sees a countable loop.
+namespace __pstl
+{
+namespace __unseq_backend
+{
+
+template <class _Iterator, class _DifferenceType, class _Function>
+_Iterator
+__simd_walk_1(_Iterator __first, _DifferenceType __n, _Function __f) noexcept
+{
+    _PSTL_PRAGMA_SIMD
+    for (_DifferenceType __i = 0; __i < __n; ++__i)
+        __f(__first[__i]);
+
+    return __first + __n;
+}
+
+template <class _Iterator1, class _DifferenceType, class _Iterator2, class _Function>
+_Iterator2
+__simd_walk_2(_Iterator1 __first1, _DifferenceType __n, _Iterator2 __first2, _Function __f) noexcept
+{
+    _PSTL_PRAGMA_SIMD
+    for (_DifferenceType __i = 0; __i < __n; ++__i)
+        __f(__first1[__i], __first2[__i]);
+    return __first2 + __n;
+}
+
+template <class _Iterator1, class _DifferenceType, class _Iterator2, class _Iterator3, class _Function>
+_Iterator3
+__simd_walk_3(_Iterator1 __first1, _DifferenceType __n, _Iterator2 __first2, _Iterator3 __first3,
+              _Function __f) noexcept
+{
+    _PSTL_PRAGMA_SIMD
+    for (_DifferenceType __i = 0; __i < __n; ++__i)
+        __f(__first1[__i], __first2[__i], __first3[__i]);
+    return __first3 + __n;
+}
+
+// The order of the reduction is left to the compiler, which only reorders
+// it where that is known to be safe, e.g. for integer addition.
+template <class _DifferenceType, class _Tp, class _BinaryOperation, class _UnaryOperation>
+_Tp
+__simd_transform_reduce(_DifferenceType __n, _Tp __init, _BinaryOperation __binary_op, _UnaryOperation __f) noexcept
+{
+    for (_DifferenceType __i = 0; __i < __n; ++__i)
+        __init = __binary_op(__init, __f(__i));
+    return __init;
+}
+
+} // namespace __unseq_backend
+} // namespace __pstl
+
+#endif /* _PSTL_UNSEQ_BACKEND_SIMD_H */
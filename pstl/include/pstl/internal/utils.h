@@ -0,0 +1,68 @@
+// -*- C++ -*-
+//===-- utils.h -----------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PSTL_UTILS_H
+#define _PSTL_UTILS_H
+
+#include <utility>
+
+namespace __pstl
+{
+namespace __internal
+{
+
+//! Unary operator that returns reference to its argument.
+struct __no_op
+{
+    template <typename _Tp>
+    _Tp&&
+    operator()(_Tp&& __a) const
+    {
+        return std::forward<_Tp>(__a);
+    }
+};
+
+//! Logical negation of a predicate
+template <typename _Pred>
+class __not_pred
+{
+    _Pred _M_pred;
+
+  public:
+    explicit __not_pred(_Pred __pred) : _M_pred(__pred) {}
+
+    template <typename... _Args>
+    bool
+    operator()(_Args&&... __args)
+    {
+        return !_M_pred(std::forward<_Args>(__args)...);
+    }
+};
+
+//! "==" comparison with a value.
+template <typename _Tp>
+class __equal_value
+{
+    const _Tp& _M_value;
+
+  public:
+    explicit __equal_value(const _Tp& __value) : _M_value(__value) {}
+
+    template <typename _Arg>
+    bool
+    operator()(_Arg&& __arg) const
+    {
+        return std::forward<_Arg>(__arg) == _M_value;
+    }
+};
+
+} // namespace __internal
+} // namespace __pstl
+
+#endif /* _PSTL_UTILS_H */
@@ -0,0 +1,74 @@
+// -*- C++ -*-
+//===-- transform.pass.cpp ------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <execution>
+#include <list>
+#include <vector>
+
+#include "support/utils.h"
+
+using namespace TestUtils;
+
+struct test_walk
+{
+    template <typename Policy>
+    void
+    operator()(Policy&& exec, std::size_t n)
+    {
+        std::vector<int> in(n);
+        std::generate(exec, in.begin(), in.end(), [] { return 3; });
+        EXPECT_TRUE(std::all_of(in.begin(), in.end(), [](int x) { return x == 3; }), "wrong result from generate");
+        for (std::size_t i = 0; i < n; ++i)
+            in[i] = int(i);
+
+        std::vector<int> out(n);
+        auto end = std::transform(exec, in.begin(), in.end(), out.begin(), [](int x) { return 2 * x; });
+        EXPECT_TRUE(end == out.end(), "wrong return value from transform");
+        for (std::size_t i = 0; i < n; ++i)
+            EXPECT_TRUE(out[i] == 2 * int(i), "wrong result from unary transform");
+
+        std::vector<long> sum(n);
+        std::transform(exec, in.begin(), in.end(), out.begin(), sum.begin(), [](int x, int y) { return long(x) + y; });
+        for (std::size_t i = 0; i < n; ++i)
+            EXPECT_TRUE(sum[i] == 3 * long(i), "wrong result from binary transform");
+
+        std::for_each(exec, out.begin(), out.end(), [](int& x) { x += 1; });
+        for (std::size_t i = 0; i < n; ++i)
+            EXPECT_TRUE(out[i] == 2 * int(i) + 1, "wrong result from for_each");
+
+        std::for_each_n(exec, out.begin(), n / 2, [](int& x) { x = -1; });
+        EXPECT_TRUE(std::count(out.begin(), out.end(), -1) == std::ptrdiff_t(n / 2), "wrong result from for_each_n");
+
+        std::fill(exec, out.begin(), out.end(), 7);
+        EXPECT_TRUE(std::count(out.begin(), out.end(), 7) == std::ptrdiff_t(n), "wrong result from fill");
+        EXPECT_TRUE(std::fill_n(exec, out.begin(), n / 3, 8) == out.begin() + n / 3, "wrong return from fill_n");
+        EXPECT_TRUE(std::count(out.begin(), out.end(), 8) == std::ptrdiff_t(n / 3), "wrong result from fill_n");
+
+        EXPECT_TRUE(std::copy(exec, in.begin(), in.end(), out.begin()) == out.end(), "wrong return from copy");
+        EXPECT_TRUE(out == in, "wrong result from copy");
+        std::copy_n(exec, in.rbegin(), n, out.begin());
+        EXPECT_TRUE(std::equal(out.begin(), out.end(), in.rbegin()), "wrong result from copy_n");
+
+        // Iterators that are not random access are walked on one thread.
+        std::list<int> l(in.begin(), in.end());
+        std::for_each(exec, l.begin(), l.end(), [](int& x) { x *= 3; });
+        EXPECT_TRUE(std::equal(l.begin(), l.end(), in.begin(), [](int x, int y) { return x == 3 * y; }),
+                    "wrong result from for_each on a list");
+    }
+};
+
+int
+main()
+{
+    for (std::size_t n : {0, 1, 2, 1000, 100000})
+        invoke_on_all_policies(test_walk(), n);
+    done();
+    return 0;
+}
@@ -0,0 +1,64 @@
+// -*- C++ -*-
+//===-- find_if.pass.cpp --------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <execution>
+#include <vector>
+
+#include "support/utils.h"
+
+using namespace TestUtils;
+
+struct test_find_if
+{
+    template <typename Policy>
+    void
+    operator()(Policy&& exec, const std::vector<int>& in)
+    {
+        // The first of several matches is found, wherever it is.
+        for (std::size_t pos : {std::size_t(0), std::size_t(1), in.size() / 3, in.size() / 2, in.size() - 1})
+        {
+            auto it = std::find_if(exec, in.begin(), in.end(), [pos](int x) { return x >= int(pos); });
+            EXPECT_TRUE(it - in.begin() == std::ptrdiff_t(pos), "wrong result from find_if");
+            EXPECT_TRUE(std::find(exec, in.begin(), in.end(), int(pos)) == it, "wrong result from find");
+        }
+        EXPECT_TRUE(std::find_if(exec, in.begin(), in.end(), [](int x) { return x < 0; }) == in.end(),
+                    "find_if found an element that does not match");
+        EXPECT_TRUE(std::find_if_not(exec, in.begin(), in.end(), [](int x) { return x < 10; }) == in.begin() + 10,
+                    "wrong result from find_if_not");
+
+        EXPECT_TRUE(std::any_of(exec, in.begin(), in.end(), [](int x) { return x == 12345; }), "wrong any_of");
+        EXPECT_FALSE(std::any_of(exec, in.begin(), in.end(), [](int x) { return x < 0; }), "wrong any_of");
+        EXPECT_TRUE(std::all_of(exec, in.begin(), in.end(), [](int x) { return x >= 0; }), "wrong all_of");
+        EXPECT_FALSE(std::all_of(exec, in.begin(), in.end(), [](int x) { return x != 5; }), "wrong all_of");
+        EXPECT_TRUE(std::none_of(exec, in.begin(), in.end(), [](int x) { return x < 0; }), "wrong none_of");
+
+        EXPECT_TRUE(std::count_if(exec, in.begin(), in.end(), [](int x) { return x % 3 == 0; }) ==
+                        std::count_if(in.begin(), in.end(), [](int x) { return x % 3 == 0; }),
+                    "wrong result from count_if");
+        EXPECT_TRUE(std::count(exec, in.begin(), in.end(), 7) == 1, "wrong result from count");
+    }
+};
+
+int
+main()
+{
+    std::vector<int> in(100000);
+    for (std::size_t i = 0; i < in.size(); ++i)
+        in[i] = int(i);
+    invoke_on_all_policies(test_find_if(), in);
+
+    std::vector<int> empty;
+    EXPECT_TRUE(std::find_if(std::execution::par, empty.begin(), empty.end(), [](int) { return true; }) ==
+                    empty.end(),
+                "find_if on an empty range");
+
+    done();
+    return 0;
+}
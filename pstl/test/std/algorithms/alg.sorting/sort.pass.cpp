@@ -0,0 +1,60 @@
+// -*- C++ -*-
+//===-- sort.pass.cpp -----------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "support/utils.h"
+
+using namespace TestUtils;
+
+struct test_sort
+{
+    template <typename Policy>
+    void
+    operator()(Policy&& exec, std::size_t n)
+    {
+        std::mt19937 gen(n);
+        std::uniform_int_distribution<int> dist(0, 100);
+
+        std::vector<int> v(n);
+        for (int& x : v)
+            x = dist(gen);
+        std::vector<int> expected = v;
+        std::sort(expected.begin(), expected.end());
+        std::sort(exec, v.begin(), v.end());
+        EXPECT_TRUE(v == expected, "wrong result from sort");
+
+        std::sort(exec, v.begin(), v.end(), std::greater<int>());
+        EXPECT_TRUE(std::is_sorted(v.begin(), v.end(), std::greater<int>()), "wrong result from sort with comp");
+
+        // Equal keys keep their order.
+        std::vector<std::pair<int, std::size_t>> p(n);
+        for (std::size_t i = 0; i < n; ++i)
+            p[i] = std::make_pair(dist(gen), i);
+        std::stable_sort(exec, p.begin(), p.end(),
+                         [](const std::pair<int, std::size_t>& a, const std::pair<int, std::size_t>& b) {
+                             return a.first < b.first;
+                         });
+        EXPECT_TRUE(std::is_sorted(p.begin(), p.end()), "wrong result from stable_sort");
+    }
+};
+
+int
+main()
+{
+    for (std::size_t n : {0, 1, 2, 100, 5000, 100000, 1000003})
+        invoke_on_all_policies(test_sort(), n);
+    done();
+    return 0;
+}
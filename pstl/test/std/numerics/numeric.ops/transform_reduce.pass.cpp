@@ -0,0 +1,102 @@
+// -*- C++ -*-
+//===-- transform_reduce.pass.cpp -----------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+#include <execution>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "support/utils.h"
+
+using namespace TestUtils;
+
+struct test_reduce
+{
+    template <typename Policy>
+    void
+    operator()(Policy&& exec, std::size_t n)
+    {
+        std::vector<long> in(n);
+        std::iota(in.begin(), in.end(), 1);
+        const long sum = long(n) * long(n + 1) / 2;
+
+        EXPECT_TRUE(std::reduce(exec, in.begin(), in.end()) == sum, "wrong result from reduce");
+        EXPECT_TRUE(std::reduce(exec, in.begin(), in.end(), 10L) == sum + 10, "wrong result from reduce with init");
+        EXPECT_TRUE(std::transform_reduce(exec, in.begin(), in.end(), 0L, std::plus<long>(),
+                                          [](long x) { return 2 * x; }) == 2 * sum,
+                    "wrong result from unary transform_reduce");
+        EXPECT_TRUE(std::transform_reduce(exec, in.begin(), in.end(), in.begin(), 0L) ==
+                        std::inner_product(in.begin(), in.end(), in.begin(), 0L),
+                    "wrong result from binary transform_reduce");
+
+        // The operation is not commutative, so the elements must be combined
+        // in order.
+        std::vector<std::string> s(n % 5000);
+        std::string expected = "x";
+        for (std::size_t i = 0; i < s.size(); ++i)
+        {
+            s[i] = std::string(1, char('a' + i % 26));
+            expected += s[i];
+        }
+        EXPECT_TRUE(std::reduce(exec, s.begin(), s.end(), std::string("x"), std::plus<std::string>()) == expected,
+                    "reduce did not combine the elements in order");
+    }
+};
+
+struct test_scan
+{
+    template <typename Policy>
+    void
+    operator()(Policy&& exec, std::size_t n)
+    {
+        std::vector<int> in(n);
+        for (std::size_t i = 0; i < n; ++i)
+            in[i] = int(i % 7) - 3;
+        std::vector<int> expected(n), out(n);
+
+        std::inclusive_scan(in.begin(), in.end(), expected.begin());
+        EXPECT_TRUE(std::inclusive_scan(exec, in.begin(), in.end(), out.begin()) == out.end(),
+                    "wrong return value from inclusive_scan");
+        EXPECT_TRUE(out == expected, "wrong result from inclusive_scan");
+
+        std::inclusive_scan(in.begin(), in.end(), expected.begin(), std::plus<int>(), 5);
+        std::inclusive_scan(exec, in.begin(), in.end(), out.begin(), std::plus<int>(), 5);
+        EXPECT_TRUE(out == expected, "wrong result from inclusive_scan with init");
+
+        std::exclusive_scan(in.begin(), in.end(), expected.begin(), 5);
+        std::exclusive_scan(exec, in.begin(), in.end(), out.begin(), 5);
+        EXPECT_TRUE(out == expected, "wrong result from exclusive_scan");
+
+        std::transform_exclusive_scan(in.begin(), in.end(), expected.begin(), 0, std::plus<int>(),
+                                      [](int x) { return x * x; });
+        std::transform_exclusive_scan(exec, in.begin(), in.end(), out.begin(), 0, std::plus<int>(),
+                                      [](int x) { return x * x; });
+        EXPECT_TRUE(out == expected, "wrong result from transform_exclusive_scan");
+
+        // In place.
+        std::transform_inclusive_scan(in.begin(), in.end(), expected.begin(), std::plus<int>(),
+                                      [](int x) { return x * 2; });
+        std::transform_inclusive_scan(exec, in.begin(), in.end(), in.begin(), std::plus<int>(),
+                                      [](int x) { return x * 2; });
+        EXPECT_TRUE(in == expected, "wrong result from transform_inclusive_scan");
+    }
+};
+
+int
+main()
+{
+    for (std::size_t n : {0, 1, 2, 1000, 100000, 1000003})
+    {
+        invoke_on_all_policies(test_reduce(), n);
+        invoke_on_all_policies(test_scan(), n);
+    }
+    done();
+    return 0;
+}
@@ -0,0 +1,56 @@
+// -*- C++ -*-
+//===-- utils.h -----------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// File contains common utilities that tests rely on
+
+#ifndef _PSTL_TEST_SUPPORT_UTILS_H
+#define _PSTL_TEST_SUPPORT_UTILS_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <execution>
+#include <utility>
+
+namespace TestUtils
+{
+
+inline void
+expect(bool expected, bool condition, const char* file, int line, const char* message)
+{
+    if (condition != expected)
+    {
+        std::fprintf(stderr, "%s:%d: error: %s\n", file, line, message);
+        std::exit(1);
+    }
+}
+
+#define EXPECT_TRUE(condition, message) TestUtils::expect(true, condition, __FILE__, __LINE__, message)
+#define EXPECT_FALSE(condition, message) TestUtils::expect(false, condition, __FILE__, __LINE__, message)
+
+// Calls __op with every execution policy followed by __rest. The sizes the
+// tests use are large enough that the parallel policies split the ranges.
+template <typename _Op, typename... _Rest>
+void
+invoke_on_all_policies(_Op __op, _Rest&&... __rest)
+{
+    __op(std::execution::seq, std::forward<_Rest>(__rest)...);
+    __op(std::execution::unseq, std::forward<_Rest>(__rest)...);
+    __op(std::execution::par, std::forward<_Rest>(__rest)...);
+    __op(std::execution::par_unseq, std::forward<_Rest>(__rest)...);
+}
+
+inline void
+done()
+{
+    std::printf("done\n");
+}
+
+} // namespace TestUtils
+
+#endif /* _PSTL_TEST_SUPPORT_UTILS_H */